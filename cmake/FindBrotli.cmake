@@ -0,0 +1,36 @@
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+# All rights reserved.
+#
+# This source code is licensed under the BSD-style license found in the
+# LICENSE file in the root directory of this source tree.
+
+# - Find brotli
+# Find the brotli compression libraries and includes
+#
+# BROTLI_INCLUDE_DIR - where to find brotli/encode.h, etc.
+# BROTLI_LIBRARIES - List of libraries when using brotli.
+# BROTLI_FOUND - True if brotli found.
+
+find_path(BROTLI_INCLUDE_DIR
+  NAMES brotli/encode.h
+  HINTS ${BROTLI_ROOT_DIR}/include)
+
+find_library(BROTLI_ENC_LIBRARY
+  NAMES brotlienc
+  HINTS ${BROTLI_ROOT_DIR}/lib)
+
+find_library(BROTLI_DEC_LIBRARY
+  NAMES brotlidec
+  HINTS ${BROTLI_ROOT_DIR}/lib)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Brotli DEFAULT_MSG
+  BROTLI_ENC_LIBRARY BROTLI_DEC_LIBRARY BROTLI_INCLUDE_DIR)
+
+set(BROTLI_LIBRARIES ${BROTLI_ENC_LIBRARY} ${BROTLI_DEC_LIBRARY})
+
+mark_as_advanced(
+  BROTLI_ENC_LIBRARY
+  BROTLI_DEC_LIBRARY
+  BROTLI_INCLUDE_DIR
+)
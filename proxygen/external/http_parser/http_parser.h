@@ -309,7 +309,10 @@ size_t http_parser_execute(http_parser *parser,
   /* Begin Facebook */
 enum http_parser_options
 {
-  F_HTTP_PARSER_OPTIONS_URL_STRICT           = (1 << 0)
+  F_HTTP_PARSER_OPTIONS_URL_STRICT           = (1 << 0),
+  /* Skip over runs of plain header name/value octets in 16/32-byte strides
+   * (SSE2/AVX2/NEON when available).  Parsing results are unchanged. */
+  F_HTTP_PARSER_OPTIONS_VECTORIZED           = (1 << 1)
 };
 
 size_t http_parser_execute_options(http_parser *parser,
@@ -27,6 +27,18 @@
 #include <stddef.h>
 #include <stdlib.h>
 
+/* Begin Facebook */
+#if defined(__GNUC__)
+# if defined(__AVX2__)
+#  include <immintrin.h>
+# elif defined(__SSE2__)
+#  include <emmintrin.h>
+# elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+# endif
+#endif
+/* End Facebook */
+
 #if __cplusplus
 #include <limits>
 
@@ -442,6 +454,166 @@ enum http_host_state
 #define IS_HEADER_CHAR(ch)                                                     \
   (ch == CR || ch == LF || ch == 9 || ((unsigned char)ch > 31 && ch != 127))
 
+/* Begin Facebook */
+#define IS_PARSER_VECTORIZED(options)                                          \
+  ((options) & F_HTTP_PARSER_OPTIONS_VECTORIZED)
+
+/**
+ * A header value octet that the s_header_value/h_general loop consumes
+ * without a state change: anything but CR, LF, '"', '\\', DEL and controls
+ * other than HT.
+ **/
+#define IS_PLAIN_HEADER_VALUE_CHAR(ch)                                         \
+  ((ch) != QT && (ch) != BS && (ch) != 127 &&                                  \
+   ((unsigned char)(ch) > 31 || (ch) == 9))
+
+#if defined(__GNUC__) && !defined(__AVX2__) && !defined(__SSE2__) &&          \
+  defined(__ARM_NEON)
+/* Collapse a 0x00/0xff byte mask into 4 bits per lane */
+static inline uint64_t neon_mask(uint8x16_t v)
+{
+  return vget_lane_u64(
+    vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+}
+#endif
+
+/**
+ * The scanners below return the length of the longest prefix of [p, end)
+ * made of octets the byte-at-a-time state machine would skip over in the
+ * h_general header field/value states.  The vector strides only recognize a
+ * subset of those octets and may stop early; the caller then resumes the
+ * regular state machine at that byte, so results are identical either way.
+ **/
+static size_t scan_header_value(const char *p, const char *end)
+{
+  const char *start = p;
+#if defined(__GNUC__) && defined(__AVX2__)
+  const __m256i ctl = _mm256_set1_epi8(0x1f);
+  const __m256i ht = _mm256_set1_epi8('\t');
+  const __m256i qt = _mm256_set1_epi8(QT);
+  const __m256i bs = _mm256_set1_epi8(BS);
+  const __m256i del = _mm256_set1_epi8(127);
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i stop = _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v);
+    stop = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, ht), stop);
+    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, qt));
+    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, bs));
+    stop = _mm256_or_si256(stop, _mm256_cmpeq_epi8(v, del));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(stop);
+    if (mask) {
+      return (size_t)(p - start) + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+#elif defined(__GNUC__) && defined(__SSE2__)
+  const __m128i ctl = _mm_set1_epi8(0x1f);
+  const __m128i ht = _mm_set1_epi8('\t');
+  const __m128i qt = _mm_set1_epi8(QT);
+  const __m128i bs = _mm_set1_epi8(BS);
+  const __m128i del = _mm_set1_epi8(127);
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i stop = _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v);
+    stop = _mm_andnot_si128(_mm_cmpeq_epi8(v, ht), stop);
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, qt));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, bs));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, del));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(stop);
+    if (mask) {
+      return (size_t)(p - start) + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+#elif defined(__GNUC__) && defined(__ARM_NEON)
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)p);
+    uint8x16_t stop = vbicq_u8(vcleq_u8(v, vdupq_n_u8(0x1f)),
+                               vceqq_u8(v, vdupq_n_u8('\t')));
+    stop = vorrq_u8(stop, vceqq_u8(v, vdupq_n_u8(QT)));
+    stop = vorrq_u8(stop, vceqq_u8(v, vdupq_n_u8(BS)));
+    stop = vorrq_u8(stop, vceqq_u8(v, vdupq_n_u8(127)));
+    uint64_t mask = neon_mask(stop);
+    if (mask) {
+      return (size_t)(p - start) + (__builtin_ctzll(mask) >> 2);
+    }
+    p += 16;
+  }
+#endif
+  while (p != end && IS_PLAIN_HEADER_VALUE_CHAR(*p)) {
+    p++;
+  }
+  return (size_t)(p - start);
+}
+
+/* The vector strides accept [A-Za-z0-9-]; the tail accepts any token char */
+static size_t scan_header_field(const char *p, const char *end)
+{
+  const char *start = p;
+#if defined(__GNUC__) && defined(__AVX2__)
+  const __m256i lowerBit = _mm256_set1_epi8(0x20);
+  const __m256i a = _mm256_set1_epi8('a');
+  const __m256i zero = _mm256_set1_epi8('0');
+  const __m256i dash = _mm256_set1_epi8('-');
+  const __m256i alphaMax = _mm256_set1_epi8(25);
+  const __m256i digitMax = _mm256_set1_epi8(9);
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(v, lowerBit), a);
+    __m256i digit = _mm256_sub_epi8(v, zero);
+    __m256i ok = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, alphaMax), alpha);
+    ok = _mm256_or_si256(
+      ok, _mm256_cmpeq_epi8(_mm256_min_epu8(digit, digitMax), digit));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(v, dash));
+    uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ok);
+    if (mask) {
+      return (size_t)(p - start) + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+#elif defined(__GNUC__) && defined(__SSE2__)
+  const __m128i lowerBit = _mm_set1_epi8(0x20);
+  const __m128i a = _mm_set1_epi8('a');
+  const __m128i zero = _mm_set1_epi8('0');
+  const __m128i dash = _mm_set1_epi8('-');
+  const __m128i alphaMax = _mm_set1_epi8(25);
+  const __m128i digitMax = _mm_set1_epi8(9);
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i alpha = _mm_sub_epi8(_mm_or_si128(v, lowerBit), a);
+    __m128i digit = _mm_sub_epi8(v, zero);
+    __m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(alpha, alphaMax), alpha);
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(_mm_min_epu8(digit, digitMax), digit));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, dash));
+    uint32_t mask = ~(uint32_t)_mm_movemask_epi8(ok) & 0xffff;
+    if (mask) {
+      return (size_t)(p - start) + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+#elif defined(__GNUC__) && defined(__ARM_NEON)
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)p);
+    uint8x16_t alpha = vsubq_u8(vorrq_u8(v, vdupq_n_u8(0x20)),
+                                vdupq_n_u8('a'));
+    uint8x16_t digit = vsubq_u8(v, vdupq_n_u8('0'));
+    uint8x16_t ok = vcleq_u8(alpha, vdupq_n_u8(25));
+    ok = vorrq_u8(ok, vcleq_u8(digit, vdupq_n_u8(9)));
+    ok = vorrq_u8(ok, vceqq_u8(v, vdupq_n_u8('-')));
+    uint64_t mask = ~neon_mask(ok);
+    if (mask) {
+      return (size_t)(p - start) + (__builtin_ctzll(mask) >> 2);
+    }
+    p += 16;
+  }
+#endif
+  while (p != end && TOKEN(*p)) {
+    p++;
+  }
+  return (size_t)(p - start);
+}
+/* End Facebook */
+
 #define start_state (parser->type == HTTP_REQUEST ? s_pre_start_req : s_pre_start_res)
 
 #define STRICT_CHECK(cond)
@@ -1531,6 +1703,10 @@ size_t http_parser_execute_options (http_parser *parser,
         if (c) {
           switch (parser->header_state) {
             case h_general:
+              if (IS_PARSER_VECTORIZED(options)) {
+                p += scan_header_field(p + 1, data + len);
+                break;
+              }
 
               // fast-forwarding, wheeeeeee!
               #define MOVE_THE_HEAD do { \
@@ -1731,6 +1907,11 @@ size_t http_parser_execute_options (http_parser *parser,
               parser->header_state = h_general_and_quote;
             }
 
+            if (IS_PARSER_VECTORIZED(options)) {
+              p += scan_header_value(p + 1, data + len);
+              break;
+            }
+
             // fast-forwarding, wheee!
             #define MOVE_FAST do {                    \
               ++p;                                    \
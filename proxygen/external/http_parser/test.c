@@ -1580,6 +1580,9 @@ parser_init (enum http_parser_type type)
   http_parser_init(parser, type);
 #if HTTP_PARSER_STRICT_URL
   parser_options |= F_HTTP_PARSER_OPTIONS_URL_STRICT;
+#endif
+#if HTTP_PARSER_TEST_VECTORIZED
+  parser_options |= F_HTTP_PARSER_OPTIONS_VECTORIZED;
 #endif
   memset(&messages, 0, sizeof messages);
 
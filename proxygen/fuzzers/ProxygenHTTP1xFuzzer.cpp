@@ -14,10 +14,42 @@
 using namespace proxygen;
 using namespace std;
 
+namespace {
+
+vector<pair<string, string>> getHeaderList(const HTTPMessage* msg) {
+  vector<pair<string, string>> headers;
+  if (msg) {
+    msg->getHeaders().forEach([&](const string& name, const string& value) {
+      headers.emplace_back(name, value);
+    });
+  }
+  return headers;
+}
+
+} // namespace
+
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* Data, size_t Size) {
   FakeHTTPCodecCallback callbacks;
   HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
   codec.setCallback(&callbacks);
   parse(&codec, Data, Size, Size);
+
+  // The vectorized scanner must be indistinguishable from the scalar parser
+  FakeHTTPCodecCallback vectorCallbacks;
+  HTTP1xCodec vectorCodec(TransportDirection::DOWNSTREAM);
+  vectorCodec.setVectorizedParsing(true);
+  vectorCodec.setCallback(&vectorCallbacks);
+  parse(&vectorCodec, Data, Size, Size);
+
+  CHECK_EQ(callbacks.messageBegin, vectorCallbacks.messageBegin);
+  CHECK_EQ(callbacks.headersComplete, vectorCallbacks.headersComplete);
+  CHECK_EQ(callbacks.messageComplete, vectorCallbacks.messageComplete);
+  CHECK_EQ(callbacks.bodyLength, vectorCallbacks.bodyLength);
+  CHECK_EQ(callbacks.chunkHeaders, vectorCallbacks.chunkHeaders);
+  CHECK_EQ(callbacks.trailers, vectorCallbacks.trailers);
+  CHECK_EQ(callbacks.streamErrors, vectorCallbacks.streamErrors);
+  CHECK_EQ(callbacks.sessionErrors, vectorCallbacks.sessionErrors);
+  CHECK(getHeaderList(callbacks.msg.get()) ==
+        getHeaderList(vectorCallbacks.msg.get()));
   return 0;
 }
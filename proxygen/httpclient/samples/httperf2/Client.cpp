@@ -165,6 +165,22 @@ void Client::setUseQuic(bool useQuic) {
   useQuic_ = useQuic;
 }
 
+void Client::setOpenLoop(bool openLoop) {
+  openLoop_ = openLoop;
+}
+
+void Client::addArrival(TimePoint intendedStart) {
+  CHECK(openLoop_);
+  arrivals_.push_back(intendedStart);
+  wake();
+}
+
+void Client::wake() {
+  if (!isLoopCallbackScheduled()) {
+    eventBase_->runInLoop(this);
+  }
+}
+
 bool Client::supportsTickets() const {
   return (sslContext_ &&
           !(SSL_CTX_get_options(sslContext_->getSSLCtx()) & SSL_OP_NO_TICKET));
@@ -301,15 +317,23 @@ void Client::sendRequest() {
   uint32_t requestsThisLoop = 0;
   while ((outstandingTransactions_ <
           uint32_t(FLAGS_max_outstanding_transactions)) &&
-         (requestsSent_ < requests_) &&
+         (requestsSent_ < requests_) && (!openLoop_ || !arrivals_.empty()) &&
          (requestsThisLoop++ < uint32_t(FLAGS_req_per_loop))) {
-    auto handler = new TransactionHandler(this);
+    TransactionHandler* handler = nullptr;
+    if (openLoop_) {
+      handler = new TransactionHandler(this, arrivals_.front());
+    } else {
+      handler = new TransactionHandler(this);
+    }
     auto txn = session_->newTransaction(handler);
     if (!txn) {
       // The session doesn't support any more transactions
       delete handler;
       break;
     }
+    if (openLoop_) {
+      arrivals_.pop_front();
+    }
     outstandingTransactions_++;
     requestsSent_++;
     stats_.addRequest();
@@ -328,7 +352,7 @@ void Client::sendRequest() {
   }
   if ((outstandingTransactions_ <
        uint32_t(FLAGS_max_outstanding_transactions)) &&
-      (requestsSent_ < requests_)) {
+      (requestsSent_ < requests_) && (!openLoop_ || !arrivals_.empty())) {
     eventBase_->runInLoop(this);
   }
 }
@@ -452,7 +476,9 @@ void Client::TransactionHandler::onTrailers(
 
 void Client::TransactionHandler::onEOM() noexcept {
   inMessage_ = false;
-  parent_->stats_.addResponse(millisecondsSince(requestStart_).count());
+  auto now = getCurrentTime();
+  parent_->stats_.addResponse(millisecondsBetween(now, requestStart_).count());
+  parent_->stats_.addResponseLatency(microsecondsBetween(now, requestStart_));
 
   // TODO: not always true. Could have sent partial headers and then
   // error'd, but since we don't have a onMessageBegin(), we have to guess
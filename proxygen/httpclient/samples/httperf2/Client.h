@@ -9,6 +9,7 @@
 #pragma once
 
 #include <chrono>
+#include <deque>
 #include <fizz/client/PskCache.h>
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <proxygen/httpclient/samples/httperf2/HTTPerfStats.h>
@@ -63,6 +64,15 @@ class Client
   void setQuicPskCache(std::shared_ptr<quic::QuicPskCache> quicPskCache);
   void setQLoggerPath(const std::string& path);
 
+  // In open-loop mode the client only sends requests handed to it by
+  // addArrival, and charges their latency from the intended start, so a
+  // slow server can't hold back the arrival rate.
+  void setOpenLoop(bool openLoop);
+  void addArrival(::proxygen::TimePoint intendedStart);
+
+  // Lets an idle client notice exitAllSoon
+  void wake();
+
   [[nodiscard]] bool supportsTickets() const;
   std::shared_ptr<folly::ssl::SSLSession> extractSSLSession();
 
@@ -96,6 +106,9 @@ class Client
    public:
     explicit TransactionHandler(Client* parent) : parent_(parent) {
     }
+    TransactionHandler(Client* parent, ::proxygen::TimePoint requestStart)
+        : parent_(parent), requestStart_(requestStart) {
+    }
     void setTransaction(proxygen::HTTPTransaction* txn) noexcept override {
       txn_ = txn;
     }
@@ -181,6 +194,10 @@ class Client
 
   bool inDestructor_{false};
   bool shouldReuseSession_{false};
+  bool openLoop_{false};
+
+  // Intended start times of the open-loop requests not sent yet
+  std::deque<::proxygen::TimePoint> arrivals_;
 
   std::unique_ptr<proxygen::HQConnector> hqConnector_;
 
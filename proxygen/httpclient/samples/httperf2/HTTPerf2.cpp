@@ -33,8 +33,11 @@
 #include <proxygen/httpclient/samples/httperf2/HTTPerfStats.h>
 #include <proxygen/lib/http/HTTPMessage.h>
 
+#include <algorithm>
 #include <csignal>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <openssl/engine.h>
 #include <random>
 
@@ -54,6 +57,13 @@ DEFINE_string(
     "",
     "If specified, the test will wait for the file to exist before starting");
 
+// Open-loop load
+DEFINE_double(rate,
+              0,
+              "Requests per second across all threads, sent regardless of "
+              "responses; 0 for closed-loop clients.  Needs -duration");
+DEFINE_string(arrival, "constant", "Open-loop arrivals, constant/poisson");
+
 // Target Params
 DEFINE_string(server, "localhost", "Server name");
 DEFINE_int32(port, 8080, "Server port");
@@ -100,6 +110,10 @@ DEFINE_string(quic_qlogger_path,
 // Output options
 DEFINE_string(testname, "", "Test name (prefixed to all the JSON keys");
 DEFINE_bool(json, false, "Output as JSON");
+DEFINE_string(latency_histogram_file,
+              "",
+              "Write the response latency distribution (msec) to this file, "
+              "in HdrHistogram percentile format");
 
 namespace {
 
@@ -129,7 +143,8 @@ class ClientRunner
                size_t numClients,
                size_t numRequests,
                size_t clientsAtOnce,
-               int32_t quicTransportTimerResolutionMs);
+               int32_t quicTransportTimerResolutionMs,
+               double rate);
 
   void run();
 
@@ -143,6 +158,24 @@ class ClientRunner
   using SSLParams =
       std::pair<folly::SSLContextPtr, std::shared_ptr<folly::ssl::SSLSession>>;
 
+  class ArrivalTimeout : public folly::AsyncTimeout {
+   public:
+    ArrivalTimeout(folly::EventBase* evb, ClientRunner& runner)
+        : folly::AsyncTimeout(evb), runner_(runner) {
+    }
+
+    void timeoutExpired() noexcept override {
+      runner_.scheduleArrivals();
+    }
+
+   private:
+    ClientRunner& runner_;
+  };
+
+  // Hands every open-loop request due by now to a client, round robin
+  void scheduleArrivals();
+  std::chrono::nanoseconds getInterArrival();
+
   HTTPerfStats& parentStats_;
   HTTPerfStats stats_;
   size_t remainingClients_;
@@ -165,6 +198,14 @@ class ClientRunner
   std::shared_ptr<fizz::client::BasicPskCache> pskCache_;
   std::shared_ptr<quic::BasicQuicPskCache> quicPskCache_;
 
+  // Open-loop requests per second for this thread, 0 when closed-loop
+  double rate_;
+  std::exponential_distribution<double> arrivalDistribution_;
+  ArrivalTimeout arrivalTimeout_;
+  TimePoint nextArrival_;
+  std::vector<Client*> clients_;
+  size_t nextClient_{0};
+
   uint32_t getClientRequests();
 
   const SSLParams& getSSLParams();
@@ -178,10 +219,16 @@ int httperf2(folly::Optional<folly::SocketAddress> bindAddress) {
   if (FLAGS_threads <= 0 || FLAGS_clients <= 0 || FLAGS_clients_at_once <= 0 ||
       (FLAGS_request_avg <= 0 && FLAGS_requests <= 0) || FLAGS_ticket_pct < 0 ||
       FLAGS_ticket_pct > 100 || FLAGS_resume_pct < 0 ||
-      FLAGS_resume_pct > 100) {
+      FLAGS_resume_pct > 100 || FLAGS_rate < 0 ||
+      (FLAGS_arrival != "constant" && FLAGS_arrival != "poisson")) {
     std::cerr << "Invalid arguments" << std::endl;
     return 1;
   }
+  if (FLAGS_rate > 0 && FLAGS_duration <= 0) {
+    std::cerr << "Open-loop -rate needs -duration" << std::endl;
+    return 1;
+  }
+  auto rate = FLAGS_rate / FLAGS_threads;
   auto numRequests = FLAGS_requests;
   if (FLAGS_request_avg > 0) {
     std::cerr << "Using request_avg" << std::endl;
@@ -233,7 +280,8 @@ int httperf2(folly::Optional<folly::SocketAddress> bindAddress) {
                    numClients,
                    numRequests,
                    clientsAtOnce,
-                   FLAGS_client_quic_transport_timer_resolution_ms);
+                   FLAGS_client_quic_transport_timer_resolution_ms,
+                   rate);
     r.run();
   } else {
     std::list<std::thread> threads;
@@ -245,7 +293,8 @@ int httperf2(folly::Optional<folly::SocketAddress> bindAddress) {
           numClients,
           numRequests,
           clientsAtOnce,
-          FLAGS_client_quic_transport_timer_resolution_ms);
+          FLAGS_client_quic_transport_timer_resolution_ms,
+          rate);
       threads.emplace_back([r]() { r->run(); });
       if (FLAGS_delaystart > 0 && i + 1 < FLAGS_threads) {
         // @lint-ignore CLANGTIDY
@@ -266,6 +315,15 @@ int httperf2(folly::Optional<folly::SocketAddress> bindAddress) {
   } else {
     stats.printStats(durationMs);
   }
+  if (!FLAGS_latency_histogram_file.empty()) {
+    std::ofstream file(FLAGS_latency_histogram_file);
+    if (!file) {
+      std::cerr << "Failed to open " << FLAGS_latency_histogram_file
+                << std::endl;
+      return 1;
+    }
+    stats.printLatencyHistogram(file);
+  }
 
   return 0;
 }
@@ -278,7 +336,8 @@ ClientRunner::ClientRunner(HTTPerfStats& parentStats,
                            size_t numClients,
                            size_t numRequests,
                            size_t clientsAtOnce,
-                           int32_t quicTransportTimerResolutionMs)
+                           int32_t quicTransportTimerResolutionMs,
+                           double rate)
     : parentStats_(parentStats),
       remainingClients_(numClients),
       numRequests_(numRequests),
@@ -295,7 +354,10 @@ ClientRunner::ClientRunner(HTTPerfStats& parentStats,
       resumeDistribution_(0, 100),
       clientsOutstanding_(0),
       pskCache_(std::make_shared<fizz::client::BasicPskCache>()),
-      quicPskCache_(std::make_shared<quic::BasicQuicPskCache>()) {
+      quicPskCache_(std::make_shared<quic::BasicQuicPskCache>()),
+      rate_(rate),
+      arrivalDistribution_(rate > 0 ? rate : 1.0),
+      arrivalTimeout_(&eventBase_, *this) {
   attachEventBase(&eventBase_);
 
   if (remainingClients_ == 0) {
@@ -387,6 +449,12 @@ void ClientRunner::run() {
     startClient();
   }
 
+  if (rate_ > 0) {
+    // The clients stay connected for the whole run, and take turns with
+    // the arrivals
+    nextArrival_ = getCurrentTime();
+    scheduleArrivals();
+  }
   if (FLAGS_duration > 0) {
     scheduleTimeout(FLAGS_duration * 1000);
   }
@@ -400,6 +468,30 @@ void ClientRunner::timeoutExpired() noexcept {
   VLOG(3) << "Duration timeout expired";
   Client::exitAllSoon();
   remainingClients_ = 0;
+  arrivalTimeout_.cancelTimeout();
+  for (auto client : clients_) {
+    client->wake();
+  }
+}
+
+void ClientRunner::scheduleArrivals() {
+  if (clients_.empty()) {
+    return;
+  }
+  auto now = getCurrentTime();
+  while (nextArrival_ <= now) {
+    clients_[nextClient_++ % clients_.size()]->addArrival(nextArrival_);
+    nextArrival_ += getInterArrival();
+  }
+  arrivalTimeout_.scheduleTimeout(
+      std::chrono::ceil<milliseconds>(nextArrival_ - now));
+}
+
+std::chrono::nanoseconds ClientRunner::getInterArrival() {
+  double seconds = FLAGS_arrival == "poisson" ? arrivalDistribution_(rng_)
+                                              : 1.0 / rate_;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(seconds));
 }
 
 void ClientRunner::startClient() {
@@ -412,7 +504,8 @@ void ClientRunner::startClient() {
                       address_,
                       request_,
                       requestData_,
-                      getClientRequests(),
+                      rate_ > 0 ? std::numeric_limits<uint32_t>::max()
+                                : getClientRequests(),
                       this,
                       plaintextProto_,
                       serverName_);
@@ -439,6 +532,10 @@ void ClientRunner::startClient() {
       client->setQLoggerPath(FLAGS_quic_qlogger_path);
     }
   }
+  if (rate_ > 0) {
+    client->setOpenLoop(true);
+    clients_.push_back(client);
+  }
   remainingClients_--;
   clientsOutstanding_++;
   client->start();
@@ -458,6 +555,8 @@ void ClientRunner::clientFinished(Client* client) {
     }
   }
   clientsOutstanding_--;
+  clients_.erase(std::remove(clients_.begin(), clients_.end(), client),
+                 clients_.end());
   delete client;
   VLOG(3) << __func__ << " clientsOutstanding=" << clientsOutstanding_
           << " remainingClients=" << remainingClients_;
@@ -8,10 +8,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <folly/io/async/EventBase.h>
 #include <folly/json.h>
 #include <iostream>
 #include <mutex>
+#include <proxygen/lib/stats/LatencyHistogram.h>
+#include <vector>
 
 /**
  * Thread-local statistics for HTTPerf2.
@@ -84,6 +88,11 @@ class HTTPerfStats {
     reqLatency_.addValue(reqLat);
   }
 
+  // Distribution of response latencies, for percentiles
+  void addResponseLatency(std::chrono::microseconds reqLat) {
+    reqLatencyHist_.record(reqLat);
+  }
+
   void addErrorLat(uint32_t reqLat) {
     reqLatency_.addValue(reqLat);
   }
@@ -153,6 +162,7 @@ class HTTPerfStats {
     eofErrors_.addValue(stats.eofErrors_.sum);
     connLatency_.addValue(stats.connLatency_);
     reqLatency_.addValue(stats.reqLatency_);
+    reqLatencyHist_.merge(stats.reqLatencyHist_);
   }
 
   std::map<std::string, size_t> aggregateSums() {
@@ -187,6 +197,72 @@ class HTTPerfStats {
     return results;
   }
 
+  std::vector<std::pair<std::string, uint64_t>> aggregatePercentiles() {
+    static const std::vector<std::pair<std::string, double>> kPercentiles{
+        {"p50", 50.0},
+        {"p90", 90.0},
+        {"p99", 99.0},
+        {"p99.9", 99.9},
+        {"p99.99", 99.99},
+    };
+    std::vector<std::pair<std::string, uint64_t>> results;
+    const std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& percentile : kPercentiles) {
+      results.emplace_back(
+          "HTTPerf_req_lat_" + percentile.first,
+          reqLatencyHist_.getPercentile(percentile.second));
+    }
+    results.emplace_back("HTTPerf_req_lat_max", reqLatencyHist_.getMax());
+    return results;
+  }
+
+  // Writes the response latency distribution in msec, in HdrHistogram's
+  // percentile text format which its plotting tools read
+  void printLatencyHistogram(std::ostream& os) {
+    using proxygen::LatencyHistogram;
+    const std::lock_guard<std::mutex> lock(mutex_);
+    auto total = reqLatencyHist_.getCount();
+    char line[128];
+    snprintf(line,
+             sizeof(line),
+             "%12s %14s %10s %14s\n\n",
+             "Value",
+             "Percentile",
+             "TotalCount",
+             "1/(1-Percentile)");
+    os << line;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LatencyHistogram::kNumBuckets; i++) {
+      auto count = reqLatencyHist_.getBucketCount(i);
+      if (count == 0) {
+        continue;
+      }
+      seen += count;
+      double fraction = double(seen) / double(total);
+      auto value = std::min(LatencyHistogram::bucketUpperBound(i),
+                            reqLatencyHist_.getMax());
+      int len = snprintf(line,
+                         sizeof(line),
+                         "%12.3f %2.12f %10lu",
+                         double(value) / 1000.0,
+                         fraction,
+                         (unsigned long)seen);
+      if (seen < total) {
+        snprintf(line + len,
+                 sizeof(line) - len,
+                 " %14.2f",
+                 1.0 / (1.0 - fraction));
+      }
+      os << line << "\n";
+    }
+    snprintf(line,
+             sizeof(line),
+             "#[Max = %12.3f, Total count = %12lu]\n",
+             double(reqLatencyHist_.getMax()) / 1000.0,
+             (unsigned long)total);
+    os << line;
+  }
+
   void printStats(std::chrono::milliseconds durationMs) {
     auto results = aggregateSums();
     for (const auto& item : results) {
@@ -202,6 +278,9 @@ class HTTPerfStats {
     for (const auto& item : results) {
       printf("  %-21s: %7ld msec\n", item.first.c_str(), item.second);
     }
+    for (const auto& item : aggregatePercentiles()) {
+      printf("  %-21s: %7lu usec\n", item.first.c_str(), item.second);
+    }
     printf("  %-21s: %9ld ms\n", "Run time", durationMs.count());
   }
 
@@ -217,6 +296,9 @@ class HTTPerfStats {
     for (const auto& item : results) {
       d[testname + "." + item.first] = item.second;
     }
+    for (const auto& item : aggregatePercentiles()) {
+      d[testname + "." + item.first + "_us"] = item.second;
+    }
 
     d[testname + ".runtime"] = durationMs.count();
     std::cout << toPrettyJson(d) << std::endl;
@@ -244,4 +326,5 @@ class HTTPerfStats {
   SumStat eofErrors_;
   AvgStat connLatency_;
   AvgStat reqLatency_;
+  proxygen::LatencyHistogram reqLatencyHist_;
 };
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/CoroRequestHandler.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <proxygen/httpserver/ResponseHandler.h>
+
+namespace proxygen {
+
+void CoroRequestHandler::onRequest(
+    std::unique_ptr<HTTPMessage> headers) noexcept {
+  running_ = true;
+  run(std::move(headers))
+      .scheduleOn(folly::getKeepAliveToken(evb_))
+      .start([this](folly::Try<void>&& result) {
+        onHandlerDone(std::move(result));
+      });
+}
+
+folly::coro::Task<void> CoroRequestHandler::run(
+    std::unique_ptr<HTTPMessage> headers) {
+  // The request may have failed before the coroutine started
+  if (!hasError()) {
+    co_await handleRequest(std::move(headers));
+  }
+}
+
+void CoroRequestHandler::onHandlerDone(folly::Try<void>&& result) noexcept {
+  running_ = false;
+  if (result.hasException()) {
+    LOG(ERROR) << "Request handler failed: " << result.exception().what();
+    if (!hasError() && !complete_) {
+      // Detaching the transaction calls requestComplete() or onError(),
+      // which delete this if it hadn't been yet
+      downstream_->sendAbort();
+      return;
+    }
+  }
+  if (hasError() || complete_) {
+    delete this;
+  }
+}
+
+void CoroRequestHandler::onBody(std::unique_ptr<folly::IOBuf> body) noexcept {
+  body_.append(std::move(body));
+  if (!ingressPaused_ && body_.chainLength() > kMaxBufferedBody) {
+    ingressPaused_ = true;
+    downstream_->pauseIngress();
+  }
+  maybeResume();
+}
+
+void CoroRequestHandler::onEOM() noexcept {
+  eom_ = true;
+  maybeResume();
+}
+
+void CoroRequestHandler::requestComplete() noexcept {
+  complete_ = true;
+  if (!running_) {
+    delete this;
+    return;
+  }
+  maybeResume();
+}
+
+void CoroRequestHandler::onError(ProxygenError err) noexcept {
+  error_ = err == kErrorNone ? kErrorUnknown : err;
+  if (!running_) {
+    delete this;
+    return;
+  }
+  maybeResume();
+}
+
+void CoroRequestHandler::onEgressPaused() noexcept {
+  egressPaused_ = true;
+}
+
+void CoroRequestHandler::onEgressResumed() noexcept {
+  egressPaused_ = false;
+  maybeResume();
+}
+
+bool CoroRequestHandler::isReady(Waiting waiting) const {
+  if (hasError() || complete_) {
+    return true;
+  }
+  if (waiting == Waiting::BODY) {
+    return !body_.empty() || eom_;
+  }
+  return !egressPaused_;
+}
+
+void CoroRequestHandler::throwIfError() const {
+  if (hasError()) {
+    HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS,
+                     getErrorString(error_));
+    ex.setProxygenError(error_);
+    throw ex;
+  }
+}
+
+std::unique_ptr<folly::IOBuf> CoroRequestHandler::takeBody() {
+  if (ingressPaused_ && !complete_) {
+    ingressPaused_ = false;
+    downstream_->resumeIngress();
+  }
+  return body_.move();
+}
+
+void CoroRequestHandler::maybeResume() {
+  if (waiting_ == Waiting::NONE || !isReady(waiting_)) {
+    return;
+  }
+  waiting_ = Waiting::NONE;
+  std::exchange(waiter_, {}).resume();
+}
+
+} // namespace proxygen
+
+#endif // FOLLY_HAS_COROUTINES
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/experimental/coro/Coroutine.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <folly/experimental/coro/Task.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/httpserver/RequestHandler.h>
+
+namespace proxygen {
+
+/**
+ * A RequestHandler written as a coroutine. handleRequest() is started on
+ * the request's EventBase with the headers, and co_awaits the body and
+ * egress readiness instead of overriding the callbacks, which keeps the
+ * state of the request in the coroutine frame.
+ *
+ * readBody() and waitForEgress() are resumed inline from the callbacks,
+ * without going through the EventBase queue or allocating. The response
+ * is sent through downstream_, as from any RequestHandler, until the
+ * request fails: readBody() and waitForEgress() then throw an
+ * HTTPException, and hasError() is true after awaiting anything else.
+ * An exception escaping handleRequest() aborts the response.
+ *
+ * The handler deletes itself once both the coroutine and the request are
+ * done.
+ */
+class CoroRequestHandler : public RequestHandler {
+ public:
+  // Ingress is paused while more body than this waits for readBody()
+  static constexpr size_t kMaxBufferedBody = 64 * 1024;
+
+  explicit CoroRequestHandler(folly::EventBase* evb) : evb_(evb) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept final;
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept final;
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onEOM() noexcept final;
+
+  void requestComplete() noexcept final;
+
+  void onError(ProxygenError err) noexcept final;
+
+  void onEgressPaused() noexcept final;
+
+  void onEgressResumed() noexcept final;
+
+ protected:
+  enum class Waiting { NONE, BODY, EGRESS };
+
+  template <Waiting W>
+  class Awaiter {
+   public:
+    explicit Awaiter(CoroRequestHandler& handler) : handler_(handler) {
+    }
+
+    bool await_ready() const noexcept {
+      return handler_.isReady(W);
+    }
+
+    void await_suspend(folly::coro::coroutine_handle<> waiter) noexcept {
+      handler_.waiting_ = W;
+      handler_.waiter_ = waiter;
+    }
+
+    auto await_resume() {
+      handler_.throwIfError();
+      if constexpr (W == Waiting::BODY) {
+        return handler_.takeBody();
+      } else {
+        return;
+      }
+    }
+
+    // The callbacks resume it on the EventBase already
+    friend Awaiter co_viaIfAsync(folly::Executor::KeepAlive<>,
+                                 Awaiter awaiter) noexcept {
+      return awaiter;
+    }
+
+   private:
+    CoroRequestHandler& handler_;
+  };
+
+  virtual folly::coro::Task<void> handleRequest(
+      std::unique_ptr<HTTPMessage> headers) = 0;
+
+  // All of the body received since the last call, or nullptr after the EOM
+  Awaiter<Waiting::BODY> readBody() {
+    return Awaiter<Waiting::BODY>(*this);
+  }
+
+  // Until egress is not paused
+  Awaiter<Waiting::EGRESS> waitForEgress() {
+    return Awaiter<Waiting::EGRESS>(*this);
+  }
+
+  bool hasError() const {
+    return error_ != kErrorNone;
+  }
+
+ private:
+  folly::coro::Task<void> run(std::unique_ptr<HTTPMessage> headers);
+  void onHandlerDone(folly::Try<void>&& result) noexcept;
+
+  bool isReady(Waiting waiting) const;
+  void throwIfError() const;
+  std::unique_ptr<folly::IOBuf> takeBody();
+  // Resumes the coroutine if it waits for something now ready. Call it
+  // last, as the coroutine may finish and delete the handler.
+  void maybeResume();
+
+  folly::EventBase* const evb_;
+  folly::coro::coroutine_handle<> waiter_;
+  Waiting waiting_{Waiting::NONE};
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  ProxygenError error_{kErrorNone};
+  bool running_{false};
+  bool eom_{false};
+  bool complete_{false};
+  bool ingressPaused_{false};
+  bool egressPaused_{false};
+};
+
+} // namespace proxygen
+
+#endif // FOLLY_HAS_COROUTINES
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/HQServer.h>
+
+#include <thread>
+
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/io/async/EventBaseLocal.h>
+#include <proxygen/httpserver/RequestHandlerAdaptor.h>
+#include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <quic/congestion_control/ServerCongestionControllerFactory.h>
+#include <quic/server/QuicServerTransport.h>
+#include <quic/server/QuicSharedUDPSocketFactory.h>
+#include <wangle/acceptor/ConnectionManager.h>
+
+using folly::IOThreadPoolExecutor;
+using folly::ThreadPoolExecutor;
+
+namespace {
+
+using namespace proxygen;
+
+// Runs the handler factories' lifecycle callbacks on the threads HQServer
+// creates, like HTTPServer does for its IO threads
+class HQHandlerCallbacks : public ThreadPoolExecutor::Observer {
+ public:
+  explicit HQHandlerCallbacks(std::shared_ptr<const HTTPServerOptions> options)
+      : options_(std::move(options)) {
+  }
+
+  void threadStarted(ThreadPoolExecutor::ThreadHandle* h) override {
+    auto evb = IOThreadPoolExecutor::getEventBase(h);
+    CHECK(evb) << "Invariant violated - started thread must have an EventBase";
+    evb->runInEventBaseThread([=]() {
+      for (auto& factory : options_->handlerFactories) {
+        factory->onServerStart(evb);
+      }
+    });
+  }
+  void threadStopped(ThreadPoolExecutor::ThreadHandle* h) override {
+    // May run after the observer is gone
+    IOThreadPoolExecutor::getEventBase(h)->runInEventBaseThread(
+        [options = options_]() {
+          for (auto& factory : options->handlerFactories) {
+            factory->onServerStop();
+          }
+        });
+  }
+
+ private:
+  std::shared_ptr<const HTTPServerOptions> options_;
+};
+
+/**
+ * Controller of a single HQDownstreamSession, it deletes itself once the
+ * session detaches
+ */
+class HQServerSessionController : public HTTPSessionController {
+ public:
+  explicit HQServerSessionController(
+      std::shared_ptr<const HTTPServerOptions> options)
+      : options_(std::move(options)) {
+  }
+
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction& txn,
+                                            HTTPMessage* msg) override {
+    folly::SocketAddress clientAddr, vipAddr;
+    txn.getPeerAddress(clientAddr);
+    txn.getLocalAddress(vipAddr);
+    msg->setClientAddress(clientAddr);
+    msg->setDstAddress(vipAddr);
+
+    // Create filters chain
+    RequestHandler* h = nullptr;
+    for (auto& factory : options_->handlerFactories) {
+      h = factory->onRequest(h, msg);
+    }
+
+    return new RequestHandlerAdaptor(h);
+  }
+
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction* /*txn*/,
+      const HTTPException& /*error*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction* /*txn*/,
+      const folly::SocketAddress& /*localAddress*/) override {
+    return nullptr;
+  }
+
+  void attachSession(HTTPSessionBase* /*session*/) override {
+  }
+
+  void detachSession(const HTTPSessionBase* /*session*/) override {
+    delete this;
+  }
+
+ private:
+  std::shared_ptr<const HTTPServerOptions> options_;
+};
+
+} // namespace
+
+namespace proxygen {
+
+class HQServerTransportFactory : public quic::QuicServerTransportFactory {
+ public:
+  explicit HQServerTransportFactory(
+      std::shared_ptr<const HTTPServerOptions> httpOptions)
+      : httpOptions_(std::move(httpOptions)) {
+  }
+
+  quic::QuicServerTransport::Ptr make(
+      folly::EventBase* evb,
+      std::unique_ptr<folly::AsyncUDPSocket> socket,
+      const folly::SocketAddress& /* peerAddr */,
+      quic::QuicVersion /* quicVersion */,
+      std::shared_ptr<const fizz::server::FizzServerContext> ctx) noexcept
+      override {
+    auto controller = new HQServerSessionController(httpOptions_);
+    auto session = new HQDownstreamSession(httpOptions_->idleTimeout,
+                                           controller,
+                                           wangle::TransportInfo(),
+                                           nullptr);
+    auto transport = quic::QuicServerTransport::make(
+        evb, std::move(socket), session, session, std::move(ctx));
+    session->setSocket(transport);
+    session->startNow();
+    getConnectionManager(evb).addConnection(session);
+    return transport;
+  }
+
+  // Must be called from evb's thread
+  void drainConnections(folly::EventBase* evb) {
+    if (auto connMgr = connMgr_.get(*evb)) {
+      (*connMgr)->drainAllConnections();
+    }
+  }
+
+  // Must be called from evb's thread
+  void dropConnections(folly::EventBase* evb) {
+    if (auto connMgr = connMgr_.get(*evb)) {
+      (*connMgr)->dropAllConnections();
+      connMgr_.erase(*evb);
+    }
+  }
+
+ private:
+  wangle::ConnectionManager& getConnectionManager(folly::EventBase* evb) {
+    if (auto connMgr = connMgr_.get(*evb)) {
+      return **connMgr;
+    }
+    return *connMgr_.emplace(
+        *evb,
+        wangle::ConnectionManager::makeUnique(evb, httpOptions_->idleTimeout));
+  }
+
+  std::shared_ptr<const HTTPServerOptions> httpOptions_;
+  folly::EventBaseLocal<wangle::ConnectionManager::UniquePtr> connMgr_;
+};
+
+HQServer::HQServer(HQServerOptions options,
+                   std::shared_ptr<const HTTPServerOptions> httpOptions)
+    : options_(std::move(options)),
+      httpOptions_(std::move(httpOptions)),
+      server_(quic::QuicServer::createQuicServer()) {
+  CHECK(options_.fizzContext) << "HQServer requires a fizz context";
+  CHECK(httpOptions_);
+  server_->setBindV6Only(false);
+  server_->setReusePort(options_.reusePort);
+  server_->setHostId(options_.hostId);
+  server_->setProcessId(options_.processId);
+  server_->setCongestionControllerFactory(
+      std::make_shared<quic::ServerCongestionControllerFactory>());
+  server_->setTransportSettings(options_.transportSettings);
+  server_->setSupportedVersion(options_.quicVersions);
+  server_->setFizzContext(options_.fizzContext);
+  auto transportFactory =
+      std::make_unique<HQServerTransportFactory>(httpOptions_);
+  transportFactory_ = transportFactory.get();
+  server_->setQuicServerTransportFactory(std::move(transportFactory));
+  server_->setQuicUDPSocketFactory(
+      std::make_unique<quic::QuicSharedUDPSocketFactory>());
+}
+
+HQServer::~HQServer() {
+  CHECK(evbs_.empty()) << "Forgot to stop() server?";
+}
+
+void HQServer::start(std::shared_ptr<IOThreadPoolExecutor> ioExecutor) {
+  CHECK(evbs_.empty()) << "HQServer already started";
+  if (!ioExecutor) {
+    auto threads = httpOptions_->threads;
+    if (threads == 0) {
+      threads = std::thread::hardware_concurrency();
+    }
+    ioExecutor = std::make_shared<IOThreadPoolExecutor>(
+        threads, std::make_shared<folly::NamedThreadFactory>("HQSrvExec"));
+    handlerCallbacks_ = std::make_shared<HQHandlerCallbacks>(httpOptions_);
+    // Queues onServerStart() on every thread ahead of the workers' setup
+    ioExecutor->addObserver(handlerCallbacks_);
+  }
+  ioExecutor_ = std::move(ioExecutor);
+  for (auto& evb : ioExecutor_->getAllEventBases()) {
+    evbs_.push_back(evb.get());
+  }
+
+  if (!options_.listeningFds.empty()) {
+    server_->setListeningFDs(options_.listeningFds);
+  }
+  server_->initialize(options_.address, evbs_);
+  if (options_.takeoverAddress) {
+    server_->allowBeingTakenOver(*options_.takeoverAddress);
+  }
+  server_->start();
+  server_->waitUntilInitialized();
+  if (options_.forwardingAddress) {
+    server_->startPacketForwarding(*options_.forwardingAddress);
+  }
+  LOG(INFO) << "HQ server listening on " << getAddress().describe()
+            << " with " << evbs_.size() << " workers";
+}
+
+void HQServer::stopListening() {
+  server_->pauseRead();
+}
+
+void HQServer::drain() {
+  for (auto evb : evbs_) {
+    evb->runInEventBaseThreadAndWait(
+        [this, evb] { transportFactory_->drainConnections(evb); });
+  }
+}
+
+void HQServer::stop() {
+  if (evbs_.empty()) {
+    return;
+  }
+  for (auto evb : evbs_) {
+    evb->runInEventBaseThreadAndWait(
+        [this, evb] { transportFactory_->dropConnections(evb); });
+  }
+  server_->shutdown();
+  evbs_.clear();
+  if (handlerCallbacks_) {
+    // Runs onServerStop() on every thread
+    ioExecutor_->removeObserver(handlerCallbacks_);
+    handlerCallbacks_.reset();
+    ioExecutor_->join();
+  }
+  ioExecutor_.reset();
+}
+
+void HQServer::stopPacketForwarding(std::chrono::milliseconds delay) {
+  server_->stopPacketForwarding(delay);
+}
+
+const folly::SocketAddress& HQServer::getAddress() const {
+  return server_->getAddress();
+}
+
+std::vector<int> HQServer::getListeningSocketFDs() const {
+  return server_->getAllListeningSocketFDs();
+}
+
+void HQServer::rejectNewConnections(bool reject) {
+  server_->rejectNewConnections([reject]() { return reject; });
+}
+
+} // namespace proxygen
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <fizz/server/FizzServerContext.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/SocketAddress.h>
+#include <proxygen/httpserver/HTTPServerOptions.h>
+#include <quic/server/QuicServer.h>
+#include <quic/state/TransportSettings.h>
+
+namespace proxygen {
+
+class HQServerTransportFactory;
+
+/**
+ * Configuration options for HQServer, HTTP level options come from the
+ * HTTPServerOptions given to the server.
+ */
+struct HQServerOptions {
+  /**
+   * Address to listen on
+   */
+  folly::SocketAddress address;
+
+  /**
+   * TLS configuration for the QUIC handshake, required.  Its ALPNs should
+   * include h3.
+   */
+  std::shared_ptr<const fizz::server::FizzServerContext> fizzContext;
+
+  quic::TransportSettings transportSettings;
+
+  std::vector<quic::QuicVersion> quicVersions{quic::QuicVersion::MVFST,
+                                              quic::QuicVersion::QUIC_V1,
+                                              quic::QuicVersion::QUIC_DRAFT};
+
+  /**
+   * Give every worker its own SO_REUSEPORT listening socket instead of
+   * sharing one.  Either way the server picks connection IDs that encode the
+   * worker, and a packet the kernel hands to the wrong worker is routed to
+   * the one owning the connection.
+   */
+  bool reusePort{true};
+
+  /**
+   * Encoded in the connection IDs the server chooses, so that a load
+   * balancer can route packets of a connection to this host
+   */
+  uint32_t hostId{0};
+
+  /**
+   * Hot restart.  The process taking over starts with the listening sockets
+   * of the running one, see HQServer::getListeningSocketFDs(), and with the
+   * other process id so the two can tell whose connection a packet belongs
+   * to.  It forwards packets of connections it doesn't know to
+   * forwardingAddress, where the old process listens for them if it was
+   * started with takeoverAddress set.
+   */
+  std::vector<int> listeningFds;
+  quic::ProcessId processId{quic::ProcessId::ZERO};
+  folly::Optional<folly::SocketAddress> takeoverAddress;
+  folly::Optional<folly::SocketAddress> forwardingAddress;
+};
+
+/**
+ * HTTP/3 server that serves requests with the RequestHandlerFactory chain of
+ * an HTTPServer, running one QUIC worker per IO thread.
+ */
+class HQServer final {
+ public:
+  /**
+   * httpOptions provides the handler factories and idle timeout, and may be
+   * the options of a running HTTPServer so that both serve the same chain.
+   */
+  HQServer(HQServerOptions options,
+           std::shared_ptr<const HTTPServerOptions> httpOptions);
+  ~HQServer();
+
+  /**
+   * Start the QUIC workers, one per thread of ioExecutor, and return once
+   * they are listening.  Throws if binding fails.
+   *
+   * When sharing threads with an HTTPServer, pass the executor given to
+   * HTTPServer::start(): its handler factories already had onServerStart()
+   * called on those threads.  Without an executor the server creates
+   * httpOptions->threads threads and starts the handler factories on them.
+   */
+  void start(std::shared_ptr<folly::IOThreadPoolExecutor> ioExecutor = nullptr);
+
+  /**
+   * Stop reading from the listening sockets, eg. once a new process has
+   * taken them over.  Existing connections keep working through packets
+   * forwarded to takeoverAddress.
+   */
+  void stopListening();
+
+  /**
+   * Ask the clients of all connections to go away, the connections close
+   * once their transactions complete
+   */
+  void drain();
+
+  /**
+   * Close all connections and stop the workers
+   */
+  void stop();
+
+  /**
+   * Stop forwarding packets to the process this one took over from, after
+   * delay
+   */
+  void stopPacketForwarding(std::chrono::milliseconds delay);
+
+  const folly::SocketAddress& getAddress() const;
+
+  /**
+   * Listening sockets to hand to the process taking over
+   */
+  std::vector<int> getListeningSocketFDs() const;
+
+  void rejectNewConnections(bool reject);
+
+ private:
+  HQServerOptions options_;
+  std::shared_ptr<const HTTPServerOptions> httpOptions_;
+  std::shared_ptr<folly::IOThreadPoolExecutor> ioExecutor_;
+  // Set when the server created ioExecutor_ and owns the handler factories'
+  // lifecycle on it
+  std::shared_ptr<folly::ThreadPoolExecutor::Observer> handlerCallbacks_;
+  std::vector<folly::EventBase*> evbs_;
+  // Owned by server_
+  HQServerTransportFactory* transportFactory_{nullptr};
+  std::shared_ptr<quic::QuicServer> server_;
+};
+
+} // namespace proxygen
@@ -8,40 +8,292 @@
 
 #include <proxygen/httpserver/HTTPServer.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Portability.h>
+#include <folly/String.h>
+#include <folly/executors/thread_factory/InitThreadFactory.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/experimental/io/IoUringBackend.h>
 #include <folly/io/async/EventBaseManager.h>
+#include <folly/net/NetOps.h>
 #include <folly/system/ThreadName.h>
 #include <proxygen/httpserver/HTTPServerAcceptor.h>
 #include <proxygen/httpserver/SignalHandler.h>
+#include <proxygen/httpserver/SocketTakeover.h>
 #include <proxygen/httpserver/filters/CompressionFilter.h>
+#include <proxygen/httpserver/filters/DecompressionFilter.h>
 #include <proxygen/httpserver/filters/RejectConnectFilter.h>
+#include <proxygen/httpserver/filters/RejectEarlyDataFilter.h>
+#include <proxygen/lib/http/session/LoopBudget.h>
+#include <proxygen/lib/utils/AdaptiveStreamLimit.h>
+#include <proxygen/lib/utils/PooledObject.h>
+#include <wangle/bootstrap/ServerSocketFactory.h>
 #include <wangle/ssl/SSLContextManager.h>
 
+#if defined(__linux__)
+#include <linux/filter.h>
+#include <linux/mempolicy.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 using folly::EventBaseManager;
 using folly::IOThreadPoolExecutor;
 using folly::ThreadPoolExecutor;
 
+namespace {
+
+#if !FOLLY_MOBILE && __has_include(<liburing.h>)
+std::unique_ptr<folly::EventBaseBackendBase> getIoUringBackend(
+    const folly::PollIoBackend::Options& backendOptions) {
+  try {
+    return std::make_unique<folly::IoUringBackend>(backendOptions);
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failure creating io_uring backend: " << ex.what();
+  }
+  return folly::EventBase::getDefaultBackend();
+}
+
+std::unique_ptr<EventBaseManager> makeIoEventBaseManager(
+    const proxygen::HTTPServerOptions& options) {
+  if (!options.useIoUringBackend) {
+    return nullptr;
+  }
+  folly::PollIoBackend::Options backendOptions;
+  backendOptions.setCapacity(options.ioUringCapacity)
+      .setMaxSubmit(options.ioUringMaxSubmit)
+      .setMaxGet(options.ioUringMaxGet)
+      .setUseRegisteredFds(options.ioUringUseRegisteredFds);
+  // The backend factory runs once per IO thread
+  return std::make_unique<EventBaseManager>(
+      folly::EventBase::Options().setBackendFactory(
+          [backendOptions] { return getIoUringBackend(backendOptions); }));
+}
+#else
+std::unique_ptr<EventBaseManager> makeIoEventBaseManager(
+    const proxygen::HTTPServerOptions& options) {
+  LOG_IF(WARNING, options.useIoUringBackend)
+      << "io_uring backend is not available, using the default backend";
+  return nullptr;
+}
+#endif
+
+void pinCurrentThread(int cpu, int numaNode) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (auto err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+    LOG(ERROR) << "Failed to pin IO thread to cpu=" << cpu << ": "
+               << folly::errnoStr(err);
+  }
+  if (numaNode < 0) {
+    return;
+  }
+  // Prefer the node for everything the thread allocates from here on, such
+  // as its EventBase, thread local stats and buffer pools.
+  constexpr size_t kBitsPerWord = sizeof(unsigned long) * 8;
+  std::vector<unsigned long> nodeMask(numaNode / kBitsPerWord + 1);
+  nodeMask[numaNode / kBitsPerWord] |= 1UL << (numaNode % kBitsPerWord);
+  if (syscall(SYS_set_mempolicy,
+              MPOL_PREFERRED,
+              nodeMask.data(),
+              nodeMask.size() * kBitsPerWord + 1) != 0) {
+    LOG(ERROR) << "Failed to set memory policy for numa node=" << numaNode
+               << ": " << folly::errnoStr(errno);
+  }
+#else
+  (void)cpu;
+  (void)numaNode;
+  LOG(WARNING) << "IO thread pinning is not supported on this platform";
+#endif
+}
+
+void setDeferAccept(const std::shared_ptr<folly::AsyncSocketBase>& socket,
+                    std::chrono::seconds deferAccept) {
+  auto serverSocket =
+      std::dynamic_pointer_cast<folly::AsyncServerSocket>(socket);
+  if (!serverSocket) {
+    return;
+  }
+#if defined(__linux__) && defined(TCP_DEFER_ACCEPT)
+  int seconds = deferAccept.count();
+  for (auto fd : serverSocket->getNetworkSockets()) {
+    if (folly::netops::setsockopt(fd,
+                                  IPPROTO_TCP,
+                                  TCP_DEFER_ACCEPT,
+                                  &seconds,
+                                  sizeof(seconds)) != 0) {
+      LOG(WARNING) << "Failed to set TCP_DEFER_ACCEPT=" << seconds << ": "
+                   << folly::errnoStr(errno);
+    }
+  }
+#else
+  (void)deferAccept;
+  LOG(WARNING) << "TCP_DEFER_ACCEPT is not supported on this platform";
+#endif
+}
+
+std::shared_ptr<folly::ThreadFactory> makeIoThreadFactory(
+    const proxygen::HTTPServerOptions& options) {
+  auto threadFactory =
+      std::make_shared<folly::NamedThreadFactory>("HTTPSrvExec");
+  if (options.ioThreadCpus.empty()) {
+    return threadFactory;
+  }
+  // Thread N is pinned to ioThreadCpus[N % size], before it creates its
+  // EventBase
+  auto nextThread = std::make_shared<std::atomic<size_t>>(0);
+  return std::make_shared<folly::InitThreadFactory>(
+      std::move(threadFactory),
+      [cpus = options.ioThreadCpus,
+       numaNode = options.numaNode,
+       nextThread] { pinCurrentThread(cpus[(*nextThread)++ % cpus.size()],
+                                      numaNode); });
+}
+
+} // namespace
+
 namespace proxygen {
 
+std::vector<int> HTTPServer::getNumaNodeCpus(int node) {
+  std::vector<int> cpus;
+  std::string cpuList;
+  auto path = folly::to<std::string>(
+      "/sys/devices/system/node/node", node, "/cpulist");
+  if (!folly::readFile(path.c_str(), cpuList)) {
+    return cpus;
+  }
+  // eg. "0-15,32-47"
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', folly::trimWhitespace(cpuList), ranges, true);
+  for (auto range : ranges) {
+    folly::StringPiece first;
+    folly::StringPiece last;
+    if (!folly::split('-', range, first, last)) {
+      first = last = range;
+    }
+    auto lo = folly::tryTo<int>(first);
+    auto hi = folly::tryTo<int>(last);
+    if (!lo.hasValue() || !hi.hasValue()) {
+      return {};
+    }
+    for (int cpu = *lo; cpu <= *hi; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+/**
+ * Initializes the TLS acceptors created while the server starts on their own
+ * IO threads, so every thread loads its certificates at the same time
+ * instead of one after the other.  ServerBootstrap creates the acceptors
+ * one by one, and an acceptor's accept callback is only added after the
+ * init queued on its EventBase has run.  Once waited for, acceptors are
+ * initialized inline again.
+ */
+class AcceptorInitGroup
+    : public std::enable_shared_from_this<AcceptorInitGroup> {
+ public:
+  void init(std::shared_ptr<HTTPServerAcceptor> acceptor,
+            folly::EventBase* evb) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (!waited_) {
+        pending_++;
+        evb->runInEventBaseThread([self = shared_from_this(), acceptor, evb] {
+          self->runInit(*acceptor, evb);
+        });
+        return;
+      }
+    }
+    acceptor->init(nullptr, evb);
+  }
+
+  // Waits for the pending inits, rethrowing the first error
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    waited_ = true;
+    if (error_) {
+      std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+  }
+
+ private:
+  void runInit(HTTPServerAcceptor& acceptor, folly::EventBase* evb) {
+    std::exception_ptr ex;
+    try {
+      acceptor.init(nullptr, evb);
+    } catch (const std::exception&) {
+      ex = std::current_exception();
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (ex && !error_) {
+      error_ = ex;
+    }
+    if (--pending_ == 0) {
+      done_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable done_;
+  size_t pending_{0};
+  bool waited_{false};
+  std::exception_ptr error_;
+};
+
 class AcceptorFactory : public wangle::AcceptorFactory {
  public:
   AcceptorFactory(std::shared_ptr<HTTPServerOptions> options,
                   std::shared_ptr<HTTPCodecFactory> codecFactory,
                   AcceptorConfiguration config,
-                  HTTPSession::InfoCallback* sessionInfoCb)
+                  HTTPSession::InfoCallback* sessionInfoCb,
+                  std::shared_ptr<AcceptorInitGroup> initGroup = nullptr,
+                  std::shared_ptr<HTTPServer::AddressStats> stats = nullptr,
+                  uint64_t maxConnections = 0)
       : options_(options),
         codecFactory_(codecFactory),
         config_(config),
-        sessionInfoCb_(sessionInfoCb) {
+        sessionInfoCb_(sessionInfoCb),
+        initGroup_(std::move(initGroup)),
+        stats_(std::move(stats)),
+        maxConnections_(maxConnections) {
   }
   std::shared_ptr<wangle::Acceptor> newAcceptor(
       folly::EventBase* eventBase) override {
+    // On the IO thread, whose budget it is
+    if (options_->loopBudgetReadSlice > 0 ||
+        options_->loopBudgetWriteSlice > 0) {
+      LoopBudget::get().setOptions(
+          {options_->loopBudgetReadSlice, options_->loopBudgetWriteSlice});
+    }
+    if (options_->loopBudgetSampleRate > 0 && !eventBase->getObserver()) {
+      eventBase->setObserver(
+          LoopBudget::makeObserver(options_->loopBudgetSampleRate));
+    }
     auto acc = std::shared_ptr<HTTPServerAcceptor>(
-        HTTPServerAcceptor::make(config_, *options_, codecFactory_).release());
+        HTTPServerAcceptor::make(
+            config_, *options_, codecFactory_, stats_, maxConnections_)
+            .release());
     if (sessionInfoCb_) {
       acc->setSessionInfoCallback(sessionInfoCb_);
     }
-    acc->init(nullptr, eventBase);
+    if (initGroup_ && config_.isSSL()) {
+      initGroup_->init(acc, eventBase);
+    } else {
+      acc->init(nullptr, eventBase);
+    }
     return acc;
   }
 
@@ -50,13 +302,198 @@ class AcceptorFactory : public wangle::AcceptorFactory {
   std::shared_ptr<HTTPCodecFactory> codecFactory_;
   AcceptorConfiguration config_;
   HTTPSession::InfoCallback* sessionInfoCb_;
+  std::shared_ptr<AcceptorInitGroup> initGroup_;
+  std::shared_ptr<HTTPServer::AddressStats> stats_;
+  uint64_t maxConnections_;
+};
+
+/**
+ * Socket factory for HTTPServerOptions::listenerPerThread.  ServerBootstrap
+ * binds one socket per thread of its accept group and hands every socket to
+ * every worker.  With the IO executor as the accept group, this factory
+ * builds each socket on the IO thread that bound it and only registers that
+ * thread's own acceptor, so connections are served where they were accepted.
+ */
+class ListenerPerThreadSocketFactory : public wangle::AsyncServerSocketFactory {
+ public:
+  ListenerPerThreadSocketFactory(
+      std::shared_ptr<IOThreadPoolExecutor> ioExecutor,
+      bool cpuSteering,
+      bool incomingCpu,
+      bool zeroCopy)
+      : ioExecutor_(std::move(ioExecutor)),
+        cpuSteering_(cpuSteering),
+        incomingCpu_(incomingCpu),
+        zeroCopy_(zeroCopy) {
+  }
+
+  std::shared_ptr<folly::AsyncSocketBase> newSocket(
+      folly::SocketAddress address,
+      int /*backlog*/,
+      bool /*reuse*/,
+      const wangle::ServerSocketConfig& config) override {
+    // The IO threads may not use the global EventBaseManager, so ask the
+    // executor for the EventBase of the calling thread.
+    auto evb = ioExecutor_->getEventBase();
+    CHECK(evb->isInEventBaseThread());
+    std::shared_ptr<folly::AsyncServerSocket> socket(
+        new folly::AsyncServerSocket(evb), ThreadSafeDestructor());
+    socket->setMaxNumMessagesInQueue(
+        config.maxNumPendingConnectionsPerWorker);
+    socket->setReusePortEnabled(true);
+    if (config.enableTCPFastOpen) {
+      socket->setTFOEnabled(true, config.fastOpenQueueSize);
+    }
+    socket->bind(address);
+    if (zeroCopy_) {
+      socket->setZeroCopy(true);
+    }
+    if (incomingCpu_) {
+      setIncomingCpu(*socket, getPinnedCpu());
+    }
+    // The program belongs to the reuseport group.  Reattach it as each
+    // socket joins so it covers the CPUs of every listener bound so far.
+    if (cpuSteering_) {
+      socketCpus_.push_back(getPinnedCpu());
+      attachCpuSteering(*socket);
+    }
+    socket->listen(config.acceptBacklog);
+    socket->startAccepting();
+    return socket;
+  }
+
+  void addAcceptCB(std::shared_ptr<folly::AsyncSocketBase> sock,
+                   wangle::Acceptor* callback,
+                   folly::EventBase* base) override {
+    if (base == sock->getEventBase()) {
+      wangle::AsyncServerSocketFactory::addAcceptCB(sock, callback, base);
+    }
+  }
+
+  void removeAcceptCB(std::shared_ptr<folly::AsyncSocketBase> sock,
+                      wangle::Acceptor* callback,
+                      folly::EventBase* base) override {
+    if (base == sock->getEventBase()) {
+      wangle::AsyncServerSocketFactory::removeAcceptCB(sock, callback, base);
+    }
+  }
+
+ private:
+  // The CPU the calling thread is pinned to, or -1 if it may run on several
+  static int getPinnedCpu() {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0 &&
+        CPU_COUNT(&set) == 1) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+          return cpu;
+        }
+      }
+    }
+#endif
+    return -1;
+  }
+
+  // Makes the kernel prefer the listener for the connections whose packets
+  // cpu handles
+  static void setIncomingCpu(folly::AsyncServerSocket& socket, int cpu) {
+#if defined(__linux__) && defined(SO_INCOMING_CPU)
+    if (cpu < 0) {
+      return;
+    }
+    for (auto fd : socket.getNetworkSockets()) {
+      if (folly::netops::setsockopt(
+              fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) != 0) {
+        LOG(WARNING) << "Failed to set SO_INCOMING_CPU=" << cpu << ": "
+                     << folly::errnoStr(errno);
+      }
+    }
+#else
+    (void)socket;
+    (void)cpu;
+#endif
+  }
+
+  void attachCpuSteering(folly::AsyncServerSocket& socket) {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    // Sockets are indexed in the order they joined the group.  When the IO
+    // threads are pinned, return the listener of the thread pinned to the
+    // receiving CPU; an out of range index makes the kernel fall back to its
+    // hash.  Otherwise assume IO thread N runs on CPU N.
+    std::vector<struct sock_filter> code;
+    code.push_back(
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, uint32_t(SKF_AD_OFF + SKF_AD_CPU)});
+    bool pinned = std::any_of(
+        socketCpus_.begin(), socketCpus_.end(), [](int c) { return c >= 0; });
+    if (pinned) {
+      for (size_t i = 0; i < socketCpus_.size(); i++) {
+        if (socketCpus_[i] >= 0) {
+          code.push_back(
+              {BPF_JMP | BPF_JEQ | BPF_K, 0, 1, uint32_t(socketCpus_[i])});
+          code.push_back({BPF_RET | BPF_K, 0, 0, uint32_t(i)});
+        }
+      }
+      code.push_back(
+          {BPF_RET | BPF_K, 0, 0, std::numeric_limits<uint32_t>::max()});
+    } else {
+      code.push_back({BPF_ALU | BPF_MOD | BPF_K,
+                      0,
+                      0,
+                      uint32_t(ioExecutor_->numThreads())});
+      code.push_back({BPF_RET | BPF_A, 0, 0, 0});
+    }
+    struct sock_fprog prog;
+    prog.len = static_cast<unsigned short>(code.size());
+    prog.filter = code.data();
+    for (auto fd : socket.getNetworkSockets()) {
+      if (folly::netops::setsockopt(fd,
+                                    SOL_SOCKET,
+                                    SO_ATTACH_REUSEPORT_CBPF,
+                                    &prog,
+                                    sizeof(prog)) != 0) {
+        LOG(WARNING) << "Failed to attach reuseport CPU steering program: "
+                     << folly::errnoStr(errno);
+      }
+    }
+#else
+    (void)socket;
+    LOG(WARNING) << "reuseport CPU steering is not supported on this platform";
+#endif
+  }
+
+  std::shared_ptr<IOThreadPoolExecutor> ioExecutor_;
+  bool cpuSteering_;
+  bool incomingCpu_;
+  bool zeroCopy_;
+  // CPU of the thread that bound each socket, in group order.  Only touched
+  // by newSocket(), which ServerBootstrap calls one at a time.
+  std::vector<int> socketCpus_;
 };
 
 HTTPServer::HTTPServer(HTTPServerOptions options)
     : options_(std::make_shared<HTTPServerOptions>(std::move(options))) {
 
+  if (options_->numaNode >= 0 && options_->ioThreadCpus.empty()) {
+    options_->ioThreadCpus = getNumaNodeCpus(options_->numaNode);
+    LOG_IF(ERROR, options_->ioThreadCpus.empty())
+        << "No cpus found for numa node=" << options_->numaNode;
+  }
+
+  if (options_->lowLatency) {
+    options_->listenerPerThread = true;
+  }
+
   if (options_->threads == 0) {
-    options_->threads = std::thread::hardware_concurrency();
+    options_->threads = options_->ioThreadCpus.empty()
+                            ? std::thread::hardware_concurrency()
+                            : options_->ioThreadCpus.size();
+  }
+
+  // Shared by all the servers in the process
+  if (options_->handlerPoolSize > 0) {
+    setPooledObjectCacheSize(options_->handlerPoolSize);
   }
 
   // Insert a filter to fail all the CONNECT request, if required
@@ -66,23 +503,50 @@ HTTPServer::HTTPServer(HTTPServerOptions options)
         std::make_unique<RejectConnectFilterFactory>());
   }
 
-  // Add Content Compression filter (gzip and maybe zstd), if needed. Should be
-  // final filter
+  // Add Content Compression filter (gzip and maybe zstd or br), if needed.
+  // Should be final filter
   if (options_->enableContentCompression) {
     CompressionFilterFactory::Options opts;
     opts.minimumCompressionSize = options_->contentCompressionMinimumSize;
     opts.zlibCompressionLevel = options_->contentCompressionLevel;
     opts.compressibleContentTypes = options_->contentCompressionTypes;
     opts.enableGzip = options_->enableGzipCompression;
+    opts.poolCompressionContexts = options_->poolCompressionContexts;
     if (options_->enableZstdCompression) {
       opts.enableZstd = options_->enableZstdCompression;
       opts.independentChunks = options_->useZstdIndependentChunks;
       opts.zstdCompressionLevel = options_->zstdContentCompressionLevel;
+      opts.zstdDictionaries = options_->zstdDictionaries;
+    }
+    opts.responseCache = options_->compressedResponseCache;
+    opts.adaptiveLevel = options_->adaptiveCompressionLevel;
+    if (options_->enableBrotliCompression) {
+      opts.enableBrotli = options_->enableBrotliCompression;
+      opts.brotliQuality = options_->brotliContentCompressionQuality;
+      opts.brotliWindowBits = options_->brotliContentCompressionWindowBits;
     }
     options_->handlerFactories.insert(
         options_->handlerFactories.begin(),
         std::make_unique<CompressionFilterFactory>(opts));
   }
+
+  // Decode compressed request bodies before any other filter sees them
+  if (options_->enableRequestBodyDecompression) {
+    BodyDecompressor::Options opts;
+    opts.maxDecompressedBytes = options_->requestDecompressionMaxBytes;
+    opts.maxRatio = options_->requestDecompressionMaxRatio;
+    opts.poolContexts = options_->poolCompressionContexts;
+    options_->handlerFactories.insert(
+        options_->handlerFactories.begin(),
+        std::make_unique<DecompressionFilterFactory>(opts));
+  }
+
+  // Before any filter acts on a request that may be replayed
+  if (options_->rejectNonIdempotentEarlyData) {
+    options_->handlerFactories.insert(
+        options_->handlerFactories.begin(),
+        std::make_unique<RejectEarlyDataFilterFactory>());
+  }
 }
 
 HTTPServer::~HTTPServer() {
@@ -129,24 +593,52 @@ folly::Expected<folly::Unit, std::exception_ptr> HTTPServer::startTcpServer(
     std::shared_ptr<folly::IOThreadPoolExecutor> ioExecutor) {
   auto accExe = std::make_shared<IOThreadPoolExecutor>(1);
   if (!ioExecutor) {
+    ioEventBaseManager_ = makeIoEventBaseManager(*options_);
     ioExecutor = std::make_shared<IOThreadPoolExecutor>(
         options_->threads,
-        std::make_shared<folly::NamedThreadFactory>("HTTPSrvExec"));
+        makeIoThreadFactory(*options_),
+        ioEventBaseManager_ ? ioEventBaseManager_.get()
+                            : EventBaseManager::get());
   }
   auto exeObserver = std::make_shared<HandlerCallbacks>(options_);
   // Observer has to be set before bind(), so onServerStart() callbacks run
   ioExecutor->addObserver(exeObserver);
 
+  auto startTime = std::chrono::steady_clock::now();
+  std::shared_ptr<AcceptorInitGroup> initGroup;
+  if (options_->parallelTLSInit) {
+    initGroup = std::make_shared<AcceptorInitGroup>();
+  }
   try {
     FOR_EACH_RANGE(i, 0, addresses_.size()) {
       auto accConfig = HTTPServerAcceptor::makeConfig(addresses_[i], *options_);
+      const auto& isolation = addresses_[i].isolation;
+      addressStats_.push_back(std::make_shared<AddressStats>());
       // If user specified an acceptor factory to use, we will use it.
       // Otherwise, we create one for each address.
       auto acceptorFactory = inputAcceptorFactory;
       if (!acceptorFactory) {
         auto codecFactory = addresses_[i].codecFactory;
-        acceptorFactory = std::make_shared<AcceptorFactory>(
-            options_, codecFactory, accConfig, sessionInfoCb_);
+        acceptorFactory =
+            std::make_shared<AcceptorFactory>(options_,
+                                              codecFactory,
+                                              accConfig,
+                                              sessionInfoCb_,
+                                              initGroup,
+                                              addressStats_.back(),
+                                              isolation.maxConnections);
+      }
+      // The address' own IO threads, which the others' load doesn't delay
+      auto addressExecutor = ioExecutor;
+      if (isolation.ioThreads > 0) {
+        addressExecutor = std::make_shared<IOThreadPoolExecutor>(
+            isolation.ioThreads,
+            std::make_shared<folly::NamedThreadFactory>(
+                folly::to<std::string>("HTTPSrvAddr", i, "-")),
+            ioEventBaseManager_ ? ioEventBaseManager_.get()
+                                : EventBaseManager::get());
+        addressExecutor->addObserver(exeObserver);
+        isolatedExecutors_.push_back(addressExecutor);
       }
       bootstrap_.push_back(wangle::ServerBootstrap<wangle::DefaultPipeline>());
       bootstrap_[i].childHandler(acceptorFactory);
@@ -160,7 +652,19 @@ folly::Expected<folly::Unit, std::exception_ptr> HTTPServer::startTcpServer(
         bootstrap_[i].socketConfig.fastOpenQueueSize =
             accConfig.fastOpenQueueSize;
       }
-      bootstrap_[i].group(accExe, ioExecutor);
+      if (options_->listenerPerThread &&
+          options_->preboundSockets_.size() <= i) {
+        bootstrap_[i].channelFactory(
+            std::make_shared<ListenerPerThreadSocketFactory>(
+                addressExecutor,
+                options_->reusePortCpuSteering,
+                options_->lowLatency,
+                options_->useZeroCopy));
+        bootstrap_[i].group(addressExecutor, addressExecutor);
+        bootstrap_[i].setReusePort(true);
+      } else {
+        bootstrap_[i].group(accExe, addressExecutor);
+      }
       if (accConfig.reusePort) {
         bootstrap_[i].setReusePort(true);
       }
@@ -169,8 +673,32 @@ folly::Expected<folly::Unit, std::exception_ptr> HTTPServer::startTcpServer(
       } else {
         bootstrap_[i].bind(addresses_[i].address);
       }
+      if (addresses_[i].deferAccept.count() > 0) {
+        for (auto& socket : bootstrap_[i].getSockets()) {
+          setDeferAccept(socket, addresses_[i].deferAccept);
+        }
+      }
+    }
+    auto boundTime = std::chrono::steady_clock::now();
+    startTimes_.bind = std::chrono::duration_cast<std::chrono::milliseconds>(
+        boundTime - startTime);
+    if (initGroup) {
+      initGroup->wait();
     }
+    startTimes_.tlsInit =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - boundTime);
+    VLOG(1) << "Bound " << addresses_.size() << " addresses in "
+            << startTimes_.bind.count() << "ms, then waited "
+            << startTimes_.tlsInit.count() << "ms for TLS acceptors";
   } catch (const std::exception&) {
+    if (initGroup) {
+      // Before the acceptors go away
+      try {
+        initGroup->wait();
+      } catch (const std::exception&) {
+      }
+    }
     stop();
 
     return folly::makeUnexpected(std::current_exception());
@@ -186,13 +714,42 @@ void HTTPServer::start(
     std::shared_ptr<folly::IOThreadPoolExecutor> ioExecutor) {
   mainEventBase_ = EventBaseManager::get()->getEventBase();
 
-  auto tcpStarted = startTcpServer(acceptorFactory, ioExecutor);
-  if (tcpStarted.hasError()) {
+  auto fail = [&](std::exception_ptr ex) {
     if (onError) {
-      onError(tcpStarted.error());
+      onError(ex);
       return;
     }
-    std::rethrow_exception(tcpStarted.error());
+    std::rethrow_exception(ex);
+  };
+
+  int takeoverFd = -1;
+  if (!options_->takeoverPath.empty()) {
+    try {
+      takeoverFd = takeSocketsOver();
+    } catch (const std::exception&) {
+      return fail(std::current_exception());
+    }
+  }
+
+  auto tcpStarted = startTcpServer(acceptorFactory, ioExecutor);
+  if (tcpStarted.hasError()) {
+    if (takeoverFd >= 0) {
+      // The old server goes on
+      ::close(takeoverFd);
+    }
+    return fail(tcpStarted.error());
+  }
+
+  if (!options_->takeoverPath.empty()) {
+    if (takeoverFd >= 0) {
+      SocketTakeover::confirm(takeoverFd);
+    }
+    try {
+      startTakeoverServer();
+    } catch (const std::exception&) {
+      stop();
+      return fail(std::current_exception());
+    }
   }
 
   // Install signal handler if required
@@ -201,6 +758,16 @@ void HTTPServer::start(
     signalHandler_->install(options_->shutdownOn);
   }
 
+  if (options_->adaptiveStreamLimit) {
+    auto interval = options_->adaptiveStreamLimit->getOptions().adjustInterval;
+    streamLimitTimeout_ = folly::AsyncTimeout::make(
+        *mainEventBase_, [this, interval]() noexcept {
+          adjustStreamLimit();
+          streamLimitTimeout_->scheduleTimeout(interval);
+        });
+    streamLimitTimeout_->scheduleTimeout(interval);
+  }
+
   // Start the main event loop.
   if (onSuccess) {
     mainEventBase_->runInLoop([onSuccess(std::move(onSuccess))]() {
@@ -211,6 +778,62 @@ void HTTPServer::start(
     });
   }
   mainEventBase_->loopForever();
+  streamLimitTimeout_.reset();
+  takeoverServer_.reset();
+}
+
+int HTTPServer::takeSocketsOver() {
+  auto takeover = SocketTakeover::requestSockets(options_->takeoverPath,
+                                                 options_->takeoverTimeout);
+  if (!takeover) {
+    return -1;
+  }
+  if (!options_->preboundSockets_.empty() ||
+      takeover->sockets.size() != addresses_.size()) {
+    LOG(WARNING) << "Not taking over " << takeover->sockets.size()
+                 << " socket groups for " << addresses_.size()
+                 << " addresses";
+    for (auto& group : takeover->sockets) {
+      for (auto fd : group) {
+        ::close(fd);
+      }
+    }
+    ::close(takeover->fd);
+    return -1;
+  }
+  for (auto& group : takeover->sockets) {
+    options_->useExistingSockets(group);
+  }
+  return takeover->fd;
+}
+
+void HTTPServer::startTakeoverServer() {
+  auto onTakenOver = options_->onSocketsTakenOver;
+  if (!onTakenOver) {
+    onTakenOver = [this] { stopListening(); };
+  }
+  takeoverServer_ = std::make_unique<SocketTakeoverServer>(
+      mainEventBase_,
+      options_->takeoverPath,
+      [this] {
+        SocketTakeover::SocketGroups groups;
+        for (auto& bootstrap : bootstrap_) {
+          groups.emplace_back();
+          for (auto& socket : bootstrap.getSockets()) {
+            auto serverSocket =
+                std::dynamic_pointer_cast<folly::AsyncServerSocket>(socket);
+            if (!serverSocket) {
+              continue;
+            }
+            for (auto fd : serverSocket->getNetworkSockets()) {
+              groups.back().push_back(fd.toFd());
+            }
+          }
+        }
+        return groups;
+      },
+      std::move(onTakenOver));
+  takeoverServer_->start();
 }
 
 void HTTPServer::stopListening() {
@@ -238,6 +861,41 @@ void HTTPServer::stop() {
   }
 }
 
+void HTTPServer::drain(std::function<void()> onDone) {
+  std::vector<HTTPSessionAcceptor*> acceptors;
+  for (auto& bootstrap : bootstrap_) {
+    bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
+      auto sessionAcceptor = dynamic_cast<HTTPSessionAcceptor*>(acceptor);
+      if (sessionAcceptor && acceptor->getEventBase()) {
+        acceptors.push_back(sessionAcceptor);
+      }
+    });
+  }
+  if (acceptors.empty()) {
+    if (onDone) {
+      onDone();
+    }
+    return;
+  }
+
+  // The last acceptor done calls onDone
+  auto remaining = std::make_shared<std::atomic<size_t>>(acceptors.size());
+  auto done = [remaining, onDone = std::move(onDone)] {
+    if (remaining->fetch_sub(1) == 1 && onDone) {
+      onDone();
+    }
+  };
+  auto window = options_->drainWindow;
+  LOG(INFO) << "Draining " << acceptors.size() << " acceptors over "
+            << window.count() << "ms";
+  for (auto acceptor : acceptors) {
+    acceptor->getEventBase()->runInEventBaseThread(
+        [acceptor, window, progress = drainProgress_, done] {
+          acceptor->drainSessions(window, progress, done);
+        });
+  }
+}
+
 const std::vector<const folly::AsyncSocketBase*> HTTPServer::getSockets()
     const {
 
@@ -272,6 +930,58 @@ int HTTPServer::getListenSocket() const {
   return socketFds[0].toFd();
 }
 
+HTTPServer::SessionSettings HTTPServer::getSessionSettings(
+    const HTTPServerOptions& options) {
+  return {options.idleTimeout,
+          options.maxConcurrentIncomingStreams,
+          options.initialReceiveWindow,
+          options.receiveStreamWindowSize,
+          options.receiveSessionWindowSize};
+}
+
+void HTTPServer::updateSessionSettings(const SessionSettings& settings) {
+  *sessionSettings_.wlock() = settings;
+  applySessionSettings(settings);
+}
+
+void HTTPServer::adjustStreamLimit() {
+  if (!options_->adaptiveStreamLimit->update()) {
+    return;
+  }
+  auto settings = sessionSettings_.copy().value_or(
+      getSessionSettings(*options_));
+  applySessionSettings(settings);
+}
+
+void HTTPServer::applySessionSettings(const SessionSettings& settings) {
+  FOR_EACH_RANGE(i, 0, bootstrap_.size()) {
+    auto addressSettings = settings;
+    if (i < addresses_.size() &&
+        addresses_[i].isolation.maxConcurrentIncomingStreams) {
+      addressSettings.maxConcurrentIncomingStreams =
+          *addresses_[i].isolation.maxConcurrentIncomingStreams;
+    }
+    if (options_->adaptiveStreamLimit) {
+      addressSettings.maxConcurrentIncomingStreams =
+          options_->adaptiveStreamLimit->getLimit(
+              addressSettings.maxConcurrentIncomingStreams);
+    }
+    bootstrap_[i].forEachWorker([&](wangle::Acceptor* acceptor) {
+      auto sessionAcceptor = dynamic_cast<HTTPSessionAcceptor*>(acceptor);
+      if (!sessionAcceptor) {
+        return;
+      }
+      auto evb = acceptor->getEventBase();
+      if (!evb) {
+        return;
+      }
+      evb->runInEventBaseThread([sessionAcceptor, addressSettings] {
+        sessionAcceptor->updateSessionSettings(addressSettings);
+      });
+    });
+  }
+}
+
 void HTTPServer::updateTLSCredentials() {
   for (auto& bootstrap : bootstrap_) {
     bootstrap.forEachWorker([&](wangle::Acceptor* acceptor) {
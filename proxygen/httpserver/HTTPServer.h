@@ -8,12 +8,18 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <folly/Synchronized.h>
 #include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/io/SocketOptionMap.h>
+#include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseManager.h>
 #include <proxygen/httpserver/HTTPServerOptions.h>
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/session/HTTPSession.h>
+#include <proxygen/lib/http/session/HTTPSessionAcceptor.h>
 #include <thread>
 #include <wangle/bootstrap/ServerBootstrap.h>
 #include <wangle/ssl/SSLContextConfig.h>
@@ -21,6 +27,7 @@
 namespace proxygen {
 
 class SignalHandler;
+class SocketTakeoverServer;
 class HTTPServerAcceptor;
 
 /**
@@ -75,12 +82,50 @@ class HTTPServer final {
      */
     uint32_t fastOpenQueueSize{10000};
 
+    /**
+     * With TCP_DEFER_ACCEPT, connections are only accepted once data
+     * arrives, for up to this long, so that the IO threads don't wake up
+     * for connections with nothing to read yet.  0 to accept on handshake.
+     * Only supported on Linux.
+     */
+    std::chrono::seconds deferAccept{0};
+
     /*
      * Determines if this server does strict checking when loading SSL contexts.
      */
     bool strictSSL{true};
 
     folly::Optional<folly::SocketOptionMap> acceptorSocketOptions;
+
+    /**
+     * Resources kept for this address, so that a busy address can't take
+     * them from the others.  The limits don't apply with an acceptor factory
+     * passed to start().
+     */
+    struct Isolation {
+      // IO threads of its own rather than the server's, when not 0
+      size_t ioThreads{0};
+      /**
+       * Connections open at once across its IO threads, 0 for no limit.
+       * Connections past it are reset when accepted.  Each IO thread
+       * checks the shared count, so it can be exceeded by the connections
+       * accepted at the same time.
+       */
+      uint64_t maxConnections{0};
+      // Overrides the server's, also over updateSessionSettings()
+      folly::Optional<uint32_t> maxConcurrentIncomingStreams;
+      // Egress bytes a session buffers before pausing its handlers
+      folly::Optional<int64_t> writeBufferLimit;
+    };
+    Isolation isolation;
+  };
+
+  /**
+   * The connections of the acceptors of an address, across IO threads.
+   */
+  struct AddressStats {
+    std::atomic<uint64_t> connections{0};
+    std::atomic<uint64_t> rejectedConnections{0};
   };
 
   /**
@@ -147,6 +192,25 @@ class HTTPServer final {
    */
   void stop();
 
+  /**
+   * Drains the sessions of every acceptor over options drainWindow (see
+   * DrainScheduler), invoking onDone from an IO thread once all of them
+   * were sent their GOAWAY.  The server keeps listening, and drains the
+   * sessions it accepts from then on as they arrive: stopListening() or
+   * stop() afterwards.  Calling it again spreads the sessions not drained
+   * yet over the new window, and invokes both onDone at its end.  Can be
+   * called from any thread after start().
+   */
+  void drain(std::function<void()> onDone = nullptr);
+
+  /**
+   * The sessions drain() scheduled, drained and saw close before their
+   * turn, over every call.  Can be read from any thread.
+   */
+  const DrainScheduler::Progress& getDrainProgress() const {
+    return *drainProgress_;
+  }
+
   /**
    * Get the list of addresses server is listening on. Empty if sockets are not
    * bound yet.
@@ -155,11 +219,43 @@ class HTTPServer final {
     return addresses_;
   }
 
+  /**
+   * How long start() took to bind the addresses, creating their acceptors
+   * (with parallelTLSInit, queueing the init of the TLS ones), then to wait
+   * for the TLS acceptors to load their certificates.
+   */
+  struct StartTimes {
+    std::chrono::milliseconds bind{0};
+    std::chrono::milliseconds tlsInit{0};
+  };
+
+  const StartTimes& getStartTimes() const {
+    return startTimes_;
+  }
+
+  /**
+   * Stats of the address at index in bind() once started, or nullptr.  Can
+   * be read from any thread.
+   */
+  const AddressStats* getAddressStats(size_t index) const {
+    return index < addressStats_.size() ? addressStats_[index].get()
+                                        : nullptr;
+  }
+
   /**
    * Get the sockets the server is currently bound to.
    */
   const std::vector<const folly::AsyncSocketBase*> getSockets() const;
 
+  /**
+   * Options the server runs with, including the filters it added to
+   * handlerFactories.  Pass them to HQServer to serve the same handler chain
+   * over HTTP/3.
+   */
+  std::shared_ptr<const HTTPServerOptions> getOptions() const {
+    return options_;
+  }
+
   void setSessionInfoCallback(HTTPSession::InfoCallback* cb) {
     sessionInfoCb_ = cb;
   }
@@ -169,6 +265,24 @@ class HTTPServer final {
    */
   int getListenSocket() const;
 
+  using SessionSettings = HTTPSessionAcceptor::SessionSettings;
+
+  /**
+   * The settings of the acceptors of a server with the given options.
+   */
+  static SessionSettings getSessionSettings(const HTTPServerOptions& options);
+
+  /**
+   * Applies new settings to every acceptor, from its IO thread: to the
+   * sessions accepted from then on, and the concurrent stream limit to the
+   * running HTTP/2 sessions too.  Tunes a running server without
+   * restarting it.  Can be called from any thread after start().
+   *
+   * With HTTPServerOptions::adaptiveStreamLimit, the limit is scaled to the
+   * current load, then and on every later change of it.
+   */
+  void updateSessionSettings(const SessionSettings& settings);
+
   /**
    * Re-reads the certificate / key pair for all SSL vips on all acceptors
    */
@@ -179,6 +293,12 @@ class HTTPServer final {
    */
   void updateTicketSeeds(wangle::TLSTicketKeySeeds seeds);
 
+  /**
+   * Returns the CPUs of a NUMA node as listed by sysfs, or an empty vector if
+   * the node doesn't exist.
+   */
+  static std::vector<int> getNumaNodeCpus(int node);
+
  protected:
   /**
    * Start TCP HTTP server.
@@ -193,6 +313,20 @@ class HTTPServer final {
       std::shared_ptr<folly::IOThreadPoolExecutor> ioExecutor);
 
  private:
+  /**
+   * Takes the sockets of the server at options_->takeoverPath as prebound
+   * sockets.  Returns the connection to confirm the takeover on, or -1.
+   */
+  int takeSocketsOver();
+
+  // Serves the next process taking the sockets over
+  void startTakeoverServer();
+
+  void applySessionSettings(const SessionSettings& settings);
+
+  // Samples options_->adaptiveStreamLimit, and applies a changed limit
+  void adjustStreamLimit();
+
   std::shared_ptr<HTTPServerOptions> options_;
 
   /**
@@ -205,11 +339,36 @@ class HTTPServer final {
    */
   std::unique_ptr<SignalHandler> signalHandler_;
 
+  /**
+   * Hands the listening sockets to the next process, with takeoverPath
+   */
+  std::unique_ptr<SocketTakeoverServer> takeoverServer_;
+
+  /**
+   * EventBaseManager for the IO threads we create, when they need a non
+   * default backend.  Declared before bootstrap_ so it outlives the executor.
+   */
+  std::unique_ptr<folly::EventBaseManager> ioEventBaseManager_;
+
   /**
    * Addresses we are listening on
    */
   std::vector<IPConfig> addresses_;
   std::vector<wangle::ServerBootstrap<wangle::DefaultPipeline>> bootstrap_;
+  std::vector<std::shared_ptr<AddressStats>> addressStats_;
+  // The IO threads of the addresses with Isolation::ioThreads
+  std::vector<std::shared_ptr<folly::IOThreadPoolExecutor>> isolatedExecutors_;
+
+  StartTimes startTimes_;
+
+  // The last settings passed to updateSessionSettings(), which the adaptive
+  // stream limit scales
+  folly::Synchronized<folly::Optional<SessionSettings>> sessionSettings_;
+  // On mainEventBase_
+  std::unique_ptr<folly::AsyncTimeout> streamLimitTimeout_;
+
+  const std::shared_ptr<DrainScheduler::Progress> drainProgress_{
+      std::make_shared<DrainScheduler::Progress>()};
 
   /**
    * Callback for session create/destruction
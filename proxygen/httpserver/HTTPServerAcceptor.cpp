@@ -29,8 +29,24 @@ AcceptorConfiguration HTTPServerAcceptor::makeConfig(
   conf.initialReceiveWindow = opts.initialReceiveWindow;
   conf.receiveStreamWindowSize = opts.receiveStreamWindowSize;
   conf.receiveSessionWindowSize = opts.receiveSessionWindowSize;
+  conf.maxAutotunedReceiveWindow = opts.maxAutotunedReceiveWindow;
+  conf.batchWindowUpdates = opts.batchWindowUpdates;
+  conf.adaptiveEgressFrameSize = opts.adaptiveEgressFrameSize;
+  conf.dynamicTLSRecordSize = opts.dynamicTLSRecordSize;
   conf.acceptBacklog = opts.listenBacklog;
-  conf.maxConcurrentIncomingStreams = opts.maxConcurrentIncomingStreams;
+  conf.maxConcurrentIncomingStreams =
+      ipConfig.isolation.maxConcurrentIncomingStreams.value_or(
+          opts.maxConcurrentIncomingStreams);
+  if (ipConfig.isolation.writeBufferLimit) {
+    conf.writeBufferLimit = *ipConfig.isolation.writeBufferLimit;
+  }
+  conf.kernelTLSOffload = opts.useKernelTLS;
+  conf.zeroCopyEgressThreshold = opts.zeroCopyEgressThreshold;
+  conf.maxEgressBytesPerLoop = opts.maxEgressBytesPerLoop;
+  if (opts.lowLatency) {
+    conf.busyPollMicros = opts.busyPollMicros;
+    conf.writeInCurrentLoop = true;
+  }
 
   if (opts.enableExHeaders) {
     conf.egressSettings.push_back(
@@ -67,7 +83,9 @@ AcceptorConfiguration HTTPServerAcceptor::makeConfig(
 std::unique_ptr<HTTPServerAcceptor> HTTPServerAcceptor::make(
     const AcceptorConfiguration& conf,
     const HTTPServerOptions& opts,
-    const std::shared_ptr<HTTPCodecFactory>& codecFactory) {
+    const std::shared_ptr<HTTPCodecFactory>& codecFactory,
+    std::shared_ptr<HTTPServer::AddressStats> addressStats,
+    uint64_t maxConnections) {
   // Create a copy of the filter chain in reverse order since we need to create
   // Handlers in that order.
   std::vector<RequestHandlerFactory*> handlerFactories;
@@ -77,17 +95,30 @@ std::unique_ptr<HTTPServerAcceptor> HTTPServerAcceptor::make(
   std::reverse(handlerFactories.begin(), handlerFactories.end());
 
   return std::unique_ptr<HTTPServerAcceptor>(
-      new HTTPServerAcceptor(conf, codecFactory, handlerFactories, opts));
+      new HTTPServerAcceptor(conf,
+                             codecFactory,
+                             handlerFactories,
+                             opts,
+                             std::move(addressStats),
+                             maxConnections));
 }
 
 HTTPServerAcceptor::HTTPServerAcceptor(
     const AcceptorConfiguration& conf,
     const std::shared_ptr<HTTPCodecFactory>& codecFactory,
     std::vector<RequestHandlerFactory*> handlerFactories,
-    const HTTPServerOptions& options)
+    const HTTPServerOptions& options,
+    std::shared_ptr<HTTPServer::AddressStats> addressStats,
+    uint64_t maxConnections)
     : HTTPSessionAcceptor(conf, codecFactory),
       serverOptions_(options),
-      handlerFactories_(handlerFactories) {
+      handlerFactories_(handlerFactories),
+      addressStats_(std::move(addressStats)),
+      maxConnections_(maxConnections) {
+  CHECK(addressStats_ || maxConnections_ == 0);
+  if (options.sslStatsFactory) {
+    ownSSLStats_ = options.sslStatsFactory();
+  }
 }
 
 void HTTPServerAcceptor::setCompletionCallback(std::function<void()> f) {
@@ -121,6 +152,15 @@ void HTTPServerAcceptor::onNewConnection(
     const std::string& nextProtocolName,
     SecureTransportType secureTransportType,
     const wangle::TransportInfo& tinfo) {
+  if (maxConnections_ > 0 && addressStats_->connections >= maxConnections_) {
+    addressStats_->rejectedConnections++;
+    VLOG(4) << "Rejecting connection from " << *address << " to "
+            << getConfig().bindAddress << ", over maxConnections="
+            << maxConnections_;
+    sock->closeWithReset();
+    return;
+  }
+
   auto& filter = serverOptions_.newConnectionFilter;
   if (filter) {
     try {
@@ -132,20 +172,39 @@ void HTTPServerAcceptor::onNewConnection(
     }
   }
 
-  const auto& func = serverOptions_.zeroCopyEnableFunc;
-  if (func && sock) {
-    sock->setZeroCopy(true);
-    sock->setZeroCopyEnableFunc(func);
-  }
-
   HTTPSessionAcceptor::onNewConnection(
       std::move(sock), address, nextProtocolName, secureTransportType, tinfo);
 }
 
+void HTTPServerAcceptor::prepareTransport(folly::AsyncTransport& sock) {
+  // After any kTLS conversion, so zero copy applies to the kTLS socket
+  const auto& func = serverOptions_.zeroCopyEnableFunc;
+  if (func) {
+    sock.setZeroCopy(true);
+    sock.setZeroCopyEnableFunc(func);
+  }
+}
+
 void HTTPServerAcceptor::onConnectionsDrained() {
   if (completionCallback_) {
     completionCallback_();
   }
 }
 
+void HTTPServerAcceptor::onConnectionAdded(
+    const wangle::ManagedConnection* conn) {
+  HTTPSessionAcceptor::onConnectionAdded(conn);
+  if (addressStats_) {
+    addressStats_->connections++;
+  }
+}
+
+void HTTPServerAcceptor::onConnectionRemoved(
+    const wangle::ManagedConnection* conn) {
+  HTTPSessionAcceptor::onConnectionRemoved(conn);
+  if (addressStats_) {
+    addressStats_->connections--;
+  }
+}
+
 } // namespace proxygen
@@ -11,6 +11,7 @@
 #include <proxygen/httpserver/HTTPServer.h>
 #include <proxygen/httpserver/HTTPServerOptions.h>
 #include <proxygen/lib/http/session/HTTPSessionAcceptor.h>
+#include <proxygen/lib/ssl/ThreadLocalSSLStats.h>
 
 namespace proxygen {
 
@@ -22,7 +23,9 @@ class HTTPServerAcceptor final : public HTTPSessionAcceptor {
   static std::unique_ptr<HTTPServerAcceptor> make(
       const AcceptorConfiguration& conf,
       const HTTPServerOptions& opts,
-      const std::shared_ptr<HTTPCodecFactory>& codecFactory = nullptr);
+      const std::shared_ptr<HTTPCodecFactory>& codecFactory = nullptr,
+      std::shared_ptr<HTTPServer::AddressStats> addressStats = nullptr,
+      uint64_t maxConnections = 0);
 
   /**
    * Invokes the given method when all the connections are drained
@@ -35,7 +38,9 @@ class HTTPServerAcceptor final : public HTTPSessionAcceptor {
   HTTPServerAcceptor(const AcceptorConfiguration& conf,
                      const std::shared_ptr<HTTPCodecFactory>& codecFactory,
                      std::vector<RequestHandlerFactory*> handlerFactories,
-                     const HTTPServerOptions& options);
+                     const HTTPServerOptions& options,
+                     std::shared_ptr<HTTPServer::AddressStats> addressStats,
+                     uint64_t maxConnections);
 
   // HTTPSessionAcceptor
   HTTPTransaction::Handler* newHandler(HTTPTransaction& txn,
@@ -47,11 +52,27 @@ class HTTPServerAcceptor final : public HTTPSessionAcceptor {
                        wangle::SecureTransportType secureTransportType,
                        const wangle::TransportInfo& tinfo) override;
 
+  void prepareTransport(folly::AsyncTransport& sock) override;
+
+  // wangle::Acceptor, for handshakes and kernel TLS offloads
+  wangle::SSLStats* getSSLStats() const override {
+    return ownSSLStats_.get();
+  }
+
   void onConnectionsDrained() override;
 
+  // wangle::ConnectionManager::Callback
+  void onConnectionAdded(const wangle::ManagedConnection* conn) override;
+  void onConnectionRemoved(const wangle::ManagedConnection* conn) override;
+
   const HTTPServerOptions& serverOptions_;
   std::function<void()> completionCallback_;
   const std::vector<RequestHandlerFactory*> handlerFactories_{nullptr};
+  // Shared by the acceptors of the address on every IO thread
+  const std::shared_ptr<HTTPServer::AddressStats> addressStats_;
+  const uint64_t maxConnections_;
+  // From HTTPServerOptions::sslStatsFactory, for this acceptor's thread
+  std::unique_ptr<ProxygenSSLStats> ownSSLStats_;
 };
 
 } // namespace proxygen
@@ -8,15 +8,23 @@
 
 #pragma once
 
+#include <chrono>
 #include <folly/Function.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/async/AsyncServerSocket.h>
 #include <proxygen/httpserver/Filters.h>
+#include <limits>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 #include <signal.h>
 
 namespace proxygen {
 
+class AdaptiveCompressionLevel;
+class AdaptiveStreamLimit;
+class CompressedResponseCache;
+class ProxygenSSLStats;
+class ZstdDictionaryStore;
+
 /**
  * Configuration options for HTTPServer
  *
@@ -97,6 +105,15 @@ class HTTPServerOptions {
    */
   bool supportsConnect{false};
 
+  /**
+   * Answer 425 Too Early to the requests that arrived as TLS 1.3 or QUIC
+   * 0-RTT early data, unless their method is idempotent.  Handlers can tell
+   * early data with HTTPMessage::isEarlyData().  0-RTT itself is enabled
+   * with the fizz context's early data settings, with a replay cache such
+   * as ShardedBloomReplayCache.
+   */
+  bool rejectNonIdempotentEarlyData{true};
+
   /**
    * Flow control configuration for the acceptor
    */
@@ -104,12 +121,39 @@ class HTTPServerOptions {
   size_t receiveStreamWindowSize{65536};
   size_t receiveSessionWindowSize{65536};
 
+  /**
+   * Upper bound for BDP based receive window autotuning, 0 to disable.
+   */
+  uint32_t maxAutotunedReceiveWindow{0};
+
+  /**
+   * Coalesce HTTP/2 WINDOW_UPDATEs into one write per loop.
+   */
+  bool batchWindowUpdates{false};
+
+  /**
+   * Size HTTP/2 DATA frames to the congestion window and TLS records.
+   */
+  bool adaptiveEgressFrameSize{false};
+
+  /**
+   * Small TLS records while a connection warms up, full records after.
+   */
+  bool dynamicTLSRecordSize{false};
+
   /**
    * The maximum number of transactions the remote could initiate
    * per connection on protocols that allow multiplexing.
    */
   uint32_t maxConcurrentIncomingStreams{100};
 
+  /**
+   * Optional policy lowering maxConcurrentIncomingStreams as the server
+   * gets busy, on the running HTTP/2 sessions too, and restoring it as the
+   * load drops. May be shared with other servers.
+   */
+  std::shared_ptr<AdaptiveStreamLimit> adaptiveStreamLimit;
+
   /**
    * Set to true to enable content compression. Currently false for
    * backwards compatibility.  If enabled, by default gzip will be enabled
@@ -138,6 +182,14 @@ class HTTPServerOptions {
    */
   bool enableGzipCompression{true};
 
+  /**
+   * Set to true to reuse the zlib and zstd contexts of finished responses,
+   * kept in per-thread pools, instead of allocating them for every
+   * response. A deflate context alone is about 256KB.
+   * Only applicable if enableContentCompression is set to true.
+   */
+  bool poolCompressionContexts{false};
+
   /**
    * Requests smaller than the specified number of bytes will not be compressed
    */
@@ -158,6 +210,76 @@ class HTTPServerOptions {
    */
   int zstdContentCompressionLevel{8};
 
+  /**
+   * Set to true to enable brotli (br) compression, if proxygen was built
+   * with brotli.
+   * Only applicable if enableContentCompression is set to true.
+   */
+  bool enableBrotliCompression{false};
+
+  /**
+   * Brotli quality, valid values are 0 to 11.
+   * Default is 5, which compresses better than gzip at a similar cpu cost.
+   * Higher values are mostly worth it for content compressed ahead of time.
+   */
+  int brotliContentCompressionQuality{5};
+
+  /**
+   * Log2 of the brotli window size, valid values are 10 to 24.
+   */
+  int brotliContentCompressionWindowBits{22};
+
+  /**
+   * Optional cache of compressed response bodies, which may be shared with
+   * other servers. Caches non chunked responses only.
+   * Only applicable if enableContentCompression is set to true.
+   */
+  std::shared_ptr<CompressedResponseCache> compressedResponseCache;
+
+  /**
+   * Optional zstd dictionaries. Requests accepting the dcz content coding
+   * and naming one of them in Available-Dictionary get responses compressed
+   * with it, which does much better than zstd alone on small responses.
+   * Only applicable if enableZstdCompression is set to true.
+   */
+  std::shared_ptr<const ZstdDictionaryStore> zstdDictionaries;
+
+  /**
+   * Optional policy lowering the compression levels above, or skipping
+   * large responses, as the CPU gets busy. May be shared with other servers.
+   * Only applicable if enableContentCompression is set to true.
+   */
+  std::shared_ptr<AdaptiveCompressionLevel> adaptiveCompressionLevel;
+
+  /**
+   * Set to true to decode request bodies sent with a gzip, deflate, zstd or
+   * (if proxygen was built with brotli) br Content-Encoding, before they get
+   * to the handlers. Requests decoding to more than the limits below are
+   * aborted.
+   */
+  bool enableRequestBodyDecompression{false};
+
+  /**
+   * Largest decoded request body, zero for no limit.
+   */
+  uint64_t requestDecompressionMaxBytes{64 * 1024 * 1024};
+
+  /**
+   * Highest ratio of decoded to encoded request body bytes, checked once a
+   * body decodes to more than 1MB, zero for no limit. Guards against
+   * decompression bombs.
+   */
+  double requestDecompressionMaxRatio{100};
+
+  /**
+   * Free blocks each thread keeps to recycle the memory of the objects
+   * allocated for each request or connection, for every class deriving
+   * from PooledObject: RequestHandlerAdaptor, the built in filters, the
+   * downstream sessions and their codecs, and any handler opting in. Zero
+   * to allocate them with malloc.
+   */
+  size_t handlerPoolSize{0};
+
   /**
    * Enable support for pub-sub extension.
    */
@@ -211,6 +333,25 @@ class HTTPServerOptions {
     useExistingSocket(std::move(socket));
   }
 
+  /**
+   * Path of a Unix socket for hot restarts.  start() first asks a server
+   * listening there for its sockets, and serves from them instead of
+   * binding new ones if it has one group per bound address.  Once started
+   * it listens there in turn, and when the next process has taken its
+   * sockets over calls onSocketsTakenOver, or stopListening() if unset, so
+   * only the new process accepts while this one drains.  Empty disables.
+   */
+  std::string takeoverPath;
+  std::chrono::milliseconds takeoverTimeout{5000};
+  std::function<void()> onSocketsTakenOver;
+
+  /**
+   * HTTPServer::drain() spreads the GOAWAYs of the sessions over this
+   * window, so their clients don't all reconnect, and handshake with the
+   * other instances, at once.  0 drains them all together.
+   */
+  std::chrono::milliseconds drainWindow{0};
+
   /**
    * Invoked after a new connection is created. Drop connection if the function
    * throws any exception.
@@ -226,5 +367,123 @@ class HTTPServerOptions {
    *  zerocopy enable function
    */
   folly::AsyncWriter::ZeroCopyEnableFunc zeroCopyEnableFunc;
+
+  /**
+   * With useZeroCopy, only writes carrying at least this many body bytes use
+   * MSG_ZEROCOPY, see HTTPSession::setZeroCopyEgressThreshold.  0 leaves the
+   * decision to zeroCopyEnableFunc.
+   */
+  uint64_t zeroCopyEgressThreshold{0};
+
+  /**
+   * Bytes a session writes per event loop callback before yielding to the
+   * other sessions of its IO thread, so a fast reader on a writable socket
+   * can't delay them, see HTTPSession::setMaxEgressBytesPerLoop.  0
+   * disables.
+   */
+  uint64_t maxEgressBytesPerLoop{0};
+
+  /**
+   * Bytes each session parses, and writes, per event loop callback before
+   * yielding to the other connections of its IO thread, HTTP/3 included,
+   * see LoopBudget.  maxEgressBytesPerLoop takes precedence for writes.  0
+   * disables.
+   */
+  uint64_t loopBudgetReadSlice{0};
+  uint64_t loopBudgetWriteSlice{0};
+
+  /**
+   * IO threads sample one loop iteration out of this many into the busy
+   * time stats of their LoopBudget::get(), unless their EventBase already
+   * has an observer.  0 disables.
+   */
+  uint32_t loopBudgetSampleRate{0};
+
+  /**
+   * Offload TLS encryption of downstream fizz connections to the kernel,
+   * see AcceptorConfiguration::kernelTLSOffload
+   */
+  bool useKernelTLS{false};
+
+  /**
+   * Makes the TLS stats of each acceptor, on its IO thread, eg a TLSSLStats.
+   * They count its handshakes and kernel TLS offloads.  Unset records none.
+   */
+  std::function<std::unique_ptr<ProxygenSSLStats>()> sslStatsFactory;
+
+  /**
+   * Run the IO threads created by HTTPServer on folly's io_uring EventBase
+   * backend instead of epoll. Only takes effect when folly is built with
+   * liburing, and is ignored if an ioExecutor is passed to start(). If a ring
+   * can't be created the thread falls back to the default backend.
+   */
+  bool useIoUringBackend{false};
+
+  /**
+   * io_uring backend tuning, see folly::PollIoBackend::Options
+   */
+  size_t ioUringCapacity{4096};
+  size_t ioUringMaxSubmit{128};
+  size_t ioUringMaxGet{std::numeric_limits<size_t>::max()};
+  bool ioUringUseRegisteredFds{false};
+
+  /**
+   * Initialize the acceptors of TLS addresses on their IO threads at the
+   * same time while starting, rather than one after the other, so threads
+   * load their certificates in parallel.  start() still waits for them,
+   * and fails if one fails.
+   */
+  bool parallelTLSInit{true};
+
+  /**
+   * Open one SO_REUSEPORT listening socket per IO thread, on that thread's
+   * EventBase, instead of accepting on a dedicated thread.  Each IO thread
+   * only serves the connections its own socket accepted, so there is no
+   * cross-thread handoff and the kernel spreads new connections over the
+   * threads.  Doesn't apply to sockets passed to useExistingSocket().
+   */
+  bool listenerPerThread{false};
+
+  /**
+   * With listenerPerThread, attach a classic BPF program to the reuseport
+   * group that picks the listener of the CPU that received the SYN.  This
+   * only keeps a connection on the CPU that handled its packets if IO thread
+   * N runs on CPU N, so pair it with pinned IO threads.
+   */
+  bool reusePortCpuSteering{false};
+
+  /**
+   * Pin the IO threads created by HTTPServer, thread N runs on
+   * ioThreadCpus[N % size].  Pinning happens before the thread creates its
+   * EventBase.  If threads is 0 one thread is started per listed CPU.  With
+   * reusePortCpuSteering, a SYN is steered to the listener of the thread
+   * pinned to the receiving CPU.  Ignored if an ioExecutor is passed to
+   * start().
+   */
+  std::vector<int> ioThreadCpus;
+
+  /**
+   * Keep the IO threads and their memory on this NUMA node.  If ioThreadCpus
+   * is empty it's filled with the node's CPUs, and each thread prefers the
+   * node for its allocations: EventBase, thread local stats and buffer pools.
+   * -1 disables.
+   */
+  int numaNode{-1};
+
+  /**
+   * Trade CPU for tail latency:
+   *
+   *  . Accepted sockets busy poll their device queue for busyPollMicros
+   *    when reading (SO_BUSY_POLL).  Set the net.core.busy_poll sysctl for
+   *    epoll_wait to busy poll them as well.
+   *  . Implies listenerPerThread, and each listener of a pinned IO thread is
+   *    marked with its CPU (SO_INCOMING_CPU), so the kernel prefers it for
+   *    the connections whose packets that CPU handles.  Pair with
+   *    ioThreadCpus, and reusePortCpuSteering to enforce it.
+   *  . Sessions write in the event loop iteration that generated the egress
+   *    rather than the next one, see HTTPSession::setWriteInCurrentLoop.
+   */
+  bool lowLatency{false};
+  uint32_t busyPollMicros{50};
 };
 } // namespace proxygen
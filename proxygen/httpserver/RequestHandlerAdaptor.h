@@ -10,6 +10,7 @@
 
 #include <proxygen/httpserver/ResponseHandler.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/utils/PooledObject.h>
 
 namespace proxygen {
 
@@ -33,7 +34,8 @@ class PushHandler;
  */
 class RequestHandlerAdaptor
     : public HTTPTransactionHandler
-    , public ResponseHandler {
+    , public ResponseHandler
+    , public PooledObject<RequestHandlerAdaptor> {
  public:
   explicit RequestHandlerAdaptor(RequestHandler* requestHandler);
 
@@ -20,7 +20,7 @@ namespace proxygen {
  *       state machine in HTTPTransaction to tell us when an
  *       error occurs
  *
- * Three expected use cases are
+ * Four expected use cases are
  *
  * 1. Send all response at once. If this is an error
  *    response, most probably you also want 'closeConnection'.
@@ -59,6 +59,14 @@ namespace proxygen {
  * ResponseBuilder(handler)
  *    .rejectUpgradeRequest() // send '400 Bad Request'
  *
+ * 4. Hint the resources of the response while it is being made
+ *
+ * ResponseBuilder(handler)
+ *    .earlyHint("</style.css>; rel=preload; as=style")
+ *    .sendEarlyHints(); // send '103 Early Hints'
+ *
+ * and later the response, as in 1 or 2.
+ *
  */
 class ResponseBuilder {
  public:
@@ -103,6 +111,47 @@ class ResponseBuilder {
     return *this;
   }
 
+  // Adds a Link to the 103 Early Hints sent by sendEarlyHints()
+  ResponseBuilder& earlyHint(const std::string& link) {
+    if (!hints_) {
+      hints_ = std::make_unique<HTTPMessage>(makeEarlyHints({}));
+    }
+    hints_->getHeaders().add(HTTP_HEADER_LINK, link);
+    return *this;
+  }
+
+  ResponseBuilder& sendEarlyHints() {
+    if (hints_) {
+      txn_->sendHeaders(*hints_);
+      hints_.reset();
+    }
+    return *this;
+  }
+
+  /**
+   * Sends hints made ahead, e.g. once per route with makeEarlyHints(),
+   * rather than those of earlyHint().  The HPACK and QPACK encoders index
+   * Link values, so hints repeated on a connection take a few bytes.
+   */
+  ResponseBuilder& sendEarlyHints(const HTTPMessage& hints) {
+    DCHECK_EQ(hints.getStatusCode(), 103);
+    // Copied as filters may change what they send
+    HTTPMessage msg(hints);
+    txn_->sendHeaders(msg);
+    return *this;
+  }
+
+  static HTTPMessage makeEarlyHints(const std::vector<std::string>& links) {
+    HTTPMessage hints;
+    hints.setHTTPVersion(1, 1);
+    hints.setStatusCode(103);
+    hints.setStatusMessage("Early Hints");
+    for (const auto& link : links) {
+      hints.getHeaders().add(HTTP_HEADER_LINK, link);
+    }
+    return hints;
+  }
+
   ResponseBuilder& body(std::unique_ptr<folly::IOBuf> bodyIn) {
     if (bodyIn) {
       if (body_) {
@@ -226,6 +275,7 @@ class ResponseBuilder {
   ResponseHandler* const txn_{nullptr};
 
   std::unique_ptr<HTTPMessage> headers_;
+  std::unique_ptr<HTTPMessage> hints_;
   std::unique_ptr<folly::IOBuf> body_;
   std::unique_ptr<HTTPHeaders> trailers_;
 
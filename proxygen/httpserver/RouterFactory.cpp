@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/RouterFactory.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <folly/Conv.h>
+#include <proxygen/httpserver/filters/DirectResponseHandler.h>
+
+namespace {
+
+// The segment at the start of path, which starts with a '/'
+folly::StringPiece firstSegment(folly::StringPiece path) {
+  auto segment = path.subpiece(1);
+  return segment.subpiece(0, segment.find('/'));
+}
+
+} // namespace
+
+namespace proxygen {
+
+folly::Optional<folly::StringPiece> RouterFactory::Match::getParam(
+    folly::StringPiece name) const {
+  if (route_) {
+    const auto& names = route_->paramNames;
+    for (size_t i = 0; i < names.size() && i < params_.size(); i++) {
+      if (names[i] == name) {
+        return params_[i];
+      }
+    }
+  }
+  return folly::none;
+}
+
+RouterFactory::RouterFactory()
+    : notFound_(std::make_shared<const CannedResponse>(404)),
+      methodNotAllowed_(std::make_shared<const CannedResponse>(405)) {
+}
+
+RouterFactory& RouterFactory::addRoute(HTTPMethod method,
+                                       folly::StringPiece pattern,
+                                       HandlerFn handler) {
+  return addRouteImpl(method, pattern, std::move(handler));
+}
+
+RouterFactory& RouterFactory::addRoute(folly::StringPiece pattern,
+                                       HandlerFn handler) {
+  return addRouteImpl(folly::none, pattern, std::move(handler));
+}
+
+RouterFactory& RouterFactory::addRouteImpl(folly::Optional<HTTPMethod> method,
+                                           folly::StringPiece pattern,
+                                           HandlerFn handler) {
+  if (pattern.empty() || pattern.front() != '/') {
+    throw std::invalid_argument(
+        folly::to<std::string>("Route must start with a /: ", pattern));
+  }
+  Route route;
+  route.method = method;
+  route.pattern = pattern.str();
+  route.handler = std::move(handler);
+  route.id = routes_.size();
+
+  auto node = &root_;
+  auto routes = &node->routes;
+  auto path = pattern;
+  while (!path.empty()) {
+    auto segment = firstSegment(path);
+    path.advance(segment.size() + 1);
+    if (!segment.empty() && segment.front() == '*') {
+      if (!path.empty()) {
+        throw std::invalid_argument(folly::to<std::string>(
+            "Wildcard must be the last segment: ", pattern));
+      }
+      route.paramNames.push_back(segment.subpiece(1).str());
+      node->hasWildcard = true;
+      routes = &node->wildcardRoutes;
+      break;
+    }
+    if (!segment.empty() && segment.front() == ':') {
+      if (segment.size() == 1) {
+        throw std::invalid_argument(
+            folly::to<std::string>("Unnamed parameter: ", pattern));
+      }
+      route.paramNames.push_back(segment.subpiece(1).str());
+      if (!node->param) {
+        node->param = std::make_unique<Node>();
+      }
+      node = node->param.get();
+    } else {
+      auto& children = node->children;
+      auto it = std::lower_bound(
+          children.begin(),
+          children.end(),
+          segment,
+          [](const auto& child, folly::StringPiece s) {
+            return folly::StringPiece(child.first) < s;
+          });
+      if (it == children.end() || it->first != segment) {
+        it = children.emplace(it, segment.str(), std::make_unique<Node>());
+      }
+      node = it->second.get();
+    }
+    routes = &node->routes;
+  }
+
+  auto& slot =
+      (*routes)[method ? static_cast<size_t>(*method) : kAnyMethod];
+  if (slot >= 0) {
+    throw std::invalid_argument(
+        folly::to<std::string>("Duplicate route: ", pattern));
+  }
+  slot = static_cast<int32_t>(route.id);
+  routes_.push_back(std::move(route));
+  return *this;
+}
+
+int32_t RouterFactory::findRoute(const MethodRoutes& routes,
+                                 size_t method,
+                                 bool& pathMatched) {
+  if (method < kAnyMethod && routes[method] >= 0) {
+    return routes[method];
+  }
+  if (routes[kAnyMethod] >= 0) {
+    return routes[kAnyMethod];
+  }
+  pathMatched |= std::any_of(
+      routes.begin(), routes.end(), [](int32_t id) { return id >= 0; });
+  return -1;
+}
+
+bool RouterFactory::find(const Node& node,
+                         folly::StringPiece path,
+                         size_t method,
+                         Match& match,
+                         bool& pathMatched) const {
+  if (path.empty()) {
+    auto id = findRoute(node.routes, method, pathMatched);
+    if (id >= 0) {
+      match.route_ = &routes_[id];
+      return true;
+    }
+    return false;
+  }
+
+  auto segment = firstSegment(path);
+  auto rest = path.subpiece(segment.size() + 1);
+  auto it = std::lower_bound(node.children.begin(),
+                             node.children.end(),
+                             segment,
+                             [](const auto& child, folly::StringPiece s) {
+                               return folly::StringPiece(child.first) < s;
+                             });
+  if (it != node.children.end() && it->first == segment &&
+      find(*it->second, rest, method, match, pathMatched)) {
+    return true;
+  }
+  if (node.param && !segment.empty()) {
+    match.params_.push_back(segment);
+    if (find(*node.param, rest, method, match, pathMatched)) {
+      return true;
+    }
+    match.params_.pop_back();
+  }
+  if (node.hasWildcard) {
+    auto id = findRoute(node.wildcardRoutes, method, pathMatched);
+    if (id >= 0) {
+      match.params_.push_back(path.subpiece(1));
+      match.route_ = &routes_[id];
+      return true;
+    }
+  }
+  return false;
+}
+
+RouterFactory::MatchResult RouterFactory::match(
+    folly::Optional<HTTPMethod> method,
+    folly::StringPiece path,
+    Match& match) const {
+  match.route_ = nullptr;
+  match.params_.clear();
+  if (path.empty() || path.front() != '/') {
+    return MatchResult::NOT_FOUND;
+  }
+  bool pathMatched = false;
+  if (find(root_,
+           path,
+           method ? static_cast<size_t>(*method) : kAnyMethod,
+           match,
+           pathMatched)) {
+    return MatchResult::MATCHED;
+  }
+  return pathMatched ? MatchResult::METHOD_NOT_ALLOWED
+                     : MatchResult::NOT_FOUND;
+}
+
+RequestHandler* RouterFactory::onRequest(RequestHandler* upstream,
+                                         HTTPMessage* msg) noexcept {
+  DCHECK(!upstream) << "RouterFactory must be the last factory";
+  Match m;
+  auto result = match(msg->getMethod(), msg->getPathAsStringPiece(), m);
+  if (result == MatchResult::MATCHED) {
+    if (stats_) {
+      stats_->onRouted(*m.route_);
+    }
+    return m.route_->handler(msg, m);
+  }
+  if (stats_) {
+    stats_->onNotRouted(result);
+  }
+  return new DirectResponseHandler(result == MatchResult::NOT_FOUND
+                                       ? notFound_
+                                       : methodNotAllowed_);
+}
+
+} // namespace proxygen
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/small_vector.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/lib/http/HTTPMethod.h>
+#include <proxygen/lib/http/session/CannedResponse.h>
+
+namespace proxygen {
+
+/**
+ * A RequestHandlerFactory dispatching requests to handlers by method and
+ * path, in one walk of a trie of the path segments of the routes instead
+ * of a chain of string compares. Patterns are made of segments, where
+ * ":name" matches any one non empty segment and "*name", which must be
+ * the last, matches the rest of the path, as in "/users/:id/posts".
+ *
+ * Literal segments are tried before parameters, and parameters before
+ * wildcards. Matching does not allocate: the parameters are views of the
+ * path of the request, valid while the HandlerFn runs. Requests matching
+ * no route get a 404, or a 405 when only the method does not match.
+ *
+ * Routes are added before the server starts, and must not change after.
+ * The router must be the last factory of the chain.
+ */
+class RouterFactory : public RequestHandlerFactory {
+ public:
+  class Match;
+  using HandlerFn =
+      std::function<RequestHandler*(HTTPMessage* msg, const Match& match)>;
+
+  struct Route {
+    // None for any method
+    folly::Optional<HTTPMethod> method;
+    std::string pattern;
+    // Of the parameters and wildcard, in order
+    std::vector<std::string> paramNames;
+    HandlerFn handler;
+    // Its index in the order the routes were added
+    size_t id;
+  };
+
+  class Match {
+   public:
+    const Route* getRoute() const {
+      return route_;
+    }
+
+    size_t numParams() const {
+      return params_.size();
+    }
+
+    folly::StringPiece getParam(size_t index) const {
+      return params_[index];
+    }
+
+    folly::Optional<folly::StringPiece> getParam(
+        folly::StringPiece name) const;
+
+   private:
+    friend class RouterFactory;
+
+    const Route* route_{nullptr};
+    folly::small_vector<folly::StringPiece, 4> params_;
+  };
+
+  enum class MatchResult { MATCHED, NOT_FOUND, METHOD_NOT_ALLOWED };
+
+  /**
+   * Told of every request routed, from the threads of the server.
+   */
+  class StatsCallback {
+   public:
+    virtual ~StatsCallback() = default;
+    virtual void onRouted(const Route& route) noexcept = 0;
+    virtual void onNotRouted(MatchResult result) noexcept = 0;
+  };
+
+  RouterFactory();
+
+  /**
+   * Throws std::invalid_argument for a malformed pattern, or one that a
+   * route for the same method already has.
+   */
+  RouterFactory& addRoute(HTTPMethod method,
+                          folly::StringPiece pattern,
+                          HandlerFn handler);
+
+  RouterFactory& addRoute(folly::StringPiece pattern, HandlerFn handler);
+
+  void setStatsCallback(std::shared_ptr<StatsCallback> stats) {
+    stats_ = std::move(stats);
+  }
+
+  const std::vector<Route>& getRoutes() const {
+    return routes_;
+  }
+
+  /**
+   * Finds the route of a request, filling match when MATCHED. method is
+   * None for extension methods, only matching the routes for any method.
+   */
+  MatchResult match(folly::Optional<HTTPMethod> method,
+                    folly::StringPiece path,
+                    Match& match) const;
+
+  // RequestHandlerFactory
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* upstream,
+                            HTTPMessage* msg) noexcept override;
+
+ private:
+  // Route indices by method, the last for any method; -1 for none
+  static constexpr size_t kAnyMethod =
+      static_cast<size_t>(HTTPMethod::UNSUB) + 1;
+  using MethodRoutes = std::array<int32_t, kAnyMethod + 1>;
+
+  struct Node {
+    Node() {
+      routes.fill(-1);
+      wildcardRoutes.fill(-1);
+    }
+
+    // Sorted by segment
+    std::vector<std::pair<std::string, std::unique_ptr<Node>>> children;
+    std::unique_ptr<Node> param;
+    MethodRoutes routes;
+    bool hasWildcard{false};
+    MethodRoutes wildcardRoutes;
+  };
+
+  RouterFactory& addRouteImpl(folly::Optional<HTTPMethod> method,
+                              folly::StringPiece pattern,
+                              HandlerFn handler);
+  static int32_t findRoute(const MethodRoutes& routes,
+                           size_t method,
+                           bool& pathMatched);
+  bool find(const Node& node,
+            folly::StringPiece path,
+            size_t method,
+            Match& match,
+            bool& pathMatched) const;
+
+  Node root_;
+  std::vector<Route> routes_;
+  std::shared_ptr<StatsCallback> stats_;
+  std::shared_ptr<const CannedResponse> notFound_;
+  std::shared_ptr<const CannedResponse> methodNotAllowed_;
+};
+
+} // namespace proxygen
@@ -129,6 +129,10 @@ class ScopedHTTPServer final {
     return addresses;
   }
 
+  const HTTPServer& getServer() const {
+    return *server_;
+  }
+
   ~ScopedHTTPServer() {
     server_->stop();
     thread_.join();
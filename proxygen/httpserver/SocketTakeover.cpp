@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/SocketTakeover.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <folly/io/async/EventBase.h>
+#include <glog/logging.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t kVersion = 1;
+constexpr char kConfirm = 'C';
+
+[[noreturn]] void throwErrno(const char* what) {
+  throw std::system_error(errno, std::system_category(), what);
+}
+
+sockaddr_un makeAddress(const std::string& path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::invalid_argument("Takeover path too long: " + path);
+  }
+  memcpy(addr.sun_path, path.data(), path.size());
+  return addr;
+}
+
+int makeSocket(int flags = 0) {
+  // Datagram boundaries keep each message, and its sockets, together
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | flags, 0);
+  if (fd < 0) {
+    throwErrno("socket");
+  }
+  return fd;
+}
+
+} // namespace
+
+namespace proxygen {
+
+void SocketTakeover::sendSockets(int fd, const SocketGroups& groups) {
+  // The version, the number of groups and the size of each
+  std::vector<uint32_t> header{kVersion, static_cast<uint32_t>(groups.size())};
+  std::vector<int> fds;
+  for (const auto& group : groups) {
+    header.push_back(group.size());
+    fds.insert(fds.end(), group.begin(), group.end());
+  }
+  if (fds.size() > kMaxSockets || header.size() > kMaxSockets + 2) {
+    throw std::runtime_error("Too many sockets to take over");
+  }
+
+  iovec iov{header.data(), header.size() * sizeof(uint32_t)};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()));
+  if (!fds.empty()) {
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    auto cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+  }
+  ssize_t ret;
+  do {
+    ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0) {
+    throwErrno("sendmsg");
+  }
+}
+
+SocketTakeover::SocketGroups SocketTakeover::receiveSockets(int fd) {
+  std::vector<uint32_t> header(kMaxSockets + 2);
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxSockets));
+  iovec iov{header.data(), header.size() * sizeof(uint32_t)};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+  ssize_t ret;
+  do {
+    ret = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0) {
+    throwErrno("recvmsg");
+  }
+
+  std::vector<int> fds;
+  for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      auto n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      auto data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+      fds.insert(fds.end(), data, data + n);
+    }
+  }
+
+  size_t words = ret / sizeof(uint32_t);
+  size_t total = 0;
+  bool valid = words >= 2 && header[0] == kVersion &&
+               words == header[1] + 2 && !(msg.msg_flags & MSG_CTRUNC);
+  if (valid) {
+    for (size_t i = 0; i < header[1]; i++) {
+      total += header[i + 2];
+    }
+    valid = total == fds.size();
+  }
+  if (!valid) {
+    for (auto s : fds) {
+      ::close(s);
+    }
+    throw std::runtime_error("Malformed takeover message");
+  }
+
+  SocketGroups groups(header[1]);
+  auto next = fds.begin();
+  for (size_t i = 0; i < groups.size(); i++) {
+    groups[i].assign(next, next + header[i + 2]);
+    next += header[i + 2];
+  }
+  return groups;
+}
+
+folly::Optional<SocketTakeover::Takeover> SocketTakeover::requestSockets(
+    const std::string& path, std::chrono::milliseconds timeout) {
+  auto addr = makeAddress(path);
+  Takeover takeover;
+  takeover.fd = makeSocket();
+  timeval tv{};
+  tv.tv_sec = timeout.count() / 1000;
+  tv.tv_usec = (timeout.count() % 1000) * 1000;
+  setsockopt(takeover.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  if (connect(takeover.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) <
+      0) {
+    auto err = errno;
+    ::close(takeover.fd);
+    if (err == ENOENT || err == ECONNREFUSED) {
+      return folly::none;
+    }
+    errno = err;
+    throwErrno("connect");
+  }
+  try {
+    takeover.sockets = receiveSockets(takeover.fd);
+  } catch (...) {
+    ::close(takeover.fd);
+    throw;
+  }
+  return takeover;
+}
+
+void SocketTakeover::confirm(int fd) {
+  ssize_t ret;
+  do {
+    ret = send(fd, &kConfirm, 1, MSG_NOSIGNAL);
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0) {
+    LOG(ERROR) << "Failed to confirm takeover: " << strerror(errno);
+  }
+  ::close(fd);
+}
+
+int SocketTakeover::listen(const std::string& path) {
+  auto addr = makeAddress(path);
+  // Accepted from an EventBase
+  int fd = makeSocket(SOCK_NONBLOCK);
+  unlink(path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      ::listen(fd, 1) < 0) {
+    auto err = errno;
+    ::close(fd);
+    errno = err;
+    throwErrno("bind");
+  }
+  return fd;
+}
+
+SocketTakeoverServer::SocketTakeoverServer(
+    folly::EventBase* evb,
+    std::string path,
+    std::function<SocketTakeover::SocketGroups()> getSockets,
+    std::function<void()> onTakenOver)
+    : folly::EventHandler(evb),
+      evb_(evb),
+      path_(std::move(path)),
+      getSockets_(std::move(getSockets)),
+      onTakenOver_(std::move(onTakenOver)) {
+}
+
+SocketTakeoverServer::~SocketTakeoverServer() {
+  unregisterHandler();
+  close(connFd_);
+  if (listenFd_ >= 0) {
+    close(listenFd_);
+    unlink(path_.c_str());
+  }
+}
+
+void SocketTakeoverServer::start() {
+  evb_->dcheckIsInEventBaseThread();
+  listenFd_ = SocketTakeover::listen(path_);
+  changeHandlerFD(folly::NetworkSocket::fromFd(listenFd_));
+  registerHandler(READ | PERSIST);
+}
+
+void SocketTakeoverServer::handlerReady(uint16_t /*events*/) noexcept {
+  if (connFd_ >= 0) {
+    onConfirm();
+  } else {
+    onRequest();
+  }
+}
+
+void SocketTakeoverServer::onRequest() {
+  int fd = accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd < 0) {
+    if (errno != EAGAIN && errno != EINTR) {
+      LOG(ERROR) << "Takeover accept failed: " << strerror(errno);
+    }
+    return;
+  }
+  try {
+    SocketTakeover::sendSockets(fd, getSockets_());
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to send sockets: " << ex.what();
+    close(fd);
+    return;
+  }
+  // Wait for the confirmation before anything else
+  connFd_ = fd;
+  unregisterHandler();
+  changeHandlerFD(folly::NetworkSocket::fromFd(connFd_));
+  registerHandler(READ | PERSIST);
+}
+
+void SocketTakeoverServer::onConfirm() {
+  char c = 0;
+  ssize_t ret;
+  do {
+    ret = recv(connFd_, &c, 1, MSG_DONTWAIT);
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0 && errno == EAGAIN) {
+    return;
+  }
+  unregisterHandler();
+  close(connFd_);
+  if (ret != 1 || c != kConfirm) {
+    // The new process went away, so keep serving
+    LOG(WARNING) << "Takeover was not confirmed";
+    changeHandlerFD(folly::NetworkSocket::fromFd(listenFd_));
+    registerHandler(READ | PERSIST);
+    return;
+  }
+  // The new process listens on path_ now, so leave it
+  close(listenFd_);
+  if (onTakenOver_) {
+    onTakenOver_();
+  }
+}
+
+void SocketTakeoverServer::close(int& fd) {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+} // namespace proxygen
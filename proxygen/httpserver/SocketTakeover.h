@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <folly/Optional.h>
+#include <folly/io/async/EventHandler.h>
+
+namespace proxygen {
+
+/**
+ * Hands the listening sockets of a server to the process replacing it,
+ * over a Unix socket, so the new process accepts from the same sockets and
+ * their backlogs while the old one drains: no connection is refused
+ * during a restart.
+ *
+ * The sockets are grouped by the address they listen on, in the order of
+ * HTTPServer::bind. Functions throw std::system_error on socket errors, and
+ * std::runtime_error on malformed messages.
+ */
+class SocketTakeover {
+ public:
+  using SocketGroups = std::vector<std::vector<int>>;
+
+  // The most sockets sent at once
+  static constexpr size_t kMaxSockets = 250;
+
+  /**
+   * Sends the sockets over the connected Unix socket fd. They stay open
+   * in this process.
+   */
+  static void sendSockets(int fd, const SocketGroups& groups);
+
+  /**
+   * Receives sockets sent by sendSockets, owned by the caller.
+   */
+  static SocketGroups receiveSockets(int fd);
+
+  struct Takeover {
+    // The connection to the old process
+    int fd;
+    SocketGroups sockets;
+  };
+
+  /**
+   * Connects to the process listening on path and receives its sockets,
+   * or none if no process listens there. Once serving from them, confirm
+   * the takeover: until then the old process keeps accepting, and goes on
+   * if this process exits first.
+   */
+  static folly::Optional<Takeover> requestSockets(
+      const std::string& path, std::chrono::milliseconds timeout);
+
+  // Tells the old process to stop accepting, and closes fd
+  static void confirm(int fd);
+
+  /**
+   * A non blocking Unix socket bound to path and listening. An earlier
+   * socket file at path is removed first.
+   */
+  static int listen(const std::string& path);
+};
+
+/**
+ * Sends the sockets of this process to the first process requesting them,
+ * then calls onTakenOver from its EventBase once that process confirms,
+ * and stops listening. getSockets is called for every request.
+ */
+class SocketTakeoverServer : private folly::EventHandler {
+ public:
+  SocketTakeoverServer(folly::EventBase* evb,
+                       std::string path,
+                       std::function<SocketTakeover::SocketGroups()> getSockets,
+                       std::function<void()> onTakenOver);
+  ~SocketTakeoverServer() override;
+
+  // Throws std::system_error if path can't be listened on
+  void start();
+
+ private:
+  void handlerReady(uint16_t events) noexcept override;
+  void onRequest();
+  void onConfirm();
+  void close(int& fd);
+
+  folly::EventBase* evb_;
+  std::string path_;
+  std::function<SocketTakeover::SocketGroups()> getSockets_;
+  std::function<void()> onTakenOver_;
+  int listenFd_{-1};
+  // The connection of the new process, until it confirms
+  int connFd_{-1};
+};
+
+} // namespace proxygen
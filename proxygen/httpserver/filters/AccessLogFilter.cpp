@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/filters/AccessLogFilter.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+
+#include <folly/Conv.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <glog/logging.h>
+
+namespace {
+
+template <size_t N, typename Length>
+Length copyTruncated(folly::StringPiece value, std::array<char, N>& out) {
+  auto length = std::min(value.size(), N);
+  memcpy(out.data(), value.data(), length);
+  return static_cast<Length>(length);
+}
+
+} // namespace
+
+namespace proxygen {
+
+void AccessLogRecord::setMethod(folly::StringPiece value) {
+  methodLength = copyTruncated<kMaxMethod, uint8_t>(value, method);
+}
+
+void AccessLogRecord::setURL(folly::StringPiece value) {
+  urlLength = copyTruncated<kMaxURL, uint16_t>(value, url);
+}
+
+AccessLogWriter::Producer::~Producer() {
+  ring_->closed.store(true, std::memory_order_release);
+}
+
+void AccessLogWriter::Producer::push(AccessLogRecord&& record) {
+  if (ring_->queue.write(std::move(record))) {
+    return;
+  }
+  if (dropPolicy_ == DropPolicy::DROP) {
+    ring_->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  while (!ring_->queue.write(std::move(record))) {
+    std::this_thread::yield();
+  }
+}
+
+AccessLogWriter::AccessLogWriter(Sink sink)
+    : AccessLogWriter(std::move(sink), Options()) {
+}
+
+AccessLogWriter::AccessLogWriter(Sink sink,
+                                 Options options,
+                                 Formatter formatter)
+    : sink_(std::move(sink)),
+      options_(options),
+      formatter_(formatter ? std::move(formatter) : &formatRecord) {
+  CHECK(sink_);
+  CHECK_GT(options_.queueSize, 0);
+  thread_ = std::thread([this] { run(); });
+}
+
+AccessLogWriter::~AccessLogWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+std::unique_ptr<AccessLogWriter::Producer> AccessLogWriter::makeProducer() {
+  auto ring = std::make_shared<Ring>(options_.queueSize);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings_.push_back(ring);
+  }
+  return std::unique_ptr<Producer>(
+      new Producer(std::move(ring), options_.dropPolicy));
+}
+
+uint64_t AccessLogWriter::getDropped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto dropped = retiredDropped_;
+  for (const auto& ring : rings_) {
+    dropped += ring->dropped.load(std::memory_order_relaxed);
+  }
+  return dropped;
+}
+
+void AccessLogWriter::run() {
+  std::vector<std::shared_ptr<Ring>> rings;
+  bool stopping = false;
+  while (!stopping) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait_for(lock, options_.flushInterval, [this] { return stop_; });
+      stopping = stop_;
+      rings = rings_;
+    }
+    // Closed before draining, so a ring with nothing left can go
+    std::vector<bool> closed;
+    for (const auto& ring : rings) {
+      closed.push_back(ring->closed.load(std::memory_order_acquire));
+    }
+    drain(rings);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < rings.size(); i++) {
+      if (closed[i]) {
+        retiredDropped_ += rings[i]->dropped.load(std::memory_order_relaxed);
+        rings_.erase(std::find(rings_.begin(), rings_.end(), rings[i]));
+      }
+    }
+  }
+}
+
+void AccessLogWriter::drain(const std::vector<std::shared_ptr<Ring>>& rings) {
+  for (const auto& ring : rings) {
+    AccessLogRecord* record;
+    while ((record = ring->queue.frontPtr()) != nullptr) {
+      formatter_(*record, buffer_);
+      ring->queue.popFront();
+    }
+  }
+  if (!buffer_.empty()) {
+    sink_(buffer_);
+    buffer_.clear();
+  }
+}
+
+void AccessLogWriter::formatRecord(const AccessLogRecord& record,
+                                   std::string& out) {
+  char time[32];
+  auto t = SystemClock::to_time_t(record.time);
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  strftime(time, sizeof(time), "%d/%b/%Y:%H:%M:%S +0000", &tm);
+
+  out += record.client.isInitialized() ? record.client.getAddressStr() : "-";
+  folly::toAppend(" - - [",
+                  time,
+                  "] \"",
+                  record.getMethod(),
+                  " ",
+                  record.getURL(),
+                  "\" ",
+                  record.status,
+                  " ",
+                  record.bytesOut,
+                  " ",
+                  record.latency.count(),
+                  &out);
+  if (record.error != kErrorNone) {
+    folly::toAppend(" ", getErrorString(record.error), &out);
+  }
+  out += '\n';
+}
+
+AccessLogWriter::Sink AccessLogWriter::makeFileSink(const std::string& path) {
+  auto file = std::make_shared<folly::File>(
+      path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  return [file](folly::StringPiece data) {
+    if (folly::writeFull(file->fd(), data.data(), data.size()) < 0) {
+      PLOG(ERROR) << "Failed to write the access log";
+    }
+  };
+}
+
+void AccessLogFilter::onRequest(std::unique_ptr<HTTPMessage> msg) noexcept {
+  start_ = getCurrentTime();
+  record_.time = SystemClock::now();
+  record_.client = msg->getClientAddress();
+  record_.setMethod(msg->getMethodString());
+  record_.setURL(msg->getURL());
+  Filter::onRequest(std::move(msg));
+}
+
+void AccessLogFilter::log() {
+  if (!producer_) {
+    return;
+  }
+  if (timePointInitialized(start_)) {
+    record_.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        getCurrentTime() - start_);
+  }
+  producer_->push(std::move(record_));
+}
+
+} // namespace proxygen
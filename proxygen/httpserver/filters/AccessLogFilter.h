@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/ProducerConsumerQueue.h>
+#include <folly/Range.h>
+#include <folly/SocketAddress.h>
+#include <folly/ThreadLocal.h>
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/lib/sampling/Sampling.h>
+#include <proxygen/lib/utils/PooledObject.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * The raw fields of an access log line, copied as is from the request so it
+ * is cheap to capture: formatting happens on the AccessLogWriter thread.
+ * The method and URL are truncated to fit.
+ */
+struct AccessLogRecord {
+  static constexpr size_t kMaxMethod = 16;
+  static constexpr size_t kMaxURL = 256;
+
+  SystemTimePoint time;
+  std::chrono::microseconds latency{0};
+  folly::SocketAddress client;
+  std::array<char, kMaxMethod> method;
+  uint8_t methodLength{0};
+  std::array<char, kMaxURL> url;
+  uint16_t urlLength{0};
+  uint16_t status{0};
+  uint64_t bytesIn{0};
+  uint64_t bytesOut{0};
+  // Set when the request failed instead of completing
+  ProxygenError error{kErrorNone};
+
+  void setMethod(folly::StringPiece value);
+  void setURL(folly::StringPiece value);
+
+  folly::StringPiece getMethod() const {
+    return folly::StringPiece(method.data(), methodLength);
+  }
+
+  folly::StringPiece getURL() const {
+    return folly::StringPiece(url.data(), urlLength);
+  }
+};
+
+/**
+ * Formats and writes access log records on a background thread. Each
+ * producing thread gets its own Producer, a single producer single consumer
+ * ring, so logging a request takes no lock. The thread writes what the
+ * rings hold every flushInterval, and everything left once destroyed.
+ */
+class AccessLogWriter {
+ public:
+  // What a Producer does with a record when its ring is full
+  enum class DropPolicy {
+    // Drops the record, counted in getDropped()
+    DROP,
+    // Waits for the writer thread to make room, stalling the producer
+    BLOCK,
+  };
+
+  struct Options {
+    // Records a ring holds
+    size_t queueSize{4096};
+    DropPolicy dropPolicy{DropPolicy::DROP};
+    std::chrono::milliseconds flushInterval{100};
+  };
+
+  // Appends the line of a record to out
+  using Formatter = std::function<void(const AccessLogRecord&, std::string&)>;
+  // Writes formatted lines, from the writer thread
+  using Sink = std::function<void(folly::StringPiece)>;
+
+ private:
+  struct Ring {
+    explicit Ring(size_t size) : queue(size + 1) {
+    }
+
+    folly::ProducerConsumerQueue<AccessLogRecord> queue;
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<bool> closed{false};
+  };
+
+ public:
+  // Pushes records from a single thread
+  class Producer {
+   public:
+    ~Producer();
+
+    void push(AccessLogRecord&& record);
+
+   private:
+    friend class AccessLogWriter;
+    Producer(std::shared_ptr<Ring> ring, DropPolicy dropPolicy)
+        : ring_(std::move(ring)), dropPolicy_(dropPolicy) {
+    }
+
+    std::shared_ptr<Ring> ring_;
+    DropPolicy dropPolicy_;
+  };
+
+  explicit AccessLogWriter(Sink sink);
+  AccessLogWriter(Sink sink, Options options, Formatter formatter = nullptr);
+  ~AccessLogWriter();
+
+  std::unique_ptr<Producer> makeProducer();
+
+  // Records dropped so far by every producer
+  uint64_t getDropped() const;
+
+  /**
+   * The default format, close to the common log format:
+   * client - - [time] "method url" status bytesOut latencyUs
+   */
+  static void formatRecord(const AccessLogRecord& record, std::string& out);
+
+  // Appends to the file at path, throws std::system_error if it can't open
+  static Sink makeFileSink(const std::string& path);
+
+ private:
+  void run();
+  void drain(const std::vector<std::shared_ptr<Ring>>& rings);
+
+  Sink sink_;
+  Options options_;
+  Formatter formatter_;
+  std::string buffer_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+  uint64_t retiredDropped_{0};
+  bool stop_{false};
+  std::thread thread_;
+};
+
+/**
+ * Captures an access log record of the request, pushed to the writer once
+ * the request completes or fails.
+ */
+class AccessLogFilter
+    : public Filter
+    , public PooledObject<AccessLogFilter> {
+ public:
+  AccessLogFilter(RequestHandler* upstream, AccessLogWriter::Producer* producer)
+      : Filter(upstream), producer_(producer) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> msg) noexcept override;
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    record_.bytesIn += body->computeChainDataLength();
+    Filter::onBody(std::move(body));
+  }
+
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    if (msg.isFinal()) {
+      record_.status = msg.getStatusCode();
+    }
+    Filter::sendHeaders(msg);
+  }
+
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    record_.bytesOut += body->computeChainDataLength();
+    Filter::sendBody(std::move(body));
+  }
+
+  void requestComplete() noexcept override {
+    log();
+    Filter::requestComplete();
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    record_.error = err;
+    log();
+    Filter::onError(err);
+  }
+
+ private:
+  void log();
+
+  AccessLogWriter::Producer* producer_;
+  AccessLogRecord record_;
+  TimePoint start_;
+};
+
+/**
+ * Logs a sample of the requests, at sampleRate, through the writer shared
+ * by every thread.
+ */
+class AccessLogFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit AccessLogFilterFactory(std::shared_ptr<AccessLogWriter> writer,
+                                  double sampleRate = 1.0)
+      : writer_(std::move(writer)), sampling_(sampleRate) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+    producer_.reset(writer_->makeProducer().release());
+  }
+
+  void onServerStop() noexcept override {
+    producer_.reset();
+  }
+
+  RequestHandler* onRequest(RequestHandler* upstream,
+                            HTTPMessage* /*msg*/) noexcept override {
+    if (!sampling_.isLucky()) {
+      return upstream;
+    }
+    return new AccessLogFilter(upstream, producer_.get());
+  }
+
+ private:
+  std::shared_ptr<AccessLogWriter> writer_;
+  Sampling sampling_;
+  folly::ThreadLocalPtr<AccessLogWriter::Producer> producer_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <folly/ThreadLocal.h>
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/DirectResponseHandler.h>
+#include <proxygen/lib/http/session/CannedResponse.h>
+#include <proxygen/lib/utils/PooledObject.h>
+
+namespace proxygen {
+
+/**
+ * An adaptive limit on the requests in flight (AIMD): it grows by one for
+ * every request completing in time while the limit is in use, and shrinks
+ * by backoffRatio for every request failing or completing later than
+ * latencyThreshold. Not thread safe: each thread has its own.
+ */
+class ConcurrencyLimiter {
+ public:
+  struct Config {
+    size_t initialLimit{20};
+    size_t minLimit{1};
+    size_t maxLimit{1000};
+    double backoffRatio{0.9};
+    std::chrono::microseconds latencyThreshold{std::chrono::seconds(5)};
+  };
+
+  explicit ConcurrencyLimiter(const Config& config)
+      : config_(config),
+        limit_(std::clamp(
+            config.initialLimit, config.minLimit, config.maxLimit)) {
+  }
+
+  // Takes a slot, false when all are in use
+  bool tryAcquire() {
+    if (inflight_ >= limit_) {
+      return false;
+    }
+    inflight_++;
+    return true;
+  }
+
+  // Gives back a slot, adjusting the limit from how the request went
+  void release(std::chrono::microseconds latency, bool failed) {
+    DCHECK_GT(inflight_, 0);
+    bool limited = inflight_ * 2 >= limit_;
+    inflight_--;
+    if (failed || latency > config_.latencyThreshold) {
+      limit_ = std::max(config_.minLimit,
+                        static_cast<size_t>(limit_ * config_.backoffRatio));
+    } else if (limited) {
+      limit_ = std::min(config_.maxLimit, limit_ + 1);
+    }
+  }
+
+  size_t getLimit() const {
+    return limit_;
+  }
+
+  size_t getInflight() const {
+    return inflight_;
+  }
+
+ private:
+  Config config_;
+  size_t limit_;
+  size_t inflight_{0};
+};
+
+/**
+ * Holds a slot of a ConcurrencyLimiter for a request, giving it back with
+ * the latency of the request once complete.
+ */
+class AdmissionControlFilter
+    : public Filter
+    , public PooledObject<AdmissionControlFilter> {
+ public:
+  class StatsCallback {
+   public:
+    virtual ~StatsCallback() = default;
+    virtual void onAdmitted(size_t priorityClass,
+                            const ConcurrencyLimiter& limiter) noexcept = 0;
+    virtual void onShed(size_t priorityClass,
+                        const ConcurrencyLimiter& limiter) noexcept = 0;
+    virtual void onCompleted(size_t priorityClass,
+                             std::chrono::microseconds latency,
+                             bool failed) noexcept = 0;
+  };
+
+  AdmissionControlFilter(RequestHandler* upstream,
+                         ConcurrencyLimiter* limiter,
+                         size_t priorityClass,
+                         StatsCallback* stats)
+      : Filter(upstream),
+        limiter_(limiter),
+        priorityClass_(priorityClass),
+        stats_(stats),
+        start_(std::chrono::steady_clock::now()) {
+  }
+
+  void requestComplete() noexcept override {
+    release(false);
+    Filter::requestComplete();
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    release(true);
+    Filter::onError(err);
+  }
+
+ private:
+  void release(bool failed) {
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_);
+    limiter_->release(latency, failed);
+    if (stats_) {
+      stats_->onCompleted(priorityClass_, latency, failed);
+    }
+  }
+
+  ConcurrencyLimiter* limiter_;
+  size_t priorityClass_;
+  StatsCallback* stats_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Sheds requests with a 503 before their handler is built, once a thread
+ * has as many requests in flight as the adaptive limit of their priority
+ * class. It wraps the factory building the handlers, so it must be the
+ * last factory of the chain. The classifier, none for a single class,
+ * maps a request to the index of its class in classes, from its route or
+ * client for example.
+ */
+class AdmissionControlFilterFactory : public RequestHandlerFactory {
+ public:
+  using Classifier = std::function<size_t(const HTTPMessage&)>;
+
+  AdmissionControlFilterFactory(
+      std::unique_ptr<RequestHandlerFactory> handlerFactory,
+      std::vector<ConcurrencyLimiter::Config> classes,
+      Classifier classifier = nullptr,
+      std::shared_ptr<AdmissionControlFilter::StatsCallback> stats = nullptr)
+      : handlerFactory_(std::move(handlerFactory)),
+        classes_(std::move(classes)),
+        classifier_(std::move(classifier)),
+        stats_(std::move(stats)),
+        serviceUnavailable_(std::make_shared<const CannedResponse>(503)) {
+    CHECK(!classes_.empty());
+  }
+
+  void onServerStart(folly::EventBase* evb) noexcept override {
+    auto limiters = new std::vector<ConcurrencyLimiter>();
+    for (const auto& config : classes_) {
+      limiters->emplace_back(config);
+    }
+    limiters_.reset(limiters);
+    handlerFactory_->onServerStart(evb);
+  }
+
+  void onServerStop() noexcept override {
+    handlerFactory_->onServerStop();
+    limiters_.reset();
+  }
+
+  RequestHandler* onRequest(RequestHandler* upstream,
+                            HTTPMessage* msg) noexcept override {
+    DCHECK(!upstream) << "AdmissionControlFilterFactory must be the last "
+                         "factory";
+    size_t priorityClass = classifier_ ? classifier_(*msg) : 0;
+    DCHECK_LT(priorityClass, classes_.size());
+    priorityClass = std::min(priorityClass, classes_.size() - 1);
+
+    auto& limiter = (*limiters_)[priorityClass];
+    if (!limiter.tryAcquire()) {
+      if (stats_) {
+        stats_->onShed(priorityClass, limiter);
+      }
+      return new DirectResponseHandler(serviceUnavailable_);
+    }
+    if (stats_) {
+      stats_->onAdmitted(priorityClass, limiter);
+    }
+    return new AdmissionControlFilter(handlerFactory_->onRequest(nullptr, msg),
+                                      &limiter,
+                                      priorityClass,
+                                      stats_.get());
+  }
+
+  // The limiter of the calling thread for a class
+  const ConcurrencyLimiter& getLimiter(size_t priorityClass) const {
+    return (*limiters_)[priorityClass];
+  }
+
+ private:
+  std::unique_ptr<RequestHandlerFactory> handlerFactory_;
+  std::vector<ConcurrencyLimiter::Config> classes_;
+  Classifier classifier_;
+  std::shared_ptr<AdmissionControlFilter::StatsCallback> stats_;
+  std::shared_ptr<const CannedResponse> serviceUnavailable_;
+  folly::ThreadLocalPtr<std::vector<ConcurrencyLimiter>> limiters_;
+};
+
+} // namespace proxygen
@@ -11,24 +11,39 @@
 #include <proxygen/httpserver/Filters.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 #include <proxygen/lib/utils/CompressionFilterUtils.h>
+#include <proxygen/lib/utils/PooledObject.h>
 
 namespace proxygen {
 
 /**
  * A Server filter to perform compression. If there are any errors it will
  * fall back to sending uncompressed responses.
+ *
+ * With a responseCache in the params, the compressed bodies of non chunked
+ * responses are cached by their resource (scheme, authority and URL) and
+ * strong ETag, or else by digest.
  */
-class CompressionFilter : public Filter {
+class CompressionFilter
+    : public Filter
+    , public PooledObject<CompressionFilter> {
  public:
   CompressionFilter(RequestHandler* downstream,
-                    CompressionFilterUtils::FilterParams params)
-      : Filter(downstream), params_(std::move(params)) {
+                    CompressionFilterUtils::FilterParams params,
+                    std::string resourceKey = std::string())
+      : Filter(downstream),
+        params_(std::move(params)),
+        resourceKey_(std::move(resourceKey)) {
   }
 
   virtual ~CompressionFilter() override {
   }
 
   void sendHeaders(HTTPMessage& msg) noexcept override {
+    if (!msg.isFinal()) {
+      // e.g. 103 Early Hints, ahead of the response compressed
+      Filter::sendHeaders(msg);
+      return;
+    }
     DCHECK(compressor_ == nullptr);
     DCHECK(header_ == false);
 
@@ -39,6 +54,14 @@ class CompressionFilter : public Filter {
     if (compress_) {
       auto& headers = msg.getHeaders();
       headers.set(HTTP_HEADER_CONTENT_ENCODING, params_.headerEncoding);
+      if (params_.dictionary) {
+        headers.add(HTTP_HEADER_VARY,
+                    CompressionFilterUtils::kAvailableDictionary);
+      }
+      if (params_.adaptiveLevel) {
+        params_.adaptiveLevel->recordResponse(params_.headerEncoding,
+                                              params_.compressionLevel);
+      }
     }
 
     // Initialize compressor
@@ -82,10 +105,24 @@ class CompressionFilter : public Filter {
 
     CHECK(compressor_ && !compressor_->hasError());
 
-    // If it's chunked, never write the trailer, it will be written on EOM
-    auto compressed = compressor_->compress(body.get(), !chunked_);
-    if (compressor_->hasError()) {
-      return fail();
+    std::string cacheKey;
+    std::unique_ptr<folly::IOBuf> compressed;
+    if (!chunked_ && params_.responseCache && body) {
+      cacheKey = getCacheKey(*body);
+      if (!cacheKey.empty()) {
+        compressed = params_.responseCache->get(cacheKey);
+      }
+    }
+
+    if (!compressed) {
+      // If it's chunked, never write the trailer, it will be written on EOM
+      compressed = compressor_->compress(body.get(), !chunked_);
+      if (compressor_->hasError()) {
+        return fail();
+      }
+      if (!cacheKey.empty()) {
+        params_.responseCache->put(cacheKey, *compressed);
+      }
     }
 
     auto compressedBodyLength = compressed->computeChainDataLength();
@@ -134,9 +171,36 @@ class CompressionFilter : public Filter {
     Filter::sendAbort();
   }
 
+  // Empty if the body shouldn't be cached
+  std::string getCacheKey(const folly::IOBuf& body) const {
+    const auto& cache = params_.responseCache;
+    if (body.computeChainDataLength() > cache->getOptions().maxBodyBytes) {
+      return std::string();
+    }
+    // Bodies compressed with different dictionaries differ
+    auto encoding = params_.dictionary
+                        ? folly::to<std::string>(
+                              params_.headerEncoding,
+                              params_.dictionary->getHashHeaderValue())
+                        : params_.headerEncoding;
+    const auto& etag =
+        responseMessage_->getHeaders().getSingleOrEmpty(HTTP_HEADER_ETAG);
+    // Weak ETags don't promise identical bodies
+    if (!etag.empty() && !resourceKey_.empty() &&
+        !folly::StringPiece(etag).startsWith("W/")) {
+      return CompressedResponseCache::makeKey(
+          folly::to<std::string>(resourceKey_, " ", etag),
+          encoding,
+          params_.compressionLevel);
+    }
+    return CompressedResponseCache::makeDigestKey(
+        body, encoding, params_.compressionLevel);
+  }
+
   std::unique_ptr<HTTPMessage> responseMessage_;
   std::unique_ptr<StreamCompressor> compressor_{nullptr};
   CompressionFilterUtils::FilterParams params_;
+  const std::string resourceKey_;
   bool header_{false};
   bool chunked_{false};
   bool compress_{false};
@@ -164,10 +228,19 @@ class CompressionFilterFactory : public RequestHandlerFactory {
     if (!filterParams) {
       return h;
     }
-    return new CompressionFilter(h, std::move(*filterParams));
+    return new CompressionFilter(
+        h, std::move(*filterParams), getResourceKey(*msg));
   }
 
  private:
+  // ETags are only unique per resource, and virtual hosts share paths
+  static std::string getResourceKey(const HTTPMessage& msg) {
+    return folly::to<std::string>(
+        msg.isSecure() ? "https://" : "http://",
+        msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST),
+        msg.getURL());
+  }
+
   const Options options_;
 };
 } // namespace proxygen
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/io/async/DestructorCheck.h>
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/lib/http/BodyDecompressor.h>
+#include <proxygen/lib/utils/PooledObject.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter decoding request bodies sent with a Content-Encoding, so
+ * that handlers of uploads get them decoded.
+ *
+ * The body is decoded a bounded step at a time, and what is left is held
+ * while the handler has paused ingress, as is the EOM. A body that is not
+ * valid, or decodes to more than the limits, aborts the request.
+ */
+class DecompressionFilter
+    : public Filter
+    , public folly::DestructorCheck
+    , public PooledObject<DecompressionFilter> {
+ public:
+  DecompressionFilter(RequestHandler* upstream,
+                      BodyDecompressor::Options options)
+      : Filter(upstream), options_(options) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override {
+    decompressor_ = BodyDecompressor::fromMessage(*headers, options_);
+    upstream_->onRequest(std::move(headers));
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (failed_) {
+      return;
+    }
+    if (!decompressor_) {
+      upstream_->onBody(std::move(body));
+      return;
+    }
+    decompressor_->append(std::move(body));
+    drain();
+  }
+
+  void onEOM() noexcept override {
+    if (failed_) {
+      return;
+    }
+    if (!decompressor_) {
+      upstream_->onEOM();
+      return;
+    }
+    eomPending_ = true;
+    drain();
+  }
+
+  void pauseIngress() noexcept override {
+    paused_ = true;
+    downstream_->pauseIngress();
+  }
+
+  void resumeIngress() noexcept override {
+    paused_ = false;
+    if (decompressor_ && !failed_) {
+      folly::DestructorCheck::Safety safety(*this);
+      drain();
+      // Only once the buffered body is passed on, or the buffer would grow
+      if (safety.destroyed() || paused_ || !downstream_) {
+        return;
+      }
+    }
+    downstream_->resumeIngress();
+  }
+
+ private:
+  void drain() {
+    folly::DestructorCheck::Safety safety(*this);
+    while (!paused_ && decompressor_->hasInput()) {
+      auto out = decompressor_->step();
+      if (decompressor_->getError() != BodyDecompressor::Error::NONE) {
+        fail();
+        return;
+      }
+      if (out && !out->empty()) {
+        upstream_->onBody(std::move(out));
+        // The handler may have ended the request
+        if (safety.destroyed() || !downstream_) {
+          return;
+        }
+      }
+    }
+    if (paused_ || !eomPending_ || decompressor_->hasInput()) {
+      return;
+    }
+    if (!decompressor_->finish()) {
+      fail();
+      return;
+    }
+    eomPending_ = false;
+    upstream_->onEOM();
+  }
+
+  void fail() {
+    VLOG(4) << "Aborting the request, "
+            << BodyDecompressor::getErrorString(decompressor_->getError())
+            << ", compressed=" << decompressor_->getCompressedBytes()
+            << " decompressed=" << decompressor_->getDecompressedBytes();
+    failed_ = true;
+    eomPending_ = false;
+    // May delete this
+    downstream_->sendAbort();
+  }
+
+  const BodyDecompressor::Options options_;
+  std::unique_ptr<BodyDecompressor> decompressor_;
+  bool paused_{false};
+  bool eomPending_{false};
+  bool failed_{false};
+};
+
+class DecompressionFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit DecompressionFilterFactory(BodyDecompressor::Options options)
+      : options_(options) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    if (!BodyDecompressor::isSupported(*msg, options_)) {
+      return h;
+    }
+    return new DecompressionFilter(h, options_);
+  }
+
+ private:
+  const BodyDecompressor::Options options_;
+};
+
+} // namespace proxygen
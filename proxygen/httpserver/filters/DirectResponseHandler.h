@@ -10,6 +10,7 @@
 
 #include <proxygen/httpserver/RequestHandler.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/http/session/CannedResponse.h>
 
 namespace proxygen {
 
@@ -24,7 +25,23 @@ class DirectResponseHandler : public RequestHandler {
         body_(folly::IOBuf::copyBuffer(body)) {
   }
 
+  // Sends a response built once for many requests
+  explicit DirectResponseHandler(
+      std::shared_ptr<const CannedResponse> response)
+      : code_(response->getMessage().getStatusCode()),
+        cannedResponse_(std::move(response)) {
+  }
+
   void onRequest(std::unique_ptr<HTTPMessage> /*headers*/) noexcept override {
+    if (cannedResponse_) {
+      // Copied, as filters may change the headers they are sent
+      HTTPMessage response(cannedResponse_->getMessage());
+      downstream_->sendHeaders(response);
+      if (auto body = cannedResponse_->cloneBody()) {
+        downstream_->sendBody(std::move(body));
+      }
+      return;
+    }
     ResponseBuilder(downstream_)
         .status(code_, std::move(message_))
         .body(std::move(body_))
@@ -53,6 +70,7 @@ class DirectResponseHandler : public RequestHandler {
   const int code_;
   std::string message_;
   std::unique_ptr<folly::IOBuf> body_;
+  std::shared_ptr<const CannedResponse> cannedResponse_;
 };
 
 } // namespace proxygen
@@ -0,0 +1,739 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/filters/HTTPCache.h>
+
+#include <fcntl.h>
+#include <limits>
+#include <map>
+
+#include <folly/Conv.h>
+#include <folly/File.h>
+#include <folly/String.h>
+#include <folly/hash/Checksum.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/system/MemoryMapping.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/HTTPTime.h>
+
+using std::chrono::seconds;
+
+namespace {
+
+// Per key, a resource varying on many headers would crowd the shard out
+const size_t kMaxVariants = 8;
+// Per entry, for what isn't counted
+const size_t kEntryOverhead = 256;
+
+bool isCacheableStatus(uint16_t status) {
+  switch (status) {
+    case 200:
+    case 203:
+    case 204:
+    case 300:
+    case 301:
+    case 308:
+    case 404:
+    case 405:
+    case 410:
+    case 414:
+    case 501:
+      return true;
+    default:
+      return false;
+  }
+}
+
+folly::Optional<seconds> parseSeconds(folly::StringPiece value) {
+  auto parsed = folly::tryTo<int64_t>(value);
+  if (!parsed || *parsed < 0) {
+    return folly::none;
+  }
+  return seconds(*parsed);
+}
+
+folly::Optional<int64_t> parseDate(const proxygen::HTTPHeaders& headers,
+                                   proxygen::HTTPHeaderCode code) {
+  const auto& value = headers.getSingleOrEmpty(code);
+  if (value.empty()) {
+    return folly::none;
+  }
+  return proxygen::parseHTTPDateTime(value);
+}
+
+} // namespace
+
+namespace proxygen {
+
+CacheControl CacheControl::parse(const HTTPHeaders& headers) {
+  CacheControl cc;
+  std::vector<folly::StringPiece> directives;
+  auto combined = headers.combine(HTTP_HEADER_CACHE_CONTROL, ",");
+  folly::split(',', combined, directives);
+  for (auto directive : directives) {
+    directive = folly::trimWhitespace(directive);
+    folly::StringPiece name = directive;
+    folly::StringPiece value;
+    auto eq = directive.find('=');
+    if (eq != folly::StringPiece::npos) {
+      name = folly::trimWhitespace(directive.subpiece(0, eq));
+      value = folly::trimWhitespace(directive.subpiece(eq + 1));
+      value.removePrefix('"');
+      value.removeSuffix('"');
+    }
+    if (name.equals("no-store", folly::AsciiCaseInsensitive())) {
+      cc.noStore = true;
+    } else if (name.equals("no-cache", folly::AsciiCaseInsensitive())) {
+      cc.noCache = true;
+    } else if (name.equals("private", folly::AsciiCaseInsensitive())) {
+      cc.isPrivate = true;
+    } else if (name.equals("must-revalidate", folly::AsciiCaseInsensitive()) ||
+               name.equals("proxy-revalidate", folly::AsciiCaseInsensitive())) {
+      cc.mustRevalidate = true;
+    } else if (name.equals("max-age", folly::AsciiCaseInsensitive())) {
+      cc.maxAge = parseSeconds(value);
+    } else if (name.equals("s-maxage", folly::AsciiCaseInsensitive())) {
+      cc.sMaxAge = parseSeconds(value);
+    } else if (name.equals("stale-while-revalidate",
+                           folly::AsciiCaseInsensitive())) {
+      cc.staleWhileRevalidate = parseSeconds(value);
+    }
+  }
+  return cc;
+}
+
+seconds HTTPCache::Entry::getAge(TimePoint now) const {
+  return initialAge +
+         std::chrono::duration_cast<seconds>(
+             std::max(now - responseTime, TimePoint::duration::zero()));
+}
+
+bool HTTPCache::Entry::hasValidator() const {
+  const auto& headers = response.getHeaders();
+  return headers.exists(HTTP_HEADER_ETAG) ||
+         headers.exists(HTTP_HEADER_LAST_MODIFIED);
+}
+
+size_t HTTPCache::Entry::getSize() const {
+  size_t size = kEntryOverhead + (body ? body->computeChainDataLength() : 0);
+  response.getHeaders().forEach(
+      [&size](const std::string& name, const std::string& value) {
+        size += name.size() + value.size();
+      });
+  return size;
+}
+
+/**
+ * A ring of serialized entries in a file mapped to memory.  Writes go after
+ * the last one and wrap around, overwriting the oldest entries, which are
+ * dropped from the index.  Every record has a checksum, and an entry is
+ * moved out of the ring when it is read.
+ */
+class HTTPCache::DiskTier {
+ public:
+  DiskTier(const std::string& path, size_t capacity)
+      : mapping_(folly::File(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600),
+                 0,
+                 capacity,
+                 folly::MemoryMapping::writable()),
+        capacity_(capacity) {
+  }
+
+  void put(const std::string& key, const Variants& variants, TimePoint now) {
+    folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+    folly::io::QueueAppender appender(&queue, 4096);
+    appender.writeBE<uint32_t>(variants.size());
+    for (const auto& entry : variants) {
+      writeEntry(appender, *entry, now);
+    }
+    auto payload = queue.move();
+    payload->coalesce();
+    const size_t size = kHeaderSize + key.size() + payload->length();
+    if (size > capacity_) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (writePos_ + size > capacity_) {
+      writePos_ = 0;
+    }
+    dropOverlapping(writePos_, size);
+    erase(key);
+    auto out = mapping_.writableRange().data() + writePos_;
+    writeUint32(out, key.size());
+    writeUint32(out + 4, payload->length());
+    writeUint32(out + 8, folly::crc32c(payload->data(), payload->length()));
+    memcpy(out + kHeaderSize, key.data(), key.size());
+    memcpy(out + kHeaderSize + key.size(), payload->data(), payload->length());
+    index_[key] = Location{writePos_, size};
+    byOffset_[writePos_] = key;
+    writePos_ += size;
+  }
+
+  // The variants of key, moved out of the ring
+  Variants take(const std::string& key, TimePoint now) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return {};
+    }
+    auto location = it->second;
+    erase(key);
+
+    auto record = mapping_.range().subpiece(location.offset, location.length);
+    size_t keyLen = readUint32(record.data());
+    size_t payloadLen = readUint32(record.data() + 4);
+    if (kHeaderSize + keyLen + payloadLen != record.size() ||
+        folly::StringPiece(record.subpiece(kHeaderSize, keyLen)) != key) {
+      LOG(ERROR) << "Corrupted HTTP cache record for " << key;
+      return {};
+    }
+    auto payload = record.subpiece(kHeaderSize + keyLen);
+    if (readUint32(record.data() + 8) !=
+        folly::crc32c(payload.data(), payload.size())) {
+      LOG(ERROR) << "Bad checksum of the HTTP cache record for " << key;
+      return {};
+    }
+    Variants variants;
+    try {
+      auto buf = folly::IOBuf::wrapBufferAsValue(payload);
+      folly::io::Cursor cursor(&buf);
+      auto count = cursor.readBE<uint32_t>();
+      for (uint32_t i = 0; i < count; i++) {
+        variants.push_back(readEntry(cursor, now));
+      }
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Failed to read the HTTP cache record for " << key << ": "
+                 << ex.what();
+      return {};
+    }
+    return variants;
+  }
+
+ private:
+  struct Location {
+    size_t offset;
+    size_t length;
+  };
+
+  // Key and payload lengths, checksum of the payload
+  static constexpr size_t kHeaderSize = 12;
+
+  static void writeUint32(uint8_t* out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+  }
+
+  static uint32_t readUint32(const uint8_t* in) {
+    return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) |
+           (uint32_t(in[2]) << 8) | uint32_t(in[3]);
+  }
+
+  static void writeString(folly::io::QueueAppender& appender,
+                          folly::StringPiece s) {
+    appender.writeBE<uint32_t>(s.size());
+    appender.push(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+  }
+
+  static std::string readString(folly::io::Cursor& cursor) {
+    return cursor.readFixedString(cursor.readBE<uint32_t>());
+  }
+
+  static void writeEntry(folly::io::QueueAppender& appender,
+                         const Entry& entry,
+                         TimePoint now) {
+    // Ages rather than times, which the next process may not share
+    appender.writeBE<uint64_t>(entry.getAge(now).count());
+    appender.writeBE<uint64_t>(entry.freshness.count());
+    appender.writeBE<uint64_t>(entry.staleWhileRevalidate.count());
+    appender.writeBE<uint16_t>(entry.response.getStatusCode());
+    writeString(appender, entry.response.getStatusMessage());
+    std::vector<std::pair<std::string, std::string>> headers;
+    entry.response.getHeaders().forEach(
+        [&headers](const std::string& name, const std::string& value) {
+          headers.emplace_back(name, value);
+        });
+    appender.writeBE<uint32_t>(headers.size());
+    for (const auto& header : headers) {
+      writeString(appender, header.first);
+      writeString(appender, header.second);
+    }
+    appender.writeBE<uint32_t>(entry.vary.size());
+    for (const auto& vary : entry.vary) {
+      writeString(appender, vary.first);
+      writeString(appender, vary.second);
+    }
+    auto bodyLen = entry.body ? entry.body->computeChainDataLength() : 0;
+    appender.writeBE<uint32_t>(bodyLen);
+    if (entry.body) {
+      for (auto range : *entry.body) {
+        appender.push(range.data(), range.size());
+      }
+    }
+  }
+
+  static std::shared_ptr<const Entry> readEntry(folly::io::Cursor& cursor,
+                                                TimePoint now) {
+    auto entry = std::make_shared<Entry>();
+    entry->responseTime = now;
+    entry->initialAge = seconds(cursor.readBE<uint64_t>());
+    entry->freshness = seconds(cursor.readBE<uint64_t>());
+    entry->staleWhileRevalidate = seconds(cursor.readBE<uint64_t>());
+    entry->response.setStatusCode(cursor.readBE<uint16_t>());
+    entry->response.setStatusMessage(readString(cursor));
+    auto numHeaders = cursor.readBE<uint32_t>();
+    for (uint32_t i = 0; i < numHeaders; i++) {
+      auto name = readString(cursor);
+      entry->response.getHeaders().add(name, readString(cursor));
+    }
+    auto numVary = cursor.readBE<uint32_t>();
+    for (uint32_t i = 0; i < numVary; i++) {
+      auto name = readString(cursor);
+      entry->vary.emplace_back(std::move(name), readString(cursor));
+    }
+    auto bodyLen = cursor.readBE<uint32_t>();
+    if (bodyLen > 0) {
+      cursor.clone(entry->body, bodyLen);
+      // Off the mapping, which is overwritten later
+      entry->body->unshare();
+      entry->body->coalesce();
+    }
+    return entry;
+  }
+
+  void erase(const std::string& key) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      byOffset_.erase(it->second.offset);
+      index_.erase(it);
+    }
+  }
+
+  // Drops the records overwritten by a write of size at offset
+  void dropOverlapping(size_t offset, size_t size) {
+    auto it = byOffset_.lower_bound(offset);
+    if (it != byOffset_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->first + index_[prev->second].length > offset) {
+        index_.erase(prev->second);
+        byOffset_.erase(prev);
+      }
+    }
+    while (it != byOffset_.end() && it->first < offset + size) {
+      index_.erase(it->second);
+      it = byOffset_.erase(it);
+    }
+  }
+
+  std::mutex mutex_;
+  folly::MemoryMapping mapping_;
+  const size_t capacity_;
+  size_t writePos_{0};
+  std::unordered_map<std::string, Location> index_;
+  std::map<size_t, std::string> byOffset_;
+};
+
+HTTPCache::Shard::Shard(size_t maxShardBytes)
+    // Bounded by bytes rather than entries
+    : map(std::numeric_limits<size_t>::max()), maxBytes(maxShardBytes) {
+}
+
+HTTPCache::HTTPCache(Options options) : options_(std::move(options)) {
+  CHECK_GT(options_.numShards, 0);
+  auto shardBytes = options_.maxBytes / options_.numShards;
+  shards_.reserve(options_.numShards);
+  for (size_t i = 0; i < options_.numShards; ++i) {
+    shards_.push_back(
+        std::make_unique<folly::Synchronized<Shard, std::mutex>>(
+            std::in_place, shardBytes));
+  }
+  if (!options_.diskPath.empty()) {
+    try {
+      disk_ = std::make_unique<DiskTier>(options_.diskPath, options_.diskBytes);
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "No HTTP cache disk tier at " << options_.diskPath << ": "
+                 << ex.what();
+    }
+  }
+}
+
+HTTPCache::~HTTPCache() = default;
+
+bool HTTPCache::isCacheableRequest(const HTTPMessage& request) {
+  auto method = request.getMethod();
+  if (method != HTTPMethod::GET && method != HTTPMethod::HEAD) {
+    return false;
+  }
+  if (request.getHeaders().exists(HTTP_HEADER_AUTHORIZATION)) {
+    return false;
+  }
+  return !CacheControl::parse(request.getHeaders()).noStore;
+}
+
+std::string HTTPCache::makeKey(const HTTPMessage& request) {
+  return folly::to<std::string>(
+      request.isSecure() ? "https://" : "http://",
+      request.getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST),
+      " ",
+      request.getURL());
+}
+
+folly::Optional<seconds> HTTPCache::getFreshness(
+    const HTTPMessage& response) const {
+  const auto& headers = response.getHeaders();
+  auto cc = CacheControl::parse(headers);
+  if (cc.sMaxAge) {
+    return cc.sMaxAge;
+  }
+  if (cc.maxAge) {
+    return cc.maxAge;
+  }
+  auto date = parseDate(headers, HTTP_HEADER_DATE)
+                  .value_or(toTimeT(getCurrentTime()));
+  if (headers.exists(HTTP_HEADER_EXPIRES)) {
+    // Invalid dates are in the past
+    auto expires = parseDate(headers, HTTP_HEADER_EXPIRES).value_or(0);
+    return seconds(std::max<int64_t>(expires - date, 0));
+  }
+  if (auto lastModified = parseDate(headers, HTTP_HEADER_LAST_MODIFIED)) {
+    // The heuristic of RFC 9111 section 4.2.2
+    return std::min(seconds(std::max<int64_t>(date - *lastModified, 0) / 10),
+                    options_.maxHeuristicFreshness);
+  }
+  return folly::none;
+}
+
+std::shared_ptr<HTTPCache::Entry> HTTPCache::makeEntry(
+    const HTTPMessage& request,
+    const HTTPMessage& response,
+    TimePoint now) const {
+  if (request.getMethod() != HTTPMethod::GET ||
+      !isCacheableStatus(response.getStatusCode())) {
+    return nullptr;
+  }
+  const auto& headers = response.getHeaders();
+  auto cc = CacheControl::parse(headers);
+  // Cookies are per client, even without private
+  if (cc.noStore || cc.isPrivate || headers.exists(HTTP_HEADER_SET_COOKIE)) {
+    return nullptr;
+  }
+
+  auto entry = std::make_shared<Entry>();
+  std::vector<folly::StringPiece> varyNames;
+  auto vary = headers.combine(HTTP_HEADER_VARY, ",");
+  folly::split(',', vary, varyNames, /*ignoreEmpty=*/true);
+  for (auto name : varyNames) {
+    name = folly::trimWhitespace(name);
+    if (name == "*") {
+      return nullptr;
+    }
+    if (!name.empty()) {
+      auto lower = name.str();
+      folly::toLowerAscii(lower);
+      auto value = request.getHeaders().combine(lower);
+      entry->vary.emplace_back(std::move(lower), std::move(value));
+    }
+  }
+
+  entry->response = response;
+  entry->responseTime = now;
+  auto freshness = getFreshness(response);
+  if (cc.noCache) {
+    freshness = seconds(0);
+  }
+  if (!freshness) {
+    if (!entry->hasValidator()) {
+      return nullptr;
+    }
+    // Stored to be revalidated
+    freshness = seconds(0);
+  }
+  entry->freshness = *freshness;
+  entry->initialAge =
+      parseSeconds(headers.getSingleOrEmpty(HTTP_HEADER_AGE)).value_or(
+          seconds(0));
+  if (!cc.mustRevalidate) {
+    entry->staleWhileRevalidate = cc.staleWhileRevalidate.value_or(seconds(0));
+  }
+  return entry;
+}
+
+std::shared_ptr<const HTTPCache::Entry> HTTPCache::freshen(
+    const std::string& key,
+    const Entry& entry,
+    const HTTPMessage& notModified,
+    TimePoint now) {
+  auto fresh = std::make_shared<Entry>();
+  fresh->response = entry.response;
+  if (entry.body) {
+    fresh->body = entry.body->clone();
+  }
+  fresh->vary = entry.vary;
+
+  // The headers of the 304 replace the stored ones, RFC 9111 section 3.2
+  auto& headers = fresh->response.getHeaders();
+  const auto& updates = notModified.getHeaders();
+  updates.forEach([&headers](const std::string& name, const std::string&) {
+    if (!folly::StringPiece(name).equals("content-length",
+                                         folly::AsciiCaseInsensitive())) {
+      headers.remove(name);
+    }
+  });
+  updates.forEach(
+      [&headers](const std::string& name, const std::string& value) {
+        if (!folly::StringPiece(name).equals("content-length",
+                                             folly::AsciiCaseInsensitive())) {
+          headers.add(name, value);
+        }
+      });
+
+  auto cc = CacheControl::parse(headers);
+  fresh->responseTime = now;
+  fresh->initialAge =
+      parseSeconds(updates.getSingleOrEmpty(HTTP_HEADER_AGE)).value_or(
+          seconds(0));
+  fresh->freshness =
+      cc.noCache ? seconds(0) : getFreshness(fresh->response).value_or(
+                                    seconds(0));
+  if (!cc.mustRevalidate) {
+    fresh->staleWhileRevalidate = cc.staleWhileRevalidate.value_or(seconds(0));
+  }
+  if (cc.noStore || cc.isPrivate) {
+    invalidate(key);
+  } else {
+    insert(key, fresh);
+  }
+  return fresh;
+}
+
+folly::Synchronized<HTTPCache::Shard, std::mutex>& HTTPCache::getShard(
+    const std::string& key) {
+  return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+size_t HTTPCache::getSize(const Variants& variants) {
+  size_t size = 0;
+  for (const auto& entry : variants) {
+    size += entry->getSize();
+  }
+  return size;
+}
+
+std::shared_ptr<const HTTPCache::Entry> HTTPCache::findVariant(
+    const Variants& variants, const HTTPMessage& request) {
+  for (const auto& entry : variants) {
+    bool matches = true;
+    for (const auto& vary : entry->vary) {
+      if (request.getHeaders().combine(vary.first) != vary.second) {
+        matches = false;
+        break;
+      }
+    }
+    if (matches) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+HTTPCache::LookupResult HTTPCache::lookup(const HTTPMessage& request,
+                                          TimePoint now) {
+  auto key = makeKey(request);
+  LookupResult result;
+  {
+    auto shard = getShard(key).lock();
+    auto it = shard->map.find(key);
+    if (it != shard->map.end()) {
+      result.entry = findVariant(it->second, request);
+    }
+  }
+  if (!result.entry && disk_) {
+    auto variants = disk_->take(key, now);
+    if (!variants.empty()) {
+      diskHits_++;
+      result.entry = findVariant(variants, request);
+      Evicted evicted;
+      {
+        auto shard = getShard(key).lock();
+        for (auto& entry : variants) {
+          insertVariant(*shard, key, std::move(entry), evicted);
+        }
+      }
+      spillToDisk(std::move(evicted));
+    }
+  }
+  if (!result.entry) {
+    misses_++;
+    return result;
+  }
+
+  auto age = result.entry->getAge(now);
+  auto cc = CacheControl::parse(request.getHeaders());
+  if (result.entry->isFresh(now) && !cc.noCache &&
+      (!cc.maxAge || age <= *cc.maxAge)) {
+    hits_++;
+    result.status = LookupStatus::FRESH;
+  } else if (!cc.noCache && age < result.entry->freshness +
+                                      result.entry->staleWhileRevalidate) {
+    staleHits_++;
+    result.status = LookupStatus::STALE_WHILE_REVALIDATE;
+  } else {
+    misses_++;
+    result.status = LookupStatus::STALE;
+  }
+  return result;
+}
+
+void HTTPCache::makeRoom(Shard& shard, size_t extra, Evicted& evicted) {
+  while (shard.bytes + extra > shard.maxBytes && !shard.map.empty()) {
+    auto oldest = std::prev(shard.map.end());
+    shard.bytes -= getSize(oldest->second);
+    if (disk_) {
+      evicted.emplace_back(oldest->first, std::move(oldest->second));
+    }
+    shard.map.erase(oldest);
+    evictions_++;
+  }
+}
+
+void HTTPCache::spillToDisk(Evicted evicted) {
+  if (!disk_ || evicted.empty()) {
+    return;
+  }
+  auto now = getCurrentTime();
+  for (const auto& [key, variants] : evicted) {
+    disk_->put(key, variants, now);
+  }
+}
+
+void HTTPCache::insertVariant(Shard& shard,
+                              const std::string& key,
+                              std::shared_ptr<const Entry> entry,
+                              Evicted& evicted) {
+  Variants variants;
+  auto it = shard.map.findWithoutPromotion(key);
+  if (it != shard.map.end()) {
+    variants = std::move(it->second);
+    shard.bytes -= getSize(variants);
+    shard.map.erase(it);
+  }
+  auto sameVaryNames = [&entry](const std::shared_ptr<const Entry>& other) {
+    if (other->vary.size() != entry->vary.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < other->vary.size(); i++) {
+      if (other->vary[i].first != entry->vary[i].first) {
+        return false;
+      }
+    }
+    return true;
+  };
+  // Replaces the same variant, and all of them if the resource now varies
+  // on other headers
+  variants.erase(std::remove_if(variants.begin(),
+                                variants.end(),
+                                [&](const std::shared_ptr<const Entry>& other) {
+                                  return !sameVaryNames(other) ||
+                                         other->vary == entry->vary;
+                                }),
+                 variants.end());
+  if (variants.size() >= kMaxVariants) {
+    variants.erase(variants.begin());
+  }
+  variants.push_back(std::move(entry));
+  auto size = getSize(variants);
+  if (size > shard.maxBytes) {
+    return;
+  }
+  makeRoom(shard, size, evicted);
+  shard.bytes += size;
+  shard.map.set(key, std::move(variants));
+}
+
+void HTTPCache::insert(const std::string& key,
+                       std::shared_ptr<const Entry> entry) {
+  if (entry->body &&
+      entry->body->computeChainDataLength() > options_.maxBodyBytes) {
+    return;
+  }
+  Evicted evicted;
+  {
+    auto shard = getShard(key).lock();
+    insertVariant(*shard, key, std::move(entry), evicted);
+  }
+  insertions_++;
+  // Disk writes are slow, they don't hold up the other users of the shard
+  spillToDisk(std::move(evicted));
+}
+
+void HTTPCache::invalidate(const std::string& key) {
+  {
+    auto shard = getShard(key).lock();
+    auto it = shard->map.findWithoutPromotion(key);
+    if (it != shard->map.end()) {
+      shard->bytes -= getSize(it->second);
+      shard->map.erase(it);
+    }
+  }
+  if (disk_) {
+    disk_->take(key, getCurrentTime());
+  }
+}
+
+bool HTTPCache::startFill(const std::string& key,
+                          folly::EventBase* evb,
+                          folly::Function<void()> callback) {
+  auto fills = fills_.lock();
+  auto it = fills->find(key);
+  if (it == fills->end()) {
+    fills->emplace(key, std::vector<Waiter>());
+    return true;
+  }
+  it->second.push_back(Waiter{evb, std::move(callback)});
+  collapsed_++;
+  return false;
+}
+
+void HTTPCache::endFill(const std::string& key) {
+  std::vector<Waiter> waiters;
+  {
+    auto fills = fills_.lock();
+    auto it = fills->find(key);
+    if (it == fills->end()) {
+      return;
+    }
+    waiters = std::move(it->second);
+    fills->erase(it);
+  }
+  for (auto& waiter : waiters) {
+    waiter.evb->runInEventBaseThread(std::move(waiter.callback));
+  }
+}
+
+HTTPCache::Stats HTTPCache::getStats() {
+  Stats stats{hits_.load(),
+              staleHits_.load(),
+              misses_.load(),
+              insertions_.load(),
+              evictions_.load(),
+              diskHits_.load(),
+              collapsed_.load(),
+              0,
+              0};
+  for (auto& shard : shards_) {
+    auto locked = shard->lock();
+    stats.bytes += locked->bytes;
+    stats.entries += locked->map.size();
+  }
+  return stats;
+}
+
+} // namespace proxygen
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Function.h>
+#include <folly/Optional.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * The Cache-Control directives of a message used by HTTPCache, see RFC 9111
+ * section 5.2.  Unknown directives are ignored.
+ */
+struct CacheControl {
+  bool noStore{false};
+  bool noCache{false};
+  bool isPrivate{false};
+  bool mustRevalidate{false};
+  folly::Optional<std::chrono::seconds> maxAge;
+  folly::Optional<std::chrono::seconds> sMaxAge;
+  folly::Optional<std::chrono::seconds> staleWhileRevalidate;
+
+  static CacheControl parse(const HTTPHeaders& headers);
+};
+
+/**
+ * A shared HTTP cache of responses (RFC 9111), for HTTPCacheFilter.
+ *
+ * Responses to GETs are stored under their Host and URL, with a variant
+ * per value of the request headers named by their Vary.  Bodies are served
+ * by clone, sharing the stored buffers.  The cache is split in shards by
+ * key, each an LRU bounded to its share of maxBytes.  With a diskPath, the
+ * entries evicted from memory spill to a ring of diskBytes in a file mapped
+ * to memory, and entries found there move back to memory.
+ *
+ * Concurrent misses of a key are collapsed: the first request fills it
+ * while the others wait, see startFill().
+ *
+ * All methods are thread safe.
+ */
+class HTTPCache {
+ public:
+  struct Options {
+    size_t maxBytes{256 * 1024 * 1024};
+    // Responses with bigger bodies are not stored
+    size_t maxBodyBytes{8 * 1024 * 1024};
+    size_t numShards{16};
+    // How long the requests collapsed into a fill wait for it before they
+    // go to the origin themselves
+    std::chrono::milliseconds fillTimeout{std::chrono::milliseconds(1000)};
+    // Lifetimes computed from Last-Modified are capped to this
+    std::chrono::seconds maxHeuristicFreshness{std::chrono::hours(24)};
+    // The disk tier, off when empty. The file is recreated on start.
+    std::string diskPath;
+    size_t diskBytes{1024 * 1024 * 1024};
+  };
+
+  struct Entry {
+    // The response headers, with its status
+    HTTPMessage response;
+    std::unique_ptr<folly::IOBuf> body;
+    TimePoint responseTime;
+    // The age of the response when received
+    std::chrono::seconds initialAge{0};
+    std::chrono::seconds freshness{0};
+    std::chrono::seconds staleWhileRevalidate{0};
+    // The request headers the response varies on, names in lower case
+    std::vector<std::pair<std::string, std::string>> vary;
+
+    std::chrono::seconds getAge(TimePoint now) const;
+    bool isFresh(TimePoint now) const {
+      return getAge(now) < freshness;
+    }
+    bool hasValidator() const;
+    size_t getSize() const;
+  };
+
+  enum class LookupStatus {
+    MISS,
+    FRESH,
+    // Stale, but may be served while it is revalidated
+    STALE_WHILE_REVALIDATE,
+    // Stale, needs a revalidation
+    STALE,
+  };
+
+  struct LookupResult {
+    LookupStatus status{LookupStatus::MISS};
+    std::shared_ptr<const Entry> entry;
+  };
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t staleHits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    uint64_t diskHits;
+    uint64_t collapsed;
+    size_t bytes;
+    size_t entries;
+  };
+
+  explicit HTTPCache(Options options);
+  ~HTTPCache();
+
+  // GETs and HEADs without credentials or no-store
+  static bool isCacheableRequest(const HTTPMessage& request);
+
+  static std::string makeKey(const HTTPMessage& request);
+
+  /**
+   * The entry storing response to request, without its body, or nullptr if
+   * it may not be stored.
+   */
+  std::shared_ptr<Entry> makeEntry(const HTTPMessage& request,
+                                   const HTTPMessage& response,
+                                   TimePoint now = getCurrentTime()) const;
+
+  /**
+   * A copy of entry updated with the headers of a 304 response to its
+   * revalidation, stored in place of it.
+   */
+  std::shared_ptr<const Entry> freshen(const std::string& key,
+                                       const Entry& entry,
+                                       const HTTPMessage& notModified,
+                                       TimePoint now = getCurrentTime());
+
+  LookupResult lookup(const HTTPMessage& request,
+                      TimePoint now = getCurrentTime());
+
+  void insert(const std::string& key, std::shared_ptr<const Entry> entry);
+
+  // Drops every variant of key, e.g. after an unsafe request to it
+  void invalidate(const std::string& key);
+
+  /**
+   * Collapses the misses of key: returns true if the caller should fill
+   * it, and then must call endFill().  Otherwise another request is filling
+   * it, and callback is invoked in evb once it ends.
+   */
+  bool startFill(const std::string& key,
+                 folly::EventBase* evb,
+                 folly::Function<void()> callback);
+
+  void endFill(const std::string& key);
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+  Stats getStats();
+
+ private:
+  class DiskTier;
+
+  using Variants = std::vector<std::shared_ptr<const Entry>>;
+  // Evicted from a shard, to spill to disk once its lock is released
+  using Evicted = std::vector<std::pair<std::string, Variants>>;
+
+  struct Shard {
+    explicit Shard(size_t maxBytes);
+
+    folly::EvictingCacheMap<std::string, Variants> map;
+    size_t maxBytes;
+    size_t bytes{0};
+  };
+
+  struct Waiter {
+    folly::EventBase* evb;
+    folly::Function<void()> callback;
+  };
+
+  folly::Synchronized<Shard, std::mutex>& getShard(const std::string& key);
+  // Evicts from shard until extra bytes fit
+  void makeRoom(Shard& shard, size_t extra, Evicted& evicted);
+  void insertVariant(Shard& shard,
+                     const std::string& key,
+                     std::shared_ptr<const Entry> entry,
+                     Evicted& evicted);
+  void spillToDisk(Evicted evicted);
+  static size_t getSize(const Variants& variants);
+  static std::shared_ptr<const Entry> findVariant(const Variants& variants,
+                                                  const HTTPMessage& request);
+  folly::Optional<std::chrono::seconds> getFreshness(
+      const HTTPMessage& response) const;
+
+  const Options options_;
+  std::vector<std::unique_ptr<folly::Synchronized<Shard, std::mutex>>>
+      shards_;
+  std::unique_ptr<DiskTier> disk_;
+  folly::Synchronized<std::unordered_map<std::string, std::vector<Waiter>>,
+                      std::mutex>
+      fills_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> staleHits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> insertions_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> diskHits_{0};
+  std::atomic<uint64_t> collapsed_{0};
+};
+
+} // namespace proxygen
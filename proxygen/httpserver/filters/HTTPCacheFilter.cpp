@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/filters/HTTPCacheFilter.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <proxygen/lib/utils/HTTPTime.h>
+#include <wangle/acceptor/TransportInfo.h>
+
+namespace {
+
+using proxygen::HTTPCache;
+using proxygen::HTTPMessage;
+
+// The request sent to revalidate the stale entry
+std::unique_ptr<HTTPMessage> makeConditional(const HTTPMessage& request,
+                                             const HTTPCache::Entry& stale) {
+  auto conditional = std::make_unique<HTTPMessage>(request);
+  auto& headers = conditional->getHeaders();
+  headers.remove(proxygen::HTTP_HEADER_IF_NONE_MATCH);
+  headers.remove(proxygen::HTTP_HEADER_IF_MODIFIED_SINCE);
+  const auto& stored = stale.response.getHeaders();
+  const auto& etag = stored.getSingleOrEmpty(proxygen::HTTP_HEADER_ETAG);
+  if (!etag.empty()) {
+    headers.set(proxygen::HTTP_HEADER_IF_NONE_MATCH, etag);
+  }
+  const auto& lastModified =
+      stored.getSingleOrEmpty(proxygen::HTTP_HEADER_LAST_MODIFIED);
+  if (!lastModified.empty()) {
+    headers.set(proxygen::HTTP_HEADER_IF_MODIFIED_SINCE, lastModified);
+  }
+  return conditional;
+}
+
+// The weak comparison of RFC 9110 section 8.8.3.2
+bool etagMatches(folly::StringPiece ifNoneMatch, folly::StringPiece etag) {
+  etag.removePrefix("W/");
+  std::vector<folly::StringPiece> tags;
+  folly::split(',', ifNoneMatch, tags);
+  for (auto tag : tags) {
+    tag = folly::trimWhitespace(tag);
+    if (tag == "*") {
+      return true;
+    }
+    tag.removePrefix("W/");
+    if (!tag.empty() && tag == etag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Methods whose success invalidates the cache, RFC 9111 section 4.4
+bool isUnsafe(const HTTPMessage& request) {
+  auto method = request.getMethod();
+  return method == proxygen::HTTPMethod::POST ||
+         method == proxygen::HTTPMethod::PUT ||
+         method == proxygen::HTTPMethod::DELETE ||
+         method == proxygen::HTTPMethod::PATCH;
+}
+
+bool isNotModified(const HTTPMessage& request, const HTTPMessage& response) {
+  if (response.getStatusCode() != 200) {
+    return false;
+  }
+  const auto& headers = request.getHeaders();
+  const auto& ifNoneMatch =
+      headers.getSingleOrEmpty(proxygen::HTTP_HEADER_IF_NONE_MATCH);
+  if (!ifNoneMatch.empty()) {
+    const auto& etag =
+        response.getHeaders().getSingleOrEmpty(proxygen::HTTP_HEADER_ETAG);
+    return !etag.empty() && etagMatches(ifNoneMatch, etag);
+  }
+  const auto& ifModifiedSince =
+      headers.getSingleOrEmpty(proxygen::HTTP_HEADER_IF_MODIFIED_SINCE);
+  const auto& lastModified = response.getHeaders().getSingleOrEmpty(
+      proxygen::HTTP_HEADER_LAST_MODIFIED);
+  if (ifModifiedSince.empty() || lastModified.empty()) {
+    return false;
+  }
+  auto since = proxygen::parseHTTPDateTime(ifModifiedSince);
+  auto modified = proxygen::parseHTTPDateTime(lastModified);
+  return since && modified && *modified <= *since;
+}
+
+} // namespace
+
+namespace proxygen {
+
+/**
+ * Revalidates a stale entry after it was served, with a request of its own
+ * to a new handler of the origin.  Deletes itself once the origin is done.
+ */
+class HTTPCacheFilter::Revalidator : public ResponseHandler {
+ public:
+  Revalidator(std::shared_ptr<HTTPCache> cache,
+              std::string key,
+              std::shared_ptr<const HTTPCache::Entry> stale)
+      : ResponseHandler(nullptr),
+        cache_(std::move(cache)),
+        key_(std::move(key)),
+        stale_(std::move(stale)) {
+  }
+
+  void start(RequestHandlerFactory* originFactory,
+             const HTTPMessage& request) {
+    request_ = makeConditional(request, *stale_);
+    request_->setMethod(HTTPMethod::GET);
+    auto conditional = std::make_unique<HTTPMessage>(*request_);
+    upstream_ = originFactory->onRequest(nullptr, conditional.get());
+    upstream_->setResponseHandler(this);
+    upstream_->onRequest(std::move(conditional));
+    upstream_->onEOM();
+  }
+
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    if (!msg.isFinal()) {
+      return;
+    }
+    if (msg.getStatusCode() == 304) {
+      cache_->freshen(key_, *stale_, msg);
+      return;
+    }
+    entry_ = cache_->makeEntry(*request_, msg);
+    if (!entry_ && msg.getStatusCode() < 500) {
+      cache_->invalidate(key_);
+    }
+  }
+
+  void sendChunkHeader(size_t /*len*/) noexcept override {
+  }
+
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (entry_) {
+      body_.append(std::move(body));
+      if (body_.chainLength() > cache_->getOptions().maxBodyBytes) {
+        entry_.reset();
+        body_.move();
+      }
+    }
+  }
+
+  void sendChunkTerminator() noexcept override {
+  }
+
+  void sendEOM() noexcept override {
+    if (entry_) {
+      entry_->body = body_.move();
+      cache_->insert(key_, std::move(entry_));
+    }
+    finish();
+  }
+
+  void sendAbort() noexcept override {
+    entry_.reset();
+    finish();
+  }
+
+  void refreshTimeout() noexcept override {
+  }
+
+  void pauseIngress() noexcept override {
+  }
+
+  void resumeIngress() noexcept override {
+  }
+
+  folly::Expected<ResponseHandler*, ProxygenError> newPushedResponse(
+      PushHandler* /*pushHandler*/) noexcept override {
+    return folly::makeUnexpected(kErrorUnknown);
+  }
+
+  const wangle::TransportInfo& getSetupTransportInfo()
+      const noexcept override {
+    return transportInfo_;
+  }
+
+  void getCurrentTransportInfo(
+      wangle::TransportInfo* /*tinfo*/) const override {
+  }
+
+ private:
+  void finish() {
+    if (done_) {
+      return;
+    }
+    done_ = true;
+    cache_->endFill(key_);
+    // Not from within the origin handler's call
+    EventBaseManager::get()->getEventBase()->runInLoop([this] {
+      upstream_->requestComplete();
+      delete this;
+    });
+  }
+
+  std::shared_ptr<HTTPCache> cache_;
+  std::string key_;
+  std::shared_ptr<const HTTPCache::Entry> stale_;
+  std::unique_ptr<HTTPMessage> request_;
+  std::shared_ptr<HTTPCache::Entry> entry_;
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  wangle::TransportInfo transportInfo_;
+  bool done_{false};
+};
+
+void HTTPCacheFilter::setResponseHandler(ResponseHandler* handler) noexcept {
+  // The origin handler, if any, is built later
+  downstream_ = handler;
+  txn_ = handler->getTransaction();
+}
+
+void HTTPCacheFilter::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
+  request_ = std::move(headers);
+  key_ = HTTPCache::makeKey(*request_);
+  if (!HTTPCache::isCacheableRequest(*request_)) {
+    startOrigin(false);
+    return;
+  }
+  lookup();
+}
+
+void HTTPCacheFilter::lookup() {
+  auto result = cache_->lookup(*request_);
+  switch (result.status) {
+    case HTTPCache::LookupStatus::FRESH:
+      serve(*result.entry);
+      return;
+    case HTTPCache::LookupStatus::STALE_WHILE_REVALIDATE: {
+      serve(*result.entry);
+      auto evb = EventBaseManager::get()->getEventBase();
+      // Unless another request revalidates it already
+      if (cache_->startFill(key_, evb, [] {})) {
+        auto revalidator = new Revalidator(cache_, key_, result.entry);
+        revalidator->start(originFactory_, *request_);
+      }
+      return;
+    }
+    case HTTPCache::LookupStatus::STALE:
+    case HTTPCache::LookupStatus::MISS:
+      break;
+  }
+
+  stale_ = result.entry;
+  bool revalidate = stale_ && stale_->hasValidator();
+  if (request_->getMethod() != HTTPMethod::GET || waited_) {
+    startOrigin(revalidate);
+    return;
+  }
+  auto evb = EventBaseManager::get()->getEventBase();
+  std::weak_ptr<bool> alive = alive_;
+  if (cache_->startFill(key_, evb, [this, alive] {
+        if (alive.lock()) {
+          onFillDone();
+        }
+      })) {
+    filling_ = true;
+    startOrigin(revalidate);
+    return;
+  }
+  waiting_ = true;
+  evb->runAfterDelay(
+      [this, alive] {
+        if (alive.lock()) {
+          onFillDone();
+        }
+      },
+      cache_->getOptions().fillTimeout.count());
+}
+
+void HTTPCacheFilter::onFillDone() {
+  if (!waiting_) {
+    return;
+  }
+  waiting_ = false;
+  // Once: if the fill failed, the origin answers this request
+  waited_ = true;
+  lookup();
+}
+
+void HTTPCacheFilter::serve(const HTTPCache::Entry& entry) {
+  served_ = true;
+  HTTPMessage response(entry.response);
+  auto& headers = response.getHeaders();
+  headers.set(HTTP_HEADER_AGE,
+              folly::to<std::string>(entry.getAge(getCurrentTime()).count()));
+  headers.remove(HTTP_HEADER_TRANSFER_ENCODING);
+  response.setIsChunked(false);
+  if (isNotModified(*request_, response)) {
+    response.setStatusCode(304);
+    response.setStatusMessage(HTTPMessage::getDefaultReason(304));
+    headers.remove(HTTP_HEADER_CONTENT_LENGTH);
+    downstream_->sendHeaders(response);
+  } else {
+    auto length = entry.body ? entry.body->computeChainDataLength() : 0;
+    headers.set(HTTP_HEADER_CONTENT_LENGTH, folly::to<std::string>(length));
+    downstream_->sendHeaders(response);
+    if (entry.body && request_->getMethod() != HTTPMethod::HEAD) {
+      downstream_->sendBody(entry.body->clone());
+    }
+  }
+  if (requestEOM_) {
+    downstream_->sendEOM();
+  }
+}
+
+void HTTPCacheFilter::startOrigin(bool revalidate) {
+  auto request = revalidate ? makeConditional(*request_, *stale_)
+                            : std::make_unique<HTTPMessage>(*request_);
+  if (!revalidate) {
+    stale_.reset();
+  }
+  upstream_ = originFactory_->onRequest(nullptr, request.get());
+  upstream_->setResponseHandler(this);
+  upstream_->onRequest(std::move(request));
+  if (!requestBody_.empty()) {
+    upstream_->onBody(requestBody_.move());
+  }
+  if (requestEOM_) {
+    upstream_->onEOM();
+  }
+}
+
+void HTTPCacheFilter::endFill() {
+  if (filling_) {
+    filling_ = false;
+    cache_->endFill(key_);
+  }
+}
+
+void HTTPCacheFilter::onBody(std::unique_ptr<folly::IOBuf> body) noexcept {
+  if (upstream_) {
+    upstream_->onBody(std::move(body));
+  } else if (!served_) {
+    requestBody_.append(std::move(body));
+  }
+}
+
+void HTTPCacheFilter::onUpgrade(UpgradeProtocol protocol) noexcept {
+  if (upstream_) {
+    upstream_->onUpgrade(protocol);
+  }
+}
+
+void HTTPCacheFilter::onEOM() noexcept {
+  requestEOM_ = true;
+  if (upstream_) {
+    upstream_->onEOM();
+  } else if (served_) {
+    downstream_->sendEOM();
+  }
+}
+
+void HTTPCacheFilter::requestComplete() noexcept {
+  endFill();
+  downstream_ = nullptr;
+  if (upstream_) {
+    upstream_->requestComplete();
+  }
+  delete this;
+}
+
+void HTTPCacheFilter::onError(ProxygenError err) noexcept {
+  endFill();
+  downstream_ = nullptr;
+  if (upstream_) {
+    upstream_->onError(err);
+  }
+  delete this;
+}
+
+void HTTPCacheFilter::onGoaway(ErrorCode code) noexcept {
+  if (upstream_) {
+    upstream_->onGoaway(code);
+  }
+}
+
+void HTTPCacheFilter::onEgressPaused() noexcept {
+  if (upstream_) {
+    upstream_->onEgressPaused();
+  }
+}
+
+void HTTPCacheFilter::onEgressResumed() noexcept {
+  if (upstream_) {
+    upstream_->onEgressResumed();
+  }
+}
+
+bool HTTPCacheFilter::canHandleExpect() noexcept {
+  // Asked before the request, so before any origin handler
+  return upstream_ && upstream_->canHandleExpect();
+}
+
+ExMessageHandler* HTTPCacheFilter::getExHandler() noexcept {
+  return upstream_ ? upstream_->getExHandler() : nullptr;
+}
+
+void HTTPCacheFilter::sendHeaders(HTTPMessage& msg) noexcept {
+  if (!msg.isFinal()) {
+    // Interim responses, e.g. 103 Early Hints, are passed on uncached
+    downstream_->sendHeaders(msg);
+    return;
+  }
+  if (!HTTPCache::isCacheableRequest(*request_)) {
+    if (isUnsafe(*request_) && msg.getStatusCode() < 400) {
+      cache_->invalidate(key_);
+    }
+    downstream_->sendHeaders(msg);
+    return;
+  }
+  if (stale_ && msg.getStatusCode() == 304) {
+    auto fresh = cache_->freshen(key_, *stale_, msg);
+    endFill();
+    discard_ = true;
+    serve(*fresh);
+    return;
+  }
+  entry_ = cache_->makeEntry(*request_, msg);
+  if (!entry_) {
+    if (stale_ && msg.getStatusCode() < 500) {
+      cache_->invalidate(key_);
+    }
+    // Nothing to wait for, the coalesced requests go to the origin now
+    endFill();
+  }
+  downstream_->sendHeaders(msg);
+}
+
+void HTTPCacheFilter::sendChunkHeader(size_t len) noexcept {
+  if (!discard_) {
+    downstream_->sendChunkHeader(len);
+  }
+}
+
+void HTTPCacheFilter::sendBody(std::unique_ptr<folly::IOBuf> body) noexcept {
+  if (discard_) {
+    return;
+  }
+  if (entry_) {
+    // Shares the buffers sent
+    body_.append(body->clone());
+    if (body_.chainLength() > cache_->getOptions().maxBodyBytes) {
+      entry_.reset();
+      body_.move();
+      endFill();
+    }
+  }
+  downstream_->sendBody(std::move(body));
+}
+
+void HTTPCacheFilter::sendChunkTerminator() noexcept {
+  if (!discard_) {
+    downstream_->sendChunkTerminator();
+  }
+}
+
+void HTTPCacheFilter::sendEOM() noexcept {
+  if (discard_) {
+    return;
+  }
+  if (entry_) {
+    entry_->body = body_.move();
+    cache_->insert(key_, std::move(entry_));
+  }
+  endFill();
+  downstream_->sendEOM();
+}
+
+void HTTPCacheFilter::sendAbort() noexcept {
+  entry_.reset();
+  endFill();
+  if (!discard_) {
+    downstream_->sendAbort();
+  }
+}
+
+RequestHandler* HTTPCacheFilterFactory::onRequest(RequestHandler* upstream,
+                                                  HTTPMessage* msg) noexcept {
+  DCHECK(!upstream) << "HTTPCacheFilterFactory must be the last factory";
+  if (HTTPCache::isCacheableRequest(*msg) || isUnsafe(*msg)) {
+    return new HTTPCacheFilter(handlerFactory_.get(), cache_);
+  }
+  return handlerFactory_->onRequest(nullptr, msg);
+}
+
+} // namespace proxygen
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/HTTPCache.h>
+
+namespace proxygen {
+
+/**
+ * Serves requests from an HTTPCache, building the handler of the origin
+ * (the application) only when the cache can't answer.
+ *
+ * Fresh entries are served as is.  Stale ones within their
+ * stale-while-revalidate window are served too, while a background request
+ * revalidates them.  Otherwise the request goes to the origin, conditional
+ * on the validators of the stale entry if any, and the response is stored.
+ * Concurrent misses of a key wait for the first one to fill it, up to the
+ * fillTimeout of the cache.  Successful unsafe requests invalidate the
+ * entries of their URL.
+ */
+class HTTPCacheFilter : public Filter {
+ public:
+  HTTPCacheFilter(RequestHandlerFactory* originFactory,
+                  std::shared_ptr<HTTPCache> cache)
+      : Filter(nullptr),
+        originFactory_(originFactory),
+        cache_(std::move(cache)) {
+  }
+
+  // RequestHandler
+  void setResponseHandler(ResponseHandler* handler) noexcept override;
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override;
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
+  void onUpgrade(UpgradeProtocol protocol) noexcept override;
+  void onEOM() noexcept override;
+  void requestComplete() noexcept override;
+  void onError(ProxygenError err) noexcept override;
+  void onGoaway(ErrorCode code) noexcept override;
+  void onEgressPaused() noexcept override;
+  void onEgressResumed() noexcept override;
+  bool canHandleExpect() noexcept override;
+  ExMessageHandler* getExHandler() noexcept override;
+
+  // ResponseHandler, for the origin
+  void sendHeaders(HTTPMessage& msg) noexcept override;
+  void sendChunkHeader(size_t len) noexcept override;
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
+  void sendChunkTerminator() noexcept override;
+  void sendEOM() noexcept override;
+  void sendAbort() noexcept override;
+
+ private:
+  class Revalidator;
+
+  void lookup();
+  void onFillDone();
+  // Serves entry, or a 304 if the request's validators match it
+  void serve(const HTTPCache::Entry& entry);
+  void startOrigin(bool revalidate);
+  void endFill();
+
+  RequestHandlerFactory* originFactory_;
+  std::shared_ptr<HTTPCache> cache_;
+  std::unique_ptr<HTTPMessage> request_;
+  std::string key_;
+  // The stale entry being revalidated
+  std::shared_ptr<const HTTPCache::Entry> stale_;
+  // The response of the origin, while it is stored
+  std::shared_ptr<HTTPCache::Entry> entry_;
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  // The request body and EOM received before the origin handler
+  folly::IOBufQueue requestBody_{folly::IOBufQueue::cacheChainLength()};
+  bool requestEOM_{false};
+  bool served_{false};
+  // Owning the fill of key_
+  bool filling_{false};
+  bool waiting_{false};
+  // Woken from a wait, so not waiting again
+  bool waited_{false};
+  // Dropping the rest of the origin's response after a 304
+  bool discard_{false};
+  // Outlives the filter in the callbacks of the fill it waits for
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
+};
+
+/**
+ * Puts an HTTPCache in front of the handlers built by handlerFactory.  It
+ * wraps that factory, so it must be the last factory of the chain.  The
+ * cache may be shared by several servers, and by all their threads.
+ */
+class HTTPCacheFilterFactory : public RequestHandlerFactory {
+ public:
+  HTTPCacheFilterFactory(std::unique_ptr<RequestHandlerFactory> handlerFactory,
+                         std::shared_ptr<HTTPCache> cache)
+      : handlerFactory_(std::move(handlerFactory)), cache_(std::move(cache)) {
+  }
+
+  void onServerStart(folly::EventBase* evb) noexcept override {
+    handlerFactory_->onServerStart(evb);
+  }
+
+  void onServerStop() noexcept override {
+    handlerFactory_->onServerStop();
+  }
+
+  RequestHandler* onRequest(RequestHandler* upstream,
+                            HTTPMessage* msg) noexcept override;
+
+ private:
+  std::unique_ptr<RequestHandlerFactory> handlerFactory_;
+  std::shared_ptr<HTTPCache> cache_;
+};
+
+} // namespace proxygen
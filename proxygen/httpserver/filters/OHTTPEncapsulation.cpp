@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/filters/OHTTPEncapsulation.h>
+
+#include <fizz/crypto/hpke/Hpke.h>
+#include <fizz/crypto/hpke/Utils.h>
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+
+#include <algorithm>
+
+using fizz::hpke::AeadId;
+using fizz::hpke::KDFId;
+using fizz::hpke::KEMId;
+
+namespace proxygen::ohttp {
+
+namespace {
+
+constexpr folly::StringPiece kRequestLabel{"message/bhttp request"};
+constexpr folly::StringPiece kResponseLabel{"message/bhttp response"};
+constexpr folly::StringPiece kHpkePrefix{"HPKE-v1"};
+// Key id, KEM, KDF and AEAD ids
+constexpr size_t kHeaderLength = 7;
+constexpr size_t kCipherSuiteLength = 4;
+
+folly::Optional<size_t> getPublicKeyLength(KEMId kem) {
+  switch (kem) {
+    case KEMId::secp256r1:
+      return 65;
+    case KEMId::secp384r1:
+      return 97;
+    case KEMId::secp521r1:
+      return 133;
+    case KEMId::x25519:
+      return 32;
+    case KEMId::x448:
+      return 56;
+  }
+  return folly::none;
+}
+
+// The KDF a DH-based KEM derives its shared secret with
+KDFId getKEMKDF(KEMId kem) {
+  switch (kem) {
+    case KEMId::secp384r1:
+      return KDFId::Sha384;
+    case KEMId::secp521r1:
+    case KEMId::x448:
+      return KDFId::Sha512;
+    default:
+      return KDFId::Sha256;
+  }
+}
+
+void writeHeader(folly::io::Appender& appender,
+                 uint8_t keyId,
+                 KEMId kem,
+                 SymmetricCipherSuite cipherSuite) {
+  appender.writeBE<uint8_t>(keyId);
+  appender.writeBE<uint16_t>(folly::to_underlying(kem));
+  appender.writeBE<uint16_t>(folly::to_underlying(cipherSuite.kdf));
+  appender.writeBE<uint16_t>(folly::to_underlying(cipherSuite.aead));
+}
+
+std::unique_ptr<folly::IOBuf> makeInfo(uint8_t keyId,
+                                       KEMId kem,
+                                       SymmetricCipherSuite cipherSuite) {
+  auto info = folly::IOBuf::create(kRequestLabel.size() + 1 + kHeaderLength);
+  folly::io::Appender appender(info.get(), 0);
+  appender.push(kRequestLabel);
+  appender.writeBE<uint8_t>(0);
+  writeHeader(appender, keyId, kem, cipherSuite);
+  return info;
+}
+
+fizz::hpke::SetupParam makeSetupParam(KEMId kem,
+                                      SymmetricCipherSuite cipherSuite,
+                                      std::unique_ptr<fizz::KeyExchange> kex) {
+  auto dhkem = std::make_unique<fizz::hpke::DHKEM>(
+      std::move(kex),
+      fizz::hpke::getKexGroup(kem),
+      fizz::hpke::makeHpkeHkdf(folly::IOBuf::copyBuffer(kHpkePrefix),
+                               getKEMKDF(kem)));
+  return fizz::hpke::SetupParam{
+      std::move(dhkem),
+      fizz::hpke::makeCipher(cipherSuite.aead),
+      fizz::hpke::makeHpkeHkdf(folly::IOBuf::copyBuffer(kHpkePrefix),
+                               cipherSuite.kdf),
+      fizz::hpke::generateHpkeSuiteId(
+          kem, cipherSuite.kdf, cipherSuite.aead),
+      0};
+}
+
+// Keys the response AEAD from the request context and the response nonce
+void setResponseKey(fizz::Aead& aead,
+                    ResponseContext& context,
+                    const folly::IOBuf& responseNonce) {
+  auto secret = context.context->exportSecret(
+      folly::IOBuf::copyBuffer(kResponseLabel), responseNonce.length());
+  auto salt = context.enc->clone();
+  salt->prependChain(responseNonce.clone());
+  salt->coalesce();
+  auto hkdf = fizz::hpke::makeHpkeHkdf(folly::IOBuf::copyBuffer(kHpkePrefix),
+                                       context.cipherSuite.kdf);
+  auto prk = hkdf->extract(std::move(salt), std::move(secret));
+  auto key = hkdf->expand(
+      folly::range(prk), folly::IOBuf::copyBuffer("key"), aead.keyLength());
+  auto nonce = hkdf->expand(
+      folly::range(prk), folly::IOBuf::copyBuffer("nonce"), aead.ivLength());
+  aead.setKey(fizz::TrafficKey{std::move(key), std::move(nonce)});
+}
+
+bool supports(const KeyConfig& config, SymmetricCipherSuite cipherSuite) {
+  return std::any_of(config.cipherSuites.begin(),
+                     config.cipherSuites.end(),
+                     [&](const SymmetricCipherSuite& supported) {
+                       return supported.kdf == cipherSuite.kdf &&
+                              supported.aead == cipherSuite.aead;
+                     });
+}
+
+} // namespace
+
+std::unique_ptr<folly::IOBuf> serializeKeyConfigs(
+    const std::vector<KeyConfig>& configs) {
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  folly::io::QueueAppender appender(&queue, 256);
+  for (const auto& config : configs) {
+    auto suitesLength = kCipherSuiteLength * config.cipherSuites.size();
+    appender.writeBE<uint16_t>(1 + 2 + config.publicKey.size() + 2 +
+                               suitesLength);
+    appender.writeBE<uint8_t>(config.keyId);
+    appender.writeBE<uint16_t>(folly::to_underlying(config.kem));
+    appender.push(folly::StringPiece(config.publicKey));
+    appender.writeBE<uint16_t>(suitesLength);
+    for (const auto& cipherSuite : config.cipherSuites) {
+      appender.writeBE<uint16_t>(folly::to_underlying(cipherSuite.kdf));
+      appender.writeBE<uint16_t>(folly::to_underlying(cipherSuite.aead));
+    }
+  }
+  return queue.move();
+}
+
+folly::Expected<std::vector<KeyConfig>, std::string> parseKeyConfigs(
+    const folly::IOBuf& buf) {
+  std::vector<KeyConfig> configs;
+  folly::io::Cursor cursor(&buf);
+  while (!cursor.isAtEnd()) {
+    if (!cursor.canAdvance(2)) {
+      return folly::makeUnexpected(std::string("Truncated key config length"));
+    }
+    auto length = cursor.readBE<uint16_t>();
+    if (!cursor.canAdvance(length) || length < 1 + 2 + 2) {
+      return folly::makeUnexpected(std::string("Truncated key config"));
+    }
+    KeyConfig config;
+    config.keyId = cursor.readBE<uint8_t>();
+    config.kem = KEMId(cursor.readBE<uint16_t>());
+    auto publicKeyLength = getPublicKeyLength(config.kem);
+    if (!publicKeyLength) {
+      return folly::makeUnexpected(
+          folly::to<std::string>("Unsupported KEM ", (uint16_t)config.kem));
+    }
+    size_t suitesLength = length - 1 - 2 - 2;
+    if (*publicKeyLength > suitesLength) {
+      return folly::makeUnexpected(std::string("Truncated public key"));
+    }
+    suitesLength -= *publicKeyLength;
+    config.publicKey = cursor.readFixedString(*publicKeyLength);
+    if (cursor.readBE<uint16_t>() != suitesLength ||
+        suitesLength % kCipherSuiteLength != 0) {
+      return folly::makeUnexpected(std::string("Malformed cipher suites"));
+    }
+    for (size_t i = 0; i < suitesLength; i += kCipherSuiteLength) {
+      SymmetricCipherSuite cipherSuite;
+      cipherSuite.kdf = KDFId(cursor.readBE<uint16_t>());
+      cipherSuite.aead = AeadId(cursor.readBE<uint16_t>());
+      config.cipherSuites.push_back(cipherSuite);
+    }
+    configs.push_back(std::move(config));
+  }
+  return configs;
+}
+
+void KeyStore::addKey(KeyConfig config,
+                      std::unique_ptr<fizz::KeyExchange> privateKey) {
+  auto keyId = config.keyId;
+  keys_.insert_or_assign(keyId, Key{std::move(config), std::move(privateKey)});
+}
+
+const KeyStore::Key* KeyStore::getKey(uint8_t keyId) const {
+  auto it = keys_.find(keyId);
+  return it == keys_.end() ? nullptr : &it->second;
+}
+
+std::unique_ptr<folly::IOBuf> KeyStore::serializeConfigs() const {
+  std::vector<KeyConfig> configs;
+  configs.reserve(keys_.size());
+  for (const auto& key : keys_) {
+    configs.push_back(key.second.config);
+  }
+  return serializeKeyConfigs(configs);
+}
+
+folly::Expected<DecapsulatedRequest, std::string> decapsulateRequest(
+    const KeyStore& keys, std::unique_ptr<folly::IOBuf> encapsulated) {
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  queue.append(std::move(encapsulated));
+  folly::io::Cursor cursor(queue.front());
+  if (!cursor.canAdvance(kHeaderLength)) {
+    return folly::makeUnexpected(std::string("Truncated request header"));
+  }
+  auto keyId = cursor.readBE<uint8_t>();
+  auto kem = KEMId(cursor.readBE<uint16_t>());
+  SymmetricCipherSuite cipherSuite;
+  cipherSuite.kdf = KDFId(cursor.readBE<uint16_t>());
+  cipherSuite.aead = AeadId(cursor.readBE<uint16_t>());
+
+  auto key = keys.getKey(keyId);
+  if (!key) {
+    return folly::makeUnexpected(
+        folly::to<std::string>("Unknown key id ", keyId));
+  }
+  if (key->config.kem != kem || !supports(key->config, cipherSuite)) {
+    return folly::makeUnexpected(
+        std::string("Unsupported HPKE algorithms for key"));
+  }
+  // The encapsulated key of a DH-based KEM is a public key
+  auto encLength = key->config.publicKey.size();
+  if (!cursor.canAdvance(encLength)) {
+    return folly::makeUnexpected(std::string("Truncated encapsulated key"));
+  }
+  queue.trimStart(kHeaderLength);
+  auto enc = queue.split(encLength);
+
+  // The ciphertext keeps its buffers, so fizz can open it in place
+  DecapsulatedRequest result;
+  result.responseContext.cipherSuite = cipherSuite;
+  try {
+    result.responseContext.context = fizz::hpke::setupWithDecap(
+        fizz::hpke::Mode::Base,
+        enc->coalesce(),
+        folly::none,
+        makeInfo(keyId, kem, cipherSuite),
+        folly::none,
+        makeSetupParam(kem, cipherSuite, key->privateKey->clone()));
+    result.request =
+        result.responseContext.context->open(nullptr, queue.move());
+  } catch (const std::exception& ex) {
+    return folly::makeUnexpected(
+        folly::to<std::string>("Failed to open request: ", ex.what()));
+  }
+  result.responseContext.enc = std::move(enc);
+  return result;
+}
+
+std::unique_ptr<folly::IOBuf> encapsulateResponse(
+    ResponseContext& context, std::unique_ptr<folly::IOBuf> response) {
+  auto aead = fizz::hpke::makeCipher(context.cipherSuite.aead);
+  auto nonceLength = std::max(aead->keyLength(), aead->ivLength());
+  auto responseNonce = folly::IOBuf::create(nonceLength);
+  folly::Random::secureRandom(responseNonce->writableData(), nonceLength);
+  responseNonce->append(nonceLength);
+  setResponseKey(*aead, context, *responseNonce);
+  if (!response) {
+    response = folly::IOBuf::create(0);
+  }
+  responseNonce->prependChain(aead->encrypt(std::move(response), nullptr, 0));
+  return responseNonce;
+}
+
+folly::Expected<EncapsulatedRequest, std::string> encapsulateRequest(
+    const KeyConfig& config,
+    SymmetricCipherSuite cipherSuite,
+    std::unique_ptr<fizz::KeyExchange> ephemeral,
+    std::unique_ptr<folly::IOBuf> request) {
+  EncapsulatedRequest result;
+  result.responseContext.cipherSuite = cipherSuite;
+  auto header = folly::IOBuf::create(kHeaderLength);
+  folly::io::Appender appender(header.get(), 0);
+  writeHeader(appender, config.keyId, config.kem, cipherSuite);
+  try {
+    auto setup = fizz::hpke::setupWithEncap(
+        fizz::hpke::Mode::Base,
+        folly::ByteRange(folly::StringPiece(config.publicKey)),
+        makeInfo(config.keyId, config.kem, cipherSuite),
+        folly::none,
+        makeSetupParam(config.kem, cipherSuite, std::move(ephemeral)));
+    header->prependChain(setup.enc->clone());
+    header->prependChain(setup.context->seal(nullptr, std::move(request)));
+    result.responseContext.context = std::move(setup.context);
+    result.responseContext.enc = std::move(setup.enc);
+  } catch (const std::exception& ex) {
+    return folly::makeUnexpected(
+        folly::to<std::string>("Failed to seal request: ", ex.what()));
+  }
+  result.request = std::move(header);
+  return result;
+}
+
+folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
+decapsulateResponse(ResponseContext& context,
+                    std::unique_ptr<folly::IOBuf> encapsulated) {
+  auto aead = fizz::hpke::makeCipher(context.cipherSuite.aead);
+  auto nonceLength = std::max(aead->keyLength(), aead->ivLength());
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  queue.append(std::move(encapsulated));
+  if (queue.chainLength() <= nonceLength) {
+    return folly::makeUnexpected(std::string("Truncated response"));
+  }
+  auto responseNonce = queue.split(nonceLength);
+  responseNonce->coalesce();
+  setResponseKey(*aead, context, *responseNonce);
+  auto response = aead->tryDecrypt(queue.move(), nullptr, 0);
+  if (!response) {
+    return folly::makeUnexpected(std::string("Failed to open response"));
+  }
+  return std::move(*response);
+}
+
+} // namespace proxygen::ohttp
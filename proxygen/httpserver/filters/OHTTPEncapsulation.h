@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <fizz/crypto/exchange/KeyExchange.h>
+#include <fizz/crypto/hpke/Context.h>
+#include <fizz/crypto/hpke/Types.h>
+#include <folly/Expected.h>
+#include <folly/io/IOBuf.h>
+#include <map>
+#include <vector>
+
+namespace proxygen::ohttp {
+
+/**
+ * Oblivious HTTP (RFC 9458) message encapsulation over fizz's HPKE.
+ *
+ * A gateway holds its keys in a KeyStore, opens encapsulated requests with
+ * decapsulateRequest and seals the responses with the context that returns.
+ * Clients do the reverse with encapsulateRequest and decapsulateResponse.
+ * The payloads are binary HTTP messages, see HTTPBinaryCodec.
+ */
+
+constexpr folly::StringPiece kRequestContentType{"message/ohttp-req"};
+constexpr folly::StringPiece kResponseContentType{"message/ohttp-res"};
+constexpr folly::StringPiece kKeysContentType{"application/ohttp-keys"};
+
+struct SymmetricCipherSuite {
+  fizz::hpke::KDFId kdf;
+  fizz::hpke::AeadId aead;
+};
+
+struct KeyConfig {
+  uint8_t keyId{0};
+  fizz::hpke::KEMId kem;
+  std::string publicKey;
+  std::vector<SymmetricCipherSuite> cipherSuites;
+};
+
+// The application/ohttp-keys encoding of configs, for clients to fetch
+std::unique_ptr<folly::IOBuf> serializeKeyConfigs(
+    const std::vector<KeyConfig>& configs);
+folly::Expected<std::vector<KeyConfig>, std::string> parseKeyConfigs(
+    const folly::IOBuf& buf);
+
+/**
+ * The gateway's keys by key id.  Each private key is loaded once into a
+ * KeyExchange, which every request clones; the HPKE context itself is bound
+ * to the client's ephemeral key and so is set up per request.
+ */
+class KeyStore {
+ public:
+  struct Key {
+    KeyConfig config;
+    std::unique_ptr<fizz::KeyExchange> privateKey;
+  };
+
+  // privateKey holds the private half of config.publicKey
+  void addKey(KeyConfig config, std::unique_ptr<fizz::KeyExchange> privateKey);
+
+  const Key* getKey(uint8_t keyId) const;
+
+  std::unique_ptr<folly::IOBuf> serializeConfigs() const;
+
+ private:
+  std::map<uint8_t, Key> keys_;
+};
+
+// What sealing or opening the response of a request needs
+struct ResponseContext {
+  std::unique_ptr<fizz::hpke::HpkeContext> context;
+  std::unique_ptr<folly::IOBuf> enc;
+  SymmetricCipherSuite cipherSuite;
+};
+
+struct DecapsulatedRequest {
+  // A binary HTTP request, the decrypted buffer itself
+  std::unique_ptr<folly::IOBuf> request;
+  ResponseContext responseContext;
+};
+
+folly::Expected<DecapsulatedRequest, std::string> decapsulateRequest(
+    const KeyStore& keys, std::unique_ptr<folly::IOBuf> encapsulated);
+
+std::unique_ptr<folly::IOBuf> encapsulateResponse(
+    ResponseContext& context, std::unique_ptr<folly::IOBuf> response);
+
+struct EncapsulatedRequest {
+  std::unique_ptr<folly::IOBuf> request;
+  ResponseContext responseContext;
+};
+
+// ephemeral is a key exchange of config.kem, generating the client's key
+folly::Expected<EncapsulatedRequest, std::string> encapsulateRequest(
+    const KeyConfig& config,
+    SymmetricCipherSuite cipherSuite,
+    std::unique_ptr<fizz::KeyExchange> ephemeral,
+    std::unique_ptr<folly::IOBuf> request);
+
+folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
+decapsulateResponse(ResponseContext& context,
+                    std::unique_ptr<folly::IOBuf> encapsulated);
+
+} // namespace proxygen::ohttp
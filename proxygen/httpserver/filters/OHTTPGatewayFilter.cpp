@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/filters/OHTTPGatewayFilter.h>
+
+#include <proxygen/httpserver/ResponseBuilder.h>
+
+namespace {
+
+using namespace proxygen;
+
+// Collects the request the binary HTTP codec parses
+class RequestCollector : public HTTPCodec::Callback {
+ public:
+  void onMessageBegin(HTTPCodec::StreamID /*stream*/,
+                      HTTPMessage* /*msg*/) override {
+  }
+
+  void onHeadersComplete(HTTPCodec::StreamID /*stream*/,
+                         std::unique_ptr<HTTPMessage> msg) override {
+    msg_ = std::move(msg);
+  }
+
+  void onBody(HTTPCodec::StreamID /*stream*/,
+              std::unique_ptr<folly::IOBuf> chain,
+              uint16_t /*padding*/) override {
+    body_.append(std::move(chain));
+  }
+
+  void onTrailersComplete(HTTPCodec::StreamID /*stream*/,
+                          std::unique_ptr<HTTPHeaders> /*trailers*/) override {
+  }
+
+  void onMessageComplete(HTTPCodec::StreamID /*stream*/,
+                         bool /*upgrade*/) override {
+    complete_ = true;
+  }
+
+  void onError(HTTPCodec::StreamID /*stream*/,
+               const HTTPException& error,
+               bool /*newTxn*/) override {
+    VLOG(4) << "Invalid binary HTTP request: " << error.what();
+    error_ = true;
+  }
+
+  std::unique_ptr<HTTPMessage> msg_;
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+  bool complete_{false};
+  bool error_{false};
+};
+
+} // namespace
+
+namespace proxygen {
+
+void OHTTPGatewayFilter::onRequest(
+    std::unique_ptr<HTTPMessage> headers) noexcept {
+  if (headers->getMethod() != HTTPMethod::POST) {
+    reject(405, "Method Not Allowed");
+  }
+}
+
+void OHTTPGatewayFilter::onBody(std::unique_ptr<folly::IOBuf> body) noexcept {
+  if (failed_) {
+    return;
+  }
+  requestBuf_.append(std::move(body));
+  if (requestBuf_.chainLength() > options_.maxRequestBytes) {
+    requestBuf_.reset();
+    reject(413, "Payload Too Large");
+  }
+}
+
+void OHTTPGatewayFilter::onEOM() noexcept {
+  if (failed_) {
+    return;
+  }
+  auto decapsulated = ohttp::decapsulateRequest(*keys_, requestBuf_.move());
+  if (decapsulated.hasError()) {
+    VLOG(4) << "Can't decapsulate the request: " << decapsulated.error();
+    reject(400, "Bad Request");
+    return;
+  }
+  responseContext_ = std::move(decapsulated->responseContext);
+
+  // The decrypted buffer is parsed in place, the body shares it
+  RequestCollector collector;
+  HTTPBinaryCodec requestCodec(TransportDirection::DOWNSTREAM);
+  requestCodec.setCallback(&collector);
+  requestCodec.onIngress(*decapsulated->request);
+  requestCodec.onIngressEOF();
+  if (collector.error_ || !collector.complete_ || !collector.msg_) {
+    reject(400, "Bad Request");
+    return;
+  }
+
+  folly::DestructorCheck::Safety safety(*this);
+  upstream_->onRequest(std::move(collector.msg_));
+  // The handler may have ended the request
+  if (safety.destroyed() || !downstream_) {
+    return;
+  }
+  if (!collector.body_.empty()) {
+    upstream_->onBody(collector.body_.move());
+    if (safety.destroyed() || !downstream_) {
+      return;
+    }
+  }
+  upstream_->onEOM();
+}
+
+void OHTTPGatewayFilter::sendHeaders(HTTPMessage& msg) noexcept {
+  if (failed_ || msg.is1xxResponse()) {
+    return;
+  }
+  // The length of the body isn't known before sendEOM
+  responseCodec_.setEgressIndeterminateLength(true);
+  responseCodec_.generateHeader(responseBuf_, 0, msg);
+  responseStarted_ = true;
+}
+
+void OHTTPGatewayFilter::sendBody(
+    std::unique_ptr<folly::IOBuf> body) noexcept {
+  if (failed_ || !responseStarted_) {
+    return;
+  }
+  responseCodec_.generateBody(
+      responseBuf_, 0, std::move(body), folly::none, false);
+}
+
+void OHTTPGatewayFilter::sendEOM() noexcept {
+  if (failed_) {
+    return;
+  }
+  if (!responseStarted_) {
+    LOG(ERROR) << "The handler ended a response it never started";
+    failed_ = true;
+    downstream_->sendAbort();
+    return;
+  }
+  responseCodec_.generateEOM(responseBuf_, 0);
+  auto encapsulated =
+      ohttp::encapsulateResponse(responseContext_, responseBuf_.move());
+  ResponseBuilder(downstream_)
+      .status(200, "OK")
+      .header(HTTP_HEADER_CONTENT_TYPE, ohttp::kResponseContentType.str())
+      .body(std::move(encapsulated))
+      .sendWithEOM();
+}
+
+void OHTTPGatewayFilter::reject(uint16_t code, const std::string& message) {
+  failed_ = true;
+  // As RejectConnectFilter does, the handler never sees the request
+  upstream_->onError(kErrorMethodNotSupported);
+  upstream_ = nullptr;
+  ResponseBuilder(downstream_).status(code, message).sendWithEOM();
+}
+
+} // namespace proxygen
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/DestructorCheck.h>
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/filters/OHTTPEncapsulation.h>
+#include <proxygen/lib/http/codec/HTTPBinaryCodec.h>
+#include <proxygen/lib/utils/PooledObject.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter acting as an Oblivious HTTP gateway (RFC 9458).
+ *
+ * The encapsulated request is buffered, opened with the gateway's keys and
+ * handed to the handler as the binary HTTP request it carries.  The
+ * handler's response is encoded as binary HTTP, sealed and sent as a 200
+ * message/ohttp-res.  Requests that are not POSTs, are too large or can't be
+ * opened get an error response, and the handler an onError() instead of
+ * the request.
+ *
+ * Interim responses and trailers of the inner messages are dropped.
+ */
+class OHTTPGatewayFilter
+    : public Filter
+    , public folly::DestructorCheck
+    , public PooledObject<OHTTPGatewayFilter> {
+ public:
+  struct Options {
+    // The largest encapsulated request accepted
+    size_t maxRequestBytes{64 * 1024};
+  };
+
+  OHTTPGatewayFilter(RequestHandler* upstream,
+                     std::shared_ptr<const ohttp::KeyStore> keys,
+                     Options options)
+      : Filter(upstream), keys_(std::move(keys)), options_(options) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override;
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
+
+  void onEOM() noexcept override;
+
+  // The handler is gone once the request is rejected
+  void requestComplete() noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->requestComplete();
+    }
+    delete this;
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->onError(err);
+    }
+    delete this;
+  }
+
+  void onGoaway(ErrorCode code) noexcept override {
+    if (upstream_) {
+      upstream_->onGoaway(code);
+    }
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressResumed();
+    }
+  }
+
+  void sendHeaders(HTTPMessage& msg) noexcept override;
+
+  void sendChunkHeader(size_t /*len*/) noexcept override {
+  }
+
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override;
+
+  void sendChunkTerminator() noexcept override {
+  }
+
+  void sendEOM() noexcept override;
+
+ private:
+  void reject(uint16_t code, const std::string& message);
+
+  const std::shared_ptr<const ohttp::KeyStore> keys_;
+  const Options options_;
+  folly::IOBufQueue requestBuf_{folly::IOBufQueue::cacheChainLength()};
+  folly::IOBufQueue responseBuf_{folly::IOBufQueue::cacheChainLength()};
+  HTTPBinaryCodec responseCodec_{TransportDirection::UPSTREAM};
+  ohttp::ResponseContext responseContext_;
+  bool failed_{false};
+  bool responseStarted_{false};
+};
+
+/**
+ * Wraps the handler of every request with an OHTTP request content type.
+ */
+class OHTTPGatewayFilterFactory : public RequestHandlerFactory {
+ public:
+  explicit OHTTPGatewayFilterFactory(
+      std::shared_ptr<const ohttp::KeyStore> keys,
+      OHTTPGatewayFilter::Options options = {})
+      : keys_(std::move(keys)), options_(options) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    if (msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE) !=
+        ohttp::kRequestContentType) {
+      return h;
+    }
+    return new OHTTPGatewayFilter(h, keys_, options_);
+  }
+
+ private:
+  const std::shared_ptr<const ohttp::KeyStore> keys_;
+  const OHTTPGatewayFilter::Options options_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/httpserver/Filters.h>
+#include <proxygen/httpserver/RequestHandlerFactory.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/httpserver/filters/OHTTPEncapsulation.h>
+#include <proxygen/lib/utils/PooledObject.h>
+
+namespace proxygen {
+
+/**
+ * A Server filter for an Oblivious HTTP relay (RFC 9458), in front of the
+ * handler forwarding encapsulated requests to the gateway.
+ *
+ * Only the content type and length of the requests and the responses pass
+ * through, so neither side learns more about the other than the relay does.
+ * Requests that are not POSTs are rejected.
+ */
+class OHTTPRelayFilter
+    : public Filter
+    , public PooledObject<OHTTPRelayFilter> {
+ public:
+  explicit OHTTPRelayFilter(RequestHandler* upstream) : Filter(upstream) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override {
+    if (headers->getMethod() != HTTPMethod::POST) {
+      upstream_->onError(kErrorMethodNotSupported);
+      upstream_ = nullptr;
+      ResponseBuilder(downstream_)
+          .status(405, "Method Not Allowed")
+          .sendWithEOM();
+      return;
+    }
+    stripHeaders(headers->getHeaders());
+    upstream_->onRequest(std::move(headers));
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    if (upstream_) {
+      upstream_->onBody(std::move(body));
+    }
+  }
+
+  void onEOM() noexcept override {
+    if (upstream_) {
+      upstream_->onEOM();
+    }
+  }
+
+  // The handler is gone once the request is rejected
+  void requestComplete() noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->requestComplete();
+    }
+    delete this;
+  }
+
+  void onError(ProxygenError err) noexcept override {
+    downstream_ = nullptr;
+    if (upstream_) {
+      upstream_->onError(err);
+    }
+    delete this;
+  }
+
+  void onGoaway(ErrorCode code) noexcept override {
+    if (upstream_) {
+      upstream_->onGoaway(code);
+    }
+  }
+
+  void onEgressPaused() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressPaused();
+    }
+  }
+
+  void onEgressResumed() noexcept override {
+    if (upstream_) {
+      upstream_->onEgressResumed();
+    }
+  }
+
+  void sendHeaders(HTTPMessage& msg) noexcept override {
+    stripHeaders(msg.getHeaders());
+    downstream_->sendHeaders(msg);
+  }
+
+ private:
+  static void stripHeaders(HTTPHeaders& headers) {
+    HTTPHeaders kept;
+    headers.forEachWithCode(
+        [&](HTTPHeaderCode code, const std::string& name,
+            const std::string& value) {
+          if (code == HTTP_HEADER_CONTENT_TYPE ||
+              code == HTTP_HEADER_CONTENT_LENGTH) {
+            kept.add(name, value);
+          }
+        });
+    headers = std::move(kept);
+  }
+};
+
+/**
+ * Wraps the handler of every request with an OHTTP request content type.
+ */
+class OHTTPRelayFilterFactory : public RequestHandlerFactory {
+ public:
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* h,
+                            HTTPMessage* msg) noexcept override {
+    if (msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE) !=
+        ohttp::kRequestContentType) {
+      return h;
+    }
+    return new OHTTPRelayFilter(h);
+  }
+};
+
+} // namespace proxygen
@@ -11,13 +11,16 @@
 #include <proxygen/httpserver/Filters.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/utils/PooledObject.h>
 
 namespace proxygen {
 
 /**
  * A filter that rejects CONNECT/UPGRADE requests.
  */
-class RejectConnectFilter : public Filter {
+class RejectConnectFilter
+    : public Filter
+    , public PooledObject<RejectConnectFilter> {
  public:
   explicit RejectConnectFilter(RequestHandler* upstream) : Filter(upstream) {
   }
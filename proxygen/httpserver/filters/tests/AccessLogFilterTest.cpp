@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/AccessLogFilter.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+// Collects what the writer thread writes
+struct TestSink {
+  AccessLogWriter::Sink sink() {
+    return [this](folly::StringPiece data) {
+      std::lock_guard<std::mutex> lock(mutex);
+      lines.append(data.data(), data.size());
+    };
+  }
+
+  std::mutex mutex;
+  std::string lines;
+};
+
+AccessLogRecord makeRecord(folly::StringPiece url) {
+  AccessLogRecord record;
+  record.time = SystemClock::from_time_t(0);
+  record.client = folly::SocketAddress("10.0.0.1", 1234);
+  record.setMethod("GET");
+  record.setURL(url);
+  record.status = 200;
+  record.bytesOut = 42;
+  record.latency = std::chrono::microseconds(7);
+  return record;
+}
+
+} // namespace
+
+TEST(AccessLogWriterTest, Format) {
+  std::string line;
+  auto record = makeRecord("/path?q=1");
+  AccessLogWriter::formatRecord(record, line);
+  EXPECT_EQ(line,
+            "10.0.0.1 - - [01/Jan/1970:00:00:00 +0000] \"GET /path?q=1\" 200 "
+            "42 7\n");
+
+  line.clear();
+  record.error = kErrorTimeout;
+  record.setURL(std::string(1000, 'a'));
+  AccessLogWriter::formatRecord(record, line);
+  EXPECT_EQ(record.getURL().size(), AccessLogRecord::kMaxURL);
+  EXPECT_NE(line.find(getErrorString(kErrorTimeout)), std::string::npos);
+}
+
+TEST(AccessLogWriterTest, WritesOnDestruction) {
+  TestSink sink;
+  auto writer = std::make_unique<AccessLogWriter>(sink.sink());
+  auto producer = writer->makeProducer();
+  producer->push(makeRecord("/a"));
+  producer->push(makeRecord("/b"));
+  producer.reset();
+  writer.reset();
+  EXPECT_NE(sink.lines.find("GET /a"), std::string::npos);
+  EXPECT_NE(sink.lines.find("GET /b"), std::string::npos);
+}
+
+TEST(AccessLogWriterTest, DropWhenFull) {
+  TestSink sink;
+  AccessLogWriter::Options options;
+  options.queueSize = 1;
+  options.flushInterval = std::chrono::hours(1);
+  auto writer = std::make_unique<AccessLogWriter>(sink.sink(), options);
+  auto producer = writer->makeProducer();
+  producer->push(makeRecord("/a"));
+  producer->push(makeRecord("/b"));
+  producer->push(makeRecord("/c"));
+  EXPECT_EQ(writer->getDropped(), 2);
+  writer.reset();
+  EXPECT_NE(sink.lines.find("GET /a"), std::string::npos);
+  EXPECT_EQ(sink.lines.find("GET /b"), std::string::npos);
+}
+
+TEST(AccessLogWriterTest, BlockWhenFull) {
+  TestSink sink;
+  AccessLogWriter::Options options;
+  options.queueSize = 1;
+  options.dropPolicy = AccessLogWriter::DropPolicy::BLOCK;
+  options.flushInterval = std::chrono::milliseconds(1);
+  auto writer = std::make_unique<AccessLogWriter>(sink.sink(), options);
+  auto producer = writer->makeProducer();
+  for (int i = 0; i < 100; i++) {
+    producer->push(makeRecord("/" + std::to_string(i)));
+  }
+  EXPECT_EQ(writer->getDropped(), 0);
+  producer.reset();
+  writer.reset();
+  EXPECT_EQ(std::count(sink.lines.begin(), sink.lines.end(), '\n'), 100);
+}
+
+TEST(AccessLogFilterTest, LogsRequest) {
+  TestSink sink;
+  auto writer = std::make_shared<AccessLogWriter>(sink.sink());
+  AccessLogFilterFactory factory(writer);
+  factory.onServerStart(nullptr);
+
+  MockRequestHandler handler;
+  auto msg = std::make_unique<HTTPMessage>();
+  msg->setMethod(HTTPMethod::POST);
+  msg->setURL("/upload");
+  auto filter = factory.onRequest(&handler, msg.get());
+  EXPECT_NE(dynamic_cast<AccessLogFilter*>(filter), nullptr);
+
+  EXPECT_CALL(handler, onRequest(_));
+  filter->onRequest(std::move(msg));
+  EXPECT_CALL(handler, onBody(_));
+  filter->onBody(folly::IOBuf::copyBuffer("hello"));
+  EXPECT_CALL(handler, requestComplete());
+  filter->requestComplete();
+
+  factory.onServerStop();
+  writer.reset();
+  EXPECT_NE(sink.lines.find("\"POST /upload\""), std::string::npos);
+}
+
+TEST(AccessLogFilterTest, NotSampled) {
+  TestSink sink;
+  AccessLogFilterFactory factory(
+      std::make_shared<AccessLogWriter>(sink.sink()), 0.0);
+  factory.onServerStart(nullptr);
+  MockRequestHandler handler;
+  HTTPMessage msg;
+  EXPECT_EQ(factory.onRequest(&handler, &msg), &handler);
+  factory.onServerStop();
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/AdmissionControlFilter.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+// Builds the same handler for every request
+class TestHandlerFactory : public RequestHandlerFactory {
+ public:
+  explicit TestHandlerFactory(RequestHandler* handler) : handler_(handler) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* /*upstream*/,
+                            HTTPMessage* /*msg*/) noexcept override {
+    return handler_;
+  }
+
+ private:
+  RequestHandler* handler_;
+};
+
+} // namespace
+
+TEST(ConcurrencyLimiterTest, AIMD) {
+  ConcurrencyLimiter::Config config;
+  config.initialLimit = 2;
+  config.maxLimit = 3;
+  config.backoffRatio = 0.5;
+  config.latencyThreshold = std::chrono::milliseconds(100);
+  ConcurrencyLimiter limiter(config);
+
+  EXPECT_TRUE(limiter.tryAcquire());
+  EXPECT_TRUE(limiter.tryAcquire());
+  EXPECT_FALSE(limiter.tryAcquire());
+  EXPECT_EQ(limiter.getInflight(), 2);
+
+  limiter.release(std::chrono::milliseconds(1), false);
+  EXPECT_EQ(limiter.getLimit(), 3);
+  // Not grown while mostly unused
+  limiter.release(std::chrono::milliseconds(1), false);
+  EXPECT_EQ(limiter.getLimit(), 3);
+  EXPECT_TRUE(limiter.tryAcquire());
+  EXPECT_TRUE(limiter.tryAcquire());
+  limiter.release(std::chrono::milliseconds(1), false);
+  // Up to maxLimit
+  EXPECT_EQ(limiter.getLimit(), 3);
+
+  limiter.release(std::chrono::milliseconds(200), false);
+  EXPECT_EQ(limiter.getLimit(), 1);
+  EXPECT_TRUE(limiter.tryAcquire());
+  limiter.release(std::chrono::milliseconds(1), true);
+  // Down to minLimit
+  EXPECT_EQ(limiter.getLimit(), 1);
+}
+
+TEST(AdmissionControlFilterTest, ShedsOverLimit) {
+  MockRequestHandler handler;
+  ConcurrencyLimiter::Config config;
+  config.initialLimit = 1;
+  config.maxLimit = 1;
+  AdmissionControlFilterFactory factory(
+      std::make_unique<TestHandlerFactory>(&handler), {config, config},
+      [](const HTTPMessage& msg) -> size_t {
+        return msg.getPathAsStringPiece() == "/low" ? 1 : 0;
+      });
+  factory.onServerStart(nullptr);
+
+  HTTPMessage msg;
+  msg.setURL("/");
+  auto admitted = factory.onRequest(nullptr, &msg);
+  EXPECT_NE(dynamic_cast<AdmissionControlFilter*>(admitted), nullptr);
+  EXPECT_EQ(factory.getLimiter(0).getInflight(), 1);
+
+  std::unique_ptr<RequestHandler> shed(factory.onRequest(nullptr, &msg));
+  EXPECT_NE(dynamic_cast<DirectResponseHandler*>(shed.get()), nullptr);
+
+  // Another class has its own limit
+  msg.setURL("/low");
+  auto low = factory.onRequest(nullptr, &msg);
+  EXPECT_NE(dynamic_cast<AdmissionControlFilter*>(low), nullptr);
+
+  EXPECT_CALL(handler, requestComplete());
+  admitted->requestComplete();
+  EXPECT_EQ(factory.getLimiter(0).getInflight(), 0);
+  EXPECT_CALL(handler, onError(kErrorTimeout));
+  low->onError(kErrorTimeout);
+  EXPECT_EQ(factory.getLimiter(1).getInflight(), 0);
+  factory.onServerStop();
+}
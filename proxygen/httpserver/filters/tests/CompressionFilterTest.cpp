@@ -19,6 +19,9 @@
 #include <proxygen/httpserver/filters/CompressionFilter.h>
 #include <proxygen/lib/utils/ZlibStreamCompressor.h>
 #include <proxygen/lib/utils/ZstdStreamDecompressor.h>
+#ifdef PROXYGEN_HAVE_BROTLI
+#include <proxygen/lib/utils/BrotliStreamDecompressor.h>
+#endif
 
 using namespace proxygen;
 using namespace testing;
@@ -58,6 +61,20 @@ struct ZstdTest {
   }
 };
 
+#ifdef PROXYGEN_HAVE_BROTLI
+struct BrotliTest {
+  static std::unique_ptr<StreamDecompressor> makeDecompressor() {
+    return std::make_unique<BrotliStreamDecompressor>();
+  }
+  static std::string getExpectedEncoding() {
+    return "br";
+  }
+  static int32_t getCompressionLevel() {
+    return 4 /* default */;
+  }
+};
+#endif
+
 template <typename T>
 class CompressionFilterTest : public Test {
  public:
@@ -182,6 +199,7 @@ class CompressionFilterTest : public Test {
     opts.minimumCompressionSize = minimumCompressionSize;
     opts.compressibleContentTypes = compressibleTypes;
     opts.enableZstd = true;
+    opts.enableBrotli = true;
     if (disableCompressionForThisEncoding) {
       if (CodecType::getExpectedEncoding() == "gzip") {
         opts.enableGzip = false;
@@ -189,6 +207,9 @@ class CompressionFilterTest : public Test {
       if (CodecType::getExpectedEncoding() == "zstd") {
         opts.enableZstd = false;
       }
+      if (CodecType::getExpectedEncoding() == "br") {
+        opts.enableBrotli = false;
+      }
     }
     auto filterFactory = std::make_unique<CompressionFilterFactory>(opts);
 
@@ -259,7 +280,11 @@ class CompressionFilterTest : public Test {
   }
 };
 
+#ifdef PROXYGEN_HAVE_BROTLI
+typedef ::testing::Types<ZlibTest, ZstdTest, BrotliTest> CompressionCodecs;
+#else
 typedef ::testing::Types<ZlibTest, ZstdTest> CompressionCodecs;
+#endif
 
 TYPED_TEST_SUITE(CompressionFilterTest, CompressionCodecs);
 
@@ -541,6 +566,7 @@ TYPED_TEST(CompressionFilterTest, NoResponseBody) {
     opts.minimumCompressionSize = minimumCompressionSize;
     opts.compressibleContentTypes = compressibleTypes;
     opts.enableZstd = true;
+    opts.enableBrotli = true;
     auto filterFactory = std::make_unique<CompressionFilterFactory>(opts);
 
     auto filter = filterFactory->onRequest(requestHandler, &msg);
@@ -559,3 +585,136 @@ TYPED_TEST(CompressionFilterTest, NoResponseBody) {
     filter->requestComplete();
   });
 }
+
+TEST(CompressionFilterUtilsTest, QvalueNegotiation) {
+  CompressionFilterUtils::FactoryOptions opts;
+  opts.enableZstd = true;
+  auto getEncoding = [&opts](const std::string& acceptEncoding) {
+    HTTPMessage msg;
+    msg.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, acceptEncoding);
+    auto params = CompressionFilterUtils::getFilterParams(msg, opts);
+    return params ? params->headerEncoding : std::string();
+  };
+
+  // The highest qvalue wins, regardless of the order
+  EXPECT_EQ(getEncoding("zstd;q=0.5, gzip;q=0.8"), "gzip");
+  EXPECT_EQ(getEncoding("gzip;q=0.5, zstd"), "zstd");
+  // Ties go to the server's preference
+  EXPECT_EQ(getEncoding("gzip, zstd"), "zstd");
+  // q=0 means not acceptable
+  EXPECT_EQ(getEncoding("gzip;q=0"), "");
+  EXPECT_EQ(getEncoding("zstd;q=0, gzip;q=0.1"), "gzip");
+  // The wildcard stands for the codings not listed
+  EXPECT_EQ(getEncoding("*"), "zstd");
+  EXPECT_EQ(getEncoding("zstd;q=0, *;q=0.5"), "gzip");
+  EXPECT_EQ(getEncoding("identity, *;q=0"), "");
+
+  opts.enableZstd = false;
+  EXPECT_EQ(getEncoding("zstd, gzip;q=0.1"), "gzip");
+#ifdef PROXYGEN_HAVE_BROTLI
+  opts.enableBrotli = true;
+  EXPECT_EQ(getEncoding("gzip, deflate, br"), "br");
+  EXPECT_EQ(getEncoding("br;q=0.5, gzip"), "gzip");
+#endif
+}
+
+TEST(CompressionFilterCacheTest, ServesCachedBody) {
+  auto cache = std::make_shared<CompressedResponseCache>(
+      CompressedResponseCache::Options());
+  CompressionFilterFactory::Options opts;
+  opts.minimumCompressionSize = 1;
+  opts.compressibleContentTypes = {"text/html"};
+  opts.responseCache = cache;
+  CompressionFilterFactory filterFactory(opts);
+
+  auto sendResponse = [&](const std::string& etag,
+                          const std::string& host = "a.test",
+                          const std::string& text = "Hello World") {
+    auto requestHandler = std::make_unique<MockRequestHandler>();
+    MockResponseHandler responseHandler(requestHandler.get());
+    ResponseHandler* downstream{nullptr};
+    EXPECT_CALL(*requestHandler, onEOM()).Times(1);
+    EXPECT_CALL(*requestHandler, setResponseHandler(_))
+        .WillOnce(DoAll(SaveArg<0>(&downstream), Return()));
+    EXPECT_CALL(*requestHandler, requestComplete()).Times(1);
+    EXPECT_CALL(responseHandler, sendHeaders(_)).Times(1);
+    EXPECT_CALL(responseHandler, sendEOM()).Times(1);
+    std::unique_ptr<folly::IOBuf> decompressed;
+    EXPECT_CALL(responseHandler, sendBody(_))
+        .WillOnce(Invoke([&](std::shared_ptr<folly::IOBuf> body) {
+          ZlibStreamDecompressor zd(CompressionType::GZIP);
+          decompressed = zd.decompress(body.get());
+          EXPECT_FALSE(zd.hasError());
+        }));
+
+    HTTPMessage msg;
+    msg.setURL("/app.js");
+    msg.getHeaders().set(HTTP_HEADER_HOST, host);
+    msg.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, "gzip");
+    auto filter = filterFactory.onRequest(requestHandler.get(), &msg);
+    filter->setResponseHandler(&responseHandler);
+    filter->onEOM();
+    ResponseBuilder builder(downstream);
+    builder.status(200, "OK")
+        .header(HTTP_HEADER_CONTENT_TYPE, "text/html")
+        .body(folly::IOBuf::copyBuffer(text));
+    if (!etag.empty()) {
+      builder.header(HTTP_HEADER_ETAG, etag);
+    }
+    builder.sendWithEOM();
+    filter->requestComplete();
+    Mock::VerifyAndClear(requestHandler.get());
+    return decompressed ? decompressed->moveToFbString().toStdString()
+                        : std::string();
+  };
+
+  // Keyed by digest
+  EXPECT_EQ(sendResponse(""), "Hello World");
+  EXPECT_EQ(sendResponse(""), "Hello World");
+  auto stats = cache->getStats();
+  EXPECT_EQ(stats.insertions, 1);
+  EXPECT_EQ(stats.hits, 1);
+
+  // Keyed by URL and ETag
+  EXPECT_EQ(sendResponse("\"v1\""), "Hello World");
+  EXPECT_EQ(sendResponse("\"v1\""), "Hello World");
+  stats = cache->getStats();
+  EXPECT_EQ(stats.insertions, 2);
+  EXPECT_EQ(stats.hits, 2);
+
+  // The same path and ETag on another virtual host is another resource
+  EXPECT_EQ(sendResponse("\"v1\"", "b.test", "Goodbye World"),
+            "Goodbye World");
+  EXPECT_EQ(sendResponse("\"v1\"", "b.test", "Goodbye World"),
+            "Goodbye World");
+  EXPECT_EQ(sendResponse("\"v1\""), "Hello World");
+  stats = cache->getStats();
+  EXPECT_EQ(stats.insertions, 3);
+  EXPECT_EQ(stats.hits, 4);
+}
+
+TEST(CompressionFilterUtilsTest, DczNegotiation) {
+  auto dictionary =
+      std::make_shared<const ZstdDictionary>(std::string(1024, 'x'), 3);
+  CompressionFilterUtils::FactoryOptions opts;
+  opts.enableZstd = true;
+  opts.zstdDictionaries = std::make_shared<const ZstdDictionaryStore>(
+      std::vector<std::shared_ptr<const ZstdDictionary>>{dictionary});
+  auto getEncoding = [&opts](const std::string& acceptEncoding,
+                             const std::string& availableDictionary) {
+    HTTPMessage msg;
+    msg.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, acceptEncoding);
+    msg.getHeaders().set(CompressionFilterUtils::kAvailableDictionary,
+                         availableDictionary);
+    auto params = CompressionFilterUtils::getFilterParams(msg, opts);
+    return params ? params->headerEncoding : std::string();
+  };
+
+  const auto& header = dictionary->getHashHeaderValue();
+  EXPECT_EQ(getEncoding("gzip, zstd, dcz", header), "dcz");
+  EXPECT_EQ(getEncoding("gzip, zstd, dcz;q=0", header), "zstd");
+  EXPECT_EQ(getEncoding("gzip, zstd", header), "zstd");
+  EXPECT_EQ(getEncoding("gzip, zstd, dcz", ":AAAA:"), "zstd");
+  opts.enableZstd = false;
+  EXPECT_EQ(getEncoding("gzip, zstd, dcz", header), "gzip");
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/DecompressionFilter.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+
+using namespace proxygen;
+using namespace testing;
+
+class DecompressionFilterTest : public Test {
+ public:
+  void SetUp() override {
+    // requesthandler is the server, responsehandler is the client
+    requestHandler_ = std::make_unique<MockRequestHandler>();
+    responseHandler_ =
+        std::make_unique<MockResponseHandler>(requestHandler_.get());
+  }
+
+ protected:
+  void createFilter(BodyDecompressor::Options options = {}) {
+    EXPECT_CALL(*requestHandler_, setResponseHandler(_))
+        .WillOnce(SaveArg<0>(&downstream_));
+    filter_ = new DecompressionFilter(requestHandler_.get(), options);
+    filter_->setResponseHandler(responseHandler_.get());
+  }
+
+  std::unique_ptr<HTTPMessage> makeRequest(const std::string& encoding) {
+    auto msg = std::make_unique<HTTPMessage>();
+    msg->setMethod(HTTPMethod::POST);
+    msg->setURL("/upload");
+    msg->getHeaders().set(HTTP_HEADER_CONTENT_ENCODING, encoding);
+    return msg;
+  }
+
+  static std::unique_ptr<folly::IOBuf> gzip(const std::string& body) {
+    ZlibStreamCompressor compressor(CompressionType::GZIP, 6);
+    auto in = folly::IOBuf::copyBuffer(body);
+    return compressor.compress(in.get(), true);
+  }
+
+  std::unique_ptr<MockRequestHandler> requestHandler_;
+  std::unique_ptr<MockResponseHandler> responseHandler_;
+  DecompressionFilter* filter_{nullptr};
+  ResponseHandler* downstream_{nullptr};
+  std::string received_;
+};
+
+TEST_F(DecompressionFilterTest, FactorySkipsIdentity) {
+  DecompressionFilterFactory factory(BodyDecompressor::Options{});
+  auto msg = makeRequest("identity");
+  EXPECT_EQ(factory.onRequest(requestHandler_.get(), msg.get()),
+            requestHandler_.get());
+  msg = makeRequest("gzip");
+  auto handler = factory.onRequest(requestHandler_.get(), msg.get());
+  EXPECT_NE(handler, requestHandler_.get());
+  delete handler;
+}
+
+TEST_F(DecompressionFilterTest, HoldsBodyWhilePaused) {
+  BodyDecompressor::Options options;
+  options.inputStepBytes = 16;
+  createFilter(options);
+  std::string body;
+  for (int i = 0; i < 2000; i++) {
+    body += folly::to<std::string>(i);
+  }
+
+  EXPECT_CALL(*requestHandler_, onRequest(_))
+      .WillOnce(Invoke([](std::shared_ptr<HTTPMessage> msg) {
+        EXPECT_FALSE(
+            msg->getHeaders().exists(HTTP_HEADER_CONTENT_ENCODING));
+      }));
+  filter_->onRequest(makeRequest("gzip"));
+
+  EXPECT_CALL(*responseHandler_, pauseIngress());
+  EXPECT_CALL(*requestHandler_, onBody(_))
+      .WillOnce(Invoke([this](std::shared_ptr<folly::IOBuf> buf) {
+        received_ += buf->cloneCoalescedAsValue().moveToFbString();
+        downstream_->pauseIngress();
+      }));
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  filter_->onBody(gzip(body));
+  filter_->onEOM();
+  Mock::VerifyAndClearExpectations(requestHandler_.get());
+
+  EXPECT_CALL(*requestHandler_, onBody(_))
+      .WillRepeatedly(Invoke([this](std::shared_ptr<folly::IOBuf> buf) {
+        received_ += buf->cloneCoalescedAsValue().moveToFbString();
+      }));
+  EXPECT_CALL(*requestHandler_, onEOM());
+  EXPECT_CALL(*responseHandler_, resumeIngress());
+  downstream_->resumeIngress();
+  EXPECT_EQ(body, received_);
+
+  EXPECT_CALL(*requestHandler_, requestComplete());
+  filter_->requestComplete();
+}
+
+TEST_F(DecompressionFilterTest, AbortsOnCorruptBody) {
+  createFilter();
+  EXPECT_CALL(*requestHandler_, onRequest(_));
+  filter_->onRequest(makeRequest("gzip"));
+
+  EXPECT_CALL(*requestHandler_, onBody(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  EXPECT_CALL(*responseHandler_, sendAbort());
+  filter_->onBody(folly::IOBuf::copyBuffer("this is not gzip data"));
+  filter_->onEOM();
+
+  EXPECT_CALL(*requestHandler_, onError(_));
+  filter_->onError(kErrorStreamAbort);
+}
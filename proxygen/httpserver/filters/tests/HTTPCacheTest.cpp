@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseManager.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/filters/HTTPCacheFilter.h>
+
+using namespace proxygen;
+using namespace testing;
+using std::chrono::seconds;
+
+namespace {
+
+HTTPMessage makeRequest(HTTPMethod method = HTTPMethod::GET,
+                        const std::string& url = "/resource") {
+  HTTPMessage request;
+  request.setMethod(method);
+  request.setURL(url);
+  request.getHeaders().set(HTTP_HEADER_HOST, "origin.test");
+  return request;
+}
+
+HTTPMessage makeResponse(const std::string& cacheControl,
+                         uint16_t status = 200) {
+  HTTPMessage response;
+  response.setStatusCode(status);
+  response.setStatusMessage(HTTPMessage::getDefaultReason(status));
+  if (!cacheControl.empty()) {
+    response.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, cacheControl);
+  }
+  return response;
+}
+
+std::shared_ptr<HTTPCache::Entry> makeEntry(HTTPCache& cache,
+                                            const HTTPMessage& request,
+                                            const HTTPMessage& response,
+                                            const std::string& body,
+                                            TimePoint now) {
+  auto entry = cache.makeEntry(request, response, now);
+  if (entry) {
+    entry->body = folly::IOBuf::copyBuffer(body);
+  }
+  return entry;
+}
+
+// Answers with a copy of response, counting the requests
+class TestOrigin : public RequestHandler {
+ public:
+  TestOrigin(const HTTPMessage& response,
+             const std::string& body,
+             std::vector<HTTPMessage>& requests)
+      : response_(response), body_(body), requests_(requests) {
+  }
+
+  void onRequest(std::unique_ptr<HTTPMessage> headers) noexcept override {
+    requests_.push_back(*headers);
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {
+  }
+
+  void onUpgrade(UpgradeProtocol /*prot*/) noexcept override {
+  }
+
+  void onEOM() noexcept override {
+    downstream_->sendHeaders(response_);
+    if (!body_.empty()) {
+      downstream_->sendBody(folly::IOBuf::copyBuffer(body_));
+    }
+    downstream_->sendEOM();
+  }
+
+  void requestComplete() noexcept override {
+    delete this;
+  }
+
+  void onError(ProxygenError /*err*/) noexcept override {
+    delete this;
+  }
+
+ private:
+  HTTPMessage response_;
+  std::string body_;
+  std::vector<HTTPMessage>& requests_;
+};
+
+class TestOriginFactory : public RequestHandlerFactory {
+ public:
+  TestOriginFactory(HTTPMessage& response,
+                    std::string& body,
+                    std::vector<HTTPMessage>& requests)
+      : response_(response), body_(body), requests_(requests) {
+  }
+
+  void onServerStart(folly::EventBase* /*evb*/) noexcept override {
+  }
+
+  void onServerStop() noexcept override {
+  }
+
+  RequestHandler* onRequest(RequestHandler* /*upstream*/,
+                            HTTPMessage* /*msg*/) noexcept override {
+    return new TestOrigin(response_, body_, requests_);
+  }
+
+ private:
+  HTTPMessage& response_;
+  std::string& body_;
+  std::vector<HTTPMessage>& requests_;
+};
+
+} // namespace
+
+TEST(CacheControlTest, Parse) {
+  HTTPHeaders headers;
+  headers.add(HTTP_HEADER_CACHE_CONTROL, "public, max-age=60");
+  headers.add(HTTP_HEADER_CACHE_CONTROL,
+              "S-MAXAGE=\"120\", stale-while-revalidate=30, must-revalidate");
+  auto cc = CacheControl::parse(headers);
+  EXPECT_FALSE(cc.noStore);
+  EXPECT_FALSE(cc.isPrivate);
+  EXPECT_TRUE(cc.mustRevalidate);
+  EXPECT_EQ(cc.maxAge, seconds(60));
+  EXPECT_EQ(cc.sMaxAge, seconds(120));
+  EXPECT_EQ(cc.staleWhileRevalidate, seconds(30));
+
+  headers.set(HTTP_HEADER_CACHE_CONTROL, "no-store, private, max-age=-1");
+  cc = CacheControl::parse(headers);
+  EXPECT_TRUE(cc.noStore);
+  EXPECT_TRUE(cc.isPrivate);
+  EXPECT_FALSE(cc.maxAge);
+}
+
+TEST(HTTPCacheTest, Freshness) {
+  HTTPCache cache{HTTPCache::Options()};
+  auto now = getCurrentTime();
+  auto request = makeRequest();
+  auto response = makeResponse("max-age=60, stale-while-revalidate=30");
+  response.getHeaders().set(HTTP_HEADER_AGE, "10");
+  auto key = HTTPCache::makeKey(request);
+  cache.insert(key, makeEntry(cache, request, response, "body", now));
+
+  auto result = cache.lookup(request, now);
+  EXPECT_EQ(result.status, HTTPCache::LookupStatus::FRESH);
+  EXPECT_EQ(result.entry->body->to<std::string>(), "body");
+  EXPECT_EQ(result.entry->getAge(now), seconds(10));
+  EXPECT_EQ(cache.lookup(request, now + seconds(55)).status,
+            HTTPCache::LookupStatus::STALE_WHILE_REVALIDATE);
+  EXPECT_EQ(cache.lookup(request, now + seconds(85)).status,
+            HTTPCache::LookupStatus::STALE);
+
+  // The request may ask for a fresher response
+  request.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "max-age=5");
+  EXPECT_EQ(cache.lookup(request, now).status, HTTPCache::LookupStatus::STALE);
+  request.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "no-cache");
+  EXPECT_EQ(cache.lookup(request, now).status, HTTPCache::LookupStatus::STALE);
+
+  EXPECT_EQ(cache.lookup(makeRequest(HTTPMethod::GET, "/other"), now).status,
+            HTTPCache::LookupStatus::MISS);
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.staleHits, 1);
+  EXPECT_EQ(stats.misses, 4);
+  EXPECT_EQ(stats.entries, 1);
+}
+
+TEST(HTTPCacheTest, HeuristicFreshness) {
+  HTTPCache cache{HTTPCache::Options()};
+  auto request = makeRequest();
+  auto response = makeResponse("");
+  response.getHeaders().set(HTTP_HEADER_DATE, "Sun, 06 Nov 1994 08:49:37 GMT");
+  response.getHeaders().set(HTTP_HEADER_LAST_MODIFIED,
+                            "Sun, 06 Nov 1994 07:49:37 GMT");
+  auto entry = cache.makeEntry(request, response);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->freshness, seconds(360));
+
+  response.getHeaders().remove(HTTP_HEADER_LAST_MODIFIED);
+  response.getHeaders().set(HTTP_HEADER_EXPIRES,
+                            "Sun, 06 Nov 1994 08:50:37 GMT");
+  entry = cache.makeEntry(request, response);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->freshness, seconds(60));
+}
+
+TEST(HTTPCacheTest, NotStored) {
+  HTTPCache cache{HTTPCache::Options()};
+  auto request = makeRequest();
+  EXPECT_FALSE(cache.makeEntry(request, makeResponse("no-store")));
+  EXPECT_FALSE(cache.makeEntry(request, makeResponse("private, max-age=60")));
+  EXPECT_FALSE(cache.makeEntry(request, makeResponse("max-age=60", 500)));
+  // Neither a lifetime nor a validator
+  EXPECT_FALSE(cache.makeEntry(request, makeResponse("")));
+  auto response = makeResponse("max-age=60");
+  response.getHeaders().set(HTTP_HEADER_SET_COOKIE, "id=1");
+  EXPECT_FALSE(cache.makeEntry(request, response));
+  response = makeResponse("max-age=60");
+  response.getHeaders().set(HTTP_HEADER_VARY, "*");
+  EXPECT_FALSE(cache.makeEntry(request, response));
+  EXPECT_FALSE(cache.makeEntry(makeRequest(HTTPMethod::POST),
+                               makeResponse("max-age=60")));
+
+  // Stored, to be revalidated on every use
+  response = makeResponse("no-cache, max-age=60");
+  response.getHeaders().set(HTTP_HEADER_ETAG, "\"v1\"");
+  auto entry = cache.makeEntry(request, response);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->freshness, seconds(0));
+
+  request.getHeaders().set(HTTP_HEADER_AUTHORIZATION, "Basic Zm9v");
+  EXPECT_FALSE(HTTPCache::isCacheableRequest(request));
+  EXPECT_FALSE(HTTPCache::isCacheableRequest(makeRequest(HTTPMethod::POST)));
+  EXPECT_TRUE(HTTPCache::isCacheableRequest(makeRequest(HTTPMethod::HEAD)));
+}
+
+TEST(HTTPCacheTest, Vary) {
+  HTTPCache cache{HTTPCache::Options()};
+  auto now = getCurrentTime();
+  auto response = makeResponse("max-age=60");
+  response.getHeaders().set(HTTP_HEADER_VARY, "Accept-Encoding");
+  auto gzip = makeRequest();
+  gzip.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, "gzip");
+  auto identity = makeRequest();
+  auto key = HTTPCache::makeKey(gzip);
+  cache.insert(key, makeEntry(cache, gzip, response, "gzipped", now));
+  EXPECT_EQ(cache.lookup(identity, now).status, HTTPCache::LookupStatus::MISS);
+  cache.insert(key, makeEntry(cache, identity, response, "plain", now));
+
+  auto result = cache.lookup(gzip, now);
+  ASSERT_EQ(result.status, HTTPCache::LookupStatus::FRESH);
+  EXPECT_EQ(result.entry->body->to<std::string>(), "gzipped");
+  result = cache.lookup(identity, now);
+  ASSERT_EQ(result.status, HTTPCache::LookupStatus::FRESH);
+  EXPECT_EQ(result.entry->body->to<std::string>(), "plain");
+
+  // One key for both variants
+  EXPECT_EQ(cache.getStats().entries, 1);
+  cache.invalidate(key);
+  EXPECT_EQ(cache.lookup(gzip, now).status, HTTPCache::LookupStatus::MISS);
+  EXPECT_EQ(cache.getStats().bytes, 0);
+}
+
+TEST(HTTPCacheTest, Freshen) {
+  HTTPCache cache{HTTPCache::Options()};
+  auto now = getCurrentTime();
+  auto request = makeRequest();
+  auto response = makeResponse("max-age=10");
+  response.getHeaders().set(HTTP_HEADER_ETAG, "\"v1\"");
+  response.getHeaders().set("X-Version", "1");
+  auto key = HTTPCache::makeKey(request);
+  auto entry = makeEntry(cache, request, response, "body", now);
+  cache.insert(key, entry);
+
+  auto later = now + seconds(20);
+  auto result = cache.lookup(request, later);
+  ASSERT_EQ(result.status, HTTPCache::LookupStatus::STALE);
+  auto notModified = makeResponse("max-age=100", 304);
+  notModified.getHeaders().set("X-Version", "2");
+  notModified.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH, "0");
+  cache.freshen(key, *result.entry, notModified, later);
+
+  result = cache.lookup(request, later);
+  ASSERT_EQ(result.status, HTTPCache::LookupStatus::FRESH);
+  EXPECT_EQ(result.entry->freshness, seconds(100));
+  const auto& headers = result.entry->response.getHeaders();
+  EXPECT_EQ(headers.getSingleOrEmpty("X-Version"), "2");
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_ETAG), "\"v1\"");
+  EXPECT_FALSE(headers.exists(HTTP_HEADER_CONTENT_LENGTH));
+  EXPECT_EQ(result.entry->body->to<std::string>(), "body");
+}
+
+TEST(HTTPCacheTest, CollapsedFills) {
+  HTTPCache cache{HTTPCache::Options()};
+  folly::EventBase evb;
+  int woken = 0;
+  EXPECT_TRUE(cache.startFill("key", &evb, [&] { woken++; }));
+  EXPECT_FALSE(cache.startFill("key", &evb, [&] { woken++; }));
+  EXPECT_FALSE(cache.startFill("key", &evb, [&] { woken++; }));
+  EXPECT_TRUE(cache.startFill("other", &evb, [&] { woken++; }));
+  cache.endFill("key");
+  EXPECT_EQ(woken, 0);
+  evb.loopOnce();
+  EXPECT_EQ(woken, 2);
+  EXPECT_TRUE(cache.startFill("key", &evb, [&] { woken++; }));
+  EXPECT_EQ(cache.getStats().collapsed, 2);
+}
+
+TEST(HTTPCacheTest, DiskTier) {
+  folly::test::TemporaryDirectory dir;
+  HTTPCache::Options options;
+  options.numShards = 1;
+  options.maxBytes = 2048;
+  options.diskPath = (dir.path() / "cache").string();
+  options.diskBytes = 64 * 1024;
+  HTTPCache cache{options};
+  auto now = getCurrentTime();
+  auto response = makeResponse("max-age=60");
+  response.getHeaders().set(HTTP_HEADER_ETAG, "\"v1\"");
+  std::string body(1000, 'a');
+  auto first = makeRequest(HTTPMethod::GET, "/first");
+  auto second = makeRequest(HTTPMethod::GET, "/second");
+  cache.insert(HTTPCache::makeKey(first),
+               makeEntry(cache, first, response, body, now));
+  cache.insert(HTTPCache::makeKey(second),
+               makeEntry(cache, second, response, body, now));
+  EXPECT_EQ(cache.getStats().evictions, 1);
+
+  auto result = cache.lookup(first, now);
+  ASSERT_EQ(result.status, HTTPCache::LookupStatus::FRESH);
+  EXPECT_EQ(result.entry->body->to<std::string>(), body);
+  EXPECT_EQ(result.entry->response.getHeaders().getSingleOrEmpty(
+                HTTP_HEADER_ETAG),
+            "\"v1\"");
+  EXPECT_EQ(result.entry->freshness, seconds(60));
+  EXPECT_EQ(cache.getStats().diskHits, 1);
+  // Back in memory, second took its place on disk
+  EXPECT_EQ(cache.lookup(second, now).status,
+            HTTPCache::LookupStatus::FRESH);
+  EXPECT_EQ(cache.getStats().diskHits, 2);
+}
+
+class HTTPCacheFilterTest : public testing::Test {
+ public:
+  void SetUp() override {
+    response_ = makeResponse("max-age=60");
+    response_.getHeaders().set(HTTP_HEADER_ETAG, "\"v1\"");
+    cache_ = std::make_shared<HTTPCache>(HTTPCache::Options());
+    factory_ = std::make_unique<HTTPCacheFilterFactory>(
+        std::make_unique<TestOriginFactory>(response_, body_, requests_),
+        cache_);
+  }
+
+  // The status and body of the response to request
+  std::pair<uint16_t, std::string> send(HTTPMessage request) {
+    uint16_t status = 0;
+    std::string body;
+    auto handler = factory_->onRequest(nullptr, &request);
+    NiceMock<MockResponseHandler> downstream(handler);
+    EXPECT_CALL(downstream, sendHeaders(_))
+        .WillOnce(Invoke([&status](HTTPMessage& response) {
+          status = response.getStatusCode();
+        }));
+    EXPECT_CALL(downstream, sendBody(_))
+        .WillRepeatedly(Invoke([&body](std::shared_ptr<folly::IOBuf> chain) {
+          body += chain->to<std::string>();
+        }));
+    EXPECT_CALL(downstream, sendEOM());
+    handler->setResponseHandler(&downstream);
+    handler->onRequest(std::make_unique<HTTPMessage>(request));
+    handler->onEOM();
+    handler->requestComplete();
+    return {status, body};
+  }
+
+ protected:
+  HTTPMessage response_;
+  std::string body_{"hello"};
+  std::vector<HTTPMessage> requests_;
+  std::shared_ptr<HTTPCache> cache_;
+  std::unique_ptr<HTTPCacheFilterFactory> factory_;
+};
+
+TEST_F(HTTPCacheFilterTest, MissThenHit) {
+  EXPECT_EQ(send(makeRequest()), std::make_pair(uint16_t(200), body_));
+  EXPECT_EQ(send(makeRequest()), std::make_pair(uint16_t(200), body_));
+  EXPECT_EQ(requests_.size(), 1);
+
+  EXPECT_EQ(send(makeRequest(HTTPMethod::HEAD)),
+            std::make_pair(uint16_t(200), std::string()));
+  auto conditional = makeRequest();
+  conditional.getHeaders().set(HTTP_HEADER_IF_NONE_MATCH, "W/\"v1\"");
+  EXPECT_EQ(send(conditional), std::make_pair(uint16_t(304), std::string()));
+  EXPECT_EQ(requests_.size(), 1);
+}
+
+TEST_F(HTTPCacheFilterTest, Revalidation) {
+  response_.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "no-cache");
+  EXPECT_EQ(send(makeRequest()), std::make_pair(uint16_t(200), body_));
+
+  response_ = makeResponse("no-cache", 304);
+  body_.clear();
+  EXPECT_EQ(send(makeRequest()),
+            std::make_pair(uint16_t(200), std::string("hello")));
+  ASSERT_EQ(requests_.size(), 2);
+  EXPECT_EQ(
+      requests_[1].getHeaders().getSingleOrEmpty(HTTP_HEADER_IF_NONE_MATCH),
+      "\"v1\"");
+}
+
+TEST_F(HTTPCacheFilterTest, UnsafeInvalidates) {
+  send(makeRequest());
+  send(makeRequest(HTTPMethod::POST));
+  EXPECT_EQ(requests_.size(), 2);
+  send(makeRequest());
+  EXPECT_EQ(requests_.size(), 3);
+}
+
+TEST_F(HTTPCacheFilterTest, StaleWhileRevalidate) {
+  auto evb = folly::EventBaseManager::get()->getEventBase();
+  response_.getHeaders().set(HTTP_HEADER_CACHE_CONTROL,
+                             "max-age=0, stale-while-revalidate=60");
+  send(makeRequest());
+  // Served stale, revalidated in the background
+  EXPECT_EQ(send(makeRequest()), std::make_pair(uint16_t(200), body_));
+  EXPECT_EQ(requests_.size(), 2);
+  evb->loopOnce();
+  EXPECT_EQ(cache_->getStats().staleHits, 1);
+}
+
+TEST_F(HTTPCacheFilterTest, UncacheableResponseEndsFill) {
+  response_ = makeResponse("no-store");
+  auto request = makeRequest();
+  auto key = HTTPCache::makeKey(request);
+  folly::EventBase evb;
+  auto handler = factory_->onRequest(nullptr, &request);
+  NiceMock<MockResponseHandler> downstream(handler);
+  EXPECT_CALL(downstream, sendHeaders(_)).WillOnce(Invoke([&](HTTPMessage&) {
+    // Waiters need not wait for the body of a response never stored
+    EXPECT_TRUE(cache_->startFill(key, &evb, [] {}));
+    cache_->endFill(key);
+  }));
+  EXPECT_CALL(downstream, sendEOM());
+  handler->setResponseHandler(&downstream);
+  handler->onRequest(std::make_unique<HTTPMessage>(request));
+  handler->onEOM();
+  handler->requestComplete();
+  EXPECT_EQ(requests_.size(), 1);
+}
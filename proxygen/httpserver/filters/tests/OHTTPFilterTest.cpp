@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fizz/crypto/exchange/X25519.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/httpserver/filters/OHTTPGatewayFilter.h>
+#include <proxygen/httpserver/filters/OHTTPRelayFilter.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+
+using namespace proxygen;
+using namespace testing;
+using fizz::hpke::AeadId;
+using fizz::hpke::KDFId;
+using fizz::hpke::KEMId;
+
+namespace {
+
+const ohttp::SymmetricCipherSuite kSuite{KDFId::Sha256,
+                                         AeadId::TLS_AES_128_GCM_SHA256};
+
+std::unique_ptr<folly::IOBuf> encodeRequest(const std::string& body) {
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::POST);
+  msg.setSecure(true);
+  msg.setURL("/query");
+  msg.getHeaders().set(HTTP_HEADER_HOST, "www.example.com");
+  HTTPBinaryCodec codec(TransportDirection::DOWNSTREAM);
+  folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+  codec.generateHeader(writeBuf, 0, msg);
+  codec.generateBody(
+      writeBuf, 0, folly::IOBuf::copyBuffer(body), folly::none, true);
+  return writeBuf.move();
+}
+
+} // namespace
+
+class OHTTPFilterTest : public Test {
+ public:
+  void SetUp() override {
+    auto kex = std::make_unique<fizz::X25519KeyExchange>();
+    kex->generateKeyPair();
+    config_.keyId = 7;
+    config_.kem = KEMId::x25519;
+    config_.publicKey = kex->getKeyShare()->to<std::string>();
+    config_.cipherSuites.push_back(kSuite);
+    auto keys = std::make_shared<ohttp::KeyStore>();
+    keys->addKey(config_, std::move(kex));
+    keys_ = std::move(keys);
+
+    requestHandler_ = std::make_unique<MockRequestHandler>();
+    responseHandler_ =
+        std::make_unique<MockResponseHandler>(requestHandler_.get());
+  }
+
+ protected:
+  ohttp::EncapsulatedRequest encapsulate(std::unique_ptr<folly::IOBuf> buf) {
+    auto ephemeral = std::make_unique<fizz::X25519KeyExchange>();
+    ephemeral->generateKeyPair();
+    auto request = ohttp::encapsulateRequest(
+        config_, kSuite, std::move(ephemeral), std::move(buf));
+    EXPECT_TRUE(request.hasValue());
+    return std::move(*request);
+  }
+
+  void createGateway(OHTTPGatewayFilter::Options options = {}) {
+    EXPECT_CALL(*requestHandler_, setResponseHandler(_))
+        .WillOnce(SaveArg<0>(&downstream_));
+    gateway_ = new OHTTPGatewayFilter(requestHandler_.get(), keys_, options);
+    gateway_->setResponseHandler(responseHandler_.get());
+  }
+
+  static std::unique_ptr<HTTPMessage> makeOuterRequest() {
+    auto msg = std::make_unique<HTTPMessage>();
+    msg->setMethod(HTTPMethod::POST);
+    msg->setURL("/gateway");
+    msg->getHeaders().set(HTTP_HEADER_CONTENT_TYPE,
+                          ohttp::kRequestContentType.str());
+    return msg;
+  }
+
+  ohttp::KeyConfig config_;
+  std::shared_ptr<const ohttp::KeyStore> keys_;
+  std::unique_ptr<MockRequestHandler> requestHandler_;
+  std::unique_ptr<MockResponseHandler> responseHandler_;
+  OHTTPGatewayFilter* gateway_{nullptr};
+  ResponseHandler* downstream_{nullptr};
+};
+
+TEST_F(OHTTPFilterTest, KeyConfigsRoundTrip) {
+  auto serialized = keys_->serializeConfigs();
+  auto parsed = ohttp::parseKeyConfigs(*serialized);
+  ASSERT_TRUE(parsed.hasValue());
+  ASSERT_EQ(parsed->size(), 1);
+  EXPECT_EQ((*parsed)[0].keyId, config_.keyId);
+  EXPECT_EQ((*parsed)[0].kem, config_.kem);
+  EXPECT_EQ((*parsed)[0].publicKey, config_.publicKey);
+  ASSERT_EQ((*parsed)[0].cipherSuites.size(), 1);
+  EXPECT_EQ((*parsed)[0].cipherSuites[0].aead, kSuite.aead);
+
+  serialized->trimEnd(1);
+  EXPECT_TRUE(ohttp::parseKeyConfigs(*serialized).hasError());
+}
+
+TEST_F(OHTTPFilterTest, EncapsulationRoundTrip) {
+  auto request = encapsulate(folly::IOBuf::copyBuffer("request"));
+  auto decapsulated =
+      ohttp::decapsulateRequest(*keys_, request.request->clone());
+  ASSERT_TRUE(decapsulated.hasValue());
+  EXPECT_EQ(decapsulated->request->cloneCoalescedAsValue().moveToFbString(),
+            "request");
+
+  auto response = ohttp::encapsulateResponse(
+      decapsulated->responseContext, folly::IOBuf::copyBuffer("response"));
+  auto opened =
+      ohttp::decapsulateResponse(request.responseContext, std::move(response));
+  ASSERT_TRUE(opened.hasValue());
+  EXPECT_EQ((*opened)->cloneCoalescedAsValue().moveToFbString(), "response");
+}
+
+TEST_F(OHTTPFilterTest, DecapsulateRejectsTampering) {
+  auto request = encapsulate(folly::IOBuf::copyBuffer("request"));
+  request.request->coalesce();
+  // The key id
+  request.request->writableData()[0] ^= 1;
+  EXPECT_TRUE(
+      ohttp::decapsulateRequest(*keys_, request.request->clone()).hasError());
+  request.request->writableData()[0] ^= 1;
+  // The ciphertext
+  request.request->writableData()[request.request->length() - 1] ^= 1;
+  EXPECT_TRUE(
+      ohttp::decapsulateRequest(*keys_, std::move(request.request))
+          .hasError());
+}
+
+TEST_F(OHTTPFilterTest, GatewayFactory) {
+  OHTTPGatewayFilterFactory factory(keys_);
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::POST);
+  EXPECT_EQ(factory.onRequest(requestHandler_.get(), &msg),
+            requestHandler_.get());
+  msg.getHeaders().set(HTTP_HEADER_CONTENT_TYPE,
+                       ohttp::kRequestContentType.str());
+  auto handler = factory.onRequest(requestHandler_.get(), &msg);
+  EXPECT_NE(handler, requestHandler_.get());
+  delete handler;
+}
+
+TEST_F(OHTTPFilterTest, GatewayRoundTrip) {
+  createGateway();
+  auto request = encapsulate(encodeRequest("hello"));
+
+  std::string received;
+  EXPECT_CALL(*requestHandler_, onRequest(_))
+      .WillOnce(Invoke([](std::shared_ptr<HTTPMessage> msg) {
+        EXPECT_EQ(msg->getMethod(), HTTPMethod::POST);
+        EXPECT_EQ(msg->getPath(), "/query");
+        EXPECT_EQ(msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST),
+                  "www.example.com");
+      }));
+  EXPECT_CALL(*requestHandler_, onBody(_))
+      .WillOnce(Invoke([&](std::shared_ptr<folly::IOBuf> buf) {
+        received += buf->cloneCoalescedAsValue().moveToFbString();
+      }));
+  EXPECT_CALL(*requestHandler_, onEOM()).WillOnce(Invoke([this] {
+    ResponseBuilder(downstream_)
+        .status(201, "Created")
+        .header("x-inner", "1")
+        .body(folly::IOBuf::copyBuffer("world"))
+        .sendWithEOM();
+  }));
+
+  std::unique_ptr<folly::IOBuf> sealed;
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+      .WillOnce(Invoke([](HTTPMessage& msg) {
+        EXPECT_EQ(msg.getStatusCode(), 200);
+        EXPECT_EQ(msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE),
+                  ohttp::kResponseContentType);
+        EXPECT_FALSE(msg.getHeaders().exists("x-inner"));
+      }));
+  EXPECT_CALL(*responseHandler_, sendBody(_))
+      .WillOnce(Invoke([&](std::shared_ptr<folly::IOBuf> buf) {
+        sealed = buf->clone();
+      }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  gateway_->onRequest(makeOuterRequest());
+  gateway_->onBody(std::move(request.request));
+  gateway_->onEOM();
+  EXPECT_EQ(received, "hello");
+
+  ASSERT_TRUE(sealed);
+  auto opened =
+      ohttp::decapsulateResponse(request.responseContext, std::move(sealed));
+  ASSERT_TRUE(opened.hasValue());
+  HTTPBinaryCodec codec(TransportDirection::UPSTREAM);
+  FakeHTTPCodecCallback callback;
+  codec.setCallback(&callback);
+  codec.onIngress(**opened);
+  codec.onIngressEOF();
+  ASSERT_FALSE(callback.lastParseError);
+  EXPECT_EQ(callback.msg->getStatusCode(), 201);
+  EXPECT_EQ(callback.msg->getHeaders().getSingleOrEmpty("x-inner"), "1");
+  EXPECT_EQ(callback.data_.move()->moveToFbString(), "world");
+
+  EXPECT_CALL(*requestHandler_, requestComplete());
+  gateway_->requestComplete();
+}
+
+TEST_F(OHTTPFilterTest, GatewayRejectsUndecryptable) {
+  createGateway();
+  EXPECT_CALL(*requestHandler_, onRequest(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  InSequence enforceOrder;
+  EXPECT_CALL(*requestHandler_, onError(kErrorMethodNotSupported));
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+      .WillOnce(Invoke(
+          [](HTTPMessage& msg) { EXPECT_EQ(msg.getStatusCode(), 400); }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  gateway_->onRequest(makeOuterRequest());
+  gateway_->onBody(folly::IOBuf::copyBuffer("not an encapsulated request"));
+  gateway_->onEOM();
+
+  // The handler had its onError() already
+  EXPECT_CALL(*requestHandler_, requestComplete()).Times(0);
+  gateway_->requestComplete();
+}
+
+TEST_F(OHTTPFilterTest, GatewayRejectsLargeRequest) {
+  OHTTPGatewayFilter::Options options;
+  options.maxRequestBytes = 16;
+  createGateway(options);
+  EXPECT_CALL(*requestHandler_, onRequest(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onError(kErrorMethodNotSupported));
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+      .WillOnce(Invoke(
+          [](HTTPMessage& msg) { EXPECT_EQ(msg.getStatusCode(), 413); }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  gateway_->onRequest(makeOuterRequest());
+  gateway_->onBody(std::move(encapsulate(encodeRequest("hello")).request));
+  gateway_->onEOM();
+
+  EXPECT_CALL(*requestHandler_, requestComplete()).Times(0);
+  gateway_->requestComplete();
+}
+
+TEST_F(OHTTPFilterTest, GatewayRejectsGet) {
+  createGateway();
+  EXPECT_CALL(*requestHandler_, onRequest(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onBody(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  InSequence enforceOrder;
+  EXPECT_CALL(*requestHandler_, onError(kErrorMethodNotSupported));
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+      .WillOnce(Invoke(
+          [](HTTPMessage& msg) { EXPECT_EQ(msg.getStatusCode(), 405); }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  auto msg = makeOuterRequest();
+  msg->setMethod(HTTPMethod::GET);
+  gateway_->onRequest(std::move(msg));
+  gateway_->onBody(folly::IOBuf::copyBuffer("ignored"));
+  gateway_->onEOM();
+  // Not passed to the handler any more
+  gateway_->onEgressPaused();
+  gateway_->onEgressResumed();
+
+  EXPECT_CALL(*requestHandler_, requestComplete()).Times(0);
+  gateway_->requestComplete();
+}
+
+TEST_F(OHTTPFilterTest, RelayRejectsGet) {
+  EXPECT_CALL(*requestHandler_, setResponseHandler(_));
+  auto relay = new OHTTPRelayFilter(requestHandler_.get());
+  relay->setResponseHandler(responseHandler_.get());
+  EXPECT_CALL(*requestHandler_, onRequest(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onBody(_)).Times(0);
+  EXPECT_CALL(*requestHandler_, onEOM()).Times(0);
+  InSequence enforceOrder;
+  EXPECT_CALL(*requestHandler_, onError(kErrorMethodNotSupported));
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+      .WillOnce(Invoke(
+          [](HTTPMessage& msg) { EXPECT_EQ(msg.getStatusCode(), 405); }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+
+  auto msg = makeOuterRequest();
+  msg->setMethod(HTTPMethod::GET);
+  relay->onRequest(std::move(msg));
+  relay->onBody(folly::IOBuf::copyBuffer("ignored"));
+  relay->onEOM();
+
+  // A later error is not passed on twice
+  EXPECT_CALL(*requestHandler_, onError(_)).Times(0);
+  relay->onError(kErrorConnectionReset);
+}
+
+TEST_F(OHTTPFilterTest, RelayStripsHeaders) {
+  ResponseHandler* downstream{nullptr};
+  EXPECT_CALL(*requestHandler_, setResponseHandler(_))
+      .WillOnce(SaveArg<0>(&downstream));
+  auto relay = new OHTTPRelayFilter(requestHandler_.get());
+  relay->setResponseHandler(responseHandler_.get());
+
+  auto msg = makeOuterRequest();
+  msg->getHeaders().set(HTTP_HEADER_CONTENT_LENGTH, "10");
+  msg->getHeaders().set(HTTP_HEADER_USER_AGENT, "client");
+  msg->getHeaders().set("x-forwarded-for", "192.0.2.1");
+  EXPECT_CALL(*requestHandler_, onRequest(_))
+      .WillOnce(Invoke([](std::shared_ptr<HTTPMessage> msg) {
+        EXPECT_EQ(msg->getHeaders().size(), 2);
+        EXPECT_TRUE(msg->getHeaders().exists(HTTP_HEADER_CONTENT_TYPE));
+        EXPECT_TRUE(msg->getHeaders().exists(HTTP_HEADER_CONTENT_LENGTH));
+      }));
+  relay->onRequest(std::move(msg));
+
+  EXPECT_CALL(*responseHandler_, sendHeaders(_))
+      .WillOnce(Invoke([](HTTPMessage& msg) {
+        // And the Content-Length ResponseBuilder adds
+        EXPECT_EQ(msg.getHeaders().size(), 2);
+        EXPECT_FALSE(msg.getHeaders().exists(HTTP_HEADER_SERVER));
+      }));
+  EXPECT_CALL(*responseHandler_, sendEOM());
+  ResponseBuilder(downstream)
+      .status(200, "OK")
+      .header(HTTP_HEADER_CONTENT_TYPE, ohttp::kResponseContentType.str())
+      .header(HTTP_HEADER_SERVER, "gateway")
+      .sendWithEOM();
+
+  EXPECT_CALL(*requestHandler_, requestComplete());
+  relay->requestComplete();
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CoroEchoHandler.h"
+
+#if FOLLY_HAS_COROUTINES
+
+#include <folly/portability/GFlags.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+
+#include "EchoStats.h"
+
+using namespace proxygen;
+
+DECLARE_bool(request_number);
+
+namespace EchoService {
+
+CoroEchoHandler::CoroEchoHandler(folly::EventBase* evb, EchoStats* stats)
+    : CoroRequestHandler(evb), stats_(stats) {
+}
+
+folly::coro::Task<void> CoroEchoHandler::handleRequest(
+    std::unique_ptr<HTTPMessage> req) {
+  stats_->recordRequest();
+  ResponseBuilder builder(downstream_);
+  builder.status(200, "OK");
+  if (FLAGS_request_number) {
+    builder.header("Request-Number",
+                   folly::to<std::string>(stats_->getRequestCount()));
+  }
+  req->getHeaders().forEach([&](std::string& name, std::string& value) {
+    builder.header(folly::to<std::string>("x-echo-", name), value);
+  });
+  builder.send();
+
+  while (auto body = co_await readBody()) {
+    co_await waitForEgress();
+    ResponseBuilder(downstream_).body(std::move(body)).send();
+  }
+  ResponseBuilder(downstream_).sendWithEOM();
+}
+
+} // namespace EchoService
+
+#endif // FOLLY_HAS_COROUTINES
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/httpserver/CoroRequestHandler.h>
+
+#if FOLLY_HAS_COROUTINES
+
+namespace EchoService {
+
+class EchoStats;
+
+// EchoHandler, as a coroutine
+class CoroEchoHandler : public proxygen::CoroRequestHandler {
+ public:
+  CoroEchoHandler(folly::EventBase* evb, EchoStats* stats);
+
+ protected:
+  folly::coro::Task<void> handleRequest(
+      std::unique_ptr<proxygen::HTTPMessage> headers) override;
+
+ private:
+  EchoStats* const stats_{nullptr};
+};
+
+} // namespace EchoService
+
+#endif // FOLLY_HAS_COROUTINES
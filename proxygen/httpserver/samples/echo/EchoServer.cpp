@@ -13,6 +13,7 @@
 #include <proxygen/httpserver/HTTPServer.h>
 #include <proxygen/httpserver/RequestHandlerFactory.h>
 
+#include "CoroEchoHandler.h"
 #include "EchoHandler.h"
 #include "EchoStats.h"
 
@@ -31,6 +32,9 @@ DEFINE_int32(threads,
              0,
              "Number of threads to listen on. Numbers <= 0 "
              "will use the number of cores on this machine.");
+DEFINE_bool(coro,
+            false,
+            "Handle requests with coroutines, when they are supported");
 
 class EchoHandlerFactory : public RequestHandlerFactory {
  public:
@@ -43,6 +47,13 @@ class EchoHandlerFactory : public RequestHandlerFactory {
   }
 
   RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
+#if FOLLY_HAS_COROUTINES
+    if (FLAGS_coro) {
+      return new CoroEchoHandler(
+          folly::EventBaseManager::get()->getExistingEventBase(),
+          stats_.get());
+    }
+#endif
     return new EchoHandler(stats_.get());
   }
 
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/httpserver/ResponseHandler.h>
+#include <proxygen/httpserver/samples/echo/CoroEchoHandler.h>
+#include <proxygen/httpserver/samples/echo/EchoHandler.h>
+#include <proxygen/httpserver/samples/echo/EchoStats.h>
+
+using namespace EchoService;
+using namespace proxygen;
+
+namespace {
+
+// Drops the response
+class NullResponseHandler : public ResponseHandler {
+ public:
+  explicit NullResponseHandler(RequestHandler* upstream)
+      : ResponseHandler(upstream) {
+  }
+
+  void sendHeaders(HTTPMessage& /*msg*/) noexcept override {
+  }
+  void sendChunkHeader(size_t /*len*/) noexcept override {
+  }
+  void sendBody(std::unique_ptr<folly::IOBuf> body) noexcept override {
+    folly::doNotOptimizeAway(body);
+  }
+  void sendChunkTerminator() noexcept override {
+  }
+  void sendEOM() noexcept override {
+  }
+  void sendAbort() noexcept override {
+  }
+  void refreshTimeout() noexcept override {
+  }
+  void pauseIngress() noexcept override {
+  }
+  void resumeIngress() noexcept override {
+  }
+  folly::Expected<ResponseHandler*, ProxygenError> newPushedResponse(
+      PushHandler* /*pushHandler*/) noexcept override {
+    return folly::makeUnexpected(kErrorUnknown);
+  }
+  const wangle::TransportInfo& getSetupTransportInfo()
+      const noexcept override {
+    return transportInfo_;
+  }
+  void getCurrentTransportInfo(
+      wangle::TransportInfo* /*tinfo*/) const override {
+  }
+
+ private:
+  wangle::TransportInfo transportInfo_;
+};
+
+void runEcho(RequestHandler* handler,
+             folly::EventBase* evb,
+             size_t chunks,
+             const folly::IOBuf& chunk) {
+  NullResponseHandler downstream(handler);
+  handler->setResponseHandler(&downstream);
+  auto req = std::make_unique<HTTPMessage>();
+  req->getHeaders().add(HTTP_HEADER_HOST, "www.example.com");
+  handler->onRequest(std::move(req));
+  if (evb) {
+    // Where the coroutine starts
+    evb->loopOnce();
+  }
+  for (size_t i = 0; i < chunks; i++) {
+    handler->onBody(chunk.clone());
+  }
+  handler->onEOM();
+  handler->requestComplete();
+}
+
+void echoBench(bool coro, size_t chunks, int iters) {
+  EchoStats stats;
+  folly::EventBase evb;
+  auto chunk = folly::IOBuf::copyBuffer(std::string(1024, 'a'));
+  for (int i = 0; i < iters; i++) {
+#if FOLLY_HAS_COROUTINES
+    if (coro) {
+      runEcho(new CoroEchoHandler(&evb, &stats), &evb, chunks, *chunk);
+      continue;
+    }
+#else
+    (void)coro;
+#endif
+    runEcho(new EchoHandler(&stats), nullptr, chunks, *chunk);
+  }
+}
+
+} // namespace
+
+BENCHMARK(CallbackEchoNoBody, iters) {
+  echoBench(false, 0, iters);
+}
+
+BENCHMARK_RELATIVE(CoroEchoNoBody, iters) {
+  echoBench(true, 0, iters);
+}
+
+BENCHMARK(CallbackEcho16Chunks, iters) {
+  echoBench(false, 16, iters);
+}
+
+BENCHMARK_RELATIVE(CoroEcho16Chunks, iters) {
+  echoBench(true, 16, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
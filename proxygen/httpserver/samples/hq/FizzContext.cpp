@@ -15,6 +15,7 @@
 #include <fizz/server/TicketCodec.h>
 #include <folly/FileUtil.h>
 #include <folly/Random.h>
+#include <proxygen/lib/services/BloomReplayCache.h>
 #include <string>
 
 namespace {
@@ -179,8 +180,11 @@ FizzServerContextPtr createFizzServerContext(const HQServerParams& params) {
   tolerance.before = std::chrono::minutes(-5);
   tolerance.after = std::chrono::minutes(5);
 
+  // Covers the ticket ages the tolerance accepts
+  proxygen::ShardedBloomReplayCache::Options replayOptions;
+  replayOptions.window = tolerance.after - tolerance.before;
   std::shared_ptr<fizz::server::ReplayCache> replayCache =
-      std::make_shared<fizz::server::AllowAllReplayReplayCache>();
+      std::make_shared<proxygen::ShardedBloomReplayCache>(replayOptions);
 
   serverCtx->setEarlyDataSettings(true, tolerance, std::move(replayCache));
 
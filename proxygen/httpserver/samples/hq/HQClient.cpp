@@ -52,11 +52,13 @@ int HQClient::start() {
   // complete.
   evb_.loopForever();
   if (params_.migrateClient) {
-    quicClient_->onNetworkSwitch(
-        std::make_unique<folly::AsyncUDPSocket>(&evb_));
+    quicClient_->onNetworkSwitch(makeUDPSocket());
     sendRequests(true, quicClient_->getNumOpenableBidirectionalStreams());
   }
   evb_.loop();
+  if (params_.udpBatchStats) {
+    LOG(INFO) << "HQClient UDP " << *params_.udpBatchStats;
+  }
 
   return failed_ ? -1 : 0;
 }
@@ -258,11 +260,18 @@ void HQClient::connectError(const quic::QuicError& error) {
   evb_.terminateLoopSoon();
 }
 
+std::unique_ptr<folly::AsyncUDPSocket> HQClient::makeUDPSocket() {
+  if (params_.udpBatchStats) {
+    return std::make_unique<proxygen::CountingUDPSocket>(
+        &evb_, params_.udpBatchStats);
+  }
+  return std::make_unique<folly::AsyncUDPSocket>(&evb_);
+}
+
 void HQClient::initializeQuicClient() {
-  auto sock = std::make_unique<folly::AsyncUDPSocket>(&evb_);
   auto client = std::make_shared<quic::QuicClientTransport>(
       &evb_,
-      std::move(sock),
+      makeUDPSocket(),
       quic::FizzClientQuicHandshakeContext::Builder()
           .setFizzClientContext(
               createFizzClientContext(params_, params_.earlyData))
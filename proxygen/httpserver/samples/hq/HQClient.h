@@ -73,6 +73,8 @@ class HQClient : private quic::QuicSocket::ConnectionSetupCallback {
 
   void connectError(const quic::QuicError& error);
 
+  std::unique_ptr<folly::AsyncUDPSocket> makeUDPSocket();
+
   void initializeQuicClient();
 
   void initializeQLogger();
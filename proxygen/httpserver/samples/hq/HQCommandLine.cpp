@@ -8,6 +8,8 @@
 
 #include <proxygen/httpserver/samples/hq/HQCommandLine.h>
 
+#include <algorithm>
+
 #include <folly/io/async/AsyncSocketException.h>
 #include <folly/io/async/AsyncTransport.h>
 #include <folly/io/async/EventBaseManager.h>
@@ -87,6 +89,16 @@ DEFINE_uint32(quic_thread_local_delay_us,
 DEFINE_uint32(quic_batch_size,
               quic::kDefaultQuicMaxBatchSize,
               "Maximum number of packets that can be batched in Quic");
+DEFINE_bool(quic_gso,
+            false,
+            "Batch egress packets with UDP GSO, overrides quic_batching_mode");
+DEFINE_bool(quic_gro,
+            false,
+            "Read coalesced ingress packets with UDP GRO, overrides "
+            "num_gro_buffers");
+DEFINE_bool(udp_batch_stats,
+            false,
+            "Log UDP packets per syscall for reads and writes on exit");
 DEFINE_string(cert, "", "Certificate file path");
 DEFINE_string(key, "", "Private key file path");
 DEFINE_string(client_auth_mode, "none", "Client authentication mode");
@@ -124,6 +136,23 @@ DEFINE_uint32(
     max_ack_receive_timestamps_to_send,
     quic::kMaxReceivedPktsTimestampsStored,
     "Controls how many packet receieve timestamps the peer should send");
+DEFINE_uint32(load_threads,
+              0,
+              "(HQClient) Run a load test on this many threads instead of "
+              "fetching the paths once");
+DEFINE_uint32(load_connections, 1, "(HQClient) Load connections per thread");
+DEFINE_uint32(load_concurrency,
+              1,
+              "(HQClient) Load requests in flight per connection");
+DEFINE_double(load_rate,
+              0,
+              "(HQClient) Load requests/s per connection, as Poisson "
+              "arrivals. 0 sends a request as soon as another completes");
+DEFINE_string(load_body_sizes,
+              "",
+              "(HQClient) Comma separated sizes of load POST bodies, picked "
+              "at random per request. Load requests are GETs if empty");
+DEFINE_uint32(load_duration_s, 10, "(HQClient) Load test duration");
 
 namespace quic::samples {
 
@@ -240,6 +269,16 @@ void initializeTransportSettings(HQToolParams& hqUberParams) {
   hqParams.transportSettings.threadLocalDelay =
       std::chrono::microseconds(FLAGS_quic_thread_local_delay_us);
   hqParams.transportSettings.maxBatchSize = FLAGS_quic_batch_size;
+  if (FLAGS_quic_gso) {
+    hqParams.transportSettings.batchingMode =
+        quic::QuicBatchingMode::BATCHING_MODE_GSO;
+  }
+  if (FLAGS_quic_gro) {
+    hqParams.transportSettings.numGROBuffers_ = quic::kMaxNumGROBuffers;
+  }
+  if (FLAGS_udp_batch_stats) {
+    hqParams.udpBatchStats = std::make_shared<proxygen::UDPBatchStats>();
+  }
   if (hqUberParams.mode == HQMode::CLIENT) {
     // There is no good reason to keep the socket around for a drain period for
     // a commandline client
@@ -325,6 +364,31 @@ void initializeHttpClientSettings(HQToolClientParams& hqParams) {
   hqParams.migrateClient = FLAGS_migrate_client;
   hqParams.txnTimeout = std::chrono::milliseconds(FLAGS_txn_timeout);
   hqParams.httpVersion.parse(FLAGS_httpversion);
+
+  hqParams.loadThreads = FLAGS_load_threads;
+  hqParams.loadConnections = FLAGS_load_connections;
+  hqParams.loadConcurrency = FLAGS_load_concurrency;
+  hqParams.loadRate = FLAGS_load_rate;
+  std::vector<folly::StringPiece> bodySizes;
+  folly::split(',', FLAGS_load_body_sizes, bodySizes, true);
+  for (auto size : bodySizes) {
+    // Invalid ones are reported by validate()
+    if (auto parsed = folly::tryTo<size_t>(size)) {
+      hqParams.loadBodySizes.push_back(*parsed);
+    }
+  }
+  hqParams.loadDuration = std::chrono::seconds(FLAGS_load_duration_s);
+  if (hqParams.loadThreads > 0 && FLAGS_protocol.empty()) {
+    // HQLoadClient only speaks H3
+    auto& alpns = hqParams.supportedAlpns;
+    alpns.erase(std::remove_if(alpns.begin(),
+                               alpns.end(),
+                               [](const std::string& alpn) {
+                                 return alpn == proxygen::kHQ ||
+                                        alpn == proxygen::kHQCurrentDraft;
+                               }),
+                alpns.end());
+  }
 } // initializeHttpClientSettings
 
 void initializeQLogSettings(HQBaseParams& hqParams) {
@@ -382,6 +446,25 @@ HQInvalidParams validate(const HQToolParams& params) {
     if (clientParams.port == 0) {
       INVALID_PARAM(port, "HQClient expected --port");
     }
+    if (clientParams.loadThreads > 0) {
+      if (clientParams.loadConnections == 0) {
+        INVALID_PARAM(load_connections, "expected at least 1");
+      }
+      if (clientParams.loadConcurrency == 0) {
+        INVALID_PARAM(load_concurrency, "expected at least 1");
+      }
+      if (!(clientParams.loadRate >= 0)) {
+        INVALID_PARAM(load_rate, "expected a non negative rate");
+      }
+      std::vector<folly::StringPiece> bodySizes;
+      folly::split(',', FLAGS_load_body_sizes, bodySizes, true);
+      if (bodySizes.size() != clientParams.loadBodySizes.size()) {
+        INVALID_PARAM(load_body_sizes, "expected sizes in bytes");
+      }
+      if (folly::StringPiece(clientParams.protocol).startsWith("hq")) {
+        INVALID_PARAM(protocol, "the load client only supports h3");
+      }
+    }
   }
 
   // Validate the transport section
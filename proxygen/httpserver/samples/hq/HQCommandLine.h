@@ -33,6 +33,16 @@ struct HQToolClientParams : public HQBaseParams {
   bool migrateClient{false};
   bool sendRequestsSequentially;
   std::chrono::milliseconds gapBetweenRequests;
+
+  // Load mode (HQLoadClient), when loadThreads > 0
+  size_t loadThreads{0};
+  size_t loadConnections{1};
+  size_t loadConcurrency{1};
+  // Requests/s per connection, 0 to send one as soon as another completes
+  double loadRate{0};
+  // POST bodies of one of these sizes at random, GETs if empty
+  std::vector<size_t> loadBodySizes;
+  std::chrono::seconds loadDuration{10};
 };
 
 struct HQToolServerParams : public HQServerParams {
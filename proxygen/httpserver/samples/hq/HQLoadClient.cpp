@@ -0,0 +1,608 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/samples/hq/HQLoadClient.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <thread>
+
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/io/async/EventBase.h>
+
+#include <proxygen/httpserver/samples/hq/FizzContext.h>
+#include <proxygen/httpserver/samples/hq/HQLoggerHelper.h>
+#include <proxygen/httpserver/samples/hq/InsecureVerifierDangerousDoNotUseInProduction.h>
+#include <proxygen/lib/http/session/HQUpstreamSession.h>
+#include <quic/client/QuicClientTransport.h>
+#include <quic/common/Timers.h>
+#include <quic/congestion_control/CongestionControllerFactory.h>
+#include <quic/fizz/client/handshake/FizzClientQuicHandshakeContext.h>
+
+namespace quic::samples {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Arrivals are timestamped when scheduled, so this only bounds how late the
+// timer may run them
+constexpr std::chrono::microseconds kArrivalTimerResolution{100};
+
+// Shared by the connections of a worker thread
+struct WorkerContext {
+  explicit WorkerContext(const HQToolClientParams& p) : params(p) {
+  }
+
+  const HQToolClientParams& params;
+  folly::EventBase evb;
+  TimerHighRes::SharedPtr pacingTimer;
+  TimerHighRes::SharedPtr arrivalTimer;
+  // Request bodies are slices of it
+  std::unique_ptr<folly::IOBuf> body;
+  HQLoadStats stats;
+  // Connections not closed yet
+  size_t live{0};
+};
+
+class LoadConnection;
+
+// One request, deletes itself once its transaction detaches
+class LoadRequest : public proxygen::HTTPTransactionHandler {
+ public:
+  LoadRequest(LoadConnection& conn, Clock::time_point arrival)
+      : conn_(conn), arrival_(arrival) {
+  }
+
+  void setTransaction(proxygen::HTTPTransaction* /*txn*/) noexcept override {
+  }
+
+  void detachTransaction() noexcept override {
+    finish(false);
+    delete this;
+  }
+
+  void onHeadersComplete(
+      std::unique_ptr<proxygen::HTTPMessage> msg) noexcept override {
+    status_ = msg->getStatusCode();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    bodyBytes_ += chain->computeChainDataLength();
+  }
+
+  void onTrailers(
+      std::unique_ptr<proxygen::HTTPHeaders> /*trailers*/) noexcept override {
+  }
+
+  void onEOM() noexcept override {
+    finish(true);
+  }
+
+  void onUpgrade(proxygen::UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onError(const proxygen::HTTPException& error) noexcept override {
+    VLOG(3) << "Request failed: " << error.what();
+    finish(false);
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  // Only the first call counts
+  void finish(bool ok);
+
+  LoadConnection& conn_;
+  Clock::time_point arrival_;
+  uint16_t status_{0};
+  uint64_t bodyBytes_{0};
+  bool done_{false};
+};
+
+class LoadConnection
+    : private quic::QuicSocket::ConnectionSetupCallback
+    , private proxygen::HTTPSessionBase::InfoCallback {
+ public:
+  LoadConnection(WorkerContext& ctx, folly::StringPiece path)
+      : ctx_(ctx), params_(ctx.params), path_(path.str()) {
+  }
+
+  void start();
+
+  // Stops sending, and closes the connection once its requests completed
+  void stop();
+
+  void onRequestDone(Clock::time_point arrival,
+                     uint16_t status,
+                     uint64_t bodyBytes,
+                     bool ok);
+
+ private:
+  class ConnectCallback : public proxygen::HQSession::ConnectCallback {
+   public:
+    explicit ConnectCallback(LoadConnection& conn) : conn_(conn) {
+    }
+
+    void connectSuccess() override {
+      conn_.connectSuccess();
+    }
+
+    void onReplaySafe() override {
+    }
+
+    void connectError(quic::QuicError error) override {
+      conn_.connectError(error);
+    }
+
+   private:
+    LoadConnection& conn_;
+  };
+
+  class ArrivalTimeout : public TimerHighRes::Callback {
+   public:
+    explicit ArrivalTimeout(LoadConnection& conn) : conn_(conn) {
+    }
+
+    void timeoutExpired() noexcept override {
+      conn_.onArrivals();
+    }
+
+    void callbackCanceled() noexcept override {
+    }
+
+   private:
+    LoadConnection& conn_;
+  };
+
+  // ConnectionSetupCallback
+  void onConnectionSetupError(quic::QuicError error) noexcept override;
+  void onTransportReady() noexcept override;
+
+  // InfoCallback
+  void onDestroy(const proxygen::HTTPSessionBase& session) override;
+
+  void connectSuccess();
+  void connectError(const quic::QuicError& error);
+  void closed();
+
+  // Queues the arrivals due and schedules the next one
+  void onArrivals();
+  std::chrono::microseconds nextInterarrival() const;
+
+  // Sends the pending requests the concurrency and stream limits allow
+  void dispatch();
+  bool sendRequest(Clock::time_point arrival);
+  void maybeDrain();
+
+  std::unique_ptr<folly::AsyncUDPSocket> makeUDPSocket();
+  void recordTransportStats();
+
+  WorkerContext& ctx_;
+  const HQToolClientParams& params_;
+  std::string path_;
+  ConnectCallback connCb_{*this};
+  ArrivalTimeout arrivalTimeout_{*this};
+  std::shared_ptr<quic::QuicClientTransport> quicClient_;
+  proxygen::HQUpstreamSession* session_{nullptr};
+  // Arrival times of the requests waiting for a stream
+  std::deque<Clock::time_point> pending_;
+  Clock::time_point nextArrival_;
+  size_t outstanding_{0};
+  bool connected_{false};
+  bool stopped_{false};
+  bool draining_{false};
+  bool closed_{false};
+  bool statsRecorded_{false};
+};
+
+void LoadRequest::finish(bool ok) {
+  if (done_) {
+    return;
+  }
+  done_ = true;
+  conn_.onRequestDone(arrival_, status_, bodyBytes_, ok);
+}
+
+std::unique_ptr<folly::AsyncUDPSocket> LoadConnection::makeUDPSocket() {
+  if (params_.udpBatchStats) {
+    return std::make_unique<proxygen::CountingUDPSocket>(
+        &ctx_.evb, params_.udpBatchStats);
+  }
+  return std::make_unique<folly::AsyncUDPSocket>(&ctx_.evb);
+}
+
+void LoadConnection::start() {
+  auto client = std::make_shared<quic::QuicClientTransport>(
+      &ctx_.evb,
+      makeUDPSocket(),
+      quic::FizzClientQuicHandshakeContext::Builder()
+          .setFizzClientContext(
+              createFizzClientContext(params_, params_.earlyData))
+          .setCertificateVerifier(
+              std::make_unique<
+                  proxygen::InsecureVerifierDangerousDoNotUseInProduction>())
+          .setPskCache(params_.pskCache)
+          .build());
+  client->setPacingTimer(ctx_.pacingTimer);
+  client->setHostname(params_.host);
+  client->addNewPeerAddress(params_.remoteAddress.value());
+  if (params_.localAddress.has_value()) {
+    client->setLocalAddress(*params_.localAddress);
+  }
+  client->setCongestionControllerFactory(
+      std::make_shared<quic::DefaultCongestionControllerFactory>());
+  client->setTransportSettings(params_.transportSettings);
+  client->setSupportedVersions(params_.quicVersions);
+  if (!params_.qLoggerPath.empty()) {
+    client->setQLogger(std::make_shared<HQLoggerHelper>(
+        params_.qLoggerPath, params_.prettyJson, quic::VantagePoint::Client));
+  }
+  quicClient_ = std::move(client);
+  quicClient_->start(this, nullptr);
+}
+
+void LoadConnection::onConnectionSetupError(quic::QuicError error) noexcept {
+  quicClient_->setConnectionSetupCallback(nullptr);
+  connectError(error);
+  if (!session_) {
+    closed();
+  }
+}
+
+void LoadConnection::onTransportReady() noexcept {
+  wangle::TransportInfo tinfo;
+  session_ = new proxygen::HQUpstreamSession(params_.txnTimeout,
+                                             params_.connectTimeout,
+                                             nullptr, // controller
+                                             tinfo,
+                                             this);
+  session_->setConnectCallback(&connCb_);
+  quicClient_->setConnectionCallback(session_);
+  quicClient_->setConnectionSetupCallback(session_);
+  session_->setSocket(quicClient_);
+  session_->startNow();
+  session_->onTransportReady(); // invokes connectSuccess()
+}
+
+void LoadConnection::connectSuccess() {
+  connected_ = true;
+  if (stopped_) {
+    maybeDrain();
+    return;
+  }
+  if (params_.loadRate > 0) {
+    nextArrival_ = Clock::now();
+    onArrivals();
+  } else {
+    // Closed loop: every completion queues the next request
+    pending_.insert(pending_.end(), params_.loadConcurrency, Clock::now());
+    dispatch();
+  }
+}
+
+void LoadConnection::connectError(const quic::QuicError& error) {
+  VLOG(2) << "Load connection failed: " << error.message;
+  ctx_.stats.connectErrors++;
+}
+
+void LoadConnection::onDestroy(const proxygen::HTTPSessionBase& /*session*/) {
+  session_ = nullptr;
+  closed();
+}
+
+void LoadConnection::closed() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  arrivalTimeout_.cancelTimeout();
+  ctx_.stats.unsent += pending_.size();
+  pending_.clear();
+  recordTransportStats();
+  CHECK_GT(ctx_.live, 0);
+  if (--ctx_.live == 0) {
+    ctx_.evb.terminateLoopSoon();
+  }
+}
+
+void LoadConnection::stop() {
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
+  arrivalTimeout_.cancelTimeout();
+  ctx_.stats.unsent += pending_.size();
+  pending_.clear();
+  maybeDrain();
+}
+
+std::chrono::microseconds LoadConnection::nextInterarrival() const {
+  // Exponentially distributed, for Poisson arrivals
+  double seconds = -std::log1p(-folly::Random::randDouble01()) /
+                   params_.loadRate;
+  return std::chrono::microseconds(int64_t(seconds * 1000000));
+}
+
+void LoadConnection::onArrivals() {
+  auto now = Clock::now();
+  while (nextArrival_ <= now) {
+    pending_.push_back(nextArrival_);
+    nextArrival_ += nextInterarrival();
+  }
+  dispatch();
+  if (!stopped_ && !closed_) {
+    auto delay = std::chrono::duration_cast<std::chrono::microseconds>(
+        nextArrival_ - now);
+    ctx_.arrivalTimer->scheduleTimeout(
+        &arrivalTimeout_, std::max(delay, kArrivalTimerResolution));
+  }
+}
+
+void LoadConnection::dispatch() {
+  while (!pending_.empty() && outstanding_ < params_.loadConcurrency &&
+         session_ &&
+         quicClient_->getNumOpenableBidirectionalStreams() > 0) {
+    if (!sendRequest(pending_.front())) {
+      break;
+    }
+    pending_.pop_front();
+  }
+}
+
+bool LoadConnection::sendRequest(Clock::time_point arrival) {
+  auto request = new LoadRequest(*this, arrival);
+  auto txn = session_->newTransaction(request);
+  if (!txn) {
+    delete request;
+    return false;
+  }
+  proxygen::HTTPMessage msg;
+  msg.setURL(path_);
+  msg.setSecure(true);
+  msg.getHeaders() = params_.httpHeaders;
+  uint64_t bodySize = 0;
+  if (params_.loadBodySizes.empty()) {
+    msg.setMethod(params_.httpMethod);
+  } else {
+    msg.setMethod(proxygen::HTTPMethod::POST);
+    bodySize = params_.loadBodySizes[folly::Random::rand32(
+        uint32_t(params_.loadBodySizes.size()))];
+    msg.getHeaders().set(proxygen::HTTP_HEADER_CONTENT_LENGTH,
+                         folly::to<std::string>(bodySize));
+  }
+  // Before sending anything, which may fail the request right away
+  outstanding_++;
+  ctx_.stats.requests++;
+  txn->sendHeaders(msg);
+  if (bodySize > 0) {
+    auto body = ctx_.body->clone();
+    body->trimEnd(body->length() - bodySize);
+    txn->sendBody(std::move(body));
+  }
+  txn->sendEOM();
+  return true;
+}
+
+void LoadConnection::onRequestDone(Clock::time_point arrival,
+                                   uint16_t status,
+                                   uint64_t bodyBytes,
+                                   bool ok) {
+  CHECK_GT(outstanding_, 0);
+  outstanding_--;
+  auto& stats = ctx_.stats;
+  stats.bodyBytesReceived += bodyBytes;
+  if (ok) {
+    stats.completed++;
+    stats.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - arrival));
+    if (status < 200 || status >= 300) {
+      stats.non2xx++;
+    }
+  } else {
+    stats.errors++;
+  }
+  if (stopped_) {
+    maybeDrain();
+    return;
+  }
+  if (params_.loadRate <= 0) {
+    pending_.push_back(Clock::now());
+  }
+  dispatch();
+}
+
+void LoadConnection::maybeDrain() {
+  if (draining_ || outstanding_ > 0 || !session_) {
+    return;
+  }
+  draining_ = true;
+  // Before the transport closes, with the counters of the whole run
+  recordTransportStats();
+  session_->drain();
+  session_->closeWhenIdle();
+}
+
+void LoadConnection::recordTransportStats() {
+  if (!connected_ || statsRecorded_) {
+    return;
+  }
+  statsRecorded_ = true;
+  auto info = quicClient_->getTransportInfo();
+  auto& stats = ctx_.stats;
+  stats.packetsSent += info.totalPacketsSent;
+  stats.packetsMarkedLost += info.totalPacketsMarkedLost;
+  stats.packetsRetransmitted += info.packetsRetransmitted;
+  stats.timeoutBasedLoss += info.timeoutBasedLoss;
+  stats.ptoCount += info.totalPTOCount;
+  stats.bytesSent += info.bytesSent;
+  stats.bytesRecvd += info.bytesRecvd;
+  stats.srtt.record(info.srtt);
+}
+
+// Runs its connections on its own thread and event base
+class LoadWorker {
+ public:
+  explicit LoadWorker(const HQToolClientParams& params) : ctx_(params) {
+  }
+
+  void start(size_t index) {
+    thread_ = std::thread([this, index] { run(index); });
+  }
+
+  void join() {
+    thread_.join();
+  }
+
+  const HQLoadStats& getStats() const {
+    return ctx_.stats;
+  }
+
+ private:
+  void run(size_t index) {
+    const auto& params = ctx_.params;
+    if (params.transportSettings.pacingEnabled) {
+      ctx_.pacingTimer = TimerHighRes::newTimer(
+          &ctx_.evb, params.transportSettings.pacingTimerResolution);
+    }
+    if (params.loadRate > 0) {
+      ctx_.arrivalTimer =
+          TimerHighRes::newTimer(&ctx_.evb, kArrivalTimerResolution);
+    }
+    if (!params.loadBodySizes.empty()) {
+      auto size = *std::max_element(params.loadBodySizes.begin(),
+                                    params.loadBodySizes.end());
+      ctx_.body = folly::IOBuf::create(size);
+      memset(ctx_.body->writableData(), 'a', size);
+      ctx_.body->append(size);
+    }
+    for (size_t i = 0; i < params.loadConnections; i++) {
+      // Spreads the paths over the connections of all the threads
+      const auto& path = params.httpPaths[(index * params.loadConnections + i) %
+                                          params.httpPaths.size()];
+      connections_.push_back(std::make_unique<LoadConnection>(ctx_, path));
+    }
+    // All counted first: one failing right away mustn't stop the loop
+    ctx_.stats.connections = ctx_.live = connections_.size();
+    for (auto& conn : connections_) {
+      conn->start();
+    }
+    ctx_.evb.runAfterDelay(
+        [this] {
+          for (auto& conn : connections_) {
+            conn->stop();
+          }
+        },
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            params.loadDuration)
+            .count());
+    if (ctx_.live > 0) {
+      ctx_.evb.loopForever();
+    }
+    connections_.clear();
+  }
+
+  WorkerContext ctx_;
+  std::vector<std::unique_ptr<LoadConnection>> connections_;
+  std::thread thread_;
+};
+
+} // namespace
+
+void HQLoadStats::merge(const HQLoadStats& other) {
+  requests += other.requests;
+  completed += other.completed;
+  errors += other.errors;
+  non2xx += other.non2xx;
+  unsent += other.unsent;
+  bodyBytesReceived += other.bodyBytesReceived;
+  latency.merge(other.latency);
+  connections += other.connections;
+  connectErrors += other.connectErrors;
+  packetsSent += other.packetsSent;
+  packetsMarkedLost += other.packetsMarkedLost;
+  packetsRetransmitted += other.packetsRetransmitted;
+  timeoutBasedLoss += other.timeoutBasedLoss;
+  ptoCount += other.ptoCount;
+  bytesSent += other.bytesSent;
+  bytesRecvd += other.bytesRecvd;
+  srtt.merge(other.srtt);
+}
+
+std::ostream& operator<<(std::ostream& o, const HQLoadStats& stats) {
+  auto percentiles = [&o](const proxygen::LatencyHistogram& h) {
+    o << "p50=" << h.getPercentile(50) << "us p90=" << h.getPercentile(90)
+      << "us p99=" << h.getPercentile(99) << "us p99.9="
+      << h.getPercentile(99.9) << "us max=" << h.getMax() << "us";
+  };
+  o << "requests=" << stats.requests << " completed=" << stats.completed
+    << " errors=" << stats.errors << " non2xx=" << stats.non2xx
+    << " unsent=" << stats.unsent << " bodyBytes=" << stats.bodyBytesReceived
+    << "\nlatency: ";
+  percentiles(stats.latency);
+  o << "\nconnections=" << stats.connections
+    << " connectErrors=" << stats.connectErrors
+    << " packetsSent=" << stats.packetsSent
+    << " packetsLost=" << stats.packetsMarkedLost
+    << " retransmitted=" << stats.packetsRetransmitted
+    << " timeoutLoss=" << stats.timeoutBasedLoss << " pto=" << stats.ptoCount
+    << " bytesSent=" << stats.bytesSent << " bytesRecvd=" << stats.bytesRecvd
+    << "\nsrtt: ";
+  percentiles(stats.srtt);
+  return o;
+}
+
+HQLoadClient::HQLoadClient(const HQToolClientParams& params)
+    : params_(params) {
+  CHECK_GT(params_.loadThreads, 0);
+  CHECK(!params_.httpPaths.empty());
+}
+
+HQLoadClient::~HQLoadClient() = default;
+
+int HQLoadClient::start() {
+  LOG(INFO) << "HQLoadClient running " << params_.loadThreads << "x"
+            << params_.loadConnections << " connections to "
+            << params_.remoteAddress->describe() << " for "
+            << params_.loadDuration.count() << "s";
+  std::vector<std::unique_ptr<LoadWorker>> workers;
+  for (size_t i = 0; i < params_.loadThreads; i++) {
+    workers.push_back(std::make_unique<LoadWorker>(params_));
+  }
+  auto begin = Clock::now();
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i]->start(i);
+  }
+  for (auto& worker : workers) {
+    worker->join();
+    stats_.merge(worker->getStats());
+  }
+  auto elapsed =
+      std::chrono::duration<double>(Clock::now() - begin).count();
+
+  LOG(INFO) << "HQLoadClient " << stats_;
+  LOG(INFO) << "HQLoadClient " << stats_.completed / elapsed << " req/s, "
+            << stats_.bodyBytesReceived / elapsed / 1e6 << " MB/s";
+  if (params_.udpBatchStats) {
+    LOG(INFO) << "HQLoadClient UDP " << *params_.udpBatchStats;
+  }
+  return stats_.connectErrors == stats_.connections ? -1 : 0;
+}
+
+int startLoadClient(const HQToolClientParams& params) {
+  HQLoadClient client(params);
+  return client.start();
+}
+
+} // namespace quic::samples
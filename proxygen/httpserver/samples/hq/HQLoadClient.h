@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <ostream>
+
+#include <proxygen/httpserver/samples/hq/HQCommandLine.h>
+#include <proxygen/lib/stats/LatencyHistogram.h>
+
+namespace quic::samples {
+
+/**
+ * What an HQLoadClient measured, per worker thread and then merged.
+ */
+struct HQLoadStats {
+  // Requests sent, and how they ended
+  uint64_t requests{0};
+  uint64_t completed{0};
+  uint64_t errors{0};
+  uint64_t non2xx{0};
+  // Arrivals still waiting for a stream when the run ended
+  uint64_t unsent{0};
+  uint64_t bodyBytesReceived{0};
+  // From the arrival of a request to its response EOM, in microseconds
+  proxygen::LatencyHistogram latency;
+
+  uint64_t connections{0};
+  uint64_t connectErrors{0};
+  // Sums of the QUIC transport counters of each connection at its end
+  uint64_t packetsSent{0};
+  uint64_t packetsMarkedLost{0};
+  uint64_t packetsRetransmitted{0};
+  uint64_t timeoutBasedLoss{0};
+  uint64_t ptoCount{0};
+  uint64_t bytesSent{0};
+  uint64_t bytesRecvd{0};
+  // Smoothed RTT of each connection, in microseconds
+  proxygen::LatencyHistogram srtt;
+
+  void merge(const HQLoadStats& other);
+};
+
+std::ostream& operator<<(std::ostream& o, const HQLoadStats& stats);
+
+/**
+ * Load generator for an H3 server: params.loadThreads threads each run
+ * params.loadConnections connections for params.loadDuration, with up to
+ * params.loadConcurrency requests in flight on each.  Requests go out as
+ * soon as one completes (closed loop) or, when params.loadRate is set, on
+ * Poisson arrivals at that rate per connection (open loop), queueing while
+ * the connection is at its concurrency.  Latency includes that queueing, so
+ * a slow server can't hide it by slowing down the client.
+ */
+class HQLoadClient {
+ public:
+  explicit HQLoadClient(const HQToolClientParams& params);
+
+  ~HQLoadClient();
+
+  HQLoadClient(const HQLoadClient&) = delete;
+  HQLoadClient& operator=(const HQLoadClient&) = delete;
+
+  // Runs the load and logs the stats, returns -1 if no connection succeeded
+  int start();
+
+  const HQLoadStats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  const HQToolClientParams& params_;
+  HQLoadStats stats_;
+};
+
+int startLoadClient(const HQToolClientParams& params);
+
+} // namespace quic::samples
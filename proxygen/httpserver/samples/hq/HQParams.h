@@ -19,6 +19,7 @@
 #include <proxygen/lib/http/HTTPHeaders.h>
 #include <proxygen/lib/http/HTTPMethod.h>
 #include <proxygen/lib/http/session/HQSession.h>
+#include <proxygen/lib/transport/CountingUDPSocket.h>
 #include <quic/QuicConstants.h>
 #include <quic/fizz/client/handshake/QuicPskCache.h>
 #include <quic/state/TransportSettings.h>
@@ -59,6 +60,8 @@ struct HQBaseParams {
   std::string congestionControlName;
   std::optional<quic::CongestionControlType> congestionControl;
   bool sendKnobFrame{false};
+  // Counts UDP syscalls and packets when set, logged on shutdown
+  std::shared_ptr<proxygen::UDPBatchStats> udpBatchStats;
 
   // HTTP section
   std::string protocol{"h3"};
@@ -18,6 +18,7 @@
 #include <proxygen/lib/http/session/HQDownstreamSession.h>
 #include <proxygen/lib/http/session/HTTPDownstreamSession.h>
 #include <quic/api/QuicStreamAsyncTransport.h>
+#include <proxygen/lib/transport/CountingUDPSocket.h>
 #include <quic/server/QuicSharedUDPSocketFactory.h>
 
 using fizz::server::FizzServerContext;
@@ -235,6 +236,28 @@ QuicServerTransport::Ptr HQServerTransportFactory::make(
   return transport;
 }
 
+// Like QuicSharedUDPSocketFactory, but the sockets count their syscalls
+class CountingUDPSocketFactory : public quic::QuicUDPSocketFactory {
+ public:
+  explicit CountingUDPSocketFactory(std::shared_ptr<UDPBatchStats> stats)
+      : stats_(std::move(stats)) {
+  }
+
+  std::unique_ptr<folly::AsyncUDPSocket> make(folly::EventBase* evb,
+                                              int fd) override {
+    auto sock = std::make_unique<CountingUDPSocket>(evb, stats_);
+    if (fd != -1) {
+      sock->setFD(folly::NetworkSocket::fromFd(fd),
+                  folly::AsyncUDPSocket::FDOwnership::SHARED);
+      sock->setDFAndTurnOffPMTU();
+    }
+    return sock;
+  }
+
+ private:
+  std::shared_ptr<UDPBatchStats> stats_;
+};
+
 } // namespace
 
 namespace quic::samples {
@@ -255,8 +278,13 @@ HQServer::HQServer(
           params_,
           std::move(httpTransactionHandlerProvider),
           std::move(onTransportReadyFn)));
-  server_->setQuicUDPSocketFactory(
-      std::make_unique<QuicSharedUDPSocketFactory>());
+  if (params_.udpBatchStats) {
+    server_->setQuicUDPSocketFactory(
+        std::make_unique<CountingUDPSocketFactory>(params_.udpBatchStats));
+  } else {
+    server_->setQuicUDPSocketFactory(
+        std::make_unique<QuicSharedUDPSocketFactory>());
+  }
   server_->setHealthCheckToken("health");
   server_->setSupportedVersion(params_.quicVersions);
   server_->setFizzContext(createFizzServerContext(params_));
@@ -288,6 +316,9 @@ const folly::SocketAddress HQServer::getAddress() const {
 
 void HQServer::stop() {
   server_->shutdown();
+  if (params_.udpBatchStats) {
+    LOG(INFO) << "HQ server UDP " << *params_.udpBatchStats;
+  }
 }
 
 void HQServer::rejectNewConnections(bool reject) {
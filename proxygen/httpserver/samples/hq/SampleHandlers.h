@@ -28,11 +28,11 @@
 #include <folly/Memory.h>
 #include <folly/Random.h>
 #include <folly/ThreadLocal.h>
-#include <folly/executors/GlobalExecutor.h>
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <proxygen/httpserver/samples/hq/HQServer.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/services/CPUOffloadPool.h>
 
 namespace quic::samples {
 
@@ -811,11 +811,7 @@ class StaticFileHandler : public BaseSampleHandler {
     proxygen::HTTPMessage resp = createHttpResponse(200, "Ok");
     maybeAddAltSvcHeader(resp);
     txn_->sendHeaders(resp);
-    // use a CPU executor since read(2) of a file can block
-    folly::getUnsafeMutableGlobalCPUExecutor()->add(
-        std::bind(&StaticFileHandler::readFile,
-                  this,
-                  folly::EventBaseManager::get()->getEventBase()));
+    readFile();
   }
 
   void onBody(std::unique_ptr<folly::IOBuf> /*chain*/) noexcept override {
@@ -837,41 +833,59 @@ class StaticFileHandler : public BaseSampleHandler {
   void onEgressResumed() noexcept override {
     VLOG(10) << "StaticFileHandler::onEgressResumed";
     paused_ = false;
-    folly::getUnsafeMutableGlobalCPUExecutor()->add(
-        std::bind(&StaticFileHandler::readFile,
-                  this,
-                  folly::EventBaseManager::get()->getEventBase()));
+    if (!reading_) {
+      readFile();
+    }
+  }
+
+  void detachTransaction() noexcept override {
+    // A read in flight still refers to this handler
+    detached_ = true;
+    if (!reading_) {
+      delete this;
+    }
   }
 
  private:
-  void readFile(folly::EventBase* evb) {
-    folly::IOBufQueue buf;
-    while (file_ && !paused_) {
-      // read 4k-ish chunks and foward each one to the client
-      auto data = buf.preallocate(4096, 4096);
-      auto rc = folly::readNoInt(file_->fd(), data.first, data.second);
-      if (rc < 0) {
-        // error
-        VLOG(4) << "Read error=" << rc;
-        file_.reset();
-        evb->runInEventBaseThread([this] {
-          LOG(ERROR) << "Error reading file";
-          txn_->sendAbort();
-        });
-        break;
-      } else if (rc == 0) {
-        // done
-        file_.reset();
-        VLOG(4) << "Read EOF";
-        evb->runInEventBaseThread([this] { txn_->sendEOM(); });
-        break;
-      } else {
-        buf.postallocate(rc);
-        evb->runInEventBaseThread([this, body = buf.move()]() mutable {
-          txn_->sendBody(std::move(body));
-        });
-      }
+  // Reads the next chunk on the CPU offload pool, since read(2) of a file
+  // can block, and sends it from the EventBase
+  void readFile() {
+    if (!file_ || paused_) {
+      return;
     }
+    reading_ = true;
+    proxygen::CPUOffloadPool::getDefault().submit(
+        folly::EventBaseManager::get()->getEventBase(),
+        [fd = file_->fd()] {
+          // read 64k-ish chunks and forward each one to the client
+          folly::IOBufQueue buf;
+          auto data = buf.preallocate(65536, 65536);
+          auto rc = folly::readNoInt(fd, data.first, data.second);
+          if (rc > 0) {
+            buf.postallocate(rc);
+          }
+          return std::make_pair(rc, buf.move());
+        },
+        [this](std::pair<ssize_t, std::unique_ptr<folly::IOBuf>> result) {
+          reading_ = false;
+          if (detached_) {
+            delete this;
+            return;
+          }
+          if (result.first < 0) {
+            VLOG(4) << "Read error=" << result.first;
+            file_.reset();
+            LOG(ERROR) << "Error reading file";
+            txn_->sendAbort();
+          } else if (result.first == 0) {
+            VLOG(4) << "Read EOF";
+            file_.reset();
+            txn_->sendEOM();
+          } else {
+            txn_->sendBody(std::move(result.second));
+            readFile();
+          }
+        });
   }
 
   void sendError(const std::string& errorMsg) {
@@ -884,7 +898,9 @@ class StaticFileHandler : public BaseSampleHandler {
   }
 
   std::unique_ptr<folly::File> file_;
-  std::atomic<bool> paused_{false};
+  bool paused_{false};
+  bool reading_{false};
+  bool detached_{false};
   std::string staticRoot_;
 };
 
@@ -14,6 +14,7 @@
 #include <proxygen/httpserver/samples/hq/ConnIdLogger.h>
 #include <proxygen/httpserver/samples/hq/HQClient.h>
 #include <proxygen/httpserver/samples/hq/HQCommandLine.h>
+#include <proxygen/httpserver/samples/hq/HQLoadClient.h>
 #include <proxygen/httpserver/samples/hq/HQParams.h>
 #include <proxygen/httpserver/samples/hq/HQServerModule.h>
 #include <proxygen/lib/transport/PersistentQuicPskCache.h>
@@ -48,9 +49,13 @@ int main(int argc, char* argv[]) {
       case HQMode::SERVER:
         startServer(boost::get<HQToolServerParams>(params.params));
         break;
-      case HQMode::CLIENT:
-        err = startClient(boost::get<HQToolClientParams>(params.params));
+      case HQMode::CLIENT: {
+        const auto& clientParams =
+            boost::get<HQToolClientParams>(params.params);
+        err = clientParams.loadThreads > 0 ? startLoadClient(clientParams)
+                                           : startClient(clientParams);
         break;
+      }
       default:
         LOG(ERROR) << "Unknown mode specified: ";
         return -1;
@@ -23,6 +23,8 @@ namespace ProxyService {
 
 class ProxyStats;
 
+// A minimal example. proxygen::ProxyTransactionHandler is a full duplex proxy
+// over pooled upstream sessions.
 class ProxyHandler
     : public proxygen::RequestHandler
     , public folly::DelayedDestruction
@@ -8,20 +8,57 @@
 
 #include "StaticHandler.h"
 
-#include <folly/FileUtil.h>
-#include <folly/executors/GlobalExecutor.h>
-#include <folly/io/async/EventBaseManager.h>
+#include <folly/File.h>
+#include <folly/portability/SysStat.h>
 #include <proxygen/httpserver/RequestHandler.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
+#include <proxygen/lib/utils/FileBodySource.h>
 
 using namespace proxygen;
 
 namespace StaticService {
 
+namespace {
+
+// Zero copy slices of a body held in memory
+RangeResponse::Reader makeReader(
+    std::shared_ptr<const StaticFileCache::Entry> entry,
+    const folly::IOBuf* body) {
+  return [entry = std::move(entry), body](uint64_t offset, uint64_t length) {
+    length = std::min<uint64_t>(length, FileBodySource::kDefaultChunkSize);
+    auto chunk = body->clone();
+    chunk->trimStart(offset);
+    chunk->trimEnd(chunk->length() - length);
+    return chunk;
+  };
+}
+
+// Maps each range of file as it gets to it
+RangeResponse::Reader makeReader(folly::File file) {
+  return [file = std::move(file),
+          source = std::unique_ptr<FileBodySource>(),
+          next = uint64_t(0)](uint64_t offset, uint64_t length) mutable {
+    if (!source || offset != next) {
+      source = std::make_unique<FileBodySource>(file.dup(), offset, length);
+    }
+    auto chunk = source->next();
+    next = offset + chunk->length();
+    return chunk;
+  };
+}
+
+} // namespace
+
 /**
- * Handles requests by serving the file named in path.  Only supports GET.
- * reads happen in a CPU thread pool since read(2) is blocking.
- * If egress pauses, file reading is also paused.
+ * Handles requests by serving the file named in path.  Only supports GET,
+ * and honors Range and If-Range, with a multipart/byteranges body for
+ * several ranges.
+ * The file is memory mapped and sent from the EventBase in large chunks that
+ * reference the page cache directly, so there are no copies or thread hops.
+ * With a StaticFileCache, the files it holds are served from their cached
+ * mapping, in their smallest accepted content coding, and revalidated with
+ * their ETag.
+ * If egress pauses, sending is also paused.
  */
 
 void StaticHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
@@ -34,71 +71,137 @@ void StaticHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
   }
   // a real webserver would validate this path didn't contain malicious
   // characters like '//' or '..'
+  // + 1 to kill leading /
+  auto path = headers->getPathAsStringPiece().subpiece(1).str();
+  std::shared_ptr<const StaticFileCache::Entry> entry;
+  folly::File file;
+  uint64_t size = 0;
   try {
-    // + 1 to kill leading /
-    file_ = std::make_unique<folly::File>(
-        headers->getPathAsStringPiece().subpiece(1));
+    if (cache_) {
+      // nullptr if too big to cache
+      entry = cache_->get(path);
+    }
+    if (entry) {
+      size = entry->size;
+    } else {
+      file = folly::File(path);
+      struct stat st;
+      if (fstat(file.fd(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        throw std::system_error(
+            EISDIR, std::generic_category(), "not a file");
+      }
+      size = st.st_size;
+    }
   } catch (const std::system_error& ex) {
+    sendNotFound(*headers, ex);
+    return;
+  }
+
+  const auto& requestHeaders = headers->getHeaders();
+  if (entry && requestHeaders.getSingleOrEmpty(HTTP_HEADER_IF_NONE_MATCH) ==
+                   entry->etag) {
     ResponseBuilder(downstream_)
-        .status(404, "Not Found")
-        .body(folly::to<std::string>("Could not find ",
-                                     headers->getPathAsStringPiece(),
-                                     " ex=",
-                                     folly::exceptionStr(ex)))
+        .status(304, "Not Modified")
+        .header(HTTP_HEADER_ETAG, entry->etag)
         .sendWithEOM();
     return;
   }
-  ResponseBuilder(downstream_).status(200, "Ok").send();
-  // use a CPU executor since read(2) of a file can block
-  readFileScheduled_ = true;
-  folly::getUnsafeMutableGlobalCPUExecutor()->add(
-      std::bind(&StaticHandler::readFile,
-                this,
-                folly::EventBaseManager::get()->getEventBase()));
-}
 
-void StaticHandler::readFile(folly::EventBase* evb) {
-  folly::IOBufQueue buf;
-  while (file_ && !paused_) {
-    // read 4k-ish chunks and foward each one to the client
-    auto data = buf.preallocate(4000, 4000);
-    auto rc = folly::readNoInt(file_->fd(), data.first, data.second);
-    if (rc < 0) {
-      // error
-      VLOG(4) << "Read error=" << rc;
-      file_.reset();
-      evb->runInEventBaseThread([this] {
-        LOG(ERROR) << "Error reading file";
-        downstream_->sendAbort();
-      });
-      break;
-    } else if (rc == 0) {
-      // done
-      file_.reset();
-      VLOG(4) << "Read EOF";
-      evb->runInEventBaseThread(
-          [this] { ResponseBuilder(downstream_).sendWithEOM(); });
-      break;
-    } else {
-      buf.postallocate(rc);
-      evb->runInEventBaseThread([this, body = buf.move()]() mutable {
-        ResponseBuilder(downstream_).body(std::move(body)).send();
+  RangeResponse::Representation representation;
+  representation.size = size;
+  if (entry) {
+    // Without validators, If-Range never matches
+    representation.etag = entry->etag;
+    representation.lastModified = entry->lastModified;
+  }
+  body_ = std::make_unique<RangeResponse>(requestHeaders, representation);
+
+  // Ranges are of the identity coding
+  const StaticFileCache::Entry::Variant* variant = nullptr;
+  if (entry && body_->getStatus() == RangeResponse::Status::FULL) {
+    variant = entry->chooseVariant(
+        requestHeaders.getSingleOrEmpty(HTTP_HEADER_ACCEPT_ENCODING));
+  }
+  if (variant) {
+    representation.size = variant->body->length();
+    body_ = std::make_unique<RangeResponse>(HTTPHeaders(), representation);
+    reader_ = makeReader(entry, variant->body.get());
+  } else if (entry) {
+    reader_ = makeReader(entry, entry->body.get());
+  } else {
+    reader_ = makeReader(std::move(file));
+  }
+
+  HTTPMessage message;
+  body_->setHeaders(message);
+  bool empty = !hasBody();
+  if (empty) {
+    // sendWithEOM sets it
+    message.getHeaders().remove(HTTP_HEADER_CONTENT_LENGTH);
+  }
+  ResponseBuilder response(downstream_);
+  response.status(message.getStatusCode(), message.getStatusMessage());
+  message.getHeaders().forEach(
+      [&](const std::string& name, const std::string& value) {
+        response.header(name, value);
       });
+  if (entry) {
+    response.header(HTTP_HEADER_ETAG, entry->etag)
+        .header(HTTP_HEADER_LAST_MODIFIED, entry->lastModified);
+    if (!entry->variants.empty()) {
+      response.header(HTTP_HEADER_VARY, "Accept-Encoding");
     }
   }
+  if (variant) {
+    response.header(HTTP_HEADER_CONTENT_ENCODING, variant->coding);
+  }
+  if (empty) {
+    body_.reset();
+    response.sendWithEOM();
+    return;
+  }
+  response.send();
+  sendBody();
+}
 
-  // Notify the request thread that we terminated the readFile loop
-  evb->runInEventBaseThread([this] {
-    readFileScheduled_ = false;
-    if (!checkForCompletion() && !paused_) {
-      VLOG(4) << "Resuming deferred readFile";
-      onEgressResumed();
+void StaticHandler::sendNotFound(const HTTPMessage& headers,
+                                 const std::system_error& ex) {
+  ResponseBuilder(downstream_)
+      .status(404, "Not Found")
+      .body(folly::to<std::string>("Could not find ",
+                                   headers.getPathAsStringPiece(),
+                                   " ex=",
+                                   folly::exceptionStr(ex)))
+      .sendWithEOM();
+}
+
+void StaticHandler::sendBody() {
+  sending_ = true;
+  // Sending can pause egress, which stops the loop until onEgressResumed
+  while (hasBody() && !paused_ && !finished_) {
+    std::unique_ptr<folly::IOBuf> chunk;
+    try {
+      chunk = body_->next(reader_);
+    } catch (const std::system_error& ex) {
+      // The file shrank since it was opened
+      LOG(ERROR) << "Error mapping file ex=" << folly::exceptionStr(ex);
+      body_.reset();
+      downstream_->sendAbort();
+      break;
     }
-  });
+    if (!hasBody()) {
+      VLOG(4) << "Sent whole file";
+      body_.reset();
+      ResponseBuilder(downstream_).body(std::move(chunk)).sendWithEOM();
+    } else {
+      ResponseBuilder(downstream_).body(std::move(chunk)).send();
+    }
+  }
+  sending_ = false;
+  checkForCompletion();
 }
 
 void StaticHandler::onEgressPaused() noexcept {
-  // This will terminate readFile soon
   VLOG(4) << "StaticHandler paused";
   paused_ = true;
 }
@@ -106,15 +209,9 @@ void StaticHandler::onEgressPaused() noexcept {
 void StaticHandler::onEgressResumed() noexcept {
   VLOG(4) << "StaticHandler resumed";
   paused_ = false;
-  // If readFileScheduled_, it will reschedule itself
-  if (!readFileScheduled_ && file_) {
-    readFileScheduled_ = true;
-    folly::getUnsafeMutableGlobalCPUExecutor()->add(
-        std::bind(&StaticHandler::readFile,
-                  this,
-                  folly::EventBaseManager::get()->getEventBase()));
-  } else {
-    VLOG(4) << "Deferred scheduling readFile";
+  // If sending_, the loop in sendBody picks up again
+  if (!sending_ && hasBody()) {
+    sendBody();
   }
 }
 
@@ -131,18 +228,16 @@ void StaticHandler::onUpgrade(UpgradeProtocol /*protocol*/) noexcept {
 
 void StaticHandler::requestComplete() noexcept {
   finished_ = true;
-  paused_ = true;
   checkForCompletion();
 }
 
 void StaticHandler::onError(ProxygenError /*err*/) noexcept {
   finished_ = true;
-  paused_ = true;
   checkForCompletion();
 }
 
 bool StaticHandler::checkForCompletion() {
-  if (finished_ && !readFileScheduled_) {
+  if (finished_ && !sending_) {
     VLOG(4) << "deleting StaticHandler";
     delete this;
     return true;
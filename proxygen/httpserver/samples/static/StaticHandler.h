@@ -8,9 +8,10 @@
 
 #pragma once
 
-#include <folly/File.h>
 #include <folly/Memory.h>
 #include <proxygen/httpserver/RequestHandler.h>
+#include <proxygen/lib/http/RangeResponse.h>
+#include <proxygen/lib/utils/StaticFileCache.h>
 
 namespace proxygen {
 class ResponseHandler;
@@ -20,6 +21,11 @@ namespace StaticService {
 
 class StaticHandler : public proxygen::RequestHandler {
  public:
+  // Serves the files cache holds, if not null, from memory
+  explicit StaticHandler(proxygen::StaticFileCache* cache = nullptr)
+      : cache_(cache) {
+  }
+
   void onRequest(
       std::unique_ptr<proxygen::HTTPMessage> headers) noexcept override;
 
@@ -38,12 +44,20 @@ class StaticHandler : public proxygen::RequestHandler {
   void onEgressResumed() noexcept override;
 
  private:
-  void readFile(folly::EventBase* evb);
+  void sendNotFound(const proxygen::HTTPMessage& headers,
+                    const std::system_error& ex);
+  bool hasBody() const {
+    return body_ && body_->remaining() > 0;
+  }
+  void sendBody();
   bool checkForCompletion();
 
-  std::unique_ptr<folly::File> file_;
-  bool readFileScheduled_{false};
-  std::atomic<bool> paused_{false};
+  proxygen::StaticFileCache* cache_;
+  std::unique_ptr<proxygen::RangeResponse> body_;
+  // Of the cached entry or the file
+  proxygen::RangeResponse::Reader reader_;
+  bool sending_{false};
+  bool paused_{false};
   bool finished_{false};
 };
 
@@ -11,6 +11,7 @@
 #include <folly/executors/GlobalExecutor.h>
 #include <folly/init/Init.h>
 #include <folly/io/async/EventBaseManager.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
 #include <folly/portability/GFlags.h>
 #include <folly/portability/Unistd.h>
 #include <proxygen/httpserver/HTTPServer.h>
@@ -32,11 +33,18 @@ DEFINE_int32(threads,
              0,
              "Number of threads to listen on. Numbers <= 0 "
              "will use the number of cores on this machine.");
+DEFINE_uint64(cache_mb,
+              256,
+              "Size of the in-memory file cache, 0 to read every file "
+              "from disk.");
 
 namespace {
 
 class StaticHandlerFactory : public RequestHandlerFactory {
  public:
+  explicit StaticHandlerFactory(StaticFileCache* cache) : cache_(cache) {
+  }
+
   void onServerStart(folly::EventBase* /*evb*/) noexcept override {
   }
 
@@ -44,8 +52,11 @@ class StaticHandlerFactory : public RequestHandlerFactory {
   }
 
   RequestHandler* onRequest(RequestHandler*, HTTPMessage*) noexcept override {
-    return new StaticHandler;
+    return new StaticHandler(cache_);
   }
+
+ private:
+  StaticFileCache* cache_;
 };
 
 } // namespace
@@ -63,13 +74,25 @@ int main(int argc, char* argv[]) {
     CHECK_GT(FLAGS_threads, 0);
   }
 
+  // Must outlive the cache watching from it
+  folly::ScopedEventBaseThread watchThread("StaticFileWatch");
+  std::unique_ptr<StaticFileCache> cache;
+  if (FLAGS_cache_mb > 0) {
+    StaticFileCache::Options cacheOptions;
+    cacheOptions.maxBytes = FLAGS_cache_mb * 1024 * 1024;
+    cache = std::make_unique<StaticFileCache>(cacheOptions);
+    if (!cache->watch(watchThread.getEventBase())) {
+      LOG(WARNING) << "Cached files won't be revalidated";
+    }
+  }
+
   HTTPServerOptions options;
   options.threads = static_cast<size_t>(FLAGS_threads);
   options.idleTimeout = std::chrono::milliseconds(60000);
   options.shutdownOn = {SIGINT, SIGTERM};
   options.enableContentCompression = false;
   options.handlerFactories =
-      RequestHandlerChain().addThen<StaticHandlerFactory>().build();
+      RequestHandlerChain().addThen<StaticHandlerFactory>(cache.get()).build();
   options.h2cEnabled = true;
 
   auto diskIOThreadPool = std::make_shared<folly::CPUThreadPoolExecutor>(
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/CoroRequestHandler.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/Mocks.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+// Reads all of the body, then echoes it once egress is not paused
+class TestCoroHandler : public CoroRequestHandler {
+ public:
+  TestCoroHandler(folly::EventBase* evb, bool* destroyed)
+      : CoroRequestHandler(evb), destroyed_(destroyed) {
+  }
+
+  ~TestCoroHandler() override {
+    *destroyed_ = true;
+  }
+
+  std::string body;
+  bool sawError{false};
+  bool throwAfterBody{false};
+
+ protected:
+  folly::coro::Task<void> handleRequest(
+      std::unique_ptr<HTTPMessage> /*headers*/) override {
+    try {
+      while (auto chunk = co_await readBody()) {
+        body += chunk->moveToFbString().toStdString();
+      }
+      if (throwAfterBody) {
+        throw std::runtime_error("failed");
+      }
+      co_await waitForEgress();
+    } catch (const HTTPException&) {
+      sawError = true;
+      co_return;
+    }
+    downstream_->sendBody(folly::IOBuf::copyBuffer(body));
+    downstream_->sendEOM();
+  }
+
+ private:
+  bool* destroyed_;
+};
+
+} // namespace
+
+class CoroRequestHandlerTest : public Test {
+ public:
+  void SetUp() override {
+    handler_ = new TestCoroHandler(&evb_, &destroyed_);
+    downstream_ = std::make_unique<StrictMock<MockResponseHandler>>(handler_);
+    handler_->setResponseHandler(downstream_.get());
+  }
+
+ protected:
+  folly::EventBase evb_;
+  bool destroyed_{false};
+  TestCoroHandler* handler_{nullptr};
+  std::unique_ptr<StrictMock<MockResponseHandler>> downstream_;
+};
+
+TEST_F(CoroRequestHandlerTest, ReadsBodyAndWaitsForEgress) {
+  std::string sent;
+  EXPECT_CALL(*downstream_, sendBody(_))
+      .WillOnce(Invoke([&](std::shared_ptr<folly::IOBuf> buf) {
+        sent = buf->moveToFbString().toStdString();
+      }));
+
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  // Before the coroutine starts
+  handler_->onBody(folly::IOBuf::copyBuffer("hello "));
+  evb_.loopOnce();
+  // Resumed inline
+  handler_->onBody(folly::IOBuf::copyBuffer("world"));
+  EXPECT_EQ(handler_->body, "hello world");
+  handler_->onEgressPaused();
+  handler_->onEOM();
+  EXPECT_TRUE(sent.empty());
+
+  EXPECT_CALL(*downstream_, sendEOM());
+  handler_->onEgressResumed();
+  EXPECT_EQ(sent, "hello world");
+  EXPECT_FALSE(destroyed_);
+  handler_->requestComplete();
+  EXPECT_TRUE(destroyed_);
+}
+
+TEST_F(CoroRequestHandlerTest, PausesIngress) {
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  auto big = folly::IOBuf::create(CoroRequestHandler::kMaxBufferedBody);
+  big->append(CoroRequestHandler::kMaxBufferedBody);
+  handler_->onBody(std::move(big));
+  // Until the coroutine starts reading it
+  EXPECT_CALL(*downstream_, pauseIngress());
+  handler_->onBody(folly::IOBuf::copyBuffer("a"));
+  Mock::VerifyAndClearExpectations(downstream_.get());
+
+  EXPECT_CALL(*downstream_, resumeIngress());
+  evb_.loopOnce();
+  EXPECT_EQ(handler_->body.size(), CoroRequestHandler::kMaxBufferedBody + 1);
+  handler_->onError(kErrorConnectionReset);
+  EXPECT_TRUE(destroyed_);
+}
+
+TEST_F(CoroRequestHandlerTest, ErrorWhileWaiting) {
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  evb_.loopOnce();
+  handler_->onBody(folly::IOBuf::copyBuffer("partial"));
+  EXPECT_FALSE(destroyed_);
+  handler_->onError(kErrorConnectionReset);
+  EXPECT_TRUE(destroyed_);
+}
+
+TEST_F(CoroRequestHandlerTest, ErrorBeforeStart) {
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  handler_->onError(kErrorTimeout);
+  EXPECT_FALSE(destroyed_);
+  evb_.loopOnce();
+  EXPECT_TRUE(destroyed_);
+}
+
+TEST_F(CoroRequestHandlerTest, ExceptionAborts) {
+  handler_->throwAfterBody = true;
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  evb_.loopOnce();
+  EXPECT_CALL(*downstream_, sendAbort());
+  handler_->onEOM();
+  EXPECT_FALSE(destroyed_);
+  handler_->requestComplete();
+  EXPECT_TRUE(destroyed_);
+}
+
+TEST_F(CoroRequestHandlerTest, ExceptionAbortsDetachingInline) {
+  handler_->throwAfterBody = true;
+  handler_->onRequest(std::make_unique<HTTPMessage>());
+  evb_.loopOnce();
+  // As RequestHandlerAdaptor does once the transaction detaches
+  EXPECT_CALL(*downstream_, sendAbort()).WillOnce(Invoke([this] {
+    handler_->requestComplete();
+  }));
+  handler_->onEOM();
+  EXPECT_TRUE(destroyed_);
+}
+
+#endif // FOLLY_HAS_COROUTINES
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fizz/protocol/CertUtils.h>
+#include <fizz/server/CertManager.h>
+#include <folly/FileUtil.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/HQServer.h>
+#include <proxygen/lib/utils/TestUtils.h>
+
+using namespace proxygen;
+
+namespace {
+
+const std::string kTestDir = getContainingDirectory(__FILE__).str();
+
+class MockRequestHandlerFactory : public RequestHandlerFactory {
+ public:
+  MOCK_METHOD((void), onServerStart, (folly::EventBase*), (noexcept));
+  MOCK_METHOD((void), onServerStop, (), (noexcept));
+  MOCK_METHOD((RequestHandler*),
+              onRequest,
+              (RequestHandler*, HTTPMessage*),
+              (noexcept));
+};
+
+std::shared_ptr<const fizz::server::FizzServerContext> makeFizzContext() {
+  std::string certData;
+  std::string keyData;
+  CHECK(folly::readFile((kTestDir + "certs/test_cert1.pem").c_str(), certData));
+  CHECK(folly::readFile((kTestDir + "certs/test_key1.pem").c_str(), keyData));
+  auto certManager = std::make_shared<fizz::server::CertManager>();
+  certManager->addCert(fizz::CertUtils::makeSelfCert(certData, keyData), true);
+  auto ctx = std::make_shared<fizz::server::FizzServerContext>();
+  ctx->setCertManager(std::move(certManager));
+  ctx->setSupportedAlpns({kH3});
+  ctx->setAlpnMode(fizz::server::AlpnMode::Required);
+  return ctx;
+}
+
+HQServerOptions makeOptions() {
+  HQServerOptions options;
+  options.address = folly::SocketAddress("127.0.0.1", 0);
+  options.fizzContext = makeFizzContext();
+  return options;
+}
+
+} // namespace
+
+class HQServerTest : public testing::Test {
+ public:
+  void SetUp() override {
+    auto handlerFactory = std::make_unique<MockRequestHandlerFactory>();
+    handlerFactory_ = handlerFactory.get();
+    HTTPServerOptions httpOptions;
+    httpOptions.threads = kThreads;
+    httpOptions.handlerFactories.push_back(std::move(handlerFactory));
+    httpOptions_ =
+        std::make_shared<const HTTPServerOptions>(std::move(httpOptions));
+  }
+
+ protected:
+  static constexpr size_t kThreads = 2;
+  MockRequestHandlerFactory* handlerFactory_{nullptr};
+  std::shared_ptr<const HTTPServerOptions> httpOptions_;
+};
+
+TEST_F(HQServerTest, StartStop) {
+  EXPECT_CALL(*handlerFactory_, onServerStart(testing::_)).Times(kThreads);
+  EXPECT_CALL(*handlerFactory_, onServerStop()).Times(kThreads);
+
+  HQServer server(makeOptions(), httpOptions_);
+  server.start();
+  EXPECT_NE(server.getAddress().getPort(), 0);
+  // One SO_REUSEPORT listener per worker
+  EXPECT_EQ(server.getListeningSocketFDs().size(), kThreads);
+  server.stop();
+}
+
+TEST_F(HQServerTest, SharedExecutor) {
+  // The owner of the executor runs the handler factories' callbacks
+  EXPECT_CALL(*handlerFactory_, onServerStart(testing::_)).Times(0);
+  EXPECT_CALL(*handlerFactory_, onServerStop()).Times(0);
+
+  auto ioExecutor = std::make_shared<folly::IOThreadPoolExecutor>(kThreads);
+  HQServer server(makeOptions(), httpOptions_);
+  server.start(ioExecutor);
+  EXPECT_EQ(server.getListeningSocketFDs().size(), kThreads);
+  server.stop();
+  ioExecutor->join();
+}
+
+TEST_F(HQServerTest, Takeover) {
+  EXPECT_CALL(*handlerFactory_, onServerStart(testing::_))
+      .Times(2 * kThreads);
+  EXPECT_CALL(*handlerFactory_, onServerStop()).Times(2 * kThreads);
+
+  auto oldOptions = makeOptions();
+  oldOptions.takeoverAddress = folly::SocketAddress("127.0.0.1", 0);
+  HQServer oldServer(std::move(oldOptions), httpOptions_);
+  oldServer.start();
+
+  auto newOptions = makeOptions();
+  newOptions.address = oldServer.getAddress();
+  newOptions.listeningFds = oldServer.getListeningSocketFDs();
+  newOptions.processId = quic::ProcessId::ONE;
+  HQServer newServer(std::move(newOptions), httpOptions_);
+  newServer.start();
+  EXPECT_EQ(newServer.getAddress(), oldServer.getAddress());
+
+  oldServer.stopListening();
+  oldServer.drain();
+  oldServer.stop();
+  newServer.stop();
+}
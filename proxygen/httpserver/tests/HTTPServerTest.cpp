@@ -7,6 +7,7 @@
  */
 
 #include <memory>
+#include <thread>
 
 #include <boost/thread.hpp>
 #include <folly/FileUtil.h>
@@ -321,6 +322,31 @@ TEST(SSL, SSLTest) {
   EXPECT_TRUE(cb.success);
 }
 
+TEST(SSL, SerialTLSInit) {
+  HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
+                           HTTPServer::Protocol::HTTP};
+  cfg.sslConfigs.push_back(getSslContextConfig(false));
+
+  HTTPServerOptions options;
+  options.threads = 4;
+  options.parallelTLSInit = false;
+
+  auto server = std::make_unique<HTTPServer>(std::move(options));
+  server->bind({cfg});
+
+  ServerThread st(server.get());
+  EXPECT_TRUE(st.start());
+  EXPECT_EQ(server->getStartTimes().tlsInit.count(), 0);
+
+  folly::EventBase evb;
+  auto ctx = std::make_shared<SSLContext>();
+  folly::AsyncSSLSocket::UniquePtr sock(new folly::AsyncSSLSocket(ctx, &evb));
+  Cb cb(sock.get());
+  sock->connect(&cb, server->addresses().front().address, 1000);
+  evb.loop();
+  EXPECT_TRUE(cb.success);
+}
+
 TEST(SSL, SSLTestWithMultiCAs) {
   HTTPServer::IPConfig cfg{folly::SocketAddress("127.0.0.1", 0),
                            HTTPServer::Protocol::HTTP};
@@ -934,7 +960,7 @@ class ScopedServerTest : public testing::Test {
     return client;
   }
 
-  std::unique_ptr<CurlClient> connectPlainText() {
+  std::unique_ptr<CurlClient> connectPlainText(bool tcpFastOpen = false) {
     URL url(folly::to<std::string>("http://localhost:", address_.getPort()));
     HTTPHeaders headers;
     auto client = std::make_unique<CurlClient>(
@@ -942,6 +968,7 @@ class ScopedServerTest : public testing::Test {
     client->setFlowControlSettings(64 * 1024);
     client->setLogging(false);
     HTTPConnector connector(client.get(), timer_.get());
+    connector.setTCPFastOpen(tcpFastOpen);
     connector.connect(&evb_, address_, std::chrono::milliseconds(1000));
     evb_.loop();
     return client;
@@ -1009,6 +1036,46 @@ TEST_F(ScopedServerTest, StartSSLWithInsecure) {
   EXPECT_EQ(200, resp->getStatusCode());
 }
 
+TEST_F(ScopedServerTest, FastOpenAndDeferAccept) {
+  cfg_.enableTCPFastOpen = true;
+  cfg_.deferAccept = std::chrono::seconds(1);
+  auto server = createScopedServer();
+  // The first connection gets the cookie, the next one can use it
+  for (auto i = 0; i < 2; i++) {
+    auto client = connectPlainText(true);
+    auto resp = client->getResponse();
+    ASSERT_NE(nullptr, resp);
+    EXPECT_EQ(200, resp->getStatusCode());
+  }
+}
+
+TEST_F(ScopedServerTest, AddressMaxConnections) {
+  cfg_.isolation.ioThreads = 2;
+  cfg_.isolation.maxConnections = 1;
+  auto server = createScopedServer();
+  auto stats = server->getServer().getAddressStats(0);
+  ASSERT_NE(stats, nullptr);
+  auto waitForConnections = [stats](uint64_t connections) {
+    for (auto i = 0; i < 1000 && stats->connections != connections; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(stats->connections, connections);
+  };
+
+  // Takes the address' only connection without a request
+  auto idle = folly::AsyncSocket::newSocket(&evb_, address_);
+  waitForConnections(1);
+  auto client = connectPlainText();
+  EXPECT_EQ(nullptr, client->getResponse());
+  EXPECT_EQ(stats->rejectedConnections, 1);
+
+  idle->closeNow();
+  waitForConnections(0);
+  client = connectPlainText();
+  ASSERT_NE(nullptr, client->getResponse());
+  EXPECT_EQ(200, client->getResponse()->getStatusCode());
+}
+
 class ConnectionFilterTest : public ScopedServerTest {
  protected:
   HTTPServerOptions createDefaultOpts() override {
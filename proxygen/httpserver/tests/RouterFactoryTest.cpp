@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/RouterFactory.h>
+
+#include <folly/portability/GTest.h>
+#include <proxygen/httpserver/filters/DirectResponseHandler.h>
+
+using namespace proxygen;
+
+namespace {
+
+RequestHandler* noHandler(HTTPMessage* /*msg*/,
+                          const RouterFactory::Match& /*match*/) {
+  return nullptr;
+}
+
+class CountingStats : public RouterFactory::StatsCallback {
+ public:
+  void onRouted(const RouterFactory::Route& /*route*/) noexcept override {
+    routed++;
+  }
+  void onNotRouted(RouterFactory::MatchResult /*result*/) noexcept override {
+    notRouted++;
+  }
+
+  size_t routed{0};
+  size_t notRouted{0};
+};
+
+} // namespace
+
+class RouterFactoryTest : public testing::Test {
+ protected:
+  RouterFactory::MatchResult match(folly::Optional<HTTPMethod> method,
+                                   folly::StringPiece path) {
+    return router_.match(method, path, match_);
+  }
+
+  std::string matchedPattern() const {
+    return match_.getRoute()->pattern;
+  }
+
+  RouterFactory router_;
+  RouterFactory::Match match_;
+};
+
+TEST_F(RouterFactoryTest, Literal) {
+  router_.addRoute(HTTPMethod::GET, "/", noHandler)
+      .addRoute(HTTPMethod::GET, "/users", noHandler)
+      .addRoute(HTTPMethod::GET, "/users/list", noHandler);
+
+  EXPECT_EQ(match(HTTPMethod::GET, "/"), RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(matchedPattern(), "/");
+  EXPECT_EQ(match(HTTPMethod::GET, "/users"),
+            RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(matchedPattern(), "/users");
+  EXPECT_EQ(match(HTTPMethod::GET, "/users/list"),
+            RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(matchedPattern(), "/users/list");
+  EXPECT_EQ(match_.numParams(), 0);
+
+  EXPECT_EQ(match(HTTPMethod::GET, "/users/"),
+            RouterFactory::MatchResult::NOT_FOUND);
+  EXPECT_EQ(match(HTTPMethod::GET, "/user"),
+            RouterFactory::MatchResult::NOT_FOUND);
+  EXPECT_EQ(match(HTTPMethod::GET, "users"),
+            RouterFactory::MatchResult::NOT_FOUND);
+  EXPECT_EQ(match_.getRoute(), nullptr);
+}
+
+TEST_F(RouterFactoryTest, Params) {
+  router_.addRoute(HTTPMethod::GET, "/users/:id/posts/:post", noHandler);
+
+  EXPECT_EQ(match(HTTPMethod::GET, "/users/42/posts/7"),
+            RouterFactory::MatchResult::MATCHED);
+  ASSERT_EQ(match_.numParams(), 2);
+  EXPECT_EQ(match_.getParam(0), "42");
+  EXPECT_EQ(match_.getParam(1), "7");
+  EXPECT_EQ(*match_.getParam("id"), "42");
+  EXPECT_EQ(*match_.getParam("post"), "7");
+  EXPECT_FALSE(match_.getParam("other"));
+
+  // Parameters do not match empty segments
+  EXPECT_EQ(match(HTTPMethod::GET, "/users//posts/7"),
+            RouterFactory::MatchResult::NOT_FOUND);
+}
+
+TEST_F(RouterFactoryTest, Priority) {
+  router_.addRoute(HTTPMethod::GET, "/files/*path", noHandler)
+      .addRoute(HTTPMethod::GET, "/files/:name", noHandler)
+      .addRoute(HTTPMethod::GET, "/files/index", noHandler)
+      .addRoute(HTTPMethod::GET, "/files/:name/raw", noHandler);
+
+  EXPECT_EQ(match(HTTPMethod::GET, "/files/index"),
+            RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(matchedPattern(), "/files/index");
+  EXPECT_EQ(match(HTTPMethod::GET, "/files/a"),
+            RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(matchedPattern(), "/files/:name");
+  EXPECT_EQ(match(HTTPMethod::GET, "/files/a/raw"),
+            RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(matchedPattern(), "/files/:name/raw");
+
+  // Backtracks from the parameter to the wildcard
+  EXPECT_EQ(match(HTTPMethod::GET, "/files/a/b/c"),
+            RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(matchedPattern(), "/files/*path");
+  ASSERT_EQ(match_.numParams(), 1);
+  EXPECT_EQ(*match_.getParam("path"), "a/b/c");
+}
+
+TEST_F(RouterFactoryTest, Methods) {
+  router_.addRoute(HTTPMethod::GET, "/items", noHandler)
+      .addRoute(HTTPMethod::POST, "/items", noHandler)
+      .addRoute("/any", noHandler);
+
+  EXPECT_EQ(match(HTTPMethod::POST, "/items"),
+            RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(*match_.getRoute()->method, HTTPMethod::POST);
+  EXPECT_EQ(match(HTTPMethod::PUT, "/items"),
+            RouterFactory::MatchResult::METHOD_NOT_ALLOWED);
+  EXPECT_EQ(match(folly::none, "/items"),
+            RouterFactory::MatchResult::METHOD_NOT_ALLOWED);
+  EXPECT_EQ(match(HTTPMethod::PUT, "/any"),
+            RouterFactory::MatchResult::MATCHED);
+  EXPECT_EQ(match(folly::none, "/any"), RouterFactory::MatchResult::MATCHED);
+}
+
+TEST_F(RouterFactoryTest, BadRoutes) {
+  router_.addRoute(HTTPMethod::GET, "/a/:id", noHandler);
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "/a/:other", noHandler),
+               std::invalid_argument);
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "a", noHandler),
+               std::invalid_argument);
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "/*rest/b", noHandler),
+               std::invalid_argument);
+  EXPECT_THROW(router_.addRoute(HTTPMethod::GET, "/:", noHandler),
+               std::invalid_argument);
+  // Another method is fine
+  router_.addRoute(HTTPMethod::PUT, "/a/:id", noHandler);
+  EXPECT_EQ(router_.getRoutes().size(), 2);
+}
+
+TEST_F(RouterFactoryTest, OnRequest) {
+  HTTPMessage* routedMsg = nullptr;
+  std::string routedId;
+  router_.addRoute(
+      HTTPMethod::GET,
+      "/users/:id",
+      [&](HTTPMessage* msg, const RouterFactory::Match& match) {
+        routedMsg = msg;
+        routedId = match.getParam(0).str();
+        return nullptr;
+      });
+  auto stats = std::make_shared<CountingStats>();
+  router_.setStatsCallback(stats);
+
+  HTTPMessage msg;
+  msg.setMethod(HTTPMethod::GET);
+  msg.setURL("/users/3?x=1");
+  EXPECT_EQ(router_.onRequest(nullptr, &msg), nullptr);
+  EXPECT_EQ(routedMsg, &msg);
+  EXPECT_EQ(routedId, "3");
+  EXPECT_EQ(stats->routed, 1);
+
+  msg.setURL("/missing");
+  std::unique_ptr<RequestHandler> handler(router_.onRequest(nullptr, &msg));
+  EXPECT_NE(dynamic_cast<DirectResponseHandler*>(handler.get()), nullptr);
+  EXPECT_EQ(stats->notRouted, 1);
+}
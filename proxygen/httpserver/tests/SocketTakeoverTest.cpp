@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/httpserver/SocketTakeover.h>
+
+#include <thread>
+
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace proxygen;
+
+namespace {
+
+bool sameFile(int a, int b) {
+  struct stat sa, sb;
+  return fstat(a, &sa) == 0 && fstat(b, &sb) == 0 && sa.st_ino == sb.st_ino;
+}
+
+std::string tempPath() {
+  return "/tmp/proxygen_takeover_" + std::to_string(getpid());
+}
+
+} // namespace
+
+TEST(SocketTakeoverTest, SendAndReceive) {
+  int pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair), 0);
+  int a = socket(AF_INET, SOCK_STREAM, 0);
+  int b = socket(AF_INET, SOCK_STREAM, 0);
+  int c = socket(AF_INET6, SOCK_STREAM, 0);
+
+  SocketTakeover::sendSockets(pair[0], {{a, b}, {}, {c}});
+  auto groups = SocketTakeover::receiveSockets(pair[1]);
+  ASSERT_EQ(groups.size(), 3);
+  ASSERT_EQ(groups[0].size(), 2);
+  EXPECT_TRUE(groups[1].empty());
+  ASSERT_EQ(groups[2].size(), 1);
+  EXPECT_TRUE(sameFile(groups[0][0], a));
+  EXPECT_TRUE(sameFile(groups[0][1], b));
+  EXPECT_TRUE(sameFile(groups[2][0], c));
+  EXPECT_NE(groups[0][0], a);
+
+  for (auto& group : groups) {
+    for (auto fd : group) {
+      close(fd);
+    }
+  }
+  for (auto fd : {a, b, c, pair[0], pair[1]}) {
+    close(fd);
+  }
+}
+
+TEST(SocketTakeoverTest, Malformed) {
+  int pair[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair), 0);
+  ASSERT_EQ(send(pair[0], "garbage!", 8, 0), 8);
+  EXPECT_THROW(SocketTakeover::receiveSockets(pair[1]), std::runtime_error);
+  close(pair[0]);
+  close(pair[1]);
+}
+
+TEST(SocketTakeoverTest, NoServer) {
+  auto path = tempPath();
+  unlink(path.c_str());
+  EXPECT_FALSE(
+      SocketTakeover::requestSockets(path, std::chrono::milliseconds(100)));
+}
+
+TEST(SocketTakeoverTest, Takeover) {
+  auto path = tempPath();
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  folly::EventBase evb;
+  bool takenOver = false;
+  SocketTakeoverServer server(
+      &evb,
+      path,
+      [&] { return SocketTakeover::SocketGroups{{listener}}; },
+      [&] {
+        takenOver = true;
+        evb.terminateLoopSoon();
+      });
+  server.start();
+  std::thread loop([&] { evb.loopForever(); });
+
+  // A process going away before confirming leaves the server serving
+  auto takeover =
+      SocketTakeover::requestSockets(path, std::chrono::milliseconds(1000));
+  ASSERT_TRUE(takeover);
+  close(takeover->sockets[0][0]);
+  close(takeover->fd);
+
+  takeover =
+      SocketTakeover::requestSockets(path, std::chrono::milliseconds(1000));
+  ASSERT_TRUE(takeover);
+  ASSERT_EQ(takeover->sockets.size(), 1);
+  EXPECT_TRUE(sameFile(takeover->sockets[0][0], listener));
+  SocketTakeover::confirm(takeover->fd);
+  loop.join();
+  EXPECT_TRUE(takenOver);
+
+  close(takeover->sockets[0][0]);
+  close(listener);
+  unlink(path.c_str());
+}
@@ -8,6 +8,8 @@
 
 #include "proxygen/lib/dns/CAresResolver.h"
 
+#include <algorithm>
+
 #include <folly/Conv.h>
 #include <folly/io/async/EventHandler.h>
 #include <folly/portability/Sockets.h>
@@ -603,6 +605,283 @@ class CAresResolver::MultiQuery
   }
 };
 
+// A query of resolveBatch() for a name and record type, shared by the batches
+// waiting for it while it's in flight.  Batches time out on their own, so the
+// query has no timeout; its answer is ignored once no batch waits for it.
+class CAresResolver::SharedQuery : private DNSResolver::ResolutionCallback {
+ public:
+  SharedQuery(CAresResolver* resolver, QueryKey key)
+      : resolver_(resolver), key_(std::move(key)) {
+  }
+
+  // May complete synchronously
+  void start() {
+    auto q = new Query(resolver_,
+                       key_.first,
+                       key_.second,
+                       false,
+                       TraceEvent(TraceEventType::DnsResolution),
+                       &resolver_->timeUtil_);
+    q->setDnsCryptUsed(false, 0);
+    q->resolve(this, std::chrono::milliseconds(0));
+  }
+
+  void addWaiter(uint64_t batchId, size_t index) {
+    waiters_.emplace_back(batchId, index);
+  }
+
+  // Deletes this once no batch waits
+  void removeWaiter(uint64_t batchId) {
+    waiters_.erase(std::remove_if(waiters_.begin(),
+                                  waiters_.end(),
+                                  [batchId](const auto& waiter) {
+                                    return waiter.first == batchId;
+                                  }),
+                   waiters_.end());
+    if (waiters_.empty()) {
+      cancelResolution();
+      resolver_->sharedQueries_.erase(key_);
+      delete this;
+    }
+  }
+
+ private:
+  ~SharedQuery() override {
+  }
+
+  void resolutionSuccess(std::vector<Answer> answers) noexcept override {
+    complete(std::move(answers), folly::exception_wrapper());
+  }
+
+  void resolutionError(const folly::exception_wrapper& ew) noexcept override {
+    complete({}, ew);
+  }
+
+  // Deletes this
+  void complete(std::vector<Answer> answers, folly::exception_wrapper ew);
+
+  CAresResolver* resolver_;
+  QueryKey key_;
+  // Batch id and index of the name in the batch
+  std::vector<std::pair<uint64_t, size_t>> waiters_;
+};
+
+// A resolveBatch() call, with one timeout for all its names.  Each name waits
+// for the SharedQuery of each of the record types.
+class CAresResolver::BatchQuery : private folly::AsyncTimeout {
+ public:
+  BatchQuery(CAresResolver* resolver,
+             BatchCallback* cb,
+             const std::vector<std::string>& names,
+             sa_family_t family,
+             std::vector<RecordType> types)
+      : AsyncTimeout(resolver->base_),
+        resolver_(resolver),
+        callback_(cb),
+        id_(resolver->nextBatchId_++),
+        family_(family),
+        types_(std::move(types)),
+        slots_(names.size()) {
+    for (size_t i = 0; i < names.size(); i++) {
+      slots_[i].result.name = names[i];
+    }
+  }
+
+  void resolve(std::chrono::milliseconds timeout) {
+    CHECK(callback_->batch_ == nullptr);
+    callback_->batch_ = this;
+    resolver_->batches_[id_] = this;
+    startTime_ = getCurrentTime();
+
+    // Queries may complete synchronously, hold the callback until all are sent
+    starting_ = true;
+    for (size_t i = 0; i < slots_.size(); i++) {
+      auto& slot = slots_[i];
+      if (resolveLocally(slot)) {
+        continue;
+      }
+      pendingSlots_++;
+      slot.pending = types_.size();
+      for (auto type : types_) {
+        QueryKey key(type, slot.result.name);
+        auto it = resolver_->sharedQueries_.find(key);
+        if (it != resolver_->sharedQueries_.end()) {
+          it->second->addWaiter(id_, i);
+          continue;
+        }
+        auto shared = new SharedQuery(resolver_, key);
+        resolver_->sharedQueries_.emplace(std::move(key), shared);
+        shared->addWaiter(id_, i);
+        shared->start();
+      }
+    }
+    starting_ = false;
+
+    if (pendingSlots_ == 0) {
+      finish();
+      return;
+    }
+    if (timeout.count() > 0 && !scheduleTimeout(timeout.count())) {
+      LOG(DFATAL) << "Failed to schedule timeout for batch of "
+                  << slots_.size() << " names";
+    }
+  }
+
+  // From the BatchCallback
+  void cancel() {
+    detach();
+    delete this;
+  }
+
+  void onQueryResult(size_t index,
+                     const std::vector<Answer>& answers,
+                     const folly::exception_wrapper& ew) {
+    auto& slot = slots_[index];
+    DCHECK_GT(slot.pending, 0);
+    slot.result.answers.insert(
+        slot.result.answers.end(), answers.begin(), answers.end());
+    // NOTE this will overwrite an existing error, as in MultiQuery
+    if (ew) {
+      slot.result.error = ew;
+    }
+    if (--slot.pending > 0) {
+      return;
+    }
+    slotDone(slot);
+    if (pendingSlots_ == 0 && !starting_) {
+      finish();
+    }
+  }
+
+ private:
+  struct Slot {
+    BatchResult result;
+    // Queries not answered yet
+    size_t pending{0};
+  };
+
+  // Handles literals and localhost, as resolveHostname() does
+  class LocalCallback : public DNSResolver::ResolutionCallback {
+   public:
+    void resolutionSuccess(std::vector<Answer> answers) noexcept override {
+      answers_ = std::move(answers);
+    }
+    void resolutionError(const folly::exception_wrapper& ew) noexcept override {
+      error_ = ew;
+    }
+
+    std::vector<Answer> answers_;
+    folly::exception_wrapper error_;
+  };
+
+  ~BatchQuery() override {
+  }
+
+  bool resolveLocally(Slot& slot) {
+    LocalCallback local;
+    if (!resolver_->resolveLiterals(&local, slot.result.name, family_) &&
+        !resolver_->resolveLocalhost(&local, slot.result.name, family_)) {
+      return false;
+    }
+    slot.result.answers = std::move(local.answers_);
+    slot.result.error = std::move(local.error_);
+    return true;
+  }
+
+  void slotDone(Slot& slot) {
+    DCHECK_GT(pendingSlots_, 0);
+    pendingSlots_--;
+    slot.pending = 0;
+    std::chrono::milliseconds resolutionTime = millisecondsSince(startTime_);
+    auto& result = slot.result;
+    if (!result.answers.empty()) {
+      result.error = folly::exception_wrapper();
+      resolver_->getStatsCollector()->recordSuccess(result.answers,
+                                                    resolutionTime);
+      return;
+    }
+    if (!result.error) {
+      result.error = folly::make_exception_wrapper<Exception>(
+          NODATA, "No answer in batch for " + result.name);
+    }
+    resolver_->getStatsCollector()->recordError(result.error, resolutionTime);
+  }
+
+  void timeoutExpired() noexcept override {
+    for (auto& slot : slots_) {
+      if (slot.pending == 0) {
+        continue;
+      }
+      removeWaiter(slot);
+      if (slot.result.answers.empty()) {
+        slot.result.error = folly::make_exception_wrapper<Exception>(
+            TIMEOUT, "Query timed out for " + slot.result.name);
+      }
+      slotDone(slot);
+    }
+    finish();
+  }
+
+  void removeWaiter(const Slot& slot) {
+    for (auto type : types_) {
+      // Gone once answered, or replaced by the query of a later batch
+      auto it =
+          resolver_->sharedQueries_.find(QueryKey(type, slot.result.name));
+      if (it != resolver_->sharedQueries_.end()) {
+        it->second->removeWaiter(id_);
+      }
+    }
+  }
+
+  void detach() {
+    for (const auto& slot : slots_) {
+      if (slot.pending > 0) {
+        removeWaiter(slot);
+      }
+    }
+    resolver_->batches_.erase(id_);
+    callback_->batch_ = nullptr;
+  }
+
+  void finish() {
+    BatchCallback* cb = callback_;
+    std::vector<BatchResult> results;
+    results.reserve(slots_.size());
+    for (auto& slot : slots_) {
+      results.push_back(std::move(slot.result));
+    }
+    detach();
+    delete this;
+    cb->batchResolved(std::move(results));
+  }
+
+  CAresResolver* resolver_;
+  BatchCallback* callback_;
+  const uint64_t id_;
+  const sa_family_t family_;
+  const std::vector<RecordType> types_;
+  std::vector<Slot> slots_;
+  size_t pendingSlots_{0};
+  bool starting_{false};
+  TimePoint startTime_;
+};
+
+void CAresResolver::SharedQuery::complete(std::vector<Answer> answers,
+                                          folly::exception_wrapper ew) {
+  CAresResolver* resolver = resolver_;
+  auto waiters = std::move(waiters_);
+  resolver->sharedQueries_.erase(key_);
+  delete this;
+
+  // A batch may complete, and its callback end other batches
+  for (const auto& [batchId, index] : waiters) {
+    auto it = resolver->batches_.find(batchId);
+    if (it != resolver->batches_.end()) {
+      it->second->onQueryResult(index, answers, ew);
+    }
+  }
+}
+
 // Helper class for managing DNS sockets
 class CAresResolver::SocketHandler : public folly::EventHandler {
  public:
@@ -974,6 +1253,57 @@ void CAresResolver::resolveMailExchange(DNSResolver::ResolutionCallback* cb,
   q->resolve(cb, timeout);
 }
 
+void CAresResolver::resolveBatch(BatchCallback* cb,
+                                 const std::vector<std::string>& names,
+                                 std::chrono::milliseconds timeout,
+                                 sa_family_t family) {
+  CHECK(cb != nullptr);
+  if (timeout > kMaxTimeout) {
+    LOG(WARNING) << "Attempt to resolve a batch of " << names.size()
+                 << " names specified with timeout of " << timeout.count()
+                 << "ms; clamping to " << kMaxTimeout.count() << "ms";
+    timeout = kMaxTimeout;
+  }
+
+  if (family != AF_INET && family != AF_INET6 && family != AF_UNSPEC) {
+    LOG(DFATAL) << "Unsupported family specified: " << family;
+    auto ew = folly::make_exception_wrapper<Exception>(
+        INVALID,
+        folly::to<std::string>("Unsupported address family: ", family));
+    std::vector<BatchResult> results(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+      results[i].name = names[i];
+      results[i].error = ew;
+    }
+    cb->batchResolved(std::move(results));
+    return;
+  }
+
+  std::vector<RecordType> types;
+  if (resolveSRVRecord_) {
+    types.push_back(RecordType::kSRV);
+  }
+  if (family != AF_INET6) {
+    types.push_back(RecordType::kA);
+  }
+  if (family != AF_INET) {
+    types.push_back(RecordType::kAAAA);
+  }
+
+  auto batch = new BatchQuery(this, cb, names, family, std::move(types));
+  batch->resolve(timeout);
+}
+
+CAresResolver::BatchCallback::~BatchCallback() {
+  cancelBatch();
+}
+
+void CAresResolver::BatchCallback::cancelBatch() {
+  if (batch_) {
+    batch_->cancel();
+  }
+}
+
 bool CAresResolver::resolveLiterals(DNSResolver::ResolutionCallback* cb,
                                     const std::string& host,
                                     sa_family_t family) {
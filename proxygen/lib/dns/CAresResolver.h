@@ -68,6 +68,9 @@ folly::Expected<std::vector<DNSResolver::Answer>, ParseError> parseMxRecords(
 } // namespace detail
 
 class CAresResolver : public DNSResolver {
+ private:
+  class BatchQuery;
+
  public:
   using UniquePtr = std::unique_ptr<CAresResolver, CAresResolver::Destructor>;
 
@@ -152,6 +155,35 @@ class CAresResolver : public DNSResolver {
         void* data, int status, int timeouts, unsigned char* abuf, int alen);
   };
 
+  /**
+   * The result of resolveBatch() for one name.
+   */
+  struct BatchResult {
+    std::string name;
+    std::vector<Answer> answers;
+    // Set when answers is empty
+    folly::exception_wrapper error;
+  };
+
+  /**
+   * Callback for resolveBatch(), for one batch at a time.  Destroying it
+   * cancels its batch.
+   */
+  class BatchCallback {
+   public:
+    virtual ~BatchCallback();
+
+    // No-op when no batch is pending
+    void cancelBatch();
+
+    // The results in the order of the names, even when the batch timed out
+    virtual void batchResolved(std::vector<BatchResult> results) noexcept = 0;
+
+   private:
+    friend class CAresResolver;
+    BatchQuery* batch_{nullptr};
+  };
+
   template <typename... Args>
   static UniquePtr newResolver(Args&&... args) {
     return UniquePtr(new CAresResolver(std::forward<Args>(args)...));
@@ -213,6 +245,30 @@ class CAresResolver : public DNSResolver {
                            const std::string& domain,
                            std::chrono::milliseconds timeout =
                                std::chrono::milliseconds(100)) override;
+
+  /**
+   * Resolve the addresses of names as resolveHostname() would each, with a
+   * single timeout and a single callback for the whole batch.
+   *
+   * The A and/or AAAA queries (and SRV, with resolveSRVOnly()) of all the
+   * names are sent at once, over the sockets the channel keeps open.  A
+   * query for a name and record type already in flight for a batch is
+   * shared instead of being sent again.
+   *
+   * @param cb                callback to invoke when all names are resolved
+   *                          or the timeout fired
+   * @param names             the hostnames to resolve, may repeat
+   * @param timeout           timeout for the whole batch; a value of 0
+   *                          indicates no timeout and values greater than
+   *                          kMaxTimeout will be clamped
+   * @param family            as for resolveHostname()
+   */
+  void resolveBatch(BatchCallback* cb,
+                    const std::vector<std::string>& names,
+                    std::chrono::milliseconds timeout =
+                        std::chrono::milliseconds(100),
+                    sa_family_t family = AF_UNSPEC);
+
   void setStatsCollector(DNSResolver::StatsCollector* statsCollector) override;
   DNSResolver::StatsCollector* getStatsCollector() const override;
   std::chrono::steady_clock::time_point& getLastNonceTimeRef();
@@ -225,6 +281,9 @@ class CAresResolver : public DNSResolver {
  private:
   class SocketHandler;
   class MultiQuery;
+  class SharedQuery;
+
+  using QueryKey = std::pair<RecordType, std::string>;
 
   void setSerializedServers();
 
@@ -239,6 +298,11 @@ class CAresResolver : public DNSResolver {
   TimeUtil timeUtil_;
   std::chrono::steady_clock::time_point lastNonceTimeStamp_;
   bool resolveSRVRecord_{false};
+  // The in flight queries of resolveBatch()
+  std::map<QueryKey, SharedQuery*> sharedQueries_;
+  // Pending batches by id, as a batch may end while a query is delivered
+  std::map<uint64_t, BatchQuery*> batches_;
+  uint64_t nextBatchId_{0};
 
   // Attempt to resolve literal IPs, invoking the callback and returning
   // true if we succeeded.
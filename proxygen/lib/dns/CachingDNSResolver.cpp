@@ -33,6 +33,7 @@ void CachingDNSResolver::resolveHostname(DNSResolver::ResolutionCallback* cb,
     bool needQuery = false;       // true if no or only expired answer exists
     bool hasCachedAnswer = false; // with respect to TTR
     bool isPartialMiss = false;
+    bool needRefresh = false; // enough of the TTL passed to refresh ahead
     for (auto& answer : res) {
       if (answer.type != Answer::AnswerType::AT_ADDRESS) {
         continue;
@@ -48,6 +49,9 @@ void CachingDNSResolver::resolveHostname(DNSResolver::ResolutionCallback* cb,
         } else {
           Answer ans(answer);
           ans.ttl -= secondsBetween(now, entry.baseTime_);
+          needRefresh |= refreshAheadRatio_ > 0 &&
+                         ans.ttl.count() <=
+                             answer.ttl.count() * (1 - refreshAheadRatio_);
           results.push_back(std::move(ans));
         }
       }
@@ -72,6 +76,13 @@ void CachingDNSResolver::resolveHostname(DNSResolver::ResolutionCallback* cb,
         std::shuffle(
             std::begin(results), std::end(results), folly::ThreadLocalPRNG{});
       }
+      // Before answering, as cb may own name
+      if (needRefresh) {
+        if (statsCollector_) {
+          statsCollector_->recordCacheRefresh();
+        }
+        startQuery(nullptr, name, timeout, family, std::move(teContext));
+      }
       cb->resolutionSuccess(std::move(results));
       return;
     } else {
@@ -85,11 +96,123 @@ void CachingDNSResolver::resolveHostname(DNSResolver::ResolutionCallback* cb,
     }
   }
 
-  Query* q = new Query(cb, name, family, this);
-  cb->insertQuery(q);
+  if (sharedCache_) {
+    std::vector<Answer> shared;
+    if (sharedCache_->lookup(name, family, now, shared)) {
+      if (statsCollector_) {
+        statsCollector_->recordSharedCacheHit();
+      }
+      addToCache(name, shared);
+      addToStaleCache(name, shared);
+      std::shuffle(
+          std::begin(shared), std::end(shared), folly::ThreadLocalPRNG{});
+      cb->resolutionSuccess(std::move(shared));
+      return;
+    }
+  }
+
+  NegativeEntry negative;
+  if (lookupNegativeCache(getQueryKey(name, family), negative)) {
+    if (statsCollector_) {
+      statsCollector_->recordNegativeCacheHit();
+    }
+    if (negative.error) {
+      cb->resolutionError(negative.error);
+    } else {
+      cb->resolutionSuccess({});
+    }
+    return;
+  }
+
+  if (serveStale_) {
+    std::vector<Answer> stale;
+    lookupStaleCache(name, family, stale);
+    if (!stale.empty()) {
+      if (statsCollector_) {
+        statsCollector_->recordStaleCacheHit();
+      }
+      std::shuffle(
+          std::begin(stale), std::end(stale), folly::ThreadLocalPRNG{});
+      startQuery(nullptr, name, timeout, family, std::move(teContext));
+      cb->resolutionSuccess(std::move(stale));
+      return;
+    }
+  }
+
+  startQuery(cb, name, timeout, family, std::move(teContext));
+}
+
+void CachingDNSResolver::startQuery(DNSResolver::ResolutionCallback* cb,
+                                    const std::string& name,
+                                    std::chrono::milliseconds timeout,
+                                    sa_family_t family,
+                                    TraceEventContext teContext) {
+  auto key = getQueryKey(name, family);
+  // Background refreshes always join a query in flight
+  if (coalesceQueries_ || !cb) {
+    auto it = pendingQueries_.find(key);
+    if (it != pendingQueries_.end()) {
+      if (cb) {
+        if (statsCollector_) {
+          statsCollector_->recordCoalescedQuery();
+        }
+        it->second->addWaiter(cb);
+      }
+      return;
+    }
+  }
+
+  Query* q = new Query(name, family, this);
+  if (cb) {
+    q->addWaiter(cb);
+  }
+  if (coalesceQueries_ || !cb) {
+    pendingQueries_.emplace(std::move(key), q);
+  }
   resolver_->resolveHostname(q, name, timeout, family, std::move(teContext));
 }
 
+void CachingDNSResolver::onQueryDone(Query* query) {
+  auto it =
+      pendingQueries_.find(getQueryKey(query->getName(), query->getFamily()));
+  if (it != pendingQueries_.end() && it->second == query) {
+    pendingQueries_.erase(it);
+  }
+}
+
+bool CachingDNSResolver::lookupNegativeCache(const std::string& key,
+                                             NegativeEntry& out) {
+  if (negativeCacheTTL_.count() == 0) {
+    return false;
+  }
+  auto iter = negativeCache_.find(key);
+  if (iter == negativeCache_.end()) {
+    return false;
+  }
+  if (iter->second.expiry <= timeUtil_->now()) {
+    negativeCache_.erase(iter);
+    return false;
+  }
+  out = iter->second;
+  return true;
+}
+
+void CachingDNSResolver::addToNegativeCache(
+    const std::string& key, const folly::exception_wrapper& error) {
+  if (negativeCacheTTL_.count() == 0) {
+    return;
+  }
+  if (error) {
+    // Only what the servers answered, local failures may not last
+    auto ex = error.get_exception<DNSResolver::Exception>();
+    if (!ex || (ex->status() != DNSResolver::SERVER_OTHER &&
+                ex->status() != DNSResolver::NODATA)) {
+      return;
+    }
+  }
+  negativeCache_.set(key, {timeUtil_->now() + negativeCacheTTL_, error});
+}
+
 // add the entry into both cache_ and staleCache_ with diff TTL
 void CachingDNSResolver::insertCache(
     std::string name,
@@ -189,5 +312,6 @@ bool CachingDNSResolver::searchDNSCache(std::string name,
 
 void CachingDNSResolver::flushDNSCache() {
   cache_.clear();
+  negativeCache_.clear();
 }
 } // namespace proxygen
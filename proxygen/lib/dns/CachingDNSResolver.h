@@ -8,13 +8,18 @@
 
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include <folly/Conv.h>
 #include <folly/container/EvictingCacheMap.h>
 #include <proxygen/lib/utils/Time.h>
 
 #include "proxygen/lib/dns/DNSResolver.h"
+#include "proxygen/lib/dns/SharedDNSCache.h"
 
 namespace proxygen {
 
@@ -49,9 +54,52 @@ class CachingDNSResolver : public DNSResolver {
     // requests and trigger callbacks to this class
     cache_.clear();
     staleCache_.clear();
+    negativeCache_.clear();
     resolver_.reset();
   }
 
+  /**
+   * Re-resolves a name in the background when it is requested after this
+   * share of its TTL has passed, so that hot names never expire. Zero, the
+   * default, disables it.
+   */
+  void setRefreshAheadRatio(double ratio) {
+    refreshAheadRatio_ = ratio;
+  }
+
+  /**
+   * Answers requests for an expired name from the stale cache right away,
+   * while re-resolving it in the background.
+   */
+  void setServeStaleWhileRevalidate(bool enabled) {
+    serveStale_ = enabled;
+  }
+
+  /**
+   * Caches names that don't exist, and server failures, for ttl, for at
+   * most maxSize names. A zero ttl, the default, disables it.
+   */
+  void setNegativeCaching(size_t maxSize, std::chrono::seconds ttl) {
+    negativeCache_.setMaxSize(std::max<size_t>(maxSize, 1));
+    negativeCacheTTL_ = ttl;
+  }
+
+  /**
+   * Lets concurrent misses on the same name and family share one query.
+   */
+  void setCoalesceQueries(bool enabled) {
+    coalesceQueries_ = enabled;
+  }
+
+  /**
+   * Consults cache, shared with the resolvers of other threads, before
+   * querying the underlying resolver, and adds the answers of every query
+   * to it. flushDNSCache() leaves it alone.
+   */
+  void setSharedCache(std::shared_ptr<SharedDNSCache> cache) {
+    sharedCache_ = std::move(cache);
+  }
+
   void resolveHostname(
       DNSResolver::ResolutionCallback* cb,
       const std::string& name,
@@ -124,6 +172,14 @@ class CachingDNSResolver : public DNSResolver {
 
   void addToStaleCache(std::string name, const std::vector<Answer>& answers);
 
+  void addToSharedCache(const std::string& name,
+                        sa_family_t family,
+                        const std::vector<Answer>& answers) {
+    if (sharedCache_) {
+      sharedCache_->insert(name, family, answers, timeUtil_->now());
+    }
+  }
+
   // DNSCache is a LRUCacheMap, so do not use const& here
   void searchCache(std::string name,
                    sa_family_t family,
@@ -142,67 +198,133 @@ class CachingDNSResolver : public DNSResolver {
     searchCache(name, family, answers, staleCache_);
   }
 
-  class Query
-      : public DNSResolver::ResolutionCallback
-      , public DNSResolver::QueryBase {
+  // An unexpired negative answer for the name, if any. Its error is empty
+  // if the name doesn't exist.
+  struct NegativeEntry {
+    TimePoint expiry;
+    folly::exception_wrapper error;
+  };
+  bool lookupNegativeCache(const std::string& key, NegativeEntry& out);
+  void addToNegativeCache(const std::string& key,
+                          const folly::exception_wrapper& error);
+
+  static std::string getQueryKey(const std::string& name, sa_family_t family) {
+    return folly::to<std::string>(name, "/", family);
+  }
+
+  /**
+   * A query to the underlying resolver, answering every request waiting for
+   * it. Refreshes issued in the background have no waiter.
+   */
+  class Query : public DNSResolver::ResolutionCallback {
    public:
-    explicit Query(ResolutionCallback* cb,
-                   const std::string name,
+    explicit Query(const std::string name,
                    sa_family_t family,
                    CachingDNSResolver* parent)
-        : cb_(cb), name_(name), family_(family), parent_(parent) {
+        : name_(name), family_(family), parent_(parent) {
+    }
+
+    // Registers cb to get the result of this query
+    void addWaiter(ResolutionCallback* cb) {
+      waiters_.push_back(std::make_unique<Waiter>(cb));
+      cb->insertQuery(waiters_.back().get());
     }
 
     void resolutionSuccess(std::vector<Answer> answers) noexcept override {
+      parent_->onQueryDone(this);
       if (!answers.empty()) {
         parent_->addToCache(name_, answers);
         parent_->addToStaleCache(name_, answers);
+        parent_->addToSharedCache(name_, family_, answers);
+      } else {
+        // The name doesn't exist
+        parent_->addToNegativeCache(getQueryKey(name_, family_),
+                                    folly::exception_wrapper());
       }
 
-      if (cb_) {
-        cb_->eraseQuery(this);
-        cb_->resolutionSuccess(answers);
+      for (auto& waiter : waiters_) {
+        if (auto cb = waiter->cb) {
+          cb->eraseQuery(waiter.get());
+          cb->resolutionSuccess(answers);
+        }
       }
       delete this;
     }
 
     void resolutionError(const folly::exception_wrapper& ew) noexcept override {
+      parent_->onQueryDone(this);
       std::vector<Answer> answers;
       parent_->lookupStaleCache(name_, family_, answers);
 
-      if (!answers.empty()) {
-        auto statsCollector = parent_->getStatsCollector();
-        if (statsCollector) {
-          statsCollector->recordStaleCacheHit();
-        }
-
-        if (cb_) {
-          cb_->eraseQuery(this);
-          cb_->resolutionSuccess(answers);
+      if (answers.empty()) {
+        parent_->addToNegativeCache(getQueryKey(name_, family_), ew);
+      }
+      for (auto& waiter : waiters_) {
+        auto cb = waiter->cb;
+        if (!cb) {
+          continue;
         }
-      } else {
-        if (cb_) {
-          cb_->eraseQuery(this);
-          cb_->resolutionError(ew);
+        cb->eraseQuery(waiter.get());
+        if (!answers.empty()) {
+          auto statsCollector = parent_->getStatsCollector();
+          if (statsCollector) {
+            statsCollector->recordStaleCacheHit();
+          }
+          cb->resolutionSuccess(answers);
+        } else {
+          cb->resolutionError(ew);
         }
       }
       delete this;
     }
 
-    void cancelResolutionImpl() override {
-      cb_ = nullptr;
+    const std::string& getName() const {
+      return name_;
+    }
+
+    sa_family_t getFamily() const {
+      return family_;
     }
 
    private:
-    // current request
-    ResolutionCallback* cb_;
+    // One request waiting for the query, which it may cancel
+    struct Waiter : public DNSResolver::QueryBase {
+      explicit Waiter(ResolutionCallback* callback) : cb(callback) {
+      }
+
+      void cancelResolutionImpl() override {
+        cb = nullptr;
+      }
+
+      ResolutionCallback* cb;
+    };
+
+    std::vector<std::unique_ptr<Waiter>> waiters_;
     std::string name_;
     sa_family_t family_;
     CachingDNSResolver* parent_;
   };
 
+  // Starts a query for name, or joins the one in flight; cb may be null
+  void startQuery(DNSResolver::ResolutionCallback* cb,
+                  const std::string& name,
+                  std::chrono::milliseconds timeout,
+                  sa_family_t family,
+                  TraceEventContext teContext);
+  void onQueryDone(Query* query);
+
+  using NegativeCache = folly::EvictingCacheMap<std::string, NegativeEntry>;
+
   DNSResolver::UniquePtr resolver_;
   DNSCache cache_, staleCache_;
+  NegativeCache negativeCache_{1};
+  std::chrono::seconds negativeCacheTTL_{0};
+  double refreshAheadRatio_{0};
+  bool serveStale_{false};
+  bool coalesceQueries_{false};
+  // Queries in flight by name and family, when coalescing them
+  std::unordered_map<std::string, Query*> pendingQueries_;
+  std::shared_ptr<SharedDNSCache> sharedCache_;
   size_t staleCacheTTLMin_, staleCacheTTLScale_;
   DNSResolver::StatsCollector* statsCollector_{nullptr};
   std::unique_ptr<TimeUtil> timeUtil_;
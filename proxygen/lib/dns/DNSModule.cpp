@@ -21,6 +21,9 @@ DEFINE_int32(stale_dns_cache_size_multiplier,
              "Size multiplier for stale dns cache");
 DEFINE_int32(stale_cache_ttl_min, 86400, "Stale dns cache min TTL in secs");
 DEFINE_int32(stale_cache_ttl_scale, 3, "Stale dns cache TTL multiplier");
+DEFINE_int32(dns_shared_cache_size,
+             0,
+             "Size of the dns cache shared by all threads, 0 for none");
 
 namespace proxygen {
 
@@ -36,6 +39,10 @@ DNSModule::DNSModule() {
   staleCacheSizeMultiplier_ = FLAGS_stale_dns_cache_size_multiplier;
   staleCacheTTLMin_ = FLAGS_stale_cache_ttl_min;
   staleCacheTTLScale_ = FLAGS_stale_cache_ttl_scale;
+  if (FLAGS_dns_shared_cache_size > 0) {
+    sharedCache_ = std::make_shared<SharedDNSCache>(
+        static_cast<size_t>(FLAGS_dns_shared_cache_size));
+  }
 }
 
 } // namespace proxygen
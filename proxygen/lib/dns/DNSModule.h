@@ -12,6 +12,8 @@
 
 #include "proxygen/lib/dns/CAresResolver.h"
 #include "proxygen/lib/dns/CachingDNSResolver.h"
+#include "proxygen/lib/dns/PosixDNSResolver.h"
+#include "proxygen/lib/dns/SharedDNSCache.h"
 
 namespace proxygen {
 
@@ -28,17 +30,23 @@ class DNSModule {
    */
   virtual DNSResolver::UniquePtr provideDNSResolver(
       folly::EventBase* eventBase) {
-    auto cares = CAresResolver::newResolver();
-
-    cares->attachEventBase(eventBase);
-    cares->setPort(dnsPort_);
-    cares->setServers(dnsServers_);
-    cares->init();
-
-    auto resolver =
-        CachingDNSResolver::newResolver(DNSResolver::UniquePtr(cares.release()),
-                                        cacheMaxSize_,
-                                        cacheClearSize_);
+    DNSResolver::UniquePtr base;
+    if (posixExecutor_) {
+      base.reset(
+          PosixDNSResolver::newResolver(eventBase, posixExecutor_).release());
+    } else {
+      auto cares = CAresResolver::newResolver();
+
+      cares->attachEventBase(eventBase);
+      cares->setPort(dnsPort_);
+      cares->setServers(dnsServers_);
+      cares->init();
+      base.reset(cares.release());
+    }
+
+    auto resolver = CachingDNSResolver::newResolver(
+        std::move(base), cacheMaxSize_, cacheClearSize_);
+    resolver->setSharedCache(sharedCache_);
 
     return DNSResolver::UniquePtr(resolver.release());
   }
@@ -82,6 +90,23 @@ class DNSModule {
     staleCacheSizeMultiplier_ = multiplier;
   }
 
+  /**
+   * Configure the cache shared by the CachingDNSResolvers of all threads,
+   * null to have none. Applies to the resolvers provided afterwards.
+   */
+  void setSharedCache(std::shared_ptr<SharedDNSCache> cache) {
+    sharedCache_ = std::move(cache);
+  }
+
+  /**
+   * Resolve with getaddrinfo() on the given executor, see
+   * PosixDNSResolver::makeExecutor(), instead of c-ares; null for c-ares.
+   * The DNS port and servers don't apply.
+   */
+  void setPosixResolverExecutor(std::shared_ptr<folly::Executor> executor) {
+    posixExecutor_ = std::move(executor);
+  }
+
  private:
   uint16_t dnsPort_{53};
   std::list<folly::SocketAddress> dnsServers_;
@@ -90,6 +115,8 @@ class DNSModule {
   size_t staleCacheSizeMultiplier_{4};
   size_t staleCacheTTLMin_{24 * 60 * 60}; // by default 24 hours;
   size_t staleCacheTTLScale_{3};          // by default 3 times of TTL;
+  std::shared_ptr<SharedDNSCache> sharedCache_;
+  std::shared_ptr<folly::Executor> posixExecutor_;
 };
 
 } // namespace proxygen
@@ -368,6 +368,30 @@ class DNSResolver : public folly::DelayedDestruction {
       * Optional: record cache hit a stale entry in CachingDNSResolver
       */
      virtual void recordStaleCacheHit() noexcept {}
+
+    /**
+      * Optional: record a request answered from the negative cache in
+      * CachingDNSResolver
+      */
+     virtual void recordNegativeCacheHit() noexcept {}
+
+    /**
+      * Optional: record a background refresh of a cached name in
+      * CachingDNSResolver
+      */
+     virtual void recordCacheRefresh() noexcept {}
+
+    /**
+      * Optional: record a request sharing the query of a concurrent one in
+      * CachingDNSResolver
+      */
+     virtual void recordCoalescedQuery() noexcept {}
+
+    /**
+      * Optional: record a request answered from the SharedDNSCache of
+      * CachingDNSResolver
+      */
+     virtual void recordSharedCacheHit() noexcept {}
 };
 
 
@@ -0,0 +1,639 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "proxygen/lib/dns/DoHResolver.h"
+
+#include <algorithm>
+
+#include <ares.h>
+#include <folly/Conv.h>
+#include <folly/IPAddress.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/portability/Sockets.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/Time.h>
+#ifndef _WIN32
+#include <netdb.h>
+#endif
+
+using folly::SocketAddress;
+
+namespace {
+
+class NullStatsCollector : public proxygen::DNSResolver::StatsCollector {
+ public:
+  void recordSuccess(
+      const std::vector<proxygen::DNSResolver::Answer>& /*answers*/,
+      std::chrono::milliseconds /*latency*/) noexcept override {
+  }
+  void recordError(const folly::exception_wrapper& /*ew*/,
+                   std::chrono::milliseconds /*latency*/) noexcept override {
+  }
+  void recordQueryResult(uint8_t /*rcode*/) noexcept override {
+  }
+};
+
+NullStatsCollector nullStatsCollector;
+
+struct HostentDeleter {
+  void operator()(hostent* ptr) {
+    ares_free_hostent(ptr);
+  }
+};
+
+constexpr folly::StringPiece kDnsMessage{"application/dns-message"};
+// Messages are at most 65535 bytes, RFC 1035 section 4.2.2
+constexpr size_t kMaxResponseSize = 65535;
+// As in CAresResolver
+constexpr int kMaxRecords = 32;
+constexpr size_t kHeaderSize = 12;
+constexpr uint8_t kRcodeNXDomain = 3;
+
+} // namespace
+
+namespace proxygen {
+
+/**
+ * One question sent to the server, and the requests waiting for its
+ * answer.  It deletes itself once the transaction is detached, or the
+ * UpstreamManager fails to open one; the resolver forgets it as soon as it
+ * has a result or is abandoned.
+ */
+class DoHResolver::Lookup
+    : public HTTPTransaction::Handler
+    , public UpstreamManager::Callback {
+ public:
+  Lookup(DoHResolver* resolver,
+         LookupKey key,
+         std::unique_ptr<folly::IOBuf> query)
+      : key_(std::move(key)), resolver_(resolver), query_(std::move(query)) {
+  }
+
+  // The requests waiting for the result
+  std::vector<Query*> queries;
+
+  const LookupKey& key() const {
+    return key_;
+  }
+
+  // Whether the resolver waits for the result
+  bool active() const {
+    return resolver_ != nullptr;
+  }
+
+  void start() {
+    // Resending a question is harmless, so it can go in early data
+    resolver_->upstream_.getTransaction(
+        resolver_->endpoint_, this, this, /* idempotent */ true);
+  }
+
+  // Nothing waits for the result anymore
+  void abandon() {
+    auto resolver = resolver_;
+    resolver_ = nullptr;
+    if (txn_) {
+      txn_->sendAbort();
+    } else {
+      resolver->upstream_.cancel(this);
+      delete this;
+    }
+  }
+
+  void onTransaction(HTTPTransaction* txn) noexcept override {
+    DCHECK_EQ(txn, txn_);
+    HTTPMessage request;
+    request.setMethod(HTTPMethod::POST);
+    request.setURL(resolver_->path_);
+    auto& headers = request.getHeaders();
+    headers.set(HTTP_HEADER_HOST, resolver_->endpoint_.getHostname());
+    headers.set(HTTP_HEADER_ACCEPT, kDnsMessage);
+    headers.set(HTTP_HEADER_CONTENT_TYPE, kDnsMessage);
+    headers.set(HTTP_HEADER_CONTENT_LENGTH,
+                folly::to<std::string>(query_->computeChainDataLength()));
+    txn->sendHeaders(request);
+    txn->sendBody(std::move(query_));
+    txn->sendEOM();
+  }
+
+  void onTransactionError(
+      const folly::exception_wrapper& error) noexcept override {
+    fail(CONN_REFUSED,
+         folly::to<std::string>("Failed to reach the DoH server: ",
+                                error.what()));
+    delete this;
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    fail(SERVER_OTHER, "DoH transaction detached");
+    delete this;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    status_ = msg->getStatusCode();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    body_.append(std::move(chain));
+    if (body_.chainLength() > kMaxResponseSize && active()) {
+      fail(PARSE_ERROR, "DoH response too large");
+      txn_->sendAbort();
+    }
+  }
+
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept override {
+  }
+
+  void onEOM() noexcept override {
+    if (!active()) {
+      return;
+    }
+    if (status_ != 200) {
+      fail(SERVER_OTHER,
+           folly::to<std::string>("DoH server returned status ", status_));
+      return;
+    }
+    auto response = body_.move();
+    if (!response) {
+      fail(PARSE_ERROR, "Empty DoH response");
+      return;
+    }
+    response->coalesce();
+    if (response->length() >= kHeaderSize) {
+      resolver_->getStatsCollector()->recordQueryResult(response->data()[3] &
+                                                        0x0F);
+    }
+    std::vector<Answer> answers;
+    auto error = parseResponse(key_.second, key_.first, *response, answers);
+    finish(std::move(answers), std::move(error));
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onError(const HTTPException& error) noexcept override {
+    fail(error.getProxygenError() == kErrorTimeout ? TIMEOUT : SERVER_OTHER,
+         folly::to<std::string>("DoH transaction failed: ", error.what()));
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  ~Lookup() override {
+  }
+
+  void fail(ResolutionStatus status, const std::string& msg) {
+    finish({},
+           folly::make_exception_wrapper<Exception>(
+               status, msg + " for " + key_.second));
+  }
+
+  // Only the first result is reported
+  void finish(std::vector<Answer> answers, folly::exception_wrapper error) {
+    if (!active()) {
+      return;
+    }
+    auto resolver = resolver_;
+    resolver_ = nullptr;
+    resolver->lookupDone(this, answers, error);
+  }
+
+  const LookupKey key_;
+  DoHResolver* resolver_;
+  std::unique_ptr<folly::IOBuf> query_;
+  HTTPTransaction* txn_{nullptr};
+  uint16_t status_{0};
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+};
+
+// A single request: its callback, timeout and the lookups it waits for
+class DoHResolver::Query
+    : public DNSResolver::QueryBase
+    , private folly::AsyncTimeout {
+ public:
+  Query(DoHResolver* resolver, ResolutionCallback* cb, std::string name)
+      : AsyncTimeout(resolver->evb_),
+        resolver_(resolver),
+        callback_(cb),
+        name_(std::move(name)),
+        startTime_(getCurrentTime()) {
+    callback_->insertQuery(this);
+  }
+
+  void wait(Lookup* lookup) {
+    lookups_.push_back(lookup);
+    lookup->queries.push_back(this);
+  }
+
+  void start(std::chrono::milliseconds timeout) {
+    if (timeout.count() > 0 && !scheduleTimeout(timeout.count())) {
+      LOG(DFATAL) << "Failed to schedule timeout for " << name_;
+    }
+  }
+
+  // Once lookup has dropped this from its waiters; may delete this
+  void lookupDone(Lookup* lookup,
+                  const std::vector<Answer>& answers,
+                  const folly::exception_wrapper& error) {
+    lookups_.erase(std::find(lookups_.begin(), lookups_.end(), lookup));
+    answers_.insert(answers_.end(), answers.begin(), answers.end());
+    if (error && !error_) {
+      error_ = error;
+    }
+    if (lookups_.empty()) {
+      complete();
+    }
+  }
+
+  void cancelResolutionImpl() override {
+    detach();
+    delete this;
+  }
+
+  // The resolver is going away
+  void shutdown() {
+    lookups_.clear();
+    answers_.clear();
+    error_ = folly::make_exception_wrapper<Exception>(
+        SHUTDOWN, "Resolver destroyed during query");
+    complete();
+  }
+
+ private:
+  ~Query() override {
+  }
+
+  void timeoutExpired() noexcept override {
+    detach();
+    if (answers_.empty()) {
+      error_ = folly::make_exception_wrapper<Exception>(
+          TIMEOUT, "DoH query timed out for " + name_);
+    }
+    complete();
+  }
+
+  void detach() {
+    auto lookups = std::move(lookups_);
+    for (auto lookup : lookups) {
+      resolver_->releaseLookup(lookup, this);
+    }
+  }
+
+  // Deletes this
+  void complete() {
+    ResolutionCallback* cb = callback_;
+    auto stats = resolver_->getStatsCollector();
+    std::chrono::milliseconds resolutionTime = millisecondsSince(startTime_);
+    auto answers = std::move(answers_);
+    auto error = std::move(error_);
+    cb->eraseQuery(this);
+    delete this;
+
+    // Some answers make a success, as with CAresResolver's MultiQuery
+    if (!answers.empty()) {
+      stats->recordSuccess(answers, resolutionTime);
+      cb->resolutionSuccess(std::move(answers));
+      return;
+    }
+    if (!error) {
+      error = folly::make_exception_wrapper<Exception>(
+          NODATA, "No answer for " + name_);
+    }
+    stats->recordError(error, resolutionTime);
+    cb->resolutionError(error);
+  }
+
+  DoHResolver* resolver_;
+  ResolutionCallback* callback_;
+  const std::string name_;
+  TimePoint startTime_;
+  std::vector<Lookup*> lookups_;
+  std::vector<Answer> answers_;
+  folly::exception_wrapper error_;
+};
+
+std::unique_ptr<folly::IOBuf> DoHResolver::encodeQuery(
+    const std::string& name, QueryType type) {
+  unsigned char* buf = nullptr;
+  int len = 0;
+  auto status = ares_create_query(name.c_str(),
+                                  1 /* ns_c_in */,
+                                  static_cast<int>(type),
+                                  0 /* id */,
+                                  1 /* rd */,
+                                  &buf,
+                                  &len,
+                                  0 /* no EDNS */);
+  if (status != ARES_SUCCESS) {
+    VLOG(4) << "Failed to encode query for " << name << ": "
+            << ares_strerror(status);
+    return nullptr;
+  }
+  auto query = folly::IOBuf::copyBuffer(buf, len);
+  ares_free_string(buf);
+  return query;
+}
+
+folly::exception_wrapper DoHResolver::parseResponse(
+    const std::string& name,
+    QueryType type,
+    const folly::IOBuf& response,
+    std::vector<Answer>& answers) {
+  auto message = response.cloneCoalescedAsValue();
+  auto abuf = message.data();
+  auto alen = static_cast<int>(message.length());
+  if (message.length() < kHeaderSize) {
+    return folly::make_exception_wrapper<Exception>(
+        PARSE_ERROR, "Truncated DoH response for " + name);
+  }
+  auto rcode = abuf[3] & 0x0F;
+  if (rcode == kRcodeNXDomain) {
+    return folly::make_exception_wrapper<Exception>(
+        NODATA, "Non-existent domain " + name);
+  }
+  if (rcode != 0) {
+    return folly::make_exception_wrapper<Exception>(
+        SERVER_OTHER,
+        folly::to<std::string>(
+            "DoH server returned rcode ", rcode, " for ", name));
+  }
+
+  int status = ARES_SUCCESS;
+  hostent* hst = nullptr;
+  switch (type) {
+    case QueryType::kA: {
+      ares_addrttl ttls[kMaxRecords];
+      int nttls = kMaxRecords;
+      status = ares_parse_a_reply(abuf, alen, &hst, ttls, &nttls);
+      std::unique_ptr<hostent, HostentDeleter> host(hst);
+      if (status != ARES_SUCCESS) {
+        break;
+      }
+      auto cname = host && host->h_name ? std::string(host->h_name) : "";
+      sockaddr_in saddr{};
+      saddr.sin_family = AF_INET;
+      for (int i = 0; i < nttls; i++) {
+        memcpy(&saddr.sin_addr, &ttls[i].ipaddr, sizeof(in_addr));
+        Answer ans(std::chrono::seconds(ttls[i].ttl),
+                   reinterpret_cast<sockaddr*>(&saddr));
+        ans.name = name;
+        ans.canonicalName = cname;
+        ans.resolverType = ResolverType::DOH;
+        answers.push_back(std::move(ans));
+      }
+      break;
+    }
+    case QueryType::kAAAA: {
+      ares_addr6ttl ttls[kMaxRecords];
+      int nttls = kMaxRecords;
+      status = ares_parse_aaaa_reply(abuf, alen, &hst, ttls, &nttls);
+      std::unique_ptr<hostent, HostentDeleter> host(hst);
+      if (status != ARES_SUCCESS) {
+        break;
+      }
+      auto cname = host && host->h_name ? std::string(host->h_name) : "";
+      sockaddr_in6 saddr{};
+      saddr.sin6_family = AF_INET6;
+      for (int i = 0; i < nttls; i++) {
+        memcpy(&saddr.sin6_addr, &ttls[i].ip6addr, sizeof(ares_in6_addr));
+        Answer ans(std::chrono::seconds(ttls[i].ttl),
+                   reinterpret_cast<sockaddr*>(&saddr));
+        ans.name = name;
+        ans.canonicalName = cname;
+        ans.resolverType = ResolverType::DOH;
+        answers.push_back(std::move(ans));
+      }
+      break;
+    }
+    case QueryType::kPtr: {
+      status = ares_parse_ptr_reply(abuf, alen, nullptr, 0, AF_INET6, &hst);
+      std::unique_ptr<hostent, HostentDeleter> host(hst);
+      if (status != ARES_SUCCESS) {
+        break;
+      }
+      for (char** aliasp = host->h_aliases; *aliasp != nullptr; aliasp++) {
+        // As in CAresResolver, PTR records come without their TTL
+        Answer ans(std::chrono::seconds(60), *aliasp);
+        ans.resolverType = ResolverType::DOH;
+        answers.push_back(std::move(ans));
+      }
+      break;
+    }
+  }
+
+  if (status == ARES_ENODATA || (status == ARES_SUCCESS && answers.empty())) {
+    return folly::make_exception_wrapper<Exception>(
+        NODATA, "No answer for " + name);
+  }
+  if (status != ARES_SUCCESS) {
+    return folly::make_exception_wrapper<Exception>(
+        PARSE_ERROR,
+        folly::to<std::string>("Failed to parse DoH response for ",
+                               name,
+                               ": ",
+                               ares_strerror(status)));
+  }
+  return folly::exception_wrapper();
+}
+
+DoHResolver::DoHResolver(folly::EventBase* evb, Options options)
+    : evb_(evb),
+      endpoint_(options.hostname, options.port, options.isSecure),
+      path_(std::move(options.path)),
+      upstream_(std::move(options.upstream), evb),
+      statsCollector_(&nullStatsCollector) {
+  CHECK(evb_);
+}
+
+DoHResolver::~DoHResolver() {
+  // A query may wait for two lookups, fail it once
+  std::vector<Query*> queries;
+  auto lookups = std::move(lookups_);
+  for (auto& [key, lookup] : lookups) {
+    for (auto query : lookup->queries) {
+      if (std::find(queries.begin(), queries.end(), query) == queries.end()) {
+        queries.push_back(query);
+      }
+    }
+    lookup->queries.clear();
+    lookup->abandon();
+  }
+  for (auto query : queries) {
+    query->shutdown();
+  }
+}
+
+void DoHResolver::setStatsCollector(
+    DNSResolver::StatsCollector* statsCollector) {
+  statsCollector_ = statsCollector;
+}
+
+DNSResolver::StatsCollector* DoHResolver::getStatsCollector() const {
+  return statsCollector_;
+}
+
+void DoHResolver::resolveAddress(ResolutionCallback* cb,
+                                 const SocketAddress& address,
+                                 std::chrono::milliseconds timeout) {
+  if (address.getFamily() != AF_INET && address.getFamily() != AF_INET6) {
+    LOG(ERROR) << "Unsupported address family " << address.getFamily();
+    cb->resolutionError(folly::make_exception_wrapper<Exception>(
+        INVALID,
+        folly::to<std::string>("Unsupported address family: ",
+                               address.getFamily())));
+    return;
+  }
+
+  auto ip = address.getIPAddress();
+  resolve(cb,
+          ip.isV4() ? ip.asV4().toInverseArpaName()
+                    : ip.asV6().toInverseArpaName(),
+          {QueryType::kPtr},
+          timeout);
+}
+
+void DoHResolver::resolveHostname(ResolutionCallback* cb,
+                                  const std::string& name,
+                                  std::chrono::milliseconds timeout,
+                                  sa_family_t family,
+                                  TraceEventContext /* teContext */) {
+  if (family != AF_INET && family != AF_INET6 && family != AF_UNSPEC) {
+    LOG(DFATAL) << "Unsupported family specified: " << family;
+    cb->resolutionError(folly::make_exception_wrapper<Exception>(
+        INVALID,
+        folly::to<std::string>("Unsupported address family: ", family)));
+    return;
+  }
+  if (resolveLocally(cb, name, family)) {
+    return;
+  }
+
+  switch (family) {
+    case AF_INET:
+      resolve(cb, name, {QueryType::kA}, timeout);
+      break;
+    case AF_INET6:
+      resolve(cb, name, {QueryType::kAAAA}, timeout);
+      break;
+    default:
+      resolve(cb, name, {QueryType::kA, QueryType::kAAAA}, timeout);
+  }
+}
+
+bool DoHResolver::resolveLocally(ResolutionCallback* cb,
+                                 const std::string& name,
+                                 sa_family_t family) {
+  std::vector<Answer> answers;
+  if (name == "localhost") {
+    if (family != AF_INET6) {
+      answers.emplace_back(kLiteralTTL, SocketAddress("127.0.0.1", 0));
+    }
+    if (family != AF_INET) {
+      answers.emplace_back(kLiteralTTL, SocketAddress("::1", 0));
+    }
+    cb->resolutionSuccess(std::move(answers));
+    return true;
+  }
+
+  addrinfo hints{};
+  hints.ai_family = family;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+  addrinfo* ainfos = nullptr;
+  if (::getaddrinfo(name.c_str(), nullptr, &hints, &ainfos) != 0) {
+    return false;
+  }
+  for (addrinfo* ai = ainfos; ai != nullptr; ai = ai->ai_next) {
+    answers.emplace_back(kLiteralTTL, ai->ai_addr);
+  }
+  freeaddrinfo(ainfos);
+  cb->resolutionSuccess(std::move(answers));
+  return true;
+}
+
+void DoHResolver::resolve(ResolutionCallback* cb,
+                          const std::string& name,
+                          const std::vector<QueryType>& types,
+                          std::chrono::milliseconds timeout) {
+  if (timeout > kMaxTimeout) {
+    LOG(WARNING) << "Attempt to resolve " << name << " specified with "
+                 << "timeout of " << timeout.count() << "ms; clamping to "
+                 << kMaxTimeout.count() << "ms";
+    timeout = kMaxTimeout;
+  }
+
+  std::vector<std::pair<QueryType, std::unique_ptr<folly::IOBuf>>> messages;
+  for (auto type : types) {
+    if (lookups_.count(LookupKey(type, name)) == 0) {
+      auto message = encodeQuery(name, type);
+      if (!message) {
+        cb->resolutionError(folly::make_exception_wrapper<Exception>(
+            INVALID, "Invalid name " + name));
+        return;
+      }
+      messages.emplace_back(type, std::move(message));
+    }
+  }
+
+  // Joins the lookups in flight, and creates the others before starting
+  // any, as they can fail synchronously
+  auto query = new Query(this, cb, name);
+  for (auto type : types) {
+    auto it = lookups_.find(LookupKey(type, name));
+    if (it != lookups_.end()) {
+      query->wait(it->second);
+    }
+  }
+  std::vector<Lookup*> newLookups;
+  for (auto& [type, message] : messages) {
+    LookupKey key(type, name);
+    auto lookup = new Lookup(this, key, std::move(message));
+    lookups_.emplace(std::move(key), lookup);
+    newLookups.push_back(lookup);
+    query->wait(lookup);
+  }
+
+  query->start(timeout);
+  DestructorGuard dg(this);
+  for (auto lookup : newLookups) {
+    lookup->start();
+  }
+}
+
+void DoHResolver::releaseLookup(Lookup* lookup, Query* query) {
+  auto& queries = lookup->queries;
+  queries.erase(std::find(queries.begin(), queries.end(), query));
+  if (queries.empty() && lookup->active()) {
+    lookups_.erase(lookup->key());
+    lookup->abandon();
+  }
+}
+
+void DoHResolver::lookupDone(Lookup* lookup,
+                             const std::vector<Answer>& answers,
+                             const folly::exception_wrapper& error) {
+  lookups_.erase(lookup->key());
+
+  // Callbacks may cancel the queries still waiting, or destroy this
+  DestructorGuard dg(this);
+  while (!lookup->queries.empty()) {
+    auto query = lookup->queries.back();
+    lookup->queries.pop_back();
+    query->lookupDone(lookup, answers, error);
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/connpool/UpstreamManager.h>
+
+#include "proxygen/lib/dns/DNSResolver.h"
+
+namespace proxygen {
+
+/**
+ * DNSResolver sending DNS-over-HTTPS (RFC 8484) queries through an
+ * UpstreamManager: every question is a POST of application/dns-message
+ * multiplexed on the persistent HTTP/2 session to the server, or HTTP/3
+ * with the QUIC options of Options::upstream, so a resolution costs one
+ * round trip on a warm connection.
+ *
+ * Implementation notes:
+ *
+ *  . Use from the EventBase thread only; the callbacks are invoked there.
+ *
+ *  . AF_UNSPEC sends the A and AAAA questions concurrently.
+ *
+ *  . Concurrent requests for the same question share one transaction.
+ *
+ *  . Queries carry ID 0, as RFC 8484 recommends for HTTP caches.
+ *
+ *  . Literals and localhost are resolved synchronously, as in
+ *    CAresResolver.
+ *
+ *  . Nothing is cached, wrap it in CachingDNSResolver to.
+ */
+class DoHResolver : public DNSResolver {
+ public:
+  using UniquePtr = std::unique_ptr<DoHResolver, DoHResolver::Destructor>;
+
+  enum class QueryType : uint16_t {
+    kA = 1,
+    kPtr = 12,
+    kAAAA = 28,
+  };
+
+  struct Options {
+    // The DoH server
+    std::string hostname;
+    uint16_t port{443};
+    bool isSecure{true};
+    std::string path{"/dns-query"};
+    // The sessions to the server.  Requests waiting for a connection or a
+    // response are bounded by connectTimeout and transactionTimeout.
+    UpstreamManager::Options upstream;
+  };
+
+  template <typename... Args>
+  static UniquePtr newResolver(Args&&... args) {
+    return UniquePtr(new DoHResolver(std::forward<Args>(args)...));
+  }
+
+  // The wire format of a recursive query for name, or null if name can't
+  // be encoded
+  static std::unique_ptr<folly::IOBuf> encodeQuery(const std::string& name,
+                                                   QueryType type);
+
+  /**
+   * Parses response, the answer of a query of type for name, into answers.
+   * Returns the error when there are none.
+   */
+  static folly::exception_wrapper parseResponse(const std::string& name,
+                                                QueryType type,
+                                                const folly::IOBuf& response,
+                                                std::vector<Answer>& answers);
+
+  DoHResolver(folly::EventBase* evb, Options options);
+
+  // Questions waiting for a connection or a response
+  size_t numPendingLookups() const {
+    return lookups_.size();
+  }
+
+  // DNSResolver API
+  void resolveAddress(ResolutionCallback* cb,
+                      const folly::SocketAddress& address,
+                      std::chrono::milliseconds timeout =
+                          std::chrono::milliseconds(100)) override;
+  void resolveHostname(
+      ResolutionCallback* cb,
+      const std::string& name,
+      std::chrono::milliseconds timeout = std::chrono::milliseconds(100),
+      sa_family_t family = AF_INET,
+      TraceEventContext teContext = TraceEventContext()) override;
+  void setStatsCollector(DNSResolver::StatsCollector* statsCollector) override;
+  DNSResolver::StatsCollector* getStatsCollector() const override;
+
+ protected:
+  // Use DelayedDestruction::destroy() instead; fails the pending requests
+  ~DoHResolver() override;
+
+ private:
+  class Lookup;
+  class Query;
+
+  using LookupKey = std::pair<QueryType, std::string>;
+
+  void resolve(ResolutionCallback* cb,
+               const std::string& name,
+               const std::vector<QueryType>& types,
+               std::chrono::milliseconds timeout);
+  bool resolveLocally(ResolutionCallback* cb,
+                      const std::string& name,
+                      sa_family_t family);
+  // Drops query from the waiters of lookup, which is abandoned without them
+  void releaseLookup(Lookup* lookup, Query* query);
+  void lookupDone(Lookup* lookup,
+                  const std::vector<Answer>& answers,
+                  const folly::exception_wrapper& error);
+
+  folly::EventBase* evb_;
+  const Endpoint endpoint_;
+  const std::string path_;
+  UpstreamManager upstream_;
+  StatsCollector* statsCollector_;
+  std::map<LookupKey, Lookup*> lookups_;
+};
+
+} // namespace proxygen
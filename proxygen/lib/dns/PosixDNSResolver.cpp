@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "proxygen/lib/dns/PosixDNSResolver.h"
+
+#include <algorithm>
+
+#include <folly/Conv.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/task_queue/LifoSemMPMCQueue.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/portability/Sockets.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/Time.h>
+#ifndef _WIN32
+#include <netdb.h>
+#endif
+
+using folly::SocketAddress;
+
+namespace {
+
+class NullStatsCollector : public proxygen::DNSResolver::StatsCollector {
+ public:
+  void recordSuccess(
+      const std::vector<proxygen::DNSResolver::Answer>& /*answers*/,
+      std::chrono::milliseconds /*latency*/) noexcept override {
+  }
+  void recordError(const folly::exception_wrapper& /*ew*/,
+                   std::chrono::milliseconds /*latency*/) noexcept override {
+  }
+  void recordQueryResult(uint8_t /*rcode*/) noexcept override {
+  }
+};
+
+NullStatsCollector nullStatsCollector;
+
+proxygen::DNSResolver::ResolutionStatus gaiStatus(int err) {
+  switch (err) {
+    case EAI_NONAME:
+#if defined(EAI_NODATA) && EAI_NODATA != EAI_NONAME
+    case EAI_NODATA:
+#endif
+      return proxygen::DNSResolver::NODATA;
+    case EAI_AGAIN:
+    case EAI_FAIL:
+      return proxygen::DNSResolver::SERVER_OTHER;
+    case EAI_FAMILY:
+      return proxygen::DNSResolver::INVALID;
+    default:
+      return proxygen::DNSResolver::GETADDRINFO;
+  }
+}
+
+} // namespace
+
+namespace proxygen {
+
+constexpr std::chrono::seconds PosixDNSResolver::kDefaultAnswerTTL;
+
+struct PosixDNSResolver::LookupResult {
+  std::vector<Answer> answers;
+  folly::exception_wrapper error;
+
+  static LookupResult getAddrInfo(const std::string& host,
+                                  sa_family_t family,
+                                  int flags,
+                                  std::chrono::seconds ttl) {
+    addrinfo hints{};
+    hints.ai_family = family;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = flags;
+
+    LookupResult result;
+    addrinfo* ainfos = nullptr;
+    int err = ::getaddrinfo(host.c_str(), nullptr, &hints, &ainfos);
+    if (err != 0) {
+      result.error = folly::make_exception_wrapper<Exception>(
+          gaiStatus(err),
+          folly::to<std::string>(
+              "getaddrinfo failed for ", host, ": ", gai_strerror(err)));
+      return result;
+    }
+    for (addrinfo* ai = ainfos; ai != nullptr; ai = ai->ai_next) {
+      Answer ans(ttl, ai->ai_addr);
+      ans.name = host;
+      ans.resolverType = ResolverType::POSIX;
+      result.answers.push_back(std::move(ans));
+    }
+    freeaddrinfo(ainfos);
+    return result;
+  }
+
+  static LookupResult getNameInfo(const SocketAddress& address,
+                                  std::chrono::seconds ttl) {
+    sockaddr_storage storage;
+    socklen_t len = address.getAddress(&storage);
+    char host[NI_MAXHOST];
+
+    LookupResult result;
+    int err = ::getnameinfo(reinterpret_cast<sockaddr*>(&storage),
+                            len,
+                            host,
+                            sizeof(host),
+                            nullptr,
+                            0,
+                            NI_NAMEREQD);
+    if (err != 0) {
+      result.error = folly::make_exception_wrapper<Exception>(
+          gaiStatus(err),
+          folly::to<std::string>("getnameinfo failed for ",
+                                 address.getAddressStr(),
+                                 ": ",
+                                 gai_strerror(err)));
+      return result;
+    }
+    Answer ans(ttl, std::string(host));
+    ans.resolverType = ResolverType::POSIX;
+    result.answers.push_back(std::move(ans));
+    return result;
+  }
+};
+
+// A lookup on the executor and the requests waiting for it.  Shared with the
+// executor, which only holds it.
+struct PosixDNSResolver::Lookup {
+  std::string key;
+  // Null once the resolver is gone
+  PosixDNSResolver* resolver{nullptr};
+  std::vector<Query*> queries;
+};
+
+// A single request: its callback and timeout
+class PosixDNSResolver::Query
+    : public DNSResolver::QueryBase
+    , private folly::AsyncTimeout {
+ public:
+  Query(PosixDNSResolver* resolver,
+        std::shared_ptr<Lookup> lookup,
+        ResolutionCallback* cb)
+      : AsyncTimeout(resolver->evb_),
+        resolver_(resolver),
+        lookup_(std::move(lookup)),
+        callback_(cb),
+        startTime_(getCurrentTime()) {
+    callback_->insertQuery(this);
+    lookup_->queries.push_back(this);
+  }
+
+  void start(std::chrono::milliseconds timeout) {
+    if (timeout.count() > 0 && !scheduleTimeout(timeout.count())) {
+      LOG(DFATAL) << "Failed to schedule timeout for lookup "
+                  << lookup_->key;
+    }
+  }
+
+  // Once detached from the lookup; deletes this
+  void complete(std::vector<Answer> answers, folly::exception_wrapper ew) {
+    ResolutionCallback* cb = callback_;
+    auto stats = resolver_->getStatsCollector();
+    std::chrono::milliseconds resolutionTime = millisecondsSince(startTime_);
+    cb->eraseQuery(this);
+    delete this;
+
+    if (ew) {
+      stats->recordError(ew, resolutionTime);
+      cb->resolutionError(ew);
+    } else {
+      stats->recordSuccess(answers, resolutionTime);
+      cb->resolutionSuccess(std::move(answers));
+    }
+  }
+
+  void cancelResolutionImpl() override {
+    detach();
+    delete this;
+  }
+
+ private:
+  ~Query() override {
+  }
+
+  void timeoutExpired() noexcept override {
+    detach();
+    complete({},
+             folly::make_exception_wrapper<Exception>(
+                 TIMEOUT, "Lookup timed out for " + lookup_->key));
+  }
+
+  void detach() {
+    auto& queries = lookup_->queries;
+    queries.erase(std::find(queries.begin(), queries.end(), this));
+  }
+
+  PosixDNSResolver* resolver_;
+  std::shared_ptr<Lookup> lookup_;
+  ResolutionCallback* callback_;
+  TimePoint startTime_;
+};
+
+std::shared_ptr<folly::Executor> PosixDNSResolver::makeExecutor(
+    size_t numThreads, size_t maxPending) {
+  return std::make_shared<folly::CPUThreadPoolExecutor>(
+      numThreads,
+      std::make_unique<
+          folly::LifoSemMPMCQueue<folly::CPUThreadPoolExecutor::CPUTask,
+                                  folly::QueueBehaviorIfFull::THROW>>(
+          maxPending),
+      std::make_shared<folly::NamedThreadFactory>("DNSLookup"));
+}
+
+PosixDNSResolver::PosixDNSResolver(folly::EventBase* evb,
+                                   std::shared_ptr<folly::Executor> executor)
+    : evb_(evb),
+      executor_(std::move(executor)),
+      statsCollector_(&nullStatsCollector) {
+  CHECK(evb_);
+  CHECK(executor_);
+}
+
+PosixDNSResolver::~PosixDNSResolver() {
+  auto lookups = std::move(lookups_);
+  for (auto& [key, lookup] : lookups) {
+    lookup->resolver = nullptr;
+    while (!lookup->queries.empty()) {
+      auto query = lookup->queries.back();
+      lookup->queries.pop_back();
+      query->complete({},
+                      folly::make_exception_wrapper<Exception>(
+                          SHUTDOWN, "Resolver destroyed during lookup"));
+    }
+  }
+}
+
+void PosixDNSResolver::setStatsCollector(
+    DNSResolver::StatsCollector* statsCollector) {
+  statsCollector_ = statsCollector;
+}
+
+DNSResolver::StatsCollector* PosixDNSResolver::getStatsCollector() const {
+  return statsCollector_;
+}
+
+void PosixDNSResolver::resolveAddress(ResolutionCallback* cb,
+                                      const SocketAddress& address,
+                                      std::chrono::milliseconds timeout) {
+  if (address.getFamily() != AF_INET && address.getFamily() != AF_INET6) {
+    LOG(ERROR) << "Unsupported address family " << address.getFamily();
+    cb->resolutionError(folly::make_exception_wrapper<Exception>(
+        INVALID,
+        folly::to<std::string>("Unsupported address family: ",
+                               address.getFamily())));
+    return;
+  }
+
+  auto ttl = answerTTL_;
+  resolve(
+      cb,
+      "ptr " + address.getAddressStr(),
+      [address, ttl]() { return LookupResult::getNameInfo(address, ttl); },
+      timeout);
+}
+
+void PosixDNSResolver::resolveHostname(ResolutionCallback* cb,
+                                       const std::string& name,
+                                       std::chrono::milliseconds timeout,
+                                       sa_family_t family,
+                                       TraceEventContext /* teContext */) {
+  if (family != AF_INET && family != AF_INET6 && family != AF_UNSPEC) {
+    LOG(DFATAL) << "Unsupported family specified: " << family;
+    cb->resolutionError(folly::make_exception_wrapper<Exception>(
+        INVALID,
+        folly::to<std::string>("Unsupported address family: ", family)));
+    return;
+  }
+
+  // Literals don't block
+  auto literal = LookupResult::getAddrInfo(
+      name, family, AI_NUMERICHOST | AI_NUMERICSERV, kLiteralTTL);
+  if (!literal.error) {
+    cb->resolutionSuccess(std::move(literal.answers));
+    return;
+  }
+
+  auto ttl = answerTTL_;
+  resolve(
+      cb,
+      folly::to<std::string>(familyToString(family), " ", name),
+      [name, family, ttl]() {
+        auto result = LookupResult::getAddrInfo(name, family, 0, ttl);
+        if (!result.error && result.answers.empty()) {
+          result.error = folly::make_exception_wrapper<Exception>(
+              NODATA, "No answer for " + name);
+        }
+        return result;
+      },
+      timeout);
+}
+
+void PosixDNSResolver::resolve(ResolutionCallback* cb,
+                               const std::string& key,
+                               LookupFn fn,
+                               std::chrono::milliseconds timeout) {
+  if (timeout > kMaxTimeout) {
+    LOG(WARNING) << "Attempt to resolve " << key << " specified with "
+                 << "timeout of " << timeout.count() << "ms; clamping to "
+                 << kMaxTimeout.count() << "ms";
+    timeout = kMaxTimeout;
+  }
+
+  auto it = lookups_.find(key);
+  if (it != lookups_.end()) {
+    auto query = new Query(this, it->second, cb);
+    query->start(timeout);
+    return;
+  }
+
+  auto lookup = std::make_shared<Lookup>();
+  lookup->key = key;
+  lookup->resolver = this;
+  auto query = new Query(this, lookup, cb);
+  try {
+    executor_->add([lookup,
+                    fn = std::move(fn),
+                    evb = folly::getKeepAliveToken(evb_)]() mutable {
+      auto result = fn();
+      evb->runInEventBaseThread(
+          [lookup = std::move(lookup), result = std::move(result)]() mutable {
+            if (lookup->resolver) {
+              lookup->resolver->lookupDone(lookup, std::move(result));
+            }
+          });
+    });
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to queue lookup " << key << ": " << ex.what();
+    lookup->queries.clear();
+    query->complete({},
+                    folly::make_exception_wrapper<Exception>(
+                        THREADPOOL, "Lookup rejected by the executor"));
+    return;
+  }
+  lookups_.emplace(key, std::move(lookup));
+  query->start(timeout);
+}
+
+void PosixDNSResolver::lookupDone(const std::shared_ptr<Lookup>& lookup,
+                                  LookupResult result) {
+  lookups_.erase(lookup->key);
+  lookup->resolver = nullptr;
+
+  // Callbacks may cancel the queries still waiting, or destroy this
+  DestructorGuard dg(this);
+  while (!lookup->queries.empty()) {
+    auto query = lookup->queries.back();
+    lookup->queries.pop_back();
+    query->complete(result.answers, result.error);
+  }
+}
+
+} // namespace proxygen
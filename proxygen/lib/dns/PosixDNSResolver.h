@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/io/async/EventBase.h>
+
+#include "proxygen/lib/dns/DNSResolver.h"
+
+namespace proxygen {
+
+/**
+ * DNSResolver running getaddrinfo() and getnameinfo() on an executor, for
+ * when c-ares isn't configured: the system resolver config, /etc/hosts and
+ * NSS are honored, and the EventBase thread never blocks.
+ *
+ * Implementation notes:
+ *
+ *  . Use from the EventBase thread only; the callbacks are invoked there.
+ *
+ *  . Concurrent requests for the same name and family share one lookup.
+ *
+ *  . A lookup can't be interrupted: on timeout or cancellation its
+ *    executor thread stays busy until it returns, and the result is
+ *    dropped.  Bound the executor, see makeExecutor(); requests it rejects
+ *    fail with THREADPOOL.
+ *
+ *  . The system calls return no TTL, the answers carry setAnswerTTL().
+ *
+ *  . Literals are resolved synchronously, as in CAresResolver.
+ */
+class PosixDNSResolver : public DNSResolver {
+ public:
+  using UniquePtr =
+      std::unique_ptr<PosixDNSResolver, PosixDNSResolver::Destructor>;
+
+  static constexpr std::chrono::seconds kDefaultAnswerTTL{60};
+
+  template <typename... Args>
+  static UniquePtr newResolver(Args&&... args) {
+    return UniquePtr(new PosixDNSResolver(std::forward<Args>(args)...));
+  }
+
+  /**
+   * An executor of numThreads threads queueing up to maxPending lookups,
+   * fit for sharing between the resolvers of all threads.
+   */
+  static std::shared_ptr<folly::Executor> makeExecutor(size_t numThreads,
+                                                       size_t maxPending);
+
+  PosixDNSResolver(folly::EventBase* evb,
+                   std::shared_ptr<folly::Executor> executor);
+
+  void setAnswerTTL(std::chrono::seconds ttl) {
+    answerTTL_ = ttl;
+  }
+
+  // Lookups running or queued on the executor for this resolver
+  size_t numPendingLookups() const {
+    return lookups_.size();
+  }
+
+  // DNSResolver API
+  void resolveAddress(ResolutionCallback* cb,
+                      const folly::SocketAddress& address,
+                      std::chrono::milliseconds timeout =
+                          std::chrono::milliseconds(100)) override;
+  void resolveHostname(
+      ResolutionCallback* cb,
+      const std::string& name,
+      std::chrono::milliseconds timeout = std::chrono::milliseconds(100),
+      sa_family_t family = AF_INET,
+      TraceEventContext teContext = TraceEventContext()) override;
+  void setStatsCollector(DNSResolver::StatsCollector* statsCollector) override;
+  DNSResolver::StatsCollector* getStatsCollector() const override;
+
+ protected:
+  // Use DelayedDestruction::destroy() instead; fails the pending requests
+  ~PosixDNSResolver() override;
+
+ private:
+  class Query;
+  struct Lookup;
+  struct LookupResult;
+
+  using LookupFn = std::function<LookupResult()>;
+
+  // Joins the lookup of key, or runs fn for it on the executor
+  void resolve(ResolutionCallback* cb,
+               const std::string& key,
+               LookupFn fn,
+               std::chrono::milliseconds timeout);
+  void lookupDone(const std::shared_ptr<Lookup>& lookup,
+                  LookupResult result);
+
+  folly::EventBase* evb_;
+  std::shared_ptr<folly::Executor> executor_;
+  std::chrono::seconds answerTTL_{kDefaultAnswerTTL};
+  StatsCollector* statsCollector_;
+  std::map<std::string, std::shared_ptr<Lookup>> lookups_;
+};
+
+} // namespace proxygen
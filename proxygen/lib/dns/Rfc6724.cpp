@@ -38,10 +38,17 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #endif
+#include <folly/io/async/EventHandler.h>
 #include <folly/portability/Unistd.h>
 #include <string>
 #include <system_error>
+#ifdef __linux__
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#endif
 
+using folly::IPAddress;
 using folly::SocketAddress;
 using std::string;
 using std::vector;
@@ -53,6 +60,12 @@ struct SortElement {
   bool hasSrcAddr;
   SocketAddress srcAddr;
   size_t originalOrder;
+  // Set by prepare_element(), rather than on each comparison
+  int scopeSrc;
+  int scopeDst;
+  int labelSrc;
+  int labelDst;
+  int precedence;
 }; // struct SortElement
 
 static bool find_src_addr(const SocketAddress* addr, SocketAddress& srcAddr);
@@ -61,6 +74,9 @@ static int get_label(const SocketAddress* addr);
 static int get_scope(const SocketAddress* addr);
 static int get_precedence(const SocketAddress* addr);
 static int rfc6724_compare(const void* ptr1, const void* ptr2);
+static void prepare_element(SortElement& elem);
+static void sort_elements(vector<SocketAddress>& addrs,
+                          vector<SortElement>& sortVec);
 
 } // namespace
 
@@ -68,9 +84,9 @@ namespace proxygen {
 
 void rfc6724_sort(vector<SocketAddress>& addrs,
                   const SocketAddress* srcAddr /* = nullptr */) {
-  vector<SortElement> sortVec;
+  vector<SortElement> sortVec(addrs.size());
   for (size_t i = 0; i < addrs.size(); ++i) {
-    SortElement elem;
+    SortElement& elem = sortVec[i];
     elem.addr = &addrs[i];
     if (srcAddr == nullptr) {
       // throws if find_src_addr fails
@@ -80,16 +96,151 @@ void rfc6724_sort(vector<SocketAddress>& addrs,
       elem.srcAddr = *srcAddr;
     }
     elem.originalOrder = i;
-    sortVec.push_back(elem);
   }
+  sort_elements(addrs, sortVec);
+}
 
-  std::qsort(
-      sortVec.data(), sortVec.size(), sizeof(SortElement), rfc6724_compare);
-  for (size_t i = 0; i < addrs.size(); i++) {
-    if (sortVec[i].originalOrder > i) {
-      std::swap(addrs[i], addrs[sortVec[i].originalOrder]);
+#ifdef __linux__
+class Rfc6724Cache::RouteWatcher : public folly::EventHandler {
+ public:
+  RouteWatcher(folly::EventBase* evb, int fd, Rfc6724Cache* cache)
+      : EventHandler(evb, folly::NetworkSocket::fromFd(fd)),
+        fd_(fd),
+        cache_(cache) {
+  }
+
+  ~RouteWatcher() override {
+    unregisterHandler();
+    close(fd_);
+  }
+
+  void handlerReady(uint16_t /* events */) noexcept override {
+    // Any message, or ENOBUFS on overrun, means something changed
+    char buf[8192];
+    while (::recv(fd_, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+    }
+    cache_->invalidate();
+  }
+
+ private:
+  int fd_;
+  Rfc6724Cache* cache_;
+};
+#else
+class Rfc6724Cache::RouteWatcher {};
+#endif
+
+Rfc6724Cache::Rfc6724Cache(Options options, SourceProbe probe)
+    : options_(options), probe_(std::move(probe)) {
+  if (!probe_) {
+    probe_ = [](const SocketAddress& dst, SocketAddress& src) {
+      return find_src_addr(&dst, src);
+    };
+  }
+}
+
+Rfc6724Cache::~Rfc6724Cache() {
+}
+
+IPAddress Rfc6724Cache::getKey(const SocketAddress& addr) const {
+  auto ip = addr.getIPAddress();
+  return ip.mask(ip.isV4() ? options_.v4PrefixLen : options_.v6PrefixLen);
+}
+
+void Rfc6724Cache::sort(vector<SocketAddress>& addrs) {
+  auto now = std::chrono::steady_clock::now();
+  vector<SortElement> sortVec(addrs.size());
+  vector<std::pair<size_t, IPAddress>> misses;
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    generation = generation_;
+    for (size_t i = 0; i < addrs.size(); ++i) {
+      SortElement& elem = sortVec[i];
+      elem.addr = &addrs[i];
+      elem.originalOrder = i;
+      if (!addrs[i].isFamilyInet()) {
+        elem.hasSrcAddr = false;
+        continue;
+      }
+      auto key = getKey(addrs[i]);
+      auto it = entries_.find(key);
+      if (it != entries_.end() && it->second.expiry > now) {
+        elem.hasSrcAddr = it->second.hasSrcAddr;
+        elem.srcAddr = it->second.srcAddr;
+      } else {
+        misses.emplace_back(i, std::move(key));
+      }
+    }
+  }
+
+  if (!misses.empty()) {
+    // Without the lock, throws if a probe fails
+    for (const auto& miss : misses) {
+      SortElement& elem = sortVec[miss.first];
+      elem.hasSrcAddr = probe_(*elem.addr, elem.srcAddr);
+    }
+    std::lock_guard<std::mutex> g(mutex_);
+    if (generation == generation_) {
+      if (entries_.size() + misses.size() > options_.maxEntries) {
+        entries_.clear();
+      }
+      auto expiry = now + options_.maxAge;
+      for (auto& miss : misses) {
+        const SortElement& elem = sortVec[miss.first];
+        entries_[std::move(miss.second)] =
+            Entry{elem.hasSrcAddr, elem.srcAddr, expiry};
+      }
     }
   }
+  sort_elements(addrs, sortVec);
+}
+
+void Rfc6724Cache::invalidate() {
+  std::lock_guard<std::mutex> g(mutex_);
+  entries_.clear();
+  generation_++;
+}
+
+bool Rfc6724Cache::watchRouteChanges(folly::EventBase* evb) {
+#ifdef __linux__
+  if (watcher_) {
+    return true;
+  }
+  int fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+  if (fd == -1) {
+    return false;
+  }
+  sockaddr_nl sa{};
+  sa.nl_family = AF_NETLINK;
+  sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR |
+                 RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == -1) {
+    close(fd);
+    return false;
+  }
+  auto watcher = std::make_unique<RouteWatcher>(evb, fd, this);
+  if (!watcher->registerHandler(folly::EventHandler::READ |
+                                folly::EventHandler::PERSIST)) {
+    return false;
+  }
+  watcher_ = std::move(watcher);
+  // Changes before the socket was bound are missed otherwise
+  invalidate();
+  return true;
+#else
+  (void)evb;
+  return false;
+#endif
+}
+
+void Rfc6724Cache::stopWatchingRouteChanges() {
+  watcher_.reset();
+}
+
+size_t Rfc6724Cache::size() const {
+  std::lock_guard<std::mutex> g(mutex_);
+  return entries_.size();
 }
 
 } // namespace proxygen
@@ -331,6 +482,30 @@ static int get_common_prefix(const in6_addr* src, const in6_addr* dst) {
   return sizeof(*src) * CHAR_BIT;
 }
 
+static void prepare_element(SortElement& elem) {
+  elem.scopeSrc = get_scope(&elem.srcAddr);
+  elem.scopeDst = get_scope(elem.addr);
+  elem.labelSrc = get_label(&elem.srcAddr);
+  elem.labelDst = get_label(elem.addr);
+  elem.precedence = get_precedence(elem.addr);
+}
+
+static void sort_elements(vector<SocketAddress>& addrs,
+                          vector<SortElement>& sortVec) {
+  for (auto& elem : sortVec) {
+    prepare_element(elem);
+  }
+  std::qsort(
+      sortVec.data(), sortVec.size(), sizeof(SortElement), rfc6724_compare);
+
+  vector<SocketAddress> sorted;
+  sorted.reserve(addrs.size());
+  for (const auto& elem : sortVec) {
+    sorted.push_back(std::move(*elem.addr));
+  }
+  addrs = std::move(sorted);
+}
+
 /*
  * Compare two source/destination address pairs.
  * RFC 6724, section 6.
@@ -338,11 +513,8 @@ static int get_common_prefix(const in6_addr* src, const in6_addr* dst) {
 static int rfc6724_compare(const void* ptr1, const void* ptr2) {
   const SortElement* l = reinterpret_cast<const SortElement*>(ptr1);
   const SortElement* r = reinterpret_cast<const SortElement*>(ptr2);
-  int scopeSrcL, scopeDstL, scopeMatchL;
-  int scopeSrcR, scopeDstR, scopeMatchR;
-  int labelSrcL, labelDstL, labelMatchL;
-  int labelSrcR, labelDstR, labelMatchR;
-  int precedenceL, precedenceR;
+  int scopeMatchL, scopeMatchR;
+  int labelMatchL, labelMatchR;
   int prefixLenL, prefixLenR;
 
   /* Rule 1: Avoid unusable destinations. */
@@ -351,13 +523,8 @@ static int rfc6724_compare(const void* ptr1, const void* ptr2) {
   }
 
   /* Rule 2: Prefer matching scope. */
-  scopeSrcL = get_scope(&l->srcAddr);
-  scopeDstL = get_scope(l->addr);
-  scopeMatchL = (scopeSrcL == scopeDstL);
-
-  scopeSrcR = get_scope(&r->srcAddr);
-  scopeDstR = get_scope(r->addr);
-  scopeMatchR = (scopeSrcR == scopeDstR);
+  scopeMatchL = (l->scopeSrc == l->scopeDst);
+  scopeMatchR = (r->scopeSrc == r->scopeDst);
 
   if (scopeMatchL != scopeMatchR) {
     return int(scopeMatchR) - int(scopeMatchL);
@@ -374,23 +541,16 @@ static int rfc6724_compare(const void* ptr1, const void* ptr2) {
    */
 
   /* Rule 5: Prefer matching label. */
-  labelSrcL = get_label(&l->srcAddr);
-  labelDstL = get_label(l->addr);
-  labelMatchL = (labelSrcL == labelDstL);
-
-  labelSrcR = get_label(&r->srcAddr);
-  labelDstR = get_label(r->addr);
-  labelMatchR = (labelSrcR == labelDstR);
+  labelMatchL = (l->labelSrc == l->labelDst);
+  labelMatchR = (r->labelSrc == r->labelDst);
 
   if (labelMatchL != labelMatchR) {
     return int(labelMatchR) - int(labelMatchL);
   }
 
   /* Rule 6: Prefer higher precedence. */
-  precedenceL = get_precedence(l->addr);
-  precedenceR = get_precedence(r->addr);
-  if (precedenceL != precedenceR) {
-    return precedenceR - precedenceL;
+  if (l->precedence != r->precedence) {
+    return r->precedence - l->precedence;
   }
 
   /*
@@ -399,8 +559,8 @@ static int rfc6724_compare(const void* ptr1, const void* ptr2) {
    */
 
   /* Rule 8: Prefer smaller scope. */
-  if (scopeDstL != scopeDstR) {
-    return scopeDstL - scopeDstR;
+  if (l->scopeDst != r->scopeDst) {
+    return l->scopeDst - r->scopeDst;
   }
 
   /*
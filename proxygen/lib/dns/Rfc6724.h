@@ -29,9 +29,19 @@
  */
 #pragma once
 
+#include <chrono>
+#include <folly/IPAddress.h>
 #include <folly/SocketAddress.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
+namespace folly {
+class EventBase;
+}
+
 namespace proxygen {
 
 /**
@@ -46,4 +56,73 @@ namespace proxygen {
 void rfc6724_sort(std::vector<folly::SocketAddress>& addrs,
                   const folly::SocketAddress* srcAddr = nullptr);
 
+/**
+ * rfc6724_sort() with the source address of each destination prefix
+ * memoized, so that sorting answers for known prefixes costs no syscalls.
+ *
+ * Entries expire after maxAge, and are dropped on invalidate() and, after
+ * watchRouteChanges(), on the route and address changes netlink reports.
+ * Thread safe, except for watchRouteChanges() and
+ * stopWatchingRouteChanges().
+ */
+class Rfc6724Cache {
+ public:
+  struct Options {
+    // Destinations sharing these leading bits share a source address
+    uint8_t v4PrefixLen{24};
+    uint8_t v6PrefixLen{64};
+    // All the entries are dropped when full
+    size_t maxEntries{4096};
+    std::chrono::milliseconds maxAge{std::chrono::seconds(60)};
+  };
+
+  // Sets the source address used to reach dst, false if it's unreachable
+  using SourceProbe = std::function<bool(const folly::SocketAddress& dst,
+                                         folly::SocketAddress& src)>;
+
+  // The default probe connect()s a UDP socket, as rfc6724_sort() does
+  explicit Rfc6724Cache(Options options = Options(),
+                        SourceProbe probe = nullptr);
+  ~Rfc6724Cache();
+
+  /**
+   * As rfc6724_sort(), probing only the destinations with no entry.
+   *
+   * @throws std::system_error if a probe fails
+   */
+  void sort(std::vector<folly::SocketAddress>& addrs);
+
+  void invalidate();
+
+  /**
+   * Invalidate on netlink route and address notifications, read on evb.
+   * False if unsupported, i.e. not on Linux, or the socket can't be set up.
+   * To be called in evb's thread, as stopWatchingRouteChanges() and the
+   * destructor when watching.
+   */
+  bool watchRouteChanges(folly::EventBase* evb);
+  void stopWatchingRouteChanges();
+
+  size_t size() const;
+
+ private:
+  class RouteWatcher;
+
+  struct Entry {
+    bool hasSrcAddr;
+    folly::SocketAddress srcAddr;
+    std::chrono::steady_clock::time_point expiry;
+  };
+
+  folly::IPAddress getKey(const folly::SocketAddress& addr) const;
+
+  const Options options_;
+  SourceProbe probe_;
+  mutable std::mutex mutex_;
+  std::unordered_map<folly::IPAddress, Entry> entries_;
+  // Bumped by invalidate(), so that probes racing it aren't cached
+  uint64_t generation_{0};
+  std::unique_ptr<RouteWatcher> watcher_;
+};
+
 } // namespace proxygen
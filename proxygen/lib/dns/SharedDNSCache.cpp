@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "proxygen/lib/dns/SharedDNSCache.h"
+
+#include <algorithm>
+
+#include <folly/Conv.h>
+
+namespace {
+
+std::string getKey(const std::string& name, sa_family_t family) {
+  return folly::to<std::string>(name, "/", family);
+}
+
+} // namespace
+
+namespace proxygen {
+
+SharedDNSCache::SharedDNSCache(size_t maxSize, size_t numShards) {
+  CHECK_GT(numShards, 0);
+  auto shardSize = std::max<size_t>((maxSize + numShards - 1) / numShards, 1);
+  shards_.reserve(numShards);
+  for (size_t i = 0; i < numShards; ++i) {
+    shards_.push_back(std::make_unique<Shard>(std::in_place, shardSize));
+  }
+}
+
+SharedDNSCache::Shard& SharedDNSCache::getShard(const std::string& key) {
+  return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+bool SharedDNSCache::lookup(const std::string& name,
+                            sa_family_t family,
+                            TimePoint now,
+                            std::vector<DNSResolver::Answer>& answers) {
+  auto key = getKey(name, family);
+  auto cache = getShard(key).rlock();
+  auto iter = cache->findWithoutPromotion(key);
+  if (iter == cache->end()) {
+    return false;
+  }
+  const Entry& entry = iter->second;
+  auto elapsed = secondsBetween(now, entry.baseTime);
+  auto size = answers.size();
+  for (const auto& answer : entry.answers) {
+    if (entry.baseTime + answer.ttl >= now) {
+      answers.push_back(answer);
+      answers.back().ttl -= elapsed;
+    }
+  }
+  // Expired entries are left to be replaced or evicted, not to take the
+  // lock exclusive
+  return answers.size() > size;
+}
+
+void SharedDNSCache::insert(const std::string& name,
+                            sa_family_t family,
+                            const std::vector<DNSResolver::Answer>& answers,
+                            TimePoint now) {
+  if (answers.empty()) {
+    return;
+  }
+  auto key = getKey(name, family);
+  getShard(key).wlock()->set(key, Entry{answers, now});
+}
+
+void SharedDNSCache::clear() {
+  for (auto& shard : shards_) {
+    shard->wlock()->clear();
+  }
+}
+
+size_t SharedDNSCache::size() {
+  size_t size = 0;
+  for (auto& shard : shards_) {
+    size += shard->rlock()->size();
+  }
+  return size;
+}
+
+} // namespace proxygen
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <proxygen/lib/utils/Time.h>
+
+#include "proxygen/lib/dns/DNSResolver.h"
+
+namespace proxygen {
+
+/**
+ * A process wide cache of hostname resolutions, shared by the
+ * CachingDNSResolver of every thread so that a name is resolved once per
+ * TTL rather than once per thread.
+ *
+ * The cache is split in shards by name, each behind a reader-writer lock.
+ * Lookups don't promote entries in the LRU order, so they only take the
+ * lock shared and hits scale with the number of threads. Entries are keyed
+ * by name and family, since a query only answers for its own family.
+ */
+class SharedDNSCache {
+ public:
+  explicit SharedDNSCache(size_t maxSize = 16384, size_t numShards = 16);
+
+  /**
+   * Fills answers with the unexpired answers of name for family, their TTL
+   * reduced by the time spent in the cache. Returns false on a miss.
+   */
+  bool lookup(const std::string& name,
+              sa_family_t family,
+              TimePoint now,
+              std::vector<DNSResolver::Answer>& answers);
+
+  // Replaces the answers of name for family
+  void insert(const std::string& name,
+              sa_family_t family,
+              const std::vector<DNSResolver::Answer>& answers,
+              TimePoint now);
+
+  void clear();
+
+  size_t size();
+
+ private:
+  struct Entry {
+    std::vector<DNSResolver::Answer> answers;
+    TimePoint baseTime;
+  };
+  using Shard = folly::Synchronized<folly::EvictingCacheMap<std::string, Entry>,
+                                    folly::SharedMutex>;
+
+  Shard& getShard(const std::string& key);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace proxygen
@@ -10,7 +10,6 @@
 
 #include "proxygen/lib/dns/DNSModule.h"
 #include "proxygen/lib/dns/NaiveResolutionCallback.h"
-#include "proxygen/lib/dns/Rfc6724.h"
 
 #include <boost/thread/barrier.hpp>
 
@@ -38,12 +37,16 @@ SyncDNSResolver::SyncDNSResolver(DNSResolver::UniquePtr resolver) {
 
   // Create the underlying DNS resolver we are doing to use
   resolver_ = std::move(resolver);
+
+  evb_.runInEventBaseThreadAndWait(
+      [this]() { sortCache_.watchRouteChanges(&evb_); });
 }
 
 // public destructor
 SyncDNSResolver::~SyncDNSResolver() {
   evb_.runInEventBaseThread([this]() {
     resolver_.reset();
+    sortCache_.stopWatchingRouteChanges();
     evb_.terminateLoopSoon();
   });
 
@@ -89,7 +92,7 @@ std::vector<folly::SocketAddress> SyncDNSResolver::resolveHostname(
   }
 
   if (rfc6724sort) {
-    rfc6724_sort(addrs);
+    sortCache_.sort(addrs);
   }
   return addrs;
 }
@@ -11,6 +11,7 @@
 #include <thread>
 
 #include "proxygen/lib/dns/DNSResolver.h"
+#include "proxygen/lib/dns/Rfc6724.h"
 
 namespace proxygen {
 
@@ -46,6 +47,8 @@ class SyncDNSResolver {
   std::thread thread_;
   folly::EventBase evb_;
   DNSResolver::UniquePtr resolver_;
+  // Kept fresh by netlink notifications on evb_
+  Rfc6724Cache sortCache_;
 };
 
 } // namespace proxygen
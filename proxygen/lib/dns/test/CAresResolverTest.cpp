@@ -6,6 +6,9 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <array>
+
+#include <folly/String.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 
@@ -198,3 +201,191 @@ TEST_F(CAresResolverTest, TestParseTxtRecords) {
   res = proxygen::detail::parseTxtRecords(&GARBAGE[0], sizeof(GARBAGE));
   EXPECT_TRUE(res.hasError());
 }
+
+class BatchCAresResolver : public CAresResolver {
+ public:
+  struct SentQuery {
+    std::string name;
+    CAresResolver::RecordType type;
+    ares_callback cb;
+    void* data;
+  };
+
+  void answer(size_t i, int status, std::vector<unsigned char> response = {}) {
+    auto& q = queries.at(i);
+    q.cb(q.data,
+         status,
+         0,
+         response.empty() ? nullptr : response.data(),
+         static_cast<int>(response.size()));
+  }
+
+  std::vector<SentQuery> queries;
+
+ private:
+  void query(const std::string& name,
+             CAresResolver::RecordType type,
+             ares_callback cb,
+             void* data) override {
+    queries.push_back({name, type, cb, data});
+  }
+  void queryFinished() override {
+  }
+
+  ~BatchCAresResolver() override {
+  }
+};
+
+class TestBatchCallback : public CAresResolver::BatchCallback {
+ public:
+  void batchResolved(
+      std::vector<CAresResolver::BatchResult> r) noexcept override {
+    results = std::move(r);
+    calls++;
+  }
+
+  std::vector<CAresResolver::BatchResult> results;
+  int calls{0};
+};
+
+// A DNS response with a single A record for name
+static std::vector<unsigned char> makeAResponse(const std::string& name,
+                                               std::array<uint8_t, 4> ip) {
+  std::vector<unsigned char> buf = {
+      0x00, 0x01, 0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00};
+  std::vector<folly::StringPiece> labels;
+  folly::split('.', name, labels);
+  for (auto label : labels) {
+    buf.push_back(label.size());
+    buf.insert(buf.end(), label.begin(), label.end());
+  }
+  // Root, type A, class IN
+  buf.insert(buf.end(), {0x00, 0x00, 0x01, 0x00, 0x01});
+  // Pointer to the question name, type A, class IN, TTL 60, 4 bytes
+  buf.insert(buf.end(),
+             {0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c,
+              0x00, 0x04});
+  buf.insert(buf.end(), ip.begin(), ip.end());
+  return buf;
+}
+
+class CAresResolverBatchTest : public testing::Test {
+ public:
+  void SetUp() override {
+    resolver.reset(new BatchCAresResolver());
+    resolver->attachEventBase(&evb);
+  }
+
+  static DNSResolver::ResolutionStatus status(
+      const CAresResolver::BatchResult& result) {
+    auto ex = result.error.get_exception<DNSResolver::Exception>();
+    return ex ? ex->status() : DNSResolver::OK;
+  }
+
+  EventBase evb;
+  std::unique_ptr<BatchCAresResolver, DelayedDestruction::Destructor> resolver;
+};
+
+TEST_F(CAresResolverBatchTest, SharesInflightQueries) {
+  TestBatchCallback cb1;
+  TestBatchCallback cb2;
+  resolver->resolveBatch(&cb1, {"a.fb.com", "b.fb.com", "a.fb.com"});
+  // A and AAAA for each distinct name
+  ASSERT_EQ(4, resolver->queries.size());
+  EXPECT_EQ("a.fb.com", resolver->queries[0].name);
+  EXPECT_EQ(CAresResolver::RecordType::kA, resolver->queries[0].type);
+  EXPECT_EQ(CAresResolver::RecordType::kAAAA, resolver->queries[1].type);
+  EXPECT_EQ("b.fb.com", resolver->queries[2].name);
+
+  resolver->resolveBatch(&cb2, {"a.fb.com"}, std::chrono::milliseconds(0));
+  EXPECT_EQ(4, resolver->queries.size());
+
+  resolver->answer(0, ARES_SUCCESS, makeAResponse("a.fb.com", {10, 0, 0, 1}));
+  resolver->answer(1, ARES_ENODATA);
+  EXPECT_EQ(0, cb1.calls);
+  ASSERT_EQ(1, cb2.calls);
+  ASSERT_EQ(1, cb2.results.size());
+  ASSERT_EQ(1, cb2.results[0].answers.size());
+  EXPECT_EQ("10.0.0.1", cb2.results[0].answers[0].address.getAddressStr());
+
+  resolver->answer(2, ARES_ESERVFAIL);
+  resolver->answer(3, ARES_ENODATA);
+  ASSERT_EQ(1, cb1.calls);
+  ASSERT_EQ(3, cb1.results.size());
+  for (auto i : {0, 2}) {
+    EXPECT_EQ("a.fb.com", cb1.results[i].name);
+    EXPECT_EQ(1, cb1.results[i].answers.size());
+    EXPECT_FALSE(cb1.results[i].error);
+  }
+  EXPECT_EQ("b.fb.com", cb1.results[1].name);
+  EXPECT_TRUE(cb1.results[1].answers.empty());
+  EXPECT_EQ(DNSResolver::SERVER_OTHER, status(cb1.results[1]));
+
+  // Answered queries aren't shared anymore
+  resolver->resolveBatch(&cb1, {"a.fb.com"}, std::chrono::milliseconds(0),
+                         AF_INET);
+  ASSERT_EQ(5, resolver->queries.size());
+  resolver->answer(4, ARES_ENOTFOUND);
+  ASSERT_EQ(2, cb1.calls);
+  EXPECT_EQ(DNSResolver::NODATA, status(cb1.results[0]));
+}
+
+TEST_F(CAresResolverBatchTest, Timeout) {
+  TestBatchCallback cb;
+  resolver->resolveBatch(&cb,
+                         {"a.fb.com", "b.fb.com"},
+                         std::chrono::milliseconds(10),
+                         AF_UNSPEC);
+  ASSERT_EQ(4, resolver->queries.size());
+  resolver->answer(0, ARES_SUCCESS, makeAResponse("a.fb.com", {10, 0, 0, 1}));
+  evb.loop();
+
+  ASSERT_EQ(1, cb.calls);
+  EXPECT_EQ(1, cb.results[0].answers.size());
+  EXPECT_FALSE(cb.results[0].error);
+  EXPECT_EQ(DNSResolver::TIMEOUT, status(cb.results[1]));
+
+  // The timed out queries are ignored, and not shared with later batches
+  resolver->resolveBatch(&cb, {"b.fb.com"}, std::chrono::milliseconds(0),
+                         AF_INET);
+  ASSERT_EQ(5, resolver->queries.size());
+  resolver->answer(1, ARES_ENODATA);
+  resolver->answer(2, ARES_ENODATA);
+  resolver->answer(3, ARES_ENODATA);
+  EXPECT_EQ(1, cb.calls);
+  resolver->answer(4, ARES_SUCCESS, makeAResponse("b.fb.com", {10, 0, 0, 2}));
+  ASSERT_EQ(2, cb.calls);
+  EXPECT_EQ("10.0.0.2", cb.results[0].answers[0].address.getAddressStr());
+}
+
+TEST_F(CAresResolverBatchTest, Cancel) {
+  TestBatchCallback cb1;
+  {
+    TestBatchCallback cb2;
+    resolver->resolveBatch(&cb2, {"a.fb.com"}, std::chrono::milliseconds(10));
+    resolver->resolveBatch(&cb1, {"a.fb.com"}, std::chrono::milliseconds(0));
+  }
+  ASSERT_EQ(2, resolver->queries.size());
+  resolver->answer(0, ARES_ENODATA);
+  resolver->answer(1, ARES_ENODATA);
+  ASSERT_EQ(1, cb1.calls);
+  EXPECT_EQ(DNSResolver::NODATA, status(cb1.results[0]));
+
+  resolver->resolveBatch(&cb1, {"b.fb.com"}, std::chrono::milliseconds(0));
+  cb1.cancelBatch();
+  resolver->answer(2, ARES_ENODATA);
+  resolver->answer(3, ARES_ENODATA);
+  EXPECT_EQ(1, cb1.calls);
+  evb.loop();
+}
+
+TEST_F(CAresResolverBatchTest, Literals) {
+  TestBatchCallback cb;
+  resolver->resolveBatch(&cb, {"127.0.0.1", "localhost"});
+  EXPECT_TRUE(resolver->queries.empty());
+  ASSERT_EQ(1, cb.calls);
+  ASSERT_EQ(2, cb.results.size());
+  ASSERT_EQ(1, cb.results[0].answers.size());
+  EXPECT_EQ("127.0.0.1", cb.results[0].answers[0].address.getAddressStr());
+  EXPECT_FALSE(cb.results[1].answers.empty());
+}
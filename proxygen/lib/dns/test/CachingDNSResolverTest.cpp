@@ -131,3 +131,167 @@ TEST_F(CachingDNSResolverFixture, StaleCacheHitAfterFailure) {
   EXPECT_EQ(underlyingResolver_->getHitCount(), 1);
   EXPECT_EQ(cb_.getNumSuccesses(), 2);
 }
+
+TEST_F(CachingDNSResolverFixture, NegativeCacheHit) {
+  cachingResolver_->setNegativeCaching(16, std::chrono::seconds(10));
+  underlyingResolver_->setIsRunning(false);
+  underlyingResolver_->setErrorStatus(DNSResolver::NODATA);
+  cachingResolver_->resolveHostname(&cb_, "foo.bar.com");
+  EXPECT_EQ(cb_.getNumFailures(), 1);
+
+  // Answered from the negative cache, even once the name exists
+  underlyingResolver_->setIsRunning(true);
+  cachingResolver_->resolveHostname(&cb_, "foo.bar.com");
+  EXPECT_EQ(cb_.getNumFailures(), 2);
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 0);
+
+  timeUtil_->advance(std::chrono::seconds(11));
+  cachingResolver_->resolveHostname(&cb_, "foo.bar.com");
+  EXPECT_EQ(cb_.getNumSuccesses(), 1);
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 1);
+}
+
+TEST_F(CachingDNSResolverFixture, NegativeCacheSkipsLocalErrors) {
+  cachingResolver_->setNegativeCaching(16, std::chrono::seconds(10));
+  underlyingResolver_->setIsRunning(false);
+  underlyingResolver_->setErrorStatus(DNSResolver::TIMEOUT);
+  cachingResolver_->resolveHostname(&cb_, "foo.bar.com");
+  EXPECT_EQ(cb_.getNumFailures(), 1);
+
+  underlyingResolver_->setIsRunning(true);
+  cachingResolver_->resolveHostname(&cb_, "foo.bar.com");
+  EXPECT_EQ(cb_.getNumSuccesses(), 1);
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 1);
+}
+
+TEST_F(CachingDNSResolverFixture, ServeStaleWhileRevalidate) {
+  cachingResolver_->setServeStaleWhileRevalidate(true);
+  // Magical string that forces Dummies to have a TTL of 2.
+  string hostname("foo");
+  cachingResolver_->resolveHostname(&cb_, hostname);
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 1);
+
+  timeUtil_->advance(std::chrono::milliseconds(5000));
+
+  underlyingResolver_->setDeferred(true);
+  // Answered from the stale cache without waiting for the refresh
+  cachingResolver_->resolveHostname(&cb_, hostname);
+  EXPECT_EQ(cb_.getNumSuccesses(), 2);
+  EXPECT_FALSE(cb_.getAnswers().empty());
+  EXPECT_EQ(underlyingResolver_->getNumDeferred(), 1);
+
+  // A single refresh at a time
+  cachingResolver_->resolveHostname(&cb_, hostname);
+  EXPECT_EQ(cb_.getNumSuccesses(), 3);
+  EXPECT_EQ(underlyingResolver_->getNumDeferred(), 1);
+
+  underlyingResolver_->answerDeferred();
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 2);
+  cachingResolver_->resolveHostname(&cb_, hostname);
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 2);
+  EXPECT_EQ(cb_.getNumSuccesses(), 4);
+}
+
+TEST_F(CachingDNSResolverFixture, RefreshAhead) {
+  cachingResolver_->setRefreshAheadRatio(0.5);
+  // Magical string that forces Dummies to have a TTL of 2.
+  string hostname("foo");
+  cachingResolver_->resolveHostname(&cb_, hostname);
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 1);
+
+  timeUtil_->advance(std::chrono::milliseconds(1000));
+
+  // Answered from the cache, and refreshed in the background
+  cachingResolver_->resolveHostname(&cb_, hostname);
+  EXPECT_EQ(cb_.getNumSuccesses(), 2);
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 2);
+
+  // The refreshed answer is still cached after the first one expired
+  timeUtil_->advance(std::chrono::milliseconds(1500));
+  underlyingResolver_->setDeferred(true);
+  cachingResolver_->resolveHostname(&cb_, hostname);
+  EXPECT_EQ(cb_.getNumSuccesses(), 3);
+  EXPECT_EQ(underlyingResolver_->getNumDeferred(), 1);
+  underlyingResolver_->answerDeferred();
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 3);
+}
+
+TEST_F(CachingDNSResolverFixture, CoalesceQueries) {
+  cachingResolver_->setCoalesceQueries(true);
+  underlyingResolver_->setDeferred(true);
+  DummyDNSClient cb2;
+  DummyDNSClient cb3;
+  cachingResolver_->resolveHostname(&cb_, "foo.bar.com");
+  cachingResolver_->resolveHostname(&cb2, "foo.bar.com");
+  // Another family is another query
+  cachingResolver_->resolveHostname(
+      &cb3, "foo.bar.com", std::chrono::milliseconds(100), AF_INET6);
+  EXPECT_EQ(underlyingResolver_->getNumDeferred(), 2);
+
+  cb2.cancelResolution();
+  underlyingResolver_->answerDeferred();
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 2);
+  EXPECT_EQ(cb_.getNumSuccesses(), 1);
+  EXPECT_EQ(cb2.getNumSuccesses(), 0);
+  EXPECT_EQ(cb3.getNumSuccesses(), 1);
+}
+
+TEST_F(CachingDNSResolverFixture, SharedCacheAcrossResolvers) {
+  auto sharedCache = std::make_shared<SharedDNSCache>();
+  cachingResolver_->setSharedCache(sharedCache);
+  DNSResolver::UniquePtr p(new DummyDNSResolver());
+  auto otherUnderlying = dynamic_cast<DummyDNSResolver*>(p.get());
+  // Both start at the same mock time
+  auto other =
+      std::make_unique<CachingDNSResolver>(std::move(p),
+                                           4096,
+                                           256,
+                                           4,
+                                           24 * 60 * 60,
+                                           3,
+                                           std::make_unique<MockTimeUtil>());
+  other->setSharedCache(sharedCache);
+
+  cachingResolver_->resolveHostname(&cb_, "foo.bar.com");
+  EXPECT_EQ(underlyingResolver_->getHitCount(), 1);
+  EXPECT_EQ(sharedCache->size(), 1);
+
+  // Answered from the shared cache, then from its own
+  DummyDNSClient cb2;
+  other->resolveHostname(&cb2, "foo.bar.com");
+  other->resolveHostname(&cb2, "foo.bar.com");
+  EXPECT_EQ(cb2.getNumSuccesses(), 2);
+  EXPECT_EQ(cb2.getAnswers().size(), 1);
+  EXPECT_EQ(otherUnderlying->getHitCount(), 0);
+  EXPECT_EQ(other->getDNSCache().size(), 1);
+
+  // Families are cached apart
+  other->resolveHostname(
+      &cb2, "foo.bar.com", std::chrono::milliseconds(100), AF_INET6);
+  EXPECT_EQ(otherUnderlying->getHitCount(), 1);
+}
+
+TEST(SharedDNSCacheTest, ExpiredAnswers) {
+  SharedDNSCache cache(16, 4);
+  TimePoint now = getCurrentTime();
+  cache.insert("foo",
+               AF_INET,
+               {DNSResolver::Answer(std::chrono::seconds(2),
+                                    folly::SocketAddress("1.2.3.4", 0))},
+               now);
+
+  std::vector<DNSResolver::Answer> answers;
+  EXPECT_TRUE(cache.lookup("foo", AF_INET, now + std::chrono::seconds(1),
+                           answers));
+  ASSERT_EQ(answers.size(), 1);
+  EXPECT_EQ(answers[0].ttl, std::chrono::seconds(1));
+
+  answers.clear();
+  EXPECT_FALSE(cache.lookup("foo", AF_INET, now + std::chrono::seconds(3),
+                            answers));
+  EXPECT_FALSE(cache.lookup("foo", AF_INET6, now, answers));
+  EXPECT_TRUE(answers.empty());
+
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0);
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+#include "proxygen/lib/dns/DoHResolver.h"
+#include "proxygen/lib/dns/test/Mocks.h"
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+DNSResolver::ResolutionStatus getStatus(const folly::exception_wrapper& ew) {
+  auto ex = ew.get_exception<DNSResolver::Exception>();
+  return ex ? ex->status() : DNSResolver::OK;
+}
+
+// The response to query with an answer of rdata per entry of rdatas
+std::unique_ptr<folly::IOBuf> makeResponse(
+    const folly::IOBuf& query,
+    DoHResolver::QueryType type,
+    const std::vector<std::string>& rdatas,
+    uint8_t rcode = 0) {
+  auto msg = query.cloneCoalescedAsValue().moveToFbString().toStdString();
+  msg[2] |= 0x80; // QR
+  msg[3] = static_cast<char>(0x80 | rcode); // RA
+  msg[6] = 0;
+  msg[7] = static_cast<char>(rdatas.size()); // ANCOUNT
+  auto type16 = static_cast<uint16_t>(type);
+  for (const auto& rdata : rdatas) {
+    // Pointer to the question name, type, class IN, TTL 300
+    msg += std::string{'\xc0',
+                       '\x0c',
+                       static_cast<char>(type16 >> 8),
+                       static_cast<char>(type16 & 0xff),
+                       0,
+                       1,
+                       0,
+                       0,
+                       1,
+                       0x2c,
+                       0,
+                       static_cast<char>(rdata.size())};
+    msg += rdata;
+  }
+  return folly::IOBuf::copyBuffer(msg);
+}
+
+} // namespace
+
+TEST(DoHResolverMessageTest, ParseA) {
+  auto query = DoHResolver::encodeQuery("www.test", DoHResolver::QueryType::kA);
+  ASSERT_TRUE(query);
+  auto response = makeResponse(*query,
+                               DoHResolver::QueryType::kA,
+                               {std::string("\x0a\x00\x00\x01", 4),
+                                std::string("\x0a\x00\x00\x02", 4)});
+
+  std::vector<DNSResolver::Answer> answers;
+  auto error = DoHResolver::parseResponse(
+      "www.test", DoHResolver::QueryType::kA, *response, answers);
+  EXPECT_FALSE(error);
+  ASSERT_EQ(2, answers.size());
+  EXPECT_EQ("10.0.0.1", answers[0].address.getAddressStr());
+  EXPECT_EQ("10.0.0.2", answers[1].address.getAddressStr());
+  EXPECT_EQ(std::chrono::seconds(300), answers[0].ttl);
+  EXPECT_EQ("www.test", answers[0].name);
+  EXPECT_EQ(DNSResolver::ResolverType::DOH, answers[0].resolverType);
+}
+
+TEST(DoHResolverMessageTest, ParseAAAA) {
+  auto query =
+      DoHResolver::encodeQuery("www.test", DoHResolver::QueryType::kAAAA);
+  ASSERT_TRUE(query);
+  std::string addr(16, '\0');
+  addr[0] = '\x20';
+  addr[1] = '\x01';
+  addr[15] = '\x01';
+  auto response =
+      makeResponse(*query, DoHResolver::QueryType::kAAAA, {addr});
+
+  std::vector<DNSResolver::Answer> answers;
+  auto error = DoHResolver::parseResponse(
+      "www.test", DoHResolver::QueryType::kAAAA, *response, answers);
+  EXPECT_FALSE(error);
+  ASSERT_EQ(1, answers.size());
+  EXPECT_EQ("2001::1", answers[0].address.getAddressStr());
+}
+
+TEST(DoHResolverMessageTest, ParseErrors) {
+  auto query = DoHResolver::encodeQuery("www.test", DoHResolver::QueryType::kA);
+  ASSERT_TRUE(query);
+  std::vector<DNSResolver::Answer> answers;
+
+  auto nxdomain = makeResponse(*query, DoHResolver::QueryType::kA, {}, 3);
+  EXPECT_EQ(DNSResolver::NODATA,
+            getStatus(DoHResolver::parseResponse(
+                "www.test", DoHResolver::QueryType::kA, *nxdomain, answers)));
+
+  auto servfail = makeResponse(*query, DoHResolver::QueryType::kA, {}, 2);
+  EXPECT_EQ(DNSResolver::SERVER_OTHER,
+            getStatus(DoHResolver::parseResponse(
+                "www.test", DoHResolver::QueryType::kA, *servfail, answers)));
+
+  auto empty = makeResponse(*query, DoHResolver::QueryType::kA, {});
+  EXPECT_EQ(DNSResolver::NODATA,
+            getStatus(DoHResolver::parseResponse(
+                "www.test", DoHResolver::QueryType::kA, *empty, answers)));
+
+  auto truncated = folly::IOBuf::copyBuffer(std::string("\x00\x00\x81", 3));
+  EXPECT_EQ(DNSResolver::PARSE_ERROR,
+            getStatus(DoHResolver::parseResponse(
+                "www.test", DoHResolver::QueryType::kA, *truncated, answers)));
+  EXPECT_TRUE(answers.empty());
+}
+
+class DoHResolverTest : public testing::Test {
+ public:
+  void SetUp() override {
+    // The kernel completes the handshakes, nothing answers the queries
+    server_.reset(new folly::AsyncServerSocket(&evb_));
+    server_->bind(folly::SocketAddress("127.0.0.1", 0));
+    server_->listen(16);
+    server_->getAddress(&serverAddr_);
+  }
+
+  void TearDown() override {
+    resolver_.reset();
+    server_.reset();
+    evb_.loop();
+  }
+
+  void makeResolver() {
+    DoHResolver::Options options;
+    options.hostname = "doh.test";
+    options.port = serverAddr_.getPort();
+    options.isSecure = false;
+    options.upstream.plaintextProtocol = "h2";
+    options.upstream.resolver = [this](const Endpoint&) {
+      return serverAddr_;
+    };
+    resolver_ = DoHResolver::newResolver(&evb_, std::move(options));
+  }
+
+  folly::EventBase evb_;
+  folly::AsyncServerSocket::UniquePtr server_;
+  folly::SocketAddress serverAddr_;
+  DoHResolver::UniquePtr resolver_;
+};
+
+TEST_F(DoHResolverTest, Literal) {
+  makeResolver();
+  MockDNSClient cb;
+  std::vector<DNSResolver::Answer> answers;
+  EXPECT_CALL(cb, _resolutionSuccess(_)).WillOnce(SaveArg<0>(&answers));
+
+  resolver_->resolveHostname(&cb, "10.0.0.1");
+  ASSERT_EQ(1, answers.size());
+  EXPECT_EQ("10.0.0.1", answers[0].address.getAddressStr());
+  EXPECT_EQ(0, resolver_->numPendingLookups());
+}
+
+TEST_F(DoHResolverTest, InvalidName) {
+  makeResolver();
+  MockDNSClient cb;
+  folly::exception_wrapper error;
+  EXPECT_CALL(cb, _resolutionError(_)).WillOnce(SaveArg<0>(&error));
+
+  resolver_->resolveHostname(&cb, std::string(300, 'a'));
+  EXPECT_EQ(DNSResolver::INVALID, getStatus(error));
+  EXPECT_EQ(0, resolver_->numPendingLookups());
+}
+
+TEST_F(DoHResolverTest, SharedLookups) {
+  makeResolver();
+  MockDNSClient cb1;
+  MockDNSClient cb2;
+  folly::exception_wrapper error1;
+  folly::exception_wrapper error2;
+  EXPECT_CALL(cb1, _resolutionError(_)).WillOnce(SaveArg<0>(&error1));
+  EXPECT_CALL(cb2, _resolutionError(_)).WillOnce(SaveArg<0>(&error2));
+
+  auto timeout = std::chrono::milliseconds(50);
+  resolver_->resolveHostname(&cb1, "www.test", timeout, AF_UNSPEC);
+  resolver_->resolveHostname(&cb2, "www.test", timeout, AF_INET);
+  // A and AAAA, the second request only joins the A lookup
+  EXPECT_EQ(2, resolver_->numPendingLookups());
+
+  while (!error1 || !error2) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(DNSResolver::TIMEOUT, getStatus(error1));
+  EXPECT_EQ(DNSResolver::TIMEOUT, getStatus(error2));
+  // Nothing waits for the lookups anymore
+  EXPECT_EQ(0, resolver_->numPendingLookups());
+}
+
+TEST_F(DoHResolverTest, Cancel) {
+  makeResolver();
+  MockDNSClient cb1;
+  MockDNSClient cb2;
+  folly::exception_wrapper error;
+  EXPECT_CALL(cb1, _resolutionError(_)).Times(0);
+  EXPECT_CALL(cb2, _resolutionError(_)).WillOnce(SaveArg<0>(&error));
+
+  auto timeout = std::chrono::milliseconds(50);
+  resolver_->resolveHostname(&cb1, "www.test", timeout, AF_UNSPEC);
+  resolver_->resolveHostname(&cb2, "www.test", timeout, AF_INET);
+  cb1.cancelResolution();
+  // The AAAA lookup was cb1's only
+  EXPECT_EQ(1, resolver_->numPendingLookups());
+
+  while (!error) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(DNSResolver::TIMEOUT, getStatus(error));
+}
+
+TEST_F(DoHResolverTest, ConnectError) {
+  // Nothing listens there anymore
+  server_.reset();
+  makeResolver();
+  MockDNSClient cb;
+  folly::exception_wrapper error;
+  EXPECT_CALL(cb, _resolutionError(_)).WillOnce(SaveArg<0>(&error));
+
+  resolver_->resolveHostname(
+      &cb, "www.test", std::chrono::milliseconds(1000), AF_UNSPEC);
+  while (!error) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(DNSResolver::CONN_REFUSED, getStatus(error));
+  EXPECT_EQ(0, resolver_->numPendingLookups());
+}
+
+TEST_F(DoHResolverTest, Shutdown) {
+  makeResolver();
+  MockDNSClient cb;
+  folly::exception_wrapper error;
+  EXPECT_CALL(cb, _resolutionError(_)).WillOnce(SaveArg<0>(&error));
+
+  resolver_->resolveHostname(
+      &cb, "www.test", std::chrono::milliseconds(1000), AF_UNSPEC);
+  resolver_.reset();
+  EXPECT_EQ(DNSResolver::SHUTDOWN, getStatus(error));
+}
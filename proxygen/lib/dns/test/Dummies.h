@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <tuple>
+
 #include "proxygen/lib/dns/CAresResolver.h"
 #include "proxygen/lib/dns/CachingDNSResolver.h"
 
@@ -22,9 +24,14 @@ class DummyDNSResolver : public DNSResolver {
       sa_family_t family = AF_INET,
       TraceEventContext /*teContext*/ = TraceEventContext()) override {
 
+    if (deferred_) {
+      deferredNames_.emplace_back(cb, name, family);
+      return;
+    }
+
     if (!isRunning_) {
       cb->resolutionError(folly::make_exception_wrapper<Exception>(
-          UNKNOWN, "dummy DNS server is down."));
+          errorStatus_, "dummy DNS server is down."));
       return;
     }
 
@@ -89,9 +96,37 @@ class DummyDNSResolver : public DNSResolver {
     isRunning_ = value;
   }
 
+  // Status of the errors returned while not running
+  void setErrorStatus(ResolutionStatus status) {
+    errorStatus_ = status;
+  }
+
+  // Holds the requests until answerDeferred() while set
+  void setDeferred(bool value) {
+    deferred_ = value;
+  }
+
+  [[nodiscard]] size_t getNumDeferred() const {
+    return deferredNames_.size();
+  }
+
+  void answerDeferred() {
+    deferred_ = false;
+    auto deferredNames = std::move(deferredNames_);
+    deferredNames_.clear();
+    for (auto& [cb, name, family] : deferredNames) {
+      resolveHostname(cb, name, std::chrono::milliseconds(100), family);
+    }
+  }
+
  private:
   int hitCount_{0};
   bool isRunning_{true};
+  ResolutionStatus errorStatus_{UNKNOWN};
+  bool deferred_{false};
+  std::vector<
+      std::tuple<DNSResolver::ResolutionCallback*, std::string, sa_family_t>>
+      deferredNames_;
 };
 
 class DummyDNSClient : public DNSResolver::ResolutionCallback {
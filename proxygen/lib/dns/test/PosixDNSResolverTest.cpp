@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/executors/ManualExecutor.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+#include "proxygen/lib/dns/PosixDNSResolver.h"
+#include "proxygen/lib/dns/test/Mocks.h"
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+DNSResolver::ResolutionStatus getStatus(const folly::exception_wrapper& ew) {
+  auto ex = ew.get_exception<DNSResolver::Exception>();
+  return ex ? ex->status() : DNSResolver::OK;
+}
+
+class RejectingExecutor : public folly::Executor {
+ public:
+  void add(folly::Func /* func */) override {
+    throw std::runtime_error("full");
+  }
+};
+
+} // namespace
+
+class PosixDNSResolverTest : public testing::Test {
+ public:
+  void SetUp() override {
+    executor_ = std::make_shared<folly::ManualExecutor>();
+    resolver_ = PosixDNSResolver::newResolver(&evb_, executor_);
+  }
+
+  // Runs the lookups and delivers their results
+  size_t runLookups() {
+    auto n = executor_->run();
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+    return n;
+  }
+
+  folly::EventBase evb_;
+  std::shared_ptr<folly::ManualExecutor> executor_;
+  PosixDNSResolver::UniquePtr resolver_;
+};
+
+TEST_F(PosixDNSResolverTest, Coalesce) {
+  MockDNSClient cb1;
+  MockDNSClient cb2;
+  std::vector<DNSResolver::Answer> answers1;
+  std::vector<DNSResolver::Answer> answers2;
+  EXPECT_CALL(cb1, _resolutionSuccess(_)).WillOnce(SaveArg<0>(&answers1));
+  EXPECT_CALL(cb2, _resolutionSuccess(_)).WillOnce(SaveArg<0>(&answers2));
+
+  auto timeout = std::chrono::milliseconds(0);
+  resolver_->resolveHostname(&cb1, "localhost", timeout, AF_INET);
+  resolver_->resolveHostname(&cb2, "localhost", timeout, AF_INET);
+  EXPECT_EQ(1, resolver_->numPendingLookups());
+
+  EXPECT_EQ(1, runLookups());
+  EXPECT_EQ(0, resolver_->numPendingLookups());
+  ASSERT_FALSE(answers1.empty());
+  EXPECT_EQ(answers1, answers2);
+  EXPECT_TRUE(answers1[0].address.isLoopbackAddress());
+  EXPECT_EQ(DNSResolver::ResolverType::POSIX, answers1[0].resolverType);
+  EXPECT_EQ(PosixDNSResolver::kDefaultAnswerTTL, answers1[0].ttl);
+}
+
+TEST_F(PosixDNSResolverTest, Literal) {
+  MockDNSClient cb;
+  std::vector<DNSResolver::Answer> answers;
+  EXPECT_CALL(cb, _resolutionSuccess(_)).WillOnce(SaveArg<0>(&answers));
+
+  resolver_->resolveHostname(&cb, "10.0.0.1");
+  ASSERT_EQ(1, answers.size());
+  EXPECT_EQ("10.0.0.1", answers[0].address.getAddressStr());
+  EXPECT_EQ(0, resolver_->numPendingLookups());
+}
+
+TEST_F(PosixDNSResolverTest, Timeout) {
+  MockDNSClient cb;
+  folly::exception_wrapper error;
+  EXPECT_CALL(cb, _resolutionError(_)).WillOnce(SaveArg<0>(&error));
+
+  resolver_->resolveHostname(
+      &cb, "localhost", std::chrono::milliseconds(10), AF_INET);
+  // Until the timeout, as the pending lookup keeps the loop alive
+  evb_.loopOnce();
+  EXPECT_EQ(DNSResolver::TIMEOUT, getStatus(error));
+
+  // The lookup runs on, and its result is dropped
+  EXPECT_EQ(1, resolver_->numPendingLookups());
+  EXPECT_EQ(1, runLookups());
+  EXPECT_EQ(0, resolver_->numPendingLookups());
+}
+
+TEST_F(PosixDNSResolverTest, Cancel) {
+  MockDNSClient cb1;
+  MockDNSClient cb2;
+  EXPECT_CALL(cb1, _resolutionSuccess(_)).Times(0);
+  EXPECT_CALL(cb2, _resolutionSuccess(_)).WillOnce(Invoke([&](auto) {
+    cb1.cancelResolution();
+  }));
+
+  auto timeout = std::chrono::milliseconds(0);
+  resolver_->resolveHostname(&cb1, "localhost", timeout, AF_INET);
+  resolver_->resolveHostname(&cb2, "localhost", timeout, AF_INET);
+  EXPECT_EQ(1, runLookups());
+}
+
+TEST_F(PosixDNSResolverTest, Rejected) {
+  resolver_ = PosixDNSResolver::newResolver(
+      &evb_, std::make_shared<RejectingExecutor>());
+  MockDNSClient cb;
+  folly::exception_wrapper error;
+  EXPECT_CALL(cb, _resolutionError(_)).WillOnce(SaveArg<0>(&error));
+
+  resolver_->resolveHostname(&cb, "localhost");
+  EXPECT_EQ(DNSResolver::THREADPOOL, getStatus(error));
+  EXPECT_EQ(0, resolver_->numPendingLookups());
+}
+
+TEST_F(PosixDNSResolverTest, Shutdown) {
+  MockDNSClient cb;
+  folly::exception_wrapper error;
+  EXPECT_CALL(cb, _resolutionError(_)).WillOnce(SaveArg<0>(&error));
+
+  resolver_->resolveAddress(&cb, folly::SocketAddress("127.0.0.1", 0));
+  resolver_.reset();
+  EXPECT_EQ(DNSResolver::SHUTDOWN, getStatus(error));
+
+  // The lookup completes after the resolver is gone
+  runLookups();
+}
@@ -129,3 +129,105 @@ TEST_F(SyncDNSResolverTest, Unsorted) {
     ASSERT_EQ(expected[i].address, actual[i]);
   }
 }
+
+TEST(Rfc6724, SortKeepsOrderOfEquals) {
+  std::vector<SocketAddress> addrs{SocketAddress("198.51.100.1", 0),
+                                   SocketAddress("198.51.100.2", 0),
+                                   SocketAddress("2001:db8:1::1", 0)};
+  std::vector<SocketAddress> expected{SocketAddress("2001:db8:1::1", 0),
+                                      SocketAddress("198.51.100.1", 0),
+                                      SocketAddress("198.51.100.2", 0)};
+  SocketAddress src("2001:db8:1::2", 0);
+  rfc6724_sort(addrs, &src);
+  EXPECT_EQ(expected, addrs);
+}
+
+class Rfc6724CacheTest : public testing::Test {
+ public:
+  Rfc6724Cache::SourceProbe probe() {
+    return [this](const SocketAddress& dst, SocketAddress& src) {
+      probes++;
+      src = dst.getFamily() == AF_INET6 ? SocketAddress("2001:db8:1::2", 0)
+                                        : SocketAddress("198.51.100.2", 0);
+      return true;
+    };
+  }
+
+  size_t probes{0};
+};
+
+TEST_F(Rfc6724CacheTest, MemoizesPerPrefix) {
+  Rfc6724Cache cache(Rfc6724Cache::Options(), probe());
+  std::vector<SocketAddress> addrs{SocketAddress("198.51.100.121", 0),
+                                   SocketAddress("2001:db8:1::1", 0)};
+  std::vector<SocketAddress> expected{SocketAddress("2001:db8:1::1", 0),
+                                      SocketAddress("198.51.100.121", 0)};
+  cache.sort(addrs);
+  EXPECT_EQ(expected, addrs);
+  EXPECT_EQ(2, probes);
+  EXPECT_EQ(2, cache.size());
+
+  // Same /24 and /64
+  addrs = {SocketAddress("198.51.100.7", 0), SocketAddress("2001:db8:1::9", 0)};
+  cache.sort(addrs);
+  EXPECT_EQ(SocketAddress("2001:db8:1::9", 0), addrs[0]);
+  EXPECT_EQ(2, probes);
+
+  addrs = {SocketAddress("203.0.113.1", 0)};
+  cache.sort(addrs);
+  EXPECT_EQ(3, probes);
+  EXPECT_EQ(3, cache.size());
+
+  cache.invalidate();
+  EXPECT_EQ(0, cache.size());
+  cache.sort(addrs);
+  EXPECT_EQ(4, probes);
+}
+
+TEST_F(Rfc6724CacheTest, Expiry) {
+  Rfc6724Cache::Options options;
+  options.maxAge = std::chrono::milliseconds(0);
+  Rfc6724Cache cache(options, probe());
+  std::vector<SocketAddress> addrs{SocketAddress("198.51.100.121", 0)};
+  cache.sort(addrs);
+  cache.sort(addrs);
+  EXPECT_EQ(2, probes);
+}
+
+TEST_F(Rfc6724CacheTest, MaxEntries) {
+  Rfc6724Cache::Options options;
+  options.maxEntries = 2;
+  Rfc6724Cache cache(options, probe());
+  std::vector<SocketAddress> addrs{SocketAddress("198.51.100.1", 0),
+                                   SocketAddress("203.0.113.1", 0)};
+  cache.sort(addrs);
+  EXPECT_EQ(2, cache.size());
+  addrs = {SocketAddress("192.0.2.1", 0)};
+  cache.sort(addrs);
+  EXPECT_EQ(1, cache.size());
+  EXPECT_EQ(3, probes);
+}
+
+TEST_F(Rfc6724CacheTest, Unreachable) {
+  Rfc6724Cache cache(
+      Rfc6724Cache::Options(),
+      [this](const SocketAddress& dst, SocketAddress& src) {
+        probes++;
+        if (dst.getFamily() == AF_INET6) {
+          return false;
+        }
+        src = SocketAddress("198.51.100.2", 0);
+        return true;
+      });
+  std::vector<SocketAddress> addrs{SocketAddress("2001:db8:1::1", 0),
+                                   SocketAddress("198.51.100.121", 0)};
+  std::vector<SocketAddress> expected{SocketAddress("198.51.100.121", 0),
+                                      SocketAddress("2001:db8:1::1", 0)};
+  cache.sort(addrs);
+  EXPECT_EQ(expected, addrs);
+  // Unreachable prefixes are cached too
+  addrs = expected;
+  cache.sort(addrs);
+  EXPECT_EQ(expected, addrs);
+  EXPECT_EQ(2, probes);
+}
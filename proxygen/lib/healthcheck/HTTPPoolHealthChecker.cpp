@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/healthcheck/HTTPPoolHealthChecker.h>
+
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/io/IOBufQueue.h>
+
+using folly::SocketAddress;
+using std::chrono::milliseconds;
+
+namespace proxygen {
+
+/**
+ * One check of a server.  It deletes itself once the transaction is
+ * detached, or the UpstreamManager fails to open one; the server forgets it
+ * as soon as it has a result or is removed.
+ */
+class HTTPPoolHealthChecker::Probe
+    : public HTTPTransaction::Handler
+    , public UpstreamManager::Callback {
+ public:
+  Probe(HTTPPoolHealthChecker& parent, Server* server)
+      : parent_(parent), server_(server) {
+    result_.startTime = getCurrentTime();
+  }
+
+  // The server is gone, don't report
+  void cancel() {
+    server_ = nullptr;
+    if (txn_) {
+      txn_->sendAbort();
+    } else {
+      parent_.upstream_->cancel(this);
+      delete this;
+    }
+  }
+
+  void onTransaction(HTTPTransaction* txn) noexcept override {
+    DCHECK_EQ(txn, txn_);
+    HTTPMessage request;
+    request.setMethod(HTTPMethod::GET);
+    request.setURL(parent_.options_.path);
+    request.getHeaders().set(HTTP_HEADER_HOST,
+                             parent_.options_.host.empty()
+                                 ? server_->name_
+                                 : parent_.options_.host);
+    txn->sendHeadersWithEOM(request);
+  }
+
+  void onTransactionError(
+      const folly::exception_wrapper& error) noexcept override {
+    fail(ServerDownInfo::HEALTHCHECK_CONNECT_ERROR, error.what().toStdString());
+    delete this;
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    fail(ServerDownInfo::HEALTHCHECK_EOF, "Transaction detached");
+    delete this;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    status_ = msg->getStatusCode();
+  }
+
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    if (parent_.options_.expectedBody) {
+      body_.append(std::move(chain));
+    }
+  }
+
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept override {
+  }
+
+  void onEOM() noexcept override {
+    if (status_ != 200) {
+      fail(ServerDownInfo::HEALTHCHECK_NON200_STATUS,
+           folly::to<std::string>("Status ", status_));
+      return;
+    }
+    const auto& expectedBody = parent_.options_.expectedBody;
+    if (expectedBody) {
+      auto body = body_.move();
+      if (!body || body->computeChainDataLength() != expectedBody->size() ||
+          body->coalesce() != folly::StringPiece(*expectedBody)) {
+        fail(ServerDownInfo::HEALTHCHECK_BODY_MISMATCH, "Unexpected body");
+        return;
+      }
+    }
+    result_.success = true;
+    report();
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onError(const HTTPException& error) noexcept override {
+    fail(error.getProxygenError() == kErrorTimeout
+             ? ServerDownInfo::HEALTHCHECK_TIMEOUT
+             : ServerDownInfo::HEALTHCHECK_MESSAGE_ERROR,
+         error.what());
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  void fail(ServerDownInfo reason, std::string reasonStr) {
+    result_.reason = reason;
+    result_.reasonStr = std::move(reasonStr);
+    report();
+  }
+
+  // Only the first result is reported
+  void report() {
+    if (!server_) {
+      return;
+    }
+    auto server = server_;
+    server_ = nullptr;
+    server->probe_ = nullptr;
+    parent_.onProbeResult(*server, std::move(result_));
+  }
+
+  HTTPPoolHealthChecker& parent_;
+  Server* server_;
+  HTTPTransaction* txn_{nullptr};
+  Result result_;
+  uint16_t status_{0};
+  folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+};
+
+HTTPPoolHealthChecker::HTTPPoolHealthChecker(folly::EventBase* evb,
+                                             Options options)
+    : evb_(evb), options_(std::move(options)) {
+}
+
+HTTPPoolHealthChecker::~HTTPPoolHealthChecker() {
+  DCHECK(servers_.empty()) << "deleteAllCheckers() must be called first";
+}
+
+void HTTPPoolHealthChecker::start() {
+  evb_->runInEventBaseThread([this] {
+    if (started_) {
+      return;
+    }
+    started_ = true;
+    for (auto& it : servers_) {
+      scheduleFirstCheck(*it.second);
+    }
+  });
+}
+
+void HTTPPoolHealthChecker::stop() {
+  evb_->runInEventBaseThread([this] {
+    started_ = false;
+    // Probes in flight still report
+    for (auto& it : servers_) {
+      it.second->cancelTimeout();
+    }
+  });
+}
+
+void HTTPPoolHealthChecker::deleteAllCheckers() {
+  evb_->runImmediatelyOrRunInEventBaseThreadAndWait([this] {
+    started_ = false;
+    while (!servers_.empty()) {
+      removeServerImpl(servers_.begin()->first);
+    }
+    notifyTimeout_.cancelTimeout();
+    upstream_.reset();
+  });
+}
+
+void HTTPPoolHealthChecker::addServer(
+    const std::string& name,
+    const SocketAddress& address,
+    bool isSecure,
+    std::shared_ptr<ServerHealthCheckerCallback> callback,
+    std::optional<SocketAddress> bindAddress,
+    std::optional<folly::SocketOptionMap> extraSockOpts,
+    std::optional<SocketAddress> overrideAddress) {
+  if (bindAddress || extraSockOpts) {
+    VLOG(2) << "Ignoring the bind address and socket options of " << name;
+  }
+  evb_->runInEventBaseThread([this,
+                              name,
+                              address,
+                              isSecure,
+                              callback = std::move(callback),
+                              overrideAddress]() mutable {
+    auto& server = servers_[address];
+    if (!server) {
+      server = std::make_unique<Server>(
+          *this, name, overrideAddress.value_or(address), isSecure);
+      if (started_) {
+        scheduleFirstCheck(*server);
+      }
+    }
+    server->callbacks_.push_back(std::move(callback));
+  });
+}
+
+void HTTPPoolHealthChecker::removeServer(const SocketAddress& address) {
+  evb_->runInEventBaseThread([this, address] { removeServerImpl(address); });
+}
+
+void HTTPPoolHealthChecker::removeServer(
+    const SocketAddress& address,
+    std::shared_ptr<ServerHealthCheckerCallback> callback) {
+  evb_->runInEventBaseThread([this, address, callback = std::move(callback)] {
+    auto it = servers_.find(address);
+    if (it == servers_.end()) {
+      return;
+    }
+    auto& callbacks = it->second->callbacks_;
+    callbacks.erase(std::remove(callbacks.begin(), callbacks.end(), callback),
+                    callbacks.end());
+    if (callbacks.empty()) {
+      removeServerImpl(address);
+    }
+  });
+}
+
+void HTTPPoolHealthChecker::setLastExternalUpdateTime(
+    std::vector<SocketAddress>&& addresses, TimePoint t) {
+  evb_->runInEventBaseThread([this, addresses = std::move(addresses), t] {
+    for (const auto& address : addresses) {
+      auto it = servers_.find(address);
+      if (it != servers_.end()) {
+        it->second->lastExternalUpdate_ = t;
+      }
+    }
+  });
+}
+
+void HTTPPoolHealthChecker::reportPassiveFailure(const SocketAddress& address,
+                                                 std::string reason) {
+  evb_->runInEventBaseThread(
+      [this, address, reason = std::move(reason)]() mutable {
+        auto it = servers_.find(address);
+        if (it == servers_.end()) {
+          return;
+        }
+        Result result;
+        result.startTime = getCurrentTime();
+        result.reason = ServerDownInfo::PASSIVE_HEALTHCHECK_FAIL;
+        result.reasonStr = std::move(reason);
+        onProbeResult(*it->second, std::move(result));
+      });
+}
+
+void HTTPPoolHealthChecker::scheduleFirstCheck(Server& server) {
+  // At a random point of the interval
+  auto interval = std::max<int64_t>(options_.checkInterval.count(), 1);
+  evb_->timer().scheduleTimeout(
+      &server, milliseconds(folly::Random::rand64(interval)));
+}
+
+void HTTPPoolHealthChecker::onCheckTimeout(Server& server) {
+  auto now = getCurrentTime();
+  evb_->timer().scheduleTimeout(&server, options_.checkInterval);
+  if (server.probe_) {
+    VLOG(4) << "Previous check of " << server.name_ << " still running";
+    return;
+  }
+  if (now - server.lastExternalUpdate_ < options_.checkInterval) {
+    return;
+  }
+  if (!upstream_) {
+    auto upstreamOptions = options_.upstream;
+    // Sessions idle between two checks are kept for the next
+    upstreamOptions.idleTimeout =
+        std::max(upstreamOptions.idleTimeout, 2 * options_.checkInterval);
+    if (!upstreamOptions.resolver) {
+      // The endpoints are addresses
+      upstreamOptions.resolver = [](const Endpoint& endpoint) {
+        return SocketAddress(endpoint.getHostname(), endpoint.getPort());
+      };
+    }
+    upstream_ =
+        std::make_unique<UpstreamManager>(std::move(upstreamOptions), evb_);
+  }
+  server.probe_ = new Probe(*this, &server);
+  upstream_->getTransaction(
+      server.endpoint_, server.probe_, server.probe_, /*idempotent=*/true);
+}
+
+void HTTPPoolHealthChecker::onProbeResult(Server& server, Result result) {
+  VLOG(5) << "Check of " << server.name_ << ": "
+          << (result.success ? "up" : serverDownInfoStr(result.reason));
+  if (!options_.notifyUnchanged && !server.pending_ &&
+      server.notifiedSuccess_ && *server.notifiedSuccess_ == result.success) {
+    return;
+  }
+  if (!server.pending_) {
+    pendingNotify_.push_back(&server);
+  }
+  server.pending_ = std::move(result);
+  if (!notifyTimeout_.isScheduled()) {
+    evb_->timer().scheduleTimeout(&notifyTimeout_, options_.notifyInterval);
+  }
+}
+
+void HTTPPoolHealthChecker::notify() {
+  auto servers = std::move(pendingNotify_);
+  pendingNotify_.clear();
+  for (auto server : servers) {
+    auto result = std::move(*server->pending_);
+    server->pending_.reset();
+    if (!options_.notifyUnchanged && server->notifiedSuccess_ &&
+        *server->notifiedSuccess_ == result.success) {
+      // Changed back before it was passed on
+      continue;
+    }
+    server->notifiedSuccess_ = result.success;
+    for (const auto& callback : server->callbacks_) {
+      if (result.success) {
+        callback->processHealthCheckSuccess(result.startTime, 0);
+      } else {
+        callback->processHealthCheckFailure(
+            result.startTime, result.reason, result.reasonStr);
+      }
+    }
+  }
+}
+
+void HTTPPoolHealthChecker::removeServerImpl(const SocketAddress& address) {
+  auto it = servers_.find(address);
+  if (it == servers_.end()) {
+    return;
+  }
+  auto& server = *it->second;
+  server.cancelTimeout();
+  if (server.probe_) {
+    auto probe = server.probe_;
+    server.probe_ = nullptr;
+    probe->cancel();
+  }
+  if (server.pending_) {
+    pendingNotify_.erase(
+        std::remove(pendingNotify_.begin(), pendingNotify_.end(), &server),
+        pendingNotify_.end());
+  }
+  servers_.erase(it);
+}
+
+} // namespace proxygen
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/healthcheck/PoolHealthChecker.h>
+#include <proxygen/lib/http/connpool/UpstreamManager.h>
+
+namespace proxygen {
+
+/**
+ * A PoolHealthChecker probing servers with HTTP GETs from one event base.
+ *
+ * Servers are checked once per address however many pools added them, and
+ * the results go to the callbacks of every pool.  The probes go over the
+ * sessions of an UpstreamManager, HTTP/2 by default, so each server is
+ * checked over one persistent session rather than a new connection per
+ * check.  The first check of each server is at a random point of the
+ * interval, spreading the probes of a large pool over it.  Results are
+ * passed to the callbacks every notifyInterval, and only when they change
+ * whether a server is up unless notifyUnchanged is set.
+ *
+ * A server whose health was set externally within the last interval is not
+ * probed.  The shared sessions can't honor a per server bind address or
+ * socket options, so those are ignored; set them in the upstream options.
+ *
+ * Callbacks are invoked in the event base thread.
+ */
+class HTTPPoolHealthChecker : public PoolHealthChecker {
+ public:
+  struct Options {
+    Options() {
+      upstream.plaintextProtocol = "h2";
+    }
+
+    std::chrono::milliseconds checkInterval{std::chrono::seconds(1)};
+    std::string path{"/status"};
+    // The Host header of the probes, the server name when empty
+    std::string host;
+    // When set, a response with another body is a failure
+    folly::Optional<std::string> expectedBody;
+    std::chrono::milliseconds notifyInterval{std::chrono::milliseconds(100)};
+    bool notifyUnchanged{false};
+    // The idle timeout is raised to keep the sessions between checks
+    UpstreamManager::Options upstream;
+  };
+
+  HTTPPoolHealthChecker(folly::EventBase* evb, Options options);
+  ~HTTPPoolHealthChecker() override;
+
+  void start() override;
+  void stop() override;
+  void deleteAllCheckers() override;
+
+  void addServer(
+      const std::string& name,
+      const folly::SocketAddress& address,
+      bool isSecure,
+      std::shared_ptr<ServerHealthCheckerCallback> callback,
+      std::optional<folly::SocketAddress> bindAddress = std::nullopt,
+      std::optional<folly::SocketOptionMap> extraSockOpts = std::nullopt,
+      std::optional<folly::SocketAddress> overrideAddress =
+          std::nullopt) override;
+
+  // Stops checking address for every pool
+  void removeServer(const folly::SocketAddress& address) override;
+
+  // Stops passing the results for address to callback only
+  void removeServer(const folly::SocketAddress& address,
+                    std::shared_ptr<ServerHealthCheckerCallback> callback);
+
+  std::chrono::milliseconds getCheckInterval() const override {
+    return options_.checkInterval;
+  }
+
+  void setLastExternalUpdateTime(std::vector<folly::SocketAddress>&& addresses,
+                                 TimePoint t) override;
+
+  /**
+   * Marks the server at address down as passive checks, e.g. an
+   * OutlierDetector, found it degraded.  The active checks bring it back.
+   */
+  void reportPassiveFailure(const folly::SocketAddress& address,
+                            std::string reason);
+
+  // The number of distinct addresses checked, from the event base thread
+  size_t getNumServers() const {
+    return servers_.size();
+  }
+
+ private:
+  class Probe;
+
+  struct Result {
+    TimePoint startTime;
+    bool success{false};
+    ServerDownInfo reason{ServerDownInfo::NONE};
+    std::string reasonStr;
+  };
+
+  class Server : public folly::HHWheelTimer::Callback {
+   public:
+    Server(HTTPPoolHealthChecker& parent,
+           std::string name,
+           const folly::SocketAddress& connectAddress,
+           bool isSecure)
+        : parent_(parent),
+          name_(std::move(name)),
+          endpoint_(connectAddress, isSecure),
+          connectAddress_(connectAddress) {
+    }
+
+    void timeoutExpired() noexcept override {
+      parent_.onCheckTimeout(*this);
+    }
+
+    void callbackCanceled() noexcept override {
+    }
+
+    HTTPPoolHealthChecker& parent_;
+    const std::string name_;
+    const Endpoint endpoint_;
+    const folly::SocketAddress connectAddress_;
+    std::vector<std::shared_ptr<ServerHealthCheckerCallback>> callbacks_;
+    TimePoint lastExternalUpdate_;
+    Probe* probe_{nullptr};
+    // Whether the last result passed on was a success
+    folly::Optional<bool> notifiedSuccess_;
+    folly::Optional<Result> pending_;
+  };
+
+  class NotifyTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit NotifyTimeout(HTTPPoolHealthChecker& parent) : parent_(parent) {
+    }
+
+    void timeoutExpired() noexcept override {
+      parent_.notify();
+    }
+
+   private:
+    HTTPPoolHealthChecker& parent_;
+  };
+
+  void scheduleFirstCheck(Server& server);
+  void onCheckTimeout(Server& server);
+  void onProbeResult(Server& server, Result result);
+  void notify();
+  void removeServerImpl(const folly::SocketAddress& address);
+
+  folly::EventBase* const evb_;
+  const Options options_;
+  // The rest is only used in evb_'s thread
+  // Created with the first probe, and dropped by deleteAllCheckers()
+  std::unique_ptr<UpstreamManager> upstream_;
+  std::unordered_map<folly::SocketAddress, std::unique_ptr<Server>> servers_;
+  std::vector<Server*> pendingNotify_;
+  NotifyTimeout notifyTimeout_{*this};
+  bool started_{false};
+};
+
+} // namespace proxygen
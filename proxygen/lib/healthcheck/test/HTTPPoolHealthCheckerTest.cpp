@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+
+#include <folly/Conv.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/healthcheck/HTTPPoolHealthChecker.h>
+
+using namespace proxygen;
+using folly::SocketAddress;
+using std::chrono::milliseconds;
+
+namespace {
+
+class TestHealthCallback : public ServerHealthCheckerCallback {
+ public:
+  struct Result {
+    TimePoint startTime;
+    TimePoint notifyTime;
+    bool success;
+    ServerDownInfo reason;
+    std::string reasonStr;
+  };
+
+  void processHealthCheckFailure(
+      const TimePoint& startTime,
+      ServerDownInfo reason,
+      const std::string& extraReasonStr,
+      const ExtraHeaders* /*extraHeaders*/) override {
+    results.push_back(
+        {startTime, getCurrentTime(), false, reason, extraReasonStr});
+  }
+
+  void processHealthCheckSuccess(
+      const TimePoint& startTime,
+      LoadType /*load*/,
+      const ServerLoadInfo* /*serverLoadInfo*/,
+      const ExtraHeaders* /*extraHeaders*/) override {
+    results.push_back(
+        {startTime, getCurrentTime(), true, ServerDownInfo::NONE, ""});
+  }
+
+  std::vector<Result> results;
+};
+
+/**
+ * Answers every HTTP/1.1 request with an empty response of status, or
+ * reads the requests and never answers if status is 0.
+ */
+class StatusServer : public folly::AsyncServerSocket::AcceptCallback {
+ public:
+  explicit StatusServer(folly::EventBase& evb) : evb_(evb) {
+  }
+
+  void connectionAccepted(folly::NetworkSocket fd,
+                          const SocketAddress& /*clientAddr*/,
+                          AcceptInfo /*info*/) noexcept override {
+    conns_.push_back(std::make_unique<Conn>(
+        *this, folly::AsyncSocket::newSocket(&evb_, fd)));
+  }
+
+  void acceptError(folly::exception_wrapper /*ex*/) noexcept override {
+  }
+
+  void closeAll() {
+    conns_.clear();
+  }
+
+  // The connections accepted so far
+  size_t connections() const {
+    return conns_.size();
+  }
+
+  uint16_t status{200};
+  size_t requests{0};
+
+ private:
+  class Conn : public folly::AsyncTransport::ReadCallback {
+   public:
+    Conn(StatusServer& parent, folly::AsyncSocket::UniquePtr sock)
+        : parent_(parent), sock_(std::move(sock)) {
+      sock_->setReadCB(this);
+    }
+
+    ~Conn() override {
+      sock_->setReadCB(nullptr);
+    }
+
+    void getReadBuffer(void** buf, size_t* lenReturn) override {
+      *buf = buf_;
+      *lenReturn = sizeof(buf_);
+    }
+
+    void readDataAvailable(size_t len) noexcept override {
+      data_.append(buf_, len);
+      size_t end;
+      while ((end = data_.find("\r\n\r\n")) != std::string::npos) {
+        data_.erase(0, end + 4);
+        parent_.requests++;
+        if (parent_.status != 0) {
+          sock_->writeChain(
+              nullptr,
+              folly::IOBuf::copyBuffer(folly::to<std::string>(
+                  "HTTP/1.1 ",
+                  parent_.status,
+                  " Status\r\nContent-Length: 0\r\n\r\n")));
+        }
+      }
+    }
+
+    void readEOF() noexcept override {
+      sock_->close();
+    }
+
+    void readErr(const folly::AsyncSocketException& /*ex*/) noexcept override {
+      sock_->close();
+    }
+
+   private:
+    StatusServer& parent_;
+    folly::AsyncSocket::UniquePtr sock_;
+    char buf_[1024];
+    std::string data_;
+  };
+
+  folly::EventBase& evb_;
+  std::vector<std::unique_ptr<Conn>> conns_;
+};
+
+} // namespace
+
+class HTTPPoolHealthCheckerTest : public testing::Test {
+ public:
+  void SetUp() override {
+    server_.reset(new folly::AsyncServerSocket(&evb_));
+    server_->bind(SocketAddress("127.0.0.1", 0));
+    server_->listen(16);
+    server_->getAddress(&serverAddr_);
+    server_->addAcceptCallback(&statusServer_, &evb_);
+    server_->startAccepting();
+  }
+
+  void TearDown() override {
+    if (checker_) {
+      checker_->deleteAllCheckers();
+      checker_.reset();
+    }
+    statusServer_.closeAll();
+    server_.reset();
+    evb_.loop();
+  }
+
+  void makeChecker(HTTPPoolHealthChecker::Options options) {
+    // The test server only speaks HTTP/1.1
+    options.upstream.plaintextProtocol.clear();
+    checker_ =
+        std::make_unique<HTTPPoolHealthChecker>(&evb_, std::move(options));
+  }
+
+  // An address only identifying a server checked at the test server
+  static SocketAddress fakeAddress(int i) {
+    return SocketAddress(folly::to<std::string>("10.0.0.", i), 80);
+  }
+
+  void addServer(const SocketAddress& address,
+                 std::shared_ptr<ServerHealthCheckerCallback> callback) {
+    checker_->addServer("upstream.test",
+                        address,
+                        false,
+                        std::move(callback),
+                        std::nullopt,
+                        std::nullopt,
+                        serverAddr_);
+  }
+
+  // Loops until done returns true, or for one second
+  template <typename F>
+  void loopUntil(F done) {
+    auto deadline = getCurrentTime() + std::chrono::seconds(1);
+    while (!done() && getCurrentTime() < deadline) {
+      evb_.loopOnce(EVLOOP_NONBLOCK);
+    }
+  }
+
+  void loopFor(milliseconds duration) {
+    auto deadline = getCurrentTime() + duration;
+    loopUntil([&] { return getCurrentTime() >= deadline; });
+  }
+
+ protected:
+  folly::EventBase evb_;
+  StatusServer statusServer_{evb_};
+  folly::AsyncServerSocket::UniquePtr server_;
+  SocketAddress serverAddr_;
+  std::unique_ptr<HTTPPoolHealthChecker> checker_;
+};
+
+TEST_F(HTTPPoolHealthCheckerTest, SharedCheck) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(200);
+  options.notifyInterval = milliseconds(1);
+  makeChecker(std::move(options));
+
+  // Two pools with the same server
+  auto cb1 = std::make_shared<TestHealthCallback>();
+  auto cb2 = std::make_shared<TestHealthCallback>();
+  addServer(fakeAddress(1), cb1);
+  addServer(fakeAddress(1), cb2);
+  checker_->start();
+  loopUntil([&] { return !cb1->results.empty() && !cb2->results.empty(); });
+  EXPECT_EQ(checker_->getNumServers(), 1);
+  ASSERT_EQ(cb1->results.size(), 1);
+  ASSERT_EQ(cb2->results.size(), 1);
+  EXPECT_TRUE(cb1->results[0].success);
+  EXPECT_EQ(cb1->results[0].startTime, cb2->results[0].startTime);
+  EXPECT_EQ(statusServer_.requests, 1);
+
+  // Checked until the last pool removes it
+  checker_->removeServer(fakeAddress(1), cb1);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(checker_->getNumServers(), 1);
+  checker_->removeServer(fakeAddress(1), cb2);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(checker_->getNumServers(), 0);
+}
+
+TEST_F(HTTPPoolHealthCheckerTest, FirstChecksSpread) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(500);
+  options.notifyInterval = milliseconds(1);
+  makeChecker(std::move(options));
+
+  std::vector<std::shared_ptr<TestHealthCallback>> callbacks;
+  for (int i = 1; i <= 8; i++) {
+    callbacks.push_back(std::make_shared<TestHealthCallback>());
+    addServer(fakeAddress(i), callbacks.back());
+  }
+  auto start = getCurrentTime();
+  checker_->start();
+  loopUntil([&] {
+    return std::all_of(callbacks.begin(), callbacks.end(), [](auto& cb) {
+      return !cb->results.empty();
+    });
+  });
+
+  // Each first check is at some point of the interval, not all at once
+  auto first = TimePoint::max();
+  auto last = TimePoint::min();
+  for (const auto& cb : callbacks) {
+    ASSERT_EQ(cb->results.size(), 1);
+    EXPECT_TRUE(cb->results[0].success);
+    first = std::min(first, cb->results[0].startTime);
+    last = std::max(last, cb->results[0].startTime);
+  }
+  EXPECT_LT(last - start, milliseconds(600));
+  EXPECT_GT(last - first, milliseconds(20));
+}
+
+TEST_F(HTTPPoolHealthCheckerTest, ReportsChanges) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(20);
+  options.notifyInterval = milliseconds(1);
+  makeChecker(std::move(options));
+
+  statusServer_.status = 503;
+  auto cb = std::make_shared<TestHealthCallback>();
+  addServer(fakeAddress(1), cb);
+  checker_->start();
+  loopUntil([&] { return statusServer_.requests >= 3; });
+  ASSERT_EQ(cb->results.size(), 1);
+  EXPECT_FALSE(cb->results[0].success);
+  EXPECT_EQ(cb->results[0].reason, ServerDownInfo::HEALTHCHECK_NON200_STATUS);
+
+  statusServer_.status = 200;
+  loopUntil([&] { return cb->results.size() == 2; });
+  ASSERT_EQ(cb->results.size(), 2);
+  EXPECT_TRUE(cb->results[1].success);
+  // All over one persistent session
+  EXPECT_EQ(statusServer_.connections(), 1);
+}
+
+TEST_F(HTTPPoolHealthCheckerTest, BatchedNotify) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(10);
+  options.notifyInterval = milliseconds(50);
+  makeChecker(std::move(options));
+
+  statusServer_.status = 503;
+  auto cb1 = std::make_shared<TestHealthCallback>();
+  auto cb2 = std::make_shared<TestHealthCallback>();
+  addServer(fakeAddress(1), cb1);
+  addServer(fakeAddress(2), cb2);
+  checker_->start();
+  loopUntil([&] { return !cb1->results.empty(); });
+
+  // Both passed on together, once the notify interval is up
+  ASSERT_EQ(cb1->results.size(), 1);
+  ASSERT_EQ(cb2->results.size(), 1);
+  auto apart = cb2->results[0].notifyTime - cb1->results[0].notifyTime;
+  EXPECT_LT(std::chrono::abs(apart), milliseconds(5));
+  EXPECT_GE(cb1->results[0].notifyTime - cb1->results[0].startTime,
+            milliseconds(40));
+  EXPECT_EQ(cb1->results[0].reason, ServerDownInfo::HEALTHCHECK_NON200_STATUS);
+
+  // Still down, nothing to pass on
+  loopFor(milliseconds(100));
+  EXPECT_GT(statusServer_.requests, 2);
+  EXPECT_EQ(cb1->results.size(), 1);
+  EXPECT_EQ(cb2->results.size(), 1);
+}
+
+TEST_F(HTTPPoolHealthCheckerTest, NotifyUnchanged) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(10);
+  options.notifyInterval = milliseconds(1);
+  options.notifyUnchanged = true;
+  makeChecker(std::move(options));
+
+  auto cb = std::make_shared<TestHealthCallback>();
+  addServer(fakeAddress(1), cb);
+  checker_->start();
+  loopUntil([&] { return cb->results.size() >= 2; });
+  ASSERT_GE(cb->results.size(), 2);
+  EXPECT_TRUE(cb->results[0].success);
+  EXPECT_TRUE(cb->results[1].success);
+}
+
+TEST_F(HTTPPoolHealthCheckerTest, PassiveFailure) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(20);
+  options.notifyInterval = milliseconds(50);
+  makeChecker(std::move(options));
+
+  // Not started, so only the passive failures are reported
+  auto cb1 = std::make_shared<TestHealthCallback>();
+  auto cb2 = std::make_shared<TestHealthCallback>();
+  addServer(fakeAddress(1), cb1);
+  addServer(fakeAddress(2), cb2);
+  auto reported = getCurrentTime();
+  checker_->reportPassiveFailure(fakeAddress(1), "outlier");
+  checker_->reportPassiveFailure(fakeAddress(2), "outlier");
+  loopUntil([&] { return !cb1->results.empty(); });
+  ASSERT_EQ(cb1->results.size(), 1);
+  ASSERT_EQ(cb2->results.size(), 1);
+  EXPECT_GE(cb1->results[0].notifyTime - reported, milliseconds(40));
+  EXPECT_EQ(cb1->results[0].reason, ServerDownInfo::PASSIVE_HEALTHCHECK_FAIL);
+  EXPECT_EQ(cb1->results[0].reasonStr, "outlier");
+  EXPECT_EQ(statusServer_.requests, 0);
+
+  // Still down, nothing to pass on
+  checker_->reportPassiveFailure(fakeAddress(1), "outlier");
+  loopFor(milliseconds(100));
+  EXPECT_EQ(cb1->results.size(), 1);
+
+  // Until an active check succeeds
+  checker_->start();
+  loopUntil([&] { return cb1->results.size() == 2; });
+  ASSERT_EQ(cb1->results.size(), 2);
+  EXPECT_TRUE(cb1->results[1].success);
+}
+
+TEST_F(HTTPPoolHealthCheckerTest, SkipsExternallyUpdated) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(100);
+  options.notifyInterval = milliseconds(1);
+  makeChecker(std::move(options));
+
+  auto cb = std::make_shared<TestHealthCallback>();
+  addServer(fakeAddress(1), cb);
+  auto updated = getCurrentTime();
+  checker_->setLastExternalUpdateTime({fakeAddress(1)}, updated);
+  checker_->start();
+  loopUntil([&] { return !cb->results.empty(); });
+
+  // Not probed until the external update is an interval old
+  ASSERT_EQ(cb->results.size(), 1);
+  EXPECT_GE(cb->results[0].startTime - updated, milliseconds(100));
+  EXPECT_EQ(statusServer_.requests, 1);
+}
+
+TEST_F(HTTPPoolHealthCheckerTest, RemoveDuringProbe) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(20);
+  options.notifyInterval = milliseconds(1);
+  makeChecker(std::move(options));
+
+  statusServer_.status = 0;
+  auto cb = std::make_shared<TestHealthCallback>();
+  addServer(fakeAddress(1), cb);
+  checker_->start();
+  loopUntil([&] { return statusServer_.requests == 1; });
+  ASSERT_EQ(statusServer_.requests, 1);
+
+  // The probe is aborted without reporting
+  checker_->removeServer(fakeAddress(1));
+  loopFor(milliseconds(50));
+  EXPECT_EQ(checker_->getNumServers(), 0);
+  EXPECT_TRUE(cb->results.empty());
+  EXPECT_EQ(statusServer_.requests, 1);
+}
+
+TEST_F(HTTPPoolHealthCheckerTest, DeleteAllCheckers) {
+  HTTPPoolHealthChecker::Options options;
+  options.checkInterval = milliseconds(20);
+  options.notifyInterval = milliseconds(50);
+  makeChecker(std::move(options));
+
+  // Probes in flight
+  statusServer_.status = 0;
+  auto cb1 = std::make_shared<TestHealthCallback>();
+  auto cb2 = std::make_shared<TestHealthCallback>();
+  addServer(fakeAddress(1), cb1);
+  addServer(fakeAddress(2), cb2);
+  checker_->start();
+  loopUntil([&] { return statusServer_.requests >= 2; });
+  ASSERT_GE(statusServer_.requests, 2);
+
+  checker_->deleteAllCheckers();
+  EXPECT_EQ(checker_->getNumServers(), 0);
+  loopFor(milliseconds(100));
+  EXPECT_TRUE(cb1->results.empty());
+  EXPECT_TRUE(cb2->results.empty());
+  checker_.reset();
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/AltSvc.h>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+
+namespace {
+
+// Splits value on sep, except inside quoted strings
+std::vector<folly::StringPiece> splitUnquoted(folly::StringPiece value,
+                                              char sep) {
+  std::vector<folly::StringPiece> parts;
+  bool quoted = false;
+  size_t start = 0;
+  for (size_t i = 0; i < value.size(); i++) {
+    auto c = value[i];
+    if (quoted && c == '\\') {
+      i++;
+    } else if (c == '"') {
+      quoted = !quoted;
+    } else if (!quoted && c == sep) {
+      parts.push_back(value.subpiece(start, i - start));
+      start = i + 1;
+    }
+  }
+  parts.push_back(value.subpiece(start));
+  return parts;
+}
+
+// The content of a quoted string, or value itself
+std::string unquote(folly::StringPiece value) {
+  if (value.size() < 2 || value.front() != '"' || value.back() != '"') {
+    return value.str();
+  }
+  std::string out;
+  value = value.subpiece(1, value.size() - 2);
+  for (size_t i = 0; i < value.size(); i++) {
+    if (value[i] == '\\' && i + 1 < value.size()) {
+      i++;
+    }
+    out.push_back(value[i]);
+  }
+  return out;
+}
+
+bool parseAlternative(folly::StringPiece value, proxygen::AltSvc& out) {
+  auto params = splitUnquoted(value, ';');
+  folly::StringPiece protocolId;
+  folly::StringPiece authority;
+  if (!folly::split(
+          '=', folly::trimWhitespace(params[0]), protocolId, authority) ||
+      protocolId.empty()) {
+    return false;
+  }
+  try {
+    out.protocolId = folly::uriUnescape<std::string>(protocolId);
+  } catch (const std::invalid_argument&) {
+    return false;
+  }
+  // [host]:port, with brackets around IPv6 literals
+  auto hostPort = unquote(authority);
+  auto colon = hostPort.rfind(':');
+  if (colon == std::string::npos) {
+    return false;
+  }
+  auto port = folly::tryTo<uint16_t>(
+      folly::StringPiece(hostPort).subpiece(colon + 1));
+  if (!port || *port == 0) {
+    return false;
+  }
+  out.port = *port;
+  out.host = hostPort.substr(0, colon);
+  if (out.host.size() >= 2 && out.host.front() == '[' &&
+      out.host.back() == ']') {
+    out.host = out.host.substr(1, out.host.size() - 2);
+  }
+
+  for (size_t i = 1; i < params.size(); i++) {
+    folly::StringPiece name;
+    folly::StringPiece paramValue;
+    if (!folly::split(
+            '=', folly::trimWhitespace(params[i]), name, paramValue)) {
+      continue;
+    }
+    auto unquoted = unquote(folly::trimWhitespace(paramValue));
+    if (name.equals("ma", folly::AsciiCaseInsensitive())) {
+      auto maxAge = folly::tryTo<uint32_t>(unquoted);
+      if (!maxAge) {
+        return false;
+      }
+      out.maxAge = std::chrono::seconds(*maxAge);
+    } else if (name.equals("persist", folly::AsciiCaseInsensitive())) {
+      // Other values are reserved and ignored
+      out.persist = unquoted == "1";
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+namespace proxygen {
+
+constexpr std::chrono::seconds AltSvc::kDefaultMaxAge;
+
+std::vector<AltSvc> parseAltSvc(folly::StringPiece value) {
+  std::vector<AltSvc> services;
+  value = folly::trimWhitespace(value);
+  if (value.equals("clear")) {
+    return services;
+  }
+  for (auto alternative : splitUnquoted(value, ',')) {
+    AltSvc service;
+    if (parseAlternative(alternative, service)) {
+      services.push_back(std::move(service));
+    }
+  }
+  return services;
+}
+
+} // namespace proxygen
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace proxygen {
+
+/**
+ * An alternative service advertised by an origin, RFC 7838.
+ */
+struct AltSvc {
+  // Freshness when the alternative has no ma parameter
+  static constexpr std::chrono::seconds kDefaultMaxAge{24 * 60 * 60};
+
+  // The ALPN protocol id, e.g. "h3"
+  std::string protocolId;
+  // Empty for the host of the origin
+  std::string host;
+  uint16_t port{0};
+  std::chrono::seconds maxAge{kDefaultMaxAge};
+  bool persist{false};
+};
+
+/**
+ * Parses the value of an Alt-Svc header, skipping the malformed
+ * alternatives.  "clear" parses to no alternatives.
+ */
+std::vector<AltSvc> parseAltSvc(folly::StringPiece value);
+
+} // namespace proxygen
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/BodyDecompressor.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <folly/String.h>
+#include <proxygen/lib/utils/UtilInl.h>
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+#include <proxygen/lib/utils/ZstdStreamDecompressor.h>
+#ifdef PROXYGEN_HAVE_BROTLI
+#include <proxygen/lib/utils/BrotliStreamDecompressor.h>
+#endif
+
+namespace {
+
+using namespace proxygen;
+
+std::unique_ptr<StreamDecompressor> makeDecompressor(
+    const HTTPMessage& msg, const BodyDecompressor::Options& options) {
+  auto encoding = folly::trimWhitespace(
+      msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_ENCODING));
+  if (encoding.empty()) {
+    return nullptr;
+  }
+  if (caseInsensitiveEqual(encoding, "gzip") ||
+      caseInsensitiveEqual(encoding, "x-gzip")) {
+    return std::make_unique<ZlibStreamDecompressor>(
+        CompressionType::GZIP,
+        kZlibDecompressorBufferGrowthDefault,
+        kZlibDecompressorBufferMinsizeDefault,
+        options.poolContexts);
+  }
+  if (caseInsensitiveEqual(encoding, "deflate")) {
+    return std::make_unique<ZlibStreamDecompressor>(
+        CompressionType::DEFLATE,
+        kZlibDecompressorBufferGrowthDefault,
+        kZlibDecompressorBufferMinsizeDefault,
+        options.poolContexts);
+  }
+  if (options.enableZstd && caseInsensitiveEqual(encoding, "zstd")) {
+    return std::make_unique<ZstdStreamDecompressor>(
+        /*reuseOutBuf=*/false, options.poolContexts);
+  }
+#ifdef PROXYGEN_HAVE_BROTLI
+  if (options.enableBrotli && caseInsensitiveEqual(encoding, "br")) {
+    return std::make_unique<BrotliStreamDecompressor>();
+  }
+#endif
+  return nullptr;
+}
+
+} // namespace
+
+namespace proxygen {
+
+const char* BodyDecompressor::getErrorString(Error error) {
+  switch (error) {
+    case Error::NONE:
+      return "none";
+    case Error::CORRUPT:
+      return "corrupt encoded body";
+    case Error::TOO_LARGE:
+      return "decompressed body too large";
+    case Error::RATIO:
+      return "decompression ratio too high";
+    case Error::TRUNCATED:
+      return "truncated encoded body";
+  }
+  return "unknown";
+}
+
+bool BodyDecompressor::isSupported(const HTTPMessage& msg,
+                                   const Options& options) {
+  return makeDecompressor(msg, options) != nullptr;
+}
+
+std::unique_ptr<BodyDecompressor> BodyDecompressor::fromMessage(
+    HTTPMessage& msg, const Options& options) {
+  auto decompressor = makeDecompressor(msg, options);
+  if (!decompressor) {
+    return nullptr;
+  }
+  msg.getHeaders().remove(HTTP_HEADER_CONTENT_ENCODING);
+  msg.getHeaders().remove(HTTP_HEADER_CONTENT_LENGTH);
+  return std::make_unique<BodyDecompressor>(std::move(decompressor), options);
+}
+
+BodyDecompressor::BodyDecompressor(
+    std::unique_ptr<StreamDecompressor> decompressor, Options options)
+    : decompressor_(std::move(decompressor)), options_(options) {
+  CHECK(decompressor_);
+  CHECK_GT(options_.inputStepBytes, 0);
+}
+
+void BodyDecompressor::append(std::unique_ptr<folly::IOBuf> compressed) {
+  if (!compressed) {
+    return;
+  }
+  compressedBytes_ += compressed->computeChainDataLength();
+  input_.append(std::move(compressed));
+}
+
+std::unique_ptr<folly::IOBuf> BodyDecompressor::step() {
+  if (error_ != Error::NONE || input_.empty()) {
+    return nullptr;
+  }
+  auto in = input_.splitAtMost(options_.inputStepBytes);
+  // Against the input consumed so far, the rest may be a bomb still
+  auto consumed = compressedBytes_ - input_.chainLength();
+  // Stops early once the output is over the limits, which fails below
+  auto out =
+      decompressor_->decompressAtMost(in.get(), getOutputBudget(consumed));
+  if (decompressor_->hasError()) {
+    error_ = Error::CORRUPT;
+    return nullptr;
+  }
+  if (out) {
+    decompressedBytes_ += out->computeChainDataLength();
+  }
+  if (options_.maxDecompressedBytes &&
+      decompressedBytes_ > options_.maxDecompressedBytes) {
+    error_ = Error::TOO_LARGE;
+    return nullptr;
+  }
+  if (options_.maxRatio > 0 &&
+      decompressedBytes_ > options_.ratioCheckMinBytes &&
+      decompressedBytes_ > options_.maxRatio * consumed) {
+    error_ = Error::RATIO;
+    return nullptr;
+  }
+  return out;
+}
+
+uint64_t BodyDecompressor::getOutputBudget(uint64_t consumed) const {
+  auto budget = std::numeric_limits<uint64_t>::max();
+  if (options_.maxDecompressedBytes) {
+    budget = options_.maxDecompressedBytes - decompressedBytes_;
+  }
+  if (options_.maxRatio > 0) {
+    auto allowed = std::max<double>(options_.ratioCheckMinBytes,
+                                    options_.maxRatio * consumed);
+    auto ratioBudget = std::max<double>(allowed - decompressedBytes_, 0);
+    if (ratioBudget < static_cast<double>(budget)) {
+      budget = static_cast<uint64_t>(ratioBudget);
+    }
+  }
+  // One more byte than allowed is enough to fail the checks
+  return budget == std::numeric_limits<uint64_t>::max() ? budget : budget + 1;
+}
+
+bool BodyDecompressor::finish() {
+  DCHECK(input_.empty());
+  if (error_ != Error::NONE) {
+    return false;
+  }
+  // Nothing encoded is an empty body
+  if (compressedBytes_ > 0 && !decompressor_->finished()) {
+    error_ = Error::TRUNCATED;
+    return false;
+  }
+  return true;
+}
+
+} // namespace proxygen
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+namespace proxygen {
+
+/**
+ * Decodes a message body sent with a Content-Encoding, a step at a time, so
+ * that the filters using it can stop while the next handler is paused.
+ *
+ * A step decompresses at most inputStepBytes of the buffered input, and
+ * stops the output just past what maxDecompressedBytes and maxRatio still
+ * allow, so decompression bombs fail before they use much memory.
+ */
+class BodyDecompressor {
+ public:
+  struct Options {
+    // Zero for no limit
+    uint64_t maxDecompressedBytes{64 * 1024 * 1024};
+    // Decompressed over compressed bytes, once the output is larger than
+    // ratioCheckMinBytes. Zero for no limit.
+    double maxRatio{100};
+    uint64_t ratioCheckMinBytes{1024 * 1024};
+    size_t inputStepBytes{4096};
+    bool enableZstd{true};
+    // Ignored unless proxygen is built with brotli
+    bool enableBrotli{true};
+    // Takes the contexts from the CompressionContextPool
+    bool poolContexts{false};
+  };
+
+  enum class Error : uint8_t {
+    NONE,
+    // Not valid for the encoding
+    CORRUPT,
+    TOO_LARGE,
+    RATIO,
+    // The stream ended before the encoding did
+    TRUNCATED,
+  };
+
+  static const char* getErrorString(Error error);
+
+  /**
+   * Whether msg has one Content-Encoding this can decode. Bodies with no
+   * or several encodings are left alone.
+   */
+  static bool isSupported(const HTTPMessage& msg, const Options& options);
+
+  /**
+   * A decompressor for the body of msg, or nullptr if it is not supported.
+   * Content-Encoding and Content-Length are removed from msg, as they no
+   * longer apply to the body passed on.
+   */
+  static std::unique_ptr<BodyDecompressor> fromMessage(HTTPMessage& msg,
+                                                       const Options& options);
+
+  BodyDecompressor(std::unique_ptr<StreamDecompressor> decompressor,
+                   Options options);
+
+  void append(std::unique_ptr<folly::IOBuf> compressed);
+
+  bool hasInput() const {
+    return !input_.empty();
+  }
+
+  /**
+   * Decompresses the next inputStepBytes of the input. The output may be
+   * null or empty, check getError() after every step.
+   */
+  std::unique_ptr<folly::IOBuf> step();
+
+  /**
+   * At the end of the body, once the input is consumed. False, with a
+   * TRUNCATED error, unless the encoded stream is complete.
+   */
+  bool finish();
+
+  Error getError() const {
+    return error_;
+  }
+
+  uint64_t getCompressedBytes() const {
+    return compressedBytes_;
+  }
+
+  uint64_t getDecompressedBytes() const {
+    return decompressedBytes_;
+  }
+
+ private:
+  // Output a step may produce before failing the limits, given the input
+  // consumed with it
+  uint64_t getOutputBudget(uint64_t consumed) const;
+
+  std::unique_ptr<StreamDecompressor> decompressor_;
+  const Options options_;
+  folly::IOBufQueue input_{folly::IOBufQueue::cacheChainLength()};
+  uint64_t compressedBytes_{0};
+  uint64_t decompressedBytes_{0};
+  Error error_{Error::NONE};
+};
+
+} // namespace proxygen
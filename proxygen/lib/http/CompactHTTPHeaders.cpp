@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/CompactHTTPHeaders.h>
+
+#include <glog/logging.h>
+#include <limits>
+#include <proxygen/lib/utils/UtilInl.h>
+
+namespace proxygen {
+
+CompactHTTPHeaders::CompactHTTPHeaders(const HTTPHeaders& headers) {
+  records_.reserve(headers.size());
+  headers.forEachWithCode([this](HTTPHeaderCode code,
+                                 const std::string& name,
+                                 const std::string& value) {
+    addImpl(code, name, value);
+  });
+}
+
+CompactHTTPHeaders::CompactHTTPHeaders(const CompactHTTPHeaders& other) {
+  compactFrom(other);
+}
+
+CompactHTTPHeaders& CompactHTTPHeaders::operator=(
+    const CompactHTTPHeaders& other) {
+  if (this != &other) {
+    removeAll();
+    compactFrom(other);
+  }
+  return *this;
+}
+
+void CompactHTTPHeaders::compactFrom(const CompactHTTPHeaders& other) {
+  if (other.deletedCount_ == 0) {
+    // Fast path: offsets stay valid, so this is just two memcpy's
+    records_ = other.records_;
+    bytes_ = other.bytes_;
+    return;
+  }
+  records_.reserve(other.size());
+  other.forEachWithCode(
+      [this](HTTPHeaderCode code,
+             folly::StringPiece name,
+             folly::StringPiece value) { addImpl(code, name, value); });
+}
+
+void CompactHTTPHeaders::add(folly::StringPiece name,
+                             folly::StringPiece value) {
+  CHECK(name.size());
+  addImpl(HTTPCommonHeaders::hash(name.data(), name.size()), name, value);
+}
+
+void CompactHTTPHeaders::add(HTTPHeaderCode code, folly::StringPiece value) {
+  CHECK_GE(code, HTTPHeaderCodeCommonOffset);
+  addImpl(code, folly::StringPiece(), value);
+}
+
+void CompactHTTPHeaders::addImpl(HTTPHeaderCode code,
+                                 folly::StringPiece name,
+                                 folly::StringPiece value) {
+  value = folly::trimWhitespace(value);
+  Record record;
+  record.code = code;
+  record.nameOffset = bytes_.size();
+  record.nameLength = 0;
+  if (code == HTTP_HEADER_OTHER) {
+    CHECK_LE(name.size(), std::numeric_limits<uint16_t>::max());
+    record.nameLength = name.size();
+    bytes_.insert(bytes_.end(), name.begin(), name.end());
+  }
+  CHECK_LE(bytes_.size() + value.size(), std::numeric_limits<uint32_t>::max());
+  record.valueOffset = bytes_.size();
+  record.valueLength = value.size();
+  bytes_.insert(bytes_.end(), value.begin(), value.end());
+  records_.push_back(record);
+}
+
+template <typename REC, typename LAMBDA>
+void CompactHTTPHeaders::forEachMatch(REC& records,
+                                      const CompactHTTPHeaders& self,
+                                      folly::StringPiece name,
+                                      LAMBDA func) {
+  const HTTPHeaderCode code = HTTPCommonHeaders::hash(name.data(), name.size());
+  for (auto& record : records) {
+    if (record.code != code) {
+      continue;
+    }
+    if (code == HTTP_HEADER_OTHER &&
+        !caseInsensitiveEqual(name, self.getName(record))) {
+      continue;
+    }
+    func(record);
+  }
+}
+
+bool CompactHTTPHeaders::exists(folly::StringPiece name) const {
+  return getNumberOfValues(name) > 0;
+}
+
+bool CompactHTTPHeaders::exists(HTTPHeaderCode code) const {
+  return getNumberOfValues(code) > 0;
+}
+
+size_t CompactHTTPHeaders::getNumberOfValues(folly::StringPiece name) const {
+  size_t count = 0;
+  forEachMatch(records_, *this, name, [&](const Record&) { count++; });
+  return count;
+}
+
+size_t CompactHTTPHeaders::getNumberOfValues(HTTPHeaderCode code) const {
+  size_t count = 0;
+  for (const auto& record : records_) {
+    if (record.code == code) {
+      count++;
+    }
+  }
+  return count;
+}
+
+folly::StringPiece CompactHTTPHeaders::getSingleOrEmpty(
+    folly::StringPiece name) const {
+  const Record* res = nullptr;
+  size_t count = 0;
+  forEachMatch(records_, *this, name, [&](const Record& record) {
+    res = &record;
+    count++;
+  });
+  return count == 1 ? getValue(*res) : folly::StringPiece();
+}
+
+folly::StringPiece CompactHTTPHeaders::getSingleOrEmpty(
+    HTTPHeaderCode code) const {
+  const Record* res = nullptr;
+  for (const auto& record : records_) {
+    if (record.code == code) {
+      if (res) {
+        return folly::StringPiece();
+      }
+      res = &record;
+    }
+  }
+  return res ? getValue(*res) : folly::StringPiece();
+}
+
+bool CompactHTTPHeaders::remove(folly::StringPiece name) {
+  bool removed = false;
+  forEachMatch(records_, *this, name, [&](Record& record) {
+    record.code = HTTP_HEADER_NONE;
+    deletedCount_++;
+    removed = true;
+  });
+  return removed;
+}
+
+bool CompactHTTPHeaders::remove(HTTPHeaderCode code) {
+  if (code == HTTP_HEADER_NONE) {
+    return false;
+  }
+  bool removed = false;
+  for (auto& record : records_) {
+    if (record.code == code) {
+      record.code = HTTP_HEADER_NONE;
+      deletedCount_++;
+      removed = true;
+    }
+  }
+  return removed;
+}
+
+void CompactHTTPHeaders::removeAll() {
+  records_.clear();
+  bytes_.clear();
+  deletedCount_ = 0;
+}
+
+void CompactHTTPHeaders::copyTo(HTTPHeaders& hdrs) const {
+  forEachWithCode([&hdrs](HTTPHeaderCode code,
+                          folly::StringPiece name,
+                          folly::StringPiece value) {
+    if (code == HTTP_HEADER_OTHER) {
+      hdrs.add(name, value);
+    } else {
+      hdrs.add(code, value);
+    }
+  });
+}
+
+} // namespace proxygen
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/small_vector.h>
+#include <proxygen/lib/http/HTTPHeaders.h>
+
+namespace proxygen {
+
+/**
+ * A flat, bump-allocated alternative to HTTPHeaders for hot paths that copy
+ * and destroy header blocks frequently (e.g. proxies).
+ *
+ * All names and values live back to back in a single byte buffer with inline
+ * capacity for a typical request, and each header is a fixed-size record of
+ * offsets into it.  Names of common headers are not stored at all, only their
+ * HTTPHeaderCode.  As a result:
+ *  - adding a header never allocates until the inline buffer is exhausted,
+ *    after which the buffer grows geometrically like any vector,
+ *  - copying is two memcpy's and destruction frees at most two blocks,
+ *    regardless of the number of headers.
+ *
+ * Values are returned as StringPiece's into the buffer and are invalidated by
+ * any mutation.  Removal only marks records as deleted; the bytes are
+ * reclaimed on copy or removeAll().  Name matching and value trimming follow
+ * HTTPHeaders.
+ */
+class CompactHTTPHeaders {
+ public:
+  CompactHTTPHeaders() = default;
+  explicit CompactHTTPHeaders(const HTTPHeaders& headers);
+
+  CompactHTTPHeaders(const CompactHTTPHeaders& other);
+  CompactHTTPHeaders& operator=(const CompactHTTPHeaders& other);
+  CompactHTTPHeaders(CompactHTTPHeaders&&) = default;
+  CompactHTTPHeaders& operator=(CompactHTTPHeaders&&) = default;
+
+  void add(folly::StringPiece name, folly::StringPiece value);
+  void add(HTTPHeaderCode code, folly::StringPiece value);
+
+  bool exists(folly::StringPiece name) const;
+  bool exists(HTTPHeaderCode code) const;
+
+  size_t getNumberOfValues(folly::StringPiece name) const;
+  size_t getNumberOfValues(HTTPHeaderCode code) const;
+
+  /**
+   * Returns the value of the header if it's present exactly once, otherwise
+   * an empty StringPiece.
+   */
+  folly::StringPiece getSingleOrEmpty(folly::StringPiece name) const;
+  folly::StringPiece getSingleOrEmpty(HTTPHeaderCode code) const;
+
+  /**
+   * Process all headers in the order they were added.  func takes two
+   * folly::StringPiece parameters (name, value) and returns void.
+   */
+  template <typename LAMBDA>
+  void forEach(LAMBDA func) const {
+    for (const auto& record : records_) {
+      if (record.code != HTTP_HEADER_NONE) {
+        func(getName(record), getValue(record));
+      }
+    }
+  }
+
+  /**
+   * As forEach, but func also takes the HTTPHeaderCode as first parameter.
+   */
+  template <typename LAMBDA>
+  void forEachWithCode(LAMBDA func) const {
+    for (const auto& record : records_) {
+      if (record.code != HTTP_HEADER_NONE) {
+        func(record.code, getName(record), getValue(record));
+      }
+    }
+  }
+
+  bool remove(folly::StringPiece name);
+  bool remove(HTTPHeaderCode code);
+  void removeAll();
+
+  size_t size() const {
+    return records_.size() - deletedCount_;
+  }
+
+  /**
+   * Append all headers to hdrs, materializing std::string values.
+   */
+  void copyTo(HTTPHeaders& hdrs) const;
+
+  /**
+   * Bytes of name/value storage in use, including deleted headers.
+   */
+  size_t bytesUsed() const {
+    return bytes_.size();
+  }
+
+ private:
+  struct Record {
+    uint32_t nameOffset;
+    uint32_t valueOffset;
+    uint32_t valueLength;
+    uint16_t nameLength;
+    HTTPHeaderCode code;
+  };
+
+  static constexpr size_t kInlineRecords = 16;
+  static constexpr size_t kInlineBytes = 512;
+
+  void addImpl(HTTPHeaderCode code,
+               folly::StringPiece name,
+               folly::StringPiece value);
+  void compactFrom(const CompactHTTPHeaders& other);
+
+  // Calls func(Record&) for every live record matching name
+  template <typename REC, typename LAMBDA>
+  static void forEachMatch(REC& records,
+                           const CompactHTTPHeaders& self,
+                           folly::StringPiece name,
+                           LAMBDA func);
+
+  folly::StringPiece getName(const Record& record) const {
+    if (record.code == HTTP_HEADER_OTHER) {
+      return folly::StringPiece(bytes_.data() + record.nameOffset,
+                                record.nameLength);
+    }
+    return *HTTPCommonHeaders::getPointerToName(record.code);
+  }
+
+  folly::StringPiece getValue(const Record& record) const {
+    return folly::StringPiece(bytes_.data() + record.valueOffset,
+                              record.valueLength);
+  }
+
+  folly::small_vector<Record, kInlineRecords> records_;
+  folly::small_vector<char, kInlineBytes> bytes_;
+  size_t deletedCount_{0};
+};
+
+} // namespace proxygen
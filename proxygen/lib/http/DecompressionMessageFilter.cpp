@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/DecompressionMessageFilter.h>
+
+namespace proxygen {
+
+void DecompressionMessageFilter::onHeadersComplete(
+    std::unique_ptr<HTTPMessage> msg) noexcept {
+  if (!decompressor_ && msg->isFinal()) {
+    decompressor_ = BodyDecompressor::fromMessage(*msg, options_);
+  }
+  nextOnHeadersComplete(std::move(msg));
+}
+
+void DecompressionMessageFilter::onBody(
+    std::unique_ptr<folly::IOBuf> chain) noexcept {
+  if (failed_) {
+    return;
+  }
+  if (!decompressor_) {
+    nextOnBody(std::move(chain));
+    return;
+  }
+  decompressor_->append(std::move(chain));
+  drain();
+}
+
+void DecompressionMessageFilter::onChunkHeader(size_t length) noexcept {
+  // The chunk lengths are those of the encoded body
+  if (!decompressor_ && !failed_) {
+    nextOnChunkHeader(length);
+  }
+}
+
+void DecompressionMessageFilter::onChunkComplete() noexcept {
+  if (!decompressor_ && !failed_) {
+    nextOnChunkComplete();
+  }
+}
+
+void DecompressionMessageFilter::onTrailers(
+    std::unique_ptr<HTTPHeaders> trailers) noexcept {
+  if (failed_) {
+    return;
+  }
+  if (!decompressor_) {
+    nextOnTrailers(std::move(trailers));
+    return;
+  }
+  trailers_ = std::move(trailers);
+}
+
+void DecompressionMessageFilter::onEOM() noexcept {
+  if (failed_) {
+    return;
+  }
+  if (!decompressor_) {
+    nextOnEOM();
+    return;
+  }
+  eomPending_ = true;
+  drain();
+}
+
+void DecompressionMessageFilter::resume(uint64_t offset) noexcept {
+  nextElementIsPaused_ = false;
+  if (decompressor_ && !failed_) {
+    folly::DestructorCheck::Safety safety(*this);
+    drain();
+    // Only once the buffered body is passed on, or the buffer would grow
+    if (safety.destroyed() || nextElementIsPaused_) {
+      return;
+    }
+  }
+  HTTPMessageFilter::resume(offset);
+}
+
+void DecompressionMessageFilter::drain() {
+  folly::DestructorCheck::Safety safety(*this);
+  while (!nextElementIsPaused_ && decompressor_->hasInput()) {
+    auto out = decompressor_->step();
+    if (decompressor_->getError() != BodyDecompressor::Error::NONE) {
+      fail();
+      return;
+    }
+    if (out && !out->empty()) {
+      nextOnBody(std::move(out));
+      if (safety.destroyed() || failed_) {
+        return;
+      }
+    }
+  }
+  if (nextElementIsPaused_ || !eomPending_ || decompressor_->hasInput()) {
+    return;
+  }
+  if (!decompressor_->finish()) {
+    fail();
+    return;
+  }
+  eomPending_ = false;
+  if (trailers_) {
+    nextOnTrailers(std::move(trailers_));
+    if (safety.destroyed()) {
+      return;
+    }
+  }
+  nextOnEOM();
+}
+
+void DecompressionMessageFilter::fail() {
+  failed_ = true;
+  auto error = decompressor_->getError();
+  VLOG(4) << "Failed to decode the body: "
+          << BodyDecompressor::getErrorString(error)
+          << ", compressed=" << decompressor_->getCompressedBytes()
+          << " decompressed=" << decompressor_->getDecompressedBytes();
+  HTTPException ex(HTTPException::Direction::INGRESS,
+                   BodyDecompressor::getErrorString(error));
+  ex.setProxygenError(kErrorParseBody);
+  ex.setHttpStatusCode((error == BodyDecompressor::Error::TOO_LARGE ||
+                        error == BodyDecompressor::Error::RATIO)
+                           ? 413
+                           : 400);
+  trailers_.reset();
+  eomPending_ = false;
+  nextOnError(ex);
+}
+
+} // namespace proxygen
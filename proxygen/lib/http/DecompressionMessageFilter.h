@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/lib/http/BodyDecompressor.h>
+#include <proxygen/lib/http/HTTPMessageFilters.h>
+
+namespace proxygen {
+
+static const std::string kDecompressionFilterName = "DecompressionFilter";
+
+/**
+ * Decodes message bodies sent with a gzip, deflate, zstd or br
+ * Content-Encoding, so that the next handlers see them decoded, with no
+ * Content-Encoding or Content-Length. Other messages pass through.
+ *
+ * The body is decoded as it arrives, a bounded step at a time, and what is
+ * left is buffered while the next handler is paused. The trailers and EOM
+ * are held back until the buffered body is passed on. A body that is not
+ * valid, or decodes to more than the limits, is reported to the next
+ * handler as an ingress error with a 400 or 413 status, and the rest of
+ * the message is dropped.
+ */
+class DecompressionMessageFilter : public HTTPMessageFilter {
+ public:
+  explicit DecompressionMessageFilter(BodyDecompressor::Options options = {})
+      : options_(options) {
+  }
+
+  std::unique_ptr<HTTPMessageFilter> clone() noexcept override {
+    return std::make_unique<DecompressionMessageFilter>(options_);
+  }
+
+  bool allowDSR() const noexcept override {
+    return false;
+  }
+
+  const std::string& getFilterName() const noexcept override {
+    return kDecompressionFilterName;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override;
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+  void onChunkHeader(size_t length) noexcept override;
+  void onChunkComplete() noexcept override;
+  void onTrailers(std::unique_ptr<HTTPHeaders> trailers) noexcept override;
+  void onEOM() noexcept override;
+
+  void resume(uint64_t offset) noexcept override;
+
+  const BodyDecompressor* getDecompressor() const {
+    return decompressor_.get();
+  }
+
+ private:
+  // Passes on the buffered body until the next handler pauses, then the
+  // trailers and EOM once it is all passed on
+  void drain();
+  void fail();
+
+  const BodyDecompressor::Options options_;
+  std::unique_ptr<BodyDecompressor> decompressor_;
+  std::unique_ptr<HTTPHeaders> trailers_;
+  bool eomPending_{false};
+  bool failed_{false};
+};
+
+} // namespace proxygen
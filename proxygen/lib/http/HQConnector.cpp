@@ -61,7 +61,12 @@ void HQConnector::connect(
         quicTransportStatsCallback) {
 
   DCHECK(!isBusy());
-  auto sock = std::make_unique<folly::AsyncUDPSocket>(eventBase);
+  std::unique_ptr<folly::AsyncUDPSocket> sock;
+  if (udpBatchStats_) {
+    sock = std::make_unique<CountingUDPSocket>(eventBase, udpBatchStats_);
+  } else {
+    sock = std::make_unique<folly::AsyncUDPSocket>(eventBase);
+  }
   auto quicClient = quic::QuicClientTransport::newClient(
       eventBase,
       std::move(sock),
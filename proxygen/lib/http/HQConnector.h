@@ -11,6 +11,7 @@
 #include <fizz/client/AsyncFizzClient.h>
 #include <folly/io/SocketOptionMap.h>
 #include <proxygen/lib/http/session/HQUpstreamSession.h>
+#include <proxygen/lib/transport/CountingUDPSocket.h>
 #include <quic/api/LoopDetectorCallback.h>
 #include <quic/api/QuicSocket.h>
 #include <quic/client/QuicClientTransport.h>
@@ -52,6 +53,11 @@ class HQConnector : public HQSession::ConnectCallback {
 
   void setQuicPskCache(std::shared_ptr<quic::QuicPskCache> quicPskCache);
 
+  // Count the UDP syscalls and packets of the connections made from now on
+  void setUDPBatchStats(std::shared_ptr<UDPBatchStats> udpBatchStats) {
+    udpBatchStats_ = std::move(udpBatchStats);
+  }
+
   void reset();
 
   void connect(
@@ -86,6 +92,7 @@ class HQConnector : public HQSession::ConnectCallback {
   HQUpstreamSession* session_{nullptr};
   quic::TransportSettings transportSettings_;
   std::shared_ptr<quic::QuicPskCache> quicPskCache_;
+  std::shared_ptr<UDPBatchStats> udpBatchStats_;
   bool useConnectionEndWithErrorCallback_{false};
 };
 
@@ -67,6 +67,9 @@ void HTTPConnector::connect(EventBase* eventBase,
   auto sock = new AsyncSocket(eventBase);
   socket_.reset(sock);
   connectStart_ = getCurrentTime();
+  if (tcpFastOpen_) {
+    sock->enableTFO();
+  }
   cb_->preConnect(sock);
   sock->connect(this, connectAddr, timeoutMs.count(), socketOptions, bindAddr);
 }
@@ -91,6 +94,9 @@ void HTTPConnector::connectSSL(EventBase* eventBase,
   sslSock->forceCacheAddrOnFailure(true);
   socket_.reset(sslSock);
   connectStart_ = getCurrentTime();
+  if (tcpFastOpen_) {
+    sslSock->enableTFO();
+  }
   cb_->preConnect(sslSock);
   sslSock->connect(
       this, connectAddr, timeoutMs.count(), socketOptions, bindAddr);
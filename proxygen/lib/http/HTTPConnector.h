@@ -88,6 +88,17 @@ class HTTPConnector : protected folly::AsyncSocket::ConnectCallback {
    */
   void setHTTPVersionOverride(bool enabled);
 
+  /**
+   * Connects with TCP Fast Open: the first bytes written, the request or the
+   * TLS ClientHello, go with the SYN when the kernel has a cookie for the
+   * server, saving a round trip on repeat connections.  The connection
+   * succeeds before the handshake, so its local address may be unset.
+   * Falls back to a regular handshake where TFO isn't supported.
+   */
+  void setTCPFastOpen(bool enabled) {
+    tcpFastOpen_ = enabled;
+  }
+
   /**
    * Begin the process of getting a plaintext connection to the server
    * specified by 'connectAddr'. This function immediately starts async
@@ -162,6 +173,7 @@ class HTTPConnector : protected folly::AsyncSocket::ConnectCallback {
   std::string plaintextProtocol_;
   TimePoint connectStart_;
   std::unique_ptr<DefaultHTTPCodecFactory> httpCodecFactory_;
+  bool tcpFastOpen_{false};
 };
 
 } // namespace proxygen
@@ -64,13 +64,26 @@ void HTTPHeaders::rawAdd(const std::string& name, const std::string& value) {
   add(name, value);
 }
 
-void HTTPHeaders::addFromCodec(const char* str, size_t len, string&& value) {
+void HTTPHeaders::addFromCodec(const char* str,
+                               size_t len,
+                               folly::StringPiece value) {
   const HTTPHeaderCode code = HTTPCommonHeaders::hash(str, len);
   auto namePtr = (code == HTTP_HEADER_OTHER)
                      ? new string(str, len)
                      : (std::string*)HTTPCommonHeaders::getPointerToName(code);
 
-  emplace_back(code, namePtr, std::move(value));
+  emplace_back(code, namePtr, value);
+}
+
+void HTTPHeaders::addFromCodec(HTTPHeaderCode code,
+                               folly::StringPiece name,
+                               folly::StringPiece value) {
+  DCHECK_EQ(code, HTTPCommonHeaders::hash(name.data(), name.size()));
+  auto namePtr = (code == HTTP_HEADER_OTHER)
+                     ? new string(name.data(), name.size())
+                     : (std::string*)HTTPCommonHeaders::getPointerToName(code);
+
+  emplace_back(code, namePtr, value);
 }
 
 bool HTTPHeaders::exists(folly::StringPiece name) const {
@@ -168,7 +181,7 @@ HTTPHeaders::~HTTPHeaders() {
 }
 
 HTTPHeaders::HTTPHeaders(const HTTPHeaders& hdrs)
-    : length_(0), capacity_(0), deletedCount_(hdrs.deletedCount_) {
+    : length_(0), capacity_(0), deletedCount_(0) {
   copyFrom(hdrs);
 }
 
@@ -184,16 +197,49 @@ HTTPHeaders::HTTPHeaders(HTTPHeaders&& hdrs) noexcept
 
 void HTTPHeaders::copyFrom(const HTTPHeaders& other) {
   ensure(other.capacity_);
-  memcpy(codes(), other.codes(), other.length_);
+  // Removed headers are left behind, so the copy starts compacted
+  auto c = codes();
+  auto n = names();
+  auto v = values();
+  size_t length = 0;
   for (size_t i = 0; i < other.length_; i++) {
-    if (codes()[i] == HTTP_HEADER_OTHER) {
-      names()[i] = new std::string(*other.names()[i]);
+    auto code = other.codes()[i];
+    if (code == HTTP_HEADER_NONE) {
+      continue;
+    }
+    c[length] = code;
+    if (code == HTTP_HEADER_OTHER) {
+      n[length] = new std::string(*other.names()[i]);
     } else {
-      names()[i] = other.names()[i];
+      n[length] = other.names()[i];
     }
-    new (values() + i) std::string(other.values()[i]);
+    new (v + length) std::string(other.values()[i]);
+    length++;
   }
-  length_ = other.length_;
+  length_ = length;
+}
+
+void HTTPHeaders::compact() {
+  auto c = codes();
+  auto n = names();
+  auto v = values();
+  size_t length = 0;
+  for (size_t i = 0; i < length_; i++) {
+    if (c[i] != HTTP_HEADER_NONE) {
+      if (length != i) {
+        c[length] = c[i];
+        n[length] = n[i];
+        v[length] = std::move(v[i]);
+      }
+      length++;
+    }
+  }
+  for (size_t i = length; i < length_; i++) {
+    (v + i)->~string();
+  }
+  VLOG(5) << "Compacted " << deletedCount_ << " removed headers";
+  length_ = length;
+  deletedCount_ = 0;
 }
 
 HTTPHeaders& HTTPHeaders::operator=(const HTTPHeaders& hdrs) {
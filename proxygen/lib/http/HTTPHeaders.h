@@ -57,7 +57,10 @@ inline bool isLWS(char c) {
  * to be very complete), then we create a new string with its name (we own that
  * pointer then). For such headers, we store the code HTTP_HEADER_OTHER.
  *
- * The code HTTP_HEADER_NONE signifies a header that has been removed.
+ * The code HTTP_HEADER_NONE signifies a header that has been removed.  The
+ * removed headers are compacted away, rather than the storage grown, once
+ * they are at least 1/kCompactionRatio of a full collection.  Copies leave
+ * them behind.
  *
  * Most methods which take a header name have two versions: one accepting
  * a string, and one accepting a code. It is recommended to use the latter
@@ -126,7 +129,18 @@ class HTTPHeaders {
   void add(headers_initializer_list l);
   void rawAdd(const std::string& name, const std::string& value);
 
-  void addFromCodec(const char* str, size_t len, std::string&& value);
+  /**
+   * Add a header whose name and value are still views into a codec's ingress
+   * buffer.  The value is copied exactly once, into the header storage.
+   */
+  void addFromCodec(const char* str, size_t len, folly::StringPiece value);
+
+  /**
+   * As above, for a name the codec has already hashed to code.
+   */
+  void addFromCodec(HTTPHeaderCode code,
+                    folly::StringPiece name,
+                    folly::StringPiece value);
 
   /**
    * For the header 'name', set its value to the single header 'value',
@@ -341,6 +355,7 @@ class HTTPHeaders {
   static const size_t kInitialVectorReserve = 16;
   static const size_t kRecSize =
       (sizeof(char) + sizeof(std::string*) + sizeof(std::string));
+  static const size_t kCompactionRatio = 4;
 
   /**
    * Moves the named header and values from this group to the destination
@@ -354,6 +369,9 @@ class HTTPHeaders {
 
   void destroy();
 
+  // Drops the removed headers, keeping the order of the others
+  void compact();
+
   void ensure(size_t minCapacity) {
     if (capacity_ >= minCapacity) {
       return;
@@ -414,6 +432,10 @@ class HTTPHeaders {
 
   template <typename T>
   void emplace_back_impl(HTTPHeaderCode code, std::string* name, T&& value) {
+    if (length_ == capacity_ && deletedCount_ > 0 &&
+        deletedCount_ * kCompactionRatio >= length_) {
+      compact();
+    }
     ensure(length_ + 1);
     codes()[length_] = code;
     names()[length_] = name;
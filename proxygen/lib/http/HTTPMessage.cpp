@@ -11,7 +11,9 @@
 #include <boost/algorithm/string.hpp>
 #include <folly/Format.h>
 #include <folly/Range.h>
-#include <folly/SingletonThreadLocal.h>
+#include <folly/String.h>
+#include <proxygen/lib/utils/HTTPTime.h>
+#include <array>
 #include <string>
 #include <vector>
 
@@ -27,6 +29,8 @@ namespace {
  * approximately 1% of our total CPU time on temporary locale objects.)
  */
 std::locale defaultLocale;
+
+const proxygen::HTTPMessage::NameValuePieces kNoPieces;
 } // namespace
 
 namespace proxygen {
@@ -68,8 +72,6 @@ void HTTPMessage::stripPerHopHeaders(bool stripPriority,
 
 HTTPMessage::HTTPMessage()
     : startTime_(getCurrentTime()),
-      localIP_(),
-      versionStr_("1.0"),
       fields_(),
       upgradeWebsocket_(HTTPMessage::WebSocketUpgrade::NONE),
       seqNo_(-1),
@@ -80,10 +82,12 @@ HTTPMessage::HTTPMessage()
       version_(1, 0),
       parsedCookies_(false),
       parsedQueryParams_(false),
+      parsedQueryParamPieces_(false),
       chunked_(false),
       upgraded_(false),
       wantsKeepalive_(true),
-      trailersAllowed_(false) {
+      trailersAllowed_(false),
+      earlyData_(false) {
 }
 
 HTTPMessage::~HTTPMessage() {
@@ -92,12 +96,9 @@ HTTPMessage::~HTTPMessage() {
 HTTPMessage::HTTPMessage(const HTTPMessage& message)
     : startTime_(message.startTime_),
       dstAddress_(message.dstAddress_),
-      dstIP_(message.dstIP_),
-      dstPort_(message.dstPort_),
-      localIP_(message.localIP_),
-      versionStr_(message.versionStr_),
+      ext_(message.ext_ ? std::make_unique<Extension>(*message.ext_)
+                        : nullptr),
       fields_(message.fields_),
-      cookies_(message.cookies_),
       queryParams_(message.queryParams_),
       headers_(message.headers_),
       upgradeWebsocket_(message.upgradeWebsocket_),
@@ -110,13 +111,19 @@ HTTPMessage::HTTPMessage(const HTTPMessage& message)
       version_(message.version_),
       parsedCookies_(message.parsedCookies_),
       parsedQueryParams_(message.parsedQueryParams_),
+      parsedQueryParamPieces_(false),
       chunked_(message.chunked_),
       upgraded_(message.upgraded_),
       wantsKeepalive_(message.wantsKeepalive_),
       trailersAllowed_(message.trailersAllowed_),
+      earlyData_(message.earlyData_),
       scheme_(message.scheme_) {
   if (isRequest()) {
-    setURL(request().url_);
+    rebaseURL(&message.request().url_);
+  }
+  // The pieces are views of the other message's URL
+  if (ext_) {
+    ext_->queryParamPieces.clear();
   }
   if (message.strippedPerHopHeaders_) {
     strippedPerHopHeaders_ =
@@ -130,12 +137,8 @@ HTTPMessage::HTTPMessage(const HTTPMessage& message)
 HTTPMessage::HTTPMessage(HTTPMessage&& message) noexcept
     : startTime_(message.startTime_),
       dstAddress_(std::move(message.dstAddress_)),
-      dstIP_(std::move(message.dstIP_)),
-      dstPort_(message.dstPort_),
-      localIP_(std::move(message.localIP_)),
-      versionStr_(std::move(message.versionStr_)),
+      ext_(std::move(message.ext_)),
       fields_(std::move(message.fields_)),
-      cookies_(std::move(message.cookies_)),
       queryParams_(std::move(message.queryParams_)),
       headers_(std::move(message.headers_)),
       strippedPerHopHeaders_(std::move(message.strippedPerHopHeaders_)),
@@ -150,13 +153,18 @@ HTTPMessage::HTTPMessage(HTTPMessage&& message) noexcept
       version_(message.version_),
       parsedCookies_(message.parsedCookies_),
       parsedQueryParams_(message.parsedQueryParams_),
+      parsedQueryParamPieces_(false),
       chunked_(message.chunked_),
       upgraded_(message.upgraded_),
       wantsKeepalive_(message.wantsKeepalive_),
       trailersAllowed_(message.trailersAllowed_),
+      earlyData_(message.earlyData_),
       scheme_(message.scheme_) {
   if (isRequest()) {
-    setURL(request().url_);
+    rebaseURL(nullptr);
+  }
+  if (ext_) {
+    ext_->queryParamPieces.clear();
   }
 }
 
@@ -167,15 +175,14 @@ HTTPMessage& HTTPMessage::operator=(const HTTPMessage& message) {
   startTime_ = message.startTime_;
   seqNo_ = message.seqNo_;
   dstAddress_ = message.dstAddress_;
-  dstIP_ = message.dstIP_;
-  dstPort_ = message.dstPort_;
-  localIP_ = message.localIP_;
-  versionStr_ = message.versionStr_;
+  ext_ = message.ext_ ? std::make_unique<Extension>(*message.ext_) : nullptr;
+  if (ext_) {
+    ext_->queryParamPieces.clear();
+  }
   fields_ = message.fields_;
   if (isRequest()) {
-    setURL(request().url_);
+    rebaseURL(&message.request().url_);
   }
-  cookies_ = message.cookies_;
   queryParams_ = message.queryParams_;
   version_ = message.version_;
   headers_ = message.headers_;
@@ -192,10 +199,12 @@ HTTPMessage& HTTPMessage::operator=(const HTTPMessage& message) {
   h2Pri_ = message.h2Pri_;
   parsedCookies_ = message.parsedCookies_;
   parsedQueryParams_ = message.parsedQueryParams_;
+  parsedQueryParamPieces_ = false;
   chunked_ = message.chunked_;
   upgraded_ = message.upgraded_;
   wantsKeepalive_ = message.wantsKeepalive_;
   trailersAllowed_ = message.trailersAllowed_;
+  earlyData_ = message.earlyData_;
   scheme_ = message.scheme_;
   upgradeWebsocket_ = message.upgradeWebsocket_;
 
@@ -214,15 +223,14 @@ HTTPMessage& HTTPMessage::operator=(HTTPMessage&& message) {
   startTime_ = message.startTime_;
   seqNo_ = message.seqNo_;
   dstAddress_ = std::move(message.dstAddress_);
-  dstIP_ = std::move(message.dstIP_);
-  dstPort_ = message.dstPort_;
-  localIP_ = std::move(message.localIP_);
-  versionStr_ = std::move(message.versionStr_);
+  ext_ = std::move(message.ext_);
+  if (ext_) {
+    ext_->queryParamPieces.clear();
+  }
   fields_ = std::move(message.fields_);
   if (isRequest()) {
-    setURL(request().url_);
+    rebaseURL(nullptr);
   }
-  cookies_ = std::move(message.cookies_);
   queryParams_ = std::move(message.queryParams_);
   version_ = message.version_;
   headers_ = std::move(message.headers_);
@@ -234,10 +242,12 @@ HTTPMessage& HTTPMessage::operator=(HTTPMessage&& message) {
   h2Pri_ = message.h2Pri_;
   parsedCookies_ = message.parsedCookies_;
   parsedQueryParams_ = message.parsedQueryParams_;
+  parsedQueryParamPieces_ = false;
   chunked_ = message.chunked_;
   upgraded_ = message.upgraded_;
   wantsKeepalive_ = message.wantsKeepalive_;
   trailersAllowed_ = message.trailersAllowed_;
+  earlyData_ = message.earlyData_;
   scheme_ = message.scheme_;
   upgradeWebsocket_ = message.upgradeWebsocket_;
   trailers_ = std::move(message.trailers_);
@@ -290,14 +300,36 @@ void HTTPMessage::setHTTPVersion(uint8_t maj, uint8_t min) {
   version_.first = maj;
   version_.second = min;
   if (version_.first >= 10 || version_.second >= 10) {
-    versionStr_ = folly::to<std::string>(maj, '.', min);
-  } else {
-    versionStr_.reserve(3);
-    versionStr_.clear();
-    versionStr_.append(1, maj + '0');
-    versionStr_.append(1, '.');
-    versionStr_.append(1, min + '0');
+    ext().versionStr = folly::to<std::string>(maj, '.', min);
+  } else if (ext_) {
+    ext_->versionStr.clear();
+  }
+}
+
+const std::string& HTTPMessage::getShortVersionString(uint8_t maj,
+                                                      uint8_t min) {
+  static const auto versionStrings = [] {
+    std::array<std::string, 100> strings;
+    for (size_t i = 0; i < strings.size(); ++i) {
+      strings[i] = folly::to<std::string>(i / 10, '.', i % 10);
+    }
+    return strings;
+  }();
+  DCHECK(maj < 10 && min < 10);
+  return versionStrings[maj * 10 + min];
+}
+
+const HTTPMessage::IPPort* HTTPMessage::getDstIPPort() const {
+  if (ext_ && ext_->dstIPPort) {
+    return ext_->dstIPPort.get();
   }
+  if (!dstAddress_.isInitialized()) {
+    return nullptr;
+  }
+  ext().dstIPPort =
+      std::make_unique<IPPort>(dstAddress_.getAddressStr(),
+                               folly::to<std::string>(dstAddress_.getPort()));
+  return ext_->dstIPPort.get();
 }
 
 const pair<uint8_t, uint8_t>& HTTPMessage::getHTTPVersion() const {
@@ -336,33 +368,8 @@ bool HTTPMessage::isHTTP1_1() const {
   return version_ == kHTTPVersion11;
 }
 
-namespace {
-struct FormattedDate {
-  time_t lastTime{0};
-  string date;
-
-  string formatDate() {
-    const auto now =
-        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-
-    if (now != lastTime) {
-      char buff[1024];
-      tm timeTupple;
-      gmtime_r(&now, &timeTupple);
-
-      strftime(buff, 1024, "%a, %d %b %Y %H:%M:%S %Z", &timeTupple);
-      date = std::string(buff);
-      lastTime = now;
-    }
-    return date;
-  }
-};
-} // namespace
-
-string HTTPMessage::formatDateHeader() {
-  struct DateTag {};
-  auto& obj = folly::SingletonThreadLocal<FormattedDate, DateTag>::get();
-  return obj.formatDate();
+const string& HTTPMessage::formatDateHeader() {
+  return getCurrentHTTPDateTime();
 }
 
 void HTTPMessage::ensureHostHeader() {
@@ -428,7 +435,7 @@ void HTTPMessage::parseCookies() const {
             ';',
             '=',
             [this](StringPiece cookieName, StringPiece cookieValue) {
-              cookies_.emplace(cookieName, cookieValue);
+              ext().cookies.emplace_back(cookieName, cookieValue);
             });
 
         return false; // continue processing "cookie" headers
@@ -436,7 +443,9 @@ void HTTPMessage::parseCookies() const {
 }
 
 void HTTPMessage::unparseCookies() const {
-  cookies_.clear();
+  if (ext_) {
+    ext_->cookies.clear();
+  }
   parsedCookies_ = false;
 }
 
@@ -449,41 +458,94 @@ const StringPiece HTTPMessage::getCookie(const string& name) const {
     parseCookies();
   }
 
-  auto it = cookies_.find(name);
-  if (it == cookies_.end()) {
-    return StringPiece();
-  } else {
-    return it->second;
+  // The first of the cookies with that name
+  for (const auto& cookie : ext_ ? ext_->cookies : kNoPieces) {
+    if (cookie.first == name) {
+      return cookie.second;
+    }
   }
+  return StringPiece();
+}
+
+const HTTPMessage::NameValuePieces& HTTPMessage::getCookies() const {
+  // As in getCookie(), the headers may have changed since the last parse
+  unparseCookies();
+  parseCookies();
+  return ext_ ? ext_->cookies : kNoPieces;
 }
 
 void HTTPMessage::parseQueryParams() const {
   DCHECK(!parsedQueryParams_);
-  const Request& req = request();
-
   parsedQueryParams_ = true;
-  if (req.query_.empty()) {
-    return;
+  for (const auto& param : getQueryParamPieces()) {
+    // We have some unit tests that make sure we always return the last
+    // value when there are duplicate parameters. I don't think this
+    // really matters, but for now we might as well maintain the same
+    // behavior.
+    queryParams_[param.first.str()] = param.second.str();
   }
+}
 
-  splitNameValue(
-      req.query_, '&', '=', [this](string&& paramName, string&& paramValue) {
-        auto it = queryParams_.find(paramName);
-        if (it == queryParams_.end()) {
-          queryParams_.emplace(std::move(paramName), std::move(paramValue));
-        } else {
-          // We have some unit tests that make sure we always return the last
-          // value when there are duplicate parameters. I don't think this
-          // really matters, but for now we might as well maintain the same
-          // behavior.
-          it->second = std::move(paramValue);
-        }
-      });
+void HTTPMessage::parseQueryParamPieces() const {
+  DCHECK(!parsedQueryParamPieces_);
+  parsedQueryParamPieces_ = true;
+  StringPiece sp(request().query_);
+  while (!sp.empty()) {
+    auto keyValue = sp.split_step('&');
+    if (keyValue.empty()) {
+      continue;
+    }
+    size_t valueDelimPos = keyValue.find('=');
+    if (valueDelimPos == string::npos) {
+      // Key only query param
+      ext().queryParamPieces.emplace_back(folly::trimWhitespace(keyValue),
+                                          StringPiece());
+    } else {
+      ext().queryParamPieces.emplace_back(
+          folly::trimWhitespace(keyValue.subpiece(0, valueDelimPos)),
+          folly::trimWhitespace(keyValue.subpiece(valueDelimPos + 1)));
+    }
+  }
 }
 
 void HTTPMessage::unparseQueryParams() {
   queryParams_.clear();
   parsedQueryParams_ = false;
+  if (ext_) {
+    ext_->queryParamPieces.clear();
+  }
+  parsedQueryParamPieces_ = false;
+}
+
+const HTTPMessage::NameValuePieces& HTTPMessage::getQueryParamPieces() const {
+  if (!parsedQueryParamPieces_) {
+    parseQueryParamPieces();
+  }
+  return ext_ ? ext_->queryParamPieces : kNoPieces;
+}
+
+folly::Optional<StringPiece> HTTPMessage::getQueryParamPiece(
+    StringPiece name) const {
+  const auto& params = getQueryParamPieces();
+  // The last one, as in getQueryParams()
+  for (auto it = params.rbegin(); it != params.rend(); ++it) {
+    if (it->first == name) {
+      return it->second;
+    }
+  }
+  return folly::none;
+}
+
+folly::Optional<std::string> HTTPMessage::decodeQueryParam(
+    StringPiece encoded) {
+  std::string result;
+  try {
+    folly::uriUnescape(encoded, result, folly::UriEscapeMode::QUERY);
+  } catch (const std::exception& ex) {
+    LOG(WARNING) << "Invalid escaped query param: " << folly::exceptionStr(ex);
+    return folly::none;
+  }
+  return result;
 }
 
 const string* HTTPMessage::getQueryParamPtr(const string& name) const {
@@ -500,7 +562,7 @@ const string* HTTPMessage::getQueryParamPtr(const string& name) const {
 }
 
 bool HTTPMessage::hasQueryParam(const string& name) const {
-  return getQueryParamPtr(name) != nullptr;
+  return getQueryParamPiece(name).has_value();
 }
 
 const string& HTTPMessage::getQueryParam(const string& name) const {
@@ -509,7 +571,7 @@ const string& HTTPMessage::getQueryParam(const string& name) const {
 }
 
 int HTTPMessage::getIntQueryParam(const std::string& name) const {
-  return folly::to<int>(getQueryParam(name));
+  return folly::to<int>(getQueryParamPiece(name).value_or(StringPiece()));
 }
 
 int HTTPMessage::getIntQueryParam(const std::string& name, int defval) const {
@@ -522,15 +584,11 @@ int HTTPMessage::getIntQueryParam(const std::string& name, int defval) const {
 }
 
 std::string HTTPMessage::getDecodedQueryParam(const std::string& name) const {
-  auto val = getQueryParam(name);
-
-  std::string result;
-  try {
-    folly::uriUnescape(val, result, folly::UriEscapeMode::QUERY);
-  } catch (const std::exception& ex) {
-    LOG(WARNING) << "Invalid escaped query param: " << folly::exceptionStr(ex);
+  auto val = getQueryParamPiece(name);
+  if (!val) {
+    return std::string();
   }
-  return result;
+  return decodeQueryParam(*val).value_or(std::string());
 }
 
 const std::map<std::string, std::string>& HTTPMessage::getQueryParams() const {
@@ -733,10 +791,10 @@ void HTTPMessage::describe(std::ostream& os) const {
 
   // Common fields to both requests and responses.
   std::vector<std::pair<const char*, folly::StringPiece>> fields{{
-      {"local_ip", localIP_},
-      {"version", versionStr_},
-      {"dst_ip", dstIP_},
-      {"dst_port", dstPort_},
+      {"local_ip", getLocalIp()},
+      {"version", getVersionString()},
+      {"dst_ip", getDstIP()},
+      {"dst_port", getDstPort()},
   }};
 
   std::string pushStatusMessage;
@@ -988,12 +1046,58 @@ ParseURL HTTPMessage::setURLImplInternal(bool unparse, bool strict) {
   }
   req.pathStr_.reset();
   req.queryStr_.reset();
+  // They view the old URL either way
+  if (ext_) {
+    ext_->queryParamPieces.clear();
+  }
+  parsedQueryParamPieces_ = false;
   if (unparse) {
     unparseQueryParams();
   }
   return u;
 }
 
+void HTTPMessage::setURL(std::string url, const URLOffsets& offsets) {
+  DVLOG(9) << "setURL: " << url;
+  auto& req = request();
+  req.url_ = std::move(url);
+  DCHECK_LE(offsets.pathStart + offsets.pathLength, req.url_.size());
+  DCHECK_LE(offsets.queryStart + offsets.queryLength, req.url_.size());
+  folly::StringPiece u(req.url_);
+  req.path_ = u.subpiece(offsets.pathStart, offsets.pathLength);
+  req.query_ = u.subpiece(offsets.queryStart, offsets.queryLength);
+  if (req.path_.empty()) {
+    req.path_.reset("/", 1);
+  }
+  req.pathStr_.reset();
+  req.queryStr_.reset();
+  unparseQueryParams();
+}
+
+void HTTPMessage::rebaseURL(const std::string* from) {
+  auto& req = request();
+  auto viewsOf = [](folly::StringPiece sp, const std::string& url) {
+    return sp.begin() >= url.data() && sp.end() <= url.data() + url.size();
+  };
+  if (from) {
+    // The same URL, at another address
+    auto rebase = [&](folly::StringPiece& sp) {
+      if (!sp.empty() && viewsOf(sp, *from)) {
+        sp.reset(req.url_.data() + (sp.data() - from->data()), sp.size());
+      }
+    };
+    rebase(req.path_);
+    rebase(req.query_);
+    return;
+  }
+  // A moved heap buffer keeps its address
+  if ((req.path_.empty() || viewsOf(req.path_, req.url_)) &&
+      (req.query_.empty() || viewsOf(req.query_, req.url_))) {
+    return;
+  }
+  setURL(req.url_);
+}
+
 void HTTPMessage::setHTTPPriority(uint8_t urgency, bool incremental) {
   headers_.set(HTTP_HEADER_PRIORITY,
                httpPriorityToString(HTTPPriority(urgency, incremental)));
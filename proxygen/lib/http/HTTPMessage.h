@@ -14,6 +14,7 @@
 #include <folly/Optional.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/IOBufQueue.h>
+#include <folly/small_vector.h>
 #include <glog/logging.h>
 #include <map>
 #include <mutex>
@@ -153,11 +154,10 @@ class HTTPMessage {
     auto& req = request();
     req.clientAddress_ = addr;
     if (!ipStr.empty() && !portStr.empty()) {
-      req.clientIPPort_.emplace(std::move(ipStr), std::move(portStr));
+      req.clientIPPort_ =
+          std::make_unique<IPPort>(std::move(ipStr), std::move(portStr));
     } else {
-      if (req.clientIPPort_) {
-        req.clientIPPort_.reset();
-      }
+      req.clientIPPort_.reset();
     }
   }
 
@@ -169,7 +169,7 @@ class HTTPMessage {
     auto& req = request();
     if (!req.clientIPPort_ || req.clientIPPort_->ip.empty()) {
       if (req.clientAddress_.isInitialized()) {
-        req.clientIPPort_.emplace(
+        req.clientIPPort_ = std::make_unique<IPPort>(
             req.clientAddress_.getAddressStr(),
             folly::to<std::string>(req.clientAddress_.getPort()));
       } else {
@@ -183,7 +183,7 @@ class HTTPMessage {
     auto& req = request();
     if (!req.clientIPPort_ || req.clientIPPort_->port.empty()) {
       if (req.clientAddress_.isInitialized()) {
-        req.clientIPPort_.emplace(
+        req.clientIPPort_ = std::make_unique<IPPort>(
             req.clientAddress_.getAddressStr(),
             folly::to<std::string>(req.clientAddress_.getPort()));
       } else {
@@ -201,11 +201,10 @@ class HTTPMessage {
                      std::string portStr = empty_string) {
     dstAddress_ = addr;
     if (!addressStr.empty() && !portStr.empty()) {
-      dstIP_ = std::move(addressStr);
-      dstPort_ = std::move(portStr);
-    } else {
-      dstIP_.clear();
-      dstPort_.clear();
+      ext().dstIPPort =
+          std::make_unique<IPPort>(std::move(addressStr), std::move(portStr));
+    } else if (ext_) {
+      ext_->dstIPPort.reset();
     }
   }
 
@@ -213,18 +212,15 @@ class HTTPMessage {
     return dstAddress_;
   }
 
+  // Formatted on demand
   const std::string& getDstIP() const {
-    if (dstIP_.empty() && dstAddress_.isInitialized()) {
-      dstIP_ = dstAddress_.getAddressStr();
-    }
-    return dstIP_;
+    auto ipPort = getDstIPPort();
+    return ipPort ? ipPort->ip : empty_string;
   }
 
   const std::string& getDstPort() const {
-    if (dstPort_.empty() && dstAddress_.isInitialized()) {
-      dstPort_ = folly::to<std::string>(dstAddress_.getPort());
-    }
-    return dstPort_;
+    auto ipPort = getDstIPPort();
+    return ipPort ? ipPort->port : empty_string;
   }
 
   /**
@@ -232,10 +228,10 @@ class HTTPMessage {
    */
   template <typename T> // T = string
   void setLocalIp(T&& ip) {
-    localIP_ = std::forward<T>(ip);
+    ext().localIP = std::forward<T>(ip);
   }
   const std::string& getLocalIp() const {
-    return localIP_;
+    return ext_ ? ext_->localIP : empty_string;
   }
 
   /**
@@ -275,6 +271,21 @@ class HTTPMessage {
   ParseURL setURL(const char* url, bool strict = false) {
     return setURL(std::string(url), strict);
   }
+
+  // Where the path and query are in a URL, the query without its '?'
+  struct URLOffsets {
+    size_t pathStart{0};
+    size_t pathLength{0};
+    size_t queryStart{0};
+    size_t queryLength{0};
+  };
+
+  /**
+   * Sets a URL that the caller, typically a codec, has already validated
+   * and found the path and query of, without parsing it again. An empty
+   * path is set as "/", as with setURL.
+   */
+  void setURL(std::string url, const URLOffsets& offsets);
   const std::string& getURL() const {
     return request().url_;
   }
@@ -352,7 +363,10 @@ class HTTPMessage {
    * XXX: Note we only support X.Y format while setting version.
    */
   const std::string& getVersionString() const {
-    return versionStr_;
+    if (ext_ && !ext_->versionStr.empty()) {
+      return ext_->versionStr;
+    }
+    return getShortVersionString(version_.first, version_.second);
   }
   void setVersionString(const std::string& ver) {
     if (ver.size() != 3 || ver[1] != '.' || !isdigit(ver[0]) ||
@@ -450,9 +464,10 @@ class HTTPMessage {
   }
 
   /**
-   * Formats the current time appropriately for a Date header
+   * Formats the current time appropriately for a Date header. The string
+   * is cached per thread and changes every second.
    */
-  static std::string formatDateHeader();
+  static const std::string& formatDateHeader();
 
   /**
    * Ensures this HTTPMessage contains a host header, adding a default one
@@ -586,6 +601,39 @@ class HTTPMessage {
    */
   std::string getDecodedQueryParam(const std::string& name) const;
 
+  /**
+   * Name value pairs viewing the message, as parsed from the query string
+   * or the Cookie headers.
+   */
+  using NameValuePieces =
+      folly::small_vector<std::pair<folly::StringPiece, folly::StringPiece>,
+                          8>;
+
+  /**
+   * Get the query parameters as views of the URL, in order and with
+   * duplicates, still percent encoded.
+   *
+   * Parsed once, without the map of getQueryParams().  The views are only
+   * valid until the URL of this HTTPMessage changes.
+   */
+  const NameValuePieces& getQueryParamPieces() const;
+
+  /**
+   * Get the last value of the query parameter with the specified name as a
+   * view of the URL, still percent encoded, or none if there is no such
+   * parameter.
+   */
+  folly::Optional<folly::StringPiece> getQueryParamPiece(
+      folly::StringPiece name) const;
+
+  /**
+   * Percent decode a query parameter name or value, on demand.
+   *
+   * Returns none if it is not validly encoded.
+   */
+  static folly::Optional<std::string> decodeQueryParam(
+      folly::StringPiece encoded);
+
   /**
    * Get all the query parameters.
    *
@@ -629,6 +677,13 @@ class HTTPMessage {
    */
   const folly::StringPiece getCookie(const std::string& name) const;
 
+  /**
+   * Get all the cookies, in order and with duplicates.
+   *
+   * The views are only valid as long as the Cookie Headers are not changed.
+   */
+  const NameValuePieces& getCookies() const;
+
   /**
    * Print the message out.
    */
@@ -673,6 +728,18 @@ class HTTPMessage {
     return (scheme_ == Scheme::HTTPS || scheme_ == Scheme::MASQUE);
   }
 
+  /**
+   * A request the session received before the TLS or QUIC handshake
+   * completed, as 0-RTT early data.  It could be a replay.
+   */
+  void setEarlyData(bool earlyData) {
+    earlyData_ = earlyData;
+  }
+
+  bool isEarlyData() const {
+    return earlyData_;
+  }
+
   void setMasque() {
     scheme_ = Scheme::MASQUE;
   }
@@ -730,7 +797,7 @@ class HTTPMessage {
       return *protoStr_;
     }
 
-    return versionStr_;
+    return getVersionString();
   }
 
   /* Setter and getter for the SPDY priority value (0 - 7).  When serialized
@@ -915,10 +982,16 @@ class HTTPMessage {
 
   ParseURL setURLImplInternal(bool unparse, bool strict);
 
+  // After copying or moving request().url_ from another message, points
+  // path_ and query_ into it again, re-parsing the URL only when they
+  // viewed a small string moved away from
+  void rebaseURL(const std::string* from);
+
   bool setQueryStringImpl(const std::string& queryString,
                           bool unparse,
                           bool strict);
   void parseQueryParams() const;
+  void parseQueryParamPieces() const;
   void unparseQueryParams();
 
   bool doHeaderTokenCheck(const HTTPHeaders& headers_,
@@ -945,7 +1018,7 @@ class HTTPMessage {
   };
   struct Request {
     folly::SocketAddress clientAddress_;
-    mutable folly::Optional<IPPort> clientIPPort_;
+    mutable std::unique_ptr<IPPort> clientIPPort_;
     mutable boost::
         variant<boost::blank, std::unique_ptr<std::string>, HTTPMethod>
             method_;
@@ -960,7 +1033,9 @@ class HTTPMessage {
     Request() = default;
 
     Request(const Request& req)
-        : clientIPPort_(req.clientIPPort_),
+        : clientIPPort_(req.clientIPPort_
+                            ? std::make_unique<IPPort>(*req.clientIPPort_)
+                            : nullptr),
           path_(req.path_),
           query_(req.query_),
           pathStr_(nullptr),
@@ -983,11 +1058,44 @@ class HTTPMessage {
   };
 
   folly::SocketAddress dstAddress_;
-  mutable std::string dstIP_;
-  mutable std::string dstPort_;
 
-  std::string localIP_;
-  std::string versionStr_;
+  /**
+   * The fields most messages never set or read, allocated on first use so
+   * that the others stay small.
+   */
+  struct Extension {
+    Extension() = default;
+    // Without the views of the other message
+    Extension(const Extension& other)
+        : dstIPPort(other.dstIPPort
+                        ? std::make_unique<IPPort>(*other.dstIPPort)
+                        : nullptr),
+          localIP(other.localIP),
+          versionStr(other.versionStr) {
+    }
+
+    std::unique_ptr<IPPort> dstIPPort;
+    std::string localIP;
+    // Only for versions getShortVersionString() has no string for
+    std::string versionStr;
+    NameValuePieces cookies;
+    // Views of the URL
+    NameValuePieces queryParamPieces;
+  };
+
+  Extension& ext() const {
+    if (!ext_) {
+      ext_ = std::make_unique<Extension>();
+    }
+    return *ext_;
+  }
+
+  const IPPort* getDstIPPort() const;
+
+  // "X.Y" for single digit versions
+  static const std::string& getShortVersionString(uint8_t maj, uint8_t min);
+
+  mutable std::unique_ptr<Extension> ext_;
 
   enum class MessageType : uint8_t { NONE = 0, REQUEST = 1, RESPONSE = 2 };
   struct Fields {
@@ -1114,8 +1222,7 @@ class HTTPMessage {
    * These are mutable since we parse them lazily in getCookie() and
    * getQueryParam()
    */
-  mutable std::map<folly::StringPiece, folly::StringPiece> cookies_;
-  // TODO: use StringPiece for queryParams_ and delete splitNameValue()
+  // Built from the query param pieces for the accessors returning strings
   mutable std::map<std::string, std::string> queryParams_;
 
   HTTPHeaders headers_;
@@ -1135,10 +1242,12 @@ class HTTPMessage {
   std::pair<uint8_t, uint8_t> version_;
   mutable bool parsedCookies_ : 1;
   mutable bool parsedQueryParams_ : 1;
+  mutable bool parsedQueryParamPieces_ : 1;
   bool chunked_ : 1;
   bool upgraded_ : 1;
   bool wantsKeepalive_ : 1;
   bool trailersAllowed_ : 1;
+  bool earlyData_ : 1;
 
   Scheme scheme_{Scheme::HTTP};
 
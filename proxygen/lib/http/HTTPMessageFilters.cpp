@@ -10,6 +10,55 @@
 
 namespace proxygen {
 
+void HTTPMessageFilter::onBody(std::unique_ptr<folly::IOBuf> chain) noexcept {
+  if (!inPlace_ || !chain) {
+    bodyHandler_->onBody(std::move(chain));
+    return;
+  }
+  unshareBody(*chain);
+  auto filter = this;
+  while (true) {
+    filter->transformBody(*chain);
+    if (!filter->nextInPlace_) {
+      break;
+    }
+    filter = filter->nextInPlace_;
+  }
+  filter->bodyHandler_->onBody(std::move(chain));
+}
+
+void HTTPMessageFilter::unshareBody(folly::IOBuf& chain) {
+  auto buf = &chain;
+  do {
+    if (buf->isSharedOne()) {
+      buf->unshareOne();
+    }
+    buf = buf->next();
+  } while (buf != &chain);
+}
+
+void HTTPMessageFilter::updateBodyPath() noexcept {
+  inPlace_ = (getBodyMode() == BodyMode::IN_PLACE);
+  bodyHandler_ = nextTransactionHandler_;
+  nextInPlace_ = nullptr;
+  auto next = dynamic_cast<HTTPMessageFilter*>(nextTransactionHandler_);
+  if (next) {
+    auto mode = next->getBodyMode();
+    if (mode == BodyMode::HEADER_ONLY && next->bodyHandler_) {
+      bodyHandler_ = next->bodyHandler_;
+      nextInPlace_ = next->nextInPlace_;
+    } else if (mode == BodyMode::IN_PLACE) {
+      nextInPlace_ = next;
+    }
+  }
+  if (prev_.which() == 0) {
+    auto prev = boost::get<HTTPMessageFilter*>(prev_);
+    if (prev && prev->nextTransactionHandler_ == this) {
+      prev->updateBodyPath();
+    }
+  }
+}
+
 void HTTPMessageFilter::pause() noexcept {
   if (nextElementIsPaused_) {
     return;
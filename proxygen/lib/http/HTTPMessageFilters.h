@@ -22,8 +22,30 @@ class HTTPMessageFilter
     : public HTTPTransaction::Handler
     , public folly::DestructorCheck {
  public:
+  /**
+   * What a filter does with the body events: onBody, onChunkHeader and
+   * onChunkComplete.
+   *
+   * HEADER_ONLY filters never see them: the filter before forwards them
+   * straight to the next filter that handles the body, along a path computed
+   * as the chain is linked.  They must not override those callbacks, nor
+   * pause for the body.
+   *
+   * IN_PLACE filters only rewrite the bytes of each chunk, keeping its
+   * length, in transformBody(), and do not override onBody either.  The
+   * chunk is unshared once for a run of them, which then transform it one
+   * after the other from a single onBody.
+   */
+  enum class BodyMode { STREAM, HEADER_ONLY, IN_PLACE };
+
+  // Queried as the chain is linked, so it must not change afterwards
+  virtual BodyMode getBodyMode() const noexcept {
+    return BodyMode::STREAM;
+  }
+
   void setNextTransactionHandler(HTTPTransaction::Handler* next) {
     nextTransactionHandler_ = CHECK_NOTNULL(next);
+    updateBodyPath();
   }
   virtual void setPrevFilter(HTTPMessageFilter* prev) noexcept {
     if (prev_.which() == 0 && boost::get<HTTPMessageFilter*>(prev_) != prev &&
@@ -31,6 +53,9 @@ class HTTPMessageFilter
       prev->pause();
     }
     prev_ = CHECK_NOTNULL(prev);
+    if (prev->nextTransactionHandler_ == this) {
+      prev->updateBodyPath();
+    }
   }
   virtual void setPrevSink(HTTPSink* prev) noexcept {
     if (prev_.which() == 1 && boost::get<HTTPSink*>(prev_) != prev && prev &&
@@ -58,14 +83,12 @@ class HTTPMessageFilter
   void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
     nextTransactionHandler_->onHeadersComplete(std::move(msg));
   }
-  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
-    nextTransactionHandler_->onBody(std::move(chain));
-  }
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
   void onChunkHeader(size_t length) noexcept override {
-    nextTransactionHandler_->onChunkHeader(length);
+    bodyHandler_->onChunkHeader(length);
   }
   void onChunkComplete() noexcept override {
-    nextTransactionHandler_->onChunkComplete();
+    bodyHandler_->onChunkComplete();
   }
   void onTrailers(std::unique_ptr<HTTPHeaders> trailers) noexcept override {
     nextTransactionHandler_->onTrailers(std::move(trailers));
@@ -136,14 +159,22 @@ class HTTPMessageFilter
     nextTransactionHandler_->onHeadersComplete(std::move(msg));
   }
   virtual void nextOnBody(std::unique_ptr<folly::IOBuf> chain) {
-    nextTransactionHandler_->onBody(std::move(chain));
+    bodyHandler_->onBody(std::move(chain));
   }
   virtual void nextOnChunkHeader(size_t length) {
-    nextTransactionHandler_->onChunkHeader(length);
+    bodyHandler_->onChunkHeader(length);
   }
   virtual void nextOnChunkComplete() {
-    nextTransactionHandler_->onChunkComplete();
+    bodyHandler_->onChunkComplete();
+  }
+
+  // Rewrites the bytes of a writable chunk, for IN_PLACE filters
+  virtual void transformBody(folly::IOBuf& /*chain*/) noexcept {
   }
+
+  // Copies the elements of chain others share, so it can be written in place
+  static void unshareBody(folly::IOBuf& chain);
+
   virtual void nextOnTrailers(std::unique_ptr<HTTPHeaders> trailers) {
     nextTransactionHandler_->onTrailers(std::move(trailers));
   }
@@ -154,11 +185,21 @@ class HTTPMessageFilter
     nextTransactionHandler_->onError(ex);
   }
   HTTPTransaction::Handler* nextTransactionHandler_{nullptr};
+  // The next handler that handles the body, past HEADER_ONLY filters
+  HTTPTransaction::Handler* bodyHandler_{nullptr};
+  // The next IN_PLACE filter on the body path, transformed in the same call
+  HTTPMessageFilter* nextInPlace_{nullptr};
 
   boost::variant<HTTPMessageFilter*, HTTPSink*> prev_ =
       static_cast<HTTPSink*>(nullptr);
 
   bool nextElementIsPaused_{false};
+
+ private:
+  // Refreshes the body path, and the one of the filter before
+  void updateBodyPath() noexcept;
+
+  bool inPlace_{false};
 };
 
 } // namespace proxygen
@@ -59,6 +59,20 @@ const std::string& methodToString(HTTPMethod method) {
   return getMethodStrings()[static_cast<unsigned>(method)];
 }
 
+bool isIdempotent(HTTPMethod method) {
+  switch (method) {
+    case HTTPMethod::GET:
+    case HTTPMethod::HEAD:
+    case HTTPMethod::OPTIONS:
+    case HTTPMethod::TRACE:
+    case HTTPMethod::PUT:
+    case HTTPMethod::DELETE:
+      return true;
+    default:
+      return false;
+  }
+}
+
 std::ostream& operator<<(std::ostream& out, HTTPMethod method) {
   out << methodToString(method);
   return out;
@@ -59,6 +59,12 @@ extern folly::Optional<HTTPMethod> stringToMethod(folly::StringPiece method);
  */
 extern const std::string& methodToString(HTTPMethod method);
 
+/**
+ * Whether repeating a request with the method has the effect of making it
+ * once (RFC 9110 9.2.2), so that 0-RTT replays of it are harmless.
+ */
+extern bool isIdempotent(HTTPMethod method);
+
 std::ostream& operator<<(std::ostream& os, HTTPMethod method);
 
 } // namespace proxygen
@@ -8,32 +8,10 @@
 
 #include <proxygen/lib/http/HTTPPriorityFunctions.h>
 
-#include <proxygen/lib/http/structuredheaders/StructuredHeadersDecoder.h>
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersViewDecoder.h>
 
 namespace proxygen {
 
-namespace {
-template <class T>
-T getWithDefault(StructuredHeaders::Dictionary& dict,
-                 const std::string& key,
-                 T value,
-                 bool& missing,
-                 bool& malformed) {
-  auto it = dict.find(key);
-  if (it == dict.end()) {
-    missing = true;
-    return value;
-  }
-
-  try {
-    return it->second.get<T>();
-  } catch (const boost::bad_get&) {
-    malformed = true;
-    return value;
-  }
-}
-} // namespace
-
 folly::Optional<HTTPPriority> httpPriorityFromHTTPMessage(
     const HTTPMessage& message) {
   return httpPriorityFromString(
@@ -52,22 +30,39 @@ folly::Optional<HTTPPriority> httpPriorityFromString(
           << "Received ill-formated priority header=" << priority;
     }
   };
-  StructuredHeadersDecoder decoder(priority);
-  StructuredHeaders::Dictionary dict;
-  auto ret = decoder.decodeDictionary(dict);
+  // Parsed on every request, so without building a Dictionary
+  bool uMissing = true;
+  bool iMissing = true;
+  bool oMissing = true;
+  bool malformed = false;
+  int64_t urgency = kDefaultHttpPriorityUrgency;
+  bool incremental = false;
+  int64_t orderId = 0;
+  using StructuredHeaders::ItemView;
+  using StructuredHeaders::MemberView;
+  StructuredHeadersViewDecoder decoder(priority);
+  auto ret = decoder.visitDictionary([&](folly::StringPiece key,
+                                         const MemberView& member) {
+    const auto& item = member.item;
+    if (key == "u") {
+      uMissing = false;
+      malformed |= member.isInnerList || item.tag != ItemView::Type::INT64;
+      urgency = item.integer;
+    } else if (key == "i") {
+      iMissing = false;
+      malformed |= member.isInnerList || item.tag != ItemView::Type::BOOLEAN;
+      incremental = item.boolean;
+    } else if (key == "o") {
+      oMissing = false;
+      malformed |= member.isInnerList || item.tag != ItemView::Type::INT64;
+      orderId = item.integer;
+    }
+  });
   if (ret != StructuredHeaders::DecodeError::OK) {
     logBadHeader = true;
     return folly::none;
   }
 
-  bool uMissing = false;
-  bool iMissing = false;
-  bool oMissing = false;
-  bool malformed = false;
-  int64_t urgency = getWithDefault<int64_t>(
-      dict, "u", (int64_t)kDefaultHttpPriorityUrgency, uMissing, malformed);
-  bool incremental = getWithDefault(dict, "i", false, iMissing, malformed);
-  auto orderId = getWithDefault<int64_t>(dict, "o", 0, oMissing, malformed);
   if ((urgency > kMaxPriority || urgency < kMinPriority) || (orderId < 0) ||
       (uMissing && iMissing && oMissing) || malformed) {
     logBadHeader = true;
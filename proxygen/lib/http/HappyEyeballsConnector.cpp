@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/HappyEyeballsConnector.h>
+
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+
+namespace proxygen {
+
+/**
+ * One TCP connection attempt. Failed attempts are kept until the race is
+ * over, since their connector is still on the stack when it reports the
+ * failure.
+ */
+class HappyEyeballsConnector::Attempt : public HTTPConnector::Callback {
+ public:
+  Attempt(HappyEyeballsConnector& parent, const WheelTimerInstance& timeout)
+      : parent_(parent), connector_(this, timeout) {
+  }
+
+  HTTPConnector& getConnector() {
+    return connector_;
+  }
+
+  void connectSuccess(HTTPUpstreamSession* session) override {
+    parent_.onAttemptSuccess(session);
+  }
+
+  void connectError(const folly::AsyncSocketException& ex) override {
+    parent_.onAttemptError(
+        folly::make_exception_wrapper<folly::AsyncSocketException>(ex),
+        /*startNext=*/true);
+  }
+
+ private:
+  HappyEyeballsConnector& parent_;
+  HTTPConnector connector_;
+};
+
+class HappyEyeballsConnector::QuicAttempt : public HQConnector::Callback {
+ public:
+  QuicAttempt(HappyEyeballsConnector& parent,
+              std::chrono::milliseconds transactionTimeout)
+      : parent_(parent), connector_(this, transactionTimeout) {
+  }
+
+  HQConnector& getConnector() {
+    return connector_;
+  }
+
+  void connectSuccess(HQUpstreamSession* session) override {
+    parent_.onAttemptSuccess(session);
+  }
+
+  void connectError(const quic::QuicErrorCode& code) override {
+    // Doesn't hasten the TCP attempts, which may still be needed for a
+    // server not reachable over UDP
+    parent_.onAttemptError(
+        folly::make_exception_wrapper<std::runtime_error>(
+            quic::toString(code)),
+        /*startNext=*/false);
+  }
+
+ private:
+  HappyEyeballsConnector& parent_;
+  HQConnector connector_;
+};
+
+HappyEyeballsConnector::HappyEyeballsConnector(
+    Callback* callback, const WheelTimerInstance& timeout)
+    : cb_(CHECK_NOTNULL(callback)), timeout_(timeout) {
+}
+
+HappyEyeballsConnector::~HappyEyeballsConnector() {
+  reset();
+}
+
+void HappyEyeballsConnector::reset() {
+  cancelTimeout();
+  // Destroying the connectors cancels their attempts without callbacks
+  attempts_.clear();
+  quicAttempt_.reset();
+  numPending_ = 0;
+}
+
+std::vector<folly::SocketAddress>
+HappyEyeballsConnector::interleaveAddressFamilies(
+    const std::vector<folly::SocketAddress>& addrs) {
+  if (addrs.empty()) {
+    return {};
+  }
+  auto firstFamily = addrs.front().getFamily();
+  std::vector<folly::SocketAddress> first;
+  std::vector<folly::SocketAddress> other;
+  for (const auto& addr : addrs) {
+    (addr.getFamily() == firstFamily ? first : other).push_back(addr);
+  }
+  std::vector<folly::SocketAddress> result;
+  result.reserve(addrs.size());
+  for (size_t i = 0; i < first.size() || i < other.size(); ++i) {
+    if (i < first.size()) {
+      result.push_back(first[i]);
+    }
+    if (i < other.size()) {
+      result.push_back(other[i]);
+    }
+  }
+  return result;
+}
+
+void HappyEyeballsConnector::connect(folly::EventBase* eventBase,
+                                     std::vector<folly::SocketAddress> addrs,
+                                     Params params) {
+  DCHECK(!isBusy());
+  eventBase_ = eventBase;
+  params_ = std::move(params);
+  addrs_ = interleaveAddressFamilies(addrs);
+  nextAddr_ = 0;
+  numPending_ = 0;
+  if (addrs_.empty()) {
+    cb_->connectError(folly::make_exception_wrapper<std::runtime_error>(
+        "No address to connect to"));
+    return;
+  }
+
+  if (params_.quicFizzContext) {
+    quicAttempt_ =
+        std::make_unique<QuicAttempt>(*this, timeout_.getDefaultTimeout());
+    auto& hqConnector = quicAttempt_->getConnector();
+    hqConnector.setTransportSettings(params_.quicTransportSettings);
+    folly::Optional<std::string> sni;
+    if (!params_.serverName.empty()) {
+      sni = params_.serverName;
+    }
+    numPending_++;
+    hqConnector.connect(eventBase_,
+                        folly::none,
+                        addrs_.front(),
+                        params_.quicFizzContext,
+                        params_.quicVerifier,
+                        params_.connectTimeout,
+                        params_.socketOptions,
+                        std::move(sni));
+  }
+  startNextAttempt();
+}
+
+void HappyEyeballsConnector::timeoutExpired() noexcept {
+  startNextAttempt();
+}
+
+void HappyEyeballsConnector::startNextAttempt() {
+  cancelTimeout();
+  if (nextAddr_ >= addrs_.size()) {
+    return;
+  }
+  const auto& addr = addrs_[nextAddr_++];
+  // Schedule before connecting, which may fail synchronously and move on
+  // to the next address right away
+  if (nextAddr_ < addrs_.size()) {
+    eventBase_->timer().scheduleTimeout(this, params_.attemptDelay);
+  }
+  VLOG(4) << "Connection attempt " << nextAddr_ << " to " << addr;
+
+  attempts_.push_back(std::make_unique<Attempt>(*this, timeout_));
+  auto& connector = attempts_.back()->getConnector();
+  numPending_++;
+  if (params_.sslContext) {
+    connector.connectSSL(eventBase_,
+                         addr,
+                         params_.sslContext,
+                         params_.sslSession,
+                         params_.connectTimeout,
+                         params_.socketOptions,
+                         folly::AsyncSocket::anyAddress(),
+                         params_.serverName);
+  } else {
+    if (!params_.plaintextProtocol.empty()) {
+      connector.setPlaintextProtocol(params_.plaintextProtocol);
+    }
+    connector.connect(
+        eventBase_, addr, params_.connectTimeout, params_.socketOptions);
+  }
+}
+
+void HappyEyeballsConnector::onAttemptSuccess(HTTPSessionBase* session) {
+  finishRace();
+  cb_->connectSuccess(session);
+}
+
+void HappyEyeballsConnector::onAttemptError(folly::exception_wrapper error,
+                                            bool startNext) {
+  DCHECK_GT(numPending_, 0);
+  numPending_--;
+  if (startNext && nextAddr_ < addrs_.size()) {
+    startNextAttempt();
+    return;
+  }
+  if (numPending_ > 0 || nextAddr_ < addrs_.size()) {
+    return;
+  }
+  finishRace();
+  cb_->connectError(error);
+}
+
+void HappyEyeballsConnector::finishRace() {
+  cancelTimeout();
+  numPending_ = 0;
+  // Cancels the losers. The connector that reported the result is still on
+  // the stack, so the attempts are destroyed from the loop.
+  for (auto& attempt : attempts_) {
+    attempt->getConnector().reset();
+  }
+  if (quicAttempt_) {
+    quicAttempt_->getConnector().reset();
+  }
+  eventBase_->runInLoop(
+      [attempts = std::move(attempts_),
+       quicAttempt = std::move(quicAttempt_)]() mutable {
+        attempts.clear();
+        quicAttempt.reset();
+      });
+  attempts_.clear();
+}
+
+} // namespace proxygen
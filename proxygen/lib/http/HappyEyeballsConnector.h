@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/http/HQConnector.h>
+#include <proxygen/lib/http/HTTPConnector.h>
+
+namespace proxygen {
+
+/**
+ * This class races connections to the addresses of one server, as in
+ * Happy Eyeballs v2 (RFC 8305), so that an unreachable address or address
+ * family costs one attempt delay rather than a whole connect timeout.
+ *
+ * The addresses are tried in order, alternating address families, starting
+ * a new attempt every attempt delay or as soon as the previous one fails.
+ * The first connection to be established wins and the others are canceled.
+ * Optionally a QUIC connection to the first address races the TCP ones.
+ *
+ * Like HTTPConnector it can be reused, but only sets up one connection at
+ * a time.
+ */
+class HappyEyeballsConnector : private folly::HHWheelTimer::Callback {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() {
+    }
+    // session is an HTTPUpstreamSession, or an HQUpstreamSession if the
+    // QUIC attempt won
+    virtual void connectSuccess(HTTPSessionBase* session) = 0;
+    // Every attempt failed, error is the one of the last attempt
+    virtual void connectError(const folly::exception_wrapper& error) = 0;
+  };
+
+  struct Params {
+    // RFC 8305 Connection Attempt Delay
+    std::chrono::milliseconds attemptDelay{std::chrono::milliseconds(250)};
+    // Timeout of every attempt, zero for none
+    std::chrono::milliseconds connectTimeout{std::chrono::milliseconds(0)};
+    folly::SocketOptionMap socketOptions;
+    // Connects with TLS when set
+    std::shared_ptr<folly::SSLContext> sslContext;
+    std::shared_ptr<folly::ssl::SSLSession> sslSession;
+    std::string serverName;
+    // Protocol of plaintext connections
+    std::string plaintextProtocol;
+    // Races a QUIC connection when set, for servers known to support HTTP/3
+    std::shared_ptr<const fizz::client::FizzClientContext> quicFizzContext;
+    std::shared_ptr<const fizz::CertificateVerifier> quicVerifier;
+    quic::TransportSettings quicTransportSettings;
+  };
+
+  /**
+   * @param callback Must outlive this connector and must not be null.
+   * @param timeout The timeout set for the transactions of the sessions.
+   */
+  HappyEyeballsConnector(Callback* callback, const WheelTimerInstance& timeout);
+
+  /**
+   * Clients may delete the connector at any time to cancel it. No
+   * callbacks will be received.
+   */
+  ~HappyEyeballsConnector() override;
+
+  /**
+   * Cancels every attempt in flight without invoking any callback.
+   */
+  void reset();
+
+  /**
+   * Begin racing connections to addrs, which should be sorted by preference
+   * as DNSResolver answers are by rfc6724_sort(). May invoke the callback
+   * before returning.
+   */
+  void connect(folly::EventBase* eventBase,
+               std::vector<folly::SocketAddress> addrs,
+               Params params);
+
+  bool isBusy() const {
+    return !attempts_.empty() || quicAttempt_ != nullptr;
+  }
+
+  // Number of TCP attempts started by the last connect()
+  size_t getNumAttempts() const {
+    return nextAddr_;
+  }
+
+  /**
+   * Reorders addrs so that address families alternate, keeping the order
+   * within each family and starting with the family of the first address.
+   */
+  static std::vector<folly::SocketAddress> interleaveAddressFamilies(
+      const std::vector<folly::SocketAddress>& addrs);
+
+ private:
+  class Attempt;
+  class QuicAttempt;
+
+  // HHWheelTimer::Callback, the attempt delay expired
+  void timeoutExpired() noexcept override;
+
+  void startNextAttempt();
+  void onAttemptSuccess(HTTPSessionBase* session);
+  // Cancels the remaining attempts before reporting the result
+  void finishRace();
+  // startNext starts the next TCP attempt without waiting for the delay
+  void onAttemptError(folly::exception_wrapper error, bool startNext);
+
+  Callback* cb_;
+  WheelTimerInstance timeout_;
+  folly::EventBase* eventBase_{nullptr};
+  Params params_;
+  std::vector<folly::SocketAddress> addrs_;
+  size_t nextAddr_{0};
+  size_t numPending_{0};
+  std::vector<std::unique_ptr<Attempt>> attempts_;
+  std::unique_ptr<QuicAttempt> quicAttempt_;
+};
+
+} // namespace proxygen
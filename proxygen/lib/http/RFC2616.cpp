@@ -8,8 +8,10 @@
 
 #include <proxygen/lib/http/RFC2616.h>
 
+#include <algorithm>
 #include <stdlib.h>
 
+#include <folly/Conv.h>
 #include <folly/String.h>
 #include <folly/ThreadLocal.h>
 #include <proxygen/lib/http/HTTPHeaders.h>
@@ -164,6 +166,132 @@ bool parseByteRangeSpec(folly::StringPiece value,
   return true;
 }
 
+namespace {
+
+// One range-spec of a "bytes" Range header
+RangeRequestResult parseRangeSpec(folly::StringPiece spec,
+                                  uint64_t instanceLength,
+                                  uint64_t& outFirstByte,
+                                  uint64_t& outLastByte) {
+  auto dash = spec.find('-');
+  if (dash == std::string::npos) {
+    return RangeRequestResult::INVALID;
+  }
+  auto firstStr = folly::trimWhitespace(spec.subpiece(0, dash));
+  auto lastStr = folly::trimWhitespace(spec.subpiece(dash + 1));
+
+  if (firstStr.empty()) {
+    // suffix-range: the final N bytes
+    auto suffix = folly::tryTo<uint64_t>(lastStr);
+    if (!suffix) {
+      return RangeRequestResult::INVALID;
+    }
+    if (*suffix == 0 || instanceLength == 0) {
+      return RangeRequestResult::UNSATISFIABLE;
+    }
+    outFirstByte = instanceLength - std::min(*suffix, instanceLength);
+    outLastByte = instanceLength - 1;
+    return RangeRequestResult::SATISFIABLE;
+  }
+
+  auto firstByte = folly::tryTo<uint64_t>(firstStr);
+  if (!firstByte) {
+    return RangeRequestResult::INVALID;
+  }
+  uint64_t lastByte = std::numeric_limits<uint64_t>::max();
+  if (!lastStr.empty()) {
+    auto parsedLast = folly::tryTo<uint64_t>(lastStr);
+    if (!parsedLast || *parsedLast < *firstByte) {
+      return RangeRequestResult::INVALID;
+    }
+    lastByte = *parsedLast;
+  }
+  if (*firstByte >= instanceLength) {
+    return RangeRequestResult::UNSATISFIABLE;
+  }
+  outFirstByte = *firstByte;
+  outLastByte = std::min(lastByte, instanceLength - 1);
+  return RangeRequestResult::SATISFIABLE;
+}
+
+// Strips the "bytes=" unit, false if it is another
+bool consumeBytesUnit(folly::StringPiece& value) {
+  value = folly::trimWhitespace(value);
+  folly::StringPiece unit("bytes=");
+  if (value.size() < unit.size() ||
+      !equalsIgnoreCase(value.subpiece(0, unit.size()), unit)) {
+    return false;
+  }
+  value.advance(unit.size());
+  return true;
+}
+
+} // namespace
+
+RangeRequestResult parseRangeRequest(folly::StringPiece value,
+                                     uint64_t instanceLength,
+                                     uint64_t& outFirstByte,
+                                     uint64_t& outLastByte) {
+  if (!consumeBytesUnit(value) || value.find(',') != std::string::npos) {
+    return RangeRequestResult::INVALID;
+  }
+  return parseRangeSpec(value, instanceLength, outFirstByte, outLastByte);
+}
+
+RangeRequestResult parseRangesRequest(folly::StringPiece value,
+                                      uint64_t instanceLength,
+                                      size_t maxRanges,
+                                      ByteRanges& outRanges) {
+  outRanges.clear();
+  if (!consumeBytesUnit(value)) {
+    return RangeRequestResult::INVALID;
+  }
+  std::vector<folly::StringPiece> specs;
+  folly::split(',', value, specs);
+  bool any = false;
+  for (auto spec : specs) {
+    spec = folly::trimWhitespace(spec);
+    if (spec.empty()) {
+      // The list syntax allows empty elements
+      continue;
+    }
+    any = true;
+    uint64_t first = 0;
+    uint64_t last = 0;
+    auto result = parseRangeSpec(spec, instanceLength, first, last);
+    if (result == RangeRequestResult::INVALID) {
+      outRanges.clear();
+      return result;
+    }
+    if (result == RangeRequestResult::SATISFIABLE) {
+      outRanges.emplace_back(first, last);
+    }
+  }
+  if (outRanges.empty()) {
+    return any ? RangeRequestResult::UNSATISFIABLE
+               : RangeRequestResult::INVALID;
+  }
+
+  // Overlapping and adjacent ranges are coalesced, so that a request can't
+  // make the response larger than the representation
+  std::sort(outRanges.begin(), outRanges.end());
+  size_t merged = 0;
+  for (size_t i = 1; i < outRanges.size(); i++) {
+    if (outRanges[i].first <= outRanges[merged].second + 1) {
+      outRanges[merged].second =
+          std::max(outRanges[merged].second, outRanges[i].second);
+    } else {
+      outRanges[++merged] = outRanges[i];
+    }
+  }
+  outRanges.resize(merged + 1);
+  if (outRanges.size() > maxRanges) {
+    outRanges.clear();
+    return RangeRequestResult::INVALID;
+  }
+  return RangeRequestResult::SATISFIABLE;
+}
+
 folly::Try<EncodingList> parseEncoding(const folly::StringPiece header) {
   EncodingList result;
   std::vector<folly::StringPiece> topLevelTokens;
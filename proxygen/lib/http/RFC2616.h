@@ -19,6 +19,7 @@
 #include <folly/Try.h>
 #include <proxygen/lib/http/HTTPMethod.h>
 #include <string>
+#include <utility>
 
 namespace proxygen {
 
@@ -131,5 +132,44 @@ bool parseByteRangeSpec(folly::StringPiece value,
                         unsigned long& lastByte,
                         unsigned long& instanceLength);
 
+/**
+ * Result of parsing a "Range" request header, see RFC 9110 section 14.2.
+ */
+enum class RangeRequestResult {
+  // Not a single "bytes" range this parser understands.  The header should
+  // be ignored and the full representation sent.
+  INVALID,
+  // outFirstByte and outLastByte hold the range to send (206)
+  SATISFIABLE,
+  // The range starts past the end of the representation (416)
+  UNSATISFIABLE,
+};
+
+/**
+ * Parse a "Range: bytes=A-B", "bytes=A-" or "bytes=-N" request header value
+ * against a representation of instanceLength bytes.  On SATISFIABLE the last
+ * byte is clamped to the end of the representation.  Multiple ranges are not
+ * supported and are reported as INVALID.
+ */
+RangeRequestResult parseRangeRequest(folly::StringPiece value,
+                                     uint64_t instanceLength,
+                                     uint64_t& outFirstByte,
+                                     uint64_t& outLastByte);
+
+// Inclusive first and last bytes
+using ByteRanges = std::vector<std::pair<uint64_t, uint64_t>>;
+
+/**
+ * Parse a "Range: bytes=" header value of one or more ranges against a
+ * representation of instanceLength bytes.  On SATISFIABLE outRanges holds the
+ * satisfiable ranges, sorted and with the overlapping or adjacent ones
+ * coalesced.  Unsatisfiable ranges are dropped, UNSATISFIABLE if none is
+ * left.  More than maxRanges ranges are reported as INVALID.
+ */
+RangeRequestResult parseRangesRequest(folly::StringPiece value,
+                                      uint64_t instanceLength,
+                                      size_t maxRanges,
+                                      ByteRanges& outRanges);
+
 } // namespace RFC2616
 } // namespace proxygen
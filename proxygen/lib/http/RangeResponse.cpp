@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/RangeResponse.h>
+
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/io/IOBufQueue.h>
+#include <glog/logging.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+namespace proxygen {
+
+constexpr size_t RangeResponse::kMaxRanges;
+
+RangeResponse::RangeResponse(const HTTPHeaders& request,
+                             const Representation& representation,
+                             size_t maxRanges)
+    : size_(representation.size),
+      contentType_(representation.contentType.str()) {
+  const auto& range = request.getSingleOrEmpty(HTTP_HEADER_RANGE);
+  if (!range.empty() && ifRangeMatches(request.getSingleOrEmpty("If-Range"),
+                                       representation.etag,
+                                       representation.lastModified)) {
+    switch (RFC2616::parseRangesRequest(range, size_, maxRanges, ranges_)) {
+      case RFC2616::RangeRequestResult::SATISFIABLE:
+        status_ = ranges_.size() > 1 ? Status::MULTIPART : Status::PARTIAL;
+        break;
+      case RFC2616::RangeRequestResult::UNSATISFIABLE:
+        status_ = Status::UNSATISFIABLE;
+        return;
+      case RFC2616::RangeRequestResult::INVALID:
+        break;
+    }
+  }
+  if (status_ == Status::FULL) {
+    ranges_.clear();
+    if (size_ > 0) {
+      ranges_.emplace_back(0, size_ - 1);
+    }
+  }
+
+  for (const auto& r : ranges_) {
+    contentLength_ += r.second - r.first + 1;
+  }
+  if (status_ == Status::MULTIPART) {
+    auto random = folly::Random::rand64();
+    boundary_ = folly::hexlify(folly::ByteRange(
+        reinterpret_cast<const uint8_t*>(&random), sizeof(random)));
+    for (const auto& r : ranges_) {
+      contentLength_ += getPartHeader(r).size();
+    }
+    contentLength_ += getCloseDelimiter().size();
+  }
+  remaining_ = contentLength_;
+}
+
+bool RangeResponse::ifRangeMatches(folly::StringPiece ifRange,
+                                   folly::StringPiece etag,
+                                   folly::StringPiece lastModified) {
+  ifRange = folly::trimWhitespace(ifRange);
+  if (ifRange.empty()) {
+    return true;
+  }
+  if (ifRange.startsWith('"') || ifRange.startsWith("W/")) {
+    // Weak ETags never match
+    return !etag.empty() && !etag.startsWith("W/") && ifRange == etag;
+  }
+  return !lastModified.empty() && ifRange == lastModified;
+}
+
+std::string RangeResponse::getPartHeader(
+    const std::pair<uint64_t, uint64_t>& range) const {
+  // The CRLF before the first delimiter is a harmless empty preamble
+  return folly::to<std::string>(
+      "\r\n--",
+      boundary_,
+      contentType_.empty() ? "" : "\r\nContent-Type: ",
+      contentType_,
+      "\r\nContent-Range: bytes ",
+      range.first,
+      "-",
+      range.second,
+      "/",
+      size_,
+      "\r\n\r\n");
+}
+
+std::string RangeResponse::getCloseDelimiter() const {
+  return folly::to<std::string>("\r\n--", boundary_, "--\r\n");
+}
+
+void RangeResponse::setHeaders(HTTPMessage& response) const {
+  auto& headers = response.getHeaders();
+  headers.set(HTTP_HEADER_ACCEPT_RANGES, "bytes");
+  switch (status_) {
+    case Status::FULL:
+      response.setStatusCode(200);
+      response.setStatusMessage("OK");
+      break;
+    case Status::PARTIAL:
+      response.setStatusCode(206);
+      response.setStatusMessage("Partial Content");
+      headers.set(HTTP_HEADER_CONTENT_RANGE,
+                  folly::to<std::string>("bytes ",
+                                         ranges_[0].first,
+                                         "-",
+                                         ranges_[0].second,
+                                         "/",
+                                         size_));
+      break;
+    case Status::MULTIPART:
+      response.setStatusCode(206);
+      response.setStatusMessage("Partial Content");
+      headers.set(
+          HTTP_HEADER_CONTENT_TYPE,
+          folly::to<std::string>("multipart/byteranges; boundary=", boundary_));
+      break;
+    case Status::UNSATISFIABLE:
+      response.setStatusCode(416);
+      response.setStatusMessage("Range Not Satisfiable");
+      headers.set(HTTP_HEADER_CONTENT_RANGE,
+                  folly::to<std::string>("bytes */", size_));
+      break;
+  }
+  if (status_ != Status::MULTIPART && !contentType_.empty()) {
+    headers.set(HTTP_HEADER_CONTENT_TYPE, contentType_);
+  }
+  headers.set(HTTP_HEADER_CONTENT_LENGTH,
+              folly::to<std::string>(contentLength_));
+}
+
+std::unique_ptr<folly::IOBuf> RangeResponse::next(Reader& reader) {
+  if (part_ >= ranges_.size()) {
+    return nullptr;
+  }
+  const auto& range = ranges_[part_];
+  bool multipart = (status_ == Status::MULTIPART);
+  folly::IOBufQueue body{folly::IOBufQueue::cacheChainLength()};
+  if (multipart && sent_ == 0) {
+    body.append(folly::IOBuf::copyBuffer(getPartHeader(range)));
+  }
+  uint64_t offset = range.first + sent_;
+  uint64_t length = range.second - offset + 1;
+  auto data = reader(offset, length);
+  auto read = data ? data->computeChainDataLength() : 0;
+  CHECK(read > 0 && read <= length)
+      << "Reader returned " << read << " of " << length << " bytes";
+  body.append(std::move(data));
+  sent_ += read;
+  if (offset + read > range.second) {
+    part_++;
+    sent_ = 0;
+    if (multipart && part_ == ranges_.size()) {
+      body.append(folly::IOBuf::copyBuffer(getCloseDelimiter()));
+    }
+  }
+  remaining_ -= body.chainLength();
+  return body.move();
+}
+
+} // namespace proxygen
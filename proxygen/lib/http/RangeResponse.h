@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Function.h>
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <proxygen/lib/http/RFC2616.h>
+#include <string>
+
+namespace proxygen {
+
+class HTTPHeaders;
+class HTTPMessage;
+
+/**
+ * Answers the Range and If-Range headers of a GET for a representation of
+ * known size, see RFC 9110 section 14.  It picks the status, sets the
+ * response headers, and produces the body, one range or a
+ * multipart/byteranges of several, from slices a Reader returns: the body is
+ * never materialized, so the data can be zero copy views of a cached or
+ * memory mapped file.
+ */
+class RangeResponse {
+ public:
+  // More ranges than this, after coalescing, get the full representation
+  static constexpr size_t kMaxRanges = 16;
+
+  enum class Status {
+    // 200 with the whole representation
+    FULL,
+    // 206 with one range
+    PARTIAL,
+    // 206 with a multipart/byteranges of several ranges
+    MULTIPART,
+    // 416, no body
+    UNSATISFIABLE,
+  };
+
+  struct Representation {
+    uint64_t size{0};
+    // Of each part of a multipart body and of the other responses
+    folly::StringPiece contentType;
+    // Validators If-Range is compared with, if any
+    folly::StringPiece etag;
+    folly::StringPiece lastModified;
+  };
+
+  /**
+   * Returns between 1 and length bytes of the representation at offset,
+   * length being the rest of the range being sent: the Reader picks the
+   * chunk size.
+   */
+  using Reader = folly::Function<std::unique_ptr<folly::IOBuf>(
+      uint64_t offset, uint64_t length)>;
+
+  RangeResponse(const HTTPHeaders& request,
+                const Representation& representation,
+                size_t maxRanges = kMaxRanges);
+
+  Status getStatus() const {
+    return status_;
+  }
+
+  const RFC2616::ByteRanges& getRanges() const {
+    return ranges_;
+  }
+
+  const std::string& getBoundary() const {
+    return boundary_;
+  }
+
+  uint64_t getContentLength() const {
+    return contentLength_;
+  }
+
+  /**
+   * Sets the status, Accept-Ranges, Content-Length, and Content-Range or
+   * Content-Type headers of response.
+   */
+  void setHeaders(HTTPMessage& response) const;
+
+  // Bytes of the body not yet returned by next()
+  uint64_t remaining() const {
+    return remaining_;
+  }
+
+  /**
+   * Returns the next chunk of the body, a Reader chunk along with any
+   * multipart delimiters around it, nullptr once it is all returned.
+   */
+  std::unique_ptr<folly::IOBuf> next(Reader& reader);
+
+  /**
+   * Whether the If-Range value ifRange, if any, matches the current
+   * validators: a strong ETag, or the exact Last-Modified date.
+   */
+  static bool ifRangeMatches(folly::StringPiece ifRange,
+                             folly::StringPiece etag,
+                             folly::StringPiece lastModified);
+
+ private:
+  std::string getPartHeader(const std::pair<uint64_t, uint64_t>& range) const;
+  std::string getCloseDelimiter() const;
+
+  Status status_{Status::FULL};
+  uint64_t size_;
+  std::string contentType_;
+  // Of the body, the whole representation when FULL
+  RFC2616::ByteRanges ranges_;
+  std::string boundary_;
+  uint64_t contentLength_{0};
+  uint64_t remaining_{0};
+  // Range next() returns, and bytes already returned of it
+  size_t part_{0};
+  uint64_t sent_{0};
+};
+
+} // namespace proxygen
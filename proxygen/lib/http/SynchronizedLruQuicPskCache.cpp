@@ -8,6 +8,8 @@
 
 #include <proxygen/lib/http/SynchronizedLruQuicPskCache.h>
 
+#include <algorithm>
+
 namespace proxygen {
 
 SynchronizedLruQuicPskCache::SynchronizedLruQuicPskCache(uint64_t mapMax)
@@ -45,4 +47,33 @@ void SynchronizedLruQuicPskCache::removePsk(const std::string& identity) {
   cacheMap->erase(identity);
 }
 
+ShardedLruQuicPskCache::ShardedLruQuicPskCache(uint64_t mapMax,
+                                               size_t numShards) {
+  CHECK_GT(numShards, 0);
+  auto shardMax = std::max<uint64_t>(1, (mapMax + numShards - 1) / numShards);
+  shards_.reserve(numShards);
+  for (size_t i = 0; i < numShards; ++i) {
+    shards_.push_back(std::make_unique<SynchronizedLruQuicPskCache>(shardMax));
+  }
+}
+
+SynchronizedLruQuicPskCache& ShardedLruQuicPskCache::getShard(
+    const std::string& identity) {
+  return *shards_[std::hash<std::string>()(identity) % shards_.size()];
+}
+
+folly::Optional<quic::QuicCachedPsk> ShardedLruQuicPskCache::getPsk(
+    const std::string& identity) {
+  return getShard(identity).getPsk(identity);
+}
+
+void ShardedLruQuicPskCache::putPsk(const std::string& identity,
+                                    quic::QuicCachedPsk psk) {
+  getShard(identity).putPsk(identity, std::move(psk));
+}
+
+void ShardedLruQuicPskCache::removePsk(const std::string& identity) {
+  getShard(identity).removePsk(identity);
+}
+
 } // namespace proxygen
@@ -8,6 +8,9 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <folly/Synchronized.h>
 #include <folly/container/EvictingCacheMap.h>
 #include <quic/fizz/client/handshake/QuicPskCache.h>
@@ -33,4 +36,29 @@ class SynchronizedLruQuicPskCache : public quic::QuicPskCache {
   folly::Synchronized<EvictingPskMap> cache_;
 };
 
+/**
+ * Spreads the identities over independently locked LRU caches, so that
+ * connections from different threads rarely contend on the same lock.
+ * Eviction is least recently used within a shard only.
+ */
+class ShardedLruQuicPskCache : public quic::QuicPskCache {
+ public:
+  ~ShardedLruQuicPskCache() override = default;
+
+  // mapMax is split evenly over the shards
+  ShardedLruQuicPskCache(uint64_t mapMax, size_t numShards = 16);
+
+  folly::Optional<quic::QuicCachedPsk> getPsk(
+      const std::string& identity) override;
+
+  void putPsk(const std::string& identity, quic::QuicCachedPsk psk) override;
+
+  void removePsk(const std::string& identity) override;
+
+ private:
+  SynchronizedLruQuicPskCache& getShard(const std::string& identity);
+
+  std::vector<std::unique_ptr<SynchronizedLruQuicPskCache>> shards_;
+};
+
 } // namespace proxygen
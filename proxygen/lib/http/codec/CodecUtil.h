@@ -13,6 +13,7 @@
 #include <folly/Range.h>
 #include <folly/portability/Windows.h> // for windows compatibility: STRICT maybe defined by some win headers
 #include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/codec/HeaderCharScan.h>
 #include <proxygen/lib/http/codec/compress/Header.h>
 #include <proxygen/lib/utils/UtilInl.h>
 #include <stdint.h>
@@ -81,6 +82,8 @@ class CodecUtil {
     if (name.size() == 0) {
       return false;
     }
+    // Skip the run that is valid in either mode
+    name.advance(header_scan::scanHeaderName(name.begin(), name.end()));
     for (uint8_t p : name) {
       if (mode == HEADER_NAME_STRICT_COMPAT) {
         // Allows ' ', '"', '/', '}' and high ASCII
@@ -119,6 +122,13 @@ class CodecUtil {
     } state = lws_none;
 
     for (auto p = std::begin(value); p != std::end(value); ++p) {
+      if (!escape && state == lws_none) {
+        // Skip the run that can neither fail nor change state
+        p += header_scan::scanHeaderValue(p, std::end(value));
+        if (p == std::end(value)) {
+          break;
+        }
+      }
       if (escape) {
         escape = false;
         if (mode == COMPLIANT) {
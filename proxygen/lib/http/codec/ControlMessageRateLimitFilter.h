@@ -30,8 +30,9 @@ constexpr std::chrono::milliseconds kDefaultDirectErrorHandlingDuration{100};
  */
 class ControlMessageRateLimitFilter : public PassThroughHTTPCodecFilter {
  public:
+  // Only intercepts callbacks, calls bypass it
   explicit ControlMessageRateLimitFilter(folly::HHWheelTimer* timer)
-      : timer_(timer) {
+      : PassThroughHTTPCodecFilter(false, true), timer_(timer) {
   }
 
   void setParams(
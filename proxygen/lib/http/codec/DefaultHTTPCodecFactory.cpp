@@ -12,12 +12,21 @@
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/codec/HTTP2Constants.h>
 
+#include <typeinfo>
+
 namespace proxygen {
 
 DefaultHTTPCodecFactory::DefaultHTTPCodecFactory(bool forceHTTP1xCodecTo1_1)
     : forceHTTP1xCodecTo1_1_(forceHTTP1xCodecTo1_1) {
 }
 
+std::unique_ptr<HTTPCodecFactory> DefaultHTTPCodecFactory::clone() const {
+  if (typeid(*this) != typeid(DefaultHTTPCodecFactory)) {
+    return nullptr;
+  }
+  return std::make_unique<DefaultHTTPCodecFactory>(*this);
+}
+
 std::unique_ptr<HTTPCodec> DefaultHTTPCodecFactory::getCodec(
     const std::string& chosenProto,
     TransportDirection direction,
@@ -29,6 +38,8 @@ std::unique_ptr<HTTPCodec> DefaultHTTPCodecFactory::getCodec(
       chosenProto == proxygen::http2::kProtocolExperimentalString) {
     auto codec = std::make_unique<HTTP2Codec>(direction);
     codec->setStrictValidation(useStrictValidation());
+    codec->setBatchedEgress(batchedHTTP2Egress_);
+    codec->setCoalesceIngressData(coalesceHTTP2IngressData_);
     return codec;
   } else {
     if (!chosenProto.empty() &&
@@ -38,8 +49,10 @@ std::unique_ptr<HTTPCodec> DefaultHTTPCodecFactory::getCodec(
                  << "Attempting to use HTTP/1.1";
     }
 
-    return std::make_unique<HTTP1xCodec>(
+    auto codec = std::make_unique<HTTP1xCodec>(
         direction, forceHTTP1xCodecTo1_1_, useStrictValidation());
+    codec->setVectorizedParsing(vectorizedHTTP1xParsing_);
+    return codec;
   }
 }
 } // namespace proxygen
@@ -23,12 +23,33 @@ class DefaultHTTPCodecFactory : public HTTPCodecFactory {
                                       TransportDirection direction,
                                       bool isTLS) override;
 
+  // nullptr for subclasses, which must clone themselves
+  std::unique_ptr<HTTPCodecFactory> clone() const override;
+
   void setForceHTTP1xCodecTo1_1(bool forceHTTP1xCodecTo1_1) {
     forceHTTP1xCodecTo1_1_ = forceHTTP1xCodecTo1_1;
   }
 
+  // See HTTP1xCodec::setVectorizedParsing
+  void setVectorizedHTTP1xParsing(bool vectorized) {
+    vectorizedHTTP1xParsing_ = vectorized;
+  }
+
+  // See HTTP2Codec::setBatchedEgress
+  void setBatchedHTTP2Egress(bool batched) {
+    batchedHTTP2Egress_ = batched;
+  }
+
+  // See HTTP2Codec::setCoalesceIngressData
+  void setCoalesceHTTP2IngressData(bool coalesce) {
+    coalesceHTTP2IngressData_ = coalesce;
+  }
+
  protected:
   bool forceHTTP1xCodecTo1_1_{false};
+  bool vectorizedHTTP1xParsing_{false};
+  bool batchedHTTP2Egress_{false};
+  bool coalesceHTTP2IngressData_{false};
 };
 
 } // namespace proxygen
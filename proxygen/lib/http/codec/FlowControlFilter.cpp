@@ -27,7 +27,8 @@ FlowControlFilter::FlowControlFilter(Callback& callback,
       recvWindow_(codec->getDefaultWindowSize()),
       sendWindow_(codec->getDefaultWindowSize()),
       error_(false),
-      sendsBlocked_(false) {
+      sendsBlocked_(false),
+      deferWindowUpdates_(false) {
   if (recvCapacity > 0) {
     if (recvCapacity < codec->getDefaultWindowSize()) {
       VLOG(4) << "Ignoring low conn-level recv window size of " << recvCapacity;
@@ -58,27 +59,47 @@ void FlowControlFilter::setReceiveWindowSize(folly::IOBufQueue& writeBuf,
     VLOG(2) << "Failed setting conn-level recv window capacity to " << capacity;
     return;
   }
-  toAck_ += delta;
-  if (toAck_ > 0) {
-    call_->generateWindowUpdate(writeBuf, 0, delta);
-    toAck_ = 0;
-  }
+  // Bytes processed but not acked yet stay in toAck_, their window is still
+  // outstanding
+  call_->generateWindowUpdate(writeBuf, 0, delta);
 }
 
 bool FlowControlFilter::ingressBytesProcessed(folly::IOBufQueue& writeBuf,
                                               uint32_t delta) {
   toAck_ += delta;
-  bool willAck =
-      (toAck_ > 0 && uint32_t(toAck_) > recvWindow_.getCapacity() / 2);
+  bool willAck = shouldAck();
   VLOG(4) << "processed " << delta << " toAck_=" << toAck_
           << " bytes, will ack=" << willAck;
-  if (willAck) {
-    CHECK(recvWindow_.free(toAck_));
-    call_->generateWindowUpdate(writeBuf, 0, toAck_);
-    toAck_ = 0;
+  if (willAck && deferWindowUpdates_) {
     return true;
   }
-  return false;
+  return willAck && flushWindowUpdate(writeBuf);
+}
+
+bool FlowControlFilter::flushWindowUpdate(folly::IOBufQueue& writeBuf) {
+  if (!shouldAck()) {
+    return false;
+  }
+  auto amount = getAckableBytes();
+  if (amount == 0) {
+    VLOG(4) << "Holding back window update of " << toAck_
+            << " bytes, limit=" << recvLimit_;
+    return false;
+  }
+  CHECK(recvWindow_.free(amount));
+  call_->generateWindowUpdate(writeBuf, 0, amount);
+  toAck_ -= amount;
+  return true;
+}
+
+uint32_t FlowControlFilter::getAckableBytes() const {
+  uint32_t amount = toAck_;
+  if (recvLimit_ == 0) {
+    return amount;
+  }
+  auto available = uint32_t(std::max(recvWindow_.getSize(), 0));
+  return available < recvLimit_ ? std::min(amount, recvLimit_ - available)
+                                : 0;
 }
 
 uint32_t FlowControlFilter::getAvailableSend() const {
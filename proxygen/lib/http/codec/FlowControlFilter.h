@@ -8,8 +8,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <proxygen/lib/http/Window.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/utils/PooledObject.h>
 
 namespace folly {
 class IOBufQueue;
@@ -22,7 +24,9 @@ namespace proxygen {
  * control. Not every codec is interested in per-session flow control, so
  * this filter can only be added in that case or else it is an error.
  */
-class FlowControlFilter : public PassThroughHTTPCodecFilter {
+class FlowControlFilter
+    : public PassThroughHTTPCodecFilter
+    , public PooledObject<FlowControlFilter> {
  public:
   class Callback {
    public:
@@ -73,6 +77,35 @@ class FlowControlFilter : public PassThroughHTTPCodecFilter {
    */
   bool ingressBytesProcessed(folly::IOBufQueue& writeBuf, uint32_t delta);
 
+  /**
+   * Hold back the WINDOW_UPDATEs ingressBytesProcessed would write, so they
+   * coalesce until flushWindowUpdate.  ingressBytesProcessed then returns
+   * true when one is due.
+   */
+  void setDeferWindowUpdates(bool defer) {
+    deferWindowUpdates_ = defer;
+  }
+
+  /**
+   * Caps the conn-level window the peer may use at limit, holding back the
+   * WINDOW_UPDATEs that would open it further; 0 lifts the cap.  Flush
+   * after raising it to release what was held back.
+   */
+  void setReceiveWindowLimit(uint32_t limit) {
+    recvLimit_ = limit;
+  }
+
+  uint32_t getReceiveWindowLimit() const {
+    return recvLimit_;
+  }
+
+  /**
+   * Writes the WINDOW_UPDATE held back since ingressBytesProcessed found one
+   * due, if any.
+   * @returns true iff we wrote a WINDOW_UPDATE frame to the write buf.
+   */
+  bool flushWindowUpdate(folly::IOBufQueue& writeBuf);
+
   /**
    * @returns the number of bytes available in the connection-level send window
    */
@@ -107,12 +140,25 @@ class FlowControlFilter : public PassThroughHTTPCodecFilter {
   }
 
  private:
+  bool shouldAck() const {
+    auto capacity = recvWindow_.getCapacity();
+    if (recvLimit_ > 0) {
+      capacity = std::min(capacity, recvLimit_);
+    }
+    return toAck_ > 0 && uint32_t(toAck_) > capacity / 2;
+  }
+
+  // What the window may open by, under recvLimit_
+  uint32_t getAckableBytes() const;
+
   Callback& notify_;
   Window recvWindow_;
   Window sendWindow_;
   int32_t toAck_{0};
+  uint32_t recvLimit_{0};
   bool error_ : 1;
   bool sendsBlocked_ : 1;
+  bool deferWindowUpdates_ : 1;
 };
 
 } // namespace proxygen
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/codec/FrameRecorder.h>
+
+#include <folly/lang/Bits.h>
+#include <sstream>
+
+namespace proxygen {
+
+FrameRecorder::FrameRecorder(size_t capacity, DumpFn dumpFn)
+    : frames_(folly::nextPowTwo(std::max<size_t>(capacity, 1))),
+      mask_(frames_.size() - 1),
+      dumpFn_(std::move(dumpFn)) {
+}
+
+std::vector<FrameRecorder::Frame> FrameRecorder::getFrames() const {
+  std::vector<Frame> frames;
+  auto first = next_ > frames_.size() ? next_ - frames_.size() : 0;
+  frames.reserve(next_ - first);
+  for (auto i = first; i < next_; i++) {
+    frames.push_back(frames_[i & mask_]);
+  }
+  return frames;
+}
+
+void FrameRecorder::describe(std::ostream& os) const {
+  auto frames = getFrames();
+  os << "frames recorded=" << next_ << " last=" << frames.size();
+  for (const auto& frame : frames) {
+    os << "\n  " << frame;
+  }
+}
+
+void FrameRecorder::dump() {
+  if (dumpFn_) {
+    dumpFn_(getFrames());
+    return;
+  }
+  std::ostringstream os;
+  describe(os);
+  LOG(ERROR) << "protocol=" << getCodecProtocolString(getProtocol()) << " "
+             << os.str();
+}
+
+void FrameRecorder::onFrameHeader(StreamID stream,
+                                  uint8_t flags,
+                                  uint64_t length,
+                                  uint64_t type,
+                                  uint16_t version) {
+  record(stream, type, length, flags, false);
+  callback_->onFrameHeader(stream, flags, length, type, version);
+}
+
+void FrameRecorder::onError(StreamID stream,
+                            const HTTPException& error,
+                            bool newTxn) {
+  // Stream 0 for the errors that fail the session
+  if (stream == 0) {
+    dump();
+  }
+  callback_->onError(stream, error, newTxn);
+}
+
+void FrameRecorder::onAbort(StreamID stream, ErrorCode code) {
+  dump();
+  callback_->onAbort(stream, code);
+}
+
+void FrameRecorder::onGoaway(uint64_t lastGoodStreamID,
+                             ErrorCode code,
+                             std::unique_ptr<folly::IOBuf> debugData) {
+  if (code != ErrorCode::NO_ERROR) {
+    dump();
+  }
+  callback_->onGoaway(lastGoodStreamID, code, std::move(debugData));
+}
+
+void FrameRecorder::onGenerateFrameHeader(StreamID stream,
+                                          uint8_t type,
+                                          uint64_t length,
+                                          uint16_t version) {
+  record(stream, type, length, 0, true);
+  callback_->onGenerateFrameHeader(stream, type, length, version);
+}
+
+size_t FrameRecorder::generateRstStream(folly::IOBufQueue& writeBuf,
+                                        StreamID stream,
+                                        ErrorCode code) {
+  // Recorded as generated, so dumped after
+  auto ret = call_->generateRstStream(writeBuf, stream, code);
+  dump();
+  return ret;
+}
+
+size_t FrameRecorder::generateGoaway(folly::IOBufQueue& writeBuf,
+                                     StreamID lastStream,
+                                     ErrorCode code,
+                                     std::unique_ptr<folly::IOBuf> debugData) {
+  auto ret =
+      call_->generateGoaway(writeBuf, lastStream, code, std::move(debugData));
+  if (code != ErrorCode::NO_ERROR) {
+    dump();
+  }
+  return ret;
+}
+
+std::ostream& operator<<(std::ostream& os, const FrameRecorder::Frame& frame) {
+  os << (frame.egress ? "egress" : "ingress") << " t=" << frame.time.count()
+     << "ns stream=" << frame.stream << " type=" << frame.type
+     << " length=" << frame.length << " flags=0x" << std::hex
+     << uint32_t(frame.flags) << std::dec;
+  return os;
+}
+
+} // namespace proxygen
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <folly/Function.h>
+#include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Records the headers of the last frames a session parsed and generated in
+ * a ring buffer of fixed size records, cheap enough to leave on in
+ * production where HTTPCodecPrinter and DebugFilter are not: no strings, no
+ * allocation, a clock read and a few stores per frame.
+ *
+ * The frames are dumped when the session fails, on a GOAWAY with an error,
+ * or a stream abort, and on demand with getFrames() or describe().  The
+ * frame types and flags are those of the codec's protocol; egress frames
+ * have no flags.
+ */
+class FrameRecorder : public PassThroughHTTPCodecFilter {
+ public:
+  struct Frame {
+    // steady_clock
+    std::chrono::nanoseconds time;
+    uint64_t stream;
+    uint32_t length;
+    // Truncated for the large HTTP/3 types, such as grease
+    uint32_t type;
+    uint8_t flags;
+    bool egress;
+  };
+
+  // Oldest first
+  using DumpFn = folly::Function<void(const std::vector<Frame>&)>;
+
+  /**
+   * Keeps the last capacity frames, rounded up to a power of two.  When
+   * dumpFn is null a dump is logged at ERROR.
+   */
+  explicit FrameRecorder(size_t capacity = 64, DumpFn dumpFn = nullptr);
+
+  std::vector<Frame> getFrames() const;
+
+  void describe(std::ostream& os) const;
+
+  uint64_t getNumRecorded() const {
+    return next_;
+  }
+
+  // Ingress
+  void onFrameHeader(StreamID stream,
+                     uint8_t flags,
+                     uint64_t length,
+                     uint64_t type,
+                     uint16_t version = 0) override;
+  void onError(StreamID stream,
+               const HTTPException& error,
+               bool newTxn = false) override;
+  void onAbort(StreamID stream, ErrorCode code) override;
+  void onGoaway(uint64_t lastGoodStreamID,
+                ErrorCode code,
+                std::unique_ptr<folly::IOBuf> debugData = nullptr) override;
+
+  // Egress
+  void onGenerateFrameHeader(StreamID stream,
+                             uint8_t type,
+                             uint64_t length,
+                             uint16_t version) override;
+  size_t generateRstStream(folly::IOBufQueue& writeBuf,
+                           StreamID stream,
+                           ErrorCode code) override;
+  size_t generateGoaway(
+      folly::IOBufQueue& writeBuf,
+      StreamID lastStream = MaxStreamID,
+      ErrorCode code = ErrorCode::NO_ERROR,
+      std::unique_ptr<folly::IOBuf> debugData = nullptr) override;
+
+ private:
+  void record(StreamID stream,
+              uint64_t type,
+              uint64_t length,
+              uint8_t flags,
+              bool egress) {
+    auto& frame = frames_[next_++ & mask_];
+    frame.time = std::chrono::steady_clock::now().time_since_epoch();
+    frame.stream = stream;
+    frame.length = static_cast<uint32_t>(length);
+    frame.type = static_cast<uint32_t>(type);
+    frame.flags = flags;
+    frame.egress = egress;
+  }
+
+  void dump();
+
+  std::vector<Frame> frames_;
+  const size_t mask_;
+  uint64_t next_{0};
+  DumpFn dumpFn_;
+};
+
+std::ostream& operator<<(std::ostream& os, const FrameRecorder::Frame& frame);
+
+} // namespace proxygen
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/codec/GrpcFraming.h>
+
+#include <array>
+#include <cstring>
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/io/Cursor.h>
+#include <folly/lang/Bits.h>
+#include <proxygen/lib/http/codec/compress/HPACKConstants.h>
+#include <proxygen/lib/http/codec/compress/HPACKEncodeBuffer.h>
+
+namespace {
+
+constexpr folly::StringPiece kStatusName{"grpc-status"};
+constexpr folly::StringPiece kMessageName{"grpc-message"};
+// OK to UNAUTHENTICATED
+constexpr uint32_t kMaxStatus = 16;
+constexpr uint32_t kGrowth = 128;
+
+enum class Format { HPACK, QPACK };
+
+// A literal field line with a literal name, without Huffman coding
+uint32_t encodeField(proxygen::HPACKEncodeBuffer& buf,
+                     Format format,
+                     folly::StringPiece name,
+                     folly::StringPiece value) {
+  uint32_t size = 0;
+  if (format == Format::HPACK) {
+    size += buf.encodeInteger(0, proxygen::HPACK::LITERAL);
+    size += buf.encodeLiteral(name);
+  } else {
+    size += buf.encodeLiteral(proxygen::HPACK::Q_LITERAL.code,
+                              proxygen::HPACK::Q_LITERAL.prefixLength,
+                              name);
+  }
+  return size + buf.encodeLiteral(value);
+}
+
+struct EncodedStatuses {
+  EncodedStatuses() {
+    for (uint32_t status = 0; status <= kMaxStatus; status++) {
+      hpack[status] = encode(Format::HPACK, status);
+      qpack[status] = encode(Format::QPACK, status);
+    }
+  }
+
+  static std::string encode(Format format, uint32_t status) {
+    proxygen::HPACKEncodeBuffer buf(kGrowth, false);
+    encodeField(buf, format, kStatusName, folly::to<std::string>(status));
+    return buf.release()->moveToFbString().toStdString();
+  }
+
+  std::array<std::string, kMaxStatus + 1> hpack;
+  std::array<std::string, kMaxStatus + 1> qpack;
+};
+
+const EncodedStatuses& getEncodedStatuses() {
+  static const EncodedStatuses statuses;
+  return statuses;
+}
+
+proxygen::HTTPHeaderSize appendStatusTrailers(folly::IOBufQueue& writeBuf,
+                                              Format format,
+                                              uint32_t status,
+                                              folly::StringPiece message) {
+  proxygen::HTTPHeaderSize size;
+  auto statusText = folly::to<std::string>(status);
+  size.uncompressed = kStatusName.size() + statusText.size() + 2;
+  proxygen::HPACKEncodeBuffer buf(kGrowth, false);
+  buf.setWriteBuf(&writeBuf);
+  if (status <= kMaxStatus) {
+    const auto& statuses = getEncodedStatuses();
+    const auto& encoded = format == Format::HPACK ? statuses.hpack[status]
+                                                  : statuses.qpack[status];
+    writeBuf.append(encoded.data(), encoded.size());
+    size.compressed = encoded.size();
+  } else {
+    size.compressed = encodeField(buf, format, kStatusName, statusText);
+  }
+  if (!message.empty()) {
+    size.compressed += encodeField(buf, format, kMessageName, message);
+    size.uncompressed += kMessageName.size() + message.size() + 2;
+  }
+  size.compressedBlock = size.compressed;
+  return size;
+}
+
+} // namespace
+
+namespace proxygen { namespace grpc {
+
+folly::Expected<folly::Optional<Message>, MessageError> MessageReader::next() {
+  if (queue_.chainLength() < kMessagePrefixSize) {
+    return folly::none;
+  }
+  folly::io::Cursor cursor(queue_.front());
+  auto flag = cursor.read<uint8_t>();
+  auto length = cursor.readBE<uint32_t>();
+  if (flag > 1) {
+    return folly::makeUnexpected(MessageError::INVALID_FLAG);
+  }
+  if (length > maxMessageSize_) {
+    return folly::makeUnexpected(MessageError::TOO_LARGE);
+  }
+  if (queue_.chainLength() < kMessagePrefixSize + length) {
+    return folly::none;
+  }
+  queue_.trimStart(kMessagePrefixSize);
+  Message message;
+  message.compressed = (flag == 1);
+  if (length > 0) {
+    message.payload = queue_.split(length);
+  }
+  return message;
+}
+
+std::unique_ptr<folly::IOBuf> frameMessage(
+    std::unique_ptr<folly::IOBuf> payload, bool compressed) {
+  uint32_t length = payload ? payload->computeChainDataLength() : 0;
+  uint8_t* prefix;
+  if (payload && payload->headroom() >= kMessagePrefixSize &&
+      !payload->isSharedOne()) {
+    payload->prepend(kMessagePrefixSize);
+    prefix = payload->writableData();
+  } else {
+    auto buf = folly::IOBuf::create(kMessagePrefixSize);
+    buf->append(kMessagePrefixSize);
+    prefix = buf->writableData();
+    if (payload) {
+      buf->prependChain(std::move(payload));
+    }
+    payload = std::move(buf);
+  }
+  prefix[0] = compressed ? 1 : 0;
+  auto bigLength = folly::Endian::big(length);
+  memcpy(prefix + 1, &bigLength, sizeof(bigLength));
+  return payload;
+}
+
+bool getStatusTrailers(const HTTPHeaders& trailers,
+                       uint32_t& status,
+                       folly::StringPiece& message) {
+  if (trailers.size() == 0 || trailers.size() > 2) {
+    return false;
+  }
+  bool hasStatus = false;
+  bool hasMessage = false;
+  bool other = false;
+  message.clear();
+  trailers.forEach([&](const std::string& name, const std::string& value) {
+    if (!hasStatus && folly::caseInsensitiveEqual(name, kStatusName)) {
+      auto parsed = folly::tryTo<uint32_t>(value);
+      if (parsed) {
+        status = *parsed;
+        hasStatus = true;
+        return;
+      }
+    } else if (!hasMessage && folly::caseInsensitiveEqual(name, kMessageName)) {
+      message = value;
+      hasMessage = true;
+      return;
+    }
+    other = true;
+  });
+  return hasStatus && !other;
+}
+
+HTTPHeaderSize appendHPACKStatusTrailers(folly::IOBufQueue& writeBuf,
+                                         uint32_t status,
+                                         folly::StringPiece message) {
+  return appendStatusTrailers(writeBuf, Format::HPACK, status, message);
+}
+
+std::unique_ptr<folly::IOBuf> encodeQPACKStatusTrailers(
+    uint32_t status, folly::StringPiece message, HTTPHeaderSize* size) {
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  // A Required Insert Count and Base of 0: no dynamic table reference
+  const uint8_t sectionPrefix[] = {0, 0};
+  queue.append(sectionPrefix, sizeof(sectionPrefix));
+  auto fieldsSize =
+      appendStatusTrailers(queue, Format::QPACK, status, message);
+  if (size) {
+    *size = fieldsSize;
+    size->compressed += sizeof(sectionPrefix);
+    size->compressedBlock = size->compressed;
+  }
+  return queue.move();
+}
+
+}} // namespace proxygen::grpc
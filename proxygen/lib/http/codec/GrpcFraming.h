@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/HTTPHeaderSize.h>
+#include <proxygen/lib/http/HTTPHeaders.h>
+
+namespace proxygen { namespace grpc {
+
+/**
+ * The length-prefixed messages of gRPC over HTTP/2 and HTTP/3 bodies: a
+ * compressed flag byte, a 4 byte big endian length, then the message.
+ */
+constexpr size_t kMessagePrefixSize = 5;
+constexpr uint32_t kDefaultMaxMessageSize = 4 * 1024 * 1024;
+
+struct Message {
+  bool compressed{false};
+  // nullptr for an empty message
+  std::unique_ptr<folly::IOBuf> payload;
+};
+
+enum class MessageError {
+  // The flag byte is neither 0 nor 1
+  INVALID_FLAG,
+  TOO_LARGE,
+};
+
+/**
+ * Splits the messages of a body as its chunks arrive.  A message spanning
+ * several chunks is a chain of (shared) slices of them: nothing is
+ * coalesced or copied.
+ */
+class MessageReader {
+ public:
+  explicit MessageReader(uint32_t maxMessageSize = kDefaultMaxMessageSize)
+      : maxMessageSize_(maxMessageSize) {
+  }
+
+  void append(std::unique_ptr<folly::IOBuf> chunk) {
+    queue_.append(std::move(chunk));
+  }
+
+  // The next message, none until it is all appended
+  folly::Expected<folly::Optional<Message>, MessageError> next();
+
+  // Bytes of an incomplete message, which must be none at the end
+  size_t pending() const {
+    return queue_.chainLength();
+  }
+
+ private:
+  folly::IOBufQueue queue_{folly::IOBufQueue::cacheChainLength()};
+  const uint32_t maxMessageSize_;
+};
+
+/**
+ * Prefixes payload, in its headroom when it has 5 unshared bytes of it, in
+ * a buffer chained in front otherwise.
+ */
+std::unique_ptr<folly::IOBuf> frameMessage(
+    std::unique_ptr<folly::IOBuf> payload, bool compressed = false);
+
+/**
+ * Whether trailers are a gRPC status alone: grpc-status, a number, and
+ * maybe grpc-message.  The HTTP/2 and HQ codecs encode those blocks from
+ * pre-encoded fields rather than through HPACK or QPACK.
+ */
+bool getStatusTrailers(const HTTPHeaders& trailers,
+                       uint32_t& status,
+                       folly::StringPiece& message);
+
+/**
+ * The HPACK and QPACK field sections of the status trailers, as literals
+ * with literal names, which neither reference nor change the dynamic
+ * tables: they can be generated regardless of the compression state.  The
+ * grpc-status field is pre-encoded for the status codes gRPC defines.
+ */
+HTTPHeaderSize appendHPACKStatusTrailers(folly::IOBufQueue& writeBuf,
+                                         uint32_t status,
+                                         folly::StringPiece message);
+
+std::unique_ptr<folly::IOBuf> encodeQPACKStatusTrailers(
+    uint32_t status, folly::StringPiece message, HTTPHeaderSize* size);
+
+}} // namespace proxygen::grpc
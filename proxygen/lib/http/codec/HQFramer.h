@@ -45,10 +45,12 @@ enum class UnidirectionalStreamType : uint64_t {
   QPACK_ENCODER = 0x02,
   QPACK_DECODER = 0x03,
   GREASE = 0x21,
+  WEBTRANSPORT = 0x54,
 };
 
 enum class BidirectionalStreamType : uint64_t {
   REQUEST = 0x00, // Can be any reserved frame type valid on a bidi stream
+  WEBTRANSPORT = 0x41,
 };
 
 enum class FrameType : uint64_t {
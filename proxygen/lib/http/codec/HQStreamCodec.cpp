@@ -13,6 +13,7 @@
 #include <folly/SingletonThreadLocal.h>
 #include <folly/io/Cursor.h>
 #include <proxygen/lib/http/HTTP3ErrorCode.h>
+#include <proxygen/lib/http/codec/GrpcFraming.h>
 #include <proxygen/lib/http/codec/HQUtils.h>
 #include <proxygen/lib/http/codec/compress/QPACKCodec.h>
 
@@ -98,8 +99,17 @@ ParseResult HQStreamCodec::parseData(Cursor& cursor,
   std::unique_ptr<IOBuf> outData;
   VLOG(10) << "parsing all frame DATA bytes for stream=" << streamId_
            << " length=" << header.length;
-  auto res = hq::parseData(cursor, header, outData);
-  CHECK(!res);
+  ParseResult res;
+  if (header.length < bodyCopyThreshold_) {
+    outData = IOBuf::create(header.length);
+    cursor.pull(outData->writableData(), header.length);
+    outData->append(header.length);
+    ingressBodyBytesCopied_ += header.length;
+  } else {
+    res = hq::parseData(cursor, header, outData);
+    CHECK(!res);
+    ingressBodyBytesZeroCopy_ += header.length;
+  }
 
   // no need to do deliverCallbackIfAllowed
   // the HQSession can trap this and stop reading.
@@ -193,7 +203,18 @@ ParseResult HQStreamCodec::parsePushPromise(Cursor& cursor,
 
 void HQStreamCodec::onHeader(const HPACKHeaderName& name,
                              const folly::fbstring& value) {
-  if (decodeInfo_.onHeader(name, value)) {
+  onDecodedHeader(name, value, false);
+}
+
+void HQStreamCodec::onStaticHeader(const HPACKHeaderName& name,
+                                   const folly::fbstring& value) {
+  onDecodedHeader(name, value, true);
+}
+
+void HQStreamCodec::onDecodedHeader(const HPACKHeaderName& name,
+                                    const folly::fbstring& value,
+                                    bool fromStaticTable) {
+  if (decodeInfo_.onHeader(name, value, fromStaticTable)) {
     if (userAgent_.empty() && name.getHeaderCode() == HTTP_HEADER_USER_AGENT) {
       userAgent_ = value.toStdString();
     }
@@ -400,19 +421,28 @@ size_t HQStreamCodec::generateTrailers(folly::IOBufQueue& writeBuf,
                                        StreamID stream,
                                        const HTTPHeaders& trailers) {
   DCHECK_EQ(stream, streamId_);
-  std::vector<compress::Header> allTrailers;
-  CodecUtil::appendHeaders(trailers, allTrailers, HTTP_HEADER_NONE);
-  auto encodeRes =
-      headerCodec_.encode(allTrailers, streamId_, maxEncoderStreamData());
-  qpackEncoderWriteBuf_.append(std::move(encodeRes.control));
-
-  logIfFieldSectionExceedsPeerMax(
-      headerCodec_.getEncodedSize(),
-      ingressSettings_.getSetting(SettingsId::MAX_HEADER_LIST_SIZE,
-                                  std::numeric_limits<uint32_t>::max()),
-      trailers);
+  uint32_t grpcStatus = 0;
+  folly::StringPiece grpcMessage;
   WriteResult res;
-  res = hq::writeHeaders(writeBuf, std::move(encodeRes.stream));
+  if (grpc::getStatusTrailers(trailers, grpcStatus, grpcMessage)) {
+    // No dynamic table reference, so nothing for the encoder stream either
+    res = hq::writeHeaders(
+        writeBuf,
+        grpc::encodeQPACKStatusTrailers(grpcStatus, grpcMessage, nullptr));
+  } else {
+    std::vector<compress::Header> allTrailers;
+    CodecUtil::appendHeaders(trailers, allTrailers, HTTP_HEADER_NONE);
+    auto encodeRes =
+        headerCodec_.encode(allTrailers, streamId_, maxEncoderStreamData());
+    qpackEncoderWriteBuf_.append(std::move(encodeRes.control));
+
+    logIfFieldSectionExceedsPeerMax(
+        headerCodec_.getEncodedSize(),
+        ingressSettings_.getSetting(SettingsId::MAX_HEADER_LIST_SIZE,
+                                    std::numeric_limits<uint32_t>::max()),
+        trailers);
+    res = hq::writeHeaders(writeBuf, std::move(encodeRes.stream));
+  }
 
   if (res.hasError()) {
     LOG(ERROR) << __func__ << ": failed to write trailers: " << res.error();
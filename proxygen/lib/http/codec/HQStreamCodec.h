@@ -72,6 +72,24 @@ class HQStreamCodec
     return onFramedIngress(buf);
   }
 
+  /**
+   * DATA payloads are normally delivered to onBody as slices sharing the
+   * ingress buffer.  Slices shorter than threshold are instead copied into
+   * a right-sized buffer, so a short body doesn't pin a whole transport read
+   * buffer.  0 (the default) never copies.
+   */
+  void setBodyCopyThreshold(size_t threshold) {
+    bodyCopyThreshold_ = threshold;
+  }
+
+  uint64_t getIngressBodyBytesZeroCopy() const {
+    return ingressBodyBytesZeroCopy_;
+  }
+
+  uint64_t getIngressBodyBytesCopied() const {
+    return ingressBodyBytesCopied_;
+  }
+
   void onIngressEOF() override {
     if (onFramedIngressEOF() && callback_) {
       auto g = folly::makeGuard(activationHook_());
@@ -142,6 +160,8 @@ class HQStreamCodec
 
   void onHeader(const HPACKHeaderName& name,
                 const folly::fbstring& value) override;
+  void onStaticHeader(const HPACKHeaderName& name,
+                      const folly::fbstring& value) override;
   void onHeadersComplete(HTTPHeaderSize decodedSize, bool acknowledge) override;
   void onDecodeError(HPACK::DecodeError decodeError) override;
 
@@ -172,6 +192,10 @@ class HQStreamCodec
   size_t generateBodyImpl(folly::IOBufQueue& writeBuf,
                           std::unique_ptr<folly::IOBuf> chain);
 
+  void onDecodedHeader(const HPACKHeaderName& name,
+                       const folly::fbstring& value,
+                       bool fromStaticTable);
+
   std::string userAgent_;
   HeaderDecodeInfo decodeInfo_;
   QPACKCodec& headerCodec_;
@@ -184,6 +208,9 @@ class HQStreamCodec
   bool parsingTrailers_{false};
   bool finalEgressHeadersSeen_{false};
   bool isConnect_{false};
+  size_t bodyCopyThreshold_{0};
+  uint64_t ingressBodyBytesZeroCopy_{0};
+  uint64_t ingressBodyBytesCopied_{0};
   folly::Function<folly::Function<void()>()> activationHook_{
       [] { return [] {}; }};
   HTTPSettings& ingressSettings_;
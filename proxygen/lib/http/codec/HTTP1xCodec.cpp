@@ -73,6 +73,31 @@ void appendString(IOBufQueue& queue, size_t& len, StringPiece str) {
   len += str.size();
 }
 
+// The framing of the first line, and the headers generateHeader() may add:
+// Date, Connection, Transfer-Encoding and the websocket ones
+constexpr size_t kGeneratedHeaderBytes = 256;
+
+// At least the size of the header block for msg, to preallocate, so that
+// the many appends of generateHeader() fill a single buffer
+size_t headerBlockSize(
+    const proxygen::HTTPMessage& msg,
+    const folly::Optional<proxygen::HTTPHeaders>& extraHeaders) {
+  size_t size = kGeneratedHeaderBytes;
+  if (msg.isRequest()) {
+    size += msg.getMethodString().size() + msg.getURL().size();
+  } else {
+    size += msg.getStatusMessage().size();
+  }
+  auto addLine = [&size](const std::string& name, const std::string& value) {
+    size += name.size() + value.size() + 4; // 4 for ": " + CRLF
+  };
+  msg.getHeaders().forEach(addLine);
+  if (extraHeaders) {
+    extraHeaders->forEach(addLine);
+  }
+  return size;
+}
+
 } // anonymous namespace
 
 namespace proxygen {
@@ -89,6 +114,7 @@ HTTP1xCodec::HTTP1xCodec(TransportDirection direction,
       keepaliveRequested_(KeepaliveRequested::UNSET),
       force1_1_(force1_1),
       strictValidation_(strictValidation),
+      vectorizedParsing_(false),
       parserActive_(false),
       pendingEOF_(false),
       parserPaused_(false),
@@ -111,7 +137,8 @@ HTTP1xCodec::HTTP1xCodec(TransportDirection direction,
       egressUpgrade_(false),
       nativeUpgrade_(false),
       headersComplete_(false),
-      releaseEgressAfterRequest_(false) {
+      releaseEgressAfterRequest_(false),
+      coalesceChunkedBody_(false) {
   switch (direction) {
     case TransportDirection::DOWNSTREAM:
       http_parser_init(&parser_, HTTP_REQUEST);
@@ -222,10 +249,13 @@ size_t HTTP1xCodec::onIngressImpl(const IOBuf& buf) {
       ingressUpgradeComplete_ = true;
       return onIngressImpl(buf);
     }
+    uint8_t parserOptions =
+        (strictValidation_ ? F_HTTP_PARSER_OPTIONS_URL_STRICT : 0) |
+        (vectorizedParsing_ ? F_HTTP_PARSER_OPTIONS_VECTORIZED : 0);
     size_t bytesParsed = http_parser_execute_options(
         &parser_,
         getParserSettings(),
-        strictValidation_ ? F_HTTP_PARSER_OPTIONS_URL_STRICT : 0,
+        parserOptions,
         (const char*)buf.data(),
         buf.length());
     // in case we parsed a section of the headers but we're not done parsing
@@ -235,6 +265,7 @@ size_t HTTP1xCodec::onIngressImpl(const IOBuf& buf) {
       headerSize_.compressed += bytesParsed;
     }
     parserActive_ = false;
+    flushChunkedBody();
     parserError_ = (HTTP_PARSER_ERRNO(&parser_) != HPE_OK) &&
                    (HTTP_PARSER_ERRNO(&parser_) != HPE_PAUSED);
     if (parserError_) {
@@ -247,6 +278,12 @@ size_t HTTP1xCodec::onIngressImpl(const IOBuf& buf) {
       currentHeaderName_.assign(currentHeaderNameStringPiece_.begin(),
                                 currentHeaderNameStringPiece_.size());
     }
+    if (currentHeaderValue_.empty() &&
+        !currentHeaderValueStringPiece_.empty()) {
+      // same for a partially received header value
+      currentHeaderValue_.assign(currentHeaderValueStringPiece_.begin(),
+                                 currentHeaderValueStringPiece_.size());
+    }
     currentIngressBuf_ = nullptr;
     if (pendingEOF_) {
       onIngressEOF();
@@ -326,6 +363,15 @@ bool HTTP1xCodec::isReusable() const {
          websockAcceptKey_.empty();
 }
 
+void HTTP1xCodec::releaseIdleMemory() {
+  if (parserActive_ || isBusy()) {
+    return;
+  }
+  // Cleared after each header, they keep the capacity of the longest
+  std::string().swap(currentHeaderName_);
+  std::string().swap(currentHeaderValue_);
+}
+
 bool HTTP1xCodec::isBusy() const {
   return requestPending_ || responsePending_;
 }
@@ -398,6 +444,32 @@ void HTTP1xCodec::generateHeader(
   }
   const bool upstream = (transportDirection_ == TransportDirection::UPSTREAM);
   const bool downstream = !upstream;
+  auto keepaliveRequested = keepaliveRequested_;
+  if (downstream && txn > egressTxnID_) {
+    // Later requests may have been parsed since this one
+    while (!pendingRequests_.empty() && pendingRequests_.front().txn < txn) {
+      pendingRequests_.pop_front();
+    }
+    if (!pendingRequests_.empty() && pendingRequests_.front().txn == txn) {
+      const auto& request = pendingRequests_.front();
+      connectRequest_ = request.connect;
+      headRequest_ = request.head;
+      mayChunkEgress_ = request.mayChunkEgress;
+      keepaliveRequested = request.keepaliveRequested;
+    }
+  }
+  if (downstream && !mayChunkEgress_ && msg.is1xxResponse() &&
+      msg.getStatusCode() > 101 && !msg.isEgressWebsocketUpgrade()) {
+    // Hints, e.g. 103 Early Hints, are not for HTTP/1.0 clients, which
+    // sent no Expect or Upgrade for the others
+    VLOG(4) << "Dropping a " << msg.getStatusCode()
+            << " response to an HTTP/1.0 request";
+    if (size) {
+      size->compressed = 0;
+      size->uncompressed = 0;
+    }
+    return;
+  }
   if (upstream) {
     DCHECK_EQ(txn, egressTxnID_);
     requestPending_ = true;
@@ -405,6 +477,8 @@ void HTTP1xCodec::generateHeader(
     connectRequest_ = (msg.getMethod() == HTTPMethod::CONNECT);
     headRequest_ = (msg.getMethod() == HTTPMethod::HEAD);
     expectNoResponseBody_ = connectRequest_ || headRequest_;
+    pendingRequests_.push_back(RequestState{
+        txn, keepaliveRequested_, connectRequest_, headRequest_, false});
   } else {
     // In HTTP, transactions must be egressed sequentially -- no out of order
     // responses.  So txn must be egressTxnID_ + 1.  Furthermore, we shouldn't
@@ -467,6 +541,8 @@ void HTTP1xCodec::generateHeader(
     version = HTTPMessage::kHTTPVersion11;
   }
 
+  auto blockSize = headerBlockSize(msg, extraHeaders);
+  writeBuf.preallocate(blockSize, std::max(blockSize, size_t(2000)));
   size_t len = 0;
   switch (transportDirection_) {
     case TransportDirection::DOWNSTREAM:
@@ -515,7 +591,7 @@ void HTTP1xCodec::generateHeader(
 
   if (keepalive_ && (!msg.wantsKeepalive() || version.first < 1 ||
                      (downstream && version == HTTPMessage::kHTTPVersion10 &&
-                      keepaliveRequested_ != KeepaliveRequested::ENABLED))) {
+                      keepaliveRequested != KeepaliveRequested::ENABLED))) {
     // Disable keepalive if
     //  - the message asked to turn it off
     //  - it's HTTP/0.9
@@ -719,7 +795,13 @@ size_t HTTP1xCodec::generateBody(IOBufQueue& writeBuf,
     CHECK_GT(rc, 0);
     CHECK_LT(size_t(rc), sizeof(chunkLenBuf));
 
-    writeBuf.append(chunkLenBuf, rc);
+    if (!chain->isSharedOne() && chain->headroom() >= size_t(rc)) {
+      // Into the headroom of the body rather than a buffer of its own
+      chain->prepend(rc);
+      memcpy(chain->writableData(), chunkLenBuf, rc);
+    } else {
+      writeBuf.append(chunkLenBuf, rc);
+    }
     totLen += rc;
 
     writeBuf.append(std::move(chain));
@@ -894,6 +976,11 @@ int HTTP1xCodec::onReason(const char* buf, size_t len) {
 }
 
 bool HTTP1xCodec::pushHeaderNameAndValue(HTTPHeaders& hdrs) {
+  // The value is usually still a view into the ingress buffer, and is only
+  // copied once, directly into hdrs
+  folly::StringPiece headerValue(currentHeaderValue_.empty()
+                                     ? currentHeaderValueStringPiece_
+                                     : currentHeaderValue_);
   // Header names are strictly validated by http_parser, however, it allows
   // quoted+escaped CTLs so run our stricter check here.
   if (strictValidation_) {
@@ -902,23 +989,24 @@ bool HTTP1xCodec::pushHeaderNameAndValue(HTTPHeaders& hdrs) {
                                       : currentHeaderName_);
     bool compatValidate = false;
     if (!CodecUtil::validateHeaderValue(
-            folly::StringPiece(currentHeaderValue_),
+            headerValue,
             compatValidate ? CodecUtil::CtlEscapeMode::STRICT_COMPAT
                            : CodecUtil::CtlEscapeMode::STRICT)) {
       LOG(ERROR) << "Invalid header name=" << headerName;
-      std::cerr << " value=" << currentHeaderValue_ << std::endl;
+      std::cerr << " value=" << headerValue << std::endl;
       return false;
     }
   }
   if (LIKELY(currentHeaderName_.empty())) {
     hdrs.addFromCodec(currentHeaderNameStringPiece_.begin(),
                       currentHeaderNameStringPiece_.size(),
-                      std::move(currentHeaderValue_));
+                      headerValue);
   } else {
-    hdrs.add(currentHeaderName_, std::move(currentHeaderValue_));
+    hdrs.add(currentHeaderName_, headerValue);
     currentHeaderName_.clear();
   }
   currentHeaderNameStringPiece_.clear();
+  currentHeaderValueStringPiece_.clear();
   currentHeaderValue_.clear();
   return true;
 }
@@ -981,6 +1069,22 @@ int HTTP1xCodec::onHeaderValue(const char* buf, size_t len) {
   } else {
     headerParseState_ = HeaderParseState::kParsingTrailerValue;
   }
+  // Mirror the header name handling: keep a view into the ingress buffer for
+  // as long as the value is contiguous, and only fall back to
+  // currentHeaderValue_ across buffer boundaries.
+  if (currentHeaderValue_.empty()) {
+    if (currentHeaderValueStringPiece_.empty()) {
+      currentHeaderValueStringPiece_.reset(buf, len);
+      return 0;
+    } else if (currentHeaderValueStringPiece_.end() == buf) {
+      currentHeaderValueStringPiece_.reset(
+          currentHeaderValueStringPiece_.begin(),
+          currentHeaderValueStringPiece_.size() + len);
+      return 0;
+    }
+    currentHeaderValue_.assign(currentHeaderValueStringPiece_.begin(),
+                               currentHeaderValueStringPiece_.size());
+  }
   currentHeaderValue_.append(buf, len);
   return 0;
 }
@@ -1064,12 +1168,20 @@ int HTTP1xCodec::onHeadersComplete(size_t len) {
   auto g = folly::makeGuard([this] {
     // Always clear the outbound upgrade header after we receive a response
     if (transportDirection_ == TransportDirection::UPSTREAM &&
-        parser_.status_code != 100) {
+        parser_.status_code != 100 && parser_.status_code != 103) {
       upgradeHeader_.clear();
     }
   });
   headerParseState_ = HeaderParseState::kParsingHeadersComplete;
   if (transportDirection_ == TransportDirection::UPSTREAM) {
+    if (!pendingRequests_.empty() &&
+        pendingRequests_.front().txn == ingressTxnID_) {
+      // Requests may have been pipelined since this one
+      const auto& request = pendingRequests_.front();
+      connectRequest_ = request.connect;
+      headRequest_ = request.head;
+      expectNoResponseBody_ = connectRequest_ || headRequest_;
+    }
     if (connectRequest_ &&
         (parser_.status_code >= 200 && parser_.status_code < 300)) {
       // Enable upgrade if this is a 200 response to a CONNECT
@@ -1210,6 +1322,13 @@ int HTTP1xCodec::onHeadersComplete(size_t len) {
   if (userAgent_.empty()) {
     userAgent_ = msg_->getHeaders().getSingleOrEmpty(HTTP_HEADER_USER_AGENT);
   }
+  if (transportDirection_ == TransportDirection::DOWNSTREAM) {
+    pendingRequests_.push_back(RequestState{ingressTxnID_,
+                                            keepaliveRequested_,
+                                            connectRequest_,
+                                            headRequest_,
+                                            mayChunkEgress_});
+  }
   callback_->onHeadersComplete(ingressTxnID_, std::move(msg_));
 
   // 1 is a magic value that tells the http_parser not to expect a
@@ -1230,13 +1349,29 @@ int HTTP1xCodec::onBody(const char* buf, size_t len) {
   clone->trimStart(buf - dataStart);
   clone->trimEnd(dataEnd - (buf + len));
   DCHECK_EQ(len, clone->computeChainDataLength());
+  if (coalesceChunkedBody_ && (parser_.flags & F_CHUNKED)) {
+    if (pendingChunkedBody_) {
+      pendingChunkedBody_->prependChain(std::move(clone));
+    } else {
+      pendingChunkedBody_ = std::move(clone);
+    }
+    return 0;
+  }
   callback_->onBody(ingressTxnID_, std::move(clone), 0);
   return 0;
 }
 
+void HTTP1xCodec::flushChunkedBody() {
+  if (pendingChunkedBody_) {
+    callback_->onBody(ingressTxnID_, std::move(pendingChunkedBody_), 0);
+  }
+}
+
 int HTTP1xCodec::onChunkHeader(size_t len) {
   if (len > 0) {
-    callback_->onChunkHeader(ingressTxnID_, len);
+    if (!coalesceChunkedBody_) {
+      callback_->onChunkHeader(ingressTxnID_, len);
+    }
   } else {
     VLOG(5) << "Suppressed onChunkHeader callback for final zero length "
             << "chunk";
@@ -1248,7 +1383,7 @@ int HTTP1xCodec::onChunkHeader(size_t len) {
 int HTTP1xCodec::onChunkComplete() {
   if (inRecvLastChunk_) {
     inRecvLastChunk_ = false;
-  } else {
+  } else if (!coalesceChunkedBody_) {
     callback_->onChunkComplete(ingressTxnID_);
   }
   return 0;
@@ -1257,6 +1392,7 @@ int HTTP1xCodec::onChunkComplete() {
 int HTTP1xCodec::onMessageComplete() {
   DCHECK(!isParsingHeaders());
   DCHECK(!inRecvLastChunk_);
+  flushChunkedBody();
   if (headerParseState_ == HeaderParseState::kParsingTrailerValue) {
     if (!trailers_) {
       trailers_.reset(new HTTPHeaders());
@@ -1288,7 +1424,11 @@ int HTTP1xCodec::onMessageComplete() {
       break;
     }
     case TransportDirection::UPSTREAM:
-      responsePending_ = is1xxResponse_;
+      if (!is1xxResponse_ && !pendingRequests_.empty() &&
+          pendingRequests_.front().txn == ingressTxnID_) {
+        pendingRequests_.pop_front();
+      }
+      responsePending_ = is1xxResponse_ || !pendingRequests_.empty();
       if (is1xxResponse_ && !nativeUpgrade_ && !ingressUpgrade_) {
         // Some other 1xx status code, which doesn't terminate the message
         return 0;
@@ -8,16 +8,20 @@
 
 #pragma once
 
+#include <deque>
 #include <proxygen/lib/http/HTTPMessage.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/codec/TransportDirection.h>
+#include <proxygen/lib/utils/PooledObject.h>
 #include <string>
 
 #include <proxygen/external/http_parser/http_parser.h>
 
 namespace proxygen {
 
-class HTTP1xCodec : public HTTPCodec {
+class HTTP1xCodec
+    : public HTTPCodec
+    , public PooledObject<HTTP1xCodec> {
  public:
   // Default strictValidation to false for now to match existing behavior
   explicit HTTP1xCodec(TransportDirection direction,
@@ -50,6 +54,7 @@ class HTTP1xCodec : public HTTPCodec {
     callback_ = callback;
   }
   bool isBusy() const override;
+  void releaseIdleMemory() override;
   void setParserPaused(bool paused) override;
   bool isParserPaused() const override {
     return parserPaused_;
@@ -131,6 +136,25 @@ class HTTP1xCodec : public HTTPCodec {
     releaseEgressAfterRequest_ = releaseEgress;
   }
 
+  /**
+   * Scan header names and values in 16/32-byte strides (SSE2/AVX2/NEON when
+   * the build targets them) instead of a byte at a time.  Callbacks and
+   * errors are identical to the default parser.
+   */
+  void setVectorizedParsing(bool vectorized) {
+    vectorizedParsing_ = vectorized;
+  }
+
+  /**
+   * For callbacks that don't need the chunk boundaries of a chunked body:
+   * onChunkHeader and onChunkComplete are not called, and the data of the
+   * consecutive chunks parsed from one onIngress() is given to onBody as one
+   * chain.
+   */
+  void setCoalesceChunkedBody(bool coalesce) {
+    coalesceChunkedBody_ = coalesce;
+  }
+
   /**
    * @returns true if the codec supports the given NPN protocol.
    */
@@ -181,6 +205,9 @@ class HTTP1xCodec : public HTTPCodec {
       HTTPException passed to callback_. */
   void onParserError(const char* what = nullptr);
 
+  /** Deliver the body held by coalesceChunkedBody_ */
+  void flushChunkedBody();
+
   /** Push out header name-value pair to hdrs and clear currentHeader*_ */
   bool pushHeaderNameAndValue(HTTPHeaders& hdrs);
 
@@ -212,6 +239,7 @@ class HTTP1xCodec : public HTTPCodec {
   std::string currentHeaderName_;
   folly::StringPiece currentHeaderNameStringPiece_;
   std::string currentHeaderValue_;
+  folly::StringPiece currentHeaderValueStringPiece_;
   std::string url_;
   std::string userAgent_;
   std::string reason_;
@@ -224,6 +252,7 @@ class HTTP1xCodec : public HTTPCodec {
   std::pair<CodecProtocol, std::string> upgradeResult_; // DOWNSTREAM only
   bool force1_1_ : 1; // Use HTTP/1.1 even if msg is 1.0
   bool strictValidation_ : 1;
+  bool vectorizedParsing_ : 1;
   bool parserActive_ : 1;
   bool pendingEOF_ : 1;
   bool parserPaused_ : 1;
@@ -248,6 +277,21 @@ class HTTP1xCodec : public HTTPCodec {
   bool nativeUpgrade_ : 1;
   bool headersComplete_ : 1;
   bool releaseEgressAfterRequest_ : 1;
+  bool coalesceChunkedBody_ : 1;
+  std::unique_ptr<folly::IOBuf> pendingChunkedBody_;
+
+  // DOWNSTREAM: what the response to each request parsed and not yet
+  // answered needs of it, as later requests may be parsed meanwhile.
+  // UPSTREAM: the same for each request sent whose response is not yet
+  // complete, as later requests may be pipelined
+  struct RequestState {
+    StreamID txn;
+    KeepaliveRequested keepaliveRequested;
+    bool connect : 1;
+    bool head : 1;
+    bool mayChunkEgress : 1;
+  };
+  std::deque<RequestState> pendingRequests_;
 
   // C-callable wrappers for the http_parser callbacks
   static int onMessageBeginCB(http_parser* parser);
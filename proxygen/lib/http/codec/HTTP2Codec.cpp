@@ -10,6 +10,7 @@
 
 #include <folly/base64.h>
 #include <proxygen/lib/http/codec/CodecUtil.h>
+#include <proxygen/lib/http/codec/GrpcFraming.h>
 #include <proxygen/lib/http/codec/HTTP2Constants.h>
 #include <proxygen/lib/utils/Logging.h>
 
@@ -18,6 +19,7 @@
 #include <folly/Try.h>
 #include <folly/io/Cursor.h>
 #include <folly/tracing/ScopedTraceSection.h>
+#include <limits>
 #include <type_traits>
 
 using namespace folly::io;
@@ -29,6 +31,10 @@ namespace {
 const size_t kDefaultGrowth = 4000;
 constexpr auto kOkhttp = "okhttp/";
 constexpr int kOkhttpResetLogFreq = 1000;
+// Most flow-controlled padding one DATA frame can carry, length byte included
+constexpr uint16_t kMaxDataFramePadding = 256;
+// Largest TLS record plaintext, RFC 8446 section 5.1
+constexpr uint32_t kTLSRecordPayload = 16384;
 } // namespace
 
 namespace proxygen {
@@ -150,6 +156,8 @@ size_t HTTP2Codec::onIngress(const folly::IOBuf& buf) {
       }
     }
   }
+  // A run only ends early on error, deliver it ahead of the error
+  deliverCoalescedData();
   checkConnectionError(connError, &buf);
   return parsed;
 }
@@ -231,6 +239,13 @@ ErrorCode HTTP2Codec::parseFrame(folly::io::Cursor& cursor) {
     case http2::FrameType::ALTSVC:
       // fall through, unimplemented
       break;
+    case http2::FrameType::ORIGIN:
+      // Only meaningful to clients, and on stream 0
+      if (transportDirection_ == TransportDirection::UPSTREAM &&
+          curHeader_.stream == 0) {
+        return parseOrigin(cursor);
+      }
+      break;
     case http2::FrameType::CERTIFICATE_REQUEST:
       return parseCertificateRequest(cursor);
     case http2::FrameType::CERTIFICATE:
@@ -288,6 +303,15 @@ ErrorCode HTTP2Codec::parseAllData(Cursor& cursor) {
   auto ret = http2::parseData(cursor, curHeader_, outData, padding);
   RETURN_IF_ERROR(ret);
 
+  if (coalesceIngressData_) {
+    coalesceData(std::move(outData), padding);
+    if (nextFrameContinuesData(cursor)) {
+      return ErrorCode::NO_ERROR;
+    }
+    deliverCoalescedData();
+    return handleEndStream();
+  }
+
   if (callback_ && (padding > 0 || (outData && !outData->empty()))) {
     if (!outData) {
       outData = std::make_unique<IOBuf>();
@@ -301,6 +325,58 @@ ErrorCode HTTP2Codec::parseAllData(Cursor& cursor) {
   return handleEndStream();
 }
 
+void HTTP2Codec::coalesceData(std::unique_ptr<IOBuf> data,
+                              uint16_t padding) {
+  DCHECK(coalescedStream_ == 0 || coalescedStream_ == curHeader_.stream);
+  coalescedStream_ = curHeader_.stream;
+  coalescedPadding_ += padding;
+  if (!data || data->empty()) {
+    return;
+  }
+  if (coalescedData_) {
+    coalescedData_->appendToChain(std::move(data));
+  } else {
+    coalescedData_ = std::move(data);
+  }
+}
+
+bool HTTP2Codec::nextFrameContinuesData(const Cursor& cursor) const {
+  if ((curHeader_.flags & http2::END_STREAM) || ingressWebsocketUpgrade_ ||
+      coalescedPadding_ >
+          std::numeric_limits<uint16_t>::max() - kMaxDataFramePadding) {
+    return false;
+  }
+  Cursor peek(cursor);
+  if (!peek.canAdvance(http2::kFrameHeaderSize)) {
+    return false;
+  }
+  http2::FrameHeader next;
+  http2::parseFrameHeader(peek, next);
+  // Only whole frames, a partial one is delivered as it arrives
+  return next.type == http2::FrameType::DATA &&
+         next.stream == curHeader_.stream &&
+         next.length <= maxRecvFrameSize() && peek.canAdvance(next.length);
+}
+
+void HTTP2Codec::deliverCoalescedData() {
+  if (coalescedStream_ == 0) {
+    return;
+  }
+  auto stream = std::exchange(coalescedStream_, 0);
+  auto data = std::move(coalescedData_);
+  auto padding = std::exchange(coalescedPadding_, 0);
+  if (callback_ && (padding > 0 || data)) {
+    if (!data) {
+      data = std::make_unique<IOBuf>();
+    }
+    deliverCallbackIfAllowed(&HTTPCodec::Callback::onBody,
+                             "onBody",
+                             stream,
+                             std::move(data),
+                             padding);
+  }
+}
+
 ErrorCode HTTP2Codec::parseDataFrameData(Cursor& cursor,
                                          size_t bufLen,
                                          size_t& parsed) {
@@ -696,7 +772,18 @@ folly::Optional<ErrorCode> HTTP2Codec::parseHeadersCheckConcurrentStreams(
 
 void HTTP2Codec::onHeader(const HPACKHeaderName& name,
                           const folly::fbstring& value) {
-  if (decodeInfo_.onHeader(name, value)) {
+  onDecodedHeader(name, value, false);
+}
+
+void HTTP2Codec::onStaticHeader(const HPACKHeaderName& name,
+                                const folly::fbstring& value) {
+  onDecodedHeader(name, value, true);
+}
+
+void HTTP2Codec::onDecodedHeader(const HPACKHeaderName& name,
+                                 const folly::fbstring& value,
+                                 bool fromStaticTable) {
+  if (decodeInfo_.onHeader(name, value, fromStaticTable)) {
     if (userAgent_.empty() && name.getHeaderCode() == HTTP_HEADER_USER_AGENT) {
       userAgent_ = value.toStdString();
     }
@@ -1012,6 +1099,17 @@ ErrorCode HTTP2Codec::parseGoaway(Cursor& cursor) {
   return ErrorCode::NO_ERROR;
 }
 
+ErrorCode HTTP2Codec::parseOrigin(Cursor& cursor) {
+  VLOG(4) << "parsing ORIGIN frame length=" << curHeader_.length;
+  std::vector<std::string> origins;
+  auto err = http2::parseOrigin(cursor, curHeader_, origins);
+  RETURN_IF_ERROR(err);
+  if (callback_) {
+    callback_->onOrigin(origins);
+  }
+  return ErrorCode::NO_ERROR;
+}
+
 ErrorCode HTTP2Codec::parseWindowUpdate(Cursor& cursor) {
   VLOG(4) << "parsing WINDOW_UPDATE frame for stream=" << curHeader_.stream
           << " length=" << curHeader_.length;
@@ -1432,7 +1530,7 @@ size_t HTTP2Codec::generateBody(folly::IOBufQueue& writeBuf,
           << " size=" << (chain ? chain->computeChainDataLength() : 0);
   IOBufQueue queue(IOBufQueue::cacheChainLength());
   queue.append(std::move(chain));
-  size_t maxFrameSize = maxSendFrameSize();
+  size_t maxFrameSize = maxSendDataFrameSize();
   while (queue.chainLength() > maxFrameSize) {
     auto chunk = queue.split(maxFrameSize);
     written += generateHeaderCallbackWrapper(
@@ -1443,7 +1541,8 @@ size_t HTTP2Codec::generateBody(folly::IOBufQueue& writeBuf,
                          stream,
                          padding,
                          false,
-                         reuseIOBufHeadroomForData_));
+                         reuseIOBufHeadroomForData_,
+                         batchedEgress_));
   }
 
   return written + generateHeaderCallbackWrapper(
@@ -1454,7 +1553,23 @@ size_t HTTP2Codec::generateBody(folly::IOBufQueue& writeBuf,
                                         stream,
                                         padding,
                                         eom,
-                                        reuseIOBufHeadroomForData_));
+                                        reuseIOBufHeadroomForData_,
+                                        batchedEgress_));
+}
+
+uint32_t HTTP2Codec::getAdaptiveDataFrameSize(uint64_t cwndBytes,
+                                              uint32_t peerMaxFrameSize,
+                                              bool tls) {
+  auto size = static_cast<uint32_t>(
+      std::min<uint64_t>(std::max<uint64_t>(cwndBytes,
+                                            http2::kMaxFramePayloadLengthMin),
+                         peerMaxFrameSize));
+  if (tls) {
+    auto records = std::max<uint32_t>(
+        (size + http2::kFrameHeaderSize) / kTLSRecordPayload, 1);
+    size = records * kTLSRecordPayload - http2::kFrameHeaderSize;
+  }
+  return size;
 }
 
 size_t HTTP2Codec::generateChunkHeader(folly::IOBufQueue& /*writeBuf*/,
@@ -1478,15 +1593,22 @@ size_t HTTP2Codec::generateTrailers(folly::IOBufQueue& writeBuf,
     return generateEOM(writeBuf, stream);
   }
   VLOG(4) << "generating TRAILERS for stream=" << stream;
-  std::vector<compress::Header> allHeaders;
-  CodecUtil::appendHeaders(trailers, allHeaders, HTTP_HEADER_NONE);
-
   HTTPHeaderSize size{0, 0, 0};
   uint8_t headerSize = http2::kFrameHeaderSize;
   auto remainingFrameSize = maxSendFrameSize();
   auto frameHeader = writeBuf.preallocate(headerSize, kDefaultGrowth);
   writeBuf.postallocate(headerSize);
-  encodeHeaders(writeBuf, trailers, allHeaders, &size);
+  uint32_t grpcStatus = 0;
+  folly::StringPiece grpcMessage;
+  // A table size update must lead the next block, so it goes through HPACK
+  if (!headerCodec_.hasPendingContextUpdate() &&
+      grpc::getStatusTrailers(trailers, grpcStatus, grpcMessage)) {
+    size = grpc::appendHPACKStatusTrailers(writeBuf, grpcStatus, grpcMessage);
+  } else {
+    std::vector<compress::Header> allHeaders;
+    CodecUtil::appendHeaders(trailers, allHeaders, HTTP_HEADER_NONE);
+    encodeHeaders(writeBuf, trailers, allHeaders, &size);
+  }
   IOBufQueue queue(IOBufQueue::cacheChainLength());
   auto chunkLen =
       splitCompressed(size.compressed, remainingFrameSize, writeBuf, queue);
@@ -1526,7 +1648,8 @@ size_t HTTP2Codec::generateEOM(folly::IOBufQueue& writeBuf, StreamID stream) {
                        stream,
                        http2::kNoPadding,
                        true,
-                       reuseIOBufHeadroomForData_));
+                       reuseIOBufHeadroomForData_,
+                       batchedEgress_));
 }
 
 size_t HTTP2Codec::generateRstStream(folly::IOBufQueue& writeBuf,
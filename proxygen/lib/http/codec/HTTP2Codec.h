@@ -15,7 +15,9 @@
 #include <proxygen/lib/http/codec/HTTPSettings.h>
 #include <proxygen/lib/http/codec/HeaderDecodeInfo.h>
 #include <proxygen/lib/http/codec/compress/HPACKCodec.h>
+#include <proxygen/lib/utils/PooledObject.h>
 
+#include <algorithm>
 #include <bitset>
 #include <set>
 
@@ -27,10 +29,13 @@ namespace proxygen {
  */
 class HTTP2Codec
     : public HTTPParallelCodec
-    , HPACK::StreamingCallback {
+    , HPACK::StreamingCallback
+    , public PooledObject<HTTP2Codec> {
  public:
   void onHeader(const HPACKHeaderName& name,
                 const folly::fbstring& value) override;
+  void onStaticHeader(const HPACKHeaderName& name,
+                      const folly::fbstring& value) override;
   void onHeadersComplete(HTTPHeaderSize decodedSize, bool acknowledge) override;
   void onDecodeError(HPACK::DecodeError decodeError) override;
 
@@ -142,6 +147,9 @@ class HTTP2Codec
   void setHeaderCodecStats(HeaderCodec::Stats* hcStats) override {
     headerCodec_.setStats(hcStats);
   }
+  void releaseIdleMemory() override {
+    headerCodec_.releaseIdleMemory();
+  }
 
   bool isRequest(StreamID id) const {
     return ((transportDirection_ == TransportDirection::DOWNSTREAM &&
@@ -177,6 +185,43 @@ class HTTP2Codec
     reuseIOBufHeadroomForData_ = enabled;
   }
 
+  // Whether DATA frames should be packed together with the frames around
+  // them, so an egress loop produces few large IOBufs instead of a chain of
+  // frame headers and small bodies.  Bodies too large to copy cheaply are
+  // still chained as is.
+  void setBatchedEgress(bool enabled) {
+    batchedEgress_ = enabled;
+  }
+
+  // Whether whole DATA frames that follow one another on a stream within
+  // one read are delivered as a single onBody, their payloads chained
+  // without padding.  The chain still shares the read buffer, but the
+  // filters and the transaction handle one body per run instead of one per
+  // frame.
+  void setCoalesceIngressData(bool enabled) {
+    coalesceIngressData_ = enabled;
+  }
+
+  // Caps the payload of egress DATA frames below the peer's
+  // SETTINGS_MAX_FRAME_SIZE, 0 for the peer's limit alone.
+  void setEgressDataFrameSize(uint32_t size) {
+    egressDataFrameSize_ = size;
+  }
+
+  uint32_t getPeerMaxFrameSize() const {
+    return maxSendFrameSize();
+  }
+
+  /**
+   * The DATA payload to use over a connection with the given congestion
+   * window, 0 if unknown: one window per frame, between 16KB and the peer's
+   * maximum.  Over TLS a frame, header included, is trimmed to fill whole
+   * records.
+   */
+  static uint32_t getAdaptiveDataFrameSize(uint64_t cwndBytes,
+                                           uint32_t peerMaxFrameSize,
+                                           bool tls);
+
   void setHeaderIndexingStrategy(const HeaderIndexingStrategy* indexingStrat) {
     headerCodec_.setHeaderIndexingStrategy(indexingStrat);
   }
@@ -184,6 +229,11 @@ class HTTP2Codec
     return headerCodec_.getHeaderIndexingStrategy();
   }
 
+  // See HPACKCodec::setEncoderAdaptiveTableSize
+  void setAdaptiveHeaderTableSize(uint32_t initialSize) {
+    headerCodec_.setEncoderAdaptiveTableSize(initialSize);
+  }
+
   void setAddDateHeaderToResponse(bool addDateHeader) {
     addDateToResponse_ = addDateHeader;
   }
@@ -221,6 +271,9 @@ class HTTP2Codec
 
   ErrorCode parseFrame(folly::io::Cursor& cursor);
   ErrorCode parseAllData(folly::io::Cursor& cursor);
+  void coalesceData(std::unique_ptr<folly::IOBuf> data, uint16_t padding);
+  bool nextFrameContinuesData(const folly::io::Cursor& cursor) const;
+  void deliverCoalescedData();
   ErrorCode parseDataFrameData(folly::io::Cursor& cursor,
                                size_t bufLen,
                                size_t& parsed);
@@ -234,6 +287,7 @@ class HTTP2Codec
   ErrorCode parseGoaway(folly::io::Cursor& cursor);
   ErrorCode parseContinuation(folly::io::Cursor& cursor);
   ErrorCode parseWindowUpdate(folly::io::Cursor& cursor);
+  ErrorCode parseOrigin(folly::io::Cursor& cursor);
   ErrorCode parseCertificateRequest(folly::io::Cursor& cursor);
   ErrorCode parseCertificate(folly::io::Cursor& cursor);
   ErrorCode parseHeadersImpl(
@@ -281,6 +335,9 @@ class HTTP2Codec
 
   folly::Optional<ErrorCode> parseHeadersCheckConcurrentStreams(
       const folly::Optional<http2::PriorityUpdate>& priority);
+  void onDecodedHeader(const HPACKHeaderName& name,
+                       const folly::fbstring& value,
+                       bool fromStaticTable);
 
   ErrorCode handleEndStream();
   ErrorCode checkNewStream(uint32_t stream, bool trailersAllowed);
@@ -291,6 +348,12 @@ class HTTP2Codec
     return (uint32_t)ingressSettings_.getSetting(
         SettingsId::MAX_FRAME_SIZE, http2::kMaxFramePayloadLengthMin);
   }
+  size_t maxSendDataFrameSize() const {
+    auto peerMax = maxSendFrameSize();
+    return egressDataFrameSize_ > 0
+               ? std::min<size_t>(egressDataFrameSize_, peerMax)
+               : peerMax;
+  }
   uint32_t maxRecvFrameSize() const {
     return (uint32_t)egressSettings_.getSetting(
         SettingsId::MAX_FRAME_SIZE, http2::kMaxFramePayloadLengthMin);
@@ -352,6 +415,13 @@ class HTTP2Codec
   std::vector<StreamID> virtualPriorityNodes_;
   folly::Optional<uint32_t> pendingTableMaxSize_;
   bool reuseIOBufHeadroomForData_{true};
+  bool batchedEgress_{false};
+  uint32_t egressDataFrameSize_{0};
+  bool coalesceIngressData_{false};
+  // The DATA run not delivered yet, coalescedStream_ is 0 when there is none
+  StreamID coalescedStream_{0};
+  uint16_t coalescedPadding_{0};
+  std::unique_ptr<folly::IOBuf> coalescedData_;
 
   // True if last parsed HEADERS frame was trailers.
   // Reset only when HEADERS frame is parsed, thus
@@ -17,6 +17,7 @@ namespace proxygen { namespace http2 {
 
 const uint8_t kMinExperimentalFrameType = 0xf0;
 const Padding kNoPadding = folly::none;
+const uint32_t kBatchedEgressGrowth = 4000;
 const PriorityUpdate DefaultPriority{0, false, 15};
 
 namespace {
@@ -123,7 +124,8 @@ size_t writeFrameHeader(IOBufQueue& queue,
                         folly::Optional<uint8_t> padding,
                         folly::Optional<PriorityUpdate> priority,
                         std::unique_ptr<IOBuf> payload,
-                        bool reuseIOBufHeadroom = true) noexcept {
+                        bool reuseIOBufHeadroom = true,
+                        bool packPayload = false) noexcept {
   size_t headerSize = kFrameHeaderSize;
   uint32_t lengthAndType = computeLengthAndType(
       length, type, flags, stream, padding, priority, headerSize);
@@ -141,7 +143,10 @@ size_t writeFrameHeader(IOBufQueue& queue,
     queue.append(std::move(payload));
     payload = std::move(tail);
   }
-  QueueAppender appender(&queue, headerSize);
+  // When packing, leave room for the frames that follow rather than
+  // allocating a buffer that only fits this header
+  QueueAppender appender(&queue,
+                         packPayload ? kBatchedEgressGrowth : headerSize);
   appender.writeBE<uint32_t>(lengthAndType);
   appender.writeBE<uint8_t>(flags);
   appender.writeBE<uint32_t>(kUint31Mask & stream);
@@ -159,7 +164,9 @@ size_t writeFrameHeader(IOBufQueue& queue,
   if (payloadLength) {
     queue.postallocate(payloadLength);
   }
-  queue.append(std::move(payload));
+  // pack copies payloads that fit in the tailroom (up to 4KB), larger ones
+  // are chained
+  queue.append(std::move(payload), packPayload);
 
   return length;
 }
@@ -288,7 +295,8 @@ ErrorCode skipPadding(Cursor& cursor, uint8_t length, bool verify) {
 bool isValidFrameType(FrameType type) {
   auto val = static_cast<uint8_t>(type);
   if (val < kMinExperimentalFrameType) {
-    return val <= static_cast<uint8_t>(FrameType::ALTSVC);
+    return val <= static_cast<uint8_t>(FrameType::ALTSVC) ||
+           type == FrameType::ORIGIN;
   } else {
     switch (type) {
       case FrameType::EX_HEADERS:
@@ -611,6 +619,26 @@ ErrorCode parseAltSvc(Cursor& cursor,
   return ErrorCode::NO_ERROR;
 }
 
+ErrorCode parseOrigin(Cursor& cursor,
+                      const FrameHeader& header,
+                      std::vector<std::string>& outOrigins) noexcept {
+  DCHECK_LE(header.length, cursor.totalLength());
+  auto remaining = header.length;
+  while (remaining > 0) {
+    if (remaining < sizeof(uint16_t)) {
+      return ErrorCode::FRAME_SIZE_ERROR;
+    }
+    const auto originLen = cursor.readBE<uint16_t>();
+    remaining -= sizeof(uint16_t);
+    if (remaining < originLen) {
+      return ErrorCode::FRAME_SIZE_ERROR;
+    }
+    outOrigins.push_back(cursor.readFixedString(originLen));
+    remaining -= originLen;
+  }
+  return ErrorCode::NO_ERROR;
+}
+
 ErrorCode parseCertificateRequest(
     folly::io::Cursor& cursor,
     const FrameHeader& header,
@@ -660,7 +688,8 @@ size_t writeData(IOBufQueue& queue,
                  uint32_t stream,
                  folly::Optional<uint8_t> padding,
                  bool endStream,
-                 bool reuseIOBufHeadroom) noexcept {
+                 bool reuseIOBufHeadroom,
+                 bool batchEgress) noexcept {
   DCHECK_NE(0, stream);
   uint8_t flags = 0;
   if (endStream) {
@@ -677,7 +706,8 @@ size_t writeData(IOBufQueue& queue,
                                          padding,
                                          folly::none,
                                          std::move(data),
-                                         reuseIOBufHeadroom);
+                                         reuseIOBufHeadroom,
+                                         batchEgress);
   writePadding(queue, padding);
   return kFrameHeaderSize + frameLen;
 }
@@ -970,6 +1000,30 @@ size_t writeAltSvc(IOBufQueue& queue,
   return kFrameHeaderSize + frameLen;
 }
 
+size_t writeOrigin(IOBufQueue& queue,
+                   const std::vector<std::string>& origins) noexcept {
+  size_t frameLen = 0;
+  for (const auto& origin : origins) {
+    frameLen += sizeof(uint16_t) + origin.size();
+  }
+  // The ORIGIN frame must be sent on stream 0.
+  writeFrameHeader(queue,
+                   frameLen,
+                   FrameType::ORIGIN,
+                   0,
+                   0,
+                   kNoPadding,
+                   folly::none,
+                   nullptr);
+  QueueAppender appender(&queue, frameLen);
+  for (const auto& origin : origins) {
+    appender.writeBE<uint16_t>(origin.size());
+    appender.push(reinterpret_cast<const uint8_t*>(origin.data()),
+                  origin.size());
+  }
+  return kFrameHeaderSize + frameLen;
+}
+
 size_t writeCertificateRequest(folly::IOBufQueue& writeBuf,
                                uint16_t requestId,
                                std::unique_ptr<folly::IOBuf> authRequest) {
@@ -1042,6 +1096,8 @@ const char* getFrameTypeString(FrameType type) {
       return "CONTINUATION";
     case FrameType::ALTSVC:
       return "ALTSVC";
+    case FrameType::ORIGIN:
+      return "ORIGIN";
     case FrameType::CERTIFICATE_REQUEST:
       return "CERTIFICATE_REQUEST";
     case FrameType::CERTIFICATE:
@@ -28,6 +28,8 @@ namespace proxygen { namespace http2 {
 extern const uint8_t kMinExperimentalFrameType;
 using Padding = folly::Optional<uint8_t>;
 extern const Padding kNoPadding;
+// Buffer growth for frame headers when egress is batched
+extern const uint32_t kBatchedEgressGrowth;
 
 //////// Types ////////
 
@@ -43,6 +45,7 @@ enum class FrameType : uint8_t {
   WINDOW_UPDATE = 8,
   CONTINUATION = 9,
   ALTSVC = 10, // not in current draft so frame type has not been assigned
+  ORIGIN = 12, // RFC 8336
 
   // experimental use
   EX_HEADERS = 0xfb,
@@ -327,6 +330,21 @@ ErrorCode parseAltSvc(folly::io::Cursor& cursor,
                       std::string& outHost,
                       std::string& outOrigin) noexcept;
 
+/**
+ * This function parses the section of the ORIGIN frame after the common
+ * frame header. The caller must ensure there is header.length bytes
+ * available in the cursor.
+ *
+ * @param cursor The cursor to pull data from.
+ * @param header The frame header for the frame being parsed.
+ * @param outOrigins The ASCII serialized origins of the origin set.
+ * @return NO_ERROR for successful parse. The connection error code to
+ *         return in a GOAWAY frame if failure.
+ */
+ErrorCode parseOrigin(folly::io::Cursor& cursor,
+                      const FrameHeader& header,
+                      std::vector<std::string>& outOrigins) noexcept;
+
 /**
  * This function parses the section of the CERTIFICATE_REQUEST frame after the
  * common frame header.  It pulls header.length bytes from the cursor, so it is
@@ -378,6 +396,10 @@ ErrorCode parseCertificate(
  * @param endStream True iff this frame ends the stream.
  * @param reuseIOBufHeadroom If HTTP2Framer should reuse headroom in data if
  *                           headroom is enough for frame header
+ * @param batchEgress If true, the frame header is written into a buffer with
+ *                    room for the frames that follow, and small data is
+ *                    copied next to it instead of being chained. Large data
+ *                    is still chained without copying.
  * @return The number of bytes written to writeBuf.
  */
 size_t writeData(folly::IOBufQueue& writeBuf,
@@ -385,7 +407,8 @@ size_t writeData(folly::IOBufQueue& writeBuf,
                  uint32_t stream,
                  folly::Optional<uint8_t> padding,
                  bool endStream,
-                 bool reuseIOBufHeadroom) noexcept;
+                 bool reuseIOBufHeadroom,
+                 bool batchEgress = false) noexcept;
 
 /**
  * Generate an entire HEADERS frame, including the common frame header. The
@@ -604,6 +627,17 @@ size_t writeAltSvc(folly::IOBufQueue& writeBuf,
                    folly::StringPiece host,
                    folly::StringPiece origin) noexcept;
 
+/**
+ * Generate an entire ORIGIN frame, including the common frame header.
+ *
+ * @param writeBuf The output queue to write to. It may grow or add
+ *                 underlying buffers inside this function.
+ * @param origins The ASCII serialized origins, e.g. "https://example.com".
+ * @return The number of bytes written to writeBuf.
+ */
+size_t writeOrigin(folly::IOBufQueue& writeBuf,
+                   const std::vector<std::string>& origins) noexcept;
+
 /**
  * Generate an entire CERTIFICATE_REQUEST frame, including the common frame
  * header.
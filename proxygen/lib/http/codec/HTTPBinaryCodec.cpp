@@ -23,6 +23,32 @@ void encodeString(folly::StringPiece str, folly::io::QueueAppender& appender) {
   encodeInteger(str.size(), appender);
   appender.pushAtMost((const uint8_t*)str.data(), str.size());
 }
+
+// Field names and values are read straight out of the ingress buffer unless
+// they are split across IOBufs
+HPACKHeaderName readHeaderName(folly::io::Cursor& cursor, size_t length) {
+  auto bytes = cursor.peekBytes();
+  if (bytes.size() >= length) {
+    HPACKHeaderName name(
+        folly::StringPiece((const char*)bytes.data(), length));
+    cursor.skip(length);
+    return name;
+  }
+  return HPACKHeaderName(folly::StringPiece(cursor.readFixedString(length)));
+}
+
+void readHeaderValue(folly::io::Cursor& cursor,
+                     size_t length,
+                     folly::fbstring& value) {
+  auto bytes = cursor.peekBytes();
+  if (bytes.size() >= length) {
+    value.assign((const char*)bytes.data(), length);
+    cursor.skip(length);
+  } else {
+    value.resize(length);
+    cursor.pull(&value[0], length);
+  }
+}
 } // namespace
 
 HTTPBinaryCodec::HTTPBinaryCodec(TransportDirection direction) {
@@ -61,10 +87,6 @@ ParseResult HTTPBinaryCodec::parseFramingIndicator(folly::io::Cursor& cursor,
   request = ((framingIndicator->first & 0x01) == 0);
   // Set knownLength to true if framingIndicator is 0 or 1
   knownLength = ((framingIndicator->first & 0x02) == 0);
-  if (!knownLength) {
-    return folly::makeUnexpected(
-        std::string("Unsupported indeterminate length Binary HTTP Request"));
-  }
   return parsed;
 }
 
@@ -185,6 +207,10 @@ ParseResult HTTPBinaryCodec::parseHeadersHelper(folly::io::Cursor& cursor,
                                                 size_t remaining,
                                                 HeaderDecodeInfo& decodeInfo,
                                                 bool isTrailers) {
+  if (!knownLength_) {
+    return parseIndeterminateLengthHeaders(
+        cursor, remaining, decodeInfo, isTrailers);
+  }
   size_t parsed = 0;
 
   // Parse length of headers and advance cursor
@@ -214,30 +240,61 @@ ParseResult HTTPBinaryCodec::parseHeadersHelper(folly::io::Cursor& cursor,
 
   auto numHeaders = 0;
   while (parsed < lengthOfHeaders->first) {
-    std::string headerName;
-    auto headerNameRes =
-        parseKnownLengthString(cursor, remaining, "headerName", headerName);
-    if (headerNameRes.hasError()) {
-      return headerNameRes;
+    auto nameLength = quic::decodeQuicInteger(cursor);
+    if (!nameLength) {
+      return folly::makeUnexpected(
+          std::string("Failure to parse: headerName length"));
+    }
+    parsed += nameLength->second;
+    remaining -= nameLength->second;
+
+    auto fieldLineRes =
+        parseFieldLine(cursor, remaining, nameLength->first, decodeInfo);
+    if (fieldLineRes.hasError()) {
+      return fieldLineRes;
+    }
+    parsed += *fieldLineRes;
+    remaining -= *fieldLineRes;
+    numHeaders++;
+  }
+  if (numHeaders < 1 && !isTrailers) {
+    return folly::makeUnexpected(
+        fmt::format("Number of headers (key value pairs) should be >= 1. "
+                    "Header count is {}",
+                    numHeaders));
+  }
+
+  return parsed;
+}
+
+ParseResult HTTPBinaryCodec::parseIndeterminateLengthHeaders(
+    folly::io::Cursor& cursor,
+    size_t remaining,
+    HeaderDecodeInfo& decodeInfo,
+    bool isTrailers) {
+  size_t parsed = 0;
+
+  auto numHeaders = 0;
+  while (true) {
+    // A zero length name is the Content Terminator of the field section
+    auto nameLength = quic::decodeQuicInteger(cursor);
+    if (!nameLength) {
+      return folly::makeUnexpected(
+          std::string("Failure to parse: headerName length"));
     }
-    parsed += *headerNameRes;
-    remaining -= *headerNameRes;
-
-    std::string headerValue;
-    auto headerValueRes =
-        parseKnownLengthString(cursor, remaining, "headerValue", headerValue);
-    if (headerValueRes.hasError()) {
-      return headerValueRes;
+    parsed += nameLength->second;
+    remaining -= nameLength->second;
+    if (nameLength->first == 0) {
+      break;
     }
-    parsed += *headerValueRes;
-    remaining -= *headerValueRes;
-
-    if (!decodeInfo.onHeader(proxygen::HPACKHeaderName(headerName),
-                             headerValue) ||
-        !decodeInfo.parsingError.empty()) {
-      return folly::makeUnexpected(fmt::format(
-          "Error parsing field section (Error: {})", decodeInfo.parsingError));
+
+    auto fieldLineRes =
+        parseFieldLine(cursor, remaining, nameLength->first, decodeInfo);
+    if (fieldLineRes.hasError()) {
+      return fieldLineRes;
     }
+    parsed += *fieldLineRes;
+    remaining -= *fieldLineRes;
     numHeaders++;
   }
   if (numHeaders < 1 && !isTrailers) {
@@ -250,6 +307,39 @@ ParseResult HTTPBinaryCodec::parseHeadersHelper(folly::io::Cursor& cursor,
   return parsed;
 }
 
+ParseResult HTTPBinaryCodec::parseFieldLine(folly::io::Cursor& cursor,
+                                            size_t remaining,
+                                            uint64_t nameLength,
+                                            HeaderDecodeInfo& decodeInfo) {
+  size_t parsed = 0;
+
+  if (nameLength > remaining) {
+    return folly::makeUnexpected(std::string("Failure to parse: headerName"));
+  }
+  auto headerName = readHeaderName(cursor, nameLength);
+  parsed += nameLength;
+
+  auto valueLength = quic::decodeQuicInteger(cursor);
+  if (!valueLength) {
+    return folly::makeUnexpected(
+        std::string("Failure to parse: headerValue length"));
+  }
+  parsed += valueLength->second;
+  if (parsed > remaining || valueLength->first > remaining - parsed) {
+    return folly::makeUnexpected(std::string("Failure to parse: headerValue"));
+  }
+  folly::fbstring headerValue;
+  readHeaderValue(cursor, valueLength->first, headerValue);
+  parsed += valueLength->first;
+
+  if (!decodeInfo.onHeader(headerName, headerValue) ||
+      !decodeInfo.parsingError.empty()) {
+    return folly::makeUnexpected(fmt::format(
+        "Error parsing field section (Error: {})", decodeInfo.parsingError));
+  }
+  return parsed;
+}
+
 ParseResult HTTPBinaryCodec::parseHeaders(folly::io::Cursor& cursor,
                                           size_t remaining,
                                           HeaderDecodeInfo& decodeInfo) {
@@ -259,6 +349,9 @@ ParseResult HTTPBinaryCodec::parseHeaders(folly::io::Cursor& cursor,
 ParseResult HTTPBinaryCodec::parseContent(folly::io::Cursor& cursor,
                                           size_t remaining,
                                           HTTPMessage& msg) {
+  if (!knownLength_) {
+    return parseIndeterminateLengthContent(cursor, remaining);
+  }
   size_t parsed = 0;
 
   // Parse the contentLength and advance cursor
@@ -286,6 +379,34 @@ ParseResult HTTPBinaryCodec::parseContent(folly::io::Cursor& cursor,
   return parsed;
 }
 
+ParseResult HTTPBinaryCodec::parseIndeterminateLengthContent(
+    folly::io::Cursor& cursor, size_t remaining) {
+  size_t parsed = 0;
+
+  // The chunks are cloned out of the ingress buffer and chained together
+  folly::IOBufQueue body{folly::IOBufQueue::cacheChainLength()};
+  while (true) {
+    auto chunkLength = quic::decodeQuicInteger(cursor);
+    if (!chunkLength) {
+      return folly::makeUnexpected(
+          std::string("Failure to parse content chunk length"));
+    }
+    parsed += chunkLength->second;
+    if (chunkLength->first == 0) {
+      break;
+    }
+    if (chunkLength->first > remaining - parsed) {
+      return folly::makeUnexpected(std::string("Failure to parse content"));
+    }
+    std::unique_ptr<folly::IOBuf> chunk;
+    cursor.clone(chunk, chunkLength->first);
+    body.append(std::move(chunk));
+    parsed += chunkLength->first;
+  }
+  msgBody_ = body.move();
+  return parsed;
+}
+
 ParseResult HTTPBinaryCodec::parseTrailers(folly::io::Cursor& cursor,
                                            size_t remaining,
                                            HeaderDecodeInfo& decodeInfo) {
@@ -456,6 +577,19 @@ void HTTPBinaryCodec::onIngressEOF() {
 
 size_t HTTPBinaryCodec::generateHeaderHelper(folly::io::QueueAppender& appender,
                                              const HTTPHeaders& headers) {
+  if (egressIndeterminateLength_) {
+    // Field lines followed by a Content Terminator, no length pass needed
+    size_t headersLength = 0;
+    headers.forEach([&](folly::StringPiece name, folly::StringPiece value) {
+      headersLength += quic::getQuicIntegerSize(name.size()).value() +
+                       name.size() +
+                       quic::getQuicIntegerSize(value.size()).value() +
+                       value.size();
+      encodeString(name, appender);
+      encodeString(value, appender);
+    });
+    return headersLength + encodeInteger(0, appender).value();
+  }
   // Calculate the number of bytes it will take to encode all the headers
   size_t headersLength = 0;
   headers.forEach([&](folly::StringPiece name, folly::StringPiece value) {
@@ -484,11 +618,16 @@ void HTTPBinaryCodec::generateHeader(
     HTTPHeaderSize* size,
     const folly::Optional<HTTPHeaders>& extraHeaders) {
   folly::io::QueueAppender appender(&writeBuf, queueAppenderMaxGrowth);
+  egressTrailersSent_ = false;
   if (transportDirection_ == TransportDirection::DOWNSTREAM) {
     // Encode Framing Indicator for Request
-    encodeInteger(folly::to<uint64_t>(
-                      HTTPBinaryCodec::FramingIndicator::REQUEST_KNOWN_LENGTH),
-                  appender);
+    encodeInteger(
+        folly::to<uint64_t>(
+            egressIndeterminateLength_
+                ? HTTPBinaryCodec::FramingIndicator::
+                      REQUEST_INDETERMINATE_LENGTH
+                : HTTPBinaryCodec::FramingIndicator::REQUEST_KNOWN_LENGTH),
+        appender);
     // Encode Request Control Data
     encodeString(msg.getMethodString(), appender);
     encodeString(msg.isSecure() ? "https" : "http", appender);
@@ -501,13 +640,20 @@ void HTTPBinaryCodec::generateHeader(
     }
     encodeString(pathWithQueryString, appender);
   } else {
-    encodeInteger(folly::to<uint64_t>(
-                      HTTPBinaryCodec::FramingIndicator::RESPONSE_KNOWN_LENGTH),
-                  appender);
+    encodeInteger(
+        folly::to<uint64_t>(
+            egressIndeterminateLength_
+                ? HTTPBinaryCodec::FramingIndicator::
+                      RESPONSE_INDETERMINATE_LENGTH
+                : HTTPBinaryCodec::FramingIndicator::RESPONSE_KNOWN_LENGTH),
+        appender);
     // Response Control Data
     encodeInteger(msg.getStatusCode(), appender);
   }
   generateHeaderHelper(appender, msg.getHeaders());
+  if (eom && egressIndeterminateLength_) {
+    generateEOM(writeBuf, txn);
+  }
 }
 
 size_t HTTPBinaryCodec::generateBody(folly::IOBufQueue& writeBuf,
@@ -517,7 +663,8 @@ size_t HTTPBinaryCodec::generateBody(folly::IOBufQueue& writeBuf,
                                      bool eom) {
   folly::io::QueueAppender appender(&writeBuf, queueAppenderMaxGrowth);
   size_t lengthWritten = 0;
-  if (chain) {
+  // An empty chunk would end indeterminate-length content
+  if (chain && (!egressIndeterminateLength_ || !chain->empty())) {
     lengthWritten = chain->computeChainDataLength();
     encodeInteger(lengthWritten, appender);
     appender.insert(std::move(chain));
@@ -533,7 +680,13 @@ size_t HTTPBinaryCodec::generateTrailers(folly::IOBufQueue& writeBuf,
                                          StreamID txn,
                                          const HTTPHeaders& trailers) {
   folly::io::QueueAppender appender(&writeBuf, queueAppenderMaxGrowth);
-  auto trailersLengthWritten = generateHeaderHelper(appender, trailers);
+  size_t trailersLengthWritten = 0;
+  if (egressIndeterminateLength_) {
+    // Content Terminator
+    trailersLengthWritten += encodeInteger(0, appender).value();
+    egressTrailersSent_ = true;
+  }
+  trailersLengthWritten += generateHeaderHelper(appender, trailers);
   encodeInteger(0, appender);
   trailersLengthWritten++;
 
@@ -541,7 +694,14 @@ size_t HTTPBinaryCodec::generateTrailers(folly::IOBufQueue& writeBuf,
 }
 
 size_t HTTPBinaryCodec::generateEOM(folly::IOBufQueue& writeBuf, StreamID txn) {
-  return 0;
+  if (!egressIndeterminateLength_ || egressTrailersSent_) {
+    return 0;
+  }
+  // Terminate the content and an empty trailer section
+  folly::io::QueueAppender appender(&writeBuf, queueAppenderMaxGrowth);
+  egressTrailersSent_ = true;
+  return encodeInteger(0, appender).value() +
+         encodeInteger(0, appender).value();
 }
 
 size_t HTTPBinaryCodec::generateChunkHeader(folly::IOBufQueue& writeBuf,
@@ -21,7 +21,9 @@ using ParseResult = folly::Expected<size_t, std::string>;
 /* The HTTPBinaryCodec class is an implementation of the "Binary Representation
  * of HTTP Messages" RFC -
  * (https://datatracker.ietf.org/doc/html/draft-ietf-httpbis-binary-message-01).
- * We currently only support the "Known Length Messages" mode.
+ * Both "Known Length Messages" and "Indeterminate Length Messages" are parsed;
+ * messages are generated in known-length form unless
+ * setEgressIndeterminateLength is set.
  */
 class HTTPBinaryCodec : public HTTPCodec {
  public:
@@ -49,6 +51,12 @@ class HTTPBinaryCodec : public HTTPCodec {
   void setCallback(Callback* callback) override {
     callback_ = callback;
   }
+  // Generate indeterminate-length messages, whose content is a sequence of
+  // chunks, so a relay can pass each body on as it arrives without knowing
+  // the total length up front
+  void setEgressIndeterminateLength(bool indeterminate) {
+    egressIndeterminateLength_ = indeterminate;
+  }
   bool isBusy() const override {
     return false;
   }
@@ -121,6 +129,19 @@ class HTTPBinaryCodec : public HTTPCodec {
    *    Known-Length Field Section (..),
    *    Padding (..),
    *  }
+   *
+   * Message with Indeterminate-Length {
+   *    Framing Indicator (i) = 2..3,
+   *    Indeterminate-Length Informational Response (..),
+   *    Control Data (..),
+   *    Indeterminate-Length Field Section (..),
+   *    Indeterminate-Length Content (..),
+   *    Indeterminate-Length Field Section (..),
+   *    Padding (..),
+   *  }
+   *
+   * where indeterminate-length field sections and content are terminated by
+   * a zero length field name or content chunk.
    */
   ParseResult parseFramingIndicator(folly::io::Cursor& cursor,
                                     bool& request,
@@ -148,6 +169,17 @@ class HTTPBinaryCodec : public HTTPCodec {
                                  size_t remaining,
                                  HeaderDecodeInfo& decodeInfo,
                                  bool isTrailers);
+  ParseResult parseIndeterminateLengthHeaders(folly::io::Cursor& cursor,
+                                              size_t remaining,
+                                              HeaderDecodeInfo& decodeInfo,
+                                              bool isTrailers);
+  // Parses the rest of a field line once its name length has been read
+  ParseResult parseFieldLine(folly::io::Cursor& cursor,
+                             size_t remaining,
+                             uint64_t nameLength,
+                             HeaderDecodeInfo& decodeInfo);
+  ParseResult parseIndeterminateLengthContent(folly::io::Cursor& cursor,
+                                              size_t remaining);
   size_t generateHeaderHelper(folly::io::QueueAppender& appender,
                               const HTTPHeaders& headers);
 
@@ -175,6 +207,11 @@ class HTTPBinaryCodec : public HTTPCodec {
 
   const size_t queueAppenderMaxGrowth = 256;
 
+  bool egressIndeterminateLength_{false};
+  // Whether the content terminator and trailers of an indeterminate-length
+  // message have been written
+  bool egressTrailersSent_{false};
+
   // This callback_ will be how we return decoded responses to the caller
   HTTPCodec::Callback* callback_;
 
@@ -10,43 +10,31 @@
 
 #include <proxygen/lib/http/RFC2616.h>
 
-namespace proxygen {
+namespace proxygen::detail {
 
-void HTTPChecks::onHeadersComplete(StreamID stream,
-                                   std::unique_ptr<HTTPMessage> msg) {
-
-  if (msg->isRequest() &&
-      (RFC2616::isRequestBodyAllowed(msg->getMethod()) ==
+folly::Optional<HTTPException> checkIngressHeaders(const HTTPMessage& msg) {
+  if (msg.isRequest() &&
+      (RFC2616::isRequestBodyAllowed(msg.getMethod()) ==
        RFC2616::BodyAllowed::NOT_ALLOWED) &&
-      RFC2616::bodyImplied(msg->getHeaders())) {
+      RFC2616::bodyImplied(msg.getHeaders())) {
     HTTPException ex(HTTPException::Direction::INGRESS,
                      "RFC2616: Request Body Not Allowed");
     ex.setProxygenError(kErrorParseHeader);
     // setting the status code means that the error is at the HTTP layer and
     // that parsing succeeded.
     ex.setHttpStatusCode(400);
-    callback_->onError(stream, ex, true);
-    return;
+    return ex;
   }
-
-  callback_->onHeadersComplete(stream, std::move(msg));
+  return folly::none;
 }
 
-void HTTPChecks::generateHeader(
-    folly::IOBufQueue& writeBuf,
-    StreamID stream,
-    const HTTPMessage& msg,
-    bool eom,
-    HTTPHeaderSize* sizeOut,
-    const folly::Optional<HTTPHeaders>& extraHeaders) {
+void checkEgressHeaders(const HTTPMessage& msg) {
   if (msg.isRequest() && RFC2616::bodyImplied(msg.getHeaders())) {
     CHECK(RFC2616::isRequestBodyAllowed(msg.getMethod()) !=
           RFC2616::BodyAllowed::NOT_ALLOWED);
     // We could also add a "strict" mode that disallows sending body on GET
     // requests here too.
   }
-
-  call_->generateHeader(writeBuf, stream, msg, eom, sizeOut, extraHeaders);
 }
 
-} // namespace proxygen
+} // namespace proxygen::detail
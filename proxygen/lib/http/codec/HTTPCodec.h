@@ -277,6 +277,15 @@ class HTTPCodec {
     virtual void onSettingsAck() {
     }
 
+    /**
+     * Called upon receipt of an ORIGIN frame (RFC 8336), for protocols that
+     * support it.
+     *
+     * @param origins the origins to add to the origin set of the connection
+     */
+    virtual void onOrigin(const std::vector<std::string>& /* origins */) {
+    }
+
     /**
      * Called upon receipt of a priority frame, for protocols that support
      * dynamic priority
@@ -796,6 +805,13 @@ class HTTPCodec {
   virtual void setHeaderCodecStats(HeaderCodec::Stats* /* stats */) {
   }
 
+  /**
+   * Called when the session has no transactions: frees what the codec can
+   * rebuild, leaving the protocol state as is.
+   */
+  virtual void releaseIdleMemory() {
+  }
+
   /**
    * Get the identifier of the last stream started by the remote.
    */
@@ -30,6 +30,15 @@ class HTTPCodecFactory {
                                               TransportDirection direction,
                                               bool isTLS) = 0;
 
+  /**
+   * A copy for the thread of one acceptor, so the threads of a server don't
+   * share the factory, or nullptr (the default) to share this one.  Changes
+   * to this factory don't apply to its clones.
+   */
+  virtual std::unique_ptr<HTTPCodecFactory> clone() const {
+    return nullptr;
+  }
+
   static std::unique_ptr<HTTPCodec> getCodec(CodecProtocol protocol,
                                              TransportDirection direction,
                                              bool strictValidation = false);
@@ -104,6 +104,11 @@ void PassThroughHTTPCodecFilter::onSettingsAck() {
   callback_->onSettingsAck();
 }
 
+void PassThroughHTTPCodecFilter::onOrigin(
+    const std::vector<std::string>& origins) {
+  callback_->onOrigin(origins);
+}
+
 void PassThroughHTTPCodecFilter::onPriority(
     StreamID stream, const HTTPMessage::HTTP2Priority& pri) {
   callback_->onPriority(stream, pri);
@@ -391,6 +396,10 @@ void PassThroughHTTPCodecFilter::setHeaderCodecStats(
   call_->setHeaderCodecStats(stats);
 }
 
+void PassThroughHTTPCodecFilter::releaseIdleMemory() {
+  call_->releaseIdleMemory();
+}
+
 HTTPCodec::StreamID PassThroughHTTPCodecFilter::getLastIncomingStreamID()
     const {
   return call_->getLastIncomingStreamID();
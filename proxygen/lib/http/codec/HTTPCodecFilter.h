@@ -87,6 +87,8 @@ class PassThroughHTTPCodecFilter : public HTTPCodecFilter {
 
   void onSettingsAck() override;
 
+  void onOrigin(const std::vector<std::string>& origins) override;
+
   void onPriority(StreamID stream,
                   const HTTPMessage::HTTP2Priority& pri) override;
 
@@ -252,6 +254,8 @@ class PassThroughHTTPCodecFilter : public HTTPCodecFilter {
 
   void setHeaderCodecStats(HeaderCodec::Stats* stats) override;
 
+  void releaseIdleMemory() override;
+
   void enableDoubleGoawayDrain() override;
 
   HTTPCodec::StreamID getLastIncomingStreamID() const override;
@@ -60,6 +60,21 @@ class HTTPRequestVerifier {
     }
     hasPath_ = true;
     assert(msg_ != nullptr);
+    // An origin-form path, validated above, needs no more parsing than
+    // finding its query
+    auto queryStart = path.find('?');
+    auto hashStart = std::min(path.find('#'), path.size());
+    if (!path.empty() && path.front() == '/' &&
+        (queryStart == std::string::npos || queryStart < hashStart)) {
+      HTTPMessage::URLOffsets offsets;
+      offsets.pathLength = std::min(queryStart, hashStart);
+      if (queryStart != std::string::npos) {
+        offsets.queryStart = queryStart + 1;
+        offsets.queryLength = hashStart - offsets.queryStart;
+      }
+      msg_->setURL(path.str(), offsets);
+      return true;
+    }
     // Relax strictValidation here if empty paths are allowed and it's empty
     strictValidation &= !(allowEmptyPath && path.empty());
     auto parseUrl = msg_->setURL(path.str(), strictValidation);
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace proxygen {
+
+/**
+ * Vectorized prefix scans behind CodecUtil's header validation.  Each
+ * returns the length of a prefix of [p, end) made of octets in a
+ * class that is valid in every validation mode, so a validator can skip
+ * that prefix and check the rest byte by byte.  The scans only take whole
+ * vectors and may stop early on a valid octet, the byte-at-a-time check
+ * decides the rest; without vector support they skip nothing.
+ */
+namespace header_scan {
+
+#if defined(__GNUC__) && !defined(__AVX2__) && !defined(__SSE2__) && \
+    defined(__ARM_NEON)
+// Collapse a 0x00/0xff byte mask into 4 bits per lane
+inline uint64_t neonMask(uint8x16_t v) {
+  return vget_lane_u64(
+      vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+}
+#endif
+
+// Lowercase tchar subset, [a-z0-9-], as HTTP/2 and HTTP/3 require
+inline size_t scanHeaderName(const uint8_t* p, const uint8_t* end) {
+  const uint8_t* start = p;
+#if defined(__GNUC__) && defined(__AVX2__)
+  const __m256i a = _mm256_set1_epi8('a');
+  const __m256i zero = _mm256_set1_epi8('0');
+  const __m256i dash = _mm256_set1_epi8('-');
+  const __m256i alphaMax = _mm256_set1_epi8(25);
+  const __m256i digitMax = _mm256_set1_epi8(9);
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    __m256i alpha = _mm256_sub_epi8(v, a);
+    __m256i digit = _mm256_sub_epi8(v, zero);
+    __m256i ok = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, alphaMax), alpha);
+    ok = _mm256_or_si256(
+        ok, _mm256_cmpeq_epi8(_mm256_min_epu8(digit, digitMax), digit));
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(v, dash));
+    auto mask = ~(uint32_t)_mm256_movemask_epi8(ok);
+    if (mask) {
+      return (p - start) + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+#elif defined(__GNUC__) && defined(__SSE2__)
+  const __m128i a = _mm_set1_epi8('a');
+  const __m128i zero = _mm_set1_epi8('0');
+  const __m128i dash = _mm_set1_epi8('-');
+  const __m128i alphaMax = _mm_set1_epi8(25);
+  const __m128i digitMax = _mm_set1_epi8(9);
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i alpha = _mm_sub_epi8(v, a);
+    __m128i digit = _mm_sub_epi8(v, zero);
+    __m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(alpha, alphaMax), alpha);
+    ok = _mm_or_si128(ok,
+                      _mm_cmpeq_epi8(_mm_min_epu8(digit, digitMax), digit));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, dash));
+    auto mask = ~(uint32_t)_mm_movemask_epi8(ok) & 0xffff;
+    if (mask) {
+      return (p - start) + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+#elif defined(__GNUC__) && defined(__ARM_NEON)
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8(p);
+    uint8x16_t ok = vcleq_u8(vsubq_u8(v, vdupq_n_u8('a')), vdupq_n_u8(25));
+    ok = vorrq_u8(ok,
+                  vcleq_u8(vsubq_u8(v, vdupq_n_u8('0')), vdupq_n_u8(9)));
+    ok = vorrq_u8(ok, vceqq_u8(v, vdupq_n_u8('-')));
+    uint64_t mask = ~neonMask(ok);
+    if (mask) {
+      return (p - start) + (__builtin_ctzll(mask) >> 2);
+    }
+    p += 16;
+  }
+#else
+  (void)end;
+#endif
+  return p - start;
+}
+
+// Octets that leave value validation state alone: HT, and SP through '~'
+// but for '"' and '\\'
+inline size_t scanHeaderValue(const uint8_t* p, const uint8_t* end) {
+  const uint8_t* start = p;
+#if defined(__GNUC__) && defined(__AVX2__)
+  const __m256i sp = _mm256_set1_epi8(' ');
+  const __m256i printMax = _mm256_set1_epi8('~' - ' ');
+  const __m256i ht = _mm256_set1_epi8('\t');
+  const __m256i qt = _mm256_set1_epi8('"');
+  const __m256i bs = _mm256_set1_epi8('\\');
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    __m256i print = _mm256_sub_epi8(v, sp);
+    __m256i ok = _mm256_cmpeq_epi8(_mm256_min_epu8(print, printMax), print);
+    ok = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, qt), ok);
+    ok = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, bs), ok);
+    ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(v, ht));
+    auto mask = ~(uint32_t)_mm256_movemask_epi8(ok);
+    if (mask) {
+      return (p - start) + __builtin_ctz(mask);
+    }
+    p += 32;
+  }
+#elif defined(__GNUC__) && defined(__SSE2__)
+  const __m128i sp = _mm_set1_epi8(' ');
+  const __m128i printMax = _mm_set1_epi8('~' - ' ');
+  const __m128i ht = _mm_set1_epi8('\t');
+  const __m128i qt = _mm_set1_epi8('"');
+  const __m128i bs = _mm_set1_epi8('\\');
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i print = _mm_sub_epi8(v, sp);
+    __m128i ok = _mm_cmpeq_epi8(_mm_min_epu8(print, printMax), print);
+    ok = _mm_andnot_si128(_mm_cmpeq_epi8(v, qt), ok);
+    ok = _mm_andnot_si128(_mm_cmpeq_epi8(v, bs), ok);
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, ht));
+    auto mask = ~(uint32_t)_mm_movemask_epi8(ok) & 0xffff;
+    if (mask) {
+      return (p - start) + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+#elif defined(__GNUC__) && defined(__ARM_NEON)
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8(p);
+    uint8x16_t ok =
+        vcleq_u8(vsubq_u8(v, vdupq_n_u8(' ')), vdupq_n_u8('~' - ' '));
+    ok = vbicq_u8(ok, vceqq_u8(v, vdupq_n_u8('"')));
+    ok = vbicq_u8(ok, vceqq_u8(v, vdupq_n_u8('\\')));
+    ok = vorrq_u8(ok, vceqq_u8(v, vdupq_n_u8('\t')));
+    uint64_t mask = ~neonMask(ok);
+    if (mask) {
+      return (p - start) + (__builtin_ctzll(mask) >> 2);
+    }
+    p += 16;
+  }
+#else
+  (void)end;
+#endif
+  return p - start;
+}
+
+} // namespace header_scan
+
+} // namespace proxygen
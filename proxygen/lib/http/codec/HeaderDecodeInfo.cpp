@@ -17,7 +17,8 @@ using std::string;
 namespace proxygen {
 
 bool HeaderDecodeInfo::onHeader(const HPACKHeaderName& name,
-                                const folly::fbstring& value) {
+                                const folly::fbstring& value,
+                                bool fromStaticTable) {
   // Refuse decoding other headers if an error is already found
   if (decodeError != HPACK::DecodeError::NONE || !parsingError.empty()) {
     VLOG(4) << "Ignoring header=" << name << " value=" << value
@@ -102,13 +103,14 @@ bool HeaderDecodeInfo::onHeader(const HPACKHeaderName& name,
         // no op
         break;
     }
-    bool nameOk = !validate_ || headerCode != HTTP_HEADER_OTHER ||
+    bool nameOk = !validate_ || fromStaticTable ||
+                  headerCode != HTTP_HEADER_OTHER ||
                   CodecUtil::validateHeaderName(
                       nameSp,
                       strictValidation_ ? CodecUtil::HEADER_NAME_STRICT
                                         : CodecUtil::HEADER_NAME_STRICT_COMPAT);
     bool valueOk =
-        !validate_ ||
+        !validate_ || fromStaticTable ||
         CodecUtil::validateHeaderValue(
             valueSp,
             strictValidation_ ? CodecUtil::CtlEscapeMode::STRICT
@@ -120,7 +122,7 @@ bool HeaderDecodeInfo::onHeader(const HPACKHeaderName& name,
     }
     // Add the (name, value) pair to headers
     if (headerCode == HTTP_HEADER_OTHER) {
-      msg->getHeaders().add(nameSp, valueSp);
+      msg->getHeaders().addFromCodec(headerCode, nameSp, valueSp);
     } else if (headerCode == HTTP_HEADER_HOST && verifier.hasAuthority()) {
       if (msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST) != valueSp) {
         parsingError = ":authority/Host header mismatch";
@@ -137,9 +139,14 @@ void HeaderDecodeInfo::onHeadersComplete(HTTPHeaderSize decodedSize) {
   HTTPHeaders& headers = msg->getHeaders();
 
   if (isRequest_ && !isRequestTrailers_) {
-    auto combinedCookie = headers.combine(HTTP_HEADER_COOKIE, "; ");
-    if (!combinedCookie.empty()) {
-      headers.set(HTTP_HEADER_COOKIE, combinedCookie);
+    // A lone crumb needs no combining, which saves copying the largest
+    // value in most requests
+    if (headers.getNumberOfValues(HTTP_HEADER_COOKIE) > 1) {
+      auto combinedCookie = headers.combine(HTTP_HEADER_COOKIE, "; ");
+      if (!combinedCookie.empty()) {
+        headers.remove(HTTP_HEADER_COOKIE);
+        headers.add(HTTP_HEADER_COOKIE, std::move(combinedCookie));
+      }
     }
     if (!verifier.validate()) {
       parsingError = verifier.error;
@@ -40,7 +40,11 @@ class HeaderDecodeInfo {
     verifier.reset(msg.get());
   }
 
-  bool onHeader(const HPACKHeaderName& name, const folly::fbstring& value);
+  // fromStaticTable skips validating regular headers, see
+  // HPACK::StreamingCallback::onStaticHeader
+  bool onHeader(const HPACKHeaderName& name,
+                const folly::fbstring& value,
+                bool fromStaticTable = false);
 
   void onHeadersComplete(HTTPHeaderSize decodedSize);
 
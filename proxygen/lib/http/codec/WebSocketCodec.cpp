@@ -0,0 +1,607 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/codec/WebSocketCodec.h>
+
+#include <cstring>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/io/Cursor.h>
+#include <glog/logging.h>
+#include <limits>
+#include <proxygen/lib/utils/CompressionContextPool.h>
+
+using folly::IOBuf;
+using folly::StringPiece;
+
+namespace proxygen {
+
+namespace {
+
+constexpr uint8_t kFinBit = 0x80;
+constexpr uint8_t kRsv1Bit = 0x40;
+constexpr uint8_t kRsv23Bits = 0x30;
+constexpr uint8_t kOpCodeBits = 0x0f;
+constexpr uint8_t kMaskBit = 0x80;
+constexpr uint8_t kLengthBits = 0x7f;
+constexpr uint8_t kLength16 = 126;
+constexpr uint8_t kLength64 = 127;
+constexpr size_t kMaxHeaderSize = 14;
+
+// What a sync flush ends with, left out of the messages (RFC 7692)
+constexpr uint8_t kDeflateTail[] = {0x00, 0x00, 0xff, 0xff};
+constexpr size_t kZlibMinOut = 512;
+constexpr size_t kZlibGrowth = 4000;
+
+bool isKnownOpCode(uint8_t opcode) {
+  return opcode <= 2 || (opcode >= 8 && opcode <= 10);
+}
+
+// Runs all of in through stream into out, or stops once out (which caches
+// its chain length) holds outLimit bytes
+bool runZlib(z_stream* stream,
+             bool compress,
+             folly::ByteRange in,
+             int flush,
+             folly::IOBufQueue& out,
+             size_t outLimit = std::numeric_limits<size_t>::max()) {
+  stream->next_in = const_cast<uint8_t*>(in.data());
+  stream->avail_in = in.size();
+  do {
+    if (out.chainLength() >= outLimit) {
+      break;
+    }
+    auto space = out.preallocate(kZlibMinOut, kZlibGrowth);
+    auto availOut = std::min(space.second, outLimit - out.chainLength());
+    stream->next_out = static_cast<uint8_t*>(space.first);
+    stream->avail_out = availOut;
+    int status = compress ? ::deflate(stream, flush) : ::inflate(stream, flush);
+    out.postallocate(availOut - stream->avail_out);
+    if (status == Z_STREAM_END && !compress) {
+      // A final block, allowed though deflaters don't send one
+      if (inflateReset(stream) != Z_OK) {
+        return false;
+      }
+    } else if (status == Z_BUF_ERROR) {
+      // No progress possible, as once everything is flushed
+      if (stream->avail_out > 0) {
+        break;
+      }
+    } else if (status != Z_OK) {
+      return false;
+    }
+  } while (stream->avail_in > 0 || stream->avail_out == 0);
+  stream->next_in = Z_NULL;
+  stream->next_out = Z_NULL;
+  stream->avail_out = 0;
+  return true;
+}
+
+void maskChain(IOBuf* chain, const std::array<uint8_t, 4>& key, size_t offset) {
+  auto buf = chain;
+  do {
+    if (buf->isSharedOne()) {
+      buf->unshareOne();
+    }
+    WebSocketCodec::mask(buf->writableData(), buf->length(), key, offset);
+    offset += buf->length();
+    buf = buf->next();
+  } while (buf != chain);
+}
+
+} // namespace
+
+const std::string WebSocketCodec::kDeflateExtension = "permessage-deflate";
+
+WebSocketCodec::WebSocketCodec(TransportDirection direction, Options options)
+    : direction_(direction), options_(std::move(options)) {
+}
+
+WebSocketCodec::~WebSocketCodec() {
+  auto& pool = CompressionContextPool::get();
+  pool.releaseRawDeflate(std::move(deflate_), options_.deflateLevel);
+  pool.releaseRawInflate(std::move(inflate_));
+}
+
+bool WebSocketCodec::ownNoContextTakeover() const {
+  return direction_ == TransportDirection::DOWNSTREAM
+             ? options_.serverNoContextTakeover
+             : options_.clientNoContextTakeover;
+}
+
+bool WebSocketCodec::peerNoContextTakeover() const {
+  return direction_ == TransportDirection::DOWNSTREAM
+             ? options_.clientNoContextTakeover
+             : options_.serverNoContextTakeover;
+}
+
+void WebSocketCodec::mask(uint8_t* data,
+                          size_t length,
+                          const std::array<uint8_t, 4>& key,
+                          size_t offset) {
+  // The key rotated to offset, twice, so that words stay aligned with it
+  uint8_t rotated[8];
+  for (size_t i = 0; i < sizeof(rotated); ++i) {
+    rotated[i] = key[(offset + i) % 4];
+  }
+  uint64_t wideKey;
+  memcpy(&wideKey, rotated, sizeof(wideKey));
+  size_t i = 0;
+  for (; i + sizeof(wideKey) <= length; i += sizeof(wideKey)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    word ^= wideKey;
+    memcpy(data + i, &word, sizeof(word));
+  }
+  for (; i < length; ++i) {
+    data[i] ^= rotated[i % 4];
+  }
+}
+
+void WebSocketCodec::fail(uint16_t closeCode, const std::string& what) {
+  VLOG(4) << "WebSocket ingress error: " << what;
+  state_ = State::ERROR;
+  input_.move();
+  if (callback_) {
+    callback_->onError(closeCode, what);
+  }
+}
+
+void WebSocketCodec::onIngress(std::unique_ptr<IOBuf> buf) {
+  if (state_ == State::ERROR) {
+    return;
+  }
+  input_.append(std::move(buf));
+  while (state_ != State::ERROR) {
+    if (state_ == State::HEADER) {
+      if (!parseHeader()) {
+        return;
+      }
+      if (payloadRemaining_ > 0) {
+        continue;
+      }
+      onPayload(nullptr, true);
+      continue;
+    }
+    auto available =
+        std::min<uint64_t>(payloadRemaining_, input_.chainLength());
+    if (available == 0) {
+      return;
+    }
+    auto chunk = input_.split(available);
+    payloadRemaining_ -= available;
+    onPayload(std::move(chunk), payloadRemaining_ == 0);
+  }
+}
+
+bool WebSocketCodec::parseHeader() {
+  if (input_.chainLength() < 2) {
+    return false;
+  }
+  folly::io::Cursor cursor(input_.front());
+  auto b0 = cursor.read<uint8_t>();
+  auto b1 = cursor.read<uint8_t>();
+  size_t headerSize = 2;
+  auto lengthCode = b1 & kLengthBits;
+  if (lengthCode == kLength16) {
+    headerSize += 2;
+  } else if (lengthCode == kLength64) {
+    headerSize += 8;
+  }
+  bool masked = b1 & kMaskBit;
+  if (masked) {
+    headerSize += 4;
+  }
+  if (input_.chainLength() < headerSize) {
+    return false;
+  }
+
+  FrameHeader frame;
+  frame.fin = b0 & kFinBit;
+  frame.rsv1 = b0 & kRsv1Bit;
+  frame.masked = masked;
+  if (lengthCode == kLength16) {
+    frame.length = cursor.readBE<uint16_t>();
+  } else if (lengthCode == kLength64) {
+    frame.length = cursor.readBE<uint64_t>();
+  } else {
+    frame.length = lengthCode;
+  }
+  if (masked) {
+    cursor.pull(frame.maskKey.data(), frame.maskKey.size());
+  }
+  input_.trimStart(headerSize);
+
+  auto opcode = b0 & kOpCodeBits;
+  if (!isKnownOpCode(opcode)) {
+    fail(kCloseProtocolError, "Unknown opcode");
+    return false;
+  }
+  frame.opcode = static_cast<OpCode>(opcode);
+  if (b0 & kRsv23Bits) {
+    fail(kCloseProtocolError, "Reserved bits set");
+    return false;
+  }
+  // Servers get masked frames only, and clients unmasked ones
+  if (masked != (direction_ == TransportDirection::DOWNSTREAM)) {
+    fail(kCloseProtocolError, "Bad masking");
+    return false;
+  }
+  if (frame.length >> 63) {
+    fail(kCloseProtocolError, "Bad length");
+    return false;
+  }
+  if (isControl(frame.opcode)) {
+    if (!frame.fin || frame.length > kMaxControlPayload || frame.rsv1) {
+      fail(kCloseProtocolError, "Bad control frame");
+      return false;
+    }
+  } else if (frame.opcode == OpCode::CONTINUATION) {
+    if (!ingressMessage_ || frame.rsv1) {
+      fail(kCloseProtocolError, "Unexpected continuation");
+      return false;
+    }
+  } else {
+    if (ingressMessage_) {
+      fail(kCloseProtocolError, "Expected a continuation");
+      return false;
+    }
+    if (frame.rsv1 && !options_.deflate) {
+      fail(kCloseProtocolError, "Compressed without permessage-deflate");
+      return false;
+    }
+    ingressMessage_ = true;
+    ingressOpCode_ = frame.opcode;
+    ingressCompressed_ = frame.rsv1;
+    ingressMessageSize_ = 0;
+  }
+  if (!isControl(frame.opcode) && !ingressCompressed_ &&
+      ingressMessageSize_ + frame.length > options_.maxMessageSize) {
+    fail(kCloseTooBig, "Message too big");
+    return false;
+  }
+  frame_ = frame;
+  payloadRemaining_ = frame.length;
+  payloadOffset_ = 0;
+  state_ = State::PAYLOAD;
+  return true;
+}
+
+void WebSocketCodec::onPayload(std::unique_ptr<IOBuf> chunk, bool frameEnd) {
+  if (chunk && frame_.masked) {
+    maskChain(chunk.get(), frame_.maskKey, payloadOffset_);
+  }
+  if (chunk) {
+    payloadOffset_ += chunk->computeChainDataLength();
+  }
+  if (frameEnd) {
+    state_ = State::HEADER;
+  }
+  if (isControl(frame_.opcode)) {
+    controlPayload_.append(std::move(chunk));
+    if (frameEnd) {
+      onControlFrame();
+    }
+    return;
+  }
+  if (!frameEnd && !chunk) {
+    return;
+  }
+  deliverData(chunk ? std::move(chunk) : IOBuf::create(0),
+              frameEnd && frame_.fin);
+}
+
+void WebSocketCodec::deliverData(std::unique_ptr<IOBuf> data, bool fin) {
+  if (ingressCompressed_) {
+    if (fin) {
+      data->prependChain(IOBuf::wrapBuffer(kDeflateTail, sizeof(kDeflateTail)));
+    }
+    data = decompress(data.get());
+    if (!data) {
+      fail(kCloseInvalidData, "Bad compressed data");
+      return;
+    }
+  }
+  ingressMessageSize_ += data->computeChainDataLength();
+  if (ingressMessageSize_ > options_.maxMessageSize) {
+    fail(kCloseTooBig, "Message too big");
+    return;
+  }
+  if (fin) {
+    ingressMessage_ = false;
+    if (ingressCompressed_ && peerNoContextTakeover()) {
+      CompressionContextPool::get().releaseRawInflate(std::move(inflate_));
+    }
+  }
+  if (callback_) {
+    callback_->onMessageData(ingressOpCode_, std::move(data), fin);
+  }
+}
+
+void WebSocketCodec::onControlFrame() {
+  auto payload = controlPayload_.move();
+  if (!payload) {
+    payload = IOBuf::create(0);
+  }
+  if (!callback_) {
+    return;
+  }
+  switch (frame_.opcode) {
+    case OpCode::PING:
+      callback_->onPing(std::move(payload));
+      break;
+    case OpCode::PONG:
+      callback_->onPong(std::move(payload));
+      break;
+    case OpCode::CLOSE: {
+      auto length = payload->computeChainDataLength();
+      if (length == 0) {
+        callback_->onClose(kCloseNoStatus, std::string());
+        break;
+      }
+      if (length == 1) {
+        fail(kCloseProtocolError, "Bad close payload");
+        break;
+      }
+      folly::io::Cursor cursor(payload.get());
+      auto code = cursor.readBE<uint16_t>();
+      callback_->onClose(code, cursor.readFixedString(length - 2));
+      break;
+    }
+    default:
+      LOG(DFATAL) << "Not a control frame: " << frame_.opcode;
+      break;
+  }
+}
+
+std::unique_ptr<IOBuf> WebSocketCodec::decompress(const IOBuf* in) {
+  if (!inflate_) {
+    inflate_ = CompressionContextPool::get().acquireRawInflate();
+    if (!inflate_) {
+      return nullptr;
+    }
+  }
+  folly::IOBufQueue out{folly::IOBufQueue::cacheChainLength()};
+  // Against decompression bombs: one byte over the limit fails the message
+  DCHECK_LE(ingressMessageSize_, options_.maxMessageSize);
+  size_t outLimit = options_.maxMessageSize - ingressMessageSize_ + 1;
+  for (auto range : *in) {
+    if (!runZlib(inflate_.get(), false, range, Z_SYNC_FLUSH, out, outLimit)) {
+      return nullptr;
+    }
+    if (out.chainLength() >= outLimit) {
+      break;
+    }
+  }
+  auto result = out.move();
+  return result ? std::move(result) : IOBuf::create(0);
+}
+
+std::unique_ptr<IOBuf> WebSocketCodec::compress(std::unique_ptr<IOBuf> in,
+                                                bool fin) {
+  if (!deflate_) {
+    deflate_ =
+        CompressionContextPool::get().acquireRawDeflate(options_.deflateLevel);
+    if (!deflate_) {
+      return nullptr;
+    }
+  }
+  folly::IOBufQueue out{folly::IOBufQueue::cacheChainLength()};
+  if (in) {
+    for (auto range : *in) {
+      if (!runZlib(deflate_.get(), true, range, Z_NO_FLUSH, out)) {
+        return nullptr;
+      }
+    }
+  }
+  if (!runZlib(deflate_.get(), true, folly::ByteRange(), Z_SYNC_FLUSH, out)) {
+    return nullptr;
+  }
+  if (fin) {
+    if (out.empty()) {
+      // Nothing new since the last flush: an empty stored block, without
+      // its tail, still ends the message (RFC 7692 7.2.3.6)
+      static const uint8_t kEmptyBlock = 0x00;
+      out.append(&kEmptyBlock, sizeof(kEmptyBlock));
+    } else {
+      DCHECK_GE(out.chainLength(), sizeof(kDeflateTail));
+      out.trimEnd(sizeof(kDeflateTail));
+    }
+    if (ownNoContextTakeover()) {
+      CompressionContextPool::get().releaseRawDeflate(std::move(deflate_),
+                                                      options_.deflateLevel);
+    }
+  }
+  auto result = out.move();
+  return result ? std::move(result) : IOBuf::create(0);
+}
+
+size_t WebSocketCodec::generateFrame(folly::IOBufQueue& writeBuf,
+                                     OpCode opcode,
+                                     std::unique_ptr<IOBuf> payload,
+                                     bool fin,
+                                     bool rsv1) {
+  uint64_t length = payload ? payload->computeChainDataLength() : 0;
+  bool masked = direction_ == TransportDirection::UPSTREAM;
+  uint8_t header[kMaxHeaderSize];
+  size_t headerSize = 0;
+  header[headerSize++] = (fin ? kFinBit : 0) | (rsv1 ? kRsv1Bit : 0) |
+                         static_cast<uint8_t>(opcode);
+  uint8_t maskBit = masked ? kMaskBit : 0;
+  if (length < kLength16) {
+    header[headerSize++] = maskBit | length;
+  } else if (length <= std::numeric_limits<uint16_t>::max()) {
+    header[headerSize++] = maskBit | kLength16;
+    for (int shift = 8; shift >= 0; shift -= 8) {
+      header[headerSize++] = (length >> shift) & 0xff;
+    }
+  } else {
+    header[headerSize++] = maskBit | kLength64;
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      header[headerSize++] = (length >> shift) & 0xff;
+    }
+  }
+  if (masked) {
+    std::array<uint8_t, 4> key;
+    auto random = folly::Random::rand32();
+    memcpy(key.data(), &random, key.size());
+    memcpy(header + headerSize, key.data(), key.size());
+    headerSize += key.size();
+    if (length > 0) {
+      maskChain(payload.get(), key, 0);
+    }
+  }
+  writeBuf.append(header, headerSize);
+  if (length > 0) {
+    writeBuf.append(std::move(payload));
+  }
+  return headerSize + length;
+}
+
+size_t WebSocketCodec::generateFragment(folly::IOBufQueue& writeBuf,
+                                        OpCode opcode,
+                                        std::unique_ptr<IOBuf> payload,
+                                        bool fin) {
+  DCHECK(opcode == OpCode::TEXT || opcode == OpCode::BINARY);
+  bool first = !egressMessage_;
+  if (first) {
+    egressCompressed_ = options_.deflate;
+  }
+  egressMessage_ = !fin;
+  if (egressCompressed_) {
+    payload = compress(std::move(payload), fin);
+    if (!payload) {
+      LOG(ERROR) << "WebSocket compression failed";
+      return 0;
+    }
+  }
+  return generateFrame(writeBuf,
+                       first ? opcode : OpCode::CONTINUATION,
+                       std::move(payload),
+                       fin,
+                       first && egressCompressed_);
+}
+
+size_t WebSocketCodec::generateMessage(folly::IOBufQueue& writeBuf,
+                                       OpCode opcode,
+                                       std::unique_ptr<IOBuf> payload) {
+  DCHECK(!egressMessage_);
+  DCHECK_GT(options_.maxFrameSize, 0);
+  folly::IOBufQueue remaining{folly::IOBufQueue::cacheChainLength()};
+  remaining.append(std::move(payload));
+  size_t written = 0;
+  while (remaining.chainLength() > options_.maxFrameSize) {
+    written += generateFragment(
+        writeBuf, opcode, remaining.split(options_.maxFrameSize), false);
+  }
+  return written + generateFragment(writeBuf, opcode, remaining.move(), true);
+}
+
+size_t WebSocketCodec::generatePing(folly::IOBufQueue& writeBuf,
+                                    std::unique_ptr<IOBuf> payload) {
+  DCHECK(!payload || payload->computeChainDataLength() <= kMaxControlPayload);
+  return generateFrame(writeBuf, OpCode::PING, std::move(payload), true, false);
+}
+
+size_t WebSocketCodec::generatePong(folly::IOBufQueue& writeBuf,
+                                    std::unique_ptr<IOBuf> payload) {
+  DCHECK(!payload || payload->computeChainDataLength() <= kMaxControlPayload);
+  return generateFrame(writeBuf, OpCode::PONG, std::move(payload), true, false);
+}
+
+size_t WebSocketCodec::generateClose(folly::IOBufQueue& writeBuf,
+                                     uint16_t code,
+                                     StringPiece reason) {
+  reason = reason.subpiece(0, kMaxControlPayload - 2);
+  auto payload = IOBuf::create(2 + reason.size());
+  payload->writableData()[0] = code >> 8;
+  payload->writableData()[1] = code & 0xff;
+  memcpy(payload->writableData() + 2, reason.data(), reason.size());
+  payload->append(2 + reason.size());
+  return generateFrame(
+      writeBuf, OpCode::CLOSE, std::move(payload), true, false);
+}
+
+bool WebSocketCodec::parseDeflateExtension(StringPiece extensions,
+                                           Options& options) {
+  std::vector<StringPiece> offers;
+  folly::split(',', extensions, offers);
+  for (auto offer : offers) {
+    std::vector<StringPiece> params;
+    folly::split(';', offer, params);
+    if (folly::trimWhitespace(params[0]) != kDeflateExtension) {
+      continue;
+    }
+    bool usable = true;
+    bool serverNoContextTakeover = false;
+    bool clientNoContextTakeover = false;
+    for (size_t i = 1; i < params.size() && usable; ++i) {
+      StringPiece name;
+      StringPiece value;
+      if (!folly::split('=', params[i], name, value)) {
+        name = params[i];
+      }
+      name = folly::trimWhitespace(name);
+      value = folly::trimWhitespace(value);
+      value.removePrefix('"');
+      value.removeSuffix('"');
+      if (name == "server_no_context_takeover") {
+        serverNoContextTakeover = true;
+      } else if (name == "client_no_context_takeover") {
+        clientNoContextTakeover = true;
+      } else if (name == "server_max_window_bits" ||
+                 name == "client_max_window_bits") {
+        // Only the default window, but clients may offer to use smaller
+        // ones themselves
+        usable = value.empty() || value == "15" ||
+                 name == "client_max_window_bits";
+      } else {
+        usable = false;
+      }
+    }
+    if (usable) {
+      options.deflate = true;
+      options.serverNoContextTakeover = serverNoContextTakeover;
+      options.clientNoContextTakeover = clientNoContextTakeover;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string WebSocketCodec::deflateExtensionResponse(const Options& options) {
+  DCHECK(options.deflate);
+  auto response = kDeflateExtension;
+  if (options.serverNoContextTakeover) {
+    response += "; server_no_context_takeover";
+  }
+  if (options.clientNoContextTakeover) {
+    response += "; client_no_context_takeover";
+  }
+  return response;
+}
+
+std::ostream& operator<<(std::ostream& os, WebSocketCodec::OpCode opcode) {
+  switch (opcode) {
+    case WebSocketCodec::OpCode::CONTINUATION:
+      return os << "CONTINUATION";
+    case WebSocketCodec::OpCode::TEXT:
+      return os << "TEXT";
+    case WebSocketCodec::OpCode::BINARY:
+      return os << "BINARY";
+    case WebSocketCodec::OpCode::CLOSE:
+      return os << "CLOSE";
+    case WebSocketCodec::OpCode::PING:
+      return os << "PING";
+    case WebSocketCodec::OpCode::PONG:
+      return os << "PONG";
+  }
+  return os << static_cast<int>(opcode);
+}
+
+} // namespace proxygen
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <folly/Range.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/codec/TransportDirection.h>
+#include <zlib.h>
+
+namespace proxygen {
+
+/**
+ * WebSocket framing (RFC 6455) of the body of an upgraded transaction:
+ * after a 101 over HTTP/1.1, or an extended CONNECT over HTTP/2 (RFC 8441)
+ * or HTTP/3 (RFC 9220), whose handshakes the HTTP codecs already do.  With
+ * permessage-deflate (RFC 7692) when negotiated.
+ *
+ * Message data is passed up fragment by fragment, as slices of the ingress
+ * unmasked in place, rather than buffered into whole messages.  Egress
+ * payloads are appended to the write buffer without copies, unless they
+ * have to be masked (upstream) and are shared.  TEXT payloads are not
+ * checked to be UTF-8.
+ */
+class WebSocketCodec {
+ public:
+  enum class OpCode : uint8_t {
+    CONTINUATION = 0,
+    TEXT = 1,
+    BINARY = 2,
+    CLOSE = 8,
+    PING = 9,
+    PONG = 10,
+  };
+
+  // Status codes of CLOSE frames
+  static constexpr uint16_t kCloseNormal = 1000;
+  static constexpr uint16_t kCloseNoStatus = 1005;
+  static constexpr uint16_t kCloseProtocolError = 1002;
+  static constexpr uint16_t kCloseInvalidData = 1007;
+  static constexpr uint16_t kCloseTooBig = 1009;
+
+  static constexpr size_t kMaxControlPayload = 125;
+
+  static const std::string kDeflateExtension;
+
+  struct Options {
+    // permessage-deflate, and its parameters, as negotiated
+    bool deflate{false};
+    bool serverNoContextTakeover{false};
+    bool clientNoContextTakeover{false};
+    int deflateLevel{Z_DEFAULT_COMPRESSION};
+    // Decompressed, beyond which the message fails with kCloseTooBig
+    uint64_t maxMessageSize{16 * 1024 * 1024};
+    // Of the fragments of generateMessage()
+    size_t maxFrameSize{16 * 1024};
+  };
+
+  class Callback {
+   public:
+    virtual ~Callback() = default;
+
+    // opcode is that of the message, TEXT or BINARY, for all its fragments
+    virtual void onMessageData(OpCode opcode,
+                               std::unique_ptr<folly::IOBuf> data,
+                               bool fin) = 0;
+    virtual void onPing(std::unique_ptr<folly::IOBuf> payload) = 0;
+    virtual void onPong(std::unique_ptr<folly::IOBuf> payload) = 0;
+    // code is kCloseNoStatus for a CLOSE without a status
+    virtual void onClose(uint16_t code, std::string reason) = 0;
+    // The ingress is ignored afterwards; the peer should get a CLOSE with
+    // closeCode
+    virtual void onError(uint16_t closeCode, const std::string& what) = 0;
+  };
+
+  WebSocketCodec(TransportDirection direction, Options options);
+  ~WebSocketCodec();
+
+  WebSocketCodec(const WebSocketCodec&) = delete;
+  WebSocketCodec& operator=(const WebSocketCodec&) = delete;
+
+  void setCallback(Callback* callback) {
+    callback_ = callback;
+  }
+
+  void onIngress(std::unique_ptr<folly::IOBuf> buf);
+
+  /**
+   * A whole message, in fragments of up to maxFrameSize.  Returns the
+   * bytes generated.
+   */
+  size_t generateMessage(folly::IOBufQueue& writeBuf,
+                         OpCode opcode,
+                         std::unique_ptr<folly::IOBuf> payload);
+
+  /**
+   * A fragment of a message being streamed: opcode is that of the message,
+   * and fin is set on its last fragment.  Control frames may go between
+   * fragments, so a sender can stop at a fragment boundary while the
+   * egress of the transaction is paused and still answer pings.
+   */
+  size_t generateFragment(folly::IOBufQueue& writeBuf,
+                          OpCode opcode,
+                          std::unique_ptr<folly::IOBuf> payload,
+                          bool fin);
+
+  size_t generatePing(folly::IOBufQueue& writeBuf,
+                      std::unique_ptr<folly::IOBuf> payload = nullptr);
+  size_t generatePong(folly::IOBufQueue& writeBuf,
+                      std::unique_ptr<folly::IOBuf> payload = nullptr);
+  size_t generateClose(folly::IOBufQueue& writeBuf,
+                       uint16_t code = kCloseNormal,
+                       folly::StringPiece reason = folly::StringPiece());
+
+  bool isEgressMessageInProgress() const {
+    return egressMessage_;
+  }
+
+  /**
+   * XORs length bytes at data with key, starting at offset bytes into the
+   * payload, eight bytes at a time.
+   */
+  static void mask(uint8_t* data,
+                   size_t length,
+                   const std::array<uint8_t, 4>& key,
+                   size_t offset = 0);
+
+  /**
+   * Accepts the first permessage-deflate offer of a client in the
+   * Sec-WebSocket-Extensions of its request, or, upstream, the one of the
+   * response, filling the deflate fields of options.  Returns false if
+   * there is none that can be used.
+   */
+  static bool parseDeflateExtension(folly::StringPiece extensions,
+                                    Options& options);
+
+  // The Sec-WebSocket-Extensions value accepting options
+  static std::string deflateExtensionResponse(const Options& options);
+
+ private:
+  enum class State : uint8_t { HEADER, PAYLOAD, ERROR };
+
+  struct FrameHeader {
+    bool fin{false};
+    bool rsv1{false};
+    OpCode opcode{OpCode::CONTINUATION};
+    bool masked{false};
+    std::array<uint8_t, 4> maskKey{};
+    uint64_t length{0};
+  };
+
+  static bool isControl(OpCode opcode) {
+    return static_cast<uint8_t>(opcode) >= 8;
+  }
+
+  // False, after onError(), if the header is not acceptable
+  bool parseHeader();
+  void onPayload(std::unique_ptr<folly::IOBuf> chunk, bool frameEnd);
+  void onControlFrame();
+  void deliverData(std::unique_ptr<folly::IOBuf> data, bool fin);
+  void fail(uint16_t closeCode, const std::string& what);
+
+  size_t generateFrame(folly::IOBufQueue& writeBuf,
+                       OpCode opcode,
+                       std::unique_ptr<folly::IOBuf> payload,
+                       bool fin,
+                       bool rsv1);
+  std::unique_ptr<folly::IOBuf> compress(std::unique_ptr<folly::IOBuf> in,
+                                         bool fin);
+  // nullptr on a zlib error
+  std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in);
+
+  bool ownNoContextTakeover() const;
+  bool peerNoContextTakeover() const;
+
+  TransportDirection direction_;
+  Options options_;
+  Callback* callback_{nullptr};
+
+  folly::IOBufQueue input_{folly::IOBufQueue::cacheChainLength()};
+  State state_{State::HEADER};
+  FrameHeader frame_;
+  uint64_t payloadRemaining_{0};
+  uint64_t payloadOffset_{0};
+  folly::IOBufQueue controlPayload_{folly::IOBufQueue::cacheChainLength()};
+
+  // Of the data message being received
+  bool ingressMessage_{false};
+  OpCode ingressOpCode_{OpCode::CONTINUATION};
+  bool ingressCompressed_{false};
+  uint64_t ingressMessageSize_{0};
+
+  bool egressMessage_{false};
+  bool egressCompressed_{false};
+
+  // From the CompressionContextPool, for the lifetime of the codec unless
+  // the context is not taken over
+  std::unique_ptr<z_stream> deflate_;
+  std::unique_ptr<z_stream> inflate_;
+};
+
+std::ostream& operator<<(std::ostream& os, WebSocketCodec::OpCode opcode);
+
+} // namespace proxygen
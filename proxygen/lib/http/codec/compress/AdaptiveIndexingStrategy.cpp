@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/codec/compress/AdaptiveIndexingStrategy.h>
+
+#include <cmath>
+#include <folly/hash/Hash.h>
+#include <folly/lang/Bits.h>
+
+namespace proxygen {
+
+namespace {
+// Linear counting estimate of the number of distinct values hashed into a
+// 64 bit map
+double estimateDistinct(uint64_t values) {
+  constexpr double kBits = 64;
+  auto zeros = kBits - folly::popcount(values);
+  if (zeros == 0) {
+    // saturated
+    return kBits * std::log(kBits);
+  }
+  return -kBits * std::log(zeros / kBits);
+}
+} // namespace
+
+const AdaptiveIndexingStrategy* AdaptiveIndexingStrategy::getInstance() {
+  static const AdaptiveIndexingStrategy* instance =
+      new AdaptiveIndexingStrategy();
+  return instance;
+}
+
+uint64_t AdaptiveIndexingStrategy::hashName(const HPACKHeaderName& name) {
+  const auto& str = name.get();
+  // 0 marks an empty slot
+  return folly::hash::fnv64_buf(str.data(), str.size()) | 1;
+}
+
+AdaptiveIndexingStrategy::NameSlot& AdaptiveIndexingStrategy::getSlot(
+    uint64_t nameHash) const {
+  auto& slot = (*sketch_)[nameHash % kNumSlots];
+  if (slot.nameHash != nameHash) {
+    slot = NameSlot();
+    slot.nameHash = nameHash;
+  }
+  return slot;
+}
+
+bool AdaptiveIndexingStrategy::indexHeader(const HPACKHeaderName& name,
+                                           folly::StringPiece value,
+                                           bool nameExists) const {
+  if (base_ && !base_->indexHeader(name, value, nameExists)) {
+    return false;
+  }
+  auto& slot = getSlot(hashName(name));
+  // fnv alone leaves the bits of short values poorly distributed
+  auto valueHash = folly::hash::twang_mix64(
+      folly::hash::fnv64_buf(value.data(), value.size()));
+  slot.values |= uint64_t(1) << (valueHash % 64);
+  if (++slot.misses == kWindow) {
+    slot.churning = estimateDistinct(slot.values) > maxDistinct_;
+    slot.values = 0;
+    slot.misses = 0;
+  }
+  return !slot.churning;
+}
+
+bool AdaptiveIndexingStrategy::isChurning(const HPACKHeaderName& name) const {
+  auto nameHash = hashName(name);
+  const auto& slot = (*sketch_)[nameHash % kNumSlots];
+  return slot.nameHash == nameHash && slot.churning;
+}
+
+} // namespace proxygen
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <folly/ThreadLocal.h>
+#include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
+
+namespace proxygen {
+
+/**
+ * Indexing strategy that learns which header names churn.  Encoders only
+ * consult the strategy for headers missing from the table, so for each name
+ * it counts the distinct values among the last kWindow misses with a 64 bit
+ * linear counting sketch.  A name whose misses are mostly distinct values
+ * (request IDs, trace headers, timestamps) stops being indexed so it can't
+ * evict useful entries; if its values start repeating it is indexed again at
+ * the end of the next window.
+ *
+ * The sketches are per-thread and per-strategy, so an instance can be shared
+ * by every HPACK and QPACK encoder in the process.  Names hash into a fixed
+ * number of slots; a collision restarts learning for that slot.
+ */
+class AdaptiveIndexingStrategy : public HeaderIndexingStrategy {
+ public:
+  static constexpr uint16_t kWindow = 64;
+  static constexpr double kDefaultChurnRatio = 0.5;
+
+  // Wraps the default strategy
+  static const AdaptiveIndexingStrategy* getInstance();
+
+  // base is applied first, nullptr indexes everything the sketch allows.
+  // A name churns when more than churnRatio of its misses are distinct.
+  explicit AdaptiveIndexingStrategy(
+      const HeaderIndexingStrategy* base =
+          HeaderIndexingStrategy::getDefaultInstance(),
+      double churnRatio = kDefaultChurnRatio)
+      : base_(base), maxDistinct_(churnRatio * kWindow) {
+  }
+
+  bool indexHeader(const HPACKHeaderName& name,
+                   folly::StringPiece value,
+                   bool nameExists = false) const override;
+
+  [[nodiscard]] std::pair<uint32_t, uint32_t> getHuffmanLimits()
+      const override {
+    return base_ ? base_->getHuffmanLimits()
+                 : HeaderIndexingStrategy::getHuffmanLimits();
+  }
+
+  // True if the calling thread currently refuses to index name
+  bool isChurning(const HPACKHeaderName& name) const;
+
+ private:
+  static constexpr size_t kNumSlots = 128;
+
+  struct NameSlot {
+    uint64_t nameHash{0};
+    // one bit per value hash bucket
+    uint64_t values{0};
+    uint16_t misses{0};
+    bool churning{false};
+  };
+  using Sketch = std::array<NameSlot, kNumSlots>;
+
+  static uint64_t hashName(const HPACKHeaderName& name);
+  NameSlot& getSlot(uint64_t nameHash) const;
+
+  const HeaderIndexingStrategy* base_;
+  double maxDistinct_;
+  mutable folly::ThreadLocal<Sketch> sketch_;
+};
+
+} // namespace proxygen
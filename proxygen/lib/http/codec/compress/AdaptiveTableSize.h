@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace proxygen {
+
+/**
+ * Sizes an encoder's dynamic table per connection: it starts at
+ * initialSize, saving memory on the many short or header-light
+ * connections, and doubles up to the peer's limit once a window of header
+ * lookups shows that it would pay: the table evicted entries while at least
+ * minHitRatio of the lookups hit it, or would have, had the header not been
+ * evicted since it was last inserted.  The latter catches a working set
+ * cycling through a table slightly too small, which never hits.
+ */
+class AdaptiveTableSize {
+ public:
+  // Header lookups per decision
+  static constexpr uint32_t kWindow = 64;
+
+  explicit AdaptiveTableSize(uint32_t initialSize, double minHitRatio = 0.1)
+      : initialSize_(initialSize), minHitRatio_(minHitRatio) {
+  }
+
+  uint32_t getInitialSize() const {
+    return initialSize_;
+  }
+
+  // Before inserting a header, by its hash
+  void onInsert(size_t hash) {
+    if (std::find(recentInserts_.begin(), recentInserts_.end(), hash) !=
+        recentInserts_.end()) {
+      reinserts_++;
+    }
+    recentInserts_[nextInsert_++ % recentInserts_.size()] = hash;
+  }
+
+  // In the current window
+  uint32_t getReinserts() const {
+    return reinserts_;
+  }
+
+  /**
+   * Takes the encoder's running totals after a header block.  Returns the
+   * capacity to grow to, up to maxSize, or 0 to keep capacity.
+   */
+  uint32_t onBlockEncoded(uint32_t lookups,
+                          uint32_t dynamicHits,
+                          uint32_t evictions,
+                          uint32_t capacity,
+                          uint32_t maxSize) {
+    uint32_t windowLookups = lookups - lookups_;
+    if (windowLookups < kWindow) {
+      return 0;
+    }
+    uint32_t windowHits = dynamicHits - dynamicHits_ + reinserts_;
+    bool evicted = evictions != evictions_;
+    lookups_ = lookups;
+    dynamicHits_ = dynamicHits;
+    evictions_ = evictions;
+    reinserts_ = 0;
+    if (!evicted || capacity >= maxSize ||
+        windowHits < minHitRatio_ * windowLookups) {
+      return 0;
+    }
+    return std::min(std::max(capacity * 2, initialSize_), maxSize);
+  }
+
+ private:
+  const uint32_t initialSize_;
+  const double minHitRatio_;
+  // Totals at the last decision
+  uint32_t lookups_{0};
+  uint32_t dynamicHits_{0};
+  uint32_t evictions_{0};
+  uint32_t reinserts_{0};
+  // Hashes of the last kWindow inserts
+  std::array<size_t, kWindow> recentInserts_{};
+  uint32_t nextInsert_{0};
+};
+
+} // namespace proxygen
@@ -73,7 +73,9 @@ void HPACKCodec::encodeHTTP(
     bool includeDate,
     const folly::Optional<HTTPHeaders>& extraHeaders) noexcept {
   auto prevSize = writeBuf.chainLength();
-  encoder_.startEncode(writeBuf);
+  encoder_.startEncode(
+      writeBuf,
+      (stats_ && stats_->sampleHeaders(Type::HPACK)) ? stats_ : nullptr);
 
   auto uncompressed = 0;
   if (msg.isRequest()) {
@@ -64,10 +64,32 @@ class HPACKCodec : public HeaderCodec {
     encoder_.setHeaderTableSize(size);
   }
 
+  /**
+   * Starts the encoder's table at initialSize, which grows up to the peer's
+   * SETTINGS_HEADER_TABLE_SIZE on connections where it pays, see
+   * AdaptiveTableSize, and shrinks back in releaseIdleMemory().
+   */
+  void setEncoderAdaptiveTableSize(uint32_t initialSize) {
+    encoder_.setAdaptiveTableSize(initialSize);
+  }
+
   void setDecoderHeaderTableMaxSize(uint32_t size) {
     decoder_.setHeaderTableMaxSize(size);
   }
 
+  bool hasPendingContextUpdate() const {
+    return encoder_.hasPendingContextUpdate();
+  }
+
+  /**
+   * For an idle connection: empties the encoder's table, and frees the
+   * storage held for the entries each table evicted.
+   */
+  void releaseIdleMemory() {
+    encoder_.releaseTable();
+    decoder_.releaseTableStorage();
+  }
+
   void describe(std::ostream& os) const;
 
   void setMaxUncompressed(uint64_t maxUncompressed) override {
@@ -67,6 +67,11 @@ class HPACKContext {
 
   void seedHeaderTable(std::vector<HPACKHeader>& headers);
 
+  // See HeaderTable::releaseStorage
+  void releaseTableStorage() {
+    table_.releaseStorage();
+  }
+
   void describe(std::ostream& os) const;
 
   uint32_t getStaticRefs() const {
@@ -92,8 +92,7 @@ DecodeError HPACKDecodeBuffer::decodeLiteral(uint8_t nbit,
     data = tmpbuf->data();
   }
   if (huffman) {
-    static auto& huffmanTree = huffman::huffTree();
-    huffmanTree.decode(data, size, literal);
+    huffman::huffTree().decode(data, size, literal);
   } else {
     literal.append((const char*)data, size);
   }
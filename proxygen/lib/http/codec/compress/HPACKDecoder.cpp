@@ -12,6 +12,22 @@
 
 using folly::io::Cursor;
 
+namespace {
+
+proxygen::HeaderCodec::Representation representation(uint8_t byte) {
+  using proxygen::HeaderCodec;
+  if (byte & proxygen::HPACK::INDEX_REF.code) {
+    return HeaderCodec::Representation::INDEXED;
+  }
+  uint8_t indexMask = (byte & proxygen::HPACK::LITERAL_INC_INDEX.code)
+                          ? 0x3F  // 0011 1111
+                          : 0x0F; // 0000 1111
+  return (byte & indexMask) ? HeaderCodec::Representation::NAME_INDEXED
+                            : HeaderCodec::Representation::LITERAL;
+}
+
+} // namespace
+
 namespace proxygen {
 
 void HPACKDecoder::decodeStreaming(Cursor& cursor,
@@ -19,9 +35,22 @@ void HPACKDecoder::decodeStreaming(Cursor& cursor,
                                    HPACK::StreamingCallback* streamingCb) {
   HPACKDecodeBuffer dbuf(cursor, totalBytes, maxUncompressed_);
   uint32_t emittedSize = 0;
+  bool sampled = startSampling(HeaderCodec::Type::HPACK, streamingCb);
 
   while (!hasError() && !dbuf.empty()) {
-    emittedSize += decodeHeader(dbuf, streamingCb, nullptr);
+    if (sampled) {
+      auto first = dbuf.peek();
+      auto before = dbuf.consumedBytes();
+      auto headerSize = decodeHeader(dbuf, streamingCb, nullptr);
+      recordSampledHeader(HeaderCodec::Type::HPACK,
+                          streamingCb,
+                          representation(first),
+                          headerSize,
+                          dbuf.consumedBytes() - before);
+      emittedSize += headerSize;
+    } else {
+      emittedSize += decodeHeader(dbuf, streamingCb, nullptr);
+    }
 
     if (emittedSize > maxUncompressed_) {
       LOG(ERROR) << "exceeded uncompressed size limit of " << maxUncompressed_
@@ -46,6 +75,8 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
   uint8_t byte = dbuf.peek();
   bool indexing = byte & HPACK::LITERAL_INC_INDEX.code;
   HPACKHeader header;
+  // Points into the table for an indexed name that won't be inserted
+  const HPACKHeaderName* name = &header.name;
   uint8_t indexMask = 0x3F; // 0011 1111
   uint8_t length = HPACK::LITERAL_INC_INDEX.prefixLength;
   if (!indexing) {
@@ -67,7 +98,11 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
       err_ = HPACK::DecodeError::INVALID_INDEX;
       return 0;
     }
-    header.name = getHeader(index).name;
+    if (indexing) {
+      header.name = getHeader(index).name;
+    } else {
+      name = &getHeader(index).name;
+    }
   } else {
     // skip current byte
     dbuf.next();
@@ -82,12 +117,12 @@ uint32_t HPACKDecoder::decodeLiteralHeader(
   // value
   err_ = dbuf.decodeLiteral(header.value);
   if (err_ != HPACK::DecodeError::NONE) {
-    LOG(ERROR) << "Error decoding header value name=" << header.name
+    LOG(ERROR) << "Error decoding header value name=" << *name
                << " err_=" << err_;
     return 0;
   }
 
-  uint32_t emittedSize = emit(header, streamingCb, emitted);
+  uint32_t emittedSize = emit(*name, header.value, streamingCb, emitted);
 
   if (indexing) {
     auto headerBytes = header.bytes();
@@ -120,7 +155,7 @@ uint32_t HPACKDecoder::decodeIndexedHeader(
   }
 
   const auto& header = getHeader(index);
-  return emit(header, streamingCb, emitted);
+  return emit(header, streamingCb, emitted, isStatic(index));
 }
 
 bool HPACKDecoder::isValid(uint32_t index) {
@@ -11,16 +11,38 @@
 
 namespace proxygen {
 
-uint32_t HPACKDecoderBase::emit(const HPACKHeader& header,
+uint32_t HPACKDecoderBase::emit(const HPACKHeaderName& name,
+                                const folly::fbstring& value,
                                 HPACK::StreamingCallback* streamingCb,
-                                headers_t* emitted) {
-  if (streamingCb) {
-    streamingCb->onHeader(header.name, header.value);
+                                headers_t* emitted,
+                                bool fromStaticTable) {
+  if (sampling_) {
+    sampledCode_ = name.getHeaderCode();
+  }
+  if (streamingCb && fromStaticTable) {
+    streamingCb->onStaticHeader(name, value);
+  } else if (streamingCb) {
+    streamingCb->onHeader(name, value);
   } else if (emitted) {
     // copying HPACKHeader
-    emitted->emplace_back(header.name.get(), header.value);
+    emitted->emplace_back(name.get(), value);
+  }
+  return HPACKHeader::realBytes(name.size(), value.size());
+}
+
+void HPACKDecoderBase::recordSampledHeader(
+    HeaderCodec::Type type,
+    HPACK::StreamingCallback* streamingCb,
+    HeaderCodec::Representation representation,
+    uint32_t emittedSize,
+    uint32_t compressed) {
+  if (sampledCode_ == HTTP_HEADER_NONE || hasError()) {
+    return;
   }
-  return header.realBytes();
+  HeaderCodec::HeaderSample sample{
+      sampledCode_, representation, emittedSize + 2, compressed};
+  sampledCode_ = HTTP_HEADER_NONE;
+  streamingCb->stats->recordHeaderDecode(type, sample);
 }
 
 void HPACKDecoderBase::completeDecode(HeaderCodec::Type type,
@@ -29,6 +51,7 @@ void HPACKDecoderBase::completeDecode(HeaderCodec::Type type,
                                       uint32_t compressedBlockSize,
                                       uint32_t emittedSize,
                                       bool acknowledge) {
+  sampling_ = false;
   if (!streamingCb) {
     return;
   }
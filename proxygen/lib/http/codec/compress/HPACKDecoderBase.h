@@ -45,7 +45,19 @@ class HPACKDecoderBase {
  protected:
   uint32_t emit(const HPACKHeader& header,
                 HPACK::StreamingCallback* streamingCb,
-                headers_t* emitted);
+                headers_t* emitted,
+                bool fromStaticTable = false) {
+    return emit(
+        header.name, header.value, streamingCb, emitted, fromStaticTable);
+  }
+
+  // The name may belong to a table entry, so literals with an indexed name
+  // need not copy it
+  uint32_t emit(const HPACKHeaderName& name,
+                const folly::fbstring& value,
+                HPACK::StreamingCallback* streamingCb,
+                headers_t* emitted,
+                bool fromStaticTable = false);
 
   void completeDecode(HeaderCodec::Type type,
                       HPACK::StreamingCallback* streamingCb,
@@ -54,6 +66,21 @@ class HPACKDecoderBase {
                       uint32_t emittedSize,
                       bool acknowledge = false);
 
+  // Whether the headers of the block about to be decoded are sampled
+  bool startSampling(HeaderCodec::Type type,
+                     HPACK::StreamingCallback* streamingCb) {
+    sampling_ = streamingCb && streamingCb->stats &&
+                streamingCb->stats->sampleHeaders(type);
+    return sampling_;
+  }
+
+  // Reports the header emitted since clearing sampledCode_, if any
+  void recordSampledHeader(HeaderCodec::Type type,
+                           HPACK::StreamingCallback* streamingCb,
+                           HeaderCodec::Representation representation,
+                           uint32_t emittedSize,
+                           uint32_t compressed);
+
   void handleTableSizeUpdate(HPACKDecodeBuffer& dbuf,
                              HeaderTable& table,
                              /* used to determine whether or not we log
@@ -61,6 +88,9 @@ class HPACKDecoderBase {
                              bool isQpack = false);
 
   HPACK::DecodeError err_{HPACK::DecodeError::NONE};
+  bool sampling_{false};
+  // Of the last header emitted while sampling
+  HTTPHeaderCode sampledCode_{HTTP_HEADER_NONE};
   uint32_t maxTableSize_;
   uint64_t maxUncompressed_;
 };
@@ -10,6 +10,7 @@
 
 #include <memory>
 #include <proxygen/lib/http/codec/compress/HPACKConstants.h>
+#include <proxygen/lib/http/codec/compress/HuffmanLiteralCache.h>
 #include <proxygen/lib/http/codec/compress/Logging.h>
 #include <proxygen/lib/utils/Logging.h>
 
@@ -104,12 +105,19 @@ uint32_t HPACKEncodeBuffer::encodeHuffman(folly::StringPiece literal) {
 uint32_t HPACKEncodeBuffer::encodeHuffman(uint8_t instruction,
                                           uint8_t nbit,
                                           folly::StringPiece literal) {
-  static const auto& huffmanTree = huffman::huffTree();
-  uint32_t size = huffmanTree.getEncodeSize(literal);
-  // add the length
+  const auto& huffmanTree = huffman::huffTree();
   DCHECK_LE(nbit, 7);
   uint8_t huffmanOn = uint8_t(1 << nbit);
   DCHECK_EQ(instruction & huffmanOn, 0);
+  auto cached = huffman::HuffmanLiteralCache::find(literal);
+  if (cached) {
+    uint32_t count =
+        encodeInteger(cached->size(), instruction | huffmanOn, nbit);
+    buf_.push((const uint8_t*)cached->data(), cached->size());
+    return count + cached->size();
+  }
+  uint32_t size = huffmanTree.getEncodeSize(literal);
+  // add the length
   uint32_t count = encodeInteger(size, instruction | huffmanOn, nbit);
   // ensure we have enough bytes before performing the encoding
   count += huffmanTree.encode(literal, buf_);
@@ -21,6 +21,7 @@ std::unique_ptr<folly::IOBuf> HPACKEncoder::encode(
   for (const auto& header : headers) {
     encodeHeader(header.name, header.value); // const, string piece
   }
+  maybeGrowTable(table_, maxTableSize_);
   return streamBuffer_.release();
 }
 
@@ -32,15 +33,22 @@ void HPACKEncoder::encode(const vector<HPACKHeader>& headers,
     encodeHeader(header.name, header.value); // const, string piece
   }
   streamBuffer_.setWriteBuf(nullptr);
+  maybeGrowTable(table_, maxTableSize_);
 }
 
-void HPACKEncoder::startEncode(folly::IOBufQueue& writeBuf) {
+void HPACKEncoder::startEncode(folly::IOBufQueue& writeBuf,
+                               HeaderCodec::Stats* sampledStats) {
   streamBuffer_.setWriteBuf(&writeBuf);
   handlePendingContextUpdate(streamBuffer_, table_.capacity());
+  sampledStats_ = sampledStats;
+  sampledBuf_ = &writeBuf;
 }
 
 void HPACKEncoder::completeEncode() {
   streamBuffer_.setWriteBuf(nullptr);
+  maybeGrowTable(table_, maxTableSize_);
+  sampledStats_ = nullptr;
+  sampledBuf_ = nullptr;
 }
 
 size_t HPACKEncoder::encodeHeader(HTTPHeaderCode code,
@@ -48,7 +56,11 @@ size_t HPACKEncoder::encodeHeader(HTTPHeaderCode code,
   DCHECK_NE(code, HTTP_HEADER_OTHER);
   HPACKHeaderName name(code);
   size_t uncompressed = name.size() + value.size() + 2;
+  auto before = sampledStats_ ? sampledBuf_->chainLength() : 0;
   encodeHeader(name, value); // const, string piece
+  if (sampledStats_) {
+    recordSampledHeader(code, uncompressed, before);
+  }
   return uncompressed;
 }
 
@@ -57,7 +69,11 @@ size_t HPACKEncoder::encodeHeader(HTTPHeaderCode code,
   DCHECK_NE(code, HTTP_HEADER_OTHER);
   HPACKHeaderName name(code);
   size_t uncompressed = name.size() + value.size() + 2;
+  auto before = sampledStats_ ? sampledBuf_->chainLength() : 0;
   encodeHeader(std::move(name), std::move(value));
+  if (sampledStats_) {
+    recordSampledHeader(code, uncompressed, before);
+  }
   return uncompressed;
 }
 
@@ -65,7 +81,12 @@ size_t HPACKEncoder::encodeHeader(const std::string& nameStr,
                                   const std::string& value) {
   HPACKHeaderName name(nameStr);
   size_t uncompressed = name.size() + value.size() + 2;
+  auto before = sampledStats_ ? sampledBuf_->chainLength() : 0;
+  auto code = sampledStats_ ? name.getHeaderCode() : HTTP_HEADER_OTHER;
   encodeHeader(std::move(name), folly::StringPiece(value)); // &&, StringPiece
+  if (sampledStats_) {
+    recordSampledHeader(code, uncompressed, before);
+  }
   return uncompressed;
 }
 
@@ -94,6 +115,7 @@ bool HPACKEncoder::encodeAsLiteral(const HPACKHeaderName& name,
   encodeAsLiteralImpl(name, nameIndex, value, indexing);
   // indexed ones need to get added to the header table
   if (indexing) {
+    onTableInsert(name, value);
     CHECK(table_.add(HPACKHeader(name, value)));
   }
   return true;
@@ -106,6 +128,7 @@ bool HPACKEncoder::encodeAsLiteral(HPACKHeaderName&& name,
   encodeAsLiteralImpl(name, nameIndex, value, indexing);
   // indexed ones need to get added to the header table
   if (indexing) {
+    onTableInsert(name, value);
     CHECK(table_.add(HPACKHeader(std::move(name), std::move(value))));
   }
   return true;
@@ -118,6 +141,7 @@ bool HPACKEncoder::encodeAsLiteral(HPACKHeaderName&& name,
   encodeAsLiteralImpl(name, nameIndex, value, indexing);
   // indexed ones need to get added to the header table
   if (indexing) {
+    onTableInsert(name, value);
     CHECK(table_.add(HPACKHeader(std::move(name), value)));
   }
   return true;
@@ -150,12 +174,19 @@ folly::Optional<uint32_t> HPACKEncoder::encodeHeaderImpl(
   uint32_t nameIndex = 0;
   // Check to see if the header is the static or dynamic table
   std::tie(index, nameIndex) = getIndex(name, value);
+  lookups_++;
 
   // Finally encode the header as determined above
   if (index) {
+    if (!isStatic(index)) {
+      dynamicRefs_++;
+    }
     encodeAsIndex(index);
+    lastRepresentation_ = HeaderCodec::Representation::INDEXED;
     return folly::none;
   } else {
+    lastRepresentation_ = nameIndex ? HeaderCodec::Representation::NAME_INDEXED
+                                    : HeaderCodec::Representation::LITERAL;
     indexable =
         HPACKHeader::bytes(name.size(), value.size()) <= table_.capacity() &&
         (!indexingStrat_ ||
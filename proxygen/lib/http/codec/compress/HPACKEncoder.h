@@ -11,6 +11,7 @@
 #include <folly/io/IOBuf.h>
 #include <proxygen/lib/http/codec/compress/HPACKConstants.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncoderBase.h>
+#include <proxygen/lib/http/codec/compress/HeaderCodec.h>
 #include <vector>
 
 namespace proxygen {
@@ -21,7 +22,9 @@ class HPACKEncoder
 
  public:
   explicit HPACKEncoder(bool huffman, uint32_t tableSize = HPACK::kTableSize)
-      : HPACKEncoderBase(huffman), HPACKContext(tableSize) {
+      : HPACKEncoderBase(huffman),
+        HPACKContext(tableSize),
+        maxTableSize_(tableSize) {
   }
 
   /**
@@ -34,7 +37,9 @@ class HPACKEncoder
   void encode(const std::vector<HPACKHeader>& headers,
               folly::IOBufQueue& writeBuf);
 
-  void startEncode(folly::IOBufQueue& writeBuf);
+  // Reports each header encoded until completeEncode to sampledStats, if set
+  void startEncode(folly::IOBufQueue& writeBuf,
+                   HeaderCodec::Stats* sampledStats = nullptr);
 
   size_t encodeHeader(HTTPHeaderCode code, const std::string& value);
 
@@ -44,11 +49,53 @@ class HPACKEncoder
 
   void completeEncode();
 
+  // The peer's limit, SETTINGS_HEADER_TABLE_SIZE
   void setHeaderTableSize(uint32_t size) {
+    maxTableSize_ = size;
+    if (adaptiveTableSize_) {
+      size = getAdaptiveCapacity(table_, size);
+    }
     HPACKEncoderBase::setHeaderTableSize(table_, size);
   }
 
+  /**
+   * Uses a table of initialSize, which grows up to the peer's limit as
+   * AdaptiveTableSize decides, and shrinks back in releaseTable().
+   */
+  void setAdaptiveTableSize(uint32_t initialSize) {
+    adaptiveTableSize_.emplace(initialSize);
+    HPACKEncoderBase::setHeaderTableSize(
+        table_, std::min(initialSize, maxTableSize_));
+  }
+
+  /**
+   * Empties the table and frees its storage.  The next header block starts
+   * with the size updates emptying the decoder's table as well.
+   */
+  void releaseTable() {
+    auto size = adaptiveTableSize_
+                    ? std::min(adaptiveTableSize_->getInitialSize(),
+                               maxTableSize_)
+                    : table_.capacity();
+    if (table_.size() > 0) {
+      HPACKEncoderBase::setHeaderTableSize(table_, 0);
+    }
+    HPACKEncoderBase::setHeaderTableSize(table_, size);
+    releaseTableStorage();
+  }
+
  private:
+  void recordSampledHeader(HTTPHeaderCode code,
+                           size_t uncompressed,
+                           size_t before) {
+    HeaderCodec::HeaderSample sample{
+        code,
+        lastRepresentation_,
+        static_cast<uint32_t>(uncompressed),
+        static_cast<uint32_t>(sampledBuf_->chainLength() - before)};
+    sampledStats_->recordHeaderEncode(HeaderCodec::Type::HPACK, sample);
+  }
+
   void encodeAsIndex(uint32_t index);
 
   // movable name and value
@@ -90,6 +137,13 @@ class HPACKEncoder
                      folly::StringPiece value,
                      uint32_t nameIndex,
                      const HPACK::Instruction& instruction);
+
+  uint32_t maxTableSize_;
+  HeaderCodec::Stats* sampledStats_{nullptr};
+  folly::IOBufQueue* sampledBuf_{nullptr};
+  // Of the last header encoded
+  HeaderCodec::Representation lastRepresentation_{
+      HeaderCodec::Representation::LITERAL};
 };
 
 } // namespace proxygen
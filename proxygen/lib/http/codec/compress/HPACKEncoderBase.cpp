@@ -16,8 +16,13 @@ uint32_t HPACKEncoderBase::handlePendingContextUpdate(HPACKEncodeBuffer& buf,
       << "Code assumes these are equal";
   uint32_t encoded = 0;
   if (pendingContextUpdate_) {
+    if (minPendingTableSize_ < tableCapacity) {
+      VLOG(5) << "Encoding table size update size=" << minPendingTableSize_;
+      encoded +=
+          buf.encodeInteger(minPendingTableSize_, HPACK::TABLE_SIZE_UPDATE);
+    }
     VLOG(5) << "Encoding table size update size=" << tableCapacity;
-    encoded = buf.encodeInteger(tableCapacity, HPACK::TABLE_SIZE_UPDATE);
+    encoded += buf.encodeInteger(tableCapacity, HPACK::TABLE_SIZE_UPDATE);
     pendingContextUpdate_ = false;
   }
 
@@ -8,6 +8,11 @@
 
 #pragma once
 
+#include <algorithm>
+
+#include <folly/Optional.h>
+#include <folly/hash/Hash.h>
+#include <proxygen/lib/http/codec/compress/AdaptiveTableSize.h>
 #include <proxygen/lib/http/codec/compress/HPACKContext.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncodeBuffer.h>
 #include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
@@ -36,6 +41,8 @@ class HPACKEncoderBase {
   void setHeaderTableSize(HeaderTable& table, uint32_t size) {
     if (size != table.capacity()) {
       CHECK(table.setCapacity(size));
+      minPendingTableSize_ =
+          pendingContextUpdate_ ? std::min(minPendingTableSize_, size) : size;
       pendingContextUpdate_ = true;
     }
   }
@@ -50,13 +57,65 @@ class HPACKEncoderBase {
     return indexingStrat_;
   }
 
+  // A table size update to signal at the start of the next block
+  bool hasPendingContextUpdate() const {
+    return pendingContextUpdate_;
+  }
+
+  // Header lookups, and those that hit the dynamic table
+  uint32_t getLookups() const {
+    return lookups_;
+  }
+  uint32_t getDynamicRefs() const {
+    return dynamicRefs_;
+  }
+
  protected:
   uint32_t handlePendingContextUpdate(HPACKEncodeBuffer& buf,
                                       uint32_t tableCapacity);
 
+  // The capacity for a table the peer allows maxSize, with adaptive sizing
+  uint32_t getAdaptiveCapacity(const HeaderTable& table,
+                               uint32_t maxSize) const {
+    return std::min(
+        maxSize,
+        std::max(table.capacity(), adaptiveTableSize_->getInitialSize()));
+  }
+
+  // Before adding name: value to the table
+  void onTableInsert(const HPACKHeaderName& name, folly::StringPiece value) {
+    if (adaptiveTableSize_) {
+      adaptiveTableSize_->onInsert(folly::hash::hash_combine(
+          folly::StringPiece(name.get()), value));
+    }
+  }
+
+  // After a header block
+  void maybeGrowTable(HeaderTable& table, uint32_t maxSize) {
+    if (!adaptiveTableSize_) {
+      return;
+    }
+    auto size = adaptiveTableSize_->onBlockEncoded(
+        lookups_,
+        dynamicRefs_,
+        table.getInsertCount() - table.size(),
+        table.capacity(),
+        maxSize);
+    if (size) {
+      VLOG(4) << "Growing the header table to " << size;
+      setHeaderTableSize(table, size);
+    }
+  }
+
   const HeaderIndexingStrategy* indexingStrat_;
   HPACKEncodeBuffer streamBuffer_;
   bool pendingContextUpdate_{false};
+  // The smallest size set since the last update, signaled first when the
+  // table was shrunk and grown back, RFC 7541 section 4.2
+  uint32_t minPendingTableSize_{0};
+  uint32_t lookups_{0};
+  uint32_t dynamicRefs_{0};
+  folly::Optional<AdaptiveTableSize> adaptiveTableSize_;
 };
 
 } // namespace proxygen
@@ -83,7 +83,7 @@ class HPACKHeaderName {
     return !(*this == headerName);
   }
   bool operator>(const HPACKHeaderName& headerName) const {
-    if (!isAllocated() && !headerName.isAllocated()) {
+    if (isOrderedByAddress() && headerName.isOrderedByAddress()) {
       // Common header tables are aligned alphabetically (unit tested as well
       // to ensure it isn't accidentally changed)
       return address_ > headerName.address_;
@@ -92,7 +92,7 @@ class HPACKHeaderName {
     }
   }
   bool operator<(const HPACKHeaderName& headerName) const {
-    if (!isAllocated() && !headerName.isAllocated()) {
+    if (isOrderedByAddress() && headerName.isOrderedByAddress()) {
       // Common header tables are aligned alphabetically (unit tested as well
       // to ensure it isn't accidentally changed)
       return address_ < headerName.address_;
@@ -202,6 +202,18 @@ class HPACKHeaderName {
     }
   }
 
+  /*
+   * Generated common header names are laid out alphabetically in the table,
+   * so their addresses order like the strings.  Runtime extension names
+   * (HTTPCommonHeaders::registerExtension) are appended in registration order
+   * and must be compared by value.
+   */
+  bool isOrderedByAddress() const {
+    auto code = getHeaderCode();
+    return code >= HTTPHeaderCodeCommonOffset &&
+           !HTTPCommonHeaders::isExtension(code);
+  }
+
   /*
    * Address either stores a pointer to a header name in HTTPCommonHeaders,
    * or stores a pointer to a dynamically allocated std::string
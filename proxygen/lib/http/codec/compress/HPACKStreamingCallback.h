@@ -20,6 +20,12 @@ class StreamingCallback {
 
   virtual void onHeader(const HPACKHeaderName& name,
                         const folly::fbstring& value) = 0;
+  // A header referenced whole from the static table.  Its name and value are
+  // constants of the spec, so callbacks can skip validating them.
+  virtual void onStaticHeader(const HPACKHeaderName& name,
+                              const folly::fbstring& value) {
+    onHeader(name, value);
+  }
   virtual void onHeadersComplete(HTTPHeaderSize decodedSize,
                                  bool acknowledge) = 0;
   virtual void onDecodeError(HPACK::DecodeError decodeError) = 0;
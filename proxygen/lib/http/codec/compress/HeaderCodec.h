@@ -11,6 +11,7 @@
 #include <folly/Expected.h>
 #include <folly/FBString.h>
 #include <memory>
+#include <proxygen/lib/http/HTTPCommonHeaders.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/codec/compress/Header.h>
 #include <proxygen/lib/http/codec/compress/HeaderPiece.h>
@@ -38,6 +39,22 @@ class HeaderCodec {
 
   enum class Type : uint8_t { GZIP = 0, HPACK = 1, QPACK = 2 };
 
+  // How a header was represented in a block
+  enum class Representation : uint8_t {
+    INDEXED = 0,      // from the static or dynamic table
+    NAME_INDEXED = 1, // literal value, name from a table
+    LITERAL = 2,
+  };
+
+  struct HeaderSample {
+    // HTTP_HEADER_OTHER for uncommon names
+    HTTPHeaderCode code;
+    Representation representation;
+    // name + value + 2, as in HTTPHeaderSize
+    uint32_t uncompressed;
+    uint32_t compressed;
+  };
+
   class Stats {
    public:
     Stats() {
@@ -49,6 +66,20 @@ class HeaderCodec {
     virtual void recordDecode(Type type, HTTPHeaderSize& size) = 0;
     virtual void recordDecodeError(Type type) = 0;
     virtual void recordDecodeTooLarge(Type type) = 0;
+
+    /**
+     * Per-header telemetry.  Asked once per header block, and if true, each
+     * header of the block is reported to recordHeaderEncode/Decode.
+     */
+    virtual bool sampleHeaders(Type /*type*/) {
+      return false;
+    }
+    virtual void recordHeaderEncode(Type /*type*/,
+                                    const HeaderSample& /*sample*/) {
+    }
+    virtual void recordHeaderDecode(Type /*type*/,
+                                    const HeaderSample& /*sample*/) {
+    }
   };
 
   HeaderCodec() {
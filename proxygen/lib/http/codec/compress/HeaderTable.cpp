@@ -27,6 +27,7 @@ void HeaderTable::init(uint32_t capacityVal) {
   for (uint32_t i = 0; i < initLength; i++) {
     table_.emplace_back();
   }
+  prevSameName_.assign(initLength, 0);
   names_.clear();
 }
 
@@ -51,8 +52,16 @@ bool HeaderTable::add(HPACKHeader header) {
         std::min((uint32_t)ceil(size_ * 1.5), getMaxTableLength(capacity_)));
   }
   head_ = next(head_);
-  // index name
-  names_[header.name].push_back(head_);
+  // index name, chaining to the previous entry with the same name
+  uint32_t absIndex = insertCount_ + 1;
+  auto it = names_.find(header.name);
+  if (it == names_.end()) {
+    prevSameName_[head_] = 0;
+    names_.emplace(header.name, absIndex);
+  } else {
+    prevSameName_[head_] = absIndex - it->second;
+    it->second = absIndex;
+  }
   bytes_ += header.bytes();
   table_[head_] = std::move(header);
 
@@ -75,18 +84,19 @@ std::pair<uint32_t, uint32_t> HeaderTable::getIndexImpl(
     const HPACKHeaderName& headerName,
     folly::StringPiece value,
     bool nameOnly) const {
-  auto it = names_.find(headerName);
-  if (it == names_.end()) {
-    return {0, 0};
-  }
-  for (auto indexIt = it->second.rbegin(); indexIt != it->second.rend();
-       ++indexIt) {
-    auto i = *indexIt;
+  std::pair<uint32_t, uint32_t> result{0, 0};
+  forEachNameIndex(headerName, [&](uint32_t i) {
     if (nameOnly || table_[i].value == value) {
-      return {toExternal(i), 0};
+      result = {toExternal(i), 0};
+      return true;
     }
-  }
-  return {0, toExternal(*it->second.rbegin())};
+    if (result.second == 0) {
+      // newest entry with the same name
+      result.second = toExternal(i);
+    }
+    return false;
+  });
+  return result;
 }
 
 bool HeaderTable::hasName(const HPACKHeaderName& headerName) {
@@ -112,15 +122,11 @@ uint32_t HeaderTable::getMaxTableLength(uint32_t capacityVal) const {
 
 uint32_t HeaderTable::removeLast() {
   auto t = tail();
-  // remove the first element from the names index
+  // remove the name if this was the only entry left with it; chains to this
+  // entry from newer ones are cut by the age check in forEachNameIndex
   auto names_it = names_.find(table_[t].name);
   DCHECK(names_it != names_.end());
-  auto& ilist = names_it->second;
-  DCHECK_EQ(ilist.front(), t);
-  ilist.pop_front();
-
-  // remove the name if there are no indices associated with it
-  if (ilist.empty()) {
+  if (names_it->second == insertCount_ - size_ + 1) {
     names_.erase(names_it);
   }
   const auto& header = table_[t];
@@ -164,6 +170,21 @@ bool HeaderTable::setCapacity(uint32_t newCapacity) {
   return true;
 }
 
+void HeaderTable::releaseStorage() {
+  if (size_ == 0) {
+    std::vector<HPACKHeader>(1).swap(table_);
+    std::vector<uint32_t>(1, 0).swap(prevSameName_);
+    names_map().swap(names_);
+    head_ = 0;
+    return;
+  }
+  // The slots after head_ up to the tail hold evicted entries
+  for (uint32_t i = length() - size_, slot = next(head_); i > 0; i--) {
+    table_[slot] = HPACKHeader();
+    slot = next(slot);
+  }
+}
+
 void HeaderTable::increaseTableLengthTo(uint32_t newLength) {
   DCHECK_GE(newLength, length());
   uint32_t oldTail = (size_ > 0) ? tail() : 0;
@@ -173,26 +194,15 @@ void HeaderTable::increaseTableLengthTo(uint32_t newLength) {
   // TODO: referenence to head here is incompatible with baseIndex
   if (size_ > 0 && oldTail > head_) {
     // the list wrapped around, need to move oldTail..oldLength to the end
-    // of the now-larger table_
+    // of the now-larger table_.  The names index is in terms of inserts, so
+    // it does not need updating.
     updateResizedTable(oldTail, oldLength, newLength);
-    // Update the names indecies that pointed to the old range
-    for (auto& names_it : names_) {
-      for (auto& idx : names_it.second) {
-        if (idx >= oldTail) {
-          DCHECK_LT(idx + (length() - oldLength), length());
-          idx += (length() - oldLength);
-        } else {
-          // remaining indecies in the list were smaller than oldTail, so
-          // should be indexed from 0
-          break;
-        }
-      }
-    }
   }
 }
 
 void HeaderTable::resizeTable(uint32_t newLength) {
   table_.resize(newLength);
+  prevSameName_.resize(newLength);
 }
 
 void HeaderTable::updateResizedTable(uint32_t oldTail,
@@ -201,6 +211,9 @@ void HeaderTable::updateResizedTable(uint32_t oldTail,
   std::move_backward(table_.begin() + oldTail,
                      table_.begin() + oldLength,
                      table_.begin() + newLength);
+  std::move_backward(prevSameName_.begin() + oldTail,
+                     prevSameName_.begin() + oldLength,
+                     prevSameName_.begin() + newLength);
 }
 
 uint32_t HeaderTable::evict(uint32_t needed, uint32_t desiredCapacity) {
@@ -20,12 +20,18 @@ namespace proxygen {
 /**
  * Data structure for maintaining indexed headers, based on a fixed-length ring
  * with FIFO semantics. Externally it acts as an array.
+ *
+ * Entries sharing a name are chained through prevSameName_, a flat array
+ * parallel to the ring. Each link is the number of inserts between an entry
+ * and the previous one with the same name. Since eviction is FIFO, a link is
+ * only followed while it stays inside the last size_ inserts, which makes the
+ * links valid without any fixups on eviction, flush or resize.
  */
 
 class HeaderTable {
  public:
-  // TODO: std::vector might be faster than std::list in the use case?
-  using names_map = folly::F14FastMap<HPACKHeaderName, std::list<uint32_t>>;
+  // maps a name to the absolute index (insert count) of its newest entry
+  using names_map = folly::F14FastMap<HPACKHeaderName, uint32_t>;
 
   explicit HeaderTable(uint32_t capacityVal) {
     init(capacityVal);
@@ -119,6 +125,13 @@ class HeaderTable {
    */
   virtual bool setCapacity(uint32_t capacity);
 
+  /**
+   * Frees the evicted entries, and the slots of an empty table, which grows
+   * back as entries are added.  HPACK only, the entries and indices are
+   * unchanged.
+   */
+  void releaseStorage();
+
   /**
    * @return number of valid entries
    */
@@ -207,9 +220,38 @@ class HeaderTable {
    */
   uint32_t toInternal(uint32_t externalIndex) const;
 
+  /**
+   * Visit the internal indices of the entries with the given name, newest
+   * first, until fn returns true.
+   */
+  template <typename F>
+  void forEachNameIndex(const HPACKHeaderName& headerName, F&& fn) const {
+    auto it = names_.find(headerName);
+    if (it == names_.end()) {
+      return;
+    }
+    // how many inserts ago the entry was added
+    uint32_t age = insertCount_ - it->second;
+    while (age < size_) {
+      uint32_t i = (head_ + length() - age) % length();
+      if (fn(i)) {
+        return;
+      }
+      uint32_t prev = prevSameName_[i];
+      if (prev == 0 || prev >= size_ - age) {
+        // no older entry with this name, or it was evicted
+        return;
+      }
+      age += prev;
+    }
+  }
+
   uint32_t capacity_{0};
   uint32_t bytes_{0}; // size in bytes of the current entries
   std::vector<HPACKHeader> table_;
+  // for each slot, how many inserts earlier the previous entry with the same
+  // name was added, or 0 if there was none
+  std::vector<uint32_t> prevSameName_;
 
   uint32_t size_{0}; // how many entries we have in the table
   uint32_t head_{0}; // points to the first element of the ring
@@ -8,26 +8,108 @@
 
 #include <proxygen/lib/http/codec/compress/Huffman.h>
 
-#include <folly/Indestructible.h>
 #include <folly/portability/Sockets.h>
 
 using std::pair;
 
 namespace proxygen { namespace huffman {
 
-HuffTree::HuffTree(const uint32_t* codes, const uint8_t* bits)
-    : codes_(codes), bits_(bits) {
-  buildTree();
+bool HuffTree::decode(const uint8_t* buf,
+                      uint32_t size,
+                      folly::fbstring& literal) const {
+  // every character takes at least 5 bits, so this is enough room for the
+  // output plus the extra byte written by a single character entry
+  size_t start = literal.size();
+  literal.resize(start + size * 8 / 5 + 1);
+  char* out = &literal[start];
+  uint64_t w = 0;     // 8-byte word, the bits not consumed are aligned to LSB
+  uint32_t wbits = 0; // how many bits we have in 'w'
+  uint32_t i = 0;
+  while (true) {
+    // load whole bytes while they fit, so the longest code (30 bits) is
+    // always available unless we reached the end of the buffer
+    while (wbits <= 56 && i < size) {
+      w = (w << 8) | buf[i];
+      wbits += 8;
+      i++;
+    }
+    if (wbits == 0) {
+      break;
+    }
+    uint32_t key;
+    if (wbits >= kMultiSymbolBits) {
+      key = (w >> (wbits - kMultiSymbolBits)) & (kMultiSymbolTableSize - 1);
+    } else {
+      // end of the buffer, pad with 1's like the encoder does
+      uint32_t xbits = kMultiSymbolBits - wbits;
+      key = ((w << xbits) | ((1 << xbits) - 1)) & (kMultiSymbolTableSize - 1);
+    }
+    const HuffMultiSymbol& entry = multiTable_[key];
+    if (entry.count == 0) {
+      uint8_t bits = decodeLongCode(w, wbits, out);
+      if (bits == 0) {
+        break;
+      }
+      out++;
+      wbits -= bits;
+    } else if (entry.bits <= wbits) {
+      out[0] = entry.ch[0];
+      out[1] = entry.ch[1];
+      out += entry.count;
+      wbits -= entry.bits;
+    } else if (entry.firstBits <= wbits) {
+      // the second character was made up from padding
+      *out++ = entry.ch[0];
+      wbits -= entry.firstBits;
+    } else {
+      // only padding left
+      break;
+    }
+  }
+  literal.resize(out - literal.data());
+  return true;
 }
 
-HuffTree::HuffTree(const HuffTree& tree)
-    : codes_(tree.codes_), bits_(tree.bits_) {
-  buildTree();
+/**
+ * decode one character whose code is longer than kMultiSymbolBits, using the
+ * lowest 'wbits' bits of 'w', and store it in 'out'
+ *
+ * @return how many bits were consumed, 0 if the remaining bits are padding
+ */
+uint8_t HuffTree::decodeLongCode(uint64_t w,
+                                 uint32_t wbits,
+                                 char* out) const {
+  const SuperHuffNode* snode = &table_[0];
+  uint32_t used = 0;
+  while (true) {
+    uint32_t left = wbits - used;
+    uint32_t key;
+    if (left >= 8) {
+      key = (w >> (left - 8)) & 0xFF;
+    } else {
+      uint8_t xbits = 8 - left;
+      key = ((w << xbits) | ((1 << xbits) - 1)) & 0xFF;
+    }
+    const HuffNode& node = snode->index[key];
+    if (node.isLeaf()) {
+      // EOS has no bits set
+      if (node.metadata.bits == 0 || node.metadata.bits > left) {
+        return 0;
+      }
+      *out = node.ch();
+      return used + node.metadata.bits;
+    }
+    if (left < 8) {
+      return 0;
+    }
+    used += 8;
+    snode = &table_[node.superNodeIndex()];
+  }
 }
 
-bool HuffTree::decode(const uint8_t* buf,
-                      uint32_t size,
-                      folly::fbstring& literal) const {
+bool HuffTree::decodeTree(const uint8_t* buf,
+                          uint32_t size,
+                          folly::fbstring& literal) const {
   const SuperHuffNode* snode = &table_[0];
   uint32_t w = 0;
   uint32_t wbits = 0;
@@ -54,13 +136,13 @@ bool HuffTree::decode(const uint8_t* buf,
     const HuffNode& node = snode->index[key];
     if (node.isLeaf()) {
       // final node, we can emit the character
-      literal.push_back(node.data.ch);
+      literal.push_back(node.ch());
       wbits -= node.metadata.bits;
       snode = &table_[0];
     } else {
       // this is a branch, so we just need to move one level
       wbits -= 8;
-      snode = &table_[node.data.superNodeIndex];
+      snode = &table_[node.superNodeIndex()];
     }
     // remove what we've just used
     w = w & ((1 << wbits) - 1);
@@ -68,30 +150,6 @@ bool HuffTree::decode(const uint8_t* buf,
   return true;
 }
 
-/**
- * insert a new character into the tree, identified by an unique code,
- * a number of bits to represent it. The code is aligned at LSB.
- */
-void HuffTree::insert(uint32_t code, uint8_t bits, uint8_t ch) {
-  SuperHuffNode* snode = &table_[0];
-  while (bits > 8) {
-    uint32_t mask = 0xFF << (bits - 8);
-    uint32_t x = (code & mask) >> (bits - 8);
-    // mark this node as branch
-    if (snode->index[x].isLeaf()) {
-      nodes_++;
-      HuffNode& node = snode->index[x];
-      node.metadata.isSuperNode = true;
-      node.data.superNodeIndex = nodes_;
-    }
-    snode = &table_[snode->index[x].data.superNodeIndex];
-    bits -= 8;
-    code = code & ~mask;
-  }
-  // fill the node with all the suffixes
-  fillIndex(*snode, code, bits, ch, bits);
-}
-
 const uint32_t* HuffTree::codesTable() const {
   return codes_;
 }
@@ -100,61 +158,22 @@ const uint8_t* HuffTree::bitsTable() const {
   return bits_;
 }
 
-/**
- * recursive function for generating subtrees
- */
-void HuffTree::fillIndex(SuperHuffNode& snode,
-                         uint32_t code,
-                         uint8_t bits,
-                         uint8_t ch,
-                         uint8_t level) {
-  if (level == 8) {
-    snode.index[code].data.ch = ch;
-    snode.index[code].metadata.bits = bits;
-    return;
-  }
-  // generate the bit at the current level
-  code = code << 1;
-  for (uint8_t bit = 0; bit <= 1; bit++) {
-    fillIndex(snode, code | bit, bits, ch, level + 1);
-  }
-}
-
-/**
- * initializes and builds the huffman tree
- */
-void HuffTree::buildTree() {
-  // create the indexed table
-  for (uint32_t i = 0; i < kTableSize; i++) {
-    insert(codes_[i], bits_[i], i);
-  }
-}
-
 uint32_t HuffTree::encode(folly::StringPiece literal,
                           folly::io::QueueAppender& buf) const {
-  uint32_t code;     // the huffman code of a given character
-  uint8_t bits;      // on how many bits code is represented
-  uint32_t w = 0;    // 4-byte word used for packing bits and write it to memory
-  uint8_t wbits = 0; // how many bits we have in 'w'
+  uint64_t w = 0;     // 8-byte word used for packing bits, aligned to LSB
+  uint32_t wbits = 0; // how many bits we have in 'w', < 32 between chars
   uint32_t totalBytes = 0;
   for (size_t i = 0; i < literal.size(); i++) {
     uint8_t ch = literal[i];
-    code = codes_[ch];
-    bits = bits_[ch];
-
-    if (wbits + bits < 32) {
-      w = (w << bits) | code;
-      wbits += bits;
-    } else {
-      uint8_t xbits = wbits + bits - 32;
-      w = (w << (bits - xbits)) | (code >> xbits);
+    // codes are up to 30 bits, so they always fit next to what we have
+    w = (w << bits_[ch]) | codes_[ch];
+    wbits += bits_[ch];
+    if (wbits >= 32) {
+      wbits -= 32;
       // write the word into the buffer by converting to network order, which
       // takes care of the endianness problems
-      buf.writeBE<uint32_t>(w);
+      buf.writeBE<uint32_t>(static_cast<uint32_t>(w >> wbits));
       totalBytes += 4;
-      // carry for next batch
-      wbits = xbits;
-      w = code & ((1 << xbits) - 1);
     }
   }
   // we might have some padding at the byte level
@@ -168,12 +187,10 @@ uint32_t HuffTree::encode(folly::StringPiece literal,
   // we need to write the leftover bytes, from 1 to 4 bytes
   if (wbits > 0) {
     uint8_t bytes = wbits >> 3;
-    // align the bits to the MSB
-    w = w << (32 - wbits);
-    // set the bytes in the network order and copy w[0], w[1]...
-    w = htonl(w);
+    // align the bits to the MSB and set the bytes in the network order
+    uint32_t tail = htonl(static_cast<uint32_t>(w << (32 - wbits)));
     // we need to use memcpy because we might write less than 4 bytes
-    buf.push((uint8_t*)&w, bytes);
+    buf.push((uint8_t*)&tail, bytes);
     totalBytes += bytes;
   }
   return totalBytes;
@@ -198,7 +215,7 @@ pair<uint32_t, uint8_t> HuffTree::getCode(uint8_t ch) const {
 }
 
 // http://tools.ietf.org/html/draft-ietf-httpbis-header-compression-09#appendix-C
-const uint32_t s_codesTable[kTableSize] = {
+constexpr uint32_t s_codesTable[kTableSize] = {
     0x1ff8,    0x7fffd8,   0xfffffe2, 0xfffffe3, 0xfffffe4,  0xfffffe5,
     0xfffffe6, 0xfffffe7,  0xfffffe8, 0xffffea,  0x3ffffffc, 0xfffffe9,
     0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec, 0xfffffed,  0xfffffee,
@@ -243,7 +260,7 @@ const uint32_t s_codesTable[kTableSize] = {
     0x7ffffe9, 0x7ffffea,  0x7ffffeb, 0xffffffe, 0x7ffffec,  0x7ffffed,
     0x7ffffee, 0x7ffffef,  0x7fffff0, 0x3ffffee};
 
-const uint8_t s_bitsTable[kTableSize] = {
+constexpr uint8_t s_bitsTable[kTableSize] = {
     13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28, 28, 28, 28,
     28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28, 6,  10, 10, 12, 13, 6,
     8,  11, 10, 10, 8,  11, 8,  6,  6,  6,  5,  5,  5,  6,  6,  6,  6,  6,  6,
@@ -259,10 +276,103 @@ const uint8_t s_bitsTable[kTableSize] = {
     22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23, 26, 27, 26, 26, 27, 27, 27,
     27, 27, 28, 27, 27, 27, 27, 27, 26};
 
-const HuffTree& huffTree() {
-  static const folly::Indestructible<HuffTree> huffTree{
-      HuffTree{s_codesTable, s_bitsTable}};
-  return *huffTree;
+constexpr HuffTree::HuffTree(const uint32_t* codes, const uint8_t* bits)
+    : codes_(codes), bits_(bits) {
+  buildTree();
+}
+
+/**
+ * insert a new character into the tree, identified by an unique code,
+ * a number of bits to represent it. The code is aligned at LSB.
+ */
+constexpr void HuffTree::insert(uint32_t code, uint8_t bits, uint8_t ch) {
+  SuperHuffNode* snode = &table_[0];
+  while (bits > 8) {
+    uint32_t mask = 0xFF << (bits - 8);
+    uint32_t x = (code & mask) >> (bits - 8);
+    // mark this node as branch
+    if (snode->index[x].isLeaf()) {
+      nodes_++;
+      HuffNode& node = snode->index[x];
+      node.metadata.isSuperNode = true;
+      node.value = nodes_;
+    }
+    snode = &table_[snode->index[x].superNodeIndex()];
+    bits -= 8;
+    code = code & ~mask;
+  }
+  // fill the node with all the suffixes
+  fillIndex(*snode, code, bits, ch);
+}
+
+/**
+ * fills every index of snode the code, of bits <= 8, is a prefix of
+ */
+constexpr void HuffTree::fillIndex(SuperHuffNode& snode,
+                                   uint32_t code,
+                                   uint8_t bits,
+                                   uint8_t ch) {
+  uint32_t prefix = code << (8 - bits);
+  for (uint32_t k = 0; k < (1u << (8 - bits)); k++) {
+    HuffNode& node = snode.index[prefix | k];
+    node.value = ch;
+    node.metadata.bits = bits;
+  }
+}
+
+/**
+ * initializes and builds the huffman tree
+ */
+constexpr void HuffTree::buildTree() {
+  // create the indexed table
+  for (uint32_t i = 0; i < kTableSize; i++) {
+    insert(codes_[i], bits_[i], i);
+  }
+  buildMultiSymbolTable();
+}
+
+/**
+ * fills the multi-symbol table with every code, or pair of codes, that fits
+ * in kMultiSymbolBits. Each one owns all the keys it is a prefix of.
+ */
+constexpr void HuffTree::buildMultiSymbolTable() {
+  // bounds the pairs to try, keeping the compile time evaluation short
+  uint8_t minBits = kMultiSymbolBits;
+  for (uint32_t i = 0; i < kTableSize; i++) {
+    minBits = bits_[i] < minBits ? bits_[i] : minBits;
+  }
+  for (uint32_t i = 0; i < kTableSize; i++) {
+    uint8_t bits = bits_[i];
+    if (bits > kMultiSymbolBits) {
+      continue;
+    }
+    uint32_t prefix = codes_[i] << (kMultiSymbolBits - bits);
+    for (uint32_t k = 0; k < (1u << (kMultiSymbolBits - bits)); k++) {
+      HuffMultiSymbol& entry = multiTable_[prefix | k];
+      entry.ch[0] = i;
+      entry.count = 1;
+      entry.firstBits = bits;
+      entry.bits = bits;
+    }
+    if (bits + minBits > kMultiSymbolBits) {
+      continue;
+    }
+    for (uint32_t j = 0; j < kTableSize; j++) {
+      uint8_t bits2 = bits + bits_[j];
+      if (bits2 > kMultiSymbolBits) {
+        continue;
+      }
+      uint32_t prefix2 = prefix | (codes_[j] << (kMultiSymbolBits - bits2));
+      for (uint32_t k = 0; k < (1u << (kMultiSymbolBits - bits2)); k++) {
+        HuffMultiSymbol& entry = multiTable_[prefix2 | k];
+        entry.ch[1] = j;
+        entry.count = 2;
+        entry.bits = bits2;
+      }
+    }
+  }
 }
 
+constexpr HuffTree kHuffTree{s_codesTable, s_bitsTable};
+
 }} // namespace proxygen::huffman
@@ -29,19 +29,24 @@ const uint32_t kEOSHpack = 0x3fffffff;
  * A leaf has no index table, or index == nullptr
  */
 struct HuffNode {
-  union {
-    uint8_t ch; // leafs hold characters
-    uint8_t superNodeIndex;
-  } data{0};
+  // the character of a leaf, or the super node index of a branch.  Not a
+  // union, whose active member cannot change in a constant expression
+  uint8_t value{0};
   struct {
     uint8_t bits : 4; // how many bits are used for representing ch, range is
                       // 0-8
     bool isSuperNode : 1;
   } metadata{0, false};
 
-  bool isLeaf() const {
+  constexpr bool isLeaf() const {
     return !metadata.isSuperNode;
   }
+  constexpr uint8_t ch() const {
+    return value;
+  }
+  constexpr uint8_t superNodeIndex() const {
+    return value;
+  }
 };
 
 /**
@@ -51,6 +56,25 @@ struct SuperHuffNode {
   HuffNode index[256];
 };
 
+// number of bits used to index the multi-symbol decode table
+const uint32_t kMultiSymbolBits = 12;
+const uint32_t kMultiSymbolTableSize = 1 << kMultiSymbolBits;
+
+/**
+ * entry of the multi-symbol decode table, indexed by the next
+ * kMultiSymbolBits of the bit stream
+ *
+ * The shortest HPACK code is 5 bits, so a 12-bit key holds at most 2 whole
+ * codes. Keys starting with a code longer than 12 bits have count == 0 and
+ * are decoded through the super node tree.
+ */
+struct HuffMultiSymbol {
+  uint8_t ch[2]{0, 0};
+  uint8_t count{0};     // number of characters emitted by this entry
+  uint8_t firstBits{0}; // bits consumed by ch[0]
+  uint8_t bits{0};      // bits consumed by all the characters
+};
+
 /**
  * Immutable Huffman tree used in the process of decoding. Traditionally the
  * huffman tree is binary, but using that approach leads to major inefficiencies
@@ -80,17 +104,25 @@ struct SuperHuffNode {
  * 3. we don't have enough bits, so we use paddding and we get a key of
  * 01011111, which points to '(' character, like any other node under the
  * subtree '010'.
+ *
+ * On top of the tree, decode() uses a flat table indexed by 12 bits that
+ * emits up to two characters per lookup, which covers the printable
+ * characters making up most header values. Keys that start with a longer
+ * code fall back to the tree.
+ *
+ * Both tables are built at compile time, huffTree() being a constexpr object
+ * in read-only data shared by HPACK and QPACK: no static initialization, and no
+ * guard on access.
  */
 class HuffTree {
  public:
   /**
    * the constructor assumes the codes and bits tables will not be freed,
-   * ideally they are static
+   * ideally they are static.  It is constexpr and defined in Huffman.cpp,
+   * only for huffTree()
    */
-  explicit HuffTree(const uint32_t* codes, const uint8_t* bits);
+  explicit constexpr HuffTree(const uint32_t* codes, const uint8_t* bits);
   explicit HuffTree(HuffTree&& tree) = default;
-  ~HuffTree() {
-  }
 
   /**
    * decode bitstream into a string literal
@@ -105,6 +137,14 @@ class HuffTree {
               uint32_t size,
               folly::fbstring& literal) const;
 
+  /**
+   * decode by walking the super node tree one byte at a time. Produces the
+   * same output as decode(), kept as a reference and for benchmarking.
+   */
+  bool decodeTree(const uint8_t* buf,
+                  uint32_t size,
+                  folly::fbstring& literal) const;
+
   /**
    * encode string literal into huffman encoded bit stream
    *
@@ -140,23 +180,30 @@ class HuffTree {
   const uint8_t* bitsTable() const;
 
  private:
-  void fillIndex(SuperHuffNode& snode,
-                 uint32_t code,
-                 uint8_t bits,
-                 uint8_t ch,
-                 uint8_t level);
-  void buildTree();
-  void insert(uint32_t code, uint8_t bits, uint8_t ch);
+  constexpr void fillIndex(SuperHuffNode& snode,
+                           uint32_t code,
+                           uint8_t bits,
+                           uint8_t ch);
+  constexpr void buildTree();
+  constexpr void buildMultiSymbolTable();
+  constexpr void insert(uint32_t code, uint8_t bits, uint8_t ch);
+  uint8_t decodeLongCode(uint64_t w, uint32_t wbits, char* out) const;
 
   uint32_t nodes_{0};
   const uint32_t* codes_;
   const uint8_t* bits_;
 
  protected:
-  explicit HuffTree(const HuffTree& tree);
-  SuperHuffNode table_[46];
+  // copies the tables
+  explicit HuffTree(const HuffTree& tree) = default;
+  SuperHuffNode table_[46]{};
+  HuffMultiSymbol multiTable_[kMultiSymbolTableSize]{};
 };
 
-const HuffTree& huffTree();
+extern const HuffTree kHuffTree;
+
+inline const HuffTree& huffTree() {
+  return kHuffTree;
+}
 
 }} // namespace proxygen::huffman
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/codec/compress/HuffmanLiteralCache.h>
+
+#include <atomic>
+#include <folly/container/F14Map.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBufQueue.h>
+#include <glog/logging.h>
+#include <proxygen/lib/http/codec/compress/Huffman.h>
+
+namespace {
+
+using LiteralMap = folly::F14FastMap<std::string, std::string>;
+
+LiteralMap* pendingLiterals() {
+  static auto literals = new LiteralMap();
+  return literals;
+}
+
+std::atomic<const LiteralMap*> frozenLiterals{nullptr};
+
+} // namespace
+
+namespace proxygen { namespace huffman {
+
+void HuffmanLiteralCache::add(folly::StringPiece literal) {
+  CHECK(frozenLiterals.load() == nullptr)
+      << "Literals must be added before freeze()";
+  auto literals = pendingLiterals();
+  if (literals->find(literal) != literals->end()) {
+    return;
+  }
+  folly::IOBufQueue queue;
+  folly::io::QueueAppender appender(&queue, literal.size());
+  uint32_t size = huffTree().encode(literal, appender);
+  std::string encoded;
+  encoded.resize(size);
+  if (size > 0) {
+    folly::io::Cursor(queue.front()).pull(&encoded[0], size);
+  }
+  literals->emplace(literal.str(), std::move(encoded));
+}
+
+void HuffmanLiteralCache::freeze() {
+  frozenLiterals.store(pendingLiterals(), std::memory_order_release);
+}
+
+const std::string* HuffmanLiteralCache::find(folly::StringPiece literal) {
+  auto literals = frozenLiterals.load(std::memory_order_acquire);
+  if (literals == nullptr) {
+    return nullptr;
+  }
+  auto it = literals->find(literal);
+  return (it == literals->end()) ? nullptr : &it->second;
+}
+
+}} // namespace proxygen::huffman
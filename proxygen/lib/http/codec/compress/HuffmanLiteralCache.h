@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <string>
+
+namespace proxygen { namespace huffman {
+
+/**
+ * Process-wide, read-only cache of Huffman encoded literals.
+ *
+ * Servers tend to send the same header names and values (server,
+ * content-type, cache-control...) on every connection. Literals registered
+ * here are Huffman encoded once, and HPACKEncodeBuffer copies the encoded
+ * bytes instead of sizing and encoding them again for every header block.
+ *
+ * Only the Huffman coded string is cached, without the length prefix, so the
+ * same entry serves any HPACK or QPACK instruction.
+ *
+ * add() must be called during startup, before freeze() publishes the cache.
+ * Lookups are lock-free and see nothing until the cache is frozen.
+ */
+class HuffmanLiteralCache {
+ public:
+  /**
+   * Register a literal to be pre-encoded. Must be called before freeze().
+   */
+  static void add(folly::StringPiece literal);
+
+  /**
+   * Publish the cache, no more literals can be added after this.
+   */
+  static void freeze();
+
+  /**
+   * @return the Huffman encoded bytes for the given literal, or nullptr if it
+   *         is not cached
+   */
+  static const std::string* find(folly::StringPiece literal);
+};
+
+}} // namespace proxygen::huffman
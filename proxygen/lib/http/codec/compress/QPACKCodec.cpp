@@ -37,11 +37,25 @@ void QPACKCodec::recordCompressedSize(const folly::IOBuf* stream,
     encodedSize_.compressedBlock = stream->computeChainDataLength();
     encodedSize_.compressed += encodedSize_.compressedBlock;
   }
+  totalEncodedSize_.uncompressed += encodedSize_.uncompressed;
+  totalEncodedSize_.compressed += encodedSize_.compressed;
+  totalEncodedSize_.compressedBlock += encodedSize_.compressedBlock;
   if (stats_) {
     stats_->recordEncode(Type::QPACK, encodedSize_);
   }
 }
 
+uint32_t QPACKCodec::warmTable(const vector<HPACKHeader>& headers,
+                               folly::IOBufQueue& controlQueue,
+                               uint32_t maxEncoderStreamBytes) {
+  auto prevSize = controlQueue.chainLength();
+  auto inserted =
+      encoder_.warmTable(headers, controlQueue, maxEncoderStreamBytes);
+  warmTableInserts_ += inserted;
+  totalEncodedSize_.compressed += controlQueue.chainLength() - prevSize;
+  return inserted;
+}
+
 QPACKEncoder::EncodeResult QPACKCodec::encode(
     vector<Header>& headers,
     uint64_t streamId,
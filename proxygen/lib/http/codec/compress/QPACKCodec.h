@@ -53,6 +53,14 @@ class QPACKCodec : public HeaderCodec {
       uint32_t maxEncoderStreamBytes = std::numeric_limits<uint32_t>::max(),
       const folly::Optional<HTTPHeaders>& extraHeaders = folly::none) noexcept;
 
+  // Insert a configured list of common entries into the encoder's dynamic
+  // table ahead of the first request, see QPACKEncoder::warmTable.  The
+  // inserts count as compressed bytes in getTotalEncodedSize().
+  uint32_t warmTable(
+      const std::vector<HPACKHeader>& headers,
+      folly::IOBufQueue& controlQueue,
+      uint32_t maxEncoderStreamBytes = std::numeric_limits<uint32_t>::max());
+
   HPACK::DecodeError decodeEncoderStream(std::unique_ptr<folly::IOBuf> buf) {
     // stats?
     return decoder_.decodeEncoderStream(std::move(buf));
@@ -83,6 +91,15 @@ class QPACKCodec : public HeaderCodec {
     decoder_.setHeaderTableMaxSize(size);
   }
 
+  /**
+   * Uses at most initialSize of the peer's QPACK_MAX_TABLE_CAPACITY, growing
+   * up to it on connections where it pays, see AdaptiveTableSize.  Call
+   * before the peer's SETTINGS.
+   */
+  void setEncoderAdaptiveTableSize(uint32_t initialSize) {
+    encoder_.setAdaptiveTableSize(initialSize);
+  }
+
   // Process bytes on the decoder stream
   HPACK::DecodeError decodeDecoderStream(std::unique_ptr<folly::IOBuf> buf) {
     return encoder_.decodeDecoderStream(std::move(buf));
@@ -157,10 +174,31 @@ class QPACKCodec : public HeaderCodec {
     decoder_.setMaxBlocking(maxBlocking);
   }
 
+  void setMaxQueuedBytes(uint64_t maxQueuedBytes) {
+    decoder_.setMaxQueuedBytes(maxQueuedBytes);
+  }
+
+  std::chrono::microseconds getBlockedTime() const {
+    return decoder_.getBlockedTime();
+  }
+
+  std::chrono::microseconds getMaxBlockedTime() const {
+    return decoder_.getMaxBlockedTime();
+  }
+
   void setMaxNumOutstandingBlocks(uint32_t value) {
     encoder_.setMaxNumOutstandingBlocks(value);
   }
 
+  // Sum of every encode on this codec, including table warming
+  const HTTPHeaderSize& getTotalEncodedSize() const {
+    return totalEncodedSize_;
+  }
+
+  uint32_t getWarmTableInserts() const {
+    return warmTableInserts_;
+  }
+
  protected:
   QPACKEncoder encoder_;
   QPACKDecoder decoder_;
@@ -169,6 +207,8 @@ class QPACKCodec : public HeaderCodec {
   void recordCompressedSize(const folly::IOBuf* stream, size_t controlSize);
 
   std::vector<HPACKHeader> decodedHeaders_;
+  HTTPHeaderSize totalEncodedSize_;
+  uint32_t warmTableInserts_{0};
 };
 
 std::ostream& operator<<(std::ostream& os, const QPACKCodec& codec);
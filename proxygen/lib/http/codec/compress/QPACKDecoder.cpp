@@ -8,13 +8,31 @@
 
 #include <proxygen/lib/http/codec/compress/QPACKDecoder.h>
 
+#include <algorithm>
+
 #include <proxygen/lib/http/codec/compress/HPACKEncodeBuffer.h>
 
 using folly::io::Cursor;
 
 namespace {
 const uint32_t kGrowth = 100;
+
+// In the order of decodeHeaderQ
+proxygen::HeaderCodec::Representation representation(uint8_t byte) {
+  using proxygen::HeaderCodec;
+  using namespace proxygen::HPACK;
+  if (byte & Q_INDEXED.code) {
+    return HeaderCodec::Representation::INDEXED;
+  } else if (byte & Q_LITERAL_NAME_REF.code) {
+    return HeaderCodec::Representation::NAME_INDEXED;
+  } else if (byte & Q_LITERAL.code) {
+    return HeaderCodec::Representation::LITERAL;
+  } else if (byte & Q_INDEXED_POST.code) {
+    return HeaderCodec::Representation::INDEXED;
+  }
+  return HeaderCodec::Representation::NAME_INDEXED;
 }
+} // namespace
 
 namespace proxygen {
 
@@ -30,9 +48,12 @@ void QPACKDecoder::decodeStreaming(uint64_t streamID,
   if (requiredInsertCount > table_.getInsertCount()) {
     VLOG(5) << "requiredInsertCount=" << requiredInsertCount
             << " > insertCount=" << table_.getInsertCount() << ", queuing";
-    if (queue_.size() >= maxBlocking_) {
+    uint32_t length = totalBytes - dbuf.consumedBytes();
+    if (queue_.size() >= maxBlocking_ ||
+        queuedBytes_ + length > maxQueuedBytes_) {
       VLOG(2) << "QPACK queue full size=" << queue_.size()
-              << " maxBlocking_=" << maxBlocking_;
+              << " maxBlocking_=" << maxBlocking_
+              << " queuedBytes_=" << queuedBytes_;
       err_ = HPACK::DecodeError::TOO_MANY_BLOCKING;
       completeDecode(HeaderCodec::Type::QPACK, streamingCb, 0, 0, 0, false);
     } else {
@@ -44,7 +65,7 @@ void QPACKDecoder::decodeStreaming(uint64_t streamID,
                          baseIndex_,
                          dbuf.consumedBytes(),
                          q.move(),
-                         totalBytes - dbuf.consumedBytes(),
+                         length,
                          streamingCb);
     }
   } else {
@@ -132,9 +153,22 @@ void QPACKDecoder::decodeStreamingImpl(uint32_t requiredInsertCount,
                                        HPACKDecodeBuffer& dbuf,
                                        HPACK::StreamingCallback* streamingCb) {
   uint32_t emittedSize = 0;
+  bool sampled = startSampling(HeaderCodec::Type::QPACK, streamingCb);
 
   while (!hasError() && !dbuf.empty()) {
-    emittedSize += decodeHeaderQ(dbuf, streamingCb);
+    if (sampled) {
+      auto first = dbuf.peek();
+      auto before = dbuf.consumedBytes();
+      auto headerSize = decodeHeaderQ(dbuf, streamingCb);
+      recordSampledHeader(HeaderCodec::Type::QPACK,
+                          streamingCb,
+                          representation(first),
+                          headerSize,
+                          dbuf.consumedBytes() - before);
+      emittedSize += headerSize;
+    } else {
+      emittedSize += decodeHeaderQ(dbuf, streamingCb);
+    }
     if (emittedSize > maxUncompressed_) {
       LOG(ERROR) << "Exceeded uncompressed size limit of " << maxUncompressed_
                  << " bytes";
@@ -283,6 +317,8 @@ uint32_t QPACKDecoder::decodeLiteralHeaderQ(
   bool allowPartial = (streamingCb == nullptr);
   Partial localPartial;
   Partial* partial = (allowPartial) ? &partial_ : &localPartial;
+  // Points into the table for an indexed name in a header block
+  const HPACKHeaderName* name = &partial->header.name;
   if (partial->state == Partial::NAME) {
     if (nameIndexed) {
       uint64_t nameIndex = 0;
@@ -302,8 +338,13 @@ uint32_t QPACKDecoder::decodeLiteralHeaderQ(
         err_ = HPACK::DecodeError::INVALID_INDEX;
         return 0;
       }
-      partial->header.name =
+      auto& indexedName =
           getHeader(isStaticName, nameIndex, baseIndex_, aboveBase).name;
+      if (allowPartial || indexing) {
+        partial->header.name = indexedName;
+      } else {
+        name = &indexedName;
+      }
     } else {
       folly::fbstring headerName;
       err_ = dbuf.decodeLiteral(prefixLength, headerName);
@@ -325,13 +366,14 @@ uint32_t QPACKDecoder::decodeLiteralHeaderQ(
     return 0;
   }
   if (err_ != HPACK::DecodeError::NONE) {
-    LOG(ERROR) << "Error decoding header value name=" << partial->header.name
+    LOG(ERROR) << "Error decoding header value name=" << *name
                << " err_=" << err_;
     return 0;
   }
   partial->state = Partial::NAME;
 
-  uint32_t emittedSize = emit(partial->header, streamingCb, nullptr);
+  uint32_t emittedSize =
+      emit(*name, partial->header.value, streamingCb, nullptr);
 
   if (indexing) {
     if (!table_.add(std::move(partial->header))) {
@@ -369,7 +411,7 @@ uint32_t QPACKDecoder::decodeIndexedHeaderQ(
   }
 
   auto& header = getHeader(isStatic, index, baseIndex_, aboveBase);
-  return emit(header, streamingCb, emitted);
+  return emit(header, streamingCb, emitted, isStatic);
 }
 
 bool QPACKDecoder::isValid(bool isStatic, uint64_t index, bool aboveBase) {
@@ -416,13 +458,16 @@ std::unique_ptr<folly::IOBuf> QPACKDecoder::encodeCancelStream(
     uint64_t streamId) {
   // Remove this stream from the queue
   VLOG(6) << "encodeCancelStream id=" << streamId;
-  auto it = queue_.begin();
-  while (it != queue_.end()) {
-    if (it->second.streamID == streamId) {
-      it = queue_.erase(it);
-    } else {
-      it++;
+  auto it = std::remove_if(
+      queue_.begin(), queue_.end(), [&](const PendingBlock& pending) {
+        return pending.streamID == streamId;
+      });
+  if (it != queue_.end()) {
+    for (auto cancelled = it; cancelled != queue_.end(); ++cancelled) {
+      queuedBytes_ -= cancelled->length;
     }
+    queue_.erase(it, queue_.end());
+    std::make_heap(queue_.begin(), queue_.end(), Later());
   }
   HPACKEncodeBuffer ackEncoder(kGrowth, false);
   ackEncoder.encodeInteger(streamId, HPACK::Q_CANCEL_STREAM);
@@ -436,23 +481,40 @@ void QPACKDecoder::enqueueHeaderBlock(uint64_t streamID,
                                       std::unique_ptr<folly::IOBuf> block,
                                       size_t length,
                                       HPACK::StreamingCallback* streamingCb) {
-  // TDOO: this queue is currently unbounded and has no timeouts
   CHECK_GT(requiredInsertCount, table_.getInsertCount());
-  queue_.emplace(std::piecewise_construct,
-                 std::forward_as_tuple(requiredInsertCount),
-                 std::forward_as_tuple(streamID,
-                                       baseIndex,
-                                       length,
-                                       consumed,
-                                       std::move(block),
-                                       streamingCb));
+  // Not to pin a whole read buffer until the inserts arrive
+  if (block && length > 0 && block->computeChainCapacity() > 2 * length) {
+    auto compact = folly::IOBuf::create(length);
+    folly::io::Cursor(block.get()).pull(compact->writableData(), length);
+    compact->append(length);
+    block = std::move(compact);
+  }
+  queue_.emplace_back(streamID,
+                      requiredInsertCount,
+                      nextSeq_++,
+                      baseIndex,
+                      length,
+                      consumed,
+                      std::move(block),
+                      streamingCb);
+  std::push_heap(queue_.begin(), queue_.end(), Later());
   holBlockCount_++;
   VLOG(5) << "queued block=" << requiredInsertCount << " len=" << length;
   queuedBytes_ += length;
 }
 
-bool QPACKDecoder::decodeBlock(uint32_t requiredInsertCount,
-                               const PendingBlock& pending) {
+QPACKDecoder::PendingBlock QPACKDecoder::popBlock() {
+  std::pop_heap(queue_.begin(), queue_.end(), Later());
+  PendingBlock block = std::move(queue_.back());
+  queue_.pop_back();
+  return block;
+}
+
+bool QPACKDecoder::decodeBlock(const PendingBlock& pending) {
+  auto blocked = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - pending.queuedAt);
+  blockedTime_ += blocked;
+  maxBlockedTime_ = std::max(maxBlockedTime_, blocked);
   if (pending.length > 0) {
     VLOG(5) << "decodeBlock len=" << pending.length;
     folly::io::Cursor cursor(pending.block.get());
@@ -462,7 +524,7 @@ bool QPACKDecoder::decodeBlock(uint32_t requiredInsertCount,
     baseIndex_ = pending.baseIndex;
     folly::DestructorCheck::Safety safety(*this);
     decodeStreamingImpl(
-        requiredInsertCount, pending.consumed, dbuf, pending.cb);
+        pending.requiredInsertCount, pending.consumed, dbuf, pending.cb);
     // The callback may destroy this, if so stop queue processing
     if (safety.destroyed()) {
       return true;
@@ -472,16 +534,13 @@ bool QPACKDecoder::decodeBlock(uint32_t requiredInsertCount,
 }
 
 void QPACKDecoder::drainQueue() {
-  auto it = queue_.begin();
-  while (!queue_.empty() && it->first <= table_.getInsertCount() &&
+  // Every block the inserts so far unblocked, fewest inserts first
+  while (!queue_.empty() &&
+         queue_.front().requiredInsertCount <= table_.getInsertCount() &&
          !hasError()) {
-    auto id = it->first;
-    PendingBlock block = std::move(it->second);
-    queue_.erase(it);
-    if (decodeBlock(id, block)) {
+    if (decodeBlock(popBlock())) {
       return;
     }
-    it = queue_.begin();
   }
 }
 
@@ -489,9 +548,7 @@ void QPACKDecoder::errorQueue() {
   // The callback may destroy this, if so stop queue processing
   folly::DestructorCheck::Safety safety(*this);
   while (!safety.destroyed() && !queue_.empty()) {
-    auto it = queue_.begin();
-    PendingBlock block = std::move(it->second);
-    queue_.erase(it);
+    auto block = popBlock();
     block.cb->onDecodeError(HPACK::DecodeError::ENCODER_STREAM_CLOSED);
   }
 }
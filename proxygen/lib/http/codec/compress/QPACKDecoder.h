@@ -8,14 +8,16 @@
 
 #pragma once
 
+#include <chrono>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/async/DestructorCheck.h>
-#include <map>
+#include <limits>
 #include <proxygen/lib/http/codec/compress/HPACKDecodeBuffer.h>
 #include <proxygen/lib/http/codec/compress/HPACKDecoderBase.h>
 #include <proxygen/lib/http/codec/compress/HeaderCodec.h>
 #include <proxygen/lib/http/codec/compress/QPACKContext.h>
+#include <vector>
 
 namespace proxygen {
 
@@ -58,6 +60,25 @@ class QPACKDecoder
     maxBlocking_ = maxBlocking;
   }
 
+  /**
+   * The header block bytes queued for blocked streams at most.  A block
+   * past it fails with TOO_MANY_BLOCKING, as past the number of blocked
+   * streams.  Queued blocks hold copies when smaller than half of the
+   * buffers they arrived in, so that they don't pin the reads.
+   */
+  void setMaxQueuedBytes(uint64_t maxQueuedBytes) {
+    maxQueuedBytes_ = maxQueuedBytes;
+  }
+
+  // How long the blocks decoded after waiting for inserts waited, in all
+  std::chrono::microseconds getBlockedTime() const {
+    return blockedTime_;
+  }
+
+  std::chrono::microseconds getMaxBlockedTime() const {
+    return maxBlockedTime_;
+  }
+
   void setHeaderTableMaxSize(uint32_t maxSize) {
     CHECK(maxTableSize_ == 0 || maxTableSize_ == maxSize)
         << "Cannot change non-zero max header table size, "
@@ -104,29 +125,50 @@ class QPACKDecoder
 
   struct PendingBlock {
     PendingBlock(uint64_t sid,
+                 uint32_t ric,
+                 uint64_t s,
                  uint32_t bi,
                  uint32_t l,
                  uint32_t cons,
                  std::unique_ptr<folly::IOBuf> b,
                  HPACK::StreamingCallback* c)
         : streamID(sid),
+          requiredInsertCount(ric),
+          seq(s),
           baseIndex(bi),
           length(l),
           consumed(cons),
           block(std::move(b)),
-          cb(c) {
+          cb(c),
+          queuedAt(std::chrono::steady_clock::now()) {
     }
     uint64_t streamID;
+    uint32_t requiredInsertCount;
+    // Orders the blocks of the same insert count as they arrived
+    uint64_t seq;
     uint32_t baseIndex;
     uint32_t length;
     uint32_t consumed;
     std::unique_ptr<folly::IOBuf> block;
     HPACK::StreamingCallback* cb;
+    std::chrono::steady_clock::time_point queuedAt;
   };
 
+  // For a min-heap of the blocks by required insert count
+  struct Later {
+    bool operator()(const PendingBlock& a, const PendingBlock& b) const {
+      return a.requiredInsertCount != b.requiredInsertCount
+                 ? a.requiredInsertCount > b.requiredInsertCount
+                 : a.seq > b.seq;
+    }
+  };
+
+  // Removes the block that needs the fewest inserts
+  PendingBlock popBlock();
+
   // Returns true if this object was destroyed by its callback.  Callers
   // should check the result and immediately return.
-  bool decodeBlock(uint32_t requiredInsertCount, const PendingBlock& pending);
+  bool decodeBlock(const PendingBlock& pending);
 
   void drainQueue();
   void errorQueue();
@@ -137,7 +179,12 @@ class QPACKDecoder
   uint32_t holBlockCount_{0};
   uint32_t pendingEncoderBytes_{0};
   uint64_t queuedBytes_{0};
-  std::multimap<uint32_t, PendingBlock> queue_;
+  uint64_t maxQueuedBytes_{std::numeric_limits<uint64_t>::max()};
+  uint64_t nextSeq_{0};
+  std::chrono::microseconds blockedTime_{0};
+  std::chrono::microseconds maxBlockedTime_{0};
+  // A min-heap ordered by Later
+  std::vector<PendingBlock> queue_;
 
   // This holds the state of a partially decoded literal insert on the control
   // stream
@@ -57,6 +57,37 @@ uint32_t QPACKEncoder::startEncode(folly::IOBufQueue& controlQueue,
   return table_.getInsertCount();
 }
 
+uint32_t QPACKEncoder::warmTable(const vector<HPACKHeader>& headers,
+                                 folly::IOBufQueue& controlQueue,
+                                 uint32_t maxEncoderStreamBytes) {
+  startEncode(controlQueue, 0, maxEncoderStreamBytes);
+  uint32_t inserted = 0;
+  for (const auto& header : headers) {
+    if (maxEncoderStreamBytes_ <= 0) {
+      break;
+    }
+    if (getStaticTable().getIndex(header.name, header.value).first > 0 ||
+        table_.getIndex(header.name, header.value) != 0) {
+      continue;
+    }
+    // Stop short of draining, a warm entry that displaces another one is
+    // wasted encoder stream bytes
+    if (!table_.fitsWithoutDraining(header.name, header.value) ||
+        !table_.canIndex(header.name, header.value)) {
+      break;
+    }
+    bool isStaticName = false;
+    uint32_t nameIndex = 0;
+    std::tie(isStaticName, nameIndex, std::ignore) = getNameIndexQ(header.name);
+    encodeInsertQ(header.name, header.value, isStaticName, nameIndex);
+    onTableInsert(header.name, header.value);
+    CHECK(table_.add(HPACKHeader(header.name, header.value)));
+    inserted++;
+  }
+  controlBuffer_.setWriteBuf(nullptr);
+  return inserted;
+}
+
 std::unique_ptr<folly::IOBuf> QPACKEncoder::completeEncode(
     uint64_t streamId, uint32_t baseIndex, uint32_t requiredInsertCount) {
   auto streamBlock = streamBuffer_.release();
@@ -97,6 +128,7 @@ std::unique_ptr<folly::IOBuf> QPACKEncoder::completeEncode(
   }
 
   controlBuffer_.setWriteBuf(nullptr);
+  maybeGrowTable(table_, std::min(maxTableSize_, kMaxHeaderTableSize));
   return streamBuffer;
 }
 
@@ -105,6 +137,7 @@ size_t QPACKEncoder::encodeHeaderQ(HPACKHeaderName name,
                                    uint32_t baseIndex,
                                    uint32_t& requiredInsertCount) {
   size_t uncompressed = HPACKHeader::realBytes(name.size(), value.size()) + 2;
+  lookups_++;
   uint32_t index = getStaticTable().getIndex(name, value).first;
   if (index > 0) {
     // static reference
@@ -125,6 +158,7 @@ size_t QPACKEncoder::encodeHeaderQ(HPACKHeaderName name,
   }
   if (index != 0) {
     // dynamic reference
+    dynamicRefs_++;
     bool duplicated = false;
     std::tie(duplicated, index) = maybeDuplicate(index);
     // index is now 0 or absolute
@@ -143,6 +177,7 @@ size_t QPACKEncoder::encodeHeaderQ(HPACKHeaderName name,
     if (indexable) {
       if (table_.canIndex(name, value)) {
         encodeInsertQ(name, value, isStaticName, nameIndex);
+        onTableInsert(name, value);
         CHECK(table_.add(HPACKHeader(std::move(name), value)));
         if (allowVulnerable() && lastEntryAvailable()) {
           index = table_.getInsertCount();
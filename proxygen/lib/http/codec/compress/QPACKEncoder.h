@@ -76,10 +76,24 @@ class QPACKEncoder
               << kMaxHeaderTableSize;
       tableSize = kMaxHeaderTableSize;
     }
+    if (adaptiveTableSize_) {
+      tableSize = getAdaptiveCapacity(table_, tableSize);
+    }
     HPACKEncoderBase::setHeaderTableSize(table_, tableSize);
     return true;
   }
 
+  /**
+   * Uses at most initialSize of the capacity the peer allows, growing up to
+   * it as AdaptiveTableSize decides.  Call before the peer's SETTINGS.
+   */
+  void setAdaptiveTableSize(uint32_t initialSize) {
+    adaptiveTableSize_.emplace(initialSize);
+    if (table_.capacity() > initialSize) {
+      HPACKEncoderBase::setHeaderTableSize(table_, initialSize);
+    }
+  }
+
   uint32_t getMaxHeaderTableSize() const {
     return maxTableSize_;
   }
@@ -96,6 +110,17 @@ class QPACKEncoder
 
   void setMaxNumOutstandingBlocks(uint32_t value);
 
+  /**
+   * Pre-populate the dynamic table with the given entries by writing inserts
+   * to controlQueue, so that the first header blocks on a connection can
+   * reference them.  Entries already in the static or dynamic table are
+   * skipped.  Stops when the table would have to evict, or when the encoder
+   * stream bytes are exhausted.  Returns the number of entries inserted.
+   */
+  uint32_t warmTable(const std::vector<HPACKHeader>& headers,
+                     folly::IOBufQueue& controlQueue,
+                     uint32_t maxEncoderStreamBytes);
+
   uint32_t startEncode(folly::IOBufQueue& controlQueue,
                        uint32_t headroom,
                        uint32_t maxEncoderStreamBytes);
@@ -94,30 +94,27 @@ uint32_t QPACKHeaderTable::getIndexImpl(const HPACKHeaderName& headerName,
                                         folly::StringPiece value,
                                         bool nameOnly,
                                         bool allowVulnerable) const {
-  auto it = names_.find(headerName);
-  if (it == names_.end()) {
-    return 0;
-  }
+  uint32_t index = 0;
   bool encoderHasUnackedEntry = false;
   // Searching backwards gives smallest index, but more likely vulnerable
   // Searching forwards least likely vulnerable but could prevent eviction
-  for (auto indexIt = it->second.rbegin(); indexIt != it->second.rend();
-       ++indexIt) {
-    auto i = *indexIt;
+  forEachNameIndex(headerName, [&](uint32_t i) {
     if (nameOnly || table_[i].value == value) {
       // allow vulnerable or not vulnerable
       if (allowVulnerable || internalToAbsolute(i) <= ackedInsertCount_) {
         // index *may* be draining, caller has to check
-        return toExternal(i);
+        index = toExternal(i);
+        return true;
       } else {
         encoderHasUnackedEntry = true;
       }
     }
-  }
-  if (encoderHasUnackedEntry) {
+    return false;
+  });
+  if (index == 0 && encoderHasUnackedEntry) {
     return UNACKED;
   }
-  return 0;
+  return index;
 }
 
 uint32_t QPACKHeaderTable::nameIndex(const HPACKHeaderName& headerName,
@@ -50,6 +50,17 @@ class QPACKHeaderTable : public HeaderTable {
             (totalBytes <= capacity_ || canEvict(totalBytes - capacity_)));
   }
 
+  /**
+   * Returns true if the header fits in the table without evicting or
+   * draining any existing entry
+   */
+  bool fitsWithoutDraining(const HPACKHeaderName& name,
+                           folly::StringPiece value) const {
+    uint64_t headerBytes = HPACKHeader::bytes(name.size(), value.size());
+    return uint64_t(bytes_) + headerBytes + minFree_ <=
+           uint64_t(capacity_) + drainedBytes_;
+  }
+
   /**
    * Returns true if the index should not be used so table space can be freed
    */
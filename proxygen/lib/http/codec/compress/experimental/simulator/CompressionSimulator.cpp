@@ -12,6 +12,7 @@
 #include <proxygen/lib/http/codec/compress/experimental/simulator/QMINScheme.h>
 #include <proxygen/lib/http/codec/compress/experimental/simulator/QPACKScheme.h>
 
+#include <map>
 #include <proxygen/lib/http/codec/compress/test/HTTPArchive.h>
 #include <proxygen/lib/utils/TestUtils.h>
 #include <proxygen/lib/utils/Time.h>
@@ -31,22 +32,33 @@ const std::string kTestDir = getContainingDirectory(__FILE__).str();
 namespace proxygen { namespace compress {
 
 bool CompressionSimulator::readInputFromFileAndSchedule(
-    const string& filename) {
+    const string& filename, InputFormat format) {
+  // Relative paths are relative to the simulator's source directory
+  auto path = (!filename.empty() && filename[0] == '/') ? filename
+                                                        : kTestDir + filename;
   unique_ptr<HTTPArchive> har;
   try {
-    har = HTTPArchive::fromFile(kTestDir + filename);
+    if (format == InputFormat::HPACK_TEST_CASE) {
+      har = HTTPArchive::fromPublicFile(path);
+    } else {
+      har = HTTPArchive::fromFile(path);
+    }
   } catch (const std::exception& ex) {
     LOG(ERROR) << folly::exceptionStr(ex);
   }
   if (!har || har->requests.size() == 0) {
     return false;
   }
-  // Sort by start time (har ordered by finish time?)
-  std::sort(har->requests.begin(),
+  // Sort by start time (har ordered by finish time?).  Stable, so that
+  // requests without timings keep their order and runs are reproducible.
+  std::stable_sort(har->requests.begin(),
             har->requests.end(),
             [](const HTTPMessage& a, const HTTPMessage& b) {
               return a.getStartTime() < b.getStartTime();
             });
+  if (params_.type == SchemeType::QPACK && params_.warmTableEntries > 0) {
+    buildWarmTable(har->requests);
+  }
   TimePoint last = har->requests[0].getStartTime();
   std::chrono::milliseconds cumulativeDelay(0);
   uint16_t index = 0;
@@ -81,6 +93,9 @@ void CompressionSimulator::run() {
   for (auto& scheme : domains_) {
     holBlockCount += scheme.second->getHolBlockCount();
   }
+  auto perHeader = [this](std::chrono::nanoseconds ns) {
+    return stats_.headers ? ns.count() / stats_.headers : 0;
+  };
   LOG(INFO) << "Complete"
             << "\nStats:"
                "\nSeed: "
@@ -94,7 +109,10 @@ void CompressionSimulator::run() {
             << "\nUncompressed Bytes: " << stats_.uncompressed
             << "\nCompressed Bytes: " << stats_.compressed
             << "\nCompression Ratio: "
-            << int(100 - double(100 * stats_.compressed) / stats_.uncompressed);
+            << int(100 - double(100 * stats_.compressed) / stats_.uncompressed)
+            << "\nHeaders: " << stats_.headers
+            << "\nEncode ns/header: " << perHeader(stats_.encodeTime)
+            << "\nDecode ns/header: " << perHeader(stats_.decodeTime);
 }
 
 void CompressionSimulator::flushRequests(CompressionScheme* scheme) {
@@ -246,6 +264,39 @@ void CompressionSimulator::flushSchemePackets(CompressionScheme* scheme) {
   CHECK(scheme->encodedBlocks.empty());
 }
 
+void CompressionSimulator::buildWarmTable(
+    const vector<HTTPMessage>& requests) {
+  // Stand-in for a server's configured list: the most frequent entries of the
+  // trace itself.  Paths and cookies are per-request, skip them.
+  std::map<std::pair<string, string>, uint32_t> counts;
+  for (const auto& msg : requests) {
+    vector<string> cookies;
+    for (const auto& header : prepareMessageForCompression(msg, cookies)) {
+      if (header.code != HTTP_HEADER_COOKIE &&
+          header.code != HTTP_HEADER_COLON_PATH) {
+        counts[{*header.name, *header.value}]++;
+      }
+    }
+  }
+  vector<std::pair<uint32_t, const std::pair<string, string>*>> sorted;
+  sorted.reserve(counts.size());
+  for (const auto& kv : counts) {
+    sorted.emplace_back(kv.second, &kv.first);
+  }
+  std::stable_sort(
+      sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.first > b.first;
+      });
+  warmTable_.clear();
+  for (const auto& entry : sorted) {
+    if (warmTable_.size() >= params_.warmTableEntries) {
+      break;
+    }
+    warmTable_.emplace_back(entry.second->first, entry.second->second);
+  }
+  LOG(INFO) << "Warm table has " << warmTable_.size() << " entries";
+}
+
 CompressionScheme* CompressionSimulator::getScheme(StringPiece domain) {
   static string blended("\"Facebook\"");
   if (params_.blend &&
@@ -269,12 +320,16 @@ CompressionScheme* CompressionSimulator::getScheme(StringPiece domain) {
 unique_ptr<CompressionScheme> CompressionSimulator::makeScheme() {
   switch (params_.type) {
     case SchemeType::QPACK:
-      return make_unique<QPACKScheme>(
-          this, params_.tableSize, params_.maxBlocking);
+      return make_unique<QPACKScheme>(this,
+                                      params_.tableSize,
+                                      params_.maxBlocking,
+                                      warmTable_,
+                                      indexingStrategy());
     case SchemeType::QMIN:
       return make_unique<QMINScheme>(this, params_.tableSize);
     case SchemeType::HPACK:
-      return make_unique<HPACKScheme>(this, params_.tableSize);
+      return make_unique<HPACKScheme>(
+          this, params_.tableSize, indexingStrategy());
   }
   LOG(FATAL) << "Bad scheme";
   return nullptr;
@@ -289,7 +344,10 @@ std::pair<FrameFlags, unique_ptr<IOBuf>> CompressionSimulator::encode(
       prepareMessageForCompression(requests_[index], cookies);
 
   auto before = stats_.uncompressed;
+  stats_.headers += allHeaders.size();
+  auto start = std::chrono::steady_clock::now();
   auto res = scheme->encode(newPacket, std::move(allHeaders), stats_);
+  stats_.encodeTime += std::chrono::steady_clock::now() - start;
   VLOG(1) << "Encoded request=" << index << " for host="
           << requests_[index].getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST)
           << " orig size=" << (stats_.uncompressed - before)
@@ -304,7 +362,9 @@ void CompressionSimulator::decode(CompressionScheme* scheme,
                                   FrameFlags flags,
                                   unique_ptr<IOBuf> encodedReq,
                                   SimStreamingCallback& cb) {
+  auto start = std::chrono::steady_clock::now();
   scheme->decode(flags, std::move(encodedReq), stats_, cb);
+  stats_.decodeTime += std::chrono::steady_clock::now() - start;
 }
 
 void CompressionSimulator::decodePacket(
@@ -398,4 +458,9 @@ std::chrono::milliseconds CompressionSimulator::extraDelay() {
 uint32_t CompressionSimulator::minOOOThresh() {
   return params_.minOOOThresh;
 }
+
+const HeaderIndexingStrategy* CompressionSimulator::indexingStrategy() {
+  return params_.indexingStrategy ? params_.indexingStrategy
+                                  : NoPathIndexingStrategy::getInstance();
+}
 }} // namespace proxygen::compress
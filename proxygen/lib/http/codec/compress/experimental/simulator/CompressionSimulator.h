@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <proxygen/lib/http/codec/compress/HPACKHeader.h>
 #include <proxygen/lib/http/codec/compress/experimental/simulator/CompressionScheme.h>
 #include <proxygen/lib/http/codec/compress/experimental/simulator/CompressionTypes.h>
 
@@ -24,9 +25,14 @@ class CompressionSimulator {
   explicit CompressionSimulator(SimParams p) : params_(p) {
   }
 
-  bool readInputFromFileAndSchedule(const std::string& filename);
+  bool readInputFromFileAndSchedule(const std::string& filename,
+                                    InputFormat format = InputFormat::HAR);
   void run();
 
+  const SimStats& getStats() const {
+    return stats_;
+  }
+
   // Called from CompressionScheme::runLoopCallback
   void flushSchemePackets(CompressionScheme* scheme);
   void flushPacket(CompressionScheme* scheme);
@@ -36,6 +42,7 @@ class CompressionSimulator {
   void setupRequest(uint16_t seqn,
                     HTTPMessage&& msg,
                     std::chrono::milliseconds encodeDelay);
+  void buildWarmTable(const std::vector<HTTPMessage>& requests);
   CompressionScheme* getScheme(folly::StringPiece host);
   std::unique_ptr<CompressionScheme> makeScheme();
   std::pair<FrameFlags, std::unique_ptr<folly::IOBuf>> encode(
@@ -60,6 +67,7 @@ class CompressionSimulator {
   bool delayed();
   std::chrono::milliseconds extraDelay();
   uint32_t minOOOThresh();
+  const HeaderIndexingStrategy* indexingStrategy();
 
   SimParams params_;
   std::vector<proxygen::HTTPMessage> requests_;
@@ -67,6 +75,7 @@ class CompressionSimulator {
   // Map of domain-name to compression scheme
   std::unordered_map<std::string, std::unique_ptr<CompressionScheme>> domains_;
   std::vector<SimStreamingCallback> callbacks_;
+  std::vector<HPACKHeader> warmTable_;
   folly::Random::DefaultGenerator rng_{
       static_cast<folly::Random::DefaultGenerator::result_type>(params_.seed)};
   SimStats stats_;
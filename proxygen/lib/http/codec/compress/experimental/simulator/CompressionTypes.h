@@ -10,9 +10,18 @@
 
 #include <chrono>
 
+namespace proxygen {
+class HeaderIndexingStrategy;
+}
+
 namespace proxygen { namespace compress {
 enum class SchemeType { QPACK, QMIN, HPACK };
 
+// HAR: HTTP Archive with request timings.  HPACK_TEST_CASE: the JSON story
+// format of the hpack-test-case corpus (headers captured off the wire, no
+// timings, so requests are sent back to back).
+enum class InputFormat { HAR, HPACK_TEST_CASE };
+
 // Metadata about encoded blocks.  In a real stack, these might be
 // conveyed via HTTP frame (HEADERS or PUSH_PROMISE) flags.
 struct FrameFlags {
@@ -36,6 +45,10 @@ struct SimParams {
   bool samePacketCompression;
   uint32_t tableSize;
   uint32_t maxBlocking;
+  // QPACK only: pre-insert the most frequent entries of the input
+  uint32_t warmTableEntries{0};
+  // HPACK and QPACK encoders, nullptr selects NoPathIndexingStrategy
+  const HeaderIndexingStrategy* indexingStrategy{nullptr};
 };
 
 struct SimStats {
@@ -46,5 +59,9 @@ struct SimStats {
   uint64_t uncompressed{0};
   uint64_t compressed{0};
   uint64_t packets{0};
+  // CPU time spent in the scheme's encode and decode calls
+  uint64_t headers{0};
+  std::chrono::nanoseconds encodeTime{0};
+  std::chrono::nanoseconds decodeTime{0};
 };
 }} // namespace proxygen::compress
@@ -20,11 +20,15 @@ namespace proxygen { namespace compress {
  */
 class HPACKScheme : public CompressionScheme {
  public:
-  explicit HPACKScheme(CompressionSimulator* sim, uint32_t tableSize)
+  explicit HPACKScheme(
+      CompressionSimulator* sim,
+      uint32_t tableSize,
+      const HeaderIndexingStrategy* indexingStrategy =
+          NoPathIndexingStrategy::getInstance())
       : CompressionScheme(sim) {
     client_.setEncodeHeadroom(2);
-    client_.setHeaderIndexingStrategy(NoPathIndexingStrategy::getInstance());
-    server_.setHeaderIndexingStrategy(NoPathIndexingStrategy::getInstance());
+    client_.setHeaderIndexingStrategy(indexingStrategy);
+    server_.setHeaderIndexingStrategy(indexingStrategy);
     client_.setEncoderHeaderTableSize(tableSize);
     server_.setDecoderHeaderTableMaxSize(tableSize);
     allowOOO_ = (tableSize == 0);
@@ -9,12 +9,28 @@
 #include <folly/init/Init.h>
 #include <folly/portability/GFlags.h>
 
+#include <proxygen/lib/http/codec/compress/AdaptiveIndexingStrategy.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncoder.h>
 #include <proxygen/lib/http/codec/compress/HPACKHeader.h>
+#include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
+#include <proxygen/lib/http/codec/compress/NoPathIndexingStrategy.h>
 #include <proxygen/lib/http/codec/compress/experimental/simulator/CompressionSimulator.h>
 
 DEFINE_string(input, "", "File containing requests");
+DEFINE_string(format,
+              "har",
+              "Input format: <har|hpack_test_case>, the latter is the JSON "
+              "story format of captured header sets");
 DEFINE_string(scheme, "qpack", "Scheme: <qpack|qmin|hpack>");
+DEFINE_string(indexing_strategy,
+              "nopath",
+              "HeaderIndexingStrategy for HPACK/QPACK: "
+              "<nopath|default|adaptive>");
+DEFINE_bool(csv,
+            false,
+            "Also print one line of results: scheme,strategy,uncompressed,"
+            "compressed,hol_delay_ms,encode_ns_per_header,"
+            "decode_ns_per_header");
 
 DEFINE_int32(rtt, 100, "Simulated RTT");
 DEFINE_double(lossp, 0.0, "Loss Probability");
@@ -27,6 +43,10 @@ DEFINE_bool(blend, true, "Blend all facebook.com and fbcdn.net domains");
 DEFINE_int32(max_blocking,
              100,
              "Maximum number of vulnerable/blocking header blocks");
+DEFINE_int32(warm_table_entries,
+             0,
+             "QPACK: pre-insert this many of the input's most frequent "
+             "header entries into each dynamic table");
 DEFINE_bool(same_packet_compression,
             true,
             "Allow QPACK to compress across "
@@ -60,6 +80,29 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  InputFormat format = InputFormat::HAR;
+  if (FLAGS_format == "hpack_test_case") {
+    format = InputFormat::HPACK_TEST_CASE;
+  } else if (FLAGS_format != "har") {
+    LOG(ERROR) << "Unsupported format";
+    return 1;
+  }
+
+  const proxygen::HeaderIndexingStrategy* strategy = nullptr;
+  if (FLAGS_indexing_strategy == "nopath") {
+    strategy = proxygen::NoPathIndexingStrategy::getInstance();
+  } else if (FLAGS_indexing_strategy == "default") {
+    strategy = proxygen::HeaderIndexingStrategy::getDefaultInstance();
+  } else if (FLAGS_indexing_strategy == "adaptive") {
+    // Learns on top of the simulator's usual no-path rules
+    static const proxygen::AdaptiveIndexingStrategy adaptive(
+        proxygen::NoPathIndexingStrategy::getInstance());
+    strategy = &adaptive;
+  } else {
+    LOG(ERROR) << "Unsupported indexing strategy";
+    return 1;
+  }
+
   if (FLAGS_seed == 0) {
     FLAGS_seed = folly::Random::rand64();
     std::cout << "Seed: " << FLAGS_seed << std::endl;
@@ -74,10 +117,23 @@ int main(int argc, char* argv[]) {
               FLAGS_blend,
               FLAGS_same_packet_compression,
               uint32_t(FLAGS_table_size),
-              uint32_t(FLAGS_max_blocking)};
+              uint32_t(FLAGS_max_blocking),
+              uint32_t(FLAGS_warm_table_entries),
+              strategy};
   CompressionSimulator sim(p);
-  if (sim.readInputFromFileAndSchedule(FLAGS_input)) {
-    sim.run();
+  if (!sim.readInputFromFileAndSchedule(FLAGS_input, format)) {
+    return 1;
+  }
+  sim.run();
+  if (FLAGS_csv) {
+    const auto& stats = sim.getStats();
+    auto perHeader = [&stats](std::chrono::nanoseconds ns) {
+      return stats.headers ? ns.count() / stats.headers : 0;
+    };
+    std::cout << FLAGS_scheme << "," << FLAGS_indexing_strategy << ","
+              << stats.uncompressed << "," << stats.compressed << ","
+              << stats.holDelay.count() << "," << perHeader(stats.encodeTime)
+              << "," << perHeader(stats.decodeTime) << std::endl;
   }
 
   return 0;
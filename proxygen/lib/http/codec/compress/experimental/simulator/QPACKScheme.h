@@ -18,14 +18,31 @@ class QPACKScheme : public CompressionScheme {
  public:
   explicit QPACKScheme(CompressionSimulator* sim,
                        uint32_t tableSize,
-                       uint32_t maxBlocking)
+                       uint32_t maxBlocking,
+                       const std::vector<HPACKHeader>& warmTable = {},
+                       const HeaderIndexingStrategy* indexingStrategy =
+                           NoPathIndexingStrategy::getInstance())
       : CompressionScheme(sim) {
-    client_.setHeaderIndexingStrategy(NoPathIndexingStrategy::getInstance());
-    server_.setHeaderIndexingStrategy(NoPathIndexingStrategy::getInstance());
+    client_.setHeaderIndexingStrategy(indexingStrategy);
+    server_.setHeaderIndexingStrategy(indexingStrategy);
     client_.setEncoderHeaderTableSize(tableSize);
     server_.setDecoderHeaderTableMaxSize(tableSize);
     client_.setMaxVulnerable(maxBlocking);
     server_.setMaxBlocking(maxBlocking);
+    if (!warmTable.empty()) {
+      // The inserts go out at connection setup, ahead of the first request,
+      // so the decoder sees them immediately.  They stay vulnerable until
+      // the first insert count increment reaches the encoder.
+      folly::IOBufQueue control{folly::IOBufQueue::cacheChainLength()};
+      auto inserted = client_.warmTable(warmTable, control);
+      warmTableBytes_ = control.chainLength();
+      VLOG(2) << "Warmed table with " << inserted
+              << " entries bytes=" << warmTableBytes_;
+      if (!control.empty()) {
+        CHECK_EQ(server_.decodeEncoderStream(control.move()),
+                 HPACK::DecodeError::NONE);
+      }
+    }
   }
 
   ~QPACKScheme() {
@@ -107,7 +124,8 @@ class QPACKScheme : public CompressionScheme {
     cursor.writeBE<uint16_t>(len);
     cursor.insert(std::move(result.stream));
     stats.uncompressed += client_.getEncodedSize().uncompressed;
-    stats.compressed += client_.getEncodedSize().compressed;
+    stats.compressed += client_.getEncodedSize().compressed + warmTableBytes_;
+    warmTableBytes_ = 0;
     // OOO is allowed if there has not been an eviction
     FrameFlags flags(false, false);
     return {flags, queue.move()};
@@ -173,6 +191,8 @@ class QPACKScheme : public CompressionScheme {
   uint16_t decodeControlIndex_{0};
   std::map<uint16_t, std::unique_ptr<folly::IOBuf>> acks_;
   uint16_t sendAck_{1};
+  // Charged to the first encode
+  uint64_t warmTableBytes_{0};
   uint16_t recvAck_{1};
 };
 
@@ -8,6 +8,8 @@
 
 #include <folly/Benchmark.h>
 #include <folly/Range.h>
+#include <folly/io/IOBufQueue.h>
+#include <proxygen/lib/http/codec/compress/Huffman.h>
 #include <proxygen/lib/http/codec/compress/test/TestStreamingCallback.h>
 #include <proxygen/lib/http/codec/compress/test/TestUtil.h>
 
@@ -101,6 +103,56 @@ BENCHMARK(EncodeDecode2, iters) {
   encodeDecodeBench(2, iters);
 }
 
+unique_ptr<IOBuf> huffmanEncode(folly::StringPiece literal) {
+  folly::IOBufQueue queue;
+  folly::io::QueueAppender appender(&queue, 512);
+  huffman::huffTree().encode(literal, appender);
+  auto buf = queue.move();
+  buf->coalesce();
+  return buf;
+}
+
+void huffmanDecodeBench(bool tree, int iters) {
+  unique_ptr<IOBuf> encoded;
+  BENCHMARK_SUSPEND {
+    string literal;
+    for (const auto& header : headers) {
+      literal.append(header.value.data(), header.value.size());
+    }
+    encoded = huffmanEncode(literal);
+  }
+  const auto& huffmanTree = huffman::huffTree();
+  for (int i = 0; i < iters; i++) {
+    folly::fbstring literal;
+    if (tree) {
+      huffmanTree.decodeTree(encoded->data(), encoded->length(), literal);
+    } else {
+      huffmanTree.decode(encoded->data(), encoded->length(), literal);
+    }
+    folly::doNotOptimizeAway(literal);
+  }
+}
+
+BENCHMARK(HuffmanDecodeTree, iters) {
+  huffmanDecodeBench(true, iters);
+}
+
+BENCHMARK_RELATIVE(HuffmanDecodeMultiSymbol, iters) {
+  huffmanDecodeBench(false, iters);
+}
+
+BENCHMARK(HuffmanEncode, iters) {
+  string literal;
+  BENCHMARK_SUSPEND {
+    for (const auto& header : headers) {
+      literal.append(header.value.data(), header.value.size());
+    }
+  }
+  for (int i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(huffmanEncode(literal));
+  }
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -12,6 +12,7 @@
 #include <memory>
 #include <proxygen/lib/http/codec/compress/HPACKDecodeBuffer.h>
 #include <proxygen/lib/http/codec/compress/HPACKEncodeBuffer.h>
+#include <proxygen/lib/http/codec/compress/HuffmanLiteralCache.h>
 
 using namespace folly::io;
 using namespace folly;
@@ -136,6 +137,43 @@ TEST_F(HPACKBufferTests, EncodeHuffmanLiteralN) {
   EXPECT_EQ(data_[11], 0x7f);
 }
 
+TEST_F(HPACKBufferTests, EncodeCachedHuffmanLiteral) {
+  vector<string> literals{"text/html; charset=utf-8",
+                          "private, no-cache, no-store, must-revalidate"};
+  auto encodeAll = [&] {
+    HPACKEncodeBuffer encoder(512, true);
+    for (const auto& literal : literals) {
+      encoder.encodeLiteral(literal);
+      encoder.encodeLiteral(0x40, 5, literal);
+    }
+    encoder.encodeLiteral("not cached");
+    return encoder.release();
+  };
+  auto expected = encodeAll();
+
+  // The cache is process-wide, and only visible once frozen
+  for (const auto& literal : literals) {
+    huffman::HuffmanLiteralCache::add(literal);
+  }
+  EXPECT_EQ(huffman::HuffmanLiteralCache::find(literals[0]), nullptr);
+  huffman::HuffmanLiteralCache::freeze();
+  auto cached = huffman::HuffmanLiteralCache::find(literals[0]);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_EQ(cached->size(),
+            huffman::huffTree().getEncodeSize(literals[0]));
+  EXPECT_EQ(huffman::HuffmanLiteralCache::find("not cached"), nullptr);
+
+  auto actual = encodeAll();
+  EXPECT_TRUE(IOBufEqualTo()(expected, actual));
+
+  buf_ = std::move(actual);
+  resetDecoder();
+  decoder_.reset(cursor_, buf_->computeChainDataLength());
+  folly::fbstring decoded;
+  EXPECT_EQ(decoder_.decodeLiteral(decoded), DecodeError::NONE);
+  EXPECT_EQ(decoded, literals[0]);
+}
+
 TEST_F(HPACKBufferTests, DecodeSingleByte) {
   buf_ = IOBuf::create(512);
   uint8_t* wdata = buf_->writableData();
@@ -6,11 +6,13 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <folly/Conv.h>
 #include <folly/Range.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/portability/GTest.h>
 #include <glog/logging.h>
+#include <proxygen/lib/http/HTTPMessage.h>
 #include <proxygen/lib/http/codec/compress/HPACKCodec.h>
 #include <proxygen/lib/http/codec/compress/Header.h>
 #include <proxygen/lib/http/codec/compress/HeaderCodec.h>
@@ -89,6 +91,75 @@ TEST_F(HPACKCodecTests, Response) {
   }
 }
 
+TEST_F(HPACKCodecTests, ReleaseIdleMemory) {
+  auto result = encodeDecode(client, server, basicHeaders());
+  EXPECT_FALSE(result.hasError());
+  auto stored = client.getCompressionInfo().egress.headersStored_;
+  EXPECT_GT(stored, 0);
+  EXPECT_EQ(server.getCompressionInfo().ingress.headersStored_, stored);
+
+  client.releaseIdleMemory();
+  EXPECT_EQ(client.getCompressionInfo().egress.headersStored_, 0);
+  EXPECT_EQ(client.getCompressionInfo().egress.headerTableSize_,
+            HPACK::kTableSize);
+
+  // The next block empties the decoder's table too
+  result = encodeDecode(client, server, {});
+  EXPECT_FALSE(result.hasError());
+  EXPECT_EQ(server.getCompressionInfo().ingress.headersStored_, 0);
+  EXPECT_EQ(server.getCompressionInfo().ingress.headerTableSize_,
+            HPACK::kTableSize);
+
+  result = encodeDecode(client, server, basicHeaders());
+  EXPECT_FALSE(result.hasError());
+  EXPECT_EQ(result->headers.size(), 12);
+  EXPECT_EQ(client.getCompressionInfo().egress.headersStored_, stored);
+  EXPECT_EQ(server.getCompressionInfo().ingress.headersStored_, stored);
+}
+
+TEST_F(HPACKCodecTests, AdaptiveTableSize) {
+  client.setEncoderAdaptiveTableSize(256);
+  auto tableSize = [this] {
+    return client.getCompressionInfo().egress.headerTableSize_;
+  };
+  // A working set of ~550 bytes that never hits a 256 byte table
+  vector<vector<string>> cycle;
+  for (int i = 0; i < 8; i++) {
+    cycle.push_back({folly::to<string>("x-h", i), string(30, 'a' + i)});
+  }
+  for (int i = 0; i < 8; i++) {
+    auto result = encodeDecode(client, server, headersFromArray(cycle));
+    EXPECT_FALSE(result.hasError());
+    EXPECT_EQ(result->headers.size(), 16);
+    EXPECT_EQ(tableSize(), i < 7 ? 256 : 512);
+  }
+  for (int i = 0; i < 16; i++) {
+    auto result = encodeDecode(client, server, headersFromArray(cycle));
+    EXPECT_FALSE(result.hasError());
+    EXPECT_EQ(result->headers.size(), 16);
+  }
+  EXPECT_EQ(tableSize(), 1024);
+  EXPECT_EQ(server.getCompressionInfo().ingress.headerTableSize_, 1024);
+  EXPECT_LT(client.encode(headersFromArray(cycle))->computeChainDataLength(),
+            16);
+
+  client.releaseIdleMemory();
+  EXPECT_EQ(tableSize(), 256);
+}
+
+TEST_F(HPACKCodecTests, AdaptiveTableSizeNoReuse) {
+  client.setEncoderAdaptiveTableSize(256);
+  for (int i = 0; i < 32; i++) {
+    vector<vector<string>> headers;
+    for (int j = 0; j < 8; j++) {
+      headers.push_back({"x-h", folly::to<string>(string(30, 'a'), i, j)});
+    }
+    auto result = encodeDecode(client, server, headersFromArray(headers));
+    EXPECT_FALSE(result.hasError());
+  }
+  EXPECT_EQ(client.getCompressionInfo().egress.headerTableSize_, 256);
+}
+
 TEST_F(HPACKCodecTests, Headroom) {
   vector<Header> req = basicHeaders();
 
@@ -203,6 +274,62 @@ TEST_F(HPACKCodecTests, HeaderCodecStats) {
   client.setStats(nullptr);
 }
 
+TEST_F(HPACKCodecTests, SampledHeaderStats) {
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  resp.getHeaders().add(HTTP_HEADER_CONTENT_TYPE, "text/plain");
+  resp.getHeaders().add("X-Uncommon-Header", "abc");
+
+  TestHeaderCodecStats stats(HeaderCodec::Type::HPACK);
+  stats.sample = true;
+  server.setStats(&stats);
+  client.setStats(&stats);
+  for (auto i = 0; i < 2; i++) {
+    stats.reset();
+    folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+    server.encodeHTTP(resp, writeBuf, false, folly::none);
+    auto encodedSize = writeBuf.chainLength();
+    auto encoded = writeBuf.move();
+    Cursor cursor(encoded.get());
+    auto result = decode(client, cursor, cursor.totalLength());
+    ASSERT_FALSE(result.hasError());
+
+    // Literals the first time, from the dynamic table the second
+    auto repr = (i == 0) ? HeaderCodec::Representation::NAME_INDEXED
+                         : HeaderCodec::Representation::INDEXED;
+    auto otherRepr = (i == 0) ? HeaderCodec::Representation::LITERAL
+                              : HeaderCodec::Representation::INDEXED;
+    for (const auto* samples : {&stats.encodedHeaders, &stats.decodedHeaders}) {
+      ASSERT_EQ(samples->size(), 3);
+      EXPECT_EQ((*samples)[0].code, HTTP_HEADER_COLON_STATUS);
+      EXPECT_EQ((*samples)[0].representation,
+                HeaderCodec::Representation::INDEXED);
+      EXPECT_EQ((*samples)[0].uncompressed, 12);
+      EXPECT_EQ((*samples)[1].code, HTTP_HEADER_CONTENT_TYPE);
+      EXPECT_EQ((*samples)[1].representation, repr);
+      EXPECT_EQ((*samples)[1].uncompressed, 24);
+      EXPECT_EQ((*samples)[2].code, HTTP_HEADER_OTHER);
+      EXPECT_EQ((*samples)[2].representation, otherRepr);
+      EXPECT_EQ((*samples)[2].uncompressed, 22);
+      uint32_t compressed = 0;
+      for (const auto& sample : *samples) {
+        compressed += sample.compressed;
+      }
+      EXPECT_EQ(compressed, encodedSize);
+    }
+  }
+
+  // Not sampled
+  stats.reset();
+  stats.sample = false;
+  folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+  server.encodeHTTP(resp, writeBuf, false, folly::none);
+  EXPECT_EQ(stats.encodes, 1);
+  EXPECT_TRUE(stats.encodedHeaders.empty());
+  server.setStats(nullptr);
+  client.setStats(nullptr);
+}
+
 /**
  * check that we're enforcing the limit on total uncompressed size
  */
@@ -245,6 +372,33 @@ TEST_F(HPACKCodecTests, SizeLimitStats) {
   EXPECT_EQ(stats.tooLarge, 1);
 }
 
+TEST_F(HPACKCodecTests, StaticTableHeaders) {
+  class StaticCallback : public TestStreamingCallback {
+   public:
+    void onStaticHeader(const HPACKHeaderName& name,
+                        const folly::fbstring& value) override {
+      staticHeaders.emplace_back(name.get(), value.toStdString());
+      onHeader(name, value);
+    }
+    vector<pair<string, string>> staticHeaders;
+  };
+  vector<vector<string>> headers = {
+      {":method", "GET"}, {":path", "/"}, {"x-fb-debug", "sdfgrwer"}};
+  auto req = headersFromArray(headers);
+  for (int i = 0; i < 2; i++) {
+    // the second time x-fb-debug comes from the dynamic table
+    unique_ptr<IOBuf> encoded = client.encode(req);
+    Cursor cursor(encoded.get());
+    StaticCallback cb;
+    server.decodeStreaming(cursor, cursor.totalLength(), &cb);
+    ASSERT_FALSE(cb.hasError());
+    EXPECT_EQ(cb.getResult()->headers.size(), 6);
+    vector<pair<string, string>> expected = {{":method", "GET"},
+                                             {":path", "/"}};
+    EXPECT_EQ(cb.staticHeaders, expected);
+  }
+}
+
 TEST_F(HPACKCodecTests, DefaultHeaderIndexingStrategy) {
   vector<Header> headers = basicHeaders();
   size_t headersIndexableSize = 4;
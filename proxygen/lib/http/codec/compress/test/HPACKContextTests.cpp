@@ -83,7 +83,7 @@ TEST_F(HPACKContextTests, StaticTableHeaderNamesAreCommon) {
                                               "max-forwards",
                                               "if-range",
                                               "refresh"};
-  for (std::pair<HPACKHeaderName, std::list<uint32_t>> entry : table.names()) {
+  for (const auto& entry : table.names()) {
     EXPECT_TRUE(entry.first.isCommonHeader() ||
                 uncommonStaticEntries.find(entry.first.get()) !=
                     uncommonStaticEntries.end())
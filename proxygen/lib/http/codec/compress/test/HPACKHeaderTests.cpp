@@ -11,6 +11,8 @@
 
 #include <glog/logging.h>
 
+#include <folly/Conv.h>
+#include <proxygen/lib/http/codec/compress/AdaptiveIndexingStrategy.h>
 #include <proxygen/lib/http/codec/compress/HeaderIndexingStrategy.h>
 #include <sstream>
 
@@ -65,6 +67,31 @@ TEST_F(HPACKHeaderTests, HeaderIndexingStrategyBasic) {
   EXPECT_TRUE(indexingStrat.indexHeader(data.name, data.value));
 }
 
+TEST_F(HPACKHeaderTests, AdaptiveIndexingStrategy) {
+  AdaptiveIndexingStrategy indexingStrat;
+  HPACKHeaderName requestId("x-request-id");
+  HPACKHeaderName accept("accept");
+  for (uint32_t i = 0; i < AdaptiveIndexingStrategy::kWindow; i++) {
+    indexingStrat.indexHeader(requestId, folly::to<std::string>(i));
+    indexingStrat.indexHeader(accept, (i % 2) ? "text/html" : "*/*");
+  }
+  EXPECT_TRUE(indexingStrat.isChurning(requestId));
+  EXPECT_FALSE(indexingStrat.isChurning(accept));
+  EXPECT_FALSE(indexingStrat.indexHeader(requestId, "abc"));
+  EXPECT_TRUE(indexingStrat.indexHeader(accept, "*/*"));
+
+  // Once the values repeat the name is indexed again
+  for (uint32_t i = 1; i < AdaptiveIndexingStrategy::kWindow; i++) {
+    indexingStrat.indexHeader(requestId, "abc");
+  }
+  EXPECT_FALSE(indexingStrat.isChurning(requestId));
+  EXPECT_TRUE(indexingStrat.indexHeader(requestId, "abc"));
+
+  // The base strategy still applies
+  HPACKHeader clen("content-length", "512");
+  EXPECT_FALSE(indexingStrat.indexHeader(clen.name, clen.value));
+}
+
 class HPACKHeaderNameTest : public testing::Test {};
 
 HPACKHeaderName destroyedHPACKHeaderName(std::string name) {
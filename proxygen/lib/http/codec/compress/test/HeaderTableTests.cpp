@@ -6,6 +6,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <folly/Conv.h>
 #include <folly/portability/GTest.h>
 #include <memory>
 #include <proxygen/lib/http/codec/compress/HeaderTable.h>
@@ -19,6 +20,18 @@ namespace proxygen {
 
 class HeaderTableTests : public testing::Test {
  protected:
+  // number of entries in the table with the given name
+  static size_t countName(const HeaderTable& table,
+                          const HPACKHeaderName& name) {
+    size_t count = 0;
+    for (uint32_t i = 1; i <= table.size(); i++) {
+      if (table.getHeader(i).name == name) {
+        count++;
+      }
+    }
+    return count;
+  }
+
   void xcheck(uint32_t internal, uint32_t external) {
     EXPECT_EQ(HeaderTable::toExternal(head_, length_, internal), external);
     EXPECT_EQ(HeaderTable::toInternal(head_, length_, external), internal);
@@ -73,8 +86,8 @@ TEST_F(HeaderTableTests, Add) {
   table.add(header.copy());
   EXPECT_EQ(table.names().size(), 1);
   EXPECT_EQ(table.hasName(header.name), true);
-  auto it = table.names().find(header.name);
-  EXPECT_EQ(it->second.size(), 3);
+  EXPECT_EQ(table.names().find(header.name)->second, 3);
+  EXPECT_EQ(countName(table, header.name), 3);
   EXPECT_EQ(table.nameIndex(header.name), 1);
 }
 
@@ -94,8 +107,7 @@ TEST_F(HeaderTableTests, Evict) {
   EXPECT_EQ(table.add(accept2.copy()), true);
   // evict the first one
   EXPECT_EQ(table.getHeader(1), accept2);
-  auto ilist = table.names().find(name)->second;
-  EXPECT_EQ(ilist.size(), max);
+  EXPECT_EQ(countName(table, name), max);
   // evict all the 'accept' headers
   for (size_t i = 0; i < max - 1; i++) {
     EXPECT_EQ(table.add(accept2.copy()), true);
@@ -117,6 +129,36 @@ TEST_F(HeaderTableTests, Evict) {
   EXPECT_EQ(table.names().size(), 0);
 }
 
+TEST_F(HeaderTableTests, ReleaseStorage) {
+  HPACKHeader first("x-first", std::string(100, 'a'));
+  HPACKHeader second("x-second", std::string(100, 'b'));
+  HPACKHeader third("x-third", std::string(100, 'c'));
+  HeaderTable table(first.bytes() + second.bytes());
+  table.add(first.copy());
+  table.add(second.copy());
+  table.add(third.copy());
+  ASSERT_EQ(table.size(), 2);
+
+  // The entries in the table are untouched
+  table.releaseStorage();
+  EXPECT_EQ(table.getHeader(1), third);
+  EXPECT_EQ(table.getHeader(2), second);
+  EXPECT_EQ(table.nameIndex(second.name), 2);
+
+  // An empty table gives up its slots, and grows back
+  table.setCapacity(0);
+  table.releaseStorage();
+  EXPECT_EQ(table.size(), 0);
+  EXPECT_EQ(table.length(), 1);
+  table.setCapacity(4096);
+  table.add(first.copy());
+  table.add(second.copy());
+  table.add(third.copy());
+  EXPECT_EQ(table.size(), 3);
+  EXPECT_EQ(table.getHeader(3), first);
+  EXPECT_EQ(table.nameIndex(third.name), 1);
+}
+
 TEST_F(HeaderTableTests, ReduceCapacity) {
   HPACKHeader accept("accept-encoding", "gzip");
   uint32_t max = 10;
@@ -283,8 +325,7 @@ TEST_F(HeaderTableTests, AddLargerThanTable) {
   EXPECT_EQ(table.names().size(), 2);
 
   EXPECT_EQ(table.hasName(name), true);
-  auto it = table.names().find(name);
-  EXPECT_EQ(it->second.size(), 2);
+  EXPECT_EQ(countName(table, name), 2);
   // As nameIndex takes the last index added, we have head = 5, index = 4
   // and so yields a difference of one and as external indexing is 1 based,
   // we expect 2 here
@@ -338,4 +379,43 @@ TEST_F(HeaderTableTests, TinyTable) {
   EXPECT_EQ(table.length(), 1);
 }
 
+TEST_F(HeaderTableTests, NameIndexAcrossEvictionAndResize) {
+  // small table that wraps around and grows, with the chains for both names
+  // spanning the wrap point
+  HeaderTable table(320);
+  HPACKHeader accept("accept", "a");
+  HPACKHeader cookie("cookie", "c");
+  for (uint32_t i = 0; i < 20; i++) {
+    HPACKHeader header = (i % 3 == 0) ? accept.copy() : cookie.copy();
+    header.value.append(folly::to<folly::fbstring>(i));
+    EXPECT_TRUE(table.add(std::move(header)));
+    if (i == 10) {
+      // grow while the ring has wrapped
+      table.setCapacity(640);
+    }
+    for (const auto& name : {accept.name, cookie.name}) {
+      // nameIndex is always the newest entry with the name
+      uint32_t newest = 0;
+      for (uint32_t j = 1; j <= table.size() && newest == 0; j++) {
+        if (table.getHeader(j).name == name) {
+          newest = j;
+        }
+      }
+      EXPECT_EQ(table.nameIndex(name), newest);
+      EXPECT_EQ(table.hasName(name), newest != 0);
+      // and every live entry can be found by value
+      for (uint32_t j = 1; j <= table.size(); j++) {
+        const auto& entry = table.getHeader(j);
+        if (entry.name == name) {
+          EXPECT_EQ(table.getIndex(entry).first, j);
+        }
+      }
+    }
+  }
+  // a value that was evicted is only found by name
+  auto result = table.getIndex(HPACKHeader("accept", "a0"));
+  EXPECT_EQ(result.first, 0);
+  EXPECT_EQ(result.second, table.nameIndex(accept.name));
+}
+
 } // namespace proxygen
@@ -162,6 +162,33 @@ TEST_F(HuffmanTests, UserAgent) {
   CHECK_EQ(user_agent, decoded);
 }
 
+/*
+ * the multi-symbol decoder must match the tree decoder for every character,
+ * including the ones with codes longer than the table index, at any offset
+ */
+TEST_F(HuffmanTests, MultiSymbolDecode) {
+  folly::fbstring all;
+  for (uint32_t i = 0; i < kTableSize; i++) {
+    all.push_back(static_cast<char>(i));
+  }
+  for (size_t offset = 0; offset < 5; offset++) {
+    folly::fbstring literal = all.substr(0, offset) + "e" + all;
+    IOBufQueue bufQueue;
+    QueueAppender appender(&bufQueue, 512);
+    uint32_t size = tree_.encode(literal, appender);
+    auto encoded = bufQueue.move();
+    encoded->coalesce();
+    EXPECT_EQ(size, encoded->length());
+
+    folly::fbstring decoded("prefix");
+    tree_.decode(encoded->data(), size, decoded);
+    EXPECT_EQ(decoded, "prefix" + literal);
+    folly::fbstring treeDecoded("prefix");
+    tree_.decodeTree(encoded->data(), size, treeDecoded);
+    EXPECT_EQ(decoded, treeDecoded);
+  }
+}
+
 /*
  * this test is verifying the CHECK for length at the end of huffman::encode()
  */
@@ -230,20 +257,20 @@ uint32_t treeDfs(const SuperHuffNode* allSnodes,
       EXPECT_TRUE(node.metadata.bits <= 8);
 
       // used to count unique leaves at this node
-      leaves.insert(node.data.ch);
+      leaves.insert(node.ch());
     } else {
 
       // this condition is a branching node
       // this should have the superNodeIndex set but not bits should be set
 
       EXPECT_TRUE(!node.isLeaf());
-      EXPECT_TRUE(node.data.superNodeIndex > 0);
+      EXPECT_TRUE(node.superNodeIndex() > 0);
       EXPECT_TRUE(node.metadata.bits == 0);
-      EXPECT_TRUE(node.data.superNodeIndex < 46);
+      EXPECT_TRUE(node.superNodeIndex() < 46);
 
       // keep track of leaf counts for this subtree
       subtreeLeafCount += treeDfs(allSnodes,
-                                  node.data.superNodeIndex,
+                                  node.superNodeIndex(),
                                   depth + 1,
                                   newFullCode,
                                   eosCode,
@@ -230,3 +230,32 @@ TEST_F(QPACKTests, HeaderCodecStats) {
   EXPECT_EQ(stats.encodedBytesUncompr, 0);
   client.setStats(nullptr);
 }
+
+TEST_F(QPACKTests, SampledHeaderStats) {
+  vector<vector<string>> headers = {{"Content-Length", "80"},
+                                    {"X-Uncommon-Header", "abc"}};
+  vector<Header> resp = headersFromArray(headers);
+  auto encResult = server.encode(resp, 1);
+
+  TestHeaderCodecStats stats(HeaderCodec::Type::QPACK);
+  stats.sample = true;
+  client.setStats(&stats);
+  TestStreamingCallback cb;
+  auto len = encResult.stream->computeChainDataLength();
+  client.decodeEncoderStream(std::move(encResult.control));
+  client.decodeStreaming(1, std::move(encResult.stream), len, &cb);
+  EXPECT_FALSE(cb.getResult().hasError());
+  ASSERT_EQ(stats.decodedHeaders.size(), 2);
+  EXPECT_EQ(stats.decodedHeaders[0].code, HTTP_HEADER_CONTENT_LENGTH);
+  EXPECT_EQ(stats.decodedHeaders[0].uncompressed, 18);
+  EXPECT_EQ(stats.decodedHeaders[1].code, HTTP_HEADER_OTHER);
+  EXPECT_EQ(stats.decodedHeaders[1].uncompressed, 22);
+  uint32_t compressed = 0;
+  for (const auto& sample : stats.decodedHeaders) {
+    EXPECT_GT(sample.compressed, 0);
+    compressed += sample.compressed;
+  }
+  // Less the block prefix
+  EXPECT_LT(compressed, len);
+  client.setStats(nullptr);
+}
@@ -588,6 +588,80 @@ TEST(QPACKContextTests, TestDecodeQueueResetSelf) {
             HPACK::DecodeError::NONE);
 }
 
+TEST(QPACKContextTests, TestDecodeQueueOrder) {
+  // Blocks unblock fewest inserts first, whatever order they arrived in
+  QPACKEncoder encoder(true, 100);
+  QPACKDecoder decoder(100);
+
+  vector<HPACKHeader> req1;
+  req1.emplace_back("Blarf", "Blah");
+  auto result1 = encoder.encode(req1, 0, 1);
+  vector<HPACKHeader> req2;
+  req2.emplace_back("Blarf", "Blerg");
+  auto result2 = encoder.encode(req2, 0, 2);
+  vector<HPACKHeader> req3;
+  req3.emplace_back("Blarf", "Blah");
+  auto result3 = encoder.encode(req3, 0, 3);
+
+  std::vector<uint64_t> order;
+  TestStreamingCallback cb1;
+  TestStreamingCallback cb2;
+  TestStreamingCallback cb3;
+  cb1.headersCompleteCb = [&] { order.push_back(1); };
+  cb2.headersCompleteCb = [&] { order.push_back(2); };
+  cb3.headersCompleteCb = [&] { order.push_back(3); };
+  auto length = result2.stream->computeChainDataLength();
+  decoder.decodeStreaming(2, std::move(result2.stream), length, &cb2);
+  length = result1.stream->computeChainDataLength();
+  decoder.decodeStreaming(1, std::move(result1.stream), length, &cb1);
+  length = result3.stream->computeChainDataLength();
+  decoder.decodeStreaming(3, std::move(result3.stream), length, &cb3);
+  EXPECT_EQ(decoder.getHolBlockCount(), 3);
+  EXPECT_GT(decoder.getQueuedBytes(), 0);
+
+  // Both inserts in one read
+  auto control = std::move(result1.control);
+  control->appendToChain(std::move(result2.control));
+  EXPECT_EQ(decoder.decodeEncoderStream(std::move(control)),
+            HPACK::DecodeError::NONE);
+  EXPECT_EQ(order, std::vector<uint64_t>({1, 3, 2}));
+  EXPECT_EQ(decoder.getQueuedBytes(), 0);
+  EXPECT_EQ(*cb2.hpackHeaders(), req2);
+  EXPECT_GE(decoder.getMaxBlockedTime().count(), 0);
+}
+
+TEST(QPACKContextTests, TestDecodeQueueMaxBytes) {
+  QPACKEncoder encoder(true, 100);
+  QPACKDecoder decoder(100);
+
+  vector<HPACKHeader> req1;
+  req1.emplace_back("Blarf", "Blah");
+  auto result1 = encoder.encode(req1, 0, 1);
+  vector<HPACKHeader> req2;
+  req2.emplace_back("Blarf", "Blerg");
+  auto result2 = encoder.encode(req2, 0, 2);
+
+  // Room for the first block only
+  TestStreamingCallback cb1;
+  auto length = result1.stream->computeChainDataLength();
+  decoder.decodeStreaming(1, std::move(result1.stream), length, &cb1);
+  auto queued = decoder.getQueuedBytes();
+  EXPECT_GT(queued, 0);
+  decoder.setMaxQueuedBytes(queued);
+  TestStreamingCallback cb2;
+  length = result2.stream->computeChainDataLength();
+  decoder.decodeStreaming(2, std::move(result2.stream), length, &cb2);
+  EXPECT_EQ(cb2.error, HPACK::DecodeError::TOO_MANY_BLOCKING);
+  EXPECT_EQ(decoder.getQueuedBytes(), queued);
+
+  // Cancelling releases the bytes
+  decoder.encodeCancelStream(1);
+  EXPECT_EQ(decoder.getQueuedBytes(), 0);
+  EXPECT_EQ(decoder.decodeEncoderStream(std::move(result1.control)),
+            HPACK::DecodeError::NONE);
+  EXPECT_EQ(cb1.headers.size(), 0);
+}
+
 TEST(QPACKContextTests, TestEncoderStreamEndBlocked) {
   // This test queues a blocked stream, then ends the encoder stream
   QPACKEncoder encoder(true, 100);
@@ -1071,3 +1145,51 @@ TEST(QPACKContextTests, TestFragmentTableSizeUpdate) {
     EXPECT_EQ(h.value, result->headers[i++].str);
   }
 }
+
+TEST(QPACKContextTests, TestWarmTable) {
+  // 200 byte table reserves 48 bytes, leaving 152 for warm entries
+  QPACKEncoder encoder(false, 200);
+  QPACKDecoder decoder(200);
+  vector<HPACKHeader> warm;
+  warm.emplace_back(":method", "GET");  // static, skipped
+  warm.emplace_back("Blarf", "Blah");   // 41 bytes
+  warm.emplace_back("Blarf", "Blah");   // already inserted, skipped
+  warm.emplace_back("Blarf", "Blerg");  // 42 bytes
+  warm.emplace_back("Blarf", "Blingo"); // 43 bytes
+  warm.emplace_back("Foo", "Barbaz");   // 41 bytes, would drain Blah
+  warm.emplace_back("A", "B");
+  folly::IOBufQueue controlQueue{folly::IOBufQueue::cacheChainLength()};
+  EXPECT_EQ(encoder.warmTable(warm, controlQueue, 1000), 3);
+  EXPECT_EQ(encoder.getInsertCount(), 3);
+  auto control = controlQueue.move();
+  EXPECT_FALSE(stringInOutput(control.get(), "Barbaz"));
+  EXPECT_EQ(decoder.decodeEncoderStream(std::move(control)),
+            HPACK::DecodeError::NONE);
+  EXPECT_EQ(decoder.getHeadersStored(), 3);
+  EXPECT_EQ(encoder.decodeDecoderStream(decoder.encodeInsertCountInc()),
+            HPACK::DecodeError::NONE);
+
+  // The first request only references the warm entries
+  vector<HPACKHeader> req;
+  req.emplace_back("Blarf", "Blerg");
+  req.emplace_back("Blarf", "Blah");
+  auto result = encoder.encode(req, 0, 1);
+  EXPECT_EQ(result.control, nullptr);
+  EXPECT_FALSE(stringInOutput(result.stream.get(), "Blerg"));
+  EXPECT_FALSE(stringInOutput(result.stream.get(), "Blah"));
+  verifyDecode(decoder, std::move(result), req);
+  headerAck(decoder, encoder, 1);
+}
+
+TEST(QPACKContextTests, TestWarmTableFlowControl) {
+  QPACKEncoder encoder(false, 4096);
+  vector<HPACKHeader> warm;
+  warm.emplace_back("Blarf", "Blah");
+  warm.emplace_back("Blarf", "Blerg");
+  folly::IOBufQueue controlQueue{folly::IOBufQueue::cacheChainLength()};
+  EXPECT_EQ(encoder.warmTable(warm, controlQueue, 0), 0);
+  EXPECT_TRUE(controlQueue.empty());
+  // Blah is 11 bytes on the encoder stream and exhausts the window
+  EXPECT_EQ(encoder.warmTable(warm, controlQueue, 11), 1);
+  EXPECT_EQ(controlQueue.chainLength(), 11);
+}
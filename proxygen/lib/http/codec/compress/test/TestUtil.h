@@ -68,6 +68,23 @@ class TestHeaderCodecStats : public HeaderCodec::Stats {
     tooLarge++;
   }
 
+  bool sampleHeaders(HeaderCodec::Type type) override {
+    EXPECT_EQ(type, type_);
+    return sample;
+  }
+
+  void recordHeaderEncode(HeaderCodec::Type type,
+                          const HeaderCodec::HeaderSample& s) override {
+    EXPECT_EQ(type, type_);
+    encodedHeaders.push_back(s);
+  }
+
+  void recordHeaderDecode(HeaderCodec::Type type,
+                          const HeaderCodec::HeaderSample& s) override {
+    EXPECT_EQ(type, type_);
+    decodedHeaders.push_back(s);
+  }
+
   void reset() {
     encodes = 0;
     decodes = 0;
@@ -78,6 +95,8 @@ class TestHeaderCodecStats : public HeaderCodec::Stats {
     decodedBytesUncompr = 0;
     errors = 0;
     tooLarge = 0;
+    encodedHeaders.clear();
+    decodedHeaders.clear();
   }
 
   HeaderCodec::Type type_;
@@ -90,6 +109,9 @@ class TestHeaderCodecStats : public HeaderCodec::Stats {
   uint32_t decodedBytesUncompr{0};
   uint32_t errors{0};
   uint32_t tooLarge{0};
+  bool sample{false};
+  std::vector<HeaderCodec::HeaderSample> encodedHeaders;
+  std::vector<HeaderCodec::HeaderSample> decodedHeaders;
 };
 
 }} // namespace proxygen::hpack
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <limits>
+#include <proxygen/lib/http/codec/ControlMessageRateLimitFilter.h>
+#include <proxygen/lib/http/codec/FlowControlFilter.h>
+#include <proxygen/lib/http/codec/HTTPChecks.h>
+#include <proxygen/lib/http/codec/test/MockHTTPCodec.h>
+
+using namespace proxygen;
+using namespace testing;
+
+/**
+ * Per-frame cost of the codec callbacks through HTTPSession's filter stack,
+ * with HTTPChecks as its own filter or composed into the flow control
+ * filter.
+ */
+
+namespace {
+
+// Window large enough for any number of iterations
+constexpr uint32_t kRecvWindow = std::numeric_limits<int32_t>::max();
+
+class NullCallback : public HTTPCodec::Callback {
+ public:
+  void onMessageBegin(HTTPCodec::StreamID, HTTPMessage*) override {
+  }
+  void onHeadersComplete(HTTPCodec::StreamID,
+                         std::unique_ptr<HTTPMessage>) override {
+  }
+  void onBody(HTTPCodec::StreamID,
+              std::unique_ptr<folly::IOBuf>,
+              uint16_t) override {
+  }
+  void onTrailersComplete(HTTPCodec::StreamID,
+                          std::unique_ptr<HTTPHeaders>) override {
+  }
+  void onMessageComplete(HTTPCodec::StreamID, bool) override {
+  }
+  void onError(HTTPCodec::StreamID, const HTTPException&, bool) override {
+  }
+  void onWindowUpdate(HTTPCodec::StreamID, uint32_t) override {
+  }
+};
+
+class NullFlowControlCallback : public FlowControlFilter::Callback {
+ public:
+  void onConnectionSendWindowOpen() override {
+  }
+  void onConnectionSendWindowClosed() override {
+  }
+};
+
+// The session's filters over a codec, and the callback the codec calls
+struct Stack {
+  explicit Stack(bool composed)
+      : codec(new NiceMock<MockHTTPCodec>()),
+        chain(std::unique_ptr<HTTPCodec>(codec)) {
+    ON_CALL(*codec, setCallback(_)).WillByDefault(SaveArg<0>(&codecCallback));
+    ON_CALL(*codec, getDefaultWindowSize())
+        .WillByDefault(Return(http2::kInitialWindow));
+    if (composed) {
+      chain.addFilters(std::unique_ptr<FlowControlFilter>(
+          new HTTPChecksT<FlowControlFilter>(
+              flowCallback, writeBuf, codec, kRecvWindow)));
+    } else {
+      chain.add<HTTPChecks>();
+      chain.addFilters(std::make_unique<FlowControlFilter>(
+          flowCallback, writeBuf, codec, kRecvWindow));
+    }
+    chain.addFilters(
+        std::make_unique<ControlMessageRateLimitFilter>(&evb.timer()));
+    chain.setCallback(&callback);
+  }
+
+  folly::EventBase evb;
+  NullCallback callback;
+  NullFlowControlCallback flowCallback;
+  folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+  HTTPCodec::Callback* codecCallback{nullptr};
+  NiceMock<MockHTTPCodec>* codec;
+  HTTPCodecFilterChain chain;
+};
+
+void messageComplete(size_t iters, bool composed) {
+  folly::Optional<Stack> stack;
+  BENCHMARK_SUSPEND {
+    stack.emplace(composed);
+  }
+  for (size_t i = 0; i < iters; i++) {
+    stack->codecCallback->onMessageComplete(1, false);
+  }
+}
+
+void body(size_t iters, bool composed) {
+  folly::Optional<Stack> stack;
+  std::vector<std::unique_ptr<folly::IOBuf>> bodies;
+  BENCHMARK_SUSPEND {
+    CHECK_LT(iters, kRecvWindow);
+    stack.emplace(composed);
+    bodies.reserve(iters);
+    for (size_t i = 0; i < iters; i++) {
+      bodies.push_back(folly::IOBuf::copyBuffer("x"));
+    }
+  }
+  for (auto& buf : bodies) {
+    stack->codecCallback->onBody(1, std::move(buf), 0);
+  }
+}
+
+void streamWindowUpdate(size_t iters, bool composed) {
+  folly::Optional<Stack> stack;
+  BENCHMARK_SUSPEND {
+    stack.emplace(composed);
+  }
+  for (size_t i = 0; i < iters; i++) {
+    stack->codecCallback->onWindowUpdate(1, 1);
+  }
+}
+
+} // namespace
+
+BENCHMARK(MessageCompleteSeparate, iters) {
+  messageComplete(iters, false);
+}
+
+BENCHMARK_RELATIVE(MessageCompleteComposed, iters) {
+  messageComplete(iters, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(BodySeparate, iters) {
+  body(iters, false);
+}
+
+BENCHMARK_RELATIVE(BodyComposed, iters) {
+  body(iters, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(StreamWindowUpdateSeparate, iters) {
+  streamWindowUpdate(iters, false);
+}
+
+BENCHMARK_RELATIVE(StreamWindowUpdateComposed, iters) {
+  streamWindowUpdate(iters, true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
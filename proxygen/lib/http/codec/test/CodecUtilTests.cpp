@@ -18,6 +18,11 @@ folly::ByteRange input(const char *str) {
   return folly::ByteRange(reinterpret_cast<const uint8_t *>(str), strlen(str));
 }
 
+folly::ByteRange input(const string& str) {
+  return folly::ByteRange(reinterpret_cast<const uint8_t *>(str.data()),
+                          str.size());
+}
+
 TEST(CodecUtil, validateURL) {
   EXPECT_TRUE(CodecUtil::validateURL(input("/foo"), URLValidateMode::STRICT));
   EXPECT_TRUE(CodecUtil::validateURL(input("/foo\xff"),
@@ -167,6 +172,44 @@ TEST(CodecUtil, validateHeaderValue) {
                                              CodecUtil::COMPLIANT));
 }
 
+TEST(CodecUtil, validateLongHeaders) {
+  // Past the vector width, with one octet the scans don't skip at every
+  // position
+  const string name(70, 'a');
+  const string value(70, 'v');
+  EXPECT_TRUE(CodecUtil::validateHeaderName(input(name),
+                                            CodecUtil::HEADER_NAME_STRICT));
+  EXPECT_TRUE(CodecUtil::validateHeaderValue(input(value), CodecUtil::STRICT));
+  for (size_t i = 0; i < name.size(); i++) {
+    auto badName = name;
+    badName[i] = ':';
+    EXPECT_FALSE(CodecUtil::validateHeaderName(input(badName),
+                                               CodecUtil::HEADER_NAME_STRICT));
+    badName[i] = 'A';
+    EXPECT_FALSE(CodecUtil::validateHeaderName(input(badName),
+                                               CodecUtil::HEADER_NAME_STRICT));
+    EXPECT_TRUE(CodecUtil::validateHeaderName(
+        input(badName), CodecUtil::HEADER_NAME_STRICT_COMPAT));
+
+    auto badValue = value;
+    badValue[i] = '\x01';
+    EXPECT_FALSE(
+        CodecUtil::validateHeaderValue(input(badValue), CodecUtil::STRICT));
+    badValue[i] = '\x80';
+    EXPECT_FALSE(
+        CodecUtil::validateHeaderValue(input(badValue), CodecUtil::STRICT));
+    EXPECT_TRUE(CodecUtil::validateHeaderValue(input(badValue),
+                                               CodecUtil::STRICT_COMPAT));
+  }
+  // The octets the scans stop at still drive the state machine
+  EXPECT_TRUE(CodecUtil::validateHeaderValue(
+      input(value + "\"\\\r\\\n\"" + value), CodecUtil::COMPLIANT));
+  EXPECT_FALSE(CodecUtil::validateHeaderValue(input(value + "\r" + value),
+                                              CodecUtil::STRICT));
+  EXPECT_TRUE(CodecUtil::validateHeaderValue(
+      input(value + "\r\n\t" + value), CodecUtil::STRICT));
+}
+
 TEST(CodecUtil, hasGzipAndDeflate) {
   bool gzip = false;
   bool deflate = false;
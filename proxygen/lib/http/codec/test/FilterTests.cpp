@@ -12,6 +12,7 @@
 #include <proxygen/lib/http/HTTPMessage.h>
 #include <proxygen/lib/http/codec/DebugFilter.h>
 #include <proxygen/lib/http/codec/FlowControlFilter.h>
+#include <proxygen/lib/http/codec/FrameRecorder.h>
 #include <proxygen/lib/http/codec/HTTPChecks.h>
 #include <proxygen/lib/http/codec/test/MockHTTPCodec.h>
 #include <proxygen/lib/http/codec/test/TestUtils.h>
@@ -73,6 +74,23 @@ class DebugFilterTest : public FilterTest {
   folly::IOBufQueue writeBuf_{folly::IOBufQueue::cacheChainLength()};
 };
 
+class FrameRecorderTest : public FilterTest {
+ public:
+  void SetUp() override {
+    recorder_ = new FrameRecorder(
+        4, [this](const std::vector<FrameRecorder::Frame>& frames) {
+          dumps_++;
+          dumped_ = frames;
+        });
+    chain_.addFilters(std::unique_ptr<FrameRecorder>(recorder_));
+  }
+
+ protected:
+  FrameRecorder* recorder_;
+  size_t dumps_{0};
+  std::vector<FrameRecorder::Frame> dumped_;
+};
+
 template <int initSize>
 class FlowControlFilterTest : public FilterTest {
  public:
@@ -112,6 +130,20 @@ class FlowControlFilterTest : public FilterTest {
   int recvWindow_{initSize};
 };
 
+// HTTPChecks composed into the flow control filter, as HTTPSession does
+class ComposedFilterTest : public FilterTest {
+ public:
+  void SetUp() override {
+    EXPECT_CALL(*codec_, getDefaultWindowSize())
+        .WillRepeatedly(Return(kInitialCapacity));
+    filter_ =
+        new HTTPChecksT<FlowControlFilter>(flowCallback_, writeBuf_, codec_);
+    chain_.addFilters(std::unique_ptr<FlowControlFilter>(filter_));
+  }
+  StrictMock<MockFlowControlCallback> flowCallback_;
+  FlowControlFilter* filter_;
+};
+
 using DefaultFlowControl = FlowControlFilterTest<0>;
 using BigWindow = FlowControlFilterTest<1000000>;
 
@@ -164,6 +196,63 @@ TEST_F(DefaultFlowControl, SendUpdate) {
   filter_->ingressBytesProcessed(writeBuf_, 1);
 }
 
+TEST_F(DefaultFlowControl, DeferredUpdate) {
+  // Deferred updates keep coalescing until flushed
+  InSequence enforceSequence;
+  EXPECT_CALL(callback_, onBody(_, _, _)).WillRepeatedly(Return());
+  filter_->setDeferWindowUpdates(true);
+  EXPECT_FALSE(filter_->flushWindowUpdate(writeBuf_));
+
+  callbackStart_->onBody(1, makeBuf(kInitialCapacity), 0);
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, _, _)).Times(0);
+  EXPECT_FALSE(filter_->ingressBytesProcessed(writeBuf_, kInitialCapacity / 2));
+  EXPECT_TRUE(filter_->ingressBytesProcessed(writeBuf_, 1));
+  EXPECT_TRUE(filter_->ingressBytesProcessed(writeBuf_, 10));
+
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, kInitialCapacity / 2 + 11));
+  EXPECT_TRUE(filter_->flushWindowUpdate(writeBuf_));
+  EXPECT_FALSE(filter_->flushWindowUpdate(writeBuf_));
+}
+
+TEST_F(DefaultFlowControl, GrowWithUnackedBytes) {
+  // Growing the window doesn't drop the bytes processed but not acked yet
+  InSequence enforceSequence;
+  EXPECT_CALL(callback_, onBody(_, _, _)).WillRepeatedly(Return());
+  callbackStart_->onBody(1, makeBuf(kInitialCapacity), 0);
+  filter_->ingressBytesProcessed(writeBuf_, kInitialCapacity / 2);
+
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, kInitialCapacity));
+  filter_->setReceiveWindowSize(writeBuf_, 2 * kInitialCapacity);
+  callbackStart_->onBody(1, makeBuf(2), 0);
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, kInitialCapacity + 2));
+  filter_->ingressBytesProcessed(writeBuf_, kInitialCapacity / 2 + 3);
+  EXPECT_EQ(filter_->getRecvWindow().getCapacity(), 2 * kInitialCapacity);
+  EXPECT_EQ(filter_->getRecvWindow().getOutstanding(), 0);
+}
+
+TEST_F(DefaultFlowControl, ReceiveWindowLimit) {
+  // The updates keep the window the peer sees under the limit
+  InSequence enforceSequence;
+  EXPECT_CALL(callback_, onBody(_, _, _)).WillRepeatedly(Return());
+  filter_->setReceiveWindowLimit(4000);
+  callbackStart_->onBody(1, makeBuf(kInitialCapacity), 0);
+
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, 2001));
+  EXPECT_TRUE(filter_->ingressBytesProcessed(writeBuf_, 2001));
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, 1999));
+  EXPECT_TRUE(filter_->ingressBytesProcessed(writeBuf_, 3000));
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, _, _)).Times(0);
+  EXPECT_FALSE(
+      filter_->ingressBytesProcessed(writeBuf_, kInitialCapacity - 5001));
+  EXPECT_EQ(filter_->getRecvWindow().getSize(), 4000);
+
+  // Lifting it releases what was held back
+  filter_->setReceiveWindowLimit(0);
+  EXPECT_CALL(*codec_, generateWindowUpdate(_, 0, kInitialCapacity - 4000));
+  EXPECT_TRUE(filter_->flushWindowUpdate(writeBuf_));
+  EXPECT_EQ(filter_->getRecvWindow().getOutstanding(), 0);
+}
+
 TEST_F(BigWindow, RecvTooMuch) {
   // Constructing the filter with a large capacity causes a WINDOW_UPDATE
   // for stream zero to be generated
@@ -266,6 +355,42 @@ TEST_F(HTTPChecksTest, RecvTraceBody) {
   callbackStart_->onHeadersComplete(0, std::move(msg));
 }
 
+TEST_F(ComposedFilterTest, RecvTraceBody) {
+  EXPECT_CALL(callback_, onError(_, _, _))
+      .WillOnce(Invoke([](HTTPCodec::StreamID,
+                          std::shared_ptr<HTTPException> exc,
+                          bool newTxn) {
+        ASSERT_TRUE(newTxn);
+        ASSERT_EQ(exc->getHttpStatusCode(), 400);
+      }));
+
+  auto msg = makePostRequest();
+  msg->setMethod("TRACE");
+
+  callbackStart_->onHeadersComplete(0, std::move(msg));
+}
+
+TEST_F(ComposedFilterTest, SendTraceBodyDeath) {
+  HTTPMessage msg = getPostRequest();
+  msg.setMethod("TRACE");
+
+  EXPECT_DEATH_NO_CORE(chain_->generateHeader(writeBuf_, 0, msg), ".*");
+}
+
+TEST_F(ComposedFilterTest, FlowControl) {
+  InSequence enforceSequence;
+  EXPECT_CALL(callback_, onHeadersComplete(1, _));
+  EXPECT_CALL(callback_, onBody(1, _, _));
+  EXPECT_CALL(callback_, onError(0, IsFlowException(), _));
+
+  callbackStart_->onHeadersComplete(1, makeGetRequest());
+  callbackStart_->onBody(1, makeBuf(kInitialCapacity), 0);
+  EXPECT_EQ(filter_->getRecvWindow().getSize(), 0);
+  // Past the window
+  callbackStart_->onBody(1, makeBuf(1), 0);
+  EXPECT_FALSE(chain_->isReusable());
+}
+
 TEST_F(DebugFilterTest, NoError) {
   chain_->onIngress(*makeIOBuf("foo"));
   chain_->onIngressEOF();
@@ -341,3 +466,41 @@ TEST_F(DebugFilterTest, OnStreamErrorPartialMsg) {
   callbackStart_->onError(1, ex, false);
   EXPECT_EQ(dumpedIngress_.move()->moveToFbString(), std::string("foo"));
 }
+
+TEST_F(FrameRecorderTest, KeepsLastFrames) {
+  for (uint8_t i = 0; i < 6; i++) {
+    callbackStart_->onFrameHeader(1, i, 100 + i, i % 2);
+  }
+  callbackStart_->onGenerateFrameHeader(3, 1, 10, 0);
+  EXPECT_EQ(recorder_->getNumRecorded(), 7);
+
+  auto frames = recorder_->getFrames();
+  ASSERT_EQ(frames.size(), 4);
+  EXPECT_EQ(frames[0].flags, 3);
+  EXPECT_EQ(frames[0].length, 103);
+  EXPECT_EQ(frames[0].type, 1);
+  EXPECT_FALSE(frames[0].egress);
+  EXPECT_LE(frames[0].time, frames[1].time);
+  EXPECT_EQ(frames[3].stream, 3);
+  EXPECT_TRUE(frames[3].egress);
+  EXPECT_EQ(dumps_, 0);
+}
+
+TEST_F(FrameRecorderTest, DumpOnError) {
+  callbackStart_->onFrameHeader(1, 0, 10, 0);
+  HTTPException ex(HTTPException::Direction::INGRESS, "error");
+  // Stream errors don't fail the session
+  callbackStart_->onError(1, ex, false);
+  EXPECT_EQ(dumps_, 0);
+
+  callbackStart_->onError(0, ex, false);
+  EXPECT_EQ(dumps_, 1);
+  ASSERT_EQ(dumped_.size(), 1);
+  EXPECT_EQ(dumped_[0].length, 10);
+
+  callbackStart_->onGoaway(0, ErrorCode::NO_ERROR, nullptr);
+  EXPECT_EQ(dumps_, 1);
+  EXPECT_CALL(*codec_, generateGoaway(_, _, _, _));
+  chain_->generateGoaway(writeBuf_, 0, ErrorCode::PROTOCOL_ERROR, nullptr);
+  EXPECT_EQ(dumps_, 2);
+}
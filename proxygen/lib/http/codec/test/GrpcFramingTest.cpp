@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/codec/GrpcFraming.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+using namespace proxygen::grpc;
+
+namespace {
+
+std::string toString(const std::unique_ptr<folly::IOBuf>& buf) {
+  return buf ? buf->cloneAsValue().moveToFbString().toStdString() : "";
+}
+
+} // namespace
+
+TEST(GrpcFramingTest, FrameInHeadroom) {
+  auto payload = folly::IOBuf::create(kMessagePrefixSize + 3);
+  payload->advance(kMessagePrefixSize);
+  memcpy(payload->writableTail(), "abc", 3);
+  payload->append(3);
+  auto data = payload->data();
+
+  auto framed = frameMessage(std::move(payload), true);
+  EXPECT_FALSE(framed->isChained());
+  EXPECT_EQ(framed->data() + kMessagePrefixSize, data);
+  EXPECT_EQ(toString(framed), std::string("\x01\x00\x00\x00\x03" "abc", 8));
+}
+
+TEST(GrpcFramingTest, FrameShared) {
+  auto payload = folly::IOBuf::copyBuffer("abc", 3, kMessagePrefixSize);
+  auto clone = payload->clone();
+  auto framed = frameMessage(std::move(payload));
+  EXPECT_TRUE(framed->isChained());
+  EXPECT_EQ(toString(framed), std::string("\x00\x00\x00\x00\x03" "abc", 8));
+  EXPECT_EQ(toString(clone), "abc");
+
+  EXPECT_EQ(toString(frameMessage(nullptr)), std::string(5, '\0'));
+}
+
+TEST(GrpcFramingTest, ReadAcrossChunks) {
+  auto wire =
+      toString(frameMessage(folly::IOBuf::copyBuffer("hello world"))) +
+      toString(frameMessage(nullptr, true)) +
+      toString(frameMessage(folly::IOBuf::copyBuffer("bye")));
+
+  // One byte at a time
+  MessageReader reader;
+  std::vector<Message> messages;
+  for (auto c : wire) {
+    reader.append(folly::IOBuf::copyBuffer(&c, 1));
+    auto message = reader.next();
+    ASSERT_TRUE(message.hasValue());
+    if (message->has_value()) {
+      messages.push_back(std::move(**message));
+    }
+  }
+  EXPECT_EQ(reader.pending(), 0);
+  ASSERT_EQ(messages.size(), 3);
+  // Chained slices of the chunks rather than a copy
+  EXPECT_EQ(messages[0].payload->countChainElements(), 11);
+  EXPECT_EQ(toString(messages[0].payload), "hello world");
+  EXPECT_FALSE(messages[0].compressed);
+  EXPECT_EQ(messages[1].payload, nullptr);
+  EXPECT_TRUE(messages[1].compressed);
+  EXPECT_EQ(toString(messages[2].payload), "bye");
+
+  // All at once
+  reader.append(folly::IOBuf::copyBuffer(wire));
+  size_t count = 0;
+  while (true) {
+    auto message = reader.next();
+    ASSERT_TRUE(message.hasValue());
+    if (!message->has_value()) {
+      break;
+    }
+    count++;
+  }
+  EXPECT_EQ(count, 3);
+  EXPECT_EQ(reader.pending(), 0);
+}
+
+TEST(GrpcFramingTest, ReadErrors) {
+  MessageReader flag;
+  flag.append(folly::IOBuf::copyBuffer("\x02\x00\x00\x00\x00", 5));
+  auto result = flag.next();
+  ASSERT_TRUE(result.hasError());
+  EXPECT_EQ(result.error(), MessageError::INVALID_FLAG);
+
+  // Before the payload arrives
+  MessageReader large(16);
+  large.append(folly::IOBuf::copyBuffer("\x00\x00\x00\x00\x11", 5));
+  result = large.next();
+  ASSERT_TRUE(result.hasError());
+  EXPECT_EQ(result.error(), MessageError::TOO_LARGE);
+}
+
+TEST(GrpcFramingTest, StatusTrailers) {
+  uint32_t status = 0;
+  folly::StringPiece message;
+  HTTPHeaders trailers;
+  EXPECT_FALSE(getStatusTrailers(trailers, status, message));
+
+  trailers.add("grpc-status", "5");
+  EXPECT_TRUE(getStatusTrailers(trailers, status, message));
+  EXPECT_EQ(status, 5);
+  EXPECT_TRUE(message.empty());
+
+  trailers.add("Grpc-Message", "not found");
+  EXPECT_TRUE(getStatusTrailers(trailers, status, message));
+  EXPECT_EQ(message, "not found");
+
+  HTTPHeaders other;
+  other.add("grpc-status", "0");
+  other.add("x-trailer", "1");
+  EXPECT_FALSE(getStatusTrailers(other, status, message));
+
+  HTTPHeaders invalid;
+  invalid.add("grpc-status", "ok");
+  EXPECT_FALSE(getStatusTrailers(invalid, status, message));
+}
+
+TEST(GrpcFramingTest, EncodeStatusTrailers) {
+  folly::IOBufQueue hpack{folly::IOBufQueue::cacheChainLength()};
+  auto size = appendHPACKStatusTrailers(hpack, 0, "");
+  EXPECT_EQ(toString(hpack.move()),
+            std::string("\x00\x0bgrpc-status\x01" "0", 15));
+  EXPECT_EQ(size.compressed, 15);
+  EXPECT_EQ(size.uncompressed, 14);
+
+  HTTPHeaderSize qpackSize;
+  auto qpack = encodeQPACKStatusTrailers(100, "", &qpackSize);
+  EXPECT_EQ(toString(qpack),
+            std::string("\x00\x00\x27\x04grpc-status\x03" "100", 19));
+  EXPECT_EQ(qpackSize.compressed, 19);
+}
@@ -173,6 +173,39 @@ TEST_F(HQCodecTest, DataFrame) {
   EXPECT_EQ(callbacks_.bodyLength, data->length());
 }
 
+TEST_F(HQCodecTest, DataFrameZeroCopy) {
+  auto data = makeBuf(500);
+  writeFrameHeaderManual(
+      queue_, static_cast<uint64_t>(FrameType::DATA), data->length());
+  queue_.append(data->clone());
+  parse();
+  EXPECT_EQ(callbacks_.bodyLength, data->length());
+  // The body is a slice of the ingress buffer
+  EXPECT_EQ(callbacks_.data_.front()->data(), data->data());
+  EXPECT_EQ(downstreamCodec_->getIngressBodyBytesZeroCopy(), data->length());
+  EXPECT_EQ(downstreamCodec_->getIngressBodyBytesCopied(), 0);
+}
+
+TEST_F(HQCodecTest, DataFrameCopyThreshold) {
+  downstreamCodec_->setBodyCopyThreshold(100);
+  auto small = makeBuf(50);
+  auto large = makeBuf(500);
+  writeFrameHeaderManual(
+      queue_, static_cast<uint64_t>(FrameType::DATA), small->length());
+  queue_.append(small->clone());
+  writeFrameHeaderManual(
+      queue_, static_cast<uint64_t>(FrameType::DATA), large->length());
+  queue_.append(large->clone());
+  parse();
+  EXPECT_EQ(callbacks_.bodyCalls, 2);
+  auto body = callbacks_.data_.move();
+  EXPECT_NE(body->data(), small->data());
+  EXPECT_EQ(memcmp(body->data(), small->data(), small->length()), 0);
+  EXPECT_EQ(body->next()->data(), large->data());
+  EXPECT_EQ(downstreamCodec_->getIngressBodyBytesCopied(), small->length());
+  EXPECT_EQ(downstreamCodec_->getIngressBodyBytesZeroCopy(), large->length());
+}
+
 TEST_F(HQCodecTest, PriorityUpdate) {
   // SETTINGS is a must have
   writeValidFrame(queueCtrl_, FrameType::SETTINGS);
@@ -307,6 +340,34 @@ TEST_F(HQCodecTest, Trailers) {
   }
 }
 
+TEST_F(HQCodecTest, GrpcStatusTrailers) {
+  // Pre-encoded, then encoded on the fly
+  for (auto status : {"0", "42"}) {
+    HTTPMessage msg = getPostRequest(0);
+    upstreamCodec_->generateHeader(queue_, streamId_, msg, false, nullptr);
+    HTTPHeaders trailers;
+    trailers.add("grpc-status", status);
+    trailers.add("grpc-message", "ok");
+    upstreamCodec_->generateTrailers(queue_, streamId_, trailers);
+    upstreamCodec_->generateEOM(queue_, streamId_);
+    parse();
+    downstreamCodec_->onIngressEOF();
+
+    EXPECT_EQ(callbacks_.trailers, 1);
+    ASSERT_NE(nullptr, callbacks_.msg->getTrailers());
+    EXPECT_EQ(status,
+              callbacks_.msg->getTrailers()->getSingleOrEmpty("grpc-status"));
+    EXPECT_EQ("ok",
+              callbacks_.msg->getTrailers()->getSingleOrEmpty("grpc-message"));
+    EXPECT_EQ(callbacks_.messageComplete, 1);
+    EXPECT_EQ(callbacks_.streamErrors, 0);
+    EXPECT_EQ(callbacks_.sessionErrors, 0);
+    callbacks_.reset();
+    makeCodecs();
+    downstreamCodec_->setCallback(&callbacks_);
+  }
+}
+
 TEST_F(HQCodecTest, GenerateExtraHeaders) {
   HTTPMessage resp = getResponse(200, 2000);
   HTTPHeaders extraHeaders;
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+
+using namespace proxygen;
+
+/**
+ * generateHeader() of a typical response with 12 headers, into an empty
+ * queue and into one whose tail has little room left, as after body.
+ */
+
+namespace {
+
+HTTPMessage makeResponse() {
+  HTTPMessage resp;
+  resp.setHTTPVersion(1, 1);
+  resp.setStatusCode(200);
+  resp.setStatusMessage("OK");
+  auto& headers = resp.getHeaders();
+  headers.add(HTTP_HEADER_CONTENT_TYPE, "text/html; charset=utf-8");
+  headers.add(HTTP_HEADER_CONTENT_LENGTH, "12345");
+  headers.add(HTTP_HEADER_DATE, "Tue, 14 Oct 2026 10:00:00 GMT");
+  headers.add(HTTP_HEADER_CACHE_CONTROL, "private, no-cache, max-age=0");
+  headers.add(HTTP_HEADER_EXPIRES, "Sat, 01 Jan 2000 00:00:00 GMT");
+  headers.add(HTTP_HEADER_PRAGMA, "no-cache");
+  headers.add(HTTP_HEADER_VARY, "Accept-Encoding");
+  headers.add(HTTP_HEADER_CONTENT_ENCODING, "gzip");
+  headers.add(HTTP_HEADER_STRICT_TRANSPORT_SECURITY,
+              "max-age=15552000; preload");
+  headers.add(HTTP_HEADER_X_FRAME_OPTIONS, "DENY");
+  headers.add("X-Content-Type-Options", "nosniff");
+  headers.add("X-Request-Id", "6f1c0b2e9a4d4c1b8e7f3a2d5c6b7a8e");
+  return resp;
+}
+
+void generateHeader(size_t iters, size_t tailroom) {
+  HTTPMessage resp;
+  BENCHMARK_SUSPEND {
+    resp = makeResponse();
+  }
+  for (size_t i = 0; i < iters; i++) {
+    folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+    if (tailroom > 0) {
+      auto buf = folly::IOBuf::create(2000);
+      buf->append(buf->capacity() - tailroom);
+      writeBuf.append(std::move(buf));
+    }
+    auto codec = HTTP1xCodec::makeResponseCodec(true);
+    auto txn = codec.createStream();
+    codec.generateHeader(writeBuf, txn, resp);
+    folly::doNotOptimizeAway(writeBuf.chainLength());
+  }
+}
+
+} // namespace
+
+BENCHMARK(GenerateHeaderEmptyQueue, iters) {
+  generateHeader(iters, 0);
+}
+
+BENCHMARK(GenerateHeaderSmallTailroom, iters) {
+  generateHeader(iters, 32);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
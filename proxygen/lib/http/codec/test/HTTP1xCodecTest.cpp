@@ -432,6 +432,85 @@ TEST(HTTP1xCodecTest, TestGetRequestChunkedResponse) {
   ASSERT_EQ("0\r\n\r\n", bodyFromBuf->moveToFbString());
 }
 
+TEST(HTTP1xCodecTest, TestPipelinedRequestsParsedAhead) {
+  HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+  HTTP1xCodecCallback callbacks;
+  codec.setCallback(&callbacks);
+
+  // The GET is parsed before the response to the HEAD is generated
+  auto reqBuf = folly::IOBuf::copyBuffer(
+      "HEAD /www.facebook.com HTTP/1.1\nHost: www.facebook.com\n\n"
+      "GET /www.facebook.com HTTP/1.1\nHost: www.facebook.com\n\n");
+  codec.onIngress(*reqBuf);
+  EXPECT_EQ(callbacks.headersComplete, 2);
+
+  HTTPMessage resp;
+  resp.setHTTPVersion(1, 1);
+  resp.setStatusCode(200);
+  resp.setIsChunked(true);
+  resp.getHeaders().set(HTTP_HEADER_TRANSFER_ENCODING, "chunked");
+  folly::IOBufQueue respBuf(folly::IOBufQueue::cacheChainLength());
+  codec.generateHeader(respBuf, 1, resp, true);
+  auto respStr = respBuf.move()->moveToFbString();
+  EXPECT_TRUE(respStr.find("0\r\n") == string::npos);
+
+  codec.generateHeader(respBuf, 2, resp, false);
+  respBuf.move();
+  codec.generateBody(respBuf,
+                     2,
+                     folly::IOBuf::copyBuffer("Hello"),
+                     HTTPCodec::NoPadding,
+                     true);
+  EXPECT_EQ("5\r\nHello\r\n0\r\n\r\n", respBuf.move()->moveToFbString());
+}
+
+TEST(HTTP1xCodecTest, ChunkHeaderInBodyHeadroom) {
+  auto codec = HTTP1xCodec::makeResponseCodec(true);
+  HTTP1xCodecCallback callbacks;
+  codec.setCallback(&callbacks);
+  auto txnID = codec.createStream();
+  HTTPMessage resp;
+  resp.setHTTPVersion(1, 1);
+  resp.setStatusCode(200);
+  resp.setIsChunked(true);
+  resp.getHeaders().set(HTTP_HEADER_TRANSFER_ENCODING, "chunked");
+  folly::IOBufQueue respBuf(folly::IOBufQueue::cacheChainLength());
+  codec.generateHeader(respBuf, txnID, resp, false);
+  respBuf.move();
+
+  auto body = folly::IOBuf::create(64);
+  body->advance(16);
+  memcpy(body->writableTail(), "Hello", 5);
+  body->append(5);
+  const uint8_t* data = body->data();
+  codec.generateBody(respBuf, txnID, std::move(body), folly::none, false);
+  EXPECT_EQ(respBuf.front()->data(), data - 3);
+  EXPECT_EQ("5\r\nHello\r\n", respBuf.move()->moveToFbString());
+}
+
+TEST(HTTP1xCodecTest, CoalesceChunkedBody) {
+  HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+  codec.setCoalesceChunkedBody(true);
+  StrictMock<MockHTTPCodecCallback> callbacks;
+  codec.setCallback(&callbacks);
+
+  // No chunk callbacks, and the body of the three chunks at once
+  EXPECT_CALL(callbacks, onMessageBegin(1, _));
+  EXPECT_CALL(callbacks, onHeadersComplete(1, _));
+  EXPECT_CALL(callbacks, onBody(1, _, _))
+      .WillOnce(Invoke([](HTTPCodec::StreamID,
+                          std::shared_ptr<folly::IOBuf> chain,
+                          uint16_t) {
+        EXPECT_EQ(chain->moveToFbString(), "abcdefghij");
+      }));
+  EXPECT_CALL(callbacks, onMessageComplete(1, _));
+  auto buf = folly::IOBuf::copyBuffer(
+      "POST / HTTP/1.1\r\nHost: www.facebook.com\r\n"
+      "Transfer-Encoding: chunked\r\n\r\n"
+      "3\r\nabc\r\n3\r\ndef\r\n4\r\nghij\r\n0\r\n\r\n");
+  codec.onIngress(*buf);
+}
+
 unique_ptr<folly::IOBuf> getChunkedRequest1st() {
   string req("GET /aha HTTP/1.1\n");
   return folly::IOBuf::copyBuffer(req);
@@ -463,6 +542,33 @@ TEST(HTTP1xCodecTest, TestChunkedHeaders) {
   }
 }
 
+TEST(HTTP1xCodecTest, TestPipelinedHeadUpstream) {
+  HTTP1xCodec codec(TransportDirection::UPSTREAM);
+  HTTP1xCodecCallback callbacks;
+  codec.setCallback(&callbacks);
+
+  folly::IOBufQueue buf(folly::IOBufQueue::cacheChainLength());
+  HTTPMessage get;
+  get.setHTTPVersion(1, 1);
+  get.setMethod(HTTPMethod::GET);
+  get.setURL("/");
+  codec.generateHeader(buf, codec.createStream(), get, true);
+  HTTPMessage head = get;
+  head.setMethod(HTTPMethod::HEAD);
+  codec.generateHeader(buf, codec.createStream(), head, true);
+
+  // The GET's response has a body, the HEAD's only says how long it would be
+  auto responses = folly::IOBuf::copyBuffer(
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello"
+      "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n");
+  codec.onIngress(*responses);
+  EXPECT_EQ(callbacks.headersComplete, 2);
+  EXPECT_EQ(callbacks.messageComplete, 2);
+  EXPECT_EQ(callbacks.bodyLen, 5);
+  EXPECT_FALSE(codec.isBusy());
+  EXPECT_TRUE(codec.isReusable());
+}
+
 TEST(HTTP1xCodecTest, TestChunkedUpstream) {
   HTTP1xCodec codec(TransportDirection::UPSTREAM);
 
@@ -664,6 +770,55 @@ TEST(HTTP1xCodecTest, Test1xxConnectionHeader) {
       "keep-alive");
 }
 
+TEST(HTTP1xCodecTest, EarlyHints) {
+  HTTP1xCodec upstream(TransportDirection::UPSTREAM);
+  HTTP1xCodec downstream(TransportDirection::DOWNSTREAM);
+  HTTP1xCodecCallback upstreamCallbacks;
+  HTTP1xCodecCallback downstreamCallbacks;
+  upstream.setCallback(&upstreamCallbacks);
+  downstream.setCallback(&downstreamCallbacks);
+  auto req = folly::IOBuf::copyBuffer("GET / HTTP/1.1\r\nHost: a\r\n\r\n");
+  downstream.onIngress(*req);
+  EXPECT_EQ(downstreamCallbacks.headersComplete, 1);
+
+  HTTPMessage hints;
+  hints.setStatusCode(103);
+  hints.setStatusMessage("Early Hints");
+  hints.setHTTPVersion(1, 1);
+  hints.getHeaders().add(HTTP_HEADER_LINK, "</a.css>; rel=preload");
+  folly::IOBufQueue writeBuf(folly::IOBufQueue::cacheChainLength());
+  downstream.generateHeader(writeBuf, 1, hints);
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  resp.setHTTPVersion(1, 1);
+  resp.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH, "0");
+  downstream.generateHeader(writeBuf, 1, resp, true);
+  upstream.onIngress(*writeBuf.move());
+  EXPECT_EQ(upstreamCallbacks.headersComplete, 2);
+  EXPECT_EQ(upstreamCallbacks.messageComplete, 1);
+  EXPECT_EQ(upstreamCallbacks.errors, 0);
+  EXPECT_EQ(upstreamCallbacks.msg_->getStatusCode(), 200);
+}
+
+TEST(HTTP1xCodecTest, NoEarlyHintsForHTTP10) {
+  HTTP1xCodec downstream(TransportDirection::DOWNSTREAM);
+  HTTP1xCodecCallback callbacks;
+  downstream.setCallback(&callbacks);
+  auto req = folly::IOBuf::copyBuffer("GET / HTTP/1.0\r\n\r\n");
+  downstream.onIngress(*req);
+  EXPECT_EQ(callbacks.headersComplete, 1);
+
+  HTTPMessage hints;
+  hints.setStatusCode(103);
+  hints.setHTTPVersion(1, 1);
+  hints.getHeaders().add(HTTP_HEADER_LINK, "</a.css>; rel=preload");
+  folly::IOBufQueue writeBuf(folly::IOBufQueue::cacheChainLength());
+  HTTPHeaderSize size;
+  downstream.generateHeader(writeBuf, 1, hints, false, &size);
+  EXPECT_TRUE(writeBuf.empty());
+  EXPECT_EQ(size.compressed, 0);
+}
+
 TEST(HTTP1xCodecTest, TestChainedBody) {
   HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
   MockHTTPCodecCallback callbacks;
@@ -1467,6 +1622,86 @@ TEST(HTTP1xCodecTest, TrailerCtls) {
   codec.onIngress(*buffer);
 }
 
+TEST(HTTP1xCodecTest, HeaderValueAcrossIngressBuffers) {
+  string req("GET / HTTP/1.1\r\n"
+             "Host: www.facebook.com\r\n"
+             "X-Split: some value that spans many buffers\r\n"
+             "Empty:\r\n"
+             "\r\n");
+  for (int32_t atOnce : {0, 1, 3, 20}) {
+    FakeHTTPCodecCallback callbacks;
+    HTTP1xCodec codec(TransportDirection::DOWNSTREAM);
+    codec.setCallback(&callbacks);
+    parse(&codec, (const uint8_t*)req.data(), req.size(), atOnce);
+    EXPECT_EQ(callbacks.headersComplete, 1);
+    ASSERT_NE(callbacks.msg, nullptr);
+    const auto& headers = callbacks.msg->getHeaders();
+    EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_HOST), "www.facebook.com");
+    EXPECT_EQ(headers.getSingleOrEmpty("X-Split"),
+              "some value that spans many buffers");
+    EXPECT_TRUE(headers.exists("Empty"));
+    EXPECT_EQ(headers.getSingleOrEmpty("Empty"), "");
+  }
+}
+
+TEST(HTTP1xCodecTest, VectorizedParsingParity) {
+  std::vector<std::string> requests{
+      "GET /yeah HTTP/1.1\r\n"
+      "Host: www.facebook.com\r\n"
+      "X-Some-Rather-Long-Custom-Header-Name: 0123456789abcdefghijklmnopq\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) \t AppleWebKit/537.36\r\n"
+      "Quoted: \"a \\\" b\", c\r\n"
+      "Utf8: h\xc3\xa9llo w\xc3\xb6rld, this value spans several strides\r\n"
+      "Content-Length: 5\r\n"
+      "\r\n"
+      "hello",
+      "GET / HTTP/1.1\r\n"
+      "Foo: \"\\\r\\\n\"\r\n"
+      "\r\n",
+      "GET / HTTP/1.1\r\n"
+      "Bad_Header!~Name_with_lots_of_token_chars: v\r\n"
+      "Ctl: abcdefghijklmnopqrstuvwxyz\x01"
+      "abcdefghijklmnop\r\n"
+      "\r\n",
+      "GET / HTTP/1.1\r\n"
+      "Trailing-Space-In-A-Long-Header-Name : v\r\n"
+      "\r\n"};
+  for (const auto& req : requests) {
+    for (int32_t atOnce : {0, 1, 7, -1}) {
+      FakeHTTPCodecCallback scalarCallbacks;
+      FakeHTTPCodecCallback vectorCallbacks;
+      HTTP1xCodec scalar(TransportDirection::DOWNSTREAM);
+      HTTP1xCodec vector(TransportDirection::DOWNSTREAM);
+      vector.setVectorizedParsing(true);
+      scalar.setCallback(&scalarCallbacks);
+      vector.setCallback(&vectorCallbacks);
+      parse(&scalar, (const uint8_t*)req.data(), req.size(), atOnce);
+      parse(&vector, (const uint8_t*)req.data(), req.size(), atOnce);
+      EXPECT_EQ(scalarCallbacks.headersComplete,
+                vectorCallbacks.headersComplete);
+      EXPECT_EQ(scalarCallbacks.messageComplete,
+                vectorCallbacks.messageComplete);
+      EXPECT_EQ(scalarCallbacks.bodyLength, vectorCallbacks.bodyLength);
+      EXPECT_EQ(scalarCallbacks.streamErrors + scalarCallbacks.sessionErrors,
+                vectorCallbacks.streamErrors + vectorCallbacks.sessionErrors);
+      ASSERT_EQ(!!scalarCallbacks.msg, !!vectorCallbacks.msg);
+      if (scalarCallbacks.msg) {
+        std::vector<std::pair<std::string, std::string>> scalarHeaders;
+        std::vector<std::pair<std::string, std::string>> vectorHeaders;
+        scalarCallbacks.msg->getHeaders().forEach(
+            [&](const std::string& name, const std::string& value) {
+              scalarHeaders.emplace_back(name, value);
+            });
+        vectorCallbacks.msg->getHeaders().forEach(
+            [&](const std::string& name, const std::string& value) {
+              vectorHeaders.emplace_back(name, value);
+            });
+        EXPECT_EQ(scalarHeaders, vectorHeaders);
+      }
+    }
+  }
+}
+
 TEST(HTTP1xCodecTest, AbsoluteURLNoPath) {
   HTTP1xCodec codec(TransportDirection::DOWNSTREAM, true);
   HTTP1xCodecCallback callbacks;
@@ -795,6 +795,24 @@ TEST_F(HTTP2CodecTest, BasicHeaderReply) {
   EXPECT_EQ("x-coolio", headers.getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE));
 }
 
+TEST_F(HTTP2CodecTest, Origin) {
+  SetUpUpstreamTest();
+  std::vector<std::string> origins{"https://a.test", "https://b.test"};
+  http2::writeOrigin(output_, origins);
+
+  parseUpstream();
+  EXPECT_EQ(callbacks_.origins, origins);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+}
+
+TEST_F(HTTP2CodecTest, OriginIgnoredByServer) {
+  http2::writeOrigin(output_, {"https://a.test"});
+
+  parse();
+  EXPECT_TRUE(callbacks_.origins.empty());
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+}
+
 TEST_F(HTTP2CodecTest, DontDoubleDate) {
   SetUpUpstreamTest();
   upstreamCodec_.createStream();
@@ -950,6 +968,18 @@ TEST_F(HTTP2CodecTest, Cookies) {
   EXPECT_EQ(callbacks_.msg->getCookie("oatmeal-raisin"), "4");
 }
 
+TEST_F(HTTP2CodecTest, SingleCookie) {
+  HTTPMessage req = getGetRequest("/guacamole");
+  req.getHeaders().add("Cookie", "chocolate-chip=1; rainbow-chip=2");
+  auto id = upstreamCodec_.createStream();
+  upstreamCodec_.generateHeader(output_, id, req);
+
+  parse();
+  callbacks_.expectMessage(false, 2, "/guacamole");
+  EXPECT_EQ(callbacks_.msg->getHeaders().getSingleOrEmpty(HTTP_HEADER_COOKIE),
+            "chocolate-chip=1; rainbow-chip=2");
+}
+
 TEST_F(HTTP2CodecTest, BasicContinuation) {
   HTTPMessage req = getBigGetRequest();
   auto id = upstreamCodec_.createStream();
@@ -1177,6 +1207,111 @@ TEST_F(HTTP2CodecTest, LongData) {
   EXPECT_EQ(callbacks_.data_.move()->moveToFbString(), buf->moveToFbString());
 }
 
+TEST_F(HTTP2CodecTest, EgressDataFrameSize) {
+  // The peer takes frames up to 1MB
+  HTTPSettings* settings = (HTTPSettings*)upstreamCodec_.getIngressSettings();
+  settings->setSetting(SettingsId::MAX_FRAME_SIZE, 1 << 20);
+  downstreamCodec_.getEgressSettings()->setSetting(SettingsId::MAX_FRAME_SIZE,
+                                                   1 << 20);
+  auto buf = makeBuf(100000);
+  upstreamCodec_.setEgressDataFrameSize(40000);
+  upstreamCodec_.generateBody(
+      output_, 1, buf->clone(), HTTPCodec::NoPadding, false);
+  parse();
+  EXPECT_EQ(callbacks_.bodyCalls, 3);
+  EXPECT_EQ(callbacks_.bodyLength, 100000);
+
+  // Capped by the peer's limit
+  settings->setSetting(SettingsId::MAX_FRAME_SIZE, 16384);
+  upstreamCodec_.generateBody(
+      output_, 1, buf->clone(), HTTPCodec::NoPadding, true);
+  parse();
+  EXPECT_EQ(callbacks_.bodyCalls, 3 + 7);
+  EXPECT_EQ(callbacks_.bodyLength, 200000);
+  EXPECT_EQ(callbacks_.messageComplete, 1);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+}
+
+TEST(HTTP2CodecAdaptiveFrameSizeTest, AdaptiveDataFrameSize) {
+  // Unknown window
+  EXPECT_EQ(HTTP2Codec::getAdaptiveDataFrameSize(0, 1 << 20, false), 16384);
+  EXPECT_EQ(HTTP2Codec::getAdaptiveDataFrameSize(0, 1 << 20, true),
+            16384 - http2::kFrameHeaderSize);
+  // One window per frame
+  EXPECT_EQ(HTTP2Codec::getAdaptiveDataFrameSize(100000, 1 << 20, false),
+            100000);
+  EXPECT_EQ(HTTP2Codec::getAdaptiveDataFrameSize(100000, 1 << 20, true),
+            6 * 16384 - http2::kFrameHeaderSize);
+  // Up to the peer's limit
+  EXPECT_EQ(HTTP2Codec::getAdaptiveDataFrameSize(1 << 24, 1 << 20, false),
+            1 << 20);
+  EXPECT_EQ(HTTP2Codec::getAdaptiveDataFrameSize(1 << 24, 16384, true),
+            16384 - http2::kFrameHeaderSize);
+}
+
+TEST_F(HTTP2CodecTest, CoalescedData) {
+  downstreamCodec_.setCoalesceIngressData(true);
+  // Hack the max frame size artificially low
+  HTTPSettings* settings = (HTTPSettings*)upstreamCodec_.getIngressSettings();
+  settings->setSetting(SettingsId::MAX_FRAME_SIZE, 16);
+  auto buf = makeBuf(100);
+  upstreamCodec_.generateBody(output_, 1, buf->clone(), 10, true);
+
+  parse();
+  EXPECT_EQ(callbacks_.messageComplete, 1);
+  EXPECT_EQ(callbacks_.bodyCalls, 1);
+  EXPECT_EQ(callbacks_.bodyLength, 100);
+  EXPECT_EQ(callbacks_.paddingBytes, 7 * 11);
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+  EXPECT_EQ(callbacks_.data_.move()->moveToFbString(), buf->moveToFbString());
+}
+
+TEST_F(HTTP2CodecTest, CoalescedDataInterleaved) {
+  downstreamCodec_.setCoalesceIngressData(true);
+  auto buf = makeBuf(10);
+  upstreamCodec_.generateBody(
+      output_, 1, buf->clone(), HTTPCodec::NoPadding, false);
+  upstreamCodec_.generateBody(
+      output_, 3, buf->clone(), HTTPCodec::NoPadding, true);
+  upstreamCodec_.generateBody(
+      output_, 1, buf->clone(), HTTPCodec::NoPadding, false);
+  upstreamCodec_.generateBody(
+      output_, 1, buf->clone(), HTTPCodec::NoPadding, true);
+
+  parse();
+  EXPECT_EQ(callbacks_.messageComplete, 2);
+  EXPECT_EQ(callbacks_.bodyCalls, 3);
+  EXPECT_EQ(callbacks_.bodyLength, 40);
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+}
+
+TEST_F(HTTP2CodecTest, CoalescedDataPartialFrame) {
+  downstreamCodec_.setCoalesceIngressData(true);
+  auto buf = makeBuf(30);
+  for (auto i = 0; i < 3; i++) {
+    upstreamCodec_.generateBody(
+        output_, 1, buf->clone(), HTTPCodec::NoPadding, i == 2);
+  }
+  // The two whole frames and the start of the third
+  auto ingress = output_.move();
+  ingress->coalesce();
+  auto split = 2 * (http2::kFrameHeaderSize + 30) + http2::kFrameHeaderSize + 5;
+  output_.append(ingress->data(), split);
+  parse();
+  EXPECT_EQ(callbacks_.bodyCalls, 2);
+  EXPECT_EQ(callbacks_.bodyLength, 65);
+  EXPECT_EQ(callbacks_.messageComplete, 0);
+
+  output_.append(ingress->data() + split, ingress->length() - split);
+  parse();
+  EXPECT_EQ(callbacks_.bodyCalls, 3);
+  EXPECT_EQ(callbacks_.bodyLength, 90);
+  EXPECT_EQ(callbacks_.messageComplete, 1);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+}
+
 TEST_F(HTTP2CodecTest, PushPromiseContinuation) {
   auto settings = upstreamCodec_.getEgressSettings();
   settings->setSetting(SettingsId::ENABLE_PUSH, 1);
@@ -2607,6 +2742,61 @@ TEST_F(HTTP2CodecTest, TrailersReply) {
 #endif
 }
 
+TEST_F(HTTP2CodecTest, GrpcStatusTrailers) {
+  SetUpUpstreamTest();
+  upstreamCodec_.createStream();
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  resp.getHeaders().add(HTTP_HEADER_CONTENT_TYPE, "application/grpc");
+  downstreamCodec_.generateHeader(output_, 1, resp);
+
+  HTTPHeaders trailers;
+  trailers.add("grpc-status", "14");
+  trailers.add("grpc-message", "backend unavailable");
+  auto trailerSz = downstreamCodec_.generateTrailers(output_, 1, trailers);
+  // Frame header, then literal fields with literal names
+  EXPECT_EQ(trailerSz, 9 + 1 + 12 + 3 + 1 + 13 + 20);
+
+  parseUpstream();
+
+  callbacks_.expectMessage(true, 2, 200);
+  EXPECT_EQ(1, callbacks_.trailers);
+  ASSERT_NE(nullptr, callbacks_.msg->getTrailers());
+  EXPECT_EQ("14",
+            callbacks_.msg->getTrailers()->getSingleOrEmpty("grpc-status"));
+  EXPECT_EQ("backend unavailable",
+            callbacks_.msg->getTrailers()->getSingleOrEmpty("grpc-message"));
+}
+
+TEST_F(HTTP2CodecTest, EarlyHints) {
+  SetUpUpstreamTest();
+  upstreamCodec_.createStream();
+  HTTPMessage hints;
+  hints.setStatusCode(103);
+  hints.getHeaders().add(HTTP_HEADER_LINK,
+                         "</style.css>; rel=preload; as=style");
+  hints.getHeaders().add(HTTP_HEADER_LINK,
+                         "</script.js>; rel=preload; as=script");
+  HTTPHeaderSize first;
+  HTTPHeaderSize second;
+  downstreamCodec_.generateHeader(output_, 1, hints, false, &first);
+  downstreamCodec_.generateHeader(output_, 1, hints, false, &second);
+  // Indexed the first time
+  EXPECT_LT(second.compressed, first.compressed);
+
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  downstreamCodec_.generateHeader(output_, 1, resp, true);
+  parseUpstream();
+
+  EXPECT_EQ(callbacks_.headersComplete, 3);
+  EXPECT_EQ(callbacks_.messageComplete, 1);
+  EXPECT_EQ(callbacks_.trailers, 0);
+  EXPECT_EQ(callbacks_.streamErrors, 0);
+  EXPECT_EQ(callbacks_.sessionErrors, 0);
+  EXPECT_EQ(callbacks_.msg->getStatusCode(), 200);
+}
+
 TEST_F(HTTP2CodecTest, TrailersReplyEmpty) {
   SetUpUpstreamTest();
   upstreamCodec_.createStream();
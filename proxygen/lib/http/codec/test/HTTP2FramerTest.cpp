@@ -194,6 +194,41 @@ TEST_F(HTTP2FramerTest, UseHeadroomOptimization) {
   EXPECT_LT(queueNode->headroom(), headRoomSize);
 }
 
+TEST_F(HTTP2FramerTest, BatchedEgress) {
+  queue_.move();
+  // small bodies are packed with their frame headers into one buffer
+  auto small = makeBuf(100);
+  for (uint32_t stream = 1; stream <= 9; stream += 2) {
+    writeData(queue_, small->clone(), stream, kNoPadding, false, true, true);
+  }
+  EXPECT_FALSE(queue_.front()->isChained());
+  EXPECT_EQ(queue_.chainLength(), 5 * (kFrameHeaderSize + 100));
+
+  // a large body is chained without copying, and the next frame header
+  // lands in a fresh buffer
+  auto large = makeBuf(kMaxFramePayloadLength);
+  large->markExternallySharedOne();
+  auto largeData = large->data();
+  writeData(queue_, std::move(large), 11, kNoPadding, false, true, true);
+  writeData(queue_, small->clone(), 13, kNoPadding, true, true, true);
+  EXPECT_EQ(queue_.front()->countChainElements(), 3);
+  EXPECT_EQ(queue_.front()->next()->data(), largeData);
+
+  Cursor cursor(queue_.front());
+  for (uint32_t stream = 1; stream <= 13; stream += 2) {
+    FrameHeader outHeader;
+    std::unique_ptr<IOBuf> outBuf;
+    uint16_t padding = 0;
+    ASSERT_EQ(parseFrameHeader(cursor, outHeader), ErrorCode::NO_ERROR);
+    ASSERT_EQ(parseData(cursor, outHeader, outBuf, padding),
+              ErrorCode::NO_ERROR);
+    EXPECT_EQ(outHeader.stream, stream);
+    EXPECT_EQ(outBuf->computeChainDataLength(),
+              stream == 11 ? kMaxFramePayloadLength : 100);
+  }
+  EXPECT_TRUE(cursor.isAtEnd());
+}
+
 TEST_F(HTTP2FramerTest, BadStreamId) {
   // We should crash on DBG builds if the stream id > 2^31 - 1
   EXPECT_DEATH_NO_CORE(writeRstStream(queue_,
@@ -559,6 +594,35 @@ TEST_F(HTTP2FramerTest, Uint32MaxWindowUpdate) {
   EXPECT_EQ(uint31Max, amount);
 }
 
+TEST_F(HTTP2FramerTest, Origin) {
+  std::vector<string> origins{"https://a.test", "https://b.test:8443"};
+  writeOrigin(queue_, origins);
+
+  FrameHeader header;
+  std::vector<string> outOrigins;
+  parse(&parseOrigin, header, outOrigins);
+
+  ASSERT_EQ(FrameType::ORIGIN, header.type);
+  ASSERT_EQ(0, header.stream);
+  EXPECT_EQ(origins, outOrigins);
+}
+
+TEST_F(HTTP2FramerTest, ShortOrigin) {
+  // origin length past the end of the frame
+  writeFrameHeaderManual(
+      queue_, 4, static_cast<uint8_t>(FrameType::ORIGIN), 0, 0);
+  QueueAppender appender(&queue_, 4);
+  appender.writeBE<uint16_t>(3);
+  appender.writeBE<uint16_t>(0);
+
+  Cursor cursor(queue_.front());
+  FrameHeader header;
+  std::vector<string> outOrigins;
+  parseFrameHeader(cursor, header);
+  auto ret = parseOrigin(cursor, header, outOrigins);
+  ASSERT_EQ(ErrorCode::FRAME_SIZE_ERROR, ret);
+}
+
 TEST_F(HTTP2FramerTest, AltSvc) {
   string protocol = "special-proto";
   string host = "special-host";
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <proxygen/lib/http/codec/HTTPBinaryCodec.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+
+using namespace proxygen;
+
+/**
+ * Encoding and decoding a request with a body and trailers in the binary
+ * HTTP known-length and indeterminate-length forms, as an OHTTP gateway
+ * does per message.
+ */
+
+namespace {
+
+HTTPMessage makeRequest() {
+  HTTPMessage msg;
+  msg.setMethod("POST");
+  msg.setSecure(true);
+  msg.setURL("/api/graphql?query=id");
+  auto& headers = msg.getHeaders();
+  headers.set("host", "www.example.com");
+  headers.set("user-agent",
+              "curl/7.16.3 libcurl/7.16.3 OpenSSL/0.9.7l zlib/1.2.3");
+  headers.set("accept-language", "en, mi");
+  headers.set("content-type", "application/x-www-form-urlencoded");
+  headers.set("x-request-correlation-id", "0123456789abcdef0123456789abcdef");
+  return msg;
+}
+
+std::unique_ptr<folly::IOBuf> encode(bool indeterminate, size_t bodyChunks) {
+  HTTPBinaryCodec codec(TransportDirection::DOWNSTREAM);
+  codec.setEgressIndeterminateLength(indeterminate);
+  folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+  codec.generateHeader(writeBuf, 0, makeRequest());
+  // A known-length message carries a single content section
+  const std::string chunk(1024, 'a');
+  if (indeterminate) {
+    for (size_t i = 0; i < bodyChunks; i++) {
+      codec.generateBody(writeBuf, 0, folly::IOBuf::copyBuffer(chunk));
+    }
+  } else {
+    std::string body;
+    for (size_t i = 0; i < bodyChunks; i++) {
+      body += chunk;
+    }
+    codec.generateBody(writeBuf, 0, folly::IOBuf::copyBuffer(body));
+  }
+  HTTPHeaders trailers;
+  trailers.set("x-checksum", "deadbeef");
+  codec.generateTrailers(writeBuf, 0, trailers);
+  codec.generateEOM(writeBuf, 0);
+  return writeBuf.move();
+}
+
+void decode(size_t iters, bool indeterminate) {
+  std::unique_ptr<folly::IOBuf> encoded;
+  BENCHMARK_SUSPEND {
+    encoded = encode(indeterminate, 4);
+  }
+  for (size_t i = 0; i < iters; i++) {
+    HTTPBinaryCodec codec(TransportDirection::DOWNSTREAM);
+    FakeHTTPCodecCallback callback;
+    codec.setCallback(&callback);
+    codec.onIngress(*encoded);
+    codec.onIngressEOF();
+    CHECK(!callback.lastParseError);
+    folly::doNotOptimizeAway(callback.msg);
+  }
+}
+
+void generate(size_t iters, bool indeterminate) {
+  for (size_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(encode(indeterminate, 4));
+  }
+}
+
+} // namespace
+
+BENCHMARK(DecodeKnownLength, iters) {
+  decode(iters, false);
+}
+
+BENCHMARK_RELATIVE(DecodeIndeterminateLength, iters) {
+  decode(iters, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(EncodeKnownLength, iters) {
+  generate(iters, false);
+}
+
+BENCHMARK_RELATIVE(EncodeIndeterminateLength, iters) {
+  generate(iters, true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -94,8 +94,8 @@ TEST_F(HTTPBinaryCodecTest, testParseFramingIndicatorSuccess) {
 
   EXPECT_EQ(downstreamBinaryCodec_
                 ->parseFramingIndicator(cursor, request, knownLength)
-                .error(),
-            "Unsupported indeterminate length Binary HTTP Request");
+                .value(),
+            1);
   EXPECT_EQ(request, false);
   EXPECT_EQ(knownLength, false);
 }
@@ -608,4 +608,116 @@ TEST_F(HTTPBinaryCodecTest, testEncodeAndDecodeRequest) {
             "test-trailer-value");
 }
 
+TEST_F(HTTPBinaryCodecTest, testOnIngressIndeterminateLength) {
+  // Format is `..GET.https.www.example.com./hello.txt.host.www.example.com.
+  // ..hello.world..trailer.done.` where the zero lengths end the field
+  // sections and the content, which comes as two chunks
+  const std::vector<uint8_t> binaryHTTPMessage{
+      0x02, 0x03, 0x47, 0x45, 0x54, 0x05, 0x68, 0x74, 0x74, 0x70, 0x73, 0x0f,
+      0x77, 0x77, 0x77, 0x2e, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x2e,
+      0x63, 0x6f, 0x6d, 0x0a, 0x2f, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x2e, 0x74,
+      0x78, 0x74, 0x04, 0x68, 0x6f, 0x73, 0x74, 0x0f, 0x77, 0x77, 0x77, 0x2e,
+      0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x2e, 0x63, 0x6f, 0x6d, 0x00,
+      0x05, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x05, 0x77, 0x6f, 0x72, 0x6c, 0x64,
+      0x00, 0x07, 0x74, 0x72, 0x61, 0x69, 0x6c, 0x65, 0x72, 0x04, 0x64, 0x6f,
+      0x6e, 0x65, 0x00};
+  auto binaryHTTPMessageIOBuf = folly::IOBuf::wrapBuffer(
+      folly::ByteRange(binaryHTTPMessage.data(), binaryHTTPMessage.size()));
+
+  FakeHTTPCodecCallback callback;
+  downstreamBinaryCodec_->setCallback(&callback);
+  downstreamBinaryCodec_->onIngress(*binaryHTTPMessageIOBuf);
+  downstreamBinaryCodec_->onIngressEOF();
+
+  EXPECT_EQ(callback.lastParseError, nullptr);
+  EXPECT_EQ(callback.msg->getMethod(), proxygen::HTTPMethod::GET);
+  EXPECT_EQ(callback.msg->getURL(), "/hello.txt");
+  EXPECT_EQ(callback.msg->getHeaders().getSingleOrEmpty("host"),
+            "www.example.com");
+  EXPECT_EQ(callback.data_.move()->moveToFbString().toStdString(),
+            "helloworld");
+  EXPECT_EQ(callback.msg->getTrailers()->getSingleOrEmpty("trailer"), "done");
+}
+
+TEST_F(HTTPBinaryCodecTest, testOnIngressIndeterminateLengthUnterminated) {
+  // Format is `..GET.https.www.example.com./hello.txt.host.www.example.com`
+  // missing the Content Terminator of the field section
+  const std::vector<uint8_t> binaryHTTPMessage{
+      0x02, 0x03, 0x47, 0x45, 0x54, 0x05, 0x68, 0x74, 0x74, 0x70, 0x73, 0x0f,
+      0x77, 0x77, 0x77, 0x2e, 0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x2e,
+      0x63, 0x6f, 0x6d, 0x0a, 0x2f, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x2e, 0x74,
+      0x78, 0x74, 0x04, 0x68, 0x6f, 0x73, 0x74, 0x0f, 0x77, 0x77, 0x77, 0x2e,
+      0x65, 0x78, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x2e, 0x63, 0x6f, 0x6d};
+  auto binaryHTTPMessageIOBuf = folly::IOBuf::wrapBuffer(
+      folly::ByteRange(binaryHTTPMessage.data(), binaryHTTPMessage.size()));
+
+  FakeHTTPCodecCallback callback;
+  downstreamBinaryCodec_->setCallback(&callback);
+  downstreamBinaryCodec_->onIngress(*binaryHTTPMessageIOBuf);
+  downstreamBinaryCodec_->onIngressEOF();
+
+  EXPECT_EQ(std::string(callback.lastParseError.get()->what()),
+            "Invalid Message: Failure to parse: headerName length");
+}
+
+TEST_F(HTTPBinaryCodecTest, testEncodeAndDecodeIndeterminateLength) {
+  folly::IOBufQueue writeBuffer;
+  downstreamBinaryCodec_->setEgressIndeterminateLength(true);
+
+  HTTPMessage msgEncoded;
+  msgEncoded.setMethod("POST");
+  msgEncoded.setSecure(true);
+  msgEncoded.setURL("/hello.txt");
+  msgEncoded.getHeaders().set("host", "www.example.com");
+  downstreamBinaryCodec_->generateHeader(writeBuffer, 0, msgEncoded);
+
+  // Each body becomes its own chunk, and empty ones are dropped
+  downstreamBinaryCodec_->generateBody(
+      writeBuffer, 0, folly::IOBuf::copyBuffer("Sample "));
+  downstreamBinaryCodec_->generateBody(writeBuffer, 0, folly::IOBuf::create(0));
+  downstreamBinaryCodec_->generateBody(
+      writeBuffer, 0, folly::IOBuf::copyBuffer("Test Body!"));
+  HTTPHeaders trailers;
+  trailers.set("test-trailer", "test-trailer-value");
+  downstreamBinaryCodec_->generateTrailers(writeBuffer, 0, trailers);
+  EXPECT_EQ(downstreamBinaryCodec_->generateEOM(writeBuffer, 0), 0);
+
+  FakeHTTPCodecCallback callback;
+  downstreamBinaryCodec_->setCallback(&callback);
+  downstreamBinaryCodec_->onIngress(*writeBuffer.front());
+  downstreamBinaryCodec_->onIngressEOF();
+
+  EXPECT_EQ(callback.lastParseError, nullptr);
+  EXPECT_EQ(callback.msg->getMethod(), msgEncoded.getMethod());
+  EXPECT_EQ(callback.msg->getURL(), msgEncoded.getURL());
+  EXPECT_EQ(callback.msg->getHeaders().getSingleOrEmpty("host"),
+            "www.example.com");
+  EXPECT_EQ(callback.data_.move()->moveToFbString().toStdString(),
+            "Sample Test Body!");
+  EXPECT_EQ(callback.msg->getTrailers()->getSingleOrEmpty("test-trailer"),
+            "test-trailer-value");
+}
+
+TEST_F(HTTPBinaryCodecTest, testGenerateEOMIndeterminateLength) {
+  folly::IOBufQueue writeBuffer;
+  downstreamBinaryCodec_->setEgressIndeterminateLength(true);
+
+  HTTPMessage msgEncoded;
+  msgEncoded.setMethod("GET");
+  msgEncoded.setSecure(true);
+  msgEncoded.setURL("/");
+  msgEncoded.getHeaders().set("host", "www.example.com");
+  downstreamBinaryCodec_->generateHeader(
+      writeBuffer, 0, msgEncoded, true /* eom */);
+
+  FakeHTTPCodecCallback callback;
+  downstreamBinaryCodec_->setCallback(&callback);
+  downstreamBinaryCodec_->onIngress(*writeBuffer.front());
+  downstreamBinaryCodec_->onIngressEOF();
+
+  EXPECT_EQ(callback.lastParseError, nullptr);
+  EXPECT_EQ(callback.msg->getURL(), "/");
+  EXPECT_EQ(callback.messageComplete, 1);
+}
+
 } // namespace proxygen::test
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cstring>
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/io/IOBufQueue.h>
+#include <glog/logging.h>
+#include <limits>
+#include <proxygen/lib/http/codec/HQStreamCodec.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/codec/compress/QPACKCodec.h>
+#include <vector>
+
+using namespace proxygen;
+
+/**
+ * Request parsing (onIngress() of a downstream codec) and generation (the
+ * generate*() calls of an upstream codec) of HTTP/1.1, HTTP/2 and HQ, one
+ * iteration per message, for:
+ *
+ *   SmallGet       a GET with a few headers
+ *   LargePost      a POST of one 64KB body
+ *   HeaderHeavy    a browser GET with 20 headers and a 1.5KB cookie
+ *   Chunked        a POST of 16 4KB chunks, chunked in HTTP/1.1
+ *   ManySmallData  a POST of 256 64 byte bodies, DATA frames in HTTP/2 and HQ
+ *
+ * The HTTP/1.1 and HTTP/2 codecs carry kBatch messages per connection,
+ * their setup included in the measurement.  HQ has a stream codec per
+ * message, the QPACK codecs being per connection.  wire_B is the encoded
+ * size of a message.
+ */
+
+namespace {
+
+constexpr size_t kBatch = 32;
+
+enum class Protocol { HTTP1, HTTP2, HQ };
+
+struct Corpus {
+  const char* name;
+  HTTPMessage msg;
+  std::vector<std::unique_ptr<folly::IOBuf>> chunks;
+};
+
+HTTPMessage makeRequest(HTTPMethod method, const std::string& url) {
+  HTTPMessage req;
+  req.setMethod(method);
+  req.setURL(url);
+  req.setHTTPVersion(1, 1);
+  req.setSecure(true);
+  auto& headers = req.getHeaders();
+  headers.add(HTTP_HEADER_HOST, "www.example.com");
+  headers.add(HTTP_HEADER_USER_AGENT, "proxygen-benchmark/1.0");
+  headers.add(HTTP_HEADER_ACCEPT, "*/*");
+  return req;
+}
+
+std::unique_ptr<folly::IOBuf> makeBody(size_t size) {
+  auto buf = folly::IOBuf::create(size);
+  memset(buf->writableData(), 'a', size);
+  buf->append(size);
+  return buf;
+}
+
+// HTTP/2 and HQ drop the Transfer-Encoding of a chunked one
+Corpus makePost(const char* name,
+                size_t numChunks,
+                size_t chunkSize,
+                bool chunked = false) {
+  Corpus corpus{name, makeRequest(HTTPMethod::POST, "/upload"), {}};
+  if (chunked) {
+    corpus.msg.setIsChunked(true);
+    corpus.msg.getHeaders().add(HTTP_HEADER_TRANSFER_ENCODING, "chunked");
+  } else {
+    corpus.msg.getHeaders().add(HTTP_HEADER_CONTENT_LENGTH,
+                                folly::to<std::string>(numChunks * chunkSize));
+  }
+  corpus.msg.getHeaders().add(HTTP_HEADER_CONTENT_TYPE,
+                              "application/octet-stream");
+  for (size_t i = 0; i < numChunks; i++) {
+    corpus.chunks.push_back(makeBody(chunkSize));
+  }
+  return corpus;
+}
+
+Corpus makeHeaderHeavy() {
+  Corpus corpus{
+      "HeaderHeavy",
+      makeRequest(HTTPMethod::GET, "/feed/story?id=1234567890&ref=bookmarks"),
+      {}};
+  auto& headers = corpus.msg.getHeaders();
+  headers.set(HTTP_HEADER_USER_AGENT,
+              "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+              "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36");
+  headers.set(HTTP_HEADER_ACCEPT,
+              "text/html,application/xhtml+xml,application/xml;q=0.9,"
+              "image/avif,image/webp,*/*;q=0.8");
+  headers.add(HTTP_HEADER_ACCEPT_ENCODING, "gzip, deflate, br, zstd");
+  headers.add(HTTP_HEADER_ACCEPT_LANGUAGE, "en-US,en;q=0.9,fr;q=0.8");
+  headers.add(HTTP_HEADER_CACHE_CONTROL, "max-age=0");
+  headers.add(HTTP_HEADER_REFERER, "https://www.example.com/home");
+  headers.add("Upgrade-Insecure-Requests", "1");
+  headers.add("Sec-Ch-Ua", "\"Chromium\";v=\"120\", \"Not?A_Brand\";v=\"8\"");
+  headers.add("Sec-Ch-Ua-Mobile", "?0");
+  headers.add("Sec-Ch-Ua-Platform", "\"Linux\"");
+  headers.add("Sec-Fetch-Dest", "document");
+  headers.add("Sec-Fetch-Mode", "navigate");
+  headers.add("Sec-Fetch-Site", "same-origin");
+  headers.add("Sec-Fetch-User", "?1");
+  headers.add("Dnt", "1");
+  headers.add("Priority", "u=0, i");
+  headers.add("X-Requested-With", "XMLHttpRequest");
+  std::string cookie;
+  for (size_t i = 0; cookie.size() < 1500; i++) {
+    folly::toAppend(i == 0 ? "" : "; ",
+                    "c",
+                    i,
+                    "=",
+                    std::string(40, 'a' + i % 26),
+                    &cookie);
+  }
+  headers.add(HTTP_HEADER_COOKIE, cookie);
+  return corpus;
+}
+
+std::vector<Corpus> makeCorpora() {
+  std::vector<Corpus> corpora;
+  corpora.push_back({"SmallGet", makeRequest(HTTPMethod::GET, "/"), {}});
+  corpora.push_back(makePost("LargePost", 1, 64 * 1024));
+  corpora.push_back(makeHeaderHeavy());
+  corpora.push_back(makePost("Chunked", 16, 4096, true));
+  corpora.push_back(makePost("ManySmallData", 256, 64));
+  return corpora;
+}
+
+// Counts the parsed messages, failing on any error
+class CountingCallback : public HTTPCodec::Callback {
+ public:
+  void onMessageBegin(HTTPCodec::StreamID, HTTPMessage*) override {
+  }
+  void onHeadersComplete(HTTPCodec::StreamID,
+                         std::unique_ptr<HTTPMessage> msg) override {
+    folly::doNotOptimizeAway(msg.get());
+  }
+  void onBody(HTTPCodec::StreamID,
+              std::unique_ptr<folly::IOBuf> chain,
+              uint16_t) override {
+    bodyBytes += chain->computeChainDataLength();
+  }
+  void onTrailersComplete(HTTPCodec::StreamID,
+                          std::unique_ptr<HTTPHeaders>) override {
+  }
+  void onMessageComplete(HTTPCodec::StreamID, bool) override {
+    messages++;
+  }
+  void onError(HTTPCodec::StreamID,
+               const HTTPException& error,
+               bool) override {
+    LOG(FATAL) << "Parse error: " << error.what();
+  }
+
+  uint64_t messages{0};
+  uint64_t bodyBytes{0};
+};
+
+// One side of a connection, handing out the codec of each message
+class Endpoint {
+ public:
+  Endpoint(Protocol protocol,
+           TransportDirection direction,
+           HTTPCodec::Callback* callback = nullptr)
+      : protocol_(protocol), direction_(direction), callback_(callback) {
+  }
+
+  // Starts a new connection, returning the preface an upstream HTTP/2 codec
+  // writes
+  std::unique_ptr<folly::IOBuf> reset() {
+    folly::IOBufQueue preface{folly::IOBufQueue::cacheChainLength()};
+    switch (protocol_) {
+      case Protocol::HTTP1:
+        codec_ = std::make_unique<HTTP1xCodec>(direction_);
+        break;
+      case Protocol::HTTP2:
+        codec_ = std::make_unique<HTTP2Codec>(direction_);
+        if (direction_ == TransportDirection::UPSTREAM) {
+          codec_->generateConnectionPreface(preface);
+          codec_->generateSettings(preface);
+        }
+        break;
+      case Protocol::HQ:
+        codec_.reset();
+        qpack_ = std::make_unique<QPACKCodec>();
+        nextStreamId_ = 0;
+        break;
+    }
+    if (codec_ && callback_) {
+      codec_->setCallback(callback_);
+    }
+    return preface.move();
+  }
+
+  // The codec of the next message
+  HTTPCodec& nextMessage() {
+    if (protocol_ != Protocol::HQ) {
+      return *codec_;
+    }
+    // Nothing reads the QPACK streams
+    encoderWriteBuf_.move();
+    decoderWriteBuf_.move();
+    codec_ = std::make_unique<hq::HQStreamCodec>(
+        nextStreamId_,
+        direction_,
+        *qpack_,
+        encoderWriteBuf_,
+        decoderWriteBuf_,
+        [] { return std::numeric_limits<uint64_t>::max(); },
+        settings_);
+    nextStreamId_ += 4;
+    if (callback_) {
+      codec_->setCallback(callback_);
+    }
+    return *codec_;
+  }
+
+ private:
+  Protocol protocol_;
+  TransportDirection direction_;
+  HTTPCodec::Callback* callback_;
+  std::unique_ptr<HTTPCodec> codec_;
+  std::unique_ptr<QPACKCodec> qpack_;
+  folly::IOBufQueue encoderWriteBuf_{folly::IOBufQueue::cacheChainLength()};
+  folly::IOBufQueue decoderWriteBuf_{folly::IOBufQueue::cacheChainLength()};
+  HTTPSettings settings_;
+  quic::StreamId nextStreamId_{0};
+};
+
+void generateMessage(HTTPCodec& codec,
+                     folly::IOBufQueue& writeBuf,
+                     const Corpus& corpus) {
+  auto id = codec.createStream();
+  bool chunked = corpus.msg.getIsChunked();
+  codec.generateHeader(writeBuf, id, corpus.msg, corpus.chunks.empty());
+  for (const auto& chunk : corpus.chunks) {
+    if (chunked) {
+      codec.generateChunkHeader(writeBuf, id, chunk->length());
+    }
+    codec.generateBody(
+        writeBuf, id, chunk->clone(), HTTPCodec::NoPadding, false);
+    if (chunked) {
+      codec.generateChunkTerminator(writeBuf, id);
+    }
+  }
+  if (!corpus.chunks.empty()) {
+    codec.generateEOM(writeBuf, id);
+  }
+}
+
+void parse(folly::UserCounters& counters,
+           unsigned iters,
+           Protocol protocol,
+           const Corpus& corpus) {
+  CountingCallback callback;
+  Endpoint server(protocol, TransportDirection::DOWNSTREAM, &callback);
+  std::unique_ptr<folly::IOBuf> preface;
+  std::vector<std::unique_ptr<folly::IOBuf>> messages;
+  BENCHMARK_SUSPEND {
+    Endpoint client(protocol, TransportDirection::UPSTREAM);
+    preface = client.reset();
+    folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+    for (size_t i = 0; i < kBatch; i++) {
+      generateMessage(client.nextMessage(), writeBuf, corpus);
+      messages.push_back(writeBuf.move());
+    }
+    counters["wire_B"] = messages.back()->computeChainDataLength();
+  }
+  for (unsigned i = 0; i < iters; i++) {
+    auto index = i % kBatch;
+    if (index == 0) {
+      server.reset();
+      if (preface) {
+        server.nextMessage().onIngress(*preface);
+      }
+    }
+    auto& codec = server.nextMessage();
+    codec.onIngress(*messages[index]);
+    if (protocol == Protocol::HQ) {
+      codec.onIngressEOF();
+    }
+  }
+  BENCHMARK_SUSPEND {
+    CHECK_EQ(callback.messages, iters);
+  }
+}
+
+void generate(folly::UserCounters& counters,
+              unsigned iters,
+              Protocol protocol,
+              const Corpus& corpus) {
+  Endpoint client(protocol, TransportDirection::UPSTREAM);
+  folly::IOBufQueue writeBuf{folly::IOBufQueue::cacheChainLength()};
+  uint64_t wireBytes = 0;
+  for (unsigned i = 0; i < iters; i++) {
+    if (i % kBatch == 0) {
+      client.reset();
+    }
+    generateMessage(client.nextMessage(), writeBuf, corpus);
+    wireBytes = writeBuf.chainLength();
+    writeBuf.move();
+  }
+  counters["wire_B"] = wireBytes;
+}
+
+const char* getProtocolName(Protocol protocol) {
+  switch (protocol) {
+    case Protocol::HTTP1:
+      return "HTTP1";
+    case Protocol::HTTP2:
+      return "HTTP2";
+    case Protocol::HQ:
+      return "HQ";
+  }
+  return "";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  // Registered benchmarks hold on to them
+  static const auto corpora = makeCorpora();
+  for (const auto& corpus : corpora) {
+    for (auto protocol : {Protocol::HTTP1, Protocol::HTTP2, Protocol::HQ}) {
+      auto name =
+          folly::to<std::string>(corpus.name, getProtocolName(protocol));
+      folly::addBenchmark(
+          __FILE__,
+          "Parse" + name,
+          [&corpus, protocol](folly::UserCounters& counters, unsigned iters) {
+            parse(counters, iters, protocol, corpus);
+            return iters;
+          });
+      folly::addBenchmark(
+          __FILE__,
+          "Generate" + name,
+          [&corpus, protocol](folly::UserCounters& counters, unsigned iters) {
+            generate(counters, iters, protocol, corpus);
+            return iters;
+          });
+    }
+  }
+  folly::runBenchmarks();
+  return 0;
+}
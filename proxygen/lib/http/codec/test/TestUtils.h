@@ -249,6 +249,10 @@ class FakeHTTPCodecCallback : public HTTPCodec::Callback {
     settingsAcks++;
   }
 
+  void onOrigin(const std::vector<std::string>& originSet) override {
+    origins.insert(origins.end(), originSet.begin(), originSet.end());
+  }
+
   void onCertificateRequest(
       uint16_t requestId, std::unique_ptr<folly::IOBuf> authRequest) override {
     certificateRequests++;
@@ -348,6 +352,7 @@ class FakeHTTPCodecCallback : public HTTPCodec::Callback {
     settings = 0;
     numSettings = 0;
     settingsAcks = 0;
+    origins.clear();
     certificateRequests = 0;
     lastCertRequestId = 0;
     certificates = 0;
@@ -427,6 +432,7 @@ class FakeHTTPCodecCallback : public HTTPCodec::Callback {
   uint32_t settings{0};
   uint64_t numSettings{0};
   uint32_t settingsAcks{0};
+  std::vector<std::string> origins;
   uint32_t certificateRequests{0};
   uint16_t lastCertRequestId{0};
   uint32_t certificates{0};
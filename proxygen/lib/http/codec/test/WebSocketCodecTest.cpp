@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/Cursor.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/codec/WebSocketCodec.h>
+
+using namespace proxygen;
+using folly::IOBuf;
+using OpCode = WebSocketCodec::OpCode;
+
+namespace {
+
+class TestCallback : public WebSocketCodec::Callback {
+ public:
+  void onMessageData(OpCode opcode,
+                     std::unique_ptr<IOBuf> data,
+                     bool fin) override {
+    opcodes.push_back(opcode);
+    current += data->moveToFbString().toStdString();
+    if (fin) {
+      messages.push_back(std::move(current));
+      current.clear();
+    }
+  }
+  void onPing(std::unique_ptr<IOBuf> payload) override {
+    pings.push_back(payload->moveToFbString().toStdString());
+  }
+  void onPong(std::unique_ptr<IOBuf> payload) override {
+    pongs.push_back(payload->moveToFbString().toStdString());
+  }
+  void onClose(uint16_t code, std::string reason) override {
+    closeCode = code;
+    closeReason = std::move(reason);
+  }
+  void onError(uint16_t code, const std::string&) override {
+    errorCode = code;
+  }
+
+  std::vector<OpCode> opcodes;
+  std::string current;
+  std::vector<std::string> messages;
+  std::vector<std::string> pings;
+  std::vector<std::string> pongs;
+  uint16_t closeCode{0};
+  std::string closeReason;
+  uint16_t errorCode{0};
+};
+
+class WebSocketCodecTest : public testing::Test {
+ public:
+  void SetUp() override {
+    init(WebSocketCodec::Options());
+  }
+
+  void init(WebSocketCodec::Options options) {
+    client_ = std::make_unique<WebSocketCodec>(TransportDirection::UPSTREAM,
+                                               options);
+    server_ = std::make_unique<WebSocketCodec>(TransportDirection::DOWNSTREAM,
+                                               options);
+    server_->setCallback(&serverCb_);
+    client_->setCallback(&clientCb_);
+  }
+
+  // Delivers the client's egress to the server a byte at a time
+  void toServerBytewise() {
+    auto buf = output_.move();
+    folly::io::Cursor cursor(buf.get());
+    while (!cursor.isAtEnd()) {
+      server_->onIngress(IOBuf::copyBuffer(cursor.data(), 1));
+      cursor.skip(1);
+    }
+  }
+
+ protected:
+  folly::IOBufQueue output_{folly::IOBufQueue::cacheChainLength()};
+  std::unique_ptr<WebSocketCodec> client_;
+  std::unique_ptr<WebSocketCodec> server_;
+  TestCallback serverCb_;
+  TestCallback clientCb_;
+};
+
+} // namespace
+
+TEST(WebSocketMaskTest, OffsetsAndTails) {
+  std::array<uint8_t, 4> key{1, 2, 3, 4};
+  std::vector<uint8_t> data(37, 0);
+  WebSocketCodec::mask(data.data(), data.size(), key);
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_EQ(data[i], key[i % 4]);
+  }
+  // Masking in two pieces, the second not starting on a key boundary
+  std::vector<uint8_t> split(37, 0);
+  WebSocketCodec::mask(split.data(), 13, key);
+  WebSocketCodec::mask(split.data() + 13, 24, key, 13);
+  EXPECT_EQ(split, data);
+}
+
+TEST_F(WebSocketCodecTest, RoundTrip) {
+  client_->generateMessage(output_, OpCode::TEXT, IOBuf::copyBuffer("hello"));
+  // Masked on the wire
+  auto wire = output_.front()->cloneCoalescedAsValue();
+  EXPECT_EQ(wire.data()[0], 0x81);
+  EXPECT_EQ(wire.data()[1], 0x80 | 5);
+  server_->onIngress(output_.move());
+  ASSERT_EQ(serverCb_.messages.size(), 1);
+  EXPECT_EQ(serverCb_.messages[0], "hello");
+  EXPECT_EQ(serverCb_.opcodes[0], OpCode::TEXT);
+
+  std::string big(70000, 'x');
+  server_->generateMessage(output_, OpCode::BINARY, IOBuf::copyBuffer(big));
+  client_->onIngress(output_.move());
+  ASSERT_EQ(clientCb_.messages.size(), 1);
+  EXPECT_EQ(clientCb_.messages[0], big);
+  EXPECT_EQ(clientCb_.errorCode, 0);
+}
+
+TEST_F(WebSocketCodecTest, FragmentsWithPing) {
+  client_->generateFragment(
+      output_, OpCode::BINARY, IOBuf::copyBuffer("abc"), false);
+  EXPECT_TRUE(client_->isEgressMessageInProgress());
+  client_->generatePing(output_, IOBuf::copyBuffer("p"));
+  client_->generateFragment(
+      output_, OpCode::BINARY, IOBuf::copyBuffer("def"), true);
+  EXPECT_FALSE(client_->isEgressMessageInProgress());
+  client_->generateClose(output_, WebSocketCodec::kCloseNormal, "bye");
+  toServerBytewise();
+  ASSERT_EQ(serverCb_.messages.size(), 1);
+  EXPECT_EQ(serverCb_.messages[0], "abcdef");
+  for (auto opcode : serverCb_.opcodes) {
+    EXPECT_EQ(opcode, OpCode::BINARY);
+  }
+  EXPECT_EQ(serverCb_.pings, std::vector<std::string>{"p"});
+  EXPECT_EQ(serverCb_.closeCode, WebSocketCodec::kCloseNormal);
+  EXPECT_EQ(serverCb_.closeReason, "bye");
+}
+
+TEST_F(WebSocketCodecTest, Deflate) {
+  WebSocketCodec::Options options;
+  options.deflate = true;
+  options.clientNoContextTakeover = true;
+  options.maxFrameSize = 100;
+  init(options);
+  std::string text;
+  for (int i = 0; i < 200; ++i) {
+    text += "repetitive ";
+  }
+  for (int i = 0; i < 3; ++i) {
+    client_->generateMessage(output_, OpCode::TEXT, IOBuf::copyBuffer(text));
+    // Compressed on the wire, with RSV1 set
+    EXPECT_LT(output_.chainLength(), text.size());
+    EXPECT_EQ(output_.front()->data()[0] & 0x40, 0x40);
+    server_->onIngress(output_.move());
+    server_->generateMessage(output_, OpCode::TEXT, IOBuf::copyBuffer(text));
+    client_->onIngress(output_.move());
+  }
+  ASSERT_EQ(serverCb_.messages.size(), 3);
+  ASSERT_EQ(clientCb_.messages.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(serverCb_.messages[i], text);
+    EXPECT_EQ(clientCb_.messages[i], text);
+  }
+  EXPECT_EQ(serverCb_.errorCode, 0);
+  EXPECT_EQ(clientCb_.errorCode, 0);
+}
+
+TEST_F(WebSocketCodecTest, DeflateContextTakeover) {
+  WebSocketCodec::Options options;
+  options.deflate = true;
+  init(options);
+  std::string text = "the same message, twice over";
+  for (int i = 0; i < 2; ++i) {
+    server_->generateMessage(output_, OpCode::TEXT, IOBuf::copyBuffer(text));
+    client_->onIngress(output_.move());
+  }
+  ASSERT_EQ(clientCb_.messages.size(), 2);
+  EXPECT_EQ(clientCb_.messages[1], text);
+  EXPECT_EQ(clientCb_.errorCode, 0);
+}
+
+TEST_F(WebSocketCodecTest, DeflateEmptyMessages) {
+  WebSocketCodec::Options options;
+  options.deflate = true;
+  init(options);
+  // With context takeover, an empty message after another flushes nothing
+  for (auto text : {"a", "", "", "b"}) {
+    server_->generateMessage(output_, OpCode::TEXT, IOBuf::copyBuffer(text));
+  }
+  client_->onIngress(output_.move());
+  EXPECT_EQ(clientCb_.messages,
+            (std::vector<std::string>{"a", "", "", "b"}));
+  EXPECT_EQ(clientCb_.errorCode, 0);
+}
+
+TEST_F(WebSocketCodecTest, DeflateEmptyFinalFragment) {
+  WebSocketCodec::Options options;
+  options.deflate = true;
+  init(options);
+  for (int i = 0; i < 2; ++i) {
+    client_->generateFragment(
+        output_, OpCode::BINARY, IOBuf::copyBuffer("abc"), false);
+    client_->generateFragment(output_, OpCode::BINARY, nullptr, true);
+  }
+  server_->onIngress(output_.move());
+  EXPECT_EQ(serverCb_.messages, (std::vector<std::string>{"abc", "abc"}));
+  EXPECT_EQ(serverCb_.errorCode, 0);
+}
+
+TEST_F(WebSocketCodecTest, DeflateTooBig) {
+  WebSocketCodec::Options options;
+  options.deflate = true;
+  options.maxMessageSize = 1000;
+  init(options);
+  // Compresses to a few hundred bytes
+  client_->generateMessage(
+      output_, OpCode::BINARY, IOBuf::copyBuffer(std::string(100000, 'x')));
+  server_->onIngress(output_.move());
+  EXPECT_EQ(serverCb_.errorCode, WebSocketCodec::kCloseTooBig);
+  EXPECT_TRUE(serverCb_.messages.empty());
+}
+
+TEST_F(WebSocketCodecTest, UnmaskedFromClient) {
+  // A server's frame, unmasked, sent to a server
+  server_->generateMessage(output_, OpCode::TEXT, IOBuf::copyBuffer("x"));
+  server_->onIngress(output_.move());
+  EXPECT_EQ(serverCb_.errorCode, WebSocketCodec::kCloseProtocolError);
+  EXPECT_TRUE(serverCb_.messages.empty());
+}
+
+TEST(WebSocketCodecErrorTest, ProtocolErrors) {
+  struct Case {
+    std::vector<uint8_t> frame;
+    uint16_t expected;
+  };
+  std::vector<Case> cases{
+      // RSV2
+      {{0xa1, 0x00}, WebSocketCodec::kCloseProtocolError},
+      // RSV1 without deflate
+      {{0xc1, 0x00}, WebSocketCodec::kCloseProtocolError},
+      // Unknown opcode
+      {{0x83, 0x00}, WebSocketCodec::kCloseProtocolError},
+      // Fragmented ping
+      {{0x09, 0x00}, WebSocketCodec::kCloseProtocolError},
+      // Continuation of nothing
+      {{0x80, 0x00}, WebSocketCodec::kCloseProtocolError},
+      // A one byte close
+      {{0x88, 0x01, 0x03}, WebSocketCodec::kCloseProtocolError},
+      // A 2^63 byte length
+      {{0x82, 0x7f, 0x80, 0, 0, 0, 0, 0, 0, 0},
+       WebSocketCodec::kCloseProtocolError},
+      // Over maxMessageSize
+      {{0x82, 0x7f, 0, 0, 0, 0, 0x10, 0, 0, 0}, WebSocketCodec::kCloseTooBig},
+  };
+  for (const auto& test : cases) {
+    TestCallback callback;
+    WebSocketCodec codec(TransportDirection::UPSTREAM,
+                         WebSocketCodec::Options());
+    codec.setCallback(&callback);
+    codec.onIngress(IOBuf::copyBuffer(test.frame.data(), test.frame.size()));
+    EXPECT_EQ(callback.errorCode, test.expected);
+    // Ignored afterwards
+    codec.onIngress(IOBuf::copyBuffer("\x81\x01x", 3));
+    EXPECT_TRUE(callback.messages.empty());
+  }
+}
+
+TEST_F(WebSocketCodecTest, TooBig) {
+  WebSocketCodec::Options options;
+  options.maxMessageSize = 10;
+  init(options);
+  client_->generateFragment(
+      output_, OpCode::TEXT, IOBuf::copyBuffer("012345"), false);
+  client_->generateFragment(
+      output_, OpCode::TEXT, IOBuf::copyBuffer("6789ab"), true);
+  server_->onIngress(output_.move());
+  EXPECT_EQ(serverCb_.errorCode, WebSocketCodec::kCloseTooBig);
+  EXPECT_TRUE(serverCb_.messages.empty());
+}
+
+TEST(WebSocketExtensionTest, ParseDeflate) {
+  WebSocketCodec::Options options;
+  EXPECT_FALSE(
+      WebSocketCodec::parseDeflateExtension("x-webkit-deflate", options));
+  EXPECT_FALSE(options.deflate);
+
+  // The first offer asks for a smaller window, so the second is taken
+  EXPECT_TRUE(WebSocketCodec::parseDeflateExtension(
+      "permessage-deflate; server_max_window_bits=10, "
+      "permessage-deflate; client_no_context_takeover; "
+      "client_max_window_bits",
+      options));
+  EXPECT_TRUE(options.deflate);
+  EXPECT_TRUE(options.clientNoContextTakeover);
+  EXPECT_FALSE(options.serverNoContextTakeover);
+  EXPECT_EQ(WebSocketCodec::deflateExtensionResponse(options),
+            "permessage-deflate; client_no_context_takeover");
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/OutlierDetector.h>
+
+#include <algorithm>
+
+#include <proxygen/lib/http/HTTPMessage.h>
+
+using std::chrono::microseconds;
+
+namespace proxygen {
+
+void OutlierDetector::SessionStats::onIngressMessage(const HTTPMessage& msg) {
+  if (stats_) {
+    stats_->onIngressMessage(msg);
+  }
+  if (msg.isResponse()) {
+    detector_.recordResponse(endpoint_, msg.getStatusCode());
+  }
+}
+
+void OutlierDetector::SessionStats::onIngressError(ProxygenError error) {
+  if (stats_) {
+    stats_->onIngressError(error);
+  }
+  detector_.recordError(endpoint_, error);
+}
+
+void OutlierDetector::recordResponse(const Endpoint& endpoint,
+                                     uint16_t status,
+                                     folly::Optional<microseconds> latency) {
+  if (status < 200) {
+    return;
+  }
+  record(endpoint, getState(endpoint), status >= 500, latency);
+}
+
+void OutlierDetector::recordError(const Endpoint& endpoint,
+                                  ProxygenError error) {
+  VLOG(5) << "Error from " << endpoint.getHostname() << ":"
+          << endpoint.getPort() << ": " << getErrorString(error);
+  record(endpoint, getState(endpoint), true, folly::none);
+}
+
+bool OutlierDetector::isEjected(const Endpoint& endpoint) {
+  auto it = endpoints_.find(endpoint);
+  if (it == endpoints_.end()) {
+    return false;
+  }
+  maybeReturn(endpoint, it->second, getCurrentTime());
+  return it->second.stats.ejected;
+}
+
+folly::Optional<OutlierDetector::EndpointStats> OutlierDetector::getStats(
+    const Endpoint& endpoint) const {
+  auto it = endpoints_.find(endpoint);
+  if (it == endpoints_.end()) {
+    return folly::none;
+  }
+  return it->second.stats;
+}
+
+OutlierDetector::State& OutlierDetector::getState(const Endpoint& endpoint) {
+  return endpoints_[endpoint];
+}
+
+void OutlierDetector::record(const Endpoint& endpoint,
+                             State& state,
+                             bool failure,
+                             folly::Optional<microseconds> latency) {
+  maybeReturn(endpoint, state, getCurrentTime());
+  auto& stats = state.stats;
+  const double weight = options_.smoothing;
+  stats.requests++;
+  stats.consecutiveFailures = failure ? stats.consecutiveFailures + 1 : 0;
+  stats.failureRate = stats.failureRate * (1 - weight) + (failure ? weight : 0);
+  if (latency) {
+    stats.latency = stats.latency.count() == 0
+                        ? *latency
+                        : microseconds(int64_t(
+                              stats.latency.count() * (1 - weight) +
+                              latency->count() * weight));
+  }
+  if (stats.ejected) {
+    // Requests sent before the ejection
+    return;
+  }
+
+  if (options_.consecutiveFailures > 0 &&
+      stats.consecutiveFailures >= options_.consecutiveFailures) {
+    eject(endpoint, state, "consecutive failures");
+  } else if (stats.requests >= options_.minRequests) {
+    if (stats.failureRate > options_.maxFailureRate) {
+      eject(endpoint, state, "failure rate");
+    } else if (options_.maxLatency.count() > 0 &&
+               stats.latency > options_.maxLatency) {
+      eject(endpoint, state, "latency");
+    } else {
+      // Healthy again since it last returned
+      stats.ejections = 0;
+    }
+  }
+}
+
+void OutlierDetector::maybeReturn(const Endpoint& endpoint,
+                                  State& state,
+                                  TimePoint now) {
+  auto& stats = state.stats;
+  if (!stats.ejected || now < state.ejectedUntil) {
+    return;
+  }
+  VLOG(3) << "Returning " << endpoint.getHostname() << ":"
+          << endpoint.getPort();
+  auto ejections = stats.ejections;
+  stats = EndpointStats();
+  stats.ejections = ejections;
+  DCHECK_GT(numEjected_, 0);
+  numEjected_--;
+  if (listener_) {
+    listener_->onReturned(endpoint);
+  }
+}
+
+void OutlierDetector::eject(const Endpoint& endpoint,
+                            State& state,
+                            const std::string& why) {
+  if (numEjected_ >= options_.maxEjectedFraction * endpoints_.size()) {
+    VLOG(3) << "Not ejecting " << endpoint.getHostname() << ":"
+            << endpoint.getPort() << " for " << why << ", " << numEjected_
+            << " of " << endpoints_.size() << " are ejected";
+    return;
+  }
+  auto& stats = state.stats;
+  auto duration = std::min(options_.baseEjectionTime * (stats.ejections + 1),
+                           options_.maxEjectionTime);
+  VLOG(2) << "Ejecting " << endpoint.getHostname() << ":" << endpoint.getPort()
+          << " for " << why << " for " << duration.count() << "ms";
+  stats.ejections++;
+  stats.ejected = true;
+  state.ejectedUntil = getCurrentTime() + duration;
+  numEjected_++;
+  if (listener_) {
+    listener_->onEjected(endpoint, why);
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+
+#include <folly/Optional.h>
+#include <proxygen/lib/http/connpool/SessionHolder.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * Passive health checking: ejects the endpoints whose responses show they
+ * are degraded, before active health checks notice.
+ *
+ * An endpoint is ejected after consecutiveFailures 5xx responses or errors
+ * in a row, or once it served minRequests requests, when the smoothed rate
+ * of failures or latency is over its limit.  It returns after an ejection
+ * time growing with the times it was ejected in a row, with its counters
+ * reset.  Ejections stop while maxEjectedFraction of the endpoints seen
+ * are ejected, so a wide outage doesn't eject every endpoint.
+ *
+ * Results come from SessionStats, a SessionHolder::Stats for a pool of
+ * one endpoint, and from record*() for what the caller measures, like
+ * latencies.  Load balancers skip the endpoints isEjected() returns true
+ * for, and a Listener may pass ejections on to a health checker.
+ *
+ * Like SessionPool, it can only be used from one thread.
+ */
+class OutlierDetector {
+ public:
+  struct Options {
+    // 0 disables
+    uint32_t consecutiveFailures{5};
+    // Above 1 disables
+    double maxFailureRate{0.5};
+    // 0 disables
+    std::chrono::milliseconds maxLatency{0};
+    // Requests before the failure rate and latency count
+    uint32_t minRequests{20};
+    // Weight of each request in the smoothed failure rate and latency
+    double smoothing{0.1};
+    std::chrono::milliseconds baseEjectionTime{std::chrono::seconds(30)};
+    std::chrono::milliseconds maxEjectionTime{std::chrono::seconds(300)};
+    double maxEjectedFraction{0.5};
+  };
+
+  struct EndpointStats {
+    uint64_t requests{0};
+    uint32_t consecutiveFailures{0};
+    double failureRate{0};
+    std::chrono::microseconds latency{0};
+    // Times ejected in a row, reset once minRequests are served after
+    uint32_t ejections{0};
+    bool ejected{false};
+  };
+
+  class Listener {
+   public:
+    virtual ~Listener() {
+    }
+    virtual void onEjected(const Endpoint& endpoint,
+                           const std::string& reason) noexcept = 0;
+    virtual void onReturned(const Endpoint& endpoint) noexcept = 0;
+  };
+
+  /**
+   * Records the responses and ingress errors of the sessions of one
+   * endpoint's SessionPool, passing every call on to stats too.
+   */
+  class SessionStats : public SessionHolder::Stats {
+   public:
+    SessionStats(OutlierDetector& detector,
+                 Endpoint endpoint,
+                 SessionHolder::Stats* stats = nullptr)
+        : detector_(detector), endpoint_(std::move(endpoint)), stats_(stats) {
+    }
+
+    void onConnectionCreated() override {
+      if (stats_) {
+        stats_->onConnectionCreated();
+      }
+    }
+    void onConnectionClosed() override {
+      if (stats_) {
+        stats_->onConnectionClosed();
+      }
+    }
+    void onConnectionActivated() override {
+      if (stats_) {
+        stats_->onConnectionActivated();
+      }
+    }
+    void onConnectionDeactivated() override {
+      if (stats_) {
+        stats_->onConnectionDeactivated();
+      }
+    }
+    void onRead(size_t bytesRead) override {
+      if (stats_) {
+        stats_->onRead(bytesRead);
+      }
+    }
+    void onWrite(size_t bytesWritten) override {
+      if (stats_) {
+        stats_->onWrite(bytesWritten);
+      }
+    }
+    void onIngressMessage(const HTTPMessage& msg) override;
+    void onIngressError(ProxygenError error) override;
+
+   private:
+    OutlierDetector& detector_;
+    const Endpoint endpoint_;
+    SessionHolder::Stats* const stats_;
+  };
+
+  explicit OutlierDetector(Options options) : options_(options) {
+  }
+
+  void setListener(Listener* listener) {
+    listener_ = listener;
+  }
+
+  // 5xx statuses are failures, informational ones are ignored
+  void recordResponse(
+      const Endpoint& endpoint,
+      uint16_t status,
+      folly::Optional<std::chrono::microseconds> latency = folly::none);
+
+  void recordError(const Endpoint& endpoint, ProxygenError error);
+
+  bool isEjected(const Endpoint& endpoint);
+
+  folly::Optional<EndpointStats> getStats(const Endpoint& endpoint) const;
+
+  size_t getNumEjected() const {
+    return numEjected_;
+  }
+
+ private:
+  struct State {
+    EndpointStats stats;
+    TimePoint ejectedUntil;
+  };
+
+  State& getState(const Endpoint& endpoint);
+  void record(const Endpoint& endpoint,
+              State& state,
+              bool failure,
+              folly::Optional<std::chrono::microseconds> latency);
+  void maybeReturn(const Endpoint& endpoint, State& state, TimePoint now);
+  void eject(const Endpoint& endpoint, State& state, const std::string& why);
+
+  const Options options_;
+  Listener* listener_{nullptr};
+  std::unordered_map<Endpoint, State, EndpointHash, EndpointEqual> endpoints_;
+  size_t numEjected_{0};
+};
+
+} // namespace proxygen
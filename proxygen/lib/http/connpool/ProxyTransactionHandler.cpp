@@ -0,0 +1,622 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/ProxyTransactionHandler.h>
+
+#include <folly/Conv.h>
+#include <proxygen/lib/utils/URL.h>
+
+namespace {
+const uint32_t kMinReadSize = 1460;
+const uint32_t kMaxReadSize = 64000;
+} // namespace
+
+namespace proxygen {
+
+ProxyTransactionHandler::ProxyTransactionHandler(UpstreamManager& upstream,
+                                                 const Options& options)
+    : upstreamManager_(upstream), options_(options) {
+  DCHECK_LE(options_.lowWatermark, options_.highWatermark);
+}
+
+ProxyTransactionHandler::~ProxyTransactionHandler() {
+  DCHECK(!downstream_ && !upstream_ && !waiting_ && !socket_ && !following_);
+}
+
+folly::Optional<Endpoint> ProxyTransactionHandler::defaultRoute(
+    const HTTPMessage& msg) {
+  if (msg.getMethod() == HTTPMethod::CONNECT) {
+    URL url(folly::to<std::string>("http://", msg.getURL()));
+    if (!url.isValid() || !url.hasHost()) {
+      return folly::none;
+    }
+    return Endpoint(url.getHost(), url.getPort(), false);
+  }
+  URL url(msg.getURL());
+  if (url.isValid() && url.hasHost()) {
+    return Endpoint(url.getHost(), url.getPort(), url.isSecure());
+  }
+  const auto& host = msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_HOST);
+  if (host.empty()) {
+    return folly::none;
+  }
+  URL hostUrl(folly::to<std::string>("http://", host));
+  if (!hostUrl.isValid() || !hostUrl.hasHost()) {
+    return folly::none;
+  }
+  return Endpoint(hostUrl.getHost(), hostUrl.getPort(), false);
+}
+
+void ProxyTransactionHandler::setTransaction(HTTPTransaction* txn) noexcept {
+  downstream_ = txn;
+  // Resumed below the low watermark, see forward()
+  downstream_->setEgressBufferLimitOverride(options_.lowWatermark);
+}
+
+void ProxyTransactionHandler::detachTransaction() noexcept {
+  DestructorGuard dg(this);
+  downstream_ = nullptr;
+  if (following_) {
+    options_.collapser->unfollow(this);
+    following_ = false;
+  }
+  if (waiting_) {
+    upstreamManager_.cancel(this);
+    waiting_ = false;
+    endGroup(true);
+  }
+  if (upstream_ && !upstream_->isEgressComplete()) {
+    // The request can't be completed anymore
+    upstream_->sendAbort();
+  }
+  if (socket_ && pendingWrites_.empty()) {
+    closeTunnel();
+  }
+  maybeDestroy();
+}
+
+void ProxyTransactionHandler::onHeadersComplete(
+    std::unique_ptr<HTTPMessage> msg) noexcept {
+  DestructorGuard dg(this);
+  request_ = std::move(msg);
+  auto endpoint =
+      options_.route ? options_.route(*request_) : defaultRoute(*request_);
+  if (!endpoint) {
+    sendError(400, "No upstream for the request");
+    return;
+  }
+  downstream_->pauseIngress();
+  if (request_->getMethod() == HTTPMethod::CONNECT) {
+    if (!options_.allowConnect) {
+      sendError(405, "CONNECT is not allowed");
+      return;
+    }
+    startTunnel(*endpoint);
+    return;
+  }
+
+  request_->stripPerHopHeaders();
+  URL url(request_->getURL());
+  if (url.isValid() && url.hasHost()) {
+    // Origin form for the upstream
+    request_->setURL(url.makeRelativeURL());
+    if (!request_->getHeaders().exists(HTTP_HEADER_HOST)) {
+      request_->getHeaders().set(HTTP_HEADER_HOST,
+                                 url.getHostAndPortOmitDefault());
+    }
+  }
+  endpoint_ = std::move(endpoint);
+  if (options_.collapser && options_.collapser->isCollapsible(*request_)) {
+    auto key = options_.collapser->makeKey(*request_);
+    // Before following, which may replay the response so far
+    following_ = true;
+    if (options_.collapser->follow(key, this)) {
+      if (downstream_) {
+        // Reads the rest of the request, it has no body
+        resumeIngress(downstream_);
+      }
+      return;
+    }
+    following_ = false;
+    group_ = options_.collapser->lead(key);
+    if (group_) {
+      group_->setPauseCallback(
+          [this](bool paused) { onFollowersPaused(paused); });
+    }
+  }
+  sendUpstream();
+}
+
+void ProxyTransactionHandler::sendUpstream() {
+  auto method = request_->getMethod();
+  waiting_ = true;
+  upstreamManager_.getTransaction(
+      *endpoint_,
+      &upstreamHandler_,
+      this,
+      /*idempotent=*/method == HTTPMethod::GET || method == HTTPMethod::HEAD);
+}
+
+void ProxyTransactionHandler::onBody(
+    std::unique_ptr<folly::IOBuf> chain) noexcept {
+  DestructorGuard dg(this);
+  if (socket_) {
+    auto len = chain->computeChainDataLength();
+    socketBuffered_ += len;
+    pendingWrites_.push_back(len);
+    socket_->writeChain(this, std::move(chain));
+    if (socketBuffered_ >= options_.highWatermark && downstream_ &&
+        !downstream_->isIngressPaused()) {
+      downstreamPaused_ = true;
+      downstream_->pauseIngress();
+    }
+    return;
+  }
+  // Ingress stays paused until the upstream transaction is open, and the
+  // body of a request answered with an error is dropped
+  if (upstream_) {
+    forward(downstream_, upstream_, std::move(chain));
+  }
+}
+
+void ProxyTransactionHandler::onTrailers(
+    std::unique_ptr<HTTPHeaders> trailers) noexcept {
+  if (upstream_) {
+    upstream_->sendTrailers(*trailers);
+  }
+}
+
+void ProxyTransactionHandler::onEOM() noexcept {
+  DestructorGuard dg(this);
+  downstreamEOM_ = true;
+  if (socket_) {
+    socket_->shutdownWrite();
+  } else if (upstream_) {
+    upstream_->sendEOM();
+  }
+}
+
+void ProxyTransactionHandler::onUpgrade(UpgradeProtocol /*protocol*/) noexcept {
+}
+
+void ProxyTransactionHandler::onError(const HTTPException& error) noexcept {
+  DestructorGuard dg(this);
+  VLOG(4) << "Downstream error: " << error.what();
+  if (following_) {
+    options_.collapser->unfollow(this);
+    following_ = false;
+  }
+  if (waiting_) {
+    upstreamManager_.cancel(this);
+    waiting_ = false;
+    endGroup(true);
+  }
+  if (upstream_) {
+    upstream_->sendAbort();
+  }
+  if (socket_) {
+    closeTunnel();
+  }
+}
+
+void ProxyTransactionHandler::onEgressPaused() noexcept {
+  // Ingress is paused once the buffer reaches the high watermark only
+}
+
+void ProxyTransactionHandler::onEgressResumed() noexcept {
+  DestructorGuard dg(this);
+  // The downstream egress buffer drained to the low watermark
+  if (upstreamPaused_ && upstream_) {
+    upstreamPaused_ = false;
+    resumeIngress(upstream_);
+  }
+  if (socketReadPaused_ && socket_) {
+    socketReadPaused_ = false;
+    socket_->setReadCB(this);
+  }
+  if (followerPaused_) {
+    followerPaused_ = false;
+    options_.collapser->setFollowerPaused(this, false);
+  }
+}
+
+void ProxyTransactionHandler::onTransaction(HTTPTransaction* txn) noexcept {
+  DestructorGuard dg(this);
+  DCHECK_EQ(txn, upstream_);
+  waiting_ = false;
+  if (!downstream_) {
+    txn->sendAbort();
+    return;
+  }
+  txn->setEgressBufferLimitOverride(options_.lowWatermark);
+  txn->sendHeaders(*request_);
+  if (downstreamEOM_) {
+    // A released follower
+    txn->sendEOM();
+  }
+  resumeIngress(downstream_);
+}
+
+void ProxyTransactionHandler::onTransactionError(
+    const folly::exception_wrapper& error) noexcept {
+  DestructorGuard dg(this);
+  waiting_ = false;
+  VLOG(3) << "No upstream transaction: " << error.what();
+  endGroup(true);
+  if (error.is_compatible_with<UpstreamManager::CircuitOpenError>()) {
+    sendError(503, "Upstream unavailable");
+  } else {
+    sendError(502, "Upstream connect failed");
+  }
+  maybeDestroy();
+}
+
+void ProxyTransactionHandler::detachUpstream() {
+  DestructorGuard dg(this);
+  upstream_ = nullptr;
+  // Without an EOM or an error
+  endGroup(true);
+  maybeDestroy();
+}
+
+void ProxyTransactionHandler::onUpstreamHeaders(
+    std::unique_ptr<HTTPMessage> msg) {
+  DestructorGuard dg(this);
+  msg->stripPerHopHeaders();
+  if (msg->getStatusCode() == 421 && endpoint_) {
+    // Misdirected, maybe on a session coalesced from another hostname
+    upstreamManager_.disableCoalescing(*endpoint_);
+  }
+  auto altSvc = msg->getHeaders().combine(HTTP_HEADER_ALT_SVC);
+  if (!altSvc.empty() && endpoint_) {
+    upstreamManager_.onAltSvc(*endpoint_, altSvc);
+  }
+  if (downstream_) {
+    if (msg->getStatusCode() >= 200) {
+      responseStarted_ = true;
+    }
+    downstream_->sendHeaders(*msg);
+  }
+  if (group_) {
+    // Kept by the group for late followers
+    group_->sendHeaders(std::move(msg));
+  }
+}
+
+void ProxyTransactionHandler::onUpstreamBody(
+    std::unique_ptr<folly::IOBuf> chain) {
+  DestructorGuard dg(this);
+  if (group_) {
+    group_->sendBody(*chain);
+  }
+  if (downstream_) {
+    forward(upstream_, downstream_, std::move(chain));
+  }
+}
+
+void ProxyTransactionHandler::onUpstreamTrailers(
+    std::unique_ptr<HTTPHeaders> trailers) {
+  DestructorGuard dg(this);
+  if (group_) {
+    group_->sendTrailers(*trailers);
+  }
+  if (downstream_) {
+    downstream_->sendTrailers(*trailers);
+  }
+}
+
+void ProxyTransactionHandler::onUpstreamEOM() {
+  DestructorGuard dg(this);
+  endGroup(false);
+  if (downstream_) {
+    downstream_->sendEOM();
+  }
+}
+
+void ProxyTransactionHandler::onUpstreamError(const HTTPException& error) {
+  DestructorGuard dg(this);
+  VLOG(4) << "Upstream error: " << error.what();
+  endGroup(true);
+  if (!downstream_) {
+    return;
+  }
+  if (responseStarted_) {
+    abortDownstream();
+  } else {
+    sendError(error.getProxygenError() == kErrorTimeout ? 504 : 502,
+              "Upstream error");
+  }
+}
+
+void ProxyTransactionHandler::onUpstreamEgressResumed() {
+  DestructorGuard dg(this);
+  if (downstreamPaused_ && downstream_) {
+    downstreamPaused_ = false;
+    resumeIngress(downstream_);
+  }
+}
+
+void ProxyTransactionHandler::forward(HTTPTransaction* src,
+                                      HTTPTransaction* dst,
+                                      std::unique_ptr<folly::IOBuf> chain) {
+  dst->sendBody(std::move(chain));
+  // The other side resumes src once dst drained to the low watermark, as
+  // the egress buffer limit of dst
+  if (src && dst->getOutstandingEgressBodyBytes() >= options_.highWatermark) {
+    (src == downstream_ ? downstreamPaused_ : upstreamPaused_) = true;
+    // Maybe already paused by the followers
+    if (!src->isIngressPaused()) {
+      src->pauseIngress();
+    }
+  }
+}
+
+void ProxyTransactionHandler::resumeIngress(HTTPTransaction* txn) {
+  if ((txn == downstream_ && downstreamPaused_) ||
+      (txn == upstream_ && (upstreamPaused_ || followersPaused_))) {
+    // Still over the watermark
+    return;
+  }
+  txn->resumeIngress();
+}
+
+void ProxyTransactionHandler::onCollapsedHeaders(
+    const HTTPMessage& msg) noexcept {
+  if (!downstream_) {
+    return;
+  }
+  responseStarted_ = true;
+  downstream_->sendHeaders(msg);
+}
+
+void ProxyTransactionHandler::onCollapsedBody(
+    std::unique_ptr<folly::IOBuf> chain) noexcept {
+  DestructorGuard dg(this);
+  if (!downstream_) {
+    return;
+  }
+  downstream_->sendBody(std::move(chain));
+  if (downstream_ && !followerPaused_ &&
+      downstream_->getOutstandingEgressBodyBytes() >= options_.highWatermark) {
+    // Until onEgressResumed(), at the low watermark
+    followerPaused_ = true;
+    options_.collapser->setFollowerPaused(this, true);
+  }
+}
+
+void ProxyTransactionHandler::onCollapsedTrailers(
+    const HTTPHeaders& trailers) noexcept {
+  if (downstream_) {
+    downstream_->sendTrailers(trailers);
+  }
+}
+
+void ProxyTransactionHandler::onCollapsedEOM() noexcept {
+  DestructorGuard dg(this);
+  following_ = false;
+  followerPaused_ = false;
+  if (downstream_) {
+    downstream_->sendEOM();
+  }
+  maybeDestroy();
+}
+
+void ProxyTransactionHandler::onCollapsedError() noexcept {
+  DestructorGuard dg(this);
+  following_ = false;
+  followerPaused_ = false;
+  abortDownstream();
+  maybeDestroy();
+}
+
+void ProxyTransactionHandler::onCollapseReleased() noexcept {
+  DestructorGuard dg(this);
+  following_ = false;
+  followerPaused_ = false;
+  if (!downstream_) {
+    maybeDestroy();
+    return;
+  }
+  VLOG(4) << "Collapsed request released, sending it upstream";
+  sendUpstream();
+}
+
+void ProxyTransactionHandler::onFollowersPaused(bool paused) {
+  followersPaused_ = paused;
+  if (!upstream_) {
+    return;
+  }
+  if (!paused) {
+    resumeIngress(upstream_);
+  } else if (!upstream_->isIngressPaused()) {
+    upstream_->pauseIngress();
+  }
+}
+
+void ProxyTransactionHandler::endGroup(bool aborted) {
+  if (!group_) {
+    return;
+  }
+  auto group = std::move(group_);
+  followersPaused_ = false;
+  if (aborted) {
+    group->sendAbort();
+  } else {
+    group->sendEOM();
+  }
+}
+
+void ProxyTransactionHandler::startTunnel(const Endpoint& endpoint) {
+  folly::SocketAddress address;
+  try {
+    address = options_.resolver
+                  ? options_.resolver(endpoint)
+                  : folly::SocketAddress(
+                        endpoint.getHostname(), endpoint.getPort(), true);
+  } catch (const std::exception& ex) {
+    VLOG(3) << "Failed to resolve " << endpoint.getHostname() << ": "
+            << ex.what();
+    sendError(502, "Upstream resolution failed");
+    return;
+  }
+  socket_ = folly::AsyncSocket::UniquePtr(
+      new folly::AsyncSocket(upstreamManager_.getEventBase()));
+  socket_->connect(this, address, options_.connectTimeout.count());
+}
+
+void ProxyTransactionHandler::closeTunnel() {
+  auto socket = std::move(socket_);
+  socket->setReadCB(nullptr);
+  // Fails the writes in flight
+  socket->closeNow();
+  pendingWrites_.clear();
+  socketBuffered_ = 0;
+}
+
+void ProxyTransactionHandler::connectSuccess() noexcept {
+  DestructorGuard dg(this);
+  if (!downstream_) {
+    closeTunnel();
+    maybeDestroy();
+    return;
+  }
+  HTTPMessage response;
+  response.setStatusCode(200);
+  response.setStatusMessage("OK");
+  responseStarted_ = true;
+  downstream_->sendHeaders(response);
+  socket_->setReadCB(this);
+  resumeIngress(downstream_);
+}
+
+void ProxyTransactionHandler::connectErr(
+    const folly::AsyncSocketException& ex) noexcept {
+  DestructorGuard dg(this);
+  if (!socket_) {
+    // Closed while connecting
+    return;
+  }
+  VLOG(3) << "Tunnel connect failed: " << ex.what();
+  socket_.reset();
+  if (downstream_) {
+    sendError(502, "Upstream connect failed");
+  }
+  maybeDestroy();
+}
+
+void ProxyTransactionHandler::getReadBuffer(void** bufReturn,
+                                            size_t* lenReturn) {
+  auto readSpace = readBuf_.preallocate(kMinReadSize, kMaxReadSize);
+  *bufReturn = readSpace.first;
+  *lenReturn = readSpace.second;
+}
+
+void ProxyTransactionHandler::readDataAvailable(size_t len) noexcept {
+  readBuf_.postallocate(len);
+  readBufferAvailable(readBuf_.move());
+}
+
+void ProxyTransactionHandler::readBufferAvailable(
+    std::unique_ptr<folly::IOBuf> buf) noexcept {
+  DestructorGuard dg(this);
+  if (!downstream_) {
+    return;
+  }
+  forward(nullptr, downstream_, std::move(buf));
+  if (socket_ && downstream_ &&
+      downstream_->getOutstandingEgressBodyBytes() >= options_.highWatermark) {
+    socketReadPaused_ = true;
+    socket_->setReadCB(nullptr);
+  }
+}
+
+void ProxyTransactionHandler::readEOF() noexcept {
+  DestructorGuard dg(this);
+  if (downstream_) {
+    downstream_->sendEOM();
+  }
+}
+
+void ProxyTransactionHandler::readErr(
+    const folly::AsyncSocketException& ex) noexcept {
+  DestructorGuard dg(this);
+  VLOG(3) << "Tunnel read error: " << ex.what();
+  closeTunnel();
+  abortDownstream();
+  maybeDestroy();
+}
+
+void ProxyTransactionHandler::writeSuccess() noexcept {
+  DestructorGuard dg(this);
+  if (pendingWrites_.empty()) {
+    return;
+  }
+  socketBuffered_ -= pendingWrites_.front();
+  pendingWrites_.pop_front();
+  if (downstreamPaused_ && socketBuffered_ <= options_.lowWatermark &&
+      downstream_) {
+    downstreamPaused_ = false;
+    resumeIngress(downstream_);
+  }
+  if (!downstream_ && pendingWrites_.empty() && socket_) {
+    // The last writes of a finished tunnel
+    closeTunnel();
+    maybeDestroy();
+  }
+}
+
+void ProxyTransactionHandler::writeErr(
+    size_t /*bytesWritten*/, const folly::AsyncSocketException& ex) noexcept {
+  DestructorGuard dg(this);
+  if (!socket_) {
+    // Closing
+    return;
+  }
+  VLOG(3) << "Tunnel write error: " << ex.what();
+  closeTunnel();
+  abortDownstream();
+  maybeDestroy();
+}
+
+void ProxyTransactionHandler::sendError(uint16_t status,
+                                        const std::string& message) {
+  if (!downstream_) {
+    return;
+  }
+  if (responseStarted_ || !downstream_->canSendHeaders()) {
+    abortDownstream();
+    return;
+  }
+  responseStarted_ = true;
+  HTTPMessage response;
+  response.setStatusCode(status);
+  response.setStatusMessage(HTTPMessage::getDefaultReason(status));
+  response.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                            folly::to<std::string>(message.size()));
+  downstream_->sendHeaders(response);
+  downstream_->sendBody(folly::IOBuf::copyBuffer(message));
+  downstream_->sendEOM();
+  if (downstream_ && downstream_->isIngressPaused()) {
+    // Reads the rest of the request, to drop it
+    downstream_->resumeIngress();
+  }
+}
+
+void ProxyTransactionHandler::abortDownstream() {
+  if (downstream_) {
+    downstream_->sendAbort();
+  }
+}
+
+void ProxyTransactionHandler::maybeDestroy() {
+  if (!downstream_ && !upstream_ && !waiting_ && !socket_ && !following_) {
+    destroy();
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/DelayedDestruction.h>
+#include <proxygen/lib/http/connpool/RequestCollapser.h>
+#include <proxygen/lib/http/connpool/UpstreamManager.h>
+
+namespace proxygen {
+
+/**
+ * Proxies a downstream transaction to an upstream one, opened on the pooled
+ * sessions of an UpstreamManager.  Set it as the handler of the downstream
+ * transaction, e.g. from HTTPSessionController::getRequestHandler(); it
+ * deletes itself once both transactions are detached.
+ *
+ * Bodies go both ways as they arrive, full duplex, and the IOBufs are
+ * passed on as is.  Flow control is coupled through byte watermarks: the
+ * ingress of a side pauses once the other side buffers highWatermark
+ * bytes, and resumes once they drain to lowWatermark.
+ *
+ * With allowConnect, CONNECT requests are tunneled over a new TCP
+ * connection to their authority, reading into movable buffers so the bytes
+ * aren't copied.
+ *
+ * With a collapser, identical GETs and HEADs in flight share one upstream
+ * request, see RequestCollapser.
+ */
+class ProxyTransactionHandler
+    : public HTTPTransaction::Handler
+    , public folly::DelayedDestruction
+    , private UpstreamManager::Callback
+    , private RequestCollapser::Follower
+    , private folly::AsyncSocket::ConnectCallback
+    , private folly::AsyncReader::ReadCallback
+    , private folly::AsyncWriter::WriteCallback {
+ public:
+  struct Options {
+    // The endpoint of a request, defaultRoute() when unset. Requests
+    // without one are answered 400.
+    std::function<folly::Optional<Endpoint>(const HTTPMessage&)> route;
+    size_t highWatermark{64 * 1024};
+    size_t lowWatermark{16 * 1024};
+    bool allowConnect{false};
+    // For CONNECT tunnels
+    std::chrono::milliseconds connectTimeout{std::chrono::milliseconds(1000)};
+    // Maps a tunnel endpoint to the address to connect to. Defaults to a
+    // (blocking) lookup of the endpoint's hostname.
+    std::function<folly::SocketAddress(const Endpoint&)> resolver;
+    // Of the thread of the UpstreamManager, none to send every request
+    RequestCollapser* collapser{nullptr};
+  };
+
+  // options must outlive the handler
+  ProxyTransactionHandler(UpstreamManager& upstream, const Options& options);
+
+  /**
+   * The authority of CONNECT requests or the host of absolute URLs, else
+   * the Host header.
+   */
+  static folly::Optional<Endpoint> defaultRoute(const HTTPMessage& msg);
+
+  // HTTPTransaction::Handler, for the downstream transaction
+  void setTransaction(HTTPTransaction* txn) noexcept override;
+  void detachTransaction() noexcept override;
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override;
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+  void onTrailers(std::unique_ptr<HTTPHeaders> trailers) noexcept override;
+  void onEOM() noexcept override;
+  void onUpgrade(UpgradeProtocol protocol) noexcept override;
+  void onError(const HTTPException& error) noexcept override;
+  void onEgressPaused() noexcept override;
+  void onEgressResumed() noexcept override;
+
+ private:
+  class UpstreamHandler : public HTTPTransaction::Handler {
+   public:
+    explicit UpstreamHandler(ProxyTransactionHandler& parent)
+        : parent_(parent) {
+    }
+
+    void setTransaction(HTTPTransaction* txn) noexcept override {
+      parent_.upstream_ = txn;
+    }
+    void detachTransaction() noexcept override {
+      parent_.detachUpstream();
+    }
+    void onHeadersComplete(
+        std::unique_ptr<HTTPMessage> msg) noexcept override {
+      parent_.onUpstreamHeaders(std::move(msg));
+    }
+    void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+      parent_.onUpstreamBody(std::move(chain));
+    }
+    void onTrailers(std::unique_ptr<HTTPHeaders> trailers) noexcept override {
+      parent_.onUpstreamTrailers(std::move(trailers));
+    }
+    void onEOM() noexcept override {
+      parent_.onUpstreamEOM();
+    }
+    void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+    }
+    void onError(const HTTPException& error) noexcept override {
+      parent_.onUpstreamError(error);
+    }
+    void onEgressPaused() noexcept override {
+    }
+    void onEgressResumed() noexcept override {
+      parent_.onUpstreamEgressResumed();
+    }
+
+   private:
+    ProxyTransactionHandler& parent_;
+  };
+
+  ~ProxyTransactionHandler() override;
+
+  // UpstreamManager::Callback
+  void onTransaction(HTTPTransaction* txn) noexcept override;
+  void onTransactionError(
+      const folly::exception_wrapper& error) noexcept override;
+
+  // RequestCollapser::Follower
+  void onCollapsedHeaders(const HTTPMessage& msg) noexcept override;
+  void onCollapsedBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+  void onCollapsedTrailers(const HTTPHeaders& trailers) noexcept override;
+  void onCollapsedEOM() noexcept override;
+  void onCollapsedError() noexcept override;
+  void onCollapseReleased() noexcept override;
+
+  void sendUpstream();
+  // Leading, some follower is slow
+  void onFollowersPaused(bool paused);
+  void endGroup(bool aborted);
+
+  void detachUpstream();
+  void onUpstreamHeaders(std::unique_ptr<HTTPMessage> msg);
+  void onUpstreamBody(std::unique_ptr<folly::IOBuf> chain);
+  void onUpstreamTrailers(std::unique_ptr<HTTPHeaders> trailers);
+  void onUpstreamEOM();
+  void onUpstreamError(const HTTPException& error);
+  void onUpstreamEgressResumed();
+
+  // Sends chain to dst, pausing src's ingress past the high watermark
+  void forward(HTTPTransaction* src,
+               HTTPTransaction* dst,
+               std::unique_ptr<folly::IOBuf> chain);
+  void resumeIngress(HTTPTransaction* txn);
+
+  void startTunnel(const Endpoint& endpoint);
+  void closeTunnel();
+
+  // AsyncSocket::ConnectCallback
+  void connectSuccess() noexcept override;
+  void connectErr(const folly::AsyncSocketException& ex) noexcept override;
+
+  // AsyncReader::ReadCallback
+  void getReadBuffer(void** bufReturn, size_t* lenReturn) override;
+  void readDataAvailable(size_t len) noexcept override;
+  bool isBufferMovable() noexcept override {
+    return true;
+  }
+  void readBufferAvailable(
+      std::unique_ptr<folly::IOBuf> buf) noexcept override;
+  void readEOF() noexcept override;
+  void readErr(const folly::AsyncSocketException& ex) noexcept override;
+
+  // AsyncWriter::WriteCallback
+  void writeSuccess() noexcept override;
+  void writeErr(size_t bytesWritten,
+                const folly::AsyncSocketException& ex) noexcept override;
+
+  void sendError(uint16_t status, const std::string& message);
+  void abortDownstream();
+  void maybeDestroy();
+
+  UpstreamManager& upstreamManager_;
+  const Options& options_;
+  UpstreamHandler upstreamHandler_{*this};
+  HTTPTransaction* downstream_{nullptr};
+  HTTPTransaction* upstream_{nullptr};
+  std::unique_ptr<HTTPMessage> request_;
+  folly::Optional<Endpoint> endpoint_;
+  // Waiting for the UpstreamManager to open the upstream transaction
+  bool waiting_{false};
+  bool responseStarted_{false};
+  // The request ended before the upstream transaction was open
+  bool downstreamEOM_{false};
+  // Whose ingress the watermarks paused
+  bool downstreamPaused_{false};
+  bool upstreamPaused_{false};
+
+  // Collapsed requests
+  std::shared_ptr<RequestCollapser::Group> group_;
+  bool following_{false};
+  // Over the high watermark while following
+  bool followerPaused_{false};
+  bool followersPaused_{false};
+
+  // Only for CONNECT
+  folly::AsyncSocket::UniquePtr socket_;
+  folly::IOBufQueue readBuf_{folly::IOBufQueue::cacheChainLength()};
+  // The sizes of the writes in flight, in order
+  std::deque<size_t> pendingWrites_;
+  size_t socketBuffered_{0};
+  bool socketReadPaused_{false};
+};
+
+} // namespace proxygen
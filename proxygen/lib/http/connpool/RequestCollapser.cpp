@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/RequestCollapser.h>
+
+#include <algorithm>
+
+#include <folly/Conv.h>
+#include <folly/String.h>
+
+namespace {
+
+// Headers making a request personal, not collapsed unless keyed on
+const char* const kPersonalHeaders[] = {"authorization", "cookie", "range"};
+
+bool isPersonal(const proxygen::HTTPMessage& response) {
+  const auto& headers = response.getHeaders();
+  if (headers.exists(proxygen::HTTP_HEADER_SET_COOKIE)) {
+    return true;
+  }
+  std::vector<folly::StringPiece> directives;
+  auto cacheControl = headers.combine(proxygen::HTTP_HEADER_CACHE_CONTROL);
+  folly::split(',', cacheControl, directives);
+  for (auto directive : directives) {
+    directive = folly::trimWhitespace(directive);
+    if (directive.startsWith("private", folly::AsciiCaseInsensitive()) ||
+        directive.equals("no-store", folly::AsciiCaseInsensitive())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+namespace proxygen {
+
+RequestCollapser::Group::Group(RequestCollapser& collapser, std::string key)
+    : collapser_(collapser), key_(std::move(key)) {
+}
+
+RequestCollapser::Group::~Group() {
+  pauseCallback_ = nullptr;
+  if (!done_) {
+    // The leader is gone without ending its response
+    sendAbort();
+  }
+}
+
+template <typename F>
+void RequestCollapser::Group::forEachFollower(F&& fn) {
+  // The followers may leave from their callbacks
+  auto followers = followers_;
+  for (auto follower : followers) {
+    if (isFollower(follower)) {
+      fn(follower);
+    }
+  }
+}
+
+void RequestCollapser::Group::add(Follower* follower) {
+  DCHECK(!follower->group_);
+  follower->group_ = this;
+  followers_.push_back(follower);
+  if (!headers_) {
+    return;
+  }
+  follower->onCollapsedHeaders(*headers_);
+  if (isFollower(follower) && !body_.empty()) {
+    follower->onCollapsedBody(body_.front()->clone());
+  }
+  if (isFollower(follower) && trailers_) {
+    follower->onCollapsedTrailers(*trailers_);
+  }
+}
+
+bool RequestCollapser::Group::isFollower(Follower* follower) const {
+  // Not dereferenced, it may be gone
+  return std::find(followers_.begin(), followers_.end(), follower) !=
+         followers_.end();
+}
+
+void RequestCollapser::Group::remove(Follower* follower) {
+  DCHECK_EQ(follower->group_, this);
+  follower->group_ = nullptr;
+  followers_.erase(std::remove(followers_.begin(), followers_.end(), follower),
+                   followers_.end());
+  setPaused(follower, false);
+}
+
+void RequestCollapser::Group::setPaused(Follower* follower, bool paused) {
+  auto it = std::find(paused_.begin(), paused_.end(), follower);
+  if (paused == (it != paused_.end())) {
+    return;
+  }
+  if (paused) {
+    paused_.push_back(follower);
+    if (paused_.size() == 1 && pauseCallback_) {
+      pauseCallback_(true);
+    }
+  } else {
+    paused_.erase(it);
+    if (paused_.empty() && pauseCallback_) {
+      pauseCallback_(false);
+    }
+  }
+}
+
+void RequestCollapser::Group::close() {
+  if (!open_) {
+    return;
+  }
+  open_ = false;
+  cancelTimeout();
+  auto it = collapser_.groups_.find(key_);
+  if (it != collapser_.groups_.end() && it->second == this) {
+    collapser_.groups_.erase(it);
+  }
+  body_.move();
+}
+
+void RequestCollapser::Group::releaseAll() {
+  close();
+  forEachFollower([this](Follower* follower) {
+    remove(follower);
+    follower->onCollapseReleased();
+  });
+}
+
+void RequestCollapser::Group::timeoutExpired() noexcept {
+  VLOG(4) << "No response for " << key_ << " within the wait, releasing "
+          << followers_.size() << " followers";
+  releaseAll();
+}
+
+bool RequestCollapser::Group::shareHeaders(const HTTPMessage& msg) {
+  if (msg.getStatusCode() < 200) {
+    // Only final responses are shared
+    return false;
+  }
+  cancelTimeout();
+  if (isPersonal(msg)) {
+    releaseAll();
+    return false;
+  }
+  return true;
+}
+
+void RequestCollapser::Group::sendHeaders(const HTTPMessage& msg) {
+  if (!shareHeaders(msg)) {
+    return;
+  }
+  if (open_) {
+    headers_ = std::make_unique<HTTPMessage>(msg);
+  }
+  forEachFollower(
+      [&msg](Follower* follower) { follower->onCollapsedHeaders(msg); });
+}
+
+void RequestCollapser::Group::sendHeaders(std::unique_ptr<HTTPMessage> msg) {
+  if (!shareHeaders(*msg)) {
+    return;
+  }
+  forEachFollower(
+      [&msg](Follower* follower) { follower->onCollapsedHeaders(*msg); });
+  if (open_) {
+    headers_ = std::move(msg);
+  }
+}
+
+void RequestCollapser::Group::sendBody(const folly::IOBuf& chain) {
+  if (open_) {
+    body_.append(chain.clone());
+    if (body_.chainLength() > collapser_.options_.maxReplayBytes) {
+      close();
+    }
+  }
+  forEachFollower([&chain](Follower* follower) {
+    follower->onCollapsedBody(chain.clone());
+  });
+}
+
+void RequestCollapser::Group::sendTrailers(const HTTPHeaders& trailers) {
+  if (open_) {
+    trailers_ = std::make_unique<HTTPHeaders>(trailers);
+  }
+  forEachFollower([&trailers](Follower* follower) {
+    follower->onCollapsedTrailers(trailers);
+  });
+}
+
+void RequestCollapser::Group::sendEOM() {
+  done_ = true;
+  close();
+  forEachFollower([this](Follower* follower) {
+    remove(follower);
+    follower->onCollapsedEOM();
+  });
+}
+
+void RequestCollapser::Group::sendAbort() {
+  done_ = true;
+  if (!headers_) {
+    releaseAll();
+    return;
+  }
+  close();
+  forEachFollower([this](Follower* follower) {
+    remove(follower);
+    follower->onCollapsedError();
+  });
+}
+
+RequestCollapser::RequestCollapser(folly::EventBase* evb, Options options)
+    : evb_(evb), options_(std::move(options)) {
+}
+
+RequestCollapser::~RequestCollapser() {
+  // The groups outliving the collapser take no more followers
+  auto groups = std::move(groups_);
+  for (auto& group : groups) {
+    group.second->open_ = false;
+    group.second->cancelTimeout();
+  }
+}
+
+bool RequestCollapser::isCollapsible(const HTTPMessage& request) const {
+  auto method = request.getMethod();
+  if (method != HTTPMethod::GET && method != HTTPMethod::HEAD) {
+    return false;
+  }
+  const auto& headers = request.getHeaders();
+  const auto& length = headers.getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH);
+  if (request.getIsChunked() || (!length.empty() && length != "0")) {
+    return false;
+  }
+  for (auto name : kPersonalHeaders) {
+    if (headers.exists(name) &&
+        std::find(options_.keyHeaders.begin(),
+                  options_.keyHeaders.end(),
+                  name) == options_.keyHeaders.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string RequestCollapser::makeKey(const HTTPMessage& request) const {
+  const auto& headers = request.getHeaders();
+  auto key = folly::to<std::string>(request.getMethodString(),
+                                    " ",
+                                    request.isSecure() ? "https://" : "http://",
+                                    headers.getSingleOrEmpty(HTTP_HEADER_HOST),
+                                    request.getURL());
+  for (const auto& name : options_.keyHeaders) {
+    folly::toAppend("\n", name, ": ", headers.combine(name), &key);
+  }
+  return key;
+}
+
+bool RequestCollapser::follow(const std::string& key, Follower* follower) {
+  auto it = groups_.find(key);
+  if (it == groups_.end()) {
+    return false;
+  }
+  auto group = it->second;
+  if (group->followers_.size() >= options_.maxFollowers) {
+    return false;
+  }
+  numCollapsed_++;
+  group->add(follower);
+  return true;
+}
+
+void RequestCollapser::unfollow(Follower* follower) {
+  if (follower->group_) {
+    follower->group_->remove(follower);
+  }
+}
+
+void RequestCollapser::setFollowerPaused(Follower* follower, bool paused) {
+  if (follower->group_) {
+    follower->group_->setPaused(follower, paused);
+  }
+}
+
+std::shared_ptr<RequestCollapser::Group> RequestCollapser::lead(
+    const std::string& key) {
+  if (groups_.count(key)) {
+    return nullptr;
+  }
+  std::shared_ptr<Group> group(new Group(*this, key));
+  groups_.emplace(key, group.get());
+  evb_->timer().scheduleTimeout(group.get(), options_.maxWait);
+  return group;
+}
+
+} // namespace proxygen
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+
+#include <folly/Function.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+namespace proxygen {
+
+/**
+ * Collapses identical requests in flight to an upstream: the first one, the
+ * leader, is sent, and the others follow it, getting its response as it
+ * streams, with the body cloned rather than copied.
+ *
+ * Requests are identical if they have the same method, Host, URL and
+ * keyHeaders.  Only GETs and HEADs without a body, credentials, cookies or
+ * ranges are collapsed, unless those headers are keyHeaders.
+ *
+ * A group takes followers until its leader's response completes, up to
+ * maxFollowers, and as long as the body so far, replayed to late
+ * followers, is within maxReplayBytes.  Followers without response headers
+ * after maxWait are released, to send their request themselves, as are
+ * those of a leader failing before its response, or getting a personal
+ * one (with Set-Cookie, or private or no-store).
+ *
+ * A follower slow to send the response pauses the upstream ingress of the
+ * leader, through its pause callback, until it drains.
+ *
+ * Only used from the thread of its EventBase.
+ */
+class RequestCollapser {
+ public:
+  struct Options {
+    // Lower case
+    std::vector<std::string> keyHeaders{"accept", "accept-encoding"};
+    size_t maxFollowers{100};
+    std::chrono::milliseconds maxWait{std::chrono::milliseconds(1000)};
+    size_t maxReplayBytes{1024 * 1024};
+  };
+
+  class Group;
+
+  class Follower {
+   public:
+    virtual ~Follower() = default;
+
+    virtual void onCollapsedHeaders(const HTTPMessage& msg) noexcept = 0;
+    virtual void onCollapsedBody(
+        std::unique_ptr<folly::IOBuf> chain) noexcept = 0;
+    virtual void onCollapsedTrailers(const HTTPHeaders& trailers) noexcept = 0;
+    virtual void onCollapsedEOM() noexcept = 0;
+    // The response of the leader failed after its headers
+    virtual void onCollapsedError() noexcept = 0;
+    // Before any response: the follower should send its request itself
+    virtual void onCollapseReleased() noexcept = 0;
+
+   private:
+    friend class RequestCollapser;
+    friend class Group;
+    Group* group_{nullptr};
+  };
+
+  /**
+   * The request of a leader and its followers.  The leader passes it its
+   * response, and must end it with sendEOM() or sendAbort().
+   */
+  class Group : private folly::HHWheelTimer::Callback {
+   public:
+    ~Group() override;
+
+    void sendHeaders(const HTTPMessage& msg);
+    // Kept for late followers without a copy
+    void sendHeaders(std::unique_ptr<HTTPMessage> msg);
+    void sendBody(const folly::IOBuf& chain);
+    void sendTrailers(const HTTPHeaders& trailers);
+    void sendEOM();
+    void sendAbort();
+
+    // Called with true once a follower is over its buffer, and with false
+    // once none is
+    void setPauseCallback(folly::Function<void(bool)> callback) {
+      pauseCallback_ = std::move(callback);
+    }
+
+    size_t getNumFollowers() const {
+      return followers_.size();
+    }
+
+   private:
+    friend class RequestCollapser;
+
+    Group(RequestCollapser& collapser, std::string key);
+
+    void timeoutExpired() noexcept override;
+
+    void add(Follower* follower);
+    void remove(Follower* follower);
+    bool isFollower(Follower* follower) const;
+    void setPaused(Follower* follower, bool paused);
+    // No new followers from now on
+    void close();
+    void releaseAll();
+    // False unless the followers are to get these headers
+    bool shareHeaders(const HTTPMessage& msg);
+    // Calls fn on each follower still in the group
+    template <typename F>
+    void forEachFollower(F&& fn);
+
+    RequestCollapser& collapser_;
+    const std::string key_;
+    std::vector<Follower*> followers_;
+    std::vector<Follower*> paused_;
+    folly::Function<void(bool)> pauseCallback_;
+    // For the followers joining late
+    std::unique_ptr<HTTPMessage> headers_;
+    folly::IOBufQueue body_{folly::IOBufQueue::cacheChainLength()};
+    std::unique_ptr<HTTPHeaders> trailers_;
+    bool open_{true};
+    bool done_{false};
+  };
+
+  RequestCollapser(folly::EventBase* evb, Options options);
+  ~RequestCollapser();
+
+  bool isCollapsible(const HTTPMessage& request) const;
+
+  std::string makeKey(const HTTPMessage& request) const;
+
+  /**
+   * Adds follower to the open group of key, if any, replaying the response
+   * so far.  False if there is none or it is full.
+   */
+  bool follow(const std::string& key, Follower* follower);
+
+  // Removes follower from its group, e.g. once its client is gone
+  void unfollow(Follower* follower);
+
+  // The follower's client is over (or back under) its buffer limit
+  void setFollowerPaused(Follower* follower, bool paused);
+
+  /**
+   * The new group of key for the caller to lead, or nullptr if there is
+   * already one.
+   */
+  std::shared_ptr<Group> lead(const std::string& key);
+
+  size_t getNumGroups() const {
+    return groups_.size();
+  }
+
+  uint64_t getNumCollapsed() const {
+    return numCollapsed_;
+  }
+
+ private:
+  folly::EventBase* evb_;
+  const Options options_;
+  // The open groups
+  std::unordered_map<std::string, Group*> groups_;
+  uint64_t numCollapsed_{0};
+};
+
+} // namespace proxygen
@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/RequestHedger.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/DelayedDestruction.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/http/HTTPException.h>
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace proxygen {
+
+RetryBudget::RetryBudget(double ratio, double maxTokens)
+    : ratio_(std::llround(ratio * 1000)),
+      maxTokens_(std::llround(maxTokens * 1000)),
+      milliTokens_(maxTokens_) {
+}
+
+void RetryBudget::onRequest() {
+  auto tokens = milliTokens_.load(std::memory_order_relaxed);
+  while (tokens < maxTokens_ &&
+         !milliTokens_.compare_exchange_weak(
+             tokens,
+             std::min(tokens + ratio_, maxTokens_),
+             std::memory_order_relaxed)) {
+  }
+}
+
+bool RetryBudget::tryAcquire() {
+  auto tokens = milliTokens_.load(std::memory_order_relaxed);
+  while (tokens >= 1000) {
+    if (milliTokens_.compare_exchange_weak(
+            tokens, tokens - 1000, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * One attempt of a request.  It deletes itself once its transaction is
+ * detached, or the UpstreamManager fails to open one; the request forgets
+ * it as soon as it fails, wins, or is aborted.
+ */
+class RequestHedger::Attempt
+    : public HTTPTransaction::Handler
+    , public UpstreamManager::Callback {
+ public:
+  Attempt(Request* request, UpstreamManager& upstream)
+      : request_(request), upstream_(upstream), startTime_(getCurrentTime()) {
+  }
+
+  // Forgets the request, aborting the transaction unless it won
+  void detach(bool abort) {
+    request_ = nullptr;
+    if (txn_) {
+      if (abort) {
+        txn_->sendAbort();
+      }
+    } else {
+      upstream_.cancel(this);
+      delete this;
+    }
+  }
+
+  TimePoint getStartTime() const {
+    return startTime_;
+  }
+
+  void onTransaction(HTTPTransaction* txn) noexcept override;
+
+  void onTransactionError(
+      const folly::exception_wrapper& error) noexcept override {
+    fail(error);
+    delete this;
+  }
+
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+
+  void detachTransaction() noexcept override {
+    HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS,
+                     "Transaction detached before the response");
+    ex.setProxygenError(kErrorEOF);
+    fail(folly::make_exception_wrapper<HTTPException>(std::move(ex)));
+    delete this;
+  }
+
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override;
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+  void onEOM() noexcept override;
+
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept override {
+  }
+
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+
+  void onError(const HTTPException& error) noexcept override {
+    fail(folly::make_exception_wrapper<HTTPException>(error));
+  }
+
+  void onEgressPaused() noexcept override {
+  }
+
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  void fail(folly::exception_wrapper error);
+
+  Request* request_;
+  UpstreamManager& upstream_;
+  const TimePoint startTime_;
+  HTTPTransaction* txn_{nullptr};
+};
+
+class RequestHedger::Request
+    : public folly::DelayedDestruction
+    , public folly::HHWheelTimer::Callback {
+ public:
+  Request(RequestHedger& parent,
+          const HTTPMessage& request,
+          std::unique_ptr<folly::IOBuf> body,
+          std::vector<Endpoint> endpoints,
+          Callback* cb)
+      : parent_(parent),
+        request_(request),
+        body_(std::move(body)),
+        endpoints_(std::move(endpoints)),
+        cb_(cb),
+        idempotent_(isIdempotent(request)) {
+  }
+
+  Callback* getCallback() const {
+    return cb_;
+  }
+
+  const HTTPMessage& getMessage() const {
+    return request_;
+  }
+
+  const folly::IOBuf* getBody() const {
+    return body_.get();
+  }
+
+  void start() {
+    DestructorGuard dg(this);
+    sendAttempt();
+    scheduleHedge();
+  }
+
+  // Aborts every attempt without invoking the callback
+  void cancel() {
+    finish();
+  }
+
+  void timeoutExpired() noexcept override {
+    DestructorGuard dg(this);
+    if (done_ || winner_ || !canSendAttempt()) {
+      return;
+    }
+    if (!parent_.budget_->tryAcquire()) {
+      VLOG(4) << "No budget to hedge " << request_.getURL();
+      return;
+    }
+    parent_.numHedges_++;
+    sendAttempt();
+    scheduleHedge();
+  }
+
+  void callbackCanceled() noexcept override {
+  }
+
+  void onAttemptHeaders(Attempt* attempt, std::unique_ptr<HTTPMessage> msg) {
+    DCHECK(!winner_);
+    winner_ = attempt;
+    cancelTimeout();
+    parent_.recordLatency(std::chrono::duration_cast<microseconds>(
+        getCurrentTime() - attempt->getStartTime()));
+    response_ = std::move(msg);
+    abortAttempts();
+  }
+
+  void onAttemptBody(std::unique_ptr<folly::IOBuf> chain) {
+    responseBody_.append(std::move(chain));
+  }
+
+  void onAttemptEOM() {
+    DestructorGuard dg(this);
+    auto cb = cb_;
+    finish();
+    cb->onResponse(std::move(response_), responseBody_.move());
+  }
+
+  void onAttemptError(Attempt* attempt, const folly::exception_wrapper& error) {
+    DestructorGuard dg(this);
+    attempts_.erase(std::remove(attempts_.begin(), attempts_.end(), attempt),
+                    attempts_.end());
+    if (attempt == winner_) {
+      winner_ = nullptr;
+      fail(error);
+      return;
+    }
+    if (!attempts_.empty()) {
+      // The others may still succeed
+      return;
+    }
+    if (parent_.options_.retryOnError && canSendAttempt() &&
+        parent_.budget_->tryAcquire()) {
+      VLOG(4) << "Retrying " << request_.getURL() << " after "
+              << error.what();
+      cancelTimeout();
+      sendAttempt();
+      scheduleHedge();
+      return;
+    }
+    fail(error);
+  }
+
+ private:
+  ~Request() override {
+    DCHECK(attempts_.empty());
+  }
+
+  bool canSendAttempt() const {
+    return idempotent_ && numAttempts_ <= parent_.options_.maxHedges &&
+           numAttempts_ < endpoints_.size();
+  }
+
+  void sendAttempt() {
+    auto attempt = new Attempt(this, parent_.upstream_);
+    attempts_.push_back(attempt);
+    const auto& endpoint = endpoints_[numAttempts_++];
+    parent_.upstream_.getTransaction(endpoint, attempt, attempt, idempotent_);
+  }
+
+  void scheduleHedge() {
+    if (done_ || winner_ || !canSendAttempt()) {
+      return;
+    }
+    parent_.upstream_.getEventBase()->timer().scheduleTimeout(
+        this, parent_.getHedgeDelay());
+  }
+
+  // Aborts the attempts but the winner
+  void abortAttempts() {
+    auto attempts = std::move(attempts_);
+    attempts_.clear();
+    for (auto attempt : attempts) {
+      if (attempt == winner_) {
+        attempts_.push_back(attempt);
+      } else {
+        attempt->detach(/*abort=*/true);
+      }
+    }
+  }
+
+  void fail(const folly::exception_wrapper& error) {
+    auto cb = cb_;
+    finish();
+    cb->onError(error);
+  }
+
+  void finish() {
+    DCHECK(!done_);
+    done_ = true;
+    cancelTimeout();
+    abortAttempts();
+    if (winner_) {
+      // Left to complete the transaction by itself
+      winner_->detach(/*abort=*/false);
+      winner_ = nullptr;
+      attempts_.clear();
+    }
+    parent_.onRequestDone(this);
+  }
+
+  RequestHedger& parent_;
+  const HTTPMessage request_;
+  const std::unique_ptr<folly::IOBuf> body_;
+  const std::vector<Endpoint> endpoints_;
+  Callback* const cb_;
+  const bool idempotent_;
+  std::vector<Attempt*> attempts_;
+  size_t numAttempts_{0};
+  // The attempt that got the response headers first
+  Attempt* winner_{nullptr};
+  std::unique_ptr<HTTPMessage> response_;
+  folly::IOBufQueue responseBody_{folly::IOBufQueue::cacheChainLength()};
+  bool done_{false};
+};
+
+void RequestHedger::Attempt::onTransaction(HTTPTransaction* txn) noexcept {
+  DCHECK_EQ(txn, txn_);
+  if (!request_) {
+    txn->sendAbort();
+    return;
+  }
+  const auto& request = request_->getMessage();
+  auto body = request_->getBody();
+  if (!body) {
+    txn->sendHeadersWithEOM(request);
+    return;
+  }
+  txn->sendHeaders(request);
+  txn->sendBody(body->clone());
+  txn->sendEOM();
+}
+
+void RequestHedger::Attempt::onHeadersComplete(
+    std::unique_ptr<HTTPMessage> msg) noexcept {
+  if (request_ && msg->getStatusCode() >= 200) {
+    request_->onAttemptHeaders(this, std::move(msg));
+  }
+}
+
+void RequestHedger::Attempt::onBody(
+    std::unique_ptr<folly::IOBuf> chain) noexcept {
+  if (request_) {
+    request_->onAttemptBody(std::move(chain));
+  }
+}
+
+void RequestHedger::Attempt::onEOM() noexcept {
+  if (request_) {
+    // Detaches this attempt
+    request_->onAttemptEOM();
+  }
+}
+
+void RequestHedger::Attempt::fail(folly::exception_wrapper error) {
+  if (!request_) {
+    return;
+  }
+  auto request = request_;
+  request_ = nullptr;
+  request->onAttemptError(this, error);
+}
+
+RequestHedger::RequestHedger(UpstreamManager& upstream, Options options)
+    : upstream_(upstream),
+      options_(std::move(options)),
+      budget_(options_.budget ? options_.budget
+                              : std::make_shared<RetryBudget>()) {
+  latencies_.reserve(options_.latencySamples);
+}
+
+RequestHedger::~RequestHedger() {
+  while (!requests_.empty()) {
+    (*requests_.begin())->cancel();
+  }
+}
+
+void RequestHedger::send(const HTTPMessage& request,
+                         std::unique_ptr<folly::IOBuf> body,
+                         std::vector<Endpoint> endpoints,
+                         Callback* cb) {
+  CHECK(!endpoints.empty());
+  budget_->onRequest();
+  auto req =
+      new Request(*this, request, std::move(body), std::move(endpoints), cb);
+  requests_.insert(req);
+  req->start();
+}
+
+void RequestHedger::cancel(Callback* cb) {
+  std::vector<Request*> canceled;
+  for (auto request : requests_) {
+    if (request->getCallback() == cb) {
+      canceled.push_back(request);
+    }
+  }
+  for (auto request : canceled) {
+    request->cancel();
+  }
+}
+
+milliseconds RequestHedger::getHedgeDelay() {
+  if (latencies_.empty()) {
+    return options_.initialDelay;
+  }
+  // Recomputed once a tenth of the samples are new
+  if (!hedgeDelay_ ||
+      latenciesSinceUpdate_ >= std::max<size_t>(latencies_.size() / 10, 1)) {
+    auto sorted = latencies_;
+    auto index = std::min(size_t(sorted.size() * options_.delayPercentile),
+                          sorted.size() - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    hedgeDelay_ = std::clamp(
+        std::chrono::duration_cast<milliseconds>(sorted[index]),
+        options_.minDelay,
+        options_.maxDelay);
+    latenciesSinceUpdate_ = 0;
+  }
+  return *hedgeDelay_;
+}
+
+bool RequestHedger::isIdempotent(const HTTPMessage& request) {
+  auto method = request.getMethod();
+  if (!method) {
+    return false;
+  }
+  switch (*method) {
+    case HTTPMethod::GET:
+    case HTTPMethod::HEAD:
+    case HTTPMethod::OPTIONS:
+    case HTTPMethod::TRACE:
+    case HTTPMethod::PUT:
+    case HTTPMethod::DELETE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void RequestHedger::recordLatency(microseconds latency) {
+  if (options_.latencySamples == 0) {
+    return;
+  }
+  if (latencies_.size() < options_.latencySamples) {
+    latencies_.push_back(latency);
+  } else {
+    latencies_[nextLatency_] = latency;
+    nextLatency_ = (nextLatency_ + 1) % latencies_.size();
+  }
+  latenciesSinceUpdate_++;
+}
+
+void RequestHedger::onRequestDone(Request* request) {
+  requests_.erase(request);
+  request->destroy();
+}
+
+} // namespace proxygen
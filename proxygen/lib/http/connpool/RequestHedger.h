@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <unordered_set>
+
+#include <proxygen/lib/http/connpool/UpstreamManager.h>
+
+namespace proxygen {
+
+/**
+ * A budget for the retries and hedges of many requests, so they can't
+ * multiply the load of a degraded upstream: every request adds ratio
+ * tokens, up to maxTokens, and every retry or hedge takes one.  It starts
+ * full.
+ *
+ * It is thread safe, one budget may be shared by the hedgers of every
+ * thread.
+ */
+class RetryBudget {
+ public:
+  explicit RetryBudget(double ratio = 0.1, double maxTokens = 10);
+
+  void onRequest();
+
+  // Takes a token if there is one
+  bool tryAcquire();
+
+  double getTokens() const {
+    return double(milliTokens_.load(std::memory_order_relaxed)) / 1000;
+  }
+
+ private:
+  const int64_t ratio_;
+  const int64_t maxTokens_;
+  // In thousandths of a token
+  std::atomic<int64_t> milliTokens_;
+};
+
+/**
+ * Sends requests through an UpstreamManager, hedging the slow ones: when
+ * an idempotent request has no response after the hedge delay, the same
+ * request is sent to the next endpoint.  The first response wins and the
+ * other attempts are aborted.  An attempt failing before any response is
+ * retried on the next endpoint right away.
+ *
+ * The hedge delay is the delayPercentile of the latencies to the response
+ * headers of the last latencySamples requests, within [minDelay, maxDelay],
+ * so only the stragglers are hedged.  Hedges and retries each take a token
+ * of the RetryBudget, and aren't sent once it is empty.
+ *
+ * The response is buffered and passed to the callback with its body.  Like
+ * UpstreamManager it can only be used from one thread.
+ */
+class RequestHedger {
+ public:
+  struct Options {
+    double delayPercentile{0.95};
+    std::chrono::milliseconds minDelay{std::chrono::milliseconds(5)};
+    std::chrono::milliseconds maxDelay{std::chrono::milliseconds(1000)};
+    // Until latencies are recorded
+    std::chrono::milliseconds initialDelay{std::chrono::milliseconds(50)};
+    size_t latencySamples{1000};
+    // Attempts after the first, both hedges and retries
+    uint32_t maxHedges{1};
+    bool retryOnError{true};
+    // Shared by many hedgers. Each hedger makes its own when null.
+    std::shared_ptr<RetryBudget> budget;
+  };
+
+  class Callback {
+   public:
+    virtual ~Callback() {
+    }
+    virtual void onResponse(std::unique_ptr<HTTPMessage> response,
+                            std::unique_ptr<folly::IOBuf> body) noexcept = 0;
+    // Every attempt failed, with the last error
+    virtual void onError(const folly::exception_wrapper& error) noexcept = 0;
+  };
+
+  RequestHedger(UpstreamManager& upstream, Options options);
+  // Cancels the requests in flight
+  ~RequestHedger();
+
+  RequestHedger(const RequestHedger&) = delete;
+  RequestHedger& operator=(const RequestHedger&) = delete;
+
+  /**
+   * Sends request with body to endpoints[0], then hedges over the next
+   * endpoints.  Requests that aren't idempotent get one attempt.  cb is
+   * invoked once, unless the request is canceled.
+   */
+  void send(const HTTPMessage& request,
+            std::unique_ptr<folly::IOBuf> body,
+            std::vector<Endpoint> endpoints,
+            Callback* cb);
+
+  // Aborts the requests of cb. Its callbacks won't be invoked.
+  void cancel(Callback* cb);
+
+  std::chrono::milliseconds getHedgeDelay();
+
+  // The latencies of the responses are recorded, others may be added
+  void recordLatency(std::chrono::microseconds latency);
+
+  size_t getNumRequests() const {
+    return requests_.size();
+  }
+
+  uint64_t getNumHedges() const {
+    return numHedges_;
+  }
+
+  // GET, HEAD, OPTIONS, TRACE, PUT and DELETE
+  static bool isIdempotent(const HTTPMessage& request);
+
+ private:
+  class Attempt;
+  class Request;
+
+  void onRequestDone(Request* request);
+
+  UpstreamManager& upstream_;
+  const Options options_;
+  std::shared_ptr<RetryBudget> budget_;
+  std::unordered_set<Request*> requests_;
+  // Ring of the latest latencies
+  std::vector<std::chrono::microseconds> latencies_;
+  size_t nextLatency_{0};
+  size_t latenciesSinceUpdate_{0};
+  folly::Optional<std::chrono::milliseconds> hedgeDelay_;
+  uint64_t numHedges_{0};
+};
+
+} // namespace proxygen
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/ReuseTracker.h>
+
+#include <folly/Bits.h>
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+namespace proxygen {
+
+size_t ReuseTracker::getBucket(std::chrono::milliseconds idleTime) {
+  if (idleTime.count() <= 0) {
+    return 0;
+  }
+  return std::min<size_t>(
+      folly::findLastSet(static_cast<uint64_t>(idleTime.count())),
+      kNumBuckets - 1);
+}
+
+void ReuseTracker::recordReuse(std::chrono::milliseconds idleTime,
+                               bool succeeded) {
+  auto& bucket = buckets_[getBucket(idleTime)];
+  if (bucket.reuses >= options_.maxSamples) {
+    bucket.reuses /= 2;
+    bucket.failures /= 2;
+  }
+  bucket.reuses++;
+  if (!succeeded) {
+    bucket.failures++;
+  }
+}
+
+void ReuseTracker::onResponse(const HTTPMessage& response) {
+  const auto& keepAlive =
+      response.getHeaders().getSingleOrEmpty(HTTP_HEADER_KEEP_ALIVE);
+  if (keepAlive.empty()) {
+    return;
+  }
+  // timeout=5, max=100
+  std::vector<folly::StringPiece> params;
+  folly::split(',', keepAlive, params);
+  for (auto param : params) {
+    param = folly::trimWhitespace(param);
+    if (param.removePrefix("timeout=")) {
+      if (auto seconds = folly::tryTo<uint32_t>(param)) {
+        keepAliveTimeout_ = std::chrono::seconds(*seconds);
+      }
+    }
+  }
+}
+
+folly::Optional<double> ReuseTracker::getReuseProbability(
+    std::chrono::milliseconds idleTime) const {
+  const auto& bucket = buckets_[getBucket(idleTime)];
+  if (bucket.reuses == 0 || bucket.reuses < options_.minSamples) {
+    return folly::none;
+  }
+  return 1.0 - static_cast<double>(bucket.failures) / bucket.reuses;
+}
+
+bool ReuseTracker::shouldReuse(std::chrono::milliseconds idleTime) const {
+  if (keepAliveTimeout_ &&
+      idleTime + options_.keepAliveMargin >= *keepAliveTimeout_) {
+    return false;
+  }
+  auto probability = getReuseProbability(idleTime);
+  return !probability || *probability >= options_.minReuseProbability;
+}
+
+} // namespace proxygen
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include <folly/Optional.h>
+
+namespace proxygen {
+
+class HTTPMessage;
+
+/**
+ * Estimates, for the origin of one SessionPool, the probability that a
+ * session still works after being idle for a given time, so the pool can
+ * drain the sessions the origin is about to close rather than send on them.
+ *
+ * Reuses of idle sessions are counted in buckets of idle time, powers of
+ * two of milliseconds.  A reuse fails when the read side hits EOF or a
+ * reset before the first response, which is how an origin closing an idle
+ * connection shows.  A bucket's counts are halved as they reach
+ * maxSamples, so the estimate follows origin configuration changes.  The
+ * timeout an origin advertises in Keep-Alive response headers caps the
+ * idle time outright.
+ */
+class ReuseTracker {
+ public:
+  struct Options {
+    // Below this an idle session is drained instead of reused
+    double minReuseProbability{0.9};
+    // Reuses a bucket needs before its estimate counts
+    uint32_t minSamples{20};
+    uint32_t maxSamples{1000};
+    // Taken off an advertised Keep-Alive timeout, for the request's trip
+    std::chrono::milliseconds keepAliveMargin{std::chrono::seconds(1)};
+  };
+
+  ReuseTracker() = default;
+
+  explicit ReuseTracker(Options options) : options_(options) {
+  }
+
+  void recordReuse(std::chrono::milliseconds idleTime, bool succeeded);
+
+  // Learns the timeout of a Keep-Alive header in response
+  void onResponse(const HTTPMessage& response);
+
+  // None until the bucket of idleTime has minSamples reuses
+  folly::Optional<double> getReuseProbability(
+      std::chrono::milliseconds idleTime) const;
+
+  bool shouldReuse(std::chrono::milliseconds idleTime) const;
+
+  folly::Optional<std::chrono::milliseconds> getKeepAliveTimeout() const {
+    return keepAliveTimeout_;
+  }
+
+ private:
+  // Bucket b > 0 holds the idle times in [2^(b-1), 2^b) ms, the last one
+  // everything from about 70 minutes
+  static constexpr size_t kNumBuckets = 24;
+
+  static size_t getBucket(std::chrono::milliseconds idleTime);
+
+  struct Bucket {
+    uint32_t reuses{0};
+    uint32_t failures{0};
+  };
+
+  Options options_;
+  std::array<Bucket, kNumBuckets> buckets_{};
+  folly::Optional<std::chrono::milliseconds> keepAliveTimeout_;
+};
+
+} // namespace proxygen
@@ -8,19 +8,33 @@
 
 #include <proxygen/lib/http/connpool/ServerIdleSessionController.h>
 
+#include <algorithm>
+#include <limits>
+
+#include <folly/Optional.h>
+
+namespace {
+// Claims can lose races against other thieves or the owner reusing the
+// session; give up after a few rather than spin
+constexpr int kMaxStealAttempts = 4;
+} // namespace
+
 namespace proxygen {
 
-folly::Future<HTTPSessionBase*> ServerIdleSessionController::getIdleSession() {
-  folly::Promise<HTTPSessionBase*> promise;
-  folly::Future<HTTPSessionBase*> future = promise.getFuture();
-  SessionPool* maxPool = nullptr;
+ServerIdleSessionController::~ServerIdleSessionController() {
+  auto numPools = getNumPools();
+  for (size_t i = 0; i < numPools; ++i) {
+    delete pools_[i].load(std::memory_order_acquire);
+  }
+}
 
-  {
-    std::lock_guard<std::mutex> lock(lock_);
-    maxPool = popBestIdlePool();
-    if (markedForDeath_ || !maxPool || !maxPool->getEventBase()) {
-      return folly::makeFuture<HTTPSessionBase*>(nullptr);
-    }
+folly::Future<HTTPSessionBase*> ServerIdleSessionController::getIdleSession() {
+  if (isMarkedForDeath()) {
+    return folly::makeFuture<HTTPSessionBase*>(nullptr);
+  }
+  SessionPool* maxPool = popBestIdlePool();
+  if (!maxPool || !maxPool->getEventBase()) {
+    return folly::makeFuture<HTTPSessionBase*>(nullptr);
   }
 
   if (maxPool->getEventBase()->isInEventBaseThread()) {
@@ -28,6 +42,8 @@ folly::Future<HTTPSessionBase*> ServerIdleSessionController::getIdleSession() {
     return folly::makeFuture<HTTPSessionBase*>(nullptr);
   }
 
+  folly::Promise<HTTPSessionBase*> promise;
+  folly::Future<HTTPSessionBase*> future = promise.getFuture();
   maxPool->getEventBase()->runInEventBaseThread(
       [this, maxPool, promise = std::move(promise)]() mutable {
         // Caller (in this case Server::getTransaction()) needs to guarantee
@@ -44,45 +60,244 @@ folly::Future<HTTPSessionBase*> ServerIdleSessionController::getIdleSession() {
 
 void ServerIdleSessionController::addIdleSession(const HTTPSessionBase* session,
                                                  SessionPool* sessionPool) {
-  std::lock_guard<std::mutex> lock(lock_);
-  if (sessionMap_.find(session) != sessionMap_.end()) {
+  if (isMarkedForDeath()) {
+    return;
+  }
+  auto pool = getOrCreatePool(sessionPool);
+  if (!pool) {
+    return;
+  }
+  bool exists = false;
+  pool->forEachSlot([&](IdleSlot& slot) {
+    exists = slot.session.load(std::memory_order_relaxed) == session;
+    return exists;
+  });
+  if (exists) {
     // removeIdleSession should've been called before re-adding
     LOG(ERROR) << "Session " << session << " already exists!";
     return;
   }
-  if (sessionsByIdleAge_.size() < maxIdleCount_) {
-    auto newIt = sessionsByIdleAge_.insert(sessionsByIdleAge_.end(),
-                                           {session, sessionPool});
-    sessionMap_[session] = newIt;
+
+  // Reserve room under the server wide limit first
+  auto numIdle = numIdle_.load(std::memory_order_relaxed);
+  do {
+    if (numIdle >= maxIdleCount_.load(std::memory_order_relaxed)) {
+      return;
+    }
+  } while (!numIdle_.compare_exchange_weak(
+      numIdle, numIdle + 1, std::memory_order_relaxed));
+
+  auto idleSeq = nextIdleSeq_.fetch_add(1, std::memory_order_relaxed);
+  // Counted before the slot is filled so that thieves never take more
+  // sessions than numIdle says there are
+  pool->numIdle.fetch_add(1, std::memory_order_relaxed);
+  fillSlot(*pool, session, idleSeq);
+}
+
+void ServerIdleSessionController::fillSlot(PoolIdleSessions& pool,
+                                           const HTTPSessionBase* session,
+                                           uint64_t idleSeq) {
+  IdleSlot* free = nullptr;
+  SlotChunk* last = nullptr;
+  for (auto chunk = &pool.firstChunk; chunk && !free;
+       chunk = chunk->next.load(std::memory_order_acquire)) {
+    last = chunk;
+    for (auto& slot : chunk->slots) {
+      if (slot.session.load(std::memory_order_relaxed) == nullptr) {
+        free = &slot;
+        break;
+      }
+    }
+  }
+  if (!free) {
+    // numIdle_ bounds the sessions in use, so chunks stop growing once
+    // there are enough for maxIdleCount
+    auto chunk = new SlotChunk();
+    free = &chunk->slots[0];
+    last->next.store(chunk, std::memory_order_release);
+  }
+  // Only this thread fills slots, so the slot stays empty until then
+  free->idleSeq.store(idleSeq, std::memory_order_relaxed);
+  free->session.store(session, std::memory_order_release);
+}
+
+void ServerIdleSessionController::removeIdleSession(
+    const HTTPSessionBase* session, const SessionPool* sessionPool) {
+  if (auto pool = findPool(sessionPool)) {
+    pool->forEachSlot(
+        [&](IdleSlot& slot) { return takeSlot(*pool, slot, session); });
   }
 }
 
 void ServerIdleSessionController::removeIdleSession(
     const HTTPSessionBase* session) {
-  std::lock_guard<std::mutex> lock(lock_);
-  auto it = sessionMap_.find(session);
-  if (it != sessionMap_.end()) {
-    sessionsByIdleAge_.erase(it->second);
-    sessionMap_.erase(it);
+  auto numPools = getNumPools();
+  for (size_t i = 0; i < numPools; ++i) {
+    auto pool = pools_[i].load(std::memory_order_acquire);
+    if (!pool) {
+      continue;
+    }
+    bool found = false;
+    pool->forEachSlot([&](IdleSlot& slot) {
+      found = takeSlot(*pool, slot, session);
+      return found;
+    });
+    if (found) {
+      return;
+    }
+  }
+}
+
+void ServerIdleSessionController::removePool(const SessionPool* sessionPool) {
+  auto pool = findPool(sessionPool);
+  if (!pool) {
+    return;
   }
+  pool->forEachSlot([&](IdleSlot& slot) {
+    takeSlot(*pool, slot, slot.session.load(std::memory_order_acquire));
+    return false;
+  });
+  // The entry and its chunks are reused by the next pool created
+  pool->pool.store(nullptr, std::memory_order_release);
 }
 
 void ServerIdleSessionController::markForDeath() {
-  std::lock_guard<std::mutex> lock(lock_);
-  markedForDeath_ = true;
-  sessionMap_.clear();
-  sessionsByIdleAge_.clear();
+  markedForDeath_.store(true, std::memory_order_release);
+  auto numPools = getNumPools();
+  for (size_t i = 0; i < numPools; ++i) {
+    auto pool = pools_[i].load(std::memory_order_acquire);
+    if (!pool) {
+      continue;
+    }
+    pool->forEachSlot([&](IdleSlot& slot) {
+      takeSlot(*pool, slot, slot.session.load(std::memory_order_acquire));
+      return false;
+    });
+  }
 }
 
-// must be called under lock_
 SessionPool* FOLLY_NULLABLE ServerIdleSessionController::popBestIdlePool() {
-  if (!sessionsByIdleAge_.empty()) {
-    auto ret = *sessionsByIdleAge_.begin();
-    sessionsByIdleAge_.erase(sessionsByIdleAge_.begin());
-    sessionMap_.erase(ret.session);
-    return ret.sessionPool;
+  for (int attempt = 0; attempt < kMaxStealAttempts; ++attempt) {
+    auto pool = findVictimPool();
+    if (!pool) {
+      return nullptr;
+    }
+    IdleSlot* oldest = nullptr;
+    const HTTPSessionBase* session = nullptr;
+    pool->forEachSlot([&](IdleSlot& slot) {
+      auto slotSession = slot.session.load(std::memory_order_acquire);
+      if (slotSession &&
+          (!oldest || slot.idleSeq.load(std::memory_order_relaxed) <
+                          oldest->idleSeq.load(std::memory_order_relaxed))) {
+        oldest = &slot;
+        session = slotSession;
+      }
+      return false;
+    });
+    if (oldest && takeSlot(*pool, *oldest, session)) {
+      // Null if the pool went away meanwhile
+      if (auto owner = pool->pool.load(std::memory_order_acquire)) {
+        return owner;
+      }
+    }
   }
   return nullptr;
 }
 
+ServerIdleSessionController::PoolIdleSessions* FOLLY_NULLABLE
+ServerIdleSessionController::findPool(const SessionPool* sessionPool) const {
+  auto numPools = getNumPools();
+  for (size_t i = 0; i < numPools; ++i) {
+    auto pool = pools_[i].load(std::memory_order_acquire);
+    if (pool && pool->pool.load(std::memory_order_acquire) == sessionPool) {
+      return pool;
+    }
+  }
+  return nullptr;
+}
+
+ServerIdleSessionController::PoolIdleSessions* FOLLY_NULLABLE
+ServerIdleSessionController::getOrCreatePool(SessionPool* sessionPool) {
+  // Only sessionPool's thread creates its entry, so there is no race with
+  // another creation for the same pool
+  if (auto pool = findPool(sessionPool)) {
+    return pool;
+  }
+  auto numPools = getNumPools();
+  for (size_t i = 0; i < numPools; ++i) {
+    auto pool = pools_[i].load(std::memory_order_acquire);
+    SessionPool* unused = nullptr;
+    if (pool && pool->pool.compare_exchange_strong(
+                    unused, sessionPool, std::memory_order_acq_rel)) {
+      return pool;
+    }
+  }
+  auto index = numPools_.fetch_add(1, std::memory_order_acq_rel);
+  if (index >= kMaxPools) {
+    LOG_FIRST_N(ERROR, 1) << "Too many session pools, not sharing the idle "
+                          << "sessions of " << sessionPool;
+    return nullptr;
+  }
+  auto pool = new PoolIdleSessions(sessionPool);
+  pools_[index].store(pool, std::memory_order_release);
+  return pool;
+}
+
+ServerIdleSessionController::PoolIdleSessions* FOLLY_NULLABLE
+ServerIdleSessionController::findVictimPool() const {
+  PoolIdleSessions* best = nullptr;
+  uint32_t bestIdle = 0;
+  folly::Optional<uint64_t> bestSeq;
+  auto oldestSeq = [](PoolIdleSessions& pool) {
+    auto seq = std::numeric_limits<uint64_t>::max();
+    pool.forEachSlot([&](IdleSlot& slot) {
+      if (slot.session.load(std::memory_order_relaxed)) {
+        seq = std::min(seq, slot.idleSeq.load(std::memory_order_relaxed));
+      }
+      return false;
+    });
+    return seq;
+  };
+
+  auto numPools = getNumPools();
+  for (size_t i = 0; i < numPools; ++i) {
+    auto pool = pools_[i].load(std::memory_order_acquire);
+    if (!pool) {
+      continue;
+    }
+    auto numIdle = pool->numIdle.load(std::memory_order_acquire);
+    if (numIdle == 0 || numIdle < bestIdle) {
+      continue;
+    }
+    if (numIdle == bestIdle) {
+      // Only compare ages on ties
+      if (!bestSeq) {
+        bestSeq = oldestSeq(*best);
+      }
+      auto seq = oldestSeq(*pool);
+      if (seq >= *bestSeq) {
+        continue;
+      }
+      bestSeq = seq;
+    } else {
+      bestSeq.reset();
+    }
+    best = pool;
+    bestIdle = numIdle;
+  }
+  return best;
+}
+
+bool ServerIdleSessionController::takeSlot(PoolIdleSessions& pool,
+                                           IdleSlot& slot,
+                                           const HTTPSessionBase* session) {
+  if (!session || !slot.session.compare_exchange_strong(
+                      session, nullptr, std::memory_order_acq_rel)) {
+    return false;
+  }
+  pool.numIdle.fetch_sub(1, std::memory_order_release);
+  numIdle_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
 } // namespace proxygen
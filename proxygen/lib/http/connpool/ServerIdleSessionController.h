@@ -10,6 +10,10 @@
 
 #include <proxygen/lib/http/connpool/SessionPool.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+
 #include <folly/futures/Future.h>
 
 namespace proxygen {
@@ -20,12 +24,20 @@ namespace proxygen {
  *
  * Server class uses it to move idle transactions between threads, if necessary.
  * All public methods are thread-safe.
+ *
+ * Every SessionPool (thread) publishes its idle sessions in its own set of
+ * slots, which grows up to maxIdleCount. A thread that misses its local
+ * pool steals from the pool with the most idle sessions, taking the oldest
+ * one on ties, with atomic operations only: there is no lock shared between
+ * threads. The slots of a destroyed pool go to the next pool created.
  */
 class ServerIdleSessionController {
  public:
   explicit ServerIdleSessionController() {
   }
 
+  ~ServerIdleSessionController();
+
   /**
    * Transfer idle session from another thread, if available.
    * Returns nullptr if nothing is available.
@@ -34,10 +46,20 @@ class ServerIdleSessionController {
 
   /**
    * Add/remove session info (called by SessionPool when state changes).
+   * Must be called from the thread of sessionPool.
    */
   void addIdleSession(const HTTPSessionBase* session, SessionPool* sessionPool);
+  void removeIdleSession(const HTTPSessionBase* session,
+                         const SessionPool* sessionPool);
+  // Slower variant that looks for the session in every pool
   void removeIdleSession(const HTTPSessionBase* session);
 
+  /**
+   * Called by a SessionPool being destroyed, from its thread, after it
+   * removed its idle sessions.
+   */
+  void removePool(const SessionPool* sessionPool);
+
   /**
    * Stop all session transfers.
    */
@@ -47,46 +69,98 @@ class ServerIdleSessionController {
    * Resize idle pool.
    */
   void setMaxIdleCount(unsigned int maxIdleCount) {
-    std::lock_guard<std::mutex> lock(lock_);
-    maxIdleCount_ = maxIdleCount;
+    maxIdleCount_.store(maxIdleCount, std::memory_order_relaxed);
   }
 
  protected:
-  struct IdleSessionInfo {
-    const HTTPSessionBase* session;
-    SessionPool* sessionPool;
+  // Bound on the number of live pools (threads) tracked
+  static constexpr size_t kMaxPools = 256;
+  // Slots are added this many at a time
+  static constexpr size_t kSlotsPerChunk = 16;
+
+  struct IdleSlot {
+    std::atomic<const HTTPSessionBase*> session{nullptr};
+    // Order in which the sessions became idle, only used to pick the oldest
+    std::atomic<uint64_t> idleSeq{0};
   };
 
-  using IdleSessionList = std::list<IdleSessionInfo>;
-  using IdleSessionListIter = IdleSessionList::iterator;
+  // Only freed with the controller, since other threads may be reading it
+  struct SlotChunk {
+    ~SlotChunk() {
+      delete next.load(std::memory_order_relaxed);
+    }
+
+    std::array<IdleSlot, kSlotsPerChunk> slots;
+    std::atomic<SlotChunk*> next{nullptr};
+  };
+
+  /**
+   * Idle sessions of one SessionPool, or of none when pool is null. Only the
+   * pool's thread fills slots and adds chunks, any thread may empty slots.
+   */
+  struct PoolIdleSessions {
+    explicit PoolIdleSessions(SessionPool* sessionPool) : pool(sessionPool) {
+    }
+
+    // Until fn returns true
+    template <typename F>
+    void forEachSlot(F&& fn) {
+      for (auto chunk = &firstChunk; chunk;
+           chunk = chunk->next.load(std::memory_order_acquire)) {
+        for (auto& slot : chunk->slots) {
+          if (fn(slot)) {
+            return;
+          }
+        }
+      }
+    }
+
+    std::atomic<SessionPool*> pool;
+    std::atomic<uint32_t> numIdle{0};
+    SlotChunk firstChunk;
+  };
 
   /**
    * Find available session pool (thread) to tranfer an idle session from.
-   * Remove it from the map.
+   * Remove its oldest idle session from the slots.
    */
   SessionPool* FOLLY_NULLABLE popBestIdlePool();
 
   bool isMarkedForDeath() {
-    std::lock_guard<std::mutex> lock(lock_);
-    return markedForDeath_;
+    return markedForDeath_.load(std::memory_order_acquire);
   }
 
-  std::mutex lock_;
-  /*
-   * List of idle sessions. Normally, addIdleSession() adds to the end and
-   * popBestIdlePool() removes from the beginning, thus keeping the list sorted
-   * by idle age.
-   * Additionally, we also support arbitrary removals if some session stops
-   * being idle or dies or gets re-used out of order if many threads attempt
-   * session transfer at the same time.
-   */
-  IdleSessionList sessionsByIdleAge_;
-  // Store iterators in sessionsByIdleAge_ to be able to find sessions.
-  std::unordered_map<const HTTPSessionBase*, IdleSessionListIter> sessionMap_;
-  bool markedForDeath_{false};
+ private:
+  size_t getNumPools() const {
+    return std::min(numPools_.load(std::memory_order_acquire), kMaxPools);
+  }
+
+  PoolIdleSessions* FOLLY_NULLABLE findPool(const SessionPool* pool) const;
+  // Reusing the entry of a destroyed pool if there is one
+  PoolIdleSessions* FOLLY_NULLABLE getOrCreatePool(SessionPool* pool);
+
+  // Fills a free slot of pool, adding a chunk if they are all in use
+  void fillSlot(PoolIdleSessions& pool,
+                const HTTPSessionBase* session,
+                uint64_t idleSeq);
+
+  // The pool with the most idle sessions, preferring the oldest on ties
+  PoolIdleSessions* FOLLY_NULLABLE findVictimPool() const;
+
+  // Empties slot if it still holds session, updating the counters
+  bool takeSlot(PoolIdleSessions& pool,
+                IdleSlot& slot,
+                const HTTPSessionBase* session);
+
+  std::array<std::atomic<PoolIdleSessions*>, kMaxPools> pools_{};
+  std::atomic<size_t> numPools_{0};
+  // Idle sessions published across all pools
+  std::atomic<uint32_t> numIdle_{0};
+  std::atomic<uint64_t> nextIdleSeq_{0};
+  std::atomic<bool> markedForDeath_{false};
 
   // Default idle pool size to 2.
-  unsigned int maxIdleCount_{2};
+  std::atomic<unsigned int> maxIdleCount_{2};
 };
 
 } // namespace proxygen
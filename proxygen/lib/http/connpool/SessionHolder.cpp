@@ -63,6 +63,24 @@ HTTPTransaction* SessionHolder::newTransaction(
   return session_->newTransaction(handler);
 }
 
+HTTPTransaction* SessionHolder::newPipelinedTransaction(
+    HTTPTransaction::Handler* handler) {
+  return session_->newPipelinedTransaction(handler);
+}
+
+void SessionHolder::onReuse(std::chrono::milliseconds idleTime) {
+  if (reuseTracker_) {
+    reuseIdleTime_ = idleTime;
+  }
+}
+
+void SessionHolder::recordReuse(bool succeeded) {
+  if (reuseIdleTime_) {
+    reuseTracker_->recordReuse(*reuseIdleTime_, succeeded);
+    reuseIdleTime_.reset();
+  }
+}
+
 std::chrono::steady_clock::time_point SessionHolder::getLastUseTime() const {
   return lastUseTime_;
 }
@@ -159,11 +177,21 @@ void SessionHolder::onCreate(const HTTPSessionBase&) {
 
 void SessionHolder::onIngressError(const HTTPSessionBase& session,
                                    ProxygenError error) {
+  if (stats_) {
+    stats_->onIngressError(error);
+  }
+  if (error == kErrorConnectionReset) {
+    recordReuse(false);
+  }
   if (originalSessionInfoCb_) {
     originalSessionInfoCb_->onIngressError(session, error);
   }
 }
 
+void SessionHolder::onIngressEOF() {
+  recordReuse(false);
+}
+
 void SessionHolder::onRead(const HTTPSessionBase& session, size_t bytesRead) {
   onRead(session, bytesRead, folly::none);
 }
@@ -236,6 +264,13 @@ void SessionHolder::onDestroy(const HTTPSessionBase& session) {
 
 void SessionHolder::onIngressMessage(const HTTPSessionBase& session,
                                      const HTTPMessage& msg) {
+  if (stats_) {
+    stats_->onIngressMessage(msg);
+  }
+  if (reuseTracker_) {
+    reuseTracker_->onResponse(msg);
+    recordReuse(true);
+  }
   if (originalSessionInfoCb_) {
     originalSessionInfoCb_->onIngressMessage(session, msg);
   }
@@ -331,6 +366,13 @@ void SessionHolder::onSettingsAck(const HTTPSessionBase& sess) {
   }
 }
 
+void SessionHolder::onOrigin(const HTTPSessionBase& sess,
+                             const std::vector<std::string>& origins) {
+  if (originalSessionInfoCb_) {
+    originalSessionInfoCb_->onOrigin(sess, origins);
+  }
+}
+
 void SessionHolder::describe(std::ostream& os) const {
   const auto transport = session_->getTransport();
   if (!transport) {
@@ -11,6 +11,7 @@
 #include <folly/IntrusiveList.h>
 #include <proxygen/lib/http/ProxygenErrorEnum.h>
 #include <proxygen/lib/http/connpool/Endpoint.h>
+#include <proxygen/lib/http/connpool/ReuseTracker.h>
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 
 namespace proxygen {
@@ -47,6 +48,12 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
     virtual void onConnectionDeactivated() = 0;
     virtual void onRead(size_t bytesRead) = 0;
     virtual void onWrite(size_t bytesWritten) = 0;
+    // Passive signals of the server's health: its messages and the errors
+    // reading from it
+    virtual void onIngressMessage(const HTTPMessage& /*msg*/) {
+    }
+    virtual void onIngressError(ProxygenError /*error*/) {
+    }
   };
 
   explicit SessionHolder(HTTPSessionBase*,
@@ -78,6 +85,19 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
 
   const HTTPSessionBase& getSession() const;
   HTTPTransaction* newTransaction(HTTPTransaction::Handler* upstreamHandler);
+  HTTPTransaction* newPipelinedTransaction(
+      HTTPTransaction::Handler* upstreamHandler);
+
+  // Reports the Keep-Alive timeouts of the responses and the reuses
+  void setReuseTracker(ReuseTracker* reuseTracker) {
+    reuseTracker_ = reuseTracker;
+  }
+
+  /**
+   * The session was just taken out of the idle list after idleTime: its
+   * first response, or an EOF or reset before, is recorded as the outcome.
+   */
+  void onReuse(std::chrono::milliseconds idleTime);
   void drain();
 
   /**
@@ -115,8 +135,7 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
   // HTTPSession::InfoCallback
   void onCreate(const HTTPSessionBase&) override;
   void onIngressError(const HTTPSessionBase&, ProxygenError) override;
-  void onIngressEOF() override {
-  }
+  void onIngressEOF() override;
   void onRead(const HTTPSessionBase&, size_t bytesRead) override;
   void onRead(const HTTPSessionBase& sess,
               size_t bytesRead,
@@ -142,6 +161,8 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
   void onEgressBufferCleared(const HTTPSessionBase&) override;
   void onSettings(const HTTPSessionBase&, const SettingsList&) override;
   void onSettingsAck(const HTTPSessionBase&) override;
+  void onOrigin(const HTTPSessionBase&,
+                const std::vector<std::string>& origins) override;
 
   // Hook in the first session pool list.
   folly::SafeIntrusiveListHook listHook;
@@ -151,6 +172,7 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
 
  private:
   void handleTransactionDetached();
+  void recordReuse(bool succeeded);
 
   enum class ListState {
     DETACHED = 0,
@@ -167,6 +189,9 @@ class SessionHolder : private HTTPSessionBase::InfoCallback {
   ListState state_{ListState::DETACHED};
   Endpoint endpoint_;
   HTTPSessionBase::InfoCallback* originalSessionInfoCb_;
+  ReuseTracker* reuseTracker_{nullptr};
+  // Set from onReuse() until the outcome is known
+  folly::Optional<std::chrono::milliseconds> reuseIdleTime_;
 };
 typedef folly::CountedIntrusiveList<SessionHolder, &SessionHolder::listHook>
     SessionList;
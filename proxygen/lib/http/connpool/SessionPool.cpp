@@ -11,7 +11,9 @@
 #include <proxygen/lib/http/connpool/ThreadIdleSessionController.h>
 
 #include <chrono>
+#include <cmath>
 #include <folly/io/async/EventBaseManager.h>
+#include <proxygen/lib/utils/Time.h>
 
 namespace proxygen {
 
@@ -33,10 +35,17 @@ SessionPool::SessionPool(
 }
 
 SessionPool::~SessionPool() {
+  while (!waiters_.empty()) {
+    auto waiter = popWaiter(waiters_.begin());
+    waiter->callback(nullptr);
+  }
   drainSessionList(idleSessionList_);
   drainSessionList(unfilledSessionList_);
   drainSessionList(fullSessionList_);
   DCHECK(empty());
+  if (serverIdleSessionController_) {
+    serverIdleSessionController_->removePool(this);
+  }
 }
 
 void SessionPool::setMaxIdleSessions(uint32_t num) {
@@ -77,6 +86,17 @@ uint32_t SessionPool::getNumSessions() const {
          fullSessionList_.size();
 }
 
+uint64_t SessionPool::getNumOutgoingTransactions() const {
+  // Idle sessions have none
+  uint64_t transactions = 0;
+  for (auto list : {&unfilledSessionList_, &fullSessionList_}) {
+    for (auto& holder : *list) {
+      transactions += holder.getSession().getNumOutgoingStreams();
+    }
+  }
+  return transactions;
+}
+
 bool SessionPool::empty() const {
   return idleSessionList_.empty() && unfilledSessionList_.empty() &&
          fullSessionList_.empty();
@@ -87,6 +107,7 @@ void SessionPool::putSession(HTTPSessionBase* session) {
     // Constructing the session holder automatically puts it on the
     // correct list (one of [idle, unfilled, full])
     auto holder = new SessionHolder(session, this, stats_);
+    holder->setReuseTracker(reuseTracker_.get());
     holder->link();
   } else {
     // this is equivalent to what happens in SessionHolder::link which is
@@ -99,15 +120,116 @@ void SessionPool::putSession(HTTPSessionBase* session) {
 }
 
 HTTPTransaction* SessionPool::getTransaction(
-    HTTPTransaction::Handler* upstreamHandler) {
-  auto txn = attemptOpenTransaction(upstreamHandler, unfilledSessionList_);
+    HTTPTransaction::Handler* upstreamHandler, bool idempotent) {
+  HTTPTransaction* txn = nullptr;
+  if (leastLoaded_) {
+    txn = attemptOpenLeastLoadedTransaction(upstreamHandler);
+  } else {
+    txn = attemptOpenTransaction(upstreamHandler, unfilledSessionList_);
+  }
   if (!txn) {
     purgeExcessIdleSessions();
     txn = attemptOpenTransaction(upstreamHandler, idleSessionList_);
   }
+  if (!txn && idempotent && maxPipelineDepth_ > 1) {
+    txn = attemptPipelineTransaction(upstreamHandler);
+  }
   return txn;
 }
 
+bool SessionPool::waitForTransaction(HTTPTransaction::Handler* handler,
+                                     WaitCallback callback,
+                                     std::chrono::milliseconds timeout,
+                                     uint8_t priority,
+                                     bool idempotent) {
+  if (waiters_.size() >= maxWaiters_) {
+    waitStats_.rejected++;
+    return false;
+  }
+  auto waiter = std::make_unique<Waiter>(
+      *this, handler, std::move(callback), idempotent);
+  auto raw = waiter.get();
+  // Equal priorities insert at the upper bound, so FIFO
+  raw->pos = waiters_.emplace(priority, std::move(waiter));
+  evb_->timer().scheduleTimeout(raw, timeout);
+  // In case a transaction is available already
+  scheduleServeWaiters();
+  return true;
+}
+
+bool SessionPool::cancelWait(HTTPTransaction::Handler* handler) {
+  for (auto it = waiters_.begin(); it != waiters_.end(); ++it) {
+    if (it->second->handler == handler) {
+      popWaiter(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::unique_ptr<SessionPool::Waiter> SessionPool::popWaiter(
+    WaitQueue::iterator it) {
+  auto waiter = std::move(it->second);
+  waiters_.erase(it);
+  waiter->cancelTimeout();
+  return waiter;
+}
+
+void SessionPool::scheduleServeWaiters() {
+  if (!waiters_.empty() && !serveWaitersCallback_.isLoopCallbackScheduled()) {
+    evb_->runInLoop(&serveWaitersCallback_);
+  }
+}
+
+void SessionPool::serveWaiters() {
+  while (!waiters_.empty()) {
+    auto it = waiters_.begin();
+    auto txn = getTransaction(it->second->handler, it->second->idempotent);
+    if (!txn) {
+      return;
+    }
+    auto waiter = popWaiter(it);
+    waitStats_.served++;
+    recordQueueTime(*waiter);
+    waiter->callback(txn);
+  }
+}
+
+void SessionPool::onWaitTimeout(Waiter& waiter) {
+  auto owned = popWaiter(waiter.pos);
+  waitStats_.timedOut++;
+  recordQueueTime(*owned);
+  owned->callback(nullptr);
+}
+
+void SessionPool::recordQueueTime(const Waiter& waiter) {
+  auto queueTime = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - waiter.start);
+  waitStats_.totalQueueTime += queueTime;
+  waitStats_.maxQueueTime = std::max(waitStats_.maxQueueTime, queueTime);
+}
+
+void SessionPool::recordRequest(std::chrono::steady_clock::time_point now) {
+  requestCount_ = getDecayedRequestCount(now) + 1;
+  lastRequestTime_ = std::max(lastRequestTime_, now);
+}
+
+double SessionPool::getRequestRate(
+    std::chrono::steady_clock::time_point now) const {
+  return getDecayedRequestCount(now) /
+         std::chrono::duration<double>(requestRateWindow_).count();
+}
+
+double SessionPool::getDecayedRequestCount(
+    std::chrono::steady_clock::time_point now) const {
+  if (requestCount_ == 0 || now <= lastRequestTime_) {
+    return requestCount_;
+  }
+  auto elapsed = std::chrono::duration<double>(now - lastRequestTime_) /
+                 std::chrono::duration<double>(requestRateWindow_);
+  return requestCount_ * std::exp(-elapsed);
+}
+
 void SessionPool::purgeExcessIdleSessions() {
   auto thresh = std::chrono::steady_clock::now() - getTimeout();
 
@@ -139,6 +261,31 @@ void SessionPool::drainAllSessions() {
   drainSessionList(fullSessionList_);
 }
 
+void SessionPool::drainAllSessions(std::chrono::milliseconds window,
+                                   folly::Function<void()> onDone) {
+  if (!drainScheduler_) {
+    drainScheduler_ = std::make_unique<DrainScheduler>(evb_, *this);
+  }
+  drainScheduler_->start(window, std::move(onDone));
+}
+
+void SessionPool::visit(
+    folly::FunctionRef<bool(const HTTPSessionBase&)> shouldDrain) {
+  // Draining unlinks and deletes the holder, so not while iterating
+  std::vector<SessionHolder*> holders;
+  for (auto list :
+       {&idleSessionList_, &unfilledSessionList_, &fullSessionList_}) {
+    for (auto& holder : *list) {
+      if (shouldDrain(holder.getSession())) {
+        holders.push_back(&holder);
+      }
+    }
+  }
+  for (auto holder : holders) {
+    holder->drain();
+  }
+}
+
 void SessionPool::closeWithReset() {
   closeSessionListWithReset(idleSessionList_);
   closeSessionListWithReset(unfilledSessionList_);
@@ -168,10 +315,25 @@ HTTPTransaction* SessionPool::attemptOpenTransaction(
       holder->drain(); // implicit unlink and delete
       continue;
     }
+    // Only sessions that served a request before count as reused
+    folly::Optional<std::chrono::milliseconds> idleTime;
+    if (reuseTracker_ && &list == &idleSessionList_ &&
+        holder->getSession().getNumTxnServed() > 0) {
+      idleTime = millisecondsSince(holder->getLastUseTime());
+      if (!reuseTracker_->shouldReuse(*idleTime)) {
+        VLOG(4) << "draining holder=" << *holder << " unlikely to be reusable"
+                << " after idleTime=" << idleTime->count();
+        holder->drain(); // implicit unlink and delete
+        continue;
+      }
+    }
     auto txn = holder->newTransaction(upstreamHandler);
     holder->unlink();
     holder->link();
     if (txn) {
+      if (idleTime) {
+        holder->onReuse(*idleTime);
+      }
       return txn;
     }
     // If we weren't able to get a transaction, then link() caused it to
@@ -180,6 +342,56 @@ HTTPTransaction* SessionPool::attemptOpenTransaction(
   return nullptr;
 }
 
+HTTPTransaction* SessionPool::attemptOpenLeastLoadedTransaction(
+    HTTPTransaction::Handler* upstreamHandler) {
+  while (!unfilledSessionList_.empty()) {
+    SessionHolder* holder = nullptr;
+    for (auto& candidate : unfilledSessionList_) {
+      if (!holder || candidate.getSession().getNumOutgoingStreams() <
+                         holder->getSession().getNumOutgoingStreams()) {
+        holder = &candidate;
+      }
+    }
+    if (holder->shouldAgeOut(maxAge_)) {
+      holder->drain(); // implicit unlink and delete
+      continue;
+    }
+    auto txn = holder->newTransaction(upstreamHandler);
+    holder->unlink();
+    holder->link();
+    if (txn) {
+      return txn;
+    }
+  }
+  return nullptr;
+}
+
+HTTPTransaction* SessionPool::attemptPipelineTransaction(
+    HTTPTransaction::Handler* upstreamHandler) {
+  SessionHolder* holder = nullptr;
+  auto headWait = maxPipelineHeadWait_;
+  for (auto& candidate : fullSessionList_) {
+    auto& session = candidate.getSession();
+    if (candidate.shouldAgeOut(maxAge_) ||
+        session.getNumOutgoingStreams() >= maxPipelineDepth_ ||
+        !session.canPipeline()) {
+      continue;
+    }
+    auto wait = session.getPipelineHeadWait();
+    if (wait < headWait) {
+      holder = &candidate;
+      headWait = wait;
+    }
+  }
+  if (!holder) {
+    return nullptr;
+  }
+  auto txn = holder->newPipelinedTransaction(upstreamHandler);
+  holder->unlink();
+  holder->link();
+  return txn;
+}
+
 // SessionHolder::Callback methods
 
 void SessionPool::detachIdle(SessionHolder* sess) {
@@ -189,7 +401,7 @@ void SessionPool::detachIdle(SessionHolder* sess) {
     threadIdleSessionController_->onDetachIdle(sess);
   }
   if (serverIdleSessionController_) {
-    serverIdleSessionController_->removeIdleSession(&sess->getSession());
+    serverIdleSessionController_->removeIdleSession(&sess->getSession(), this);
   }
 }
 
@@ -220,6 +432,7 @@ void SessionPool::attachIdle(SessionHolder* sess) {
       threadIdleSessionController_->onAttachIdle(sess);
     }
     purgeExcessIdleSessions();
+    scheduleServeWaiters();
   }
 }
 
@@ -227,6 +440,7 @@ void SessionPool::attachPartiallyFilled(SessionHolder* sess) {
   // round robin partially full sessions to reduce the chance of GOAWAY
   // race conditions from the server.
   unfilledSessionList_.push_back(*sess);
+  scheduleServeWaiters();
 }
 
 void SessionPool::attachFilled(SessionHolder* sess) {
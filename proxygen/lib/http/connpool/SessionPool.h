@@ -8,9 +8,14 @@
 
 #pragma once
 
+#include <folly/Function.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <map>
 
+#include <proxygen/lib/http/connpool/ReuseTracker.h>
 #include <proxygen/lib/http/connpool/SessionHolder.h>
+#include <proxygen/lib/http/session/DrainScheduler.h>
 
 namespace proxygen {
 
@@ -37,7 +42,9 @@ class ServerIdleSessionController;
  * closed any remaining sessions. Remember that this object must be
  * deleted in the event base thread it was used in.
  */
-class SessionPool : private SessionHolder::Callback {
+class SessionPool
+    : private SessionHolder::Callback
+    , private DrainScheduler::SessionSource {
  public:
   /**
    * Construct an empty SessionPool.
@@ -85,6 +92,64 @@ class SessionPool : private SessionHolder::Callback {
   void setTimeout(std::chrono::milliseconds);
   std::chrono::milliseconds getTimeout() const;
 
+  /**
+   * By default getTransaction() round robins over the partially filled
+   * sessions. With least loaded selection it picks the partially filled
+   * session with the fewest outgoing transactions instead.
+   */
+  void setLeastLoadedSelection(bool leastLoaded) {
+    leastLoaded_ = leastLoaded;
+  }
+
+  /**
+   * Lets getTransaction(handler, true) pipeline an idempotent request on a
+   * busy HTTP/1.1 session when no session is idle, behind at most
+   * maxDepth - 1 outstanding requests the oldest of which was sent less
+   * than maxHeadWait ago.  Of those sessions the one whose oldest request
+   * is the most recent is picked, so slow responses don't hold up the
+   * requests that could go behind fast ones.  A maxDepth of 1 disables.
+   */
+  void setPipelining(uint32_t maxDepth, std::chrono::milliseconds maxHeadWait) {
+    CHECK_GT(maxDepth, 0);
+    maxPipelineDepth_ = maxDepth;
+    maxPipelineHeadWait_ = maxHeadWait;
+  }
+
+  /**
+   * Tracks how likely the idle sessions put from now on are to still work
+   * after their idle time, and drains rather than reuses those unlikely to,
+   * see ReuseTracker.
+   */
+  void setReuseTracking(ReuseTracker::Options options) {
+    reuseTracker_ = std::make_unique<ReuseTracker>(options);
+  }
+
+  ReuseTracker* FOLLY_NULLABLE getReuseTracker() {
+    return reuseTracker_.get();
+  }
+
+  /**
+   * Counts one request for this pool's endpoint towards the request rate.
+   * The pool does not count getTransaction() calls itself, since callers
+   * may retry them.
+   */
+  void recordRequest(
+      std::chrono::steady_clock::time_point now =
+          std::chrono::steady_clock::now());
+
+  /**
+   * Returns the recorded requests per second, as an exponentially weighted
+   * moving average over the rate window: a request recorded one window ago
+   * weighs 1/e of a request recorded now.
+   */
+  double getRequestRate(std::chrono::steady_clock::time_point now =
+                            std::chrono::steady_clock::now()) const;
+
+  void setRequestRateWindow(std::chrono::milliseconds window) {
+    CHECK_GT(window.count(), 0);
+    requestRateWindow_ = window;
+  }
+
   /**
    * Returns the number of idle sessions. That is, sessions with no open
    * outgoing transactions.
@@ -114,6 +179,12 @@ class SessionPool : private SessionHolder::Callback {
    */
   uint32_t getNumSessions() const;
 
+  /**
+   * Returns the outgoing transactions open on the pooled sessions, the
+   * pool's load for RendezvousHash::getWithTwoChoices().
+   */
+  uint64_t getNumOutgoingTransactions() const;
+
   /**
    * Returns true if this SessionPool has no sessions in it. This implies
    * getNumSessions() == 0
@@ -146,10 +217,56 @@ class SessionPool : private SessionHolder::Callback {
    * use, but that can support more outgoing transactions.
    *
    * This function checks 'unfilledSessionList_' first. If no sessions are
-   * found, it checks idleSessionList_. If still no session is found,
-   * nullptr is returned.
+   * found, it checks idleSessionList_. If still no session is found and
+   * the request is idempotent, it tries pipelining on 'fullSessionList_',
+   * see setPipelining(). Else nullptr is returned.
+   */
+  HTTPTransaction* getTransaction(HTTPTransaction::Handler*,
+                                  bool idempotent = false);
+
+  // nullptr when the wait timed out or the pool was destroyed
+  using WaitCallback = folly::Function<void(HTTPTransaction* FOLLY_NULLABLE)>;
+
+  /**
+   * For when getTransaction() returned nullptr: queues handler until a
+   * pooled session can open a transaction for it, which is as soon as a
+   * full session frees a stream or a session is put in the pool.  Higher
+   * priority waiters are served first, FIFO within a priority.  callback
+   * runs from the event loop, with nullptr after timeout.
+   *
+   * False, without calling callback, when the queue is full: the caller
+   * should open a connection or fail the request.
    */
-  HTTPTransaction* getTransaction(HTTPTransaction::Handler*);
+  bool waitForTransaction(HTTPTransaction::Handler* handler,
+                          WaitCallback callback,
+                          std::chrono::milliseconds timeout,
+                          uint8_t priority = 0,
+                          bool idempotent = false);
+
+  // False if handler was not waiting.  Its callback is not called.
+  bool cancelWait(HTTPTransaction::Handler* handler);
+
+  void setMaxWaiters(size_t maxWaiters) {
+    maxWaiters_ = maxWaiters;
+  }
+
+  size_t getNumWaiters() const {
+    return waiters_.size();
+  }
+
+  struct WaitStats {
+    uint64_t served{0};
+    uint64_t timedOut{0};
+    // The queue was full
+    uint64_t rejected{0};
+    // Of the served and timed out waiters
+    std::chrono::microseconds totalQueueTime{0};
+    std::chrono::microseconds maxQueueTime{0};
+  };
+
+  const WaitStats& getWaitStats() const {
+    return waitStats_;
+  }
 
   /**
    * Remove oldest idle session from idleSessionList_.
@@ -161,6 +278,19 @@ class SessionPool : private SessionHolder::Callback {
    */
   void drainAllSessions();
 
+  /**
+   * Drains the sessions in the pool over window, see DrainScheduler, so the
+   * peer doesn't see them all reconnect at once.  Until their turn they keep
+   * serving transactions.
+   */
+  void drainAllSessions(std::chrono::milliseconds window,
+                        folly::Function<void()> onDone = nullptr);
+
+  // Empty unless drainAllSessions(window) was called
+  const DrainScheduler::Progress* FOLLY_NULLABLE getDrainProgress() const {
+    return drainScheduler_ ? &drainScheduler_->getProgress() : nullptr;
+  }
+
   /**
    * Immediately close the socket in both directions for all sessions in the
    * pool, discarding any queued writes that haven't yet been transferred to
@@ -180,6 +310,10 @@ class SessionPool : private SessionHolder::Callback {
    */
   void purgeExcessIdleSessions();
 
+  // The request count decayed to now, see getRequestRate()
+  double getDecayedRequestCount(
+      std::chrono::steady_clock::time_point now) const;
+
   /**
    * Calls drain() on all the sessions in the list and empties the list.
    */
@@ -197,6 +331,17 @@ class SessionPool : private SessionHolder::Callback {
   HTTPTransaction* attemptOpenTransaction(
       HTTPTransaction::Handler* upstreamHandler, SessionList& list);
 
+  /**
+   * Attempt to open a transaction on the partially filled session with the
+   * fewest outgoing transactions.
+   */
+  HTTPTransaction* attemptOpenLeastLoadedTransaction(
+      HTTPTransaction::Handler* upstreamHandler);
+
+  // Attempt to pipeline a transaction on a full HTTP/1.1 session
+  HTTPTransaction* attemptPipelineTransaction(
+      HTTPTransaction::Handler* upstreamHandler);
+
   // SessionHolder::Callback methods
   void detachIdle(SessionHolder*) override;
   void detachPartiallyFilled(SessionHolder*) override;
@@ -206,11 +351,75 @@ class SessionPool : private SessionHolder::Callback {
   void attachFilled(SessionHolder*) override;
   void addDrainingSession(HTTPSessionBase*) override;
 
+  struct Waiter;
+  using WaitQueue = std::multimap<uint8_t,
+                                  std::unique_ptr<Waiter>,
+                                  std::greater<uint8_t>>;
+
+  struct Waiter : public folly::HHWheelTimer::Callback {
+    Waiter(SessionPool& pool,
+           HTTPTransaction::Handler* handler,
+           WaitCallback callback,
+           bool idempotent)
+        : pool(pool),
+          handler(handler),
+          callback(std::move(callback)),
+          start(std::chrono::steady_clock::now()),
+          idempotent(idempotent) {
+    }
+
+    void timeoutExpired() noexcept override {
+      pool.onWaitTimeout(*this);
+    }
+
+    SessionPool& pool;
+    HTTPTransaction::Handler* const handler;
+    WaitCallback callback;
+    const std::chrono::steady_clock::time_point start;
+    const bool idempotent;
+    WaitQueue::iterator pos;
+  };
+
+  class ServeWaitersCallback : public folly::EventBase::LoopCallback {
+   public:
+    explicit ServeWaitersCallback(SessionPool& pool) : pool_(pool) {
+    }
+
+    void runLoopCallback() noexcept override {
+      pool_.serveWaiters();
+    }
+
+   private:
+    SessionPool& pool_;
+  };
+
+  // Serves the waiters from the next loop, outside the SessionHolder
+  // callbacks that free the streams
+  void scheduleServeWaiters();
+  void serveWaiters();
+  void onWaitTimeout(Waiter& waiter);
+  std::unique_ptr<Waiter> popWaiter(WaitQueue::iterator it);
+  void recordQueueTime(const Waiter& waiter);
+
+  // DrainScheduler::SessionSource
+  void visit(folly::FunctionRef<bool(const HTTPSessionBase&)> shouldDrain)
+      override;
+
   SessionHolder::Stats* stats_{nullptr};
   // Max number of connections stored in the pool.
   uint32_t maxConns_;
   std::chrono::milliseconds timeout_;
   std::chrono::milliseconds maxAge_;
+  bool leastLoaded_{false};
+  uint32_t maxPipelineDepth_{1};
+  std::chrono::milliseconds maxPipelineHeadWait_{0};
+  std::unique_ptr<ReuseTracker> reuseTracker_;
+
+  // Exponentially decayed number of recorded requests as of
+  // lastRequestTime_; divided by the window it is the request rate.
+  double requestCount_{0};
+  std::chrono::steady_clock::time_point lastRequestTime_;
+  std::chrono::milliseconds requestRateWindow_{std::chrono::seconds(10)};
 
   // List of all idle sessions in this SessionPool. Sessions
   // are sorted in descending order of lastUseTime in the list.
@@ -219,10 +428,10 @@ class SessionPool : private SessionHolder::Callback {
   // another transaction. Sessions are sorted in descending order of
   // lastUseTime in the list. Note that this list will never contain
   // sessions that are using a serial L7 protocol like HTTP/1.0 (and
-  // 1.1 since we don't support pipelining).
+  // 1.1, which only pipelines from the full list).
   SessionList unfilledSessionList_;
   // List of active sessions are full and cannot open any more
-  // transactions.
+  // transactions, other than pipelined ones.
   SessionList fullSessionList_;
   // Manages idle sessions for the same thread across servers.
   ThreadIdleSessionController* threadIdleSessionController_{nullptr};
@@ -230,6 +439,13 @@ class SessionPool : private SessionHolder::Callback {
   ServerIdleSessionController* serverIdleSessionController_{nullptr};
 
   folly::EventBase* const evb_{nullptr};
+
+  std::unique_ptr<DrainScheduler> drainScheduler_;
+
+  WaitQueue waiters_;
+  size_t maxWaiters_{1000};
+  WaitStats waitStats_;
+  ServeWaitersCallback serveWaitersCallback_{*this};
 };
 
 std::ostream& operator<<(std::ostream& os, const SessionPool& pool);
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/UnaryClient.h>
+
+#include <folly/Conv.h>
+#include <proxygen/lib/http/HTTPException.h>
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace proxygen {
+
+constexpr folly::StringPiece UnaryClient::kDeadlineHeader;
+
+folly::SemiFuture<UnaryClient::Response> UnaryClient::Call::start(
+    HTTPMessage request,
+    std::unique_ptr<folly::IOBuf> body,
+    steady_clock::time_point deadline) {
+  DCHECK(done_);
+  done_ = false;
+  promise_ = folly::Promise<Response>();
+  auto future = promise_.getSemiFuture();
+  auto left = std::chrono::ceil<milliseconds>(deadline - steady_clock::now());
+  if (left.count() <= 0) {
+    fail(kErrorTimeout, "Deadline passed before the request was sent");
+    client_.release(this);
+    return future;
+  }
+  if (!client_.pool_.getTransaction(this)) {
+    fail(kErrorConnect, "No pooled session to send the request on");
+    client_.release(this);
+    return future;
+  }
+  client_.evb_->timer().scheduleTimeout(this, left);
+  const auto& header = client_.options_.deadlineHeader;
+  if (!header.empty()) {
+    request.getHeaders().set(header, folly::to<std::string>(left.count()));
+  }
+  if (!body) {
+    txn_->sendHeadersWithEOM(request);
+    return future;
+  }
+  txn_->sendHeaders(request);
+  txn_->sendBody(std::move(body));
+  txn_->sendEOM();
+  return future;
+}
+
+void UnaryClient::Call::abort() {
+  if (!done_) {
+    fail(kErrorDropped, "Client destroyed before the response");
+  }
+  if (txn_) {
+    // Not to be detached from the transaction later
+    auto txn = txn_;
+    txn_ = nullptr;
+    txn->setHandler(nullptr);
+    txn->sendAbort();
+  }
+  client_.release(this);
+}
+
+void UnaryClient::Call::detachTransaction() noexcept {
+  txn_ = nullptr;
+  if (!done_) {
+    fail(kErrorEOF, "Transaction detached before the response");
+  }
+  client_.release(this);
+}
+
+void UnaryClient::Call::onHeadersComplete(
+    std::unique_ptr<HTTPMessage> msg) noexcept {
+  // Skips the 1xx
+  if (!done_ && msg->getStatusCode() >= 200) {
+    response_ = std::move(msg);
+  }
+}
+
+void UnaryClient::Call::onBody(std::unique_ptr<folly::IOBuf> chain) noexcept {
+  if (!done_) {
+    responseBody_.append(std::move(chain));
+  }
+}
+
+void UnaryClient::Call::onEOM() noexcept {
+  if (done_) {
+    return;
+  }
+  if (!response_) {
+    fail(kErrorParseHeader, "Message complete without a final response");
+    return;
+  }
+  complete(folly::Try<Response>(
+      Response{std::move(response_), responseBody_.move()}));
+}
+
+void UnaryClient::Call::onError(const HTTPException& error) noexcept {
+  if (!done_) {
+    complete(folly::Try<Response>(
+        folly::make_exception_wrapper<HTTPException>(error)));
+  }
+}
+
+void UnaryClient::Call::timeoutExpired() noexcept {
+  fail(kErrorTimeout, "Deadline passed before the response");
+  if (txn_) {
+    // Detaches it, now or once the session is done with it
+    txn_->sendAbort();
+  }
+}
+
+void UnaryClient::Call::fail(ProxygenError error, const std::string& what) {
+  HTTPException ex(HTTPException::Direction::INGRESS_AND_EGRESS, what);
+  ex.setProxygenError(error);
+  complete(folly::Try<Response>(
+      folly::make_exception_wrapper<HTTPException>(std::move(ex))));
+}
+
+void UnaryClient::Call::complete(folly::Try<Response> result) {
+  DCHECK(!done_);
+  done_ = true;
+  cancelTimeout();
+  response_.reset();
+  responseBody_.move();
+  // Moved out first, in case the continuation starts another call
+  auto promise = std::move(promise_);
+  promise.setTry(std::move(result));
+}
+
+UnaryClient::UnaryClient(SessionPool& pool,
+                         folly::EventBase* evb,
+                         Options options)
+    : pool_(pool), evb_(evb), options_(std::move(options)) {
+}
+
+UnaryClient::~UnaryClient() {
+  while (!active_.empty()) {
+    active_.front().abort();
+  }
+  while (!free_.empty()) {
+    auto call = &free_.front();
+    free_.pop_front();
+    delete call;
+  }
+}
+
+folly::SemiFuture<UnaryClient::Response> UnaryClient::call(
+    HTTPMessage request,
+    std::unique_ptr<folly::IOBuf> body,
+    steady_clock::time_point deadline) {
+  Call* call;
+  if (free_.empty()) {
+    call = new Call(*this);
+  } else {
+    call = &free_.front();
+    free_.pop_front();
+  }
+  active_.push_back(*call);
+  return call->start(std::move(request), std::move(body), deadline);
+}
+
+folly::SemiFuture<UnaryClient::Response> UnaryClient::call(
+    HTTPMessage request, std::unique_ptr<folly::IOBuf> body) {
+  return call(std::move(request),
+              std::move(body),
+              steady_clock::now() + options_.timeout);
+}
+
+folly::Optional<steady_clock::time_point> UnaryClient::getDeadline(
+    const HTTPMessage& request, folly::StringPiece header) {
+  const auto& value = request.getHeaders().getSingleOrEmpty(header);
+  auto ms = folly::tryTo<uint64_t>(value);
+  if (!ms) {
+    return folly::none;
+  }
+  return steady_clock::now() + milliseconds(*ms);
+}
+
+void UnaryClient::release(Call* call) {
+  active_.erase(active_.iterator_to(*call));
+  if (free_.size() < options_.maxPooledCalls) {
+    free_.push_back(*call);
+  } else {
+    delete call;
+  }
+}
+
+} // namespace proxygen
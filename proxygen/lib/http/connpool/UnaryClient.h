@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <folly/IntrusiveList.h>
+#include <folly/Optional.h>
+#include <folly/futures/Future.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/connpool/SessionPool.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+namespace proxygen {
+
+/**
+ * Unary requests over the sessions of a SessionPool: call() sends a request
+ * and returns a future of the whole response, which coroutines can
+ * co_await.  The transaction handlers are pooled, so once warm a call
+ * allocates nothing of its own but its future's state.
+ *
+ * Every call has a deadline.  Past it the request is aborted and the future
+ * fails with a kErrorTimeout HTTPException.  The time left is sent in
+ * milliseconds in the deadlineHeader, so that the server can bound its work
+ * and, with getDeadline(), pass the rest of it on to its own calls.
+ *
+ * Like SessionPool it can only be used from one thread, whose event base
+ * completes the futures.  Destroying it aborts the calls in flight.
+ */
+class UnaryClient {
+ public:
+  struct Options {
+    std::chrono::milliseconds timeout{std::chrono::milliseconds(1000)};
+    // Not sent when empty
+    std::string deadlineHeader{kDeadlineHeader};
+    // Idle handlers kept for the next calls
+    size_t maxPooledCalls{64};
+  };
+
+  struct Response {
+    std::unique_ptr<HTTPMessage> message;
+    // nullptr for an empty body
+    std::unique_ptr<folly::IOBuf> body;
+  };
+
+  static constexpr folly::StringPiece kDeadlineHeader{"X-Deadline-Ms"};
+
+  UnaryClient(SessionPool& pool, folly::EventBase* evb, Options options);
+  ~UnaryClient();
+
+  UnaryClient(const UnaryClient&) = delete;
+  UnaryClient& operator=(const UnaryClient&) = delete;
+
+  /**
+   * Sends request with body on a transaction of the pool.  The future fails
+   * with a kErrorConnect HTTPException at once when no pooled session can
+   * open one.  Final responses complete it, whatever their status.
+   */
+  folly::SemiFuture<Response> call(
+      HTTPMessage request,
+      std::unique_ptr<folly::IOBuf> body,
+      std::chrono::steady_clock::time_point deadline);
+
+  // With the default timeout from now
+  folly::SemiFuture<Response> call(
+      HTTPMessage request, std::unique_ptr<folly::IOBuf> body = nullptr);
+
+  /**
+   * The deadline a caller sent in header, if any, so that a server can
+   * propagate it to the calls made on behalf of request.
+   */
+  static folly::Optional<std::chrono::steady_clock::time_point> getDeadline(
+      const HTTPMessage& request, folly::StringPiece header = kDeadlineHeader);
+
+  size_t getNumCalls() const {
+    return active_.size();
+  }
+
+  size_t getNumPooledCalls() const {
+    return free_.size();
+  }
+
+ private:
+  // The handler of one call, pooled once its transaction is detached
+  class Call
+      : public HTTPTransaction::Handler
+      , public folly::HHWheelTimer::Callback {
+   public:
+    explicit Call(UnaryClient& client) : client_(client) {
+    }
+
+    folly::SemiFuture<Response> start(
+        HTTPMessage request,
+        std::unique_ptr<folly::IOBuf> body,
+        std::chrono::steady_clock::time_point deadline);
+
+    // Fails the call and abandons its transaction
+    void abort();
+
+    void setTransaction(HTTPTransaction* txn) noexcept override {
+      txn_ = txn;
+    }
+    void detachTransaction() noexcept override;
+    void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override;
+    void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override;
+    void onTrailers(
+        std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept override {
+    }
+    void onEOM() noexcept override;
+    void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+    }
+    void onError(const HTTPException& error) noexcept override;
+    void onEgressPaused() noexcept override {
+    }
+    void onEgressResumed() noexcept override {
+    }
+
+    void timeoutExpired() noexcept override;
+    void callbackCanceled() noexcept override {
+    }
+
+    folly::SafeIntrusiveListHook hook_;
+
+   private:
+    void fail(ProxygenError error, const std::string& what);
+    void complete(folly::Try<Response> result);
+
+    UnaryClient& client_;
+    folly::Promise<Response> promise_{folly::Promise<Response>::makeEmpty()};
+    HTTPTransaction* txn_{nullptr};
+    std::unique_ptr<HTTPMessage> response_;
+    folly::IOBufQueue responseBody_{folly::IOBufQueue::cacheChainLength()};
+    bool done_{true};
+  };
+  using CallList = folly::CountedIntrusiveList<Call, &Call::hook_>;
+
+  void release(Call* call);
+
+  SessionPool& pool_;
+  folly::EventBase* evb_;
+  const Options options_;
+  CallList active_;
+  CallList free_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,772 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/connpool/UpstreamManager.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <folly/Conv.h>
+#include <folly/Optional.h>
+#include <folly/TokenBucket.h>
+#include <folly/io/async/HHWheelTimer.h>
+
+#include <folly/io/async/EventBaseManager.h>
+#include <proxygen/lib/http/AltSvc.h>
+#include <folly/io/async/ssl/OpenSSLTransportCertificate.h>
+#include <openssl/x509v3.h>
+#include <proxygen/lib/http/session/HQSession.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+
+namespace proxygen {
+
+/**
+ * The SessionPool of one endpoint, plus the requests waiting for its
+ * connection attempt. At most one attempt is in flight at a time.
+ */
+class UpstreamManager::EndpointPool
+    : public HTTPConnector::Callback
+    , public HQConnector::Callback
+    , private folly::HHWheelTimer::Callback
+    , private HTTPSessionBase::InfoCallback {
+ public:
+  EndpointPool(UpstreamManager& parent, Endpoint endpoint)
+      : parent_(parent),
+        endpoint_(std::move(endpoint)),
+        outlierStats_(makeOutlierStats(parent.options_, endpoint_)),
+        pool_(outlierStats_ ? outlierStats_.get() : parent.options_.stats,
+              parent.options_.maxIdleSessionsPerEndpoint,
+              parent.options_.idleTimeout,
+              parent.options_.maxAge) {
+    pool_.setLeastLoadedSelection(true);
+    pool_.setRequestRateWindow(parent.options_.requestRateWindow);
+    scheduleWarm();
+  }
+
+  ~EndpointPool() override {
+    unregisterCoalescing();
+    cancelTimeout();
+    connector_.reset();
+    hqConnector_.reset();
+    for (auto session : earlySessions_) {
+      session->setInfoCallback(nullptr);
+      session->drain();
+    }
+    failWaiters(folly::make_exception_wrapper<std::runtime_error>(
+        "UpstreamManager destroyed"));
+  }
+
+  void getTransaction(HTTPTransaction::Handler* handler,
+                      Callback* cb,
+                      bool idempotent) {
+    pool_.recordRequest();
+    auto txn = pool_.getTransaction(handler);
+    if (!txn && idempotent) {
+      txn = getEarlyTransaction(handler);
+    }
+    if (!txn) {
+      txn = getCoalescedTransaction(handler);
+    }
+    if (txn) {
+      cb->onTransaction(txn);
+      return;
+    }
+    if (!admitWaiter()) {
+      cb->onTransactionError(folly::make_exception_wrapper<CircuitOpenError>(
+          "Circuit open for " + endpoint_.getHostname()));
+      return;
+    }
+    waiters_.push_back({handler, cb, idempotent});
+    maybeConnect();
+  }
+
+  void cancel(Callback* cb) {
+    waiters_.erase(std::remove_if(waiters_.begin(),
+                                  waiters_.end(),
+                                  [cb](const Waiter& waiter) {
+                                    return waiter.cb == cb;
+                                  }),
+                   waiters_.end());
+  }
+
+  void drain() {
+    pool_.drainAllSessions(parent_.options_.drainWindow);
+  }
+
+  const SessionPool& getSessionPool() const {
+    return pool_;
+  }
+
+  size_t getNumWaitingRequests() const {
+    return waiters_.size();
+  }
+
+  CircuitState getCircuitState() const {
+    if (circuit_ == CircuitState::OPEN &&
+        std::chrono::steady_clock::now() >= openUntil_) {
+      return CircuitState::HALF_OPEN;
+    }
+    return circuit_;
+  }
+
+  void disableCoalescing() {
+    coalescable_ = false;
+  }
+
+  void onAltSvc(folly::StringPiece value) {
+    bool had = getHTTP3Port().has_value();
+    h3Port_.reset();
+    for (const auto& service : parseAltSvc(value)) {
+      if (service.protocolId == "h3" &&
+          (service.host.empty() || service.host == endpoint_.getHostname())) {
+        h3Port_ = service.port;
+        h3Expiry_ = std::chrono::steady_clock::now() + service.maxAge;
+        break;
+      }
+    }
+    if (!had && getHTTP3Port() && !connecting_ && pool_.getNumSessions() > 0) {
+      // Upgrades the sessions already there
+      connect();
+    }
+  }
+
+  folly::Optional<uint16_t> getHTTP3Port() const {
+    auto now = std::chrono::steady_clock::now();
+    if (!h3Port_ || now >= h3Expiry_ || now < h3BrokenUntil_) {
+      return folly::none;
+    }
+    return h3Port_;
+  }
+
+  // HTTPConnector::Callback
+  void connectSuccess(HTTPUpstreamSession* session) override {
+    recordConnectTime(connector_->timeElapsed());
+    closeCircuit();
+    recordSecureConnect(session);
+    connecting_ = false;
+    onSession(session);
+  }
+  void connectError(const folly::AsyncSocketException& ex) override {
+    connecting_ = false;
+    recordConnectError();
+    recordCircuitFailure();
+    failWaiters(folly::make_exception_wrapper<folly::AsyncSocketException>(ex));
+  }
+
+  // HQConnector::Callback
+  void connectSuccess(HQUpstreamSession* session) override {
+    recordConnectTime(hqConnector_->timeElapsed());
+    closeCircuit();
+    connecting_ = false;
+    onSession(session);
+  }
+  void connectError(const quic::QuicErrorCode& code) override {
+    connecting_ = false;
+    if (parent_.options_.altSvcUpgrade) {
+      VLOG(3) << "QUIC to " << endpoint_.getHostname()
+              << " failed, falling back to TCP: " << quic::toString(code);
+      h3BrokenUntil_ = std::chrono::steady_clock::now() +
+                       parent_.options_.altSvcBrokenTimeout;
+      maybeConnect();
+      return;
+    }
+    recordConnectError();
+    recordCircuitFailure();
+    failWaiters(folly::make_exception_wrapper<std::runtime_error>(
+        quic::toString(code)));
+  }
+
+ private:
+  struct Waiter {
+    HTTPTransaction::Handler* handler;
+    Callback* cb;
+    bool idempotent;
+  };
+
+  // HTTPSessionBase::InfoCallback, only set on the early sessions
+  void onFullHandshakeCompletion(const HTTPSessionBase& session) override {
+    if (auto early = removeEarlySession(session)) {
+      early->setInfoCallback(nullptr);
+      onSession(early);
+    }
+  }
+  void onDestroy(const HTTPSessionBase& session) override {
+    if (removeEarlySession(session)) {
+      // The waiters it was going to serve need another connection
+      maybeConnect();
+    }
+  }
+
+  HTTPSessionBase* FOLLY_NULLABLE
+  removeEarlySession(const HTTPSessionBase& session) {
+    auto it = std::find(earlySessions_.begin(), earlySessions_.end(), &session);
+    if (it == earlySessions_.end()) {
+      return nullptr;
+    }
+    auto early = *it;
+    earlySessions_.erase(it);
+    return early;
+  }
+
+  HTTPTransaction* FOLLY_NULLABLE
+  getEarlyTransaction(HTTPTransaction::Handler* handler) {
+    for (auto session : earlySessions_) {
+      if (session->supportsMoreTransactions()) {
+        if (auto txn = session->newTransaction(handler)) {
+          return txn;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  void recordSecureConnect(HTTPSessionBase* session) {
+    auto stats = parent_.options_.tlsStats;
+    if (!stats || !endpoint_.isSecure()) {
+      return;
+    }
+    auto resume = session->getSetupTransportInfo().sslResume;
+    stats->recordSecureConnect(
+        resume == wangle::SSLResumeEnum::RESUME_SESSION_ID ||
+            resume == wangle::SSLResumeEnum::RESUME_TICKET,
+        !session->isReplaySafe());
+  }
+
+  std::string getPskIdentity() const {
+    return folly::to<std::string>(
+        endpoint_.getHostname(), ":", endpoint_.getPort());
+  }
+
+  // HHWheelTimer::Callback, fires every warmInterval
+  void timeoutExpired() noexcept override {
+    maybeWarm();
+    scheduleWarm();
+  }
+
+  void scheduleWarm() {
+    auto interval = parent_.options_.warmInterval;
+    if (interval.count() > 0) {
+      parent_.evb_->timer().scheduleTimeout(this, interval);
+    }
+  }
+
+  static std::unique_ptr<OutlierDetector::SessionStats> makeOutlierStats(
+      const Options& options, const Endpoint& endpoint) {
+    if (!options.outlierDetector) {
+      return nullptr;
+    }
+    return std::make_unique<OutlierDetector::SessionStats>(
+        *options.outlierDetector, endpoint, options.stats);
+  }
+
+  void recordConnectError() {
+    if (auto detector = parent_.options_.outlierDetector) {
+      detector->recordError(endpoint_, kErrorConnect);
+    }
+  }
+
+  void recordConnectTime(std::chrono::milliseconds elapsed) {
+    // Weighs recent connections more, but smooths out one-off slow ones
+    connectTime_ = connectTime_ ? (*connectTime_ * 3 + elapsed) / 4 : elapsed;
+  }
+
+  // Coalescing
+  HTTPTransaction* FOLLY_NULLABLE
+  getCoalescedTransaction(HTTPTransaction::Handler* handler);
+  bool covers(const std::string& hostname);
+  void registerCoalescing(HTTPSessionBase* session);
+  void unregisterCoalescing();
+
+  // Circuit breaking
+  bool admitWaiter();
+  void recordCircuitFailure();
+  void closeCircuit();
+
+  bool needsConnect() const;
+  void maybeConnect();
+  void maybeWarm();
+  void connect();
+  void onSession(HTTPSessionBase* session);
+  void onEarlySession(HTTPSessionBase* session);
+  void failWaiters(const folly::exception_wrapper& error);
+
+  UpstreamManager& parent_;
+  const Endpoint endpoint_;
+  // Before pool_, which records in it
+  std::unique_ptr<OutlierDetector::SessionStats> outlierStats_;
+  SessionPool pool_;
+  std::deque<Waiter> waiters_;
+  // Sessions sending early data. They only take idempotent requests and
+  // join the pool once the handshake completes.
+  std::vector<HTTPSessionBase*> earlySessions_;
+  bool connecting_{false};
+  // Smoothed setup time of the successful connections
+  folly::Optional<std::chrono::milliseconds> connectTime_;
+  folly::DynamicTokenBucket warmConnects_;
+  std::unique_ptr<HTTPConnectorWithFizz> connector_;
+  std::unique_ptr<HQConnector> hqConnector_;
+
+  // The address of the last connection
+  folly::Optional<folly::SocketAddress> address_;
+  // Where this pool is in coalescingPools_
+  folly::Optional<folly::SocketAddress> registeredAddress_;
+  // Of the last session other endpoints may coalesce on
+  std::shared_ptr<const folly::AsyncTransportCertificate> cert_;
+  // Hostnames checked against cert_
+  std::unordered_map<std::string, bool> coveredHosts_;
+  bool coalescable_{true};
+
+  // From Alt-Svc
+  folly::Optional<uint16_t> h3Port_;
+  std::chrono::steady_clock::time_point h3Expiry_;
+  std::chrono::steady_clock::time_point h3BrokenUntil_;
+  // Drained once a QUIC session replaces them
+  bool tcpSessions_{false};
+
+  CircuitState circuit_{CircuitState::CLOSED};
+  uint32_t connectFailures_{0};
+  // Times opened in a row
+  uint32_t circuitOpens_{0};
+  std::chrono::steady_clock::time_point openUntil_;
+};
+
+bool UpstreamManager::EndpointPool::admitWaiter() {
+  circuit_ = getCircuitState();
+  switch (circuit_) {
+    case CircuitState::CLOSED:
+      return true;
+    case CircuitState::OPEN:
+      return false;
+    case CircuitState::HALF_OPEN:
+      return waiters_.size() < parent_.options_.circuitProbes;
+  }
+  return true;
+}
+
+void UpstreamManager::EndpointPool::recordCircuitFailure() {
+  const auto& options = parent_.options_;
+  if (options.circuitBreakerFailures == 0) {
+    return;
+  }
+  circuit_ = getCircuitState();
+  if (circuit_ == CircuitState::CLOSED &&
+      ++connectFailures_ < options.circuitBreakerFailures) {
+    return;
+  }
+  connectFailures_ = 0;
+  auto openTime = options.circuitOpenTime * (1 << std::min(circuitOpens_, 16u));
+  circuitOpens_++;
+  openTime = std::min(openTime, options.maxCircuitOpenTime);
+  VLOG(3) << "Opening the circuit of " << endpoint_.getHostname() << ":"
+          << endpoint_.getPort() << " for " << openTime.count() << "ms";
+  circuit_ = CircuitState::OPEN;
+  openUntil_ = std::chrono::steady_clock::now() + openTime;
+}
+
+void UpstreamManager::EndpointPool::closeCircuit() {
+  connectFailures_ = 0;
+  if (circuit_ != CircuitState::CLOSED) {
+    VLOG(3) << "Closing the circuit of " << endpoint_.getHostname() << ":"
+            << endpoint_.getPort();
+    circuit_ = CircuitState::CLOSED;
+    circuitOpens_ = 0;
+  }
+}
+
+HTTPTransaction* FOLLY_NULLABLE
+UpstreamManager::EndpointPool::getCoalescedTransaction(
+    HTTPTransaction::Handler* handler) {
+  if (!parent_.options_.coalesce || !endpoint_.isSecure() || !address_ ||
+      !coalescable_) {
+    return nullptr;
+  }
+  auto it = parent_.coalescingPools_.find(*address_);
+  if (it == parent_.coalescingPools_.end()) {
+    return nullptr;
+  }
+  for (auto donor : it->second) {
+    if (donor == this || !donor->covers(endpoint_.getHostname())) {
+      continue;
+    }
+    if (auto txn = donor->pool_.getTransaction(handler)) {
+      VLOG(4) << "Coalesced " << endpoint_.getHostname() << " on a session of "
+              << donor->endpoint_.getHostname();
+      parent_.numCoalesced_++;
+      return txn;
+    }
+  }
+  return nullptr;
+}
+
+bool UpstreamManager::EndpointPool::covers(const std::string& hostname) {
+  if (!cert_) {
+    return false;
+  }
+  auto it = coveredHosts_.find(hostname);
+  if (it == coveredHosts_.end()) {
+    auto covered = UpstreamManager::certCoversHost(*cert_, hostname);
+    it = coveredHosts_.emplace(hostname, covered).first;
+  }
+  return it->second;
+}
+
+void UpstreamManager::EndpointPool::registerCoalescing(
+    HTTPSessionBase* session) {
+  if (!parent_.options_.coalesce || !endpoint_.isSecure() || !address_) {
+    return;
+  }
+  // Only multiplexed sessions can be shared
+  auto protocol = session->getCodecProtocol();
+  if (!isHTTP2CodecProtocol(protocol) && !isHQCodecProtocol(protocol)) {
+    return;
+  }
+  std::shared_ptr<const folly::AsyncTransportCertificate> cert;
+  if (auto transport = session->getTransport()) {
+    cert = transport->getPeerCertificate();
+  } else if (auto hqSession = dynamic_cast<HQSession*>(session)) {
+    if (auto sock = hqSession->getQuicSocket()) {
+      cert = sock->getPeerCertificate();
+    }
+  }
+  if (!cert) {
+    return;
+  }
+  if (!cert_ || cert_->getIdentity() != cert->getIdentity()) {
+    coveredHosts_.clear();
+  }
+  cert_ = std::move(cert);
+  if (registeredAddress_ == address_) {
+    return;
+  }
+  unregisterCoalescing();
+  parent_.coalescingPools_[*address_].push_back(this);
+  registeredAddress_ = address_;
+}
+
+void UpstreamManager::EndpointPool::unregisterCoalescing() {
+  if (!registeredAddress_) {
+    return;
+  }
+  auto it = parent_.coalescingPools_.find(*registeredAddress_);
+  if (it != parent_.coalescingPools_.end()) {
+    auto& pools = it->second;
+    pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+    if (pools.empty()) {
+      parent_.coalescingPools_.erase(it);
+    }
+  }
+  registeredAddress_.reset();
+}
+
+bool UpstreamManager::EndpointPool::needsConnect() const {
+  if (waiters_.empty()) {
+    return false;
+  }
+  if (earlySessions_.empty()) {
+    return true;
+  }
+  // The others wait for the early sessions to become replay safe
+  return std::any_of(waiters_.begin(), waiters_.end(), [](const Waiter& w) {
+    return w.idempotent;
+  });
+}
+
+void UpstreamManager::EndpointPool::maybeConnect() {
+  if (connecting_ || !needsConnect()) {
+    return;
+  }
+  connect();
+}
+
+void UpstreamManager::EndpointPool::maybeWarm() {
+  const auto& options = parent_.options_;
+  if (connecting_ || getCircuitState() != CircuitState::CLOSED) {
+    return;
+  }
+  // Little's law: the requests arriving while a new connection is being
+  // set up need that many spare sessions to not wait for it
+  double predicted = 0;
+  if (connectTime_) {
+    predicted = std::ceil(
+        pool_.getRequestRate() *
+        std::chrono::duration<double>(*connectTime_).count());
+  }
+  // Warm sessions beyond the idle limit would be purged right away
+  auto target = std::min<double>(
+      std::max<double>(options.minIdleSessions, predicted),
+      pool_.getMaxIdleSessions());
+  auto spare =
+      pool_.getNumIdleSessions() + pool_.getNumActiveNonFullSessions();
+  if (spare >= target) {
+    return;
+  }
+  auto rate = options.maxWarmConnectsPerSecond;
+  if (!warmConnects_.consume(1, rate, std::max(rate, 1.0))) {
+    return;
+  }
+  VLOG(4) << "Warming " << endpoint_.getHostname() << ":"
+          << endpoint_.getPort() << ", spare=" << spare
+          << " target=" << target;
+  connect();
+}
+
+void UpstreamManager::EndpointPool::connect() {
+  DCHECK(!connecting_);
+  const auto& options = parent_.options_;
+  folly::SocketAddress addr;
+  try {
+    addr = options.resolver
+               ? options.resolver(endpoint_)
+               : folly::SocketAddress(
+                     endpoint_.getHostname(), endpoint_.getPort(), true);
+  } catch (const std::exception&) {
+    failWaiters(folly::exception_wrapper(std::current_exception()));
+    return;
+  }
+  address_ = addr;
+  // Another endpoint's session may serve the waiters without connecting
+  bool waiting = !waiters_.empty();
+  while (!waiters_.empty()) {
+    auto waiter = waiters_.front();
+    auto txn = getCoalescedTransaction(waiter.handler);
+    if (!txn) {
+      break;
+    }
+    waiters_.pop_front();
+    waiter.cb->onTransaction(txn);
+  }
+  if (waiting && waiters_.empty()) {
+    return;
+  }
+
+  connecting_ = true;
+  auto evb = parent_.evb_;
+  auto h3Port = getHTTP3Port();
+  if (endpoint_.isSecure() && options.quicFizzContext &&
+      (!options.altSvcUpgrade || h3Port)) {
+    if (h3Port) {
+      addr.setPort(*h3Port);
+    }
+    if (!hqConnector_) {
+      hqConnector_ =
+          std::make_unique<HQConnector>(this, options.transactionTimeout);
+      hqConnector_->setTransportSettings(options.quicTransportSettings);
+    }
+    hqConnector_->connect(evb,
+                          folly::none,
+                          addr,
+                          options.quicFizzContext,
+                          options.quicVerifier,
+                          options.connectTimeout,
+                          options.socketOptions,
+                          endpoint_.getHostname());
+    return;
+  }
+
+  if (!connector_) {
+    connector_ = std::make_unique<HTTPConnectorWithFizz>(
+        this, WheelTimerInstance(options.transactionTimeout, evb));
+    if (!options.plaintextProtocol.empty()) {
+      connector_->setPlaintextProtocol(options.plaintextProtocol);
+    }
+  }
+  if (!endpoint_.isSecure()) {
+    connector_->connect(
+        evb, addr, options.connectTimeout, options.socketOptions);
+  } else if (options.fizzContext) {
+    // Keyed on the endpoint so that every connection to it may resume the
+    // session of another, through the PSK cache of the context
+    connector_->connectFizz(evb,
+                            addr,
+                            options.fizzContext,
+                            options.fizzVerifier,
+                            options.connectTimeout,
+                            options.connectTimeout,
+                            options.socketOptions,
+                            folly::AsyncSocket::anyAddress(),
+                            endpoint_.getHostname(),
+                            getPskIdentity());
+  } else if (options.sslContext) {
+    connector_->connectSSL(evb,
+                           addr,
+                           options.sslContext,
+                           nullptr,
+                           options.connectTimeout,
+                           options.socketOptions,
+                           folly::AsyncSocket::anyAddress(),
+                           endpoint_.getHostname());
+  } else {
+    connecting_ = false;
+    failWaiters(folly::make_exception_wrapper<std::runtime_error>(
+        "No TLS context for secure endpoint"));
+  }
+}
+
+void UpstreamManager::EndpointPool::onSession(HTTPSessionBase* session) {
+  if (!session->isReplaySafe()) {
+    onEarlySession(session);
+    return;
+  }
+  // Early sessions may already be busy with idempotent requests
+  bool busy = session->getNumOutgoingStreams() > 0;
+  registerCoalescing(session);
+  if (parent_.options_.altSvcUpgrade) {
+    if (!isHQCodecProtocol(session->getCodecProtocol())) {
+      tcpSessions_ = true;
+    } else if (tcpSessions_) {
+      VLOG(4) << "Upgraded " << endpoint_.getHostname() << " to HTTP/3";
+      tcpSessions_ = false;
+      pool_.drainAllSessions();
+    }
+  }
+  pool_.putSession(session);
+  size_t served = 0;
+  while (!waiters_.empty()) {
+    auto waiter = waiters_.front();
+    auto txn = pool_.getTransaction(waiter.handler);
+    if (!txn) {
+      break;
+    }
+    waiters_.pop_front();
+    served++;
+    waiter.cb->onTransaction(txn);
+  }
+  if (served == 0 && !busy && !waiters_.empty()) {
+    // Reconnecting would most likely get another unusable session
+    failWaiters(folly::make_exception_wrapper<std::runtime_error>(
+        "New session can not open transactions"));
+    return;
+  }
+  maybeConnect();
+}
+
+void UpstreamManager::EndpointPool::onEarlySession(HTTPSessionBase* session) {
+  earlySessions_.push_back(session);
+  session->setInfoCallback(this);
+  // Serve the idempotent requests from early data, in order
+  for (auto it = waiters_.begin(); it != waiters_.end();) {
+    if (!it->idempotent) {
+      ++it;
+      continue;
+    }
+    auto txn = session->supportsMoreTransactions()
+                   ? session->newTransaction(it->handler)
+                   : nullptr;
+    if (!txn) {
+      break;
+    }
+    auto cb = it->cb;
+    it = waiters_.erase(it);
+    cb->onTransaction(txn);
+  }
+  maybeConnect();
+}
+
+void UpstreamManager::EndpointPool::failWaiters(
+    const folly::exception_wrapper& error) {
+  auto waiters = std::move(waiters_);
+  waiters_.clear();
+  for (auto& waiter : waiters) {
+    waiter.cb->onTransactionError(error);
+  }
+}
+
+UpstreamManager::UpstreamManager(Options options, folly::EventBase* evb)
+    : options_(std::move(options)),
+      evb_(evb ? evb : folly::EventBaseManager::get()->getEventBase()) {
+}
+
+UpstreamManager::~UpstreamManager() {
+  // Requests still waiting are failed from the pools' destructors, and their
+  // callbacks may call back into this manager
+  auto pools = std::move(pools_);
+  pools_.clear();
+  pools.clear();
+}
+
+void UpstreamManager::getTransaction(const Endpoint& endpoint,
+                                     HTTPTransaction::Handler* handler,
+                                     Callback* cb,
+                                     bool idempotent) {
+  CHECK(evb_->isInEventBaseThread());
+  getEndpointPool(endpoint).getTransaction(handler, cb, idempotent);
+}
+
+void UpstreamManager::cancel(Callback* cb) {
+  for (auto& pool : pools_) {
+    pool.second->cancel(cb);
+  }
+}
+
+void UpstreamManager::drain() {
+  for (auto& pool : pools_) {
+    pool.second->drain();
+  }
+}
+
+const SessionPool* FOLLY_NULLABLE
+UpstreamManager::getSessionPool(const Endpoint& endpoint) const {
+  auto it = pools_.find(endpoint);
+  return it == pools_.end() ? nullptr : &it->second->getSessionPool();
+}
+
+bool UpstreamManager::certCoversHost(
+    const folly::AsyncTransportCertificate& cert, const std::string& hostname) {
+  auto x509 = folly::OpenSSLTransportCertificate::tryExtractX509(&cert);
+  // Wildcards match a single label only
+  return x509 && X509_check_host(x509.get(),
+                                 hostname.data(),
+                                 hostname.size(),
+                                 X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS,
+                                 nullptr) == 1;
+}
+
+void UpstreamManager::onAltSvc(const Endpoint& endpoint,
+                               folly::StringPiece value) {
+  getEndpointPool(endpoint).onAltSvc(value);
+}
+
+UpstreamManager::CircuitState UpstreamManager::getCircuitState(
+    const Endpoint& endpoint) const {
+  auto it = pools_.find(endpoint);
+  if (it == pools_.end()) {
+    return CircuitState::CLOSED;
+  }
+  return it->second->getCircuitState();
+}
+
+folly::Optional<uint16_t> UpstreamManager::getHTTP3Port(
+    const Endpoint& endpoint) const {
+  auto it = pools_.find(endpoint);
+  if (it == pools_.end()) {
+    return folly::none;
+  }
+  return it->second->getHTTP3Port();
+}
+
+void UpstreamManager::disableCoalescing(const Endpoint& endpoint) {
+  getEndpointPool(endpoint).disableCoalescing();
+}
+
+size_t UpstreamManager::getNumWaitingRequests(const Endpoint& endpoint) const {
+  auto it = pools_.find(endpoint);
+  return it == pools_.end() ? 0 : it->second->getNumWaitingRequests();
+}
+
+UpstreamManager::EndpointPool& UpstreamManager::getEndpointPool(
+    const Endpoint& endpoint) {
+  auto it = pools_.find(endpoint);
+  if (it == pools_.end()) {
+    it = pools_
+             .emplace(endpoint, std::make_unique<EndpointPool>(*this, endpoint))
+             .first;
+  }
+  return *it->second;
+}
+
+} // namespace proxygen
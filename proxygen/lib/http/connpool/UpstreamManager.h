@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/io/SocketOptionMap.h>
+#include <folly/io/async/AsyncTransportCertificate.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/SSLContext.h>
+#include <proxygen/lib/http/HQConnector.h>
+#include <proxygen/lib/http/HTTPConnectorWithFizz.h>
+#include <proxygen/lib/http/connpool/Endpoint.h>
+#include <proxygen/lib/http/connpool/OutlierDetector.h>
+#include <proxygen/lib/http/connpool/SessionPool.h>
+
+namespace proxygen {
+
+/**
+ * UpstreamManager owns one SessionPool per Endpoint and connects to the
+ * endpoint when its pool can't open a transaction.
+ *
+ * Concurrent requests for the same endpoint share a single connection
+ * attempt; once it succeeds, as many waiting requests as the new session
+ * accepts get a transaction and the rest wait for the next attempt.
+ * Transactions go to the least loaded partially filled session of the pool.
+ * Pools can also be warmed: connections are opened before requests need
+ * them, as predicted from each endpoint's recent request rate.
+ *
+ * With coalescing, a secure endpoint without a session to spare borrows
+ * one from another endpoint, as in RFC 9113 section 9.1.1: an HTTP/2 or
+ * HTTP/3 session connected to the address the endpoint resolves to, with a
+ * certificate valid for the endpoint's hostname.
+ *
+ * With altSvcUpgrade, an endpoint whose responses advertise HTTP/3 in
+ * Alt-Svc (see onAltSvc()) is connected over QUIC, and once connected,
+ * its TCP sessions are drained.
+ *
+ * Like SessionPool it can only be used from one thread, so create one per
+ * worker thread. It must be destroyed in that thread's event base.
+ */
+class UpstreamManager {
+ public:
+  class TLSStats {
+   public:
+    virtual ~TLSStats() {
+    }
+    // Called for every TLS over TCP connection; the resumption hit rate is
+    // the share of resumed ones
+    virtual void recordSecureConnect(bool resumed, bool earlyData) = 0;
+  };
+
+  struct Options {
+    // Per endpoint SessionPool settings
+    uint32_t maxIdleSessionsPerEndpoint{1};
+    std::chrono::milliseconds idleTimeout{std::chrono::milliseconds(1000)};
+    std::chrono::milliseconds maxAge{std::chrono::milliseconds(0)};
+    SessionHolder::Stats* stats{nullptr};
+    // When set, the responses, errors and connect failures of every
+    // endpoint are recorded in it
+    OutlierDetector* outlierDetector{nullptr};
+
+    std::chrono::milliseconds connectTimeout{std::chrono::milliseconds(1000)};
+    std::chrono::milliseconds transactionTimeout{
+        std::chrono::milliseconds(5000)};
+    folly::SocketOptionMap socketOptions;
+    // Protocol for insecure endpoints, e.g. "h2" for HTTP/2 prior knowledge
+    std::string plaintextProtocol;
+    // TLS context for secure endpoints
+    std::shared_ptr<folly::SSLContext> sslContext;
+    // When set, secure endpoints use fizz for TLS instead. The PSK identity
+    // is the endpoint: with a PSK cache in the context connections resume
+    // the sessions of earlier ones, and if the context sends early data,
+    // idempotent requests are sent in 0-RTT.
+    std::shared_ptr<const fizz::client::FizzClientContext> fizzContext;
+    std::shared_ptr<const fizz::CertificateVerifier> fizzVerifier;
+    TLSStats* tlsStats{nullptr};
+    // When set, secure endpoints are connected over QUIC instead of TLS
+    // (see altSvcUpgrade)
+    std::shared_ptr<const fizz::client::FizzClientContext> quicFizzContext;
+    std::shared_ptr<const fizz::CertificateVerifier> quicVerifier;
+    quic::TransportSettings quicTransportSettings;
+    // Maps an endpoint to the address to connect to. Defaults to a
+    // (blocking) lookup of the endpoint's hostname.
+    std::function<folly::SocketAddress(const Endpoint&)> resolver;
+
+    // Warming: every warmInterval each endpoint connects ahead of demand
+    // while it has fewer spare sessions than the requests expected during
+    // one connection setup (request rate x connect time), or than
+    // minIdleSessions. Bounded by maxIdleSessionsPerEndpoint, and by
+    // maxWarmConnectsPerSecond per endpoint. A zero interval disables it.
+    std::chrono::milliseconds warmInterval{std::chrono::milliseconds(0)};
+    uint32_t minIdleSessions{0};
+    double maxWarmConnectsPerSecond{1};
+    // Window of the per endpoint request rate average
+    std::chrono::milliseconds requestRateWindow{std::chrono::seconds(10)};
+
+    // Connection coalescing across the secure endpoints
+    bool coalesce{false};
+
+    // Only connects over QUIC to the endpoints advertising h3 in Alt-Svc,
+    // on the advertised port, and falls back to TLS when QUIC fails, not
+    // retrying it for altSvcBrokenTimeout
+    bool altSvcUpgrade{false};
+    std::chrono::milliseconds altSvcBrokenTimeout{std::chrono::minutes(5)};
+
+    // Circuit breaking: after circuitBreakerFailures failed connects in a
+    // row, the circuit of an endpoint opens, failing its requests without
+    // a session with CircuitOpenError at once.  After circuitOpenTime,
+    // doubling each time it opens again in a row up to
+    // maxCircuitOpenTime, it is half open: up to circuitProbes requests
+    // wait for one connection attempt, which closes the circuit if it
+    // succeeds and opens it again otherwise.  0 failures disables it.
+    uint32_t circuitBreakerFailures{0};
+    std::chrono::milliseconds circuitOpenTime{std::chrono::seconds(5)};
+    std::chrono::milliseconds maxCircuitOpenTime{std::chrono::seconds(60)};
+    uint32_t circuitProbes{1};
+
+    // drain() spreads the drains of each endpoint's sessions over this
+    // window, so the servers don't see them all reconnect at once
+    std::chrono::milliseconds drainWindow{std::chrono::milliseconds(0)};
+  };
+
+  enum class CircuitState { CLOSED, OPEN, HALF_OPEN };
+
+  // The error of the requests failed by an open circuit
+  class CircuitOpenError : public std::runtime_error {
+   public:
+    using std::runtime_error::runtime_error;
+  };
+
+  class Callback {
+   public:
+    virtual ~Callback() {
+    }
+    // txn was opened with the handler passed to getTransaction()
+    virtual void onTransaction(HTTPTransaction* txn) noexcept = 0;
+    virtual void onTransactionError(
+        const folly::exception_wrapper& error) noexcept = 0;
+  };
+
+  explicit UpstreamManager(Options options, folly::EventBase* evb = nullptr);
+  ~UpstreamManager();
+
+  UpstreamManager(const UpstreamManager&) = delete;
+  UpstreamManager& operator=(const UpstreamManager&) = delete;
+
+  /**
+   * Opens a transaction to endpoint for handler, then invokes cb.
+   *
+   * cb is invoked before this returns if a pooled session can take the
+   * transaction, otherwise once a connection to the endpoint is
+   * established or fails.
+   *
+   * Only idempotent requests may be sent in TLS early data, which a server
+   * can receive more than once. The others wait for the handshake.
+   */
+  void getTransaction(const Endpoint& endpoint,
+                      HTTPTransaction::Handler* handler,
+                      Callback* cb,
+                      bool idempotent = false);
+
+  /**
+   * Drops the requests of cb that are still waiting for a connection.
+   */
+  void cancel(Callback* cb);
+
+  /**
+   * Drains the sessions of every endpoint, see SessionPool::drainAllSessions.
+   */
+  void drain();
+
+  const SessionPool* FOLLY_NULLABLE
+  getSessionPool(const Endpoint& endpoint) const;
+
+  size_t getNumWaitingRequests(const Endpoint& endpoint) const;
+
+  CircuitState getCircuitState(const Endpoint& endpoint) const;
+
+  /**
+   * Records the Alt-Svc header value of a response from endpoint, replacing
+   * the alternative services known so far.  Only h3 on the endpoint's own
+   * host is used.  ProxyTransactionHandler calls it on every response.
+   */
+  void onAltSvc(const Endpoint& endpoint, folly::StringPiece value);
+
+  // The port of the h3 alternative of endpoint, if fresh and not broken
+  folly::Optional<uint16_t> getHTTP3Port(const Endpoint& endpoint) const;
+
+  /**
+   * Stops coalescing the requests of endpoint, e.g. after a 421
+   * (Misdirected Request) on a borrowed session.
+   */
+  void disableCoalescing(const Endpoint& endpoint);
+
+  // The transactions opened on sessions of other endpoints
+  uint64_t getNumCoalescedTransactions() const {
+    return numCoalesced_;
+  }
+
+  // Whether cert is valid for hostname, as used for coalescing
+  static bool certCoversHost(const folly::AsyncTransportCertificate& cert,
+                             const std::string& hostname);
+
+  folly::EventBase* getEventBase() const {
+    return evb_;
+  }
+
+ private:
+  class EndpointPool;
+
+  EndpointPool& getEndpointPool(const Endpoint& endpoint);
+
+  const Options options_;
+  folly::EventBase* const evb_;
+  // The pools with sessions to coalesce on, by the address they connect to
+  std::unordered_map<folly::SocketAddress, std::vector<EndpointPool*>>
+      coalescingPools_;
+  uint64_t numCoalesced_{0};
+  std::unordered_map<Endpoint,
+                     std::unique_ptr<EndpointPool>,
+                     EndpointHash,
+                     EndpointEqual>
+      pools_;
+};
+
+} // namespace proxygen
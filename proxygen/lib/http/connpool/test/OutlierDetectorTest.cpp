@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/connpool/OutlierDetector.h>
+#include <thread>
+
+using namespace proxygen;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace {
+
+class TestListener : public OutlierDetector::Listener {
+ public:
+  void onEjected(const Endpoint& /*endpoint*/,
+                 const std::string& reason) noexcept override {
+    reasons.push_back(reason);
+  }
+  void onReturned(const Endpoint& /*endpoint*/) noexcept override {
+    returned++;
+  }
+
+  std::vector<std::string> reasons;
+  size_t returned{0};
+};
+
+const Endpoint kFirst{"first.test", 443, true};
+const Endpoint kSecond{"second.test", 443, true};
+
+} // namespace
+
+TEST(OutlierDetectorTest, ConsecutiveFailures) {
+  OutlierDetector::Options options;
+  options.consecutiveFailures = 3;
+  OutlierDetector detector(options);
+  TestListener listener;
+  detector.setListener(&listener);
+  // A healthy endpoint, so the other may be ejected
+  detector.recordResponse(kSecond, 200);
+
+  detector.recordResponse(kFirst, 503);
+  detector.recordError(kFirst, kErrorConnectionReset);
+  // Interim responses don't count, successes reset the failures in a row
+  detector.recordResponse(kFirst, 100);
+  detector.recordResponse(kFirst, 200);
+  detector.recordResponse(kFirst, 500);
+  detector.recordResponse(kFirst, 502);
+  EXPECT_FALSE(detector.isEjected(kFirst));
+  detector.recordError(kFirst, kErrorTimeout);
+  EXPECT_TRUE(detector.isEjected(kFirst));
+  EXPECT_FALSE(detector.isEjected(kSecond));
+  ASSERT_EQ(listener.reasons.size(), 1);
+  EXPECT_EQ(listener.reasons[0], "consecutive failures");
+  EXPECT_EQ(detector.getNumEjected(), 1);
+  EXPECT_EQ(detector.getStats(kFirst)->ejections, 1);
+}
+
+TEST(OutlierDetectorTest, FailureRate) {
+  OutlierDetector::Options options;
+  options.consecutiveFailures = 0;
+  options.minRequests = 10;
+  options.maxFailureRate = 0.3;
+  OutlierDetector detector(options);
+  detector.recordResponse(kSecond, 200);
+
+  // Every other request fails
+  for (int i = 0; i < 9; i++) {
+    detector.recordResponse(kFirst, i % 2 ? 200 : 500);
+  }
+  EXPECT_FALSE(detector.isEjected(kFirst));
+  for (int i = 0; i < 20 && !detector.isEjected(kFirst); i++) {
+    detector.recordResponse(kFirst, i % 2 ? 200 : 500);
+  }
+  EXPECT_TRUE(detector.isEjected(kFirst));
+  EXPECT_GT(detector.getStats(kFirst)->failureRate, 0.3);
+}
+
+TEST(OutlierDetectorTest, Latency) {
+  OutlierDetector::Options options;
+  options.minRequests = 5;
+  options.maxLatency = milliseconds(100);
+  OutlierDetector detector(options);
+  detector.recordResponse(kSecond, 200);
+
+  for (int i = 0; i < 5; i++) {
+    detector.recordResponse(kFirst, 200, microseconds(50000));
+  }
+  EXPECT_FALSE(detector.isEjected(kFirst));
+  for (int i = 0; i < 50 && !detector.isEjected(kFirst); i++) {
+    detector.recordResponse(kFirst, 200, microseconds(500000));
+  }
+  EXPECT_TRUE(detector.isEjected(kFirst));
+}
+
+TEST(OutlierDetectorTest, ReturnsAfterEjectionTime) {
+  OutlierDetector::Options options;
+  options.consecutiveFailures = 1;
+  options.baseEjectionTime = milliseconds(50);
+  OutlierDetector detector(options);
+  TestListener listener;
+  detector.setListener(&listener);
+  detector.recordResponse(kSecond, 200);
+
+  detector.recordResponse(kFirst, 500);
+  EXPECT_TRUE(detector.isEjected(kFirst));
+  std::this_thread::sleep_for(milliseconds(60));
+  EXPECT_FALSE(detector.isEjected(kFirst));
+  EXPECT_EQ(listener.returned, 1);
+  EXPECT_EQ(detector.getNumEjected(), 0);
+  auto stats = detector.getStats(kFirst);
+  EXPECT_EQ(stats->requests, 0);
+  EXPECT_EQ(stats->ejections, 1);
+
+  // Ejected in a row, for longer
+  detector.recordResponse(kFirst, 500);
+  EXPECT_EQ(detector.getStats(kFirst)->ejections, 2);
+  std::this_thread::sleep_for(milliseconds(60));
+  EXPECT_TRUE(detector.isEjected(kFirst));
+}
+
+TEST(OutlierDetectorTest, MaxEjectedFraction) {
+  OutlierDetector::Options options;
+  options.consecutiveFailures = 1;
+  OutlierDetector detector(options);
+
+  detector.recordResponse(kFirst, 500);
+  EXPECT_TRUE(detector.isEjected(kFirst));
+  // Half the endpoints are ejected already
+  detector.recordResponse(kSecond, 500);
+  EXPECT_FALSE(detector.isEjected(kSecond));
+}
+
+TEST(OutlierDetectorTest, SessionStats) {
+  OutlierDetector::Options options;
+  options.consecutiveFailures = 2;
+  OutlierDetector detector(options);
+  detector.recordResponse(kSecond, 200);
+  OutlierDetector::SessionStats stats(detector, kFirst);
+
+  HTTPMessage response;
+  response.setStatusCode(503);
+  stats.onIngressMessage(response);
+  EXPECT_FALSE(detector.isEjected(kFirst));
+  stats.onIngressError(kErrorConnectionReset);
+  EXPECT_TRUE(detector.isEjected(kFirst));
+}
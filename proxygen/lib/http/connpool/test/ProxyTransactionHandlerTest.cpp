@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/connpool/ProxyTransactionHandler.h>
+#include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+std::unique_ptr<HTTPMessage> makeRequest(HTTPMethod method,
+                                         const std::string& url,
+                                         const std::string& host = "") {
+  auto request = std::make_unique<HTTPMessage>();
+  request->setMethod(method);
+  request->setURL(url);
+  if (!host.empty()) {
+    request->getHeaders().set(HTTP_HEADER_HOST, host);
+  }
+  return request;
+}
+
+} // namespace
+
+TEST(ProxyTransactionHandlerTest, DefaultRoute) {
+  auto endpoint = ProxyTransactionHandler::defaultRoute(
+      *makeRequest(HTTPMethod::GET, "https://origin.test/path"));
+  ASSERT_TRUE(endpoint);
+  EXPECT_EQ(endpoint->getHostname(), "origin.test");
+  EXPECT_EQ(endpoint->getPort(), 443);
+  EXPECT_TRUE(endpoint->isSecure());
+
+  endpoint = ProxyTransactionHandler::defaultRoute(
+      *makeRequest(HTTPMethod::GET, "/path", "origin.test:8080"));
+  ASSERT_TRUE(endpoint);
+  EXPECT_EQ(endpoint->getHostname(), "origin.test");
+  EXPECT_EQ(endpoint->getPort(), 8080);
+  EXPECT_FALSE(endpoint->isSecure());
+
+  endpoint = ProxyTransactionHandler::defaultRoute(
+      *makeRequest(HTTPMethod::CONNECT, "origin.test:22"));
+  ASSERT_TRUE(endpoint);
+  EXPECT_EQ(endpoint->getHostname(), "origin.test");
+  EXPECT_EQ(endpoint->getPort(), 22);
+
+  EXPECT_FALSE(ProxyTransactionHandler::defaultRoute(
+      *makeRequest(HTTPMethod::GET, "/path")));
+}
+
+class ProxyTransactionHandlerTest : public testing::Test {
+ public:
+  void SetUp() override {
+    UpstreamManager::Options upstreamOptions;
+    // Nothing listens there
+    upstreamOptions.resolver = [](const Endpoint&) {
+      return folly::SocketAddress("127.0.0.1", 1);
+    };
+    manager_ =
+        std::make_unique<UpstreamManager>(std::move(upstreamOptions), &evb_);
+    handler_ = new ProxyTransactionHandler(*manager_, options_);
+    handler_->setTransaction(&txn_);
+  }
+
+  void TearDown() override {
+    handler_->detachTransaction();
+    manager_.reset();
+    evb_.loop();
+  }
+
+  void expectResponse(uint16_t status) {
+    EXPECT_CALL(txn_, sendHeaders(_))
+        .WillOnce(Invoke([status, this](const HTTPMessage& response) {
+          EXPECT_EQ(response.getStatusCode(), status);
+          responded_ = true;
+        }));
+    EXPECT_CALL(txn_, sendBody(_));
+    EXPECT_CALL(txn_, sendEOM());
+  }
+
+ protected:
+  folly::EventBase evb_;
+  ProxyTransactionHandler::Options options_;
+  std::unique_ptr<UpstreamManager> manager_;
+  HTTP2PriorityQueue queue_;
+  NiceMock<MockHTTPTransaction> txn_{TransportDirection::DOWNSTREAM,
+                                     1,
+                                     0,
+                                     queue_};
+  ProxyTransactionHandler* handler_{nullptr};
+  bool responded_{false};
+};
+
+TEST_F(ProxyTransactionHandlerTest, NoRoute) {
+  expectResponse(400);
+  handler_->onHeadersComplete(makeRequest(HTTPMethod::GET, "/path"));
+  EXPECT_TRUE(responded_);
+}
+
+TEST_F(ProxyTransactionHandlerTest, ConnectNotAllowed) {
+  expectResponse(405);
+  handler_->onHeadersComplete(makeRequest(HTTPMethod::CONNECT, "origin:22"));
+  EXPECT_TRUE(responded_);
+}
+
+TEST_F(ProxyTransactionHandlerTest, UpstreamConnectError) {
+  EXPECT_CALL(txn_, pauseIngress());
+  expectResponse(502);
+  handler_->onHeadersComplete(
+      makeRequest(HTTPMethod::GET, "http://origin.test/path"));
+  EXPECT_FALSE(responded_);
+  while (!responded_) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(manager_->getNumWaitingRequests(Endpoint("origin.test", 80, false)),
+            0);
+}
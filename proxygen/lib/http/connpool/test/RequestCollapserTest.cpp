@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/connpool/RequestCollapser.h>
+
+using namespace proxygen;
+
+namespace {
+
+HTTPMessage makeRequest(const std::string& url = "/resource") {
+  HTTPMessage request;
+  request.setMethod(HTTPMethod::GET);
+  request.setURL(url);
+  request.getHeaders().set(HTTP_HEADER_HOST, "origin.test");
+  return request;
+}
+
+HTTPMessage makeResponse() {
+  HTTPMessage response;
+  response.setStatusCode(200);
+  response.setStatusMessage("OK");
+  return response;
+}
+
+class TestFollower : public RequestCollapser::Follower {
+ public:
+  void onCollapsedHeaders(const HTTPMessage& msg) noexcept override {
+    status = msg.getStatusCode();
+  }
+  void onCollapsedBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    body += chain->to<std::string>();
+  }
+  void onCollapsedTrailers(const HTTPHeaders& /*trailers*/) noexcept override {
+    trailers = true;
+  }
+  void onCollapsedEOM() noexcept override {
+    eom = true;
+  }
+  void onCollapsedError() noexcept override {
+    error = true;
+  }
+  void onCollapseReleased() noexcept override {
+    released = true;
+  }
+
+  uint16_t status{0};
+  std::string body;
+  bool trailers{false};
+  bool eom{false};
+  bool error{false};
+  bool released{false};
+};
+
+} // namespace
+
+class RequestCollapserTest : public testing::Test {
+ public:
+  void SetUp() override {
+    options_.maxFollowers = 2;
+    options_.maxWait = std::chrono::milliseconds(10);
+    options_.maxReplayBytes = 8;
+    collapser_ = std::make_unique<RequestCollapser>(&evb_, options_);
+    key_ = collapser_->makeKey(makeRequest());
+  }
+
+ protected:
+  folly::EventBase evb_;
+  RequestCollapser::Options options_;
+  std::unique_ptr<RequestCollapser> collapser_;
+  std::string key_;
+};
+
+TEST_F(RequestCollapserTest, Collapsible) {
+  auto request = makeRequest();
+  EXPECT_TRUE(collapser_->isCollapsible(request));
+  request.getHeaders().set(HTTP_HEADER_COOKIE, "id=1");
+  EXPECT_FALSE(collapser_->isCollapsible(request));
+  request = makeRequest();
+  request.setMethod(HTTPMethod::POST);
+  EXPECT_FALSE(collapser_->isCollapsible(request));
+
+  // Keyed on the selected headers
+  request = makeRequest();
+  request.getHeaders().set(HTTP_HEADER_ACCEPT_ENCODING, "gzip");
+  EXPECT_NE(collapser_->makeKey(request), key_);
+  EXPECT_NE(collapser_->makeKey(makeRequest("/other")), key_);
+  request = makeRequest();
+  request.getHeaders().set(HTTP_HEADER_USER_AGENT, "test");
+  EXPECT_EQ(collapser_->makeKey(request), key_);
+}
+
+TEST_F(RequestCollapserTest, FollowersStream) {
+  TestFollower first;
+  TestFollower late;
+  TestFollower overCap;
+  EXPECT_FALSE(collapser_->follow(key_, &first));
+  auto group = collapser_->lead(key_);
+  ASSERT_TRUE(group);
+  EXPECT_FALSE(collapser_->lead(key_));
+  EXPECT_TRUE(collapser_->follow(key_, &first));
+
+  group->sendHeaders(makeResponse());
+  EXPECT_EQ(first.status, 200);
+  group->sendBody(*folly::IOBuf::copyBuffer("hello"));
+  EXPECT_EQ(first.body, "hello");
+
+  // Replayed from the start
+  EXPECT_TRUE(collapser_->follow(key_, &late));
+  EXPECT_EQ(late.status, 200);
+  EXPECT_EQ(late.body, "hello");
+  EXPECT_FALSE(collapser_->follow(key_, &overCap));
+  EXPECT_EQ(group->getNumFollowers(), 2);
+
+  // Over maxReplayBytes, closed to new followers
+  group->sendBody(*folly::IOBuf::copyBuffer(" world"));
+  EXPECT_EQ(collapser_->getNumGroups(), 0);
+  collapser_->unfollow(&late);
+  EXPECT_FALSE(collapser_->follow(key_, &overCap));
+
+  group->sendEOM();
+  EXPECT_EQ(first.body, "hello world");
+  EXPECT_TRUE(first.eom);
+  EXPECT_FALSE(late.eom);
+  EXPECT_EQ(late.body, "hello world");
+  EXPECT_EQ(collapser_->getNumCollapsed(), 2);
+}
+
+TEST_F(RequestCollapserTest, ReleasedWithoutResponse) {
+  TestFollower follower;
+  auto group = collapser_->lead(key_);
+  ASSERT_TRUE(collapser_->follow(key_, &follower));
+  evb_.loopOnce();
+  while (!follower.released) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(collapser_->getNumGroups(), 0);
+  group->sendAbort();
+
+  // A failure before the response releases too, after it fails them
+  TestFollower second;
+  group = collapser_->lead(key_);
+  ASSERT_TRUE(collapser_->follow(key_, &second));
+  group->sendAbort();
+  EXPECT_TRUE(second.released);
+
+  TestFollower third;
+  group = collapser_->lead(key_);
+  ASSERT_TRUE(collapser_->follow(key_, &third));
+  group->sendHeaders(makeResponse());
+  group.reset();
+  EXPECT_TRUE(third.error);
+  EXPECT_FALSE(third.released);
+}
+
+TEST_F(RequestCollapserTest, PersonalResponse) {
+  TestFollower follower;
+  auto group = collapser_->lead(key_);
+  ASSERT_TRUE(collapser_->follow(key_, &follower));
+  auto response = makeResponse();
+  response.getHeaders().set(HTTP_HEADER_CACHE_CONTROL, "private, max-age=10");
+  group->sendHeaders(response);
+  EXPECT_TRUE(follower.released);
+  EXPECT_EQ(follower.status, 0);
+  group->sendEOM();
+}
+
+TEST_F(RequestCollapserTest, SlowFollowersPause) {
+  TestFollower first;
+  TestFollower second;
+  std::vector<bool> pauses;
+  auto group = collapser_->lead(key_);
+  group->setPauseCallback([&pauses](bool paused) { pauses.push_back(paused); });
+  ASSERT_TRUE(collapser_->follow(key_, &first));
+  ASSERT_TRUE(collapser_->follow(key_, &second));
+  collapser_->setFollowerPaused(&first, true);
+  collapser_->setFollowerPaused(&second, true);
+  collapser_->setFollowerPaused(&first, false);
+  EXPECT_EQ(pauses, std::vector<bool>({true}));
+  // Leaving resumes too
+  collapser_->unfollow(&second);
+  EXPECT_EQ(pauses, std::vector<bool>({true, false}));
+  group->sendEOM();
+}
+
+TEST_F(RequestCollapserTest, MovedHeadersReplayed) {
+  TestFollower first;
+  TestFollower late;
+  auto group = collapser_->lead(key_);
+  ASSERT_TRUE(collapser_->follow(key_, &first));
+  group->sendHeaders(std::make_unique<HTTPMessage>(makeResponse()));
+  EXPECT_EQ(first.status, 200);
+  EXPECT_TRUE(collapser_->follow(key_, &late));
+  EXPECT_EQ(late.status, 200);
+  group->sendEOM();
+  EXPECT_TRUE(late.eom);
+}
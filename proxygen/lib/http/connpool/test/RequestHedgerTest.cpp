@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/connpool/RequestHedger.h>
+
+using namespace proxygen;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+namespace {
+
+class TestHedgerCallback : public RequestHedger::Callback {
+ public:
+  void onResponse(std::unique_ptr<HTTPMessage> /*response*/,
+                  std::unique_ptr<folly::IOBuf> /*body*/) noexcept override {
+    responses++;
+  }
+  void onError(const folly::exception_wrapper& /*error*/) noexcept override {
+    errors++;
+  }
+
+  size_t responses{0};
+  size_t errors{0};
+};
+
+HTTPMessage makeRequest(HTTPMethod method) {
+  HTTPMessage request;
+  request.setMethod(method);
+  request.setURL("/");
+  request.getHeaders().set(HTTP_HEADER_HOST, "upstream.test");
+  return request;
+}
+
+} // namespace
+
+TEST(RetryBudgetTest, Tokens) {
+  RetryBudget budget(0.5, 2);
+  EXPECT_TRUE(budget.tryAcquire());
+  EXPECT_TRUE(budget.tryAcquire());
+  EXPECT_FALSE(budget.tryAcquire());
+
+  budget.onRequest();
+  EXPECT_FALSE(budget.tryAcquire());
+  budget.onRequest();
+  EXPECT_TRUE(budget.tryAcquire());
+
+  // Capped at the max
+  for (int i = 0; i < 10; i++) {
+    budget.onRequest();
+  }
+  EXPECT_DOUBLE_EQ(budget.getTokens(), 2);
+}
+
+class RequestHedgerTest : public testing::Test {
+ public:
+  void SetUp() override {
+    // The kernel completes the handshakes of the listening socket, and
+    // nothing ever responds
+    server_.reset(new folly::AsyncServerSocket(&evb_));
+    server_->bind(folly::SocketAddress("127.0.0.1", 0));
+    server_->listen(16);
+    server_->getAddress(&serverAddr_);
+  }
+
+  void TearDown() override {
+    hedger_.reset();
+    manager_.reset();
+    server_.reset();
+    evb_.loop();
+  }
+
+  void makeHedger(RequestHedger::Options options = {}) {
+    UpstreamManager::Options upstreamOptions;
+    upstreamOptions.plaintextProtocol = "h2";
+    upstreamOptions.resolver = [this](const Endpoint&) { return serverAddr_; };
+    manager_ = std::make_unique<UpstreamManager>(std::move(upstreamOptions),
+                                                 &evb_);
+    hedger_ = std::make_unique<RequestHedger>(*manager_, std::move(options));
+  }
+
+  // Loops until done returns true, or for one second
+  template <typename F>
+  void loopUntil(F done) {
+    auto deadline = getCurrentTime() + std::chrono::seconds(1);
+    while (!done() && getCurrentTime() < deadline) {
+      evb_.loopOnce(EVLOOP_NONBLOCK);
+    }
+  }
+
+ protected:
+  folly::EventBase evb_;
+  const std::vector<Endpoint> endpoints_{{"first.test", 80, false},
+                                         {"second.test", 80, false}};
+  folly::AsyncServerSocket::UniquePtr server_;
+  folly::SocketAddress serverAddr_;
+  std::unique_ptr<UpstreamManager> manager_;
+  std::unique_ptr<RequestHedger> hedger_;
+};
+
+TEST_F(RequestHedgerTest, HedgeDelay) {
+  RequestHedger::Options options;
+  options.initialDelay = milliseconds(20);
+  options.minDelay = milliseconds(2);
+  options.maxDelay = milliseconds(100);
+  options.delayPercentile = 0.9;
+  options.latencySamples = 100;
+  makeHedger(std::move(options));
+  EXPECT_EQ(hedger_->getHedgeDelay(), milliseconds(20));
+
+  for (int i = 1; i <= 100; i++) {
+    hedger_->recordLatency(microseconds(i * 500));
+  }
+  EXPECT_EQ(hedger_->getHedgeDelay(), milliseconds(45));
+
+  // Within the bounds
+  for (int i = 0; i < 100; i++) {
+    hedger_->recordLatency(milliseconds(500));
+  }
+  EXPECT_EQ(hedger_->getHedgeDelay(), milliseconds(100));
+  for (int i = 0; i < 100; i++) {
+    hedger_->recordLatency(microseconds(10));
+  }
+  EXPECT_EQ(hedger_->getHedgeDelay(), milliseconds(2));
+}
+
+TEST_F(RequestHedgerTest, HedgesSlowRequest) {
+  RequestHedger::Options options;
+  options.initialDelay = milliseconds(10);
+  makeHedger(std::move(options));
+
+  TestHedgerCallback cb;
+  hedger_->send(makeRequest(HTTPMethod::GET), nullptr, endpoints_, &cb);
+  EXPECT_EQ(hedger_->getNumHedges(), 0);
+  loopUntil([&] { return hedger_->getNumHedges() > 0; });
+  EXPECT_EQ(hedger_->getNumHedges(), 1);
+  EXPECT_NE(manager_->getSessionPool(endpoints_[1]), nullptr);
+
+  hedger_->cancel(&cb);
+  EXPECT_EQ(hedger_->getNumRequests(), 0);
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(cb.responses + cb.errors, 0);
+}
+
+TEST_F(RequestHedgerTest, NoHedgeForNonIdempotent) {
+  RequestHedger::Options options;
+  options.initialDelay = milliseconds(5);
+  makeHedger(std::move(options));
+
+  TestHedgerCallback cb;
+  hedger_->send(makeRequest(HTTPMethod::POST),
+                folly::IOBuf::copyBuffer("body"),
+                endpoints_,
+                &cb);
+  evb_.runAfterDelay([this] { evb_.terminateLoopSoon(); }, 50);
+  evb_.loop();
+  EXPECT_EQ(hedger_->getNumHedges(), 0);
+  EXPECT_EQ(hedger_->getNumRequests(), 1);
+  hedger_->cancel(&cb);
+}
+
+TEST_F(RequestHedgerTest, NoHedgeWithoutBudget) {
+  RequestHedger::Options options;
+  options.initialDelay = milliseconds(5);
+  options.budget = std::make_shared<RetryBudget>(0.1, 0);
+  makeHedger(std::move(options));
+
+  TestHedgerCallback cb;
+  hedger_->send(makeRequest(HTTPMethod::GET), nullptr, endpoints_, &cb);
+  evb_.runAfterDelay([this] { evb_.terminateLoopSoon(); }, 50);
+  evb_.loop();
+  EXPECT_EQ(hedger_->getNumHedges(), 0);
+  hedger_->cancel(&cb);
+}
+
+TEST_F(RequestHedgerTest, RetriesConnectError) {
+  // Nothing listens there anymore
+  server_.reset();
+  RequestHedger::Options options;
+  auto budget = std::make_shared<RetryBudget>(0.1, 5);
+  options.budget = budget;
+  makeHedger(std::move(options));
+
+  TestHedgerCallback cb;
+  hedger_->send(makeRequest(HTTPMethod::GET), nullptr, endpoints_, &cb);
+  loopUntil([&] { return cb.errors > 0; });
+  EXPECT_EQ(cb.errors, 1);
+  EXPECT_EQ(hedger_->getNumRequests(), 0);
+  // Retried once, on the second endpoint
+  EXPECT_DOUBLE_EQ(budget->getTokens(), 4);
+  EXPECT_NE(manager_->getSessionPool(endpoints_[1]), nullptr);
+}
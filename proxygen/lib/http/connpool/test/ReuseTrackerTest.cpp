@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/connpool/ReuseTracker.h>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+TEST(ReuseTrackerTest, Probability) {
+  ReuseTracker::Options options;
+  options.minSamples = 10;
+  ReuseTracker tracker(options);
+  for (int i = 0; i < 9; i++) {
+    tracker.recordReuse(milliseconds(3000), i % 3 != 0);
+  }
+  // Not enough samples yet
+  EXPECT_FALSE(tracker.getReuseProbability(milliseconds(3000)).hasValue());
+  EXPECT_TRUE(tracker.shouldReuse(milliseconds(3000)));
+
+  tracker.recordReuse(milliseconds(2500), false);
+  // Same bucket, [2048, 4096)
+  auto probability = tracker.getReuseProbability(milliseconds(3500));
+  ASSERT_TRUE(probability.hasValue());
+  EXPECT_DOUBLE_EQ(*probability, 0.6);
+  EXPECT_FALSE(tracker.shouldReuse(milliseconds(3500)));
+  // Other buckets are unaffected
+  EXPECT_FALSE(tracker.getReuseProbability(milliseconds(100)).hasValue());
+  EXPECT_TRUE(tracker.shouldReuse(milliseconds(100)));
+  EXPECT_TRUE(tracker.shouldReuse(milliseconds(8000)));
+}
+
+TEST(ReuseTrackerTest, Decay) {
+  ReuseTracker::Options options;
+  options.minSamples = 10;
+  options.maxSamples = 100;
+  ReuseTracker tracker(options);
+  for (int i = 0; i < 99; i++) {
+    tracker.recordReuse(milliseconds(10), false);
+  }
+  EXPECT_FALSE(tracker.shouldReuse(milliseconds(10)));
+  // The failures are halved, so the successes catch up
+  for (int i = 0; i < 100; i++) {
+    tracker.recordReuse(milliseconds(10), true);
+  }
+  auto probability = tracker.getReuseProbability(milliseconds(10));
+  ASSERT_TRUE(probability.hasValue());
+  EXPECT_GT(*probability, 0.5);
+}
+
+TEST(ReuseTrackerTest, KeepAlive) {
+  ReuseTracker tracker;
+  HTTPMessage resp;
+  resp.setStatusCode(200);
+  tracker.onResponse(resp);
+  EXPECT_FALSE(tracker.getKeepAliveTimeout().hasValue());
+
+  resp.getHeaders().set(HTTP_HEADER_KEEP_ALIVE, "max=100, timeout=5");
+  tracker.onResponse(resp);
+  EXPECT_EQ(tracker.getKeepAliveTimeout(), milliseconds(5000));
+  EXPECT_TRUE(tracker.shouldReuse(milliseconds(3900)));
+  // Within the default 1s margin
+  EXPECT_FALSE(tracker.shouldReuse(milliseconds(4000)));
+
+  // Malformed values are ignored
+  resp.getHeaders().set(HTTP_HEADER_KEEP_ALIVE, "timeout=soon");
+  tracker.onResponse(resp);
+  EXPECT_EQ(tracker.getKeepAliveTimeout(), seconds(5));
+}
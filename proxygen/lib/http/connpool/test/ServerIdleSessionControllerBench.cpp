@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/connpool/ServerIdleSessionController.h>
+
+using namespace proxygen;
+
+namespace {
+
+class BenchIdleController : public ServerIdleSessionController {
+ public:
+  using ServerIdleSessionController::popBestIdlePool;
+};
+
+// Every thread repeatedly publishes an idle session from its own pool and
+// then steals one, which is the controller side of getIdleSession(); the hop
+// to the victim's event base is left out.
+void runSteals(size_t iters, size_t numThreads) {
+  BenchIdleController ctrl;
+  std::vector<std::unique_ptr<SessionPool>> pools;
+  // The controller only uses sessions as keys
+  std::vector<uint64_t> sessionKeys(numThreads);
+  std::vector<std::thread> threads;
+  std::atomic<bool> go{false};
+  std::atomic<size_t> steals{0};
+
+  BENCHMARK_SUSPEND {
+    ctrl.setMaxIdleCount(numThreads);
+    for (size_t t = 0; t < numThreads; ++t) {
+      pools.push_back(std::make_unique<SessionPool>());
+    }
+    for (size_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t] {
+        auto pool = pools[t].get();
+        auto session =
+            reinterpret_cast<const HTTPSessionBase*>(&sessionKeys[t]);
+        while (!go.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        size_t localSteals = 0;
+        for (size_t i = t; i < iters; i += numThreads) {
+          ctrl.addIdleSession(session, pool);
+          if (ctrl.popBestIdlePool()) {
+            localSteals++;
+          }
+          // No-op when the session was the one stolen
+          ctrl.removeIdleSession(session, pool);
+        }
+        steals += localSteals;
+      });
+    }
+  }
+
+  go.store(true, std::memory_order_release);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  folly::doNotOptimizeAway(steals.load());
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(runSteals, threads_1, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(runSteals, threads_8, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(runSteals, threads_64, 64)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
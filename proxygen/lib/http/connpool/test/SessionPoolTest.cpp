@@ -13,6 +13,8 @@
 #include <proxygen/lib/http/connpool/SessionPool.h>
 #include <proxygen/lib/http/connpool/ThreadIdleSessionController.h>
 
+#include <cmath>
+
 #include <folly/io/async/EventBaseManager.h>
 #include <folly/portability/GFlags.h>
 #include <folly/synchronization/Baton.h>
@@ -234,6 +236,122 @@ TEST_F(SessionPoolFixture, ParallelPoolLists) {
   evb_.loop();
 }
 
+TEST_F(SessionPoolFixture, RequestRate) {
+  SessionPool p(this);
+  p.setRequestRateWindow(std::chrono::seconds(1));
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(p.getRequestRate(start), 0);
+
+  // 100 requests per second for 10 windows converges to the real rate
+  for (int i = 1; i <= 1000; ++i) {
+    p.recordRequest(start + std::chrono::milliseconds(i * 10));
+  }
+  auto end = start + std::chrono::seconds(10);
+  EXPECT_NEAR(p.getRequestRate(end), 100, 1);
+
+  // Without requests the rate decays by 1/e per window
+  EXPECT_NEAR(p.getRequestRate(end + std::chrono::seconds(1)),
+              100 * std::exp(-1),
+              1);
+  EXPECT_LT(p.getRequestRate(end + std::chrono::seconds(20)), 0.001);
+}
+
+TEST_F(SessionPoolFixture, ParallelPoolLeastLoaded) {
+  // With least loaded selection transactions go to the partially filled
+  // session with the fewest outgoing streams
+  SessionPool p(this, 2);
+  p.setLeastLoadedSelection(true);
+  std::vector<HTTPTransaction*> txns;
+
+  auto sess1 = makeParallelSession();
+  auto sess2 = makeParallelSession();
+  // Both sessions enter the pool partially filled, sess1 less so
+  txns.push_back(CHECK_NOTNULL(sess1->newTransaction(this)));
+  for (int i = 0; i < 3; ++i) {
+    txns.push_back(CHECK_NOTNULL(sess2->newTransaction(this)));
+  }
+  p.putSession(sess1);
+  p.putSession(sess2);
+  ASSERT_EQ(p.getNumActiveNonFullSessions(), 2);
+
+  txns.push_back(CHECK_NOTNULL(p.getTransaction(this)));
+  txns.push_back(CHECK_NOTNULL(p.getTransaction(this)));
+  EXPECT_EQ(sess1->getNumOutgoingStreams(), 3);
+  EXPECT_EQ(sess2->getNumOutgoingStreams(), 3);
+
+  // Then they are used evenly
+  for (int i = 0; i < 4; ++i) {
+    txns.push_back(CHECK_NOTNULL(p.getTransaction(this)));
+  }
+  EXPECT_EQ(sess1->getNumOutgoingStreams(), 5);
+  EXPECT_EQ(sess2->getNumOutgoingStreams(), 5);
+
+  p.setMaxIdleSessions(0);
+  for (auto txn : txns) {
+    txn->sendAbort();
+  }
+  evb_.loop();
+  ASSERT_EQ(closed_, 2);
+}
+
+TEST_F(SessionPoolFixture, WaitForTransaction) {
+  SessionPool p(this, 1);
+  p.setMaxWaiters(2);
+  auto sess = makeParallelSession();
+  p.putSession(sess);
+  std::vector<HTTPTransaction*> txns;
+  while (sess->supportsMoreTransactions()) {
+    txns.push_back(CHECK_NOTNULL(p.getTransaction(this)));
+  }
+  ASSERT_EQ(p.getTransaction(this), nullptr);
+
+  std::vector<std::pair<int, HTTPTransaction*>> served;
+  auto waitFor = [&](int id, uint8_t priority) {
+    return p.waitForTransaction(
+        this,
+        [&served, id](HTTPTransaction* txn) { served.emplace_back(id, txn); },
+        std::chrono::milliseconds(50),
+        priority);
+  };
+  EXPECT_TRUE(waitFor(1, 0));
+  EXPECT_TRUE(waitFor(2, 1));
+  EXPECT_FALSE(waitFor(3, 0));
+  EXPECT_EQ(p.getWaitStats().rejected, 1);
+  p.getEventBase()->loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_TRUE(served.empty());
+
+  // A freed stream goes to the higher priority waiter
+  txns.back()->sendAbort();
+  txns.pop_back();
+  p.getEventBase()->loopOnce(EVLOOP_NONBLOCK);
+  ASSERT_EQ(served.size(), 1);
+  EXPECT_EQ(served[0].first, 2);
+  ASSERT_NE(served[0].second, nullptr);
+  txns.push_back(served[0].second);
+  EXPECT_EQ(p.getWaitStats().served, 1);
+
+  // The other one times out
+  while (served.size() < 2) {
+    p.getEventBase()->loopOnce();
+  }
+  EXPECT_EQ(served[1].first, 1);
+  EXPECT_EQ(served[1].second, nullptr);
+  EXPECT_EQ(p.getWaitStats().timedOut, 1);
+  EXPECT_GT(p.getWaitStats().maxQueueTime.count(), 0);
+  EXPECT_EQ(p.getNumWaiters(), 0);
+
+  EXPECT_TRUE(waitFor(4, 0));
+  EXPECT_TRUE(p.cancelWait(this));
+  EXPECT_FALSE(p.cancelWait(this));
+
+  p.setMaxIdleSessions(0);
+  for (auto txn : txns) {
+    txn->sendAbort();
+  }
+  evb_.loop();
+  EXPECT_EQ(served.size(), 2);
+}
+
 TEST_F(SessionPoolFixture, OutstandingWrites) {
   auto codec = makeSerialCodec();
   EXPECT_CALL(*codec, generateHeader(_, _, _, _, _, _))
@@ -371,6 +489,67 @@ TEST_F(SessionPoolFixture, DrainSessionLater) {
   txn2->sendAbort();
 }
 
+TEST_F(SessionPoolFixture, StaggeredDrain) {
+  SessionPool p(this, 3, std::chrono::seconds(4));
+  for (int i = 0; i < 3; i++) {
+    p.putSession(makeParallelSession());
+  }
+  auto txn = CHECK_NOTNULL(p.getTransaction(this));
+  ASSERT_EQ(p.getNumActiveSessions(), 1);
+
+  bool done = false;
+  p.drainAllSessions(std::chrono::milliseconds(100), [&] { done = true; });
+  // An idle session drains at once, the busy one last
+  EXPECT_EQ(p.getNumIdleSessions(), 1);
+  EXPECT_EQ(p.getNumActiveSessions(), 1);
+  auto progress = p.getDrainProgress();
+  ASSERT_NE(progress, nullptr);
+  EXPECT_EQ(progress->scheduled, 3);
+  EXPECT_EQ(progress->drained, 1);
+  EXPECT_EQ(progress->getPending(), 2);
+
+  // The pool times out on the thread's EventBase
+  while (!done) {
+    p.getEventBase()->loopOnce(EVLOOP_NONBLOCK);
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+  }
+  EXPECT_EQ(p.getNumSessions(), 0);
+  EXPECT_EQ(progress->drained, 3);
+  EXPECT_EQ(progress->closed, 0);
+  txn->sendAbort();
+}
+
+TEST_F(SessionPoolFixture, StaggeredDrainAgain) {
+  SessionPool p(this, 3, std::chrono::seconds(4));
+  for (int i = 0; i < 3; i++) {
+    p.putSession(makeParallelSession());
+  }
+  auto txn = CHECK_NOTNULL(p.getTransaction(this));
+
+  bool firstDone = false;
+  bool secondDone = false;
+  p.drainAllSessions(std::chrono::seconds(10), [&] { firstDone = true; });
+  auto progress = p.getDrainProgress();
+  ASSERT_NE(progress, nullptr);
+  EXPECT_EQ(progress->drained, 1);
+
+  // The two left are planned again over the shorter window, and counted
+  // once
+  p.drainAllSessions(std::chrono::milliseconds(50),
+                     [&] { secondDone = true; });
+  EXPECT_EQ(progress->scheduled, 3);
+  EXPECT_EQ(progress->drained, 2);
+  while (!secondDone) {
+    p.getEventBase()->loopOnce(EVLOOP_NONBLOCK);
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+  }
+  EXPECT_TRUE(firstDone);
+  EXPECT_EQ(p.getNumSessions(), 0);
+  EXPECT_EQ(progress->drained, 3);
+  EXPECT_EQ(progress->closed, 0);
+  txn->sendAbort();
+}
+
 TEST_F(SessionPoolFixture, InsertDrainedSession) {
   // Put a draining session into the pool. Make sure the pool ignores it.
   auto session = makeParallelSession();
@@ -605,6 +784,86 @@ TEST_F(SessionPoolFixture, ServerIdleSessionControllerTest) {
   s3->drain();
 }
 
+TEST_F(SessionPoolFixture, ServerIdleSessionControllerStealsFromMostIdle) {
+  TestIdleController ctrl;
+  ctrl.setMaxIdleCount(3);
+  SessionPool p1, p2;
+  auto s1 = makeParallelSession(), s2 = makeParallelSession(),
+       s3 = makeParallelSession();
+
+  // p2's session is the oldest, but p1 has more idle sessions
+  ctrl.addIdleSession(s1, &p2);
+  ctrl.addIdleSession(s2, &p1);
+  ctrl.addIdleSession(s3, &p1);
+  EXPECT_EQ(ctrl.popBestIdlePool(), &p1);
+  // Now tied, the oldest wins
+  EXPECT_EQ(ctrl.popBestIdlePool(), &p2);
+  EXPECT_EQ(ctrl.popBestIdlePool(), &p1);
+  EXPECT_EQ(ctrl.popBestIdlePool(), nullptr);
+
+  // The limit is server wide
+  ctrl.setMaxIdleCount(1);
+  ctrl.addIdleSession(s1, &p1);
+  ctrl.addIdleSession(s2, &p2);
+  EXPECT_EQ(ctrl.popBestIdlePool(), &p1);
+  EXPECT_EQ(ctrl.popBestIdlePool(), nullptr);
+
+  // Removing a session that was stolen is a no-op
+  ctrl.removeIdleSession(s1, &p1);
+  ctrl.addIdleSession(s2, &p2);
+  EXPECT_EQ(ctrl.popBestIdlePool(), &p2);
+
+  s1->drain();
+  s2->drain();
+  s3->drain();
+}
+
+TEST_F(SessionPoolFixture, ServerIdleSessionControllerReusesPools) {
+  TestIdleController ctrl;
+  auto s1 = makeParallelSession();
+  // More pools over time than there are entries
+  for (int i = 0; i < 300; ++i) {
+    SessionPool pool(this,
+                     10,
+                     std::chrono::seconds(30),
+                     std::chrono::milliseconds(0),
+                     nullptr,
+                     &ctrl);
+    ctrl.addIdleSession(s1, &pool);
+    if (i % 2 == 0) {
+      EXPECT_EQ(ctrl.popBestIdlePool(), &pool);
+    }
+  }
+  // The destroyed pools took their sessions with them
+  EXPECT_EQ(ctrl.popBestIdlePool(), nullptr);
+
+  SessionPool p1;
+  ctrl.addIdleSession(s1, &p1);
+  EXPECT_EQ(ctrl.popBestIdlePool(), &p1);
+
+  s1->drain();
+}
+
+TEST_F(SessionPoolFixture, ServerIdleSessionControllerSlotsFollowMaxIdle) {
+  TestIdleController ctrl;
+  ctrl.setMaxIdleCount(20);
+  SessionPool p1;
+  std::vector<HTTPUpstreamSession*> sessions;
+  for (int i = 0; i < 21; ++i) {
+    sessions.push_back(makeParallelSession());
+    ctrl.addIdleSession(sessions.back(), &p1);
+  }
+  // All but the one over the limit are shared
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(ctrl.popBestIdlePool(), &p1);
+  }
+  EXPECT_EQ(ctrl.popBestIdlePool(), nullptr);
+
+  for (auto session : sessions) {
+    session->drain();
+  }
+}
+
 TEST_F(SessionPoolFixture, WritePausedSessionNotMarkedAsIdle) {
   auto codec = makeParallelCodec();
   EXPECT_CALL(*codec, generateHeader(_, _, _, _, _, _))
@@ -723,6 +982,95 @@ TEST_F(SessionPoolFixture, ThreadIdleSessionControllerTrackSessionPoolChanges) {
   EXPECT_EQ(p2.getNumIdleSessions(), 1);
 }
 
+namespace {
+
+void sendGet(HTTPTransaction* txn) {
+  HTTPMessage req;
+  req.setMethod("GET");
+  req.setURL<string>("/");
+  req.setHTTPVersion(1, 1);
+  txn->sendHeaders(req);
+  txn->sendEOM();
+}
+
+void respond(HTTPCodec::Callback* cb,
+             HTTPCodec::StreamID id,
+             const std::string& keepAlive = "") {
+  auto resp = std::make_unique<HTTPMessage>();
+  resp->setStatusCode(200);
+  resp->setHTTPVersion(1, 1);
+  if (!keepAlive.empty()) {
+    resp->getHeaders().set(HTTP_HEADER_KEEP_ALIVE, keepAlive);
+  }
+  cb->onMessageBegin(id, resp.get());
+  cb->onHeadersComplete(id, std::move(resp));
+  cb->onMessageComplete(id, false);
+}
+
+} // namespace
+
+TEST_F(SessionPoolFixture, SerialPoolPipelining) {
+  SessionPool p(this, 1);
+  p.setPipelining(2, std::chrono::seconds(10));
+  HTTPCodec::Callback* cb = nullptr;
+  auto codec = makeSerialCodec();
+  EXPECT_CALL(*codec, setCallback(_)).WillRepeatedly(SaveArg<0>(&cb));
+  auto sess = makeSession(std::move(codec));
+  p.putSession(sess);
+
+  // Nothing is pipelined before a response shows the origin keeps the
+  // connection alive
+  auto txn1 = CHECK_NOTNULL(p.getTransaction(this));
+  sendGet(txn1);
+  evb_.loop();
+  EXPECT_EQ(p.getTransaction(this, true), nullptr);
+  respond(cb, txn1->getID());
+  evb_.loop();
+  EXPECT_EQ(p.getNumIdleSessions(), 1);
+
+  auto txn2 = CHECK_NOTNULL(p.getTransaction(this));
+  sendGet(txn2);
+  evb_.loop();
+  EXPECT_EQ(p.getNumFullSessions(), 1);
+  EXPECT_EQ(p.getTransaction(this), nullptr);
+  auto txn3 = p.getTransaction(this, true);
+  ASSERT_NE(txn3, nullptr);
+  EXPECT_EQ(sess->getNumOutgoingStreams(), 2);
+  // Depth 2
+  EXPECT_EQ(p.getTransaction(this, true), nullptr);
+
+  respond(cb, txn2->getID());
+  EXPECT_EQ(sess->getNumOutgoingStreams(), 1);
+  p.setMaxIdleSessions(0);
+  txn3->sendAbort();
+  evb_.loop();
+  EXPECT_EQ(closed_, 1);
+}
+
+TEST_F(SessionPoolFixture, ReuseTrackingKeepAlive) {
+  SessionPool p(this, 1);
+  p.setReuseTracking(ReuseTracker::Options());
+  HTTPCodec::Callback* cb = nullptr;
+  auto codec = makeSerialCodec();
+  EXPECT_CALL(*codec, setCallback(_)).WillRepeatedly(SaveArg<0>(&cb));
+  p.putSession(makeSession(std::move(codec)));
+
+  auto txn = CHECK_NOTNULL(p.getTransaction(this));
+  sendGet(txn);
+  evb_.loop();
+  // Within the 1s margin of any idle time
+  respond(cb, txn->getID(), "timeout=1, max=100");
+  evb_.loop();
+  EXPECT_EQ(p.getReuseTracker()->getKeepAliveTimeout(),
+            std::chrono::milliseconds(1000));
+  EXPECT_EQ(p.getNumIdleSessions(), 1);
+
+  EXPECT_EQ(p.getTransaction(this), nullptr);
+  EXPECT_EQ(p.getNumSessions(), 0);
+  evb_.loop();
+  EXPECT_EQ(closed_, 1);
+}
+
 TEST_F(SessionPoolFixture, DescribeWithNullTransport) {
   MockHQSession session;
   MockSessionHolderCallback cb;
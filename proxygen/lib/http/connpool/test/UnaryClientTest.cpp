@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/HHWheelTimer.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/HTTPException.h>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/connpool/UnaryClient.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+HTTPMessage makeRequest() {
+  HTTPMessage request;
+  request.setMethod(HTTPMethod::GET);
+  request.setURL("/rpc");
+  request.getHeaders().set(HTTP_HEADER_HOST, "service.test");
+  return request;
+}
+
+ProxygenError getError(folly::Try<UnaryClient::Response>& result) {
+  EXPECT_TRUE(result.hasException());
+  auto ex = result.exception().get_exception<HTTPException>();
+  return ex ? ex->getProxygenError() : kErrorNone;
+}
+
+} // namespace
+
+class UnaryClientTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    transport_ = new TestAsyncTransport(&evb_);
+    auto session = new HTTPUpstreamSession(
+        timeouts_.get(),
+        folly::AsyncTransport::UniquePtr(transport_),
+        folly::SocketAddress("127.0.0.1", 80),
+        folly::SocketAddress("127.0.0.1", 12345),
+        std::make_unique<HTTP1xCodec>(TransportDirection::UPSTREAM),
+        wangle::TransportInfo(),
+        nullptr);
+    session->startNow();
+    pool_ = std::make_unique<SessionPool>();
+    pool_->putSession(session);
+    client_ = std::make_unique<UnaryClient>(
+        *pool_, &evb_, UnaryClient::Options());
+  }
+
+  void TearDown() override {
+    client_.reset();
+    pool_.reset();
+    evb_.loop();
+  }
+
+  std::string getWritten() {
+    std::string written;
+    for (const auto& event : *transport_->getWriteEvents()) {
+      auto vec = event->getIoVec();
+      for (size_t i = 0; i < event->getCount(); i++) {
+        written.append(static_cast<const char*>(vec[i].iov_base),
+                       vec[i].iov_len);
+      }
+    }
+    return written;
+  }
+
+  void respond(const std::string& response) {
+    transport_->addReadEvent(response.data(), milliseconds(0));
+    transport_->startReadEvents();
+  }
+
+  folly::Try<UnaryClient::Response> wait(
+      folly::SemiFuture<UnaryClient::Response>& future) {
+    while (!future.isReady()) {
+      evb_.loopOnce();
+    }
+    return std::move(future).getTry();
+  }
+
+  folly::EventBase evb_;
+  folly::HHWheelTimer::UniquePtr timeouts_{folly::HHWheelTimer::newTimer(
+      &evb_,
+      std::chrono::milliseconds(folly::HHWheelTimer::DEFAULT_TICK_INTERVAL),
+      folly::TimeoutManager::InternalEnum::INTERNAL,
+      std::chrono::milliseconds(5000))};
+  TestAsyncTransport* transport_{nullptr};
+  std::unique_ptr<SessionPool> pool_;
+  std::unique_ptr<UnaryClient> client_;
+};
+
+TEST_F(UnaryClientTest, Response) {
+  auto future = client_->call(makeRequest());
+  EXPECT_EQ(client_->getNumCalls(), 1);
+  evb_.loopOnce();
+  auto written = getWritten();
+  EXPECT_EQ(written.find("GET /rpc HTTP/1.1\r\n"), 0);
+  EXPECT_NE(written.find("X-Deadline-Ms: "), std::string::npos);
+
+  respond("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+  auto result = wait(future);
+  ASSERT_TRUE(result.hasValue());
+  EXPECT_EQ(result->message->getStatusCode(), 200);
+  EXPECT_EQ(result->body->moveToFbString().toStdString(), "hello");
+  evb_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(client_->getNumCalls(), 0);
+  EXPECT_EQ(client_->getNumPooledCalls(), 1);
+
+  // The handler is reused
+  auto next = client_->call(makeRequest());
+  EXPECT_EQ(client_->getNumPooledCalls(), 0);
+  EXPECT_EQ(client_->getNumCalls(), 1);
+}
+
+TEST_F(UnaryClientTest, Timeout) {
+  auto future = client_->call(
+      makeRequest(), nullptr, steady_clock::now() + milliseconds(20));
+  auto result = wait(future);
+  EXPECT_EQ(getError(result), kErrorTimeout);
+}
+
+TEST_F(UnaryClientTest, PastDeadline) {
+  auto future = client_->call(makeRequest(), nullptr, steady_clock::now());
+  ASSERT_TRUE(future.isReady());
+  auto result = std::move(future).getTry();
+  EXPECT_EQ(getError(result), kErrorTimeout);
+  EXPECT_TRUE(transport_->getWriteEvents()->empty());
+}
+
+TEST_F(UnaryClientTest, NoSession) {
+  SessionPool empty;
+  UnaryClient client(empty, &evb_, UnaryClient::Options());
+  auto future = client.call(makeRequest());
+  ASSERT_TRUE(future.isReady());
+  auto result = std::move(future).getTry();
+  EXPECT_EQ(getError(result), kErrorConnect);
+  EXPECT_EQ(client.getNumCalls(), 0);
+}
+
+TEST_F(UnaryClientTest, DestroyedInFlight) {
+  auto future = client_->call(makeRequest());
+  evb_.loopOnce();
+  client_.reset();
+  ASSERT_TRUE(future.isReady());
+  auto result = std::move(future).getTry();
+  EXPECT_EQ(getError(result), kErrorDropped);
+}
+
+TEST(UnaryClientDeadlineTest, GetDeadline) {
+  HTTPMessage request = makeRequest();
+  EXPECT_FALSE(UnaryClient::getDeadline(request).has_value());
+  request.getHeaders().set(UnaryClient::kDeadlineHeader, "250");
+  auto before = steady_clock::now();
+  auto deadline = UnaryClient::getDeadline(request);
+  ASSERT_TRUE(deadline.has_value());
+  EXPECT_GE(*deadline, before + milliseconds(250));
+  EXPECT_LE(*deadline, steady_clock::now() + milliseconds(250));
+}
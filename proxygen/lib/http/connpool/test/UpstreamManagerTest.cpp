@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fizz/client/PskCache.h>
+#include <fizz/server/test/Mocks.h>
+#include <fizz/server/test/Utils.h>
+#include <folly/Conv.h>
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/portability/Unistd.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/connpool/UpstreamManager.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+class TestHandler : public HTTPTransaction::Handler {
+ public:
+  void setTransaction(HTTPTransaction* /*txn*/) noexcept override {
+  }
+  void detachTransaction() noexcept override {
+  }
+  void onHeadersComplete(
+      std::unique_ptr<HTTPMessage> /*msg*/) noexcept override {
+  }
+  void onBody(std::unique_ptr<folly::IOBuf> /*chain*/) noexcept override {
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders> /*trailers*/) noexcept override {
+  }
+  void onEOM() noexcept override {
+  }
+  void onUpgrade(UpgradeProtocol /*protocol*/) noexcept override {
+  }
+  void onError(const HTTPException& /*error*/) noexcept override {
+  }
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+};
+
+class TestUpstreamCallback : public UpstreamManager::Callback {
+ public:
+  void onTransaction(HTTPTransaction* txn) noexcept override {
+    txns.push_back(txn);
+  }
+  void onTransactionError(
+      const folly::exception_wrapper& error) noexcept override {
+    errors++;
+    if (error.is_compatible_with<UpstreamManager::CircuitOpenError>()) {
+      circuitOpenErrors++;
+    }
+  }
+
+  std::vector<HTTPTransaction*> txns;
+  size_t errors{0};
+  size_t circuitOpenErrors{0};
+};
+
+class CountingTLSStats : public UpstreamManager::TLSStats {
+ public:
+  void recordSecureConnect(bool resumed, bool earlyData) override {
+    connects++;
+    resumptions += resumed;
+    earlyDataConnects += earlyData;
+  }
+
+  size_t connects{0};
+  size_t resumptions{0};
+  size_t earlyDataConnects{0};
+};
+
+class RecordingPskCache : public fizz::client::BasicPskCache {
+ public:
+  folly::Optional<fizz::client::CachedPsk> getPsk(
+      const std::string& identity) override {
+    identities.push_back(identity);
+    return fizz::client::BasicPskCache::getPsk(identity);
+  }
+
+  std::vector<std::string> identities;
+};
+
+class KeepAliveCallbackFactory
+    : public fizz::server::test::FizzTestServer::CallbackFactory {
+ public:
+  fizz::server::AsyncFizzServer::HandshakeCallback* getCallback(
+      std::shared_ptr<fizz::server::AsyncFizzServer> server) override {
+    conns_.push_back(std::move(server));
+    return &handshakeCb_;
+  }
+
+ private:
+  NiceMock<fizz::server::test::MockHandshakeCallback> handshakeCb_;
+  std::vector<std::shared_ptr<fizz::server::AsyncFizzServer>> conns_;
+};
+
+} // namespace
+
+class UpstreamManagerTest : public testing::Test {
+ public:
+  void SetUp() override {
+    // The kernel completes the handshakes of the listening socket, nothing
+    // needs to accept them
+    server_.reset(new folly::AsyncServerSocket(&evb_));
+    server_->bind(folly::SocketAddress("127.0.0.1", 0));
+    server_->listen(16);
+    server_->getAddress(&serverAddr_);
+  }
+
+  void TearDown() override {
+    manager_.reset();
+    server_.reset();
+    evb_.loop();
+  }
+
+  void makeManager(UpstreamManager::Options options = {}) {
+    options.resolver = [this](const Endpoint&) {
+      resolves_++;
+      return serverAddr_;
+    };
+    manager_ = std::make_unique<UpstreamManager>(std::move(options), &evb_);
+  }
+
+  void abortAll(TestUpstreamCallback& cb) {
+    for (auto txn : cb.txns) {
+      txn->sendAbort();
+    }
+    cb.txns.clear();
+  }
+
+ protected:
+  folly::EventBase evb_;
+  TestHandler handler_;
+  const Endpoint endpoint_{"upstream.test", 80, false};
+  folly::AsyncServerSocket::UniquePtr server_;
+  folly::SocketAddress serverAddr_;
+  std::unique_ptr<UpstreamManager> manager_;
+  size_t resolves_{0};
+};
+
+TEST_F(UpstreamManagerTest, CoalescedConnect) {
+  UpstreamManager::Options options;
+  options.plaintextProtocol = "h2";
+  makeManager(std::move(options));
+
+  TestUpstreamCallback cb1;
+  TestUpstreamCallback cb2;
+  manager_->getTransaction(endpoint_, &handler_, &cb1);
+  manager_->getTransaction(endpoint_, &handler_, &cb2);
+  EXPECT_EQ(manager_->getNumWaitingRequests(endpoint_), 2);
+  EXPECT_TRUE(cb1.txns.empty());
+
+  while (cb1.txns.empty() || cb2.txns.empty()) {
+    evb_.loopOnce();
+  }
+  // One connection serves both requests
+  EXPECT_EQ(resolves_, 1);
+  EXPECT_EQ(manager_->getNumWaitingRequests(endpoint_), 0);
+  EXPECT_EQ(manager_->getSessionPool(endpoint_)->getNumSessions(), 1);
+
+  // The pooled session is reused without connecting
+  TestUpstreamCallback cb3;
+  manager_->getTransaction(endpoint_, &handler_, &cb3);
+  EXPECT_EQ(cb3.txns.size(), 1);
+  EXPECT_EQ(resolves_, 1);
+
+  abortAll(cb1);
+  abortAll(cb2);
+  abortAll(cb3);
+}
+
+TEST_F(UpstreamManagerTest, PlaintextNotCoalesced) {
+  UpstreamManager::Options options;
+  options.plaintextProtocol = "h2";
+  options.coalesce = true;
+  makeManager(std::move(options));
+
+  // Both resolve to the server, but without a certificate to vouch for them
+  const Endpoint other{"other.test", 80, false};
+  TestUpstreamCallback cb1;
+  TestUpstreamCallback cb2;
+  manager_->getTransaction(endpoint_, &handler_, &cb1);
+  while (cb1.txns.empty()) {
+    evb_.loopOnce();
+  }
+  manager_->getTransaction(other, &handler_, &cb2);
+  while (cb2.txns.empty()) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(resolves_, 2);
+  EXPECT_EQ(manager_->getSessionPool(other)->getNumSessions(), 1);
+  EXPECT_EQ(manager_->getNumCoalescedTransactions(), 0);
+
+  abortAll(cb1);
+  abortAll(cb2);
+}
+
+TEST_F(UpstreamManagerTest, SerialSessions) {
+  makeManager();
+
+  TestUpstreamCallback cb1;
+  TestUpstreamCallback cb2;
+  manager_->getTransaction(endpoint_, &handler_, &cb1);
+  manager_->getTransaction(endpoint_, &handler_, &cb2);
+
+  while (cb1.txns.empty() || cb2.txns.empty()) {
+    evb_.loopOnce();
+  }
+  // HTTP/1.1 sessions take one transaction each, so the second request
+  // waited for a second connection
+  EXPECT_EQ(resolves_, 2);
+  EXPECT_EQ(manager_->getSessionPool(endpoint_)->getNumFullSessions(), 2);
+
+  abortAll(cb1);
+  abortAll(cb2);
+}
+
+TEST_F(UpstreamManagerTest, ConnectError) {
+  // Nothing listens there anymore
+  server_.reset();
+  makeManager();
+
+  TestUpstreamCallback cb1;
+  TestUpstreamCallback cb2;
+  manager_->getTransaction(endpoint_, &handler_, &cb1);
+  manager_->getTransaction(endpoint_, &handler_, &cb2);
+  while (cb1.errors == 0 || cb2.errors == 0) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(resolves_, 1);
+  EXPECT_TRUE(cb1.txns.empty());
+  EXPECT_TRUE(cb2.txns.empty());
+  EXPECT_EQ(manager_->getNumWaitingRequests(endpoint_), 0);
+}
+
+TEST_F(UpstreamManagerTest, CircuitBreaker) {
+  server_.reset();
+  UpstreamManager::Options options;
+  options.circuitBreakerFailures = 2;
+  options.circuitOpenTime = std::chrono::milliseconds(20);
+  makeManager(std::move(options));
+
+  auto connect = [this](TestUpstreamCallback& cb) {
+    auto errors = cb.errors;
+    manager_->getTransaction(endpoint_, &handler_, &cb);
+    while (cb.errors == errors) {
+      evb_.loopOnce();
+    }
+  };
+  TestUpstreamCallback cb1;
+  connect(cb1);
+  EXPECT_EQ(manager_->getCircuitState(endpoint_),
+            UpstreamManager::CircuitState::CLOSED);
+  connect(cb1);
+  EXPECT_EQ(manager_->getCircuitState(endpoint_),
+            UpstreamManager::CircuitState::OPEN);
+  EXPECT_EQ(cb1.circuitOpenErrors, 0);
+
+  // Failed without connecting
+  TestUpstreamCallback cb2;
+  manager_->getTransaction(endpoint_, &handler_, &cb2);
+  EXPECT_EQ(cb2.circuitOpenErrors, 1);
+  EXPECT_EQ(resolves_, 2);
+
+  // One probe once half open, failing opens it again
+  /* sleep override */ usleep(25000);
+  EXPECT_EQ(manager_->getCircuitState(endpoint_),
+            UpstreamManager::CircuitState::HALF_OPEN);
+  TestUpstreamCallback probe;
+  TestUpstreamCallback cb3;
+  manager_->getTransaction(endpoint_, &handler_, &probe);
+  manager_->getTransaction(endpoint_, &handler_, &cb3);
+  EXPECT_EQ(cb3.circuitOpenErrors, 1);
+  while (probe.errors == 0) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(probe.circuitOpenErrors, 0);
+  EXPECT_EQ(resolves_, 3);
+  EXPECT_EQ(manager_->getCircuitState(endpoint_),
+            UpstreamManager::CircuitState::OPEN);
+}
+
+TEST_F(UpstreamManagerTest, Cancel) {
+  makeManager();
+
+  TestUpstreamCallback cb;
+  manager_->getTransaction(endpoint_, &handler_, &cb);
+  EXPECT_EQ(manager_->getNumWaitingRequests(endpoint_), 1);
+  manager_->cancel(&cb);
+  EXPECT_EQ(manager_->getNumWaitingRequests(endpoint_), 0);
+
+  // The session of the canceled request is pooled but not used
+  while (manager_->getSessionPool(endpoint_)->getNumSessions() == 0) {
+    evb_.loopOnce();
+  }
+  EXPECT_TRUE(cb.txns.empty());
+  EXPECT_EQ(cb.errors, 0);
+}
+
+TEST_F(UpstreamManagerTest, WarmMinIdleSessions) {
+  UpstreamManager::Options options;
+  options.maxIdleSessionsPerEndpoint = 2;
+  options.minIdleSessions = 2;
+  options.warmInterval = std::chrono::milliseconds(1);
+  options.maxWarmConnectsPerSecond = 1000;
+  makeManager(std::move(options));
+
+  TestUpstreamCallback cb;
+  manager_->getTransaction(endpoint_, &handler_, &cb);
+  auto pool = manager_->getSessionPool(endpoint_);
+  while (cb.txns.empty() || pool->getNumIdleSessions() < 2) {
+    evb_.loopOnce();
+  }
+  // The busy HTTP/1.1 session is not spare, so two more were opened
+  EXPECT_EQ(resolves_, 3);
+  EXPECT_EQ(pool->getNumSessions(), 3);
+  // and the next request doesn't wait
+  TestUpstreamCallback cb2;
+  manager_->getTransaction(endpoint_, &handler_, &cb2);
+  EXPECT_EQ(cb2.txns.size(), 1);
+
+  abortAll(cb);
+  abortAll(cb2);
+}
+
+TEST_F(UpstreamManagerTest, WarmRateLimited) {
+  UpstreamManager::Options options;
+  options.maxIdleSessionsPerEndpoint = 4;
+  options.minIdleSessions = 4;
+  options.warmInterval = std::chrono::milliseconds(1);
+  // The bucket starts full with one connect, and refills in 1000s
+  options.maxWarmConnectsPerSecond = 0.001;
+  makeManager(std::move(options));
+
+  TestUpstreamCallback cb;
+  manager_->getTransaction(endpoint_, &handler_, &cb);
+  auto pool = manager_->getSessionPool(endpoint_);
+  while (cb.txns.empty() || pool->getNumIdleSessions() < 1) {
+    evb_.loopOnce();
+  }
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(50);
+  while (std::chrono::steady_clock::now() < deadline) {
+    evb_.loopOnce(EVLOOP_NONBLOCK);
+  }
+  EXPECT_EQ(resolves_, 2);
+  EXPECT_EQ(pool->getNumIdleSessions(), 1);
+
+  abortAll(cb);
+}
+
+TEST_F(UpstreamManagerTest, FizzPskKeyedOnEndpoint) {
+  KeepAliveCallbackFactory factory;
+  fizz::server::test::FizzTestServer fizzServer(evb_, &factory);
+  serverAddr_ = fizzServer.getAddress();
+
+  auto pskCache = std::make_shared<RecordingPskCache>();
+  auto context = std::make_shared<fizz::client::FizzClientContext>();
+  context->setPskCache(pskCache);
+  CountingTLSStats tlsStats;
+  UpstreamManager::Options options;
+  options.fizzContext = context;
+  options.tlsStats = &tlsStats;
+  makeManager(std::move(options));
+
+  const Endpoint secureEndpoint("upstream.test", 443, true);
+  TestUpstreamCallback cb;
+  manager_->getTransaction(secureEndpoint, &handler_, &cb);
+  while (cb.txns.empty() && cb.errors == 0) {
+    evb_.loopOnce();
+  }
+  ASSERT_EQ(cb.txns.size(), 1);
+  EXPECT_EQ(pskCache->identities,
+            std::vector<std::string>{"upstream.test:443"});
+  EXPECT_EQ(tlsStats.connects, 1);
+  EXPECT_EQ(tlsStats.resumptions, 0);
+  EXPECT_EQ(tlsStats.earlyDataConnects, 0);
+
+  abortAll(cb);
+  manager_.reset();
+}
+
+TEST_F(UpstreamManagerTest, AltSvcFallsBackToTCP) {
+  KeepAliveCallbackFactory factory;
+  fizz::server::test::FizzTestServer fizzServer(evb_, &factory);
+  serverAddr_ = fizzServer.getAddress();
+
+  UpstreamManager::Options options;
+  options.fizzContext = std::make_shared<fizz::client::FizzClientContext>();
+  options.quicFizzContext =
+      std::make_shared<fizz::client::FizzClientContext>();
+  options.altSvcUpgrade = true;
+  options.connectTimeout = std::chrono::milliseconds(100);
+  makeManager(std::move(options));
+
+  // Over TLS until HTTP/3 is advertised
+  const Endpoint secureEndpoint("upstream.test", 443, true);
+  TestUpstreamCallback cb1;
+  manager_->getTransaction(secureEndpoint, &handler_, &cb1);
+  while (cb1.txns.empty() && cb1.errors == 0) {
+    evb_.loopOnce();
+  }
+  ASSERT_EQ(cb1.txns.size(), 1);
+  EXPECT_FALSE(manager_->getHTTP3Port(secureEndpoint));
+
+  // Only h3 on the endpoint's host
+  manager_->onAltSvc(secureEndpoint, "h3=\"other.test:443\", h2=\":443\"");
+  EXPECT_FALSE(manager_->getHTTP3Port(secureEndpoint));
+  auto port = serverAddr_.getPort();
+  manager_->onAltSvc(secureEndpoint,
+                     folly::to<std::string>("h3=\":", port, "\""));
+  EXPECT_EQ(manager_->getHTTP3Port(secureEndpoint), port);
+
+  // Nothing answers QUIC there
+  while (manager_->getHTTP3Port(secureEndpoint)) {
+    evb_.loopOnce();
+  }
+  TestUpstreamCallback cb2;
+  manager_->getTransaction(secureEndpoint, &handler_, &cb2);
+  while (cb2.txns.empty() && cb2.errors == 0) {
+    evb_.loopOnce();
+  }
+  EXPECT_EQ(cb2.txns.size(), 1);
+
+  abortAll(cb1);
+  abortAll(cb2);
+  manager_.reset();
+}
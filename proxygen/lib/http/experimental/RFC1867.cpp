@@ -49,6 +49,49 @@ BoundaryResult isBoundary(const IOBuf& buf,
   return BoundaryResult::PARTIAL;
 }
 
+/**
+ * Offset in head of the first match of boundary, which may continue in the
+ * rest of the chain, or of a partial match at the end of the chain. The
+ * windows within head are scanned with Boyer-Moore-Horspool, then the few
+ * that straddle its end with isBoundary().
+ */
+size_t findBoundary(const IOBuf& head,
+                    const std::string& boundary,
+                    const std::array<uint32_t, 256>& skip,
+                    BoundaryResult& result) {
+  const uint8_t* data = head.data();
+  size_t len = head.length();
+  size_t blen = boundary.length();
+  auto last = static_cast<uint8_t>(boundary[blen - 1]);
+  // Windows within head, without touching the rest of the chain
+  size_t pos = 0;
+  while (pos + blen <= len) {
+    uint8_t ch = data[pos + blen - 1];
+    if (ch == last && memcmp(data + pos, boundary.data(), blen - 1) == 0) {
+      result = BoundaryResult::YES;
+      return pos;
+    }
+    pos += skip[ch];
+  }
+  // The boundary may straddle the end of head
+  pos = len >= blen ? len - blen + 1 : 0;
+  while (pos < len) {
+    auto ptr = static_cast<const uint8_t*>(
+        memchr(data + pos, boundary[0], len - pos));
+    if (!ptr) {
+      break;
+    }
+    pos = ptr - data;
+    result = isBoundary(head, pos, boundary.data(), blen);
+    if (result != BoundaryResult::NO) {
+      return pos;
+    }
+    pos++;
+  }
+  result = BoundaryResult::NO;
+  return len;
+}
+
 } // namespace
 
 namespace proxygen {
@@ -217,72 +260,59 @@ void RFC1867Codec::onHeadersComplete(HTTPCodec::StreamID /*stream*/,
   }
 }
 
+void RFC1867Codec::initSkipTable() {
+  auto len = boundary_.length();
+  skip_.fill(len);
+  for (size_t i = 0; i + 1 < len; i++) {
+    skip_[static_cast<uint8_t>(boundary_[i])] = len - 1 - i;
+  }
+}
+
 IOBufQueue RFC1867Codec::readToBoundary(bool& foundBoundary) {
   IOBufQueue result{IOBufQueue::cacheChainLength()};
   BoundaryResult boundaryResult = BoundaryResult::NO;
 
   while (!input_.empty() && boundaryResult != BoundaryResult::PARTIAL) {
     const IOBuf* head = input_.front();
-    uint64_t len = head->length();
-    const uint8_t* ptr = head->data();
-
-    /* iterate through first character matches */
-    while (len > 0 && (ptr = (const uint8_t*)memchr(ptr, boundary_[0], len))) {
-      /* calculate length after match */
-      uint64_t readlen = (ptr - head->data());
-      len = head->length() - readlen;
-      boundaryResult =
-          isBoundary(*head, readlen, boundary_.data(), boundary_.length());
-      if (boundaryResult == BoundaryResult::YES) {
-        CHECK(readlen < head->length());
-        bool hasCr = false;
-        if (readlen == 0 && pendingCR_) {
-          pendingCR_.reset();
-        }
-        if (readlen > 0) {
-          // If the last read char is a CR omit from result
-          Cursor c(head);
-          c.skip(readlen - 1);
-          uint8_t ch = c.read<uint8_t>();
-          if (ch == '\r') {
-            --readlen;
-            hasCr = true;
-          }
-        }
-        result.append(std::move(pendingCR_));
-        result.append(input_.split(readlen));
-        uint32_t trimLen = boundary_.length() + (hasCr ? 1 : 0);
-        input_.trimStart(trimLen);
-        bytesProcessed_ += readlen + trimLen;
-        foundBoundary = true;
-        return result;
-      } else if (boundaryResult == BoundaryResult::PARTIAL) {
-        break;
-      } else if (pendingCR_) {
-        // not a match, append pending CR to result
-        result.append(std::move(pendingCR_));
+    if (head->length() == 0) {
+      input_.pop_front();
+      continue;
+    }
+    uint64_t readlen = findBoundary(*head, boundary_, skip_, boundaryResult);
+    if (boundaryResult == BoundaryResult::YES) {
+      CHECK(readlen < head->length());
+      bool hasCr = false;
+      if (readlen == 0 && pendingCR_) {
+        pendingCR_.reset();
       }
-
-      /* next character */
-      ptr++;
-      len--;
+      // If the last read char is a CR omit from result
+      if (readlen > 0 && head->data()[readlen - 1] == '\r') {
+        --readlen;
+        hasCr = true;
+      }
+      result.append(std::move(pendingCR_));
+      result.append(input_.split(readlen));
+      uint32_t trimLen = boundary_.length() + (hasCr ? 1 : 0);
+      input_.trimStart(trimLen);
+      bytesProcessed_ += readlen + trimLen;
+      foundBoundary = true;
+      return result;
     }
-    uint64_t resultLen = ptr ? ptr - head->data() : head->length();
     // Put pendingCR_ in result if there was no partial match in head, or a
     // partial match starting after the first character
-    if ((boundaryResult == BoundaryResult::NO || resultLen > 0) && pendingCR_) {
+    if ((boundaryResult == BoundaryResult::NO || readlen > 0) && pendingCR_) {
       result.append(std::move(pendingCR_));
     }
-    // the boundary does not start through resultLen, append it
+    // the boundary does not start through readlen, append it
     // to result, except maybe the last char if it's a CR.
-    if (resultLen > 0 && head->data()[resultLen - 1] == '\r') {
-      result.append(input_.split(resultLen - 1));
+    if (readlen > 0 && head->data()[readlen - 1] == '\r') {
+      result.append(input_.split(readlen - 1));
       CHECK(!pendingCR_);
       pendingCR_ = input_.split(1);
     } else {
-      result.append(input_.split(resultLen));
+      result.append(input_.split(readlen));
     }
-    bytesProcessed_ += resultLen;
+    bytesProcessed_ += readlen;
   }
 
   // reached the end but no boundary found
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <array>
+
 #include <folly/Conv.h>
 #include <proxygen/lib/http/codec/HTTP1xCodec.h>
 
@@ -47,6 +49,7 @@ class RFC1867Codec : HTTPCodec::Callback {
   explicit RFC1867Codec(const std::string& boundary) {
     CHECK(!boundary.empty());
     boundary_ = folly::to<std::string>("\n--", boundary);
+    initSkipTable();
     headerParser_.setCallback(this);
   }
 
@@ -105,9 +108,14 @@ class RFC1867Codec : HTTPCodec::Callback {
     headerParser_.setParserPaused(true);
   }
 
+  // Parts are passed on as slices of the input buffers, which are scanned
+  // with Boyer-Moore-Horspool
   folly::IOBufQueue readToBoundary(bool& foundBoundary);
+  void initSkipTable();
 
   std::string boundary_;
+  // Horspool shift for each byte at the end of the window
+  std::array<uint32_t, 256> skip_;
   Callback* callback_{nullptr};
   ParserState state_{ParserState::START};
   HTTP1xCodec headerParser_{TransportDirection::DOWNSTREAM};
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <proxygen/lib/http/experimental/RFC1867.h>
+
+using namespace proxygen;
+
+// Parses a multipart POST with one 16MB file, fed to the codec in chunks
+// of the given size, the way a network read loop would. The throughput is
+// that of the boundary search, as the parts are passed on as slices.
+
+namespace {
+
+const std::string kBoundary("----WebKitFormBoundary7MA4YWxkTrZu0gW");
+constexpr size_t kFileSize = 16 * 1024 * 1024;
+
+class CountingCallback : public RFC1867Codec::Callback {
+ public:
+  int onFieldStart(const std::string&,
+                   folly::Optional<std::string>,
+                   std::unique_ptr<HTTPMessage>,
+                   uint64_t) override {
+    return 0;
+  }
+  int onFieldData(std::unique_ptr<folly::IOBuf> data, uint64_t) override {
+    bytes += data->computeChainDataLength();
+    return 0;
+  }
+  void onFieldEnd(bool, uint64_t) override {
+  }
+  void onError() override {
+    errors++;
+  }
+
+  size_t bytes{0};
+  size_t errors{0};
+};
+
+// newlineEvery adds a newline to the file that often, as text files have
+std::unique_ptr<folly::IOBuf> makePost(size_t newlineEvery) {
+  std::string file(kFileSize, '\0');
+  for (size_t i = 0; i < file.size(); i++) {
+    file[i] = static_cast<char>(folly::Random::rand32(256));
+    if (newlineEvery && i % newlineEvery == 0) {
+      file[i] = '\n';
+    } else if (file[i] == '\n') {
+      file[i] = 'x';
+    }
+  }
+  folly::IOBufQueue post;
+  post.append("--" + kBoundary + "\r\n");
+  post.append(
+      "Content-Disposition: form-data; name=\"file\"; "
+      "filename=\"upload.bin\"\r\n\r\n");
+  post.append(file);
+  post.append("\r\n--" + kBoundary + "--\r\n");
+  return post.move();
+}
+
+void parseInChunks(const folly::IOBuf& post, size_t chunkSize, size_t iters) {
+  for (size_t i = 0; i < iters; i++) {
+    folly::IOBufQueue input{folly::IOBufQueue::cacheChainLength()};
+    std::unique_ptr<folly::IOBuf> rem;
+    CountingCallback callback;
+    RFC1867Codec codec(kBoundary);
+    BENCHMARK_SUSPEND {
+      // Chunks shared with post, so that only the parsing is timed
+      input.append(post.clone());
+      codec.setCallback(&callback);
+    }
+    while (!input.empty()) {
+      auto chunk = input.split(std::min(chunkSize, input.chainLength()));
+      if (rem) {
+        rem->prependChain(std::move(chunk));
+        chunk = std::move(rem);
+      }
+      rem = codec.onIngress(std::move(chunk));
+    }
+    codec.onIngressEOM();
+    CHECK_EQ(callback.bytes, kFileSize);
+    CHECK_EQ(callback.errors, 0);
+  }
+}
+
+const folly::IOBuf& binaryPost() {
+  static auto post = makePost(0);
+  return *post;
+}
+
+const folly::IOBuf& textPost() {
+  static auto post = makePost(80);
+  return *post;
+}
+
+} // namespace
+
+BENCHMARK(binary_4KB_chunks, iters) {
+  parseInChunks(binaryPost(), 4096, iters);
+}
+
+BENCHMARK_RELATIVE(binary_64KB_chunks, iters) {
+  parseInChunks(binaryPost(), 64 * 1024, iters);
+}
+
+BENCHMARK(text_4KB_chunks, iters) {
+  parseInChunks(textPost(), 4096, iters);
+}
+
+BENCHMARK_RELATIVE(text_64KB_chunks, iters) {
+  parseInChunks(textPost(), 64 * 1024, iters);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
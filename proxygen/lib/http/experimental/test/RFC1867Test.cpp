@@ -237,6 +237,40 @@ TEST_F(RFC1867Test, TestHeadersChunkExtraCr) {
   testSimple(std::move(data), 3 + 5 + fileSize, numCRs - 1, 3);
 }
 
+TEST_F(RFC1867Test, TestNearBoundaries) {
+  // Prefixes of the boundary, in every position relative to the splits
+  string content;
+  for (size_t i = 0; i < kTestBoundary.size(); i++) {
+    content += "\r\n--" + kTestBoundary.substr(0, i) + "x\n";
+  }
+  for (size_t i = 1; i < content.size(); i++) {
+    auto data = makePost({{"foo", "bar"}, {"jojo", "binky"}},
+                         {{"file1", {"file1.txt", content}}},
+                         {});
+    testSimple(std::move(data), 3 + 5 + content.size(), i, 3);
+  }
+}
+
+TEST_F(RFC1867Test, TestPartsAreSlices) {
+  // Parts are passed on without copying the input
+  auto data = makePost({}, {}, {{"file1", {"", 100000}}});
+  auto input = data->clone();
+  input->coalesce();
+  auto begin = input->data();
+  auto end = begin + input->length();
+  EXPECT_CALL(callback_, onFieldStartImpl(_, _, _, _)).WillOnce(Return(0));
+  EXPECT_CALL(callback_, onFieldData(_, _))
+      .WillRepeatedly(Invoke([&](std::shared_ptr<IOBuf> buf, uint64_t) {
+        for (auto& range : *buf) {
+          EXPECT_GE(range.begin(), begin);
+          EXPECT_LE(range.end(), end);
+        }
+        return 0;
+      }));
+  EXPECT_CALL(callback_, onFieldEnd(true, _));
+  parse(std::move(input), 4096);
+}
+
 class RFC1867CR
     : public testing::TestWithParam<string>
     , public RFC1867Base {
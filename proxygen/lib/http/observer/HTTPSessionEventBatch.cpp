@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/observer/HTTPSessionEventBatch.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+HTTPSessionEventBatch::~HTTPSessionEventBatch() {
+  deliver(true);
+}
+
+void HTTPSessionEventBatch::addObserver(Observer* observer,
+                                        uint32_t mask,
+                                        folly::EventBase* evb) {
+  CHECK(observer);
+  if (evb) {
+    DCHECK(!evb_ || evb_ == evb);
+    evb_ = evb;
+  }
+  auto it = std::find_if(
+      subscribers_.begin(), subscribers_.end(), [observer](const auto& sub) {
+        return sub.observer == observer;
+      });
+  if (it != subscribers_.end()) {
+    it->mask = mask;
+  } else {
+    subscribers_.push_back(Subscriber{observer, mask});
+  }
+  updateMask();
+}
+
+void HTTPSessionEventBatch::removeObserver(Observer* observer) {
+  subscribers_.erase(
+      std::remove_if(
+          subscribers_.begin(),
+          subscribers_.end(),
+          [observer](const auto& sub) { return sub.observer == observer; }),
+      subscribers_.end());
+  updateMask();
+  if (subscribers_.empty()) {
+    records_.clear();
+    cancelLoopCallback();
+  }
+}
+
+void HTTPSessionEventBatch::attachEventBase(folly::EventBase* evb) {
+  CHECK(evb);
+  cancelLoopCallback();
+  evb_ = evb;
+  if (!records_.empty()) {
+    evb_->runInLoop(this);
+  }
+}
+
+void HTTPSessionEventBatch::detachEventBase() {
+  // Still in the thread of the old one
+  deliver(false);
+  cancelLoopCallback();
+  evb_ = nullptr;
+}
+
+HTTPSessionEventBatch::Record& HTTPSessionEventBatch::record(
+    Events event, uint64_t streamID) {
+  DCHECK(wants(event));
+  if (evb_ && !isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+  records_.emplace_back();
+  auto& record = records_.back();
+  record.type = event;
+  record.streamID = streamID;
+  record.time = getCurrentTime();
+  return record;
+}
+
+void HTTPSessionEventBatch::deliver(bool last) {
+  if (records_.empty() && !last) {
+    return;
+  }
+  // Observers may add records or remove themselves while called
+  auto records = std::move(records_);
+  records_.clear();
+  auto subscribers = subscribers_;
+  auto mask = mask_;
+  for (const auto& sub : subscribers) {
+    if (std::none_of(subscribers_.begin(),
+                     subscribers_.end(),
+                     [&sub](const auto& current) {
+                       return current.observer == sub.observer;
+                     })) {
+      continue;
+    }
+    if (sub.mask == mask) {
+      sub.observer->onEventBatch(folly::range(records), last);
+      continue;
+    }
+    std::vector<Record> filtered;
+    for (const auto& record : records) {
+      if (sub.mask & eventBit(record.type)) {
+        filtered.push_back(record);
+      }
+    }
+    if (!filtered.empty() || last) {
+      sub.observer->onEventBatch(folly::range(filtered), last);
+    }
+  }
+  // Reusing the allocation
+  if (records_.empty()) {
+    records_ = std::move(records);
+    records_.clear();
+  }
+}
+
+void HTTPSessionEventBatch::updateMask() {
+  mask_ = 0;
+  for (const auto& sub : subscribers_) {
+    mask_ |= sub.mask;
+  }
+}
+
+} // namespace proxygen
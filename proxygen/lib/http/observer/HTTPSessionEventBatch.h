@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/observer/HTTPSessionObserverInterface.h>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Batched delivery of the events of a session, for observers interested in
+ * many of them, e.g. telemetry: compact records of the events are kept and
+ * delivered together once per event loop iteration, and when the session
+ * goes away, rather than by a virtual call per event.  The mask of the
+ * events of all the batch observers is checked inline, so an event none of
+ * them wants costs a branch.
+ */
+class HTTPSessionEventBatch : private folly::EventBase::LoopCallback {
+ public:
+  using Events = HTTPSessionObserverInterface::Events;
+
+  struct Record {
+    Events type;
+    uint64_t streamID{0};
+    TimePoint time;
+    // requestStarted: the number of request headers
+    uint32_t headerCount{0};
+    // transactionTimings
+    HTTPTransactionTimings timings;
+  };
+
+  class Observer {
+   public:
+    virtual ~Observer() = default;
+
+    // The records of the events of the mask of the observer, in order.
+    // last is set once the session goes away.
+    virtual void onEventBatch(folly::Range<const Record*> records,
+                              bool last) noexcept = 0;
+  };
+
+  static constexpr uint32_t eventBit(Events event) {
+    return 1u << static_cast<uint32_t>(event);
+  }
+
+  HTTPSessionEventBatch() = default;
+  // Delivers what is left, as the last batch
+  ~HTTPSessionEventBatch() override;
+
+  HTTPSessionEventBatch(const HTTPSessionEventBatch&) = delete;
+  HTTPSessionEventBatch& operator=(const HTTPSessionEventBatch&) = delete;
+
+  /**
+   * mask is of eventBit()s.  Batches are delivered in the loop of evb, or at
+   * the end without one.  Adding an observer again changes its mask.
+   */
+  void addObserver(Observer* observer,
+                   uint32_t mask,
+                   folly::EventBase* evb = nullptr);
+  void removeObserver(Observer* observer);
+
+  /**
+   * Moves the delivery to the loop of evb, as the session moves to its
+   * thread.  detachEventBase() delivers the records kept first.
+   */
+  void attachEventBase(folly::EventBase* evb);
+  void detachEventBase();
+
+  bool wants(Events event) const {
+    return mask_ & eventBit(event);
+  }
+
+  // A record for event, which must be wanted, to fill in
+  Record& record(Events event, uint64_t streamID);
+
+  // Delivers the records kept now
+  void flush() {
+    deliver(false);
+  }
+
+  size_t getNumRecords() const {
+    return records_.size();
+  }
+
+ private:
+  struct Subscriber {
+    Observer* observer;
+    uint32_t mask;
+  };
+
+  void runLoopCallback() noexcept override {
+    deliver(false);
+  }
+  void deliver(bool last);
+  void updateMask();
+
+  std::vector<Subscriber> subscribers_;
+  std::vector<Record> records_;
+  uint32_t mask_{0};
+  folly::EventBase* evb_{nullptr};
+};
+
+} // namespace proxygen
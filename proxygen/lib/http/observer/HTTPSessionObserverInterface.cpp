@@ -28,4 +28,21 @@ HTTPSessionObserverInterface::RequestStartedEvent::RequestStartedEvent(
           *CHECK_NOTNULL(builderFields.maybeHTTPHeadersRef.get_pointer())) {
 }
 
+HTTPSessionObserverInterface::TransactionTimingsEvent::Builder&&
+HTTPSessionObserverInterface::TransactionTimingsEvent::Builder::setTimings(
+    const proxygen::HTTPTransactionTimings& timingsIn) {
+  maybeTimingsRef = timingsIn;
+  return std::move(*this);
+}
+
+HTTPSessionObserverInterface::TransactionTimingsEvent
+HTTPSessionObserverInterface::TransactionTimingsEvent::Builder::build() && {
+  return TransactionTimingsEvent(*this);
+}
+
+HTTPSessionObserverInterface::TransactionTimingsEvent::TransactionTimingsEvent(
+    const TransactionTimingsEvent::BuilderFields& builderFields)
+    : timings(*CHECK_NOTNULL(builderFields.maybeTimingsRef.get_pointer())) {
+}
+
 } // namespace proxygen
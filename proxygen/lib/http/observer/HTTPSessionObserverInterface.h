@@ -10,6 +10,7 @@
 
 #include <glog/logging.h>
 #include <proxygen/lib/http/HTTPHeaders.h>
+#include <proxygen/lib/http/session/HTTPTransactionTimings.h>
 #include <utility>
 
 namespace proxygen {
@@ -42,7 +43,7 @@ class HTTPSessionObserverAccessor {
  */
 class HTTPSessionObserverInterface {
  public:
-  enum class Events { requestStarted = 1 };
+  enum class Events { requestStarted = 1, transactionTimings = 2 };
 
   virtual ~HTTPSessionObserverInterface() = default;
 
@@ -74,6 +75,31 @@ class HTTPSessionObserverInterface {
     explicit RequestStartedEvent(const BuilderFields& builderFields);
   };
 
+  struct TransactionTimingsEvent {
+    const HTTPTransactionTimings& timings;
+
+    // Do not support copy or move given that timings is a ref.
+    TransactionTimingsEvent(TransactionTimingsEvent&&) = delete;
+    TransactionTimingsEvent& operator=(const TransactionTimingsEvent&) =
+        delete;
+    TransactionTimingsEvent& operator=(TransactionTimingsEvent&& rhs) = delete;
+
+    struct BuilderFields {
+      folly::Optional<std::reference_wrapper<const HTTPTransactionTimings>>
+          maybeTimingsRef;
+      explicit BuilderFields() = default;
+    };
+
+    struct Builder : public BuilderFields {
+      Builder&& setTimings(const proxygen::HTTPTransactionTimings& timings);
+      TransactionTimingsEvent build() &&;
+      explicit Builder() = default;
+    };
+
+    // Use builder to construct.
+    explicit TransactionTimingsEvent(const BuilderFields& builderFields);
+  };
+
   /**
    * Events.
    */
@@ -87,6 +113,18 @@ class HTTPSessionObserverInterface {
   virtual void requestStarted(HTTPSessionObserverAccessor* /* session */,
                               const RequestStartedEvent& /* event */) noexcept {
   }
+
+  /**
+   * transactionTimings() is invoked as a transaction is detached, when the
+   * session records transaction timings.
+   *
+   * @param session  Http session.
+   * @param event    TransactionTimingsEvent with the timings.
+   */
+  virtual void transactionTimings(
+      HTTPSessionObserverAccessor* /* session */,
+      const TransactionTimingsEvent& /* event */) noexcept {
+  }
 };
 
 } // namespace proxygen
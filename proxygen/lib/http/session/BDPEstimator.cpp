@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/BDPEstimator.h>
+
+#include <algorithm>
+#include <folly/Indestructible.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+namespace {
+// The RTT is the average of the first kBootstrapSamples, then an EWMA
+// with the gain of RFC 6298's SRTT, so one late ack moves it by 1/8
+constexpr uint32_t kBootstrapSamples = 10;
+constexpr double kRTTAlpha = 1.0 / 8;
+// Grow when a sample is at least kGrowThreshold of the estimate, to
+// kGrowFactor times the sample
+constexpr double kGrowThreshold = 0.66;
+constexpr double kGrowFactor = 2;
+// How much larger than the BDP a sample can be on a saturated link
+constexpr double kSampleOvershoot = 1.5;
+} // namespace
+
+bool BDPEstimator::onBytesReceived(uint64_t bytes, TimePoint now) {
+  if (bdp_ >= maxBDP_) {
+    return false;
+  }
+  if (!pingOutstanding_) {
+    pingOutstanding_ = true;
+    pingSent_ = now;
+    sample_ = bytes;
+    return true;
+  }
+  sample_ += bytes;
+  return false;
+}
+
+folly::Optional<uint32_t> BDPEstimator::onPingAck(TimePoint now) {
+  if (!pingOutstanding_) {
+    return folly::none;
+  }
+  pingOutstanding_ = false;
+  auto rttSample = std::max(
+      std::chrono::duration_cast<std::chrono::microseconds>(now - pingSent_),
+      std::chrono::microseconds(1));
+  numSamples_++;
+  double rtt = rtt_.count();
+  if (numSamples_ <= kBootstrapSamples) {
+    rtt += (rttSample.count() - rtt) / numSamples_;
+  } else {
+    rtt += (rttSample.count() - rtt) * kRTTAlpha;
+  }
+  rtt_ = std::chrono::microseconds(std::max<int64_t>(rtt, 1));
+
+  double bandwidth = sample_ / (rtt_.count() * kSampleOvershoot);
+  maxBandwidth_ = std::max(maxBandwidth_, bandwidth);
+  VLOG(5) << "BDP sample=" << sample_ << " rtt=" << rtt_.count()
+          << "us bdp=" << bdp_;
+  if (sample_ < kGrowThreshold * bdp_ || bandwidth < maxBandwidth_ ||
+      bdp_ >= maxBDP_) {
+    return folly::none;
+  }
+  bdp_ = static_cast<uint32_t>(
+      std::min<double>(kGrowFactor * sample_, static_cast<double>(maxBDP_)));
+  return bdp_;
+}
+
+ReceiveWindowBudget& ReceiveWindowBudget::get() {
+  static folly::Indestructible<ReceiveWindowBudget> budget;
+  return *budget;
+}
+
+uint64_t ReceiveWindowBudget::reserve(uint64_t bytes) {
+  auto reserved = reserved_.load(std::memory_order_relaxed);
+  uint64_t granted;
+  do {
+    auto limit = getLimit();
+    granted = reserved < limit ? std::min(bytes, limit - reserved) : 0;
+    if (granted == 0) {
+      return 0;
+    }
+  } while (!reserved_.compare_exchange_weak(
+      reserved, reserved + granted, std::memory_order_relaxed));
+  return granted;
+}
+
+void ReceiveWindowBudget::release(uint64_t bytes) {
+  auto previous = reserved_.fetch_sub(bytes, std::memory_order_relaxed);
+  DCHECK_GE(previous, bytes);
+}
+
+} // namespace proxygen
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <folly/Optional.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * Estimates the bandwidth-delay product of a connection from its ingress,
+ * to size the receive windows, the way gRPC does.  A PING is sent with the
+ * first body bytes received, and every byte received until it is acked is
+ * part of the sample.  On a saturated link the sample is up to 1.5 times
+ * the BDP, so when a sample reaches 2/3 of the current estimate at the
+ * highest bandwidth seen so far, the estimate grows to twice the sample.
+ */
+class BDPEstimator {
+ public:
+  BDPEstimator(uint32_t initialBDP, uint32_t maxBDP)
+      : bdp_(initialBDP), maxBDP_(maxBDP) {
+  }
+
+  /**
+   * Accounts for received body bytes.  Returns true when a BDP ping must be
+   * sent now, ie. none is outstanding.
+   */
+  bool onBytesReceived(uint64_t bytes, TimePoint now = getCurrentTime());
+
+  /**
+   * The BDP ping was acked.  Returns the new estimate if it grew, to size
+   * the receive windows with.
+   */
+  folly::Optional<uint32_t> onPingAck(TimePoint now = getCurrentTime());
+
+  bool isPingOutstanding() const {
+    return pingOutstanding_;
+  }
+
+  uint32_t getBDP() const {
+    return bdp_;
+  }
+
+  // Smoothed, zero until the first ack
+  std::chrono::microseconds getRTT() const {
+    return rtt_;
+  }
+
+ private:
+  uint32_t bdp_;
+  uint32_t maxBDP_;
+  bool pingOutstanding_{false};
+  TimePoint pingSent_;
+  uint64_t sample_{0};
+  uint32_t numSamples_{0};
+  std::chrono::microseconds rtt_{0};
+  // Highest bytes per us seen
+  double maxBandwidth_{0};
+};
+
+/**
+ * Bounds the memory that autotuned receive windows may take across the
+ * process: every session reserves the bytes it grows its window by, and
+ * releases them once destroyed.  Thread safe.
+ */
+class ReceiveWindowBudget {
+ public:
+  static constexpr uint64_t kDefaultLimit = uint64_t(1) << 30;
+
+  explicit ReceiveWindowBudget(uint64_t limit = kDefaultLimit)
+      : limit_(limit) {
+  }
+
+  // Shared by every session
+  static ReceiveWindowBudget& get();
+
+  void setLimit(uint64_t limit) {
+    limit_.store(limit, std::memory_order_relaxed);
+  }
+
+  uint64_t getLimit() const {
+    return limit_.load(std::memory_order_relaxed);
+  }
+
+  // Reserves up to bytes, returns how many were granted
+  uint64_t reserve(uint64_t bytes);
+
+  void release(uint64_t bytes);
+
+  uint64_t getReserved() const {
+    return reserved_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<uint64_t> limit_;
+  std::atomic<uint64_t> reserved_{0};
+};
+
+} // namespace proxygen
@@ -8,6 +8,7 @@
 
 #include <proxygen/lib/http/session/ByteEventTracker.h>
 
+#include <algorithm>
 #include <folly/io/async/DelayedDestruction.h>
 #include <string>
 
@@ -17,8 +18,55 @@ ByteEventTracker::~ByteEventTracker() {
   drainByteEvents();
 }
 
+void* ByteEventTracker::EventPool::allocate() {
+  if (free_.empty()) {
+    auto slots = std::min(std::max(capacity_, kMinSlabSlots), kMaxSlabSlots);
+    slabs_.emplace_back(new Slot[slots]);
+    capacity_ += slots;
+    auto slab = slabs_.back().get();
+    for (size_t i = slots; i > 0; i--) {
+      free_.push_back(&slab[i - 1]);
+    }
+  }
+  auto slot = free_.back();
+  free_.pop_back();
+  return slot;
+}
+
+void ByteEventTracker::EventPool::absorb(EventPool&& other) {
+  for (auto& slab : other.slabs_) {
+    slabs_.push_back(std::move(slab));
+  }
+  free_.insert(free_.end(), other.free_.begin(), other.free_.end());
+  capacity_ += other.capacity_;
+  other.slabs_.clear();
+  other.free_.clear();
+  other.capacity_ = 0;
+}
+
 void ByteEventTracker::absorb(ByteEventTracker&& other) {
   byteEvents_ = std::move(other.byteEvents_);
+  pool_.absorb(std::move(other.pool_));
+}
+
+TransactionByteEvent* ByteEventTracker::makeTransactionByteEvent(
+    uint64_t byteNo,
+    ByteEvent::EventType type,
+    HTTPTransaction* txn,
+    ByteEvent::Callback callback) {
+  auto event = new (pool_.allocate())
+      TransactionByteEvent(byteNo, type, txn, std::move(callback));
+  event->pooled_ = true;
+  return event;
+}
+
+void ByteEventTracker::disposeEvent(ByteEvent* event) {
+  if (event->pooled_) {
+    event->~ByteEvent();
+    pool_.release(event);
+  } else {
+    delete event;
+  }
 }
 
 // The purpose of self is to represent shared ownership during
@@ -74,7 +122,8 @@ bool ByteEventTracker::processByteEvents(std::shared_ptr<ByteEventTracker> self,
     VLOG(5) << " removing ByteEvent " << event;
     // explicitly remove from the list, in case delete event triggers a
     // callback that would absorb this ByteEventTracker.
-    byteEvents_.pop_front_and_dispose([](ByteEvent* event) { delete event; });
+    byteEvents_.pop_front_and_dispose(
+        [this](ByteEvent* event) { disposeEvent(event); });
   }
 
   return self.use_count() == 1;
@@ -84,7 +133,8 @@ size_t ByteEventTracker::drainByteEvents() {
   size_t numEvents = 0;
   // everything is dead from here on, let's just drop all extra refs to txns
   while (!byteEvents_.empty()) {
-    byteEvents_.pop_front_and_dispose([](ByteEvent* event) { delete event; });
+    byteEvents_.pop_front_and_dispose(
+        [this](ByteEvent* event) { disposeEvent(event); });
     ++numEvents;
   }
   return numEvents;
@@ -94,8 +144,8 @@ void ByteEventTracker::addLastByteEvent(HTTPTransaction* txn,
                                         uint64_t byteNo,
                                         ByteEvent::Callback callback) noexcept {
   VLOG(5) << " adding last byte event for " << byteNo;
-  TransactionByteEvent* event =
-      new TransactionByteEvent(byteNo, ByteEvent::LAST_BYTE, txn, callback);
+  auto event =
+      makeTransactionByteEvent(byteNo, ByteEvent::LAST_BYTE, txn, callback);
   byteEvents_.push_back(*event);
 }
 
@@ -104,8 +154,8 @@ void ByteEventTracker::addTrackedByteEvent(
     uint64_t byteNo,
     ByteEvent::Callback callback) noexcept {
   VLOG(5) << " adding tracked byte event for " << byteNo;
-  TransactionByteEvent* event =
-      new TransactionByteEvent(byteNo, ByteEvent::TRACKED_BYTE, txn, callback);
+  auto event =
+      makeTransactionByteEvent(byteNo, ByteEvent::TRACKED_BYTE, txn, callback);
   byteEvents_.push_back(*event);
 }
 
@@ -143,7 +193,7 @@ void ByteEventTracker::addFirstBodyByteEvent(uint64_t offset,
                                              HTTPTransaction* txn,
                                              ByteEvent::Callback callback) {
   byteEvents_.push_back(
-      *new TransactionByteEvent(offset, ByteEvent::FIRST_BYTE, txn, callback));
+      *makeTransactionByteEvent(offset, ByteEvent::FIRST_BYTE, txn, callback));
 }
 
 void ByteEventTracker::addFirstHeaderByteEvent(uint64_t offset,
@@ -151,7 +201,7 @@ void ByteEventTracker::addFirstHeaderByteEvent(uint64_t offset,
                                                ByteEvent::Callback callback) {
   // onWriteSuccess() is called after the entire header has been written.
   // It does not catch partial write case.
-  byteEvents_.push_back(*new TransactionByteEvent(
+  byteEvents_.push_back(*makeTransactionByteEvent(
       offset, ByteEvent::FIRST_HEADER_BYTE, txn, callback));
 }
 
@@ -141,7 +141,58 @@ class ByteEventTracker {
   virtual void setTTLBAStats(TTLBAStats* /* stats */) {
   }
 
+  // TransactionByteEvents allocated, and slots ready for reuse
+  size_t getPoolCapacity() const {
+    return pool_.capacity();
+  }
+  size_t getPoolAvailable() const {
+    return pool_.available();
+  }
+
  protected:
+  /**
+   * Recycles the storage of the TransactionByteEvents, several of which
+   * every transaction adds, in slabs that live as long as the tracker.  The
+   * slabs start small, for the trackers of a single HQ stream, and double.
+   */
+  class EventPool {
+   public:
+    void* allocate();
+
+    void release(void* slot) {
+      free_.push_back(slot);
+    }
+
+    // Takes the slabs of other, whose events this tracker now owns
+    void absorb(EventPool&& other);
+
+    size_t capacity() const {
+      return capacity_;
+    }
+    size_t available() const {
+      return free_.size();
+    }
+
+   private:
+    struct alignas(TransactionByteEvent) Slot {
+      unsigned char data[sizeof(TransactionByteEvent)];
+    };
+    static constexpr size_t kMinSlabSlots = 4;
+    static constexpr size_t kMaxSlabSlots = 256;
+
+    std::vector<std::unique_ptr<Slot[]>> slabs_;
+    std::vector<void*> free_;
+    size_t capacity_{0};
+  };
+
+  TransactionByteEvent* makeTransactionByteEvent(uint64_t byteNo,
+                                                 ByteEvent::EventType type,
+                                                 HTTPTransaction* txn,
+                                                 ByteEvent::Callback callback);
+
+  // Frees an event removed from byteEvents_, pooled or not
+  void disposeEvent(ByteEvent* event);
+
   // the last value of byteWritten passed to processByteEvents
   // should always increase
   uint64_t bytesWritten_ = 0;
@@ -150,6 +201,10 @@ class ByteEventTracker {
   folly::CountedIntrusiveList<ByteEvent, &ByteEvent::listHook> byteEvents_;
 
   Callback* callback_;
+
+ private:
+  // ~ByteEventTracker drains the events before the slabs go
+  EventPool pool_;
 };
 
 } // namespace proxygen
@@ -37,6 +37,7 @@ class ByteEvent {
       : eventType_(eventType),
         timestampTx_(false),
         timestampAck_(false),
+        pooled_(false),
         byteOffset_(byteOffset),
         callback_(callback) {
   }
@@ -71,7 +72,9 @@ class ByteEvent {
   // be delivered to the handler.
   bool timestampTx_ : 1;  // packed w/ byteOffset_
   bool timestampAck_ : 1; // packed w/ byteOffset_
-  uint64_t byteOffset_ : (8 * sizeof(uint64_t) - 5);
+  // Storage from a ByteEventTracker's pool rather than the heap
+  bool pooled_ : 1; // packed w/ byteOffset_
+  uint64_t byteOffset_ : (8 * sizeof(uint64_t) - 6);
   Callback callback_{nullptr};
 };
 
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/CannedResponse.h>
+
+#include <folly/Conv.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+
+namespace proxygen {
+
+CannedResponse::CannedResponse(uint16_t statusCode,
+                               const std::string& statusMessage,
+                               std::unique_ptr<folly::IOBuf> body,
+                               const HTTPHeaders& headers)
+    : body_(std::move(body)) {
+  msg_.setHTTPVersion(1, 1);
+  msg_.setStatusCode(statusCode);
+  msg_.setStatusMessage(statusMessage.empty()
+                            ? HTTPMessage::getDefaultReason(statusCode)
+                            : statusMessage);
+  msg_.getHeaders() = headers;
+  msg_.getHeaders().set(
+      HTTP_HEADER_CONTENT_LENGTH,
+      folly::to<std::string>(body_ ? body_->computeChainDataLength() : 0));
+  if (body_ && body_->empty()) {
+    body_.reset();
+  }
+}
+
+void CannedResponse::send(HTTPTransaction& txn, bool eom) const {
+  if (!body_) {
+    txn.sendHeadersWithOptionalEOM(msg_, eom);
+    return;
+  }
+  txn.sendHeaders(msg_);
+  txn.sendBody(body_->clone());
+  if (eom) {
+    txn.sendEOM();
+  }
+}
+
+} // namespace proxygen
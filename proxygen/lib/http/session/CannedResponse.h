@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/io/IOBuf.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+namespace proxygen {
+
+class HTTPTransaction;
+
+/**
+ * A response built once and sent as is to many requests, such as health
+ * checks, 404s and redirects. The HTTPMessage, with its Content-Length and
+ * default reason already set, is sent by reference rather than rebuilt for
+ * every request, and the body is shared rather than copied.
+ *
+ * It does not change once built, so it can be shared between threads.
+ */
+class CannedResponse {
+ public:
+  explicit CannedResponse(uint16_t statusCode,
+                          const std::string& statusMessage = empty_string,
+                          std::unique_ptr<folly::IOBuf> body = nullptr,
+                          const HTTPHeaders& headers = HTTPHeaders());
+
+  const HTTPMessage& getMessage() const {
+    return msg_;
+  }
+
+  // The body, sharing the buffer of the canned one; nullptr without one
+  std::unique_ptr<folly::IOBuf> cloneBody() const {
+    return body_ ? body_->clone() : nullptr;
+  }
+
+  /**
+   * Sends the headers and body, and the EOM if eom is true.
+   */
+  void send(HTTPTransaction& txn, bool eom = true) const;
+
+ private:
+  HTTPMessage msg_;
+  std::unique_ptr<folly::IOBuf> body_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/DSRObjectSender.h>
+
+#include <folly/Conv.h>
+
+namespace proxygen {
+
+bool DSRObjectSender::sendResponse(HTTPTransaction& txn,
+                                   HTTPMessage response,
+                                   DSRObject object,
+                                   std::unique_ptr<Backend> backend) {
+  response.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                            folly::to<std::string>(object.length));
+  return txn.sendHeadersWithDelegate(
+      response,
+      std::make_unique<DSRObjectSender>(
+          txn, std::move(object), std::move(backend)));
+}
+
+DSRObjectSender::DSRObjectSender(HTTPTransaction& txn,
+                                 DSRObject object,
+                                 std::unique_ptr<Backend> backend)
+    : txn_(&txn), object_(std::move(object)), backend_(std::move(backend)) {
+  CHECK(backend_);
+}
+
+uint64_t DSRObjectSender::toObjectOffset(uint64_t streamOffset) const {
+  CHECK(bodyStreamOffset_);
+  DCHECK_GE(streamOffset, *bodyStreamOffset_);
+  return object_.offset + (streamOffset - *bodyStreamOffset_);
+}
+
+void DSRObjectSender::onHeaderBytesGenerated(size_t dsrDataStartingOffset) {
+  bodyStreamOffset_ = dsrDataStartingOffset;
+  auto txn = txn_;
+  txn_ = nullptr;
+  if (!txn) {
+    return;
+  }
+  // The whole Content-Length at once: the session splits it as the stream
+  // and connection windows allow
+  if (txn->addBufferMeta()) {
+    txn->sendEOM();
+  }
+}
+
+bool DSRObjectSender::addSendInstruction(
+    const quic::SendInstruction& instruction) {
+  if (!bodyStreamOffset_ || instruction.streamOffset < *bodyStreamOffset_) {
+    LOG(ERROR) << "DSR instruction before the body, streamOffset="
+               << instruction.streamOffset;
+    return false;
+  }
+  auto objectOffset = toObjectOffset(instruction.streamOffset);
+  if (objectOffset + instruction.len > object_.offset + object_.length) {
+    LOG(ERROR) << "DSR instruction past the object, objectId="
+               << object_.objectId << " offset=" << objectOffset
+               << " len=" << instruction.len;
+    return false;
+  }
+  return backend_->addSendInstruction(instruction, object_, objectOffset);
+}
+
+bool DSRObjectSender::flush() {
+  return backend_->flush();
+}
+
+void DSRObjectSender::release() {
+  backend_->release();
+}
+
+} // namespace proxygen
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <quic/dsr/DSRPacketizationRequestSender.h>
+#include <quic/dsr/Types.h>
+
+namespace proxygen {
+
+/**
+ * Experimental
+ *
+ * The bytes of a response body that a backend holds: length bytes of the
+ * object objectId from offset.
+ */
+struct DSRObject {
+  std::string objectId;
+  uint64_t offset{0};
+  uint64_t length{0};
+};
+
+/**
+ * Experimental
+ *
+ * Delegates the body of an H3 or HQ response to a backend that holds it.  The
+ * session writes the headers and the DATA frame header, then only BufferMeta
+ * placeholders for the body, which account for it in the stream's flow
+ * control and byte events like real bytes.  mvfst turns them into send
+ * instructions, which this forwards to the backend along with the part of
+ * the object they cover; the backend packetizes and sends it.
+ *
+ *   DSRObjectSender::sendResponse(*txn, std::move(response), object,
+ *                                 std::move(backend));
+ *
+ * The handler must not send body or EOM afterwards.
+ */
+class DSRObjectSender
+    : public DSRRequestSender
+    , public quic::DSRPacketizationRequestSender {
+ public:
+  class Backend {
+   public:
+    virtual ~Backend() = default;
+
+    /**
+     * Queues the packetization of instruction, whose stream bytes are
+     * instruction.len bytes of object from objectOffset.  False fails the
+     * write on the stream.
+     */
+    virtual bool addSendInstruction(const quic::SendInstruction& instruction,
+                                    const DSRObject& object,
+                                    uint64_t objectOffset) = 0;
+
+    // Sends what was queued
+    virtual bool flush() = 0;
+
+    // When the stream is done with the backend
+    virtual void release() {
+    }
+  };
+
+  /**
+   * Sends response with a Content-Length of object.length, and the body
+   * from backend.  False when txn cannot be delegated, in which case the
+   * handler still owns the response.
+   */
+  static bool sendResponse(HTTPTransaction& txn,
+                           HTTPMessage response,
+                           DSRObject object,
+                           std::unique_ptr<Backend> backend);
+
+  DSRObjectSender(HTTPTransaction& txn,
+                  DSRObject object,
+                  std::unique_ptr<Backend> backend);
+
+  // The object offset of a stream offset in the body
+  uint64_t toObjectOffset(uint64_t streamOffset) const;
+
+  // Once the session wrote the headers, queues the body placeholders and EOM
+  void onHeaderBytesGenerated(size_t dsrDataStartingOffset) override;
+
+  bool addSendInstruction(const quic::SendInstruction& instruction) override;
+  bool flush() override;
+  void release() override;
+
+ private:
+  // Only until the headers are generated: the socket outlives it
+  HTTPTransaction* txn_;
+  const DSRObject object_;
+  std::unique_ptr<Backend> backend_;
+  folly::Optional<uint64_t> bodyStreamOffset_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/DrainScheduler.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+#include <proxygen/lib/http/session/HTTPSessionBase.h>
+#include <vector>
+
+namespace proxygen {
+
+constexpr uint32_t DrainScheduler::kMaxSteps;
+constexpr std::chrono::milliseconds DrainScheduler::kMinStep;
+
+DrainScheduler::DrainScheduler(folly::EventBase* evb,
+                               SessionSource& source,
+                               std::shared_ptr<Progress> progress)
+    : folly::AsyncTimeout(evb),
+      source_(source),
+      progress_(progress ? std::move(progress)
+                         : std::make_shared<Progress>()) {
+}
+
+uint64_t DrainScheduler::getWeight(const HTTPSessionBase& session) {
+  return 1 + session.getNumStreams();
+}
+
+void DrainScheduler::start(std::chrono::milliseconds window,
+                           folly::Function<void()> onDone) {
+  cancelTimeout();
+  if (onDone_ && onDone) {
+    // Both callers wait for the merged drain
+    onDone_ = [first = std::move(onDone_),
+               second = std::move(onDone)]() mutable {
+      first();
+      second();
+    };
+  } else if (onDone) {
+    onDone_ = std::move(onDone);
+  }
+
+  std::vector<std::pair<uint64_t, const HTTPSessionBase*>> sessions;
+  uint64_t totalWeight = 0;
+  size_t replanned = 0;
+  source_.visit([&](const HTTPSessionBase& session) {
+    auto weight = getWeight(session);
+    sessions.emplace_back(weight, &session);
+    totalWeight += weight;
+    replanned += due_.count(&session);
+    return false;
+  });
+  // The sessions still due in the previous plan that are gone closed
+  progress_->closed.fetch_add(due_.size() - replanned,
+                              std::memory_order_relaxed);
+  due_.clear();
+  std::stable_sort(
+      sessions.begin(), sessions.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+      });
+
+  // Each session drains at the start of its share of the window
+  uint64_t before = 0;
+  for (const auto& [weight, session] : sessions) {
+    due_.emplace(session,
+                 std::chrono::milliseconds(window.count() * before /
+                                           std::max<uint64_t>(totalWeight, 1)));
+    before += weight;
+  }
+  progress_->scheduled.fetch_add(sessions.size() - replanned,
+                                 std::memory_order_relaxed);
+  VLOG(3) << "Draining " << sessions.size() << " sessions over "
+          << window.count() << "ms";
+
+  start_ = getCurrentTime();
+  step_ = std::max(window / kMaxSteps, kMinStep);
+  step();
+}
+
+void DrainScheduler::timeoutExpired() noexcept {
+  step();
+}
+
+void DrainScheduler::step() {
+  auto elapsed = millisecondsSince(start_);
+  size_t drained = 0;
+  source_.visit([&](const HTTPSessionBase& session) {
+    auto it = due_.find(&session);
+    if (it == due_.end() || it->second > elapsed) {
+      return false;
+    }
+    due_.erase(it);
+    drained++;
+    return true;
+  });
+  progress_->drained.fetch_add(drained, std::memory_order_relaxed);
+
+  // The ones due the source no longer holds went away on their own
+  size_t closed = 0;
+  for (auto it = due_.begin(); it != due_.end();) {
+    if (it->second <= elapsed) {
+      it = due_.erase(it);
+      closed++;
+    } else {
+      ++it;
+    }
+  }
+  progress_->closed.fetch_add(closed, std::memory_order_relaxed);
+
+  if (!due_.empty()) {
+    scheduleTimeout(step_);
+    return;
+  }
+  VLOG(3) << "Drain scheduled";
+  if (auto onDone = std::move(onDone_)) {
+    onDone();
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <folly/Function.h>
+#include <folly/container/F14Map.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <memory>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+class HTTPSessionBase;
+
+/**
+ * Drains a group of sessions over a window instead of all at once, so that
+ * their clients don't reconnect, and handshake with the peers, together.
+ *
+ * Each session takes a share of the window proportional to its weight,
+ * 1 + its open streams, and the lightest drain first: idle sessions, whose
+ * clients may not even come back, go out in a burst at the start, the busy
+ * ones are spaced out at the end.  Those closing before their turn are
+ * counted as closed.  Sessions joining the group later are not planned,
+ * the source drains them as they arrive and counts them with
+ * addDrained().
+ *
+ * Single threaded, except for the Progress counters.
+ */
+class DrainScheduler : private folly::AsyncTimeout {
+ public:
+  /**
+   * Owns the sessions.  visit() calls shouldDrain with every session it
+   * holds that isn't draining yet, then drains those it returned true for.
+   */
+  class SessionSource {
+   public:
+    virtual ~SessionSource() = default;
+    virtual void visit(
+        folly::FunctionRef<bool(const HTTPSessionBase&)> shouldDrain) = 0;
+  };
+
+  // Can be read from any thread, and shared by several schedulers
+  struct Progress {
+    std::atomic<uint64_t> scheduled{0};
+    std::atomic<uint64_t> drained{0};
+    // Closed before their turn
+    std::atomic<uint64_t> closed{0};
+
+    uint64_t getPending() const {
+      auto done = drained.load(std::memory_order_relaxed) +
+                  closed.load(std::memory_order_relaxed);
+      auto total = scheduled.load(std::memory_order_relaxed);
+      return total > done ? total - done : 0;
+    }
+  };
+
+  // The window is split in at most kMaxSteps, of at least kMinStep
+  static constexpr uint32_t kMaxSteps = 100;
+  static constexpr std::chrono::milliseconds kMinStep{10};
+
+  DrainScheduler(folly::EventBase* evb,
+                 SessionSource& source,
+                 std::shared_ptr<Progress> progress = nullptr);
+
+  ~DrainScheduler() override = default;
+
+  static uint64_t getWeight(const HTTPSessionBase& session);
+
+  /**
+   * Plans the drain of the sessions of source over window, 0 for all of
+   * them now, and invokes onDone once they are all drained or closed.
+   * During a drain, the sessions not drained yet are planned again over
+   * the new window, and the onDone of both calls are invoked at its end.
+   */
+  void start(std::chrono::milliseconds window,
+             folly::Function<void()> onDone = nullptr);
+
+  // Counts sessions the source drained outside of the plan
+  void addDrained(uint64_t count = 1) {
+    progress_->scheduled.fetch_add(count, std::memory_order_relaxed);
+    progress_->drained.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  bool isRunning() const {
+    return !due_.empty();
+  }
+
+  const Progress& getProgress() const {
+    return *progress_;
+  }
+
+ private:
+  void timeoutExpired() noexcept override;
+
+  // Drains the sessions due by now, and schedules the next step or finishes
+  void step();
+
+  SessionSource& source_;
+  std::shared_ptr<Progress> progress_;
+  // Scheduled sessions not yet drained, to their offset in the window
+  folly::F14FastMap<const HTTPSessionBase*, std::chrono::milliseconds> due_;
+  TimePoint start_;
+  std::chrono::milliseconds step_{0};
+  folly::Function<void()> onDone_;
+};
+
+} // namespace proxygen
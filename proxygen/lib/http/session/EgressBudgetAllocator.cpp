@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/EgressBudgetAllocator.h>
+
+#include <algorithm>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+namespace {
+// Added to every drain rate so that new and momentarily idle streams still
+// get a share proportional to their weight
+constexpr double kRateFloor = 1.0;
+
+double score(uint32_t weight, double rate) {
+  return static_cast<double>(weight) * (rate + kRateFloor);
+}
+} // namespace
+
+uint64_t EgressBudgetAllocator::allocate(std::vector<Entry>& entries,
+                                         std::chrono::milliseconds elapsed) {
+  generation_++;
+  const double elapsedMs = std::max<int64_t>(elapsed.count(), 1);
+  double totalScore = 0;
+  for (auto& entry : entries) {
+    DCHECK_GT(entry.weight, 0);
+    auto& state = drainStates_[entry.id];
+    uint64_t delta = 0;
+    if (entry.bytesEgressed > state.lastBytesEgressed) {
+      delta = entry.bytesEgressed - state.lastBytesEgressed;
+    }
+    double sample = delta / elapsedMs;
+    state.rate = (state.generation == 0) ? sample : (state.rate + sample) / 2;
+    state.lastBytesEgressed = entry.bytesEgressed;
+    state.generation = generation_;
+    totalScore += score(entry.weight, state.rate);
+  }
+
+  uint64_t allocated = 0;
+  for (auto& entry : entries) {
+    const auto& state = drainStates_.find(entry.id)->second;
+    auto share = static_cast<uint64_t>(
+        budget_ * score(entry.weight, state.rate) / totalScore);
+    entry.limit = std::max(share, minTxnLimit_);
+    allocated += entry.limit;
+  }
+
+  for (auto it = drainStates_.begin(); it != drainStates_.end();) {
+    if (it->second.generation != generation_) {
+      it = drainStates_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return allocated;
+}
+
+double EgressBudgetAllocator::getDrainRate(HTTPCodec::StreamID id) const {
+  auto it = drainStates_.find(id);
+  return it == drainStates_.end() ? 0 : it->second.rate;
+}
+
+} // namespace proxygen
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <folly/container/F14Map.h>
+#include <proxygen/lib/http/codec/HTTPCodec.h>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Splits a session-wide egress buffer budget into per-transaction buffer
+ * limits.  Each transaction's share is proportional to its priority weight
+ * times its measured drain rate (smoothed bytes egressed per ms), so a
+ * stream whose client has stalled gives up buffer space to streams that are
+ * draining.  Every transaction is guaranteed at least the minimum limit.
+ */
+class EgressBudgetAllocator {
+ public:
+  static constexpr uint64_t kDefaultMinTxnLimit = 16 * 1024;
+
+  struct Entry {
+    Entry(HTTPCodec::StreamID inId, uint32_t inWeight, uint64_t inEgressed)
+        : id(inId), weight(inWeight), bytesEgressed(inEgressed) {
+    }
+
+    HTTPCodec::StreamID id;
+    // Relative priority, larger is more important.  Must be non-zero.
+    uint32_t weight;
+    // Cumulative body bytes written by the transaction
+    uint64_t bytesEgressed;
+    // Output of allocate()
+    uint64_t limit{0};
+  };
+
+  explicit EgressBudgetAllocator(uint64_t budget,
+                                 uint64_t minTxnLimit = kDefaultMinTxnLimit)
+      : budget_(budget), minTxnLimit_(minTxnLimit) {
+  }
+
+  void setBudget(uint64_t budget) {
+    budget_ = budget;
+  }
+
+  uint64_t getBudget() const {
+    return budget_;
+  }
+
+  /**
+   * Fill in the limit of every entry.  elapsed is the time since the previous
+   * call and is used to update drain rates.  Streams not present in entries
+   * are forgotten.  Returns the sum of the limits handed out.
+   */
+  uint64_t allocate(std::vector<Entry>& entries,
+                    std::chrono::milliseconds elapsed);
+
+  double getDrainRate(HTTPCodec::StreamID id) const;
+
+ private:
+  struct DrainState {
+    uint64_t lastBytesEgressed{0};
+    // EWMA of bytes egressed per millisecond
+    double rate{0};
+    uint64_t generation{0};
+  };
+
+  uint64_t budget_;
+  uint64_t minTxnLimit_;
+  uint64_t generation_{0};
+  folly::F14FastMap<HTTPCodec::StreamID, DrainState> drainStates_;
+};
+
+} // namespace proxygen
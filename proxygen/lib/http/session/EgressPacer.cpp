@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/EgressPacer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+EgressPacer::TokenBucket::TokenBucket(uint64_t bitsPerSecond,
+                                      uint64_t burstBytes)
+    : bytesPerSecond_(bitsPerSecond / 8),
+      burst_(std::max(burstBytes ? burstBytes : bytesPerSecond_ / 10,
+                      kMinGrant)),
+      tokens_(burst_),
+      lastRefill_(getCurrentTime()) {
+  DCHECK_GT(bytesPerSecond_, 0);
+}
+
+uint64_t EgressPacer::TokenBucket::available(TimePoint now) {
+  if (now > lastRefill_) {
+    auto elapsedUs = microsecondsBetween(now, lastRefill_).count();
+    tokens_ = std::min<double>(
+        burst_, tokens_ + elapsedUs * (bytesPerSecond_ / 1000000.0));
+    lastRefill_ = now;
+  }
+  return tokens_ > 0 ? static_cast<uint64_t>(tokens_) : 0;
+}
+
+void EgressPacer::TokenBucket::consume(uint64_t bytes) {
+  // May go negative when other sessions share the bucket
+  tokens_ -= bytes;
+}
+
+std::chrono::milliseconds EgressPacer::TokenBucket::timeUntil(
+    uint64_t bytes, TimePoint now) {
+  auto missing = static_cast<double>(bytes) - available(now);
+  if (missing <= 0) {
+    return std::chrono::milliseconds(0);
+  }
+  return std::chrono::milliseconds(
+      static_cast<int64_t>(std::ceil(missing * 1000 / bytesPerSecond_)));
+}
+
+EgressPacer::EgressPacer(folly::HHWheelTimer* timer,
+                         uint64_t bitsPerSecond,
+                         std::shared_ptr<TokenBucket> tenant)
+    : timer_(timer), session_(bitsPerSecond), tenant_(std::move(tenant)) {
+  CHECK(timer_);
+}
+
+EgressPacer::~EgressPacer() {
+  cancelTimeout();
+}
+
+uint64_t EgressPacer::acquire(Callback* cb, uint32_t weight, uint64_t want) {
+  DCHECK_GT(weight, 0);
+  DCHECK_GT(want, 0);
+  auto now = getCurrentTime();
+  uint64_t avail = session_.available(now);
+  if (tenant_) {
+    avail = std::min(avail, tenant_->available(now));
+  }
+  auto it = findWaiter(cb);
+  uint64_t othersWeight = waitingWeight_;
+  if (it != waiters_.end()) {
+    othersWeight -= it->weight;
+  }
+  uint64_t grant = std::min(want, avail);
+  if (othersWeight > 0) {
+    grant = std::min(
+        grant, std::max(kMinGrant, avail * weight / (weight + othersWeight)));
+  }
+  if (grant < std::min(want, kMinGrant)) {
+    if (it == waiters_.end()) {
+      waiters_.push_back(Waiter{cb, weight});
+      waitingWeight_ += weight;
+    } else {
+      it->woken = false;
+    }
+    scheduleWakeup(now);
+    return 0;
+  }
+  if (it != waiters_.end()) {
+    eraseWaiter(it);
+  }
+  session_.consume(grant);
+  if (tenant_) {
+    tenant_->consume(grant);
+  }
+  return grant;
+}
+
+void EgressPacer::remove(Callback* cb) {
+  auto it = findWaiter(cb);
+  if (it != waiters_.end()) {
+    eraseWaiter(it);
+  }
+  if (waiters_.empty()) {
+    cancelTimeout();
+  }
+}
+
+void EgressPacer::releaseAll() {
+  cancelTimeout();
+  auto waiters = std::move(waiters_);
+  waiters_.clear();
+  waitingWeight_ = 0;
+  for (auto& waiter : waiters) {
+    waiter.cb->onEgressPacerReady();
+  }
+}
+
+void EgressPacer::timeoutExpired() noexcept {
+  // Those woken last time without coming back no longer wait
+  for (auto it = waiters_.begin(); it != waiters_.end();) {
+    if (it->woken) {
+      waitingWeight_ -= it->weight;
+      it = waiters_.erase(it);
+    } else {
+      it->woken = true;
+      ++it;
+    }
+  }
+  std::vector<Callback*> callbacks;
+  callbacks.reserve(waiters_.size());
+  for (const auto& waiter : waiters_) {
+    callbacks.push_back(waiter.cb);
+  }
+  for (auto cb : callbacks) {
+    if (findWaiter(cb) != waiters_.end()) {
+      cb->onEgressPacerReady();
+    }
+  }
+}
+
+void EgressPacer::scheduleWakeup(TimePoint now) {
+  if (isScheduled()) {
+    return;
+  }
+  auto delay = session_.timeUntil(kMinGrant, now);
+  if (tenant_) {
+    delay = std::max(delay, tenant_->timeUntil(kMinGrant, now));
+  }
+  timer_->scheduleTimeout(this,
+                          std::max(delay, std::chrono::milliseconds(1)));
+}
+
+std::vector<EgressPacer::Waiter>::iterator EgressPacer::findWaiter(
+    Callback* cb) {
+  return std::find_if(waiters_.begin(),
+                      waiters_.end(),
+                      [cb](const Waiter& waiter) { return waiter.cb == cb; });
+}
+
+void EgressPacer::eraseWaiter(std::vector<Waiter>::iterator it) {
+  waitingWeight_ -= it->weight;
+  waiters_.erase(it);
+}
+
+} // namespace proxygen
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/io/async/HHWheelTimer.h>
+#include <memory>
+#include <proxygen/lib/utils/Time.h>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Paces the body egress of the transactions of a session with token
+ * buckets: one of the session and optionally one of a tenant, shared with
+ * other sessions of the same thread.  Transactions waiting for tokens at
+ * the same time share them by weight.  A single timer per session wakes
+ * the waiting transactions once a packet's worth of tokens is available.
+ */
+class EgressPacer : private folly::HHWheelTimer::Callback {
+ public:
+  // The smallest grant, about a packet
+  static constexpr uint64_t kMinGrant = 1400;
+
+  class TokenBucket {
+   public:
+    // burstBytes defaults to 100ms at the rate, and at least kMinGrant
+    explicit TokenBucket(uint64_t bitsPerSecond, uint64_t burstBytes = 0);
+
+    uint64_t getBytesPerSecond() const {
+      return bytesPerSecond_;
+    }
+
+    // The tokens available at now, refilled since the previous call
+    uint64_t available(TimePoint now);
+    void consume(uint64_t bytes);
+    // Until bytes are available, zero if they are
+    std::chrono::milliseconds timeUntil(uint64_t bytes, TimePoint now);
+
+   private:
+    uint64_t bytesPerSecond_;
+    uint64_t burst_;
+    double tokens_;
+    TimePoint lastRefill_;
+  };
+
+  class Callback {
+   public:
+    virtual ~Callback() = default;
+    virtual void onEgressPacerReady() noexcept = 0;
+  };
+
+  EgressPacer(folly::HHWheelTimer* timer,
+              uint64_t bitsPerSecond,
+              std::shared_ptr<TokenBucket> tenant = nullptr);
+  ~EgressPacer() override;
+
+  /**
+   * The bytes of the want (> 0) bytes cb may send now, weighted against
+   * the other waiters.  Returns 0 when under a packet is available; cb then
+   * gets onEgressPacerReady() once there may be enough.
+   */
+  uint64_t acquire(Callback* cb, uint32_t weight, uint64_t want);
+
+  // cb won't be called anymore
+  void remove(Callback* cb);
+
+  // Wakes all the waiters, e.g. before the pacer goes away
+  void releaseAll();
+
+  TokenBucket& getSessionBucket() {
+    return session_;
+  }
+
+  const std::shared_ptr<TokenBucket>& getTenantBucket() const {
+    return tenant_;
+  }
+
+  size_t getNumWaiters() const {
+    return waiters_.size();
+  }
+
+ private:
+  struct Waiter {
+    Callback* cb;
+    uint32_t weight;
+    // Called back, and not waiting again yet
+    bool woken{false};
+  };
+
+  void timeoutExpired() noexcept override;
+  void callbackCanceled() noexcept override {
+  }
+  void scheduleWakeup(TimePoint now);
+  std::vector<Waiter>::iterator findWaiter(Callback* cb);
+  void eraseWaiter(std::vector<Waiter>::iterator it);
+
+  folly::HHWheelTimer* timer_;
+  TokenBucket session_;
+  std::shared_ptr<TokenBucket> tenant_;
+  // Few at a time
+  std::vector<Waiter> waiters_;
+  uint64_t waitingWeight_{0};
+};
+
+} // namespace proxygen
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/ExtensiblePriorityQueue.h>
+
+#include <folly/lang/Bits.h>
+
+namespace proxygen {
+
+HTTP2PriorityQueueBase::Handle ExtensiblePriorityQueue::addTransaction(
+    HTTPCodec::StreamID id,
+    http2::PriorityUpdate /*pri*/,
+    HTTPTransaction* txn,
+    bool /*permanent*/,
+    uint64_t* depth) {
+  CHECK_NE(id, rootNodeId_);
+  auto res = nodes_.emplace(id, std::make_unique<Node>(id, txn));
+  CHECK(res.second) << "Duplicate stream id=" << id;
+  if (depth) {
+    *depth = 1;
+  }
+  return res.first->second.get();
+}
+
+HTTP2PriorityQueueBase::Handle ExtensiblePriorityQueue::updatePriority(
+    Handle handle, http2::PriorityUpdate /*pri*/, uint64_t* depth) {
+  if (depth) {
+    *depth = 1;
+  }
+  return handle;
+}
+
+bool ExtensiblePriorityQueue::updatePriority(HTTPCodec::StreamID id,
+                                             const HTTPPriority& pri) {
+  auto it = nodes_.find(id);
+  if (it == nodes_.end()) {
+    return false;
+  }
+  auto& node = *it->second;
+  if (node.urgency_ == pri.urgency && node.incremental_ == pri.incremental) {
+    return true;
+  }
+  bool enqueued = node.enqueued_;
+  if (enqueued) {
+    dequeue(node);
+  }
+  node.urgency_ = pri.urgency;
+  node.incremental_ = pri.incremental;
+  if (enqueued) {
+    enqueue(node);
+  }
+  return true;
+}
+
+void ExtensiblePriorityQueue::removeTransaction(Handle handle) {
+  auto node = static_cast<Node*>(handle);
+  if (node->enqueued_) {
+    dequeue(*node);
+  }
+  nodes_.erase(node->id_);
+}
+
+void ExtensiblePriorityQueue::signalPendingEgress(Handle h) {
+  auto node = static_cast<Node*>(h);
+  if (!node->enqueued_) {
+    enqueue(*node);
+  }
+}
+
+void ExtensiblePriorityQueue::clearPendingEgress(Handle h) {
+  auto node = static_cast<Node*>(h);
+  CHECK(node->enqueued_);
+  dequeue(*node);
+}
+
+void ExtensiblePriorityQueue::nextEgress(NextEgressResult& result,
+                                         bool /*spdyMode*/) {
+  if (activeMask_ == 0) {
+    return;
+  }
+  auto& bucket = buckets_[folly::findFirstSet(activeMask_) - 1];
+  if (!bucket.sequential.empty()) {
+    result.emplace_back(bucket.sequential.front().txn_, 1.0);
+    return;
+  }
+  auto& node = bucket.incremental.front();
+  result.emplace_back(node.txn_, 1.0);
+  if (&bucket.incremental.back() != &node) {
+    bucket.incremental.pop_front();
+    bucket.incremental.push_back(node);
+  }
+}
+
+folly::Optional<HTTPPriority> ExtensiblePriorityQueue::getPriority(
+    HTTPCodec::StreamID id) const {
+  auto it = nodes_.find(id);
+  if (it == nodes_.end()) {
+    return folly::none;
+  }
+  return HTTPPriority(it->second->urgency_, it->second->incremental_);
+}
+
+void ExtensiblePriorityQueue::enqueue(Node& node) {
+  DCHECK(!node.enqueued_);
+  DCHECK_LT(node.urgency_, kNumUrgencyLevels);
+  auto& bucket = buckets_[node.urgency_];
+  if (node.incremental_) {
+    bucket.incremental.push_back(node);
+  } else {
+    bucket.sequential.push_back(node);
+  }
+  activeMask_ |= (1 << node.urgency_);
+  node.enqueued_ = true;
+  activeCount_++;
+}
+
+void ExtensiblePriorityQueue::dequeue(Node& node) {
+  DCHECK(node.enqueued_);
+  node.hook_.unlink();
+  if (buckets_[node.urgency_].empty()) {
+    activeMask_ &= ~(1 << node.urgency_);
+  }
+  node.enqueued_ = false;
+  activeCount_--;
+}
+
+} // namespace proxygen
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/IntrusiveList.h>
+#include <folly/container/F14Map.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
+
+#include <array>
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * Egress scheduler for RFC 9218 extensible priorities.  Transactions are kept
+ * in one of eight urgency buckets, and only transactions with pending egress
+ * are linked into a bucket.  Within a bucket, non-incremental transactions are
+ * served one at a time in the order they became ready, and incremental
+ * transactions share the remaining bandwidth round-robin.  nextEgress() is
+ * O(1): it picks the first non-empty bucket from a bitmask and returns exactly
+ * one transaction.
+ *
+ * HTTP/2 dependency tree information passed through the HTTP2PriorityQueueBase
+ * interface is ignored, there are no virtual nodes.
+ */
+class ExtensiblePriorityQueue : public HTTP2PriorityQueueBase {
+ public:
+  using NextEgressResult = HTTP2PriorityQueue::NextEgressResult;
+
+  static constexpr size_t kNumUrgencyLevels = 8;
+
+  explicit ExtensiblePriorityQueue(HTTPCodec::StreamID rootNodeId = 0)
+      : HTTP2PriorityQueueBase(rootNodeId) {
+  }
+
+  ExtensiblePriorityQueue(const ExtensiblePriorityQueue&) = delete;
+  ExtensiblePriorityQueue& operator=(const ExtensiblePriorityQueue&) = delete;
+
+  Handle addTransaction(HTTPCodec::StreamID id,
+                        http2::PriorityUpdate pri,
+                        HTTPTransaction* txn,
+                        bool permanent = false,
+                        uint64_t* depth = nullptr) override;
+
+  // HTTP/2 priority updates don't carry urgency, the handle is unchanged
+  Handle updatePriority(Handle handle,
+                        http2::PriorityUpdate pri,
+                        uint64_t* depth = nullptr) override;
+
+  void removeTransaction(Handle handle) override;
+
+  void signalPendingEgress(Handle h) override;
+
+  void clearPendingEgress(Handle h) override;
+
+  // There is no dependency tree to build
+  void addPriorityNode(HTTPCodec::StreamID /*id*/,
+                       HTTPCodec::StreamID /*parent*/) override {
+  }
+
+  // Set the urgency and incremental flag of an existing stream.  Returns false
+  // if the stream is not in the queue.
+  bool updatePriority(HTTPCodec::StreamID id, const HTTPPriority& pri);
+
+  // Returns true if there are no transaction with pending egress
+  bool empty() const {
+    return activeCount_ == 0;
+  }
+
+  // The number with pending egress
+  uint64_t numPendingEgress() const {
+    return activeCount_;
+  }
+
+  // Appends the single transaction that should egress next, with ratio 1.0.
+  // Incremental transactions rotate to the back of their bucket.
+  void nextEgress(NextEgressResult& result, bool spdyMode = false);
+
+  folly::Optional<HTTPPriority> getPriority(HTTPCodec::StreamID id) const;
+
+ private:
+  class Node : public BaseNode {
+   public:
+    Node(HTTPCodec::StreamID id, HTTPTransaction* txn)
+        : id_(id), txn_(txn) {
+    }
+
+    bool isEnqueued() const override {
+      return enqueued_;
+    }
+
+    uint64_t calculateDepth(bool /*includeVirtual*/ = true) const override {
+      return 1;
+    }
+
+    HTTPCodec::StreamID id_;
+    HTTPTransaction* txn_;
+    uint8_t urgency_{kDefaultHttpPriorityUrgency};
+    bool incremental_{kDefaultHttpPriorityIncremental};
+    bool enqueued_{false};
+    folly::IntrusiveListHook hook_;
+  };
+
+  using NodeList = folly::IntrusiveList<Node, &Node::hook_>;
+
+  struct Bucket {
+    NodeList sequential;
+    NodeList incremental;
+
+    bool empty() const {
+      return sequential.empty() && incremental.empty();
+    }
+  };
+
+  void enqueue(Node& node);
+  void dequeue(Node& node);
+
+  folly::F14FastMap<HTTPCodec::StreamID, std::unique_ptr<Node>> nodes_;
+  std::array<Bucket, kNumUrgencyLevels> buckets_;
+  // bit N is set when buckets_[N] is non-empty
+  uint8_t activeMask_{0};
+  uint64_t activeCount_{0};
+};
+
+} // namespace proxygen
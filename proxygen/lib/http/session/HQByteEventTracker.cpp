@@ -8,6 +8,8 @@
 
 #include <proxygen/lib/http/session/HQByteEventTracker.h>
 
+#include <algorithm>
+
 namespace {
 class HQTransportByteEvent
     : public proxygen::TransactionByteEvent
@@ -46,6 +48,27 @@ HQByteEventTracker::HQByteEventTracker(Callback* callback,
 }
 
 void HQByteEventTracker::onByteEventWrittenToSocket(const ByteEvent& event) {
+  if (batched_) {
+    switch (event.eventType_) {
+      case ByteEvent::FIRST_BYTE:
+        if (!fullTracking_) {
+          break;
+        }
+        addBatchedEvent(event, quic::QuicSocket::ByteEvent::Type::TX);
+        addBatchedEvent(event, quic::QuicSocket::ByteEvent::Type::ACK);
+        break;
+      case ByteEvent::LAST_BYTE:
+        if (fullTracking_) {
+          addBatchedEvent(event, quic::QuicSocket::ByteEvent::Type::TX);
+        }
+        addBatchedEvent(event, quic::QuicSocket::ByteEvent::Type::ACK);
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+
   // create a ByteEvent
   const auto& txn = event.getTransaction();
   const auto& streamOffset = event.getByteOffset();
@@ -81,4 +104,85 @@ void HQByteEventTracker::onByteEventWrittenToSocket(const ByteEvent& event) {
   }
 }
 
+void HQByteEventTracker::addBatchedEvent(
+    const ByteEvent& event, quic::QuicSocket::ByteEvent::Type quicType) {
+  const auto offset = event.getByteOffset();
+  auto registered = std::any_of(
+      pendingEvents_.begin(),
+      pendingEvents_.end(),
+      [offset, quicType](const PendingEvent& pending) {
+        return pending.offset == offset && pending.quicType == quicType;
+      });
+  if (!registered) {
+    auto ret = quicType == quic::QuicSocket::ByteEvent::Type::TX
+                   ? socket_->registerTxCallback(streamId_, offset, this)
+                   : socket_->registerDeliveryCallback(streamId_, offset, this);
+    if (ret.hasError()) {
+      return;
+    }
+  }
+  auto txn = event.getTransaction();
+  txn->incrementPendingByteEvents();
+  pendingEvents_.push_back({offset, event.eventType_, quicType, txn});
+  if (stats_) {
+    if (quicType == quic::QuicSocket::ByteEvent::Type::TX) {
+      stats_->recordTTBTXTracked();
+    } else if (event.eventType_ == ByteEvent::LAST_BYTE) {
+      stats_->recordTTLBATracked();
+    }
+  }
+}
+
+folly::small_vector<HQByteEventTracker::PendingEvent, 2>
+HQByteEventTracker::takePendingEvents(
+    const quic::QuicSocket::ByteEvent& byteEvent) {
+  folly::small_vector<PendingEvent, 2> events;
+  auto it = std::stable_partition(
+      pendingEvents_.begin(),
+      pendingEvents_.end(),
+      [&byteEvent](const PendingEvent& pending) {
+        return pending.offset != byteEvent.offset ||
+               pending.quicType != byteEvent.type;
+      });
+  events.assign(it, pendingEvents_.end());
+  pendingEvents_.erase(it, pendingEvents_.end());
+  return events;
+}
+
+void HQByteEventTracker::onByteEvent(quic::QuicSocket::ByteEvent byteEvent) {
+  auto events = takePendingEvents(byteEvent);
+  if (stats_) {
+    for (const auto& pending : events) {
+      if (byteEvent.type == quic::QuicSocket::ByteEvent::Type::TX) {
+        stats_->recordTTBTXReceived();
+      } else if (pending.eventType == ByteEvent::LAST_BYTE) {
+        stats_->recordTTLBAReceived();
+      }
+    }
+  }
+  // Releasing the last pending byte event may detach the transaction and
+  // destroy this tracker, only locals are used from here on
+  for (const auto& pending : events) {
+    proxygen::TransactionByteEvent event(
+        pending.offset, pending.eventType, pending.txn);
+    pending.txn->decrementPendingByteEvents();
+    switch (byteEvent.type) {
+      case quic::QuicSocket::ByteEvent::Type::TX:
+        pending.txn->onEgressTrackedByteEventTX(event);
+        break;
+      case quic::QuicSocket::ByteEvent::Type::ACK:
+        pending.txn->onEgressTrackedByteEventAck(event);
+        break;
+    }
+  }
+}
+
+void HQByteEventTracker::onByteEventCanceled(
+    quic::QuicSocket::ByteEventCancellation cancellation) {
+  auto events = takePendingEvents(cancellation);
+  for (const auto& pending : events) {
+    pending.txn->decrementPendingByteEvents();
+  }
+}
+
 } // namespace proxygen
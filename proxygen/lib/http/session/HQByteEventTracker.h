@@ -8,7 +8,9 @@
 
 #pragma once
 
+#include <folly/small_vector.h>
 #include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/TTLBAStats.h>
 #include <quic/api/QuicSocket.h>
 
 namespace proxygen {
@@ -16,7 +18,9 @@ namespace proxygen {
 /**
  * ByteEventTracker specialized for HQSession.
  */
-class HQByteEventTracker : public ByteEventTracker {
+class HQByteEventTracker
+    : public ByteEventTracker
+    , private quic::QuicSocket::ByteEventCallback {
  public:
   HQByteEventTracker(Callback* callback,
                      quic::QuicSocket* socket,
@@ -32,9 +36,58 @@ class HQByteEventTracker : public ByteEventTracker {
    */
   void onByteEventWrittenToSocket(const ByteEvent& event) override;
 
+  /**
+   * Switches to batched tracking.  Instead of allocating a callback object
+   * per TX and ACK event, the tracker registers itself with the QuicSocket
+   * once per offset and event type, and delivers every byte event pending at
+   * that offset when it fires.
+   *
+   * When fullTracking is false only the ACK of the last byte is tracked,
+   * which is all TTLBA needs; the caller decides (e.g. by sampling) which
+   * transactions also get first byte and TX events.
+   */
+  void enableBatchedEvents(bool fullTracking) {
+    batched_ = true;
+    fullTracking_ = fullTracking;
+  }
+
+  void setTTLBAStats(TTLBAStats* stats) override {
+    stats_ = stats;
+  }
+
+  size_t getNumPendingBatchedEvents() const {
+    return pendingEvents_.size();
+  }
+
  private:
+  struct PendingEvent {
+    uint64_t offset;
+    ByteEvent::EventType eventType;
+    quic::QuicSocket::ByteEvent::Type quicType;
+    // Holds a pending byte event on the transaction until delivered
+    HTTPTransaction* txn;
+  };
+
+  void addBatchedEvent(const ByteEvent& event,
+                       quic::QuicSocket::ByteEvent::Type quicType);
+
+  // quic::QuicSocket::ByteEventCallback, batched mode only
+  void onByteEvent(quic::QuicSocket::ByteEvent byteEvent) override;
+  void onByteEventCanceled(
+      quic::QuicSocket::ByteEventCancellation cancellation) override;
+
+  // Removes and returns the events registered for the given QUIC event
+  folly::small_vector<PendingEvent, 2> takePendingEvents(
+      const quic::QuicSocket::ByteEvent& byteEvent);
+
   quic::QuicSocket* const socket_;
   const quic::StreamId streamId_;
+  TTLBAStats* stats_{nullptr};
+  bool batched_{false};
+  bool fullTracking_{true};
+  // Every entry pins its transaction, so the stream (and this tracker) stays
+  // alive until the socket has delivered or canceled all the registrations
+  folly::small_vector<PendingEvent, 4> pendingEvents_;
 };
 
 } // namespace proxygen
@@ -15,6 +15,7 @@ void HQDownstreamSession::onTransportReady() noexcept {
   if (!onTransportReadyCommon()) {
     return;
   }
+  maybeStartIngressCapture();
   if (infoCallback_) {
     infoCallback_->onTransportReady(*this);
   }
@@ -23,6 +24,7 @@ void HQDownstreamSession::onTransportReady() noexcept {
 
 void HQDownstreamSession::onFullHandshakeDone() noexcept {
   HQDownstreamSession::DestructorGuard dg(this);
+  fullHandshakeDone_ = true;
   if (infoCallback_) {
     infoCallback_->onFullHandshakeCompletion(*this);
   }
@@ -17,10 +17,14 @@
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
 #include <proxygen/lib/http/codec/QPACKDecoderCodec.h>
 #include <proxygen/lib/http/codec/QPACKEncoderCodec.h>
+#include <proxygen/lib/http/session/HQWebTransportSession.h>
 #include <proxygen/lib/http/session/HTTPSession.h>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <proxygen/lib/http/session/IngressCapture.h>
+#include <proxygen/lib/http/session/LoopBudget.h>
+#include <proxygen/lib/utils/AllocationPhase.h>
 
 #include <folly/CppAttributes.h>
 #include <folly/Format.h>
@@ -31,6 +35,7 @@
 #include <folly/io/async/DelayedDestructionBase.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/HHWheelTimer.h>
+#include <folly/tracing/StaticTracepoint.h>
 #include <quic/QuicConstants.h>
 #include <quic/codec/QuicInteger.h>
 #include <quic/common/BufUtil.h>
@@ -82,8 +87,10 @@ quic::QuicErrorCode quicControlStreamError(quic::QuicErrorCode error) {
   folly::assume_unreachable();
 }
 
-quic::Priority toQuicPriority(const proxygen::HTTPPriority& pri) {
-  return quic::Priority(pri.urgency, pri.incremental, pri.orderId);
+quic::Priority toQuicPriority(const proxygen::HTTPPriority& pri,
+                              bool sendWhole = false) {
+  return quic::Priority(
+      pri.urgency, pri.incremental && !sendWhole, pri.orderId);
 }
 } // namespace
 
@@ -104,6 +111,12 @@ const http2::PriorityUpdate hqDefaultPriority{kSessionStreamId, false, 15};
 
 HQSession::~HQSession() {
   VLOG(3) << *this << " closing";
+  const auto& encodedSize = qpackCodec_.getTotalEncodedSize();
+  if (sessionStats_ && encodedSize.uncompressed > 0) {
+    sessionStats_->recordQPACKEncodeRatio(
+        qpackCodec_.getWarmTableInserts() > 0,
+        uint64_t(encodedSize.compressed) * 100 / encodedSize.uncompressed);
+  }
   runDestroyCallbacks();
 }
 
@@ -116,15 +129,32 @@ void HQSession::setSessionStats(HTTPSessionStats* stats) {
 
 void HQSession::onNewBidirectionalStream(quic::StreamId id) noexcept {
   VLOG(4) << __func__ << " sess=" << *this << ": new streamID=" << id;
+  FOLLY_SDT(proxygen, hq_new_stream, this, id, true);
   // The transport should never call onNewBidirectionalStream before
   // onTransportReady
   if (!checkNewStream(id)) {
     return;
   }
+  if (webTransportEgressEnabled()) {
+    // Wait for the preface to tell a WebTransport stream from a request
+    bidirectionalReadDispatcher_.takeTemporaryOwnership(id);
+    sock_->setPeekCallback(id, &bidirectionalReadDispatcher_);
+  } else {
+    setupIngressRequestStream(id);
+  }
+
+  // checkNewStream will reject kMaxClientBidiStreamId, so id + 4 will not wrap
+  if (!sock_->isServerStream(id)) {
+    minUnseenIncomingStreamId_ = std::max(minUnseenIncomingStreamId_, id + 4);
+  }
+}
+
+HQSession::HQStreamTransport* HQSession::setupIngressRequestStream(
+    quic::StreamId id) {
   auto hqStream = findNonDetachedStream(id);
   DCHECK(!hqStream);
-  hqStream = createStreamTransport(id);
-  DCHECK(hqStream);
+  auto requestStream = createStreamTransport(id);
+  DCHECK(requestStream);
   sock_->setReadCallback(id, this);
   if (ingressLimitExceeded()) {
     sock_->pauseRead(id);
@@ -132,15 +162,14 @@ void HQSession::onNewBidirectionalStream(quic::StreamId id) noexcept {
 
   if (minUnseenIncomingStreamId_ == 0 && version_ == HQVersion::HQ) {
     // generate grease frame
-    auto writeGreaseFrameResult = hq::writeGreaseFrame(hqStream->writeBuf_);
+    auto writeGreaseFrameResult =
+        hq::writeGreaseFrame(requestStream->writeBuf_);
     if (writeGreaseFrameResult.hasError()) {
       VLOG(2) << __func__ << " failed to create grease frame: " << *this
               << ". Error = " << writeGreaseFrameResult.error();
     }
   }
-
-  // checkNewStream will reject kMaxClientBidiStreamId, so id + 4 will not wrap
-  minUnseenIncomingStreamId_ = std::max(minUnseenIncomingStreamId_, id + 4);
+  return requestStream;
 }
 
 void HQSession::onBidirectionalStreamsAvailable(
@@ -159,6 +188,7 @@ void HQSession::onNewUnidirectionalStream(quic::StreamId id) noexcept {
   // Try to check whether this is a push
   // if yes, register this as a push
   VLOG(4) << __func__ << " sess=" << *this << ": new streamID=" << id;
+  FOLLY_SDT(proxygen, hq_new_stream, this, id, false);
   // The transport should never call onNewUnidirectionalStream
   // before onTransportReady
   if (!checkNewStream(id)) {
@@ -183,6 +213,13 @@ void HQSession::onStopSending(quic::StreamId id,
   auto stream = findStream(id);
   if (stream) {
     handleWriteError(stream, error);
+    return;
+  }
+  for (auto& it : webTransportSessions_) {
+    if (it.second->findStream(id)) {
+      it.second->onStopSending(id, error);
+      break;
+    }
   }
 }
 
@@ -197,9 +234,12 @@ void HQSession::onKnob(uint64_t knobSpace,
 }
 
 bool HQSession::checkNewStream(quic::StreamId id) {
-  // Reject all bidirectional, server-initiated streams
+  // Reject all bidirectional, server-initiated streams, but WebTransport ones
+  // which the dispatcher tells apart
   if (id == kMaxClientBidiStreamId ||
-      (sock_->isBidirectionalStream(id) && sock_->isServerStream(id))) {
+      (sock_->isBidirectionalStream(id) && sock_->isServerStream(id) &&
+       (direction_ == TransportDirection::DOWNSTREAM ||
+        !webTransportEgressEnabled()))) {
     abortStream(HTTPException::Direction::INGRESS_AND_EGRESS,
                 id,
                 HTTP3::ErrorCode::HTTP_STREAM_CREATION_ERROR);
@@ -969,6 +1009,7 @@ void HQSession::runLoopCallback() noexcept {
 
   inLoopCallback_ = true;
   HQSession::DestructorGuard dg(this);
+  PROXYGEN_ALLOCATION_PHASE(WRITE);
   auto scopeg = folly::makeGuard([this] {
     // This ScopeGuard needs to be under the above DestructorGuard
     updatePendingWrites();
@@ -994,8 +1035,15 @@ void HQSession::runLoopCallback() noexcept {
   maxToSend_ -= writeControlStreams(maxToSend_);
   // Then write the request streams
   if (!txnEgressQueue_.empty() && maxToSend_ > 0) {
+    auto writeSlice = LoopBudget::get().getWriteSlice();
+    auto allowed = writeSlice > 0 ? std::min(maxToSend_, writeSlice)
+                                  : maxToSend_;
     // TODO: we could send FIN only?
-    maxToSend_ = writeRequestStreams(maxToSend_);
+    writeRequestStreams(allowed);
+    if (allowed < maxToSend_ && !txnEgressQueue_.empty()) {
+      // scheduleWrite() below asks the transport for another round
+      LoopBudget::get().onWriteYield();
+    }
   }
   // Zero out maxToSend_ here.  We won't egress anything else until the next
   // onWriteReady call
@@ -1009,7 +1057,7 @@ void HQSession::runLoopCallback() noexcept {
   VLOG(4) << "sess=" << *this << " maybe schedule the next loop callback. "
           << " pending writes: " << !txnEgressQueue_.empty()
           << " pending processing reads: " << pendingProcessReadSet_.size();
-  if (!pendingProcessReadSet_.empty()) {
+  if (!pendingProcessReadSet_.empty() || !pendingBatchedReadSet_.empty()) {
     scheduleLoopCallback(false);
   }
   // checkForShutdown is now in ScopeGuard
@@ -1081,6 +1129,12 @@ void HQSession::readAvailable(quic::StreamId id) noexcept {
   // this is the bidirectional callback
   VLOG(4) << __func__ << " sess=" << *this
           << ": readAvailable on streamID=" << id;
+  FOLLY_SDT(proxygen, hq_read_available, this, id);
+  if (batchedReads_) {
+    pendingBatchedReadSet_.insert(id);
+    scheduleLoopCallback(true);
+    return;
+  }
   if (readsPerLoop_ >= kMaxReadsPerLoop) {
     VLOG(2) << __func__ << ": skipping read for streamID=" << id
             << " maximum reads per loop reached"
@@ -1148,6 +1202,9 @@ void HQSession::readError(quic::StreamId id, quic::QuicError error) noexcept {
 
 void HQSession::timeoutExpired() noexcept {
   VLOG(3) << "ManagedConnection timeoutExpired " << *this;
+  if (httpSessionActivityTracker_) {
+    httpSessionActivityTracker_->flushActivity();
+  }
   if (getNumStreams() > 0) {
     VLOG(3) << "ignoring session timeout " << *this;
     resetTimeout();
@@ -1178,6 +1235,8 @@ void HQSession::readControlStream(HQControlStream* ctrlStream) {
   quic::Buf data = std::move(readRes.value().first);
   auto readSize = data ? data->computeChainDataLength() : 0;
   VLOG(4) << "Read " << readSize << " bytes from control stream";
+  recordIngress(
+      ctrlStream->getIngressStreamId(), data.get(), readRes.value().second);
   ctrlStream->readBuf_.append(std::move(data));
   ctrlStream->readEOF_ = readRes.value().second;
 
@@ -1201,6 +1260,12 @@ void HQSession::dispatchControlStream(quic::StreamId id,
 
   auto consumeRes = sock_->consume(id, toConsume);
   CHECK(!consumeRes.hasError()) << "Unexpected error consuming bytes";
+  if (ingressRecorder_) {
+    // Re-encoded, the replay only needs the same type
+    folly::IOBufQueue preface{folly::IOBufQueue::cacheChainLength()};
+    hq::writeStreamPreface(preface, static_cast<uint64_t>(type));
+    recordIngress(id, preface.front(), false);
+  }
 
   // Notify the read callback
   if (infoCallback_) {
@@ -1227,6 +1292,74 @@ void HQSession::dispatchControlStream(quic::StreamId id,
   controlStreamReadAvailable(id);
 }
 
+void HQSession::dispatchRequestStream(quic::StreamId id) {
+  if (sock_->isServerStream(id)) {
+    // Server-initiated bidirectional streams are WebTransport only
+    rejectStream(id);
+    return;
+  }
+  VLOG(4) << __func__ << " streamID=" << id;
+  sock_->setPeekCallback(id, nullptr);
+  setupIngressRequestStream(id);
+  // The transport notifies of data arriving from now on only
+  readAvailable(id);
+}
+
+void HQSession::dispatchWebTransportStream(quic::StreamId id,
+                                           quic::StreamId sessionId,
+                                           size_t toConsume) {
+  VLOG(4) << __func__ << " streamID=" << id << " sessionID=" << sessionId;
+  auto it = webTransportSessions_.find(sessionId);
+  if (it == webTransportSessions_.end() || !supportsWebTransport()) {
+    VLOG(3) << "No WebTransport session for streamID=" << id
+            << " sessionID=" << sessionId << " sess=" << *this;
+    rejectStream(id);
+    return;
+  }
+  auto consumeRes = sock_->consume(id, toConsume);
+  CHECK(!consumeRes.hasError()) << "Unexpected error consuming bytes";
+  sock_->setPeekCallback(id, nullptr);
+  it->second->onIncomingStream(id);
+}
+
+HQWebTransportSession* HQSession::startWebTransport(
+    HTTPTransaction* txn, WebTransportHandler* handler) {
+  CHECK(txn);
+  if (!supportsWebTransport()) {
+    return nullptr;
+  }
+  auto sessionId = txn->getID();
+  auto stream = findNonDetachedStream(sessionId);
+  if (!stream || webTransportSessions_.count(sessionId)) {
+    return nullptr;
+  }
+  auto res = webTransportSessions_.emplace(
+      sessionId,
+      std::unique_ptr<HQWebTransportSession, WebTransportSessionDestructor>(
+          new HQWebTransportSession(*this, sessionId, handler)));
+  VLOG(3) << "Started WebTransport sessionID=" << sessionId
+          << " sess=" << *this;
+  return res.first->second.get();
+}
+
+void HQSession::endWebTransportSession(quic::StreamId sessionId,
+                                       bool notify) {
+  auto it = webTransportSessions_.find(sessionId);
+  if (it == webTransportSessions_.end()) {
+    return;
+  }
+  VLOG(3) << "Ending WebTransport sessionID=" << sessionId
+          << " sess=" << *this;
+  auto wtSession = std::move(it->second);
+  webTransportSessions_.erase(it);
+  wtSession->end(notify);
+}
+
+void HQSession::WebTransportSessionDestructor::operator()(
+    HQWebTransportSession* session) const {
+  session->destroy();
+}
+
 void HQSession::rejectStream(quic::StreamId id) {
   if (!sock_) {
     return;
@@ -1307,6 +1440,7 @@ void HQSession::controlStreamReadError(quic::StreamId id,
 }
 
 void HQSession::readRequestStream(quic::StreamId id) noexcept {
+  PROXYGEN_ALLOCATION_PHASE(PARSE);
   auto hqStream = findIngressStream(id, false /* includeDetached */);
   if (!hqStream) {
     // can we even get readAvailable after a stream is marked for detach ?
@@ -1326,6 +1460,7 @@ void HQSession::readRequestStream(quic::StreamId id) noexcept {
   quic::Buf data = std::move(readRes.value().first);
   auto readSize = data ? data->computeChainDataLength() : 0;
   hqStream->readEOF_ = readRes.value().second;
+  recordIngress(id, data.get(), hqStream->readEOF_);
   VLOG(3) << "Got streamID=" << hqStream->getStreamId() << " len=" << readSize
           << " eof=" << uint32_t(hqStream->readEOF_) << " sess=" << *this;
   if (hqStream->readEOF_) {
@@ -1349,9 +1484,61 @@ void HQSession::readRequestStream(quic::StreamId id) noexcept {
   pendingProcessReadSet_.insert(id);
 }
 
+void HQSession::recordIngress(quic::StreamId id,
+                              const folly::IOBuf* data,
+                              bool eof) {
+  if (!ingressRecorder_) {
+    return;
+  }
+  if (data) {
+    ingressRecorder_->onData(id, *data);
+  }
+  if (eof) {
+    ingressRecorder_->onEndOfStream(id);
+  }
+}
+
+void HQSession::readBatchedStreams() {
+  auto streams = std::move(pendingBatchedReadSet_);
+  pendingBatchedReadSet_.clear();
+  for (auto id : streams) {
+    if (!sock_) {
+      return;
+    }
+    readRequestStream(id);
+  }
+}
+
+void HQSession::flushDeferredIngress(
+    const std::vector<quic::StreamId>& streams) {
+  for (auto id : streams) {
+    // handler callbacks may detach or abort other streams
+    auto ingressStream = findIngressStream(id, true /* includeDetached */);
+    if (ingressStream) {
+      ingressStream->txn_.flushDeferredIngress();
+    }
+  }
+}
+
 void HQSession::processReadData() {
+  PROXYGEN_ALLOCATION_PHASE(PARSE);
+  std::vector<quic::StreamId> deferredStreams;
+  if (batchedReads_) {
+    readBatchedStreams();
+    deferredStreams.reserve(pendingProcessReadSet_.size());
+  }
+  uint64_t readSlice = LoopBudget::get().getReadSlice();
+  uint64_t parsed = 0;
   for (auto it = pendingProcessReadSet_.begin();
        it != pendingProcessReadSet_.end();) {
+    if (readSlice > 0 && parsed >= readSlice) {
+      // The streams left are processed from the next loop callback, which
+      // runLoopCallback schedules
+      VLOG(4) << "sess=" << *this << " yielding reads, streams left="
+              << pendingProcessReadSet_.size();
+      LoopBudget::get().onReadYield();
+      break;
+    }
     auto g = folly::makeGuard([&]() {
       // the codec may not have processed all the data, but we won't ask again
       // until we get more
@@ -1376,8 +1563,16 @@ void HQSession::processReadData() {
       continue;
     }
 
+    if (batchedReads_) {
+      ingressStream->txn_.deferIngress();
+      deferredStreams.push_back(*it);
+    }
+
     // Feed it to the codec
+    auto unparsed = ingressStream->readBuf_.chainLength();
     auto blocked = ingressStream->processReadData();
+    auto left = ingressStream->readBuf_.chainLength();
+    parsed += unparsed - std::min(unparsed, left);
     if (!blocked) {
       if (ingressStream->readEOF_) {
         ingressStream->onIngressEOF();
@@ -1385,6 +1580,9 @@ void HQSession::processReadData() {
       continue;
     }
   }
+  if (batchedReads_) {
+    flushDeferredIngress(deferredStreams);
+  }
 }
 
 void HQSession::headersComplete(HTTPMessage* /*msg*/) {
@@ -1442,6 +1640,9 @@ void HQSession::applySettings(const SettingsList& settings) {
   }
   qpackCodec_.setEncoderHeaderTableSize(tableSize);
   qpackCodec_.setMaxVulnerable(blocked);
+  if (qpackWarmTable_ && tableSize > 0) {
+    warmQPACKTable();
+  }
 
   // If H3 datagram is enabled but datagram was not negotiated at the
   // transport, close the connection
@@ -1514,7 +1715,7 @@ void HQSession::onPriority(quic::StreamId streamId, const HTTPPriority& pri) {
     priorityUpdatesBuffer_.insert(streamId, pri);
     return;
   }
-  sock_->setStreamPriority(streamId, toQuicPriority(pri));
+  stream->setStreamPriority(pri);
 }
 
 void HQSession::onPushPriority(hq::PushId pushId, const HTTPPriority& pri) {
@@ -1542,7 +1743,7 @@ void HQSession::onPushPriority(hq::PushId pushId, const HTTPPriority& pri) {
   if (!stream) {
     return;
   }
-  sock_->setStreamPriority(streamId, toQuicPriority(pri));
+  stream->setStreamPriority(pri);
 }
 
 void HQSession::notifyEgressBodyBuffered(int64_t bytes) {
@@ -1608,6 +1809,7 @@ void HQSession::onFlowControlUpdate(quic::StreamId id) noexcept {
 
 void HQSession::onConnectionWriteReady(uint64_t maxToSend) noexcept {
   VLOG(4) << __func__ << " sess=" << *this << ": maxToSend=" << maxToSend;
+  FOLLY_SDT(proxygen, hq_write_ready, this, maxToSend);
   scheduledWrite_ = false;
   maxToSend_ = maxToSend;
 
@@ -1947,6 +2149,7 @@ uint64_t HQSession::requestStreamWriteImpl(HQStreamTransportBase* hqStream,
           << " buflen=" << hqStream->writeBufferSize()
           << " hasPendingBody=" << hqStream->txn_.hasPendingBody()
           << " EOM=" << hqStream->pendingEOM_;
+  FOLLY_SDT(proxygen, hq_stream_write, this, streamId, sent, sendEof);
   if (infoCallback_) {
     infoCallback_->onWrite(*this, sent);
   }
@@ -2093,6 +2296,30 @@ HQSession::createStreamTransport(quic::StreamId streamId) {
   return &matchPair.first->second;
 }
 
+void HQSession::warmQPACKTable() {
+  auto QPACKEncoderStream =
+      findControlStream(UnidirectionalStreamType::QPACK_ENCODER);
+  if (!QPACKEncoderStream || !sock_) {
+    return;
+  }
+  auto flowControl =
+      sock_->getStreamFlowControl(QPACKEncoderStream->getEgressStreamId());
+  if (flowControl.hasError()) {
+    return;
+  }
+  // Leave room in the window for inserts and duplicates made by requests
+  uint32_t maxBytes = std::min<uint64_t>(
+      flowControl->sendWindowAvailable / 2,
+      std::numeric_limits<uint32_t>::max());
+  auto inserted = qpackCodec_.warmTable(
+      *qpackWarmTable_, QPACKEncoderStream->writeBuf_, maxBytes);
+  VLOG(4) << "Warmed QPACK table with " << inserted
+          << " entries sess=" << *this;
+  if (inserted > 0) {
+    scheduleWrite();
+  }
+}
+
 std::unique_ptr<HTTPCodec> HQSession::createCodec(quic::StreamId streamId) {
   auto QPACKEncoderStream =
       findControlStream(UnidirectionalStreamType::QPACK_ENCODER);
@@ -2121,6 +2348,12 @@ std::unique_ptr<HTTPCodec> HQSession::createCodec(quic::StreamId streamId) {
   return codec;
 }
 
+void HQSession::onEgressPacerChanged() {
+  invokeOnAllStreams([this](HQStreamTransportBase* stream) {
+    stream->txn_.setEgressPacer(egressPacer_.get());
+  });
+}
+
 HQSession::HQStreamTransportBase::HQStreamTransportBase(
     HQSession& session,
     TransportDirection direction,
@@ -2151,7 +2384,18 @@ HQSession::HQStreamTransportBase::HQStreamTransportBase(
       byteEventTracker_(nullptr, session.getQuicSocket(), streamId) {
   VLOG(4) << __func__ << " txn=" << txn_;
   byteEventTracker_.setTTLBAStats(session_.sessionStats_);
+  if (session_.requestSampling_) {
+    txn_.setRequestSampling(session_.requestSampling_);
+  }
+  if (session_.byteEventSampling_) {
+    byteEventTracker_.enableBatchedEvents(
+        session_.byteEventSampling_->isLucky());
+  } else if (session_.requestSampling_) {
+    // Decided by now unless keyed on the request headers
+    byteEventTracker_.enableBatchedEvents(txn_.isSampled());
+  }
   quicStreamProtocolInfo_ = std::make_shared<QuicStreamProtocolInfo>();
+  txn_.setEgressPacer(session_.getEgressPacer());
 }
 
 void HQSession::HQStreamTransportBase::initCodec(
@@ -2165,6 +2409,7 @@ void HQSession::HQStreamTransportBase::initCodec(
     auto c = dynamic_cast<hq::HQStreamCodec*>(realCodec_.get());
     CHECK(c) << "HQ should use HQStream codec";
     c->setActivationHook([this] { return setActiveCodec("self"); });
+    c->setBodyCopyThreshold(session_.ingressBodyCopyThreshold_);
   }
   auto g = folly::makeGuard(setActiveCodec(__func__));
   if (session_.direction_ == TransportDirection::UPSTREAM || txn_.isPushed()) {
@@ -2173,6 +2418,18 @@ void HQSession::HQStreamTransportBase::initCodec(
   hasCodec_ = true;
 }
 
+void HQSession::HQStreamTransportBase::recordIngressBodyStats() {
+  auto stats = session_.sessionStats_;
+  if (!stats || session_.version_ != HQVersion::HQ) {
+    return;
+  }
+  auto c = dynamic_cast<hq::HQStreamCodec*>(realCodec_.get());
+  if (c) {
+    stats->recordIngressBodyZeroCopyBytes(c->getIngressBodyBytesZeroCopy());
+    stats->recordIngressBodyCopiedBytes(c->getIngressBodyBytesCopied());
+  }
+}
+
 void HQSession::HQStreamTransportBase::initIngress(const std::string& where) {
   VLOG(3) << where << " " << __func__ << " txn=" << txn_;
   CHECK(session_.sock_)
@@ -2301,6 +2558,7 @@ HQSession::HQStreamTransportBase::getSessionType() const noexcept {
 }
 
 void HQSession::detachStreamTransport(HQStreamTransportBase* hqStream) {
+  hqStream->recordIngressBodyStats();
   // Special case - streams that dont have either ingress stream id
   // or egress stream id dont need to be actually detached
   // prior to being erased
@@ -2308,6 +2566,9 @@ void HQSession::detachStreamTransport(HQStreamTransportBase* hqStream) {
     auto streamId = hqStream->getStreamId();
     VLOG(4) << __func__ << " streamID=" << streamId;
     CHECK(findStream(streamId));
+    if (!webTransportSessions_.empty()) {
+      endWebTransportSession(streamId, true);
+    }
     if (sock_ && hqStream->hasIngressStreamId()) {
       clearStreamCallbacks(streamId);
     }
@@ -2423,10 +2684,15 @@ bool HQSession::HQStreamTransportBase::processReadData() {
 void HQSession::HQStreamTransportBase::onHeadersComplete(
     HTTPCodec::StreamID streamID, std::unique_ptr<HTTPMessage> msg) {
   VLOG(4) << __func__ << " txn=" << txn_;
+  FOLLY_SDT(proxygen, hq_headers_complete, &session_, streamID);
   msg->dumpMessage(3);
   // TODO: the codec will set this
   msg->setAdvancedProtocolString(session_.alpn_);
   msg->setSecure(true);
+  if (session_.direction_ == TransportDirection::DOWNSTREAM &&
+      !session_.fullHandshakeDone_) {
+    msg->setEarlyData(true);
+  }
   CHECK(codecStreamId_);
   CHECK_EQ(streamID, *codecStreamId_);
 
@@ -2444,6 +2710,7 @@ void HQSession::HQStreamTransportBase::onHeadersComplete(
   // client) are processed.
   if (session_.direction_ == TransportDirection::DOWNSTREAM) {
     if (auto msgPtr = msg.get()) {
+      session_.recordRequestStarted(txn_.getID(), msgPtr->getHeaders());
       const auto event =
           HTTPSessionObserverInterface::RequestStartedEvent::Builder()
               .setHeaders(msgPtr->getHeaders())
@@ -2491,11 +2758,11 @@ void HQSession::HQStreamTransportBase::onHeadersComplete(
   if (sock) {
     auto itr = session_.priorityUpdatesBuffer_.find(streamId);
     if (itr != session_.priorityUpdatesBuffer_.end()) {
-      sock->setStreamPriority(streamId, toQuicPriority(itr->second));
+      setStreamPriority(itr->second);
     } else {
       const auto httpPriority = httpPriorityFromHTTPMessage(*msg);
       if (httpPriority) {
-        sock->setStreamPriority(streamId, toQuicPriority(httpPriority.value()));
+        setStreamPriority(httpPriority.value());
       }
     }
   }
@@ -2524,7 +2791,11 @@ void HQSession::HQStreamTransportBase::onHeadersComplete(
     if (itr != session_.datagramsBuffer_.end()) {
       auto& vec = itr->second;
       for (auto& datagram : vec) {
-        txn_.onDatagram(std::move(datagram));
+        if (datagramSink_) {
+          datagramSink_->onDatagram(streamId, std::move(datagram));
+        } else {
+          txn_.onDatagram(std::move(datagram));
+        }
       }
       session_.datagramsBuffer_.erase(itr);
     }
@@ -2627,13 +2898,28 @@ void HQSession::abortStream(quic::StreamId id) {
   scheduleWrite();
 }
 
+void HQSession::HQStreamTransportBase::setStreamPriority(
+    const HTTPPriority& priority) noexcept {
+  priority_ = priority;
+  if (auto sock = session_.sock_) {
+    sock->setStreamPriority(getStreamId(),
+                            toQuicPriority(priority, sendWhole_));
+  }
+}
+
 void HQSession::HQStreamTransportBase::updatePriority(
     const HTTPMessage& headers) noexcept {
-  auto sock = session_.sock_;
-  auto streamId = getStreamId();
+  if (!headers.isRequest() && session_.incrementalMinResponseSize_ > 0) {
+    auto length = folly::tryTo<uint64_t>(
+        headers.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH));
+    sendWhole_ = length && *length < session_.incrementalMinResponseSize_;
+  }
   auto httpPriority = httpPriorityFromHTTPMessage(headers);
-  if (sock && httpPriority) {
-    sock->setStreamPriority(streamId, toQuicPriority(httpPriority.value()));
+  if (httpPriority) {
+    setStreamPriority(httpPriority.value());
+  } else if (sendWhole_ && priority_ && priority_->incremental) {
+    // The request's priority, without the interleaving
+    setStreamPriority(*priority_);
   }
 }
 
@@ -2752,6 +3038,7 @@ void HQSession::HQStreamTransportBase::sendHeaders(HTTPTransaction* txn,
                                                    const HTTPMessage& headers,
                                                    HTTPHeaderSize* size,
                                                    bool includeEOM) noexcept {
+  PROXYGEN_ALLOCATION_PHASE(ENCODE);
   VLOG(4) << __func__ << " txn=" << txn_;
   CHECK(hasEgressStreamId()) << __func__ << " invoked on stream without egress";
   DCHECK(txn == &txn_);
@@ -2798,6 +3085,7 @@ void HQSession::HQStreamTransportBase::sendHeaders(HTTPTransaction* txn,
   // If this is a client sending request headers to upstream
   // invoke requestStarted event for attached observers.
   if (session_.direction_ == TransportDirection::UPSTREAM) {
+    session_.recordRequestStarted(txn_.getID(), headers.getHeaders());
     const auto event =
         HTTPSessionObserverInterface::RequestStartedEvent::Builder()
             .setHeaders(headers.getHeaders())
@@ -2812,6 +3100,7 @@ void HQSession::HQStreamTransportBase::sendHeaders(HTTPTransaction* txn,
 
 size_t HQSession::HQStreamTransportBase::sendEOM(
     HTTPTransaction* txn, const HTTPHeaders* trailers) noexcept {
+  PROXYGEN_ALLOCATION_PHASE(ENCODE);
   VLOG(4) << __func__ << " txn=" << txn_;
   CHECK(hasEgressStreamId()) << __func__ << " invoked on stream without egress";
   DCHECK(txn == &txn_);
@@ -3107,6 +3396,7 @@ size_t HQSession::HQStreamTransportBase::sendBody(
     std::unique_ptr<folly::IOBuf> body,
     bool includeEOM,
     bool /* trackLastByteFlushed */) noexcept {
+  PROXYGEN_ALLOCATION_PHASE(ENCODE);
   auto bodyLength = body->computeChainDataLength();
   VLOG(4) << __func__ << " len=" << bodyLength << " eof=" << includeEOM
           << " txn=" << txn_;
@@ -3569,59 +3859,104 @@ void HQSession::onDatagramsAvailable() noexcept {
     VLOG(4) << "Received datagram for streamId=" << streamId
             << " ctx=" << ctxId->first << " len=" << datagramQ.chainLength()
             << " sess=" << *this;
-    stream->txn_.onDatagram(datagramQ.move());
+    if (stream->datagramSink_) {
+      stream->datagramSink_->onDatagram(streamId, datagramQ.move());
+    } else {
+      stream->txn_.onDatagram(datagramQ.move());
+    }
   }
 }
 
-uint16_t HQSession::HQStreamTransport::getDatagramSizeLimit() const noexcept {
-  if (!session_.datagramEnabled_) {
-    return 0;
+bool HQSession::setDatagramSink(quic::StreamId streamId, DatagramSink* sink) {
+  if (!datagramEnabled_) {
+    return false;
   }
-  auto transportMaxDatagramSize = session_.sock_->getDatagramSizeLimit();
-  if (transportMaxDatagramSize < kMaxDatagramHeaderSize) {
-    return 0;
+  auto stream = findNonDetachedStream(streamId);
+  if (!stream) {
+    return false;
   }
-  return session_.sock_->getDatagramSizeLimit() - kMaxDatagramHeaderSize;
+  stream->datagramSink_ = sink;
+  return true;
 }
 
-bool HQSession::HQStreamTransport::sendDatagram(
-    std::unique_ptr<folly::IOBuf> datagram) {
-  if (!streamId_.hasValue() || !session_.datagramEnabled_) {
-    return false;
+size_t HQSession::sendDatagrams(
+    quic::StreamId streamId,
+    std::vector<std::unique_ptr<folly::IOBuf>> datagrams) {
+  if (!datagramEnabled_ || !findNonDetachedStream(streamId)) {
+    return 0;
   }
+  size_t sent = 0;
+  for (auto& datagram : datagrams) {
+    if (!writeDatagram(streamId, std::move(datagram))) {
+      break;
+    }
+    sent++;
+  }
+  return sent;
+}
+
+bool HQSession::writeDatagram(quic::StreamId streamId,
+                              std::unique_ptr<folly::IOBuf> datagram) {
   // Prepend the H3 Datagram header to the datagram payload
   // HTTP/3 Datagram {
   //   Quarter Stream ID (i),
   //   [Context ID (i)],
   //   HTTP/3 Datagram Payload (..),
   // }
-  quic::Buf headerBuf =
-      quic::Buf(folly::IOBuf::create(session_.sock_->getDatagramSizeLimit()));
-  quic::BufAppender appender(headerBuf.get(), kMaxDatagramHeaderSize);
-  auto streamIdRes = quic::encodeQuicInteger(
-      streamId_.value() / 4, [&](auto val) { appender.writeBE(val); });
-  if (streamIdRes.hasError()) {
-    return false;
-  }
   // Always use context-id = 0 for now
-  auto ctxIdRes =
-      quic::encodeQuicInteger(0, [&](auto val) { appender.writeBE(val); });
-  if (ctxIdRes.hasError()) {
+  auto quarterStreamId = streamId / 4;
+  auto headerLen = quic::getQuicIntegerSize(quarterStreamId);
+  if (headerLen.hasError()) {
     return false;
   }
-  VLOG(4) << "Sending datagram for streamId=" << streamId_.value()
-          << " len=" << datagram->computeChainDataLength()
-          << " sess=" << session_;
-  quic::BufQueue queue(std::move(headerBuf));
-  queue.append(std::move(datagram));
-  auto writeRes = session_.sock_->writeDatagram(queue.move());
+  auto len = *headerLen + 1;
+  VLOG(4) << "Sending datagram for streamId=" << streamId
+          << " len=" << datagram->computeChainDataLength() << " sess=" << *this;
+  quic::BufQueue queue;
+  if (!datagram->isSharedOne() && datagram->headroom() >= len) {
+    // Write the header in place, in front of the payload
+    datagram->prepend(len);
+    folly::io::RWPrivateCursor cursor(datagram.get());
+    quic::encodeQuicInteger(quarterStreamId,
+                            [&](auto val) { cursor.writeBE(val); });
+    cursor.write<uint8_t>(0);
+    queue.append(std::move(datagram));
+  } else {
+    auto headerBuf = folly::IOBuf::create(kMaxDatagramHeaderSize);
+    quic::BufAppender appender(headerBuf.get(), kMaxDatagramHeaderSize);
+    quic::encodeQuicInteger(quarterStreamId,
+                            [&](auto val) { appender.writeBE(val); });
+    appender.writeBE<uint8_t>(0);
+    queue.append(std::move(headerBuf));
+    queue.append(std::move(datagram));
+  }
+  auto writeRes = sock_->writeDatagram(queue.move());
   if (writeRes.hasError()) {
-    LOG(ERROR) << "Failed to send datagram for streamId=" << streamId_.value();
+    LOG(ERROR) << "Failed to send datagram for streamId=" << streamId;
     return false;
   }
   return true;
 }
 
+uint16_t HQSession::HQStreamTransport::getDatagramSizeLimit() const noexcept {
+  if (!session_.datagramEnabled_) {
+    return 0;
+  }
+  auto transportMaxDatagramSize = session_.sock_->getDatagramSizeLimit();
+  if (transportMaxDatagramSize < kMaxDatagramHeaderSize) {
+    return 0;
+  }
+  return session_.sock_->getDatagramSizeLimit() - kMaxDatagramHeaderSize;
+}
+
+bool HQSession::HQStreamTransport::sendDatagram(
+    std::unique_ptr<folly::IOBuf> datagram) {
+  if (!streamId_.hasValue() || !session_.datagramEnabled_) {
+    return false;
+  }
+  return session_.writeDatagram(streamId_.value(), std::move(datagram));
+}
+
 std::ostream& operator<<(std::ostream& os, const HQSession& session) {
   session.describe(os);
   return os;
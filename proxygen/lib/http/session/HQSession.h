@@ -31,6 +31,7 @@
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 #include <proxygen/lib/http/session/QuicProtocolInfo.h>
 #include <proxygen/lib/http/session/ServerPushLifecycle.h>
+#include <proxygen/lib/sampling/Sampling.h>
 #include <proxygen/lib/utils/ConditionalGate.h>
 #include <quic/api/QuicSocket.h>
 #include <quic/common/BufUtil.h>
@@ -39,6 +40,7 @@ namespace proxygen {
 
 class HTTPSessionController;
 class HQSession;
+class HQWebTransportSession;
 
 namespace hq {
 class HQStreamCodec;
@@ -164,6 +166,60 @@ class HQSession
     strictValidation_ = strictValidation;
   }
 
+  /**
+   * In batched read mode readAvailable() only records the stream.  The loop
+   * callback then reads every readable stream, runs all of their codecs, and
+   * delivers the resulting handler callbacks in a single pass at the end,
+   * instead of interleaving socket reads, parsing and handler callbacks per
+   * stream.  The kMaxReadsPerLoop limit doesn't apply.
+   */
+  void setBatchedReads(bool batchedReads) {
+    batchedReads_ = batchedReads;
+  }
+
+  /**
+   * Track egress byte events in batched mode (see
+   * HQByteEventTracker::enableBatchedEvents).  The given fraction of streams
+   * gets full first/last byte TX and ACK tracking, the others only track
+   * the ACK of their last byte.  Applies to streams created after the call.
+   */
+  void setByteEventSampling(double rate) {
+    byteEventSampling_ = Sampling(rate);
+  }
+
+  /**
+   * Request stream DATA payloads shorter than this are copied rather than
+   * delivered as slices of the QUIC read buffer, see
+   * HQStreamCodec::setBodyCopyThreshold.  Applies to streams created after
+   * the call.
+   */
+  void setIngressBodyCopyThreshold(size_t threshold) {
+    ingressBodyCopyThreshold_ = threshold;
+  }
+
+  /**
+   * Responses with a Content-Length below this are sent non-incremental
+   * whatever their RFC 9218 priority says: they fit in a few packets, and
+   * interleaving them with the other incremental streams of their urgency
+   * only delays their completion.  0, the default, keeps the incremental
+   * flag as is.
+   */
+  void setIncrementalMinResponseSize(uint64_t size) {
+    incrementalMinResponseSize_ = size;
+  }
+
+  /**
+   * Frequently used header entries to insert into the QPACK encoder's dynamic
+   * table as soon as the peer's SETTINGS allow it, so short connections get
+   * dynamic table hits from their first request.  The list is typically
+   * shared by every session of a server.  Entries that don't fit in the
+   * table or the encoder stream flow control window are dropped.
+   */
+  void setQPACKWarmTable(
+      std::shared_ptr<const std::vector<HPACKHeader>> warmTable) {
+    qpackWarmTable_ = std::move(warmTable);
+  }
+
   void setSessionStats(HTTPSessionStats* stats) override;
 
   void onNewBidirectionalStream(quic::StreamId id) noexcept override;
@@ -390,6 +446,89 @@ class HQSession
   bool getCurrentStreamTransportInfo(QuicStreamProtocolInfo* /*qspinfo*/,
                                      quic::StreamId /*streamId*/);
 
+  /**
+   * Receives the HTTP/3 datagrams of one stream straight from the session,
+   * instead of through HTTPTransaction::Handler::onDatagram.  The payload is
+   * the buffer read from the transport with the datagram header trimmed.
+   */
+  class DatagramSink {
+   public:
+    virtual ~DatagramSink() = default;
+    virtual void onDatagram(quic::StreamId streamId,
+                            std::unique_ptr<folly::IOBuf> payload) noexcept = 0;
+  };
+
+  /**
+   * Deliver the datagrams of streamId to sink, nullptr goes back to the
+   * transaction.  Datagrams buffered before the stream's headers arrived are
+   * delivered when the headers do.  The sink is forgotten when the stream
+   * detaches and must outlive it or be reset.  Returns false if datagrams
+   * are disabled or the stream doesn't exist.
+   */
+  bool setDatagramSink(quic::StreamId streamId, DatagramSink* sink);
+
+  /**
+   * Send several datagrams for streamId.  The H3 datagram header is written
+   * into each buffer's headroom when it is unshared and has room, see
+   * kMaxDatagramHeaderSize, so the payload isn't copied.  Stops at the first
+   * failure and returns how many were written.
+   */
+  size_t sendDatagrams(quic::StreamId streamId,
+                       std::vector<std::unique_ptr<folly::IOBuf>> datagrams);
+
+  /**
+   * Callbacks of an HQWebTransportSession.  Stream data is the buffer read
+   * from the transport, it doesn't go through HTTPTransaction.
+   */
+  class WebTransportHandler {
+   public:
+    virtual ~WebTransportHandler() = default;
+
+    // A stream opened by the peer, its data follows in onStreamData
+    virtual void onNewStream(quic::StreamId id, bool bidi) noexcept = 0;
+
+    // data may be nullptr with eof
+    virtual void onStreamData(quic::StreamId id,
+                              std::unique_ptr<folly::IOBuf> data,
+                              bool eof) noexcept = 0;
+
+    // The ingress of id was reset by the peer or failed
+    virtual void onStreamError(quic::StreamId id,
+                               quic::QuicError error) noexcept = 0;
+
+    // The peer sent STOP_SENDING, the egress of id has been reset
+    virtual void onStopSending(
+        quic::StreamId /* id */,
+        quic::ApplicationErrorCode /* error */) noexcept {
+    }
+
+    virtual void onDatagram(std::unique_ptr<folly::IOBuf> payload) noexcept = 0;
+
+    // The CONNECT stream detached, no callback follows
+    virtual void onSessionEnd() noexcept = 0;
+  };
+
+  /**
+   * True when both this and the peer send ENABLE_WEBTRANSPORT in SETTINGS.
+   * The egress SETTINGS should also enable H3_DATAGRAM and
+   * ENABLE_CONNECT_PROTOCOL.
+   */
+  bool supportsWebTransport() const {
+    return receivedSettings_ &&
+           egressSettings_.getSetting(SettingsId::ENABLE_WEBTRANSPORT, 0) &&
+           ingressSettings_.getSetting(SettingsId::ENABLE_WEBTRANSPORT, 0);
+  }
+
+  /**
+   * Starts a WebTransport session on txn, the extended CONNECT stream, once
+   * its 2xx response is sent or received.  Owned by this, the session ends
+   * when txn detaches or it is closed.  Streams the peer opens for it before
+   * this are rejected.  nullptr if WebTransport isn't supported or txn
+   * already has a session.
+   */
+  HQWebTransportSession* startWebTransport(HTTPTransaction* txn,
+                                           WebTransportHandler* handler);
+
   bool connCloseByRemote() override {
     return false;
   }
@@ -436,6 +575,13 @@ class HQSession
     });
   }
 
+  // See QPACKCodec::setEncoderAdaptiveTableSize
+  void setAdaptiveHeaderTableSize(uint32_t initialSize) {
+    versionUtilsReady_.then([this, initialSize] {
+      qpackCodec_.setEncoderAdaptiveTableSize(initialSize);
+    });
+  }
+
   void enableDoubleGoawayDrain() override {
   }
 
@@ -506,6 +652,9 @@ class HQSession
         true);
   }
 
+  // The QUIC transport paces on its own besides
+  void onEgressPacerChanged() override;
+
   void invokeOnEgressStreams(std::function<void(HQStreamTransportBase*)> fn,
                              bool includeDetached = false) {
     invokeOnStreamsImpl(std::move(fn),
@@ -607,8 +756,11 @@ class HQSession
                              hq::UnidirectionalStreamType /* type */,
                              size_t /* toConsume */) override;
 
-  void dispatchRequestStream(quic::StreamId /* streamId */) override {
-  }
+  void dispatchRequestStream(quic::StreamId streamId) override;
+
+  void dispatchWebTransportStream(quic::StreamId id,
+                                  quic::StreamId sessionId,
+                                  size_t toConsume) override;
 
   std::chrono::milliseconds getDispatchTimeout() const override {
     return transactionsTimeout_;
@@ -620,7 +772,11 @@ class HQSession
       uint64_t preface) override;
 
   folly::Optional<hq::BidirectionalStreamType> parseBidiStreamPreface(
-      uint64_t) override {
+      uint64_t preface) override {
+    if (preface ==
+        folly::to_underlying(hq::BidirectionalStreamType::WEBTRANSPORT)) {
+      return hq::BidirectionalStreamType::WEBTRANSPORT;
+    }
     return hq::BidirectionalStreamType::REQUEST;
   }
 
@@ -738,8 +894,25 @@ class HQSession
   // or Push streams are request streams.
   HQStreamTransport* createStreamTransport(quic::StreamId streamId);
 
+  // Creates the stream of a new ingress request and starts reading it
+  HQStreamTransport* setupIngressRequestStream(quic::StreamId streamId);
+
+  // With ENABLE_WEBTRANSPORT in the egress SETTINGS, bidirectional ingress
+  // streams go through the dispatcher to tell WebTransport from requests
+  bool webTransportEgressEnabled() const {
+    return egressSettings_.getSetting(SettingsId::ENABLE_WEBTRANSPORT, 0);
+  }
+
+  // Ends the WebTransport session of sessionId, if any
+  void endWebTransportSession(quic::StreamId sessionId, bool notify);
+
   bool createEgressControlStreams();
 
+  // Prepends the H3 datagram header for streamId and hands the datagram to
+  // the transport
+  bool writeDatagram(quic::StreamId streamId,
+                     std::unique_ptr<folly::IOBuf> datagram);
+
   // Creates outgoing control stream.
   bool createEgressControlStream(hq::UnidirectionalStreamType streamType);
 
@@ -767,11 +940,19 @@ class HQSession
   // helper functions for reads
   void readRequestStream(quic::StreamId id) noexcept;
   void readControlStream(HQControlStream* controlStream);
+  // Hands a read to the ingress capture, if any
+  void recordIngress(quic::StreamId id, const folly::IOBuf* data, bool eof);
 
   // Runs the codecs on all request streams that have received data
   // during the last event loop
   void processReadData();
 
+  // Batched read mode: read the streams recorded by readAvailable()
+  void readBatchedStreams();
+
+  // Batched read mode: deliver the handler callbacks queued while parsing
+  void flushDeferredIngress(const std::vector<quic::StreamId>& streams);
+
   // Pausing reads prevents the read callback to be invoked on the stream
   void resumeReads(quic::StreamId id);
 
@@ -828,6 +1009,9 @@ class HQSession
                                   double ratio);
 
   uint64_t writeControlStreams(uint64_t maxEgress);
+
+  // Write the configured warm table entries to the QPACK encoder stream
+  void warmQPACKTable();
   uint64_t controlStreamWriteImpl(HQControlStream* ctrlStream,
                                   uint64_t maxEgress);
   void handleSessionError(HQStreamBase* stream,
@@ -1072,6 +1256,9 @@ class HQSession
 
     void initIngress(const std::string& /* where */);
 
+    // Reports how the codec delivered DATA payloads to the session stats
+    void recordIngressBodyStats();
+
     HTTPSessionBase* getHTTPSessionBase() override {
       return &(getSession());
     }
@@ -1642,6 +1829,8 @@ class HQSession
     bool detached_{false};
     bool ingressError_{false};
     bool hasHeaders_{false};
+    // Set by HQSession::setDatagramSink
+    DatagramSink* datagramSink_{nullptr};
     enum class EOMType { CODEC, TRANSPORT };
     ConditionalGate<EOMType, 2> eomGate_;
 
@@ -1656,6 +1845,11 @@ class HQSession
     // remote entity.
     HTTPTransaction::BufferMeta bufMeta_;
 
+    // The last priority set, from the request, the response or an update
+    folly::Optional<HTTPPriority> priority_;
+    // A response too small to interleave, see setIncrementalMinResponseSize
+    bool sendWhole_{false};
+
     void armStreamByteEventCb(uint64_t streamOffset,
                               quic::QuicSocket::ByteEvent::Type type);
     void armEgressHeadersAckCb(uint64_t streamOffset);
@@ -1684,6 +1878,9 @@ class HQSession
       return numActiveDeliveryCallbacks_;
     }
 
+    // Maps priority straight to the QUIC stream priority
+    void setStreamPriority(const HTTPPriority& priority) noexcept;
+
    private:
     void updatePriority(const HTTPMessage& headers) noexcept;
 
@@ -1778,6 +1975,9 @@ class HQSession
   std::unique_ptr<HTTPCodec> createCodec(quic::StreamId id);
   bool checkNewStream(quic::StreamId id);
 
+  // Downstream, the requests until then arrived as 0-RTT data
+  bool fullHandshakeDone_{false};
+
  private:
   void sendGoaway();
 
@@ -1853,6 +2053,13 @@ class HQSession
   /** Reads in the current loop iteration */
   uint16_t readsPerLoop_{0};
   std::unordered_set<quic::StreamId> pendingProcessReadSet_;
+  bool batchedReads_{false};
+  folly::Optional<Sampling> byteEventSampling_;
+  size_t ingressBodyCopyThreshold_{0};
+  uint64_t incrementalMinResponseSize_{0};
+  std::shared_ptr<const std::vector<HPACKHeader>> qpackWarmTable_;
+  // Batched read mode: streams with data for readBatchedStreams()
+  std::unordered_set<quic::StreamId> pendingBatchedReadSet_;
   std::shared_ptr<QuicProtocolInfo> quicInfo_;
   folly::Optional<HQVersion> version_;
   std::string alpn_;
@@ -1867,11 +2074,13 @@ class HQSession
   HTTPSettings ingressSettings_;
   uint64_t minUnseenIncomingPushId_{0};
 
-  ReadyGate versionUtilsReady_;
+  // Inline room for the settings, stats and indexing strategy setters
+  ConditionalGate<detail::ReadyEnum, 1, 3> versionUtilsReady_;
 
   // NOTE: introduce better decoupling between the streams
   // and the containing session, then remove the friendship.
   friend class HQStreamBase;
+  friend class HQWebTransportSession;
 
   // To let the operator<< access DrainState which is private
   friend std::ostream& operator<<(std::ostream&, DrainState);
@@ -1896,6 +2105,15 @@ class HQSession
   folly::F14FastMap<hq::PushId, quic::StreamId> pushIdToStreamId_;
   // Lookup maps for matching ingress push streams to push ids
   folly::F14FastMap<quic::StreamId, hq::PushId> streamIdToPushId_;
+
+  // WebTransport sessions by CONNECT stream id
+  struct WebTransportSessionDestructor {
+    void operator()(HQWebTransportSession* session) const;
+  };
+  folly::F14FastMap<
+      quic::StreamId,
+      std::unique_ptr<HQWebTransportSession, WebTransportSessionDestructor>>
+      webTransportSessions_;
   std::string userAgent_;
 
   /**
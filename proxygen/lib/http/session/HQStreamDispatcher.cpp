@@ -15,6 +15,51 @@ HQStreamDispatcherBase::HQStreamDispatcherBase(
     : callback_(callback), direction_(direction) {
 }
 
+void HQStreamDispatcherBase::takeTemporaryOwnership(quic::StreamId id) {
+  auto deadline =
+      std::chrono::steady_clock::now() + callback_.getDispatchTimeout();
+  auto it = findPendingStream(id);
+  if (it != pendingStreams_.end()) {
+    it->deadline = deadline;
+  } else {
+    pendingStreams_.push_back({id, deadline});
+  }
+  scheduleDispatchTimeout();
+}
+
+void HQStreamDispatcherBase::scheduleDispatchTimeout() {
+  if (pendingStreams_.empty()) {
+    dispatchTimeout_.cancelTimeout();
+    return;
+  }
+  auto earliest = std::min_element(
+      pendingStreams_.begin(),
+      pendingStreams_.end(),
+      [](const PendingStream& a, const PendingStream& b) {
+        return a.deadline < b.deadline;
+      });
+  auto timeout = std::chrono::ceil<std::chrono::milliseconds>(
+      earliest->deadline - std::chrono::steady_clock::now());
+  callback_.getEventBase()->timer().scheduleTimeout(
+      &dispatchTimeout_, std::max(timeout, std::chrono::milliseconds(0)));
+}
+
+void HQStreamDispatcherBase::dispatchTimeoutExpired() {
+  auto now = std::chrono::steady_clock::now();
+  PendingStreams expired;
+  auto it = std::stable_partition(
+      pendingStreams_.begin(),
+      pendingStreams_.end(),
+      [now](const PendingStream& stream) { return stream.deadline > now; });
+  expired.assign(std::make_move_iterator(it),
+                 std::make_move_iterator(pendingStreams_.end()));
+  pendingStreams_.erase(it, pendingStreams_.end());
+  scheduleDispatchTimeout();
+  for (auto& stream : expired) {
+    callback_.rejectStream(stream.id);
+  }
+}
+
 void HQStreamDispatcherBase::peekError(quic::StreamId id,
                                        quic::QuicError error) noexcept {
   VLOG(4) << __func__ << ": peekError streamID=" << id << " error: " << error;
@@ -83,6 +128,21 @@ void HQStreamDispatcherBase::onDataAvailable(
   }
 }
 
+HQStreamDispatcherBase::HandleStreamResult
+HQStreamDispatcherBase::handleWebTransportStream(quic::StreamId id,
+                                                 folly::io::Cursor& cursor,
+                                                 size_t consumed) {
+  // The preface is followed by the id of the CONNECT stream of the session
+  auto sessionId = quic::decodeQuicInteger(cursor);
+  if (!sessionId) {
+    return HandleStreamResult::PENDING;
+  }
+  consumed += sessionId->second;
+  callback_.dispatchWebTransportStream(
+      releaseOwnership(id), sessionId->first, consumed);
+  return HandleStreamResult::DISPATCHED;
+}
+
 HQStreamDispatcherBase::HandleStreamResult HQUniStreamDispatcher::handleStream(
     quic::StreamId id,
     folly::io::Cursor& cursor,
@@ -124,6 +184,8 @@ HQStreamDispatcherBase::HandleStreamResult HQUniStreamDispatcher::handleStream(
         return HandleStreamResult::PENDING;
       }
     }
+    case hq::UnidirectionalStreamType::WEBTRANSPORT:
+      return handleWebTransportStream(id, cursor, consumed);
     case hq::UnidirectionalStreamType::GREASE:
       VLOG(4) << "Hey, a grease stream id=" << id;
       break;
@@ -135,9 +197,9 @@ HQStreamDispatcherBase::HandleStreamResult HQUniStreamDispatcher::handleStream(
 
 HQStreamDispatcherBase::HandleStreamResult HQBidiStreamDispatcher::handleStream(
     quic::StreamId id,
-    folly::io::Cursor& /*cursor*/,
+    folly::io::Cursor& cursor,
     uint64_t preface,
-    size_t /*consumed*/) {
+    size_t consumed) {
   auto type = callback_.parseBidiStreamPreface(preface);
 
   if (!type) {
@@ -149,6 +211,8 @@ HQStreamDispatcherBase::HandleStreamResult HQBidiStreamDispatcher::handleStream(
     case hq::BidirectionalStreamType::REQUEST:
       callback_.dispatchRequestStream(releaseOwnership(id));
       return HandleStreamResult::DISPATCHED;
+    case hq::BidirectionalStreamType::WEBTRANSPORT:
+      return handleWebTransportStream(id, cursor, consumed);
     default: {
       LOG(ERROR) << "Unrecognized type=" << static_cast<uint64_t>(type.value());
     }
@@ -8,6 +8,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+
+#include <folly/small_vector.h>
 #include <quic/api/QuicSocket.h>
 
 #include <proxygen/lib/http/codec/HQFramer.h>
@@ -33,6 +37,14 @@ class HQStreamDispatcherBase : public quic::QuicSocket::PeekCallback {
     // Called by the dispatcher when a stream can not be recognized
     virtual void rejectStream(quic::StreamId /* id */) = 0;
 
+    // Called by the dispatcher when a WebTransport stream of either
+    // direction is identified, with the session it belongs to.
+    virtual void dispatchWebTransportStream(quic::StreamId id,
+                                            quic::StreamId /* sessionId */,
+                                            size_t /* to consume */) {
+      rejectStream(id);
+    }
+
    protected:
     virtual ~CallbackBase() = default;
   }; // Callback
@@ -52,23 +64,22 @@ class HQStreamDispatcherBase : public quic::QuicSocket::PeekCallback {
   // Take the temporary ownership of the stream.
   // The ownership is released when the stream is passed
   // to the callback
-  void takeTemporaryOwnership(quic::StreamId id) {
-    auto res = pendingStreams_.emplace(std::piecewise_construct,
-                                       std::forward_as_tuple(id),
-                                       std::forward_as_tuple(*this, id));
-    callback_.getEventBase()->timer().scheduleTimeout(
-        &res.first->second, callback_.getDispatchTimeout());
-  }
+  void takeTemporaryOwnership(quic::StreamId id);
 
   bool hasOwnership(quic::StreamId id) const {
-    return pendingStreams_.count(id) > 0;
+    return findPendingStream(id) != pendingStreams_.end();
   }
 
   quic::StreamId releaseOwnership(quic::StreamId id) {
-    LOG_IF(DFATAL, !hasOwnership(id))
+    auto it = findPendingStream(id);
+    LOG_IF(DFATAL, it == pendingStreams_.end())
         << "Can not release ownership on unowned streamID=" << id;
-    bool found = pendingStreams_.erase(id);
-    LOG_IF(DFATAL, !found) << "Inconstency detected streamID=" << id;
+    if (it != pendingStreams_.end()) {
+      pendingStreams_.erase(it);
+    }
+    if (pendingStreams_.empty()) {
+      dispatchTimeout_.cancelTimeout();
+    }
     return id;
   }
 
@@ -78,40 +89,69 @@ class HQStreamDispatcherBase : public quic::QuicSocket::PeekCallback {
 
   void invokeOnPendingStreamIDs(const std::function<void(quic::StreamId)>& fn) {
     for (auto& pendingStream : pendingStreams_) {
-      fn(pendingStream.first);
+      fn(pendingStream.id);
     }
   }
 
-  void dispatchTimeoutExpired(quic::StreamId id) {
-    callback_.rejectStream(releaseOwnership(id));
-  }
+  // Rejects the streams whose dispatch timeout has passed
+  void dispatchTimeoutExpired();
 
   void cleanup() {
-    for (auto& pendingStream : pendingStreams_) {
-      callback_.rejectStream(pendingStream.first);
-    }
+    dispatchTimeout_.cancelTimeout();
+    auto pendingStreams = std::move(pendingStreams_);
     pendingStreams_.clear();
+    for (auto& pendingStream : pendingStreams) {
+      callback_.rejectStream(pendingStream.id);
+    }
   }
 
  private:
+  // A peer opens a handful of unidirectional streams per connection, so
+  // they are kept in a small vector in arrival order, sharing one timer
+  // scheduled for the earliest deadline.
+  static constexpr size_t kInlinePendingStreams = 4;
+
+  struct PendingStream {
+    quic::StreamId id;
+    std::chrono::steady_clock::time_point deadline;
+  };
+  using PendingStreams =
+      folly::small_vector<PendingStream, kInlinePendingStreams>;
+
   class DispatchTimeout : public folly::HHWheelTimer::Callback {
    public:
-    explicit DispatchTimeout(HQStreamDispatcherBase& dispatcher,
-                             quic::StreamId id)
-        : dispatcher_(dispatcher), id_(id) {
+    explicit DispatchTimeout(HQStreamDispatcherBase& dispatcher)
+        : dispatcher_(dispatcher) {
     }
 
     ~DispatchTimeout() override = default;
     void timeoutExpired() noexcept override {
-      dispatcher_.dispatchTimeoutExpired(id_);
+      dispatcher_.dispatchTimeoutExpired();
     }
 
    private:
     HQStreamDispatcherBase& dispatcher_;
-    quic::StreamId id_;
   };
 
-  std::unordered_map<quic::StreamId, DispatchTimeout> pendingStreams_;
+  PendingStreams::const_iterator findPendingStream(quic::StreamId id) const {
+    return std::find_if(
+        pendingStreams_.begin(),
+        pendingStreams_.end(),
+        [id](const PendingStream& stream) { return stream.id == id; });
+  }
+
+  PendingStreams::iterator findPendingStream(quic::StreamId id) {
+    return std::find_if(
+        pendingStreams_.begin(),
+        pendingStreams_.end(),
+        [id](const PendingStream& stream) { return stream.id == id; });
+  }
+
+  // (Re)arms dispatchTimeout_ for the earliest pending deadline
+  void scheduleDispatchTimeout();
+
+  PendingStreams pendingStreams_;
+  DispatchTimeout dispatchTimeout_{*this};
 
  protected:
   enum class HandleStreamResult { DISPATCHED, REJECT, PENDING };
@@ -120,6 +160,11 @@ class HQStreamDispatcherBase : public quic::QuicSocket::PeekCallback {
                                           uint64_t preface,
                                           size_t consumed) = 0;
 
+  // Reads the session id after a WebTransport stream preface
+  HandleStreamResult handleWebTransportStream(quic::StreamId id,
+                                              folly::io::Cursor& cursor,
+                                              size_t consumed);
+
   CallbackBase& callback_;
   proxygen::TransportDirection direction_;
 };
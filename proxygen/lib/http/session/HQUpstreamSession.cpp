@@ -134,6 +134,7 @@ void HQUpstreamSession::attachThreadLocals(folly::EventBase* eventBase,
   }
   codec_.foreach (fn);
   setHeaderCodecStats(headerCodecStats);
+  eventBatch_.attachEventBase(eventBase);
   sock_->getEventBase()->runInLoop(this);
   // The caller MUST re-add the connection to a new connection manager.
 }
@@ -151,6 +152,7 @@ void HQUpstreamSession::detachThreadLocals(bool) {
   }
 
   txnEgressQueue_.detachThreadLocals();
+  eventBatch_.detachEventBase();
   setController(nullptr);
   setSessionStats(nullptr);
   // The codec filters *shouldn't* be accessible while the socket is detached,
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/HQWebTransportSession.h>
+
+#include <quic/codec/QuicInteger.h>
+
+namespace proxygen {
+
+HQWebTransportSession::HQWebTransportSession(HQSession& session,
+                                             quic::StreamId sessionId,
+                                             Handler* handler)
+    : session_(&session), sessionId_(sessionId), handler_(handler) {
+  CHECK(handler_);
+  session_->setDatagramSink(sessionId_, this);
+}
+
+quic::QuicSocket* HQWebTransportSession::getSocket() const {
+  return session_ ? session_->sock_.get() : nullptr;
+}
+
+HQWebTransportSession::Stream* HQWebTransportSession::findStream(
+    quic::StreamId id) {
+  auto it = streams_.find(id);
+  return it == streams_.end() ? nullptr : &it->second;
+}
+
+HQWebTransportSession::StreamResult HQWebTransportSession::createStream(
+    bool bidi) {
+  auto sock = getSocket();
+  if (!sock) {
+    return folly::makeUnexpected(quic::LocalErrorCode::CONNECTION_CLOSED);
+  }
+  auto id = bidi ? sock->createBidirectionalStream()
+                 : sock->createUnidirectionalStream();
+  if (id.hasError()) {
+    VLOG(3) << "Failed to create WebTransport stream sess=" << *session_
+            << " err=" << id.error();
+    return folly::makeUnexpected(id.error());
+  }
+  uint64_t type =
+      bidi ? folly::to_underlying(hq::BidirectionalStreamType::WEBTRANSPORT)
+           : folly::to_underlying(hq::UnidirectionalStreamType::WEBTRANSPORT);
+  auto preface = folly::IOBuf::create(2 * sizeof(uint64_t));
+  quic::BufAppender appender(preface.get(), 2 * sizeof(uint64_t));
+  auto appendInt = [&](auto val) { appender.writeBE(val); };
+  quic::encodeQuicInteger(type, appendInt);
+  quic::encodeQuicInteger(sessionId_, appendInt);
+  auto writeRes =
+      sock->writeChain(id.value(), std::move(preface), false, nullptr);
+  if (writeRes.hasError()) {
+    sock->resetStream(id.value(), HTTP3::ErrorCode::HTTP_INTERNAL_ERROR);
+    return folly::makeUnexpected(writeRes.error());
+  }
+  streams_.emplace(id.value(), Stream{bidi, false, bidi, true});
+  if (bidi) {
+    sock->setReadCallback(id.value(), this);
+  }
+  VLOG(4) << "Created WebTransport streamID=" << id.value()
+          << " sessionID=" << sessionId_;
+  return id.value();
+}
+
+HQWebTransportSession::WriteResult HQWebTransportSession::writeStream(
+    quic::StreamId id, std::unique_ptr<folly::IOBuf> data, bool eof) {
+  auto sock = getSocket();
+  auto stream = findStream(id);
+  if (!sock || !stream || !stream->egressOpen) {
+    return folly::makeUnexpected(quic::LocalErrorCode::STREAM_NOT_EXISTS);
+  }
+  auto writeRes = sock->writeChain(id, std::move(data), eof, nullptr);
+  if (writeRes.hasError()) {
+    return folly::makeUnexpected(writeRes.error());
+  }
+  if (eof) {
+    endEgress(id, *stream);
+  }
+  return folly::unit;
+}
+
+void HQWebTransportSession::resetStream(quic::StreamId id,
+                                        uint32_t errorCode) {
+  auto sock = getSocket();
+  auto stream = findStream(id);
+  if (!sock || !stream || !stream->egressOpen) {
+    return;
+  }
+  sock->resetStream(id, toHttp3ErrorCode(errorCode));
+  endEgress(id, *stream);
+}
+
+void HQWebTransportSession::stopSending(quic::StreamId id,
+                                        uint32_t errorCode) {
+  auto sock = getSocket();
+  auto stream = findStream(id);
+  if (!sock || !stream || !stream->ingressOpen) {
+    return;
+  }
+  sock->stopSending(id, toHttp3ErrorCode(errorCode));
+  sock->setReadCallback(id, nullptr, folly::none);
+  endIngress(id, *stream);
+}
+
+bool HQWebTransportSession::sendDatagram(
+    std::unique_ptr<folly::IOBuf> payload) {
+  if (!session_) {
+    return false;
+  }
+  std::vector<std::unique_ptr<folly::IOBuf>> datagrams;
+  datagrams.emplace_back(std::move(payload));
+  return session_->sendDatagrams(sessionId_, std::move(datagrams)) == 1;
+}
+
+void HQWebTransportSession::close() {
+  if (session_) {
+    // Destroys this after the call
+    session_->endWebTransportSession(sessionId_, false);
+  }
+}
+
+void HQWebTransportSession::onIncomingStream(quic::StreamId id) {
+  auto sock = getSocket();
+  CHECK(sock);
+  bool bidi = sock->isBidirectionalStream(id);
+  if (numIncomingStreams_[bidi] >= maxIncomingStreams_) {
+    VLOG(3) << "Rejecting WebTransport streamID=" << id
+            << " over the limit of sessionID=" << sessionId_;
+    sock->stopSending(id, kBufferedStreamRejected);
+    if (bidi) {
+      sock->resetStream(id, kBufferedStreamRejected);
+    }
+    return;
+  }
+  streams_.emplace(id, Stream{bidi, true, true, bidi});
+  numIncomingStreams_[bidi]++;
+  sock->setReadCallback(id, this);
+  DestructorGuard dg(this);
+  handler_->onNewStream(id, bidi);
+  // The transport notifies of data arriving from now on only
+  if (findStream(id)) {
+    readAvailable(id);
+  }
+}
+
+void HQWebTransportSession::onStopSending(quic::StreamId id,
+                                          quic::ApplicationErrorCode error) {
+  auto sock = getSocket();
+  auto stream = findStream(id);
+  if (!sock || !stream || !stream->egressOpen) {
+    return;
+  }
+  sock->resetStream(id, error);
+  endEgress(id, *stream);
+  handler_->onStopSending(id, error);
+}
+
+void HQWebTransportSession::readAvailable(quic::StreamId id) noexcept {
+  auto sock = getSocket();
+  auto stream = findStream(id);
+  if (!sock || !stream || !stream->ingressOpen) {
+    return;
+  }
+  auto readRes = sock->read(id, 0);
+  if (readRes.hasError()) {
+    readError(id, quic::QuicError(readRes.error(), "sync read error"));
+    return;
+  }
+  auto& data = readRes.value().first;
+  auto eof = readRes.value().second;
+  if ((!data || data->empty()) && !eof) {
+    return;
+  }
+  if (eof) {
+    endIngress(id, *stream);
+  }
+  handler_->onStreamData(id, std::move(data), eof);
+}
+
+void HQWebTransportSession::readError(quic::StreamId id,
+                                      quic::QuicError error) noexcept {
+  VLOG(4) << "WebTransport readError streamID=" << id << " error=" << error;
+  auto stream = findStream(id);
+  if (!stream || !stream->ingressOpen) {
+    return;
+  }
+  if (auto sock = getSocket()) {
+    sock->setReadCallback(id, nullptr, folly::none);
+  }
+  endIngress(id, *stream);
+  handler_->onStreamError(id, std::move(error));
+}
+
+void HQWebTransportSession::onDatagram(
+    quic::StreamId /* streamId */,
+    std::unique_ptr<folly::IOBuf> payload) noexcept {
+  handler_->onDatagram(std::move(payload));
+}
+
+void HQWebTransportSession::endIngress(quic::StreamId id, Stream& stream) {
+  stream.ingressOpen = false;
+  maybeEraseStream(id, stream);
+}
+
+void HQWebTransportSession::endEgress(quic::StreamId id, Stream& stream) {
+  stream.egressOpen = false;
+  maybeEraseStream(id, stream);
+}
+
+void HQWebTransportSession::maybeEraseStream(quic::StreamId id,
+                                             const Stream& stream) {
+  if (stream.ingressOpen || stream.egressOpen) {
+    return;
+  }
+  if (stream.incoming) {
+    DCHECK_GT(numIncomingStreams_[stream.bidi], 0);
+    numIncomingStreams_[stream.bidi]--;
+  }
+  streams_.erase(id);
+}
+
+void HQWebTransportSession::end(bool notify) {
+  if (!session_) {
+    return;
+  }
+  DestructorGuard dg(this);
+  if (auto sock = getSocket()) {
+    for (auto& [id, stream] : streams_) {
+      if (stream.ingressOpen) {
+        sock->stopSending(id, kSessionGone);
+        sock->setReadCallback(id, nullptr, folly::none);
+      }
+      if (stream.egressOpen) {
+        sock->resetStream(id, kSessionGone);
+      }
+    }
+  }
+  streams_.clear();
+  numIncomingStreams_[0] = numIncomingStreams_[1] = 0;
+  session_->setDatagramSink(sessionId_, nullptr);
+  session_ = nullptr;
+  if (notify) {
+    handler_->onSessionEnd();
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <folly/io/async/DelayedDestruction.h>
+#include <proxygen/lib/http/session/HQSession.h>
+
+namespace proxygen {
+
+/**
+ * A WebTransport session on the extended CONNECT stream of an HQSession, see
+ * HQSession::startWebTransport.
+ *
+ * The session's streams are QUIC streams of the connection, prefaced with the
+ * stream type and the session id, and its datagrams are the H3 datagrams of
+ * the CONNECT stream.  Ingress data is handed to the handler as read from the
+ * transport, and egress data is written to it as given.
+ *
+ * The peer may have maxIncomingStreams() streams of each direction open on
+ * the session, those beyond are rejected.  A stream is open until both its
+ * ingress and its egress end, by FIN, reset or STOP_SENDING.
+ */
+class HQWebTransportSession
+    : public folly::DelayedDestruction
+    , private quic::QuicSocket::ReadCallback
+    , private HQSession::DatagramSink {
+ public:
+  using Handler = HQSession::WebTransportHandler;
+  using StreamResult = folly::Expected<quic::StreamId, quic::LocalErrorCode>;
+  using WriteResult = folly::Expected<folly::Unit, quic::LocalErrorCode>;
+
+  // Application error codes, mapped into the HTTP/3 space on the wire
+  static constexpr uint64_t kFirstErrorCode = 0x52e4a40fa8db;
+  static constexpr uint64_t kBufferedStreamRejected = 0x3994bd84;
+  static constexpr uint64_t kSessionGone = 0x170d7b68;
+  static quic::ApplicationErrorCode toHttp3ErrorCode(uint32_t errorCode) {
+    return kFirstErrorCode + errorCode + errorCode / 0x1e;
+  }
+
+  static constexpr uint32_t kDefaultMaxIncomingStreams = 100;
+
+  HQWebTransportSession(HQSession& session,
+                        quic::StreamId sessionId,
+                        Handler* handler);
+
+  quic::StreamId getSessionId() const {
+    return sessionId_;
+  }
+
+  // False once the session ended
+  bool good() const {
+    return session_ != nullptr;
+  }
+
+  // Opens a stream and writes its preface
+  StreamResult createStream(bool bidi);
+
+  WriteResult writeStream(quic::StreamId id,
+                          std::unique_ptr<folly::IOBuf> data,
+                          bool eof);
+
+  // Ends the egress of id
+  void resetStream(quic::StreamId id, uint32_t errorCode);
+
+  // Ends the ingress of id
+  void stopSending(quic::StreamId id, uint32_t errorCode);
+
+  // The H3 header is written into payload's headroom when possible
+  bool sendDatagram(std::unique_ptr<folly::IOBuf> payload);
+
+  // Per direction, for the streams opened by the peer from now on
+  void setMaxIncomingStreams(uint32_t maxStreams) {
+    maxIncomingStreams_ = maxStreams;
+  }
+
+  uint32_t maxIncomingStreams() const {
+    return maxIncomingStreams_;
+  }
+
+  uint32_t numIncomingStreams(bool bidi) const {
+    return numIncomingStreams_[bidi];
+  }
+
+  size_t numStreams() const {
+    return streams_.size();
+  }
+
+  /**
+   * Resets the open streams and ends the session without calling the
+   * handler.  The CONNECT transaction is left to the caller, e.g. to send
+   * EOM on it.
+   */
+  void close();
+
+ private:
+  friend class HQSession;
+
+  struct Stream {
+    bool bidi;
+    bool incoming;
+    bool ingressOpen;
+    bool egressOpen;
+  };
+
+  ~HQWebTransportSession() override = default;
+
+  // From HQSession
+  void onIncomingStream(quic::StreamId id);
+  void onStopSending(quic::StreamId id, quic::ApplicationErrorCode error);
+  void end(bool notify);
+
+  // quic::QuicSocket::ReadCallback
+  void readAvailable(quic::StreamId id) noexcept override;
+  void readError(quic::StreamId id, quic::QuicError error) noexcept override;
+
+  // HQSession::DatagramSink
+  void onDatagram(quic::StreamId streamId,
+                  std::unique_ptr<folly::IOBuf> payload) noexcept override;
+
+  quic::QuicSocket* getSocket() const;
+  Stream* findStream(quic::StreamId id);
+  void endIngress(quic::StreamId id, Stream& stream);
+  void endEgress(quic::StreamId id, Stream& stream);
+  void maybeEraseStream(quic::StreamId id, const Stream& stream);
+
+  HQSession* session_;
+  const quic::StreamId sessionId_;
+  Handler* handler_;
+  uint32_t maxIncomingStreams_{kDefaultMaxIncomingStreams};
+  // By bidi
+  uint32_t numIncomingStreams_[2]{0, 0};
+  folly::F14FastMap<quic::StreamId, Stream> streams_;
+};
+
+} // namespace proxygen
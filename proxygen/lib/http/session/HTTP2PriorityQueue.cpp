@@ -8,9 +8,6 @@
 
 #include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
 
-using std::list;
-using std::unique_ptr;
-
 namespace proxygen {
 
 HTTP2PriorityQueue::Node* HTTP2PriorityQueue::nodeFromBaseNode(
@@ -42,6 +39,11 @@ HTTP2PriorityQueue::Node::Node(HTTP2PriorityQueue& queue,
 }
 
 HTTP2PriorityQueue::Node::~Node() {
+  while (!children_.empty()) {
+    auto& child = children_.front();
+    children_.pop_front();
+    queue_.releaseNode(&child);
+  }
   if (!txn_) {
     queue_.numVirtualNodes_--;
   }
@@ -50,13 +52,13 @@ HTTP2PriorityQueue::Node::~Node() {
 
 // Add a new node as a child of this node
 HTTP2PriorityQueue::Node* HTTP2PriorityQueue::Node::emplaceNode(
-    unique_ptr<HTTP2PriorityQueue::Node> node, bool exclusive) {
+    HTTP2PriorityQueue::Node* node, bool exclusive) {
   CHECK(!node->isEnqueued());
-  list<unique_ptr<Node>> children;
+  NodeList children;
   CHECK_NE(id_, node->id_) << "Tried to create a loop in the tree";
   if (exclusive) {
     // this->children become new node's children
-    std::swap(children, children_);
+    children.swap(children_);
     totalChildWeight_ = 0;
     bool wasInEgressTree = inEgressTree();
     totalEnqueuedWeight_ = 0;
@@ -67,26 +69,26 @@ HTTP2PriorityQueue::Node* HTTP2PriorityQueue::Node::emplaceNode(
       propagatePendingEgressClear(this);
     }
   }
-  auto res = addChild(std::move(node));
-  res->addChildren(std::move(children));
+  auto res = addChild(node);
+  res->addChildren(children);
   return res;
 }
 
-void HTTP2PriorityQueue::Node::addChildren(list<unique_ptr<Node>>&& children) {
-  list<unique_ptr<Node>> emptyChilden;
+void HTTP2PriorityQueue::Node::addChildren(NodeList& children) {
   uint64_t totalEnqueuedWeight = 0;
-  for (auto& child : children) {
+  while (!children.empty()) {
+    auto child = &children.front();
+    children.pop_front();
     if (child->inEgressTree()) {
       totalEnqueuedWeight += child->weight_;
-      child->parent_->removeEnqueuedChild(child.get());
+      child->parent_->removeEnqueuedChild(child);
       CHECK(!child->enqueuedHook_.is_linked());
-      addEnqueuedChild(child.get());
+      addEnqueuedChild(child);
     } else {
       CHECK(!child->enqueuedHook_.is_linked());
     }
-    addChild(std::move(child));
+    addChild(child);
   }
-  std::swap(children, emptyChilden);
   if (totalEnqueuedWeight > 0) {
     if (!inEgressTree()) {
       propagatePendingEgressSignal(this);
@@ -96,28 +98,25 @@ void HTTP2PriorityQueue::Node::addChildren(list<unique_ptr<Node>>&& children) {
 }
 
 HTTP2PriorityQueue::Node* HTTP2PriorityQueue::Node::addChild(
-    unique_ptr<HTTP2PriorityQueue::Node> child) {
+    HTTP2PriorityQueue::Node* child) {
   CHECK_NE(id_, child->id_) << "Tried to create a loop in the tree";
+  CHECK(!child->childHook_.is_linked());
   child->parent_ = this;
   totalChildWeight_ += child->weight_;
-  Node* raw = child.get();
-  raw->self_ = children_.insert(children_.end(), std::move(child));
+  children_.push_back(*child);
   cancelTimeout();
-  return raw;
+  return child;
 }
 
-unique_ptr<HTTP2PriorityQueue::Node> HTTP2PriorityQueue::Node::detachChild(
-    Node* node) {
+HTTP2PriorityQueue::Node* HTTP2PriorityQueue::Node::detachChild(Node* node) {
   CHECK(!node->isEnqueued());
   totalChildWeight_ -= node->weight_;
-  auto it = node->self_;
-  auto res = std::move(*node->self_);
-  children_.erase(it);
+  children_.erase(children_.iterator_to(*node));
   node->parent_ = nullptr;
   if (children_.empty() && !txn_ && !isPermanent_) {
     queue_.scheduleNodeExpiration(this);
   }
-  return res;
+  return node;
 }
 
 HTTP2PriorityQueue::Node* HTTP2PriorityQueue::Node::reparent(
@@ -134,7 +133,7 @@ HTTP2PriorityQueue::Node* HTTP2PriorityQueue::Node::reparent(
   }
 
   auto self = parent_->detachChild(this);
-  (void)newParent->emplaceNode(std::move(self), exclusive);
+  (void)newParent->emplaceNode(self, exclusive);
 
   // Restore state
   enqueued_ = enqueued;
@@ -235,9 +234,9 @@ void HTTP2PriorityQueue::Node::removeFromTree() {
     // update child weights so they sum to (approximately) this node's weight.
     double r = double(weight_) / totalChildWeight_;
     for (auto& child : children_) {
-      uint64_t newWeight = std::max(uint64_t(child->weight_ * r), uint64_t(1));
+      uint64_t newWeight = std::max(uint64_t(child.weight_ * r), uint64_t(1));
       CHECK_LE(newWeight, 256);
-      child->updateWeight(uint8_t(newWeight) - 1);
+      child.updateWeight(uint8_t(newWeight) - 1);
     }
   }
 
@@ -253,8 +252,9 @@ void HTTP2PriorityQueue::Node::removeFromTree() {
   }
 
   // move my children to my parent
-  parent_->addChildren(std::move(children_));
-  (void)parent_->detachChild(this);
+  parent_->addChildren(children_);
+  // releasing the node destroys this, it must come last
+  queue_.releaseNode(parent_->detachChild(this));
 }
 
 bool HTTP2PriorityQueue::Node::iterate(
@@ -276,7 +276,7 @@ bool HTTP2PriorityQueue::Node::iterate(
     if (stop || stopFn()) {
       return true;
     }
-    stop = child->iterate(fn, stopFn, all);
+    stop = child.iterate(fn, stopFn, all);
   }
   return stop;
 }
@@ -308,7 +308,7 @@ bool HTTP2PriorityQueue::Node::visitBFS(
       }
     } else {
       for (auto& child : children_) {
-        pendingNodes.emplace_back(child->id_, child.get(), newRelWeight);
+        pendingNodes.emplace_back(child.id_, &child, newRelWeight);
       }
     }
   }
@@ -326,7 +326,7 @@ bool HTTP2PriorityQueue::Node::visitBFS(
 void HTTP2PriorityQueue::Node::updateEnqueuedWeight(bool activeNodes) {
   totalEnqueuedWeightCheck_ = totalChildWeight_;
   for (auto& child : children_) {
-    child->updateEnqueuedWeight(activeNodes);
+    child.updateEnqueuedWeight(activeNodes);
   }
   if (activeNodes) {
     if (totalEnqueuedWeightCheck_ == 0 && !isEnqueued()) {
@@ -344,7 +344,7 @@ void HTTP2PriorityQueue::Node::updateEnqueuedWeight(bool activeNodes) {
 void HTTP2PriorityQueue::Node::dropPriorityNodes() {
   for (auto it = children_.begin(); it != children_.end();) {
     auto& child = *it++;
-    child->dropPriorityNodes();
+    child.dropPriorityNodes();
   }
   if (!txn_ && !isPermanent_) {
     removeFromTree();
@@ -373,13 +373,15 @@ uint64_t HTTP2PriorityQueue::Node::calculateDepth(bool includeVirtual) const {
 }
 
 void HTTP2PriorityQueue::Node::flattenSubtree() {
-  std::list<std::unique_ptr<Node>> oldChildren_;
+  NodeList oldChildren_;
   // Move the old children to a temporary list
-  std::swap(oldChildren_, children_);
+  oldChildren_.swap(children_);
   // Reparent the children
-  for (auto& child : oldChildren_) {
+  while (!oldChildren_.empty()) {
+    auto child = &oldChildren_.front();
+    oldChildren_.pop_front();
     child->flattenSubtreeDFS(this);
-    addChildToNewSubtreeRoot(std::move(child), this);
+    addChildToNewSubtreeRoot(child, this);
   }
   // Update the weights
   totalEnqueuedWeight_ = 0;
@@ -389,27 +391,29 @@ void HTTP2PriorityQueue::Node::flattenSubtree() {
   totalChildWeight_ = 0;
   std::for_each(children_.begin(),
                 children_.end(),
-                [this](const std::unique_ptr<Node>& child) {
-                  totalChildWeight_ += child->weight_;
-                  if (child->enqueued_) {
-                    totalEnqueuedWeight_ += child->weight_;
+                [this](const Node& child) {
+                  totalChildWeight_ += child.weight_;
+                  if (child.enqueued_) {
+                    totalEnqueuedWeight_ += child.weight_;
 #ifndef NDEBUG
-                    totalEnqueuedWeightCheck_ += child->weight_;
+                    totalEnqueuedWeightCheck_ += child.weight_;
 #endif
                   }
                 });
 }
 
 void HTTP2PriorityQueue::Node::flattenSubtreeDFS(Node* subtreeRoot) {
-  for (auto& child : children_) {
+  while (!children_.empty()) {
+    auto child = &children_.front();
+    children_.pop_front();
     child->flattenSubtreeDFS(subtreeRoot);
-    addChildToNewSubtreeRoot(std::move(child), subtreeRoot);
+    addChildToNewSubtreeRoot(child, subtreeRoot);
   }
 }
 
-void HTTP2PriorityQueue::Node::addChildToNewSubtreeRoot(
-    std::unique_ptr<Node> child, Node* subtreeRoot) {
-  child->children_.clear();
+void HTTP2PriorityQueue::Node::addChildToNewSubtreeRoot(Node* child,
+                                                        Node* subtreeRoot) {
+  DCHECK(child->children_.empty());
   child->parent_ = subtreeRoot;
   child->weight_ = kDefaultWeight;
   child->totalChildWeight_ = 0;
@@ -417,9 +421,7 @@ void HTTP2PriorityQueue::Node::addChildToNewSubtreeRoot(
 #ifndef NDEBUG
   child->totalEnqueuedWeightCheck_ = 0;
 #endif
-  Node* raw = child.get();
-  raw->self_ = subtreeRoot->children_.insert(subtreeRoot->children_.end(),
-                                             std::move(child));
+  subtreeRoot->children_.push_back(*child);
 }
 
 /// class HTTP2PriorityQueue
@@ -511,13 +513,13 @@ HTTP2PriorityQueue::Handle HTTP2PriorityQueue::addTransaction(
   }
   VLOG(4) << "Adding id=" << id << " with parent=" << parent->getID()
           << " and weight=" << ((uint16_t)pri.weight + 1);
-  auto node = std::make_unique<Node>(*this, parent, id, pri.weight, txn);
+  auto node = allocateNode(parent, id, pri.weight, txn);
   if (permanent) {
     node->setPermanent();
   } else if (!txn) {
-    scheduleNodeExpiration(node.get());
+    scheduleNodeExpiration(node);
   }
-  auto result = parent->emplaceNode(std::move(node), pri.exclusive);
+  auto result = parent->emplaceNode(node, pri.exclusive);
   pendingWeightChange_ = true;
   return result;
 }
@@ -714,6 +716,43 @@ void HTTP2PriorityQueue::updateEnqueuedWeight() {
 #endif
 }
 
+HTTP2PriorityQueue::Node* HTTP2PriorityQueue::allocateNode(
+    Node* parent,
+    HTTPCodec::StreamID id,
+    uint8_t weight,
+    HTTPTransaction* txn) {
+  if (!freeNodes_) {
+    auto slab = std::make_unique<NodeStorage[]>(kNodesPerSlab);
+    for (size_t i = 0; i < kNodesPerSlab; i++) {
+      slab[i].nextFree = freeNodes_;
+      freeNodes_ = &slab[i];
+    }
+    nodeSlabs_.push_back(std::move(slab));
+  }
+  auto storage = freeNodes_;
+  freeNodes_ = storage->nextFree;
+  return new (storage->node) Node(*this, parent, id, weight, txn);
+}
+
+void HTTP2PriorityQueue::releaseIdleMemory() {
+  if (nodes_.size() > 1) {
+    return;
+  }
+  nodeSlabs_.clear();
+  freeNodes_ = nullptr;
+  // Erasing doesn't shrink the map
+  NodeMap().swap(nodes_);
+  nodes_.emplace(root_.getID(), &root_);
+}
+
+void HTTP2PriorityQueue::releaseNode(Node* node) {
+  DCHECK(node != &root_);
+  node->~Node();
+  auto storage = reinterpret_cast<NodeStorage*>(node);
+  storage->nextFree = freeNodes_;
+  freeNodes_ = storage;
+}
+
 // Internal error handling
 
 void HTTP2PriorityQueue::rebuildTree() {
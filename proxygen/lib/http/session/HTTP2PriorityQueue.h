@@ -9,6 +9,7 @@
 #pragma once
 
 #include <folly/IntrusiveList.h>
+#include <folly/container/F14Map.h>
 #include <folly/io/async/HHWheelTimer.h>
 #include <proxygen/lib/http/codec/HTTP2Framer.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
@@ -163,6 +164,14 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
 
   void nextEgress(NextEgressResult& result, bool spdyMode = false);
 
+  // Frees the node pool once the tree is down to the root
+  void releaseIdleMemory();
+
+  // Bytes held by the node pool
+  size_t getPoolSize() const {
+    return nodeSlabs_.size() * kNodesPerSlab * sizeof(NodeStorage);
+  }
+
   static void setNodeLifetime(std::chrono::milliseconds lifetime) {
     kNodeLifetime_ = lifetime;
   }
@@ -255,7 +264,7 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
     }
 
     // Add a new node as a child of this node
-    Node* emplaceNode(std::unique_ptr<Node> node, bool exclusive);
+    Node* emplaceNode(Node* node, bool exclusive);
 
     // Removes the node from the tree
     void removeFromTree();
@@ -355,15 +364,19 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
     // Internal error recovery
     void flattenSubtree();
     void flattenSubtreeDFS(Node* subtreeRoot);
-    static void addChildToNewSubtreeRoot(std::unique_ptr<Node> child,
-                                         Node* subtreeRoot);
+    static void addChildToNewSubtreeRoot(Node* child, Node* subtreeRoot);
 
    private:
-    Node* addChild(std::unique_ptr<Node> child);
+    // Linked into the parent's children_, which doesn't own the node
+    folly::IntrusiveListHook childHook_;
+    using NodeList = folly::IntrusiveList<Node, &Node::childHook_>;
 
-    void addChildren(std::list<std::unique_ptr<Node>>&& children);
+    Node* addChild(Node* child);
 
-    std::unique_ptr<Node> detachChild(Node* node);
+    // Moves every node in children to this node, leaving children empty
+    void addChildren(NodeList& children);
+
+    Node* detachChild(Node* node);
 
     void addEnqueuedChild(HTTP2PriorityQueue::Node* node);
 
@@ -398,8 +411,7 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
 #endif
     uint64_t totalEnqueuedWeight_{0};
     uint64_t totalChildWeight_{0};
-    std::list<std::unique_ptr<Node>> children_;
-    std::list<std::unique_ptr<Node>>::iterator self_;
+    NodeList children_;
     // enqueuedChildren_ includes all children that are themselves enqueued_
     // or have enqueued descendants. Therefore, enqueuedChildren_ may contain
     // direct children that have enqueued_ == false
@@ -407,8 +419,33 @@ class HTTP2PriorityQueue : public HTTP2PriorityQueueBase {
     folly::IntrusiveList<Node, &Node::enqueuedHook_> enqueuedChildren_;
   };
 
-  using NodeMap = std::unordered_map<HTTPCodec::StreamID, Node*>;
+  // Non-root nodes live in fixed size slabs owned by the queue.  Released
+  // nodes go on a free list and are reused, so opening and closing streams
+  // doesn't allocate once the pool has grown to the working set.
+  union NodeStorage {
+    NodeStorage() {
+    }
+    ~NodeStorage() {
+    }
+    NodeStorage* nextFree;
+    alignas(Node) unsigned char node[sizeof(Node)];
+  };
+
+  static constexpr size_t kNodesPerSlab = 32;
+
+  Node* allocateNode(Node* parent,
+                     HTTPCodec::StreamID id,
+                     uint8_t weight,
+                     HTTPTransaction* txn);
+
+  void releaseNode(Node* node);
+
+  using NodeMap = folly::F14FastMap<HTTPCodec::StreamID, Node*>;
 
+  // The pool and map are declared before root_ so that they outlive it, root_
+  // releases the rest of the tree when it is destroyed
+  std::vector<std::unique_ptr<NodeStorage[]>> nodeSlabs_;
+  NodeStorage* freeNodes_{nullptr};
   NodeMap nodes_;
   Node root_;
   uint32_t rebuildCount_{0};
@@ -12,6 +12,8 @@
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/codec/HTTP2Constants.h>
 
+#include <typeinfo>
+
 namespace proxygen {
 
 HTTPDefaultSessionCodecFactory::HTTPDefaultSessionCodecFactory(
@@ -23,6 +25,14 @@ HTTPDefaultSessionCodecFactory::HTTPDefaultSessionCodecFactory(
   }
 }
 
+std::unique_ptr<HTTPCodecFactory> HTTPDefaultSessionCodecFactory::clone()
+    const {
+  if (typeid(*this) != typeid(HTTPDefaultSessionCodecFactory)) {
+    return nullptr;
+  }
+  return std::make_unique<HTTPDefaultSessionCodecFactory>(*this);
+}
+
 std::unique_ptr<HTTPCodec> HTTPDefaultSessionCodecFactory::getCodec(
     const std::string& nextProtocol, TransportDirection direction, bool isTLS) {
   if (!isTLS && alwaysUseHTTP2_) {
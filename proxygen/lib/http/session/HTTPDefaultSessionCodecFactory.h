@@ -27,6 +27,9 @@ class HTTPDefaultSessionCodecFactory : public HTTPCodecFactory {
                                       TransportDirection direction,
                                       bool isTLS) override;
 
+  // nullptr for subclasses, which must clone themselves
+  std::unique_ptr<HTTPCodecFactory> clone() const override;
+
  protected:
   const AcceptorConfiguration& accConfig_;
   folly::Optional<bool> alwaysUseHTTP2_{};
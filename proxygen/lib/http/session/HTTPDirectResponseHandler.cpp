@@ -30,6 +30,17 @@ HTTPDirectResponseHandler::HTTPDirectResponseHandler(
       forceConnectionClose_(true) {
 }
 
+HTTPDirectResponseHandler::HTTPDirectResponseHandler(
+    std::shared_ptr<const CannedResponse> response)
+    : txn_(nullptr),
+      errorPage_(nullptr),
+      cannedResponse_(std::move(response)),
+      statusCode_(cannedResponse_->getMessage().getStatusCode()),
+      headersSent_(false),
+      eomSent_(false),
+      forceConnectionClose_(false) {
+}
+
 HTTPDirectResponseHandler::~HTTPDirectResponseHandler() {
 }
 
@@ -45,6 +56,10 @@ void HTTPDirectResponseHandler::onHeadersComplete(
     std::unique_ptr<HTTPMessage> /*msg*/) noexcept {
   VLOG(4) << "processing request";
   headersSent_ = true;
+  if (cannedResponse_) {
+    cannedResponse_->send(*txn_, /*eom=*/false);
+    return;
+  }
   HTTPMessage response;
   std::unique_ptr<folly::IOBuf> responseBody;
   response.setHTTPVersion(1, 1);
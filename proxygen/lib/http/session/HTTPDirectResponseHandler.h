@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <proxygen/lib/http/session/CannedResponse.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 
 namespace proxygen {
@@ -20,6 +21,10 @@ class HTTPDirectResponseHandler : public HTTPTransaction::Handler {
                             const std::string& statusMsg,
                             const HTTPErrorPage* errorPage = nullptr);
 
+  // Sends the response as is, forceConnectionClose() not applying to it
+  explicit HTTPDirectResponseHandler(
+      std::shared_ptr<const CannedResponse> response);
+
   void forceConnectionClose(bool close) {
     forceConnectionClose_ = close;
   }
@@ -43,6 +48,7 @@ class HTTPDirectResponseHandler : public HTTPTransaction::Handler {
 
   HTTPTransaction* txn_;
   const HTTPErrorPage* errorPage_;
+  std::shared_ptr<const CannedResponse> cannedResponse_;
   std::string statusMessage_;
   unsigned statusCode_;
   bool headersSent_ : 1;
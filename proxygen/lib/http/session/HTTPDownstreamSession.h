@@ -9,12 +9,15 @@
 #pragma once
 
 #include <proxygen/lib/http/session/HTTPSession.h>
+#include <proxygen/lib/utils/PooledObject.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
 
 namespace proxygen {
 
 class HTTPSessionStats;
-class HTTPDownstreamSession final : public HTTPSession {
+class HTTPDownstreamSession final
+    : public HTTPSession
+    , public PooledObject<HTTPDownstreamSession> {
  public:
   /**
    * @param sock       An open socket on which any applicable TLS handshaking
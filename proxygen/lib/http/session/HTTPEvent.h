@@ -115,6 +115,16 @@ class HTTPEvent {
     return std::move(body_);
   }
 
+  // Whether more body can be appended, i.e. the body is not taken yet
+  bool canAppendBody() const {
+    return event_ == Type::BODY && body_;
+  }
+
+  void appendBody(std::unique_ptr<folly::IOBuf> body) {
+    CHECK(canAppendBody());
+    body_->prependChain(std::move(body));
+  }
+
   std::unique_ptr<HTTPException> getError() {
     return std::move(error_);
   }
@@ -8,19 +8,30 @@
 
 #include <proxygen/lib/http/session/HTTPSession.h>
 
+#include <algorithm>
 #include <chrono>
+#include <limits>
 #include <fizz/protocol/AsyncFizzBase.h>
 #include <folly/Conv.h>
 #include <folly/CppAttributes.h>
 #include <folly/Random.h>
+#include <folly/String.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/async/AsyncSSLSocket.h>
+#include <folly/portability/Sockets.h>
 #include <folly/tracing/ScopedTraceSection.h>
+#include <folly/tracing/StaticTracepoint.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
+#include <proxygen/lib/http/HTTPPriorityFunctions.h>
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/codec/HTTPChecks.h>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/http/session/IngressCapture.h>
+#include <proxygen/lib/http/session/LoopBudget.h>
+#include <proxygen/lib/http/session/MemoryGovernor.h>
+#include <proxygen/lib/http/session/ReadBufferPool.h>
+#include <proxygen/lib/utils/AllocationPhase.h>
 #include <wangle/acceptor/ConnectionManager.h>
 #include <wangle/acceptor/SocketOptions.h>
 
@@ -43,6 +54,24 @@ static const uint32_t kWriteReadyMax = 65536;
 // Higher = lower latency, less prioritization
 static const uint32_t kMaxWritesPerLoop = 32;
 
+// Dynamic TLS record sizing: records that fit one TCP segment, MSS 1460 less
+// TCP options and TLS overhead, until a connection has written this much
+// since it last sat idle, then full ones
+static const uint32_t kTLSSmallRecordSize = 1300;
+static const uint32_t kTLSMaxRecordSize = 16384;
+static const uint64_t kTLSRecordWarmupBytes = 1024 * 1024;
+static constexpr std::chrono::milliseconds kTLSRecordIdleReset{1000};
+
+namespace {
+// Frees the storage of an emptied container, which erasing keeps
+template <typename Container>
+void releaseIfEmpty(Container& container) {
+  if (container.empty()) {
+    Container().swap(container);
+  }
+}
+} // namespace
+
 static constexpr folly::StringPiece kClientLabel =
     "EXPORTER HTTP CERTIFICATE client";
 static constexpr folly::StringPiece kServerLabel =
@@ -95,6 +124,8 @@ HTTPSession::HTTPSession(const WheelTimerInstance& wheelTimer,
       ingressError_(false),
       flowControlTimeout_(this),
       drainTimeout_(this),
+      memoryPressureTimeout_(this),
+      lazyIdleTimeoutCb_(this),
       reads_(SocketState::PAUSED),
       writes_(SocketState::UNPAUSED),
       ingressUpgraded_(false),
@@ -108,7 +139,10 @@ HTTPSession::HTTPSession(const WheelTimerInstance& wheelTimer,
   initialReceiveWindow_ = receiveStreamWindowSize_ = receiveSessionWindowSize_ =
       codec_->getDefaultWindowSize();
 
-  codec_.add<HTTPChecks>();
+  if (!codec_->supportsSessionFlowControl()) {
+    codec_.add<HTTPChecks>();
+    httpChecksInstalled_ = true;
+  }
 
   setupCodec();
 
@@ -216,7 +250,15 @@ void HTTPSession::setupCodec() {
   codec_->generateConnectionPreface(writeBuf_);
 
   if (codec_->supportsSessionFlowControl() && !connFlowControl_) {
-    connFlowControl_ = new FlowControlFilter(*this, writeBuf_, codec_.call());
+    if (httpChecksInstalled_) {
+      connFlowControl_ = new FlowControlFilter(*this, writeBuf_, codec_.call());
+    } else {
+      // Composed into one filter, a frame makes one virtual hop less
+      connFlowControl_ =
+          new HTTPChecksT<FlowControlFilter>(*this, writeBuf_, codec_.call());
+      httpChecksInstalled_ = true;
+    }
+    connFlowControl_->setDeferWindowUpdates(batchWindowUpdates_);
     codec_.addFilters(std::unique_ptr<FlowControlFilter>(connFlowControl_));
     // if we really support switching from spdy <-> h2, we need to update
     // existing flow control filter
@@ -238,7 +280,15 @@ HTTPSession::~HTTPSession() {
   CHECK(transactions_.empty());
   txnEgressQueue_.dropPriorityNodes();
   CHECK(txnEgressQueue_.empty());
+  CHECK(!extensibleEgressQueue_ || extensibleEgressQueue_->empty());
   DCHECK(!sock_->getReadCallback());
+  if (sessionStats_ && egressBudgetAllocated_ > 0) {
+    sessionStats_->recordEgressBudgetAllocatedBytes(
+        -static_cast<int64_t>(egressBudgetAllocated_));
+  }
+  if (zeroCopyReleaseState_) {
+    zeroCopyReleaseState_->session = nullptr;
+  }
 
   if (writeTimeout_.isScheduled()) {
     writeTimeout_.cancelTimeout();
@@ -248,6 +298,19 @@ HTTPSession::~HTTPSession() {
     flowControlTimeout_.cancelTimeout();
   }
 
+  if (memoryPressureTimeout_.isScheduled()) {
+    memoryPressureTimeout_.cancelTimeout();
+  }
+
+  releasePooledReadBuf();
+  if (pinnedReadBytes_ > 0) {
+    ReadBufferPool::get().adjustPinnedBytes(-int64_t(pinnedReadBytes_));
+  }
+
+  if (autotunedWindowBytes_ > 0) {
+    ReceiveWindowBudget::get().release(autotunedWindowBytes_);
+  }
+
   runDestroyCallbacks();
 }
 
@@ -270,6 +333,9 @@ void HTTPSession::startNow() {
                                   controller->getGracefulShutdownTimeout());
     }
   }
+  if (isDownstream()) {
+    maybeStartIngressCapture();
+  }
   scheduleWrite();
   resumeReads();
 }
@@ -308,6 +374,345 @@ void HTTPSession::setFlowControl(size_t initialReceiveWindow,
   }
 }
 
+void HTTPSession::setReceiveWindowAutotuning(uint32_t maxWindow) {
+  maxAutotunedReceiveWindow_ = maxWindow;
+  if (maxWindow == 0) {
+    bdpEstimator_.reset();
+    return;
+  }
+  bdpEstimator_ = std::make_unique<BDPEstimator>(
+      static_cast<uint32_t>(
+          std::min<size_t>(receiveSessionWindowSize_, maxWindow)),
+      maxWindow);
+}
+
+void HTTPSession::onAutotuneBytesReceived(uint64_t bytes) {
+  if (!bdpEstimator_ || !connFlowControl_ || draining_ ||
+      !bdpEstimator_->onBytesReceived(bytes)) {
+    return;
+  }
+  // A ping of our own, told apart from the prober's by its data
+  bdpPingData_ = folly::Random::rand64();
+  if (sendPing(bdpPingData_) == 0) {
+    bdpEstimator_->onPingAck();
+  }
+}
+
+void HTTPSession::onBDPPingReply() {
+  auto bdp = bdpEstimator_->onPingAck();
+  if (!bdp || *bdp <= receiveSessionWindowSize_ ||
+      MemoryGovernor::get().isUnderPressure()) {
+    return;
+  }
+  auto granted = ReceiveWindowBudget::get().reserve(
+      *bdp - receiveSessionWindowSize_);
+  if (granted == 0) {
+    VLOG(4) << *this << " receive window budget exhausted";
+    return;
+  }
+  autotunedWindowBytes_ += granted;
+  receiveSessionWindowSize_ += granted;
+  VLOG(4) << *this << " autotuned receive window to "
+          << receiveSessionWindowSize_
+          << " rtt=" << bdpEstimator_->getRTT().count() << "us";
+  connFlowControl_->setReceiveWindowSize(writeBuf_, receiveSessionWindowSize_);
+  HTTPSessionBase::setReadBufferLimit(receiveSessionWindowSize_);
+  // A single stream may use all of the session window
+  if (receiveSessionWindowSize_ > receiveStreamWindowSize_) {
+    receiveStreamWindowSize_ = receiveSessionWindowSize_;
+    invokeOnAllTransactions([this](HTTPTransaction* txn) {
+      txn->setReceiveWindow(receiveStreamWindowSize_);
+    });
+  }
+  scheduleWrite();
+}
+
+void HTTPSession::setWindowUpdateBatching(bool enabled) {
+  if (batchWindowUpdates_ && !enabled) {
+    flushWindowUpdates();
+    scheduleWrite();
+  }
+  batchWindowUpdates_ = enabled;
+  if (connFlowControl_) {
+    connFlowControl_->setDeferWindowUpdates(enabled);
+  }
+}
+
+void HTTPSession::setAdaptiveEgressFrameSize(bool enabled) {
+  adaptiveEgressFrameSize_ = enabled;
+  nextEgressFrameSizeUpdate_ = bytesWritten_;
+  if (!enabled && egressFrameSize_ > 0) {
+    egressFrameSize_ = 0;
+    applyEgressDataFrameSize();
+  }
+}
+
+void HTTPSession::applyEgressDataFrameSize() {
+  auto* h2Codec = dynamic_cast<HTTP2Codec*>(codec_.getChainEndPtr());
+  if (!h2Codec) {
+    return;
+  }
+  auto size = egressFrameSize_;
+  if (tlsRecordSize_ > 0 && tlsRecordSize_ < kTLSMaxRecordSize) {
+    // One DATA frame per small record, so each can be read on arrival
+    size = tlsRecordSize_ - http2::kFrameHeaderSize;
+  }
+  h2Codec->setEgressDataFrameSize(size);
+}
+
+void HTTPSession::setDynamicTLSRecordSize(bool enabled) {
+  dynamicTLSRecordSize_ = enabled;
+  if (!enabled && tlsRecordSize_ > 0) {
+    setTLSRecordSize(kTLSMaxRecordSize);
+    tlsRecordSize_ = 0;
+    applyEgressDataFrameSize();
+  }
+}
+
+void HTTPSession::updateTLSRecordSize() {
+  auto now = getCurrentTime();
+  if (millisecondsBetween(now, lastTLSRecordWrite_) >= kTLSRecordIdleReset) {
+    // The congestion window has likely collapsed, start small again
+    tlsRecordWarmupStart_ = bytesWritten_;
+  }
+  lastTLSRecordWrite_ = now;
+  auto size = (bytesWritten_ - tlsRecordWarmupStart_ < kTLSRecordWarmupBytes)
+                  ? kTLSSmallRecordSize
+                  : kTLSMaxRecordSize;
+  if (size == tlsRecordSize_) {
+    return;
+  }
+  if (!setTLSRecordSize(size)) {
+    // The TLS layer keeps its own record size, only align writes to it
+    size = kTLSMaxRecordSize;
+  }
+  if (size != tlsRecordSize_) {
+    VLOG(4) << *this << " TLS record size=" << size;
+    tlsRecordSize_ = size;
+    applyEgressDataFrameSize();
+  }
+}
+
+bool HTTPSession::setTLSRecordSize(uint32_t size) {
+  // AsyncSSLSocket seals each buffer of a write with its own SSL_write(),
+  // so one record each, combining only the buffers shorter than its min
+  // write size.  getNextToSend() cuts small records into buffers of their
+  // own.  Other TLS layers pack writes into records themselves.
+  auto sslSock = sock_->getUnderlyingTransport<folly::AsyncSSLSocket>();
+  if (!sslSock) {
+    return false;
+  }
+  if (!tlsMinWriteSize_) {
+    tlsMinWriteSize_ = sslSock->getMinWriteSize();
+  }
+  sslSock->setMinWriteSize(std::min<size_t>(*tlsMinWriteSize_, size));
+  return true;
+}
+
+std::unique_ptr<folly::IOBuf> HTTPSession::splitTLSRecords(
+    std::unique_ptr<folly::IOBuf> buf) const {
+  folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
+  queue.append(std::move(buf));
+  std::unique_ptr<folly::IOBuf> records;
+  while (!queue.empty()) {
+    auto record = queue.split(
+        std::min<size_t>(queue.chainLength(), tlsRecordSize_));
+    // Only copies the records straddling two buffers
+    record->coalesce();
+    if (records) {
+      records->prependChain(std::move(record));
+    } else {
+      records = std::move(record);
+    }
+  }
+  return records;
+}
+
+void HTTPSession::updateEgressFrameSize() {
+  auto* h2Codec = dynamic_cast<HTTP2Codec*>(codec_.getChainEndPtr());
+  if (!h2Codec) {
+    // Not HTTP/2, at least not yet
+    nextEgressFrameSizeUpdate_ = bytesWritten_ + kWriteReadyMax;
+    return;
+  }
+  wangle::TransportInfo tinfo;
+  uint64_t cwndBytes = 0;
+  if (getCurrentTransportInfoWithoutUpdate(&tinfo) && tinfo.cwndBytes > 0) {
+    cwndBytes = tinfo.cwndBytes;
+  }
+  egressFrameSize_ = HTTP2Codec::getAdaptiveDataFrameSize(
+      cwndBytes, h2Codec->getPeerMaxFrameSize(), transportInfo_.secure);
+  applyEgressDataFrameSize();
+  nextEgressFrameSizeUpdate_ =
+      bytesWritten_ + std::max<uint64_t>(cwndBytes, kWriteReadyMax);
+  VLOG(4) << *this << " cwndBytes=" << cwndBytes
+          << " egressFrameSize=" << egressFrameSize_;
+}
+
+void HTTPSession::scheduleWindowUpdateFlush() {
+  if (!isLoopCallbackScheduled()) {
+    sock_->getEventBase()->runInLoop(this);
+  }
+}
+
+void HTTPSession::flushWindowUpdates() {
+  if (connFlowControl_) {
+    connFlowControl_->flushWindowUpdate(writeBuf_);
+  }
+  for (const auto& [streamID, bytes] : pendingWindowUpdates_) {
+    // Streams that closed since don't need them anymore
+    if (findTransaction(streamID)) {
+      codec_->generateWindowUpdate(writeBuf_, streamID, bytes);
+    }
+  }
+  pendingWindowUpdates_.clear();
+}
+
+void HTTPSession::setUseExtensiblePriorities(bool enabled) {
+  CHECK(transactions_.empty());
+  if (!enabled) {
+    extensibleEgressQueue_.reset();
+  } else if (codec_->supportsParallelRequests() && !extensibleEgressQueue_) {
+    extensibleEgressQueue_ =
+        std::make_unique<ExtensiblePriorityQueue>(txnEgressQueue_.getRootId());
+  }
+}
+
+void HTTPSession::setMaxPipelinedRequests(uint32_t maxRequests,
+                                          uint64_t maxHeldEgressBytes) {
+  CHECK_GT(maxRequests, 0);
+  CHECK(transactions_.empty()) << "Set before any request is read";
+  maxPipelinedRequests_ = maxRequests;
+  maxHeldEgressBytes_ = maxHeldEgressBytes;
+}
+
+void HTTPSession::setEgressBudget(uint64_t bytes) {
+  if (bytes > 0) {
+    if (egressBudgetAllocator_) {
+      egressBudgetAllocator_->setBudget(bytes);
+    } else {
+      egressBudgetAllocator_ = std::make_unique<EgressBudgetAllocator>(bytes);
+      lastEgressBudgetRebalance_ = getCurrentTime();
+    }
+    rebalanceEgressBudget();
+    return;
+  }
+  if (!egressBudgetAllocator_) {
+    return;
+  }
+  egressBudgetAllocator_.reset();
+  egressBudgetEntries_.clear();
+  if (sessionStats_ && egressBudgetAllocated_ > 0) {
+    sessionStats_->recordEgressBudgetAllocatedBytes(
+        -static_cast<int64_t>(egressBudgetAllocated_));
+  }
+  egressBudgetAllocated_ = 0;
+  // Restoring a limit can resume a handler, which may open or close streams
+  DestructorGuard dg(this);
+  std::vector<HTTPCodec::StreamID> ids(transactionIds_.begin(),
+                                       transactionIds_.end());
+  for (auto id : ids) {
+    auto txn = findTransaction(id);
+    if (txn) {
+      txn->setEgressBufferLimitOverride(folly::none);
+    }
+  }
+}
+
+void HTTPSession::maybeRebalanceEgressBudget() {
+  if (egressBudgetAllocator_ &&
+      millisecondsBetween(getCurrentTime(), lastEgressBudgetRebalance_) >=
+          kEgressBudgetInterval) {
+    rebalanceEgressBudget();
+  }
+}
+
+void HTTPSession::rebalanceEgressBudget() {
+  DCHECK(egressBudgetAllocator_);
+  auto now = getCurrentTime();
+  auto elapsed = millisecondsBetween(now, lastEgressBudgetRebalance_);
+  lastEgressBudgetRebalance_ = now;
+
+  egressBudgetEntries_.clear();
+  for (auto& it : transactions_) {
+    auto& txn = it.second;
+    if (txn.isEgressComplete()) {
+      continue;
+    }
+    egressBudgetEntries_.emplace_back(
+        it.first, getEgressBudgetWeight(txn), txn.getBodyBytesEgressed());
+  }
+  auto allocated =
+      egressBudgetAllocator_->allocate(egressBudgetEntries_, elapsed);
+  if (sessionStats_) {
+    sessionStats_->recordEgressBudgetAllocatedBytes(
+        static_cast<int64_t>(allocated) -
+        static_cast<int64_t>(egressBudgetAllocated_));
+    sessionStats_->recordEgressBudgetRebalance();
+  }
+  egressBudgetAllocated_ = allocated;
+
+  // A new limit can pause or resume a handler, so look each stream up again
+  DestructorGuard dg(this);
+  auto entries = std::move(egressBudgetEntries_);
+  for (const auto& entry : entries) {
+    auto txn = findTransaction(entry.id);
+    if (txn) {
+      VLOG(5) << *this << " egress budget limit=" << entry.limit
+              << " txn=" << entry.id;
+      txn->setEgressBufferLimitOverride(entry.limit);
+    }
+  }
+  egressBudgetEntries_ = std::move(entries);
+}
+
+uint32_t HTTPSession::getEgressBudgetWeight(const HTTPTransaction& txn) const {
+  if (extensibleEgressQueue_) {
+    auto pri = extensibleEgressQueue_->getPriority(txn.getID());
+    uint8_t urgency = pri ? pri->urgency : kDefaultHttpPriorityUrgency;
+    // Scale the eight urgency levels onto the HTTP/2 weight range
+    return (kMaxPriority + 1 - urgency) * 32;
+  }
+  return txn.getPriority().weight + 1;
+}
+
+void HTTPSession::trackZeroCopyRelease(folly::IOBuf& writeBuf, uint64_t len) {
+  if (!zeroCopyReleaseState_) {
+    zeroCopyReleaseState_ =
+        std::make_shared<ZeroCopyReleaseState>(ZeroCopyReleaseState{this});
+  }
+  using Release = std::pair<std::shared_ptr<ZeroCopyReleaseState>, uint64_t>;
+  auto release = new Release(zeroCopyReleaseState_, len);
+  writeBuf.prependChain(folly::IOBuf::takeOwnership(
+      release,
+      0,
+      [](void* /*buf*/, void* userData) {
+        std::unique_ptr<Release> r(static_cast<Release*>(userData));
+        if (r->first->session) {
+          r->first->session->onZeroCopyReleased(r->second);
+        }
+      },
+      release));
+  zeroCopyBytesInFlight_ += len;
+  // Balanced in onZeroCopyReleased, this keeps the bytes pending after
+  // writeSuccess until the kernel is done with the buffers
+  HTTPSessionBase::notifyEgressBodyBuffered(len, false);
+}
+
+void HTTPSession::onZeroCopyReleased(uint64_t len) {
+  DCHECK_GE(zeroCopyBytesInFlight_, len);
+  zeroCopyBytesInFlight_ -= len;
+  VLOG(5) << *this << " zero copy write released len=" << len
+          << " inFlight=" << zeroCopyBytesInFlight_;
+  if (inLoopCallback_) {
+    // applied by updatePendingWrites when the loop callback finishes
+    HTTPSessionBase::notifyEgressBodyBuffered(-static_cast<int64_t>(len),
+                                              false);
+  } else {
+    updateWriteBufSize(-static_cast<int64_t>(len));
+  }
+}
+
 void HTTPSession::setEgressSettings(const SettingsList& inSettings) {
   VLOG_IF(4, started_) << "Must flush egress settings to peer";
   HTTPSettings* settings = codec_->getEgressSettings();
@@ -333,11 +738,91 @@ void HTTPSession::setMaxConcurrentIncomingStreams(uint32_t num) {
   }
 }
 
+void HTTPSession::changeMaxConcurrentIncomingStreams(uint32_t num) {
+  if (!started_) {
+    setMaxConcurrentIncomingStreams(num);
+    return;
+  }
+  HTTPSettings* settings = codec_->getEgressSettings();
+  if (!codec_->supportsParallelRequests() || !settings) {
+    return;
+  }
+  settings->setSetting(SettingsId::MAX_CONCURRENT_STREAMS, num);
+  sendSettings();
+  if (num >= maxConcurrentIncomingStreams_) {
+    maxConcurrentIncomingStreams_ = num;
+    pendingMaxConcurrentIncomingStreams_.reset();
+  } else {
+    pendingMaxConcurrentIncomingStreams_ = num;
+  }
+}
+
 void HTTPSession::setEgressBytesLimit(uint64_t bytesLimit) {
   CHECK(!started_);
   egressBytesLimit_ = bytesLimit;
 }
 
+void HTTPSession::setHibernateWhenIdle(bool enabled) {
+  hibernateWhenIdle_ = enabled;
+  maybeHibernate();
+}
+
+bool HTTPSession::hibernate() {
+  if (!transactions_.empty() || numActiveWrites_ > 0 || hasMoreWrites() ||
+      !readBuf_.empty() || readsShutdown() || writesShutdown()) {
+    return false;
+  }
+  VLOG(4) << *this << " hibernating";
+  hibernating_ = true;
+  codec_->releaseIdleMemory();
+  txnEgressQueue_.releaseIdleMemory();
+  releaseIfEmpty(transactions_);
+  releaseIfEmpty(transactionIds_);
+  releaseIfEmpty(controlStreamIds_);
+  releaseIfEmpty(pendingWindowUpdates_);
+  releasePooledReadBuf();
+  return true;
+}
+
+void HTTPSession::maybeHibernate() {
+  if (hibernateWhenIdle_ && !hibernating_) {
+    hibernate();
+  }
+}
+
+void HTTPSession::refreshIdleTimeout() {
+  auto connectionManager = getConnectionManager();
+  if (!isLazyIdleTimeoutsEnabled() || !connectionManager) {
+    resetTimeout();
+    return;
+  }
+  auto timeout = connectionManager->getDefaultTimeout();
+  if (lazyIdleTimeout_.refresh(lazyIdleTimeoutCb_.isScheduled(), timeout)) {
+    // In case the ConnectionManager scheduled it when adding the session
+    cancelTimeout();
+    connectionManager->scheduleTimeout(&lazyIdleTimeoutCb_, timeout);
+  }
+}
+
+bool HTTPSession::isIdleTimeoutScheduled() const {
+  return isScheduled() || lazyIdleTimeoutCb_.isScheduled();
+}
+
+void HTTPSession::cancelIdleTimeout() {
+  cancelTimeout();
+  lazyIdleTimeoutCb_.cancelTimeout();
+}
+
+void HTTPSession::lazyIdleTimeoutExpired() noexcept {
+  auto remaining = lazyIdleTimeout_.remaining();
+  auto connectionManager = getConnectionManager();
+  if (remaining.count() > 0 && connectionManager) {
+    connectionManager->scheduleTimeout(&lazyIdleTimeoutCb_, remaining);
+    return;
+  }
+  timeoutExpired();
+}
+
 void HTTPSession::readTimeoutExpired() noexcept {
   VLOG(3) << "session-level timeout on " << *this;
 
@@ -455,6 +940,20 @@ bool HTTPSession::isDownstream() const {
 
 void HTTPSession::getReadBuffer(void** buf, size_t* bufSize) {
   FOLLY_SCOPED_TRACE_SECTION("HTTPSession - getReadBuffer");
+  wakeUp();
+  if (HTTPSessionBase::useReadBufferPool_ && readBuf_.empty()) {
+    // Nothing to append to, borrow a buffer for the duration of this read
+    if (!pooledReadBuf_) {
+      pooledReadBuf_ =
+          ReadBufferPool::get().acquire(HTTPSessionBase::maxReadBufferSize_);
+      if (!readBufferRelease_.isLoopCallbackScheduled()) {
+        sock_->getEventBase()->runInLoop(&readBufferRelease_);
+      }
+    }
+    *buf = pooledReadBuf_->writableTail();
+    *bufSize = pooledReadBuf_->tailroom();
+    return;
+  }
   pair<void*, uint32_t> readSpace =
       readBuf_.preallocate(kMinReadSize, HTTPSessionBase::maxReadBufferSize_);
   *buf = readSpace.first;
@@ -464,20 +963,37 @@ void HTTPSession::getReadBuffer(void** buf, size_t* bufSize) {
 void HTTPSession::readDataAvailable(size_t readSize) noexcept {
   FOLLY_SCOPED_TRACE_SECTION(
       "HTTPSession - readDataAvailable", "readSize", readSize);
+  FOLLY_SDT(proxygen, session_read, this, readSize);
   VLOG(10) << "read completed on " << *this << ", bytes=" << readSize;
 
   DestructorGuard dg(this);
   if (pingProber_) {
     pingProber_->refreshTimeout(/*onIngress=*/true);
   }
-  resetTimeout();
+  refreshIdleTimeout();
 
   if (ingressError_) {
     VLOG(3) << "discarding readBuf due to ingressError_ sess=" << *this
             << " bytes=" << readSize;
+    releasePooledReadBuf();
     return;
   }
-  readBuf_.postallocate(readSize);
+  if (pooledReadBuf_) {
+    pooledReadBuf_->append(readSize);
+    if (ingressRecorder_) {
+      ingressRecorder_->onData(0, *pooledReadBuf_);
+    }
+    readBuf_.append(std::move(pooledReadBuf_));
+  } else {
+    if (ingressRecorder_) {
+      ingressRecorder_->onData(
+          0, folly::ByteRange(readBuf_.writableTail(), readSize));
+    }
+    readBuf_.postallocate(readSize);
+  }
+  if (recordsTransactionTimings()) {
+    lastReadTime_ = getCurrentTime();
+  }
 
   if (infoCallback_) {
     infoCallback_->onRead(*this, readSize, HTTPCodec::NoStream);
@@ -494,21 +1010,29 @@ void HTTPSession::readBufferAvailable(std::unique_ptr<IOBuf> readBuf) noexcept {
   size_t readSize = readBuf->computeChainDataLength();
   FOLLY_SCOPED_TRACE_SECTION(
       "HTTPSession - readBufferAvailable", "readSize", readSize);
+  FOLLY_SDT(proxygen, session_read, this, readSize);
   VLOG(5) << "read completed on " << *this << ", bytes=" << readSize;
+  wakeUp();
 
   if (pingProber_) {
     pingProber_->refreshTimeout(/*onIngress=*/true);
   }
 
   DestructorGuard dg(this);
-  resetTimeout();
+  refreshIdleTimeout();
 
   if (ingressError_) {
     VLOG(3) << "discarding readBuf due to ingressError_ sess=" << *this
             << " bytes=" << readSize;
     return;
   }
+  if (ingressRecorder_) {
+    ingressRecorder_->onData(0, *readBuf);
+  }
   readBuf_.append(std::move(readBuf));
+  if (recordsTransactionTimings()) {
+    lastReadTime_ = getCurrentTime();
+  }
 
   if (infoCallback_) {
     infoCallback_->onRead(*this, readSize, HTTPCodec::NoStream);
@@ -519,10 +1043,17 @@ void HTTPSession::readBufferAvailable(std::unique_ptr<IOBuf> readBuf) noexcept {
 
 void HTTPSession::processReadData() {
   FOLLY_SCOPED_TRACE_SECTION("HTTPSession - processReadData");
+  PROXYGEN_ALLOCATION_PHASE(PARSE);
 
   // Pass the ingress data through the codec to parse it. The codec
   // will invoke various methods of the HTTPSession as callbacks.
+  uint64_t readSlice = LoopBudget::get().getReadSlice();
+  uint64_t parsed = 0;
   while (!ingressError_ && readsUnpaused() && !readBuf_.empty()) {
+    if (readSlice > 0 && parsed >= readSlice) {
+      yieldReads();
+      break;
+    }
     // Skip any 0 length buffers before invoking the codec. Since readBuf_ is
     // not empty, we are guaranteed to find a non-empty buffer.
     while (readBuf_.front()->length() == 0) {
@@ -531,19 +1062,67 @@ void HTTPSession::processReadData() {
 
     // We're about to parse, make sure the parser is not paused
     codec_->setParserPaused(false);
-    size_t bytesParsed = codec_->onIngress(*readBuf_.front());
+    size_t bytesParsed = 0;
+    if (readSlice > 0 && readBuf_.chainLength() > readSlice - parsed) {
+      // The rest of the slice, unless it doesn't hold a whole frame
+      folly::io::Cursor cursor(readBuf_.front());
+      std::unique_ptr<IOBuf> slice;
+      cursor.clone(slice, readSlice - parsed);
+      bytesParsed = codec_->onIngress(*slice);
+    }
+    if (bytesParsed == 0) {
+      bytesParsed = codec_->onIngress(*readBuf_.front());
+    }
     if (bytesParsed == 0) {
       // If the codec didn't make any progress with current input, we
       // better get more.
       break;
     }
-    readBuf_.trimStart(bytesParsed);
+    if (HTTPSessionBase::useReadBufferPool_ &&
+        bytesParsed == readBuf_.chainLength()) {
+      // Everything was parsed, hand the buffers back right away
+      ReadBufferPool::get().release(readBuf_.move());
+    } else {
+      readBuf_.trimStart(bytesParsed);
+    }
+    parsed += bytesParsed;
+  }
+  if (HTTPSessionBase::useReadBufferPool_ || pinnedReadBytes_ > 0) {
+    // Account for what a partially parsed message keeps around
+    size_t pinned = readBuf_.chainLength();
+    ReadBufferPool::get().adjustPinnedBytes(int64_t(pinned) -
+                                            int64_t(pinnedReadBytes_));
+    pinnedReadBytes_ = pinned;
+  }
+  checkMemoryPressure();
+}
+
+void HTTPSession::yieldReads() {
+  // The loop callback parses the rest and reinstalls the read callback,
+  // leaving the socket's data there meanwhile
+  VLOG(4) << *this << " yielding reads, unparsed=" << readBuf_.chainLength();
+  LoopBudget::get().onReadYield();
+  readsYielded_ = true;
+  sock_->setReadCB(nullptr);
+  if (!isLoopCallbackScheduled()) {
+    sock_->getEventBase()->runInLoop(this);
+  }
+}
+
+void HTTPSession::releasePooledReadBuf() {
+  readBufferRelease_.cancelLoopCallback();
+  if (pooledReadBuf_) {
+    ReadBufferPool::get().release(std::move(pooledReadBuf_));
   }
 }
 
 void HTTPSession::readEOF() noexcept {
   DestructorGuard guard(this);
   VLOG(4) << "EOF on " << *this;
+  releasePooledReadBuf();
+  if (ingressRecorder_) {
+    ingressRecorder_->onEndOfStream(0);
+  }
   // for SSL only: error without any bytes from the client might happen
   // due to client-side issues with the SSL cert. Note that it can also
   // happen if the client sends a SPDY frame header but no body.
@@ -563,6 +1142,7 @@ void HTTPSession::readEOF() noexcept {
 void HTTPSession::readErr(const AsyncSocketException& ex) noexcept {
   DestructorGuard guard(this);
   VLOG(4) << "read error on " << *this << ": " << ex.what();
+  releasePooledReadBuf();
 
   auto sslEx = dynamic_cast<const folly::SSLException*>(&ex);
   if (infoCallback_ && sslEx) {
@@ -688,6 +1268,15 @@ http2::PriorityUpdate HTTPSession::getMessagePriority(const HTTPMessage* msg) {
   return h2Pri;
 }
 
+void HTTPSession::updateExtensiblePriority(HTTPCodec::StreamID streamID,
+                                           const HTTPMessage& msg) {
+  DCHECK(extensibleEgressQueue_);
+  auto pri = httpPriorityFromHTTPMessage(msg);
+  if (pri) {
+    extensibleEgressQueue_->updatePriority(streamID, *pri);
+  }
+}
+
 void HTTPSession::onMessageBegin(HTTPCodec::StreamID streamID,
                                  HTTPMessage* msg) {
   VLOG(4) << "processing new msg streamID=" << streamID << " " << *this;
@@ -717,6 +1306,12 @@ void HTTPSession::onMessageBegin(HTTPCodec::StreamID streamID,
   if (!txn) {
     return; // This could happen if the socket is bad.
   }
+  if (auto timings = txn->getTimings()) {
+    timings->firstHeaderByteRead = lastReadTime_;
+  }
+  if (maxPipelinedRequests_ > 1) {
+    holdPipelinedEgress(txn);
+  }
 
   if (!codec_->supportsParallelRequests() && getPipelineStreamCount() > 1) {
     // The previous transaction hasn't completed yet. Pause reads until
@@ -727,8 +1322,9 @@ void HTTPSession::onMessageBegin(HTTPCodec::StreamID streamID,
     CHECK(byteEventTracker_);
     byteEventTracker_->drainByteEvents();
 
-    // drainByteEvents() may detach txn(s). Don't pause read if one txn left
-    if (getPipelineStreamCount() < 2) {
+    // drainByteEvents() may detach txn(s). Don't pause read if within the
+    // pipelining limit
+    if (getPipelineStreamCount() <= maxPipelinedRequests_) {
       DCHECK(readsUnpaused());
       return;
     }
@@ -841,6 +1437,7 @@ void HTTPSession::onHeadersComplete(HTTPCodec::StreamID streamID,
   // headers.
   VLOG(4) << "processing ingress headers complete for " << *this
           << ", streamID=" << streamID;
+  FOLLY_SDT(proxygen, session_headers_complete, this, streamID);
 
   if (!codec_->isReusable()) {
     setCloseReason(ConnectionCloseReason::REQ_NOTREUSABLE);
@@ -854,6 +1451,7 @@ void HTTPSession::onHeadersComplete(HTTPCodec::StreamID streamID,
   // client) are processed.
   if (isDownstream()) {
     if (auto msgPtr = msg.get()) {
+      recordRequestStarted(streamID, msgPtr->getHeaders());
       const auto event =
           HTTPSessionObserverInterface::RequestStartedEvent::Builder()
               .setHeaders(msgPtr->getHeaders())
@@ -878,6 +1476,10 @@ void HTTPSession::onHeadersComplete(HTTPCodec::StreamID streamID,
       transportInfo_.sslCipher ? transportInfo_.sslCipher->c_str() : nullptr;
   msg->setSecureInfo(transportInfo_.sslVersion, sslCipher);
   msg->setSecure(transportInfo_.secure);
+  // Before the client's Finished, only 0-RTT data can arrive
+  if (isDownstream() && !sock_->isReplaySafe()) {
+    msg->setEarlyData(true);
+  }
 
   auto controlStreamID = txn->getControlStream();
   if (controlStreamID) {
@@ -918,6 +1520,10 @@ void HTTPSession::onHeadersComplete(HTTPCodec::StreamID streamID,
     return;
   }
 
+  if (extensibleEgressQueue_ && msg->isRequest()) {
+    updateExtensiblePriority(streamID, *msg);
+  }
+
   // Tell the Transaction to start processing the message now
   // that the full ingress headers have arrived.
   txn->onIngressHeadersComplete(std::move(msg));
@@ -934,6 +1540,7 @@ void HTTPSession::onBody(HTTPCodec::StreamID streamID,
   // The codec's parser detected part of the ingress message's
   // entity-body.
   uint64_t length = chain->computeChainDataLength();
+  onAutotuneBytesReceived(length + padding);
   HTTPTransaction* txn = findTransaction(streamID);
   if (!txn) {
     if (connFlowControl_ &&
@@ -1240,7 +1847,10 @@ void HTTPSession::onPingRequest(uint64_t data) {
 
 void HTTPSession::onPingReply(uint64_t data) {
   VLOG(4) << *this << " got ping reply with id=" << data;
-  if (pingProber_) {
+  if (bdpEstimator_ && bdpEstimator_->isPingOutstanding() &&
+      data == bdpPingData_) {
+    onBDPPingReply();
+  } else if (pingProber_) {
     pingProber_->onPingReply(data);
   }
   if (infoCallback_) {
@@ -1288,11 +1898,22 @@ void HTTPSession::onSettings(const SettingsList& settings) {
 
 void HTTPSession::onSettingsAck() {
   VLOG(4) << *this << " received settings ack";
+  if (pendingMaxConcurrentIncomingStreams_) {
+    maxConcurrentIncomingStreams_ = *pendingMaxConcurrentIncomingStreams_;
+    pendingMaxConcurrentIncomingStreams_.reset();
+  }
   if (infoCallback_) {
     infoCallback_->onSettingsAck(*this);
   }
 }
 
+void HTTPSession::onOrigin(const std::vector<std::string>& origins) {
+  VLOG(4) << *this << " received origins " << folly::join(", ", origins);
+  if (infoCallback_) {
+    infoCallback_->onOrigin(*this, origins);
+  }
+}
+
 void HTTPSession::onPriority(HTTPCodec::StreamID streamID,
                              const HTTPMessage::HTTP2Priority& pri) {
   if (!getHTTP2PrioritiesEnabled()) {
@@ -1310,7 +1931,11 @@ void HTTPSession::onPriority(HTTPCodec::StreamID streamID,
   }
 }
 
-void HTTPSession::onPriority(HTTPCodec::StreamID, const HTTPPriority&) {
+void HTTPSession::onPriority(HTTPCodec::StreamID streamID,
+                             const HTTPPriority& pri) {
+  if (extensibleEgressQueue_) {
+    extensibleEgressQueue_->updatePriority(streamID, pri);
+  }
 }
 
 void HTTPSession::onCertificateRequest(uint16_t requestId,
@@ -1509,7 +2134,8 @@ void HTTPSession::resumeIngress(HTTPTransaction* txn) noexcept {
   // This function can be called from detach(), in which case liveTransactions_
   // may go to 1 briefly, even though we are still anit-pipelining.
   if (liveTransactions_ == 1 &&
-      (codec_->supportsParallelRequests() || getPipelineStreamCount() <= 1)) {
+      (codec_->supportsParallelRequests() ||
+       getPipelineStreamCount() <= maxPipelinedRequests_)) {
     resumeReads();
   }
 }
@@ -1558,6 +2184,7 @@ void HTTPSession::sendHeaders(HTTPTransaction* txn,
                               HTTPHeaderSize* size,
                               bool includeEOM) noexcept {
   CHECK(started_);
+  PROXYGEN_ALLOCATION_PHASE(ENCODE);
   unique_ptr<IOBuf> goawayBuf;
   if (draining_ && isUpstream() && codec_->isReusable() &&
       allTransactionsStarted()) {
@@ -1578,6 +2205,9 @@ void HTTPSession::sendHeaders(HTTPTransaction* txn,
         txn->onPriorityUpdate(pri);
       }
     }
+    if (extensibleEgressQueue_ && headers.isRequest()) {
+      updateExtensiblePriority(txn->getID(), headers);
+    }
   }
 
   const bool wasReusable = codec_->isReusable();
@@ -1605,7 +2235,9 @@ void HTTPSession::sendHeaders(HTTPTransaction* txn,
   // For all downstream, only response headers need addFirstHeaderByteEvent
   bool shouldAddFirstHeaderByteEvent =
       isUpstream() || (isDownstream() && headers.isResponse());
+  // Unsampled transactions skip it, unless a transport callback needs it
   if (shouldAddFirstHeaderByteEvent && newOffset > oldOffset &&
+      (txn->isSampled() || txn->hasTransportCallback()) &&
       !txn->testAndSetFirstHeaderByteSent() && byteEventTracker_) {
     byteEventTracker_->addFirstHeaderByteEvent(newOffset, txn);
   }
@@ -1622,12 +2254,14 @@ void HTTPSession::sendHeaders(HTTPTransaction* txn,
     CHECK_GE(newOffset, oldOffset);
     commonEom(txn, newOffset - oldOffset, true);
   }
+  txnWriteInCurrentLoop_ |= txn->getWriteInCurrentLoop();
   scheduleWrite();
   onHeadersSent(headers, wasReusable);
 
   // If this is a client sending request headers to upstream
   // invoke requestStarted event for attached observers.
   if (isUpstream()) {
+    recordRequestStarted(txn->getID(), headers.getHeaders());
     const auto event =
         HTTPSessionObserverInterface::RequestStartedEvent::Builder()
             .setHeaders(headers.getHeaders())
@@ -1655,6 +2289,7 @@ size_t HTTPSession::sendBody(HTTPTransaction* txn,
                              std::unique_ptr<folly::IOBuf> body,
                              bool includeEOM,
                              bool trackLastByteFlushed) noexcept {
+  PROXYGEN_ALLOCATION_PHASE(ENCODE);
   uint64_t offset = sessionByteOffset();
   size_t bodyLen = body ? body->computeChainDataLength() : 0;
   size_t encodedSize = codec_->generateBody(writeBuf_,
@@ -1668,7 +2303,9 @@ size_t HTTPSession::sendBody(HTTPTransaction* txn,
     httpSessionActivityTracker_->addTrackedEgressByteEvent(
         offset, encodedSize, byteEventTracker_.get(), txn);
   }
-  if (encodedSize > 0 && !txn->testAndSetFirstByteSent() && byteEventTracker_) {
+  if (encodedSize > 0 &&
+      (txn->isSampled() || txn->hasTransportCallback()) &&
+      !txn->testAndSetFirstByteSent() && byteEventTracker_) {
     byteEventTracker_->addFirstBodyByteEvent(offset + 1, txn);
   }
 
@@ -1687,12 +2324,14 @@ size_t HTTPSession::sendChunkHeader(HTTPTransaction* txn,
                                     size_t length) noexcept {
   size_t encodedSize =
       codec_->generateChunkHeader(writeBuf_, txn->getID(), length);
+  txnWriteInCurrentLoop_ |= txn->getWriteInCurrentLoop();
   scheduleWrite();
   return encodedSize;
 }
 
 size_t HTTPSession::sendChunkTerminator(HTTPTransaction* txn) noexcept {
   size_t encodedSize = codec_->generateChunkTerminator(writeBuf_, txn->getID());
+  txnWriteInCurrentLoop_ |= txn->getWriteInCurrentLoop();
   scheduleWrite();
   return encodedSize;
 }
@@ -1745,6 +2384,7 @@ void HTTPSession::onEgressMessageFinished(HTTPTransaction* txn, bool withRST) {
       drain();
     }
   } else {
+    releasePipelinedEgress(txn);
     maybeResumePausedPipelinedTransaction(oldStreamCount,
                                           txn->getSequenceNumber());
   }
@@ -1752,6 +2392,7 @@ void HTTPSession::onEgressMessageFinished(HTTPTransaction* txn, bool withRST) {
 
 size_t HTTPSession::sendEOM(HTTPTransaction* txn,
                             const HTTPHeaders* trailers) noexcept {
+  PROXYGEN_ALLOCATION_PHASE(ENCODE);
 
   VLOG(4) << *this << " sending EOM for streamID=" << txn->getID()
           << " trailers=" << (trailers ? "yes" : "no");
@@ -1768,6 +2409,8 @@ size_t HTTPSession::sendEOM(HTTPTransaction* txn,
     encodedSize += codec_->generateEOM(writeBuf_, txn->getID());
   }
 
+  // The transaction schedules the write
+  txnWriteInCurrentLoop_ |= txn->getWriteInCurrentLoop();
   commonEom(txn, encodedSize, false);
   return encodedSize;
 }
@@ -1801,8 +2444,12 @@ size_t HTTPSession::sendPriority(HTTPTransaction* txn,
   return sendPriorityImpl(txn->getID(), pri);
 }
 
-size_t HTTPSession::changePriority(HTTPTransaction* /*txn*/,
-                                   HTTPPriority /*pri*/) noexcept {
+size_t HTTPSession::changePriority(HTTPTransaction* txn,
+                                   HTTPPriority pri) noexcept {
+  // Only reprioritizes locally, there is no HTTP/2 PRIORITY_UPDATE egress
+  if (extensibleEgressQueue_) {
+    extensibleEgressQueue_->updatePriority(txn->getID(), pri);
+  }
   return 0;
 }
 
@@ -1891,14 +2538,22 @@ bool HTTPSession::maybeResumePausedPipelinedTransaction(size_t oldStreamCount,
                                                         uint32_t txnSeqn) {
   if (!codec_->supportsParallelRequests() && !transactions_.empty()) {
     auto pipelineStreamCount = getPipelineStreamCount();
-    if (pipelineStreamCount < oldStreamCount && pipelineStreamCount == 1) {
-      // For H1, StreamID = txnSeqn + 1
-      auto curStreamId = txnSeqn + 1;
-      auto txnIt = transactions_.find(curStreamId + 1);
+    // Upstream pipelined responses are read as they come, nothing paused
+    if (isDownstream() && pipelineStreamCount < oldStreamCount &&
+        pipelineStreamCount == maxPipelinedRequests_) {
+      // The newest was paused when it went over the limit.  For H1,
+      // StreamID = txnSeqn + 1
+      auto nextStreamId = txnSeqn + 2;
+      if (maxPipelinedRequests_ > 1) {
+        nextStreamId = *std::max_element(transactionIds_.begin(),
+                                         transactionIds_.end());
+      }
+      auto txnIt = transactions_.find(nextStreamId);
       CHECK(txnIt != transactions_.end());
-      DCHECK(transactionIds_.count(curStreamId + 1));
+      DCHECK(transactionIds_.count(nextStreamId));
       auto& nextTxn = txnIt->second;
-      DCHECK_EQ(nextTxn.getSequenceNumber(), txnSeqn + 1);
+      DCHECK(maxPipelinedRequests_ > 1 ||
+             nextTxn.getSequenceNumber() == txnSeqn + 1);
       DCHECK(!nextTxn.isIngressComplete());
       DCHECK(nextTxn.isIngressPaused());
       VLOG(4) << "Resuming paused pipelined txn " << nextTxn;
@@ -1909,6 +2564,46 @@ bool HTTPSession::maybeResumePausedPipelinedTransaction(size_t oldStreamCount,
   return false;
 }
 
+void HTTPSession::holdPipelinedEgress(HTTPTransaction* txn) {
+  if (codec_->supportsParallelRequests() || !isDownstream()) {
+    return;
+  }
+  for (auto& it : transactions_) {
+    if (&it.second != txn && !it.second.isEgressComplete()) {
+      VLOG(4) << "Holding egress of pipelined txn " << *txn;
+      txn->setEgressHeld(true);
+      if (maxHeldEgressBytes_ > 0 && !egressBudgetAllocator_) {
+        txn->setEgressBufferLimitOverride(maxHeldEgressBytes_ /
+                                          (maxPipelinedRequests_ - 1));
+      }
+      return;
+    }
+  }
+}
+
+void HTTPSession::releasePipelinedEgress(HTTPTransaction* finished) {
+  if (maxPipelinedRequests_ <= 1 || codec_->supportsParallelRequests()) {
+    return;
+  }
+  // finished may not be egress complete yet, if it sent EOM with headers
+  HTTPTransaction* next = nullptr;
+  for (auto& it : transactions_) {
+    auto& txn = it.second;
+    if (&txn != finished && !txn.isEgressComplete() &&
+        (!next || txn.getSequenceNumber() < next->getSequenceNumber())) {
+      next = &txn;
+    }
+  }
+  if (!next || !next->isEgressHeld()) {
+    return;
+  }
+  VLOG(4) << "Releasing egress of pipelined txn " << *next;
+  if (maxHeldEgressBytes_ > 0 && !egressBudgetAllocator_) {
+    next->setEgressBufferLimitOverride(folly::none);
+  }
+  next->setEgressHeld(false);
+}
+
 void HTTPSession::detach(HTTPTransaction* txn) noexcept {
   DestructorGuard guard(this);
   HTTPCodec::StreamID streamID = txn->getID();
@@ -1944,6 +2639,7 @@ void HTTPSession::detach(HTTPTransaction* txn) noexcept {
 
   // do not track a detached control stream
   controlStreamIds_.erase(txn->getID());
+  reportTransactionTimings(*txn);
 
   auto oldStreamCount = getPipelineStreamCount();
   decrementTransactionCount(txn, true, true);
@@ -1980,8 +2676,9 @@ void HTTPSession::detach(HTTPTransaction* txn) noexcept {
     }
   }
 
-  if (liveTransactions_ == 0 && transactions_.empty() && !isScheduled()) {
-    resetTimeout();
+  if (liveTransactions_ == 0 && transactions_.empty() &&
+      !isIdleTimeoutScheduled()) {
+    refreshIdleTimeout();
   }
 
   // It's possible that this is the last transaction in the session,
@@ -1996,12 +2693,19 @@ void HTTPSession::detach(HTTPTransaction* txn) noexcept {
       shutdownTransport(false, true);
       return;
     }
+    maybeHibernate();
   }
   checkForShutdown();
 }
 
 size_t HTTPSession::sendWindowUpdate(HTTPTransaction* txn,
                                      uint32_t bytes) noexcept {
+  if (batchWindowUpdates_) {
+    // Written in flushWindowUpdates
+    pendingWindowUpdates_[txn->getID()] += bytes;
+    scheduleWindowUpdateFlush();
+    return 0;
+  }
   size_t sent = codec_->generateWindowUpdate(writeBuf_, txn->getID(), bytes);
   if (sent) {
     scheduleWrite();
@@ -2015,7 +2719,11 @@ void HTTPSession::notifyIngressBodyProcessed(uint32_t bytes) noexcept {
   }
   if (connFlowControl_ &&
       connFlowControl_->ingressBytesProcessed(writeBuf_, bytes)) {
-    scheduleWrite();
+    if (batchWindowUpdates_) {
+      scheduleWindowUpdateFlush();
+    } else {
+      scheduleWrite();
+    }
   }
 }
 
@@ -2107,10 +2815,16 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork,
     return nullptr;
   }
 
+  maybeRebalanceEgressBudget();
+  if (adaptiveEgressFrameSize_ && bytesWritten_ >= nextEgressFrameSizeUpdate_) {
+    updateEgressFrameSize();
+  }
+
   // We always tack on at least one body packet to the current write buf
   // This ensures that a short HTTPS response will go out in a single SSL record
-  while (!txnEgressQueue_.empty()) {
-    uint32_t toSend = kWriteReadyMax;
+  while (!isEgressQueueEmpty()) {
+    // Room for at least one frame of the adaptive size
+    uint32_t toSend = std::max(kWriteReadyMax, egressFrameSize_);
     if (connFlowControl_) {
       if (connFlowControl_->getAvailableSend() == 0) {
         VLOG(4) << "Session-level send window is full, skipping remaining "
@@ -2119,7 +2833,11 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork,
       }
       toSend = std::min(toSend, connFlowControl_->getAvailableSend());
     }
-    txnEgressQueue_.nextEgress(nextEgressResults_, false);
+    if (extensibleEgressQueue_) {
+      extensibleEgressQueue_->nextEgress(nextEgressResults_);
+    } else {
+      txnEgressQueue_.nextEgress(nextEgressResults_, false);
+    }
     CHECK(!nextEgressResults_.empty()); // Queue was non empty, so this must be
     // The maximum we will send for any transaction in this loop
     uint32_t txnMaxToSend = toSend * nextEgressResults_.front().second;
@@ -2170,7 +2888,7 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork,
     if (needed > 0) {
       VLOG(5) << *this
               << " writeBuf_.chainLength(): " << writeBuf_.chainLength()
-              << " txnEgressQueue_.empty(): " << txnEgressQueue_.empty();
+              << " isEgressQueueEmpty(): " << isEgressQueueEmpty();
 
       if (needed < writeBuf_.chainLength()) {
         // split the next SOM / EOM chunk
@@ -2189,7 +2907,25 @@ unique_ptr<IOBuf> HTTPSession::getNextToSend(bool* cork,
   }
 
   // cork if there are txns with pending egress and room to send them
-  *cork = !txnEgressQueue_.empty() && !isConnWindowFull();
+  *cork = !isEgressQueueEmpty() && !isConnWindowFull();
+  if (dynamicTLSRecordSize_ && transportInfo_.secure && !*timestampTx &&
+      !*timestampAck) {
+    updateTLSRecordSize();
+    auto len = writeBuf_.chainLength();
+    std::unique_ptr<folly::IOBuf> buf;
+    if (*cork && len > tlsRecordSize_ && len % tlsRecordSize_ != 0) {
+      // Write whole records only, the tail goes out with the egress that is
+      // still to come instead of as a runt record
+      writeBufSplit_ = true;
+      buf = writeBuf_.split(len - len % tlsRecordSize_);
+    } else {
+      buf = writeBuf_.move();
+    }
+    if (buf && tlsRecordSize_ < kTLSMaxRecordSize) {
+      buf = splitTLSRecords(std::move(buf));
+    }
+    return buf;
+  }
   return writeBuf_.move();
 }
 
@@ -2199,9 +2935,11 @@ void HTTPSession::runLoopCallback() noexcept {
   //   * The session has generated some egress data (see scheduleWrite())
   //   * Reads have become unpaused (see resumeReads())
   DestructorGuard dg(this);
+  PROXYGEN_ALLOCATION_PHASE(WRITE);
   inLoopCallback_ = true;
   auto scopeg = folly::makeGuard([this] {
     inLoopCallback_ = false;
+    releasePooledReadBuf();
     // This ScopeGuard needs to be under the above DestructorGuard
     updatePendingWrites();
     if (!hasMoreWrites() && isDownstream() && !hasPendingEgress()) {
@@ -2212,7 +2950,15 @@ void HTTPSession::runLoopCallback() noexcept {
     checkForShutdown();
   });
   VLOG(5) << *this << " in loop callback";
+  checkMemoryPressure();
+  if (batchWindowUpdates_) {
+    flushWindowUpdates();
+  }
 
+  uint64_t maxLoopBytes = maxEgressBytesPerLoop_ > 0
+                              ? maxEgressBytesPerLoop_
+                              : LoopBudget::get().getWriteSlice();
+  uint64_t loopBytes = 0;
   for (uint32_t i = 0; i < kMaxWritesPerLoop; ++i) {
     bodyBytesPerWriteBuf_ = 0;
     bool cork = true;
@@ -2238,6 +2984,13 @@ void HTTPSession::runLoopCallback() noexcept {
     flags |= (timestampTx) ? folly::WriteFlags::TIMESTAMP_TX
                            : folly::WriteFlags::NONE;
     flags |= (timestampAck) ? folly::WriteFlags::EOR : folly::WriteFlags::NONE;
+    // Decided after ByteEventTracker::preSend has split the write, so writes
+    // that need TX/ACK timestamps keep their boundaries
+    if (zeroCopyEgressThreshold_ > 0 &&
+        std::min(bodyBytesPerWriteBuf_, len) >= zeroCopyEgressThreshold_) {
+      flags |= folly::WriteFlags::WRITE_MSG_ZEROCOPY;
+      trackZeroCopyRelease(*writeBuf, len);
+    }
     CHECK(!pendingWrite_.hasValue());
     pendingWrite_.emplace(len, DestructorGuard(this));
 
@@ -2259,6 +3012,15 @@ void HTTPSession::runLoopCallback() noexcept {
       break;
     }
     // writeChain can result in a writeError and trigger the shutdown code path
+    loopBytes += len;
+    if (maxLoopBytes > 0 && loopBytes >= maxLoopBytes) {
+      // The rest goes out in the next iteration, below
+      if (hasMoreWrites()) {
+        VLOG(4) << *this << " yielding after " << loopBytes << " bytes";
+        LoopBudget::get().onWriteYield();
+      }
+      break;
+    }
   }
   if (numActiveWrites_ == 0 && !writesShutdown() && hasMoreWrites() &&
       (!connFlowControl_ || connFlowControl_->getAvailableSend())) {
@@ -2266,10 +3028,11 @@ void HTTPSession::runLoopCallback() noexcept {
   }
 
   if (readsUnpaused()) {
+    readsYielded_ = false;
     processReadData();
 
     // Install the read callback if necessary
-    if (readsUnpaused() && !sock_->getReadCallback()) {
+    if (readsUnpaused() && !readsYielded_ && !sock_->getReadCallback()) {
       sock_->setReadCB(this);
     }
   }
@@ -2281,10 +3044,22 @@ void HTTPSession::scheduleWrite() {
   // the end of the current event loop iteration.  Writing in a
   // batch helps us packetize the network traffic more efficiently,
   // as well as saving a few system calls.
-  if (!isLoopCallbackScheduled() &&
-      (writeBuf_.front() || !txnEgressQueue_.empty())) {
+  bool thisIteration =
+      (writeInCurrentLoop_ || txnWriteInCurrentLoop_) && !inLoopCallback_;
+  // A callback already scheduled may be waiting for the next iteration
+  bool reschedule =
+      txnWriteInCurrentLoop_ && thisIteration && isLoopCallbackScheduled();
+  txnWriteInCurrentLoop_ = false;
+  if (reschedule) {
+    cancelLoopCallback();
+  }
+  if (reschedule || (!isLoopCallbackScheduled() &&
+                     (writeBuf_.front() || !isEgressQueueEmpty()))) {
     VLOG(5) << *this << " scheduling write callback";
-    sock_->getEventBase()->runInLoop(this);
+    FOLLY_SDT(proxygen, session_schedule_write, this, writeBuf_.chainLength());
+    // Rescheduling from the write callback itself waits for the next
+    // iteration either way, so a blocked socket can't spin the loop
+    sock_->getEventBase()->runInLoop(this, thisIteration);
   }
 }
 
@@ -2687,6 +3462,7 @@ HTTPTransaction* HTTPSession::createTransaction(
   }
 
   if (transactions_.empty()) {
+    wakeUp();
     if (pingProber_) {
       pingProber_->startProbes();
     }
@@ -2706,7 +3482,7 @@ HTTPTransaction* HTTPSession::createTransaction(
                             streamID,
                             getNumTxnServed(),
                             *this,
-                            txnEgressQueue_,
+                            getEgressQueue(),
                             wheelTimer_.getWheelTimer(),
                             wheelTimer_.getDefaultTimeout(),
                             sessionStats_,
@@ -2723,6 +3499,7 @@ HTTPTransaction* HTTPSession::createTransaction(
   transactionIds_.emplace(streamID);
 
   HTTPTransaction* txn = &matchPair.first->second;
+  txn->setEgressPacer(egressPacer_.get());
 
   if (getNumTxnServed() > 0) {
     auto stats = txn->getSessionStats();
@@ -2737,6 +3514,16 @@ HTTPTransaction* HTTPSession::createTransaction(
   ++liveTransactions_;
   incrementSeqNo();
   txn->setReceiveWindow(receiveStreamWindowSize_);
+  if (requestSampling_) {
+    txn->setRequestSampling(requestSampling_);
+  }
+  // Undecided keyed ones drop theirs if unsampled, see decideSampling()
+  if (recordsTransactionTimings() && txn->isSampled()) {
+    txn->enableTimings();
+  }
+  if (isLazyIdleTimeoutsEnabled()) {
+    txn->enableLazyIdleTimeout();
+  }
 
   if (isUpstream() && !txn->isPushed()) {
     incrementOutgoingStreams(txn);
@@ -2770,6 +3557,7 @@ void HTTPSession::writeSuccess() noexcept {
   CHECK(pendingWrite_.hasValue());
   DestructorGuard dg(this);
   auto bytesWritten = pendingWrite_->first;
+  FOLLY_SDT(proxygen, session_write_success, this, bytesWritten);
   bytesWritten_ += bytesWritten;
   transportInfo_.totalBytes += bytesWritten;
   CHECK(writeTimeout_.isScheduled());
@@ -2824,11 +3612,13 @@ void HTTPSession::writeSuccess() noexcept {
             << bytesWritten_ << ", limit set to " << egressBytesLimit_ << ")";
     shutdownTransport(true, true);
   }
+  maybeHibernate();
 }
 
 void HTTPSession::writeErr(size_t bytesWritten,
                            const AsyncSocketException& ex) noexcept {
   VLOG(4) << *this << " write error: " << ex.what();
+  FOLLY_SDT(proxygen, session_write_error, this, bytesWritten);
   DestructorGuard dg(this);
   DCHECK(pendingWrite_.hasValue());
   pendingWrite_.reset();
@@ -2917,22 +3707,68 @@ void HTTPSession::pauseReadsImpl() {
   if (infoCallback_) {
     infoCallback_->onIngressPaused(*this);
   }
-  cancelTimeout();
+  cancelIdleTimeout();
   sock_->setReadCB(nullptr);
+  releasePooledReadBuf();
   reads_ = SocketState::PAUSED;
 }
 
 void HTTPSession::resumeReads() {
-  if (!readsPaused() ||
+  if (!readsPaused() || memoryReadsPaused_ ||
       (codec_->supportsParallelRequests() && ingressLimitExceeded())) {
     return;
   }
   resumeReadsImpl();
 }
 
+void HTTPSession::checkMemoryPressure() {
+  auto& governor = MemoryGovernor::get();
+  if (!governor.isEnabled() && !memoryThrottled_) {
+    return;
+  }
+  governor.update();
+  auto scale = governor.getScale();
+  if (connFlowControl_) {
+    uint32_t limit = 0;
+    if (scale < MemoryGovernor::kScaleOne) {
+      limit = governor.scale(receiveSessionWindowSize_);
+    }
+    if (limit != connFlowControl_->getReceiveWindowLimit()) {
+      VLOG(4) << *this << " receive window limit=" << limit;
+      connFlowControl_->setReceiveWindowLimit(limit);
+      if (connFlowControl_->flushWindowUpdate(writeBuf_)) {
+        scheduleWrite();
+      }
+    }
+  }
+
+  bool pause = governor.isUnderPressure() &&
+               pendingReadSize_ + pendingWriteSize_ >=
+                   governor.getLargeConsumerBytes();
+  if (pause != memoryReadsPaused_) {
+    memoryReadsPaused_ = pause;
+    if (pause) {
+      VLOG(3) << *this << " pausing reads under memory pressure";
+      codec_->setParserPaused(true);
+      if (readsUnpaused()) {
+        pauseReadsImpl();
+      }
+    } else {
+      VLOG(3) << *this << " resuming reads, memory pressure relieved";
+      resumeReads();
+    }
+  }
+
+  memoryThrottled_ = scale < MemoryGovernor::kScaleOne || memoryReadsPaused_;
+  if (memoryThrottled_ && !memoryPressureTimeout_.isScheduled()) {
+    wheelTimer_.scheduleTimeout(&memoryPressureTimeout_,
+                                MemoryGovernor::kUpdateInterval);
+  }
+}
+
 void HTTPSession::resumeReadsImpl() {
   VLOG(4) << *this << ": resuming reads";
-  resetTimeout();
+  refreshIdleTimeout();
   reads_ = SocketState::UNPAUSED;
   codec_->setParserPaused(false);
   if (!isLoopCallbackScheduled()) {
@@ -2943,10 +3779,10 @@ void HTTPSession::resumeReadsImpl() {
 bool HTTPSession::hasMoreWrites() const {
   VLOG(10) << __PRETTY_FUNCTION__ << " numActiveWrites_: " << numActiveWrites_
            << " pendingWrite_.hasValue(): " << pendingWrite_.hasValue()
-           << " txnEgressQueue_.empty(): " << txnEgressQueue_.empty();
+           << " isEgressQueueEmpty(): " << isEgressQueueEmpty();
 
   return (numActiveWrites_ != 0) || pendingWrite_.hasValue() ||
-         writeBuf_.front() || !txnEgressQueue_.empty();
+         writeBuf_.front() || !isEgressQueueEmpty();
 }
 
 void HTTPSession::errorOnAllTransactions(ProxygenError err,
@@ -2992,7 +3828,7 @@ void HTTPSession::onConnectionSendWindowOpen() {
 }
 
 void HTTPSession::onConnectionSendWindowClosed() {
-  if (!txnEgressQueue_.empty()) {
+  if (!isEgressQueueEmpty()) {
     VLOG(4) << *this << " session stalled by flow control";
     if (sessionStats_) {
       sessionStats_->recordSessionStalled();
@@ -3089,6 +3925,27 @@ bool HTTPSession::isDetachable(bool checkSocket) const {
          !writeTimeout_.isScheduled() && !drainTimeout_.isScheduled();
 }
 
+void HTTPSession::onEgressPacerChanged() {
+  invokeOnAllTransactions([this](HTTPTransaction* txn) {
+    txn->setEgressPacer(egressPacer_.get());
+  });
+#ifdef SO_MAX_PACING_RATE
+  auto sock = sock_->getUnderlyingTransport<AsyncSocket>();
+  if (!sock) {
+    return;
+  }
+  // ~0U is unlimited
+  uint32_t rate = std::numeric_limits<uint32_t>::max();
+  if (egressPacer_) {
+    rate = std::min<uint64_t>(
+        egressPacer_->getSessionBucket().getBytesPerSecond(), rate - 1);
+  }
+  if (sock->setSockOpt(SOL_SOCKET, SO_MAX_PACING_RATE, &rate) != 0) {
+    VLOG(4) << "Failed to set SO_MAX_PACING_RATE " << *this;
+  }
+#endif
+}
+
 void HTTPSession::invokeOnAllTransactions(
     folly::Function<void(HTTPTransaction*)> fn) {
   DestructorGuard g(this);
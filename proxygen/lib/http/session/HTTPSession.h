@@ -25,12 +25,16 @@
 #include <proxygen/lib/http/codec/FlowControlFilter.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/http/session/BDPEstimator.h>
 #include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/EgressBudgetAllocator.h>
+#include <proxygen/lib/http/session/ExtensiblePriorityQueue.h>
 #include <proxygen/lib/http/session/HTTPEvent.h>
 #include <proxygen/lib/http/session/HTTPSessionActivityTracker.h>
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 #include <proxygen/lib/http/session/HTTPTransaction.h>
 #include <proxygen/lib/http/session/SecondaryAuthManagerBase.h>
+#include <proxygen/lib/utils/LazyTimeout.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
 #include <queue>
 #include <set>
@@ -130,6 +134,48 @@ class HTTPSession
                       size_t receiveStreamWindowSize,
                       size_t receiveSessionWindowSize) override;
 
+  /**
+   * Grow the receive windows of the session and its streams, up to
+   * maxWindow bytes, to the bandwidth-delay product estimated from PINGs
+   * sent along with ingress body.  Growth is reserved from the process wide
+   * ReceiveWindowBudget.  0 disables it.
+   */
+  void setReceiveWindowAutotuning(uint32_t maxWindow);
+
+  uint32_t getMaxAutotunedReceiveWindow() const {
+    return maxAutotunedReceiveWindow_;
+  }
+
+  /**
+   * Hold back the stream and session WINDOW_UPDATEs due while processing
+   * ingress, and write them from the loop callback, at most one per stream.
+   * Many concurrent uploads then take fewer frames per write.
+   */
+  void setWindowUpdateBatching(bool enabled);
+
+  bool isWindowUpdateBatchingEnabled() const {
+    return batchWindowUpdates_;
+  }
+
+  /**
+   * Size HTTP/2 DATA frames, and the body budget of each write loop, to the
+   * connection instead of the fixed defaults: frames grow with the TCP
+   * congestion window up to the peer's SETTINGS_MAX_FRAME_SIZE, and over
+   * TLS fill whole records.  Bulk transfers take fewer frames, while a
+   * connection with a small window keeps frames of one record.
+   */
+  void setAdaptiveEgressFrameSize(bool enabled);
+
+  /**
+   * Over TLS, start with records that fit a single TCP segment, so the
+   * first bytes of a response can be decrypted as soon as they arrive, and
+   * move to full records once the connection has written 1MB without going
+   * idle.  Writes are cut on record boundaries while more egress is
+   * pending, and HTTP/2 DATA frames fit small records.  Record sizes only
+   * change on AsyncSSLSocket transports.
+   */
+  void setDynamicTLSRecordSize(bool enabled);
+
   /**
    * Set outgoing settings for this session
    */
@@ -143,6 +189,87 @@ class HTTPSession
     HTTPSessionBase::setHTTP2PrioritiesEnabled(enabled);
   }
 
+  /**
+   * Schedule egress using RFC 9218 urgency and incremental parameters from
+   * the Priority header instead of the HTTP/2 dependency tree.  Only has an
+   * effect on multiplexed codecs, and must be called before the first
+   * transaction is created.
+   */
+  void setUseExtensiblePriorities(bool enabled);
+
+  bool getUseExtensiblePriorities() const {
+    return extensibleEgressQueue_ != nullptr;
+  }
+
+  /**
+   * Cap the body bytes buffered across all transactions on this session.
+   * The budget is split into per-transaction egress buffer limits according
+   * to priority and measured drain rate, and rebalanced every
+   * kEgressBudgetInterval while the session is writing.  0 removes the
+   * budget and restores the process-wide per-transaction limit.
+   */
+  void setEgressBudget(uint64_t bytes);
+
+  uint64_t getEgressBudget() const {
+    return egressBudgetAllocator_ ? egressBudgetAllocator_->getBudget() : 0;
+  }
+
+  static constexpr std::chrono::milliseconds kEgressBudgetInterval{50};
+
+  /**
+   * HTTP/1.x downstream: parse and dispatch up to maxRequests pipelined
+   * requests at once rather than one at a time.  Responses behind the first
+   * are held in their transactions and sent in request order; their body is
+   * limited to maxHeldEgressBytes across the connection (0 for the
+   * process-wide per-transaction limit).  Reads pause beyond maxRequests.
+   */
+  void setMaxPipelinedRequests(uint32_t maxRequests,
+                               uint64_t maxHeldEgressBytes);
+
+  uint32_t getMaxPipelinedRequests() const {
+    return maxPipelinedRequests_;
+  }
+
+  /**
+   * Request MSG_ZEROCOPY for writes carrying at least threshold body bytes.
+   * The transport holds the written buffers until the kernel reports
+   * completion, and the session keeps them counted as pending egress until
+   * they are released.  Transports without zero copy enabled ignore the
+   * request.  0 (the default) disables.
+   */
+  void setZeroCopyEgressThreshold(uint64_t threshold) {
+    zeroCopyEgressThreshold_ = threshold;
+  }
+
+  uint64_t getZeroCopyEgressThreshold() const {
+    return zeroCopyEgressThreshold_;
+  }
+
+  /**
+   * Egress generated outside of the session's write callback, say by a
+   * handler replying from its own loop callback, is written in the same
+   * event loop iteration instead of the next one.  Trades batching for
+   * latency.
+   */
+  void setWriteInCurrentLoop(bool enabled) {
+    writeInCurrentLoop_ = enabled;
+  }
+
+  /**
+   * Caps the bytes written in one loop callback.  Past it a session with
+   * more egress yields to the other sessions of its EventBase and writes the
+   * rest in the next iteration, even if the socket is still writable.  0,
+   * the default, only bounds the number of writes.
+   */
+  void setMaxEgressBytesPerLoop(uint64_t maxBytes) {
+    maxEgressBytesPerLoop_ = maxBytes;
+  }
+
+  // Bytes of zero copy writes not yet released by the transport
+  uint64_t getZeroCopyBytesInFlight() const {
+    return zeroCopyBytesInFlight_;
+  }
+
   folly::Optional<HTTPTransaction::ConnectionToken> getConnectionToken()
       const noexcept override {
     return connectionToken_;
@@ -171,12 +298,37 @@ class HTTPSession
    */
   void setMaxConcurrentIncomingStreams(uint32_t num) override;
 
+  /**
+   * Changes the maximum number of transactions the remote can open at once
+   * after the session started, sending it in a SETTINGS frame.  A higher
+   * limit applies at once, a lower one once the peer acknowledges it, so
+   * it does not refuse streams the peer opened before knowing it.
+   */
+  void changeMaxConcurrentIncomingStreams(uint32_t num);
+
   /**
    * Set the maximum number of bytes allowed to be egressed in the session
    * before cutting it off
    */
   void setEgressBytesLimit(uint64_t bytesLimit);
 
+  /**
+   * Hibernation: once the session has no transactions and nothing left to
+   * write, it frees what it rebuilds on demand, the codec's spare header
+   * table storage and the HTTP/2 encoder's table, the priority tree's node
+   * pool and the emptied stream maps.  The next read or transaction wakes
+   * it up, growing them back as needed.  For many mostly idle connections,
+   * where memory rather than CPU is the limit.
+   */
+  void setHibernateWhenIdle(bool enabled);
+
+  // Hibernates now if idle; returns whether it did
+  bool hibernate();
+
+  bool isHibernating() const {
+    return hibernating_;
+  }
+
   /**
    * If set to true, HTTPSession will abort the push streams when receiving
    * a STREAM_RST on the associated stream.
@@ -231,6 +383,9 @@ class HTTPSession
 
   // public ManagedConnection methods
   void timeoutExpired() noexcept override {
+    if (httpSessionActivityTracker_) {
+      httpSessionActivityTracker_->flushActivity();
+    }
     readTimeoutExpired();
   }
 
@@ -443,6 +598,8 @@ class HTTPSession
   bool isBufferMovable() noexcept override;
   void readBufferAvailable(std::unique_ptr<folly::IOBuf>) noexcept override;
   void processReadData();
+  // Hands pooledReadBuf_ back to the pool, when a read brought nothing
+  void releasePooledReadBuf();
   void readEOF() noexcept override;
   void readErr(const folly::AsyncSocketException&) noexcept override;
 
@@ -481,6 +638,7 @@ class HTTPSession
   void onWindowUpdate(HTTPCodec::StreamID stream, uint32_t amount) override;
   void onSettings(const SettingsList& settings) override;
   void onSettingsAck() override;
+  void onOrigin(const std::vector<std::string>& origins) override;
   void onPriority(HTTPCodec::StreamID stream,
                   const HTTPMessage::HTTP2Priority&) override;
   void onPriority(HTTPCodec::StreamID, const HTTPPriority&) override;
@@ -604,6 +762,9 @@ class HTTPSession
    */
   void scheduleWrite();
 
+  // Stops parsing for this callback, see LoopBudget
+  void yieldReads();
+
   /**
    * Update the size of the unwritten egress data and invoke
    * callbacks if the size has crossed the buffering limit.
@@ -689,6 +850,9 @@ class HTTPSession
    */
   void invokeOnAllTransactions(folly::Function<void(HTTPTransaction*)> fn);
 
+  // Also caps the kernel pacing rate of the socket, where supported
+  void onEgressPacerChanged() override;
+
   /**
    * This function invokes a callback on all transactions. It is safe,
    * but runs in O(n*log n) and if the callback *adds* transactions,
@@ -756,6 +920,29 @@ class HTTPSession
   /** Chain of ingress IOBufs */
   folly::IOBufQueue readBuf_{folly::IOBufQueue::cacheChainLength()};
 
+  /** Buffer borrowed from ReadBufferPool for the read in progress */
+  std::unique_ptr<folly::IOBuf> pooledReadBuf_;
+
+  // Releases pooledReadBuf_ at the end of the loop iteration it was
+  // borrowed in, as the read after one filling the buffer usually finds
+  // nothing
+  class ReadBufferRelease : public folly::EventBase::LoopCallback {
+   public:
+    explicit ReadBufferRelease(HTTPSession* session) : session_(session) {
+    }
+
+    void runLoopCallback() noexcept override {
+      session_->releasePooledReadBuf();
+    }
+
+   private:
+    HTTPSession* session_;
+  };
+  ReadBufferRelease readBufferRelease_{this};
+
+  /** Unparsed bytes accounted as pinned in ReadBufferPool */
+  size_t pinnedReadBytes_{0};
+
   folly::F14NodeMap<HTTPCodec::StreamID, HTTPTransaction> transactions_;
   folly::F14FastSet<HTTPCodec::StreamID> transactionIds_;
 
@@ -834,6 +1021,41 @@ class HTTPSession
 
   http2::PriorityUpdate getMessagePriority(const HTTPMessage* msg);
 
+  /**
+   * The queue transactions signal egress on, either txnEgressQueue_ or
+   * extensibleEgressQueue_.
+   */
+  HTTP2PriorityQueueBase& getEgressQueue() {
+    if (extensibleEgressQueue_) {
+      return *extensibleEgressQueue_;
+    }
+    return txnEgressQueue_;
+  }
+
+  bool isEgressQueueEmpty() const {
+    return extensibleEgressQueue_ ? extensibleEgressQueue_->empty()
+                                  : txnEgressQueue_.empty();
+  }
+
+  // Apply the Priority header in msg to streamID in extensibleEgressQueue_
+  void updateExtensiblePriority(HTTPCodec::StreamID streamID,
+                                const HTTPMessage& msg);
+
+  // Recompute per-transaction egress limits if the interval has passed
+  void maybeRebalanceEgressBudget();
+
+  void rebalanceEgressBudget();
+
+  // Relative priority of txn for the egress budget, larger is more important
+  uint32_t getEgressBudgetWeight(const HTTPTransaction& txn) const;
+
+  /**
+   * Appends an empty buffer to a zero copy write whose release, when the
+   * transport frees the chain, calls onZeroCopyReleased(len).
+   */
+  void trackZeroCopyRelease(folly::IOBuf& writeBuf, uint64_t len);
+  void onZeroCopyReleased(uint64_t len);
+
   bool isConnWindowFull() const {
     return connFlowControl_ && connFlowControl_->getAvailableSend() == 0;
   }
@@ -909,6 +1131,12 @@ class HTTPSession
   bool maybeResumePausedPipelinedTransaction(size_t oldStreamCount,
                                              uint32_t txnSeqn);
 
+  // Holds the egress of txn if responses are due ahead of it
+  void holdPipelinedEgress(HTTPTransaction* txn);
+
+  // Releases the egress of the response due after finished
+  void releasePipelinedEgress(HTTPTransaction* finished);
+
   void incrementOutgoingStreams(HTTPTransaction* txn);
   void incrementIncomingStreams(HTTPTransaction* txn);
 
@@ -936,6 +1164,10 @@ class HTTPSession
    */
   FlowControlFilter* connFlowControl_{nullptr};
 
+  // Whether the codec chain has HTTPChecks, on its own or composed into
+  // connFlowControl_
+  bool httpChecksInstalled_{false};
+
   /**
    * The received setting for the maximum number of concurrent
    * transactions that this session may create. We may assume the
@@ -952,6 +1184,40 @@ class HTTPSession
    */
   uint32_t maxConcurrentIncomingStreams_{kDefaultMaxConcurrentIncomingStreams};
 
+  /**
+   * A lower maxConcurrentIncomingStreams_, applied on the next SETTINGS ack.
+   */
+  folly::Optional<uint32_t> pendingMaxConcurrentIncomingStreams_;
+
+  /**
+   * When the last read completed, when recording transaction timings.
+   */
+  TimePoint lastReadTime_;
+
+  // The session stats get latencies computed from the timings too
+  bool recordsTransactionTimings() const {
+    return isTransactionTimingsEnabled() || sessionStats_;
+  }
+
+  // Pushes back the idle timeout, lazily when enabled
+  void refreshIdleTimeout();
+  bool isIdleTimeoutScheduled() const;
+  void cancelIdleTimeout();
+  // Only from the timer, unlike timeoutExpired() which the ConnectionManager
+  // also calls to drop idle connections
+  void lazyIdleTimeoutExpired() noexcept;
+
+  LazyTimeout lazyIdleTimeout_;
+
+  // Hibernates if enabled and idle
+  void maybeHibernate();
+  void wakeUp() {
+    hibernating_ = false;
+  }
+
+  bool hibernateWhenIdle_{false};
+  bool hibernating_{false};
+
   /**
    * The number concurrent transactions initiated by this session
    */
@@ -982,9 +1248,37 @@ class HTTPSession
    */
   HTTP2PriorityQueue::NextEgressResult nextEgressResults_;
 
-  std::shared_ptr<ByteEventTracker> byteEventTracker_{nullptr};
+  /**
+   * Urgency-bucketed egress scheduler, used in place of txnEgressQueue_ when
+   * extensible priorities are enabled.
+   */
+  std::unique_ptr<ExtensiblePriorityQueue> extensibleEgressQueue_;
+
+  std::unique_ptr<EgressBudgetAllocator> egressBudgetAllocator_;
+  std::vector<EgressBudgetAllocator::Entry> egressBudgetEntries_;
+  TimePoint lastEgressBudgetRebalance_;
+  // Sum of the limits from the last rebalance, as reported to sessionStats_
+  uint64_t egressBudgetAllocated_{0};
+
+  uint32_t maxPipelinedRequests_{1};
+  uint64_t maxHeldEgressBytes_{0};
+
+  uint64_t zeroCopyEgressThreshold_{0};
+  bool writeInCurrentLoop_{false};
+  // Set by the egress of a transaction that writes in the current loop
+  bool txnWriteInCurrentLoop_{false};
+  // Parsing stopped at the read slice of LoopBudget
+  bool readsYielded_{false};
+  uint64_t maxEgressBytesPerLoop_{0};
+  uint64_t zeroCopyBytesInFlight_{0};
+  // Shared with the release buffers of zero copy writes, which the transport
+  // may free after the session is gone.  session is cleared on destruction.
+  struct ZeroCopyReleaseState {
+    HTTPSession* session;
+  };
+  std::shared_ptr<ZeroCopyReleaseState> zeroCopyReleaseState_;
 
-  std::unique_ptr<HTTPSessionActivityTracker> httpSessionActivityTracker_;
+  std::shared_ptr<ByteEventTracker> byteEventTracker_{nullptr};
 
   HTTPTransaction* lastTxn_{nullptr};
 
@@ -998,6 +1292,53 @@ class HTTPSession
   size_t receiveStreamWindowSize_{0};
   size_t receiveSessionWindowSize_{0};
 
+  // Receive window autotuning, see setReceiveWindowAutotuning
+  void onAutotuneBytesReceived(uint64_t bytes);
+  void onBDPPingReply();
+  uint32_t maxAutotunedReceiveWindow_{0};
+  std::unique_ptr<BDPEstimator> bdpEstimator_;
+  uint64_t bdpPingData_{0};
+  // Bytes reserved from ReceiveWindowBudget
+  uint64_t autotunedWindowBytes_{0};
+
+  /**
+   * Applies the MemoryGovernor's pressure: caps the session receive window
+   * at its scale, and pauses reads while this session is one of the large
+   * consumers.  Rechecks every kUpdateInterval while throttled, to recover.
+   */
+  void checkMemoryPressure();
+  bool memoryReadsPaused_{false};
+  bool memoryThrottled_{false};
+
+  // Window update batching, see setWindowUpdateBatching
+  void scheduleWindowUpdateFlush();
+  void flushWindowUpdates();
+  bool batchWindowUpdates_{false};
+  // Bytes to ack per stream
+  folly::F14FastMap<HTTPCodec::StreamID, uint32_t> pendingWindowUpdates_;
+
+  // Adaptive egress frame sizing, see setAdaptiveEgressFrameSize
+  void updateEgressFrameSize();
+  bool adaptiveEgressFrameSize_{false};
+  // DATA frame size in use, 0 for the codec's default
+  uint32_t egressFrameSize_{0};
+  // bytesWritten_ at which to sample the congestion window again
+  uint64_t nextEgressFrameSizeUpdate_{0};
+  void applyEgressDataFrameSize();
+
+  // Dynamic TLS record sizing, see setDynamicTLSRecordSize
+  void updateTLSRecordSize();
+  bool setTLSRecordSize(uint32_t size);
+  std::unique_ptr<folly::IOBuf> splitTLSRecords(
+      std::unique_ptr<folly::IOBuf> buf) const;
+  bool dynamicTLSRecordSize_{false};
+  // Record size in use, 0 until the first write
+  uint32_t tlsRecordSize_{0};
+  uint64_t tlsRecordWarmupStart_{0};
+  TimePoint lastTLSRecordWrite_;
+  // The transport's own min write size, restored on full records
+  folly::Optional<size_t> tlsMinWriteSize_;
+
   class ShutdownTransportCallback : public folly::EventBase::LoopCallback {
    public:
     explicit ShutdownTransportCallback(HTTPSession* session)
@@ -1063,6 +1404,36 @@ class HTTPSession
   };
   DrainTimeout drainTimeout_;
 
+  class MemoryPressureTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit MemoryPressureTimeout(HTTPSession* session) : session_(session) {
+    }
+
+    void timeoutExpired() noexcept override {
+      session_->checkMemoryPressure();
+    }
+
+   private:
+    HTTPSession* session_;
+  };
+  MemoryPressureTimeout memoryPressureTimeout_;
+
+  // Scheduled instead of the ManagedConnection timeout with lazy idle
+  // timeouts
+  class LazyIdleTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit LazyIdleTimeout(HTTPSession* session) : session_(session) {
+    }
+
+    void timeoutExpired() noexcept override {
+      session_->lazyIdleTimeoutExpired();
+    }
+
+   private:
+    HTTPSession* session_;
+  };
+  LazyIdleTimeout lazyIdleTimeoutCb_;
+
   class PingProber : public folly::HHWheelTimer::Callback {
    public:
     PingProber(HTTPSession& session,
@@ -8,15 +8,46 @@
 
 #include <proxygen/lib/http/session/HTTPSessionAcceptor.h>
 
+#include <fizz/experimental/ktls/AsyncFizzBaseKTLS.h>
+#include <fizz/experimental/ktls/KTLS.h>
+#include <fizz/server/AsyncFizzServer.h>
+#include <folly/String.h>
+#include <folly/net/NetOps.h>
 #include <proxygen/lib/http/codec/HTTP1xCodec.h>
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/HTTPDefaultSessionCodecFactory.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
+#include <proxygen/lib/ssl/ThreadLocalSSLStats.h>
 
 using folly::SocketAddress;
 using std::string;
 using std::unique_ptr;
 
+namespace {
+
+void setBusyPoll(folly::AsyncTransport& sock, uint32_t micros) {
+#if defined(SO_BUSY_POLL)
+  auto asyncSock = sock.getUnderlyingTransport<folly::AsyncSocket>();
+  if (!asyncSock) {
+    return;
+  }
+  int value = micros;
+  if (folly::netops::setsockopt(asyncSock->getNetworkSocket(),
+                                SOL_SOCKET,
+                                SO_BUSY_POLL,
+                                &value,
+                                sizeof(value)) != 0) {
+    VLOG(2) << "Failed to set SO_BUSY_POLL=" << micros << ": "
+            << folly::errnoStr(errno);
+  }
+#else
+  (void)sock;
+  (void)micros;
+#endif
+}
+
+} // namespace
+
 namespace proxygen {
 
 const SocketAddress HTTPSessionAcceptor::unknownSocketAddress_("0.0.0.0", 0);
@@ -49,13 +80,75 @@ const HTTPErrorPage* HTTPSessionAcceptor::getErrorPage(
   return errorPage;
 }
 
+void HTTPSessionAcceptor::updateSessionSettings(
+    const SessionSettings& settings) {
+  accConfig_.transactionIdleTimeout = settings.transactionIdleTimeout;
+  accConfig_.maxConcurrentIncomingStreams =
+      settings.maxConcurrentIncomingStreams;
+  accConfig_.initialReceiveWindow = settings.initialReceiveWindow;
+  accConfig_.receiveStreamWindowSize = settings.receiveStreamWindowSize;
+  accConfig_.receiveSessionWindowSize = settings.receiveSessionWindowSize;
+  // Sessions copy the timer when created
+  if (timer_) {
+    timer_->setDefaultTimeout(settings.transactionIdleTimeout);
+  }
+
+  // Changing the windows of running streams is not worth the risk
+  if (!settings.maxConcurrentIncomingStreams) {
+    return;
+  }
+  if (auto connectionManager = getConnectionManager()) {
+    connectionManager->iterateConns([&](wangle::ManagedConnection* conn) {
+      if (auto session = dynamic_cast<HTTPSession*>(conn)) {
+        session->changeMaxConcurrentIncomingStreams(
+            settings.maxConcurrentIncomingStreams);
+      }
+    });
+  }
+}
+
+void HTTPSessionAcceptor::drainSessions(
+    std::chrono::milliseconds window,
+    std::shared_ptr<DrainScheduler::Progress> progress,
+    folly::Function<void()> onDone) {
+  if (!drainScheduler_) {
+    drainScheduler_ = std::make_unique<DrainScheduler>(
+        getEventBase(), *this, std::move(progress));
+  }
+  drainScheduler_->start(window, std::move(onDone));
+}
+
+void HTTPSessionAcceptor::visit(
+    folly::FunctionRef<bool(const HTTPSessionBase&)> shouldDrain) {
+  auto connectionManager = getConnectionManager();
+  if (!connectionManager) {
+    return;
+  }
+  // Draining may close a session, so not while iterating
+  std::vector<HTTPSession*> sessions;
+  connectionManager->iterateConns([&](wangle::ManagedConnection* conn) {
+    auto session = dynamic_cast<HTTPSession*>(conn);
+    if (session && !session->isDraining() && shouldDrain(*session)) {
+      sessions.push_back(session);
+    }
+  });
+  for (auto session : sessions) {
+    session->drain();
+  }
+}
+
 void HTTPSessionAcceptor::onNewConnection(folly::AsyncTransport::UniquePtr sock,
                                           const SocketAddress* peerAddress,
                                           const string& nextProtocol,
                                           wangle::SecureTransportType,
                                           const wangle::TransportInfo& tinfo) {
+  sock = maybeOffloadToKernelTLS(std::move(sock));
+  prepareTransport(*sock);
+  if (accConfig_.busyPollMicros > 0) {
+    setBusyPoll(*sock, accConfig_.busyPollMicros);
+  }
 
-  unique_ptr<HTTPCodec> codec = codecFactory_->getCodec(
+  unique_ptr<HTTPCodec> codec = getConnCodecFactory().getCodec(
       nextProtocol,
       TransportDirection::DOWNSTREAM,
       // we assume if security protocol isn't empty, then it's TLS
@@ -116,12 +209,83 @@ void HTTPSessionAcceptor::onNewConnection(folly::AsyncTransport::UniquePtr sock,
   session->setFlowControl(accConfig_.initialReceiveWindow,
                           accConfig_.receiveStreamWindowSize,
                           accConfig_.receiveSessionWindowSize);
+  if (accConfig_.maxAutotunedReceiveWindow > 0) {
+    session->setReceiveWindowAutotuning(accConfig_.maxAutotunedReceiveWindow);
+  }
+  if (accConfig_.batchWindowUpdates) {
+    session->setWindowUpdateBatching(true);
+  }
+  if (accConfig_.adaptiveEgressFrameSize) {
+    session->setAdaptiveEgressFrameSize(true);
+  }
+  if (accConfig_.dynamicTLSRecordSize) {
+    session->setDynamicTLSRecordSize(true);
+  }
   if (accConfig_.writeBufferLimit > 0) {
     session->setWriteBufferLimit(accConfig_.writeBufferLimit);
   }
+  if (accConfig_.zeroCopyEgressThreshold > 0) {
+    session->setZeroCopyEgressThreshold(accConfig_.zeroCopyEgressThreshold);
+  }
+  if (accConfig_.writeInCurrentLoop) {
+    session->setWriteInCurrentLoop(true);
+  }
+  if (accConfig_.maxEgressBytesPerLoop > 0) {
+    session->setMaxEgressBytesPerLoop(accConfig_.maxEgressBytesPerLoop);
+  }
   session->setSessionStats(downstreamSessionStats_);
   Acceptor::addConnection(session);
+  if (!drainScheduler_) {
+    startSession(*session);
+    return;
+  }
+  // Accepted after drainSessions(), so its turn has come
+  HTTPSession::DestructorGuard dg(session);
   startSession(*session);
+  session->drain();
+  drainScheduler_->addDrained();
+}
+
+HTTPCodecFactory& HTTPSessionAcceptor::getConnCodecFactory() {
+  if (!connCodecFactory_) {
+    // On the acceptor's thread, so the clone's memory is local to it
+    threadCodecFactory_ = codecFactory_->clone();
+    connCodecFactory_ = threadCodecFactory_ ? threadCodecFactory_.get()
+                                            : codecFactory_.get();
+  }
+  return *connCodecFactory_;
+}
+
+folly::AsyncTransport::UniquePtr HTTPSessionAcceptor::maybeOffloadToKernelTLS(
+    folly::AsyncTransport::UniquePtr sock) {
+#if FIZZ_PLATFORM_CAPABLE_KTLS
+  if (!accConfig_.kernelTLSOffload || !sock) {
+    return sock;
+  }
+  auto fizzSock = sock->getUnderlyingTransport<fizz::server::AsyncFizzServer>();
+  if (!fizzSock) {
+    // plaintext, OpenSSL, or already converted
+    return sock;
+  }
+  auto stats = sslStats_ ? sslStats_
+                         : dynamic_cast<ProxygenSSLStats*>(getSSLStats());
+  auto ktlsSock = fizz::tryConvertKTLS(*fizzSock);
+  if (ktlsSock.hasError()) {
+    VLOG(4) << "kTLS offload failed, staying on fizz err="
+            << ktlsSock.error().what();
+    if (stats) {
+      stats->recordKTLSOffload(false);
+    }
+    return sock;
+  }
+  if (stats) {
+    stats->recordKTLSOffload(true);
+  }
+  // sock no longer owns the connection's fd
+  return std::move(ktlsSock.value());
+#else
+  return sock;
+#endif
 }
 
 size_t HTTPSessionAcceptor::dropIdleConnections(size_t num) {
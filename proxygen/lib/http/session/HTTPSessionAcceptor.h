@@ -10,6 +10,7 @@
 
 #include <folly/io/async/AsyncSSLSocket.h>
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
+#include <proxygen/lib/http/session/DrainScheduler.h>
 #include <proxygen/lib/http/session/HTTPDownstreamSession.h>
 #include <proxygen/lib/http/session/HTTPErrorPage.h>
 #include <proxygen/lib/http/session/SimpleController.h>
@@ -18,6 +19,7 @@
 namespace proxygen {
 
 class HTTPSessionStats;
+class ProxygenSSLStats;
 
 /**
  * Specialization of Acceptor that serves as an abstract base for
@@ -25,7 +27,8 @@ class HTTPSessionStats;
  */
 class HTTPSessionAcceptor
     : public HTTPAcceptor
-    , private HTTPSessionBase::InfoCallback {
+    , private HTTPSessionBase::InfoCallback
+    , private DrainScheduler::SessionSource {
  public:
   explicit HTTPSessionAcceptor(const AcceptorConfiguration& accConfig);
   explicit HTTPSessionAcceptor(const AcceptorConfiguration& accConfig,
@@ -58,10 +61,13 @@ class HTTPSessionAcceptor
       const folly::SocketAddress& addr) const;
 
   /**
-   * Set the codec factory for this session
+   * Set the codec factory for this session.  Connections use its clone() for
+   * the acceptor's thread if it has one, made on the first connection.
    */
   void setCodecFactory(std::shared_ptr<HTTPCodecFactory> codecFactory) {
     codecFactory_ = codecFactory;
+    threadCodecFactory_.reset();
+    connCodecFactory_ = nullptr;
   }
 
   /**
@@ -93,6 +99,45 @@ class HTTPSessionAcceptor
     return accConfig_.HTTP2PrioritiesEnabled;
   }
 
+  /**
+   * The AcceptorConfiguration settings that can change after the acceptor
+   * started.
+   */
+  struct SessionSettings {
+    std::chrono::milliseconds transactionIdleTimeout;
+    uint32_t maxConcurrentIncomingStreams;
+    size_t initialReceiveWindow;
+    size_t receiveStreamWindowSize;
+    size_t receiveSessionWindowSize;
+  };
+
+  /**
+   * Applies the settings to the sessions accepted from now on, and the
+   * concurrent stream limit to the sessions already accepted as well.  Call
+   * it from the EventBase of the acceptor.
+   */
+  void updateSessionSettings(const SessionSettings& settings);
+
+  /**
+   * Drains the sessions accepted so far over window, see DrainScheduler,
+   * counting them in progress if set, and those accepted later as they
+   * arrive.  Calling it again plans the sessions not drained yet over the
+   * new window, still counted in the progress of the first call.  Call it
+   * from the EventBase of the acceptor.
+   */
+  void drainSessions(
+      std::chrono::milliseconds window,
+      std::shared_ptr<DrainScheduler::Progress> progress = nullptr,
+      folly::Function<void()> onDone = nullptr);
+
+  /**
+   * Stats used to count kernel TLS offloads, instead of getSSLStats() if
+   * that is a ProxygenSSLStats.  May be nullptr.
+   */
+  void setSSLStats(ProxygenSSLStats* stats) {
+    sslStats_ = stats;
+  }
+
  protected:
   /**
    * This function is invoked when a new session is created to get the
@@ -105,6 +150,7 @@ class HTTPSessionAcceptor
   }
 
   HTTPSessionStats* downstreamSessionStats_{nullptr};
+  ProxygenSSLStats* sslStats_{nullptr};
 
   bool setEnableConnectProtocol_{false};
 
@@ -127,6 +173,13 @@ class HTTPSessionAcceptor
   virtual void onSessionCreationError(ProxygenError /*error*/) {
   }
 
+  /**
+   * Invoked with the socket of each new connection once it is final, ie
+   * after any kernel TLS offload, before a session takes it.
+   */
+  virtual void prepareTransport(folly::AsyncTransport& /*sock*/) {
+  }
+
  private:
   HTTPSessionAcceptor(const HTTPSessionAcceptor&) = delete;
   HTTPSessionAcceptor& operator=(const HTTPSessionAcceptor&) = delete;
@@ -135,11 +188,30 @@ class HTTPSessionAcceptor
   std::unique_ptr<HTTPErrorPage> defaultErrorPage_;
 
   std::shared_ptr<HTTPCodecFactory> codecFactory_{};
+  std::unique_ptr<HTTPCodecFactory> threadCodecFactory_;
+  // threadCodecFactory_ or codecFactory_, once there was a connection
+  HTTPCodecFactory* connCodecFactory_{nullptr};
+
+  HTTPCodecFactory& getConnCodecFactory();
+
+  /**
+   * If kernelTLSOffload is configured and sock is a fizz server, returns a
+   * kTLS socket that took over its connection.  Otherwise, including when the
+   * kernel rejects the cipher, returns sock unchanged.
+   */
+  folly::AsyncTransport::UniquePtr maybeOffloadToKernelTLS(
+      folly::AsyncTransport::UniquePtr sock);
 
   SimpleController simpleController_;
 
   HTTPSession::InfoCallback* sessionInfoCb_{nullptr};
 
+  // DrainScheduler::SessionSource
+  void visit(folly::FunctionRef<bool(const HTTPSessionBase&)> shouldDrain)
+      override;
+
+  std::unique_ptr<DrainScheduler> drainScheduler_;
+
   /**
    * 0.0.0.0:0, a valid address to use if getsockname() or getpeername() fails
    */
@@ -22,12 +22,41 @@ HTTPSessionActivityTracker::HTTPSessionActivityTracker(
 }
 
 void HTTPSessionActivityTracker::reportActivity() {
-  if (managedConnection_->getConnectionManager()) {
+  if (counting_) {
+    ++activityEpoch_;
+    return;
+  }
+  notifyConnectionManager();
+}
+
+void HTTPSessionActivityTracker::notifyConnectionManager() {
+  if (managedConnection_ && managedConnection_->getConnectionManager()) {
     managedConnection_->getConnectionManager()->reportActivity(
         *managedConnection_);
   }
 }
 
+bool HTTPSessionActivityTracker::flushActivity() {
+  if (flushedEpoch_ == activityEpoch_) {
+    return false;
+  }
+  flushedEpoch_ = activityEpoch_;
+  notifyConnectionManager();
+  return true;
+}
+
+folly::Optional<std::chrono::milliseconds>
+HTTPSessionActivityTracker::getIdleTime() const {
+  if (activityEpoch_ == 0) {
+    return folly::none;
+  }
+  if (datedEpoch_ != activityEpoch_) {
+    datedEpoch_ = activityEpoch_;
+    datedTime_ = getCurrentTime();
+  }
+  return millisecondsSince(datedTime_);
+}
+
 bool HTTPSessionActivityTracker::onIngressBody(size_t bytes) {
   ingressSize_ += bytes;
   if (ingressSize_ >= ingressThreshold_) {
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <folly/Optional.h>
+#include <proxygen/lib/utils/Time.h>
 #include <wangle/acceptor/ConnectionManager.h>
 
 namespace proxygen {
@@ -23,6 +25,12 @@ class HTTPTransaction;
  * significant activities. Once significant activity is detected, the connection
  * manager is notified of the event. Significant activities could be in the form
  * of read or write above threshold amount of bytes.
+ *
+ * With counting enabled, reportActivity() only advances an activity epoch
+ * instead of notifying the connection manager on every event.  The session
+ * flushes it to the connection manager from its idle timeout, at most once
+ * per timeout period, and the idle sweeper reads it through
+ * ManagedConnection::getIdleTime(), which dates each epoch lazily.
  */
 class HTTPSessionActivityTracker {
  public:
@@ -32,6 +40,29 @@ class HTTPSessionActivityTracker {
 
   virtual void reportActivity();
 
+  void setCountingEnabled(bool enabled) {
+    counting_ = enabled;
+  }
+
+  bool isCountingEnabled() const {
+    return counting_;
+  }
+
+  uint64_t getActivityEpoch() const {
+    return activityEpoch_;
+  }
+
+  // Notifies the connection manager if the epoch advanced since the last
+  // flush, returns whether it did
+  bool flushActivity();
+
+  /**
+   * Time since the epoch was first seen to advance by a call to this, none
+   * before any activity.  Activity is dated when it is queried rather than
+   * when it happens, so it looks up to one query period more recent.
+   */
+  folly::Optional<std::chrono::milliseconds> getIdleTime() const;
+
   bool onIngressBody(size_t bytes);
 
   void addTrackedEgressByteEvent(const size_t offset,
@@ -41,10 +72,17 @@ class HTTPSessionActivityTracker {
   virtual ~HTTPSessionActivityTracker() = default;
 
  private:
+  void notifyConnectionManager();
+
   wangle::ManagedConnection* managedConnection_;
   size_t ingressSize_{0};
   size_t sessionBodyOffset_{0};
   const size_t ingressThreshold_;
   const size_t egressThreshold_;
+  uint64_t activityEpoch_{0};
+  uint64_t flushedEpoch_{0};
+  mutable uint64_t datedEpoch_{0};
+  mutable TimePoint datedTime_{};
+  bool counting_{false};
 };
 } // namespace proxygen
@@ -8,10 +8,13 @@
 
 #include <proxygen/lib/http/session/HTTPSessionBase.h>
 
+#include <folly/io/async/EventBase.h>
 #include <proxygen/lib/http/codec/HTTP2Codec.h>
 #include <proxygen/lib/http/session/ByteEventTracker.h>
 #include <proxygen/lib/http/session/HTTPSessionController.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/http/session/IngressCapture.h>
+#include <proxygen/lib/http/session/MemoryGovernor.h>
 
 using folly::SocketAddress;
 using wangle::TransportInfo;
@@ -19,6 +22,7 @@ using wangle::TransportInfo;
 namespace proxygen {
 std::atomic<uint32_t> HTTPSessionBase::kDefaultReadBufLimit{65536};
 uint32_t HTTPSessionBase::maxReadBufferSize_ = 4000;
+bool HTTPSessionBase::useReadBufferPool_ = false;
 uint32_t HTTPSessionBase::egressBodySizeLimit_ = 4096;
 uint32_t HTTPSessionBase::kDefaultWriteBufLimit = 65536;
 
@@ -47,9 +51,13 @@ HTTPSessionBase::HTTPSessionBase(const SocketAddress& localAddr,
   // If we receive IPv4-mapped IPv6 addresses, convert them to IPv4.
   localAddr_.tryConvertToIPv4();
   peerAddr_.tryConvertToIPv4();
+  MemoryGovernor::get().addConsumer();
 }
 
 HTTPSessionBase::~HTTPSessionBase() {
+  auto& governor = MemoryGovernor::get();
+  governor.onBuffered(-int64_t(pendingWriteSize_ + pendingReadSize_));
+  governor.removeConsumer();
   if (sessionStats_) {
     sessionStats_->recordPendingBufferedWriteBytes(-1 *
                                                    (int64_t)pendingWriteSize_);
@@ -58,6 +66,22 @@ HTTPSessionBase::~HTTPSessionBase() {
   }
 }
 
+void HTTPSessionBase::setEgressPacing(
+    uint64_t bitsPerSecond, std::shared_ptr<EgressPacer::TokenBucket> tenant) {
+  // Kept until the transactions move off it
+  auto oldPacer = std::move(egressPacer_);
+  if (oldPacer) {
+    oldPacer->releaseAll();
+  }
+  if (bitsPerSecond >= 8) {
+    auto evb = getEventBase();
+    CHECK(evb);
+    egressPacer_ = std::make_unique<EgressPacer>(
+        &evb->timer(), bitsPerSecond, std::move(tenant));
+  }
+  onEgressPacerChanged();
+}
+
 void HTTPSessionBase::setSessionStats(HTTPSessionStats* stats) {
   if (sessionStats_ != stats && sessionStats_ != nullptr) {
     sessionStats_->recordPendingBufferedWriteBytes(-1 *
@@ -72,6 +96,14 @@ void HTTPSessionBase::setSessionStats(HTTPSessionStats* stats) {
   }
 }
 
+void HTTPSessionBase::maybeStartIngressCapture() {
+  auto& capture = IngressCapture::get();
+  if (!ingressRecorder_ && capture.isEnabled()) {
+    ingressRecorder_ = capture.maybeStartRecording(
+        getCodecProtocolString(getCodecProtocol()));
+  }
+}
+
 void HTTPSessionBase::runDestroyCallbacks() {
   if (infoCallback_) {
     infoCallback_->onDestroy(*this);
@@ -105,6 +137,7 @@ bool HTTPSessionBase::onBodyImpl(std::unique_ptr<folly::IOBuf> chain,
   CHECK_LE(pendingReadSize_,
            std::numeric_limits<uint32_t>::max() - length - padding);
   pendingReadSize_ += length + padding;
+  MemoryGovernor::get().onBuffered(length + padding);
   if (httpSessionActivityTracker_) {
     httpSessionActivityTracker_->onIngressBody(length + padding);
   }
@@ -131,6 +164,7 @@ bool HTTPSessionBase::notifyBodyProcessed(uint32_t bytes) {
   CHECK_GE(pendingReadSize_, bytes);
   auto oldSize = pendingReadSize_;
   pendingReadSize_ -= bytes;
+  MemoryGovernor::get().onBuffered(-int64_t(bytes));
   if (sessionStats_) {
     sessionStats_->recordPendingBufferedReadBytes(-1 * (int64_t)bytes);
   }
@@ -157,6 +191,32 @@ bool HTTPSessionBase::notifyEgressBodyBuffered(int64_t bytes, bool update) {
   return true;
 }
 
+void HTTPSessionBase::reportTransactionTimings(const HTTPTransaction& txn) {
+  auto timings = txn.getTimings();
+  if (!timings || !transactionTimingsEnabled_ || !txn.isSampled()) {
+    return;
+  }
+  if (infoCallback_) {
+    infoCallback_->onTransactionTimings(*this, *timings);
+  }
+  if (eventBatch_.wants(HTTPSessionEventBatch::Events::transactionTimings)) {
+    eventBatch_
+        .record(HTTPSessionEventBatch::Events::transactionTimings, txn.getID())
+        .timings = *timings;
+  }
+  if (auto observers = getHTTPSessionObserverContainer()) {
+    const auto event =
+        HTTPSessionObserverInterface::TransactionTimingsEvent::Builder()
+            .setTimings(*timings)
+            .build();
+    observers->invokeInterfaceMethod<
+        HTTPSessionObserverInterface::Events::transactionTimings>(
+        [&event](auto observer, auto observed) {
+          observer->transactionTimings(observed, event);
+        });
+  }
+}
+
 void HTTPSessionBase::updateWriteBufSize(int64_t delta) {
   // This is the sum of body bytes buffered within transactions_ and in
   // the sock_'s write buffer.
@@ -167,6 +227,7 @@ void HTTPSessionBase::updateWriteBufSize(int64_t delta) {
     sessionStats_->recordPendingBufferedWriteBytes(delta);
   }
   pendingWriteSize_ += delta;
+  MemoryGovernor::get().onBuffered(delta);
 }
 
 void HTTPSessionBase::updatePendingWrites() {
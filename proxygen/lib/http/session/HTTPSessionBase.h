@@ -13,6 +13,7 @@
 #include <folly/io/async/AsyncUDPSocket.h>
 #include <folly/io/async/SSLContext.h>
 #include <proxygen/lib/http/codec/HTTPCodecFilter.h>
+#include <proxygen/lib/http/observer/HTTPSessionEventBatch.h>
 #include <proxygen/lib/http/observer/HTTPSessionObserverContainer.h>
 #include <proxygen/lib/http/observer/HTTPSessionObserverInterface.h>
 #include <proxygen/lib/http/session/HTTPSessionActivityTracker.h>
@@ -26,6 +27,7 @@ class HTTPSessionController;
 class HTTPSessionStats;
 class HTTPTransaction;
 class ByteEventTracker;
+class IngressRecorder;
 
 constexpr uint32_t kDefaultMaxConcurrentOutgoingStreams = 100;
 
@@ -117,6 +119,14 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     }
     virtual void onSettingsAck(const HTTPSessionBase&) {
     }
+    // The origins of an HTTP/2 ORIGIN frame from the server
+    virtual void onOrigin(const HTTPSessionBase&,
+                          const std::vector<std::string>& /*origins*/) {
+    }
+    // With transaction timings enabled, as each transaction is detached
+    virtual void onTransactionTimings(const HTTPSessionBase&,
+                                      const HTTPTransactionTimings&) {
+    }
   };
 
   HTTPSessionBase(const folly::SocketAddress& localAddr,
@@ -151,6 +161,14 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     maxReadBufferSize_ = bytes;
   }
 
+  /**
+   * Borrow socket read buffers from a per-thread ReadBufferPool, returning
+   * them as soon as all the data was parsed, for all HTTPSession objects.
+   */
+  static void setUseReadBufferPool(bool enabled) {
+    useReadBufferPool_ = enabled;
+  }
+
   /**
    * Set the maximum egress body size for any outbound body bytes per loop,
    * when there are > 1 transactions.
@@ -266,6 +284,19 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   virtual void setEgressSettings(const SettingsList& inSettings) = 0;
 
+  /**
+   * Paces the body egress of all the transactions to bitsPerSecond, and to
+   * the rate of tenant if set, which other sessions of this thread may
+   * share.  0 stops pacing.  Only call on the thread of the session.
+   */
+  void setEgressPacing(
+      uint64_t bitsPerSecond,
+      std::shared_ptr<EgressPacer::TokenBucket> tenant = nullptr);
+
+  EgressPacer* getEgressPacer() const {
+    return egressPacer_.get();
+  }
+
   /**
    * Global flag for turning HTTP2 priorities off
    **/
@@ -475,6 +506,29 @@ class HTTPSessionBase : public wangle::ManagedConnection {
   virtual HTTPTransaction* newTransaction(
       HTTPTransaction::Handler* handler) = 0;
 
+  /**
+   * Whether newPipelinedTransaction() can send an idempotent request behind
+   * the outstanding ones, only ever on HTTP/1.1 upstream sessions.
+   */
+  virtual bool canPipeline() const {
+    return false;
+  }
+
+  // How long the oldest outstanding response on the session has been awaited
+  virtual std::chrono::milliseconds getPipelineHeadWait() const {
+    return std::chrono::milliseconds(0);
+  }
+
+  /**
+   * A transaction pipelined behind the outstanding ones if canPipeline(),
+   * else nullptr.  The handler must only send an idempotent request on it,
+   * since the origin may close the connection before answering it.
+   */
+  virtual HTTPTransaction* newPipelinedTransaction(
+      HTTPTransaction::Handler* /*handler*/) {
+    return nullptr;
+  }
+
   virtual bool isReplaySafe() const = 0;
 
   /**
@@ -528,6 +582,49 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     setIngressTimeoutAfterEom_ = setIngressTimeoutAfterEom;
   }
 
+  /**
+   * Records HTTPTransactionTimings for the transactions created from now
+   * on, reported to the InfoCallback and observers once each is detached.
+   */
+  void setTransactionTimingsEnabled(bool enabled) noexcept {
+    transactionTimingsEnabled_ = enabled;
+  }
+
+  bool isTransactionTimingsEnabled() const noexcept {
+    return transactionTimingsEnabled_;
+  }
+
+  /**
+   * Samples the transactions created from now on for deep tracing at rate,
+   * see HTTPTransaction::isSampled(): only sampled ones record transaction
+   * timings, for observers and the session stats' latencies, and track
+   * their first byte events.  With keyHeader, requests
+   * carrying it are sampled by its value (Sampling::isLucky(key)), the same
+   * way at every hop.  A rate of 1 samples everything again.
+   */
+  void setRequestSampling(double rate, std::string keyHeader = std::string()) {
+    if (rate >= 1.0) {
+      requestSampling_.reset();
+      return;
+    }
+    requestSampling_ = std::make_shared<const HTTPRequestSampling>(
+        HTTPRequestSampling{Sampling(rate), std::move(keyHeader)});
+  }
+
+  /**
+   * Refreshing the idle timeouts of the session and of the transactions
+   * created from now on only pushes back their deadline, instead of
+   * rescheduling them on every read, see LazyTimeout. A timeout then fires
+   * once per interval and is rescheduled for the time left, if any.
+   */
+  void setLazyIdleTimeoutsEnabled(bool enabled) noexcept {
+    lazyIdleTimeoutsEnabled_ = enabled;
+  }
+
+  bool isLazyIdleTimeoutsEnabled() const noexcept {
+    return lazyIdleTimeoutsEnabled_;
+  }
+
   /**
    * Adds an observer.
    *
@@ -589,9 +686,36 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     return false;
   }
 
+  /**
+   * Adds an observer of batches of the events of mask, of
+   * HTTPSessionEventBatch::eventBit()s, delivered once per loop of the
+   * event base of the session rather than one call per event.  Adding it
+   * again changes its mask.
+   */
+  void addEventBatchObserver(HTTPSessionEventBatch::Observer* observer,
+                             uint32_t mask) {
+    eventBatch_.addObserver(observer, mask, getEventBase());
+  }
+
+  void removeEventBatchObserver(HTTPSessionEventBatch::Observer* observer) {
+    eventBatch_.removeObserver(observer);
+  }
+
  protected:
   bool notifyEgressBodyBuffered(int64_t bytes, bool update);
 
+  // Records requestStarted for the batch observers wanting it
+  void recordRequestStarted(uint64_t streamID, const HTTPHeaders& headers) {
+    if (eventBatch_.wants(HTTPSessionEventBatch::Events::requestStarted)) {
+      eventBatch_
+          .record(HTTPSessionEventBatch::Events::requestStarted, streamID)
+          .headerCount = headers.size();
+    }
+  }
+
+  // Reports the timings of a transaction being detached, if recorded
+  void reportTransactionTimings(const HTTPTransaction& txn);
+
   void updateWriteBufSize(int64_t delta);
 
   void updatePendingWrites();
@@ -647,6 +771,12 @@ class HTTPSessionBase : public wangle::ManagedConnection {
     }
   }
 
+  /**
+   * Records the ingress of this session from now on, if IngressCapture
+   * samples it.
+   */
+  void maybeStartIngressCapture();
+
   static void handleLastByteEvents(ByteEventTracker* byteEventTracker,
                                    HTTPTransaction* txn,
                                    size_t encodedSize,
@@ -722,6 +852,11 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   static uint32_t maxReadBufferSize_;
 
+  /**
+   * Whether read buffers are borrowed from ReadBufferPool.
+   */
+  static bool useReadBufferPool_;
+
   /**
    * Maximum number of bytes that can be buffered across all transactions before
    * this session will start applying backpressure to its transactions.
@@ -749,8 +884,27 @@ class HTTPSessionBase : public wangle::ManagedConnection {
    */
   bool setIngressTimeoutAfterEom_{false};
 
+  bool transactionTimingsEnabled_{false};
+
+  // Shared with the transactions until they decide
+  std::shared_ptr<const HTTPRequestSampling> requestSampling_;
+
+  bool lazyIdleTimeoutsEnabled_{false};
+
   std::unique_ptr<HTTPSessionActivityTracker> httpSessionActivityTracker_;
 
+  // Passes the pacer of setEgressPacing(), or nullptr, to the transactions
+  virtual void onEgressPacerChanged() {
+  }
+
+  std::unique_ptr<EgressPacer> egressPacer_;
+
+  // Delivers what is left when the session goes away
+  HTTPSessionEventBatch eventBatch_;
+
+  // Set when IngressCapture samples the session
+  std::unique_ptr<IngressRecorder> ingressRecorder_;
+
  private:
   // Underlying controller_ is marked as private so that callers must utilize
   // getController/setController protected methods.  This ensures we have a
@@ -759,11 +913,18 @@ class HTTPSessionBase : public wangle::ManagedConnection {
 
   // private ManagedConnection methods
   std::chrono::milliseconds getIdleTime() const override {
-    if (timePointInitialized(latestActive_)) {
-      return millisecondsSince(latestActive_);
-    } else {
-      return std::chrono::milliseconds(0);
-    }
+    auto idleTime = timePointInitialized(latestActive_)
+                        ? millisecondsSince(latestActive_)
+                        : std::chrono::milliseconds(0);
+    if (httpSessionActivityTracker_ &&
+        httpSessionActivityTracker_->isCountingEnabled()) {
+      auto activityIdleTime = httpSessionActivityTracker_->getIdleTime();
+      if (activityIdleTime &&
+          (idleTime.count() == 0 || *activityIdleTime < idleTime)) {
+        idleTime = *activityIdleTime;
+      }
+    }
+    return idleTime;
   }
 
   /**
@@ -33,6 +33,34 @@ class HTTPSessionStats : public TTLBAStats {
   }
   virtual void recordEgressContentLengthMismatches() noexcept = 0;
   virtual void recordSessionPeriodicPingProbeTimeout() noexcept = 0;
+  // Change in the sum of per-transaction limits handed out by egress budgets
+  virtual void recordEgressBudgetAllocatedBytes(int64_t) noexcept {
+  }
+  virtual void recordEgressBudgetRebalance() noexcept {
+  }
+  // Ingress body bytes delivered as slices of the read buffer, or copied
+  virtual void recordIngressBodyZeroCopyBytes(uint64_t) noexcept {
+  }
+  virtual void recordIngressBodyCopiedBytes(uint64_t) noexcept {
+  }
+  // Per-connection QPACK compressed/uncompressed header bytes, in percent,
+  // split by whether the encoder's dynamic table was warmed
+  virtual void recordQPACKEncodeRatio(bool /* warmTable */,
+                                      uint32_t /* pct */) noexcept {
+  }
+  // Of sampled transactions, see HTTPSessionBase::setRequestSampling()
+  // From the first byte read of the ingress headers until they are parsed
+  virtual void recordIngressHeaderParseTime(
+      std::chrono::microseconds) noexcept {
+  }
+  // Downstream only: from the first byte read of the request until the first
+  // and last response bytes are written
+  virtual void recordTransactionTimeToFirstByte(
+      std::chrono::microseconds) noexcept {
+  }
+  virtual void recordTransactionTimeToLastByte(
+      std::chrono::microseconds) noexcept {
+  }
 };
 
 } // namespace proxygen
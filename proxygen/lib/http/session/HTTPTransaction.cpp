@@ -12,10 +12,12 @@
 #include <folly/Conv.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <folly/tracing/ScopedTraceSection.h>
+#include <folly/tracing/StaticTracepoint.h>
 #include <glog/logging.h>
 #include <proxygen/lib/http/HTTPHeaderSize.h>
 #include <proxygen/lib/http/RFC2616.h>
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
+#include <proxygen/lib/utils/AllocationPhase.h>
 #include <sstream>
 
 using folly::IOBuf;
@@ -89,12 +91,14 @@ HTTPTransaction::HTTPTransaction(
       flowControlPaused_(false),
       handlerEgressPaused_(false),
       egressRateLimited_(false),
+      egressHeld_(false),
       useFlowControl_(useFlowControl),
       aborted_(false),
       deleting_(false),
       firstByteSent_(false),
       firstHeaderByteSent_(false),
       inResume_(false),
+      ingressDeferred_(false),
       isCountedTowardsStreamLimit_(false),
       ingressErrorSeen_(false),
       priorityFallback_(false),
@@ -103,6 +107,8 @@ HTTPTransaction::HTTPTransaction(
       egressHeadersDelivered_(false),
       has1xxResponse_(false),
       isDelegated_(false),
+      writeInCurrentLoop_(false),
+      idempotentRequest_(false),
       idleTimeout_(defaultIdleTimeout),
       timer_(timer),
       setIngressTimeoutAfterEom_(setIngressTimeoutAfterEom) {
@@ -179,6 +185,9 @@ HTTPTransaction::~HTTPTransaction() {
   if (queueHandle_) {
     egressQueue_.removeTransaction(queueHandle_);
   }
+  if (egressPacer_) {
+    egressPacer_->remove(&pacerCallback_);
+  }
 }
 
 void HTTPTransaction::reset(bool useFlowControl,
@@ -191,9 +200,48 @@ void HTTPTransaction::reset(bool useFlowControl,
   sendWindow_.setCapacity(sendInitialWindowSize);
 }
 
+void HTTPTransaction::recordLatency(
+    TimePoint HTTPTransactionTimings::*step,
+    void (HTTPSessionStats::*record)(std::chrono::microseconds) noexcept) {
+  if (stats_ && timePointInitialized(timings_->firstHeaderByteRead)) {
+    (stats_->*record)(HTTPTransactionTimings::between(
+        timings_->firstHeaderByteRead, (*timings_).*step));
+  }
+}
+
+void HTTPTransaction::setRequestSampling(
+    std::shared_ptr<const HTTPRequestSampling> sampling) {
+  requestSampling_ = std::move(sampling);
+  if (requestSampling_ && requestSampling_->keyHeader.empty()) {
+    decideSampling(nullptr);
+  }
+}
+
+void HTTPTransaction::decideSampling(const HTTPHeaders* headers) {
+  const auto& sampling = requestSampling_->sampling;
+  const std::string* key = nullptr;
+  if (headers) {
+    key = &headers->getSingleOrEmpty(requestSampling_->keyHeader);
+  }
+  bool lucky =
+      key && !key->empty() ? sampling.isLucky(*key) : sampling.isLucky();
+  samplingWeight_ = lucky ? sampling.getWeight() : 0;
+  requestSampling_.reset();
+  if (!lucky) {
+    timings_.reset();
+  }
+}
+
 void HTTPTransaction::onIngressHeadersComplete(
     std::unique_ptr<HTTPMessage> msg) {
   DestructorGuard g(this);
+  if (markTiming(&HTTPTransactionTimings::headersParsed)) {
+    recordLatency(&HTTPTransactionTimings::headersParsed,
+                  &HTTPSessionStats::recordIngressHeaderParseTime);
+  }
+  if (requestSampling_ && msg->isRequest()) {
+    decideSampling(&msg->getHeaders());
+  }
   msg->setSeqNo(seqNo_);
   if (isUpstream() && !isPushed() && msg->isResponse()) {
     lastResponseStatus_ = msg->getStatusCode();
@@ -252,6 +300,8 @@ void HTTPTransaction::processIngressHeadersComplete(
   }
   refreshTimeout();
   if (handler_ && !isIngressComplete()) {
+    markTiming(&HTTPTransactionTimings::headersHandled);
+    PROXYGEN_ALLOCATION_PHASE(HANDLER);
     handler_->onHeadersComplete(std::move(msg));
   }
 }
@@ -321,7 +371,13 @@ void HTTPTransaction::onIngressBody(unique_ptr<IOBuf> chain, uint16_t padding) {
   }
   if (mustQueueIngress()) {
     checkCreateDeferredIngress();
-    deferredIngress_->emplace(id_, HTTPEvent::Type::BODY, std::move(chain));
+    // Consecutive body is delivered in one call on resume
+    if (!deferredIngress_->empty() &&
+        deferredIngress_->back().canAppendBody()) {
+      deferredIngress_->back().appendBody(std::move(chain));
+    } else {
+      deferredIngress_->emplace(id_, HTTPEvent::Type::BODY, std::move(chain));
+    }
     VLOG(4) << "Queued ingress event of type " << HTTPEvent::Type::BODY
             << " size=" << len << " " << *this;
   } else {
@@ -341,6 +397,7 @@ void HTTPTransaction::processIngressBody(unique_ptr<IOBuf> chain, size_t len) {
   auto chainLen = chain->computeChainDataLength();
   if (handler_) {
     if (!isIngressComplete()) {
+      PROXYGEN_ALLOCATION_PHASE(HANDLER);
       handler_->onBodyWithOffset(ingressBodyOffset_, std::move(chain));
     }
 
@@ -437,6 +494,7 @@ void HTTPTransaction::processIngressTrailers(unique_ptr<HTTPHeaders> trailers) {
   }
   refreshTimeout();
   if (handler_ && !isIngressComplete()) {
+    PROXYGEN_ALLOCATION_PHASE(HANDLER);
     handler_->onTrailers(std::move(trailers));
   }
 }
@@ -520,6 +578,7 @@ void HTTPTransaction::processIngressEOM() {
   }
   if (handler_) {
     if (!wasComplete) {
+      PROXYGEN_ALLOCATION_PHASE(HANDLER);
       handler_->onEOM();
     }
   } else {
@@ -575,6 +634,12 @@ void HTTPTransaction::markEgressComplete() {
 bool HTTPTransaction::validateIngressStateTransition(
     HTTPTransactionIngressSM::Event event) {
   DestructorGuard g(this);
+  FOLLY_SDT(proxygen,
+            txn_ingress_transition,
+            this,
+            id_,
+            static_cast<uint8_t>(ingressState_),
+            static_cast<uint8_t>(event));
 
   if (!HTTPTransactionIngressSM::transit(ingressState_, event)) {
     std::stringstream ss;
@@ -593,6 +658,12 @@ bool HTTPTransaction::validateIngressStateTransition(
 bool HTTPTransaction::validateEgressStateTransition(
     HTTPTransactionEgressSM::Event event) {
   DestructorGuard g(this);
+  FOLLY_SDT(proxygen,
+            txn_egress_transition,
+            this,
+            id_,
+            static_cast<uint8_t>(egressState_),
+            static_cast<uint8_t>(event));
 
   if (!HTTPTransactionEgressSM::transit(egressState_, event)) {
     std::stringstream ss;
@@ -797,6 +868,10 @@ void HTTPTransaction::onEgressTimeout() {
 
 void HTTPTransaction::onEgressHeaderFirstByte() {
   DestructorGuard g(this);
+  if (markTiming(&HTTPTransactionTimings::firstEgressByte) && isDownstream()) {
+    recordLatency(&HTTPTransactionTimings::firstEgressByte,
+                  &HTTPSessionStats::recordTransactionTimeToFirstByte);
+  }
   if (transportCallback_) {
     transportCallback_->firstHeaderByteFlushed();
   }
@@ -811,6 +886,10 @@ void HTTPTransaction::onEgressBodyFirstByte() {
 
 void HTTPTransaction::onEgressBodyLastByte() {
   DestructorGuard g(this);
+  if (markTiming(&HTTPTransactionTimings::lastByteWritten) && isDownstream()) {
+    recordLatency(&HTTPTransactionTimings::lastByteWritten,
+                  &HTTPSessionStats::recordTransactionTimeToLastByte);
+  }
   if (transportCallback_) {
     transportCallback_->lastByteFlushed();
   }
@@ -825,6 +904,7 @@ void HTTPTransaction::onEgressTrackedByte() {
 
 void HTTPTransaction::onEgressLastByteAck(std::chrono::milliseconds latency) {
   DestructorGuard g(this);
+  markTiming(&HTTPTransactionTimings::lastByteAcked);
   if (transportCallback_) {
     transportCallback_->lastByteAcked(latency);
   }
@@ -872,6 +952,9 @@ void HTTPTransaction::onEgressTrackedByteEventTX(const ByteEvent& event) {
 
 void HTTPTransaction::onEgressTrackedByteEventAck(const ByteEvent& event) {
   DestructorGuard g(this);
+  if (event.eventType_ == ByteEvent::LAST_BYTE) {
+    markTiming(&HTTPTransactionTimings::lastByteAcked);
+  }
   if (transportCallback_) {
     transportCallback_->trackedByteEventAck(event);
   }
@@ -896,6 +979,11 @@ void HTTPTransaction::sendHeadersWithOptionalEOM(const HTTPMessage& headers,
   }
   if (headers.isRequest()) {
     headRequest_ = (headers.getMethod() == HTTPMethod::HEAD);
+    auto method = headers.getMethod();
+    idempotentRequest_ = method && isIdempotent(*method);
+    if (requestSampling_) {
+      decideSampling(&headers.getHeaders());
+    }
   } else {
     has1xxResponse_ = headers.is1xxResponse();
   }
@@ -912,6 +1000,14 @@ void HTTPTransaction::sendHeadersWithOptionalEOM(const HTTPMessage& headers,
       }
     }
   }
+  if (egressHeld_) {
+    heldHeaders_.push_back(headers);
+    if (eom) {
+      // Queued, to go out after the headers once egress is released
+      sendEOM();
+    }
+    return;
+  }
   HTTPHeaderSize size;
   transport_.sendHeaders(this, headers, &size, eom);
   if (transportCallback_) {
@@ -1098,6 +1194,16 @@ size_t HTTPTransaction::sendDeferredBody(uint32_t maxEgress) {
     // Timeout will call notifyTransportPendingEgress again
     return 0;
   }
+  if (egressPacer_ && canSend > 0) {
+    canSend =
+        egressPacer_->acquire(&pacerCallback_, egressPacerWeight_, canSend);
+    if (canSend == 0) {
+      // As for the rate limit, the pacer calls back once there are tokens
+      egressRateLimited_ = true;
+      notifyTransportPendingEgress();
+      return 0;
+    }
+  }
 
   size_t nbytes = 0;
   bool willSendEOM = false;
@@ -1335,7 +1441,9 @@ void HTTPTransaction::sendEOM() {
   if (getOutstandingEgressBodyBytes() == 0 && chunkHeaders_.empty()) {
     // there is nothing left to send, egress the EOM directly.  For SPDY
     // this will jump the txn queue
-    if (!isEnqueued()) {
+    if (egressHeld_) {
+      VLOG(4) << "Holding egress EOM on " << *this;
+    } else if (!isEnqueued()) {
       size_t nbytes = sendEOMNow();
       transport_.notifyPendingEgress();
       if (transportCallback_) {
@@ -1463,15 +1571,34 @@ void HTTPTransaction::resumeIngress() {
     inResume_ = false;
   };
 
+  processDeferredIngress();
+}
+
+void HTTPTransaction::flushDeferredIngress() {
+  DestructorGuard g(this);
+  ingressDeferred_ = false;
+  if (ingressPaused_ || inResume_) {
+    // resumeIngress() delivers whatever is queued
+    return;
+  }
+  inResume_ = true;
+  SCOPE_EXIT {
+    inResume_ = false;
+  };
+  processDeferredIngress();
+}
+
+void HTTPTransaction::processDeferredIngress() {
   if (deferredIngress_ && (maxDeferredIngress_ <= deferredIngress_->size())) {
     maxDeferredIngress_ = deferredIngress_->size();
   }
 
   // Process any deferred ingress callbacks
   // Note: we recheck the ingressPaused_ state because a callback
-  // invoked by the resumeIngress() call above could have re-paused
+  // invoked by the resumeIngress() call could have re-paused
   // the transaction.
-  while (!ingressPaused_ && deferredIngress_ && !deferredIngress_->empty()) {
+  while (!ingressPaused_ && !ingressDeferred_ && deferredIngress_ &&
+         !deferredIngress_->empty()) {
     HTTPEvent& callback(deferredIngress_->front());
     VLOG(5) << "Processing deferred ingress callback of type "
             << callback.getEvent() << " " << *this;
@@ -1543,10 +1670,113 @@ void HTTPTransaction::setEgressRateLimit(uint64_t bitsPerSecond) {
   numLimitedBytesEgressed_ = 0;
 }
 
+void HTTPTransaction::setEgressPacer(EgressPacer* pacer) {
+  if (pacer == egressPacer_) {
+    return;
+  }
+  if (egressPacer_) {
+    egressPacer_->remove(&pacerCallback_);
+  }
+  egressPacer_ = pacer;
+  if (egressRateLimited_ && !rateLimitCallback_.isScheduled()) {
+    // Was waiting for the previous pacer
+    rateLimitTimeoutExpired();
+  }
+}
+
+void HTTPTransaction::setEgressBufferLimitOverride(
+    folly::Optional<uint64_t> limit) {
+  if (egressBufferLimitOverride_ == limit) {
+    return;
+  }
+  DestructorGuard g(this);
+  egressBufferLimitOverride_ = limit;
+  updateHandlerPauseState();
+}
+
+void HTTPTransaction::setEgressCoalescing(std::chrono::microseconds maxDelay,
+                                          uint32_t minBytes) {
+  egressCoalescingDelay_ = maxDelay;
+  egressCoalescingMinBytes_ = minBytes;
+  if (minBytes == 0 && egressCoalescingCallback_.isScheduled()) {
+    egressCoalescingCallback_.cancelTimeout();
+    notifyTransportPendingEgress();
+  }
+}
+
+void HTTPTransaction::setEgressHeld(bool held) {
+  if (egressHeld_ == held) {
+    return;
+  }
+  DestructorGuard g(this);
+  egressHeld_ = held;
+  if (held) {
+    return;
+  }
+  auto heldHeaders = std::move(heldHeaders_);
+  heldHeaders_.clear();
+  for (const auto& headers : heldHeaders) {
+    HTTPHeaderSize size;
+    transport_.sendHeaders(this, headers, &size, false);
+    if (transportCallback_) {
+      transportCallback_->headerBytesGenerated(size);
+    }
+  }
+  if (!heldHeaders.empty()) {
+    updateEgressCompressionInfo(transport_.getCodec().getCompressionInfo());
+  }
+  if (hasPendingEOM() && chunkHeaders_.empty()) {
+    // sendDeferredBody() only sends the EOM along with body, so send it as
+    // sendEOM() would have
+    if (isEnqueued()) {
+      egressQueue_.clearPendingEgress(queueHandle_);
+    }
+    size_t nbytes = sendEOMNow();
+    transport_.notifyPendingEgress();
+    if (transportCallback_) {
+      transportCallback_->bodyBytesGenerated(nbytes);
+    }
+    return;
+  }
+  if (queueHandle_ && !isEgressComplete()) {
+    notifyTransportPendingEgress();
+  }
+}
+
+bool HTTPTransaction::shouldHoldEgressForCoalescing() {
+  if (egressCoalescingMinBytes_ == 0 || !timer_) {
+    return false;
+  }
+  const size_t pending = getOutstandingEgressBodyBytes();
+  if (pending == 0) {
+    egressCoalescingFlush_ = false;
+  }
+  if (pending == 0 || egressCoalescingFlush_ ||
+      pending >= egressCoalescingMinBytes_ || isEgressEOMQueued()) {
+    if (egressCoalescingCallback_.isScheduled()) {
+      egressCoalescingCallback_.cancelTimeout();
+    }
+    return false;
+  }
+  if (!egressCoalescingCallback_.isScheduled()) {
+    VLOG(4) << "holding " << pending << " bytes for coalescing " << *this;
+    timer_->scheduleTimeout(
+        &egressCoalescingCallback_,
+        std::chrono::ceil<std::chrono::milliseconds>(egressCoalescingDelay_));
+  }
+  return true;
+}
+
+void HTTPTransaction::egressCoalescingTimeoutExpired() {
+  egressCoalescingFlush_ = true;
+  notifyTransportPendingEgress();
+}
+
 void HTTPTransaction::notifyTransportPendingEgress() {
   DestructorGuard guard(this);
   CHECK(queueHandle_);
-  if (!egressRateLimited_ &&
+  if (!egressRateLimited_ && !egressHeld_ &&
+      !shouldHoldEgressForCoalescing() &&
       (getOutstandingEgressBodyBytes() > 0 || isEgressEOMQueued()) &&
       (!useFlowControl_ || sendWindow_.getSize() > 0)) {
     // Egress isn't paused, we have something to send, and flow
@@ -1579,7 +1809,7 @@ void HTTPTransaction::updateHandlerPauseState() {
     }
   }
   flowControlPaused_ = useFlowControl_ && availWindow <= 0;
-  bool bufferFull = getOutstandingEgressBodyBytes() > egressBufferLimit_;
+  bool bufferFull = getOutstandingEgressBodyBytes() > getEgressBufferLimit();
   bool handlerShouldBePaused =
       egressPaused_ || flowControlPaused_ || egressRateLimited_ || bufferFull;
 
@@ -1620,7 +1850,8 @@ const CompressionInfo& HTTPTransaction::getCompressionInfo() const {
 }
 
 bool HTTPTransaction::mustQueueIngress() const {
-  return ingressPaused_ || (deferredIngress_ && !deferredIngress_->empty());
+  return ingressPaused_ || ingressDeferred_ ||
+         (deferredIngress_ && !deferredIngress_->empty());
 }
 
 void HTTPTransaction::checkCreateDeferredIngress() {
@@ -23,10 +23,15 @@
 #include <proxygen/lib/http/Window.h>
 #include <proxygen/lib/http/codec/HTTPCodec.h>
 #include <proxygen/lib/http/session/ByteEvents.h>
+#include <proxygen/lib/http/session/EgressPacer.h>
 #include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
 #include <proxygen/lib/http/session/HTTPEvent.h>
 #include <proxygen/lib/http/session/HTTPTransactionEgressSM.h>
 #include <proxygen/lib/http/session/HTTPTransactionIngressSM.h>
+#include <proxygen/lib/http/session/HTTPTransactionTimings.h>
+#include <proxygen/lib/http/session/MemoryGovernor.h>
+#include <proxygen/lib/sampling/Sampling.h>
+#include <proxygen/lib/utils/LazyTimeout.h>
 #include <proxygen/lib/utils/Time.h>
 #include <proxygen/lib/utils/TraceEvent.h>
 #include <proxygen/lib/utils/TraceEventObserver.h>
@@ -36,6 +41,17 @@
 
 namespace proxygen {
 
+/**
+ * The sampling of the requests of a session for deep tracing, see
+ * HTTPSessionBase::setRequestSampling().
+ */
+struct HTTPRequestSampling {
+  Sampling sampling;
+  // The request header whose value, when present, makes the decision, so
+  // that the hops of a request agree on it
+  std::string keyHeader;
+};
+
 /**
  * Experimental
  *
@@ -978,6 +994,10 @@ class HTTPTransaction
     transportCallback_ = cb;
   }
 
+  bool hasTransportCallback() const {
+    return transportCallback_ != nullptr;
+  }
+
   /**
    * @return true if ingress has started on this transaction.
    */
@@ -1206,6 +1226,17 @@ class HTTPTransaction
     return ingressPaused_;
   }
 
+  /**
+   * Queue ingress events for the handler without pausing the transport, and
+   * deliver them on the next flushDeferredIngress().  Lets a session parse
+   * many streams before running any handler callbacks.
+   */
+  void deferIngress() {
+    ingressDeferred_ = true;
+  }
+
+  void flushDeferredIngress();
+
   /**
    * Pause egress generation. HTTPTransaction may call its Handler's
    * onEgressPaused() method if there is a state change as a result of
@@ -1237,6 +1268,39 @@ class HTTPTransaction
    */
   void setEgressRateLimit(uint64_t bitsPerSecond);
 
+  /**
+   * Paces body egress with the pacer of the session, see
+   * HTTPSessionBase::setEgressPacing(), or stops if nullptr.  Transactions
+   * waiting on it share it by their weight.
+   */
+  void setEgressPacer(EgressPacer* pacer);
+  void setEgressPacerWeight(uint32_t weight) {
+    DCHECK_GT(weight, 0);
+    egressPacerWeight_ = weight;
+  }
+
+  /**
+   * Hold small amounts of body so that adjacent sendBody() calls are egressed
+   * together in one frame.  Body is held until at least minBytes are
+   * buffered, EOM is queued, or maxDelay has passed since body was first
+   * held.  The delay is rounded up to the granularity of the transaction's
+   * timer.  Setting minBytes to 0 disables coalescing.
+   */
+  void setEgressCoalescing(std::chrono::microseconds maxDelay,
+                           uint32_t minBytes);
+
+  /**
+   * Used by the session for responses to pipelined requests, which must go
+   * out in order: while held, headers, body and EOM are buffered here rather
+   * than handed to the transport, and releasing sends what was buffered.
+   * Body is still subject to the egress buffer limit.
+   */
+  void setEgressHeld(bool held);
+
+  bool isEgressHeld() const {
+    return egressHeld_;
+  }
+
   /**
    * @return true iff egress processing is paused for the handler
    */
@@ -1425,11 +1489,24 @@ class HTTPTransaction
   void refreshTimeout() {
     // TODO(T121147568): Remove the zero-check after the experiment is complete.
     if (timer_ && hasIdleTimeout() &&
-        idleTimeout_.value() != std::chrono::milliseconds::zero()) {
+        idleTimeout_.value() != std::chrono::milliseconds::zero() &&
+        (!lazyTimeout_ ||
+         lazyTimeout_->refresh(isScheduled(), idleTimeout_.value()))) {
       timer_->scheduleTimeout(this, idleTimeout_.value());
     }
   }
 
+  /**
+   * Only push back the deadline when refreshing the idle timeout while it is
+   * scheduled, see LazyTimeout. Sessions enable it for their transactions
+   * with HTTPSessionBase::setLazyIdleTimeoutsEnabled.
+   */
+  void enableLazyIdleTimeout() {
+    if (!lazyTimeout_) {
+      lazyTimeout_ = std::make_unique<LazyTimeout>();
+    }
+  }
+
   /**
    * Tests if the first byte has already been sent, and if it
    * hasn't yet then it marks it as sent.
@@ -1450,6 +1527,41 @@ class HTTPTransaction
     isCountedTowardsStreamLimit_ = true;
   }
 
+  /**
+   * Starts recording when the transaction goes through each step, see
+   * HTTPTransactionTimings. Sessions enable it for their transactions with
+   * HTTPSessionBase::setTransactionTimingsEnabled.
+   */
+  void enableTimings() {
+    if (!timings_) {
+      timings_ = std::make_unique<HTTPTransactionTimings>();
+    }
+  }
+
+  // The timings recorded so far, nullptr unless enabled
+  HTTPTransactionTimings* getTimings() const {
+    return timings_.get();
+  }
+
+  /**
+   * Samples the transaction for deep tracing: right away, or once the
+   * request headers are known when sampling has a key header.  Unsampled
+   * transactions record no timings and skip the first byte events unless
+   * a TransportCallback wants them; handlers should create no TraceEvents
+   * for them.
+   */
+  void setRequestSampling(std::shared_ptr<const HTTPRequestSampling> sampling);
+
+  // 1/rate once sampled, 0 if not, and 1 without sampling
+  uint32_t getSamplingWeight() const {
+    return samplingWeight_;
+  }
+
+  // True until decided otherwise
+  bool isSampled() const {
+    return samplingWeight_ > 0;
+  }
+
   /**
    * Tests if the very first byte of Header has already been set.
    * If it hasn't yet, it marks it as sent.
@@ -1486,6 +1598,13 @@ class HTTPTransaction
    * until the ingress message is complete or terminated by error.
    */
   void timeoutExpired() noexcept override {
+    if (lazyTimeout_ && timer_) {
+      auto remaining = lazyTimeout_->remaining();
+      if (remaining.count() > 0) {
+        timer_->scheduleTimeout(this, remaining);
+        return;
+      }
+    }
     transport_.transactionTimeout(this);
   }
 
@@ -1547,6 +1666,25 @@ class HTTPTransaction
     enableLastByteFlushedTracking_ = enabled;
   }
 
+  /**
+   * The headers, EOM and chunk framing of this transaction, along with the
+   * egress queued with them, are written in the event loop iteration that
+   * generated them, as HTTPSession::setWriteInCurrentLoop does for a whole
+   * session.  For request/response exchanges on a session that otherwise
+   * batches.
+   */
+  void setWriteInCurrentLoop(bool enabled) {
+    writeInCurrentLoop_ = enabled;
+  }
+  bool getWriteInCurrentLoop() const {
+    return writeInCurrentLoop_;
+  }
+
+  // Whether the request this transaction sent has an idempotent method
+  bool isIdempotentRequest() const {
+    return idempotentRequest_;
+  }
+
   // Use this API to track TX or Ack for a particular offset of the HTTP body,
   // if the underlying transport is capable of tracking.
   // It will generate a callback to HTTPTransactionTransportCallback either
@@ -1568,6 +1706,23 @@ class HTTPTransaction
     egressBufferLimit_ = limit;
   }
 
+  /**
+   * Override the process-wide egress buffer limit for this transaction, or
+   * restore it with folly::none.  The handler is paused or resumed right away
+   * if the new limit changes whether the buffer is full.
+   */
+  void setEgressBufferLimitOverride(folly::Optional<uint64_t> limit);
+
+  // Scaled down by the MemoryGovernor under memory pressure
+  uint64_t getEgressBufferLimit() const {
+    return MemoryGovernor::get().scale(
+        egressBufferLimitOverride_.value_or(egressBufferLimit_));
+  }
+
+  uint64_t getBodyBytesEgressed() const {
+    return bodyBytesEgressed_;
+  }
+
   virtual bool addBufferMeta() noexcept;
 
  private:
@@ -1601,6 +1756,12 @@ class HTTPTransaction
 
   bool mustQueueIngress() const;
 
+  /**
+   * Deliver queued ingress events until the queue is empty or ingress is
+   * paused or deferred again.
+   */
+  void processDeferredIngress();
+
   /**
    * Check if deferredIngress_ points to some queue before pushing HTTPEvent
    * to it.
@@ -1619,6 +1780,25 @@ class HTTPTransaction
   void processIngressChunkHeader(size_t length);
   void processIngressChunkComplete();
   void processIngressTrailers(std::unique_ptr<HTTPHeaders> trailers);
+
+  // headers, or nullptr if there are none to key the decision on
+  void decideSampling(const HTTPHeaders* headers);
+
+  // Records the current time for a step, the first time only. Returns
+  // whether it did.
+  bool markTiming(TimePoint HTTPTransactionTimings::*step) {
+    if (timings_ && !timePointInitialized((*timings_).*step)) {
+      (*timings_).*step = getCurrentTime();
+      return true;
+    }
+    return false;
+  }
+
+  // Reports the time from the first ingress byte to a step just marked
+  void recordLatency(TimePoint HTTPTransactionTimings::*step,
+                     void (HTTPSessionStats::*record)(
+                         std::chrono::microseconds) noexcept);
+
   void processIngressUpgrade(UpgradeProtocol protocol);
   void processIngressEOM();
 
@@ -1711,6 +1891,44 @@ class HTTPTransaction
 
   RateLimitCallback rateLimitCallback_{*this};
 
+  class PacerCallback : public EgressPacer::Callback {
+   public:
+    explicit PacerCallback(HTTPTransaction& txn) : txn_(txn) {
+    }
+
+    void onEgressPacerReady() noexcept override {
+      txn_.rateLimitTimeoutExpired();
+    }
+
+   private:
+    HTTPTransaction& txn_;
+  };
+
+  PacerCallback pacerCallback_{*this};
+
+  // Returns true if buffered body should wait for more before egressing
+  bool shouldHoldEgressForCoalescing();
+
+  void egressCoalescingTimeoutExpired();
+
+  class EgressCoalescingCallback : public folly::HHWheelTimer::Callback {
+   public:
+    explicit EgressCoalescingCallback(HTTPTransaction& txn) : txn_(txn) {
+    }
+
+    void timeoutExpired() noexcept override {
+      txn_.egressCoalescingTimeoutExpired();
+    }
+    void callbackCanceled() noexcept override {
+      // no op
+    }
+
+   private:
+    HTTPTransaction& txn_;
+  };
+
+  EgressCoalescingCallback egressCoalescingCallback_{*this};
+
   /**
    * Queue to hold any events that we receive from the Transaction
    * while the ingress is supposed to be paused.
@@ -1767,6 +1985,13 @@ class HTTPTransaction
    */
   std::unique_ptr<HTTPHeaders> trailers_;
 
+  // Only allocated when enabled, to keep the cost off other transactions
+  std::unique_ptr<HTTPTransactionTimings> timings_;
+  // Until decided, when the decision waits for the request headers
+  std::shared_ptr<const HTTPRequestSampling> requestSampling_;
+  uint32_t samplingWeight_{1};
+  std::unique_ptr<LazyTimeout> lazyTimeout_;
+
   struct Chunk {
     explicit Chunk(size_t inLength) : length(inLength), headerSent(false) {
     }
@@ -1833,18 +2058,22 @@ class HTTPTransaction
   folly::Optional<uint64_t> actualResponseLength_{0};
   uint64_t bodyBytesEgressed_{0};
   std::map<uint64_t, ByteEvent::EventFlags> egressBodyOffsetsToTrack_;
+  // Headers sent while egress is held, 1xx included
+  std::vector<HTTPMessage> heldHeaders_;
 
   bool ingressPaused_ : 1;
   bool egressPaused_ : 1;
   bool flowControlPaused_ : 1;
   bool handlerEgressPaused_ : 1;
   bool egressRateLimited_ : 1;
+  bool egressHeld_ : 1;
   bool useFlowControl_ : 1;
   bool aborted_ : 1;
   bool deleting_ : 1;
   bool firstByteSent_ : 1;
   bool firstHeaderByteSent_ : 1;
   bool inResume_ : 1;
+  bool ingressDeferred_ : 1;
   bool isCountedTowardsStreamLimit_ : 1;
   bool ingressErrorSeen_ : 1;
   bool priorityFallback_ : 1;
@@ -1861,6 +2090,9 @@ class HTTPTransaction
   // Whether this HTTPTransaction delegates body sending to another entity.
   bool isDelegated_ : 1;
 
+  bool writeInCurrentLoop_ : 1;
+  bool idempotentRequest_ : 1;
+
   /**
    * If this transaction represents a request (ie, it is backed by an
    * HTTPUpstreamSession) , this field indicates the last response status
@@ -1872,11 +2104,20 @@ class HTTPTransaction
 
   // Maximum size of egress buffer before invoking onEgressPaused
   static uint64_t egressBufferLimit_;
+  folly::Optional<uint64_t> egressBufferLimitOverride_;
 
   uint64_t egressLimitBytesPerMs_{0};
   proxygen::TimePoint startRateLimit_;
   uint64_t numLimitedBytesEgressed_{0};
 
+  EgressPacer* egressPacer_{nullptr};
+  uint32_t egressPacerWeight_{1};
+
+  std::chrono::microseconds egressCoalescingDelay_{0};
+  uint32_t egressCoalescingMinBytes_{0};
+  // Set when the coalescing delay expires, cleared once the body drains
+  bool egressCoalescingFlush_{false};
+
   folly::Optional<std::chrono::milliseconds> idleTimeout_;
 
   folly::HHWheelTimer* timer_;
@@ -51,11 +51,60 @@ class HTTPTransactionEgressSMData {
     return State::Start;
   }
 
-  static std::pair<State, bool> find(State s, Event e);
+  static std::pair<State, bool> find(State s, Event e) {
+    return kTransitions.find(s, e);
+  }
 
   static const std::string getName() {
     return "HTTPTransactionEgress";
   }
+
+ private:
+  //             +--> ChunkHeaderSent -> ChunkBodySent
+  //             |      ^                    v
+  //             |      |   ChunkTerminatorSent -> TrailersSent
+  //             |      |__________|        |          |
+  //             |                          |          v
+  // Start -> HeadersSent                   +----> EOMQueued --> SendingDone
+  //             |                                     ^
+  //             +------------> RegularBodySent -------+
+  static constexpr TransitionTable<State, Event> kTransitions{
+      {{{State::Start, Event::sendHeaders}, State::HeadersSent},
+
+       // For HTTP sending 100 response, then a regular response
+       {{State::HeadersSent, Event::sendHeaders}, State::HeadersSent},
+
+       {{State::HeadersSent, Event::sendBody}, State::RegularBodySent},
+       {{State::HeadersSent, Event::sendTrailers}, State::TrailersSent},
+       {{State::HeadersSent, Event::sendChunkHeader},
+        State::ChunkHeaderSent},
+       {{State::HeadersSent, Event::sendEOM}, State::EOMQueued},
+
+       {{State::RegularBodySent, Event::sendBody}, State::RegularBodySent},
+       {{State::RegularBodySent, Event::sendTrailers}, State::TrailersSent},
+       {{State::RegularBodySent, Event::sendEOM}, State::EOMQueued},
+
+       {{State::ChunkHeaderSent, Event::sendBody}, State::ChunkBodySent},
+
+       {{State::ChunkBodySent, Event::sendBody}, State::ChunkBodySent},
+       {{State::ChunkBodySent, Event::sendChunkTerminator},
+        State::ChunkTerminatorSent},
+
+       {{State::ChunkTerminatorSent, Event::sendChunkHeader},
+        State::ChunkHeaderSent},
+       {{State::ChunkTerminatorSent, Event::sendTrailers},
+        State::TrailersSent},
+       {{State::ChunkTerminatorSent, Event::sendEOM}, State::EOMQueued},
+
+       {{State::TrailersSent, Event::sendEOM}, State::EOMQueued},
+
+       {{State::HeadersSent, Event::sendDatagram}, State::DatagramSent},
+       {{State::DatagramSent, Event::sendDatagram}, State::DatagramSent},
+       {{State::DatagramSent, Event::sendTrailers}, State::TrailersSent},
+       {{State::DatagramSent, Event::sendEOM}, State::EOMQueued},
+
+       {{State::EOMQueued, Event::eomFlushed}, State::SendingDone}}};
+  static_assert(kTransitions.valid(), "Invalid transitions");
 };
 
 std::ostream& operator<<(std::ostream& os,
@@ -55,11 +55,80 @@ class HTTPTransactionIngressSMData {
     return State::Start;
   }
 
-  static std::pair<State, bool> find(State s, Event e);
+  static std::pair<State, bool> find(State s, Event e) {
+    return kTransitions.find(s, e);
+  }
 
   static const std::string getName() {
     return "HTTPTransactionIngress";
   }
+
+ private:
+  //             +--> ChunkHeaderReceived -> ChunkBodyReceived
+  //             |        ^                     v
+  //             |        |          ChunkCompleted -> TrailersReceived
+  //             |        |_______________|     |      |
+  //             |                              v      v
+  // Start -> HeadersReceived ---------------> EOMQueued ---> ReceivingDone
+  //             |  |                             ^  ^
+  //             |  +-----> RegularBodyReceived --+  |
+  //             |                                   |
+  //             +---------> UpgradeComplete --------+
+  static constexpr TransitionTable<State, Event> kTransitions{
+      {{{State::Start, Event::onFinalHeaders}, State::FinalHeadersReceived},
+
+       {{State::Start, Event::onNonFinalHeaders},
+        State::NonFinalHeadersReceived},
+       {{State::NonFinalHeadersReceived, Event::onNonFinalHeaders},
+        State::NonFinalHeadersReceived},
+       {{State::NonFinalHeadersReceived, Event::onFinalHeaders},
+        State::FinalHeadersReceived},
+       {{State::NonFinalHeadersReceived, Event::onUpgrade},
+        State::UpgradeComplete},
+
+       {{State::FinalHeadersReceived, Event::onBody},
+        State::RegularBodyReceived},
+       {{State::FinalHeadersReceived, Event::onDatagram},
+        State::FinalHeadersReceived},
+       {{State::FinalHeadersReceived, Event::onChunkHeader},
+        State::ChunkHeaderReceived},
+       // special case - 0 byte body with trailers
+       {{State::FinalHeadersReceived, Event::onTrailers},
+        State::TrailersReceived},
+       {{State::FinalHeadersReceived, Event::onUpgrade},
+        State::UpgradeComplete},
+       {{State::FinalHeadersReceived, Event::onEOM}, State::EOMQueued},
+
+       {{State::RegularBodyReceived, Event::onBody},
+        State::RegularBodyReceived},
+       {{State::RegularBodyReceived, Event::onDatagram},
+        State::RegularBodyReceived},
+       // HTTP2 supports trailers and doesn't handle body as chunked events
+       {{State::RegularBodyReceived, Event::onTrailers},
+        State::TrailersReceived},
+       {{State::RegularBodyReceived, Event::onEOM}, State::EOMQueued},
+
+       {{State::ChunkHeaderReceived, Event::onBody},
+        State::ChunkBodyReceived},
+
+       {{State::ChunkBodyReceived, Event::onBody},
+        State::ChunkBodyReceived},
+       {{State::ChunkBodyReceived, Event::onChunkComplete},
+        State::ChunkCompleted},
+
+       {{State::ChunkCompleted, Event::onChunkHeader},
+        State::ChunkHeaderReceived},
+       {{State::ChunkCompleted, Event::onTrailers},
+        State::TrailersReceived},
+       {{State::ChunkCompleted, Event::onEOM}, State::EOMQueued},
+
+       {{State::TrailersReceived, Event::onEOM}, State::EOMQueued},
+
+       {{State::UpgradeComplete, Event::onBody}, State::UpgradeComplete},
+       {{State::UpgradeComplete, Event::onEOM}, State::EOMQueued},
+
+       {{State::EOMQueued, Event::eomFlushed}, State::ReceivingDone}}};
+  static_assert(kTransitions.valid(), "Invalid transitions");
 };
 
 std::ostream& operator<<(std::ostream& os,
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * When a transaction went through each step, to tell where its latency goes.
+ * A step not reached, or not tracked by the session, is left unset (see
+ * timePointInitialized). Byte events are only set when the session tracks
+ * them, ie. with a ByteEventTracker.
+ */
+struct HTTPTransactionTimings {
+  // The read of the bytes starting the ingress message
+  TimePoint firstHeaderByteRead;
+  // The codec parsed the ingress headers
+  TimePoint headersParsed;
+  // The handler got the headers, ie. onRequest in a downstream server
+  TimePoint headersHandled;
+  // The first egress header byte was written to the socket
+  TimePoint firstEgressByte;
+  // The last egress byte was written to the socket
+  TimePoint lastByteWritten;
+  // The peer acked the last egress byte
+  TimePoint lastByteAcked;
+
+  // The time between two steps, zero unless both are set
+  static std::chrono::microseconds between(TimePoint from, TimePoint to) {
+    if (!timePointInitialized(from) || !timePointInitialized(to)) {
+      return std::chrono::microseconds::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+  }
+};
+
+} // namespace proxygen
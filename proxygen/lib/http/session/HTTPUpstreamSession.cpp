@@ -46,6 +46,62 @@ bool HTTPUpstreamSession::isReusable() const {
               !writeTimeout_.isScheduled()));
 }
 
+bool HTTPUpstreamSession::canPipeline() const {
+  // A completed response shows the origin keeps the connection alive
+  if (codec_->supportsParallelRequests() || !started_ || isClosing() ||
+      !codec_->isReusable() || ingressError_ ||
+      getNumOutgoingStreams() == 0 ||
+      getNumTxnServed() <= getNumOutgoingStreams()) {
+    return false;
+  }
+  for (const auto& it : transactions_) {
+    const auto& txn = it.second;
+    // The codec must have generated its EOM, to frame the next request
+    if (!txn.isIngressEOMSeen() &&
+        (!txn.isEgressComplete() || !txn.isIdempotentRequest())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::chrono::milliseconds HTTPUpstreamSession::getPipelineHeadWait() const {
+  // Responses complete in order, so the oldest are the ones answered
+  while (requestSentTimes_.size() > getNumOutgoingStreams()) {
+    requestSentTimes_.pop_front();
+  }
+  if (requestSentTimes_.empty()) {
+    return std::chrono::milliseconds(0);
+  }
+  return millisecondsSince(requestSentTimes_.front());
+}
+
+HTTPTransaction* HTTPUpstreamSession::newPipelinedTransaction(
+    HTTPTransaction::Handler* handler) {
+  if (!canPipeline()) {
+    return nullptr;
+  }
+  auto txn = createOutgoingTransaction(handler);
+  if (txn.hasError()) {
+    return nullptr;
+  }
+  VLOG(4) << *this << " pipelining streamID=" << txn.value()->getID();
+  return txn.value();
+}
+
+void HTTPUpstreamSession::onHeadersSent(const HTTPMessage& /*headers*/,
+                                        bool /*codecWasReusable*/) {
+  if (codec_->supportsParallelRequests()) {
+    return;
+  }
+  // The request just sent is outstanding already
+  while (!requestSentTimes_.empty() &&
+         requestSentTimes_.size() >= getNumOutgoingStreams()) {
+    requestSentTimes_.pop_front();
+  }
+  requestSentTimes_.push_back(getCurrentTime());
+}
+
 bool HTTPUpstreamSession::isClosing() const {
   VLOG(5) << "isClosing: " << *this << ", sock_->good()=" << sock_->good()
           << ", draining_=" << draining_
@@ -92,7 +148,14 @@ HTTPUpstreamSession::newTransactionWithError(
     // This session doesn't support any more parallel transactions
     return folly::makeUnexpected<NewTransactionError>(
         "Number of HTTP outgoing transactions reaches limit in the session");
-  } else if (draining_) {
+  }
+  return createOutgoingTransaction(handler);
+}
+
+folly::Expected<HTTPTransaction*, HTTPUpstreamSession::NewTransactionError>
+HTTPUpstreamSession::createOutgoingTransaction(
+    HTTPTransaction::Handler* handler) {
+  if (draining_) {
     return folly::makeUnexpected<NewTransactionError>("Connection is draining");
   }
 
@@ -191,6 +254,7 @@ void HTTPUpstreamSession::attachThreadLocals(
   }
   codec_.foreach (fn);
   codec_->setHeaderCodecStats(headerCodecStats);
+  eventBatch_.attachEventBase(eventBase);
   resumeReadsImpl();
   rescheduleLoopCallbacks();
 }
@@ -216,6 +280,7 @@ void HTTPUpstreamSession::detachThreadLocals(bool detachSSLContext) {
     sock_->detachEventBase();
   }
   txnEgressQueue_.detachThreadLocals();
+  eventBatch_.detachEventBase();
   if (controlMessageRateLimitFilter_) {
     controlMessageRateLimitFilter_->detachThreadLocals();
   }
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <deque>
 #include <folly/io/async/SSLContext.h>
 #include <proxygen/lib/http/codec/compress/HeaderCodec.h>
 #include <proxygen/lib/http/session/HTTPSession.h>
@@ -107,6 +108,18 @@ class HTTPUpstreamSession final : public HTTPSession {
    */
   HTTPTransaction* newTransaction(HTTPTransaction::Handler* handler) override;
 
+  /**
+   * Over HTTP/1.1, true when every outstanding request is idempotent and
+   * fully sent, and the origin already kept the connection alive through a
+   * response on it.
+   */
+  bool canPipeline() const override;
+
+  std::chrono::milliseconds getPipelineHeadWait() const override;
+
+  HTTPTransaction* newPipelinedTransaction(
+      HTTPTransaction::Handler* handler) override;
+
   /**
    * Returns true if the underlying transport has completed full handshake.
    */
@@ -161,6 +174,12 @@ class HTTPUpstreamSession final : public HTTPSession {
 
   bool allTransactionsStarted() const override;
 
+  void onHeadersSent(const HTTPMessage& headers,
+                     bool codecWasReusable) override;
+
+  folly::Expected<HTTPTransaction*, NewTransactionError>
+  createOutgoingTransaction(HTTPTransaction::Handler* handler);
+
   bool onNativeProtocolUpgrade(HTTPCodec::StreamID streamID,
                                CodecProtocol protocol,
                                const std::string& protocolString,
@@ -173,6 +192,10 @@ class HTTPUpstreamSession final : public HTTPSession {
 
   std::shared_ptr<const PriorityMapFactory> priorityMapFactory_;
   std::unique_ptr<PriorityAdapter> priorityAdapter_;
+
+  // HTTP/1.1: when the requests whose responses are awaited were sent,
+  // oldest first.  Trimmed to the outstanding ones lazily.
+  mutable std::deque<TimePoint> requestSentTimes_;
 };
 
 } // namespace proxygen
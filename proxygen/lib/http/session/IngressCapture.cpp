@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/IngressCapture.h>
+
+#include <fcntl.h>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/Varint.h>
+#include <folly/portability/Unistd.h>
+#include <glog/logging.h>
+
+namespace {
+
+// Type, stream ID, delay and length, the most a record header takes
+constexpr size_t kMaxRecordHeaderBytes = 1 + 3 * folly::kMaxVarintLength64;
+
+} // namespace
+
+namespace proxygen {
+
+constexpr size_t IngressRecorder::kFlushBytes;
+
+IngressRecorder::IngressRecorder(folly::File file,
+                                 folly::StringPiece protocol,
+                                 uint64_t maxBytes)
+    : file_(std::move(file)),
+      maxBytes_(maxBytes),
+      last_(std::chrono::steady_clock::now()) {
+  buf_.reserve(kFlushBytes + kMaxRecordHeaderBytes);
+  buf_.append(kIngressCaptureMagic.data(), kIngressCaptureMagic.size());
+  appendVarint(protocol.size());
+  buf_.append(protocol.data(), protocol.size());
+  bytes_ = buf_.size();
+}
+
+IngressRecorder::~IngressRecorder() {
+  flush();
+}
+
+void IngressRecorder::appendVarint(uint64_t value) {
+  uint8_t varint[folly::kMaxVarintLength64];
+  auto length = folly::encodeVarint(value, varint);
+  buf_.append(reinterpret_cast<const char*>(varint), length);
+}
+
+bool IngressRecorder::appendHeader(IngressRecordType type,
+                                   uint64_t streamId,
+                                   uint64_t dataLength) {
+  if (truncated_ || failed_) {
+    return false;
+  }
+  if (bytes_ + kMaxRecordHeaderBytes + dataLength > maxBytes_) {
+    // The rest of the connection too, a replay may stop short but never
+    // skips ahead
+    VLOG(3) << "Ingress capture truncated at " << bytes_ << " bytes";
+    truncated_ = true;
+    return false;
+  }
+  auto now = std::chrono::steady_clock::now();
+  auto delay =
+      std::chrono::duration_cast<std::chrono::microseconds>(now - last_);
+  last_ = now;
+  auto start = buf_.size();
+  buf_.push_back(static_cast<char>(type));
+  appendVarint(streamId);
+  appendVarint(std::max<int64_t>(delay.count(), 0));
+  if (type == IngressRecordType::DATA) {
+    appendVarint(dataLength);
+  }
+  bytes_ += buf_.size() - start + dataLength;
+  return true;
+}
+
+void IngressRecorder::onData(uint64_t streamId, folly::ByteRange data) {
+  if (data.empty() ||
+      !appendHeader(IngressRecordType::DATA, streamId, data.size())) {
+    return;
+  }
+  buf_.append(reinterpret_cast<const char*>(data.data()), data.size());
+  if (buf_.size() >= kFlushBytes) {
+    flush();
+  }
+}
+
+void IngressRecorder::onData(uint64_t streamId, const folly::IOBuf& chain) {
+  auto length = chain.computeChainDataLength();
+  if (length == 0 ||
+      !appendHeader(IngressRecordType::DATA, streamId, length)) {
+    return;
+  }
+  for (auto range : chain) {
+    buf_.append(reinterpret_cast<const char*>(range.data()), range.size());
+  }
+  if (buf_.size() >= kFlushBytes) {
+    flush();
+  }
+}
+
+void IngressRecorder::onEndOfStream(uint64_t streamId) {
+  appendHeader(IngressRecordType::END_OF_STREAM, streamId, 0);
+}
+
+void IngressRecorder::flush() {
+  if (failed_ || buf_.empty()) {
+    return;
+  }
+  if (folly::writeFull(file_.fd(), buf_.data(), buf_.size()) < 0) {
+    LOG(ERROR) << "Ingress capture write failed: " << folly::errnoStr(errno);
+    failed_ = true;
+  }
+  buf_.clear();
+}
+
+folly::Expected<IngressRecording, std::string> IngressRecording::parse(
+    folly::ByteRange capture) {
+  if (!capture.startsWith(folly::ByteRange(kIngressCaptureMagic))) {
+    return folly::makeUnexpected(std::string("not an ingress capture"));
+  }
+  capture.advance(kIngressCaptureMagic.size());
+  auto truncated = [] {
+    return folly::makeUnexpected(std::string("truncated ingress capture"));
+  };
+
+  IngressRecording recording;
+  auto protocolLength = folly::tryDecodeVarint(capture);
+  if (!protocolLength || *protocolLength > capture.size()) {
+    return truncated();
+  }
+  recording.protocol = std::string(
+      reinterpret_cast<const char*>(capture.data()), *protocolLength);
+  capture.advance(*protocolLength);
+
+  while (!capture.empty()) {
+    auto type = static_cast<IngressRecordType>(capture.front());
+    capture.pop_front();
+    if (type != IngressRecordType::DATA &&
+        type != IngressRecordType::END_OF_STREAM) {
+      return folly::makeUnexpected(folly::to<std::string>(
+          "unknown ingress record type ", uint32_t(type)));
+    }
+    auto streamId = folly::tryDecodeVarint(capture);
+    auto delay = streamId ? folly::tryDecodeVarint(capture) : streamId;
+    if (!delay) {
+      return truncated();
+    }
+    Record record{
+        type, *streamId, std::chrono::microseconds(*delay), nullptr};
+    if (type == IngressRecordType::DATA) {
+      auto length = folly::tryDecodeVarint(capture);
+      if (!length || *length > capture.size()) {
+        return truncated();
+      }
+      record.data = folly::IOBuf::copyBuffer(capture.data(), *length);
+      capture.advance(*length);
+    }
+    recording.records.push_back(std::move(record));
+  }
+  return recording;
+}
+
+folly::Expected<IngressRecording, std::string> IngressRecording::read(
+    const std::string& path) {
+  std::string capture;
+  if (!folly::readFile(path.c_str(), capture)) {
+    return folly::makeUnexpected(folly::to<std::string>(
+        "can't read ", path, ": ", folly::errnoStr(errno)));
+  }
+  return parse(folly::ByteRange(folly::StringPiece(capture)));
+}
+
+IngressCapture& IngressCapture::get() {
+  static IngressCapture capture;
+  return capture;
+}
+
+void IngressCapture::configure(Options options) {
+  auto sampleOneIn = options.directory.empty() ? 0 : options.sampleOneIn;
+  *options_.wlock() = std::move(options);
+  recorded_.store(0, std::memory_order_relaxed);
+  sampleOneIn_.store(sampleOneIn, std::memory_order_relaxed);
+}
+
+std::unique_ptr<IngressRecorder> IngressCapture::maybeStartRecording(
+    folly::StringPiece protocol) {
+  auto sampleOneIn = sampleOneIn_.load(std::memory_order_relaxed);
+  if (sampleOneIn == 0 || !folly::Random::oneIn(sampleOneIn)) {
+    return nullptr;
+  }
+  auto options = options_.copy();
+  auto recorded = recorded_.load(std::memory_order_relaxed);
+  do {
+    if (recorded >= options.maxConnections) {
+      return nullptr;
+    }
+  } while (!recorded_.compare_exchange_weak(
+      recorded, recorded + 1, std::memory_order_relaxed));
+
+  auto path = folly::to<std::string>(options.directory,
+                                     "/",
+                                     getpid(),
+                                     "-",
+                                     nextFile_.fetch_add(1),
+                                     ".cap");
+  try {
+    folly::File file(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    VLOG(2) << "Capturing " << protocol << " ingress to " << path;
+    return std::make_unique<IngressRecorder>(
+        std::move(file), protocol, options.maxBytesPerConnection);
+  } catch (const std::system_error& ex) {
+    LOG_EVERY_N(ERROR, 100) << "Can't open ingress capture: " << ex.what();
+    return nullptr;
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <folly/Expected.h>
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/io/IOBuf.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Captures of the raw ingress of sampled connections, so that production
+ * traffic can be replayed offline (see IngressReplayBench).  A capture file
+ * holds one connection:
+ *
+ *   "PXGNCAP1", protocol length (varint), protocol
+ *   records: type (1 byte), stream ID (varint), microseconds since the
+ *            previous record (varint), then for DATA a length (varint) and
+ *            the bytes
+ *
+ * TCP sessions record their plaintext ingress as stream 0.  HQ sessions
+ * record each QUIC stream, unidirectional ones from their stream preface.
+ */
+enum class IngressRecordType : uint8_t {
+  DATA = 0,
+  END_OF_STREAM = 1,
+};
+
+constexpr folly::StringPiece kIngressCaptureMagic{"PXGNCAP1"};
+
+/**
+ * Writes the capture of one connection.  Records are buffered and written
+ * by kFlushBytes; the ones past maxBytes are dropped.  Not thread safe.
+ */
+class IngressRecorder {
+ public:
+  static constexpr size_t kFlushBytes = 64 * 1024;
+
+  IngressRecorder(folly::File file,
+                  folly::StringPiece protocol,
+                  uint64_t maxBytes);
+
+  ~IngressRecorder();
+
+  void onData(uint64_t streamId, folly::ByteRange data);
+
+  void onData(uint64_t streamId, const folly::IOBuf& chain);
+
+  void onEndOfStream(uint64_t streamId);
+
+  // Whether records were dropped for maxBytes
+  bool isTruncated() const {
+    return truncated_;
+  }
+
+ private:
+  // False if the record doesn't fit in maxBytes
+  bool appendHeader(IngressRecordType type,
+                    uint64_t streamId,
+                    uint64_t dataLength);
+  void appendVarint(uint64_t value);
+  void flush();
+
+  folly::File file_;
+  std::string buf_;
+  uint64_t maxBytes_;
+  uint64_t bytes_{0};
+  std::chrono::steady_clock::time_point last_;
+  bool truncated_{false};
+  bool failed_{false};
+};
+
+/**
+ * A capture file, read back.
+ */
+struct IngressRecording {
+  struct Record {
+    IngressRecordType type;
+    uint64_t streamId;
+    std::chrono::microseconds delay;
+    // DATA only
+    std::unique_ptr<folly::IOBuf> data;
+  };
+
+  static folly::Expected<IngressRecording, std::string> parse(
+      folly::ByteRange capture);
+
+  static folly::Expected<IngressRecording, std::string> read(
+      const std::string& path);
+
+  std::string protocol;
+  std::vector<Record> records;
+};
+
+/**
+ * Which sessions record their ingress, and where: one in sampleOneIn
+ * downstream sessions, up to maxConnections overall, each to its own file
+ * of the directory.  Off until configured.  Thread safe.
+ */
+class IngressCapture {
+ public:
+  struct Options {
+    std::string directory;
+    // None if 0
+    uint32_t sampleOneIn{0};
+    uint64_t maxConnections{1000};
+    uint64_t maxBytesPerConnection{16 * 1024 * 1024};
+  };
+
+  // Shared by every session
+  static IngressCapture& get();
+
+  // Restarts the count of maxConnections
+  void configure(Options options);
+
+  bool isEnabled() const {
+    return sampleOneIn_.load(std::memory_order_relaxed) > 0;
+  }
+
+  /**
+   * A recorder for a new connection speaking protocol if it is sampled,
+   * nullptr otherwise.
+   */
+  std::unique_ptr<IngressRecorder> maybeStartRecording(
+      folly::StringPiece protocol);
+
+  // Since configured
+  uint64_t getNumRecorded() const {
+    return recorded_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  folly::Synchronized<Options> options_;
+  std::atomic<uint32_t> sampleOneIn_{0};
+  std::atomic<uint64_t> recorded_{0};
+  // Never reused, so that files of a previous configuration are kept
+  std::atomic<uint64_t> nextFile_{0};
+};
+
+} // namespace proxygen
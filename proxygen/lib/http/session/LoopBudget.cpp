@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/LoopBudget.h>
+
+#include <algorithm>
+
+#include <folly/io/async/EventBase.h>
+
+namespace proxygen {
+
+namespace {
+
+class LoopBudgetObserver : public folly::EventBaseObserver {
+ public:
+  explicit LoopBudgetObserver(uint32_t sampleRate) : sampleRate_(sampleRate) {
+  }
+
+  uint32_t getSampleRate() const override {
+    return sampleRate_;
+  }
+
+  // Called on the EventBase's thread, in microseconds
+  void loopSample(int64_t busyTime, int64_t /*idleTime*/) override {
+    LoopBudget::get().onLoopSample(std::chrono::microseconds(busyTime));
+  }
+
+ private:
+  const uint32_t sampleRate_;
+};
+
+} // namespace
+
+LoopBudget& LoopBudget::get() {
+  static thread_local LoopBudget budget;
+  return budget;
+}
+
+std::shared_ptr<folly::EventBaseObserver> LoopBudget::makeObserver(
+    uint32_t sampleRate) {
+  return std::make_shared<LoopBudgetObserver>(sampleRate);
+}
+
+void LoopBudget::onLoopSample(std::chrono::microseconds busyTime) {
+  stats_.loopSamples++;
+  stats_.loopBusyTime += busyTime;
+  stats_.maxLoopBusyTime = std::max(stats_.maxLoopBusyTime, busyTime);
+}
+
+} // namespace proxygen
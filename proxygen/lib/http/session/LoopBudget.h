@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace folly {
+class EventBaseObserver;
+}
+
+namespace proxygen {
+
+/**
+ * Per-thread, hence per EventBase, cooperative budget of the sessions the
+ * thread runs.  A session that parsed or wrote its slice in one callback
+ * yields and continues from a later loop callback, so one connection with a
+ * burst of pipelined requests or a large pending egress can't delay every
+ * other connection of the thread.  Shared by HTTPSession and HQSession.
+ *
+ * Not thread safe, use get() for the calling thread's budget.
+ */
+class LoopBudget {
+ public:
+  struct Options {
+    // Bytes a session parses per callback, 0 for no limit
+    uint64_t readSlice{0};
+    // Bytes a session writes per callback, 0 for no limit.  A session's own
+    // HTTPSession::setMaxEgressBytesPerLoop takes precedence.
+    uint64_t writeSlice{0};
+  };
+
+  struct Stats {
+    uint64_t readYields{0};
+    uint64_t writeYields{0};
+    // Loop iterations sampled by the observer from makeObserver()
+    uint64_t loopSamples{0};
+    // Time the sampled iterations spent running callbacks
+    std::chrono::microseconds loopBusyTime{0};
+    std::chrono::microseconds maxLoopBusyTime{0};
+  };
+
+  /**
+   * The budget for the calling thread.
+   */
+  static LoopBudget& get();
+
+  /**
+   * Samples one loop iteration out of sampleRate into the stats of the
+   * budget of the EventBase's thread.  For EventBase::setObserver().
+   */
+  static std::shared_ptr<folly::EventBaseObserver> makeObserver(
+      uint32_t sampleRate = 16);
+
+  void setOptions(const Options& options) {
+    options_ = options;
+  }
+  const Options& getOptions() const {
+    return options_;
+  }
+
+  uint64_t getReadSlice() const {
+    return options_.readSlice;
+  }
+  uint64_t getWriteSlice() const {
+    return options_.writeSlice;
+  }
+
+  void onReadYield() {
+    stats_.readYields++;
+  }
+  void onWriteYield() {
+    stats_.writeYields++;
+  }
+
+  void onLoopSample(std::chrono::microseconds busyTime);
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+  std::chrono::microseconds getAvgLoopBusyTime() const {
+    return stats_.loopSamples == 0 ? std::chrono::microseconds(0)
+                                   : stats_.loopBusyTime / stats_.loopSamples;
+  }
+
+ private:
+  Options options_;
+  Stats stats_;
+};
+
+} // namespace proxygen
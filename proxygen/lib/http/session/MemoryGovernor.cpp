@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/MemoryGovernor.h>
+
+#include <folly/Indestructible.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+constexpr uint32_t MemoryGovernor::kScaleOne;
+constexpr uint32_t MemoryGovernor::kMinScale;
+constexpr uint32_t MemoryGovernor::kScaleStep;
+constexpr std::chrono::milliseconds MemoryGovernor::kUpdateInterval;
+constexpr uint64_t MemoryGovernor::kMinLargeConsumerBytes;
+
+MemoryGovernor& MemoryGovernor::get() {
+  static folly::Indestructible<MemoryGovernor> governor;
+  return *governor;
+}
+
+void MemoryGovernor::setWatermarks(uint64_t low, uint64_t high) {
+  DCHECK_LE(low, high);
+  lowWatermark_.store(low, std::memory_order_relaxed);
+  highWatermark_.store(high, std::memory_order_relaxed);
+  if (high == 0) {
+    underPressure_.store(false, std::memory_order_relaxed);
+    scale_.store(kScaleOne, std::memory_order_relaxed);
+  }
+}
+
+uint64_t MemoryGovernor::getBufferedBytes() const {
+  // A session may buffer on one shard and free on another
+  int64_t total = 0;
+  for (const auto& shard : shards_) {
+    total += shard.bytes.load(std::memory_order_relaxed);
+  }
+  return total > 0 ? total : 0;
+}
+
+uint64_t MemoryGovernor::getNumConsumers() const {
+  int64_t total = 0;
+  for (const auto& shard : shards_) {
+    total += shard.consumers.load(std::memory_order_relaxed);
+  }
+  return total > 0 ? total : 0;
+}
+
+void MemoryGovernor::update(TimePoint now) {
+  auto high = highWatermark_.load(std::memory_order_relaxed);
+  if (high == 0) {
+    return;
+  }
+  // A single thread updates per interval
+  auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   now.time_since_epoch())
+                   .count();
+  auto last = lastUpdate_.load(std::memory_order_relaxed);
+  if (nowMs - last < kUpdateInterval.count() ||
+      !lastUpdate_.compare_exchange_strong(
+          last, nowMs, std::memory_order_relaxed)) {
+    return;
+  }
+
+  auto buffered = getBufferedBytes();
+  auto consumers = std::max<uint64_t>(getNumConsumers(), 1);
+  largeConsumerBytes_.store(
+      std::max(buffered / consumers, kMinLargeConsumerBytes),
+      std::memory_order_relaxed);
+  auto scale = getScale();
+  if (buffered > high) {
+    if (!isUnderPressure()) {
+      LOG(WARNING) << "Memory pressure: " << buffered
+                   << " bytes buffered by " << consumers << " sessions";
+    }
+    underPressure_.store(true, std::memory_order_relaxed);
+    scale_.store(std::max(scale / 2, kMinScale), std::memory_order_relaxed);
+  } else if (buffered < lowWatermark_.load(std::memory_order_relaxed)) {
+    if (isUnderPressure()) {
+      LOG(INFO) << "Memory pressure relieved: " << buffered
+                << " bytes buffered";
+    }
+    underPressure_.store(false, std::memory_order_relaxed);
+    scale_.store(std::min(scale + kScaleStep, kScaleOne),
+                 std::memory_order_relaxed);
+  }
+  VLOG(4) << "Memory governor: buffered=" << buffered
+          << " scale=" << getScale() << "/" << kScaleOne;
+}
+
+} // namespace proxygen
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <folly/concurrency/CacheLocality.h>
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * Tracks the body bytes buffered by every session of the process, ingress
+ * not yet processed by the handlers and egress not yet written, and turns
+ * their sum into back pressure:
+ *
+ *  . Above the high watermark the scale, the fraction of its usual receive
+ *    window and egress buffer limit a session uses, halves every
+ *    kUpdateInterval, down to kMinScale.  The sessions buffering at least
+ *    getLargeConsumerBytes() also pause their reads.
+ *
+ *  . Below the low watermark the reads resume, and the scale grows back by
+ *    kScaleStep every kUpdateInterval.
+ *
+ * Off until setWatermarks() is called.  The counters are sharded by CPU, so
+ * that sessions on different threads don't contend.  Thread safe.
+ */
+class MemoryGovernor {
+ public:
+  static constexpr uint32_t kScaleOne = 1024;
+  static constexpr uint32_t kMinScale = kScaleOne / 16;
+  static constexpr uint32_t kScaleStep = kScaleOne / 8;
+  static constexpr std::chrono::milliseconds kUpdateInterval{100};
+  // A session buffering less is never paused
+  static constexpr uint64_t kMinLargeConsumerBytes = 64 * 1024;
+
+  MemoryGovernor() = default;
+
+  // Shared by every session
+  static MemoryGovernor& get();
+
+  /**
+   * Pressure starts above high and ends below low.  A high watermark of 0
+   * turns the governor off, resetting the scale.
+   */
+  void setWatermarks(uint64_t low, uint64_t high);
+
+  bool isEnabled() const {
+    return highWatermark_.load(std::memory_order_relaxed) > 0;
+  }
+
+  // Accounts for bytes buffered, or freed when negative
+  void onBuffered(int64_t delta) {
+    if (delta != 0) {
+      shard().bytes.fetch_add(delta, std::memory_order_relaxed);
+    }
+  }
+
+  // Sessions are consumers from their construction to their destruction
+  void addConsumer() {
+    shard().consumers.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void removeConsumer() {
+    shard().consumers.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Sums the shards
+  uint64_t getBufferedBytes() const;
+
+  uint64_t getNumConsumers() const;
+
+  /**
+   * Re-evaluates the pressure from the buffered bytes, unless done less than
+   * kUpdateInterval ago.
+   */
+  void update(TimePoint now = getCurrentTime());
+
+  bool isUnderPressure() const {
+    return underPressure_.load(std::memory_order_relaxed);
+  }
+
+  // In 1/kScaleOne
+  uint32_t getScale() const {
+    return scale_.load(std::memory_order_relaxed);
+  }
+
+  // limit at the current scale, at least 1
+  uint64_t scale(uint64_t limit) const {
+    auto scale = getScale();
+    if (scale >= kScaleOne) {
+      return limit;
+    }
+    return std::max<uint64_t>(limit * scale / kScaleOne, 1);
+  }
+
+  // The average of the sessions when last updated, at least
+  // kMinLargeConsumerBytes
+  uint64_t getLargeConsumerBytes() const {
+    return largeConsumerBytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t kNumShards = 64;
+
+  struct alignas(folly::hardware_destructive_interference_size) Shard {
+    std::atomic<int64_t> bytes{0};
+    std::atomic<int64_t> consumers{0};
+  };
+
+  Shard& shard() {
+    return shards_[folly::AccessSpreader<>::cachedCurrent(kNumShards)];
+  }
+
+  std::array<Shard, kNumShards> shards_;
+  std::atomic<uint64_t> lowWatermark_{0};
+  std::atomic<uint64_t> highWatermark_{0};
+  // Steady clock, in ms
+  std::atomic<int64_t> lastUpdate_{0};
+  std::atomic<bool> underPressure_{false};
+  std::atomic<uint32_t> scale_{kScaleOne};
+  std::atomic<uint64_t> largeConsumerBytes_{kMinLargeConsumerBytes};
+};
+
+} // namespace proxygen
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/session/ReadBufferPool.h>
+
+namespace proxygen {
+
+ReadBufferPool& ReadBufferPool::get() {
+  static thread_local ReadBufferPool pool;
+  return pool;
+}
+
+std::unique_ptr<folly::IOBuf> ReadBufferPool::acquire(size_t size) {
+  stats_.acquired++;
+  while (!free_.empty()) {
+    auto buf = std::move(free_.back());
+    free_.pop_back();
+    // the read size may have been changed since the buffer was allocated
+    if (buf->tailroom() >= size) {
+      stats_.reused++;
+      return buf;
+    }
+  }
+  return folly::IOBuf::create(size);
+}
+
+void ReadBufferPool::release(std::unique_ptr<folly::IOBuf> chain) {
+  while (chain) {
+    auto next = chain->pop();
+    if (free_.size() < maxFree_ && !chain->isSharedOne()) {
+      chain->clear();
+      free_.push_back(std::move(chain));
+      stats_.released++;
+    }
+    chain = std::move(next);
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/io/IOBuf.h>
+#include <memory>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Per-thread free list of socket read buffers.
+ *
+ * A session borrows a buffer for one read callback and hands it back as soon
+ * as the codec consumed all of it, so idle keep-alive connections don't pin
+ * read memory. Buffers still referenced elsewhere (e.g. body data cloned by
+ * the codec) are not reused, they are freed once the last reference goes.
+ *
+ * Not thread safe, use get() for the calling thread's pool.
+ */
+class ReadBufferPool {
+ public:
+  struct Stats {
+    // buffers handed out by acquire()
+    uint64_t acquired{0};
+    // buffers handed out from the free list
+    uint64_t reused{0};
+    // buffers put back in the free list
+    uint64_t released{0};
+    // unparsed bytes held by sessions between reads
+    int64_t pinnedBytes{0};
+  };
+
+  static constexpr size_t kDefaultMaxFree = 64;
+
+  explicit ReadBufferPool(size_t maxFree = kDefaultMaxFree)
+      : maxFree_(maxFree) {
+  }
+
+  /**
+   * The pool for the calling thread.
+   */
+  static ReadBufferPool& get();
+
+  /**
+   * Get an empty buffer with at least size bytes of tailroom.
+   */
+  std::unique_ptr<folly::IOBuf> acquire(size_t size);
+
+  /**
+   * Return a chain of buffers. The caller must be done with the data.
+   */
+  void release(std::unique_ptr<folly::IOBuf> chain);
+
+  void adjustPinnedBytes(int64_t delta) {
+    stats_.pinnedBytes += delta;
+  }
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+  /**
+   * Fraction of acquire() calls served from the free list.
+   */
+  double getHitRate() const {
+    return stats_.acquired == 0
+               ? 0.0
+               : static_cast<double>(stats_.reused) / stats_.acquired;
+  }
+
+  size_t getFreeCount() const {
+    return free_.size();
+  }
+
+ private:
+  size_t maxFree_;
+  std::vector<std::unique_ptr<folly::IOBuf>> free_;
+  Stats stats_;
+};
+
+} // namespace proxygen
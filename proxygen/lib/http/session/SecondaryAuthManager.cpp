@@ -11,10 +11,53 @@
 #include <fizz/extensions/exportedauth/ExportedAuthenticator.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBufQueue.h>
+#include <folly/lang/Bits.h>
+#include <folly/ssl/OpenSSLHash.h>
 using folly::io::QueueAppender;
 
 namespace proxygen {
 
+VerifiedChainCache::VerifiedChainCache(ChainVerifier verifier,
+                                       size_t capacity,
+                                       std::chrono::seconds ttl)
+    : verifier_(std::move(verifier)),
+      ttl_(ttl),
+      results_(folly::in_place, capacity) {
+  CHECK(verifier_);
+}
+
+bool VerifiedChainCache::verify(
+    const std::vector<fizz::CertificateEntry>& certs) {
+  folly::ssl::OpenSSLHash::Digest digest;
+  digest.hash_init(EVP_sha256());
+  for (const auto& entry : certs) {
+    // Length prefixed so that the boundaries are part of the digest
+    auto length = folly::Endian::big(
+        static_cast<uint32_t>(entry.cert_data->computeChainDataLength()));
+    digest.hash_update(folly::ByteRange(
+        reinterpret_cast<const uint8_t*>(&length), sizeof(length)));
+    digest.hash_update(*entry.cert_data);
+  }
+  std::string key(EVP_MD_size(EVP_sha256()), '\0');
+  digest.hash_final(folly::MutableByteRange(
+      reinterpret_cast<uint8_t*>(&key[0]), key.size()));
+
+  auto now = std::chrono::steady_clock::now();
+  {
+    auto results = results_.lock();
+    auto it = results->find(key);
+    if (it != results->end() && now - it->second.verified < ttl_) {
+      stats_.hits++;
+      return it->second.valid;
+    }
+  }
+  stats_.misses++;
+  // Not under the lock: validation is the expensive part
+  bool valid = verifier_(certs);
+  results_.lock()->set(key, Entry{now, valid});
+  return valid;
+}
+
 SecondaryAuthManager::SecondaryAuthManager(
     std::unique_ptr<fizz::SelfCert> cert) {
   cert_ = std::move(cert);
@@ -50,6 +93,15 @@ SecondaryAuthManager::getAuthenticator(
     TransportDirection dir,
     uint16_t requestId,
     std::unique_ptr<folly::IOBuf> authRequest) {
+  auto key = authRequest->to<std::string>();
+  key.push_back(static_cast<char>(dir));
+  auto it = signed_.find(key);
+  if (it != signed_.end()) {
+    // The repeated request still maps to the cert it was answered with
+    requestCertMap_.insert(std::make_pair(requestId, it->second.certId));
+    return std::make_pair(it->second.certId,
+                          it->second.authenticator->clone());
+  }
   uint16_t certId = certIdCounter_++;
   std::unique_ptr<folly::IOBuf> authenticator;
   if (dir == TransportDirection::UPSTREAM) {
@@ -60,6 +112,9 @@ SecondaryAuthManager::getAuthenticator(
         transport, fizz::Direction::DOWNSTREAM, *cert_, std::move(authRequest));
   }
   requestCertMap_.insert(std::make_pair(requestId, certId));
+  if (authenticator) {
+    signed_.set(std::move(key), Signed{certId, authenticator->clone()});
+  }
   return std::make_pair(certId, std::move(authenticator));
 }
 
@@ -95,6 +150,9 @@ bool SecondaryAuthManager::validateAuthenticator(
   } else if ((*certs).size() == 0) {
     VLOG(4) << "Peer does not have appropriate certificate or does not want to "
                "provide one, empty authenticator received";
+  } else if (chainCache_ && !chainCache_->verify(*certs)) {
+    VLOG(4) << "Peer's secondary certificate chain failed validation";
+    return false;
   } else {
     receivedCerts_.insert(std::make_pair(certId, std::move(*certs)));
   }
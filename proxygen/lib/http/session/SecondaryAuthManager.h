@@ -8,11 +8,62 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <fizz/protocol/Certificate.h>
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <mutex>
 #include <proxygen/lib/http/session/SecondaryAuthManagerBase.h>
 
 namespace proxygen {
 
+/**
+ * Remembers the results of validating the peers' secondary certificate
+ * chains, by the SHA-256 of the chain, so that a chain presented for many
+ * coalesced origins, or on many connections, is validated once per ttl.
+ * It can be shared by the managers of all the sessions, on any thread.
+ *
+ * Only the path validation is cached: the signature proving possession of
+ * the leaf key covers the connection and the request, and is checked for
+ * every authenticator.
+ */
+class VerifiedChainCache {
+ public:
+  // Leaf first
+  using ChainVerifier =
+      folly::Function<bool(const std::vector<fizz::CertificateEntry>&) const>;
+
+  struct Stats {
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+  };
+
+  explicit VerifiedChainCache(
+      ChainVerifier verifier,
+      size_t capacity = 1024,
+      std::chrono::seconds ttl = std::chrono::hours(1));
+
+  bool verify(const std::vector<fizz::CertificateEntry>& certs);
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  struct Entry {
+    std::chrono::steady_clock::time_point verified;
+    bool valid;
+  };
+
+  const ChainVerifier verifier_;
+  const std::chrono::seconds ttl_;
+  folly::Synchronized<folly::EvictingCacheMap<std::string, Entry>, std::mutex>
+      results_;
+  Stats stats_;
+};
+
 class SecondaryAuthManager : public SecondaryAuthManagerBase {
  public:
   explicit SecondaryAuthManager(std::unique_ptr<fizz::SelfCert> cert);
@@ -48,6 +99,14 @@ class SecondaryAuthManager : public SecondaryAuthManagerBase {
   folly::Optional<std::vector<fizz::CertificateEntry>> getPeerCert(
       uint16_t certId);
 
+  /**
+   * Authenticators whose chain cache rejects the chain fail validation.
+   * Without one, any chain with a valid signature is accepted.
+   */
+  void setVerifiedChainCache(std::shared_ptr<VerifiedChainCache> cache) {
+    chainCache_ = std::move(cache);
+  }
+
  private:
   uint16_t requestIdCounter_{0};
   uint16_t certIdCounter_{0};
@@ -75,6 +134,17 @@ class SecondaryAuthManager : public SecondaryAuthManagerBase {
   // Locally cached certificates which authenticates the secondary identity of
   // the peer.
   std::map<uint16_t, std::vector<fizz::CertificateEntry>> receivedCerts_;
+
+  std::shared_ptr<VerifiedChainCache> chainCache_;
+
+  // The authenticators signed on this connection, by authenticator request,
+  // so that a repeated request is answered without signing again.  They are
+  // bound to the connection's exporter and cannot be shared with others.
+  struct Signed {
+    uint16_t certId;
+    std::unique_ptr<folly::IOBuf> authenticator;
+  };
+  folly::EvictingCacheMap<std::string, Signed> signed_{16};
 };
 
 } // namespace proxygen
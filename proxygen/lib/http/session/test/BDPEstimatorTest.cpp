@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/BDPEstimator.h>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+
+namespace {
+// Receives bytes over one rtt, then acks the ping
+folly::Optional<uint32_t> sample(BDPEstimator& estimator,
+                                 TimePoint& now,
+                                 uint64_t bytes,
+                                 milliseconds rtt) {
+  EXPECT_TRUE(estimator.onBytesReceived(bytes / 2, now));
+  EXPECT_FALSE(estimator.onBytesReceived(bytes - bytes / 2, now));
+  now += rtt;
+  return estimator.onPingAck(now);
+}
+} // namespace
+
+TEST(BDPEstimatorTest, GrowsWhenSaturated) {
+  BDPEstimator estimator(65536, 16 * 1024 * 1024);
+  TimePoint now = getCurrentTime();
+  // Filling the window doubles it
+  auto bdp = sample(estimator, now, 65536, milliseconds(50));
+  ASSERT_TRUE(bdp.has_value());
+  EXPECT_EQ(*bdp, 131072);
+  EXPECT_EQ(estimator.getRTT(), milliseconds(50));
+  EXPECT_FALSE(estimator.isPingOutstanding());
+
+  bdp = sample(estimator, now, 131072, milliseconds(50));
+  ASSERT_TRUE(bdp.has_value());
+  EXPECT_EQ(*bdp, 262144);
+}
+
+TEST(BDPEstimatorTest, NoGrowthWhenUnderused) {
+  BDPEstimator estimator(65536, 16 * 1024 * 1024);
+  TimePoint now = getCurrentTime();
+  EXPECT_FALSE(sample(estimator, now, 16384, milliseconds(50)).has_value());
+  EXPECT_EQ(estimator.getBDP(), 65536);
+
+  // Bandwidth below the best seen is not conclusive either
+  EXPECT_TRUE(sample(estimator, now, 65536, milliseconds(10)).has_value());
+  EXPECT_FALSE(sample(estimator, now, 131072, milliseconds(500)).has_value());
+  EXPECT_EQ(estimator.getBDP(), 131072);
+}
+
+TEST(BDPEstimatorTest, Capped) {
+  BDPEstimator estimator(65536, 100000);
+  TimePoint now = getCurrentTime();
+  auto bdp = sample(estimator, now, 65536, milliseconds(10));
+  ASSERT_TRUE(bdp.has_value());
+  EXPECT_EQ(*bdp, 100000);
+  // No more pings once at the cap
+  EXPECT_FALSE(estimator.onBytesReceived(100000, now));
+  EXPECT_FALSE(estimator.onPingAck(now).has_value());
+}
+
+TEST(BDPEstimatorTest, RTTAverage) {
+  BDPEstimator estimator(65536, 16 * 1024 * 1024);
+  TimePoint now = getCurrentTime();
+  sample(estimator, now, 1000, milliseconds(10));
+  sample(estimator, now, 1000, milliseconds(30));
+  EXPECT_EQ(estimator.getRTT(), milliseconds(20));
+}
+
+TEST(BDPEstimatorTest, RTTSmoothed) {
+  BDPEstimator estimator(65536, 16 * 1024 * 1024);
+  TimePoint now = getCurrentTime();
+  for (int i = 0; i < 10; i++) {
+    sample(estimator, now, 1000, milliseconds(10));
+  }
+  EXPECT_EQ(estimator.getRTT(), milliseconds(10));
+  // An outlier moves it by 1/8 of the difference
+  sample(estimator, now, 1000, milliseconds(90));
+  EXPECT_EQ(estimator.getRTT(), milliseconds(20));
+}
+
+TEST(ReceiveWindowBudgetTest, ReserveRelease) {
+  ReceiveWindowBudget budget(1000);
+  EXPECT_EQ(budget.reserve(600), 600);
+  // Partially granted, then nothing left
+  EXPECT_EQ(budget.reserve(600), 400);
+  EXPECT_EQ(budget.reserve(1), 0);
+  EXPECT_EQ(budget.getReserved(), 1000);
+
+  budget.release(600);
+  EXPECT_EQ(budget.reserve(100), 100);
+  budget.setLimit(200);
+  EXPECT_EQ(budget.reserve(100), 0);
+  budget.release(500);
+  EXPECT_EQ(budget.getReserved(), 0);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <new>
+#include <proxygen/lib/http/session/ByteEventTracker.h>
+#include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
+#include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
+#include <vector>
+
+/**
+ * The byte events of a long lived session carrying many streams: each
+ * stream adds its first header byte, first body byte and last byte events,
+ * and every write completion of batch streams fires theirs.  One iteration
+ * per stream.  Reports allocs, the operator new calls per stream, which the
+ * tracker's event pool keeps at zero once it has grown.
+ */
+
+DEFINE_int32(streams, 4096, "Transactions on the session");
+DEFINE_int32(batch, 64, "Streams a write completes");
+
+namespace {
+std::atomic<uint64_t> numAllocs{0};
+} // namespace
+
+void* operator new(size_t size) {
+  numAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+class NullCallback : public ByteEventTracker::Callback {
+ public:
+  void onPingReplyLatency(int64_t) noexcept override {
+  }
+  void onTxnByteEventWrittenToBuf(const ByteEvent&) noexcept override {
+  }
+  void onDeleteTxnByteEvent() noexcept override {
+  }
+};
+
+void runStreams(folly::UserCounters& counters, size_t iters) {
+  folly::EventBase evb;
+  WheelTimerInstance timeouts{std::chrono::milliseconds(500), &evb};
+  NiceMock<MockHTTPTransactionTransport> transport;
+  HTTP2PriorityQueue egressQueue;
+  NullCallback callback;
+  auto tracker = std::make_shared<ByteEventTracker>(&callback);
+  std::vector<std::unique_ptr<HTTPTransaction>> txns;
+  uint64_t offset = 0;
+  uint64_t allocs = 0;
+
+  BENCHMARK_SUSPEND {
+    for (int32_t i = 0; i < FLAGS_streams; i++) {
+      txns.push_back(
+          std::make_unique<HTTPTransaction>(TransportDirection::DOWNSTREAM,
+                                            HTTPCodec::StreamID(i * 2 + 1),
+                                            i,
+                                            transport,
+                                            egressQueue,
+                                            timeouts.getWheelTimer(),
+                                            timeouts.getDefaultTimeout()));
+    }
+    // Grow the pool before measuring
+    for (auto& txn : txns) {
+      tracker->addFirstHeaderByteEvent(++offset, txn.get());
+      tracker->addFirstBodyByteEvent(++offset, txn.get());
+      tracker->addTrackedByteEvent(txn.get(), ++offset);
+    }
+    tracker->processByteEvents(tracker, offset);
+  }
+
+  for (size_t i = 0; i < iters; i++) {
+    auto txn = txns[i % txns.size()].get();
+    auto before = numAllocs.load(std::memory_order_relaxed);
+    tracker->addFirstHeaderByteEvent(++offset, txn);
+    tracker->addFirstBodyByteEvent(++offset, txn);
+    tracker->addTrackedByteEvent(txn, ++offset);
+    allocs += numAllocs.load(std::memory_order_relaxed) - before;
+    if ((i + 1) % FLAGS_batch == 0) {
+      tracker->processByteEvents(tracker, offset);
+    }
+  }
+
+  BENCHMARK_SUSPEND {
+    tracker->processByteEvents(tracker, offset);
+    counters["allocs"] = allocs / iters;
+    tracker.reset();
+    txns.clear();
+  }
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(LongLivedSession, counters, iters) {
+  runStreams(counters, iters);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleMock(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
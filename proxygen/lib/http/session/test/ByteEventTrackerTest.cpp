@@ -89,3 +89,38 @@ TEST_F(ByteEventTrackerTest, TrackBytes) {
       &txn_, 10, trackedByteEventCb); // same offset
   byteEventTracker_->processByteEvents(byteEventTracker_, 10);
 }
+
+TEST_F(ByteEventTrackerTest, PooledEvents) {
+  EXPECT_CALL(transportCallback_, trackedByteFlushed()).Times(12);
+  EXPECT_CALL(callback_, onTxnByteEventWrittenToBuf(_)).Times(13);
+  EXPECT_CALL(callback_, onPingReplyLatency(_));
+  for (uint64_t i = 1; i <= 4; i++) {
+    byteEventTracker_->addTrackedByteEvent(&txn_, i * 10);
+  }
+  EXPECT_EQ(byteEventTracker_->getPoolCapacity(), 4);
+  EXPECT_EQ(byteEventTracker_->getPoolAvailable(), 0);
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 4);
+
+  // Ping events are not pooled, and move pooled ones along
+  byteEventTracker_->addPingByteEvent(
+      5, proxygen::getCurrentTime(), 15, nullptr);
+  byteEventTracker_->processByteEvents(byteEventTracker_, 25);
+  EXPECT_EQ(byteEventTracker_->getPoolAvailable(), 2);
+  byteEventTracker_->processByteEvents(byteEventTracker_, 45);
+  EXPECT_EQ(byteEventTracker_->getPoolAvailable(), 4);
+  EXPECT_EQ(txn_.getNumPendingByteEvents(), 0);
+
+  // Reused, then grown
+  for (uint64_t i = 1; i <= 8; i++) {
+    byteEventTracker_->addTrackedByteEvent(&txn_, 45 + i);
+  }
+  EXPECT_EQ(byteEventTracker_->getPoolCapacity(), 8);
+
+  // Absorbing takes the slabs along with the events
+  auto replacement = std::make_shared<ByteEventTracker>(&callback_);
+  replacement->absorb(std::move(*byteEventTracker_));
+  byteEventTracker_.reset();
+  EXPECT_EQ(replacement->getPoolCapacity(), 8);
+  replacement->processByteEvents(replacement, 100);
+  EXPECT_EQ(replacement->getPoolAvailable(), 8);
+}
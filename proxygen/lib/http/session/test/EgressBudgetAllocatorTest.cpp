@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/EgressBudgetAllocator.h>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+
+using Entries = std::vector<EgressBudgetAllocator::Entry>;
+
+TEST(EgressBudgetAllocatorTest, EqualSplit) {
+  EgressBudgetAllocator allocator(400000, 1000);
+  Entries entries{{1, 16, 0}, {3, 16, 0}, {5, 16, 0}, {7, 16, 0}};
+  EXPECT_EQ(allocator.allocate(entries, milliseconds(50)), 400000);
+  for (const auto& entry : entries) {
+    EXPECT_EQ(entry.limit, 100000);
+  }
+}
+
+TEST(EgressBudgetAllocatorTest, PriorityWeight) {
+  EgressBudgetAllocator allocator(100000, 1000);
+  Entries entries{{1, 64, 0}, {3, 16, 0}};
+  allocator.allocate(entries, milliseconds(50));
+  EXPECT_EQ(entries[0].limit, 80000);
+  EXPECT_EQ(entries[1].limit, 20000);
+}
+
+TEST(EgressBudgetAllocatorTest, DrainRate) {
+  EgressBudgetAllocator allocator(1000000, 1000);
+  Entries entries{{1, 16, 0}, {3, 16, 0}};
+  allocator.allocate(entries, milliseconds(50));
+  // Stream 1 drains 100KB per interval, stream 3 is stalled
+  for (uint64_t i = 1; i <= 4; i++) {
+    entries = {{1, 16, i * 100000}, {3, 16, 0}};
+    allocator.allocate(entries, milliseconds(50));
+  }
+  EXPECT_GT(allocator.getDrainRate(1), 1000);
+  EXPECT_EQ(allocator.getDrainRate(3), 0);
+  EXPECT_GT(entries[0].limit, 100 * entries[1].limit);
+  EXPECT_GE(entries[1].limit, 1000);
+
+  // Once stream 1 stalls too, its share decays
+  auto previous = entries[0].limit;
+  entries = {{1, 16, 400000}, {3, 16, 0}};
+  allocator.allocate(entries, milliseconds(50));
+  EXPECT_LT(entries[0].limit, previous);
+}
+
+TEST(EgressBudgetAllocatorTest, MinimumLimit) {
+  EgressBudgetAllocator allocator(10000, 4000);
+  Entries entries{{1, 256, 0}, {3, 1, 0}, {5, 1, 0}};
+  auto allocated = allocator.allocate(entries, milliseconds(50));
+  EXPECT_GT(entries[0].limit, 4000);
+  EXPECT_EQ(entries[1].limit, 4000);
+  EXPECT_EQ(entries[2].limit, 4000);
+  EXPECT_EQ(allocated, entries[0].limit + 8000);
+}
+
+TEST(EgressBudgetAllocatorTest, ForgetsClosedStreams) {
+  EgressBudgetAllocator allocator(100000);
+  Entries entries{{1, 16, 0}, {3, 16, 0}};
+  allocator.allocate(entries, milliseconds(50));
+  entries = {{1, 16, 50000}, {3, 16, 0}};
+  allocator.allocate(entries, milliseconds(50));
+  EXPECT_GT(allocator.getDrainRate(1), 0);
+
+  entries = {{3, 16, 0}};
+  allocator.allocate(entries, milliseconds(50));
+  EXPECT_EQ(allocator.getDrainRate(1), 0);
+  EXPECT_EQ(entries[0].limit, 100000);
+
+  // A stream that comes back starts over
+  entries = {{1, 16, 50000}, {3, 16, 0}};
+  allocator.allocate(entries, milliseconds(50));
+  EXPECT_EQ(allocator.getDrainRate(1), 1000);
+}
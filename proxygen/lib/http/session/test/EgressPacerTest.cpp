@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/EgressPacer.h>
+
+using namespace proxygen;
+using std::chrono::milliseconds;
+
+namespace {
+
+class TestCallback : public EgressPacer::Callback {
+ public:
+  void onEgressPacerReady() noexcept override {
+    ready++;
+  }
+
+  uint32_t ready{0};
+};
+
+} // namespace
+
+TEST(EgressPacerTest, TokenBucket) {
+  // 8000 bytes per second, and a packet of burst
+  EgressPacer::TokenBucket bucket(64000);
+  auto now = getCurrentTime();
+  EXPECT_EQ(bucket.available(now), EgressPacer::kMinGrant);
+  bucket.consume(EgressPacer::kMinGrant);
+  EXPECT_EQ(bucket.available(now + milliseconds(100)), 800);
+  EXPECT_EQ(bucket.timeUntil(EgressPacer::kMinGrant, now + milliseconds(100)),
+            milliseconds(75));
+  // Up to the burst
+  EXPECT_EQ(bucket.available(now + milliseconds(10000)),
+            EgressPacer::kMinGrant);
+}
+
+TEST(EgressPacerTest, WaitersShareByWeight) {
+  folly::EventBase evb;
+  // 10MB per second, with 1MB of burst
+  EgressPacer pacer(&evb.timer(), 80000000);
+  TestCallback light;
+  TestCallback heavy;
+  EXPECT_EQ(pacer.acquire(&light, 1, 2000000), 1000000);
+  EXPECT_EQ(pacer.acquire(&heavy, 3, 2000000), 0);
+  EXPECT_EQ(pacer.getNumWaiters(), 1);
+  while (heavy.ready == 0) {
+    evb.loopOnce();
+  }
+  // The light one gets about a quarter while the heavy one waits
+  auto lightGrant = pacer.acquire(&light, 1, 2000000);
+  auto heavyGrant = pacer.acquire(&heavy, 3, 2000000);
+  EXPECT_GT(lightGrant, 0);
+  EXPECT_GT(heavyGrant, 2 * lightGrant);
+  EXPECT_EQ(pacer.getNumWaiters(), 0);
+}
+
+TEST(EgressPacerTest, SharedTenant) {
+  folly::EventBase evb;
+  auto tenant = std::make_shared<EgressPacer::TokenBucket>(64000);
+  EgressPacer first(&evb.timer(), 80000000, tenant);
+  EgressPacer second(&evb.timer(), 80000000, tenant);
+  TestCallback firstCb;
+  TestCallback secondCb;
+  EXPECT_EQ(first.acquire(&firstCb, 1, 100000), EgressPacer::kMinGrant);
+  EXPECT_EQ(second.acquire(&secondCb, 1, 100000), 0);
+
+  // Released rather than left waiting
+  second.releaseAll();
+  EXPECT_EQ(secondCb.ready, 1);
+  EXPECT_EQ(second.getNumWaiters(), 0);
+  second.remove(&secondCb);
+}
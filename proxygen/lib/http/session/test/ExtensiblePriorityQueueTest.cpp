@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <map>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/ExtensiblePriorityQueue.h>
+
+using namespace testing;
+
+namespace {
+static char* fakeTxn = (char*)0xface0000;
+
+proxygen::HTTPTransaction* makeFakeTxn(proxygen::HTTPCodec::StreamID id) {
+  return (proxygen::HTTPTransaction*)(fakeTxn + id);
+}
+
+proxygen::HTTPCodec::StreamID getTxnID(proxygen::HTTPTransaction* txn) {
+  return (proxygen::HTTPCodec::StreamID)((char*)txn - fakeTxn);
+}
+
+} // namespace
+
+namespace proxygen {
+
+using IDs = std::vector<HTTPCodec::StreamID>;
+
+class ExtensiblePriorityQueueTest : public testing::Test {
+ protected:
+  void addTransaction(HTTPCodec::StreamID id,
+                      uint8_t urgency,
+                      bool incremental,
+                      bool signal = true) {
+    handles_[id] = q_.addTransaction(
+        id, http2::DefaultPriority, makeFakeTxn(id), false, nullptr);
+    EXPECT_TRUE(q_.updatePriority(id, HTTPPriority(urgency, incremental)));
+    if (signal) {
+      q_.signalPendingEgress(handles_[id]);
+    }
+  }
+
+  void removeTransaction(HTTPCodec::StreamID id) {
+    q_.removeTransaction(handles_[id]);
+    handles_.erase(id);
+  }
+
+  // Returns the ids returned by n calls to nextEgress
+  IDs nextEgress(size_t n) {
+    IDs ids;
+    for (size_t i = 0; i < n; i++) {
+      ExtensiblePriorityQueue::NextEgressResult res;
+      q_.nextEgress(res);
+      if (res.empty()) {
+        break;
+      }
+      EXPECT_EQ(res.size(), 1);
+      EXPECT_EQ(res.front().second, 1.0);
+      ids.push_back(getTxnID(res.front().first));
+    }
+    return ids;
+  }
+
+  ExtensiblePriorityQueue q_;
+  std::map<HTTPCodec::StreamID, ExtensiblePriorityQueue::Handle> handles_;
+};
+
+TEST_F(ExtensiblePriorityQueueTest, Empty) {
+  EXPECT_TRUE(q_.empty());
+  addTransaction(1, 3, false, false);
+  EXPECT_TRUE(q_.empty());
+  EXPECT_EQ(nextEgress(1), IDs());
+  q_.signalPendingEgress(handles_[1]);
+  EXPECT_FALSE(q_.empty());
+  EXPECT_TRUE(handles_[1]->isEnqueued());
+  EXPECT_EQ(handles_[1]->calculateDepth(), 1);
+  q_.clearPendingEgress(handles_[1]);
+  EXPECT_TRUE(q_.empty());
+  removeTransaction(1);
+  EXPECT_FALSE(q_.getPriority(1));
+}
+
+TEST_F(ExtensiblePriorityQueueTest, UrgencyOrder) {
+  addTransaction(1, 5, false);
+  addTransaction(3, 0, false);
+  addTransaction(5, 7, false);
+  addTransaction(7, 2, false);
+  EXPECT_EQ(q_.numPendingEgress(), 4);
+  EXPECT_EQ(nextEgress(2), IDs({3, 3}));
+  q_.clearPendingEgress(handles_[3]);
+  EXPECT_EQ(nextEgress(1), IDs({7}));
+  removeTransaction(7);
+  EXPECT_EQ(nextEgress(1), IDs({1}));
+  removeTransaction(1);
+  EXPECT_EQ(nextEgress(1), IDs({5}));
+  removeTransaction(5);
+  EXPECT_TRUE(q_.empty());
+}
+
+TEST_F(ExtensiblePriorityQueueTest, SequentialBeforeIncremental) {
+  addTransaction(1, 3, true);
+  addTransaction(3, 3, false);
+  addTransaction(5, 3, false);
+  // non-incremental streams are served one at a time, in order
+  EXPECT_EQ(nextEgress(3), IDs({3, 3, 3}));
+  q_.clearPendingEgress(handles_[3]);
+  EXPECT_EQ(nextEgress(2), IDs({5, 5}));
+  q_.clearPendingEgress(handles_[5]);
+  EXPECT_EQ(nextEgress(2), IDs({1, 1}));
+}
+
+TEST_F(ExtensiblePriorityQueueTest, IncrementalRoundRobin) {
+  addTransaction(1, 3, true);
+  addTransaction(3, 3, true);
+  addTransaction(5, 3, true);
+  EXPECT_EQ(nextEgress(4), IDs({1, 3, 5, 1}));
+  q_.clearPendingEgress(handles_[5]);
+  EXPECT_EQ(nextEgress(3), IDs({3, 1, 3}));
+  q_.signalPendingEgress(handles_[5]);
+  EXPECT_EQ(nextEgress(3), IDs({1, 3, 5}));
+}
+
+TEST_F(ExtensiblePriorityQueueTest, Reprioritize) {
+  addTransaction(1, 3, false);
+  addTransaction(3, 4, false);
+  EXPECT_EQ(nextEgress(1), IDs({1}));
+  EXPECT_TRUE(q_.updatePriority(3, HTTPPriority(1, true)));
+  EXPECT_EQ(nextEgress(1), IDs({3}));
+  EXPECT_EQ(q_.getPriority(3)->urgency, 1);
+  EXPECT_TRUE(q_.getPriority(3)->incremental);
+
+  // reprioritizing an idle stream takes effect on the next signal
+  q_.clearPendingEgress(handles_[3]);
+  EXPECT_TRUE(q_.updatePriority(3, HTTPPriority(6, false)));
+  EXPECT_EQ(q_.numPendingEgress(), 1);
+  q_.signalPendingEgress(handles_[3]);
+  EXPECT_EQ(nextEgress(1), IDs({1}));
+  removeTransaction(1);
+  EXPECT_EQ(nextEgress(1), IDs({3}));
+
+  EXPECT_FALSE(q_.updatePriority(99, HTTPPriority(0, false)));
+}
+
+TEST_F(ExtensiblePriorityQueueTest, IgnoresDependencyTree) {
+  uint64_t depth = 0;
+  q_.addPriorityNode(11, 0);
+  auto h =
+      q_.addTransaction(1, {11, true, 255}, makeFakeTxn(1), false, &depth);
+  EXPECT_EQ(depth, 1);
+  depth = 0;
+  EXPECT_EQ(q_.updatePriority(h, {0, false, 15}, &depth), h);
+  EXPECT_EQ(depth, 1);
+  EXPECT_EQ(q_.getPriority(1)->urgency, kDefaultHttpPriorityUrgency);
+  q_.removeTransaction(h);
+}
+
+} // namespace proxygen
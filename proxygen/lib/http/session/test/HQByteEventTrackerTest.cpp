@@ -12,6 +12,7 @@
 #include <proxygen/lib/http/session/HQByteEventTracker.h>
 #include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
 #include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
+#include <proxygen/lib/http/session/test/MockHTTPSessionStats.h>
 #include <quic/api/test/MockQuicSocket.h>
 #include <quic/api/test/Mocks.h>
 
@@ -23,6 +24,31 @@ using namespace proxygen;
 using QuicByteEvent = quic::QuicSocket::ByteEvent;
 using QuicByteEventType = quic::QuicSocket::ByteEvent::Type;
 
+namespace {
+
+class CountingTTLBAStats : public DummyHTTPSessionStats {
+ public:
+  void recordTTLBAReceived() noexcept override {
+    ttlbaReceived++;
+  }
+  void recordTTLBATracked() noexcept override {
+    ttlbaTracked++;
+  }
+  void recordTTBTXReceived() noexcept override {
+    ttbtxReceived++;
+  }
+  void recordTTBTXTracked() noexcept override {
+    ttbtxTracked++;
+  }
+
+  uint64_t ttlbaReceived{0};
+  uint64_t ttlbaTracked{0};
+  uint64_t ttbtxReceived{0};
+  uint64_t ttbtxTracked{0};
+};
+
+} // namespace
+
 class HQByteEventTrackerTest : public Test {
  public:
   void SetUp() override {
@@ -539,3 +565,139 @@ TEST_F(HQByteEventTrackerTest, FirstLastBodyByteErrorOnRegistration) {
   Mock::VerifyAndClearExpectations(&transportCallback_);
   EXPECT_EQ(0, txn_.getNumPendingByteEvents());
 }
+
+/**
+ * Test batched mode when the first and last body byte have the same offset.
+ *
+ * The tracker registers itself once per offset and event type and delivers
+ * both byte events from each QUIC callback.
+ */
+TEST_F(HQByteEventTrackerTest, BatchedSingleByte) {
+  const uint64_t bodyByteOffset = 1;
+  CountingTTLBAStats stats;
+  auto tracker =
+      std::make_shared<HQByteEventTracker>(nullptr, socket_.get(), streamId_);
+  tracker->enableBatchedEvents(true);
+  tracker->setTTLBAStats(&stats);
+
+  tracker->addFirstBodyByteEvent(bodyByteOffset, &txn_);
+  tracker->addLastByteEvent(&txn_, bodyByteOffset);
+
+  EXPECT_CALL(transportCallback_, firstByteFlushed());
+  EXPECT_CALL(transportCallback_, lastByteFlushed());
+  auto txCbHandler = expectRegisterTxCallback(bodyByteOffset);
+  auto ackCbHandler = expectRegisterDeliveryCallback(bodyByteOffset);
+  tracker->processByteEvents(tracker, bodyByteOffset);
+  Mock::VerifyAndClearExpectations(&socket_);
+  Mock::VerifyAndClearExpectations(&transportCallback_);
+  ASSERT_THAT(txCbHandler, NotNull());
+  ASSERT_THAT(ackCbHandler, NotNull());
+  EXPECT_EQ(*txCbHandler, *ackCbHandler);
+  EXPECT_EQ(4, tracker->getNumPendingBatchedEvents());
+  EXPECT_EQ(4, txn_.getNumPendingByteEvents());
+  EXPECT_EQ(2, stats.ttbtxTracked);
+  EXPECT_EQ(1, stats.ttlbaTracked);
+
+  {
+    InSequence s;
+    EXPECT_CALL(transportCallback_,
+                trackedByteEventTX(getByteEventMatcher(
+                    ByteEvent::EventType::FIRST_BYTE, bodyByteOffset)));
+    EXPECT_CALL(transportCallback_,
+                trackedByteEventTX(getByteEventMatcher(
+                    ByteEvent::EventType::LAST_BYTE, bodyByteOffset)));
+  }
+  (*txCbHandler)
+      ->onByteEvent(QuicByteEvent{.id = streamId_,
+                                  .offset = bodyByteOffset,
+                                  .type = QuicByteEventType::TX});
+  EXPECT_EQ(2, txn_.getNumPendingByteEvents());
+  EXPECT_EQ(2, stats.ttbtxReceived);
+
+  {
+    InSequence s;
+    EXPECT_CALL(transportCallback_,
+                trackedByteEventAck(getByteEventMatcher(
+                    ByteEvent::EventType::FIRST_BYTE, bodyByteOffset)));
+    EXPECT_CALL(transportCallback_,
+                trackedByteEventAck(getByteEventMatcher(
+                    ByteEvent::EventType::LAST_BYTE, bodyByteOffset)));
+  }
+  (*ackCbHandler)
+      ->onByteEvent(QuicByteEvent{.id = streamId_,
+                                  .offset = bodyByteOffset,
+                                  .type = QuicByteEventType::ACK});
+  EXPECT_EQ(0, txn_.getNumPendingByteEvents());
+  EXPECT_EQ(0, tracker->getNumPendingBatchedEvents());
+  EXPECT_EQ(1, stats.ttlbaReceived);
+}
+
+/**
+ * Test batched mode for a transaction that was not sampled for full
+ * tracking: only the ACK of the last byte is registered.
+ */
+TEST_F(HQByteEventTrackerTest, BatchedNotSampled) {
+  const uint64_t firstBodyByteOffset = 1;
+  const uint64_t lastBodyByteOffset = 10;
+  CountingTTLBAStats stats;
+  auto tracker =
+      std::make_shared<HQByteEventTracker>(nullptr, socket_.get(), streamId_);
+  tracker->enableBatchedEvents(false);
+  tracker->setTTLBAStats(&stats);
+
+  tracker->addFirstBodyByteEvent(firstBodyByteOffset, &txn_);
+  tracker->addLastByteEvent(&txn_, lastBodyByteOffset);
+
+  EXPECT_CALL(transportCallback_, firstByteFlushed());
+  EXPECT_CALL(transportCallback_, lastByteFlushed());
+  EXPECT_CALL(*socket_, registerTxCallback(_, _, _)).Times(0);
+  auto ackCbHandler = expectRegisterDeliveryCallback(lastBodyByteOffset);
+  tracker->processByteEvents(tracker, lastBodyByteOffset);
+  Mock::VerifyAndClearExpectations(&socket_);
+  Mock::VerifyAndClearExpectations(&transportCallback_);
+  ASSERT_THAT(ackCbHandler, NotNull());
+  EXPECT_EQ(1, txn_.getNumPendingByteEvents());
+  EXPECT_EQ(0, stats.ttbtxTracked);
+  EXPECT_EQ(1, stats.ttlbaTracked);
+
+  EXPECT_CALL(transportCallback_,
+              trackedByteEventAck(getByteEventMatcher(
+                  ByteEvent::EventType::LAST_BYTE, lastBodyByteOffset)));
+  (*ackCbHandler)
+      ->onByteEvent(QuicByteEvent{.id = streamId_,
+                                  .offset = lastBodyByteOffset,
+                                  .type = QuicByteEventType::ACK});
+  EXPECT_EQ(0, txn_.getNumPendingByteEvents());
+  EXPECT_EQ(1, stats.ttlbaReceived);
+}
+
+/**
+ * Test batched mode when the QUIC byte events are canceled.
+ */
+TEST_F(HQByteEventTrackerTest, BatchedCancellation) {
+  const uint64_t lastBodyByteOffset = 10;
+  auto tracker =
+      std::make_shared<HQByteEventTracker>(nullptr, socket_.get(), streamId_);
+  tracker->enableBatchedEvents(true);
+
+  tracker->addLastByteEvent(&txn_, lastBodyByteOffset);
+  EXPECT_CALL(transportCallback_, lastByteFlushed());
+  auto txCbHandler = expectRegisterTxCallback(lastBodyByteOffset);
+  auto ackCbHandler = expectRegisterDeliveryCallback(lastBodyByteOffset);
+  tracker->processByteEvents(tracker, lastBodyByteOffset);
+  Mock::VerifyAndClearExpectations(&socket_);
+  EXPECT_EQ(2, txn_.getNumPendingByteEvents());
+
+  EXPECT_CALL(transportCallback_, trackedByteEventTX(_)).Times(0);
+  EXPECT_CALL(transportCallback_, trackedByteEventAck(_)).Times(0);
+  (*txCbHandler)
+      ->onByteEventCanceled(QuicByteEvent{.id = streamId_,
+                                          .offset = lastBodyByteOffset,
+                                          .type = QuicByteEventType::TX});
+  (*ackCbHandler)
+      ->onByteEventCanceled(QuicByteEvent{.id = streamId_,
+                                          .offset = lastBodyByteOffset,
+                                          .type = QuicByteEventType::ACK});
+  EXPECT_EQ(0, txn_.getNumPendingByteEvents());
+  EXPECT_EQ(0, tracker->getNumPendingBatchedEvents());
+}
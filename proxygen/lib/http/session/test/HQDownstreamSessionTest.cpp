@@ -8,6 +8,7 @@
 
 #include <folly/Expected.h>
 #include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <proxygen/lib/http/session/HQWebTransportSession.h>
 
 #include <folly/io/async/EventBaseManager.h>
 #include <proxygen/lib/http/codec/HQControlCodec.h>
@@ -310,6 +311,75 @@ TEST_P(HQDownstreamSessionTest, SimpleGet) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTest, EarlyDataFlag) {
+  // Until the handshake completes, requests are 0-RTT
+  sendRequest();
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([](std::shared_ptr<HTTPMessage> msg) {
+    EXPECT_TRUE(msg->isEarlyData());
+  });
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  flushRequestsAndLoop();
+
+  hqSession_->onFullHandshakeDone();
+  sendRequest();
+  handler = addSimpleStrictHandler();
+  handler->expectHeaders([](std::shared_ptr<HTTPMessage> msg) {
+    EXPECT_FALSE(msg->isEarlyData());
+  });
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  flushRequestsAndLoop();
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTest, BatchedReads) {
+  hqSession_->setBatchedReads(true);
+  std::vector<std::unique_ptr<StrictMock<MockHTTPHandler>>> handlers;
+  for (size_t i = 0; i < 3; i++) {
+    sendRequest();
+    handlers.push_back(addSimpleStrictHandler());
+  }
+  for (auto& handler : handlers) {
+    handler->expectHeaders([&handlers] {
+      // All three streams were parsed before any handler callback ran
+      EXPECT_NE(handlers.back()->txn_, nullptr);
+    });
+    handler->expectEOM(
+        [hdlr = handler.get()] { hdlr->sendReplyWithBody(200, 100); });
+    handler->expectDetachTransaction();
+  }
+  flushRequestsAndLoop();
+  for (auto& req : requests_) {
+    EXPECT_TRUE(socketDriver_->streams_[req.first].writeEOF);
+  }
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTest, QPACKWarmTable) {
+  auto warmTable = std::make_shared<std::vector<HPACKHeader>>();
+  warmTable->emplace_back(":status", "200"); // static, skipped
+  warmTable->emplace_back("x-warm", "entry");
+  warmTable->emplace_back("server", "proxygen");
+  hqSession_->setQPACKWarmTable(warmTable);
+  flushRequestsAndLoop(); // SETTINGS trigger the inserts
+  EXPECT_EQ(qpackCodec_.getCompressionInfo().ingress.headersStored_, 2);
+
+  auto id = sendRequest();
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] {
+    auto resp = makeResponse(200, 0);
+    std::get<0>(resp)->getHeaders().add("server", "proxygen");
+    handler->sendRequest(*std::get<0>(resp));
+  });
+  handler->expectDetachTransaction();
+  flushRequestsAndLoop();
+  EXPECT_TRUE(socketDriver_->streams_[id].writeEOF);
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTest, PriorityUpdateIntoTransport) {
   auto request = getProgressiveGetRequest();
   sendRequest(request);
@@ -330,6 +400,30 @@ TEST_P(HQDownstreamSessionTest, PriorityUpdateIntoTransport) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTest, SmallResponseNotIncremental) {
+  hqSession_->setIncrementalMinResponseSize(1000);
+  for (auto length : {100, 2000}) {
+    auto request = getProgressiveGetRequest();
+    sendRequest(request);
+    auto handler = addSimpleStrictHandler();
+    EXPECT_CALL(*socketDriver_->getSocket(),
+                setStreamPriority(_, Priority(1, true)));
+    handler->expectHeaders();
+    handler->expectEOM([&, length]() {
+      EXPECT_CALL(*socketDriver_->getSocket(), getStreamPriority(_))
+          .WillRepeatedly(Return(quic::Priority(1, length > 1000)));
+      // Only the small one changes
+      EXPECT_CALL(*socketDriver_->getSocket(),
+                  setStreamPriority(_, Priority(1, false)))
+          .Times(length > 1000 ? 0 : 1);
+      handler->sendReplyWithBody(200, length);
+    });
+    handler->expectDetachTransaction();
+    flushRequestsAndLoop();
+  }
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTest, ReplyResponsePriority) {
   auto request = getProgressiveGetRequest();
   sendRequest(request);
@@ -2743,6 +2837,57 @@ TEST_P(HQDownstreamSessionTest, DelegateResponseError) {
   hqSession_->closeWhenIdle();
 }
 
+TEST_P(HQDownstreamSessionTest, DelegateObjectResponse) {
+  // The body of the response is a range of an object a backend holds
+  sendRequest("/cdn.thing", 0, true);
+  InSequence handlerSequence;
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  auto backend = std::make_unique<StrictMock<MockDSRObjectBackend>>();
+  auto rawBackend = backend.get();
+  std::unique_ptr<quic::DSRPacketizationRequestSender> senderStorage;
+  handler->expectEOM([&]() {
+    handler->txn_->setTransportCallback(&transportCallback_);
+    EXPECT_CALL(*socketDriver_->getSocket(),
+                setDSRPacketizationRequestSender(_, _))
+        .WillOnce(Invoke(
+            [&](StreamId,
+                std::unique_ptr<quic::DSRPacketizationRequestSender> sender) {
+              senderStorage = std::move(sender);
+              return folly::unit;
+            }));
+    HTTPMessage response;
+    response.setStatusCode(200);
+    EXPECT_TRUE(DSRObjectSender::sendResponse(*handler->txn_,
+                                              std::move(response),
+                                              {"object-1", 4096, 10 * 1000},
+                                              std::move(backend)));
+    auto dataFrameHeaderSize = transportCallback_.bodyBytesGenerated_;
+    EXPECT_GT(dataFrameHeaderSize, 0);
+    auto sender = dynamic_cast<DSRObjectSender*>(senderStorage.get());
+    ASSERT_NE(sender, nullptr);
+    // The body placeholders and EOM were queued from the headers callback
+    EXPECT_TRUE(handler->txn_->hasPendingBody());
+    handler->txn_->onWriteReady(10 * 1000, 1.0);
+    EXPECT_EQ(transportCallback_.bodyBytesGenerated_,
+              10 * 1000 + dataFrameHeaderSize);
+
+    EXPECT_CALL(*rawBackend, flush()).WillOnce(Return(true));
+    EXPECT_TRUE(sender->flush());
+    eventBase_.runInLoop([&] {
+      ASSERT_TRUE(transportCallback_.lastByteFlushed_);
+      handler->expectDetachTransaction();
+      EXPECT_CALL(*socketDriver_->getSocket(),
+                  setDSRPacketizationRequestSender(Eq(0), Eq(nullptr)));
+    });
+  });
+  flushRequestsAndLoop();
+  EXPECT_CALL(*rawBackend, release());
+  // As mvfst does when the stream is done with it
+  senderStorage->release();
+  hqSession_->closeWhenIdle();
+}
+
 TEST_P(HQDownstreamSessionTest, getHTTPPriority) {
   folly::Optional<HTTPPriority> expectedResults = HTTPPriority{1, true};
 
@@ -3333,3 +3478,172 @@ INSTANTIATE_TEST_SUITE_P(HQDownstreamSessionTest,
                            return tp;
                          }()),
                          paramsToTestName);
+
+namespace {
+class MockWebTransportHandler : public HQSession::WebTransportHandler {
+ public:
+  MOCK_METHOD(void, onNewStream, (quic::StreamId, bool), (noexcept));
+  MOCK_METHOD(void,
+              onStreamData,
+              (quic::StreamId, std::unique_ptr<folly::IOBuf>, bool),
+              (noexcept));
+  MOCK_METHOD(void,
+              onStreamError,
+              (quic::StreamId, quic::QuicError),
+              (noexcept));
+  MOCK_METHOD(void, onDatagram, (std::unique_ptr<folly::IOBuf>), (noexcept));
+  MOCK_METHOD(void, onSessionEnd, (), (noexcept));
+};
+
+std::unique_ptr<folly::IOBuf> makeWebTransportStreamData(
+    uint64_t type, quic::StreamId sessionId, folly::StringPiece data) {
+  folly::IOBufQueue buf{folly::IOBufQueue::cacheChainLength()};
+  folly::io::QueueAppender appender(&buf, 16);
+  auto appendInt = [&](auto val) { appender.writeBE(val); };
+  quic::encodeQuicInteger(type, appendInt);
+  quic::encodeQuicInteger(sessionId, appendInt);
+  appender.push(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+  return buf.move();
+}
+
+constexpr uint64_t kWebTransportBidi =
+    folly::to_underlying(hq::BidirectionalStreamType::WEBTRANSPORT);
+constexpr uint64_t kWebTransportUni =
+    folly::to_underlying(hq::UnidirectionalStreamType::WEBTRANSPORT);
+} // namespace
+
+using HQDownstreamSessionTestWebTransport = HQDownstreamSessionTest;
+
+TEST_P(HQDownstreamSessionTestWebTransport, Streams) {
+  StrictMock<MockWebTransportHandler> wtHandler;
+  HQWebTransportSession* wtSession = nullptr;
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&] {
+    HTTPMessage resp;
+    resp.setStatusCode(200);
+    handler->txn_->sendHeaders(resp);
+    wtSession = hqSession_->startWebTransport(handler->txn_, &wtHandler);
+  });
+  HTTPMessage req;
+  req.setURL("/wt");
+  req.setMethod("CONNECT");
+  req.setUpgradeProtocol("webtransport");
+  req.getHeaders().add(HTTP_HEADER_HOST, "test.net");
+  auto sessionId = sendRequest(req, /* eom */ false);
+  flushRequestsAndLoopN(1);
+  ASSERT_NE(wtSession, nullptr);
+  EXPECT_EQ(wtSession->getSessionId(), sessionId);
+  EXPECT_EQ(hqSession_->startWebTransport(handler->txn_, &wtHandler), nullptr);
+
+  // Peer streams, with the data as read
+  auto bidiId = nextStreamId();
+  auto uniId = nextUnidirectionalStreamId();
+  std::vector<std::string> received;
+  auto onData = [&](quic::StreamId, std::unique_ptr<folly::IOBuf> buf, bool) {
+    received.push_back(buf->moveToFbString().toStdString());
+  };
+  EXPECT_CALL(wtHandler, onNewStream(bidiId, true));
+  EXPECT_CALL(wtHandler, onStreamData(bidiId, _, false)).WillOnce(onData);
+  EXPECT_CALL(wtHandler, onNewStream(uniId, false));
+  EXPECT_CALL(wtHandler, onStreamData(uniId, _, true)).WillOnce(onData);
+  socketDriver_->addReadEvent(
+      bidiId, makeWebTransportStreamData(kWebTransportBidi, sessionId, "hi"));
+  socketDriver_->addReadEvent(
+      uniId,
+      makeWebTransportStreamData(kWebTransportUni, sessionId, "there"),
+      true);
+  flushRequestsAndLoopN(1);
+  EXPECT_EQ(received, std::vector<std::string>({"hi", "there"}));
+  // The uni stream is done
+  EXPECT_EQ(wtSession->numIncomingStreams(true), 1);
+  EXPECT_EQ(wtSession->numIncomingStreams(false), 0);
+
+  // Unknown session, and over the stream limit
+  auto unknownId = nextStreamId();
+  auto overLimitId = nextStreamId();
+  wtSession->setMaxIncomingStreams(1);
+  socketDriver_->addReadEvent(
+      unknownId, makeWebTransportStreamData(kWebTransportBidi, 1000, "x"));
+  socketDriver_->addReadEvent(
+      overLimitId,
+      makeWebTransportStreamData(kWebTransportBidi, sessionId, "y"));
+  flushRequestsAndLoopN(1);
+  EXPECT_EQ(*socketDriver_->streams_[unknownId].error,
+            HTTP3::ErrorCode::HTTP_STREAM_CREATION_ERROR);
+  EXPECT_EQ(*socketDriver_->streams_[overLimitId].error,
+            HQWebTransportSession::kBufferedStreamRejected);
+
+  // Egress stream, prefaced with the type and the session id
+  auto egressId = wtSession->createStream(true);
+  ASSERT_TRUE(egressId.hasValue());
+  EXPECT_TRUE(
+      wtSession->writeStream(*egressId, folly::IOBuf::copyBuffer("ok"), true)
+          .hasValue());
+  flushRequestsAndLoopN(1);
+  auto written = socketDriver_->streams_[*egressId].writeBuf.move();
+  folly::io::Cursor cursor(written.get());
+  EXPECT_EQ(quic::decodeQuicInteger(cursor)->first, kWebTransportBidi);
+  EXPECT_EQ(quic::decodeQuicInteger(cursor)->first, sessionId);
+  EXPECT_EQ(cursor.readFixedString(cursor.totalLength()), "ok");
+  EXPECT_TRUE(socketDriver_->streams_[*egressId].writeEOF);
+
+  // Ending the CONNECT stream ends the session and resets its streams
+  EXPECT_CALL(wtHandler, onSessionEnd());
+  handler->expectDetachTransaction();
+  handler->terminate();
+  flushRequestsAndLoop();
+  EXPECT_EQ(*socketDriver_->streams_[bidiId].error,
+            HQWebTransportSession::kSessionGone);
+  hqSession_->closeWhenIdle();
+}
+
+TEST_P(HQDownstreamSessionTestWebTransport, Datagrams) {
+  StrictMock<MockWebTransportHandler> wtHandler;
+  HQWebTransportSession* wtSession = nullptr;
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&] {
+    HTTPMessage resp;
+    resp.setStatusCode(200);
+    handler->txn_->sendHeaders(resp);
+    wtSession = hqSession_->startWebTransport(handler->txn_, &wtHandler);
+  });
+  HTTPMessage req;
+  req.setURL("/wt");
+  req.setMethod("CONNECT");
+  req.setUpgradeProtocol("webtransport");
+  req.getHeaders().add(HTTP_HEADER_HOST, "test.net");
+  auto sessionId = sendRequest(req, /* eom */ false);
+  flushRequestsAndLoopN(1);
+  ASSERT_NE(wtSession, nullptr);
+
+  EXPECT_CALL(*handler, _onDatagram(_)).Times(0);
+  EXPECT_CALL(wtHandler, onDatagram(_))
+      .WillOnce([](std::unique_ptr<folly::IOBuf> payload) {
+        EXPECT_EQ(payload->moveToFbString().toStdString(), "ping");
+      });
+  socketDriver_->addDatagram(
+      getH3Datagram(sessionId, folly::IOBuf::copyBuffer("ping")));
+  socketDriver_->addDatagramsAvailableReadEvent();
+  flushRequestsAndLoopN(1);
+
+  EXPECT_TRUE(wtSession->sendDatagram(folly::IOBuf::copyBuffer("pong")));
+  EXPECT_EQ(socketDriver_->outDatagrams_.size(), 1);
+
+  // Closing leaves the CONNECT stream to the handler
+  wtSession->close();
+  handler->expectDetachTransaction();
+  handler->terminate();
+  flushRequestsAndLoop();
+  hqSession_->closeWhenIdle();
+}
+
+INSTANTIATE_TEST_SUITE_P(HQDownstreamSessionTest,
+                         HQDownstreamSessionTestWebTransport,
+                         Values([] {
+                           TestParams tp;
+                           tp.alpn_ = "h3";
+                           tp.datagrams_ = true;
+                           tp.webTransport_ = true;
+                           return tp;
+                         }()),
+                         paramsToTestName);
@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/io/async/EventBase.h>
+#include <proxygen/lib/http/codec/HQControlCodec.h>
+#include <proxygen/lib/http/codec/HQStreamCodec.h>
+#include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <proxygen/lib/http/session/test/HQSessionTestCommon.h>
+#include <proxygen/lib/http/session/test/MockQuicSocketDriver.h>
+#include <proxygen/lib/http/session/test/TestUtils.h>
+
+using namespace proxygen;
+using namespace proxygen::hq;
+
+namespace {
+
+constexpr quic::StreamId kControlStreamId = 2;
+constexpr quic::StreamId kQPACKEncoderStreamId = 6;
+constexpr quic::StreamId kQPACKDecoderStreamId = 10;
+
+// Replies 200 with no body as soon as the request is complete
+class BenchHandler : public HTTPTransactionHandler {
+ public:
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+  void detachTransaction() noexcept override {
+    delete this;
+  }
+  void onHeadersComplete(std::unique_ptr<HTTPMessage>) noexcept override {
+  }
+  void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders>) noexcept override {
+  }
+  void onEOM() noexcept override {
+    HTTPMessage resp;
+    resp.setStatusCode(200);
+    resp.setStatusMessage("OK");
+    txn_->sendHeadersWithEOM(resp);
+  }
+  void onUpgrade(UpgradeProtocol) noexcept override {
+  }
+  void onError(const HTTPException&) noexcept override {
+  }
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  HTTPTransaction* txn_{nullptr};
+};
+
+// Replies 200 with a body of the size the path asks for: /<bytes>
+class PageHandler : public BenchHandler {
+ public:
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+  void onHeadersComplete(std::unique_ptr<HTTPMessage> msg) noexcept override {
+    length_ = folly::to<size_t>(msg->getPathAsStringPiece().subpiece(1));
+  }
+  void onEOM() noexcept override {
+    HTTPMessage resp;
+    resp.setStatusCode(200);
+    resp.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                          folly::to<std::string>(length_));
+    txn_->sendHeaders(resp);
+    txn_->sendBody(folly::IOBuf::copyBuffer(std::string(length_, 'a')));
+    txn_->sendEOM();
+  }
+
+ private:
+  HTTPTransaction* txn_{nullptr};
+  size_t length_{0};
+};
+
+class BenchController : public HTTPSessionController {
+ public:
+  explicit BenchController(bool page = false) : page_(page) {
+  }
+
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction&,
+                                            HTTPMessage*) override {
+    if (page_) {
+      return new PageHandler();
+    }
+    return new BenchHandler();
+  }
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction*,
+      const HTTPException&,
+      const folly::SocketAddress&) override {
+    return nullptr;
+  }
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction*, const folly::SocketAddress&) override {
+    return nullptr;
+  }
+  void attachSession(HTTPSessionBase*) override {
+  }
+  void detachSession(const HTTPSessionBase*) override {
+  }
+
+ private:
+  bool page_;
+};
+
+// Each iteration delivers numStreams small GET requests to one HQ session in
+// the same event loop
+void runRequests(size_t iters, size_t numStreams, bool batched) {
+  folly::EventBase evb;
+  BenchController controller;
+  auto session = new HQDownstreamSession(
+      std::chrono::milliseconds(5000), &controller, mockTransportInfo, nullptr);
+  quic::MockQuicSocketDriver socketDriver(
+      &evb,
+      session,
+      session,
+      quic::MockQuicSocketDriver::TransportEnum::SERVER,
+      kH3);
+  quic::QuicSocket::TransportInfo transportInfo;
+  EXPECT_CALL(*socketDriver.getSocket(), getTransportInfo())
+      .WillRepeatedly(testing::Return(transportInfo));
+  EXPECT_CALL(*socketDriver.getSocket(), getStreamTransportInfo(testing::_))
+      .WillRepeatedly(
+          testing::Return(quic::QuicSocket::StreamTransportInfo()));
+  session->setSocket(socketDriver.getSocket());
+  session->setBatchedReads(batched);
+  session->onTransportReady();
+
+  HTTPSettings settings;
+  HQControlCodec controlCodec(kControlStreamId,
+                              TransportDirection::UPSTREAM,
+                              StreamDirection::EGRESS,
+                              settings);
+  createControlStream(
+      &socketDriver, kControlStreamId, UnidirectionalStreamType::CONTROL);
+  createControlStream(&socketDriver,
+                      kQPACKEncoderStreamId,
+                      UnidirectionalStreamType::QPACK_ENCODER);
+  createControlStream(&socketDriver,
+                      kQPACKDecoderStreamId,
+                      UnidirectionalStreamType::QPACK_DECODER);
+  folly::IOBufQueue settingsBuf{folly::IOBufQueue::cacheChainLength()};
+  controlCodec.generateSettings(settingsBuf);
+  socketDriver.addReadEvent(
+      kControlStreamId, settingsBuf.move(), std::chrono::milliseconds(0));
+  evb.loopOnce();
+
+  QPACKCodec qpackCodec;
+  folly::IOBufQueue encoderWriteBuf{folly::IOBufQueue::cacheChainLength()};
+  folly::IOBufQueue decoderWriteBuf{folly::IOBufQueue::cacheChainLength()};
+  auto req = getGetRequest();
+  quic::StreamId nextStreamId = 0;
+  for (size_t i = 0; i < iters; i++) {
+    BENCHMARK_SUSPEND {
+      for (size_t j = 0; j < numStreams; j++) {
+        auto id = nextStreamId;
+        nextStreamId += 4;
+        HQStreamCodec codec(
+            id,
+            TransportDirection::UPSTREAM,
+            qpackCodec,
+            encoderWriteBuf,
+            decoderWriteBuf,
+            [] { return std::numeric_limits<uint64_t>::max(); },
+            settings);
+        folly::IOBufQueue buf{folly::IOBufQueue::cacheChainLength()};
+        codec.generateHeader(buf, codec.createStream(), req, true);
+        socketDriver.addReadEvent(
+            id, buf.move(), std::chrono::milliseconds(0));
+        socketDriver.addReadEOF(id, std::chrono::milliseconds(0));
+      }
+      if (!encoderWriteBuf.empty()) {
+        socketDriver.addReadEvent(kQPACKEncoderStreamId,
+                                  encoderWriteBuf.move(),
+                                  std::chrono::milliseconds(0));
+      }
+    }
+    evb.loop();
+  }
+  BENCHMARK_SUSPEND {
+    session->closeWhenIdle();
+    evb.loop();
+  }
+}
+
+// The peer's control and QPACK streams, and its SETTINGS
+void deliverPeerSetup(quic::MockQuicSocketDriver* socketDriver,
+                      folly::EventBase& evb) {
+  createControlStream(
+      socketDriver, kControlStreamId, UnidirectionalStreamType::CONTROL);
+  createControlStream(socketDriver,
+                      kQPACKEncoderStreamId,
+                      UnidirectionalStreamType::QPACK_ENCODER);
+  createControlStream(socketDriver,
+                      kQPACKDecoderStreamId,
+                      UnidirectionalStreamType::QPACK_DECODER);
+  HTTPSettings settings;
+  HQControlCodec controlCodec(kControlStreamId,
+                              TransportDirection::UPSTREAM,
+                              StreamDirection::EGRESS,
+                              settings);
+  folly::IOBufQueue settingsBuf{folly::IOBufQueue::cacheChainLength()};
+  controlCodec.generateSettings(settingsBuf);
+  socketDriver->addReadEvent(
+      kControlStreamId, settingsBuf.move(), std::chrono::milliseconds(0));
+  evb.loopOnce();
+}
+
+std::unique_ptr<quic::MockQuicSocketDriver> makeSocketDriver(
+    folly::EventBase& evb, HQDownstreamSession* session) {
+  auto socketDriver = std::make_unique<quic::MockQuicSocketDriver>(
+      &evb,
+      session,
+      session,
+      quic::MockQuicSocketDriver::TransportEnum::SERVER,
+      kH3);
+  EXPECT_CALL(*socketDriver->getSocket(), getTransportInfo())
+      .WillRepeatedly(testing::Return(quic::QuicSocket::TransportInfo()));
+  return socketDriver;
+}
+
+// Each iteration sets up one HQ session: transport ready, the peer's control
+// and QPACK streams dispatched and its SETTINGS parsed
+void runConnectionSetup(size_t iters) {
+  folly::EventBase evb;
+  BenchController controller;
+  for (size_t i = 0; i < iters; i++) {
+    HQDownstreamSession* session{nullptr};
+    std::unique_ptr<quic::MockQuicSocketDriver> socketDriver;
+    BENCHMARK_SUSPEND {
+      session = new HQDownstreamSession(std::chrono::milliseconds(5000),
+                                        &controller,
+                                        mockTransportInfo,
+                                        nullptr);
+      socketDriver = makeSocketDriver(evb, session);
+    }
+    session->setSocket(socketDriver->getSocket());
+    session->onTransportReady();
+    deliverPeerSetup(socketDriver.get(), evb);
+    BENCHMARK_SUSPEND {
+      session->closeWhenIdle();
+      evb.loop();
+      socketDriver.reset();
+    }
+  }
+}
+
+// As above, with the session constructed and torn down in the measurement,
+// the whole lifetime of a short-lived connection without requests.  Only the
+// mock socket is set up outside of it.
+void runConnectionLifetime(size_t iters) {
+  folly::EventBase evb;
+  BenchController controller;
+  for (size_t i = 0; i < iters; i++) {
+    auto session = new HQDownstreamSession(std::chrono::milliseconds(5000),
+                                           &controller,
+                                           mockTransportInfo,
+                                           nullptr);
+    std::unique_ptr<quic::MockQuicSocketDriver> socketDriver;
+    BENCHMARK_SUSPEND {
+      socketDriver = makeSocketDriver(evb, session);
+    }
+    session->setSocket(socketDriver->getSocket());
+    session->onTransportReady();
+    deliverPeerSetup(socketDriver.get(), evb);
+    session->closeWhenIdle();
+    evb.loop();
+    BENCHMARK_SUSPEND {
+      socketDriver.reset();
+    }
+  }
+}
+
+// Each iteration loads a page of incremental requests for objects, half of
+// them small and half large, and reprioritizes each with a PRIORITY_UPDATE,
+// with the responses under minResponseSize sent non-incremental.  The mock
+// transport doesn't schedule, so this measures the session's side of it.
+void runMixedPage(size_t iters, uint64_t minResponseSize) {
+  constexpr size_t kObjects = 16;
+  constexpr size_t kSmall = 1000;
+  constexpr size_t kLarge = 16000;
+  folly::EventBase evb;
+  BenchController controller(true);
+  auto session = new HQDownstreamSession(
+      std::chrono::milliseconds(5000), &controller, mockTransportInfo, nullptr);
+  auto socketDriver = makeSocketDriver(evb, session);
+  EXPECT_CALL(*socketDriver->getSocket(), getStreamTransportInfo(testing::_))
+      .WillRepeatedly(
+          testing::Return(quic::QuicSocket::StreamTransportInfo()));
+  session->setSocket(socketDriver->getSocket());
+  session->setIncrementalMinResponseSize(minResponseSize);
+  session->onTransportReady();
+  deliverPeerSetup(socketDriver.get(), evb);
+
+  HTTPSettings settings;
+  HQControlCodec controlCodec(kControlStreamId,
+                              TransportDirection::UPSTREAM,
+                              StreamDirection::EGRESS,
+                              settings);
+  QPACKCodec qpackCodec;
+  folly::IOBufQueue encoderWriteBuf{folly::IOBufQueue::cacheChainLength()};
+  folly::IOBufQueue decoderWriteBuf{folly::IOBufQueue::cacheChainLength()};
+  quic::StreamId nextStreamId = 0;
+  for (size_t i = 0; i < iters; i++) {
+    BENCHMARK_SUSPEND {
+      socketDriver->setConnectionFlowControlWindow(kObjects * kLarge);
+      folly::IOBufQueue updates{folly::IOBufQueue::cacheChainLength()};
+      for (size_t j = 0; j < kObjects; j++) {
+        auto id = nextStreamId;
+        nextStreamId += 4;
+        auto req = getGetRequest(
+            folly::to<std::string>("/", j % 2 ? kLarge : kSmall));
+        req.getHeaders().set(HTTP_HEADER_PRIORITY, "u=3, i");
+        HQStreamCodec codec(
+            id,
+            TransportDirection::UPSTREAM,
+            qpackCodec,
+            encoderWriteBuf,
+            decoderWriteBuf,
+            [] { return std::numeric_limits<uint64_t>::max(); },
+            settings);
+        folly::IOBufQueue buf{folly::IOBufQueue::cacheChainLength()};
+        codec.generateHeader(buf, codec.createStream(), req, true);
+        socketDriver->addReadEvent(
+            id, buf.move(), std::chrono::milliseconds(0));
+        socketDriver->addReadEOF(id, std::chrono::milliseconds(0));
+        controlCodec.generatePriority(updates, id, HTTPPriority(2, true));
+      }
+      if (!encoderWriteBuf.empty()) {
+        socketDriver->addReadEvent(kQPACKEncoderStreamId,
+                                   encoderWriteBuf.move(),
+                                   std::chrono::milliseconds(0));
+      }
+      socketDriver->addReadEvent(
+          kControlStreamId, updates.move(), std::chrono::milliseconds(0));
+    }
+    evb.loop();
+  }
+  BENCHMARK_SUSPEND {
+    session->closeWhenIdle();
+    evb.loop();
+  }
+}
+
+} // namespace
+
+BENCHMARK(ConnectionSetup, iters) {
+  runConnectionSetup(iters);
+}
+
+BENCHMARK(ConnectionLifetime, iters) {
+  runConnectionLifetime(iters);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(PerStreamReads16, iters) {
+  runRequests(iters, 16, false);
+}
+
+BENCHMARK_RELATIVE(BatchedReads16, iters) {
+  runRequests(iters, 16, true);
+}
+
+BENCHMARK(PerStreamReads256, iters) {
+  runRequests(iters, 256, false);
+}
+
+BENCHMARK_RELATIVE(BatchedReads256, iters) {
+  runRequests(iters, 256, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(MixedPageIncremental, iters) {
+  runMixedPage(iters, 0);
+}
+
+BENCHMARK_RELATIVE(MixedPageSmallWhole, iters) {
+  runMixedPage(iters, 4096);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleMock(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -10,6 +10,7 @@
 
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/DSRObjectSender.h>
 #include <proxygen/lib/http/session/HQSession.h>
 #include <proxygen/lib/http/session/HQStreamDispatcher.h>
 #include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
@@ -391,4 +392,13 @@ class MockQuicDSRRequestSender
   MockQuicDSRRequestSender() = default;
 };
 
+class MockDSRObjectBackend : public DSRObjectSender::Backend {
+ public:
+  MOCK_METHOD(bool,
+              addSendInstruction,
+              (const quic::SendInstruction&, const DSRObject&, uint64_t));
+  MOCK_METHOD(bool, flush, ());
+  MOCK_METHOD(void, release, ());
+};
+
 } // namespace proxygen
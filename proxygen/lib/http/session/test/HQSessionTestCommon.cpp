@@ -83,6 +83,9 @@ std::string paramsToTestName(const testing::TestParamInfo<TestParams>& info) {
   if (info.param.datagrams_) {
     paramsV.push_back("_datagrams");
   }
+  if (info.param.webTransport_) {
+    paramsV.push_back("_webtransport");
+  }
   return folly::join("", paramsV);
 }
 
@@ -44,6 +44,7 @@ struct TestParams {
   std::size_t numBytesOnPushStream{kUnlimited};
   bool expectOnTransportReady{true};
   bool datagrams_{false};
+  bool webTransport_{false};
   bool checkUniridStreamCallbacks{true};
 };
 
@@ -122,6 +123,11 @@ class HQSessionTest
     if (GetParam().datagrams_) {
       egressSettings_.setSetting(proxygen::SettingsId::_HQ_DATAGRAM, 1);
     }
+    if (GetParam().webTransport_) {
+      egressSettings_.setSetting(proxygen::SettingsId::ENABLE_CONNECT_PROTOCOL,
+                                 1);
+      egressSettings_.setSetting(proxygen::SettingsId::ENABLE_WEBTRANSPORT, 1);
+    }
 
     egressControlCodec_ = std::make_unique<proxygen::hq::HQControlCodec>(
         nextUnidirectionalStreamId_,
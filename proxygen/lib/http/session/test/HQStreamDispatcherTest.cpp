@@ -64,12 +64,12 @@ class MockDispatcher : public HQUniStreamDispatcher::Callback {
   }
 
   std::chrono::milliseconds getDispatchTimeout() const override {
-    return std::chrono::seconds(1);
+    return dispatchTimeout_;
   }
 
   MOCK_METHOD(void, dispatchPushStream, (quic::StreamId, hq::PushId, size_t));
   MOCK_METHOD(void,
-              dispatchUniWTStream,
+              dispatchWebTransportStream,
               (quic::StreamId, quic::StreamId, size_t));
   MOCK_METHOD(void,
               dispatchControlStream,
@@ -80,6 +80,7 @@ class MockDispatcher : public HQUniStreamDispatcher::Callback {
   MOCK_METHOD(void, rejectStream, (quic::StreamId));
 
   folly::EventBase* evb_{nullptr};
+  std::chrono::milliseconds dispatchTimeout_{std::chrono::seconds(1)};
 };
 
 class UnidirectionalReadDispatcherTest : public Test {
@@ -168,6 +169,29 @@ TEST_F(UnidirectionalReadDispatcherTest, TestDispatchControlPreface) {
            atLeastBytes);
 }
 
+TEST_F(UnidirectionalReadDispatcherTest, TestDispatchWebTransportPreface) {
+  quic::StreamId expectedId = 7;
+  quic::StreamId expectedSessionId = 4;
+  uint8_t atLeastBytes = 2;
+  dispatcherCallback_->expectParsePreface([&](uint64_t /* type */) {
+    return hq::UnidirectionalStreamType::WEBTRANSPORT;
+  });
+  EXPECT_CALL(*dispatcherCallback_, dispatchWebTransportStream(_, _, _))
+      .WillOnce([&](quic::StreamId id,
+                    quic::StreamId sessionId,
+                    size_t consumed) {
+        EXPECT_EQ(id, expectedId);
+        EXPECT_EQ(sessionId, expectedSessionId);
+        EXPECT_EQ(consumed, atLeastBytes + atLeastBytes);
+      });
+  dispatcher_->takeTemporaryOwnership(expectedId);
+  sendData(expectedId,
+           static_cast<uint64_t>(hq::UnidirectionalStreamType::WEBTRANSPORT),
+           expectedSessionId,
+           atLeastBytes);
+  EXPECT_FALSE(dispatcher_->hasOwnership(expectedId));
+}
+
 TEST_F(UnidirectionalReadDispatcherTest,
        TestDispatchPushPrefaceNewPushStreamApi) {
 
@@ -222,3 +246,41 @@ TEST_F(UnidirectionalReadDispatcherTest, TestRejectUnrecognizedPreface) {
            static_cast<uint64_t>(hq::UnidirectionalStreamType::CONTROL),
            atLeastBytes);
 }
+
+TEST_F(UnidirectionalReadDispatcherTest, TestDispatchTimeoutCoalesced) {
+  dispatcherCallback_->dispatchTimeout_ = std::chrono::milliseconds(10);
+  std::vector<quic::StreamId> rejected;
+  EXPECT_CALL(*dispatcherCallback_, rejectStream(_))
+      .Times(2)
+      .WillRepeatedly(
+          Invoke([&](quic::StreamId id) { rejected.push_back(id); }));
+
+  dispatcher_->takeTemporaryOwnership(2);
+  dispatcher_->takeTemporaryOwnership(6);
+  dispatcher_->takeTemporaryOwnership(10);
+  EXPECT_EQ(dispatcher_->numberOfStreams(), 3);
+  EXPECT_TRUE(dispatcher_->hasOwnership(6));
+
+  // A released stream is not timed out
+  EXPECT_EQ(dispatcher_->releaseOwnership(6), 6);
+  EXPECT_FALSE(dispatcher_->hasOwnership(6));
+
+  evb_.loop();
+  EXPECT_EQ(rejected, std::vector<quic::StreamId>({2, 10}));
+  EXPECT_EQ(dispatcher_->numberOfStreams(), 0);
+}
+
+TEST_F(UnidirectionalReadDispatcherTest, TestReleaseAllCancelsTimeout) {
+  EXPECT_CALL(*dispatcherCallback_, rejectStream(_)).Times(0);
+
+  dispatcher_->takeTemporaryOwnership(2);
+  dispatcher_->takeTemporaryOwnership(6);
+  dispatcher_->releaseOwnership(2);
+  dispatcher_->releaseOwnership(6);
+
+  // Nothing is left scheduled, so the loop does not wait for the timeout
+  auto start = std::chrono::steady_clock::now();
+  evb_.loop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            dispatcherCallback_->getDispatchTimeout());
+}
@@ -2096,6 +2096,89 @@ TEST_P(HQUpstreamSessionTestDatagram, TestReceiveEarlyDatagramsSingleStream) {
   flushAndLoop();
 }
 
+namespace {
+class MockDatagramSink : public HQSession::DatagramSink {
+ public:
+  MOCK_METHOD(void,
+              onDatagram,
+              (quic::StreamId, std::unique_ptr<folly::IOBuf>),
+              (noexcept));
+};
+} // namespace
+
+TEST_P(HQUpstreamSessionTestDatagram, TestDatagramSink) {
+  auto handler = openTransaction();
+  auto id = handler->txn_->getID();
+  MockDatagramSink sink;
+  handler->txn_->sendHeaders(getGetRequest());
+  handler->txn_->sendEOM();
+  // Buffered until the response headers arrive
+  socketDriver_->addDatagram(
+      getH3Datagram(id, folly::IOBuf::wrapBuffer("early", 5)));
+  flushAndLoopN(1);
+  auto resp = makeResponse(200, 0);
+  sendResponse(id, *std::get<0>(resp), std::move(std::get<1>(resp)), false);
+  handler->expectHeaders([&] {
+    EXPECT_TRUE(hqSession_->setDatagramSink(id, &sink));
+  });
+  EXPECT_CALL(*handler, _onDatagram(testing::_)).Times(0);
+  std::vector<std::string> received;
+  EXPECT_CALL(sink, onDatagram(id, testing::_))
+      .Times(2)
+      .WillRepeatedly([&](quic::StreamId, std::unique_ptr<folly::IOBuf> buf) {
+        received.push_back(buf->moveToFbString().toStdString());
+      });
+  flushAndLoopN(1);
+  socketDriver_->addDatagram(
+      getH3Datagram(id, folly::IOBuf::wrapBuffer("testtest", 8)));
+  flushAndLoopN(1);
+  EXPECT_EQ(received, std::vector<std::string>({"early", "testtest"}));
+
+  auto it = streams_.find(id);
+  CHECK(it != streams_.end());
+  it->second.readEOF = true;
+  handler->expectEOM();
+  handler->expectDetachTransaction();
+  hqSession_->closeWhenIdle();
+  flushAndLoop();
+}
+
+TEST_P(HQUpstreamSessionTestDatagram, TestSendDatagrams) {
+  auto handler = openTransaction();
+  auto id = handler->txn_->getID();
+  std::vector<std::unique_ptr<folly::IOBuf>> datagrams;
+  // With headroom for the header
+  auto withHeadroom = folly::IOBuf::create(kMaxDatagramHeaderSize + 5);
+  withHeadroom->advance(kMaxDatagramHeaderSize);
+  memcpy(withHeadroom->writableData(), "first", 5);
+  withHeadroom->append(5);
+  const auto* payloadStart = withHeadroom->data();
+  datagrams.push_back(std::move(withHeadroom));
+  // Without headroom
+  datagrams.push_back(folly::IOBuf::copyBuffer("second"));
+  EXPECT_EQ(hqSession_->sendDatagrams(id, std::move(datagrams)), 2);
+
+  ASSERT_EQ(socketDriver_->outDatagrams_.size(), 2);
+  // The header went into the headroom, 1 byte quarter stream ID + context ID
+  EXPECT_EQ(socketDriver_->outDatagrams_[0].front()->data(), payloadStart - 2);
+  std::vector<std::string> payloads;
+  for (auto& out : socketDriver_->outDatagrams_) {
+    auto buf = out.move();
+    folly::io::Cursor cursor(buf.get());
+    auto quarterStreamId = quic::decodeQuicInteger(cursor);
+    ASSERT_TRUE(quarterStreamId);
+    EXPECT_EQ(quarterStreamId->first, id / 4);
+    EXPECT_EQ(cursor.read<uint8_t>(), 0);
+    payloads.push_back(cursor.readFixedString(cursor.totalLength()));
+  }
+  EXPECT_EQ(payloads, std::vector<std::string>({"first", "second"}));
+
+  handler->expectDetachTransaction();
+  handler->txn_->sendAbort();
+  hqSession_->closeWhenIdle();
+  eventBase_.loopOnce();
+}
+
 TEST_P(HQUpstreamSessionTestDatagram, TestReceiveEarlyDatagramsMultiStream) {
   auto deliveredDatagrams = 0;
   EXPECT_TRUE(httpCallbacks_.datagramEnabled);
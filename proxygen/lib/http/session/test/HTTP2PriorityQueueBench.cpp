@@ -8,9 +8,11 @@
 
 #include <folly/Benchmark.h>
 #include <folly/Range.h>
+#include <proxygen/lib/http/session/ExtensiblePriorityQueue.h>
 #include <proxygen/lib/http/session/HTTP2PriorityQueue.h>
 
 #include <algorithm>
+#include <vector>
 
 using namespace proxygen;
 
@@ -23,6 +25,32 @@ const proxygen::HTTPCodec::StreamID kRootNodeId =
 proxygen::HTTPTransaction* makeFakeTxn(proxygen::HTTPCodec::StreamID id) {
   return (proxygen::HTTPTransaction*)(fakeTxn + id);
 }
+
+const size_t kNumStreams = 10000;
+
+// Streams hang off the root with varying weights, the shape a client that
+// no longer builds dependency trees produces.
+void addTreeStreams(HTTP2PriorityQueue& q, size_t numStreams) {
+  for (size_t i = 0; i < numStreams; ++i) {
+    HTTPCodec::StreamID id = i * 2 + 1;
+    auto h = q.addTransaction(id,
+                              {kRootNodeId, false, uint8_t(i % 256)},
+                              makeFakeTxn(id),
+                              false,
+                              nullptr);
+    q.signalPendingEgress(h);
+  }
+}
+
+void addUrgencyStreams(ExtensiblePriorityQueue& q, size_t numStreams) {
+  for (size_t i = 0; i < numStreams; ++i) {
+    HTTPCodec::StreamID id = i * 2 + 1;
+    auto h = q.addTransaction(
+        id, http2::DefaultPriority, makeFakeTxn(id), false, nullptr);
+    q.updatePriority(id, HTTPPriority(i % 8, i % 2));
+    q.signalPendingEgress(h);
+  }
+}
 } // namespace
 
 BENCHMARK(Encode, iters) {
@@ -35,6 +63,69 @@ BENCHMARK(Encode, iters) {
   }
 }
 
+BENCHMARK(TreeNextEgress10k, iters) {
+  HTTP2PriorityQueue q(WheelTimerInstance(), kRootNodeId);
+  HTTP2PriorityQueue::NextEgressResult res;
+  BENCHMARK_SUSPEND {
+    addTreeStreams(q, kNumStreams);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    q.nextEgress(res, false);
+    folly::doNotOptimizeAway(res.size());
+    res.clear();
+  }
+}
+
+BENCHMARK_RELATIVE(UrgencyNextEgress10k, iters) {
+  ExtensiblePriorityQueue q(kRootNodeId);
+  ExtensiblePriorityQueue::NextEgressResult res;
+  BENCHMARK_SUSPEND {
+    addUrgencyStreams(q, kNumStreams);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    q.nextEgress(res);
+    folly::doNotOptimizeAway(res.size());
+    res.clear();
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+// Open, signal and close 10k streams
+BENCHMARK(TreeStreamChurn10k, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    HTTP2PriorityQueue q(WheelTimerInstance(), kRootNodeId);
+    std::vector<HTTP2PriorityQueue::Handle> handles;
+    handles.reserve(kNumStreams);
+    for (size_t j = 0; j < kNumStreams; ++j) {
+      HTTPCodec::StreamID id = j * 2 + 1;
+      handles.push_back(q.addTransaction(
+          id, http2::DefaultPriority, makeFakeTxn(id), false, nullptr));
+      q.signalPendingEgress(handles.back());
+    }
+    for (auto h : handles) {
+      q.removeTransaction(h);
+    }
+  }
+}
+
+BENCHMARK_RELATIVE(UrgencyStreamChurn10k, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    ExtensiblePriorityQueue q(kRootNodeId);
+    std::vector<ExtensiblePriorityQueue::Handle> handles;
+    handles.reserve(kNumStreams);
+    for (size_t j = 0; j < kNumStreams; ++j) {
+      HTTPCodec::StreamID id = j * 2 + 1;
+      handles.push_back(q.addTransaction(
+          id, http2::DefaultPriority, makeFakeTxn(id), false, nullptr));
+      q.signalPendingEgress(handles.back());
+    }
+    for (auto h : handles) {
+      q.removeTransaction(h);
+    }
+  }
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
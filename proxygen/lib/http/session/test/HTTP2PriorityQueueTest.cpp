@@ -163,6 +163,28 @@ TEST_F(QueueTest, RemoveParent) {
   EXPECT_EQ(nodes_, IDList({{0, 100}, {3, 25}, {7, 50}, {9, 25}}));
 }
 
+TEST_F(QueueTest, ReleaseIdleMemory) {
+  buildSimpleTree();
+  EXPECT_GT(q_.getPoolSize(), 0);
+
+  // Nothing is freed while there are nodes
+  q_.releaseIdleMemory();
+  EXPECT_GT(q_.getPoolSize(), 0);
+
+  for (auto id : {9, 7, 5, 3, 0}) {
+    removeTransaction(id);
+  }
+  q_.releaseIdleMemory();
+  EXPECT_EQ(q_.getPoolSize(), 0);
+  EXPECT_TRUE(q_.empty());
+
+  // The pool grows back
+  buildSimpleTree();
+  EXPECT_GT(q_.getPoolSize(), 0);
+  dump();
+  EXPECT_EQ(nodes_, IDList({{0, 100}, {3, 25}, {5, 25}, {9, 100}, {7, 50}}));
+}
+
 TEST_F(QueueTest, RemoveParentWeights) {
   // weight_ / totalChildWeight_ < 1
   addTransaction(0, {kRootNodeId, false, 0});
@@ -883,4 +905,19 @@ TEST_F(QueueTest, Rebuild) {
   EXPECT_EQ(nodes_, IDList({{3, 20}, {9, 20}, {5, 20}, {7, 20}, {0, 20}}));
 }
 
+TEST_F(QueueTest, ReuseNodes) {
+  // Nodes released by one generation of streams back the next one
+  for (auto round = 0; round < 40; round++) {
+    buildSimpleTree();
+    dump();
+    EXPECT_EQ(nodes_, IDList({{0, 100}, {3, 25}, {5, 25}, {9, 100}, {7, 50}}));
+    for (auto id : {3, 9, 0, 7, 5}) {
+      removeTransaction(id);
+    }
+    EXPECT_TRUE(q_.empty());
+    dump();
+    EXPECT_EQ(nodes_, IDList());
+  }
+}
+
 } // namespace proxygen
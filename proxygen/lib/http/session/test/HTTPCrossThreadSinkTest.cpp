@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+#include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
+#include <proxygen/lib/http/sink/HTTPCrossThreadSink.h>
+#include <thread>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+class MockSinkCallback : public HTTPCrossThreadSink::Callback {
+ public:
+  MOCK_METHOD(void, onEgressPaused, (), (noexcept));
+  MOCK_METHOD(void, onEgressResumed, (), (noexcept));
+};
+
+} // namespace
+
+class HTTPCrossThreadSinkTest : public Test {
+ public:
+  void SetUp() override {
+    timeouts_ = folly::HHWheelTimer::newTimer(
+        &evb_,
+        std::chrono::milliseconds(folly::HHWheelTimer::DEFAULT_TICK_INTERVAL),
+        folly::TimeoutManager::InternalEnum::INTERNAL,
+        std::chrono::milliseconds(60000));
+    txn_ = std::make_unique<MockHTTPTransaction>(TransportDirection::DOWNSTREAM,
+                                                 1,
+                                                 1,
+                                                 egressQueue_,
+                                                 timeouts_.get(),
+                                                 folly::none);
+  }
+
+  void init(HTTPCrossThreadSink::Options options) {
+    sink_ = HTTPCrossThreadSink::make(txn_.get(), &evb_, options);
+    sink_->setCallback(&callback_);
+  }
+
+ protected:
+  HTTP2PriorityQueue egressQueue_;
+  folly::EventBase evb_;
+  folly::HHWheelTimer::UniquePtr timeouts_;
+  std::unique_ptr<MockHTTPTransaction> txn_;
+  std::shared_ptr<HTTPCrossThreadSink> sink_;
+  StrictMock<MockSinkCallback> callback_;
+};
+
+TEST_F(HTTPCrossThreadSinkTest, OneDrainPerBatch) {
+  init(HTTPCrossThreadSink::Options());
+  std::thread producer([this] {
+    EXPECT_TRUE(sink_->sendHeaders(*makeResponse(200)));
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_TRUE(sink_->sendBody(makeBuf(100)));
+    }
+    EXPECT_TRUE(sink_->sendEOM());
+    // Nothing after the EOM
+    EXPECT_FALSE(sink_->sendBody(makeBuf(100)));
+  });
+  producer.join();
+  EXPECT_EQ(sink_->getQueuedBytes(), 1000);
+
+  InSequence enforceOrder;
+  EXPECT_CALL(*txn_, sendHeaders(_));
+  EXPECT_CALL(*txn_, sendBody(_))
+      .WillOnce(Invoke([](std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(body->computeChainDataLength(), 1000);
+      }));
+  EXPECT_CALL(*txn_, sendEOM());
+  evb_.loopOnce();
+  EXPECT_EQ(sink_->getQueuedBytes(), 0);
+}
+
+TEST_F(HTTPCrossThreadSinkTest, Backpressure) {
+  HTTPCrossThreadSink::Options options;
+  options.maxQueuedBytes = 100;
+  init(options);
+  EXPECT_CALL(*txn_, sendBody(_)).Times(2);
+
+  std::thread([this] { sink_->sendBody(makeBuf(150)); }).join();
+  EXPECT_TRUE(sink_->isEgressPaused());
+  // Told to go on once the queue is drained
+  EXPECT_CALL(callback_, onEgressResumed());
+  evb_.loopOnce();
+  EXPECT_FALSE(sink_->isEgressPaused());
+
+  // The transaction's own egress pause
+  EXPECT_CALL(callback_, onEgressPaused());
+  sink_->onEgressPaused();
+  EXPECT_TRUE(sink_->isEgressPaused());
+  std::thread([this] { sink_->sendBody(makeBuf(150)); }).join();
+  // Still paused after the drain
+  evb_.loopOnce();
+  EXPECT_TRUE(sink_->isEgressPaused());
+  EXPECT_CALL(callback_, onEgressResumed());
+  sink_->onEgressResumed();
+  EXPECT_FALSE(sink_->isEgressPaused());
+}
+
+TEST_F(HTTPCrossThreadSinkTest, Detach) {
+  init(HTTPCrossThreadSink::Options());
+  EXPECT_CALL(*txn_, sendHeaders(_)).Times(0);
+  EXPECT_TRUE(sink_->sendHeaders(*makeResponse(200)));
+  sink_->detach();
+  txn_.reset();
+  // Dropped, the sink living on in the queued drain
+  EXPECT_FALSE(sink_->sendBody(makeBuf(10)));
+  sink_.reset();
+  evb_.loopOnce();
+}
@@ -81,6 +81,25 @@ TEST(HTTPDefaultSessionCodecFactoryTest, GetCodec) {
   EXPECT_EQ(codec, nullptr);
 }
 
+TEST(HTTPDefaultSessionCodecFactoryTest, Clone) {
+  AcceptorConfiguration conf;
+  conf.plaintextProtocol = "h2c";
+  HTTPDefaultSessionCodecFactory factory(conf);
+  auto clone = factory.clone();
+  ASSERT_NE(clone, nullptr);
+  auto codec = clone->getCodec(
+      "http/1.1", TransportDirection::DOWNSTREAM, false /* isTLS */);
+  EXPECT_NE(dynamic_cast<HTTP2Codec*>(codec.get()), nullptr);
+
+  // A copy would lose what a subclass overrides
+  class SubFactory : public HTTPDefaultSessionCodecFactory {
+   public:
+    using HTTPDefaultSessionCodecFactory::HTTPDefaultSessionCodecFactory;
+  };
+  SubFactory subFactory(conf);
+  EXPECT_EQ(subFactory.clone(), nullptr);
+}
+
 struct TestParams {
   bool strict;
   std::string plaintextProto;
@@ -13,17 +13,23 @@
 #include <folly/Range.h>
 #include <folly/futures/Promise.h>
 #include <folly/io/Cursor.h>
+#include <folly/io/async/AsyncSSLSocket.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventBaseManager.h>
 #include <folly/io/async/TimeoutManager.h>
 #include <folly/io/async/test/MockAsyncTransport.h>
+#include <folly/portability/Filesystem.h>
 #include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
 #include <proxygen/lib/http/codec/HTTPCodecFactory.h>
 #include <proxygen/lib/http/codec/test/TestUtils.h>
 #include <proxygen/lib/http/observer/HTTPSessionObserverInterface.h>
 #include <proxygen/lib/http/session/HTTPDirectResponseHandler.h>
 #include <proxygen/lib/http/session/HTTPDownstreamSession.h>
 #include <proxygen/lib/http/session/HTTPSession.h>
+#include <proxygen/lib/http/session/IngressCapture.h>
+#include <proxygen/lib/http/session/LoopBudget.h>
+#include <proxygen/lib/http/session/ReadBufferPool.h>
 #include <proxygen/lib/http/session/test/HTTPSessionMocks.h>
 #include <proxygen/lib/http/session/test/HTTPSessionTest.h>
 #include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
@@ -43,8 +49,10 @@ using folly::Promise;
 template <typename C>
 class HTTPDownstreamTest : public testing::Test {
  public:
-  explicit HTTPDownstreamTest(std::vector<int64_t> flowControl = {-1, -1, -1},
-                              bool startImmediately = true)
+  explicit HTTPDownstreamTest(
+      std::vector<int64_t> flowControl = {-1, -1, -1},
+      bool startImmediately = true,
+      const wangle::TransportInfo& tinfo = mockTransportInfo)
       : eventBase_(),
         transport_(new TestAsyncTransport(&eventBase_)),
         transactionTimeouts_(makeTimeoutSet(&eventBase_)),
@@ -79,7 +87,7 @@ class HTTPDownstreamTest : public testing::Test {
         peerAddr,
         &mockController_,
         std::move(codec),
-        mockTransportInfo /* no stats for now */,
+        tinfo /* no stats for now */,
         &infoCb_);
     for (auto& param : flowControl) {
       if (param < 0) {
@@ -1073,6 +1081,111 @@ TEST_F(HTTPDownstreamSessionTest, ClientPipelined) {
   eventBase_.loop();
 }
 
+TEST_F(HTTPDownstreamSessionTest, PipelinedResponsesInOrder) {
+  httpSession_->setMaxPipelinedRequests(3, 0);
+  // The three are dispatched at once, and the first is answered last
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM();
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&handler2] { handler2->sendReplyWithBody(201, 100); });
+  auto handler3 = addSimpleStrictHandler();
+  handler3->expectHeaders();
+  handler3->expectEOM([&handler3] { handler3->sendReplyWithBody(202, 100); });
+  sendRequest();
+  sendRequest();
+  sendRequest();
+  flushRequestsAndLoop();
+  EXPECT_TRUE(handler2->txn_->isEgressHeld());
+  EXPECT_TRUE(handler3->txn_->isEgressHeld());
+  EXPECT_TRUE(transport_->getWriteEvents()->empty());
+
+  handler1->expectDetachTransaction();
+  handler2->expectDetachTransaction();
+  handler3->expectDetachTransaction();
+  handler1->sendReplyWithBody(200, 100);
+  eventBase_.loop();
+
+  std::vector<uint16_t> codes;
+  EXPECT_CALL(callbacks_, onHeadersComplete(_, _))
+      .Times(3)
+      .WillRepeatedly(Invoke(
+          [&codes](HTTPCodec::StreamID, std::shared_ptr<HTTPMessage> msg) {
+            codes.push_back(msg->getStatusCode());
+          }));
+  parseOutput(*clientCodec_);
+  EXPECT_EQ(codes, (std::vector<uint16_t>{200, 201, 202}));
+  gracefulShutdown();
+}
+
+TEST_F(HTTPDownstreamSessionTest, PipelinedBodilessResponsesInOrder) {
+  httpSession_->setMaxPipelinedRequests(3, 0);
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM();
+  // Headers with EOM
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&handler2] { handler2->sendReplyCode(204); });
+  // Headers, then EOM without body
+  auto handler3 = addSimpleStrictHandler();
+  handler3->expectHeaders();
+  handler3->expectEOM([&handler3] {
+    handler3->sendHeaders(200, 0);
+    handler3->txn_->sendEOM();
+  });
+  sendRequest();
+  sendRequest();
+  sendRequest();
+  flushRequestsAndLoop();
+  EXPECT_TRUE(handler2->txn_->isEgressHeld());
+  EXPECT_TRUE(handler3->txn_->isEgressHeld());
+
+  handler1->expectDetachTransaction();
+  handler2->expectDetachTransaction();
+  handler3->expectDetachTransaction();
+  handler1->sendReplyWithBody(200, 100);
+  eventBase_.loop();
+
+  std::vector<uint16_t> codes;
+  EXPECT_CALL(callbacks_, onHeadersComplete(_, _))
+      .Times(3)
+      .WillRepeatedly(Invoke(
+          [&codes](HTTPCodec::StreamID, std::shared_ptr<HTTPMessage> msg) {
+            codes.push_back(msg->getStatusCode());
+          }));
+  EXPECT_CALL(callbacks_, onMessageComplete(_, _)).Times(3);
+  parseOutput(*clientCodec_);
+  EXPECT_EQ(codes, (std::vector<uint16_t>{200, 204, 200}));
+  gracefulShutdown();
+}
+
+TEST_F(HTTPDownstreamSessionTest, PipelinedReadsPauseBeyondLimit) {
+  httpSession_->setMaxPipelinedRequests(2, 0);
+  auto handler1 = addSimpleStrictHandler();
+  handler1->expectHeaders();
+  handler1->expectEOM();
+  auto handler2 = addSimpleStrictHandler();
+  handler2->expectHeaders();
+  handler2->expectEOM([&handler2] { handler2->sendReplyWithBody(200, 100); });
+  auto handler3 = addSimpleStrictHandler();
+  sendRequest();
+  sendRequest();
+  sendRequest();
+  flushRequestsAndLoop();
+  // The third waits for the first to be answered
+  handler1->expectDetachTransaction();
+  handler3->expectHeaders();
+  handler3->expectEOM([&handler3] { handler3->sendReplyWithBody(200, 100); });
+  handler2->expectDetachTransaction();
+  handler3->expectDetachTransaction();
+  handler1->sendReplyWithBody(200, 100);
+  eventBase_.loop();
+  expectResponses(3);
+  gracefulShutdown();
+}
+
 TEST_F(HTTPDownstreamSessionTest, BadContentLength) {
   InSequence enforceOrder;
 
@@ -1374,6 +1487,24 @@ TEST_F(HTTPDownstreamSessionTest, HttpWithAckTimingPipeline) {
   gracefulShutdown();
 }
 
+TEST_F(HTTPDownstreamSessionTest, CannedResponse) {
+  auto canned = std::make_shared<const CannedResponse>(
+      404, "", folly::IOBuf::copyBuffer("missing"));
+  EXPECT_EQ(canned->getMessage().getStatusMessage(), "Not Found");
+  EXPECT_EQ(canned->getMessage().getHeaders().getSingleOrEmpty(
+                HTTP_HEADER_CONTENT_LENGTH),
+            "7");
+  EXPECT_CALL(mockController_, getRequestHandler(_, _))
+      .WillOnce(Return(new HTTPDirectResponseHandler(canned)))
+      .WillOnce(Return(new HTTPDirectResponseHandler(canned)));
+
+  sendRequest();
+  sendRequest();
+  flushRequestsAndLoop();
+  expectResponses(2, 404);
+  gracefulShutdown();
+}
+
 TEST_F(HTTPDownstreamSessionTest, HttpWithAckTimingPipelineError) {
   HTTPDirectResponseHandler* errorHandler =
       new HTTPDirectResponseHandler(400, "Bad Request");
@@ -1988,6 +2119,316 @@ TEST_F(HTTP2DownstreamSessionTest, Trailers) {
   expectDetachSession();
 }
 
+TEST_F(HTTP2DownstreamSessionTest, EgressCoalescing) {
+  InSequence enforceOrder;
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&handler] {
+    handler->txn_->setEgressCoalescing(milliseconds(500), 50);
+  });
+  handler->expectEOM([&handler, this]() {
+    handler->sendHeaders(200, 40);
+    // small writes on separate loops, all under the byte threshold
+    for (auto i = 0; i < 4; i++) {
+      eventBase_.runAfterDelay([&handler] { handler->sendBody(10); }, i * 5);
+    }
+    eventBase_.runAfterDelay([&handler] { handler->txn_->sendEOM(); }, 30);
+  });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _)).Times(1);
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _)).Times(1);
+  EXPECT_CALL(callbacks_, onBody(1, _, _)).Times(1);
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+
+  parseOutput(*clientCodec_);
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, EgressCoalescingDelay) {
+  InSequence enforceOrder;
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&handler] {
+    handler->txn_->setEgressCoalescing(milliseconds(10), 1000);
+  });
+  handler->expectEOM([&handler, this]() {
+    handler->sendHeaders(200, 20);
+    handler->sendBody(10);
+    // the held body is flushed when the delay expires, before this runs
+    eventBase_.runAfterDelay(
+        [&handler] {
+          handler->sendBody(10);
+          handler->txn_->sendEOM();
+        },
+        200);
+  });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _)).Times(1);
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _)).Times(1);
+  EXPECT_CALL(callbacks_, onBody(1, _, _)).Times(2);
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+
+  parseOutput(*clientCodec_);
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, ZeroCopyEgress) {
+  httpSession_->setZeroCopyEgressThreshold(16000);
+  transport_->setHoldZeroCopyBuffers(true);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM(
+      [&handler] { handler->sendReplyWithBody(200, 32000); });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  EXPECT_EQ(transport_->getZeroCopyCount(), 1);
+  // the transport still holds the body, so it's still pending
+  EXPECT_GE(httpSession_->getZeroCopyBytesInFlight(), 32000);
+  transport_->releaseZeroCopyBuffers();
+  EXPECT_EQ(httpSession_->getZeroCopyBytesInFlight(), 0);
+
+  EXPECT_CALL(callbacks_, onMessageBegin(1, _));
+  EXPECT_CALL(callbacks_, onHeadersComplete(1, _));
+  EXPECT_CALL(callbacks_, onBody(1, _, _)).Times(AtLeast(1));
+  EXPECT_CALL(callbacks_, onMessageComplete(1, _));
+  parseOutput(*clientCodec_);
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, ZeroCopyEgressBelowThreshold) {
+  httpSession_->setZeroCopyEgressThreshold(16000);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  EXPECT_EQ(transport_->getZeroCopyCount(), 0);
+  EXPECT_EQ(httpSession_->getZeroCopyBytesInFlight(), 0);
+  expectDetachSession();
+}
+
+namespace {
+wangle::TransportInfo makeSecureTransportInfo() {
+  wangle::TransportInfo tinfo;
+  tinfo.secure = true;
+  return tinfo;
+}
+
+class HTTPDownstreamSessionTLSTest
+    : public HTTPDownstreamTest<HTTP1xCodecPair> {
+ public:
+  HTTPDownstreamSessionTLSTest()
+      : HTTPDownstreamTest<HTTP1xCodecPair>(
+            {-1, -1, -1}, true, makeSecureTransportInfo()) {
+    // The records are sized on an OpenSSL socket under transport_
+    transport_->setWrappedTransport(sslSock_.get());
+    initialMinWriteSize_ = sslSock_->getMinWriteSize();
+    httpSession_->setDynamicTLSRecordSize(true);
+  }
+
+  // The buffers of the writes from first on fit records of recordSize, and
+  // each write but the last is a whole number of records
+  void expectRecords(size_t first, size_t recordSize) {
+    auto writes = transport_->getWriteEvents();
+    for (size_t i = first; i < writes->size(); i++) {
+      const auto& event = *(*writes)[i];
+      size_t len = 0;
+      for (size_t j = 0; j < event.getCount(); j++) {
+        EXPECT_LE(event.getIoVec()[j].iov_len, recordSize);
+        len += event.getIoVec()[j].iov_len;
+      }
+      if (i + 1 < writes->size()) {
+        EXPECT_EQ(len % recordSize, 0);
+      }
+    }
+  }
+
+  static size_t maxBufferLength(const TestAsyncTransport::WriteEvent& event) {
+    size_t maxLen = 0;
+    for (size_t i = 0; i < event.getCount(); i++) {
+      maxLen = std::max(maxLen, event.getIoVec()[i].iov_len);
+    }
+    return maxLen;
+  }
+
+  void sendReply(size_t bodyLen, bool eof) {
+    auto handler = addSimpleStrictHandler();
+    handler->expectHeaders();
+    handler->expectEOM(
+        [&handler, bodyLen] { handler->sendReplyWithBody(200, bodyLen); });
+    handler->expectDetachTransaction();
+    sendRequest();
+    flushRequestsAndLoop(eof);
+  }
+
+ protected:
+  folly::AsyncSSLSocket::UniquePtr sslSock_{new folly::AsyncSSLSocket(
+      std::make_shared<folly::SSLContext>(), &eventBase_)};
+  size_t initialMinWriteSize_{0};
+};
+} // namespace
+
+TEST_F(HTTPDownstreamSessionTLSTest, DynamicTLSRecordSize) {
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendReply(100000, true);
+
+  // Corked writes were cut on record boundaries, and every record is a
+  // buffer of its own
+  EXPECT_GT(transport_->getWriteEvents()->size(), 1);
+  expectRecords(0, 1300);
+  EXPECT_EQ(sslSock_->getMinWriteSize(),
+            std::min<size_t>(initialMinWriteSize_, 1300));
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTLSTest, DynamicTLSRecordSizeWarmup) {
+  HTTPSession::DestructorGuard g(httpSession_);
+  auto writes = transport_->getWriteEvents();
+
+  // Full records once 1MB was written
+  sendReply(1100000, false);
+  EXPECT_EQ(sslSock_->getMinWriteSize(), initialMinWriteSize_);
+  EXPECT_GT(maxBufferLength(*writes->back()), 1300);
+
+  // Small again after a second idle
+  eventBase_.runAfterDelay([] {}, 1100);
+  eventBase_.loop();
+  auto first = writes->size();
+  sendReply(5000, true);
+  EXPECT_GT(writes->size(), first);
+  expectRecords(first, 1300);
+  EXPECT_EQ(sslSock_->getMinWriteSize(),
+            std::min<size_t>(initialMinWriteSize_, 1300));
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, WriteInCurrentLoop) {
+  for (bool enabled : {false, true}) {
+    httpSession_->setWriteInCurrentLoop(enabled);
+    auto handler = addSimpleStrictHandler();
+    handler->expectHeaders();
+    // Reply from a loop callback, checking the transport from the next
+    // iteration
+    size_t writtenBeforeNextLoop = 0;
+    handler->expectEOM([&] {
+      eventBase_.runInLoop([&] {
+        auto writes = transport_->getWriteEvents()->size();
+        eventBase_.runInLoop([&, writes] {
+          writtenBeforeNextLoop = transport_->getWriteEvents()->size() - writes;
+        });
+        handler->sendReplyWithBody(200, 100);
+      });
+    });
+    handler->expectDetachTransaction();
+    sendRequest();
+    flushRequestsAndLoop();
+    if (enabled) {
+      EXPECT_GT(writtenBeforeNextLoop, 0);
+    } else {
+      EXPECT_EQ(writtenBeforeNextLoop, 0);
+    }
+  }
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, TxnWriteInCurrentLoop) {
+  for (bool enabled : {false, true}) {
+    auto handler = addSimpleStrictHandler();
+    handler->expectHeaders();
+    size_t writtenBeforeNextLoop = 0;
+    handler->expectEOM([&] {
+      eventBase_.runInLoop([&] {
+        auto writes = transport_->getWriteEvents()->size();
+        eventBase_.runInLoop([&, writes] {
+          writtenBeforeNextLoop = transport_->getWriteEvents()->size() - writes;
+        });
+        handler->txn_->setWriteInCurrentLoop(enabled);
+        handler->sendReplyWithBody(200, 100);
+      });
+    });
+    handler->expectDetachTransaction();
+    sendRequest();
+    flushRequestsAndLoop();
+    if (enabled) {
+      EXPECT_GT(writtenBeforeNextLoop, 0);
+    } else {
+      EXPECT_EQ(writtenBeforeNextLoop, 0);
+    }
+  }
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, MaxEgressBytesPerLoop) {
+  for (uint64_t maxBytes : {0, 1000}) {
+    httpSession_->setMaxEgressBytesPerLoop(maxBytes);
+    auto handler = addSimpleStrictHandler();
+    handler->expectHeaders();
+    // Counts the writes of the session's loop callback, which runs first
+    size_t writesInLoop = 0;
+    handler->expectEOM([&] {
+      auto writes = transport_->getWriteEvents()->size();
+      handler->sendReplyWithBody(200, 200000);
+      eventBase_.runInLoop([&, writes] {
+        writesInLoop = transport_->getWriteEvents()->size() - writes;
+      });
+    });
+    handler->expectDetachTransaction();
+    sendRequest();
+    flushRequestsAndLoop();
+    if (maxBytes > 0) {
+      EXPECT_EQ(writesInLoop, 1);
+    } else {
+      EXPECT_GT(writesInLoop, 1);
+    }
+  }
+  expectDetachSession();
+}
+
+TEST_F(HTTPDownstreamSessionTest, LoopBudgetReadSlice) {
+  LoopBudget::get().setOptions({1000, 0});
+  auto yields = LoopBudget::get().getStats().readYields;
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  uint64_t bodyLen = 0;
+  EXPECT_CALL(*handler, _onBodyWithOffset(_, _))
+      .WillRepeatedly(
+          Invoke([&](uint64_t, std::shared_ptr<folly::IOBuf> body) {
+            bodyLen += body->computeChainDataLength();
+          }));
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+
+  // Parsed 1000 bytes per loop callback
+  auto streamID = sendRequest(getPostRequest(5000), false);
+  clientCodec_->generateBody(
+      requests_, streamID, makeBuf(5000), HTTPCodec::NoPadding, true);
+  flushRequestsAndLoop();
+  EXPECT_EQ(bodyLen, 5000);
+  EXPECT_GT(LoopBudget::get().getStats().readYields, yields);
+  LoopBudget::get().setOptions({});
+  expectDetachSession();
+}
+
 TEST_F(HTTPDownstreamSessionTest, Trailers) {
   testChunks(true);
 }
@@ -2856,6 +3297,189 @@ TEST_F(HTTP2DownstreamSessionTest, H2TimeoutWin) {
   cleanup();
 }
 
+// With lazy idle timeouts, a request trickling in for longer than the
+// transaction timeout is not timed out, one that stops still is
+TEST_F(HTTP2DownstreamSessionTest, LazyIdleTimeout) {
+  httpSession_->setLazyIdleTimeoutsEnabled(true);
+  auto streamID = sendHeader();
+  transport_->addReadEvent(requests_, milliseconds(0));
+  const int kChunks = 8;
+  for (int i = 0; i < kChunks; i++) {
+    clientCodec_->generateBody(
+        requests_, streamID, makeBuf(10), HTTPCodec::NoPadding, false);
+    transport_->addReadEvent(requests_, milliseconds(100));
+  }
+
+  InSequence handlerSequence;
+  auto start = getCurrentTime();
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  EXPECT_CALL(*handler, _onBodyWithOffset(_, _)).Times(kChunks);
+  handler->expectError([&](const HTTPException& ex) {
+    ASSERT_EQ(ex.getProxygenError(), kErrorTimeout);
+    // Every chunk was received, well past the first deadline
+    EXPECT_GE(millisecondsSince(start), milliseconds(100 * kChunks));
+    handler->terminate();
+  });
+  handler->expectDetachTransaction();
+
+  transport_->startReadEvents();
+  eventBase_.loop();
+
+  cleanup();
+}
+
+TEST_F(HTTPDownstreamSessionTest, IdleHoldsNoPooledReadBuffer) {
+  HTTPSessionBase::setUseReadBufferPool(true);
+  auto& pool = ReadBufferPool::get();
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  sendRequest();
+  flushRequestsAndLoop();
+  auto freeCount = pool.getFreeCount();
+  EXPECT_GT(freeCount, 0);
+
+  // A read bringing nothing, as the one after a read filling the buffer
+  auto readCallback = transport_->getReadCallback();
+  ASSERT_NE(readCallback, nullptr);
+  void* buf;
+  size_t bufSize;
+  readCallback->getReadBuffer(&buf, &bufSize);
+  EXPECT_EQ(pool.getFreeCount(), freeCount - 1);
+  eventBase_.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(pool.getFreeCount(), freeCount);
+
+  HTTPSessionBase::setUseReadBufferPool(false);
+  cleanup();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, HibernateWhenIdle) {
+  httpSession_->setHibernateWhenIdle(true);
+  EXPECT_FALSE(httpSession_->isHibernating());
+
+  for (int i = 0; i < 2; i++) {
+    auto handler = addSimpleStrictHandler();
+    handler->expectHeaders();
+    handler->expectEOM([&handler] { handler->sendReplyWithBody(200, 100); });
+    handler->expectDetachTransaction();
+    auto streamID = sendRequest();
+    flushRequestsAndLoop();
+    EXPECT_TRUE(httpSession_->isHibernating());
+
+    // The client's decoder follows the released header table
+    EXPECT_CALL(callbacks_, onHeadersComplete(streamID, _));
+    EXPECT_CALL(callbacks_, onMessageComplete(streamID, _));
+    EXPECT_CALL(callbacks_, onError(_, _, _)).Times(0);
+    parseOutput(*clientCodec_);
+    Mock::VerifyAndClearExpectations(&callbacks_);
+  }
+
+  // Busy sessions stay awake
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  sendRequest("/", 0, false);
+  flushRequestsAndLoopN(1);
+  EXPECT_FALSE(httpSession_->isHibernating());
+  EXPECT_FALSE(httpSession_->hibernate());
+  handler->expectError();
+  handler->expectDetachTransaction();
+  cleanup();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, ReceiveWindowAutotuning) {
+  httpSession_->setReceiveWindowAutotuning(1024 * 1024);
+  auto streamID = sendHeader();
+  // Most of the session window in a single round trip
+  clientCodec_->generateBody(
+      requests_, streamID, makeBuf(60000), HTTPCodec::NoPadding, false);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  EXPECT_CALL(*handler, _onBodyWithOffset(_, _)).Times(AtLeast(1));
+  flushRequestsAndLoopN(1);
+
+  uint64_t pingVal = 0;
+  EXPECT_CALL(callbacks_, onPingRequest(_)).WillOnce(SaveArg<0>(&pingVal));
+  parseOutput(*clientCodec_);
+  auto reserved = ReceiveWindowBudget::get().getReserved();
+
+  // The ack grows both windows to twice the sample
+  clientCodec_->generatePingReply(requests_, pingVal);
+  flushRequestsAndLoopN(1);
+  uint32_t sessionDelta = 0;
+  uint32_t streamDelta = 0;
+  EXPECT_CALL(callbacks_, onWindowUpdate(0, _))
+      .WillRepeatedly(Invoke(
+          [&](HTTPCodec::StreamID, uint32_t delta) { sessionDelta += delta; }));
+  EXPECT_CALL(callbacks_, onWindowUpdate(streamID, _))
+      .WillRepeatedly(Invoke(
+          [&](HTTPCodec::StreamID, uint32_t delta) { streamDelta += delta; }));
+  parseOutput(*clientCodec_);
+  EXPECT_GE(sessionDelta, 2 * 60000 - http2::kInitialWindow);
+  EXPECT_GE(streamDelta, 2 * 60000 - http2::kInitialWindow);
+  EXPECT_EQ(ReceiveWindowBudget::get().getReserved(),
+            reserved + 2 * 60000 - http2::kInitialWindow);
+
+  handler->expectEOM([&] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  clientCodec_->generateEOM(requests_, streamID);
+  flushRequestsAndLoop();
+  cleanup();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, WindowUpdateBatching) {
+  httpSession_->setWindowUpdateBatching(true);
+  auto streamID = sendHeader();
+  // Crosses half the stream window twice in a single read
+  clientCodec_->generateBody(requests_,
+                             streamID,
+                             makeBuf(http2::kInitialWindow),
+                             HTTPCodec::NoPadding,
+                             false);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  EXPECT_CALL(*handler, _onBodyWithOffset(_, _)).Times(AtLeast(1));
+  flushRequestsAndLoopN(1);
+
+  // One update each, for everything processed
+  EXPECT_CALL(callbacks_, onWindowUpdate(0, http2::kInitialWindow));
+  EXPECT_CALL(callbacks_, onWindowUpdate(streamID, http2::kInitialWindow));
+  parseOutput(*clientCodec_);
+
+  handler->expectEOM([&] { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  clientCodec_->generateEOM(requests_, streamID);
+  flushRequestsAndLoop();
+  cleanup();
+}
+
+// Dropping idle connections still closes the session right away with lazy
+// idle timeouts, rather than waiting for the deadline the reads pushed back
+TEST_F(HTTP2DownstreamSessionTest, LazyIdleTimeoutDropIdleConnections) {
+  httpSession_->setLazyIdleTimeoutsEnabled(true);
+  auto cm = wangle::ConnectionManager::makeUnique(&eventBase_,
+                                                  std::chrono::seconds(10));
+  cm->addConnection(httpSession_, true);
+  HTTPSession::DestructorGuard g(httpSession_);
+  transport_->addReadEvent(requests_, milliseconds(0));
+  transport_->startReadEvents();
+
+  eventBase_.runAfterDelay(
+      [&] {
+        EXPECT_EQ(cm->dropIdleConnections(1), 1);
+        EXPECT_EQ(httpSession_->getConnectionCloseReason(),
+                  ConnectionCloseReason::TIMEOUT);
+      },
+      50);
+  expectDetachSession();
+  auto start = getCurrentTime();
+  eventBase_.loop();
+  EXPECT_LT(millisecondsSince(start), milliseconds(1000));
+}
+
 TYPED_TEST_SUITE_P(HTTPDownstreamTest);
 
 TYPED_TEST_P(HTTPDownstreamTest, TestMaxTxnOverriding) {
@@ -3053,6 +3677,28 @@ TEST_F(HTTP2DownstreamSessionFCTest, TestSessionFlowControl) {
   cleanup();
 }
 
+TEST_F(HTTP2DownstreamSessionTest, ChangeMaxConcurrentStreams) {
+  eventBase_.loopOnce();
+  httpSession_->changeMaxConcurrentIncomingStreams(2);
+  eventBase_.loopOnce();
+
+  std::vector<uint32_t> maxStreams;
+  EXPECT_CALL(callbacks_, onSettings(_))
+      .WillRepeatedly(Invoke([&](const SettingsList& settings) {
+        for (const auto& setting : settings) {
+          if (setting.id == SettingsId::MAX_CONCURRENT_STREAMS) {
+            maxStreams.push_back(setting.value);
+          }
+        }
+      }));
+  EXPECT_CALL(callbacks_, onWindowUpdate(_, _)).Times(AnyNumber());
+  parseOutput(*clientCodec_);
+  ASSERT_EQ(maxStreams.size(), 2);
+  EXPECT_EQ(maxStreams.back(), 2);
+
+  cleanup();
+}
+
 TEST_F(HTTP2DownstreamSessionTest, TestEOFOnBlockedStream) {
   sendRequest();
 
@@ -3211,7 +3857,11 @@ TEST_F(HTTP2DownstreamSessionTest, PaddingFlowControl) {
     handler->txn_->pauseIngress();
     eventBase_.runAfterDelay([&] { handler->txn_->resumeIngress(); }, 100);
   });
-  EXPECT_CALL(*handler, _onBodyWithOffset(_, _)).Times(129);
+  // The body queued while paused is delivered in one call
+  EXPECT_CALL(*handler, _onBodyWithOffset(0, _))
+      .WillOnce(Invoke([](uint64_t, std::shared_ptr<folly::IOBuf> body) {
+        EXPECT_EQ(body->computeChainDataLength(), 129);
+      }));
   handler->expectError();
   handler->expectDetachTransaction();
 
@@ -4043,6 +4693,54 @@ TEST_F(HTTPDownstreamSessionTest, HttpShortContentLength) {
   flushRequestsAndLoop();
 }
 
+TEST_F(HTTP2DownstreamSessionTest, TransactionLatencyStats) {
+  NiceMock<MockHTTPSessionStats> stats;
+  httpSession_->setSessionStats(&stats);
+
+  std::chrono::microseconds ttfb{0};
+  std::chrono::microseconds ttlb{0};
+  EXPECT_CALL(stats, _recordIngressHeaderParseTime(_)).Times(1);
+  EXPECT_CALL(stats, _recordTransactionTimeToFirstByte(_))
+      .WillOnce(SaveArg<0>(&ttfb));
+  EXPECT_CALL(stats, _recordTransactionTimeToLastByte(_))
+      .WillOnce(SaveArg<0>(&ttlb));
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler]() { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+
+  flushRequestsAndLoop(true, milliseconds(0));
+  EXPECT_LE(ttfb, ttlb);
+
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, TransactionLatencyStatsUnsampled) {
+  NiceMock<MockHTTPSessionStats> stats;
+  httpSession_->setSessionStats(&stats);
+  httpSession_->setRequestSampling(0.0);
+  // Unsampled transactions pay for no timings, even with stats
+  EXPECT_CALL(stats, _recordIngressHeaderParseTime(_)).Times(0);
+  EXPECT_CALL(stats, _recordTransactionTimeToFirstByte(_)).Times(0);
+  EXPECT_CALL(stats, _recordTransactionTimeToLastByte(_)).Times(0);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&handler] {
+    EXPECT_FALSE(handler->txn_->isSampled());
+    EXPECT_EQ(handler->txn_->getTimings(), nullptr);
+  });
+  handler->expectEOM([&handler]() { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+
+  flushRequestsAndLoop(true, milliseconds(0));
+  expectDetachSession();
+}
+
 TEST_F(HTTP2DownstreamSessionTest, TestSessionStallByFlowControl) {
   NiceMock<MockHTTPSessionStats> stats;
   // By default the send and receive windows are 64K each.
@@ -4478,3 +5176,192 @@ TEST_F(HTTP2DownstreamSessionTest, Observer_RequestStarted) {
 
   expectDetachSession();
 }
+
+TEST_F(HTTP2DownstreamSessionTest, RequestSamplingUnsampled) {
+  auto observer = addMockSessionObserver(
+      MockSessionObserver::EventSetBuilder()
+          .enable(HTTPSessionObserverInterface::Events::transactionTimings)
+          .build());
+  httpSession_->addObserver(observer.get());
+  httpSession_->setTransactionTimingsEnabled(true);
+  httpSession_->setRequestSampling(0.0);
+  EXPECT_CALL(*observer, transactionTimings(_, _)).Times(0);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&handler] {
+    EXPECT_FALSE(handler->txn_->isSampled());
+    EXPECT_EQ(handler->txn_->getSamplingWeight(), 0);
+  });
+  handler->expectEOM([&handler]() { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, RequestSamplingTransportCallback) {
+  httpSession_->setRequestSampling(0.0);
+  // Unsampled, but the callback still gets its first byte events
+  NiceMock<MockHTTPTransactionTransportCallback> transportCallback;
+  EXPECT_CALL(transportCallback, firstHeaderByteFlushed());
+  EXPECT_CALL(transportCallback, firstByteFlushed());
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&handler, &transportCallback] {
+    EXPECT_FALSE(handler->txn_->isSampled());
+    handler->txn_->setTransportCallback(&transportCallback);
+  });
+  handler->expectEOM([&handler]() { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, RequestSamplingKeyed) {
+  httpSession_->setRequestSampling(0.5, "x-trace-id");
+  // As every hop decides for the key
+  bool expected = Sampling(0.5).isLucky(std::string("abc123"));
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&handler, expected] {
+    EXPECT_EQ(handler->txn_->isSampled(), expected);
+    EXPECT_EQ(handler->txn_->getSamplingWeight(), expected ? 2 : 0);
+  });
+  handler->expectEOM([&handler]() { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  HTTPSession::DestructorGuard g(httpSession_);
+  HTTPMessage req = getGetRequest();
+  req.getHeaders().add("x-trace-id", "abc123");
+  sendRequest(req);
+  flushRequestsAndLoop(true, milliseconds(0));
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, EventBatch) {
+  class BatchObserver : public HTTPSessionEventBatch::Observer {
+   public:
+    void onEventBatch(
+        folly::Range<const HTTPSessionEventBatch::Record*> records,
+        bool) noexcept override {
+      for (const auto& record : records) {
+        types.push_back(record.type);
+        if (record.type ==
+            HTTPSessionObserverInterface::Events::requestStarted) {
+          EXPECT_GT(record.headerCount, 0);
+        }
+      }
+    }
+    std::vector<HTTPSessionObserverInterface::Events> types;
+  } observer;
+  httpSession_->addEventBatchObserver(
+      &observer,
+      HTTPSessionEventBatch::eventBit(
+          HTTPSessionObserverInterface::Events::requestStarted) |
+          HTTPSessionEventBatch::eventBit(
+              HTTPSessionObserverInterface::Events::transactionTimings));
+  httpSession_->setTransactionTimingsEnabled(true);
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler]() { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+  flushRequestsAndLoop(true, milliseconds(0));
+  eventBase_.loopOnce(EVLOOP_NONBLOCK);
+
+  EXPECT_EQ(observer.types,
+            (std::vector<HTTPSessionObserverInterface::Events>{
+                HTTPSessionObserverInterface::Events::requestStarted,
+                HTTPSessionObserverInterface::Events::transactionTimings}));
+  httpSession_->removeEventBatchObserver(&observer);
+  expectDetachSession();
+}
+
+TEST_F(HTTP2DownstreamSessionTest, TransactionTimings) {
+  auto observer = addMockSessionObserver(
+      MockSessionObserver::EventSetBuilder()
+          .enable(HTTPSessionObserverInterface::Events::transactionTimings)
+          .build());
+  httpSession_->addObserver(observer.get());
+  httpSession_->setTransactionTimingsEnabled(true);
+
+  EXPECT_CALL(*observer, transactionTimings(_, _))
+      .WillOnce(Invoke(
+          [](HTTPSessionObserverAccessor*,
+             const HTTPSessionObserverInterface::TransactionTimingsEvent&
+                 event) {
+            const auto& timings = event.timings;
+            EXPECT_TRUE(timePointInitialized(timings.firstHeaderByteRead));
+            EXPECT_LE(timings.firstHeaderByteRead, timings.headersParsed);
+            EXPECT_LE(timings.headersParsed, timings.headersHandled);
+            EXPECT_LE(timings.headersHandled, timings.firstEgressByte);
+            EXPECT_LE(timings.firstEgressByte, timings.lastByteWritten);
+            // No ACKs from the test transport
+            EXPECT_FALSE(timePointInitialized(timings.lastByteAcked));
+            EXPECT_EQ(HTTPTransactionTimings::between(timings.lastByteWritten,
+                                                      timings.lastByteAcked),
+                      std::chrono::microseconds::zero());
+          }));
+
+  auto handler = addSimpleStrictHandler();
+  handler->expectHeaders([&handler] {
+    EXPECT_NE(handler->txn_->getTimings(), nullptr);
+  });
+  handler->expectEOM([&handler]() { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  HTTPSession::DestructorGuard g(httpSession_);
+  sendRequest();
+
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  expectDetachSession();
+}
+
+class HTTPDownstreamSessionCaptureTest : public HTTPDownstreamSessionTest {
+ public:
+  HTTPDownstreamSessionCaptureTest()
+      : HTTPDownstreamSessionTest({-1, -1, -1}, false) {
+  }
+};
+
+TEST_F(HTTPDownstreamSessionCaptureTest, RecordsIngress) {
+  folly::test::TemporaryDirectory dir;
+  IngressCapture::Options options;
+  options.directory = dir.path().string();
+  options.sampleOneIn = 1;
+  IngressCapture::get().configure(options);
+  httpSession_->startNow();
+  IngressCapture::get().configure(IngressCapture::Options());
+
+  auto handler = addSimpleNiceHandler();
+  handler->expectHeaders();
+  handler->expectEOM([&handler]() { handler->sendReplyWithBody(200, 100); });
+  handler->expectDetachTransaction();
+  expectDetachSession();
+  sendRequest("/captured");
+  flushRequestsAndLoop(true, milliseconds(0));
+
+  std::vector<std::string> captures;
+  for (const auto& entry : folly::fs::directory_iterator(dir.path())) {
+    captures.push_back(entry.path().string());
+  }
+  ASSERT_EQ(captures.size(), 1);
+  auto recording = IngressRecording::read(captures[0]);
+  ASSERT_TRUE(recording.hasValue()) << recording.error();
+  EXPECT_EQ(recording->protocol, "http/1.1");
+  ASSERT_GE(recording->records.size(), 2);
+  std::string ingress;
+  for (const auto& record : recording->records) {
+    EXPECT_EQ(record.streamId, 0);
+    if (record.data) {
+      ingress += record.data->moveToFbString().toStdString();
+    }
+  }
+  EXPECT_EQ(ingress.find("GET /captured HTTP/1.1\r\n"), 0);
+  EXPECT_EQ(recording->records.back().type,
+            IngressRecordType::END_OF_STREAM);
+}
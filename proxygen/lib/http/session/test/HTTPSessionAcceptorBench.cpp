@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <new>
+#include <proxygen/lib/http/codec/HTTP2Constants.h>
+#include <proxygen/lib/http/session/HTTPSessionAcceptor.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+#include <proxygen/lib/utils/PooledObject.h>
+
+/**
+ * Accepts batches of connections on an HTTPSessionAcceptor and drops them,
+ * one iteration per connection, so the rate is in connections per second.
+ * It reports allocs, the operator new calls per connection, with and
+ * without the PooledObject free lists that recycle the sessions and codecs.
+ */
+
+DEFINE_int32(connections, 64, "Connections open at once in a batch");
+DEFINE_int32(pool_size, 64, "PooledObject free blocks for the Pooled runs");
+
+namespace {
+std::atomic<uint64_t> numAllocs{0};
+} // namespace
+
+void* operator new(size_t size) {
+  numAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+using namespace proxygen;
+
+namespace {
+
+class BenchAcceptor : public HTTPSessionAcceptor {
+ public:
+  explicit BenchAcceptor(const AcceptorConfiguration& accConfig)
+      : HTTPSessionAcceptor(accConfig) {
+  }
+
+  HTTPTransaction::Handler* newHandler(HTTPTransaction& /*txn*/,
+                                       HTTPMessage* /*msg*/) noexcept override {
+    return nullptr;
+  }
+
+  void accept(folly::EventBase& evb, const std::string& nextProtocol) {
+    static const folly::SocketAddress peer("127.0.0.1", 12345);
+    wangle::TransportInfo tinfo;
+    onNewConnection(
+        folly::AsyncTransport::UniquePtr(new TestAsyncTransport(&evb)),
+        &peer,
+        nextProtocol,
+        wangle::SecureTransportType::NONE,
+        tinfo);
+  }
+};
+
+void runConnections(folly::UserCounters& counters,
+                    size_t iters,
+                    const std::string& nextProtocol,
+                    bool pooled) {
+  folly::EventBase evb;
+  AcceptorConfiguration config;
+  config.bindAddress = folly::SocketAddress("127.0.0.1", 0);
+  std::unique_ptr<BenchAcceptor> acceptor;
+  BENCHMARK_SUSPEND {
+    setPooledObjectCacheSize(pooled ? FLAGS_pool_size : 0);
+    acceptor = std::make_unique<BenchAcceptor>(config);
+    acceptor->init(nullptr, &evb);
+    // Warms the free lists and the factory clone
+    acceptor->accept(evb, nextProtocol);
+    acceptor->dropAllConnections();
+    evb.loop();
+  }
+
+  auto allocsBefore = numAllocs.load(std::memory_order_relaxed);
+  for (size_t done = 0; done < iters;) {
+    auto batch = std::min<size_t>(FLAGS_connections, iters - done);
+    for (size_t i = 0; i < batch; i++) {
+      acceptor->accept(evb, nextProtocol);
+    }
+    evb.loopOnce(EVLOOP_NONBLOCK);
+    acceptor->dropAllConnections();
+    evb.loop();
+    done += batch;
+  }
+
+  BENCHMARK_SUSPEND {
+    counters["allocs"] =
+        (numAllocs.load(std::memory_order_relaxed) - allocsBefore) / iters;
+    acceptor.reset();
+    evb.loop();
+    setPooledObjectCacheSize(0);
+  }
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(HTTP1xConnections, counters, iters) {
+  runConnections(counters, iters, "http/1.1", false);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(HTTP1xConnectionsPooled, counters, iters) {
+  runConnections(counters, iters, "http/1.1", true);
+}
+
+BENCHMARK_COUNTERS(HTTP2Connections, counters, iters) {
+  runConnections(counters, iters, http2::kProtocolString, false);
+}
+
+BENCHMARK_COUNTERS_RELATIVE(HTTP2ConnectionsPooled, counters, iters) {
+  runConnections(counters, iters, http2::kProtocolString, true);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -63,6 +63,11 @@ class HTTPTargetSessionAcceptor : public HTTPSessionAcceptor {
     sessionCreationErrors_++;
   }
 
+  void prepareTransport(folly::AsyncTransport& sock) override {
+    preparedTransports_.push_back(&sock);
+  }
+
+  std::vector<folly::AsyncTransport*> preparedTransports_;
   uint32_t sessionsCreated_{0};
   uint32_t sessionCreationErrors_{0};
   std::string expectedProto_;
@@ -184,3 +189,45 @@ TEST_F(HTTPSessionAcceptorTestNPN, AcceptorConfigCapture) {
   acceptor_->connectionReady(
       std::move(sock), clientAddress, "", SecureTransportType::NONE, tinfo);
 }
+
+TEST_F(HTTPSessionAcceptorTestNPNPlaintext, DrainSessionsAcceptedLater) {
+  config_->plaintextProtocol = "h2c";
+  newAcceptor();
+  acceptor_->expectedProto_ = "http/2";
+  auto progress = std::make_shared<DrainScheduler::Progress>();
+  size_t done = 0;
+  acceptor_->drainSessions(
+      std::chrono::milliseconds(0), progress, [&done] { done++; });
+  EXPECT_EQ(done, 1);
+
+  // Its turn has come as it arrives
+  AsyncSocket::UniquePtr sock(new AsyncSocket(&eventBase_));
+  SocketAddress clientAddress;
+  wangle::TransportInfo tinfo;
+  acceptor_->connectionReady(
+      std::move(sock), clientAddress, "", SecureTransportType::NONE, tinfo);
+  EXPECT_EQ(acceptor_->sessionsCreated_, 1);
+  EXPECT_EQ(progress->scheduled, 1);
+  EXPECT_EQ(progress->drained, 1);
+
+  // Nothing left to drain, nor to count again
+  acceptor_->drainSessions(
+      std::chrono::milliseconds(100), progress, [&done] { done++; });
+  EXPECT_EQ(done, 2);
+  EXPECT_EQ(progress->scheduled, 1);
+  EXPECT_EQ(progress->getPending(), 0);
+}
+
+TEST_F(HTTPSessionAcceptorTestNPNPlaintext, PrepareTransport) {
+  acceptor_->expectedProto_ = "http/1.1";
+  AsyncSocket::UniquePtr sock(new AsyncSocket(&eventBase_));
+  auto sockPtr = sock.get();
+  SocketAddress clientAddress;
+  wangle::TransportInfo tinfo;
+  acceptor_->connectionReady(
+      std::move(sock), clientAddress, "", SecureTransportType::NONE, tinfo);
+  // Plaintext, so unconverted and given to the session as prepared
+  ASSERT_EQ(acceptor_->preparedTransports_.size(), 1);
+  EXPECT_EQ(acceptor_->preparedTransports_[0], sockPtr);
+  EXPECT_EQ(acceptor_->sessionsCreated_, 1);
+}
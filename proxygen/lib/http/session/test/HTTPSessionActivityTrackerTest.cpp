@@ -98,3 +98,27 @@ TEST_F(HTTPSessionActivityTrackerTest, addTrackedEgressByteEvent) {
         1100, 2600, &byteEventTracker, transaction_.get());
   }
 }
+
+TEST_F(HTTPSessionActivityTrackerTest, Counting) {
+  HTTPSessionActivityTracker tracker(nullptr, 1000, 1000);
+  tracker.setCountingEnabled(true);
+  EXPECT_FALSE(tracker.getIdleTime().has_value());
+  EXPECT_FALSE(tracker.flushActivity());
+
+  EXPECT_FALSE(tracker.onIngressBody(500));
+  EXPECT_EQ(tracker.getActivityEpoch(), 0);
+  EXPECT_TRUE(tracker.onIngressBody(2700));
+  EXPECT_EQ(tracker.getActivityEpoch(), 1);
+  tracker.reportActivity();
+  EXPECT_EQ(tracker.getActivityEpoch(), 2);
+
+  auto idleTime = tracker.getIdleTime();
+  ASSERT_TRUE(idleTime.has_value());
+  EXPECT_LT(idleTime->count(), 1000);
+
+  // One flush per epoch, however many events it saw
+  EXPECT_TRUE(tracker.flushActivity());
+  EXPECT_FALSE(tracker.flushActivity());
+  tracker.reportActivity();
+  EXPECT_TRUE(tracker.flushActivity());
+}
@@ -0,0 +1,580 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
+#include <new>
+#include <proxygen/lib/http/codec/HQControlCodec.h>
+#include <proxygen/lib/http/codec/HQStreamCodec.h>
+#include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/codec/test/TestUtils.h>
+#include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPDownstreamSession.h>
+#include <proxygen/lib/http/session/test/HQSessionTestCommon.h>
+#include <proxygen/lib/http/session/test/MockQuicSocketDriver.h>
+#include <proxygen/lib/http/session/test/TestUtils.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+#include <vector>
+
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+#include <proxygen/lib/test/AllocationTracker.h>
+#endif
+
+/**
+ * Drives batches of concurrent requests through a downstream session, from
+ * ingress parsing to the write loop, one iteration per request.  Besides the
+ * request rate, it reports per request:
+ *
+ *   allocs     operator new calls
+ *   malloc_B   bytes allocated, buffer copies included (jemalloc only)
+ *   egress_B   bytes written to the transport
+ *
+ * The IdleSessions benchmarks instead report idle_B, the bytes a session
+ * still holds once it has answered a batch, with and without hibernation.
+ *
+ * Built with PROXYGEN_ALLOCATION_TRACKING and linked with allocationtracker,
+ * it also splits the mallocs by phase, as <phase>_allocs and <phase>_B.
+ */
+
+DEFINE_int32(streams, 16, "Concurrent requests per batch");
+DEFINE_int32(request_body_size, 0, "Request body bytes, 0 for a GET");
+DEFINE_int32(response_body_size, 1024, "Response body bytes");
+
+namespace {
+std::atomic<uint64_t> numAllocs{0};
+} // namespace
+
+void* operator new(size_t size) {
+  numAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+using namespace proxygen;
+using namespace proxygen::hq;
+
+namespace {
+
+constexpr quic::StreamId kControlStreamId = 2;
+constexpr quic::StreamId kQPACKEncoderStreamId = 6;
+constexpr quic::StreamId kQPACKDecoderStreamId = 10;
+// Large enough that flow control never stalls a batch
+constexpr uint32_t kWindow = 1 << 24;
+
+struct AllocStats {
+  static AllocStats now() {
+    AllocStats stats;
+    stats.allocs = numAllocs.load(std::memory_order_relaxed);
+    if (folly::usingJEMalloc()) {
+      folly::mallctlRead("thread.allocated", &stats.bytes);
+    }
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+    stats.phases = AllocationTracker::snapshot();
+#endif
+    return stats;
+  }
+
+  AllocStats& operator+=(const AllocStats& other) {
+    allocs += other.allocs;
+    bytes += other.bytes;
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+    for (size_t i = 0; i < kNumAllocationPhases; i++) {
+      auto phase = static_cast<AllocationPhase>(i);
+      phases[phase].allocs += other.phases[phase].allocs;
+      phases[phase].bytes += other.phases[phase].bytes;
+    }
+#endif
+    return *this;
+  }
+
+  AllocStats operator-(const AllocStats& other) const {
+    AllocStats stats;
+    stats.allocs = allocs - other.allocs;
+    stats.bytes = bytes - other.bytes;
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+    stats.phases = phases - other.phases;
+#endif
+    return stats;
+  }
+
+  uint64_t allocs{0};
+  uint64_t bytes{0};
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+  AllocationTracker::Snapshot phases;
+#endif
+};
+
+// Accepts every write at once, without copying it
+class SinkTransport : public TestAsyncTransport {
+ public:
+  using TestAsyncTransport::TestAsyncTransport;
+
+  void writeChain(folly::AsyncTransport::WriteCallback* callback,
+                  std::unique_ptr<folly::IOBuf>&& iob,
+                  folly::WriteFlags) override {
+    bytesWritten += iob->computeChainDataLength();
+    callback->writeSuccess();
+  }
+
+  uint64_t bytesWritten{0};
+};
+
+class BenchController;
+
+// Replies with FLAGS_response_body_size bytes once the request is complete
+class BenchHandler : public HTTPTransactionHandler {
+ public:
+  explicit BenchHandler(BenchController& controller)
+      : controller_(controller) {
+  }
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+  void detachTransaction() noexcept override;
+  void onHeadersComplete(std::unique_ptr<HTTPMessage>) noexcept override {
+  }
+  void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders>) noexcept override {
+  }
+  void onEOM() noexcept override;
+  void onUpgrade(UpgradeProtocol) noexcept override {
+  }
+  void onError(const HTTPException&) noexcept override {
+  }
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  BenchController& controller_;
+  HTTPTransaction* txn_{nullptr};
+};
+
+// Hands out pooled handlers, so their allocation isn't measured
+class BenchController : public HTTPSessionController {
+ public:
+  BenchController() {
+    response_.setStatusCode(200);
+    response_.setStatusMessage("OK");
+    response_.getHeaders().set(
+        HTTP_HEADER_CONTENT_LENGTH,
+        folly::to<std::string>(FLAGS_response_body_size));
+    if (FLAGS_response_body_size > 0) {
+      responseBody_ = makeBuf(FLAGS_response_body_size);
+    }
+    for (int32_t i = 0; i < FLAGS_streams; i++) {
+      handlers_.push_back(std::make_unique<BenchHandler>(*this));
+      freeHandlers_.push_back(handlers_.back().get());
+    }
+  }
+
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction&,
+                                            HTTPMessage*) override {
+    CHECK(!freeHandlers_.empty());
+    auto handler = freeHandlers_.back();
+    freeHandlers_.pop_back();
+    return handler;
+  }
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction*,
+      const HTTPException&,
+      const folly::SocketAddress&) override {
+    return nullptr;
+  }
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction*, const folly::SocketAddress&) override {
+    return nullptr;
+  }
+  void attachSession(HTTPSessionBase*) override {
+  }
+  void detachSession(const HTTPSessionBase*) override {
+  }
+
+  void release(BenchHandler* handler) {
+    freeHandlers_.push_back(handler);
+    completed_++;
+  }
+
+  const HTTPMessage& getResponse() const {
+    return response_;
+  }
+
+  const folly::IOBuf* getResponseBody() const {
+    return responseBody_.get();
+  }
+
+  uint64_t getCompleted() const {
+    return completed_;
+  }
+
+ private:
+  HTTPMessage response_;
+  std::unique_ptr<folly::IOBuf> responseBody_;
+  std::vector<std::unique_ptr<BenchHandler>> handlers_;
+  std::vector<BenchHandler*> freeHandlers_;
+  uint64_t completed_{0};
+};
+
+void BenchHandler::detachTransaction() noexcept {
+  txn_ = nullptr;
+  controller_.release(this);
+}
+
+void BenchHandler::onEOM() noexcept {
+  auto body = controller_.getResponseBody();
+  if (!body) {
+    txn_->sendHeadersWithEOM(controller_.getResponse());
+    return;
+  }
+  txn_->sendHeaders(controller_.getResponse());
+  txn_->sendBody(body->clone());
+  txn_->sendEOM();
+}
+
+HTTPMessage makeRequest() {
+  return FLAGS_request_body_size > 0 ? getPostRequest(FLAGS_request_body_size)
+                                     : getGetRequest();
+}
+
+void reportCounters(folly::UserCounters& counters,
+                    size_t iters,
+                    const AllocStats& stats,
+                    uint64_t egressBytes) {
+  if (iters == 0) {
+    return;
+  }
+  counters["allocs"] = stats.allocs / iters;
+  if (folly::usingJEMalloc()) {
+    counters["malloc_B"] = stats.bytes / iters;
+  }
+  counters["egress_B"] = egressBytes / iters;
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+  if (!AllocationTracker::isActive()) {
+    return;
+  }
+  for (size_t i = 0; i < kNumAllocationPhases; i++) {
+    auto phase = static_cast<AllocationPhase>(i);
+    std::string name = getAllocationPhaseString(phase);
+    counters[name + "_allocs"] = stats.phases[phase].allocs / iters;
+    counters[name + "_B"] = stats.phases[phase].bytes / iters;
+  }
+#endif
+}
+
+// Runs iters requests in batches of FLAGS_streams, each queued by prepare
+// and delivered by deliver and the event loop, until every batch is
+// answered.  Returns what the measured part allocated.
+template <typename Prepare, typename Deliver>
+AllocStats runBatches(folly::EventBase& evb,
+                      const BenchController& controller,
+                      size_t iters,
+                      Prepare prepare,
+                      Deliver deliver) {
+  AllocStats total;
+  for (size_t done = 0; done < iters;) {
+    size_t batch = std::min<size_t>(FLAGS_streams, iters - done);
+    AllocStats start;
+    BENCHMARK_SUSPEND {
+      prepare(batch);
+      start = AllocStats::now();
+    }
+    auto target = controller.getCompleted() + batch;
+    deliver();
+    while (controller.getCompleted() < target) {
+      evb.loopOnce();
+    }
+    BENCHMARK_SUSPEND {
+      total += AllocStats::now() - start;
+    }
+    done += batch;
+  }
+  return total;
+}
+
+// A downstream HTTP/2 session past the preface from clientCodec, writing to
+// transport
+HTTPDownstreamSession* startHTTP2Session(folly::EventBase& evb,
+                                         folly::HHWheelTimer* timeouts,
+                                         BenchController& controller,
+                                         HTTP2Codec& clientCodec,
+                                         SinkTransport*& transport) {
+  transport = new SinkTransport(&evb);
+  auto session = new HTTPDownstreamSession(
+      timeouts,
+      folly::AsyncTransport::UniquePtr(transport),
+      localAddr,
+      peerAddr,
+      &controller,
+      std::make_unique<HTTP2Codec>(TransportDirection::DOWNSTREAM),
+      mockTransportInfo,
+      nullptr);
+  session->setFlowControl(kWindow, kWindow, kWindow);
+  session->setMaxConcurrentIncomingStreams(
+      std::max<uint32_t>(FLAGS_streams, 100));
+  session->startNow();
+
+  folly::IOBufQueue preface{folly::IOBufQueue::cacheChainLength()};
+  clientCodec.generateConnectionPreface(preface);
+  clientCodec.getEgressSettings()->setSetting(
+      SettingsId::INITIAL_WINDOW_SIZE, kWindow);
+  clientCodec.generateSettings(preface);
+  clientCodec.generateWindowUpdate(
+      preface, 0, kWindow - clientCodec.getDefaultWindowSize());
+  transport->addReadEvent(preface, std::chrono::milliseconds(0));
+  transport->startReadEvents();
+  evb.loopOnce();
+  return session;
+}
+
+void runHTTP2(folly::UserCounters& counters, size_t iters) {
+  folly::EventBase evb;
+  BenchController controller;
+  folly::HHWheelTimer::UniquePtr timeouts;
+  SinkTransport* transport{nullptr};
+  HTTPDownstreamSession* session{nullptr};
+  HTTP2Codec clientCodec(TransportDirection::UPSTREAM);
+  auto req = makeRequest();
+  std::unique_ptr<folly::IOBuf> reqBody;
+  BENCHMARK_SUSPEND {
+    timeouts = makeTimeoutSet(&evb);
+    session = startHTTP2Session(
+        evb, timeouts.get(), controller, clientCodec, transport);
+    if (FLAGS_request_body_size > 0) {
+      reqBody = makeBuf(FLAGS_request_body_size);
+    }
+  }
+
+  auto prepare = [&](size_t batch) {
+    folly::IOBufQueue requests{folly::IOBufQueue::cacheChainLength()};
+    for (size_t i = 0; i < batch; i++) {
+      auto id = clientCodec.createStream();
+      clientCodec.generateHeader(requests, id, req, !reqBody);
+      if (reqBody) {
+        clientCodec.generateBody(
+            requests, id, reqBody->clone(), HTTPCodec::NoPadding, true);
+      }
+    }
+    // Credit back the session window the batch's responses will take
+    if (FLAGS_response_body_size > 0) {
+      clientCodec.generateWindowUpdate(
+          requests, 0, batch * FLAGS_response_body_size);
+    }
+    transport->addReadEvent(requests, std::chrono::milliseconds(0));
+  };
+  auto stats = runBatches(
+      evb, controller, iters, prepare, [&] { transport->startReadEvents(); });
+  uint64_t egressBytes = transport->bytesWritten;
+
+  BENCHMARK_SUSPEND {
+    reportCounters(counters, iters, stats, egressBytes);
+    session->dropConnection();
+    evb.loop();
+  }
+}
+
+void runHQ(folly::UserCounters& counters, size_t iters) {
+  folly::EventBase evb;
+  BenchController controller;
+  HQDownstreamSession* session{nullptr};
+  std::unique_ptr<quic::MockQuicSocketDriver> socketDriver;
+  HTTPSettings settings;
+  QPACKCodec qpackCodec;
+  folly::IOBufQueue encoderWriteBuf{folly::IOBufQueue::cacheChainLength()};
+  folly::IOBufQueue decoderWriteBuf{folly::IOBufQueue::cacheChainLength()};
+  auto req = makeRequest();
+  std::unique_ptr<folly::IOBuf> reqBody;
+  quic::StreamId nextStreamId = 0;
+  BENCHMARK_SUSPEND {
+    session = new HQDownstreamSession(std::chrono::milliseconds(5000),
+                                      &controller,
+                                      mockTransportInfo,
+                                      nullptr);
+    socketDriver = std::make_unique<quic::MockQuicSocketDriver>(
+        &evb,
+        session,
+        session,
+        quic::MockQuicSocketDriver::TransportEnum::SERVER,
+        kH3);
+    quic::QuicSocket::TransportInfo transportInfo;
+    EXPECT_CALL(*socketDriver->getSocket(), getTransportInfo())
+        .WillRepeatedly(testing::Return(transportInfo));
+    EXPECT_CALL(*socketDriver->getSocket(), getStreamTransportInfo(testing::_))
+        .WillRepeatedly(
+            testing::Return(quic::QuicSocket::StreamTransportInfo()));
+    session->setSocket(socketDriver->getSocket());
+    session->onTransportReady();
+
+    createControlStream(socketDriver.get(),
+                        kControlStreamId,
+                        UnidirectionalStreamType::CONTROL);
+    createControlStream(socketDriver.get(),
+                        kQPACKEncoderStreamId,
+                        UnidirectionalStreamType::QPACK_ENCODER);
+    createControlStream(socketDriver.get(),
+                        kQPACKDecoderStreamId,
+                        UnidirectionalStreamType::QPACK_DECODER);
+    HQControlCodec controlCodec(kControlStreamId,
+                                TransportDirection::UPSTREAM,
+                                StreamDirection::EGRESS,
+                                settings);
+    folly::IOBufQueue settingsBuf{folly::IOBufQueue::cacheChainLength()};
+    controlCodec.generateSettings(settingsBuf);
+    socketDriver->addReadEvent(
+        kControlStreamId, settingsBuf.move(), std::chrono::milliseconds(0));
+    evb.loopOnce();
+    if (FLAGS_request_body_size > 0) {
+      reqBody = makeBuf(FLAGS_request_body_size);
+    }
+  }
+
+  auto prepare = [&](size_t batch) {
+    for (size_t i = 0; i < batch; i++) {
+      auto id = nextStreamId;
+      nextStreamId += 4;
+      HQStreamCodec codec(
+          id,
+          TransportDirection::UPSTREAM,
+          qpackCodec,
+          encoderWriteBuf,
+          decoderWriteBuf,
+          [] { return std::numeric_limits<uint64_t>::max(); },
+          settings);
+      folly::IOBufQueue buf{folly::IOBufQueue::cacheChainLength()};
+      auto streamID = codec.createStream();
+      codec.generateHeader(buf, streamID, req, !reqBody);
+      if (reqBody) {
+        codec.generateBody(
+            buf, streamID, reqBody->clone(), HTTPCodec::NoPadding, true);
+      }
+      socketDriver->addReadEvent(id, buf.move(), std::chrono::milliseconds(0));
+      socketDriver->addReadEOF(id, std::chrono::milliseconds(0));
+    }
+    if (!encoderWriteBuf.empty()) {
+      socketDriver->addReadEvent(kQPACKEncoderStreamId,
+                                 encoderWriteBuf.move(),
+                                 std::chrono::milliseconds(0));
+    }
+  };
+  // The socket driver delivers the reads from the event loop
+  auto stats = runBatches(evb, controller, iters, prepare, [] {});
+
+  BENCHMARK_SUSPEND {
+    uint64_t egressBytes = 0;
+    for (quic::StreamId id = 0; id < nextStreamId; id += 4) {
+      egressBytes += socketDriver->streams_[id].writeBuf.chainLength();
+    }
+    reportCounters(counters, iters, stats, egressBytes);
+    session->closeWhenIdle();
+    evb.loop();
+    socketDriver.reset();
+  }
+}
+
+// The bytes still allocated by this thread (jemalloc only)
+uint64_t liveBytes() {
+  uint64_t allocated = 0;
+  uint64_t deallocated = 0;
+  if (folly::usingJEMalloc()) {
+    folly::mallctlRead("thread.allocated", &allocated);
+    folly::mallctlRead("thread.deallocated", &deallocated);
+  }
+  return allocated - deallocated;
+}
+
+// Opens iters HTTP/2 sessions, each answering one batch of GETs before it
+// sits idle, and reports what an idle session holds as idle_B
+void runIdleHTTP2(folly::UserCounters& counters,
+                  size_t iters,
+                  bool hibernate) {
+  folly::EventBase evb;
+  BenchController controller;
+  folly::HHWheelTimer::UniquePtr timeouts;
+  std::vector<HTTPDownstreamSession*> sessions;
+  auto req = getGetRequest();
+  BENCHMARK_SUSPEND {
+    timeouts = makeTimeoutSet(&evb);
+    sessions.reserve(iters);
+  }
+
+  int64_t idleBytes = 0;
+  for (size_t i = 0; i < iters; i++) {
+    auto start = liveBytes();
+    {
+      // The client's codec is gone before the measurement
+      HTTP2Codec clientCodec(TransportDirection::UPSTREAM);
+      SinkTransport* transport{nullptr};
+      auto session = startHTTP2Session(
+          evb, timeouts.get(), controller, clientCodec, transport);
+      session->setHibernateWhenIdle(hibernate);
+      folly::IOBufQueue requests{folly::IOBufQueue::cacheChainLength()};
+      for (int32_t j = 0; j < FLAGS_streams; j++) {
+        clientCodec.generateHeader(
+            requests, clientCodec.createStream(), req, true);
+      }
+      transport->addReadEvent(requests, std::chrono::milliseconds(0));
+      transport->startReadEvents();
+      auto target = controller.getCompleted() + FLAGS_streams;
+      while (controller.getCompleted() < target) {
+        evb.loopOnce();
+      }
+      sessions.push_back(session);
+    }
+    idleBytes += liveBytes() - start;
+  }
+
+  BENCHMARK_SUSPEND {
+    if (iters > 0 && folly::usingJEMalloc()) {
+      counters["idle_B"] = idleBytes / int64_t(iters);
+    }
+    for (auto session : sessions) {
+      session->dropConnection();
+    }
+    evb.loop();
+  }
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(HTTP2Requests, counters, iters) {
+  runHTTP2(counters, iters);
+}
+
+BENCHMARK_COUNTERS(HQRequests, counters, iters) {
+  runHQ(counters, iters);
+}
+
+BENCHMARK_COUNTERS(HTTP2IdleSessions, counters, iters) {
+  runIdleHTTP2(counters, iters, false);
+}
+
+BENCHMARK_COUNTERS(HTTP2IdleSessionsHibernating, counters, iters) {
+  runIdleHTTP2(counters, iters, true);
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleMock(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/observer/HTTPSessionEventBatch.h>
+
+using namespace proxygen;
+using Events = HTTPSessionEventBatch::Events;
+
+namespace {
+
+class TestObserver : public HTTPSessionEventBatch::Observer {
+ public:
+  void onEventBatch(folly::Range<const HTTPSessionEventBatch::Record*> records,
+                    bool lastIn) noexcept override {
+    batches++;
+    last = lastIn;
+    for (const auto& record : records) {
+      types.push_back(record.type);
+      streams.push_back(record.streamID);
+    }
+  }
+
+  uint32_t batches{0};
+  bool last{false};
+  std::vector<Events> types;
+  std::vector<uint64_t> streams;
+};
+
+} // namespace
+
+TEST(HTTPSessionEventBatchTest, OncePerLoop) {
+  folly::EventBase evb;
+  TestObserver observer;
+  {
+    HTTPSessionEventBatch batch;
+    EXPECT_FALSE(batch.wants(Events::requestStarted));
+    batch.addObserver(&observer,
+                      HTTPSessionEventBatch::eventBit(Events::requestStarted),
+                      &evb);
+    EXPECT_TRUE(batch.wants(Events::requestStarted));
+    EXPECT_FALSE(batch.wants(Events::transactionTimings));
+
+    batch.record(Events::requestStarted, 1).headerCount = 3;
+    batch.record(Events::requestStarted, 3).headerCount = 4;
+    EXPECT_EQ(observer.batches, 0);
+    evb.loopOnce();
+    EXPECT_EQ(observer.batches, 1);
+    EXPECT_EQ(observer.streams, (std::vector<uint64_t>{1, 3}));
+    EXPECT_FALSE(observer.last);
+
+    // Nothing recorded, nothing delivered
+    evb.loopOnce();
+    EXPECT_EQ(observer.batches, 1);
+    batch.record(Events::requestStarted, 5);
+  }
+  // The rest when the session goes away
+  EXPECT_EQ(observer.batches, 2);
+  EXPECT_TRUE(observer.last);
+  EXPECT_EQ(observer.streams.back(), 5);
+}
+
+TEST(HTTPSessionEventBatchTest, FilteredByObserver) {
+  TestObserver requests;
+  TestObserver all;
+  HTTPSessionEventBatch batch;
+  batch.addObserver(&requests,
+                    HTTPSessionEventBatch::eventBit(Events::requestStarted));
+  batch.addObserver(
+      &all,
+      HTTPSessionEventBatch::eventBit(Events::requestStarted) |
+          HTTPSessionEventBatch::eventBit(Events::transactionTimings));
+  batch.record(Events::requestStarted, 1);
+  batch.record(Events::transactionTimings, 1);
+  batch.flush();
+  EXPECT_EQ(requests.types, std::vector<Events>{Events::requestStarted});
+  EXPECT_EQ(all.types.size(), 2);
+
+  batch.removeObserver(&all);
+  EXPECT_FALSE(batch.wants(Events::transactionTimings));
+  batch.removeObserver(&requests);
+  EXPECT_FALSE(batch.wants(Events::requestStarted));
+  EXPECT_EQ(batch.getNumRecords(), 0);
+}
+
+TEST(HTTPSessionEventBatchTest, MovesEventBase) {
+  folly::EventBase evb1;
+  folly::EventBase evb2;
+  TestObserver observer;
+  HTTPSessionEventBatch batch;
+  batch.addObserver(&observer,
+                    HTTPSessionEventBatch::eventBit(Events::requestStarted),
+                    &evb1);
+  batch.record(Events::requestStarted, 1);
+
+  // What is kept goes out before leaving the old thread
+  batch.detachEventBase();
+  EXPECT_EQ(observer.batches, 1);
+  EXPECT_EQ(observer.streams, std::vector<uint64_t>{1});
+  EXPECT_FALSE(observer.last);
+  evb1.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(observer.batches, 1);
+
+  batch.attachEventBase(&evb2);
+  batch.record(Events::requestStarted, 3);
+  evb1.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(observer.batches, 1);
+  evb2.loopOnce();
+  EXPECT_EQ(observer.batches, 2);
+  EXPECT_EQ(observer.streams, (std::vector<uint64_t>{1, 3}));
+}
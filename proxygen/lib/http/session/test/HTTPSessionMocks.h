@@ -575,6 +575,9 @@ class MockHTTPSessionInfoCallback : public HTTPSession::InfoCallback {
   MOCK_METHOD(void, onEgressBufferCleared, (const HTTPSessionBase&));
   MOCK_METHOD(void, onSettings, (const HTTPSessionBase&, const SettingsList&));
   MOCK_METHOD(void, onSettingsAck, (const HTTPSessionBase&));
+  MOCK_METHOD(void,
+              onTransactionTimings,
+              (const HTTPSessionBase&, const HTTPTransactionTimings&));
 };
 
 class MockDSRRequestSender : public DSRRequestSender {
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <proxygen/lib/http/session/HTTPTransactionEgressSM.h>
+#include <proxygen/lib/http/session/HTTPTransactionIngressSM.h>
+
+#include <vector>
+
+using namespace proxygen;
+
+namespace {
+
+const size_t kNumBodyChunks = 16;
+
+// The transitions of a transaction receiving a chunked request and
+// sending a response with a body, kNumBodyChunks events a direction.
+template <class IngressFind, class EgressFind>
+bool runTransaction(IngressFind ingressFind, EgressFind egressFind) {
+  using IngressEvent = HTTPTransactionIngressSM::Event;
+  using EgressEvent = HTTPTransactionEgressSM::Event;
+  bool ok = true;
+  auto ingress = HTTPTransactionIngressSM::getNewInstance();
+  auto egress = HTTPTransactionEgressSM::getNewInstance();
+  auto ingressEvent = [&](IngressEvent event) {
+    auto res = ingressFind(ingress, event);
+    ingress = res.first;
+    ok &= res.second;
+  };
+  auto egressEvent = [&](EgressEvent event) {
+    auto res = egressFind(egress, event);
+    egress = res.first;
+    ok &= res.second;
+  };
+
+  ingressEvent(IngressEvent::onFinalHeaders);
+  ingressEvent(IngressEvent::onChunkHeader);
+  for (size_t i = 0; i < kNumBodyChunks; ++i) {
+    ingressEvent(IngressEvent::onBody);
+  }
+  ingressEvent(IngressEvent::onChunkComplete);
+  ingressEvent(IngressEvent::onEOM);
+  ingressEvent(IngressEvent::eomFlushed);
+
+  egressEvent(EgressEvent::sendHeaders);
+  for (size_t i = 0; i < kNumBodyChunks; ++i) {
+    egressEvent(EgressEvent::sendBody);
+  }
+  egressEvent(EgressEvent::sendEOM);
+  egressEvent(EgressEvent::eomFlushed);
+  return ok;
+}
+
+// The table as it was before it was built at compile time: on the heap,
+// bounds checked and behind a function call.
+template <class Data>
+class RuntimeTable {
+ public:
+  using State = typename Data::State;
+  using Event = typename Data::Event;
+  static constexpr size_t kNumStates = static_cast<size_t>(State::NumStates);
+  static constexpr size_t kNumEvents = static_cast<size_t>(Event::NumEvents);
+
+  RuntimeTable() {
+    transitions_.resize(kNumStates * kNumEvents);
+    for (size_t s = 0; s < kNumStates; ++s) {
+      for (size_t e = 0; e < kNumEvents; ++e) {
+        auto res = Data::find(State(s), Event(e));
+        transitions_[s * kNumEvents + e] =
+            res.second ? static_cast<uint8_t>(res.first) : kInvalid;
+      }
+    }
+  }
+
+  FOLLY_NOINLINE std::pair<State, bool> find(State s, Event e) const {
+    CHECK_LT(static_cast<size_t>(s), kNumStates);
+    CHECK_LT(static_cast<size_t>(e), kNumEvents);
+    uint8_t result = transitions_[static_cast<size_t>(s) * kNumEvents +
+                                  static_cast<size_t>(e)];
+    if (result == kInvalid) {
+      return std::make_pair(s, false);
+    }
+    return std::make_pair(State(result), true);
+  }
+
+ private:
+  static constexpr uint8_t kInvalid = 0xff;
+  std::vector<uint8_t> transitions_;
+};
+
+} // namespace
+
+BENCHMARK(RuntimeTransitionTable, iters) {
+  RuntimeTable<HTTPTransactionIngressSMData> ingress;
+  RuntimeTable<HTTPTransactionEgressSMData> egress;
+  for (size_t i = 0; i < iters; ++i) {
+    bool ok = runTransaction(
+        [&](auto s, auto e) { return ingress.find(s, e); },
+        [&](auto s, auto e) { return egress.find(s, e); });
+    folly::doNotOptimizeAway(ok);
+  }
+}
+
+BENCHMARK_RELATIVE(ConstexprTransitionTable, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    bool ok = runTransaction(
+        [](auto s, auto e) { return HTTPTransactionIngressSMData::find(s, e); },
+        [](auto s, auto e) { return HTTPTransactionEgressSMData::find(s, e); });
+    folly::doNotOptimizeAway(ok);
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -291,3 +291,22 @@ TEST_F(IngressStateMachineFixture, BadDatagramTransitionAfterEOM) {
   follow(HTTPTransactionIngressSM::Event::onEOM);
   fail(HTTPTransactionIngressSM::Event::onDatagram);
 }
+
+TEST(TransitionTableTest, Validation) {
+  using State = HTTPTransactionEgressSM::State;
+  using Event = HTTPTransactionEgressSM::Event;
+  constexpr TransitionTable<State, Event> twice{
+      {{{State::Start, Event::sendHeaders}, State::HeadersSent},
+       {{State::Start, Event::sendHeaders}, State::SendingDone}}};
+  static_assert(!twice.valid(), "Duplicate transition allowed");
+  constexpr TransitionTable<State, Event> outOfRange{
+      {{{State::Start, Event::NumEvents}, State::HeadersSent}}};
+  static_assert(!outOfRange.valid(), "Out of range transition allowed");
+
+  constexpr TransitionTable<State, Event> table{
+      {{{State::Start, Event::sendHeaders}, State::HeadersSent}}};
+  EXPECT_EQ(table.find(State::Start, Event::sendHeaders),
+            std::make_pair(State::HeadersSent, true));
+  EXPECT_EQ(table.find(State::Start, Event::sendBody),
+            std::make_pair(State::Start, false));
+}
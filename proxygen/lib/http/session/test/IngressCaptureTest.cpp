@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fcntl.h>
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+#include <limits>
+#include <proxygen/lib/http/session/IngressCapture.h>
+
+using namespace proxygen;
+
+namespace {
+folly::ByteRange bytes(folly::StringPiece data) {
+  return folly::ByteRange(data);
+}
+} // namespace
+
+class IngressCaptureTest : public testing::Test {
+ protected:
+  std::unique_ptr<IngressRecorder> makeRecorder(
+      uint64_t maxBytes = std::numeric_limits<uint64_t>::max()) {
+    return std::make_unique<IngressRecorder>(
+        folly::File(tmpFile_.path().string(), O_WRONLY | O_TRUNC),
+        "h3",
+        maxBytes);
+  }
+
+  IngressRecording readBack() {
+    auto recording = IngressRecording::read(tmpFile_.path().string());
+    EXPECT_TRUE(recording.hasValue()) << recording.error();
+    return std::move(recording.value());
+  }
+
+  static std::string toString(const folly::IOBuf& buf) {
+    return buf.cloneCoalescedAsValue().moveToFbString().toStdString();
+  }
+
+  folly::test::TemporaryFile tmpFile_;
+};
+
+TEST_F(IngressCaptureTest, RoundTrip) {
+  auto recorder = makeRecorder();
+  recorder->onData(2, bytes(folly::StringPiece("\x00", 1)));
+  auto chain = folly::IOBuf::copyBuffer("hello ");
+  chain->appendToChain(folly::IOBuf::copyBuffer("world"));
+  recorder->onData(0, *chain);
+  // Empty reads aren't recorded
+  recorder->onData(0, folly::ByteRange());
+  recorder->onEndOfStream(0);
+  std::string big(3 * IngressRecorder::kFlushBytes, 'x');
+  recorder->onData(1ULL << 40, bytes(big));
+  EXPECT_FALSE(recorder->isTruncated());
+  recorder.reset();
+
+  auto recording = readBack();
+  EXPECT_EQ(recording.protocol, "h3");
+  ASSERT_EQ(recording.records.size(), 4);
+  const auto& records = recording.records;
+  EXPECT_EQ(records[0].type, IngressRecordType::DATA);
+  EXPECT_EQ(records[0].streamId, 2);
+  EXPECT_EQ(toString(*records[0].data), std::string("\x00", 1));
+  EXPECT_EQ(records[1].streamId, 0);
+  EXPECT_EQ(toString(*records[1].data), "hello world");
+  EXPECT_EQ(records[2].type, IngressRecordType::END_OF_STREAM);
+  EXPECT_EQ(records[2].data, nullptr);
+  EXPECT_EQ(records[3].streamId, 1ULL << 40);
+  EXPECT_EQ(toString(*records[3].data), big);
+}
+
+TEST_F(IngressCaptureTest, Truncated) {
+  auto recorder = makeRecorder(100);
+  recorder->onData(0, bytes("first"));
+  recorder->onData(0, bytes(std::string(100, 'x')));
+  EXPECT_TRUE(recorder->isTruncated());
+  // Nothing after the first dropped record either
+  recorder->onData(0, bytes("last"));
+  recorder->onEndOfStream(0);
+  recorder.reset();
+
+  auto recording = readBack();
+  ASSERT_EQ(recording.records.size(), 1);
+  EXPECT_EQ(toString(*recording.records[0].data), "first");
+  std::string capture;
+  ASSERT_TRUE(folly::readFile(tmpFile_.path().c_str(), capture));
+  EXPECT_LE(capture.size(), 100);
+}
+
+TEST_F(IngressCaptureTest, Malformed) {
+  EXPECT_TRUE(IngressRecording::parse(folly::ByteRange()).hasError());
+  EXPECT_TRUE(
+      IngressRecording::parse(bytes("garbage")).hasError());
+
+  auto recorder = makeRecorder();
+  recorder->onData(0, bytes("data"));
+  recorder.reset();
+  std::string capture;
+  ASSERT_TRUE(folly::readFile(tmpFile_.path().c_str(), capture));
+  EXPECT_TRUE(IngressRecording::parse(bytes(capture)).hasValue());
+  capture.pop_back();
+  EXPECT_TRUE(IngressRecording::parse(bytes(capture)).hasError());
+  capture.push_back('a');
+  capture.push_back(char(7));
+  EXPECT_TRUE(IngressRecording::parse(bytes(capture)).hasError());
+}
+
+TEST_F(IngressCaptureTest, Sampling) {
+  folly::test::TemporaryDirectory dir;
+  auto& capture = IngressCapture::get();
+  EXPECT_FALSE(capture.isEnabled());
+  EXPECT_EQ(capture.maybeStartRecording("h3"), nullptr);
+
+  IngressCapture::Options options;
+  options.directory = dir.path().string();
+  options.sampleOneIn = 1;
+  options.maxConnections = 2;
+  capture.configure(options);
+  EXPECT_TRUE(capture.isEnabled());
+  auto first = capture.maybeStartRecording("h3");
+  auto second = capture.maybeStartRecording("http/1.1");
+  EXPECT_NE(first, nullptr);
+  EXPECT_NE(second, nullptr);
+  EXPECT_EQ(capture.maybeStartRecording("h3"), nullptr);
+  EXPECT_EQ(capture.getNumRecorded(), 2);
+
+  // Without a directory, nothing is recorded
+  options.directory.clear();
+  capture.configure(options);
+  EXPECT_FALSE(capture.isEnabled());
+  EXPECT_EQ(capture.getNumRecorded(), 0);
+  capture.configure(IngressCapture::Options());
+}
@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <folly/Benchmark.h>
+#include <folly/String.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
+#include <new>
+#include <proxygen/lib/http/codec/HTTP1xCodec.h>
+#include <proxygen/lib/http/codec/HTTP2Codec.h>
+#include <proxygen/lib/http/session/HQDownstreamSession.h>
+#include <proxygen/lib/http/session/HTTPDownstreamSession.h>
+#include <proxygen/lib/http/session/IngressCapture.h>
+#include <proxygen/lib/http/session/test/MockQuicSocketDriver.h>
+#include <proxygen/lib/http/session/test/TestUtils.h>
+#include <proxygen/lib/test/TestAsyncTransport.h>
+#include <quic/state/QuicStreamUtilities.h>
+#include <set>
+#include <vector>
+
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+#include <proxygen/lib/test/AllocationTracker.h>
+#endif
+
+/**
+ * Replays the connections IngressCapture recorded through a downstream
+ * session answering every request with an empty 200, one iteration per
+ * replay of a capture.  The captured timing is ignored: every record is
+ * delivered at once, in order, so that runs are deterministic.  Besides the
+ * replay time, it reports per request:
+ *
+ *   cpu_ns     thread CPU time
+ *   allocs     operator new calls
+ *   malloc_B   bytes allocated (jemalloc only)
+ *
+ * and stalled, the replays the session didn't finish within
+ * --replay_timeout_ms (eg: a request waiting on flow control credit the
+ * client only sent the original responses).
+ *
+ * Built with PROXYGEN_ALLOCATION_TRACKING and linked with allocationtracker,
+ * it also splits the mallocs by phase, as <phase>_allocs and <phase>_B.
+ */
+
+DEFINE_string(captures, "", "Comma separated capture files to replay");
+DEFINE_int32(replay_timeout_ms, 1000, "Drops a replay taking longer");
+
+namespace {
+std::atomic<uint64_t> numAllocs{0};
+} // namespace
+
+void* operator new(size_t size) {
+  numAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+using namespace proxygen;
+
+namespace {
+
+struct ReplayStats {
+  static ReplayStats now() {
+    ReplayStats stats;
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    stats.cpuNs = uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    stats.allocs = numAllocs.load(std::memory_order_relaxed);
+    if (folly::usingJEMalloc()) {
+      folly::mallctlRead("thread.allocated", &stats.bytes);
+    }
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+    stats.phases = AllocationTracker::snapshot();
+#endif
+    return stats;
+  }
+
+  ReplayStats& operator+=(const ReplayStats& other) {
+    cpuNs += other.cpuNs;
+    allocs += other.allocs;
+    bytes += other.bytes;
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+    for (size_t i = 0; i < kNumAllocationPhases; i++) {
+      auto phase = static_cast<AllocationPhase>(i);
+      phases[phase].allocs += other.phases[phase].allocs;
+      phases[phase].bytes += other.phases[phase].bytes;
+    }
+#endif
+    return *this;
+  }
+
+  ReplayStats operator-(const ReplayStats& other) const {
+    ReplayStats stats;
+    stats.cpuNs = cpuNs - other.cpuNs;
+    stats.allocs = allocs - other.allocs;
+    stats.bytes = bytes - other.bytes;
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+    stats.phases = phases - other.phases;
+#endif
+    return stats;
+  }
+
+  uint64_t cpuNs{0};
+  uint64_t allocs{0};
+  uint64_t bytes{0};
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+  AllocationTracker::Snapshot phases;
+#endif
+};
+
+// Accepts every write at once, without copying it
+class SinkTransport : public TestAsyncTransport {
+ public:
+  using TestAsyncTransport::TestAsyncTransport;
+
+  void writeChain(folly::AsyncTransport::WriteCallback* callback,
+                  std::unique_ptr<folly::IOBuf>&& iob,
+                  folly::WriteFlags) override {
+    callback->writeSuccess();
+  }
+};
+
+class ReplayController;
+
+// Discards the request, and answers it with an empty 200 once complete
+class ReplayHandler : public HTTPTransactionHandler {
+ public:
+  explicit ReplayHandler(ReplayController& controller)
+      : controller_(controller) {
+  }
+  void setTransaction(HTTPTransaction* txn) noexcept override {
+    txn_ = txn;
+  }
+  void detachTransaction() noexcept override;
+  void onHeadersComplete(std::unique_ptr<HTTPMessage>) noexcept override {
+  }
+  void onBody(std::unique_ptr<folly::IOBuf>) noexcept override {
+  }
+  void onTrailers(std::unique_ptr<HTTPHeaders>) noexcept override {
+  }
+  void onEOM() noexcept override;
+  void onUpgrade(UpgradeProtocol) noexcept override {
+  }
+  void onError(const HTTPException&) noexcept override {
+  }
+  void onEgressPaused() noexcept override {
+  }
+  void onEgressResumed() noexcept override {
+  }
+
+ private:
+  ReplayController& controller_;
+  HTTPTransaction* txn_{nullptr};
+};
+
+// Reuses the handlers of earlier replays, so that once warm their
+// allocation isn't measured
+class ReplayController : public HTTPSessionController {
+ public:
+  ReplayController() {
+    response_.setStatusCode(200);
+    response_.setStatusMessage("OK");
+    response_.getHeaders().set(HTTP_HEADER_CONTENT_LENGTH, "0");
+  }
+
+  HTTPTransactionHandler* getRequestHandler(HTTPTransaction&,
+                                            HTTPMessage*) override {
+    requests_++;
+    if (freeHandlers_.empty()) {
+      handlers_.push_back(std::make_unique<ReplayHandler>(*this));
+      return handlers_.back().get();
+    }
+    auto handler = freeHandlers_.back();
+    freeHandlers_.pop_back();
+    return handler;
+  }
+  HTTPTransactionHandler* getParseErrorHandler(
+      HTTPTransaction*,
+      const HTTPException&,
+      const folly::SocketAddress&) override {
+    return nullptr;
+  }
+  HTTPTransactionHandler* getTransactionTimeoutHandler(
+      HTTPTransaction*, const folly::SocketAddress&) override {
+    return nullptr;
+  }
+  void attachSession(HTTPSessionBase*) override {
+  }
+  void detachSession(const HTTPSessionBase*) override {
+  }
+
+  void release(ReplayHandler* handler) {
+    freeHandlers_.push_back(handler);
+  }
+
+  const HTTPMessage& getResponse() const {
+    return response_;
+  }
+
+  uint64_t getRequests() const {
+    return requests_;
+  }
+
+ private:
+  HTTPMessage response_;
+  std::vector<std::unique_ptr<ReplayHandler>> handlers_;
+  std::vector<ReplayHandler*> freeHandlers_;
+  uint64_t requests_{0};
+};
+
+void ReplayHandler::detachTransaction() noexcept {
+  txn_ = nullptr;
+  controller_.release(this);
+}
+
+void ReplayHandler::onEOM() noexcept {
+  txn_->sendHeadersWithEOM(controller_.getResponse());
+}
+
+class DestroyWatcher : public HTTPSessionBase::InfoCallback {
+ public:
+  void onDestroy(const HTTPSessionBase&) override {
+    destroyed = true;
+  }
+
+  bool destroyed{false};
+};
+
+// Loops until the session is gone, dropping it past --replay_timeout_ms.
+// Returns whether it had to.
+bool loopUntilDestroyed(folly::EventBase& evb,
+                        HTTPSessionBase* session,
+                        const DestroyWatcher& watcher) {
+  bool stalled = false;
+  auto watchdog = folly::AsyncTimeout::make(evb, [&]() noexcept {
+    stalled = true;
+    session->dropConnection();
+  });
+  watchdog->scheduleTimeout(FLAGS_replay_timeout_ms);
+  while (!watcher.destroyed) {
+    evb.loopOnce();
+  }
+  return stalled;
+}
+
+// Feeds the recorded bytes of a TCP connection to a fresh session, then
+// EOF, which closes it once its requests are answered
+bool replayHTTP(folly::EventBase& evb,
+                folly::HHWheelTimer* timeouts,
+                ReplayController& controller,
+                const IngressRecording& recording,
+                CodecProtocol protocol) {
+  DestroyWatcher watcher;
+  auto transport = new SinkTransport(&evb);
+  std::unique_ptr<HTTPCodec> codec;
+  if (protocol == CodecProtocol::HTTP_2) {
+    codec = std::make_unique<HTTP2Codec>(TransportDirection::DOWNSTREAM);
+  } else {
+    codec = std::make_unique<HTTP1xCodec>(TransportDirection::DOWNSTREAM);
+  }
+  auto session =
+      new HTTPDownstreamSession(timeouts,
+                                folly::AsyncTransport::UniquePtr(transport),
+                                localAddr,
+                                peerAddr,
+                                &controller,
+                                std::move(codec),
+                                mockTransportInfo,
+                                &watcher);
+  session->startNow();
+  bool eof = false;
+  for (const auto& record : recording.records) {
+    if (record.type == IngressRecordType::DATA) {
+      transport->addMovableReadEvent(record.data->clone());
+    } else {
+      transport->addReadEOF(std::chrono::milliseconds(0));
+      eof = true;
+      break;
+    }
+  }
+  if (!eof) {
+    transport->addReadEOF(std::chrono::milliseconds(0));
+  }
+  transport->startReadEvents();
+  return loopUntilDestroyed(evb, session, watcher);
+}
+
+// Feeds the recorded streams of a QUIC connection to a fresh session,
+// ending the request streams the capture left open, then closes it once
+// idle
+bool replayHQ(folly::EventBase& evb,
+              ReplayController& controller,
+              const IngressRecording& recording) {
+  DestroyWatcher watcher;
+  auto session = new HQDownstreamSession(
+      std::chrono::milliseconds(5000), &controller, mockTransportInfo, nullptr);
+  session->setInfoCallback(&watcher);
+  auto socketDriver = std::make_unique<quic::MockQuicSocketDriver>(
+      &evb,
+      session,
+      session,
+      quic::MockQuicSocketDriver::TransportEnum::SERVER,
+      recording.protocol);
+  quic::QuicSocket::TransportInfo transportInfo;
+  EXPECT_CALL(*socketDriver->getSocket(), getTransportInfo())
+      .WillRepeatedly(testing::Return(transportInfo));
+  EXPECT_CALL(*socketDriver->getSocket(), getStreamTransportInfo(testing::_))
+      .WillRepeatedly(testing::Return(quic::QuicSocket::StreamTransportInfo()));
+  session->setSocket(socketDriver->getSocket());
+  session->onTransportReady();
+
+  std::set<quic::StreamId> open;
+  for (const auto& record : recording.records) {
+    if (record.type == IngressRecordType::DATA) {
+      socketDriver->addReadEvent(record.streamId,
+                                 record.data->clone(),
+                                 std::chrono::milliseconds(0));
+      if (quic::isBidirectionalStream(record.streamId)) {
+        open.insert(record.streamId);
+      }
+    } else {
+      socketDriver->addReadEOF(record.streamId, std::chrono::milliseconds(0));
+      open.erase(record.streamId);
+    }
+  }
+  for (auto id : open) {
+    socketDriver->addReadEOF(id, std::chrono::milliseconds(0));
+  }
+  // The socket driver delivers the reads from the event loop
+  evb.loopOnce();
+  session->closeWhenIdle();
+  auto stalled = loopUntilDestroyed(evb, session, watcher);
+  socketDriver.reset();
+  return stalled;
+}
+
+void reportCounters(folly::UserCounters& counters,
+                    uint64_t requests,
+                    unsigned iters,
+                    uint64_t stalled,
+                    const ReplayStats& stats) {
+  counters["requests"] = iters > 0 ? requests / iters : 0;
+  counters["stalled"] = stalled;
+  if (requests == 0) {
+    return;
+  }
+  counters["cpu_ns"] = stats.cpuNs / requests;
+  counters["allocs"] = stats.allocs / requests;
+  if (folly::usingJEMalloc()) {
+    counters["malloc_B"] = stats.bytes / requests;
+  }
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+  if (!AllocationTracker::isActive()) {
+    return;
+  }
+  for (size_t i = 0; i < kNumAllocationPhases; i++) {
+    auto phase = static_cast<AllocationPhase>(i);
+    std::string name = getAllocationPhaseString(phase);
+    counters[name + "_allocs"] = stats.phases[phase].allocs / requests;
+    counters[name + "_B"] = stats.phases[phase].bytes / requests;
+  }
+#endif
+}
+
+void runReplay(folly::UserCounters& counters,
+               unsigned iters,
+               const IngressRecording& recording) {
+  folly::EventBase evb;
+  ReplayController controller;
+  folly::HHWheelTimer::UniquePtr timeouts;
+  auto protocol = getCodecProtocolFromStr(recording.protocol);
+  BENCHMARK_SUSPEND {
+    timeouts = makeTimeoutSet(&evb);
+  }
+
+  ReplayStats total;
+  uint64_t stalled = 0;
+  for (unsigned i = 0; i < iters; i++) {
+    ReplayStats start;
+    BENCHMARK_SUSPEND {
+      start = ReplayStats::now();
+    }
+    bool timedOut = isHQCodecProtocol(protocol)
+                        ? replayHQ(evb, controller, recording)
+                        : replayHTTP(evb,
+                                     timeouts.get(),
+                                     controller,
+                                     recording,
+                                     protocol);
+    BENCHMARK_SUSPEND {
+      total += ReplayStats::now() - start;
+      stalled += timedOut;
+    }
+  }
+  BENCHMARK_SUSPEND {
+    reportCounters(counters, controller.getRequests(), iters, stalled, total);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  testing::InitGoogleMock(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  std::vector<std::string> paths;
+  folly::split(',', FLAGS_captures, paths, true);
+  if (paths.empty()) {
+    LOG(ERROR) << "No --captures to replay";
+    return 1;
+  }
+  // Registered benchmarks hold on to their recordings
+  std::vector<std::unique_ptr<IngressRecording>> recordings;
+  for (const auto& path : paths) {
+    auto recording = IngressRecording::read(path);
+    if (recording.hasError()) {
+      LOG(ERROR) << "Can't replay " << path << ": " << recording.error();
+      return 1;
+    }
+    auto protocol = getCodecProtocolFromStr(recording->protocol);
+    if (!isHQCodecProtocol(protocol) && protocol != CodecProtocol::HTTP_1_1 &&
+        protocol != CodecProtocol::HTTP_2) {
+      LOG(ERROR) << "Can't replay " << path << ": unsupported protocol "
+                 << recording->protocol;
+      return 1;
+    }
+    recordings.push_back(
+        std::make_unique<IngressRecording>(std::move(*recording)));
+    auto replayed = recordings.back().get();
+    folly::addBenchmark(
+        __FILE__,
+        folly::to<std::string>("Replay(", path, ")"),
+        [replayed](folly::UserCounters& counters, unsigned iters) {
+          runReplay(counters, iters, *replayed);
+          return iters;
+        });
+  }
+  folly::runBenchmarks();
+  return 0;
+}
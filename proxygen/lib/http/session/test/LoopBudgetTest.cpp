@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/LoopBudget.h>
+
+#include <thread>
+
+using namespace proxygen;
+using namespace std::chrono;
+
+TEST(LoopBudgetTest, PerThread) {
+  LoopBudget::get().setOptions({1000, 2000});
+  LoopBudget::get().onReadYield();
+  EXPECT_EQ(LoopBudget::get().getReadSlice(), 1000);
+  EXPECT_EQ(LoopBudget::get().getWriteSlice(), 2000);
+
+  std::thread([] {
+    EXPECT_EQ(LoopBudget::get().getReadSlice(), 0);
+    EXPECT_EQ(LoopBudget::get().getWriteSlice(), 0);
+    EXPECT_EQ(LoopBudget::get().getStats().readYields, 0);
+  }).join();
+  LoopBudget::get().setOptions({});
+}
+
+TEST(LoopBudgetTest, LoopSamples) {
+  LoopBudget budget;
+  EXPECT_EQ(budget.getAvgLoopBusyTime(), microseconds(0));
+  budget.onLoopSample(microseconds(100));
+  budget.onLoopSample(microseconds(300));
+  EXPECT_EQ(budget.getStats().loopSamples, 2);
+  EXPECT_EQ(budget.getStats().maxLoopBusyTime, microseconds(300));
+  EXPECT_EQ(budget.getAvgLoopBusyTime(), microseconds(200));
+}
+
+TEST(LoopBudgetTest, Observer) {
+  folly::EventBase evb;
+  evb.setObserver(LoopBudget::makeObserver(1));
+  auto samples = LoopBudget::get().getStats().loopSamples;
+  for (int i = 0; i < 4; i++) {
+    evb.runInLoop([] {});
+    evb.loopOnce();
+  }
+  EXPECT_GT(LoopBudget::get().getStats().loopSamples, samples);
+}
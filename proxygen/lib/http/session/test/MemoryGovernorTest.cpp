@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/MemoryGovernor.h>
+#include <thread>
+#include <vector>
+
+using namespace proxygen;
+
+namespace {
+constexpr uint64_t kLow = 1 << 20;
+constexpr uint64_t kHigh = 4 << 20;
+} // namespace
+
+class MemoryGovernorTest : public testing::Test {
+ protected:
+  // Updates one interval later than the last time
+  void update() {
+    now_ += MemoryGovernor::kUpdateInterval;
+    governor_.update(now_);
+  }
+
+  MemoryGovernor governor_;
+  TimePoint now_{getCurrentTime()};
+};
+
+TEST_F(MemoryGovernorTest, Disabled) {
+  governor_.addConsumer();
+  governor_.onBuffered(2 * kHigh);
+  update();
+  EXPECT_FALSE(governor_.isEnabled());
+  EXPECT_FALSE(governor_.isUnderPressure());
+  EXPECT_EQ(governor_.scale(65536), 65536);
+}
+
+TEST_F(MemoryGovernorTest, Counters) {
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([this] {
+      governor_.addConsumer();
+      for (int j = 0; j < 1000; j++) {
+        governor_.onBuffered(100);
+      }
+      governor_.onBuffered(-50000);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(governor_.getBufferedBytes(), 4 * 50000);
+  EXPECT_EQ(governor_.getNumConsumers(), 4);
+}
+
+TEST_F(MemoryGovernorTest, PressureAndRecovery) {
+  governor_.setWatermarks(kLow, kHigh);
+  for (int i = 0; i < 4; i++) {
+    governor_.addConsumer();
+  }
+  governor_.onBuffered(kHigh + 1);
+  update();
+  EXPECT_TRUE(governor_.isUnderPressure());
+  EXPECT_EQ(governor_.getScale(), MemoryGovernor::kScaleOne / 2);
+  EXPECT_EQ(governor_.scale(65536), 32768);
+  EXPECT_EQ(governor_.getLargeConsumerBytes(), (kHigh + 1) / 4);
+
+  // At most once per interval
+  governor_.update(now_);
+  EXPECT_EQ(governor_.getScale(), MemoryGovernor::kScaleOne / 2);
+  for (int i = 0; i < 10; i++) {
+    update();
+  }
+  EXPECT_EQ(governor_.getScale(), MemoryGovernor::kMinScale);
+
+  // Between the watermarks nothing changes
+  governor_.onBuffered(-int64_t(kHigh - kLow));
+  update();
+  EXPECT_TRUE(governor_.isUnderPressure());
+  EXPECT_EQ(governor_.getScale(), MemoryGovernor::kMinScale);
+
+  // Below the low one the scale grows back a step at a time
+  governor_.onBuffered(-int64_t(kLow));
+  update();
+  EXPECT_FALSE(governor_.isUnderPressure());
+  EXPECT_EQ(governor_.getScale(),
+            MemoryGovernor::kMinScale + MemoryGovernor::kScaleStep);
+  EXPECT_EQ(governor_.getLargeConsumerBytes(),
+            MemoryGovernor::kMinLargeConsumerBytes);
+  for (int i = 0; i < 10; i++) {
+    update();
+  }
+  EXPECT_EQ(governor_.getScale(), MemoryGovernor::kScaleOne);
+}
+
+TEST_F(MemoryGovernorTest, TurnOff) {
+  governor_.setWatermarks(kLow, kHigh);
+  governor_.onBuffered(kHigh + 1);
+  update();
+  EXPECT_TRUE(governor_.isUnderPressure());
+
+  governor_.setWatermarks(0, 0);
+  EXPECT_FALSE(governor_.isEnabled());
+  EXPECT_FALSE(governor_.isUnderPressure());
+  EXPECT_EQ(governor_.getScale(), MemoryGovernor::kScaleOne);
+}
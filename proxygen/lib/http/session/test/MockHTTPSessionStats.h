@@ -89,6 +89,35 @@ class MockHTTPSessionStats : public DummyHTTPSessionStats {
     _recordSessionPeriodicPingProbeTimeout();
   }
   MOCK_METHOD(void, _recordSessionPeriodicPingProbeTimeout, ());
+  void recordEgressBudgetAllocatedBytes(int64_t num) noexcept override {
+    _recordEgressBudgetAllocatedBytes(num);
+  }
+  MOCK_METHOD(void, _recordEgressBudgetAllocatedBytes, (int64_t));
+  void recordEgressBudgetRebalance() noexcept override {
+    _recordEgressBudgetRebalance();
+  }
+  MOCK_METHOD(void, _recordEgressBudgetRebalance, ());
+  void recordIngressHeaderParseTime(
+      std::chrono::microseconds latency) noexcept override {
+    _recordIngressHeaderParseTime(latency);
+  }
+  MOCK_METHOD(void,
+              _recordIngressHeaderParseTime,
+              (std::chrono::microseconds));
+  void recordTransactionTimeToFirstByte(
+      std::chrono::microseconds latency) noexcept override {
+    _recordTransactionTimeToFirstByte(latency);
+  }
+  MOCK_METHOD(void,
+              _recordTransactionTimeToFirstByte,
+              (std::chrono::microseconds));
+  void recordTransactionTimeToLastByte(
+      std::chrono::microseconds latency) noexcept override {
+    _recordTransactionTimeToLastByte(latency);
+  }
+  MOCK_METHOD(void,
+              _recordTransactionTimeToLastByte,
+              (std::chrono::microseconds));
 };
 
 } // namespace proxygen
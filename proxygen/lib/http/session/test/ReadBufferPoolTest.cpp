@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/session/ReadBufferPool.h>
+
+using namespace folly;
+using namespace proxygen;
+
+TEST(ReadBufferPoolTest, ReuseConsumedBuffer) {
+  ReadBufferPool pool;
+  auto buf = pool.acquire(4000);
+  EXPECT_GE(buf->tailroom(), 4000);
+  auto data = buf->data();
+  buf->append(100);
+  pool.release(std::move(buf));
+  EXPECT_EQ(pool.getFreeCount(), 1);
+
+  buf = pool.acquire(4000);
+  EXPECT_EQ(buf->data(), data);
+  EXPECT_EQ(buf->length(), 0);
+  EXPECT_EQ(pool.getStats().acquired, 2);
+  EXPECT_EQ(pool.getStats().reused, 1);
+  EXPECT_EQ(pool.getStats().released, 1);
+  EXPECT_DOUBLE_EQ(pool.getHitRate(), 0.5);
+}
+
+TEST(ReadBufferPoolTest, SharedBufferNotReused) {
+  ReadBufferPool pool;
+  auto buf = pool.acquire(4000);
+  buf->append(100);
+  // e.g. body data the codec handed to a transaction
+  auto clone = buf->cloneOne();
+  pool.release(std::move(buf));
+  EXPECT_EQ(pool.getFreeCount(), 0);
+  EXPECT_EQ(clone->length(), 100);
+}
+
+TEST(ReadBufferPoolTest, ReleaseChainAndLimit) {
+  ReadBufferPool pool(2);
+  auto chain = pool.acquire(100);
+  chain->prependChain(pool.acquire(100));
+  chain->prependChain(pool.acquire(100));
+  pool.release(std::move(chain));
+  EXPECT_EQ(pool.getFreeCount(), 2);
+  EXPECT_EQ(pool.getStats().released, 2);
+
+  // buffers too small for the requested size are dropped
+  auto big = pool.acquire(100000);
+  EXPECT_GE(big->tailroom(), 100000);
+  EXPECT_EQ(pool.getFreeCount(), 0);
+  EXPECT_EQ(pool.getStats().reused, 0);
+}
+
+TEST(ReadBufferPoolTest, PinnedBytes) {
+  ReadBufferPool pool;
+  pool.adjustPinnedBytes(300);
+  pool.adjustPinnedBytes(-100);
+  EXPECT_EQ(pool.getStats().pinnedBytes, 200);
+}
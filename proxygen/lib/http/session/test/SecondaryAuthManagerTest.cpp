@@ -83,6 +83,7 @@ TEST(SecondaryAuthManagerTest, Authenticator) {
       std::move(certRequestContext), std::move(extensions));
   auto requestId = authRequestPair.first;
   auto authRequest = std::move(authRequestPair.second);
+  auto repeatedRequest = authRequest->clone();
 
   // Generate an authenticator.
   MockAsyncFizzBase fizzBase;
@@ -119,4 +120,52 @@ TEST(SecondaryAuthManagerTest, Authenticator) {
   EXPECT_EQ(expected_cert,
             StringPiece(hexlify(((*peerCert)[0].cert_data)->coalesce())));
   EXPECT_TRUE(isValid);
+
+  // The same request again is answered from the cache, and still mapped
+  const uint16_t repeatedId = requestId + 1;
+  EXPECT_FALSE(authManager.getCertId(repeatedId).has_value());
+  auto repeatedPair = authManager.getAuthenticator(fizzBase,
+                                                   TransportDirection::UPSTREAM,
+                                                   repeatedId,
+                                                   std::move(repeatedRequest));
+  EXPECT_EQ(repeatedPair.first, certId);
+  auto repeatedCertId = authManager.getCertId(repeatedId);
+  ASSERT_TRUE(repeatedCertId.has_value());
+  EXPECT_EQ(*repeatedCertId, certId);
+}
+
+TEST(SecondaryAuthManagerTest, VerifiedChainCache) {
+  size_t verified = 0;
+  bool accept = true;
+  VerifiedChainCache cache(
+      [&](const std::vector<fizz::CertificateEntry>&) {
+        verified++;
+        return accept;
+      },
+      2);
+  auto makeChain = [](std::vector<std::string> certs) {
+    std::vector<fizz::CertificateEntry> chain;
+    for (auto& cert : certs) {
+      fizz::CertificateEntry entry;
+      entry.cert_data = folly::IOBuf::copyBuffer(cert);
+      chain.push_back(std::move(entry));
+    }
+    return chain;
+  };
+  EXPECT_TRUE(cache.verify(makeChain({"leaf", "ca"})));
+  EXPECT_TRUE(cache.verify(makeChain({"leaf", "ca"})));
+  EXPECT_EQ(verified, 1);
+  EXPECT_EQ(cache.getStats().hits, 1);
+
+  // The boundaries between the certificates count
+  accept = false;
+  EXPECT_FALSE(cache.verify(makeChain({"lea", "fca"})));
+  EXPECT_FALSE(cache.verify(makeChain({"lea", "fca"})));
+  EXPECT_EQ(verified, 2);
+
+  // Evicted
+  EXPECT_FALSE(cache.verify(makeChain({"other"})));
+  EXPECT_FALSE(cache.verify(makeChain({"leaf", "ca"})));
+  EXPECT_EQ(verified, 4);
+  EXPECT_EQ(cache.getStats().misses, 4);
 }
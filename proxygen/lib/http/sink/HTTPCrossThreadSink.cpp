@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/sink/HTTPCrossThreadSink.h>
+
+#include <glog/logging.h>
+
+namespace proxygen {
+
+std::shared_ptr<HTTPCrossThreadSink> HTTPCrossThreadSink::make(
+    HTTPTransaction* txn, folly::EventBase* evb, Options options) {
+  CHECK(txn);
+  CHECK(evb);
+  return std::shared_ptr<HTTPCrossThreadSink>(
+      new HTTPCrossThreadSink(txn, evb, options));
+}
+
+bool HTTPCrossThreadSink::sendHeaders(const HTTPMessage& headers) {
+  Op op{Op::Type::HEADERS};
+  op.headers = std::make_unique<HTTPMessage>(headers);
+  return enqueue(std::move(op));
+}
+
+bool HTTPCrossThreadSink::sendBody(std::unique_ptr<folly::IOBuf> body) {
+  Op op{Op::Type::BODY};
+  op.body = std::move(body);
+  return enqueue(std::move(op));
+}
+
+bool HTTPCrossThreadSink::sendTrailers(const HTTPHeaders& trailers) {
+  Op op{Op::Type::TRAILERS};
+  op.trailers = std::make_unique<HTTPHeaders>(trailers);
+  return enqueue(std::move(op));
+}
+
+bool HTTPCrossThreadSink::sendEOM() {
+  return enqueue(Op{Op::Type::EOM});
+}
+
+bool HTTPCrossThreadSink::sendAbort() {
+  return enqueue(Op{Op::Type::ABORT});
+}
+
+bool HTTPCrossThreadSink::enqueue(Op op) {
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+      return false;
+    }
+    if (op.type == Op::Type::EOM || op.type == Op::Type::ABORT) {
+      closed_ = true;
+    }
+    if (op.type == Op::Type::BODY) {
+      if (!op.body || op.body->empty()) {
+        return true;
+      }
+      auto queued = queuedBytes_.load(std::memory_order_relaxed) +
+                    op.body->computeChainDataLength();
+      queuedBytes_.store(queued, std::memory_order_relaxed);
+      if (queued > options_.maxQueuedBytes) {
+        sawFull_ = true;
+      }
+    }
+    if (op.type == Op::Type::BODY && !pending_.empty() &&
+        pending_.back().type == Op::Type::BODY) {
+      pending_.back().body->prependChain(std::move(op.body));
+    } else {
+      pending_.push_back(std::move(op));
+    }
+    schedule = !scheduled_;
+    scheduled_ = true;
+  }
+  if (schedule) {
+    evb_->runInEventBaseThread([self = shared_from_this()] { self->drain(); });
+  }
+  return true;
+}
+
+void HTTPCrossThreadSink::drain() {
+  std::vector<Op> ops;
+  bool sawFull = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ops.swap(pending_);
+    scheduled_ = false;
+    sawFull = sawFull_;
+    sawFull_ = false;
+    queuedBytes_.store(0, std::memory_order_relaxed);
+  }
+  if (!txn_) {
+    return;
+  }
+  HTTPTransaction::DestructorGuard g(txn_);
+  // The transaction's callbacks may detach() it along the way
+  for (auto& op : ops) {
+    if (!txn_) {
+      return;
+    }
+    switch (op.type) {
+      case Op::Type::HEADERS:
+        txn_->sendHeaders(*op.headers);
+        break;
+      case Op::Type::BODY:
+        txn_->sendBody(std::move(op.body));
+        break;
+      case Op::Type::TRAILERS:
+        txn_->sendTrailers(*op.trailers);
+        break;
+      case Op::Type::EOM:
+        txn_->sendEOM();
+        break;
+      case Op::Type::ABORT:
+        txn_->sendAbort();
+        break;
+    }
+  }
+  if (sawFull && txn_ && callback_ &&
+      !txnEgressPaused_.load(std::memory_order_relaxed)) {
+    callback_->onEgressResumed();
+  }
+}
+
+void HTTPCrossThreadSink::onEgressPaused() {
+  DCHECK(evb_->isInEventBaseThread());
+  txnEgressPaused_.store(true, std::memory_order_relaxed);
+  if (callback_) {
+    callback_->onEgressPaused();
+  }
+}
+
+void HTTPCrossThreadSink::onEgressResumed() {
+  DCHECK(evb_->isInEventBaseThread());
+  txnEgressPaused_.store(false, std::memory_order_relaxed);
+  // Otherwise once the queue is drained
+  if (callback_ && !isEgressPaused()) {
+    callback_->onEgressResumed();
+  }
+}
+
+void HTTPCrossThreadSink::detach() {
+  DCHECK(evb_->isInEventBaseThread());
+  txn_ = nullptr;
+  callback_ = nullptr;
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  pending_.clear();
+  queuedBytes_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace proxygen
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <folly/io/async/EventBase.h>
+#include <memory>
+#include <mutex>
+#include <proxygen/lib/http/session/HTTPTransaction.h>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Egress of a transaction for handlers producing it on other threads,
+ * e.g. CPU-bound work on a CPUOffloadPool.
+ *
+ * The send*() calls may be made from any thread.  They are queued, and the
+ * queue is drained into the transaction on its EventBase in one
+ * runInEventBaseThread for all that was queued meanwhile, body queued back
+ * to back being sent as one sendBody().
+ *
+ * Backpressure: isEgressPaused() may be polled from any thread, and the
+ * Callback is told on the EventBase when to stop and when to go on.  The
+ * handler of the transaction forwards its onEgressPaused() and
+ * onEgressResumed() to the sink, and calls detach() from its
+ * detachTransaction(), after which the send*() calls return false.
+ */
+class HTTPCrossThreadSink
+    : public std::enable_shared_from_this<HTTPCrossThreadSink> {
+ public:
+  class Callback {
+   public:
+    virtual ~Callback() = default;
+
+    // Both on the EventBase
+    virtual void onEgressPaused() noexcept = 0;
+    virtual void onEgressResumed() noexcept = 0;
+  };
+
+  struct Options {
+    // Queued body beyond which isEgressPaused() is set until the next drain
+    size_t maxQueuedBytes{64 * 1024};
+  };
+
+  // txn must be on evb
+  static std::shared_ptr<HTTPCrossThreadSink> make(HTTPTransaction* txn,
+                                                   folly::EventBase* evb,
+                                                   Options options);
+  static std::shared_ptr<HTTPCrossThreadSink> make(HTTPTransaction* txn,
+                                                   folly::EventBase* evb) {
+    return make(txn, evb, Options());
+  }
+
+  HTTPCrossThreadSink(const HTTPCrossThreadSink&) = delete;
+  HTTPCrossThreadSink& operator=(const HTTPCrossThreadSink&) = delete;
+
+  // Any thread.  false, dropping what is given, once detached or after an
+  // EOM or abort.
+  bool sendHeaders(const HTTPMessage& headers);
+  bool sendBody(std::unique_ptr<folly::IOBuf> body);
+  bool sendTrailers(const HTTPHeaders& trailers);
+  bool sendEOM();
+  bool sendAbort();
+
+  // Any thread
+  [[nodiscard]] bool isEgressPaused() const {
+    return txnEgressPaused_.load(std::memory_order_relaxed) ||
+           queuedBytes_.load(std::memory_order_relaxed) >
+               options_.maxQueuedBytes;
+  }
+
+  // EventBase thread
+  void setCallback(Callback* callback) {
+    callback_ = callback;
+  }
+  void onEgressPaused();
+  void onEgressResumed();
+  void detach();
+
+  // Any thread, for tests
+  size_t getQueuedBytes() const {
+    return queuedBytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Op {
+    enum class Type : uint8_t { HEADERS, BODY, TRAILERS, EOM, ABORT };
+
+    Type type;
+    std::unique_ptr<HTTPMessage> headers;
+    std::unique_ptr<folly::IOBuf> body;
+    std::unique_ptr<HTTPHeaders> trailers;
+  };
+
+  HTTPCrossThreadSink(HTTPTransaction* txn,
+                      folly::EventBase* evb,
+                      Options options)
+      : txn_(txn), evb_(evb), options_(options) {
+  }
+
+  bool enqueue(Op op);
+  void drain();
+
+  // EventBase thread only
+  HTTPTransaction* txn_;
+  Callback* callback_{nullptr};
+
+  folly::EventBase* evb_;
+  const Options options_;
+  std::atomic<bool> txnEgressPaused_{false};
+  std::atomic<size_t> queuedBytes_{0};
+
+  std::mutex mutex_;
+  std::vector<Op> pending_;
+  bool scheduled_{false};
+  // Queued body went over maxQueuedBytes since the last drain
+  bool sawFull_{false};
+  // No more may be queued
+  bool closed_{false};
+};
+
+} // namespace proxygen
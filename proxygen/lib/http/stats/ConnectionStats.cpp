@@ -37,21 +37,49 @@ TLConnectionStats::TLConnectionStats(const std::string& prefix)
       newConns_(prefix + "_new_conn", SUM) {
 }
 
+const char* TLConnectionStats::getColumnName(Column column) {
+  switch (column) {
+    case kConnectionsOpened:
+      return "new_conn";
+    case kConnectionsClosed:
+      return "closed_conn";
+    case kRequests:
+      return "req";
+    case kResponses:
+      return "resp";
+    case kEgressBytes:
+      return "egress_bytes";
+    case kIngressBytes:
+      return "ingress_bytes";
+    case kEgressBodyBytes:
+      return "egress_body_bytes";
+    case kIngressBodyBytes:
+      return "ingress_body_bytes";
+    case kNumColumns:
+      break;
+  }
+  return "";
+}
+
 void TLConnectionStats::recordConnectionOpen() {
   currConns_.incrementValue(1);
   newConns_.add(1);
+  columns_.add(kConnectionsOpened);
 }
 
 void TLConnectionStats::recordConnectionClose() {
   currConns_.incrementValue(-1);
+  columns_.add(kConnectionsClosed);
 }
 
 void TLConnectionStats::recordRequest() {
   req_.add(1);
+  columns_.add(kRequests);
 }
 
 void TLConnectionStats::recordResponse(folly::Optional<uint16_t> responseCode) {
   resp_.add(1);
+  columns_.add(kResponses);
   if (responseCode.has_value()) {
     responseCodes_.addStatus(responseCode.value());
   }
@@ -63,18 +91,22 @@ void TLConnectionStats::recordDuration(size_t duration) {
 
 void TLConnectionStats::addEgressBytes(size_t bytes) {
   egressBytes_.add(bytes);
+  columns_.add(kEgressBytes, bytes);
 }
 
 void TLConnectionStats::addIngressBytes(size_t bytes) {
   ingressBytes_.add(bytes);
+  columns_.add(kIngressBytes, bytes);
 }
 
 void TLConnectionStats::addEgressBodyBytes(size_t bytes) {
   egressBodyBytes_.add(bytes);
+  columns_.add(kEgressBodyBytes, bytes);
 }
 
 void TLConnectionStats::addIngressBodyBytes(size_t bytes) {
   ingressBodyBytes_.add(bytes);
+  columns_.add(kIngressBodyBytes, bytes);
 }
 
 } // namespace proxygen
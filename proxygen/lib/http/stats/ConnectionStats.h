@@ -12,6 +12,7 @@
 
 #include <proxygen/lib/http/stats/TLResponseCodeStats.h>
 #include <proxygen/lib/stats/BaseStats.h>
+#include <proxygen/lib/stats/ColumnStats.h>
 
 namespace proxygen {
 
@@ -48,8 +49,29 @@ class ConnectionStats {
  */
 class TLConnectionStats : public ConnectionStats {
  public:
+  // Also counted per thread, for bulk export through getColumns()
+  enum Column : size_t {
+    kConnectionsOpened,
+    kConnectionsClosed,
+    kRequests,
+    kResponses,
+    kEgressBytes,
+    kIngressBytes,
+    kEgressBodyBytes,
+    kIngressBodyBytes,
+    kNumColumns
+  };
+  using Columns = ColumnStats<kNumColumns>;
+
   explicit TLConnectionStats(const std::string& prefix);
 
+  // Without the prefix, eg: "req"
+  static const char* getColumnName(Column column);
+
+  const Columns& getColumns() const {
+    return columns_;
+  }
+
   void recordConnectionOpen() override;
 
   void recordConnectionClose() override;
@@ -81,6 +103,8 @@ class TLConnectionStats : public ConnectionStats {
 
   BaseStats::TLCounter currConns_;
   BaseStats::TLTimeseries newConns_;
+
+  Columns columns_;
 };
 
 } // namespace proxygen
@@ -113,4 +113,56 @@ void TLHeaderCodecStats::recordDecodeTooLarge(HeaderCodec::Type type) {
   decodeTooLarge_[i].add(1);
 }
 
+bool TLHeaderCodecStats::sampleHeaders(HeaderCodec::Type /*type*/) {
+  return headerSampling_.isLucky();
+}
+
+void TLHeaderCodecStats::recordHeaderEncode(
+    HeaderCodec::Type type, const HeaderCodec::HeaderSample& sample) {
+  recordHeader(type, true, sample);
+}
+
+void TLHeaderCodecStats::recordHeaderDecode(
+    HeaderCodec::Type type, const HeaderCodec::HeaderSample& sample) {
+  recordHeader(type, false, sample);
+}
+
+const TLHeaderCodecStats::HeaderTotals& TLHeaderCodecStats::getSampledHeaders(
+    HeaderCodec::Type type, bool encode, HTTPHeaderCode code) const {
+  static const HeaderTotals kNone;
+  if (sampledHeaders_.empty()) {
+    return kNone;
+  }
+  return sampledHeaders_[sampledHeaderIndex(type, encode, code)];
+}
+
+size_t TLHeaderCodecStats::sampledHeaderIndex(HeaderCodec::Type type,
+                                              bool encode,
+                                              HTTPHeaderCode code) const {
+  uint32_t i = (uint32_t)type;
+  CHECK(i < kCompressionTypes.size());
+  // Including registered extensions
+  CHECK_LT(code, HTTPCommonHeaders::kMaxCodes);
+  return (i * 2 + (encode ? 0 : 1)) * HTTPCommonHeaders::kMaxCodes + code;
+}
+
+void TLHeaderCodecStats::recordHeader(HeaderCodec::Type type,
+                                      bool encode,
+                                      const HeaderCodec::HeaderSample& sample) {
+  if (sampledHeaders_.empty()) {
+    sampledHeaders_.resize(kCompressionTypes.size() * 2 *
+                           HTTPCommonHeaders::kMaxCodes);
+  }
+  auto& totals = sampledHeaders_[sampledHeaderIndex(type, encode, sample.code)];
+  totals.headers++;
+  totals.uncompressed += sample.uncompressed;
+  totals.compressed += sample.compressed;
+  if (sample.representation == HeaderCodec::Representation::INDEXED) {
+    totals.indexed++;
+  } else if (sample.representation ==
+             HeaderCodec::Representation::NAME_INDEXED) {
+    totals.nameIndexed++;
+  }
+}
+
 } // namespace proxygen
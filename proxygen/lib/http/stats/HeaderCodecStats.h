@@ -9,6 +9,7 @@
 #pragma once
 
 #include <proxygen/lib/http/codec/compress/HeaderCodec.h>
+#include <proxygen/lib/sampling/Sampling.h>
 #include <proxygen/lib/stats/BaseStats.h>
 #include <string>
 #include <vector>
@@ -28,7 +29,48 @@ class TLHeaderCodecStats : public HeaderCodec::Stats {
   void recordDecodeError(HeaderCodec::Type type) override;
   void recordDecodeTooLarge(HeaderCodec::Type type) override;
 
+  /**
+   * Per-header sizes and table hits, over the given share of header blocks
+   * (none by default), summed on this thread by HTTPHeaderCode.  Uncommon
+   * names, neither generated nor registered, are summed as HTTP_HEADER_OTHER.
+   */
+  struct HeaderTotals {
+    uint64_t headers{0};
+    uint64_t uncompressed{0};
+    uint64_t compressed{0};
+    // Whole header from a table
+    uint64_t indexed{0};
+    // Name from a table, literal value
+    uint64_t nameIndexed{0};
+  };
+
+  void setHeaderSampleRate(double rate) {
+    headerSampling_.updateRate(rate);
+  }
+
+  const HeaderTotals& getSampledHeaders(HeaderCodec::Type type,
+                                        bool encode,
+                                        HTTPHeaderCode code) const;
+
+  void resetSampledHeaders() {
+    sampledHeaders_.clear();
+  }
+
+  bool sampleHeaders(HeaderCodec::Type type) override;
+  void recordHeaderEncode(HeaderCodec::Type type,
+                          const HeaderCodec::HeaderSample& sample) override;
+  void recordHeaderDecode(HeaderCodec::Type type,
+                          const HeaderCodec::HeaderSample& sample) override;
+
  private:
+  size_t sampledHeaderIndex(HeaderCodec::Type type,
+                            bool encode,
+                            HTTPHeaderCode code) const;
+  void recordHeader(HeaderCodec::Type type,
+                    bool encode,
+                    const HeaderCodec::HeaderSample& sample);
+
+
   std::vector<std::unique_ptr<BaseStats::TLHistogram>> encodeCompr_;
   std::vector<std::unique_ptr<BaseStats::TLHistogram>> encodeUncompr_;
   std::vector<std::unique_ptr<BaseStats::TLHistogram>> decodeCompr_;
@@ -37,6 +79,9 @@ class TLHeaderCodecStats : public HeaderCodec::Stats {
   std::vector<BaseStats::TLTimeseries> decodes_;
   std::vector<BaseStats::TLTimeseries> decodeErrors_;
   std::vector<BaseStats::TLTimeseries> decodeTooLarge_;
+  Sampling headerSampling_{0.0};
+  // By type, direction and code, allocated on the first sample
+  std::vector<HeaderTotals> sampledHeaders_;
 };
 
 } // namespace proxygen
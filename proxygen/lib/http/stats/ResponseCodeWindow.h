@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/Time.h>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Response counts by status class over a rolling window of fixed-width
+ * buckets, e.g. the last 10s by 100ms, for admission control and circuit
+ * breakers on the thread that records them.
+ *
+ * A ring of buckets plus running totals: addStatus() and sum() are O(1),
+ * amortized over the buckets expiring, and use no locks or atomics, so an
+ * instance must only be used from one thread.
+ */
+class ResponseCodeWindow {
+ public:
+  enum StatusClass : uint8_t {
+    kNone, // no status
+    kOther,
+    k1xx,
+    k2xx,
+    k3xx,
+    k4xx,
+    k5xx,
+    kNumClasses
+  };
+
+  static StatusClass statusClass(int status) {
+    if (status < 0) {
+      return kNone;
+    } else if (status < 100 || status >= 600) {
+      return kOther;
+    }
+    return static_cast<StatusClass>(k1xx + (status / 100 - 1));
+  }
+
+  ResponseCodeWindow(std::chrono::milliseconds bucketWidth, size_t numBuckets)
+      : bucketWidth_(bucketWidth), buckets_(numBuckets) {
+    CHECK_GT(bucketWidth.count(), 0);
+    CHECK_GT(numBuckets, 0);
+  }
+
+  std::chrono::milliseconds getWindow() const {
+    return bucketWidth_ * buckets_.size();
+  }
+
+  void addStatus(int status, TimePoint now = getCurrentTime()) {
+    auto cls = statusClass(status);
+    advance(now);
+    buckets_[current_ % buckets_.size()][cls]++;
+    totals_[cls]++;
+  }
+
+  // Over the last getWindow(), including the current partial bucket
+  uint64_t sum(StatusClass cls, TimePoint now = getCurrentTime()) {
+    DCHECK_LT(cls, kNumClasses);
+    advance(now);
+    return totals_[cls];
+  }
+
+  uint64_t sum(TimePoint now = getCurrentTime()) {
+    advance(now);
+    uint64_t total = 0;
+    for (auto count : totals_) {
+      total += count;
+    }
+    return total;
+  }
+
+ private:
+  using Counts = std::array<uint64_t, kNumClasses>;
+
+  void advance(TimePoint now) {
+    auto bucket = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            now.time_since_epoch())
+            .count() /
+        bucketWidth_.count());
+    if (bucket <= current_) {
+      // Same bucket, or a clock going back: count in the current one
+      return;
+    }
+    if (bucket - current_ >= buckets_.size()) {
+      // The whole window expired
+      for (auto& counts : buckets_) {
+        counts.fill(0);
+      }
+      totals_.fill(0);
+    } else {
+      while (current_ < bucket) {
+        current_++;
+        auto& counts = buckets_[current_ % buckets_.size()];
+        for (size_t i = 0; i < kNumClasses; i++) {
+          totals_[i] -= counts[i];
+        }
+        counts.fill(0);
+      }
+    }
+    current_ = bucket;
+  }
+
+  std::chrono::milliseconds bucketWidth_;
+  std::vector<Counts> buckets_;
+  Counts totals_{};
+  // Index of the bucket being counted, in bucket widths since the epoch
+  uint64_t current_{0};
+};
+
+} // namespace proxygen
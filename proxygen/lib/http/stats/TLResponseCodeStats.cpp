@@ -47,6 +47,10 @@ TLResponseCodeStats::TLResponseCodeStats(const std::string& name)
 }
 
 void TLResponseCodeStats::addStatus(int status) {
+  // As exported, without the healthcheck failures below
+  if (window && status != 555) {
+    window->addStatus(status);
+  }
   switch (status) {
     case 200:
       status2xx.add(1);
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <memory>
+#include <proxygen/lib/http/stats/ResponseCodeWindow.h>
 #include <proxygen/lib/stats/BaseStats.h>
 
 namespace proxygen {
@@ -25,6 +27,9 @@ struct TLResponseCodeStats {
   BaseStats::TLTimeseries status4xx;
   BaseStats::TLTimeseries status5xx;
 
+  // If set, statuses are counted in it too, at sub-minute resolution
+  std::unique_ptr<ResponseCodeWindow> window;
+
   // TODO: all the counters below are marked for deprecation.
 
   BaseStats::TLTimeseries status39x;
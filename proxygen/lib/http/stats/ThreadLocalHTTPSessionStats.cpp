@@ -14,6 +14,7 @@ TLHTTPSessionStats::TLHTTPSessionStats(const std::string& prefix)
     : txnsOpen(prefix + "_transactions_open"),
       pendingBufferedReadBytes(prefix + "_pending_buffered_read_bytes"),
       pendingBufferedWriteBytes(prefix + "_pending_buffered_write_bytes"),
+      egressBudgetAllocatedBytes(prefix + "_egress_budget_allocated_bytes"),
       txnsOpened(prefix + "_txn_opened", facebook::fb303::SUM),
       txnsFromSessionReuse(prefix + "_txn_session_reuse", facebook::fb303::SUM),
       txnsTransactionStalled(prefix + "_txn_transaction_stall",
@@ -24,6 +25,12 @@ TLHTTPSessionStats::TLHTTPSessionStats(const std::string& prefix)
       sessionPeriodicPingProbeTimeout(
           prefix + "_session_periodic_ping_probe_timeout",
           facebook::fb303::SUM),
+      egressBudgetRebalances(prefix + "_egress_budget_rebalances",
+                             facebook::fb303::SUM),
+      ingressBodyZeroCopyBytes(prefix + "_ingress_body_zero_copy_bytes",
+                               facebook::fb303::SUM),
+      ingressBodyCopiedBytes(prefix + "_ingress_body_copied_bytes",
+                             facebook::fb303::SUM),
       presendIoSplit(prefix + "_presend_io_split", facebook::fb303::SUM),
       presendExceedLimit(prefix + "_presend_exceed_limit",
                          facebook::fb303::SUM),
@@ -53,7 +60,24 @@ TLHTTPSessionStats::TLHTTPSessionStats(const std::string& prefix)
                       50,
                       75,
                       95,
-                      99) {
+                      99),
+      qpackEncodeRatio(prefix + "_qpack_encode_ratio_pct",
+                       1,
+                       0,
+                       100,
+                       facebook::fb303::AVG,
+                       50,
+                       95),
+      qpackWarmEncodeRatio(prefix + "_qpack_warm_encode_ratio_pct",
+                           1,
+                           0,
+                           100,
+                           facebook::fb303::AVG,
+                           50,
+                           95),
+      ingressHeaderParseTime(prefix + "_ingress_header_parse_time_us"),
+      txnTimeToFirstByte(prefix + "_txn_ttfb_us"),
+      txnTimeToLastByte(prefix + "_txn_ttlb_us") {
 }
 
 void TLHTTPSessionStats::recordTransactionOpened() noexcept {
@@ -152,4 +176,46 @@ void TLHTTPSessionStats::recordPendingBufferedWriteBytes(
   pendingBufferedWriteBytes.incrementValue(amount);
 }
 
+void TLHTTPSessionStats::recordEgressBudgetAllocatedBytes(
+    int64_t amount) noexcept {
+  egressBudgetAllocatedBytes.incrementValue(amount);
+}
+
+void TLHTTPSessionStats::recordEgressBudgetRebalance() noexcept {
+  egressBudgetRebalances.add(1);
+}
+
+void TLHTTPSessionStats::recordIngressBodyZeroCopyBytes(
+    uint64_t bytes) noexcept {
+  ingressBodyZeroCopyBytes.add(bytes);
+}
+
+void TLHTTPSessionStats::recordIngressBodyCopiedBytes(uint64_t bytes) noexcept {
+  ingressBodyCopiedBytes.add(bytes);
+}
+
+void TLHTTPSessionStats::recordQPACKEncodeRatio(bool warmTable,
+                                                uint32_t pct) noexcept {
+  if (warmTable) {
+    qpackWarmEncodeRatio.add(pct);
+  } else {
+    qpackEncodeRatio.add(pct);
+  }
+}
+
+void TLHTTPSessionStats::recordIngressHeaderParseTime(
+    std::chrono::microseconds latency) noexcept {
+  ingressHeaderParseTime.record(latency);
+}
+
+void TLHTTPSessionStats::recordTransactionTimeToFirstByte(
+    std::chrono::microseconds latency) noexcept {
+  txnTimeToFirstByte.record(latency);
+}
+
+void TLHTTPSessionStats::recordTransactionTimeToLastByte(
+    std::chrono::microseconds latency) noexcept {
+  txnTimeToLastByte.record(latency);
+}
+
 } // namespace proxygen
@@ -10,6 +10,7 @@
 
 #include <proxygen/lib/http/session/HTTPSessionStats.h>
 #include <proxygen/lib/stats/BaseStats.h>
+#include <proxygen/lib/stats/TLLatencyHistogram.h>
 #include <string>
 
 namespace proxygen {
@@ -41,16 +42,31 @@ class TLHTTPSessionStats : public HTTPSessionStats {
   void recordPendingBufferedWriteBytes(int64_t amount) noexcept override;
   void recordEgressContentLengthMismatches() noexcept override;
   void recordSessionPeriodicPingProbeTimeout() noexcept override;
+  void recordEgressBudgetAllocatedBytes(int64_t amount) noexcept override;
+  void recordEgressBudgetRebalance() noexcept override;
+  void recordIngressBodyZeroCopyBytes(uint64_t bytes) noexcept override;
+  void recordIngressBodyCopiedBytes(uint64_t bytes) noexcept override;
+  void recordQPACKEncodeRatio(bool warmTable, uint32_t pct) noexcept override;
+  void recordIngressHeaderParseTime(
+      std::chrono::microseconds latency) noexcept override;
+  void recordTransactionTimeToFirstByte(
+      std::chrono::microseconds latency) noexcept override;
+  void recordTransactionTimeToLastByte(
+      std::chrono::microseconds latency) noexcept override;
 
   BaseStats::TLCounter txnsOpen;
   BaseStats::TLCounter pendingBufferedReadBytes;
   BaseStats::TLCounter pendingBufferedWriteBytes;
+  BaseStats::TLCounter egressBudgetAllocatedBytes;
   BaseStats::TLTimeseries txnsOpened;
   BaseStats::TLTimeseries txnsFromSessionReuse;
   BaseStats::TLTimeseries txnsTransactionStalled;
   BaseStats::TLTimeseries txnsSessionStalled;
   BaseStats::TLTimeseries egressContentLengthMismatches;
   BaseStats::TLTimeseries sessionPeriodicPingProbeTimeout;
+  BaseStats::TLTimeseries egressBudgetRebalances;
+  BaseStats::TLTimeseries ingressBodyZeroCopyBytes;
+  BaseStats::TLTimeseries ingressBodyCopiedBytes;
   // Time to Last Byte Ack (TTLBA)
   BaseStats::TLTimeseries presendIoSplit;
   BaseStats::TLTimeseries presendExceedLimit;
@@ -66,6 +82,12 @@ class TLHTTPSessionStats : public HTTPSessionStats {
   BaseStats::TLTimeseries ttbtxExceedLimit;
   BaseStats::TLHistogram txnsPerSession;
   BaseStats::TLHistogram sessionIdleTime;
+  BaseStats::TLHistogram qpackEncodeRatio;
+  BaseStats::TLHistogram qpackWarmEncodeRatio;
+  // Percentiles, in microseconds, to the p999
+  TLLatencyHistogram ingressHeaderParseTime;
+  TLLatencyHistogram txnTimeToFirstByte;
+  TLLatencyHistogram txnTimeToLastByte;
 };
 
 } // namespace proxygen
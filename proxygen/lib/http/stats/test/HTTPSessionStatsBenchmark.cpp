@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <proxygen/lib/http/stats/TLResponseCodeStats.h>
+#include <proxygen/lib/http/stats/ThreadLocalHTTPSessionStats.h>
+
+using namespace proxygen;
+
+namespace {
+
+// The calls HTTPSessionBase and HTTPTransaction make for one small request
+// that is read and written in a single IO each.
+void recordRequest(HTTPSessionStats* stats, TLResponseCodeStats* codes) {
+  if (stats) {
+    stats->recordTransactionOpened();
+    stats->recordPendingBufferedReadBytes(512);
+    stats->recordPendingBufferedReadBytes(-512);
+    stats->recordPendingBufferedWriteBytes(1024);
+    stats->recordPendingBufferedWriteBytes(-1024);
+    stats->recordTransactionClosed();
+  }
+  if (codes) {
+    codes->addStatus(200);
+  }
+}
+
+} // namespace
+
+BENCHMARK(PerRequestNullStats, iters) {
+  HTTPSessionStats* stats = nullptr;
+  TLResponseCodeStats* codes = nullptr;
+  folly::makeUnpredictable(stats);
+  folly::makeUnpredictable(codes);
+  for (size_t i = 0; i < iters; i++) {
+    recordRequest(stats, codes);
+  }
+}
+
+BENCHMARK_RELATIVE(PerRequestTLStats, iters) {
+  folly::BenchmarkSuspender suspender;
+  TLHTTPSessionStats stats("bench_session");
+  TLResponseCodeStats codes("bench_status_");
+  suspender.dismiss();
+  for (size_t i = 0; i < iters; i++) {
+    recordRequest(&stats, &codes);
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersViewDecoder.h>
+
+#include <folly/Conv.h>
+#include <folly/base64.h>
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersUtilities.h>
+
+namespace {
+
+// RFC 8941 Section 3.3.1 and 3.3.2
+constexpr size_t kMaxIntegerDigits = 15;
+constexpr size_t kMaxDecimalIntegerDigits = 12;
+constexpr size_t kMaxFractionDigits = 3;
+
+bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+bool isAlpha(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool isKeyChar(char c) {
+  return proxygen::StructuredHeaders::isLcAlpha(c) || isDigit(c) ||
+         c == '_' || c == '-' || c == '.' || c == '*';
+}
+
+// tchar, ":" or "/"
+bool isTokenChar(char c) {
+  if (isAlpha(c) || isDigit(c)) {
+    return true;
+  }
+  switch (c) {
+    case '!':
+    case '#':
+    case '$':
+    case '%':
+    case '&':
+    case '\'':
+    case '*':
+    case '+':
+    case '-':
+    case '.':
+    case '^':
+    case '_':
+    case '`':
+    case '|':
+    case '~':
+    case ':':
+    case '/':
+      return true;
+    default:
+      return false;
+  }
+}
+
+} // namespace
+
+namespace proxygen {
+
+using namespace StructuredHeaders;
+
+namespace StructuredHeaders {
+
+std::string ItemView::getString() const {
+  if (!escaped) {
+    return text.str();
+  }
+  std::string result;
+  result.reserve(text.size());
+  for (size_t i = 0; i < text.size(); i++) {
+    // Only \" and \\ were accepted
+    if (text[i] == '\\') {
+      i++;
+    }
+    result.push_back(text[i]);
+  }
+  return result;
+}
+
+std::string ItemView::getBinaryContent() const {
+  return folly::base64Decode(text);
+}
+
+const ItemView* findParameter(const ParametersView& params,
+                              folly::StringPiece key) {
+  for (auto it = params.rbegin(); it != params.rend(); ++it) {
+    if (it->key == key) {
+      return &it->value;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace StructuredHeaders
+
+DecodeError StructuredHeadersViewDecoder::decodeItem(MemberView& result) {
+  skipWhitespace();
+  result.isInnerList = false;
+  result.innerList.clear();
+  auto err = parseBareItem(result.item);
+  if (err == DecodeError::OK) {
+    err = parseParameters(result.params);
+  }
+  if (err != DecodeError::OK) {
+    return err;
+  }
+  skipWhitespace();
+  return content_.empty() ? DecodeError::OK : DecodeError::INVALID_CHARACTER;
+}
+
+DecodeError StructuredHeadersViewDecoder::parseDictionaryMember(
+    folly::StringPiece& key, MemberView& result) {
+  auto err = parseKey(key);
+  if (err != DecodeError::OK) {
+    return err;
+  }
+  if (!content_.empty() && content_.front() == '=') {
+    content_.advance(1);
+    return parseMember(result);
+  }
+  result.isInnerList = false;
+  result.innerList.clear();
+  result.item = ItemView();
+  result.item.tag = ItemView::Type::BOOLEAN;
+  result.item.boolean = true;
+  return parseParameters(result.params);
+}
+
+DecodeError StructuredHeadersViewDecoder::parseMember(MemberView& result) {
+  DecodeError err;
+  if (!content_.empty() && content_.front() == '(') {
+    result.isInnerList = true;
+    result.item = ItemView();
+    err = parseInnerList(result.innerList);
+  } else {
+    result.isInnerList = false;
+    result.innerList.clear();
+    err = parseBareItem(result.item);
+  }
+  if (err != DecodeError::OK) {
+    return err;
+  }
+  return parseParameters(result.params);
+}
+
+DecodeError StructuredHeadersViewDecoder::parseInnerList(
+    folly::StringPiece& result) {
+  DCHECK_EQ(content_.front(), '(');
+  content_.advance(1);
+  auto begin = content_.begin();
+  // Only validated, visitInnerList decodes the items again
+  ItemView item;
+  ParametersView params;
+  while (true) {
+    skipSpaces();
+    if (content_.empty()) {
+      return DecodeError::UNEXPECTED_END_OF_BUFFER;
+    }
+    if (content_.front() == ')') {
+      result = folly::StringPiece(begin, content_.begin());
+      content_.advance(1);
+      return DecodeError::OK;
+    }
+    auto err = parseBareItem(item);
+    if (err == DecodeError::OK) {
+      err = parseParameters(params);
+    }
+    if (err != DecodeError::OK) {
+      return err;
+    }
+    if (!content_.empty() && content_.front() != ' ' &&
+        content_.front() != ')') {
+      return DecodeError::INVALID_CHARACTER;
+    }
+  }
+}
+
+DecodeError StructuredHeadersViewDecoder::parseParameters(
+    ParametersView& result) {
+  result.clear();
+  while (!content_.empty() && content_.front() == ';') {
+    content_.advance(1);
+    skipSpaces();
+    ParameterView param;
+    auto err = parseKey(param.key);
+    if (err != DecodeError::OK) {
+      return err;
+    }
+    if (!content_.empty() && content_.front() == '=') {
+      content_.advance(1);
+      err = parseBareItem(param.value);
+      if (err != DecodeError::OK) {
+        return err;
+      }
+    } else {
+      param.value.tag = ItemView::Type::BOOLEAN;
+      param.value.boolean = true;
+    }
+    result.push_back(param);
+  }
+  return DecodeError::OK;
+}
+
+DecodeError StructuredHeadersViewDecoder::parseKey(folly::StringPiece& result) {
+  if (content_.empty()) {
+    return DecodeError::UNEXPECTED_END_OF_BUFFER;
+  }
+  if (!isLcAlpha(content_.front()) && content_.front() != '*') {
+    return DecodeError::INVALID_CHARACTER;
+  }
+  size_t len = 1;
+  while (len < content_.size() && isKeyChar(content_[len])) {
+    len++;
+  }
+  result = content_.subpiece(0, len);
+  content_.advance(len);
+  return DecodeError::OK;
+}
+
+DecodeError StructuredHeadersViewDecoder::parseBareItem(ItemView& result) {
+  result = ItemView();
+  if (content_.empty()) {
+    return DecodeError::UNEXPECTED_END_OF_BUFFER;
+  }
+  char first = content_.front();
+  if (first == '-' || isDigit(first)) {
+    return parseNumber(result);
+  } else if (first == '"') {
+    return parseString(result);
+  } else if (isAlpha(first) || first == '*') {
+    return parseToken(result);
+  } else if (first == ':') {
+    return parseByteSequence(result);
+  } else if (first == '?') {
+    return parseBoolean(result);
+  }
+  return DecodeError::INVALID_CHARACTER;
+}
+
+DecodeError StructuredHeadersViewDecoder::parseNumber(ItemView& result) {
+  size_t pos = 0;
+  bool negative = content_.front() == '-';
+  if (negative) {
+    pos++;
+  }
+  if (pos == content_.size()) {
+    return DecodeError::UNEXPECTED_END_OF_BUFFER;
+  }
+  if (!isDigit(content_[pos])) {
+    return DecodeError::INVALID_CHARACTER;
+  }
+  int64_t integer = 0;
+  size_t digits = 0;
+  while (pos < content_.size() && isDigit(content_[pos])) {
+    if (++digits > kMaxIntegerDigits) {
+      return DecodeError::VALUE_TOO_LONG;
+    }
+    integer = integer * 10 + (content_[pos] - '0');
+    pos++;
+  }
+  if (pos == content_.size() || content_[pos] != '.') {
+    result.tag = ItemView::Type::INT64;
+    result.integer = negative ? -integer : integer;
+    content_.advance(pos);
+    return DecodeError::OK;
+  }
+  if (digits > kMaxDecimalIntegerDigits) {
+    return DecodeError::VALUE_TOO_LONG;
+  }
+  pos++;
+  size_t fractionDigits = 0;
+  while (pos < content_.size() && isDigit(content_[pos])) {
+    if (++fractionDigits > kMaxFractionDigits) {
+      return DecodeError::VALUE_TOO_LONG;
+    }
+    pos++;
+  }
+  if (fractionDigits == 0) {
+    return DecodeError::INVALID_CHARACTER;
+  }
+  auto decimal = folly::tryTo<double>(content_.subpiece(0, pos));
+  if (!decimal) {
+    return DecodeError::UNPARSEABLE_NUMERIC_TYPE;
+  }
+  result.tag = ItemView::Type::DOUBLE;
+  result.decimal = *decimal;
+  content_.advance(pos);
+  return DecodeError::OK;
+}
+
+DecodeError StructuredHeadersViewDecoder::parseString(ItemView& result) {
+  for (size_t pos = 1; pos < content_.size(); pos++) {
+    char c = content_[pos];
+    if (c == '\\') {
+      pos++;
+      if (pos == content_.size()) {
+        break;
+      }
+      if (content_[pos] != '"' && content_[pos] != '\\') {
+        return DecodeError::INVALID_CHARACTER;
+      }
+      result.escaped = true;
+    } else if (c == '"') {
+      result.tag = ItemView::Type::STRING;
+      result.text = content_.subpiece(1, pos - 1);
+      content_.advance(pos + 1);
+      return DecodeError::OK;
+    } else if (!isValidStringChar(c)) {
+      return DecodeError::INVALID_CHARACTER;
+    }
+  }
+  return DecodeError::UNEXPECTED_END_OF_BUFFER;
+}
+
+DecodeError StructuredHeadersViewDecoder::parseToken(ItemView& result) {
+  size_t len = 1;
+  while (len < content_.size() && isTokenChar(content_[len])) {
+    len++;
+  }
+  result.tag = ItemView::Type::IDENTIFIER;
+  result.text = content_.subpiece(0, len);
+  content_.advance(len);
+  return DecodeError::OK;
+}
+
+DecodeError StructuredHeadersViewDecoder::parseByteSequence(ItemView& result) {
+  for (size_t pos = 1; pos < content_.size(); pos++) {
+    char c = content_[pos];
+    if (c == ':') {
+      result.tag = ItemView::Type::BINARYCONTENT;
+      result.text = content_.subpiece(1, pos - 1);
+      content_.advance(pos + 1);
+      return DecodeError::OK;
+    }
+    if (!isValidEncodedBinaryContentChar(c)) {
+      return DecodeError::INVALID_CHARACTER;
+    }
+  }
+  return DecodeError::UNEXPECTED_END_OF_BUFFER;
+}
+
+DecodeError StructuredHeadersViewDecoder::parseBoolean(ItemView& result) {
+  if (content_.size() < 2) {
+    return DecodeError::UNEXPECTED_END_OF_BUFFER;
+  }
+  char c = content_[1];
+  if (c != '0' && c != '1') {
+    return DecodeError::INVALID_CHARACTER;
+  }
+  result.tag = ItemView::Type::BOOLEAN;
+  result.boolean = c == '1';
+  content_.advance(2);
+  return DecodeError::OK;
+}
+
+void StructuredHeadersViewDecoder::skipSpaces() {
+  while (!content_.empty() && content_.front() == ' ') {
+    content_.advance(1);
+  }
+}
+
+void StructuredHeadersViewDecoder::skipWhitespace() {
+  while (!content_.empty() &&
+         (content_.front() == ' ' || content_.front() == '\t')) {
+    content_.advance(1);
+  }
+}
+
+} // namespace proxygen
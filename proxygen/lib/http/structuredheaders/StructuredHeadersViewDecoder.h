@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/small_vector.h>
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersConstants.h>
+#include <string>
+
+namespace proxygen {
+
+namespace StructuredHeaders {
+
+/*
+ * An item of a structured header, viewing the header value it was decoded
+ * from, which must outlive it.
+ */
+struct ItemView {
+  using Type = StructuredHeaderItem::Type;
+
+  // STRING: the characters between the quotes, still escaped if escaped
+  // BINARYCONTENT: the base64 between the colons
+  // IDENTIFIER: the token
+  folly::StringPiece text;
+  int64_t integer{0};
+  double decimal{0};
+  bool boolean{false};
+  bool escaped{false};
+  Type tag{Type::NONE};
+
+  // The STRING with its escapes removed, which allocates
+  std::string getString() const;
+  // The decoded BINARYCONTENT, which allocates
+  std::string getBinaryContent() const;
+};
+
+struct ParameterView {
+  folly::StringPiece key;
+  ItemView value;
+};
+
+// In order; RFC 8941 has the last of duplicate keys win
+using ParametersView = folly::small_vector<ParameterView, 4>;
+
+const ItemView* findParameter(const ParametersView& params,
+                              folly::StringPiece key);
+
+/*
+ * A member of a list or dictionary: an item or an inner list, with its
+ * parameters. The items of innerList are visited with
+ * StructuredHeadersViewDecoder(innerList).visitInnerList().
+ */
+struct MemberView {
+  ItemView item;
+  folly::StringPiece innerList;
+  bool isInnerList{false};
+  ParametersView params;
+};
+
+} // namespace StructuredHeaders
+
+/**
+ * Decodes RFC 8941 structured headers without allocating: the strings,
+ * tokens and keys passed to the visitors are views of the header value.
+ * Unlike StructuredHeadersDecoder nothing is stored, each member is passed
+ * to the visitor as it is decoded, and decode errors are left to the
+ * caller to log.
+ *
+ * With an error the visitor may have seen some of the members already.
+ */
+class StructuredHeadersViewDecoder {
+ public:
+  explicit StructuredHeadersViewDecoder(folly::StringPiece s) : content_(s) {
+  }
+
+  StructuredHeaders::DecodeError decodeItem(
+      StructuredHeaders::MemberView& result);
+
+  // fn(const MemberView&) for each member
+  template <typename Fn>
+  StructuredHeaders::DecodeError visitList(Fn&& fn) {
+    return visitMembers(
+        [&](folly::StringPiece, const auto& member) { fn(member); },
+        /*dictionary=*/false);
+  }
+
+  // fn(folly::StringPiece key, const MemberView&) for each member. Keys
+  // are not checked for duplicates, the last one would win.
+  template <typename Fn>
+  StructuredHeaders::DecodeError visitDictionary(Fn&& fn) {
+    return visitMembers(std::forward<Fn>(fn), /*dictionary=*/true);
+  }
+
+  // fn(const ItemView&, const ParametersView&) for each item of the
+  // innerList of a MemberView
+  template <typename Fn>
+  StructuredHeaders::DecodeError visitInnerList(Fn&& fn) {
+    StructuredHeaders::MemberView member;
+    skipSpaces();
+    while (!content_.empty()) {
+      auto err = parseBareItem(member.item);
+      if (err == StructuredHeaders::DecodeError::OK) {
+        err = parseParameters(member.params);
+      }
+      if (err != StructuredHeaders::DecodeError::OK) {
+        return err;
+      }
+      fn(member.item, member.params);
+      if (!content_.empty() && content_.front() != ' ') {
+        return StructuredHeaders::DecodeError::INVALID_CHARACTER;
+      }
+      skipSpaces();
+    }
+    return StructuredHeaders::DecodeError::OK;
+  }
+
+ private:
+  template <typename Fn>
+  StructuredHeaders::DecodeError visitMembers(Fn&& fn, bool dictionary) {
+    StructuredHeaders::MemberView member;
+    folly::StringPiece key;
+    skipWhitespace();
+    while (!content_.empty()) {
+      auto err = dictionary ? parseDictionaryMember(key, member)
+                            : parseMember(member);
+      if (err != StructuredHeaders::DecodeError::OK) {
+        return err;
+      }
+      fn(key, member);
+      skipWhitespace();
+      if (content_.empty()) {
+        return StructuredHeaders::DecodeError::OK;
+      }
+      if (content_.front() != ',') {
+        return StructuredHeaders::DecodeError::INVALID_CHARACTER;
+      }
+      content_.advance(1);
+      skipWhitespace();
+      if (content_.empty()) {
+        // Trailing comma
+        return StructuredHeaders::DecodeError::UNEXPECTED_END_OF_BUFFER;
+      }
+    }
+    return StructuredHeaders::DecodeError::OK;
+  }
+
+  StructuredHeaders::DecodeError parseDictionaryMember(
+      folly::StringPiece& key, StructuredHeaders::MemberView& result);
+  StructuredHeaders::DecodeError parseMember(
+      StructuredHeaders::MemberView& result);
+  StructuredHeaders::DecodeError parseInnerList(folly::StringPiece& result);
+  StructuredHeaders::DecodeError parseParameters(
+      StructuredHeaders::ParametersView& result);
+  StructuredHeaders::DecodeError parseKey(folly::StringPiece& result);
+  StructuredHeaders::DecodeError parseBareItem(
+      StructuredHeaders::ItemView& result);
+  StructuredHeaders::DecodeError parseNumber(
+      StructuredHeaders::ItemView& result);
+  StructuredHeaders::DecodeError parseString(
+      StructuredHeaders::ItemView& result);
+  StructuredHeaders::DecodeError parseToken(
+      StructuredHeaders::ItemView& result);
+  StructuredHeaders::DecodeError parseByteSequence(
+      StructuredHeaders::ItemView& result);
+  StructuredHeaders::DecodeError parseBoolean(
+      StructuredHeaders::ItemView& result);
+
+  // SP only, within inner lists and parameters
+  void skipSpaces();
+  // SP and HTAB, around the members of lists and dictionaries
+  void skipWhitespace();
+
+  folly::StringPiece content_;
+};
+
+} // namespace proxygen
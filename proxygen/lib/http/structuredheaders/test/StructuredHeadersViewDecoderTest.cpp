@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/structuredheaders/StructuredHeadersViewDecoder.h>
+
+#include <folly/portability/GTest.h>
+#include <string>
+
+namespace proxygen {
+
+using namespace StructuredHeaders;
+
+class StructuredHeadersViewDecoderTest : public testing::Test {};
+
+TEST_F(StructuredHeadersViewDecoderTest, TestItem) {
+  std::string input = "645643;a=1;b";
+  StructuredHeadersViewDecoder decoder(input);
+  MemberView member;
+  EXPECT_EQ(decoder.decodeItem(member), DecodeError::OK);
+  EXPECT_EQ(member.item.tag, ItemView::Type::INT64);
+  EXPECT_EQ(member.item.integer, 645643);
+  ASSERT_EQ(member.params.size(), 2);
+  EXPECT_EQ(member.params[0].key, "a");
+  EXPECT_EQ(member.params[0].value.integer, 1);
+  auto b = findParameter(member.params, "b");
+  ASSERT_NE(b, nullptr);
+  EXPECT_EQ(b->tag, ItemView::Type::BOOLEAN);
+  EXPECT_TRUE(b->boolean);
+  EXPECT_EQ(findParameter(member.params, "c"), nullptr);
+}
+
+TEST_F(StructuredHeadersViewDecoderTest, TestBareItems) {
+  std::string input =
+      "\"a \\\"quoted\\\" str\", -3.14, ?0, foo/bar, :aGVsbG8=:, *tok";
+  StructuredHeadersViewDecoder decoder(input);
+  std::vector<ItemView> items;
+  auto err = decoder.visitList(
+      [&](const MemberView& member) { items.push_back(member.item); });
+  EXPECT_EQ(err, DecodeError::OK);
+  ASSERT_EQ(items.size(), 6);
+  EXPECT_EQ(items[0].tag, ItemView::Type::STRING);
+  EXPECT_TRUE(items[0].escaped);
+  EXPECT_EQ(items[0].getString(), "a \"quoted\" str");
+  // A view of the input
+  EXPECT_GE(items[0].text.begin(), input.data());
+  EXPECT_LE(items[0].text.end(), input.data() + input.size());
+  EXPECT_EQ(items[1].tag, ItemView::Type::DOUBLE);
+  EXPECT_DOUBLE_EQ(items[1].decimal, -3.14);
+  EXPECT_EQ(items[2].tag, ItemView::Type::BOOLEAN);
+  EXPECT_FALSE(items[2].boolean);
+  EXPECT_EQ(items[3].tag, ItemView::Type::IDENTIFIER);
+  EXPECT_EQ(items[3].text, "foo/bar");
+  EXPECT_EQ(items[4].tag, ItemView::Type::BINARYCONTENT);
+  EXPECT_EQ(items[4].getBinaryContent(), "hello");
+  EXPECT_EQ(items[5].text, "*tok");
+}
+
+TEST_F(StructuredHeadersViewDecoderTest, TestDictionary) {
+  std::string input = "u=3, i, o=100;x=?1,  l=(1 \"two\";p three)";
+  StructuredHeadersViewDecoder decoder(input);
+  std::vector<std::string> keys;
+  folly::StringPiece innerList;
+  EXPECT_EQ(decoder.visitDictionary(
+                [&](folly::StringPiece key, const MemberView& member) {
+                  keys.push_back(key.str());
+                  if (key == "i") {
+                    EXPECT_EQ(member.item.tag, ItemView::Type::BOOLEAN);
+                    EXPECT_TRUE(member.item.boolean);
+                  } else if (key == "o") {
+                    EXPECT_EQ(member.item.integer, 100);
+                    EXPECT_NE(findParameter(member.params, "x"), nullptr);
+                  } else if (key == "l") {
+                    EXPECT_TRUE(member.isInnerList);
+                    innerList = member.innerList;
+                  }
+                }),
+            DecodeError::OK);
+  EXPECT_EQ(keys, (std::vector<std::string>{"u", "i", "o", "l"}));
+
+  std::vector<std::string> inner;
+  StructuredHeadersViewDecoder innerDecoder(innerList);
+  EXPECT_EQ(innerDecoder.visitInnerList(
+                [&](const ItemView& item, const ParametersView& params) {
+                  inner.push_back(item.tag == ItemView::Type::INT64
+                                      ? folly::to<std::string>(item.integer)
+                                      : item.text.str());
+                  if (item.text == "two") {
+                    EXPECT_NE(findParameter(params, "p"), nullptr);
+                  }
+                }),
+            DecodeError::OK);
+  EXPECT_EQ(inner, (std::vector<std::string>{"1", "two", "three"}));
+}
+
+TEST_F(StructuredHeadersViewDecoderTest, TestErrors) {
+  for (std::string input : {"u=3,",
+                            "u=3 i",
+                            "U=3",
+                            "u=\"unterminated",
+                            "u=?2",
+                            "u=1234567890123456",
+                            "u=1.2345",
+                            "u=1.",
+                            "l=(1 2",
+                            "u=:not base64!:"}) {
+    StructuredHeadersViewDecoder decoder(input);
+    EXPECT_NE(decoder.visitDictionary([](folly::StringPiece,
+                                         const MemberView&) {}),
+              DecodeError::OK)
+        << input;
+  }
+}
+
+TEST_F(StructuredHeadersViewDecoderTest, TestEmpty) {
+  std::string input = "   ";
+  StructuredHeadersViewDecoder decoder(input);
+  size_t members = 0;
+  EXPECT_EQ(decoder.visitList([&](const MemberView&) { members++; }),
+            DecodeError::OK);
+  EXPECT_EQ(members, 0);
+}
+
+} // namespace proxygen
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/AltSvc.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+
+TEST(AltSvcTest, Parse) {
+  auto services =
+      parseAltSvc("h3=\":443\"; ma=3600, h2=\"alt.test:8443\"; persist=1, "
+                  "h3-29=\"[::1]:4433\"");
+  ASSERT_EQ(services.size(), 3);
+  EXPECT_EQ(services[0].protocolId, "h3");
+  EXPECT_EQ(services[0].host, "");
+  EXPECT_EQ(services[0].port, 443);
+  EXPECT_EQ(services[0].maxAge, std::chrono::seconds(3600));
+  EXPECT_FALSE(services[0].persist);
+  EXPECT_EQ(services[1].host, "alt.test");
+  EXPECT_EQ(services[1].port, 8443);
+  EXPECT_EQ(services[1].maxAge, AltSvc::kDefaultMaxAge);
+  EXPECT_TRUE(services[1].persist);
+  EXPECT_EQ(services[2].protocolId, "h3-29");
+  EXPECT_EQ(services[2].host, "::1");
+  EXPECT_EQ(services[2].port, 4433);
+}
+
+TEST(AltSvcTest, Malformed) {
+  EXPECT_TRUE(parseAltSvc("clear").empty());
+  EXPECT_TRUE(parseAltSvc("").empty());
+  // The invalid alternatives are skipped
+  auto services = parseAltSvc(
+      "h3, h3=\"host\", h3=\":0\", h3=\":443\"; ma=soon, h2=\":443\"");
+  ASSERT_EQ(services.size(), 1);
+  EXPECT_EQ(services[0].protocolId, "h2");
+  // Percent encoded protocol ids
+  services = parseAltSvc("w%3Dx%3Ay=\":80\"");
+  ASSERT_EQ(services.size(), 1);
+  EXPECT_EQ(services[0].protocolId, "w=x:y");
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/CompactHTTPHeaders.h>
+
+using namespace proxygen;
+
+TEST(CompactHTTPHeadersTest, AddAndLookup) {
+  CompactHTTPHeaders headers;
+  headers.add(HTTP_HEADER_HOST, "www.facebook.com");
+  headers.add("X-Custom", "  padded value\t");
+  headers.add("accept", "a");
+  headers.add("Accept", "b");
+
+  EXPECT_EQ(headers.size(), 4);
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_HOST), "www.facebook.com");
+  EXPECT_EQ(headers.getSingleOrEmpty("host"), "www.facebook.com");
+  EXPECT_EQ(headers.getSingleOrEmpty("x-custom"), "padded value");
+  EXPECT_TRUE(headers.exists("X-CUSTOM"));
+  EXPECT_FALSE(headers.exists("X-Other"));
+  EXPECT_EQ(headers.getNumberOfValues(HTTP_HEADER_ACCEPT), 2);
+  // Multiple values means no single value
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_ACCEPT), "");
+}
+
+TEST(CompactHTTPHeadersTest, ForEachPreservesOrderAndCase) {
+  CompactHTTPHeaders headers;
+  headers.add("x-lower", "1");
+  headers.add(HTTP_HEADER_CONTENT_TYPE, "text/plain");
+  headers.add("X-Upper", "2");
+
+  std::vector<std::pair<std::string, std::string>> seen;
+  headers.forEach([&](folly::StringPiece name, folly::StringPiece value) {
+    seen.emplace_back(name.str(), value.str());
+  });
+  std::vector<std::pair<std::string, std::string>> expected{
+      {"x-lower", "1"}, {"Content-Type", "text/plain"}, {"X-Upper", "2"}};
+  EXPECT_EQ(seen, expected);
+}
+
+TEST(CompactHTTPHeadersTest, RemoveAndCopy) {
+  CompactHTTPHeaders headers;
+  headers.add(HTTP_HEADER_HOST, "h");
+  headers.add("X-A", "a");
+  headers.add("X-B", "b");
+  EXPECT_TRUE(headers.remove("x-a"));
+  EXPECT_FALSE(headers.remove("x-a"));
+  EXPECT_TRUE(headers.remove(HTTP_HEADER_HOST));
+  EXPECT_EQ(headers.size(), 1);
+
+  // Copying drops the bytes of removed headers
+  CompactHTTPHeaders copy(headers);
+  EXPECT_EQ(copy.size(), 1);
+  EXPECT_EQ(copy.getSingleOrEmpty("X-B"), "b");
+  EXPECT_LT(copy.bytesUsed(), headers.bytesUsed());
+
+  CompactHTTPHeaders assigned;
+  assigned.add("X-C", "c");
+  assigned = copy;
+  EXPECT_FALSE(assigned.exists("X-C"));
+  EXPECT_EQ(assigned.getSingleOrEmpty("X-B"), "b");
+
+  headers.removeAll();
+  EXPECT_EQ(headers.size(), 0);
+  EXPECT_EQ(headers.bytesUsed(), 0);
+}
+
+TEST(CompactHTTPHeadersTest, ConvertFromAndToHTTPHeaders) {
+  HTTPHeaders original;
+  original.add(HTTP_HEADER_USER_AGENT, "curl");
+  original.add("X-Custom", "custom");
+  original.add(HTTP_HEADER_COOKIE, std::string(1024, 'c'));
+
+  CompactHTTPHeaders compact(original);
+  EXPECT_EQ(compact.size(), 3);
+  EXPECT_EQ(compact.getSingleOrEmpty(HTTP_HEADER_COOKIE).size(), 1024);
+
+  HTTPHeaders roundTrip;
+  compact.copyTo(roundTrip);
+  EXPECT_EQ(roundTrip.size(), 3);
+  EXPECT_EQ(roundTrip.getSingleOrEmpty(HTTP_HEADER_USER_AGENT), "curl");
+  EXPECT_EQ(roundTrip.getSingleOrEmpty("x-custom"), "custom");
+  EXPECT_EQ(roundTrip.getSingleOrEmpty(HTTP_HEADER_COOKIE),
+            std::string(1024, 'c'));
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/DecompressionMessageFilter.h>
+#include <proxygen/lib/http/test/MockHTTPMessageFilter.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+std::unique_ptr<folly::IOBuf> gzip(const std::string& body) {
+  ZlibStreamCompressor compressor(CompressionType::GZIP, 6);
+  auto in = folly::IOBuf::copyBuffer(body);
+  return compressor.compress(in.get(), true);
+}
+
+std::unique_ptr<HTTPMessage> makeRequest(const std::string& encoding,
+                                         size_t length) {
+  auto msg = std::make_unique<HTTPMessage>();
+  msg->setMethod(HTTPMethod::POST);
+  msg->setURL("/upload");
+  msg->getHeaders().set(HTTP_HEADER_CONTENT_ENCODING, encoding);
+  msg->getHeaders().set(HTTP_HEADER_CONTENT_LENGTH,
+                        folly::to<std::string>(length));
+  return msg;
+}
+
+std::string toString(std::unique_ptr<folly::IOBuf> buf) {
+  return buf ? buf->moveToFbString().toStdString() : "";
+}
+
+} // namespace
+
+class DecompressionMessageFilterTest : public Test {
+ protected:
+  void SetUp() override {
+    next_.setTrackDataPassedThrough(true);
+    recreate();
+  }
+
+  void recreate() {
+    filter_ = std::make_unique<DecompressionMessageFilter>(options_);
+    filter_->setPrevFilter(&prev_);
+    filter_->setNextTransactionHandler(&next_);
+  }
+
+  BodyDecompressor::Options options_;
+  MockHTTPMessageFilter prev_;
+  MockHTTPMessageFilter next_;
+  std::unique_ptr<DecompressionMessageFilter> filter_;
+};
+
+TEST_F(DecompressionMessageFilterTest, DecodesGzipBody) {
+  std::string body(10000, 'a');
+  auto encoded = gzip(body);
+  EXPECT_CALL(next_, onHeadersComplete(_))
+      .WillOnce(Invoke([](std::shared_ptr<HTTPMessage> msg) {
+        EXPECT_FALSE(
+            msg->getHeaders().exists(HTTP_HEADER_CONTENT_ENCODING));
+        EXPECT_FALSE(msg->getHeaders().exists(HTTP_HEADER_CONTENT_LENGTH));
+      }));
+  filter_->onHeadersComplete(
+      makeRequest("gzip", encoded->computeChainDataLength()));
+
+  EXPECT_CALL(next_, onChunkHeader(_)).Times(0);
+  EXPECT_CALL(next_, onBody(_)).Times(AtLeast(1));
+  EXPECT_CALL(next_, onEOM());
+  filter_->onChunkHeader(encoded->computeChainDataLength());
+  filter_->onBody(std::move(encoded));
+  filter_->onChunkComplete();
+  filter_->onEOM();
+  EXPECT_EQ(body, toString(next_.bodyDataSinceLastCheck()));
+}
+
+TEST_F(DecompressionMessageFilterTest, PassesThroughIdentity) {
+  auto msg = makeRequest("identity", 5);
+  EXPECT_CALL(next_, onHeadersComplete(_))
+      .WillOnce(Invoke([](std::shared_ptr<HTTPMessage> msg) {
+        EXPECT_TRUE(msg->getHeaders().exists(HTTP_HEADER_CONTENT_ENCODING));
+      }));
+  filter_->onHeadersComplete(std::move(msg));
+  EXPECT_EQ(filter_->getDecompressor(), nullptr);
+
+  EXPECT_CALL(next_, onBody(_));
+  EXPECT_CALL(next_, onEOM());
+  filter_->onBody(folly::IOBuf::copyBuffer("hello"));
+  filter_->onEOM();
+  EXPECT_EQ("hello", toString(next_.bodyDataSinceLastCheck()));
+}
+
+TEST_F(DecompressionMessageFilterTest, PausesWithBufferedInput) {
+  options_.inputStepBytes = 16;
+  recreate();
+  std::string body;
+  for (int i = 0; i < 2000; i++) {
+    body += folly::to<std::string>(i);
+  }
+  auto encoded = gzip(body);
+  EXPECT_CALL(next_, onHeadersComplete(_));
+  filter_->onHeadersComplete(
+      makeRequest("gzip", encoded->computeChainDataLength()));
+
+  // The next handler pauses on the first body, the rest waits for resume
+  EXPECT_CALL(prev_, pause());
+  EXPECT_CALL(next_, onBody(_))
+      .WillOnce(Invoke(
+          [this](std::shared_ptr<folly::IOBuf>) { filter_->pause(); }));
+  filter_->onBody(std::move(encoded));
+  EXPECT_CALL(next_, onEOM()).Times(0);
+  filter_->onEOM();
+  Mock::VerifyAndClearExpectations(&next_);
+
+  EXPECT_CALL(next_, onBody(_)).Times(AtLeast(1));
+  EXPECT_CALL(next_, onEOM());
+  EXPECT_CALL(prev_, resume(0));
+  filter_->resume(0);
+  EXPECT_EQ(body, toString(next_.bodyDataSinceLastCheck()));
+}
+
+TEST_F(DecompressionMessageFilterTest, DefersTrailers) {
+  auto encoded = gzip("hello");
+  EXPECT_CALL(next_, onHeadersComplete(_));
+  filter_->onHeadersComplete(
+      makeRequest("gzip", encoded->computeChainDataLength()));
+
+  InSequence seq;
+  EXPECT_CALL(next_, onBody(_));
+  EXPECT_CALL(next_, onTrailers(_));
+  EXPECT_CALL(next_, onEOM());
+  filter_->onBody(std::move(encoded));
+  filter_->onTrailers(std::make_unique<HTTPHeaders>());
+  filter_->onEOM();
+}
+
+TEST_F(DecompressionMessageFilterTest, RejectsCorruptBody) {
+  EXPECT_CALL(next_, onHeadersComplete(_));
+  filter_->onHeadersComplete(makeRequest("gzip", 20));
+  EXPECT_CALL(next_, onError(_)).WillOnce(Invoke([](const HTTPException& ex) {
+    EXPECT_EQ(ex.getHttpStatusCode(), 400);
+    EXPECT_EQ(ex.getProxygenError(), kErrorParseBody);
+  }));
+  EXPECT_CALL(next_, onBody(_)).Times(0);
+  EXPECT_CALL(next_, onEOM()).Times(0);
+  filter_->onBody(folly::IOBuf::copyBuffer("this is not gzip data"));
+  filter_->onEOM();
+}
+
+TEST_F(DecompressionMessageFilterTest, RejectsTruncatedBody) {
+  auto encoded = gzip(std::string(1000, 'x'));
+  encoded->coalesce();
+  encoded->trimEnd(10);
+  EXPECT_CALL(next_, onHeadersComplete(_));
+  filter_->onHeadersComplete(
+      makeRequest("gzip", encoded->computeChainDataLength()));
+  EXPECT_CALL(next_, onBody(_)).Times(AnyNumber());
+  EXPECT_CALL(next_, onError(_)).WillOnce(Invoke([](const HTTPException& ex) {
+    EXPECT_EQ(ex.getHttpStatusCode(), 400);
+  }));
+  EXPECT_CALL(next_, onEOM()).Times(0);
+  filter_->onBody(std::move(encoded));
+  filter_->onEOM();
+}
+
+TEST_F(DecompressionMessageFilterTest, RejectsTooLarge) {
+  options_.maxDecompressedBytes = 4096;
+  recreate();
+  auto encoded = gzip(std::string(100000, 'x'));
+  EXPECT_CALL(next_, onHeadersComplete(_));
+  filter_->onHeadersComplete(
+      makeRequest("gzip", encoded->computeChainDataLength()));
+  EXPECT_CALL(next_, onBody(_)).Times(AnyNumber());
+  EXPECT_CALL(next_, onError(_)).WillOnce(Invoke([](const HTTPException& ex) {
+    EXPECT_EQ(ex.getHttpStatusCode(), 413);
+  }));
+  EXPECT_CALL(next_, onEOM()).Times(0);
+  filter_->onBody(std::move(encoded));
+  filter_->onEOM();
+  EXPECT_EQ(filter_->getDecompressor()->getError(),
+            BodyDecompressor::Error::TOO_LARGE);
+  // Stopped one byte past the limit rather than after the whole step
+  EXPECT_EQ(filter_->getDecompressor()->getDecompressedBytes(), 4097);
+}
+
+TEST_F(DecompressionMessageFilterTest, RejectsHighRatio) {
+  options_.maxDecompressedBytes = 0;
+  options_.maxRatio = 50;
+  options_.ratioCheckMinBytes = 64 * 1024;
+  recreate();
+  // Zeros compress about a thousand to one
+  auto encoded = gzip(std::string(4 * 1024 * 1024, '\0'));
+  EXPECT_CALL(next_, onHeadersComplete(_));
+  filter_->onHeadersComplete(
+      makeRequest("gzip", encoded->computeChainDataLength()));
+  EXPECT_CALL(next_, onBody(_)).Times(AnyNumber());
+  EXPECT_CALL(next_, onError(_)).WillOnce(Invoke([](const HTTPException& ex) {
+    EXPECT_EQ(ex.getHttpStatusCode(), 413);
+  }));
+  filter_->onBody(std::move(encoded));
+  EXPECT_EQ(filter_->getDecompressor()->getError(),
+            BodyDecompressor::Error::RATIO);
+  auto decompressor = filter_->getDecompressor();
+  EXPECT_LE(decompressor->getDecompressedBytes(),
+            std::max<uint64_t>(options_.ratioCheckMinBytes,
+                               50 * decompressor->getCompressedBytes()) +
+                1);
+}
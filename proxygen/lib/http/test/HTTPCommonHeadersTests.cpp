@@ -8,6 +8,8 @@
 
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
+#include <proxygen/lib/http/HTTPHeaders.h>
+#include <proxygen/lib/http/codec/compress/HPACKHeaderName.h>
 
 using namespace proxygen;
 
@@ -84,3 +86,48 @@ TEST_F(HTTPCommonHeadersTests, TestGetHeaderCodeFromTableCommonHeaderName) {
               HTTPCommonHeaders::getCodeFromTableName(
                   &externalHeader, HTTPCommonHeaderTableType::TABLE_CAMELCASE));
 }
+
+TEST_F(HTTPCommonHeadersTests, TestExtensions) {
+  // Extensions are process-wide, so this is the only test registering any
+  auto code = HTTPCommonHeaders::registerExtension("X-Proxygen-Test-Ext");
+  EXPECT_TRUE(HTTPCommonHeaders::isExtension(code));
+  EXPECT_EQ(HTTPCommonHeaders::registerExtension("x-proxygen-test-ext"), code);
+  // Generated names keep their codes
+  EXPECT_EQ(HTTPCommonHeaders::registerExtension("Content-Length"),
+            HTTP_HEADER_CONTENT_LENGTH);
+  // Not visible until frozen
+  EXPECT_EQ(HTTPCommonHeaders::hash("X-Proxygen-Test-Ext"), HTTP_HEADER_OTHER);
+  HTTPCommonHeaders::freezeExtensions();
+
+  EXPECT_EQ(HTTPCommonHeaders::hash("X-PROXYGEN-TEST-EXT"), code);
+  EXPECT_EQ(HTTPCommonHeaders::hash("X-Proxygen-Test-Other"),
+            HTTP_HEADER_OTHER);
+  EXPECT_EQ(*HTTPCommonHeaders::getPointerToName(code), "X-Proxygen-Test-Ext");
+  EXPECT_EQ(*HTTPCommonHeaders::getPointerToName(
+                code, HTTPCommonHeaderTableType::TABLE_LOWERCASE),
+            "x-proxygen-test-ext");
+  EXPECT_EQ(HTTPCommonHeaders::getCodeFromTableName(
+                HTTPCommonHeaders::getPointerToName(code),
+                HTTPCommonHeaderTableType::TABLE_CAMELCASE),
+            code);
+
+  // HTTPHeaders looks the extension up by code
+  HTTPHeaders headers;
+  headers.add("x-proxygen-test-ext", "1");
+  EXPECT_TRUE(headers.exists(code));
+  EXPECT_EQ(headers.getSingleOrEmpty(code), "1");
+  headers.forEachWithCode(
+      [&](HTTPHeaderCode c, const std::string& name, const std::string&) {
+        EXPECT_EQ(c, code);
+        EXPECT_EQ(name, "X-Proxygen-Test-Ext");
+      });
+
+  // HPACKHeaderName points into the table, and still orders by value
+  HPACKHeaderName extName("X-Proxygen-Test-Ext");
+  EXPECT_TRUE(extName.isCommonHeader());
+  EXPECT_EQ(extName.getHeaderCode(), code);
+  HPACKHeaderName accept(HTTP_HEADER_ACCEPT);
+  HPACKHeaderName zzz("zzz-uncommon");
+  EXPECT_LT(accept, extName);
+  EXPECT_LT(extName, zzz);
+}
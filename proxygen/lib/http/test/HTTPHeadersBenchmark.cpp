@@ -8,6 +8,8 @@
 
 #include <algorithm>
 #include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <proxygen/lib/http/CompactHTTPHeaders.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 #include <proxygen/lib/http/HTTPHeaders.h>
 
@@ -153,6 +155,118 @@ BENCHMARK(addCode24_headers_32_length, iters) {
   addCodeBench(24, 32, iters);
 }
 
+HTTPHeaders makeProxyHeaders(int nHeaders, int hdrSize) {
+  HTTPHeaders headers;
+  std::string value(hdrSize, 'a');
+  for (int j = 0; j < nHeaders; ++j) {
+    if (j % 4 == 0) {
+      headers.add(folly::to<std::string>("X-Custom-", j), value);
+    } else {
+      headers.add(testHeaderCodes[j % testHeaderCodes.size()], value);
+    }
+  }
+  return headers;
+}
+
+template <typename T>
+void copyBench(const T& headers, int iters) {
+  for (int i = 0; i < iters; ++i) {
+    T copy(headers);
+    folly::doNotOptimizeAway(copy.size());
+  }
+}
+
+BENCHMARK(copyHTTPHeaders20_headers_40_length, iters) {
+  HTTPHeaders headers;
+  BENCHMARK_SUSPEND {
+    headers = makeProxyHeaders(20, 40);
+  }
+  copyBench(headers, iters);
+}
+
+BENCHMARK_RELATIVE(copyCompactHTTPHeaders20_headers_40_length, iters) {
+  CompactHTTPHeaders headers;
+  BENCHMARK_SUSPEND {
+    headers = CompactHTTPHeaders(makeProxyHeaders(20, 40));
+  }
+  copyBench(headers, iters);
+}
+
+// A client request with hop-by-hop headers, stripped and re-headed as a
+// proxy forwards it
+void stripAndForwardBench(int nHeaders, int iters) {
+  HTTPHeaders request;
+  BENCHMARK_SUSPEND {
+    request = makeProxyHeaders(nHeaders, 40);
+    request.add(HTTP_HEADER_CONNECTION, "keep-alive, X-Hop-1, X-Hop-2");
+    request.add(HTTP_HEADER_KEEP_ALIVE, "timeout=5");
+    request.add(HTTP_HEADER_TE, "trailers");
+    request.add("X-Hop-1", "1");
+    request.add("X-Hop-2", "2");
+    request.add(HTTP_HEADER_UPGRADE, "websocket");
+  }
+  for (int i = 0; i < iters; ++i) {
+    HTTPHeaders headers(request);
+    HTTPHeaders stripped;
+    headers.stripPerHopHeaders(stripped, false, nullptr);
+    headers.add(HTTP_HEADER_VIA, "1.1 proxy");
+    headers.add(HTTP_HEADER_X_FORWARDED_FOR, "127.0.0.1");
+    headers.add(HTTP_HEADER_CONNECTION, "keep-alive");
+    folly::doNotOptimizeAway(headers.getSingleOrEmpty("x-custom-0"));
+  }
+}
+
+BENCHMARK(stripAndForward10_headers, iters) {
+  stripAndForwardBench(10, iters);
+}
+
+BENCHMARK(stripAndForward30_headers, iters) {
+  stripAndForwardBench(30, iters);
+}
+
+// Headers rewritten in place, each set() removing the previous value
+void setRepeatedlyBench(int nHeaders, int iters) {
+  HTTPHeaders headers;
+  BENCHMARK_SUSPEND {
+    headers = makeProxyHeaders(nHeaders, 40);
+  }
+  std::string value(40, 'b');
+  for (int i = 0; i < iters; ++i) {
+    headers.set(HTTP_HEADER_VIA, value);
+    headers.set("X-Rewritten", value);
+    folly::doNotOptimizeAway(headers.exists(HTTP_HEADER_HOST));
+  }
+}
+
+BENCHMARK(setRepeatedly10_headers, iters) {
+  setRepeatedlyBench(10, iters);
+}
+
+BENCHMARK(setRepeatedly30_headers, iters) {
+  setRepeatedlyBench(30, iters);
+}
+
+// String lookups of uncommon headers, matched case insensitively
+void getOtherBench(int nHeaders, int iters) {
+  HTTPHeaders headers;
+  std::string name;
+  BENCHMARK_SUSPEND {
+    headers = makeProxyHeaders(nHeaders, 40);
+    name = folly::to<std::string>("x-custom-", (nHeaders - 1) / 4 * 4);
+  }
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(headers.getSingleOrEmpty(name));
+  }
+}
+
+BENCHMARK(getOther10_headers, iters) {
+  getOtherBench(10, iters);
+}
+
+BENCHMARK(getOther30_headers, iters) {
+  getOtherBench(30, iters);
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
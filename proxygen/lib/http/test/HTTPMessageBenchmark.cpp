@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <folly/Benchmark.h>
+#include <new>
+#include <proxygen/lib/http/HTTPMessage.h>
+
+using namespace proxygen;
+
+// Reports the memory an in-flight transaction holds in its request and
+// response messages: bytes_per_txn is sizeof() both plus what they allocate.
+//
+// ./http_message_benchmark -bm_min_iters 1000
+
+namespace {
+
+std::atomic<int64_t> allocatedBytes{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+  // Ahead of the block, so that delete knows how much it frees
+  auto block = static_cast<size_t*>(std::malloc(size + sizeof(size_t)));
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  *block = size;
+  allocatedBytes += size;
+  return block + 1;
+}
+
+void operator delete(void* ptr) noexcept {
+  if (ptr) {
+    auto block = static_cast<size_t*>(ptr) - 1;
+    allocatedBytes -= *block;
+    std::free(block);
+  }
+}
+
+void operator delete(void* ptr, size_t /*size*/) noexcept {
+  operator delete(ptr);
+}
+
+namespace {
+
+constexpr size_t kInFlight = 1000;
+
+HTTPMessage makeRequest() {
+  static const folly::SocketAddress clientAddr("10.0.0.1", 45678);
+  static const folly::SocketAddress dstAddr("10.0.0.2", 443);
+  HTTPMessage request;
+  request.setMethod(HTTPMethod::GET);
+  request.setURL("/path/to/resource?id=12345&lang=en");
+  request.setHTTPVersion(1, 1);
+  request.setClientAddress(clientAddr);
+  request.setDstAddress(dstAddr);
+  auto& headers = request.getHeaders();
+  headers.add(HTTP_HEADER_HOST, "www.example.com");
+  headers.add(HTTP_HEADER_USER_AGENT, "Mozilla/5.0 (X11; Linux x86_64)");
+  headers.add(HTTP_HEADER_ACCEPT, "*/*");
+  headers.add(HTTP_HEADER_ACCEPT_ENCODING, "gzip, deflate, br");
+  return request;
+}
+
+HTTPMessage makeResponse() {
+  HTTPMessage response;
+  response.setStatusCode(200);
+  response.setStatusMessage("OK");
+  response.setHTTPVersion(1, 1);
+  auto& headers = response.getHeaders();
+  headers.add(HTTP_HEADER_CONTENT_TYPE, "text/html");
+  headers.add(HTTP_HEADER_CONTENT_LENGTH, "1024");
+  return response;
+}
+
+// What a server reads off each request
+void touchRequest(const HTTPMessage& request) {
+  folly::doNotOptimizeAway(request.getClientIP());
+  folly::doNotOptimizeAway(request.getVersionString());
+  folly::doNotOptimizeAway(request.getQueryParam("id"));
+}
+
+void inFlightBench(folly::UserCounters& counters, size_t iters, bool touch) {
+  std::vector<std::pair<HTTPMessage, HTTPMessage>> txns;
+  int64_t bytes = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    BENCHMARK_SUSPEND {
+      txns.clear();
+      txns.reserve(kInFlight);
+    }
+    auto before = allocatedBytes.load();
+    for (size_t j = 0; j < kInFlight; ++j) {
+      txns.emplace_back(makeRequest(), makeResponse());
+      if (touch) {
+        touchRequest(txns.back().first);
+      }
+    }
+    bytes = allocatedBytes.load() - before;
+  }
+  counters["bytes_per_txn"] = static_cast<int64_t>(2 * sizeof(HTTPMessage)) +
+                              bytes / static_cast<int64_t>(kInFlight);
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(inFlightTransactions, counters, iters) {
+  inFlightBench(counters, iters, false);
+}
+
+BENCHMARK_COUNTERS(inFlightTransactionsRead, counters, iters) {
+  inFlightBench(counters, iters, true);
+}
+
+BENCHMARK(copyRequest, iters) {
+  HTTPMessage request;
+  BENCHMARK_SUSPEND {
+    request = makeRequest();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    HTTPMessage copy(request);
+    folly::doNotOptimizeAway(copy.getURL().size());
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  LOG(INFO) << "sizeof(HTTPMessage) = " << sizeof(HTTPMessage);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -6,6 +6,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cctype>
 #include <proxygen/lib/http/HTTPMessageFilters.h>
 #include <proxygen/lib/http/session/test/HTTPTransactionMocks.h>
 #include <proxygen/lib/http/sink/HTTPTransactionSink.h>
@@ -117,6 +118,71 @@ TEST(HTTPMessageFilter, TestFilterOnBodyDataTracking) {
   EXPECT_EQ(bodyContent, std::string(p, len));
 }
 
+class HeaderOnlyFilter : public TestFilter {
+ public:
+  BodyMode getBodyMode() const noexcept override {
+    return BodyMode::HEADER_ONLY;
+  }
+  // Only to check that the body path skips it
+  void onBody(std::unique_ptr<folly::IOBuf> chain) noexcept override {
+    bodyCalls++;
+    nextOnBody(std::move(chain));
+  }
+  size_t bodyCalls{0};
+};
+
+class UpperCaseFilter : public TestFilter {
+ public:
+  BodyMode getBodyMode() const noexcept override {
+    return BodyMode::IN_PLACE;
+  }
+  void transformBody(folly::IOBuf& chain) noexcept override {
+    transforms++;
+    for (auto& range : chain) {
+      auto data = const_cast<uint8_t*>(range.data());
+      for (size_t i = 0; i < range.size(); i++) {
+        data[i] = toupper(data[i]);
+      }
+    }
+  }
+  size_t transforms{0};
+};
+
+TEST(HTTPMessageFilter, TestFilterBodyPath) {
+  //                 next                next                next
+  // upperCase1 -----> headerOnly -----> upperCase2 -----> mockFilter
+  UpperCaseFilter upperCase1;
+  HeaderOnlyFilter headerOnly;
+  UpperCaseFilter upperCase2;
+  MockHTTPMessageFilter mockFilter;
+  mockFilter.setTrackDataPassedThrough(true);
+
+  // Linked from the head, before the prev pointers
+  upperCase1.setNextTransactionHandler(&headerOnly);
+  headerOnly.setNextTransactionHandler(&upperCase2);
+  upperCase2.setNextTransactionHandler(&mockFilter);
+  headerOnly.setPrevFilter(&upperCase1);
+  upperCase2.setPrevFilter(&headerOnly);
+  mockFilter.setPrevFilter(&upperCase2);
+
+  auto body = folly::IOBuf::copyBuffer("hello");
+  body->prependChain(folly::IOBuf::copyBuffer(" world"));
+  auto shared = body->clone();
+
+  EXPECT_CALL(mockFilter, onBody(testing::_));
+  EXPECT_CALL(mockFilter, onChunkComplete());
+  upperCase1.onBody(std::move(body));
+  upperCase1.onChunkComplete();
+
+  EXPECT_EQ(headerOnly.bodyCalls, 0);
+  EXPECT_EQ(upperCase1.transforms, 1);
+  EXPECT_EQ(upperCase2.transforms, 1);
+  EXPECT_EQ(mockFilter.bodyDataSinceLastCheck()->moveToFbString(),
+            "HELLO WORLD");
+  // The clone is untouched
+  EXPECT_EQ(shared->moveToFbString(), "hello world");
+}
+
 TEST(HTTPMessageFilter, TestFilterPauseResumeAfterTxnDetached) {
   //              prev               prev               prev
   // testFilter2 -----> mockFilter -----> testFilter1 -----> mockTxn
@@ -58,6 +58,75 @@ TEST(HTTPMessage, TestParseCookiesMultipleCookies) {
   EXPECT_EQ(msg.getCookie("Name"), "");
 }
 
+TEST(HTTPMessage, TestGetCookies) {
+  HTTPMessage msg;
+
+  msg.getHeaders().add("Cookie", "id=1; same=first; Name");
+  msg.getHeaders().add("Cookie", "same=second");
+  const auto& cookies = msg.getCookies();
+  ASSERT_EQ(cookies.size(), 4);
+  EXPECT_EQ(cookies[0].first, "id");
+  EXPECT_EQ(cookies[0].second, "1");
+  EXPECT_EQ(cookies[2].first, "Name");
+  EXPECT_EQ(cookies[2].second, "");
+  EXPECT_EQ(cookies[3].second, "second");
+  EXPECT_EQ(msg.getCookie("same"), "first");
+}
+
+TEST(HTTPMessage, TestQueryParamPieces) {
+  HTTPMessage msg;
+  msg.setURL("/test?a=1&b=x%20y&a=2&flag&&c=3");
+
+  const auto& params = msg.getQueryParamPieces();
+  ASSERT_EQ(params.size(), 5);
+  EXPECT_EQ(params[0].first, "a");
+  EXPECT_EQ(params[2].second, "2");
+  EXPECT_EQ(params[3].first, "flag");
+  EXPECT_EQ(params[3].second, "");
+  EXPECT_EQ(params[4].second, "3");
+  // The last value wins, as in getQueryParams()
+  EXPECT_EQ(msg.getQueryParamPiece("a"), folly::StringPiece("2"));
+  EXPECT_EQ(msg.getQueryParams().at("a"), "2");
+  EXPECT_FALSE(msg.getQueryParamPiece("d"));
+  EXPECT_EQ(HTTPMessage::decodeQueryParam(*msg.getQueryParamPiece("b")),
+            std::string("x y"));
+  EXPECT_FALSE(HTTPMessage::decodeQueryParam("%zz"));
+
+  // Reparsed once the URL changes
+  msg.setQueryParam("d", "4");
+  EXPECT_EQ(msg.getQueryParamPiece("d"), folly::StringPiece("4"));
+  EXPECT_EQ(msg.getQueryParamPieces().size(), 5);
+
+  HTTPMessage copy(msg);
+  msg.setURL("/other");
+  EXPECT_TRUE(msg.getQueryParamPieces().empty());
+  EXPECT_EQ(copy.getQueryParamPiece("d"), folly::StringPiece("4"));
+}
+
+TEST(HTTPMessage, CopyQueryParamPieces) {
+  auto msg = std::make_unique<HTTPMessage>();
+  msg->setURL("/test?a=1&b=2");
+  ASSERT_EQ(msg->getQueryParamPieces().size(), 2);
+
+  HTTPMessage copy(*msg);
+  HTTPMessage assigned;
+  assigned.setURL("/other?c=3");
+  EXPECT_EQ(assigned.getQueryParamPieces().size(), 1);
+  assigned = *msg;
+  msg.reset();
+
+  // Parsed again, as views of their own URL
+  for (auto* m : {&copy, &assigned}) {
+    const auto& params = m->getQueryParamPieces();
+    ASSERT_EQ(params.size(), 2);
+    EXPECT_EQ(params[0].first, "a");
+    EXPECT_EQ(params[1].second, "2");
+    const auto& url = m->getURL();
+    EXPECT_GE(params[0].first.data(), url.data());
+    EXPECT_LE(params[1].second.end(), url.data() + url.size());
+  }
+}
+
 TEST(HTTPMessage, TestParseQueryParamsSimple) {
   HTTPMessage msg;
   string url =
@@ -140,6 +209,54 @@ TEST(HTTPMessage, SetInvalidURL) {
   EXPECT_EQ(msg.getPathAsStringPiece(), "");
 }
 
+TEST(HTTPMessage, SetURLWithOffsets) {
+  HTTPMessage msg;
+  HTTPMessage::URLOffsets offsets;
+  offsets.pathLength = 4;
+  offsets.queryStart = 5;
+  offsets.queryLength = 5;
+  msg.setURL("/foo?a=1&b#frag", offsets);
+  EXPECT_EQ(msg.getURL(), "/foo?a=1&b#frag");
+  EXPECT_EQ(msg.getPathAsStringPiece(), "/foo");
+  EXPECT_EQ(msg.getQueryStringAsStringPiece(), "a=1&b");
+  EXPECT_EQ(msg.getQueryParam("a"), "1");
+
+  msg.setURL("?x=2", {0, 0, 1, 3});
+  EXPECT_EQ(msg.getPathAsStringPiece(), "/");
+  EXPECT_EQ(msg.getQueryParam("x"), "2");
+  EXPECT_EQ(msg.getQueryParam("a"), "");
+}
+
+TEST(HTTPMessage, CopyAndMoveURL) {
+  // Short enough for the string to be stored inline, and not
+  for (std::string url : {"/a?b=1", "/aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa?b=1"}) {
+    HTTPMessage msg;
+    msg.setURL(url);
+    auto path = url.substr(0, url.find('?'));
+
+    HTTPMessage copy(msg);
+    EXPECT_EQ(copy.getPathAsStringPiece(), path);
+    EXPECT_EQ(copy.getQueryStringAsStringPiece(), "b=1");
+    EXPECT_GE(copy.getPathAsStringPiece().data(), copy.getURL().data());
+
+    HTTPMessage assigned;
+    assigned = msg;
+    EXPECT_EQ(assigned.getPathAsStringPiece(), path);
+    EXPECT_GE(assigned.getQueryStringAsStringPiece().data(),
+              assigned.getURL().data());
+
+    HTTPMessage moved(std::move(copy));
+    EXPECT_EQ(moved.getPathAsStringPiece(), path);
+    EXPECT_EQ(moved.getQueryStringAsStringPiece(), "b=1");
+    EXPECT_GE(moved.getPathAsStringPiece().data(), moved.getURL().data());
+
+    HTTPMessage moveAssigned;
+    moveAssigned = std::move(moved);
+    EXPECT_EQ(moveAssigned.getPathAsStringPiece(), path);
+    EXPECT_EQ(moveAssigned.getQueryParam("b"), "1");
+  }
+}
+
 TEST(HTTPMessage, SetURLEmpty) {
   HTTPMessage msg;
 
@@ -282,6 +399,32 @@ TEST(HTTPMessage, BizarreVersions) {
   EXPECT_EQ(msg.getVersionString(), "0.22");
   msg.setHTTPVersion(10, 1);
   EXPECT_EQ(msg.getVersionString(), "10.1");
+  HTTPMessage copy(msg);
+  EXPECT_EQ(copy.getVersionString(), "10.1");
+  msg.setHTTPVersion(1, 1);
+  EXPECT_EQ(msg.getVersionString(), "1.1");
+  EXPECT_EQ(msg.getProtocolString(), "1.1");
+}
+
+TEST(HTTPMessage, TestLazyAddresses) {
+  HTTPMessage msg;
+  EXPECT_EQ(msg.getDstIP(), "");
+  EXPECT_EQ(msg.getLocalIp(), "");
+  msg.setDstAddress(folly::SocketAddress("10.0.0.2", 443));
+  msg.setLocalIp("10.0.0.3");
+
+  HTTPMessage copy(msg);
+  EXPECT_EQ(msg.getDstIP(), "10.0.0.2");
+  EXPECT_EQ(msg.getDstPort(), "443");
+  EXPECT_EQ(copy.getDstPort(), "443");
+  EXPECT_EQ(copy.getLocalIp(), "10.0.0.3");
+  HTTPMessage moved(std::move(copy));
+  EXPECT_EQ(moved.getLocalIp(), "10.0.0.3");
+
+  // Formatted again for a new address
+  msg.setDstAddress(folly::SocketAddress("10.0.0.4", 80));
+  EXPECT_EQ(msg.getDstIP(), "10.0.0.4");
+  EXPECT_EQ(msg.getDstPort(), "80");
 }
 
 TEST(HTTPMessage, TestKeepaliveCheck) {
@@ -488,6 +631,15 @@ TEST(HTTPHeaders, AddStringPiece) {
   EXPECT_EQ("value", headers.getSingleOrEmpty("name"));
 }
 
+TEST(HTTPHeaders, AddFromCodecWithCode) {
+  HTTPHeaders headers;
+
+  headers.addFromCodec(HTTP_HEADER_OTHER, "x-custom", "value");
+  headers.addFromCodec(HTTP_HEADER_SERVER, "server", "proxygen");
+  EXPECT_EQ("value", headers.getSingleOrEmpty("x-custom"));
+  EXPECT_EQ("proxygen", headers.getSingleOrEmpty(HTTP_HEADER_SERVER));
+}
+
 TEST(HTTPHeaders, InitializerList) {
   HTTPHeaders hdrs;
 
@@ -790,6 +942,53 @@ TEST(HTTPHeaders, GetSetOnResize) {
   EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_SERVER), value);
 }
 
+TEST(HTTPHeaders, CompactRemoved) {
+  HTTPHeaders headers;
+  for (size_t i = 0; i < kInitialVectorReserve; i++) {
+    headers.add(folly::to<std::string>("x-", i), std::string(50, 'a' + i));
+  }
+  // Hop-by-hop stripping, as a proxy does
+  for (size_t i = 0; i < kInitialVectorReserve; i += 2) {
+    headers.remove(folly::to<std::string>("x-", i));
+  }
+  std::string value(50, 'z');
+  // A full collection, half removed: compacted rather than grown, keeping
+  // the order and a value aliasing the storage
+  headers.add(HTTP_HEADER_SERVER, headers.getSingleOrEmpty("x-1"));
+  headers.add(HTTP_HEADER_VIA, value);
+  EXPECT_EQ(headers.size(), kInitialVectorReserve / 2 + 2);
+  std::vector<std::string> names;
+  headers.forEach([&](const std::string& name, const std::string&) {
+    names.push_back(name);
+  });
+  ASSERT_EQ(names.size(), headers.size());
+  EXPECT_EQ(names.front(), "x-1");
+  EXPECT_EQ(names[names.size() - 3], "x-15");
+  EXPECT_EQ(names[names.size() - 2], "Server");
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_SERVER), std::string(50, 'b'));
+  EXPECT_EQ(headers.getSingleOrEmpty(HTTP_HEADER_VIA), value);
+  EXPECT_EQ(headers.getSingleOrEmpty("x-15")[0], 'a' + 15);
+  EXPECT_FALSE(headers.exists("x-14"));
+}
+
+TEST(HTTPHeaders, CopyCompacts) {
+  HTTPHeaders headers;
+  headers.add(HTTP_HEADER_CONNECTION, "close");
+  headers.add("x-other", "1");
+  headers.add(HTTP_HEADER_HOST, "www.facebook.com");
+  headers.remove(HTTP_HEADER_CONNECTION);
+  headers.remove("x-other");
+  HTTPHeaders copy(headers);
+  EXPECT_EQ(copy.size(), 1);
+  HTTPHeaders assigned;
+  assigned.add(HTTP_HEADER_SERVER, "blown away");
+  assigned = headers;
+  EXPECT_EQ(assigned.size(), 1);
+  EXPECT_EQ(assigned.getSingleOrEmpty(HTTP_HEADER_HOST), "www.facebook.com");
+  assigned.add("x-other", "2");
+  EXPECT_EQ(assigned.size(), 2);
+}
+
 TEST(HTTPHeaders, MoveFromTest) {
   HTTPHeaders h1;
   HTTPHeaders h2(std::move(h1));
@@ -143,3 +143,19 @@ TEST(HTTPPriorityFunctionsTest, PriorityHeaderCustomOrderId) {
   EXPECT_EQ(priority->urgency, 3);
   EXPECT_EQ(priority->orderId, 100);
 }
+
+TEST(HTTPPriorityFunctionsTest, PriorityHeaderAnyOrder) {
+  HTTPMessage req;
+  req.getHeaders().add(HTTP_HEADER_PRIORITY, "i=?1, u=5;foo, o=7");
+  auto priority = httpPriorityFromHTTPMessage(req);
+  ASSERT_TRUE(priority.hasValue());
+  EXPECT_EQ(priority->urgency, 5);
+  EXPECT_TRUE(priority->incremental);
+  EXPECT_EQ(priority->orderId, 7);
+
+  // The last of duplicate keys wins, as in RFC 8941
+  req.getHeaders().set(HTTP_HEADER_PRIORITY, "u=1, u=2");
+  priority = httpPriorityFromHTTPMessage(req);
+  ASSERT_TRUE(priority.hasValue());
+  EXPECT_EQ(priority->urgency, 2);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/AsyncServerSocket.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/HappyEyeballsConnector.h>
+#include <proxygen/lib/http/session/HTTPUpstreamSession.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+class TestConnectCallback : public HappyEyeballsConnector::Callback {
+ public:
+  void connectSuccess(HTTPSessionBase* sess) override {
+    session = sess;
+  }
+  void connectError(const folly::exception_wrapper& /*error*/) override {
+    errors++;
+  }
+
+  HTTPSessionBase* session{nullptr};
+  size_t errors{0};
+};
+
+} // namespace
+
+class HappyEyeballsConnectorTest : public testing::Test {
+ public:
+  void SetUp() override {
+    // The kernel completes the handshakes of the listening sockets, nothing
+    // needs to accept them
+    for (auto& server : servers_) {
+      server.reset(new folly::AsyncServerSocket(&evb_));
+      server->bind(folly::SocketAddress("127.0.0.1", 0));
+      server->listen(16);
+    }
+    // Nothing listens on the address of a closed socket
+    auto closed = folly::AsyncServerSocket::UniquePtr(
+        new folly::AsyncServerSocket(&evb_));
+    closed->bind(folly::SocketAddress("127.0.0.1", 0));
+    closed->getAddress(&refusedAddr_);
+  }
+
+  void TearDown() override {
+    if (cb_.session) {
+      cb_.session->dropConnection();
+    }
+    evb_.loop();
+  }
+
+  folly::SocketAddress getServerAddress(size_t i) {
+    folly::SocketAddress addr;
+    servers_[i]->getAddress(&addr);
+    return addr;
+  }
+
+  void runUntilDone() {
+    while (!cb_.session && cb_.errors == 0) {
+      evb_.loopOnce();
+    }
+  }
+
+ protected:
+  folly::EventBase evb_;
+  std::array<folly::AsyncServerSocket::UniquePtr, 2> servers_;
+  folly::SocketAddress refusedAddr_;
+  TestConnectCallback cb_;
+  HappyEyeballsConnector connector_{
+      &cb_, WheelTimerInstance(std::chrono::milliseconds(5000), &evb_)};
+};
+
+TEST_F(HappyEyeballsConnectorTest, InterleaveAddressFamilies) {
+  std::vector<folly::SocketAddress> addrs{
+      folly::SocketAddress("::1", 1),
+      folly::SocketAddress("::2", 1),
+      folly::SocketAddress("::3", 1),
+      folly::SocketAddress("10.0.0.1", 1),
+      folly::SocketAddress("10.0.0.2", 1),
+  };
+  auto result = HappyEyeballsConnector::interleaveAddressFamilies(addrs);
+  std::vector<folly::SocketAddress> expected{
+      folly::SocketAddress("::1", 1),
+      folly::SocketAddress("10.0.0.1", 1),
+      folly::SocketAddress("::2", 1),
+      folly::SocketAddress("10.0.0.2", 1),
+      folly::SocketAddress("::3", 1),
+  };
+  EXPECT_EQ(result, expected);
+}
+
+TEST_F(HappyEyeballsConnectorTest, FirstAddressWins) {
+  HappyEyeballsConnector::Params params;
+  params.attemptDelay = std::chrono::seconds(10);
+  connector_.connect(
+      &evb_, {getServerAddress(0), getServerAddress(1)}, std::move(params));
+  runUntilDone();
+  ASSERT_NE(cb_.session, nullptr);
+  EXPECT_EQ(cb_.session->getPeerAddress(), getServerAddress(0));
+  // The second address was never needed
+  EXPECT_EQ(connector_.getNumAttempts(), 1);
+  EXPECT_FALSE(connector_.isBusy());
+}
+
+TEST_F(HappyEyeballsConnectorTest, FailedAttemptStartsNext) {
+  HappyEyeballsConnector::Params params;
+  // Far longer than the test waits
+  params.attemptDelay = std::chrono::seconds(10);
+  connector_.connect(
+      &evb_, {refusedAddr_, getServerAddress(1)}, std::move(params));
+  runUntilDone();
+  ASSERT_NE(cb_.session, nullptr);
+  EXPECT_EQ(cb_.session->getPeerAddress(), getServerAddress(1));
+  EXPECT_EQ(connector_.getNumAttempts(), 2);
+}
+
+TEST_F(HappyEyeballsConnectorTest, AllAttemptsFail) {
+  HappyEyeballsConnector::Params params;
+  connector_.connect(&evb_, {refusedAddr_, refusedAddr_}, std::move(params));
+  runUntilDone();
+  EXPECT_EQ(cb_.session, nullptr);
+  EXPECT_EQ(cb_.errors, 1);
+  EXPECT_FALSE(connector_.isBusy());
+}
+
+TEST_F(HappyEyeballsConnectorTest, NoAddress) {
+  connector_.connect(&evb_, {}, HappyEyeballsConnector::Params());
+  EXPECT_EQ(cb_.errors, 1);
+}
+
+TEST_F(HappyEyeballsConnectorTest, ResetCancels) {
+  connector_.connect(
+      &evb_, {getServerAddress(0)}, HappyEyeballsConnector::Params());
+  EXPECT_TRUE(connector_.isBusy());
+  connector_.reset();
+  EXPECT_FALSE(connector_.isBusy());
+  evb_.loop();
+  EXPECT_EQ(cb_.session, nullptr);
+  EXPECT_EQ(cb_.errors, 0);
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <proxygen/lib/http/codec/CodecUtil.h>
+
+using namespace proxygen;
+
+/**
+ * CodecUtil's header name and value validation, which every codec runs on
+ * every header, against a plain loop over the octets that checks only the
+ * character class.
+ */
+
+namespace {
+
+folly::ByteRange range(const std::string& str) {
+  return folly::ByteRange(reinterpret_cast<const uint8_t*>(str.data()),
+                          str.size());
+}
+
+const std::string kShortName = "content-type";
+const std::string kLongName = "x-fb-debug-request-correlation-identifier";
+const std::string kUserAgent =
+    "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36";
+const std::string kCookie = [] {
+  std::string cookie;
+  for (int i = 0; i < 32; i++) {
+    cookie += folly::to<std::string>("cookie", i, "=0123456789abcdef; ");
+  }
+  return cookie;
+}();
+
+bool byteLoopName(folly::ByteRange name) {
+  for (uint8_t c : name) {
+    if (c >= 0x80 || CodecUtil::http_tokens[c] != c) {
+      return false;
+    }
+  }
+  return !name.empty();
+}
+
+bool byteLoopValue(folly::ByteRange value) {
+  for (uint8_t c : value) {
+    if ((c < 0x20 && c != '\t') || c >= 0x7f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void validateName(size_t iters, const std::string& name) {
+  auto input = range(name);
+  for (size_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(
+        CodecUtil::validateHeaderName(input, CodecUtil::HEADER_NAME_STRICT));
+  }
+}
+
+void validateValue(size_t iters, const std::string& value) {
+  auto input = range(value);
+  for (size_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(
+        CodecUtil::validateHeaderValue(input, CodecUtil::STRICT));
+  }
+}
+
+void loopName(size_t iters, const std::string& name) {
+  auto input = range(name);
+  for (size_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(byteLoopName(input));
+  }
+}
+
+void loopValue(size_t iters, const std::string& value) {
+  auto input = range(value);
+  for (size_t i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(byteLoopValue(input));
+  }
+}
+
+} // namespace
+
+BENCHMARK(ByteLoopShortName, iters) {
+  loopName(iters, kShortName);
+}
+
+BENCHMARK_RELATIVE(ValidateShortName, iters) {
+  validateName(iters, kShortName);
+}
+
+BENCHMARK(ByteLoopLongName, iters) {
+  loopName(iters, kLongName);
+}
+
+BENCHMARK_RELATIVE(ValidateLongName, iters) {
+  validateName(iters, kLongName);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(ByteLoopUserAgent, iters) {
+  loopValue(iters, kUserAgent);
+}
+
+BENCHMARK_RELATIVE(ValidateUserAgent, iters) {
+  validateValue(iters, kUserAgent);
+}
+
+BENCHMARK(ByteLoopCookie, iters) {
+  loopValue(iters, kCookie);
+}
+
+BENCHMARK_RELATIVE(ValidateCookie, iters) {
+  validateValue(iters, kCookie);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -13,6 +13,9 @@
 using namespace proxygen;
 
 using RFC2616::parseByteRangeSpec;
+using RFC2616::parseRangeRequest;
+using RFC2616::parseRangesRequest;
+using RFC2616::RangeRequestResult;
 using std::string;
 
 TEST(QvalueTest, Basic) {
@@ -254,3 +257,121 @@ TEST(ByteRangeSpecTest, Invalids) {
   EXPECT_FALSE(parseByteRangeSpec(sp, dummy, dummy, dummy))
       << "Spec StringPiece ends before first byte in initial byte range";
 }
+
+TEST(RangeRequestTest, Satisfiable) {
+  uint64_t first = 0;
+  uint64_t last = 0;
+  EXPECT_EQ(parseRangeRequest("bytes=0-9", 100, first, last),
+            RangeRequestResult::SATISFIABLE);
+  EXPECT_EQ(first, 0);
+  EXPECT_EQ(last, 9);
+
+  EXPECT_EQ(parseRangeRequest("bytes=90-", 100, first, last),
+            RangeRequestResult::SATISFIABLE);
+  EXPECT_EQ(first, 90);
+  EXPECT_EQ(last, 99);
+
+  EXPECT_EQ(parseRangeRequest("Bytes = 50-500", 100, first, last),
+            RangeRequestResult::INVALID)
+      << "No whitespace allowed inside the unit";
+  EXPECT_EQ(parseRangeRequest(" BYTES=50-500 ", 100, first, last),
+            RangeRequestResult::SATISFIABLE);
+  EXPECT_EQ(first, 50);
+  EXPECT_EQ(last, 99) << "Last byte is clamped";
+
+  EXPECT_EQ(parseRangeRequest("bytes=-10", 100, first, last),
+            RangeRequestResult::SATISFIABLE);
+  EXPECT_EQ(first, 90);
+  EXPECT_EQ(last, 99);
+
+  EXPECT_EQ(parseRangeRequest("bytes=-1000", 100, first, last),
+            RangeRequestResult::SATISFIABLE);
+  EXPECT_EQ(first, 0);
+  EXPECT_EQ(last, 99);
+}
+
+TEST(RangeRequestTest, Unsatisfiable) {
+  uint64_t first = 0;
+  uint64_t last = 0;
+  EXPECT_EQ(parseRangeRequest("bytes=100-", 100, first, last),
+            RangeRequestResult::UNSATISFIABLE);
+  EXPECT_EQ(parseRangeRequest("bytes=100-200", 100, first, last),
+            RangeRequestResult::UNSATISFIABLE);
+  EXPECT_EQ(parseRangeRequest("bytes=-0", 100, first, last),
+            RangeRequestResult::UNSATISFIABLE);
+  EXPECT_EQ(parseRangeRequest("bytes=-5", 0, first, last),
+            RangeRequestResult::UNSATISFIABLE);
+}
+
+TEST(RangeRequestTest, Invalid) {
+  uint64_t first = 0;
+  uint64_t last = 0;
+  EXPECT_EQ(parseRangeRequest("0-10", 100, first, last),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangeRequest("items=0-10", 100, first, last),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangeRequest("bytes=10", 100, first, last),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangeRequest("bytes=10-5", 100, first, last),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangeRequest("bytes=x-5", 100, first, last),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangeRequest("bytes=-", 100, first, last),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangeRequest("bytes=0-1,5-6", 100, first, last),
+            RangeRequestResult::INVALID)
+      << "Multiple ranges are not supported";
+}
+
+TEST(RangesRequestTest, Multiple) {
+  RFC2616::ByteRanges ranges;
+  EXPECT_EQ(parseRangesRequest("bytes=0-9, 50-59,-10", 100, 16, ranges),
+            RangeRequestResult::SATISFIABLE);
+  RFC2616::ByteRanges expected{{0, 9}, {50, 59}, {90, 99}};
+  EXPECT_EQ(ranges, expected);
+
+  EXPECT_EQ(parseRangesRequest("bytes=10-20", 100, 16, ranges),
+            RangeRequestResult::SATISFIABLE);
+  expected = {{10, 20}};
+  EXPECT_EQ(ranges, expected);
+}
+
+TEST(RangesRequestTest, Coalesced) {
+  RFC2616::ByteRanges ranges;
+  EXPECT_EQ(parseRangesRequest("bytes=50-60,0-9,10-19,55-70", 100, 16, ranges),
+            RangeRequestResult::SATISFIABLE);
+  RFC2616::ByteRanges expected{{0, 19}, {50, 70}};
+  EXPECT_EQ(ranges, expected);
+
+  // Overlaps can't amplify the response
+  EXPECT_EQ(parseRangesRequest("bytes=0-,0-,0-,0-", 100, 2, ranges),
+            RangeRequestResult::SATISFIABLE);
+  expected = {{0, 99}};
+  EXPECT_EQ(ranges, expected);
+}
+
+TEST(RangesRequestTest, Unsatisfiable) {
+  RFC2616::ByteRanges ranges;
+  EXPECT_EQ(parseRangesRequest("bytes=0-9,200-300", 100, 16, ranges),
+            RangeRequestResult::SATISFIABLE)
+      << "Unsatisfiable ranges are dropped";
+  RFC2616::ByteRanges expected{{0, 9}};
+  EXPECT_EQ(ranges, expected);
+  EXPECT_EQ(parseRangesRequest("bytes=100-,200-300", 100, 16, ranges),
+            RangeRequestResult::UNSATISFIABLE);
+  EXPECT_TRUE(ranges.empty());
+}
+
+TEST(RangesRequestTest, Invalid) {
+  RFC2616::ByteRanges ranges;
+  EXPECT_EQ(parseRangesRequest("bytes=", 100, 16, ranges),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangesRequest("bytes=0-9,x", 100, 16, ranges),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangesRequest("items=0-9", 100, 16, ranges),
+            RangeRequestResult::INVALID);
+  EXPECT_EQ(parseRangesRequest("bytes=0-9,20-29,40-49", 100, 2, ranges),
+            RangeRequestResult::INVALID)
+      << "Too many ranges";
+  EXPECT_TRUE(ranges.empty());
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/HTTPMessage.h>
+#include <proxygen/lib/http/RangeResponse.h>
+
+using namespace proxygen;
+
+class RangeResponseTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    for (size_t i = 0; i < 100; i++) {
+      contents_.push_back('a' + (i % 26));
+    }
+    representation_.size = contents_.size();
+    representation_.contentType = "text/plain";
+    representation_.etag = "\"tag\"";
+    representation_.lastModified = "Thu, 01 Jan 2026 00:00:00 GMT";
+  }
+
+  HTTPHeaders makeRequest(const std::string& range,
+                          const std::string& ifRange = "") {
+    HTTPHeaders headers;
+    if (!range.empty()) {
+      headers.set(HTTP_HEADER_RANGE, range);
+    }
+    if (!ifRange.empty()) {
+      headers.set("If-Range", ifRange);
+    }
+    return headers;
+  }
+
+  // Reads the body 7 bytes at most at a time
+  std::string readBody(RangeResponse& response) {
+    RangeResponse::Reader reader = [this](uint64_t offset, uint64_t length) {
+      return folly::IOBuf::copyBuffer(
+          contents_.substr(offset, std::min<uint64_t>(length, 7)));
+    };
+    std::string body;
+    while (auto chunk = response.next(reader)) {
+      body += chunk->moveToFbString().toStdString();
+      EXPECT_EQ(response.remaining(),
+                response.getContentLength() - body.size());
+    }
+    EXPECT_EQ(body.size(), response.getContentLength());
+    return body;
+  }
+
+  std::string contents_;
+  RangeResponse::Representation representation_;
+};
+
+TEST_F(RangeResponseTest, Full) {
+  RangeResponse response(makeRequest(""), representation_);
+  EXPECT_EQ(response.getStatus(), RangeResponse::Status::FULL);
+  HTTPMessage message;
+  response.setHeaders(message);
+  EXPECT_EQ(message.getStatusCode(), 200);
+  EXPECT_EQ(message.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH),
+            "100");
+  EXPECT_EQ(message.getHeaders().getSingleOrEmpty(HTTP_HEADER_ACCEPT_RANGES),
+            "bytes");
+  EXPECT_EQ(message.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE),
+            "text/plain");
+  EXPECT_EQ(readBody(response), contents_);
+}
+
+TEST_F(RangeResponseTest, Empty) {
+  representation_.size = 0;
+  RangeResponse response(makeRequest(""), representation_);
+  EXPECT_EQ(response.getStatus(), RangeResponse::Status::FULL);
+  EXPECT_EQ(response.remaining(), 0);
+  RangeResponse::Reader reader = [](uint64_t, uint64_t) {
+    ADD_FAILURE() << "Nothing to read";
+    return folly::IOBuf::create(0);
+  };
+  EXPECT_EQ(response.next(reader), nullptr);
+}
+
+TEST_F(RangeResponseTest, Partial) {
+  RangeResponse response(makeRequest("bytes=10-29"), representation_);
+  EXPECT_EQ(response.getStatus(), RangeResponse::Status::PARTIAL);
+  HTTPMessage message;
+  response.setHeaders(message);
+  EXPECT_EQ(message.getStatusCode(), 206);
+  EXPECT_EQ(message.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_RANGE),
+            "bytes 10-29/100");
+  EXPECT_EQ(message.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH),
+            "20");
+  EXPECT_EQ(readBody(response), contents_.substr(10, 20));
+}
+
+TEST_F(RangeResponseTest, Multipart) {
+  RangeResponse response(makeRequest("bytes=90-,0-9,5-14"), representation_);
+  ASSERT_EQ(response.getStatus(), RangeResponse::Status::MULTIPART);
+  EXPECT_EQ(response.getRanges().size(), 2);
+  HTTPMessage message;
+  response.setHeaders(message);
+  EXPECT_EQ(message.getStatusCode(), 206);
+  const auto& boundary = response.getBoundary();
+  ASSERT_FALSE(boundary.empty());
+  EXPECT_EQ(message.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_TYPE),
+            "multipart/byteranges; boundary=" + boundary);
+  EXPECT_FALSE(message.getHeaders().exists(HTTP_HEADER_CONTENT_RANGE));
+  EXPECT_EQ(message.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH),
+            folly::to<std::string>(response.getContentLength()));
+
+  auto expected = folly::to<std::string>("\r\n--",
+                                         boundary,
+                                         "\r\nContent-Type: text/plain",
+                                         "\r\nContent-Range: bytes 0-14/100",
+                                         "\r\n\r\n",
+                                         contents_.substr(0, 15),
+                                         "\r\n--",
+                                         boundary,
+                                         "\r\nContent-Type: text/plain",
+                                         "\r\nContent-Range: bytes 90-99/100",
+                                         "\r\n\r\n",
+                                         contents_.substr(90),
+                                         "\r\n--",
+                                         boundary,
+                                         "--\r\n");
+  EXPECT_EQ(readBody(response), expected);
+}
+
+TEST_F(RangeResponseTest, TooManyRanges) {
+  RangeResponse response(
+      makeRequest("bytes=0-0,2-2,4-4"), representation_, 2);
+  EXPECT_EQ(response.getStatus(), RangeResponse::Status::FULL);
+  EXPECT_EQ(readBody(response), contents_);
+}
+
+TEST_F(RangeResponseTest, Unsatisfiable) {
+  RangeResponse response(makeRequest("bytes=100-"), representation_);
+  EXPECT_EQ(response.getStatus(), RangeResponse::Status::UNSATISFIABLE);
+  HTTPMessage message;
+  response.setHeaders(message);
+  EXPECT_EQ(message.getStatusCode(), 416);
+  EXPECT_EQ(message.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_RANGE),
+            "bytes */100");
+  EXPECT_EQ(response.getContentLength(), 0);
+}
+
+TEST_F(RangeResponseTest, IfRange) {
+  auto getStatus = [this](const std::string& ifRange) {
+    return RangeResponse(makeRequest("bytes=0-9", ifRange), representation_)
+        .getStatus();
+  };
+  EXPECT_EQ(getStatus("\"tag\""), RangeResponse::Status::PARTIAL);
+  EXPECT_EQ(getStatus(representation_.lastModified.str()),
+            RangeResponse::Status::PARTIAL);
+  EXPECT_EQ(getStatus("\"old\""), RangeResponse::Status::FULL);
+  EXPECT_EQ(getStatus("Wed, 31 Dec 2025 00:00:00 GMT"),
+            RangeResponse::Status::FULL);
+  EXPECT_EQ(getStatus("W/\"tag\""), RangeResponse::Status::FULL)
+      << "Weak ETags never match";
+
+  representation_.etag = "";
+  representation_.lastModified = "";
+  EXPECT_EQ(getStatus("\"tag\""), RangeResponse::Status::FULL);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/http/stats/ResponseCodeWindow.h>
+
+using namespace proxygen;
+using namespace std::chrono;
+
+TEST(ResponseCodeWindowTest, StatusClass) {
+  EXPECT_EQ(ResponseCodeWindow::statusClass(-1), ResponseCodeWindow::kNone);
+  EXPECT_EQ(ResponseCodeWindow::statusClass(99), ResponseCodeWindow::kOther);
+  EXPECT_EQ(ResponseCodeWindow::statusClass(101), ResponseCodeWindow::k1xx);
+  EXPECT_EQ(ResponseCodeWindow::statusClass(200), ResponseCodeWindow::k2xx);
+  EXPECT_EQ(ResponseCodeWindow::statusClass(399), ResponseCodeWindow::k3xx);
+  EXPECT_EQ(ResponseCodeWindow::statusClass(404), ResponseCodeWindow::k4xx);
+  EXPECT_EQ(ResponseCodeWindow::statusClass(503), ResponseCodeWindow::k5xx);
+  EXPECT_EQ(ResponseCodeWindow::statusClass(600), ResponseCodeWindow::kOther);
+}
+
+TEST(ResponseCodeWindowTest, Rolling) {
+  // 1s, by 100ms
+  ResponseCodeWindow window(milliseconds(100), 10);
+  EXPECT_EQ(window.getWindow(), seconds(1));
+  auto start = TimePoint(seconds(1000));
+  window.addStatus(200, start);
+  window.addStatus(503, start);
+  window.addStatus(503, start + milliseconds(50));
+  window.addStatus(200, start + milliseconds(450));
+  EXPECT_EQ(window.sum(ResponseCodeWindow::k5xx, start + milliseconds(450)),
+            2);
+  EXPECT_EQ(window.sum(start + milliseconds(450)), 4);
+
+  // The first bucket expires
+  auto later = start + milliseconds(1000);
+  EXPECT_EQ(window.sum(ResponseCodeWindow::k5xx, later), 0);
+  EXPECT_EQ(window.sum(ResponseCodeWindow::k2xx, later), 1);
+  window.addStatus(404, later);
+  EXPECT_EQ(window.sum(later + milliseconds(300)), 2);
+  EXPECT_EQ(window.sum(later + milliseconds(400)), 1);
+
+  // All of it
+  EXPECT_EQ(window.sum(later + seconds(10)), 0);
+  window.addStatus(200, later + seconds(10));
+  EXPECT_EQ(window.sum(later + seconds(10)), 1);
+
+  // Time going back counts in the current bucket
+  window.addStatus(200, later);
+  EXPECT_EQ(window.sum(ResponseCodeWindow::k2xx, later + seconds(10)), 2);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/http/SynchronizedLruQuicPskCache.h>
+
+using namespace proxygen;
+
+namespace {
+
+constexpr size_t kNumIdentities = 1024;
+
+// Every thread looks up the PSKs of many origins, replacing one in 16 as a
+// connect that received a new ticket would
+void runLookups(quic::QuicPskCache& cache, size_t iters, size_t numThreads) {
+  std::vector<std::string> identities;
+  std::vector<std::thread> threads;
+  std::atomic<bool> go{false};
+
+  BENCHMARK_SUSPEND {
+    quic::QuicCachedPsk psk;
+    psk.cachedPsk.ticketExpirationTime =
+        std::chrono::system_clock::now() + std::chrono::hours(1);
+    for (size_t i = 0; i < kNumIdentities; ++i) {
+      identities.push_back(folly::to<std::string>("origin", i, ".test:443"));
+      cache.putPsk(identities.back(), psk);
+    }
+    for (size_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t, psk] {
+        while (!go.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        for (size_t i = t; i < iters; i += numThreads) {
+          const auto& identity = identities[(i * 7919) % kNumIdentities];
+          if (i % 16 == 0) {
+            cache.putPsk(identity, psk);
+          } else {
+            folly::doNotOptimizeAway(cache.getPsk(identity));
+          }
+        }
+      });
+    }
+  }
+
+  go.store(true, std::memory_order_release);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+void runSynchronized(size_t iters, size_t numThreads) {
+  SynchronizedLruQuicPskCache cache(kNumIdentities);
+  runLookups(cache, iters, numThreads);
+}
+
+void runSharded(size_t iters, size_t numThreads) {
+  // Room for the skew of the hash over the shards
+  ShardedLruQuicPskCache cache(kNumIdentities * 2);
+  runLookups(cache, iters, numThreads);
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(runSynchronized, threads_1, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(runSharded, threads_1, 1)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(runSynchronized, threads_8, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(runSharded, threads_8, 8)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(runSynchronized, threads_32, 32)
+BENCHMARK_RELATIVE_NAMED_PARAM(runSharded, threads_32, 32)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
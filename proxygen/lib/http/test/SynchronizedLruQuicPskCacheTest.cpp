@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/http/SynchronizedLruQuicPskCache.h>
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+using namespace testing;
+
+namespace {
+
+quic::QuicCachedPsk makePsk(const std::string& psk,
+                            std::chrono::seconds validFor) {
+  quic::QuicCachedPsk quicPsk;
+  quicPsk.cachedPsk.psk = psk;
+  quicPsk.cachedPsk.ticketExpirationTime =
+      std::chrono::system_clock::now() + validFor;
+  return quicPsk;
+}
+
+} // namespace
+
+TEST(ShardedLruQuicPskCacheTest, PutGetRemove) {
+  ShardedLruQuicPskCache cache(100, 4);
+  for (int i = 0; i < 10; ++i) {
+    cache.putPsk(folly::to<std::string>("host", i),
+                 makePsk(folly::to<std::string>("psk", i),
+                         std::chrono::seconds(60)));
+  }
+  for (int i = 0; i < 10; ++i) {
+    auto psk = cache.getPsk(folly::to<std::string>("host", i));
+    ASSERT_TRUE(psk.has_value());
+    EXPECT_EQ(psk->cachedPsk.psk, folly::to<std::string>("psk", i));
+  }
+  cache.removePsk("host3");
+  EXPECT_FALSE(cache.getPsk("host3").has_value());
+  EXPECT_TRUE(cache.getPsk("host4").has_value());
+}
+
+TEST(ShardedLruQuicPskCacheTest, Expired) {
+  ShardedLruQuicPskCache cache(100);
+  cache.putPsk("host", makePsk("psk", std::chrono::seconds(-1)));
+  EXPECT_FALSE(cache.getPsk("host").has_value());
+}
+
+TEST(ShardedLruQuicPskCacheTest, EvictsLeastRecentlyUsed) {
+  // With one shard it is a plain LRU cache
+  ShardedLruQuicPskCache cache(2, 1);
+  cache.putPsk("a", makePsk("a", std::chrono::seconds(60)));
+  cache.putPsk("b", makePsk("b", std::chrono::seconds(60)));
+  EXPECT_TRUE(cache.getPsk("a").has_value());
+  cache.putPsk("c", makePsk("c", std::chrono::seconds(60)));
+  EXPECT_TRUE(cache.getPsk("a").has_value());
+  EXPECT_FALSE(cache.getPsk("b").has_value());
+  EXPECT_TRUE(cache.getPsk("c").has_value());
+}
@@ -19,6 +19,19 @@ using folly::SocketAddress;
 using std::string;
 using std::chrono::milliseconds;
 
+namespace {
+
+int64_t getMtimeNs(const struct stat& st) {
+#ifdef __APPLE__
+  const auto& mtime = st.st_mtimespec;
+#else
+  const auto& mtime = st.st_mtim;
+#endif
+  return int64_t(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+}
+
+} // namespace
+
 namespace proxygen {
 
 void FileServerListGenerator::FileGenerator::readFile(std::string& filePath,
@@ -34,6 +47,18 @@ void FileServerListGenerator::FileGenerator::run(milliseconds /*timeout*/) {
 
   VLOG(4) << "Looking up server list from File Handle " << params_->fileName;
 
+  // A file that can't be stat'ed, as readFile may be overridden, is read
+  struct stat st;
+  bool statted = snapshot_ && ::stat(params_->fileName.c_str(), &st) == 0;
+  if (statted && snapshot_->version > 0 && st.st_dev == snapshot_->device &&
+      st.st_ino == snapshot_->inode && st.st_size == snapshot_->size &&
+      getMtimeNs(st) == snapshot_->mtimeNs) {
+    VLOG(4) << "File " << params_->fileName << " is unchanged";
+    deliver({}, false);
+    delete this;
+    return;
+  }
+
   std::string content;
   try {
     readFile(params_->fileName, content);
@@ -43,6 +68,27 @@ void FileServerListGenerator::FileGenerator::run(milliseconds /*timeout*/) {
     return;
   }
 
+  // Only a file that parsed is skipped next time
+  auto recordStat = [&] {
+    if (statted) {
+      snapshot_->device = st.st_dev;
+      snapshot_->inode = st.st_ino;
+      snapshot_->size = st.st_size;
+      snapshot_->mtimeNs = getMtimeNs(st);
+    }
+  };
+  size_t contentHash = 0;
+  if (snapshot_) {
+    contentHash = std::hash<std::string>()(content);
+    if (snapshot_->version > 0 && contentHash == snapshot_->contentHash) {
+      VLOG(4) << "Content of " << params_->fileName << " is unchanged";
+      recordStat();
+      deliver({}, false);
+      delete this;
+      return;
+    }
+  }
+
   // process the content and get the server list
   std::vector<ServerConfig> servers;
 
@@ -85,10 +131,50 @@ void FileServerListGenerator::FileGenerator::run(milliseconds /*timeout*/) {
 
   VLOG(4) << "Found " << servers.size() << " usable servers from File "
           << params_->fileName;
-  callback_->serverListAvailable(std::move(servers));
+  if (snapshot_) {
+    recordStat();
+    snapshot_->contentHash = contentHash;
+  }
+  deliver(std::move(servers), true);
   delete this;
 }
 
+void FileServerListGenerator::FileGenerator::deliver(
+    std::vector<ServerConfig> servers, bool changed) {
+  if (!snapshot_) {
+    callback_->serverListAvailable(std::move(servers));
+    return;
+  }
+  const auto previousVersion = snapshot_->version;
+  if (changed) {
+    // servers holds the previous list from here on
+    std::swap(snapshot_->servers, servers);
+    snapshot_->version++;
+  }
+  if (!callback_->wantsServerListDelta()) {
+    callback_->serverListAvailable(snapshot_->servers);
+    return;
+  }
+
+  const auto callbackVersion = callback_->serverListVersion_;
+  ServerListDelta delta;
+  if (callbackVersion == snapshot_->version) {
+    delta.baseVersion = callbackVersion;
+  } else if (changed && callbackVersion == previousVersion) {
+    delta = diffServerLists(servers, snapshot_->servers);
+    delta.baseVersion = previousVersion;
+  } else {
+    // The callback holds a list older than the one kept
+    delta = diffServerLists({}, snapshot_->servers);
+  }
+  delta.version = snapshot_->version;
+  VLOG(4) << "Server list of " << params_->fileName << " version "
+          << delta.version << ": " << delta.added.size() << " added, "
+          << delta.changed.size() << " changed, " << delta.removed.size()
+          << " removed";
+  callback_->serverListDeltaAvailable(std::move(delta));
+}
+
 FileServerListGenerator::FileServerListGenerator(const string& fileName,
                                                  const FileType fileType,
                                                  const string& poolName,
@@ -108,7 +194,7 @@ FileServerListGenerator::FileServerListGenerator(const string& fileName,
 
 void FileServerListGenerator::listServers(Callback* callback,
                                           milliseconds timeout) {
-  auto gen = new FileGenerator(&params_, callback);
+  auto gen = new FileGenerator(&params_, callback, &snapshot_);
   callback->resetGenerator(gen);
   gen->run(timeout);
 }
@@ -17,6 +17,10 @@ namespace proxygen {
 /*
  * A ServerListGenerator implementation that gets the server list from
  * a file.
+ *
+ * The last list is kept.  Refreshes skip reading a file whose size, inode
+ * and mtime are unchanged, and parsing one whose content hashes the same,
+ * and callbacks wanting deltas get only the members that changed.
  */
 class FileServerListGenerator : public ServerListGenerator {
  public:
@@ -50,10 +54,24 @@ class FileServerListGenerator : public ServerListGenerator {
     uint16_t port;
   };
 
+  // The last list read, and what identifies its file and content
+  struct Snapshot {
+    dev_t device{0};
+    ino_t inode{0};
+    off_t size{0};
+    int64_t mtimeNs{0};
+    size_t contentHash{0};
+    uint64_t version{0};
+    std::vector<ServerConfig> servers;
+  };
+
   class FileGenerator : public ServerListGenerator::Generator {
    public:
-    FileGenerator(Params* params, Callback* callback)
-        : params_(params), callback_(callback) {
+    // Without a snapshot the file is read and parsed every time
+    FileGenerator(Params* params,
+                  Callback* callback,
+                  Snapshot* snapshot = nullptr)
+        : params_(params), callback_(callback), snapshot_(snapshot) {
     }
     virtual ~FileGenerator() override {
     }
@@ -62,11 +80,16 @@ class FileServerListGenerator : public ServerListGenerator {
     virtual void cancelServerListRequest() override;
 
    protected:
+    // Hands the list to the callback, in full or as a delta
+    void deliver(std::vector<ServerConfig> servers, bool changed);
+
     Params* params_;
     Callback* callback_;
+    Snapshot* snapshot_;
   };
 
   Params params_;
+  Snapshot snapshot_;
 
  private:
   // Forbidden copy constructor and assignment operator
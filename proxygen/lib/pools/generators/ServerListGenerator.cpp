@@ -10,6 +10,7 @@
 
 #include <folly/Conv.h>
 #include <folly/io/async/EventBase.h>
+#include <unordered_map>
 
 using folly::EventBase;
 using std::vector;
@@ -30,6 +31,34 @@ void ServerListGenerator::detachEventBase() {
   eventBase_ = nullptr;
 }
 
+ServerListGenerator::ServerListDelta ServerListGenerator::diffServerLists(
+    const vector<ServerConfig>& before, const vector<ServerConfig>& after) {
+  ServerListDelta delta;
+  std::unordered_map<folly::StringPiece, const ServerConfig*> previous;
+  previous.reserve(before.size());
+  for (const auto& server : before) {
+    previous.emplace(server.name, &server);
+  }
+  for (const auto& server : after) {
+    auto it = previous.find(server.name);
+    if (it == previous.end()) {
+      delta.added.push_back(server);
+      continue;
+    }
+    if (*it->second != server) {
+      delta.changed.push_back(server);
+    }
+    previous.erase(it);
+  }
+  // Whatever is left was not in the new list
+  for (const auto& server : before) {
+    if (previous.count(server.name)) {
+      delta.removed.push_back(server.name);
+    }
+  }
+  return delta;
+}
+
 void ServerListGenerator::listServersBlocking(vector<ServerConfig>* results,
                                               milliseconds timeout) {
   // Run a EventBase to drive the asynchronous listServers() call until it
@@ -54,8 +54,39 @@ class ServerListGenerator {
     // Optional parameter. It's only set if a server belongs to a group, which
     // is configured in Pool Config.
     MemberGroupId groupId_{kInvalidPoolMemberGroupId};
+
+    bool operator==(const ServerConfig& other) const {
+      return name == other.name && address == other.address &&
+             altAddresses == other.altAddresses &&
+             properties == other.properties && groupId_ == other.groupId_;
+    }
+    bool operator!=(const ServerConfig& other) const {
+      return !(*this == other);
+    }
   };
 
+  /**
+   * What changed in a server list between two versions, with members known
+   * by name.  A baseVersion of 0 means the delta is against an empty list,
+   * so what the consumer holds should be replaced.
+   */
+  struct ServerListDelta {
+    uint64_t baseVersion{0};
+    uint64_t version{0};
+    std::vector<ServerConfig> added;
+    // The new configs of members whose config changed
+    std::vector<ServerConfig> changed;
+    std::vector<std::string> removed;
+
+    bool empty() const {
+      return added.empty() && changed.empty() && removed.empty();
+    }
+  };
+
+  static ServerListDelta diffServerLists(
+      const std::vector<ServerConfig>& before,
+      const std::vector<ServerConfig>& after);
+
   /**
    * Handle that can be used to stop any request in progress
    **/
@@ -93,6 +124,25 @@ class ServerListGenerator {
     virtual void onServerListAvailable(
         std::vector<ServerConfig>&& results) noexcept = 0;
 
+    /**
+     * Callbacks that keep the list they were last given can have generators
+     * supporting it pass only what changed since, to
+     * onServerListDelta().  Other generators still call
+     * onServerListAvailable().
+     */
+    virtual bool wantsServerListDelta() const {
+      return false;
+    }
+
+    void serverListDeltaAvailable(ServerListDelta delta) noexcept {
+      resetGenerator();
+      serverListVersion_ = delta.version;
+      onServerListDelta(std::move(delta));
+    }
+
+    virtual void onServerListDelta(ServerListDelta&& /*delta*/) noexcept {
+    }
+
     /**
      * onServerListError will be invoked if there was a problem fetching servers
      * list.
@@ -146,6 +196,8 @@ class ServerListGenerator {
      */
     Generator* gen_;
     bool takeOwnershipOfGenerator_{false};
+    // The version of the last delta, 0 when none was received
+    uint64_t serverListVersion_{0};
   };
 
   explicit ServerListGenerator(folly::EventBase* base = nullptr)
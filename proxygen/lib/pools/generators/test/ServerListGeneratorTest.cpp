@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+#include <proxygen/lib/pools/generators/FileServerListGenerator.h>
+
+using namespace proxygen;
+using ServerConfig = ServerListGenerator::ServerConfig;
+
+namespace {
+
+ServerConfig server(const std::string& name,
+                    uint16_t port,
+                    const std::string& weight = "1") {
+  return ServerConfig(name,
+                      folly::SocketAddress("10.0.0.1", port),
+                      {{"weight", weight}});
+}
+
+std::vector<std::string> names(const std::vector<ServerConfig>& servers) {
+  std::vector<std::string> result;
+  for (const auto& server : servers) {
+    result.push_back(server.name);
+  }
+  return result;
+}
+
+class DeltaCallback : public ServerListCallback {
+ public:
+  bool wantsServerListDelta() const override {
+    return true;
+  }
+
+  void onServerListDelta(
+      ServerListGenerator::ServerListDelta&& delta) noexcept override {
+    deltas.push_back(std::move(delta));
+    status = SUCCESS;
+  }
+
+  std::vector<ServerListGenerator::ServerListDelta> deltas;
+};
+
+} // namespace
+
+TEST(ServerListGeneratorTest, DiffAddedRemoved) {
+  auto delta = ServerListGenerator::diffServerLists(
+      {server("a", 1), server("b", 2)}, {server("b", 2), server("c", 3)});
+  EXPECT_EQ(names(delta.added), std::vector<std::string>{"c"});
+  EXPECT_TRUE(delta.changed.empty());
+  EXPECT_EQ(delta.removed, std::vector<std::string>{"a"});
+  EXPECT_FALSE(delta.empty());
+}
+
+TEST(ServerListGeneratorTest, DiffChanged) {
+  // Matched by name, so a new weight or address is a change
+  auto delta = ServerListGenerator::diffServerLists(
+      {server("a", 1), server("b", 2), server("c", 3)},
+      {server("a", 1, "5"), server("b", 4), server("c", 3)});
+  EXPECT_TRUE(delta.added.empty());
+  EXPECT_TRUE(delta.removed.empty());
+  ASSERT_EQ(delta.changed.size(), 2);
+  EXPECT_EQ(delta.changed[0], server("a", 1, "5"));
+  EXPECT_EQ(delta.changed[1], server("b", 4));
+}
+
+TEST(ServerListGeneratorTest, DiffUnchanged) {
+  std::vector<ServerConfig> servers{server("a", 1), server("b", 2)};
+  EXPECT_TRUE(ServerListGenerator::diffServerLists(servers, servers).empty());
+
+  // From nothing, everything is added
+  auto delta = ServerListGenerator::diffServerLists({}, servers);
+  EXPECT_EQ(names(delta.added), (std::vector<std::string>{"a", "b"}));
+  delta = ServerListGenerator::diffServerLists(servers, {});
+  EXPECT_EQ(delta.removed, (std::vector<std::string>{"a", "b"}));
+}
+
+class FileServerListGeneratorTest : public testing::Test {
+ protected:
+  void write(const std::string& content) {
+    ASSERT_TRUE(folly::writeFile(content, path().c_str()));
+  }
+
+  std::string path() const {
+    return tmpFile_.path().string();
+  }
+
+  folly::test::TemporaryFile tmpFile_;
+};
+
+TEST_F(FileServerListGeneratorTest, Deltas) {
+  write("10.0.0.1:80\n10.0.0.2:80\n");
+  FileServerListGenerator generator(path());
+  DeltaCallback callback;
+  generator.listServers(&callback, std::chrono::milliseconds(0));
+  ASSERT_EQ(callback.deltas.size(), 1);
+  // The first one replaces whatever the callback holds
+  EXPECT_EQ(callback.deltas[0].baseVersion, 0);
+  EXPECT_EQ(callback.deltas[0].version, 1);
+  EXPECT_EQ(names(callback.deltas[0].added),
+            (std::vector<std::string>{"10.0.0.1", "10.0.0.2"}));
+
+  write("10.0.0.2:80\n10.0.0.3:80\n10.0.0.4:80\n");
+  generator.listServers(&callback, std::chrono::milliseconds(0));
+  ASSERT_EQ(callback.deltas.size(), 2);
+  const auto& delta = callback.deltas[1];
+  EXPECT_EQ(delta.baseVersion, 1);
+  EXPECT_EQ(delta.version, 2);
+  EXPECT_EQ(names(delta.added),
+            (std::vector<std::string>{"10.0.0.3", "10.0.0.4"}));
+  EXPECT_EQ(delta.removed, std::vector<std::string>{"10.0.0.1"});
+  EXPECT_TRUE(delta.changed.empty());
+
+  // Nothing changed, nothing to apply
+  generator.listServers(&callback, std::chrono::milliseconds(0));
+  ASSERT_EQ(callback.deltas.size(), 3);
+  EXPECT_TRUE(callback.deltas[2].empty());
+  EXPECT_EQ(callback.deltas[2].baseVersion, 2);
+  EXPECT_EQ(callback.deltas[2].version, 2);
+}
+
+TEST_F(FileServerListGeneratorTest, MixedCallbacks) {
+  write("10.0.0.1:80\n");
+  FileServerListGenerator generator(path());
+  DeltaCallback early;
+  generator.listServers(&early, std::chrono::milliseconds(0));
+  write("10.0.0.1:80\n10.0.0.2:80\n");
+
+  // Full lists for the others, from the kept one when unchanged
+  ServerListCallback full;
+  generator.listServers(&full, std::chrono::milliseconds(0));
+  EXPECT_EQ(names(full.servers),
+            (std::vector<std::string>{"10.0.0.1", "10.0.0.2"}));
+  generator.listServers(&full, std::chrono::milliseconds(0));
+  EXPECT_EQ(full.servers.size(), 2);
+
+  // A callback subscribed later gets the whole list
+  DeltaCallback late;
+  generator.listServers(&late, std::chrono::milliseconds(0));
+  ASSERT_EQ(late.deltas.size(), 1);
+  EXPECT_EQ(late.deltas[0].baseVersion, 0);
+  EXPECT_EQ(late.deltas[0].added.size(), 2);
+
+  // As does one that missed a version
+  generator.listServers(&early, std::chrono::milliseconds(0));
+  ASSERT_EQ(early.deltas.size(), 2);
+  EXPECT_EQ(early.deltas[1].baseVersion, 0);
+  EXPECT_EQ(early.deltas[1].version, 2);
+  EXPECT_EQ(early.deltas[1].added.size(), 2);
+}
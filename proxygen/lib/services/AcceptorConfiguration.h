@@ -22,6 +22,8 @@
 
 namespace proxygen {
 
+class HandshakeOffload;
+
 /**
  * Configuration for a single Acceptor.
  *
@@ -89,6 +91,31 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
   size_t receiveStreamWindowSize{65536};
   size_t receiveSessionWindowSize{65536};
 
+  /**
+   * Grow the HTTP/2 stream and session receive windows up to this many bytes
+   * following the connection's estimated bandwidth-delay product, within the
+   * process wide ReceiveWindowBudget.  0 disables autotuning.
+   */
+  uint32_t maxAutotunedReceiveWindow{0};
+
+  /**
+   * Coalesce the WINDOW_UPDATEs due while processing ingress into the
+   * session's next write, see HTTPSession::setWindowUpdateBatching.
+   */
+  bool batchWindowUpdates{false};
+
+  /**
+   * Grow HTTP/2 DATA frames with the connection's congestion window, see
+   * HTTPSession::setAdaptiveEgressFrameSize.
+   */
+  bool adaptiveEgressFrameSize{false};
+
+  /**
+   * Size TLS records to the connection's warmth, see
+   * HTTPSession::setDynamicTLSRecordSize.
+   */
+  bool dynamicTLSRecordSize{false};
+
   /**
    * These parameters control how many bytes HTTPSession's will buffer in user
    * space before applying backpressure to handlers.  -1 means use the
@@ -100,6 +127,50 @@ struct AcceptorConfiguration : public wangle::ServerSocketConfig {
    * Determines if HTTP2 ping is enabled on connection
    **/
   bool HTTP2PingEnabled{false};
+
+  /**
+   * Hand the record layer of established fizz (TLS 1.3) connections to the
+   * kernel (TLS_TX/TLS_RX), so encryption happens in the socket write path
+   * and zero copy writes apply to TLS traffic.  Connections whose cipher or
+   * state the kernel can't take over stay on fizz.  Ignored on platforms
+   * without kTLS.
+   */
+  bool kernelTLSOffload{false};
+
+  /**
+   * Sign the fizz (TLS 1.3) handshakes on this pool rather than on the IO
+   * threads, see HandshakeOffload.  Shared by the acceptors using it.
+   * Ignored for a fizz context passed to HTTPAcceptor::init, whose
+   * CertManager HandshakeOffload::wrap can wrap instead.
+   */
+  std::shared_ptr<HandshakeOffload> handshakeOffload;
+
+  /**
+   * Writes carrying at least this many body bytes request MSG_ZEROCOPY, see
+   * HTTPSession::setZeroCopyEgressThreshold.  Needs a transport with zero
+   * copy enabled.  0 disables.
+   */
+  uint64_t zeroCopyEgressThreshold{0};
+
+  /**
+   * Busy poll the device queue of accepted sockets for this long when
+   * reading (SO_BUSY_POLL).  Past net.core.busy_read it needs
+   * CAP_NET_ADMIN.  0 disables.
+   */
+  uint32_t busyPollMicros{0};
+
+  /**
+   * Sessions write in the loop iteration that generated the egress, see
+   * HTTPSession::setWriteInCurrentLoop.
+   */
+  bool writeInCurrentLoop{false};
+
+  /**
+   * Bytes a session writes per loop callback before yielding to the other
+   * sessions of its EventBase, see HTTPSession::setMaxEgressBytesPerLoop.
+   * 0 disables.
+   */
+  uint64_t maxEgressBytesPerLoop{0};
 };
 
 } // namespace proxygen
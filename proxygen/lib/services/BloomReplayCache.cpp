@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/services/BloomReplayCache.h>
+
+#include <algorithm>
+#include <folly/hash/SpookyHashV2.h>
+#include <glog/logging.h>
+
+using fizz::server::ReplayCacheResult;
+
+namespace proxygen {
+
+ShardedBloomReplayCache::ShardedBloomReplayCache(Options options)
+    : options_(std::move(options)),
+      numWords_(std::max<size_t>((options_.bitsPerShard + 63) / 64, 1)) {
+  CHECK_GT(options_.numShards, 0);
+  CHECK_GT(options_.numHashes, 0);
+  auto now = Clock::now();
+  for (size_t i = 0; i < options_.numShards; i++) {
+    auto shard = std::make_unique<Shard>();
+    shard->current.resize(numWords_);
+    shard->previous.resize(numWords_);
+    shard->rotated = now;
+    shards_.push_back(std::move(shard));
+  }
+}
+
+folly::SemiFuture<ReplayCacheResult> ShardedBloomReplayCache::check(
+    folly::ByteRange identifier) {
+  return checkNow(identifier);
+}
+
+ReplayCacheResult ShardedBloomReplayCache::checkNow(
+    folly::ByteRange identifier, Clock::time_point now) {
+  stats_.checked++;
+  uint64_t h1 = 0;
+  uint64_t h2 = 0;
+  folly::hash::SpookyHashV2::Hash128(
+      identifier.data(), identifier.size(), &h1, &h2);
+  auto& shard = *shards_[h1 % shards_.size()];
+  // The shard took the low bits, the bits of the filter come from the rest
+  h1 /= shards_.size();
+  // Odd, so that the probes cycle over every bit
+  h2 |= 1;
+  const uint64_t numBits = numWords_ * 64;
+
+  std::lock_guard<std::mutex> guard(shard.mutex);
+  if (now - shard.rotated >= options_.window) {
+    if (now - shard.rotated >= 2 * options_.window) {
+      std::fill(shard.previous.begin(), shard.previous.end(), 0);
+    } else {
+      std::swap(shard.previous, shard.current);
+    }
+    std::fill(shard.current.begin(), shard.current.end(), 0);
+    shard.rotated = now;
+  }
+  bool inCurrent = true;
+  bool inPrevious = true;
+  for (size_t i = 0; i < options_.numHashes; i++) {
+    auto bit = (h1 + i * h2) % numBits;
+    auto mask = uint64_t(1) << (bit % 64);
+    auto& word = shard.current[bit / 64];
+    inCurrent = inCurrent && (word & mask);
+    inPrevious = inPrevious && (shard.previous[bit / 64] & mask);
+    word |= mask;
+  }
+  if (inCurrent || inPrevious) {
+    stats_.replays++;
+    return ReplayCacheResult::MaybeReplay;
+  }
+  return ReplayCacheResult::NotReplay;
+}
+
+} // namespace proxygen
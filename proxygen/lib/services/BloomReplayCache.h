@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fizz/server/ReplayCache.h>
+#include <folly/Range.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * Anti-replay cache for TLS 1.3 and QUIC 0-RTT, to pass to
+ * FizzServerContext::setEarlyDataSettings().  Remembers the identifiers of
+ * the early data accepted over the last window in bloom filters, so that
+ * fizz falls back to a full handshake when one comes again.  The ticket
+ * age check turns away the replays older than the clock skew tolerance, so
+ * window should be at least its width.
+ *
+ * The filters are split in shards with a lock each, which the IO threads
+ * rarely contend for.  Each shard keeps two generations, swapped every
+ * window: identifiers are remembered for one to two windows.  False
+ * positives only cost a round trip, which bitsPerShard and numHashes keep
+ * rare.
+ */
+class ShardedBloomReplayCache : public fizz::server::ReplayCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    size_t numShards{16};
+    // Rounded up to 64.  About 10 bits per identifier per window keep
+    // false positives around 1%.
+    size_t bitsPerShard{1 << 20};
+    size_t numHashes{7};
+    std::chrono::milliseconds window{std::chrono::seconds(10)};
+  };
+
+  struct Stats {
+    std::atomic<uint64_t> checked{0};
+    std::atomic<uint64_t> replays{0};
+  };
+
+  explicit ShardedBloomReplayCache(Options options);
+
+  folly::SemiFuture<fizz::server::ReplayCacheResult> check(
+      folly::ByteRange identifier) override;
+
+  // NotReplay the first time identifier is seen in a window, then
+  // MaybeReplay
+  fizz::server::ReplayCacheResult checkNow(
+      folly::ByteRange identifier, Clock::time_point now = Clock::now());
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    std::vector<uint64_t> current;
+    std::vector<uint64_t> previous;
+    Clock::time_point rotated;
+  };
+
+  const Options options_;
+  const size_t numWords_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  Stats stats_;
+};
+
+} // namespace proxygen
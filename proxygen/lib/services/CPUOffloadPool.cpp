@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/services/CPUOffloadPool.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/Indestructible.h>
+#include <folly/String.h>
+#include <folly/system/ThreadName.h>
+#include <glog/logging.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// NUMA node by CPU from sysfs, empty if there is only one node
+std::vector<int> readCPUNodes() {
+  std::vector<int> cpuNodes;
+#ifdef __linux__
+  int numNodes = 0;
+  for (int node = 0;; node++) {
+    std::string list;
+    auto path = folly::to<std::string>(
+        "/sys/devices/system/node/node", node, "/cpulist");
+    if (!folly::readFile(path.c_str(), list)) {
+      break;
+    }
+    auto cpus = proxygen::CPUOffloadPool::parseCPUList(list);
+    if (cpus.empty()) {
+      // Memory-only node
+      continue;
+    }
+    for (auto cpu : cpus) {
+      if (cpu >= cpuNodes.size()) {
+        cpuNodes.resize(cpu + 1, -1);
+      }
+      cpuNodes[cpu] = numNodes;
+    }
+    numNodes++;
+  }
+  if (numNodes <= 1) {
+    cpuNodes.clear();
+  }
+#endif
+  return cpuNodes;
+}
+
+} // namespace
+
+namespace proxygen {
+
+CPUOffloadPool::CPUOffloadPool(Options options) {
+  auto numThreads = options.numThreads;
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (options.numaAware) {
+    cpuNodes_ = readCPUNodes();
+  }
+  size_t numNodes = 1;
+  for (auto node : cpuNodes_) {
+    numNodes = std::max(numNodes, size_t(node + 1));
+  }
+  // Workers are dealt across the nodes, so every node has one when there
+  // are enough threads
+  numNodes = std::min(numNodes, numThreads);
+  nodeWorkers_.resize(numNodes);
+  workers_.reserve(numThreads);
+  for (size_t i = 0; i < numThreads; i++) {
+    auto worker = std::make_unique<Worker>();
+    worker->node = i % numNodes;
+    nodeWorkers_[worker->node].push_back(i);
+    workers_.push_back(std::move(worker));
+  }
+  for (size_t i = 0; i < numThreads; i++) {
+    workers_[i]->thread = std::thread([this, i, name = options.threadName] {
+      folly::setThreadName(folly::to<std::string>(name, i));
+      runWorker(i);
+    });
+  }
+#ifdef __linux__
+  if (numNodes > 1) {
+    for (auto& worker : workers_) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for (size_t cpu = 0; cpu < cpuNodes_.size(); cpu++) {
+        if (cpuNodes_[cpu] == int(worker->node)) {
+          CPU_SET(cpu, &cpus);
+        }
+      }
+      pthread_setaffinity_np(
+          worker->thread.native_handle(), sizeof(cpus), &cpus);
+    }
+  }
+#endif
+}
+
+CPUOffloadPool::~CPUOffloadPool() {
+  {
+    std::lock_guard<std::mutex> lock(idleMutex_);
+    stopping_ = true;
+  }
+  idleCv_.notify_all();
+  for (auto& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+CPUOffloadPool& CPUOffloadPool::getDefault() {
+  static folly::Indestructible<CPUOffloadPool> pool;
+  return *pool;
+}
+
+int CPUOffloadPool::getCurrentNode() const {
+#ifdef __linux__
+  int cpu = sched_getcpu();
+  if (cpu >= 0 && size_t(cpu) < cpuNodes_.size() && cpuNodes_[cpu] >= 0 &&
+      size_t(cpuNodes_[cpu]) < nodeWorkers_.size()) {
+    return cpuNodes_[cpu];
+  }
+#endif
+  return 0;
+}
+
+std::vector<size_t> CPUOffloadPool::parseCPUList(const std::string& list) {
+  std::vector<size_t> cpus;
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', folly::trimWhitespace(list), ranges, true);
+  for (auto range : ranges) {
+    folly::StringPiece first;
+    folly::StringPiece last;
+    if (!folly::split('-', range, first, last)) {
+      first = last = range;
+    }
+    auto from = folly::tryTo<size_t>(folly::trimWhitespace(first));
+    auto to = folly::tryTo<size_t>(folly::trimWhitespace(last));
+    if (!from || !to || *from > *to) {
+      LOG(ERROR) << "Invalid CPU list: " << list;
+      return {};
+    }
+    for (auto cpu = *from; cpu <= *to; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+void CPUOffloadPool::addWithNode(folly::Func func, int node) {
+  if (node == kCurrentNode) {
+    node = getCurrentNode();
+  }
+  CHECK_GE(node, 0);
+  const auto& candidates = nodeWorkers_[size_t(node) % nodeWorkers_.size()];
+  auto& worker = *workers_[candidates[nextWorker_.fetch_add(
+                                          1, std::memory_order_relaxed) %
+                                      candidates.size()]];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks.push_back(std::move(func));
+  }
+  // Counted once queued, so a woken worker always finds it
+  pending_.fetch_add(1, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(idleMutex_);
+  }
+  idleCv_.notify_one();
+}
+
+void CPUOffloadPool::runWorker(size_t index) {
+  while (true) {
+    folly::Func task;
+    if (popTask(index, task)) {
+      pending_.fetch_sub(1, std::memory_order_relaxed);
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idleMutex_);
+    idleCv_.wait(lock, [this] {
+      return pending_.load(std::memory_order_acquire) > 0 || stopping_;
+    });
+    if (stopping_ && pending_.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+bool CPUOffloadPool::popTask(size_t index, folly::Func& task) {
+  auto& self = *workers_[index];
+  {
+    std::lock_guard<std::mutex> lock(self.mutex);
+    if (!self.tasks.empty()) {
+      task = std::move(self.tasks.front());
+      self.tasks.pop_front();
+      return true;
+    }
+  }
+  // Steal from the same node first, starting after ourselves so the
+  // thieves spread out
+  const auto& local = nodeWorkers_[self.node];
+  for (size_t i = 1; i <= local.size(); i++) {
+    auto victim = local[(index + i) % local.size()];
+    if (victim != index && stealFrom(*workers_[victim], task)) {
+      return true;
+    }
+  }
+  for (size_t i = 1; i < workers_.size(); i++) {
+    auto& victim = *workers_[(index + i) % workers_.size()];
+    if (victim.node != self.node && stealFrom(victim, task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CPUOffloadPool::stealFrom(Worker& victim, folly::Func& task) {
+  std::lock_guard<std::mutex> lock(victim.mutex);
+  if (victim.tasks.empty()) {
+    return false;
+  }
+  // The owner takes the oldest work, thieves the newest
+  task = std::move(victim.tasks.back());
+  victim.tasks.pop_back();
+  return true;
+}
+
+std::shared_ptr<CPUOffloadPool::CompletionQueue>
+CPUOffloadPool::getCompletionQueue(folly::EventBase* evb) {
+  evb->dcheckIsInEventBaseThread();
+  if (auto completions = completions_.get(*evb)) {
+    return *completions;
+  }
+  return completions_.emplace(*evb, std::make_shared<CompletionQueue>(evb));
+}
+
+void CPUOffloadPool::CompletionQueue::add(folly::Func func) {
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(std::move(func));
+    schedule = !scheduled_;
+    scheduled_ = true;
+  }
+  if (schedule) {
+    evb_->runInEventBaseThread([self = shared_from_this()] { self->run(); });
+  }
+}
+
+void CPUOffloadPool::CompletionQueue::run() {
+  std::vector<folly::Func> completions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    completions.swap(pending_);
+    scheduled_ = false;
+  }
+  for (auto& completion : completions) {
+    completion();
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <folly/Executor.h>
+#include <folly/Function.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventBaseLocal.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * A work-stealing thread pool for handlers that have CPU-bound or blocking
+ * work to do off their EventBase.
+ *
+ * Each worker has its own queue.  Work goes to a worker on the submitting
+ * thread's NUMA node, and idle workers steal from their own node before
+ * the others.  submit() runs the result callback back on the originating
+ * EventBase, and the callbacks that complete together reach the EventBase
+ * as one notification instead of one runInEventBaseThread each.
+ */
+class CPUOffloadPool : public folly::Executor {
+ public:
+  // The submitting thread's node
+  static constexpr int kCurrentNode = -1;
+
+  struct Options {
+    // 0 for one per CPU
+    size_t numThreads{0};
+    // Spread the workers across NUMA nodes and pin them to their node's
+    // CPUs, when there is more than one node
+    bool numaAware{true};
+    std::string threadName{"CPUOffload"};
+  };
+
+  CPUOffloadPool() : CPUOffloadPool(Options()) {
+  }
+  explicit CPUOffloadPool(Options options);
+
+  // Runs the queued work, then joins the workers
+  ~CPUOffloadPool() override;
+
+  CPUOffloadPool(const CPUOffloadPool&) = delete;
+  CPUOffloadPool& operator=(const CPUOffloadPool&) = delete;
+
+  // A process-wide pool with the default options, created on first use
+  static CPUOffloadPool& getDefault();
+
+  // folly::Executor
+  void add(folly::Func func) override {
+    addWithNode(std::move(func), kCurrentNode);
+  }
+
+  void addWithNode(folly::Func func, int node);
+
+  /**
+   * Runs work() on the pool, then done(result) on evb; done() takes no
+   * argument when work returns void.  Must be called from evb's thread,
+   * and evb stays alive until done has been queued on it.
+   */
+  template <typename Work, typename Done>
+  void submit(folly::EventBase* evb,
+              Work&& work,
+              Done&& done,
+              int node = kCurrentNode) {
+    auto completions = getCompletionQueue(evb);
+    addWithNode(
+        [work = std::forward<Work>(work),
+         done = std::forward<Done>(done),
+         completions = std::move(completions),
+         keepAlive = folly::getKeepAliveToken(evb)]() mutable {
+          if constexpr (std::is_void_v<std::invoke_result_t<Work&>>) {
+            work();
+            completions->add(std::move(done));
+          } else {
+            completions->add(
+                [done = std::move(done), result = work()]() mutable {
+                  done(std::move(result));
+                });
+          }
+        },
+        node);
+  }
+
+  [[nodiscard]] size_t getNumThreads() const {
+    return workers_.size();
+  }
+
+  [[nodiscard]] size_t getNumNodes() const {
+    return nodeWorkers_.size();
+  }
+
+  // Work queued and not started yet
+  [[nodiscard]] size_t getQueueDepth() const {
+    return pending_.load(std::memory_order_relaxed);
+  }
+
+  // The NUMA node of the calling thread's CPU, 0 if unknown
+  [[nodiscard]] int getCurrentNode() const;
+
+  // Parses a sysfs CPU list such as "0-3,8,10-11"
+  static std::vector<size_t> parseCPUList(const std::string& list);
+
+ private:
+  // Callbacks queued for one EventBase, run in a batch on it
+  class CompletionQueue
+      : public std::enable_shared_from_this<CompletionQueue> {
+   public:
+    explicit CompletionQueue(folly::EventBase* evb) : evb_(evb) {
+    }
+
+    void add(folly::Func func);
+
+   private:
+    void run();
+
+    folly::EventBase* evb_;
+    std::mutex mutex_;
+    std::vector<folly::Func> pending_;
+    bool scheduled_{false};
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<folly::Func> tasks;
+    size_t node{0};
+    std::thread thread;
+  };
+
+  std::shared_ptr<CompletionQueue> getCompletionQueue(folly::EventBase* evb);
+
+  void runWorker(size_t index);
+  bool popTask(size_t index, folly::Func& task);
+  bool stealFrom(Worker& victim, folly::Func& task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  // Worker indexes by NUMA node
+  std::vector<std::vector<size_t>> nodeWorkers_;
+  // NUMA node by CPU, empty when the pool ignores NUMA
+  std::vector<int> cpuNodes_;
+  std::atomic<size_t> nextWorker_{0};
+
+  std::mutex idleMutex_;
+  std::condition_variable idleCv_;
+  std::atomic<size_t> pending_{0};
+  bool stopping_{false};
+
+  folly::EventBaseLocal<std::shared_ptr<CompletionQueue>> completions_;
+};
+
+} // namespace proxygen
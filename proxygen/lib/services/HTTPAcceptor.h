@@ -13,6 +13,7 @@
 #include <proxygen/lib/services/AcceptorConfiguration.h>
 #include <proxygen/lib/utils/AsyncTimeoutSet.h>
 #include <proxygen/lib/utils/WheelTimerInstance.h>
+#include <proxygen/lib/services/HandshakeOffload.h>
 #include <wangle/acceptor/Acceptor.h>
 
 namespace proxygen {
@@ -56,6 +57,20 @@ class HTTPAcceptor : public wangle::Acceptor {
         accConfig_.transactionIdleTimeout, eventBase);
   }
 
+  std::shared_ptr<fizz::server::FizzServerContext> createFizzContext()
+      override {
+    auto ctx = Acceptor::createFizzContext();
+    if (!ctx || !accConfig_.handshakeOffload) {
+      return ctx;
+    }
+    // Signs with the certificates ctx already has, as wangle loaded them,
+    // rather than loading them again without a password collector.  The
+    // copy keeps ctx's own CertManager.
+    ctx->setCertManager(accConfig_.handshakeOffload->wrap(
+        std::make_shared<const fizz::server::FizzServerContext>(*ctx)));
+    return ctx;
+  }
+
  private:
   AsyncTimeoutSet::UniquePtr tcpEventsTimeouts_;
 };
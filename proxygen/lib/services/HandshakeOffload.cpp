@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/services/HandshakeOffload.h>
+
+#include <folly/io/async/EventBaseManager.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+namespace {
+
+// A certificate whose signatures go through HandshakeOffload::sign
+class OffloadedSelfCert : public fizz::server::AsyncSelfCert {
+ public:
+  OffloadedSelfCert(std::shared_ptr<fizz::SelfCert> cert,
+                    std::shared_ptr<HandshakeOffload> offload)
+      : cert_(std::move(cert)), offload_(std::move(offload)) {
+  }
+
+  std::string getIdentity() const override {
+    return cert_->getIdentity();
+  }
+
+  std::vector<std::string> getAltIdentities() const override {
+    return cert_->getAltIdentities();
+  }
+
+  std::vector<fizz::SignatureScheme> getSigSchemes() const override {
+    return cert_->getSigSchemes();
+  }
+
+  fizz::CertificateMsg getCertMessage(
+      fizz::Buf certificateRequestContext) const override {
+    return cert_->getCertMessage(std::move(certificateRequestContext));
+  }
+
+  fizz::CompressedCertificate getCompressedCert(
+      fizz::CertificateCompressionAlgorithm algo) const override {
+    return cert_->getCompressedCert(algo);
+  }
+
+  folly::ssl::X509UniquePtr getX509() const override {
+    return cert_->getX509();
+  }
+
+  fizz::Buf sign(fizz::SignatureScheme scheme,
+                 fizz::CertificateVerifyContext context,
+                 folly::ByteRange toBeSigned) const override {
+    return cert_->sign(scheme, context, toBeSigned);
+  }
+
+  folly::SemiFuture<folly::Optional<fizz::Buf>> signFuture(
+      fizz::SignatureScheme scheme,
+      fizz::CertificateVerifyContext context,
+      std::unique_ptr<folly::IOBuf> toBeSigned) const override {
+    return offload_->sign(cert_, scheme, context, std::move(toBeSigned));
+  }
+
+ private:
+  std::shared_ptr<fizz::SelfCert> cert_;
+  std::shared_ptr<HandshakeOffload> offload_;
+};
+
+// Hands out the certificates of another CertManager, wrapped
+class OffloadingCertManager : public fizz::server::CertManager {
+ public:
+  OffloadingCertManager(std::shared_ptr<fizz::server::CertManager> certManager,
+                        std::shared_ptr<HandshakeOffload> offload)
+      : certManager_(std::move(certManager)), offload_(std::move(offload)) {
+  }
+
+  CertMatch getCert(
+      const folly::Optional<std::string>& sni,
+      const std::vector<fizz::SignatureScheme>& supportedSigSchemes,
+      const std::vector<fizz::SignatureScheme>& peerSigSchemes,
+      const std::vector<fizz::Extension>& peerExtensions) const override {
+    auto match = certManager_->getCert(
+        sni, supportedSigSchemes, peerSigSchemes, peerExtensions);
+    if (match) {
+      match->cert = offload_->wrap(std::move(match->cert));
+    }
+    return match;
+  }
+
+  std::shared_ptr<fizz::SelfCert> getCert(
+      const std::string& identity) const override {
+    return offload_->wrap(certManager_->getCert(identity));
+  }
+
+ private:
+  std::shared_ptr<fizz::server::CertManager> certManager_;
+  std::shared_ptr<HandshakeOffload> offload_;
+};
+
+// Hands out the certificates of a FizzServerContext's CertManager
+class ContextCertManager : public fizz::server::CertManager {
+ public:
+  explicit ContextCertManager(
+      std::shared_ptr<const fizz::server::FizzServerContext> ctx)
+      : ctx_(std::move(ctx)) {
+  }
+
+  CertMatch getCert(
+      const folly::Optional<std::string>& sni,
+      const std::vector<fizz::SignatureScheme>& supportedSigSchemes,
+      const std::vector<fizz::SignatureScheme>& peerSigSchemes,
+      const std::vector<fizz::Extension>& peerExtensions) const override {
+    return ctx_->getCert(
+        sni, supportedSigSchemes, peerSigSchemes, peerExtensions);
+  }
+
+  std::shared_ptr<fizz::SelfCert> getCert(
+      const std::string& identity) const override {
+    return ctx_->getCert(identity);
+  }
+
+ private:
+  std::shared_ptr<const fizz::server::FizzServerContext> ctx_;
+};
+
+CPUOffloadPool::Options makePoolOptions(const HandshakeOffload::Options& in) {
+  CPUOffloadPool::Options options;
+  options.numThreads = in.numThreads;
+  options.threadName = in.threadName;
+  return options;
+}
+
+} // namespace
+
+std::shared_ptr<HandshakeOffload> HandshakeOffload::make(Options options) {
+  return std::shared_ptr<HandshakeOffload>(
+      new HandshakeOffload(std::move(options)));
+}
+
+HandshakeOffload::HandshakeOffload(Options options)
+    : maxInFlightPerThread_(options.maxInFlightPerThread),
+      pool_(makePoolOptions(options)) {
+}
+
+std::shared_ptr<fizz::server::CertManager> HandshakeOffload::wrap(
+    std::shared_ptr<fizz::server::CertManager> certManager) {
+  CHECK(certManager);
+  return std::make_shared<OffloadingCertManager>(std::move(certManager),
+                                                 shared_from_this());
+}
+
+std::shared_ptr<fizz::server::CertManager> HandshakeOffload::wrap(
+    std::shared_ptr<const fizz::server::FizzServerContext> ctx) {
+  CHECK(ctx);
+  return wrap(std::make_shared<ContextCertManager>(std::move(ctx)));
+}
+
+std::shared_ptr<fizz::SelfCert> HandshakeOffload::wrap(
+    std::shared_ptr<fizz::SelfCert> cert) {
+  // Certificates already signing asynchronously, eg. with a remote key,
+  // are left alone
+  if (!cert || dynamic_cast<fizz::server::AsyncSelfCert*>(cert.get())) {
+    return cert;
+  }
+  return std::make_shared<OffloadedSelfCert>(std::move(cert),
+                                             shared_from_this());
+}
+
+folly::SemiFuture<HandshakeOffload::Signature> HandshakeOffload::sign(
+    std::shared_ptr<const fizz::SelfCert> cert,
+    fizz::SignatureScheme scheme,
+    fizz::CertificateVerifyContext context,
+    std::unique_ptr<folly::IOBuf> toBeSigned) {
+  auto evb = folly::EventBaseManager::get()->getExistingEventBase();
+  size_t* inFlight = evb ? &inFlight_.getOrCreate(*evb, 0) : nullptr;
+  if (!inFlight || *inFlight >= maxInFlightPerThread_) {
+    VLOG(4) << "Signing inline, in flight="
+            << (inFlight ? *inFlight : size_t(0));
+    inlined_.fetch_add(1, std::memory_order_relaxed);
+    return folly::makeSemiFuture(signNow(*cert, scheme, context, *toBeSigned));
+  }
+
+  ++*inFlight;
+  offloaded_.fetch_add(1, std::memory_order_relaxed);
+  auto [promise, future] = folly::makePromiseContract<Signature>();
+  // The pending callback keeps this, and so pool_, alive
+  pool_.submit(
+      evb,
+      [this,
+       cert = std::move(cert),
+       scheme,
+       context,
+       toBeSigned = std::move(toBeSigned)]() {
+        return signNow(*cert, scheme, context, *toBeSigned);
+      },
+      [self = shared_from_this(), evb, promise = std::move(promise)](
+          Signature signature) mutable {
+        --*self->inFlight_.get(*evb);
+        promise.setValue(std::move(signature));
+      });
+  return std::move(future);
+}
+
+HandshakeOffload::Signature HandshakeOffload::signNow(
+    const fizz::SelfCert& cert,
+    fizz::SignatureScheme scheme,
+    fizz::CertificateVerifyContext context,
+    folly::IOBuf& toBeSigned) {
+  try {
+    auto data = toBeSigned.coalesce();
+    return cert.sign(scheme, context, data);
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Signing with " << cert.getIdentity()
+               << " failed: " << ex.what();
+    failed_.fetch_add(1, std::memory_order_relaxed);
+    return folly::none;
+  }
+}
+
+size_t HandshakeOffload::getInFlight(folly::EventBase& evb) const {
+  auto inFlight = inFlight_.get(evb);
+  return inFlight ? *inFlight : 0;
+}
+
+HandshakeOffload::Stats HandshakeOffload::getStats() const {
+  Stats stats;
+  stats.offloaded = offloaded_.load(std::memory_order_relaxed);
+  stats.inlined = inlined_.load(std::memory_order_relaxed);
+  stats.failed = failed_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace proxygen
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <fizz/server/AsyncSelfCert.h>
+#include <fizz/server/CertManager.h>
+#include <fizz/server/FizzServerContext.h>
+#include <folly/futures/Future.h>
+#include <folly/io/async/EventBaseLocal.h>
+#include <memory>
+#include <proxygen/lib/services/CPUOffloadPool.h>
+#include <string>
+
+namespace proxygen {
+
+/**
+ * Moves the private key operations of fizz (TLS 1.3) handshakes off the IO
+ * threads to a dedicated CPUOffloadPool, so that a burst of handshakes
+ * doesn't stall the established connections sharing their EventBase.
+ *
+ * wrap() turns a CertManager's certificates into AsyncSelfCerts: fizz
+ * suspends the handshake until the signature is back on its EventBase.
+ * Every EventBase keeps at most maxInFlightPerThread signatures on the
+ * pool, past which it signs inline, as without offload: a thread flooded
+ * with handshakes paces itself instead of growing the queue.
+ */
+class HandshakeOffload
+    : public std::enable_shared_from_this<HandshakeOffload> {
+ public:
+  struct Options {
+    // 0 for one per CPU
+    size_t numThreads{0};
+    size_t maxInFlightPerThread{64};
+    std::string threadName{"TLSSign"};
+  };
+
+  struct Stats {
+    // Signatures computed on the pool
+    uint64_t offloaded{0};
+    // Signatures computed on the IO thread, over the in-flight limit
+    uint64_t inlined{0};
+    uint64_t failed{0};
+  };
+
+  // None if signing failed
+  using Signature = folly::Optional<std::unique_ptr<folly::IOBuf>>;
+
+  static std::shared_ptr<HandshakeOffload> make(Options options);
+
+  // Certificates found by certManager sign on the pool
+  std::shared_ptr<fizz::server::CertManager> wrap(
+      std::shared_ptr<fizz::server::CertManager> certManager);
+
+  // Certificates found by the cert manager of ctx sign on the pool
+  std::shared_ptr<fizz::server::CertManager> wrap(
+      std::shared_ptr<const fizz::server::FizzServerContext> ctx);
+
+  std::shared_ptr<fizz::SelfCert> wrap(std::shared_ptr<fizz::SelfCert> cert);
+
+  /**
+   * Signs toBeSigned with cert, on the pool from an EventBase thread under
+   * its limit, inline otherwise.
+   */
+  folly::SemiFuture<Signature> sign(
+      std::shared_ptr<const fizz::SelfCert> cert,
+      fizz::SignatureScheme scheme,
+      fizz::CertificateVerifyContext context,
+      std::unique_ptr<folly::IOBuf> toBeSigned);
+
+  // Signatures waiting for a pool thread, across EventBases
+  size_t getQueueDepth() const {
+    return pool_.getQueueDepth();
+  }
+
+  // evb's signatures on the pool, from its thread
+  size_t getInFlight(folly::EventBase& evb) const;
+
+  Stats getStats() const;
+
+ private:
+  explicit HandshakeOffload(Options options);
+
+  Signature signNow(const fizz::SelfCert& cert,
+                    fizz::SignatureScheme scheme,
+                    fizz::CertificateVerifyContext context,
+                    folly::IOBuf& toBeSigned);
+
+  size_t maxInFlightPerThread_;
+  std::atomic<uint64_t> offloaded_{0};
+  std::atomic<uint64_t> inlined_{0};
+  std::atomic<uint64_t> failed_{0};
+  mutable folly::EventBaseLocal<size_t> inFlight_;
+  CPUOffloadPool pool_;
+};
+
+} // namespace proxygen
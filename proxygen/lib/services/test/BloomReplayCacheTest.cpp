@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+
+#include "proxygen/lib/services/BloomReplayCache.h"
+
+using namespace proxygen;
+using fizz::server::ReplayCacheResult;
+
+namespace {
+
+folly::ByteRange range(const std::string& str) {
+  return folly::StringPiece(str);
+}
+
+} // namespace
+
+TEST(BloomReplayCacheTest, DetectsReplays) {
+  ShardedBloomReplayCache cache({});
+  auto now = ShardedBloomReplayCache::Clock::now();
+  for (auto i = 0; i < 1000; i++) {
+    auto id = folly::to<std::string>("binder", i);
+    EXPECT_EQ(cache.checkNow(range(id), now), ReplayCacheResult::NotReplay);
+    EXPECT_EQ(cache.checkNow(range(id), now), ReplayCacheResult::MaybeReplay);
+  }
+  EXPECT_EQ(cache.getStats().checked, 2000);
+  EXPECT_EQ(cache.getStats().replays, 1000);
+
+  EXPECT_EQ(std::move(cache.check(range("binder0"))).get(),
+            ReplayCacheResult::MaybeReplay);
+}
+
+TEST(BloomReplayCacheTest, ForgetsAfterTwoWindows) {
+  ShardedBloomReplayCache::Options options;
+  options.numShards = 1;
+  options.window = std::chrono::seconds(10);
+  ShardedBloomReplayCache cache(options);
+  auto now = ShardedBloomReplayCache::Clock::now();
+  EXPECT_EQ(cache.checkNow(range("old"), now), ReplayCacheResult::NotReplay);
+
+  // Still remembered through the next window
+  now += std::chrono::seconds(15);
+  EXPECT_EQ(cache.checkNow(range("old"), now),
+            ReplayCacheResult::MaybeReplay);
+  EXPECT_EQ(cache.checkNow(range("new"), now), ReplayCacheResult::NotReplay);
+
+  // Seen again, so remembered past the next swap
+  now += std::chrono::seconds(10);
+  EXPECT_EQ(cache.checkNow(range("new"), now),
+            ReplayCacheResult::MaybeReplay);
+  // Unless two windows go by without it
+  now += std::chrono::seconds(30);
+  EXPECT_EQ(cache.checkNow(range("new"), now), ReplayCacheResult::NotReplay);
+}
+
+TEST(BloomReplayCacheTest, FalsePositivesAreRare) {
+  ShardedBloomReplayCache::Options options;
+  options.numShards = 4;
+  options.bitsPerShard = 100000;
+  ShardedBloomReplayCache cache(options);
+  auto now = ShardedBloomReplayCache::Clock::now();
+  // 10 bits per identifier
+  size_t falsePositives = 0;
+  for (auto i = 0; i < 40000; i++) {
+    auto id = folly::to<std::string>("ticket", i);
+    falsePositives +=
+        cache.checkNow(range(id), now) == ReplayCacheResult::MaybeReplay;
+  }
+  EXPECT_LT(falsePositives, 400);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+
+#include "proxygen/lib/services/CPUOffloadPool.h"
+
+using namespace proxygen;
+
+namespace {
+
+CPUOffloadPool::Options makeOptions(size_t numThreads) {
+  CPUOffloadPool::Options options;
+  options.numThreads = numThreads;
+  return options;
+}
+
+} // namespace
+
+TEST(CPUOffloadPoolTest, ParseCPUList) {
+  EXPECT_EQ(CPUOffloadPool::parseCPUList("0-3,8,10-11\n"),
+            std::vector<size_t>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(CPUOffloadPool::parseCPUList("5"), std::vector<size_t>({5}));
+  EXPECT_TRUE(CPUOffloadPool::parseCPUList("").empty());
+  EXPECT_TRUE(CPUOffloadPool::parseCPUList("3-1").empty());
+  EXPECT_TRUE(CPUOffloadPool::parseCPUList("a-b").empty());
+}
+
+TEST(CPUOffloadPoolTest, SubmitReturnsToEventBase) {
+  CPUOffloadPool pool(makeOptions(2));
+  EXPECT_EQ(pool.getNumThreads(), 2);
+  folly::EventBase evb;
+  auto evbThread = std::this_thread::get_id();
+  std::thread::id workThread;
+  int result = 0;
+  bool voidDone = false;
+  pool.submit(
+      &evb,
+      [&] {
+        workThread = std::this_thread::get_id();
+        return 42;
+      },
+      [&](int value) {
+        EXPECT_TRUE(evb.isInEventBaseThread());
+        result = value;
+      });
+  pool.submit(
+      &evb, [] {}, [&] { voidDone = true; });
+  while (result == 0 || !voidDone) {
+    evb.loopOnce();
+  }
+  EXPECT_EQ(result, 42);
+  EXPECT_NE(workThread, evbThread);
+}
+
+TEST(CPUOffloadPoolTest, ManySubmissions) {
+  CPUOffloadPool pool(makeOptions(4));
+  folly::EventBase evb;
+  constexpr int kNumTasks = 10000;
+  int done = 0;
+  int64_t sum = 0;
+  for (int i = 0; i < kNumTasks; i++) {
+    pool.submit(
+        &evb,
+        [i] { return std::make_unique<int>(i); },
+        [&](std::unique_ptr<int> value) {
+          done++;
+          sum += *value;
+        });
+  }
+  while (done < kNumTasks) {
+    evb.loopOnce();
+  }
+  EXPECT_EQ(sum, int64_t(kNumTasks) * (kNumTasks - 1) / 2);
+}
+
+TEST(CPUOffloadPoolTest, IdleWorkerSteals) {
+  CPUOffloadPool pool(makeOptions(2));
+  folly::Baton<> blocked;
+  folly::Baton<> release;
+  pool.add([&] {
+    blocked.post();
+    release.wait();
+  });
+  blocked.wait();
+  // Half of these queue behind the blocked worker
+  constexpr int kNumTasks = 10;
+  std::atomic<int> ran{0};
+  folly::Baton<> allRan;
+  for (int i = 0; i < kNumTasks; i++) {
+    pool.add([&] {
+      if (++ran == kNumTasks) {
+        allRan.post();
+      }
+    });
+  }
+  EXPECT_TRUE(allRan.try_wait_for(std::chrono::seconds(10)));
+  release.post();
+}
+
+TEST(CPUOffloadPoolTest, DrainsOnDestruction) {
+  std::atomic<int> ran{0};
+  {
+    CPUOffloadPool pool(makeOptions(2));
+    for (int i = 0; i < 100; i++) {
+      pool.add([&] { ran++; });
+    }
+  }
+  EXPECT_EQ(ran, 100);
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/io/async/EventBaseManager.h>
+#include <folly/portability/GTest.h>
+
+#include "proxygen/lib/services/HandshakeOffload.h"
+
+using namespace proxygen;
+
+namespace {
+
+// Signs with its identity, recording the signing thread
+class FakeSelfCert : public fizz::SelfCert {
+ public:
+  explicit FakeSelfCert(bool fail = false) : fail_(fail) {
+  }
+
+  std::string getIdentity() const override {
+    return "fake";
+  }
+
+  std::vector<std::string> getAltIdentities() const override {
+    return {};
+  }
+
+  std::vector<fizz::SignatureScheme> getSigSchemes() const override {
+    return {fizz::SignatureScheme::ecdsa_secp256r1_sha256};
+  }
+
+  fizz::CertificateMsg getCertMessage(fizz::Buf) const override {
+    return fizz::CertificateMsg();
+  }
+
+  fizz::CompressedCertificate getCompressedCert(
+      fizz::CertificateCompressionAlgorithm) const override {
+    throw std::runtime_error("not supported");
+  }
+
+  folly::ssl::X509UniquePtr getX509() const override {
+    return nullptr;
+  }
+
+  fizz::Buf sign(fizz::SignatureScheme,
+                 fizz::CertificateVerifyContext,
+                 folly::ByteRange toBeSigned) const override {
+    signThread = std::this_thread::get_id();
+    if (fail_) {
+      throw std::runtime_error("no key");
+    }
+    auto signature = folly::IOBuf::copyBuffer("signed:");
+    signature->appendToChain(folly::IOBuf::copyBuffer(toBeSigned));
+    return signature;
+  }
+
+  mutable std::thread::id signThread;
+
+ private:
+  bool fail_;
+};
+
+HandshakeOffload::Options makeOptions(size_t maxInFlightPerThread) {
+  HandshakeOffload::Options options;
+  options.numThreads = 1;
+  options.maxInFlightPerThread = maxInFlightPerThread;
+  return options;
+}
+
+} // namespace
+
+class HandshakeOffloadTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    folly::EventBaseManager::get()->setEventBase(&evb_, false);
+  }
+
+  void TearDown() override {
+    folly::EventBaseManager::get()->clearEventBase();
+  }
+
+  HandshakeOffload::Signature signAndWait(
+      HandshakeOffload& offload, std::shared_ptr<fizz::SelfCert> cert) {
+    auto future = offload
+                      .sign(std::move(cert),
+                            fizz::SignatureScheme::ecdsa_secp256r1_sha256,
+                            fizz::CertificateVerifyContext::Server,
+                            folly::IOBuf::copyBuffer("hello"))
+                      .via(&evb_);
+    while (!future.isReady()) {
+      evb_.loopOnce();
+    }
+    return std::move(future).get();
+  }
+
+  folly::EventBase evb_;
+};
+
+TEST_F(HandshakeOffloadTest, SignOnPool) {
+  auto offload = HandshakeOffload::make(makeOptions(4));
+  auto cert = std::make_shared<FakeSelfCert>();
+  auto signature = signAndWait(*offload, cert);
+  ASSERT_TRUE(signature.hasValue());
+  EXPECT_EQ((*signature)->moveToFbString().toStdString(), "signed:hello");
+  EXPECT_NE(cert->signThread, std::this_thread::get_id());
+  EXPECT_EQ(offload->getInFlight(evb_), 0);
+  auto stats = offload->getStats();
+  EXPECT_EQ(stats.offloaded, 1);
+  EXPECT_EQ(stats.inlined, 0);
+}
+
+TEST_F(HandshakeOffloadTest, InlineOverLimit) {
+  auto offload = HandshakeOffload::make(makeOptions(0));
+  auto cert = std::make_shared<FakeSelfCert>();
+  auto signature = signAndWait(*offload, cert);
+  ASSERT_TRUE(signature.hasValue());
+  EXPECT_EQ(cert->signThread, std::this_thread::get_id());
+  auto stats = offload->getStats();
+  EXPECT_EQ(stats.offloaded, 0);
+  EXPECT_EQ(stats.inlined, 1);
+}
+
+TEST_F(HandshakeOffloadTest, InlineWithoutEventBase) {
+  folly::EventBaseManager::get()->clearEventBase();
+  auto offload = HandshakeOffload::make(makeOptions(4));
+  auto signature =
+      offload
+          ->sign(std::make_shared<FakeSelfCert>(),
+                 fizz::SignatureScheme::ecdsa_secp256r1_sha256,
+                 fizz::CertificateVerifyContext::Server,
+                 folly::IOBuf::copyBuffer("hello"))
+          .get();
+  EXPECT_TRUE(signature.hasValue());
+  EXPECT_EQ(offload->getStats().inlined, 1);
+}
+
+TEST_F(HandshakeOffloadTest, SignFailure) {
+  auto offload = HandshakeOffload::make(makeOptions(4));
+  auto signature =
+      signAndWait(*offload, std::make_shared<FakeSelfCert>(true));
+  EXPECT_FALSE(signature.hasValue());
+  EXPECT_EQ(offload->getStats().failed, 1);
+}
+
+TEST_F(HandshakeOffloadTest, Wrap) {
+  auto offload = HandshakeOffload::make(makeOptions(4));
+  auto wrapped = offload->wrap(std::make_shared<FakeSelfCert>());
+  auto async =
+      std::dynamic_pointer_cast<fizz::server::AsyncSelfCert>(wrapped);
+  ASSERT_NE(async, nullptr);
+  EXPECT_EQ(async->getIdentity(), "fake");
+  // Already asynchronous
+  EXPECT_EQ(offload->wrap(wrapped), wrapped);
+  EXPECT_EQ(offload->wrap(std::shared_ptr<fizz::SelfCert>()), nullptr);
+
+  auto future = async
+                    ->signFuture(fizz::SignatureScheme::ecdsa_secp256r1_sha256,
+                                 fizz::CertificateVerifyContext::Server,
+                                 folly::IOBuf::copyBuffer("hello"))
+                    .via(&evb_);
+  while (!future.isReady()) {
+    evb_.loopOnce();
+  }
+  EXPECT_TRUE(std::move(future).get().hasValue());
+  EXPECT_EQ(offload->getStats().offloaded, 1);
+}
+
+TEST_F(HandshakeOffloadTest, WrapContext) {
+  auto certManager = std::make_shared<fizz::server::CertManager>();
+  certManager->addCert(std::make_shared<FakeSelfCert>(), true);
+  auto ctx = std::make_shared<fizz::server::FizzServerContext>();
+  ctx->setCertManager(certManager);
+
+  // As HTTPAcceptor does, the certificates ctx already has sign on the pool
+  auto offload = HandshakeOffload::make(makeOptions(4));
+  ctx->setCertManager(offload->wrap(
+      std::make_shared<const fizz::server::FizzServerContext>(*ctx)));
+  auto cert = ctx->getCert("fake");
+  ASSERT_NE(cert, nullptr);
+  EXPECT_NE(std::dynamic_pointer_cast<fizz::server::AsyncSelfCert>(cert),
+            nullptr);
+  EXPECT_EQ(cert->getIdentity(), "fake");
+}
@@ -73,6 +73,8 @@ TLSSLStats::TLSSLStats(const std::string& prefix)
       tlsVersion_1_2_(prefix + "_tls_v1_2", SUM),
       tlsVersion_1_3_(prefix + "_tls_v1_3", SUM),
       tlsInsecureConnection(prefix + "_tls_insecure_connection", SUM),
+      ktlsOffloaded_(prefix + "_ktls_offloaded", SUM),
+      ktlsFallbacks_(prefix + "_ktls_fallbacks", SUM),
       fizzPskTypeNotSupported_(prefix + "_fizz_psktype_not_supported", SUM),
       fizzPskTypeNotAttempted_(prefix + "_fizz_psktype_not_attempted", SUM),
       fizzPskTypeRejected_(prefix + "_fizz_psktype_rejected", SUM),
@@ -80,6 +82,64 @@ TLSSLStats::TLSSLStats(const std::string& prefix)
       fizzPskTypeResumption_(prefix + "_fizz_psktype_resumption", SUM) {
 }
 
+const char* TLSSLStats::getColumnName(Column column) {
+  switch (column) {
+    case kSSLHandshakeSuccesses:
+      return "ssl_handshake_successes";
+    case kSSLHandshakeErrors:
+      return "ssl_handshake_errors";
+    case kFizzHandshakeSuccesses:
+      return "fizz_handshake_successes";
+    case kFizzHandshakeErrors:
+      return "fizz_handshake_errors";
+    case kFizzHandshakeProtocolErrors:
+      return "fizz_handshake_protocol_errors";
+    case kHandshakesShed:
+      return "ssl_handshake_shed_new";
+    case kTLSTicketNew:
+      return "tls_ticket_new";
+    case kTLSTicketHit:
+      return "tls_ticket_hit";
+    case kTLSTicketMiss:
+      return "tls_ticket_miss";
+    case kSSLSessionNew:
+      return "ssl_sess_new";
+    case kSSLSessionHit:
+      return "ssl_sess_hit";
+    case kSSLSessionForeignHit:
+      return "ssl_sess_foreign_hit";
+    case kSSLSessionMiss:
+      return "ssl_sess_total_miss";
+    case kUpstreamHandshakes:
+      return "ssl_upstream_handshakes";
+    case kUpstreamResumes:
+      return "ssl_upstream_resumes";
+    case kUpstreamErrors:
+      return "ssl_upstream_errors";
+    case kUpstreamVerifyErrors:
+      return "ssl_upstream_verify_errors";
+    case kTLSVersion1_0:
+      return "tls_v1_0";
+    case kTLSVersion1_1:
+      return "tls_v1_1";
+    case kTLSVersion1_2:
+      return "tls_v1_2";
+    case kTLSVersion1_3:
+      return "tls_v1_3";
+    case kTLSVersionUnknown:
+      return "tls_unknown";
+    case kInsecureConnections:
+      return "tls_insecure_connection";
+    case kKTLSOffloaded:
+      return "ktls_offloaded";
+    case kKTLSFallbacks:
+      return "ktls_fallbacks";
+    case kNumColumns:
+      break;
+  }
+  return "";
+}
+
 void TLSSLStats::recordSSLAcceptLatency(int64_t latency) noexcept {
   if (latency >= 0) {
     sslAcceptLatency_.add(latency);
@@ -90,10 +150,13 @@ void TLSSLStats::recordSSLAcceptLatency(int64_t latency) noexcept {
 void TLSSLStats::recordTLSTicket(bool ticketNew, bool ticketHit) noexcept {
   if (ticketNew) {
     tlsTicketNew_.add(1);
+    columns_.add(kTLSTicketNew);
   } else if (ticketHit) {
     tlsTicketHit_.add(1);
+    columns_.add(kTLSTicketHit);
   } else {
     tlsTicketMiss_.add(1);
+    columns_.add(kTLSTicketMiss);
   }
 }
 
@@ -102,11 +165,14 @@ void TLSSLStats::recordSSLSession(bool sessionNew,
                                   bool foreign) noexcept {
   if (sessionNew) {
     sslSessionNew_.add(1);
+    columns_.add(kSSLSessionNew);
   } else if (sessionHit) {
     sslSessionHit_.add((foreign) ? 0 : 1);
     sslSessionForeignHit_.add((foreign) ? 1 : 0);
+    columns_.add(foreign ? kSSLSessionForeignHit : kSSLSessionHit);
   } else {
     sslSessionTotalMiss_.add(1);
+    columns_.add(kSSLSessionMiss);
   }
 }
 
@@ -143,16 +209,20 @@ void TLSSLStats::recordTLSTicketRotation(bool valid) noexcept {
 void TLSSLStats::recordSSLUpstreamConnection(bool handshake) noexcept {
   if (handshake) {
     sslUpstreamHandshakes_.add(1);
+    columns_.add(kUpstreamHandshakes);
   } else {
     sslUpstreamResumes_.add(1);
+    columns_.add(kUpstreamResumes);
   }
 }
 
 void TLSSLStats::recordSSLUpstreamConnectionError(bool verifyError) noexcept {
   if (verifyError) {
     sslUpstreamVerifyErrors_.add(1);
+    columns_.add(kUpstreamVerifyErrors);
   } else {
     sslUpstreamErrors_.add(1);
+    columns_.add(kUpstreamErrors);
   }
 }
 
@@ -171,28 +241,34 @@ void TLSSLStats::recordReplayCacheRequestError() noexcept {
 
 void TLSSLStats::recordNewSSLHandshakeShed() {
   newSSLHandshakeShed_.add(1);
+  columns_.add(kHandshakesShed);
 }
 
 void TLSSLStats::recordSSLHandshake(bool success) {
   if (success) {
     sslHandshakeSuccesses_.add(1);
+    columns_.add(kSSLHandshakeSuccesses);
     sslHandshakeErrors_.add(0);
   } else {
     sslHandshakeErrors_.add(1);
+    columns_.add(kSSLHandshakeErrors);
   }
 }
 
 void TLSSLStats::recordFizzHandshake(bool success) {
   if (success) {
     fizzHandshakeSuccesses_.add(1);
+    columns_.add(kFizzHandshakeSuccesses);
     fizzHandshakeErrors_.add(0);
   } else {
     fizzHandshakeErrors_.add(1);
+    columns_.add(kFizzHandshakeErrors);
   }
 }
 
 void TLSSLStats::recordFizzHandshakeProtocolError() {
   fizzHandshakeProtocolErrors_.add(1);
+  columns_.add(kFizzHandshakeProtocolErrors);
 }
 
 void TLSSLStats::recordTFOSuccess() {
@@ -235,12 +311,15 @@ void TLSSLStats::recordTLSVersion(fizz::ProtocolVersion tlsVersion) noexcept {
   switch (tlsVersion) {
     case fizz::ProtocolVersion::tls_1_0:
       tlsVersion_1_0_.add(1);
+      columns_.add(kTLSVersion1_0);
       return;
     case fizz::ProtocolVersion::tls_1_1:
       tlsVersion_1_1_.add(1);
+      columns_.add(kTLSVersion1_1);
       return;
     case fizz::ProtocolVersion::tls_1_2:
       tlsVersion_1_2_.add(1);
+      columns_.add(kTLSVersion1_2);
       return;
     case fizz::ProtocolVersion::tls_1_3:
     case fizz::ProtocolVersion::tls_1_3_23:
@@ -249,13 +328,26 @@ void TLSSLStats::recordTLSVersion(fizz::ProtocolVersion tlsVersion) noexcept {
     case fizz::ProtocolVersion::tls_1_3_26_fb:
     case fizz::ProtocolVersion::tls_1_3_28:
       tlsVersion_1_3_.add(1);
+      columns_.add(kTLSVersion1_3);
       return;
   }
   tlsUnknown_.add(1);
+  columns_.add(kTLSVersionUnknown);
 }
 
 void TLSSLStats::recordInsecureConnection() noexcept {
   tlsInsecureConnection.add(1);
+  columns_.add(kInsecureConnections);
+}
+
+void TLSSLStats::recordKTLSOffload(bool success) noexcept {
+  if (success) {
+    ktlsOffloaded_.add(1);
+    columns_.add(kKTLSOffloaded);
+  } else {
+    ktlsFallbacks_.add(1);
+    columns_.add(kKTLSFallbacks);
+  }
 }
 
 } // namespace proxygen
@@ -11,6 +11,7 @@
 #include <fizz/protocol/Types.h>
 #include <folly/ThreadLocal.h>
 #include <proxygen/lib/stats/BaseStats.h>
+#include <proxygen/lib/stats/ColumnStats.h>
 #include <string>
 #include <wangle/ssl/SSLStats.h>
 #include <wangle/ssl/SSLUtil.h>
@@ -48,13 +49,55 @@ class ProxygenSSLStats : public wangle::SSLStats {
   virtual void recordTLSVersion(fizz::ProtocolVersion tlsVersion) noexcept = 0;
 
   virtual void recordInsecureConnection() noexcept = 0;
+
+  // A downstream connection was (or failed to be) handed to kernel TLS
+  virtual void recordKTLSOffload(bool /*success*/) noexcept {
+  }
 };
 
 class TLSSLStats : public ProxygenSSLStats {
  public:
+  // Also counted per thread, for bulk export through getColumns()
+  enum Column : size_t {
+    kSSLHandshakeSuccesses,
+    kSSLHandshakeErrors,
+    kFizzHandshakeSuccesses,
+    kFizzHandshakeErrors,
+    kFizzHandshakeProtocolErrors,
+    kHandshakesShed,
+    kTLSTicketNew,
+    kTLSTicketHit,
+    kTLSTicketMiss,
+    kSSLSessionNew,
+    kSSLSessionHit,
+    kSSLSessionForeignHit,
+    kSSLSessionMiss,
+    kUpstreamHandshakes,
+    kUpstreamResumes,
+    kUpstreamErrors,
+    kUpstreamVerifyErrors,
+    kTLSVersion1_0,
+    kTLSVersion1_1,
+    kTLSVersion1_2,
+    kTLSVersion1_3,
+    kTLSVersionUnknown,
+    kInsecureConnections,
+    kKTLSOffloaded,
+    kKTLSFallbacks,
+    kNumColumns
+  };
+  using Columns = ColumnStats<kNumColumns>;
+
   TLSSLStats(const std::string& prefix);
   virtual ~TLSSLStats() override = default;
 
+  // Without the prefix, eg: "tls_v1_3"
+  static const char* getColumnName(Column column);
+
+  const Columns& getColumns() const {
+    return columns_;
+  }
+
   // downstream
   void recordSSLAcceptLatency(int64_t latency) noexcept override;
   void recordTLSTicket(bool ticketNew, bool ticketHit) noexcept override;
@@ -101,6 +144,8 @@ class TLSSLStats : public ProxygenSSLStats {
 
   void recordInsecureConnection() noexcept override;
 
+  void recordKTLSOffload(bool success) noexcept override;
+
  private:
   // Forbidden copy constructor and assignment operator
   TLSSLStats(TLSSLStats const&) = delete;
@@ -154,6 +199,8 @@ class TLSSLStats : public ProxygenSSLStats {
   BaseStats::TLTimeseries tlsVersion_1_2_;
   BaseStats::TLTimeseries tlsVersion_1_3_;
   BaseStats::TLTimeseries tlsInsecureConnection;
+  BaseStats::TLTimeseries ktlsOffloaded_;
+  BaseStats::TLTimeseries ktlsFallbacks_;
 
   // PskTypes counters
   BaseStats::TLTimeseries fizzPskTypeNotSupported_;
@@ -161,6 +208,8 @@ class TLSSLStats : public ProxygenSSLStats {
   BaseStats::TLTimeseries fizzPskTypeRejected_;
   BaseStats::TLTimeseries fizzPskTypeExternal_;
   BaseStats::TLTimeseries fizzPskTypeResumption_;
+
+  Columns columns_;
 };
 
 } // namespace proxygen
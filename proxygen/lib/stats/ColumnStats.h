@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <folly/Likely.h>
+#include <folly/ThreadLocal.h>
+#include <glog/logging.h>
+#include <mutex>
+#include <vector>
+
+namespace proxygen {
+
+/**
+ * N counters of a stats object, for bulk export: each thread adds to a
+ * fixed-layout block of its own, under a seqlock, and an exporter copies
+ * each block with one memcpy, rather than reading the counters one by one
+ * through the stats interfaces.
+ *
+ * add() is lock-free.  snapshot() and sum() lock out threads coming and
+ * going, not add().  The counts of exited threads are kept.
+ */
+template <size_t N>
+class ColumnStats {
+ public:
+  struct Block {
+    uint64_t values[N]{};
+  };
+
+  ColumnStats() = default;
+  ColumnStats(const ColumnStats&) = delete;
+  ColumnStats& operator=(const ColumnStats&) = delete;
+
+  void add(size_t column, uint64_t value = 1) {
+    DCHECK_LT(column, N);
+    auto& local = getLocal();
+    auto seq = local.seq.load(std::memory_order_relaxed);
+    local.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    local.block.values[column] += value;
+    local.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  // A consistent block per thread, the first for the exited threads
+  std::vector<Block> snapshot() const {
+    std::lock_guard<std::mutex> g(mutex_);
+    std::vector<Block> blocks;
+    blocks.reserve(threads_.size() + 1);
+    blocks.push_back(retired_);
+    for (const auto* local : threads_) {
+      blocks.push_back(local->read());
+    }
+    return blocks;
+  }
+
+  Block sum() const {
+    Block total;
+    for (const auto& block : snapshot()) {
+      for (size_t i = 0; i < N; i++) {
+        total.values[i] += block.values[i];
+      }
+    }
+    return total;
+  }
+
+ private:
+  struct LocalBlock {
+    Block read() const {
+      Block out;
+      while (true) {
+        auto before = seq.load(std::memory_order_acquire);
+        if (before & 1) {
+          continue;
+        }
+        std::memcpy(&out, &block, sizeof(out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq.load(std::memory_order_relaxed) == before) {
+          return out;
+        }
+      }
+    }
+
+    // Odd while the owning thread writes
+    std::atomic<uint32_t> seq{0};
+    Block block;
+  };
+
+  LocalBlock& getLocal() {
+    auto* local = locals_.get();
+    if (FOLLY_UNLIKELY(!local)) {
+      local = new LocalBlock();
+      {
+        std::lock_guard<std::mutex> g(mutex_);
+        threads_.push_back(local);
+      }
+      locals_.reset(local,
+                    [this](LocalBlock* exited, folly::TLPDestructionMode) {
+                      retire(exited);
+                    });
+    }
+    return *local;
+  }
+
+  void retire(LocalBlock* local) {
+    std::lock_guard<std::mutex> g(mutex_);
+    for (size_t i = 0; i < N; i++) {
+      retired_.values[i] += local->block.values[i];
+    }
+    threads_.erase(std::find(threads_.begin(), threads_.end(), local));
+    delete local;
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<LocalBlock*> threads_;
+  Block retired_;
+  // Last, so that the blocks are retired while the rest is alive
+  folly::ThreadLocalPtr<LocalBlock> locals_;
+};
+
+} // namespace proxygen
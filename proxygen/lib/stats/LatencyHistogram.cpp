@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/stats/LatencyHistogram.h>
+
+#include <algorithm>
+#include <cmath>
+#include <folly/lang/Bits.h>
+
+namespace proxygen {
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+  value = std::min(value, kMaxValue);
+  if (value < kSubBuckets) {
+    return value;
+  }
+  // Keeps the kSubBucketBits bits below the highest set one
+  size_t shift = folly::findLastSet(value) - 1 - kSubBucketBits;
+  return shift * kSubBuckets + (value >> shift);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+  if (index < 2 * kSubBuckets) {
+    return index;
+  }
+  size_t shift = index / kSubBuckets - 1;
+  uint64_t base = index - shift * kSubBuckets;
+  return ((base + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+  value = std::min(value, kMaxValue);
+  addToBucket(bucketIndex(value), count);
+  sum_ += value * count;
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::clear() {
+  buckets_.fill(0);
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+uint64_t LatencyHistogram::getPercentile(double pct) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  pct = std::min(std::max(pct, 0.0), 100.0);
+  auto rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(pct / 100.0 * count_)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(bucketUpperBound(i), max_);
+    }
+  }
+  return max_;
+}
+
+} // namespace proxygen
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace proxygen {
+
+/**
+ * Fixed size log-linear histogram, in the style of HdrHistogram: values
+ * below kSubBuckets get a bucket each, and every power of two above is
+ * split in kSubBuckets linear buckets. A percentile is thus within
+ * 1 / kSubBuckets of the recorded value, whatever its magnitude. Histograms
+ * merge by adding their buckets, so per-thread ones can be aggregated.
+ *
+ * Not thread safe, see TLLatencyHistogram.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 4;
+  static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+  // Larger values are recorded as kMaxValue, ~19 hours in microseconds
+  static constexpr size_t kMaxBits = 36;
+  static constexpr uint64_t kMaxValue = (uint64_t(1) << kMaxBits) - 1;
+  static constexpr size_t kNumBuckets =
+      (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+  static size_t bucketIndex(uint64_t value);
+  // The largest value recorded in the bucket
+  static uint64_t bucketUpperBound(size_t index);
+
+  void record(uint64_t value, uint64_t count = 1);
+
+  void record(std::chrono::microseconds latency, uint64_t count = 1) {
+    record(latency.count() > 0 ? uint64_t(latency.count()) : 0, count);
+  }
+
+  void merge(const LatencyHistogram& other);
+
+  void clear();
+
+  uint64_t getCount() const {
+    return count_;
+  }
+
+  uint64_t getSum() const {
+    return sum_;
+  }
+
+  uint64_t getMax() const {
+    return max_;
+  }
+
+  uint64_t getBucketCount(size_t index) const {
+    return buckets_[index];
+  }
+
+  // The value below which pct percent of the values fall, 0 if empty
+  uint64_t getPercentile(double pct) const;
+
+ private:
+  friend class TLLatencyHistogram;
+
+  void addToBucket(size_t index, uint64_t count) {
+    buckets_[index] += count;
+    count_ += count;
+  }
+
+  std::array<uint64_t, kNumBuckets> buckets_{};
+  uint64_t count_{0};
+  uint64_t sum_{0};
+  uint64_t max_{0};
+};
+
+} // namespace proxygen
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/stats/TLLatencyHistogram.h>
+
+#include <algorithm>
+#include <fb303/ServiceData.h>
+#include <folly/Conv.h>
+#include <folly/Indestructible.h>
+#include <folly/experimental/FunctionScheduler.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+DEFINE_int32(latency_histogram_flush_ms,
+             10000,
+             "How often TLLatencyHistograms are merged and their percentiles "
+             "exported");
+
+namespace proxygen {
+
+namespace {
+
+// Tracks the live histograms and owns the thread that flushes them.  The
+// thread runs while there are histograms, and is joined with the last.
+class LatencyHistogramRegistry {
+ public:
+  static LatencyHistogramRegistry& get() {
+    static folly::Indestructible<LatencyHistogramRegistry> registry;
+    return *registry;
+  }
+
+  void add(TLLatencyHistogram* histogram) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    histograms_.push_back(histogram);
+    if (!scheduler_) {
+      scheduler_ = std::make_unique<folly::FunctionScheduler>();
+      scheduler_->setThreadName("latency_hist");
+      scheduler_->addFunction(
+          [this] { flushAll(); },
+          std::chrono::milliseconds(FLAGS_latency_histogram_flush_ms),
+          "latency_histogram_flush");
+      scheduler_->start();
+    }
+  }
+
+  void remove(TLLatencyHistogram* histogram) {
+    std::unique_ptr<folly::FunctionScheduler> scheduler;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = std::find(histograms_.begin(), histograms_.end(), histogram);
+      DCHECK(it != histograms_.end());
+      *it = histograms_.back();
+      histograms_.pop_back();
+      if (histograms_.empty()) {
+        // Nothing left to flush, so the thread doesn't outlive the
+        // histograms into static destruction
+        scheduler = std::move(scheduler_);
+      }
+    }
+    if (scheduler) {
+      // Outside the lock, a running flush takes it
+      scheduler->shutdown();
+    }
+  }
+
+  void flushAll() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto histogram : histograms_) {
+      histogram->flush();
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<TLLatencyHistogram*> histograms_;
+  std::unique_ptr<folly::FunctionScheduler> scheduler_;
+};
+
+} // namespace
+
+TLLatencyHistogram::LocalHistogram::~LocalHistogram() {
+  // The thread is exiting, or the TLLatencyHistogram is being destroyed:
+  // keep what was not flushed yet for the next flush
+  std::lock_guard<std::mutex> guard(parent_->mutex_);
+  drainInto(parent_->pending_);
+}
+
+void TLLatencyHistogram::LocalHistogram::record(uint64_t value) {
+  value = std::min(value, LatencyHistogram::kMaxValue);
+  buckets_[LatencyHistogram::bucketIndex(value)].fetch_add(
+      1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  // Only this thread raises max_, a racing flush at worst reports it in
+  // the next window
+  if (value > max_.load(std::memory_order_relaxed)) {
+    max_.store(value, std::memory_order_relaxed);
+  }
+}
+
+void TLLatencyHistogram::LocalHistogram::drainInto(
+    LatencyHistogram& histogram) {
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    auto count = buckets_[i].exchange(0, std::memory_order_relaxed);
+    if (count != 0) {
+      histogram.addToBucket(i, count);
+    }
+  }
+  histogram.sum_ += sum_.exchange(0, std::memory_order_relaxed);
+  histogram.max_ =
+      std::max(histogram.max_, max_.exchange(0, std::memory_order_relaxed));
+}
+
+TLLatencyHistogram::TLLatencyHistogram(const std::string& name)
+    : name_(name), local_([this] { return new LocalHistogram(this); }) {
+  LatencyHistogramRegistry::get().add(this);
+}
+
+TLLatencyHistogram::~TLLatencyHistogram() {
+  // Once removed the flush thread can no longer see this histogram
+  LatencyHistogramRegistry::get().remove(this);
+}
+
+void TLLatencyHistogram::flush() {
+  // Threads exiting meanwhile drain into pending_ instead
+  auto accessor = local_.accessAllThreads();
+  std::lock_guard<std::mutex> guard(mutex_);
+  LatencyHistogram window;
+  std::swap(window, pending_);
+  for (auto& local : accessor) {
+    local.drainInto(window);
+  }
+  exportValue(".p50", window.getPercentile(50));
+  exportValue(".p90", window.getPercentile(90));
+  exportValue(".p99", window.getPercentile(99));
+  exportValue(".p999", window.getPercentile(99.9));
+  exportValue(".max", window.getMax());
+  total_.merge(window);
+  lastWindow_ = window;
+}
+
+void TLLatencyHistogram::exportValue(folly::StringPiece suffix,
+                                     uint64_t value) {
+  facebook::fb303::ServiceData::get()->setCounter(
+      folly::to<std::string>(name_, suffix), static_cast<int64_t>(value));
+}
+
+LatencyHistogram TLLatencyHistogram::getLastWindow() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return lastWindow_;
+}
+
+LatencyHistogram TLLatencyHistogram::getTotal() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return total_;
+}
+
+void TLLatencyHistogram::flushAll() {
+  LatencyHistogramRegistry::get().flushAll();
+}
+
+} // namespace proxygen
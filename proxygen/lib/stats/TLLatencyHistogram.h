@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#include <folly/Range.h>
+#include <folly/ThreadLocal.h>
+#include <proxygen/lib/stats/LatencyHistogram.h>
+
+namespace proxygen {
+
+/**
+ * A LatencyHistogram recorded per thread: record() only touches the
+ * calling thread's buckets. A background thread merges every thread's
+ * buckets every --latency_histogram_flush_ms and exports the percentiles
+ * of that window as <name>.p50, .p90, .p99, .p999 and .max. The thread
+ * is joined once the last TLLatencyHistogram is destroyed.
+ *
+ * record() is lock-free and safe to call from any thread.
+ */
+class TLLatencyHistogram {
+ public:
+  explicit TLLatencyHistogram(const std::string& name);
+  ~TLLatencyHistogram();
+
+  TLLatencyHistogram(const TLLatencyHistogram&) = delete;
+  TLLatencyHistogram& operator=(const TLLatencyHistogram&) = delete;
+
+  void record(std::chrono::microseconds latency) {
+    local_->record(latency.count() > 0 ? uint64_t(latency.count()) : 0);
+  }
+
+  // Merges the values recorded since the last flush and exports them
+  void flush();
+
+  // The window exported by the last flush
+  LatencyHistogram getLastWindow() const;
+
+  // Every value flushed so far
+  LatencyHistogram getTotal() const;
+
+  // Flushes every live TLLatencyHistogram immediately, eg: in tests
+  static void flushAll();
+
+ private:
+  // Written by its thread only, drained by flushes. Merged into pending_
+  // when the thread exits.
+  class LocalHistogram {
+   public:
+    explicit LocalHistogram(TLLatencyHistogram* parent) : parent_(parent) {
+    }
+    ~LocalHistogram();
+
+    void record(uint64_t value);
+    void drainInto(LatencyHistogram& histogram);
+
+   private:
+    TLLatencyHistogram* parent_;
+    std::array<std::atomic<uint64_t>, LatencyHistogram::kNumBuckets>
+        buckets_{};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+  };
+  struct LocalTag {};
+
+  void exportValue(folly::StringPiece suffix, uint64_t value);
+
+  const std::string name_;
+  mutable std::mutex mutex_;
+  LatencyHistogram pending_;
+  LatencyHistogram lastWindow_;
+  LatencyHistogram total_;
+  // Last, so the threads' histograms are merged while the rest is alive
+  folly::ThreadLocal<LocalHistogram, LocalTag> local_;
+};
+
+} // namespace proxygen
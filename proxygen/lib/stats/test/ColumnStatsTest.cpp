@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/stats/ColumnStats.h>
+
+#include <folly/portability/GTest.h>
+#include <thread>
+
+using namespace proxygen;
+
+TEST(ColumnStatsTest, BlockPerThread) {
+  ColumnStats<3> stats;
+  EXPECT_EQ(stats.snapshot().size(), 1);
+  stats.add(0);
+  stats.add(2, 10);
+
+  std::atomic<bool> added{false};
+  std::atomic<bool> done{false};
+  std::thread other([&] {
+    stats.add(1, 5);
+    added = true;
+    while (!done) {
+      std::this_thread::yield();
+    }
+  });
+  while (!added) {
+    std::this_thread::yield();
+  }
+  auto blocks = stats.snapshot();
+  ASSERT_EQ(blocks.size(), 3);
+  // The exited threads first, none yet
+  EXPECT_EQ(blocks[0].values[0] + blocks[0].values[1] + blocks[0].values[2],
+            0);
+  auto total = stats.sum();
+  EXPECT_EQ(total.values[0], 1);
+  EXPECT_EQ(total.values[1], 5);
+  EXPECT_EQ(total.values[2], 10);
+
+  done = true;
+  other.join();
+  // Kept after the thread exits
+  blocks = stats.snapshot();
+  ASSERT_EQ(blocks.size(), 2);
+  EXPECT_EQ(blocks[0].values[1], 5);
+  EXPECT_EQ(stats.sum().values[1], 5);
+}
+
+TEST(ColumnStatsTest, ConcurrentSnapshots) {
+  ColumnStats<2> stats;
+  constexpr uint64_t kAdds = 100000;
+  std::thread writer([&] {
+    for (uint64_t i = 0; i < kAdds; i++) {
+      // Both columns in one block stay equal between adds
+      stats.add(0);
+      stats.add(1);
+    }
+  });
+  uint64_t last = 0;
+  while (last < kAdds) {
+    auto total = stats.sum();
+    EXPECT_GE(total.values[0], total.values[1]);
+    EXPECT_LE(total.values[0], total.values[1] + 1);
+    EXPECT_GE(total.values[1], last);
+    last = total.values[1];
+  }
+  writer.join();
+}
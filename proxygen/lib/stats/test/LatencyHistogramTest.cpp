@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/stats/LatencyHistogram.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+
+TEST(LatencyHistogramTest, Buckets) {
+  // Exact below kSubBuckets, and for the first power of two above
+  for (uint64_t value = 0; value < 2 * LatencyHistogram::kSubBuckets;
+       value++) {
+    EXPECT_EQ(LatencyHistogram::bucketIndex(value), value);
+    EXPECT_EQ(LatencyHistogram::bucketUpperBound(value), value);
+  }
+  EXPECT_EQ(LatencyHistogram::bucketIndex(32), 32);
+  EXPECT_EQ(LatencyHistogram::bucketIndex(33), 32);
+  EXPECT_EQ(LatencyHistogram::bucketUpperBound(32), 33);
+  EXPECT_EQ(LatencyHistogram::bucketIndex(LatencyHistogram::kMaxValue),
+            LatencyHistogram::kNumBuckets - 1);
+  EXPECT_EQ(LatencyHistogram::bucketIndex(uint64_t(-1)),
+            LatencyHistogram::kNumBuckets - 1);
+  EXPECT_EQ(
+      LatencyHistogram::bucketUpperBound(LatencyHistogram::kNumBuckets - 1),
+      LatencyHistogram::kMaxValue);
+
+  // Every value lands in a bucket no wider than 1 / kSubBuckets of it
+  for (uint64_t value = 1; value < LatencyHistogram::kMaxValue;
+       value = value * 3 + 1) {
+    auto index = LatencyHistogram::bucketIndex(value);
+    auto upper = LatencyHistogram::bucketUpperBound(index);
+    EXPECT_GE(upper, value);
+    EXPECT_LE(upper - value, value / LatencyHistogram::kSubBuckets);
+    if (index > 0) {
+      EXPECT_LT(LatencyHistogram::bucketUpperBound(index - 1), value);
+    }
+  }
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.getPercentile(99), 0);
+  for (uint64_t value = 1; value <= 10000; value++) {
+    histogram.record(value);
+  }
+  EXPECT_EQ(histogram.getCount(), 10000);
+  EXPECT_EQ(histogram.getSum(), 10000 * 10001 / 2);
+  EXPECT_EQ(histogram.getMax(), 10000);
+  auto expectNear = [&](double pct, uint64_t expected) {
+    auto value = histogram.getPercentile(pct);
+    EXPECT_GE(value, expected);
+    EXPECT_LE(value - expected, expected / LatencyHistogram::kSubBuckets);
+  };
+  expectNear(50, 5000);
+  expectNear(99, 9900);
+  expectNear(99.9, 9990);
+  EXPECT_EQ(histogram.getPercentile(100), 10000);
+  EXPECT_EQ(histogram.getPercentile(0), 1);
+}
+
+TEST(LatencyHistogramTest, Merge) {
+  LatencyHistogram fast;
+  LatencyHistogram slow;
+  fast.record(std::chrono::microseconds(100), 990);
+  slow.record(std::chrono::microseconds(100000), 10);
+  fast.merge(slow);
+  EXPECT_EQ(fast.getCount(), 1000);
+  EXPECT_EQ(fast.getMax(), 100000);
+  EXPECT_LE(fast.getPercentile(99), 100 + 100 / 16);
+  EXPECT_GE(fast.getPercentile(99.9), 100000);
+
+  fast.clear();
+  EXPECT_EQ(fast.getCount(), 0);
+  EXPECT_EQ(fast.getMax(), 0);
+  EXPECT_EQ(fast.getPercentile(50), 0);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <proxygen/lib/stats/PeriodicStats.h>
+
+#include <thread>
+#include <vector>
+
+using namespace proxygen;
+
+namespace {
+
+const size_t kNumThreads = 64;
+
+class BenchData {
+ public:
+  std::chrono::milliseconds getLastUpdateTime() const {
+    return time_;
+  }
+
+  void setLastUpdateTime(std::chrono::milliseconds time) {
+    time_ = time;
+  }
+
+  uint64_t values[8]{};
+
+ private:
+  std::chrono::milliseconds time_{0};
+};
+
+class BenchStats : public PeriodicStats<BenchData> {
+ public:
+  BenchStats() : PeriodicStats<BenchData>(new BenchData()) {
+  }
+
+  // Publishes new data, as a refresh would
+  void refresh() {
+    updateCachedData();
+  }
+
+  // How getCurrentData() used to read: an RCU read lock on every call
+  const BenchData& getCurrentDataLocked() const {
+    {
+      std::scoped_lock guard(folly::rcu_default_domain());
+      auto* loadedData = data_.load();
+      if (loadedData->getLastUpdateTime() !=
+          tlData_->data.getLastUpdateTime()) {
+        tlData_->data = *loadedData;
+      }
+    }
+    return tlData_->data;
+  }
+
+ protected:
+  BenchData* getNewData() const override {
+    auto data = new BenchData();
+    data->setLastUpdateTime(data_.load()->getLastUpdateTime() +
+                            std::chrono::milliseconds(1));
+    return data;
+  }
+};
+
+// Reads from kNumThreads threads, with a refresh every 10k reads of
+// the first thread
+template <typename Read>
+void readOnThreads(BenchStats& stats, size_t iters, Read read) {
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&stats, &read, iters, t] {
+      uint64_t sum = 0;
+      for (size_t i = 0; i < iters; i++) {
+        sum += read(stats).values[0];
+        if (t == 0 && i % 10000 == 0) {
+          stats.refresh();
+        }
+      }
+      folly::doNotOptimizeAway(sum);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace
+
+BENCHMARK(GetCurrentDataRcuLocked, iters) {
+  folly::BenchmarkSuspender suspender;
+  BenchStats stats;
+  suspender.dismiss();
+  readOnThreads(stats, iters, [](BenchStats& s) -> const BenchData& {
+    return s.getCurrentDataLocked();
+  });
+}
+
+BENCHMARK_RELATIVE(GetCurrentDataVersioned, iters) {
+  folly::BenchmarkSuspender suspender;
+  BenchStats stats;
+  suspender.dismiss();
+  readOnThreads(stats, iters, [](BenchStats& s) -> const BenchData& {
+    return s.getCurrentData();
+  });
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -41,6 +41,7 @@ class PeriodicStatsUnderTest : public PeriodicStats<PeriodicStatsData> {
   }
 
   PeriodicStatsData& getMutableData() {
+    bumpDataVersion();
     return *data_.load();
   }
 
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/test/AllocationTracker.h>
+
+#include <cstdlib>
+
+namespace {
+
+// Plain TLS, malloc can't run constructors or allocate to reach it
+__thread uint64_t tlAllocs[proxygen::kNumAllocationPhases]
+    __attribute__((tls_model("initial-exec")));
+__thread uint64_t tlBytes[proxygen::kNumAllocationPhases]
+    __attribute__((tls_model("initial-exec")));
+
+inline void countAllocation(size_t size) noexcept {
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+  auto phase = static_cast<size_t>(proxygen::currentAllocationPhase());
+#else
+  size_t phase = 0;
+#endif
+  tlAllocs[phase]++;
+  tlBytes[phase] += size;
+}
+
+} // namespace
+
+#ifdef __GLIBC__
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+  countAllocation(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+  countAllocation(num * size);
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  countAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+}
+
+#endif
+
+namespace proxygen {
+
+AllocationTracker::Snapshot AllocationTracker::Snapshot::operator-(
+    const Snapshot& other) const {
+  Snapshot delta;
+  for (size_t i = 0; i < kNumAllocationPhases; i++) {
+    delta.counts_[i].allocs = counts_[i].allocs - other.counts_[i].allocs;
+    delta.counts_[i].bytes = counts_[i].bytes - other.counts_[i].bytes;
+  }
+  return delta;
+}
+
+AllocationTracker::Counts AllocationTracker::Snapshot::total() const {
+  Counts total;
+  for (const auto& counts : counts_) {
+    total.allocs += counts.allocs;
+    total.bytes += counts.bytes;
+  }
+  return total;
+}
+
+AllocationTracker::Snapshot AllocationTracker::snapshot() {
+  Snapshot snapshot;
+  for (size_t i = 0; i < kNumAllocationPhases; i++) {
+    auto phase = static_cast<AllocationPhase>(i);
+    snapshot[phase].allocs = tlAllocs[i];
+    snapshot[phase].bytes = tlBytes[i];
+  }
+  return snapshot;
+}
+
+bool AllocationTracker::isActive() {
+  auto before = snapshot().total().allocs;
+  // Volatile, so the allocation isn't elided
+  void* volatile ptr = std::malloc(1);
+  std::free(ptr);
+  return snapshot().total().allocs != before;
+}
+
+} // namespace proxygen
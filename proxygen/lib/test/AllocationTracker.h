@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <proxygen/lib/utils/AllocationPhase.h>
+
+namespace proxygen {
+
+/**
+ * Counts the heap allocations of the calling thread by AllocationPhase.
+ * Linking the allocationtracker library interposes malloc, calloc and
+ * realloc (glibc only), and so operator new; the counts are only broken
+ * down by phase when proxygen is built with PROXYGEN_ALLOCATION_TRACKING.
+ *
+ *   auto before = AllocationTracker::snapshot();
+ *   ... run requests ...
+ *   auto delta = AllocationTracker::snapshot() - before;
+ *   delta[AllocationPhase::PARSE].allocs / numRequests;
+ */
+class AllocationTracker {
+ public:
+  struct Counts {
+    uint64_t allocs{0};
+    uint64_t bytes{0};
+  };
+
+  class Snapshot {
+   public:
+    const Counts& operator[](AllocationPhase phase) const {
+      return counts_[static_cast<size_t>(phase)];
+    }
+
+    Counts& operator[](AllocationPhase phase) {
+      return counts_[static_cast<size_t>(phase)];
+    }
+
+    Snapshot operator-(const Snapshot& other) const;
+
+    Counts total() const;
+
+   private:
+    std::array<Counts, kNumAllocationPhases> counts_;
+  };
+
+  // The calling thread's counts since it started
+  static Snapshot snapshot();
+
+  // Whether allocations are counted at all, ie. the interposer is in use
+  static bool isActive();
+};
+
+} // namespace proxygen
@@ -261,6 +261,9 @@ void TestAsyncTransport::writev(AsyncTransport::WriteCallback* callback,
   } else if (isSet(flags, WriteFlags::EOR)) {
     eorCount_++;
   }
+  if (isSet(flags, WriteFlags::WRITE_MSG_ZEROCOPY)) {
+    zeroCopyCount_++;
+  }
   if (!writesAllowed()) {
     AsyncSocketException ex(AsyncSocketException::NOT_OPEN,
                             "write() called on non-open TestAsyncTransport");
@@ -294,6 +297,9 @@ void TestAsyncTransport::writeChain(AsyncTransport::WriteCallback* callback,
     next = next->next();
   } while (next != head);
   this->writev(callback, vec, count, flags);
+  if (holdZeroCopyBuffers_ && isSet(flags, WriteFlags::WRITE_MSG_ZEROCOPY)) {
+    zeroCopyBuffers_.push_back(std::move(iob));
+  }
 }
 
 void TestAsyncTransport::close() {
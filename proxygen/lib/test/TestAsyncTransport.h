@@ -9,6 +9,7 @@
 #pragma once
 
 #include <deque>
+#include <vector>
 #include <folly/SocketAddress.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/io/async/AsyncTimeout.h>
@@ -111,6 +112,20 @@ class TestAsyncTransport
     return corkCount_;
   }
 
+  uint32_t getZeroCopyCount() {
+    return zeroCopyCount_;
+  }
+
+  // Hold the chains of WRITE_MSG_ZEROCOPY writes until
+  // releaseZeroCopyBuffers(), like a socket waiting for kernel completions
+  void setHoldZeroCopyBuffers(bool hold) {
+    holdZeroCopyBuffers_ = hold;
+  }
+
+  void releaseZeroCopyBuffers() {
+    zeroCopyBuffers_.clear();
+  }
+
   void setAppBytesWritten(size_t bytes) {
     appBytesWritten_ = bytes;
   }
@@ -137,6 +152,14 @@ class TestAsyncTransport
     eorTrackingEnabled_ = flag;
   }
 
+  // Stands in for a TLS transport wrapped by this one
+  void setWrappedTransport(const folly::AsyncTransport* transport) {
+    wrappedTransport_ = transport;
+  }
+  const folly::AsyncTransport* getWrappedTransport() const override {
+    return wrappedTransport_;
+  }
+
  private:
   enum StateEnum {
     kStateOpen,
@@ -181,6 +204,10 @@ class TestAsyncTransport
   size_t appBytesWritten_{0};
   size_t rawBytesWritten_{0};
   bool eorTrackingEnabled_{false};
+  const folly::AsyncTransport* wrappedTransport_{nullptr};
   uint32_t eorCount_{0};
   uint32_t corkCount_{0};
+  uint32_t zeroCopyCount_{0};
+  bool holdZeroCopyBuffers_{false};
+  std::vector<std::unique_ptr<folly::IOBuf>> zeroCopyBuffers_;
 };
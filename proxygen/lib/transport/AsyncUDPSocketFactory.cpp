@@ -23,8 +23,13 @@ folly::Expected<std::unique_ptr<folly::AsyncUDPSocket>, proxygen::Exception>
 AsyncUDPSocketFactory::createSocket(
     const folly::SocketAddress& destinationAddress,
     SocketCreateOptions options) {
-  std::unique_ptr<folly::AsyncUDPSocket> socket =
-      std::make_unique<folly::AsyncUDPSocket>(eventBase_);
+  std::unique_ptr<folly::AsyncUDPSocket> socket;
+  if (options.batchStats) {
+    socket = std::make_unique<CountingUDPSocket>(eventBase_,
+                                                 std::move(options.batchStats));
+  } else {
+    socket = std::make_unique<folly::AsyncUDPSocket>(eventBase_);
+  }
 
   auto maybeAddress = getBindingAddress(destinationAddress);
 
@@ -35,6 +40,15 @@ AsyncUDPSocketFactory::createSocket(
 
   try {
     socket->bind(maybeAddress.value());
+    if (options.requireGSO && socket->getGSO() < 0) {
+      return folly::makeUnexpected(
+          Exception("UDP GSO not supported, bind address=",
+                    maybeAddress.value().describe()));
+    }
+    if (options.enableGRO && !socket->setGRO(true)) {
+      VLOG(2) << "UDP GRO not supported, bind address="
+              << maybeAddress.value().describe();
+    }
     if (options.connectSocket) {
       socket->connect(destinationAddress);
     }
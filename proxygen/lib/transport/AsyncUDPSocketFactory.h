@@ -11,6 +11,7 @@
 #include <folly/Expected.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/async/AsyncUDPSocket.h>
+#include <proxygen/lib/transport/CountingUDPSocket.h>
 #include <proxygen/lib/utils/Exception.h>
 
 namespace proxygen {
@@ -19,6 +20,14 @@ class AsyncUDPSocketFactory {
  public:
   struct SocketCreateOptions {
     bool connectSocket{false};
+    // Turn on UDP_GRO so one read can return several coalesced packets.
+    // Best effort, the socket is still created if the kernel lacks GRO.
+    bool enableGRO{false};
+    // Fail creation unless the kernel supports UDP GSO on the socket, for
+    // callers that would otherwise batch writes one sendmsg per packet
+    bool requireGSO{false};
+    // If set, the socket counts syscalls and packets into these stats
+    std::shared_ptr<UDPBatchStats> batchStats;
   };
 
   explicit AsyncUDPSocketFactory(
@@ -33,7 +42,7 @@ class AsyncUDPSocketFactory {
 
  private:
   static SocketCreateOptions getDefaultCreateOptions() {
-    return SocketCreateOptions{.connectSocket = false};
+    return SocketCreateOptions{};
   }
 
   folly::Expected<folly::SocketAddress, proxygen::Exception> getBindingAddress(
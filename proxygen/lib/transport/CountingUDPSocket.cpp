@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/transport/CountingUDPSocket.h>
+
+#include <cstring>
+#include <folly/net/NetOps.h>
+
+namespace proxygen {
+
+namespace {
+uint64_t segments(uint64_t len, int gso) {
+  if (gso <= 0 || len == 0) {
+    return 1;
+  }
+  return (len + gso - 1) / gso;
+}
+
+// Number of packets the kernel coalesced into one received datagram
+uint64_t groSegments(const struct msghdr* msg, size_t len) {
+#if defined(UDP_GRO) && !defined(_WIN32)
+  if (msg->msg_control) {
+    for (auto* cmsg = CMSG_FIRSTHDR(msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(msg), cmsg)) {
+      if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+        int segSize = 0;
+        memcpy(&segSize, CMSG_DATA(cmsg), sizeof(segSize));
+        return segments(len, segSize);
+      }
+    }
+  }
+#else
+  (void)msg;
+  (void)len;
+#endif
+  return 1;
+}
+} // namespace
+
+std::ostream& operator<<(std::ostream& os, const UDPBatchStats& stats) {
+  os << "writes=" << stats.writeCalls.load(std::memory_order_relaxed)
+     << " packetsWritten="
+     << stats.packetsWritten.load(std::memory_order_relaxed)
+     << " packetsPerWrite=" << stats.packetsPerWrite()
+     << " reads=" << stats.readCalls.load(std::memory_order_relaxed)
+     << " packetsRead=" << stats.packetsRead.load(std::memory_order_relaxed)
+     << " packetsPerRead=" << stats.packetsPerRead();
+  return os;
+}
+
+void CountingUDPSocket::countWrite(uint64_t packets) {
+  stats_->writeCalls.fetch_add(1, std::memory_order_relaxed);
+  stats_->packetsWritten.fetch_add(packets, std::memory_order_relaxed);
+}
+
+void CountingUDPSocket::countRead(uint64_t packets) {
+  stats_->readCalls.fetch_add(1, std::memory_order_relaxed);
+  stats_->packetsRead.fetch_add(packets, std::memory_order_relaxed);
+}
+
+ssize_t CountingUDPSocket::write(const folly::SocketAddress& address,
+                                 const std::unique_ptr<folly::IOBuf>& buf) {
+  Scope scope(inWrite_);
+  auto ret = folly::AsyncUDPSocket::write(address, buf);
+  if (scope.outer() && ret >= 0) {
+    countWrite(1);
+  }
+  return ret;
+}
+
+ssize_t CountingUDPSocket::writeGSO(const folly::SocketAddress& address,
+                                    const std::unique_ptr<folly::IOBuf>& buf,
+                                    int gso) {
+  Scope scope(inWrite_);
+  auto ret = folly::AsyncUDPSocket::writeGSO(address, buf, gso);
+  if (scope.outer() && ret >= 0) {
+    countWrite(segments(buf->computeChainDataLength(), gso));
+  }
+  return ret;
+}
+
+int CountingUDPSocket::writem(folly::Range<folly::SocketAddress const*> addrs,
+                              const std::unique_ptr<folly::IOBuf>* bufs,
+                              size_t count) {
+  Scope scope(inWrite_);
+  auto ret = folly::AsyncUDPSocket::writem(addrs, bufs, count);
+  if (scope.outer() && ret >= 0) {
+    countWrite(ret);
+  }
+  return ret;
+}
+
+int CountingUDPSocket::writemGSO(
+    folly::Range<folly::SocketAddress const*> addrs,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    size_t count,
+    const int* gso) {
+  Scope scope(inWrite_);
+  auto ret = folly::AsyncUDPSocket::writemGSO(addrs, bufs, count, gso);
+  if (scope.outer() && ret >= 0) {
+    uint64_t packets = 0;
+    for (int i = 0; i < ret; i++) {
+      packets +=
+          segments(bufs[i]->computeChainDataLength(), gso ? gso[i] : 0);
+    }
+    countWrite(packets);
+  }
+  return ret;
+}
+
+ssize_t CountingUDPSocket::recvmsg(struct msghdr* msg, int flags) {
+  Scope scope(inRead_);
+  auto ret = folly::AsyncUDPSocket::recvmsg(msg, flags);
+  if (scope.outer() && ret >= 0) {
+    countRead(groSegments(msg, ret));
+  }
+  return ret;
+}
+
+int CountingUDPSocket::recvmmsg(struct mmsghdr* msgvec,
+                                unsigned int vlen,
+                                unsigned int flags,
+                                struct timespec* timeout) {
+  Scope scope(inRead_);
+  auto ret = folly::AsyncUDPSocket::recvmmsg(msgvec, vlen, flags, timeout);
+  if (scope.outer() && ret > 0) {
+    uint64_t packets = 0;
+    for (int i = 0; i < ret; i++) {
+      packets += groSegments(&msgvec[i].msg_hdr, msgvec[i].msg_len);
+    }
+    countRead(packets);
+  }
+  return ret;
+}
+
+} // namespace proxygen
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <ostream>
+
+namespace proxygen {
+
+/**
+ * Syscall and packet counters for UDP sockets, used to tell how well GSO,
+ * sendmmsg, GRO and recvmmsg batch packets.  A GSO write or a GRO read counts
+ * every segment as a packet.  May be shared by sockets on different threads.
+ */
+struct UDPBatchStats {
+  std::atomic<uint64_t> writeCalls{0};
+  std::atomic<uint64_t> packetsWritten{0};
+  std::atomic<uint64_t> readCalls{0};
+  std::atomic<uint64_t> packetsRead{0};
+
+  double packetsPerWrite() const {
+    auto calls = writeCalls.load(std::memory_order_relaxed);
+    return calls ? double(packetsWritten.load(std::memory_order_relaxed)) /
+                       calls
+                 : 0;
+  }
+
+  double packetsPerRead() const {
+    auto calls = readCalls.load(std::memory_order_relaxed);
+    return calls ? double(packetsRead.load(std::memory_order_relaxed)) / calls
+                 : 0;
+  }
+};
+
+std::ostream& operator<<(std::ostream& os, const UDPBatchStats& stats);
+
+/**
+ * AsyncUDPSocket that counts write and read syscalls into UDPBatchStats.
+ * Writes are counted for write, writeGSO, writem and writemGSO; reads for
+ * recvmsg and recvmmsg, which is how QUIC transports read when batched
+ * receive is on.  Reads that the socket does itself before invoking
+ * ReadCallback::onDataAvailable are not counted.
+ */
+class CountingUDPSocket : public folly::AsyncUDPSocket {
+ public:
+  CountingUDPSocket(folly::EventBase* evb, std::shared_ptr<UDPBatchStats> stats)
+      : folly::AsyncUDPSocket(evb), stats_(std::move(stats)) {
+    CHECK(stats_);
+  }
+
+  ssize_t write(const folly::SocketAddress& address,
+                const std::unique_ptr<folly::IOBuf>& buf) override;
+
+  ssize_t writeGSO(const folly::SocketAddress& address,
+                   const std::unique_ptr<folly::IOBuf>& buf,
+                   int gso) override;
+
+  int writem(folly::Range<folly::SocketAddress const*> addrs,
+             const std::unique_ptr<folly::IOBuf>* bufs,
+             size_t count) override;
+
+  int writemGSO(folly::Range<folly::SocketAddress const*> addrs,
+                const std::unique_ptr<folly::IOBuf>* bufs,
+                size_t count,
+                const int* gso) override;
+
+  ssize_t recvmsg(struct msghdr* msg, int flags) override;
+
+  int recvmmsg(struct mmsghdr* msgvec,
+               unsigned int vlen,
+               unsigned int flags,
+               struct timespec* timeout) override;
+
+  const UDPBatchStats& getStats() const {
+    return *stats_;
+  }
+
+ private:
+  // The base class may implement one write or read through another, only the
+  // outermost call is counted
+  class Scope {
+   public:
+    explicit Scope(bool& active) : active_(active), outer_(!active) {
+      active_ = true;
+    }
+    ~Scope() {
+      if (outer_) {
+        active_ = false;
+      }
+    }
+    bool outer() const {
+      return outer_;
+    }
+
+   private:
+    bool& active_;
+    bool outer_;
+  };
+
+  void countWrite(uint64_t packets);
+  void countRead(uint64_t packets);
+
+  std::shared_ptr<UDPBatchStats> stats_;
+  bool inWrite_{false};
+  bool inRead_{false};
+};
+
+} // namespace proxygen
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/transport/LogPersistentCache.h>
+
+#include <cstring>
+
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/hash/Checksum.h>
+#include <folly/lang/Bits.h>
+#include <folly/system/MemoryMapping.h>
+#include <glog/logging.h>
+
+namespace {
+
+constexpr folly::StringPiece kMagic{"PXLOGV01"};
+// type, key length and value length
+constexpr size_t kRecordHeaderSize = 1 + 4 + 4;
+constexpr size_t kRecordChecksumSize = 4;
+
+void appendUint32(std::string& out, uint32_t value) {
+  value = folly::Endian::little(value);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint32_t readUint32(const uint8_t* data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return folly::Endian::little(value);
+}
+
+} // namespace
+
+namespace proxygen {
+
+LogPersistentCache::LogPersistentCache(std::string filename, Config config)
+    : filename_(std::move(filename)),
+      config_(config),
+      map_(config.capacity) {
+  load();
+  // Only now, as evictions while loading are left to compaction
+  map_.setPruneHook([this](std::string key, std::string&&) {
+    appendRecord(RecordType::REMOVE, key, folly::StringPiece());
+  });
+  syncThread_ = std::thread([this] { syncLoop(); });
+}
+
+LogPersistentCache::~LogPersistentCache() {
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    stopping_ = true;
+  }
+  syncCv_.notify_all();
+  syncThread_.join();
+  sync();
+}
+
+folly::Optional<std::string> LogPersistentCache::get(const std::string& key) {
+  std::lock_guard<std::mutex> g(mutex_);
+  auto it = map_.find(key);
+  if (it == map_.end()) {
+    return folly::none;
+  }
+  return it->second;
+}
+
+void LogPersistentCache::put(const std::string& key, std::string value) {
+  std::lock_guard<std::mutex> g(mutex_);
+  appendRecord(RecordType::PUT, key, value);
+  map_.set(key, std::move(value));
+}
+
+bool LogPersistentCache::remove(const std::string& key) {
+  std::lock_guard<std::mutex> g(mutex_);
+  if (!map_.erase(key)) {
+    return false;
+  }
+  appendRecord(RecordType::REMOVE, key, folly::StringPiece());
+  return true;
+}
+
+size_t LogPersistentCache::size() {
+  std::lock_guard<std::mutex> g(mutex_);
+  return map_.size();
+}
+
+size_t LogPersistentCache::getNumLogRecords() {
+  std::lock_guard<std::mutex> g(mutex_);
+  return numLogRecords_;
+}
+
+void LogPersistentCache::encodeRecord(std::string& out,
+                                      RecordType type,
+                                      folly::StringPiece key,
+                                      folly::StringPiece value) {
+  auto start = out.size();
+  out.push_back(static_cast<char>(type));
+  appendUint32(out, key.size());
+  appendUint32(out, value.size());
+  out.append(key.data(), key.size());
+  out.append(value.data(), value.size());
+  appendUint32(out,
+               folly::crc32c(reinterpret_cast<const uint8_t*>(&out[start]),
+                             out.size() - start));
+}
+
+void LogPersistentCache::appendRecord(RecordType type,
+                                      folly::StringPiece key,
+                                      folly::StringPiece value) {
+  encodeRecord(pending_, type, key, value);
+  numLogRecords_++;
+}
+
+void LogPersistentCache::load() {
+  std::unique_ptr<folly::MemoryMapping> mapping;
+  try {
+    mapping = std::make_unique<folly::MemoryMapping>(filename_.c_str());
+  } catch (const std::exception& ex) {
+    VLOG(2) << "No persistent cache to load from " << filename_ << ": "
+            << ex.what();
+    needsCompaction_ = true;
+    return;
+  }
+  auto data = mapping->range();
+  if (data.size() < kMagic.size() ||
+      memcmp(data.data(), kMagic.data(), kMagic.size()) != 0) {
+    LOG(ERROR) << "Not a persistent cache log: " << filename_;
+    needsCompaction_ = true;
+    return;
+  }
+  data.advance(kMagic.size());
+
+  while (!data.empty()) {
+    if (data.size() < kRecordHeaderSize + kRecordChecksumSize) {
+      needsCompaction_ = true;
+      break;
+    }
+    auto type = static_cast<RecordType>(data[0]);
+    size_t keyLen = readUint32(data.data() + 1);
+    size_t valueLen = readUint32(data.data() + 5);
+    auto bodyLen = kRecordHeaderSize + keyLen + valueLen;
+    if (data.size() - kRecordChecksumSize < bodyLen ||
+        readUint32(data.data() + bodyLen) !=
+            folly::crc32c(data.data(), bodyLen)) {
+      needsCompaction_ = true;
+      break;
+    }
+    auto keyStart = reinterpret_cast<const char*>(data.data()) +
+                    kRecordHeaderSize;
+    std::string key(keyStart, keyLen);
+    if (type == RecordType::PUT) {
+      map_.set(key, std::string(keyStart + keyLen, valueLen));
+    } else if (type == RecordType::REMOVE) {
+      map_.erase(key);
+    } else {
+      needsCompaction_ = true;
+      break;
+    }
+    numLogRecords_++;
+    data.advance(bodyLen + kRecordChecksumSize);
+  }
+  if (needsCompaction_) {
+    LOG(ERROR) << "Dropping the corrupted tail of " << filename_ << " after "
+               << numLogRecords_ << " records";
+  }
+}
+
+void LogPersistentCache::sync() {
+  std::lock_guard<std::mutex> fileGuard(fileMutex_);
+  std::string records;
+  bool compact = false;
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    compact = needsCompaction_ ||
+              (numLogRecords_ >= config_.minCompactionRecords &&
+               numLogRecords_ > config_.compactionRatio * map_.size());
+    if (compact) {
+      // Oldest first, so that replaying it keeps the LRU order
+      for (auto it = map_.rbegin(); it != map_.rend(); ++it) {
+        encodeRecord(records, RecordType::PUT, it->first, it->second);
+      }
+      numLogRecords_ = map_.size();
+      needsCompaction_ = false;
+      pending_.clear();
+    } else if (pending_.empty()) {
+      return;
+    } else {
+      records.swap(pending_);
+    }
+  }
+  if (!writeLog(records, compact)) {
+    std::lock_guard<std::mutex> g(mutex_);
+    // The file may now be missing records, so rewrite all of it
+    needsCompaction_ = true;
+  }
+}
+
+bool LogPersistentCache::writeLog(const std::string& records, bool compact) {
+  try {
+    if (compact) {
+      auto tmpName = filename_ + ".tmp";
+      folly::File file(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC);
+      std::string contents(kMagic.str());
+      contents.append(records);
+      folly::checkUnixError(
+          folly::writeFull(file.fd(), contents.data(), contents.size()),
+          "write");
+      folly::checkUnixError(folly::fsyncNoInt(file.fd()), "fsync");
+      file.close();
+      folly::checkUnixError(::rename(tmpName.c_str(), filename_.c_str()),
+                            "rename");
+    } else {
+      folly::File file(filename_.c_str(), O_WRONLY | O_APPEND);
+      folly::checkUnixError(
+          folly::writeFull(file.fd(), records.data(), records.size()),
+          "write");
+    }
+    return true;
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to write persistent cache " << filename_ << ": "
+               << ex.what();
+    return false;
+  }
+}
+
+void LogPersistentCache::syncLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    syncCv_.wait_for(lock, config_.syncInterval);
+    if (stopping_) {
+      break;
+    }
+    lock.unlock();
+    sync();
+    lock.lock();
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/container/EvictingCacheMap.h>
+
+namespace proxygen {
+
+/**
+ * A string to string LRU cache persisted as an append-only log of binary
+ * records, unlike wangle::FilePersistentCache which rewrites the whole
+ * cache as JSON on every sync.
+ *
+ * Changes are buffered in memory and appended to the file from a sync
+ * thread, so a sync costs O(changes). Once the log holds compactionRatio
+ * times more records than the cache has entries, it is rewritten with one
+ * record per entry. At startup the file is memory mapped and replayed; a
+ * torn or corrupted tail is dropped, and the rest of the records kept.
+ *
+ * All methods are thread safe.
+ */
+class LogPersistentCache {
+ public:
+  struct Config {
+    size_t capacity{1000};
+    std::chrono::milliseconds syncInterval{std::chrono::seconds(1)};
+    double compactionRatio{2};
+    // The log is not compacted below this many records
+    size_t minCompactionRecords{1024};
+  };
+
+  LogPersistentCache(std::string filename, Config config);
+  // Writes the pending changes
+  ~LogPersistentCache();
+
+  LogPersistentCache(const LogPersistentCache&) = delete;
+  LogPersistentCache& operator=(const LogPersistentCache&) = delete;
+
+  folly::Optional<std::string> get(const std::string& key);
+  void put(const std::string& key, std::string value);
+  bool remove(const std::string& key);
+  size_t size();
+
+  /**
+   * Writes the pending changes now, compacting the log if due.
+   */
+  void sync();
+
+  // Records in the log, including the pending ones
+  size_t getNumLogRecords();
+
+ private:
+  enum class RecordType : uint8_t {
+    PUT = 1,
+    REMOVE = 2,
+  };
+
+  void load();
+  void appendRecord(RecordType type,
+                    folly::StringPiece key,
+                    folly::StringPiece value);
+  static void encodeRecord(std::string& out,
+                           RecordType type,
+                           folly::StringPiece key,
+                           folly::StringPiece value);
+  bool writeLog(const std::string& records, bool compact);
+  void syncLoop();
+
+  const std::string filename_;
+  const Config config_;
+
+  // Serializes the file writes, taken before mutex_
+  std::mutex fileMutex_;
+
+  std::mutex mutex_;
+  folly::EvictingCacheMap<std::string, std::string> map_;
+  // Encoded records not written yet
+  std::string pending_;
+  size_t numLogRecords_{0};
+  // The file is missing, or has a corrupted record that appending to it
+  // would hide
+  bool needsCompaction_{false};
+
+  std::condition_variable syncCv_;
+  bool stopping_{false};
+  std::thread syncThread_;
+};
+
+} // namespace proxygen
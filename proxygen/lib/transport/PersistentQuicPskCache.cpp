@@ -22,7 +22,66 @@ PersistentQuicPskCache::PersistentQuicPskCache(
     const std::string& filename,
     wangle::PersistentCacheConfig config,
     std::unique_ptr<fizz::Factory> factory)
-    : cache_(filename, std::move(config)), factory_(std::move(factory)) {
+    : cache_(std::make_unique<wangle::FilePersistentCache<
+                 std::string,
+                 PersistentQuicCachedPsk>>(filename, std::move(config))),
+      factory_(std::move(factory)) {
+}
+
+PersistentQuicPskCache::PersistentQuicPskCache(
+    const std::string& filename,
+    LogPersistentCache::Config config,
+    std::unique_ptr<fizz::Factory> factory)
+    : logCache_(std::make_unique<LogPersistentCache>(filename, config)),
+      factory_(std::move(factory)) {
+}
+
+folly::Optional<PersistentQuicCachedPsk> PersistentQuicPskCache::getCachedPsk(
+    const std::string& identity) {
+  if (cache_) {
+    return cache_->get(identity);
+  }
+  auto serialized = logCache_->get(identity);
+  if (!serialized) {
+    return folly::none;
+  }
+  try {
+    auto buf = folly::IOBuf::wrapBuffer(serialized->data(), serialized->size());
+    folly::io::Cursor cursor(buf.get());
+    PersistentQuicCachedPsk cachedPsk;
+    cachedPsk.fizzPsk = cursor.readFixedString(cursor.readLE<uint32_t>());
+    cachedPsk.quicParams = cursor.readFixedString(cursor.readLE<uint32_t>());
+    cachedPsk.uses = cursor.readLE<uint64_t>();
+    return cachedPsk;
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Error deserializing cached PSK: " << ex.what();
+    logCache_->remove(identity);
+    return folly::none;
+  }
+}
+
+void PersistentQuicPskCache::putCachedPsk(
+    const std::string& identity, const PersistentQuicCachedPsk& cachedPsk) {
+  if (cache_) {
+    cache_->put(identity, cachedPsk);
+    return;
+  }
+  auto buf = folly::IOBuf::create(0);
+  folly::io::Appender appender(buf.get(), 512);
+  appender.writeLE<uint32_t>(cachedPsk.fizzPsk.size());
+  appender.push(folly::ByteRange(folly::StringPiece(cachedPsk.fizzPsk)));
+  appender.writeLE<uint32_t>(cachedPsk.quicParams.size());
+  appender.push(folly::ByteRange(folly::StringPiece(cachedPsk.quicParams)));
+  appender.writeLE<uint64_t>(cachedPsk.uses);
+  logCache_->put(identity, buf->moveToFbString().toStdString());
+}
+
+void PersistentQuicPskCache::removeCachedPsk(const std::string& identity) {
+  if (cache_) {
+    cache_->remove(identity);
+  } else {
+    logCache_->remove(identity);
+  }
 }
 
 void PersistentQuicPskCache::setMaxPskUses(size_t maxUses) {
@@ -31,7 +90,7 @@ void PersistentQuicPskCache::setMaxPskUses(size_t maxUses) {
 
 folly::Optional<size_t> PersistentQuicPskCache::getPskUses(
     const std::string& identity) {
-  auto cachedPsk = cache_.get(identity);
+  auto cachedPsk = getCachedPsk(identity);
   if (cachedPsk) {
     return cachedPsk->uses;
   }
@@ -40,7 +99,7 @@ folly::Optional<size_t> PersistentQuicPskCache::getPskUses(
 
 folly::Optional<quic::QuicCachedPsk> PersistentQuicPskCache::getPsk(
     const std::string& identity) {
-  auto cachedPsk = cache_.get(identity);
+  auto cachedPsk = getCachedPsk(identity);
   if (!cachedPsk) {
     return folly::none;
   }
@@ -75,14 +134,14 @@ folly::Optional<quic::QuicCachedPsk> PersistentQuicPskCache::getPsk(
 
     cachedPsk->uses++;
     if (maxPskUses_ != 0 && cachedPsk->uses >= maxPskUses_) {
-      cache_.remove(identity);
+      removeCachedPsk(identity);
     } else {
-      cache_.put(identity, *cachedPsk);
+      putCachedPsk(identity, *cachedPsk);
     }
     return std::move(quicCachedPsk);
   } catch (const std::exception& ex) {
     LOG(ERROR) << "Error deserializing PSK: " << ex.what();
-    cache_.remove(identity);
+    removeCachedPsk(identity);
     return folly::none;
   }
 }
@@ -116,11 +175,11 @@ void PersistentQuicPskCache::putPsk(const std::string& identity,
       appender);
   cachedPsk.quicParams = quicParams->moveToFbString().toStdString();
   cachedPsk.uses = 0;
-  cache_.put(identity, cachedPsk);
+  putCachedPsk(identity, cachedPsk);
 }
 
 void PersistentQuicPskCache::removePsk(const std::string& identity) {
-  cache_.remove(identity);
+  removeCachedPsk(identity);
 }
 } // namespace proxygen
 
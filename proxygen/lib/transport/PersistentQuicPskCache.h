@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <proxygen/lib/transport/LogPersistentCache.h>
 #include <proxygen/lib/transport/PersistentFizzPskCache.h>
 
 #include <fizz/client/PskSerializationUtils.h>
@@ -37,6 +38,16 @@ class PersistentQuicPskCache : public quic::QuicPskCache {
                          std::unique_ptr<fizz::Factory> factory =
                              std::make_unique<fizz::OpenSSLFactory>());
 
+  /**
+   * Persists the cache as an append-only log instead of JSON, so that
+   * loading and every sync cost O(changes) rather than O(cache). The file
+   * formats are not compatible.
+   */
+  PersistentQuicPskCache(const std::string& filename,
+                         LogPersistentCache::Config config,
+                         std::unique_ptr<fizz::Factory> factory =
+                             std::make_unique<fizz::OpenSSLFactory>());
+
   void setMaxPskUses(size_t maxUses);
 
   /**
@@ -51,7 +62,17 @@ class PersistentQuicPskCache : public quic::QuicPskCache {
   void removePsk(const std::string& identity) override;
 
  private:
-  wangle::FilePersistentCache<std::string, PersistentQuicCachedPsk> cache_;
+  folly::Optional<PersistentQuicCachedPsk> getCachedPsk(
+      const std::string& identity);
+  void putCachedPsk(const std::string& identity,
+                    const PersistentQuicCachedPsk& cachedPsk);
+  void removeCachedPsk(const std::string& identity);
+
+  // One of them is set
+  std::unique_ptr<
+      wangle::FilePersistentCache<std::string, PersistentQuicCachedPsk>>
+      cache_;
+  std::unique_ptr<LogPersistentCache> logCache_;
   size_t maxPskUses_{5};
   std::unique_ptr<fizz::Factory> factory_;
 };
@@ -12,20 +12,35 @@ namespace proxygen {
 
 PersistentQuicTokenCache::PersistentQuicTokenCache(
     const std::string& filename, wangle::PersistentCacheConfig config)
-    : cache_(filename, std::move(config)){};
+    : cache_(std::make_unique<
+             wangle::FilePersistentCache<std::string, std::string>>(
+          filename, std::move(config))){};
+
+PersistentQuicTokenCache::PersistentQuicTokenCache(
+    const std::string& filename, LogPersistentCache::Config config)
+    : logCache_(std::make_unique<LogPersistentCache>(filename, config)) {
+}
 
 folly::Optional<std::string> PersistentQuicTokenCache::getToken(
     const std::string& hostname) {
-  return cache_.get(hostname);
+  return cache_ ? cache_->get(hostname) : logCache_->get(hostname);
 }
 
 void PersistentQuicTokenCache::putToken(const std::string& hostname,
                                         std::string token) {
-  cache_.put(hostname, token);
+  if (cache_) {
+    cache_->put(hostname, token);
+  } else {
+    logCache_->put(hostname, std::move(token));
+  }
 }
 
 void PersistentQuicTokenCache::removeToken(const std::string& hostname) {
-  cache_.remove(hostname);
+  if (cache_) {
+    cache_->remove(hostname);
+  } else {
+    logCache_->remove(hostname);
+  }
 }
 
 } // namespace proxygen
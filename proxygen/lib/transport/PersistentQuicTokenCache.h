@@ -10,6 +10,7 @@
 
 #include <string>
 
+#include <proxygen/lib/transport/LogPersistentCache.h>
 #include <quic/fizz/client/handshake/QuicTokenCache.h>
 #include <wangle/client/persistence/FilePersistentCache.h>
 
@@ -20,6 +21,11 @@ class PersistentQuicTokenCache : public quic::QuicTokenCache {
   PersistentQuicTokenCache(const std::string& filename,
                            wangle::PersistentCacheConfig config);
 
+  // Persists the cache as an append-only log instead of JSON, see
+  // LogPersistentCache. The file formats are not compatible.
+  PersistentQuicTokenCache(const std::string& filename,
+                           LogPersistentCache::Config config);
+
   [[nodiscard]] folly::Optional<std::string> getToken(
       const std::string& hostname) override;
 
@@ -28,7 +34,10 @@ class PersistentQuicTokenCache : public quic::QuicTokenCache {
   void removeToken(const std::string&) override;
 
  private:
-  wangle::FilePersistentCache<std::string, std::string> cache_;
+  // One of them is set
+  std::unique_ptr<wangle::FilePersistentCache<std::string, std::string>>
+      cache_;
+  std::unique_ptr<LogPersistentCache> logCache_;
 };
 
 } // namespace proxygen
@@ -59,4 +59,36 @@ TEST_F(AsyncUDPSocketFactoryTest, BindFailure) {
   EXPECT_TRUE(maybeSocket.hasError());
 }
 
+TEST_F(AsyncUDPSocketFactoryTest, BatchStats) {
+  AsyncUDPSocketFactory factory(&evb_, getV6TestAddress(), getV4TestAddress());
+  auto stats = std::make_shared<UDPBatchStats>();
+  AsyncUDPSocketFactory::SocketCreateOptions options;
+  options.batchStats = stats;
+  auto maybeSocket = factory.createSocket(getV4TestAddress(), options);
+  ASSERT_FALSE(maybeSocket.hasError());
+  auto& socket = maybeSocket.value();
+  ASSERT_NE(dynamic_cast<CountingUDPSocket*>(socket.get()), nullptr);
+
+  auto buf = folly::IOBuf::copyBuffer("hello");
+  EXPECT_GE(socket->write(socket->address(), buf), 0);
+  EXPECT_EQ(stats->writeCalls.load(), 1);
+  EXPECT_EQ(stats->packetsWritten.load(), 1);
+}
+
+TEST_F(AsyncUDPSocketFactoryTest, RequireGSO) {
+  AsyncUDPSocketFactory factory(&evb_, getV6TestAddress(), getV4TestAddress());
+  AsyncUDPSocketFactory::SocketCreateOptions options;
+  options.requireGSO = true;
+  options.enableGRO = true;
+  auto maybeSocket = factory.createSocket(getV4TestAddress(), options);
+  if (maybeSocket.hasError()) {
+    // Only fails when the kernel has no GSO
+    folly::AsyncUDPSocket probe(&evb_);
+    probe.bind(getV4TestAddress());
+    EXPECT_LT(probe.getGSO(), 0);
+  } else {
+    EXPECT_GE(maybeSocket.value()->getGSO(), 0);
+  }
+}
+
 } // namespace proxygen
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/transport/CountingUDPSocket.h>
+
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Sockets.h>
+
+using namespace proxygen;
+
+class CountingUDPSocketTest : public testing::Test {
+ public:
+  void SetUp() override {
+    sender_.bind(folly::SocketAddress("127.0.0.1", 0));
+    receiver_.bind(folly::SocketAddress("127.0.0.1", 0));
+  }
+
+ protected:
+  std::unique_ptr<folly::IOBuf> makeBuf(size_t len) {
+    auto buf = folly::IOBuf::create(len);
+    memset(buf->writableData(), 'a', len);
+    buf->append(len);
+    return buf;
+  }
+
+  // Reads everything queued on the receiver in one recvmmsg
+  int readAll() {
+    constexpr size_t kNumMsgs = 8;
+    std::array<std::array<char, 4096>, kNumMsgs> bufs;
+    std::array<struct iovec, kNumMsgs> iovs;
+    std::array<struct mmsghdr, kNumMsgs> msgs{};
+    for (size_t i = 0; i < kNumMsgs; i++) {
+      iovs[i].iov_base = bufs[i].data();
+      iovs[i].iov_len = bufs[i].size();
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return receiver_.recvmmsg(msgs.data(), kNumMsgs, MSG_DONTWAIT, nullptr);
+  }
+
+  folly::EventBase evb_;
+  std::shared_ptr<UDPBatchStats> senderStats_{
+      std::make_shared<UDPBatchStats>()};
+  std::shared_ptr<UDPBatchStats> receiverStats_{
+      std::make_shared<UDPBatchStats>()};
+  CountingUDPSocket sender_{&evb_, senderStats_};
+  CountingUDPSocket receiver_{&evb_, receiverStats_};
+};
+
+TEST_F(CountingUDPSocketTest, Write) {
+  auto buf = makeBuf(100);
+  EXPECT_EQ(sender_.write(receiver_.address(), buf), 100);
+  EXPECT_EQ(senderStats_->writeCalls.load(), 1);
+  EXPECT_EQ(senderStats_->packetsWritten.load(), 1);
+  EXPECT_EQ(readAll(), 1);
+  EXPECT_EQ(receiverStats_->readCalls.load(), 1);
+  EXPECT_EQ(receiverStats_->packetsRead.load(), 1);
+}
+
+TEST_F(CountingUDPSocketTest, Writem) {
+  std::array<std::unique_ptr<folly::IOBuf>, 3> bufs{
+      makeBuf(100), makeBuf(200), makeBuf(300)};
+  std::array<folly::SocketAddress, 1> addrs{receiver_.address()};
+  EXPECT_EQ(sender_.writem(folly::range(addrs), bufs.data(), bufs.size()), 3);
+  EXPECT_EQ(senderStats_->writeCalls.load(), 1);
+  EXPECT_EQ(senderStats_->packetsWritten.load(), 3);
+  EXPECT_DOUBLE_EQ(senderStats_->packetsPerWrite(), 3);
+
+  EXPECT_EQ(readAll(), 3);
+  EXPECT_EQ(receiverStats_->readCalls.load(), 1);
+  EXPECT_EQ(receiverStats_->packetsRead.load(), 3);
+  EXPECT_DOUBLE_EQ(receiverStats_->packetsPerRead(), 3);
+}
+
+TEST_F(CountingUDPSocketTest, WriteGSO) {
+  if (sender_.getGSO() < 0) {
+    GTEST_SKIP() << "UDP GSO not supported";
+  }
+  // 2 full segments and a short one
+  auto buf = makeBuf(2500);
+  EXPECT_EQ(sender_.writeGSO(receiver_.address(), buf, 1000), 2500);
+  EXPECT_EQ(senderStats_->writeCalls.load(), 1);
+  EXPECT_EQ(senderStats_->packetsWritten.load(), 3);
+  // Without GRO the receiver gets each segment as its own datagram
+  EXPECT_EQ(readAll(), 3);
+  EXPECT_EQ(receiverStats_->packetsRead.load(), 3);
+}
+
+TEST_F(CountingUDPSocketTest, FailedReadNotCounted) {
+  EXPECT_LT(readAll(), 0);
+  EXPECT_EQ(receiverStats_->readCalls.load(), 0);
+  EXPECT_DOUBLE_EQ(receiverStats_->packetsPerRead(), 0);
+}
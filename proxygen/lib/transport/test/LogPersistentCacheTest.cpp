@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/transport/LogPersistentCache.h>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Unistd.h>
+#include <folly/testing/TestUtil.h>
+
+using namespace proxygen;
+using namespace testing;
+
+class LogPersistentCacheTest : public Test {
+ public:
+  void SetUp() override {
+    file_ = (dir_.path() / "cache").string();
+    config_.capacity = 10;
+    // Only the explicit syncs write
+    config_.syncInterval = std::chrono::hours(1);
+    config_.minCompactionRecords = 8;
+    createCache();
+  }
+
+  void createCache() {
+    cache_.reset();
+    cache_ = std::make_unique<LogPersistentCache>(file_, config_);
+  }
+
+  size_t getFileSize() {
+    std::string contents;
+    folly::readFile(file_.c_str(), contents);
+    return contents.size();
+  }
+
+ protected:
+  folly::test::TemporaryDirectory dir_;
+  std::string file_;
+  LogPersistentCache::Config config_;
+  std::unique_ptr<LogPersistentCache> cache_;
+};
+
+TEST_F(LogPersistentCacheTest, Reload) {
+  cache_->put("a", "1");
+  cache_->put("b", "2");
+  cache_->put("a", "3");
+  cache_->put("c", "4");
+  EXPECT_TRUE(cache_->remove("c"));
+  EXPECT_FALSE(cache_->remove("d"));
+  EXPECT_EQ(*cache_->get("a"), "3");
+
+  // The destructor syncs
+  createCache();
+  EXPECT_EQ(cache_->size(), 2);
+  EXPECT_EQ(*cache_->get("a"), "3");
+  EXPECT_EQ(*cache_->get("b"), "2");
+  EXPECT_FALSE(cache_->get("c").has_value());
+}
+
+TEST_F(LogPersistentCacheTest, SyncAppendsChanges) {
+  cache_->put("a", "1");
+  cache_->sync();
+  auto size = getFileSize();
+  cache_->put("b", "2");
+  cache_->sync();
+  auto grown = getFileSize() - size;
+  // Only the new record was written
+  EXPECT_GT(grown, 0);
+  EXPECT_LT(grown, size);
+  // Nothing at all without changes
+  cache_->sync();
+  EXPECT_EQ(getFileSize() - size, grown);
+}
+
+TEST_F(LogPersistentCacheTest, Compaction) {
+  for (int i = 0; i < 20; ++i) {
+    cache_->put("a", folly::to<std::string>(i));
+  }
+  EXPECT_EQ(cache_->getNumLogRecords(), 20);
+  cache_->sync();
+  EXPECT_EQ(cache_->getNumLogRecords(), 1);
+
+  createCache();
+  EXPECT_EQ(*cache_->get("a"), "19");
+  EXPECT_EQ(cache_->getNumLogRecords(), 1);
+}
+
+TEST_F(LogPersistentCacheTest, EvictionIsPersisted) {
+  for (int i = 0; i < 12; ++i) {
+    cache_->put(folly::to<std::string>(i), "v");
+  }
+  EXPECT_EQ(cache_->size(), 10);
+  createCache();
+  EXPECT_EQ(cache_->size(), 10);
+  EXPECT_FALSE(cache_->get("0").has_value());
+  EXPECT_FALSE(cache_->get("1").has_value());
+  EXPECT_TRUE(cache_->get("11").has_value());
+}
+
+TEST_F(LogPersistentCacheTest, TornTail) {
+  cache_->put("a", "1");
+  cache_->put("b", "2");
+  cache_.reset();
+
+  std::string contents;
+  folly::readFile(file_.c_str(), contents);
+  contents.resize(contents.size() - 3);
+  folly::writeFile(contents, file_.c_str());
+
+  createCache();
+  EXPECT_EQ(*cache_->get("a"), "1");
+  EXPECT_FALSE(cache_->get("b").has_value());
+
+  // The corrupted tail was dropped, so new records can be read back
+  cache_->put("c", "3");
+  createCache();
+  EXPECT_EQ(*cache_->get("a"), "1");
+  EXPECT_EQ(*cache_->get("c"), "3");
+}
+
+TEST_F(LogPersistentCacheTest, NotALog) {
+  cache_.reset();
+  folly::writeFile(std::string("{\"a\": 1}"), file_.c_str());
+  createCache();
+  EXPECT_EQ(cache_->size(), 0);
+  cache_->put("a", "1");
+  createCache();
+  EXPECT_EQ(*cache_->get("a"), "1");
+}
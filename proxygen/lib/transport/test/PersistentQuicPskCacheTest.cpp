@@ -161,6 +161,29 @@ TEST_F(PersistentQuicPskCacheTest, TestInsert2Hosts) {
   EXPECT_FALSE(cache_->getPsk("somethingelse.com").has_value());
 }
 
+TEST_F(PersistentQuicPskCacheTest, TestLogCache) {
+  cache_.reset();
+  unlink(file_.c_str());
+  auto createLogCache = [this] {
+    cache_.reset();
+    LogPersistentCache::Config config;
+    config.capacity = 50;
+    cache_ = std::make_unique<PersistentQuicPskCache>(file_, config);
+  };
+  createLogCache();
+  cache_->putPsk("facebook.com", quicPsk1_);
+  cache_->putPsk("something.com", quicPsk2_);
+  expectMatch(*cache_->getPsk("facebook.com"), quicPsk1_);
+
+  createLogCache();
+
+  expectMatch(*cache_->getPsk("facebook.com"), quicPsk1_);
+  expectMatch(*cache_->getPsk("something.com"), quicPsk2_);
+  // The uses are persisted too
+  EXPECT_EQ(*cache_->getPskUses("facebook.com"), 2);
+  EXPECT_FALSE(cache_->getPsk("somethingelse.com").has_value());
+}
+
 TEST_F(PersistentQuicPskCacheTest, TestOverwrite) {
   cache_->putPsk("facebook.com", quicPsk1_);
   cache_->putPsk("facebook.com", quicPsk2_);
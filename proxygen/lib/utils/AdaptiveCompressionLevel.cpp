@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/AdaptiveCompressionLevel.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+#include <proxygen/lib/stats/ResourceStats.h>
+#include <zlib.h>
+
+namespace proxygen {
+
+AdaptiveCompressionLevel::AdaptiveCompressionLevel(Options options,
+                                                   LoadFn load)
+    : options_(options), load_(std::move(load)) {
+  CHECK(load_);
+  CHECK_LE(options_.lowLoad, options_.highLoad);
+  CHECK_GT(options_.numSteps, 0);
+}
+
+AdaptiveCompressionLevel::AdaptiveCompressionLevel(
+    Options options, std::shared_ptr<ResourceStats> resourceStats)
+    : AdaptiveCompressionLevel(options, [resourceStats]() {
+        return resourceStats->getCurrentData().getCpuRatioUtil();
+      }) {
+  CHECK(resourceStats);
+}
+
+void AdaptiveCompressionLevel::maybeUpdate() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  auto next = nextUpdateNs_.load(std::memory_order_relaxed);
+  // Only the thread winning the exchange samples the load
+  if (now < next || !nextUpdateNs_.compare_exchange_strong(
+                        next,
+                        now + std::chrono::nanoseconds(options_.adjustInterval)
+                                  .count(),
+                        std::memory_order_relaxed)) {
+    return;
+  }
+  update();
+}
+
+void AdaptiveCompressionLevel::update() {
+  auto load = load_();
+  lastLoad_.store(load, std::memory_order_relaxed);
+  auto pressure = pressure_.load(std::memory_order_relaxed);
+  if (load > options_.highLoad && pressure < options_.numSteps) {
+    pressure++;
+    increases_.fetch_add(1, std::memory_order_relaxed);
+    VLOG(2) << "Compression pressure up to " << pressure << " at load "
+            << load;
+  } else if (load < options_.lowLoad && pressure > 0) {
+    pressure--;
+    decreases_.fetch_add(1, std::memory_order_relaxed);
+    VLOG(2) << "Compression pressure down to " << pressure << " at load "
+            << load;
+  }
+  pressure_.store(pressure, std::memory_order_relaxed);
+  skipping_.store(pressure == options_.numSteps && load > options_.skipLoad,
+                  std::memory_order_relaxed);
+}
+
+int32_t AdaptiveCompressionLevel::adjust(int32_t configured,
+                                         int32_t minLevel) {
+  maybeUpdate();
+  auto pressure = pressure_.load(std::memory_order_relaxed);
+  if (pressure == 0 || configured <= minLevel) {
+    return configured;
+  }
+  auto range = configured - minLevel;
+  return configured - static_cast<int32_t>(std::lround(
+                          static_cast<double>(range) * pressure /
+                          options_.numSteps));
+}
+
+int32_t AdaptiveCompressionLevel::getZlibLevel(int32_t configured) {
+  if (configured == Z_DEFAULT_COMPRESSION) {
+    // What zlib means by it
+    auto level = adjust(6, options_.minZlibLevel);
+    return level == 6 ? configured : level;
+  }
+  return adjust(configured, options_.minZlibLevel);
+}
+
+int32_t AdaptiveCompressionLevel::getZstdLevel(int32_t configured) {
+  return adjust(configured, options_.minZstdLevel);
+}
+
+int32_t AdaptiveCompressionLevel::getBrotliQuality(int32_t configured) {
+  return adjust(configured, options_.minBrotliQuality);
+}
+
+bool AdaptiveCompressionLevel::shouldSkip(uint64_t contentLength) {
+  maybeUpdate();
+  if (contentLength <= options_.skipBodyBytes ||
+      !skipping_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  skipped_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void AdaptiveCompressionLevel::recordResponse(folly::StringPiece encoding,
+                                              int32_t level) {
+  auto it = std::find(kEncodings.begin(), kEncodings.end(), encoding);
+  if (it == kEncodings.end()) {
+    return;
+  }
+  auto index = std::clamp<int32_t>(level - kMinLevel, 0, kNumLevels - 1);
+  responses_[it - kEncodings.begin()][index].fetch_add(
+      1, std::memory_order_relaxed);
+}
+
+AdaptiveCompressionLevel::Stats AdaptiveCompressionLevel::getStats() const {
+  Stats stats;
+  stats.pressure = pressure_.load(std::memory_order_relaxed);
+  stats.load = lastLoad_.load(std::memory_order_relaxed);
+  stats.increases = increases_.load(std::memory_order_relaxed);
+  stats.decreases = decreases_.load(std::memory_order_relaxed);
+  stats.skipped = skipped_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < kEncodings.size(); ++i) {
+    for (size_t j = 0; j < kNumLevels; ++j) {
+      auto count = responses_[i][j].load(std::memory_order_relaxed);
+      if (count > 0) {
+        stats.responses[kEncodings[i].str()][j + kMinLevel] = count;
+      }
+    }
+  }
+  return stats;
+}
+
+} // namespace proxygen
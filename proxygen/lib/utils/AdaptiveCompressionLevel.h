@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <folly/Range.h>
+
+namespace proxygen {
+
+class ResourceStats;
+
+/**
+ * Lowers the compression levels CompressionFilter uses as the CPU gets
+ * busy, so that peaks cost compression ratio rather than shed load.
+ *
+ * The load is sampled at most every adjustInterval. Above highLoad the
+ * pressure goes up one step, below lowLoad it goes down one, in between it
+ * stays, so the levels don't flap around a threshold. At full pressure
+ * every codec is at its minimum level, and above skipLoad responses larger
+ * than skipBodyBytes are not compressed at all.
+ *
+ * All methods are thread safe, and cheap enough to call per request.
+ */
+class AdaptiveCompressionLevel {
+ public:
+  struct Options {
+    // Load, from 0 to 1, above which the pressure goes up
+    double highLoad{0.8};
+    // and below which it goes down
+    double lowLoad{0.6};
+    // Non chunked responses above skipBodyBytes are sent uncompressed at
+    // full pressure and above this load. Above 1 disables skipping.
+    double skipLoad{0.95};
+    uint64_t skipBodyBytes{64 * 1024};
+    // Steps from the configured levels to the minimum ones
+    uint32_t numSteps{3};
+    std::chrono::milliseconds adjustInterval{std::chrono::seconds(1)};
+    int32_t minZlibLevel{1};
+    int32_t minZstdLevel{1};
+    int32_t minBrotliQuality{1};
+  };
+
+  struct Stats {
+    uint32_t pressure{0};
+    double load{0};
+    uint64_t increases{0};
+    uint64_t decreases{0};
+    uint64_t skipped{0};
+    // Compressed responses by encoding and level
+    std::map<std::string, std::map<int32_t, uint64_t>> responses;
+  };
+
+  // Returns the current load, from 0 to 1
+  using LoadFn = std::function<double()>;
+
+  AdaptiveCompressionLevel(Options options, LoadFn load);
+
+  /**
+   * The load is the CPU utilization measured by resourceStats, which must
+   * be refreshing.
+   */
+  AdaptiveCompressionLevel(Options options,
+                           std::shared_ptr<ResourceStats> resourceStats);
+
+  // The levels to use instead of the configured ones
+  int32_t getZlibLevel(int32_t configured);
+  int32_t getZstdLevel(int32_t configured);
+  int32_t getBrotliQuality(int32_t configured);
+
+  // Whether to skip compressing a response of contentLength bytes
+  bool shouldSkip(uint64_t contentLength);
+
+  void recordResponse(folly::StringPiece encoding, int32_t level);
+
+  // Samples the load now, regardless of the adjust interval
+  void update();
+
+  uint32_t getPressure() const {
+    return pressure_.load(std::memory_order_relaxed);
+  }
+
+  Stats getStats() const;
+
+ private:
+  // From -5, the lowest zstd level, to 22, the highest
+  static constexpr int32_t kMinLevel = -5;
+  static constexpr size_t kNumLevels = 28;
+  static constexpr std::array<folly::StringPiece, 4> kEncodings = {
+      "gzip", "zstd", "br", "dcz"};
+
+  void maybeUpdate();
+  int32_t adjust(int32_t configured, int32_t minLevel);
+
+  const Options options_;
+  const LoadFn load_;
+  std::atomic<uint32_t> pressure_{0};
+  std::atomic<bool> skipping_{false};
+  std::atomic<double> lastLoad_{0};
+  std::atomic<int64_t> nextUpdateNs_{0};
+  std::atomic<uint64_t> increases_{0};
+  std::atomic<uint64_t> decreases_{0};
+  std::atomic<uint64_t> skipped_{0};
+  std::array<std::array<std::atomic<uint64_t>, kNumLevels>, kEncodings.size()>
+      responses_{};
+};
+
+} // namespace proxygen
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/AdaptiveStreamLimit.h>
+
+#include <cmath>
+
+#include <glog/logging.h>
+#include <proxygen/lib/stats/ResourceStats.h>
+
+namespace proxygen {
+
+AdaptiveStreamLimit::AdaptiveStreamLimit(Options options, LoadFn load)
+    : options_(options), load_(std::move(load)) {
+  CHECK(load_);
+  CHECK_LE(options_.lowLoad, options_.highLoad);
+  CHECK_GT(options_.numSteps, 0);
+}
+
+AdaptiveStreamLimit::AdaptiveStreamLimit(
+    Options options, std::shared_ptr<ResourceStats> resourceStats)
+    : AdaptiveStreamLimit(options, [resourceStats]() {
+        return resourceStats->getCurrentData().getCpuRatioUtil();
+      }) {
+  CHECK(resourceStats);
+}
+
+bool AdaptiveStreamLimit::update() {
+  auto load = load_();
+  lastLoad_.store(load, std::memory_order_relaxed);
+  auto pressure = pressure_.load(std::memory_order_relaxed);
+  if (load > options_.highLoad && pressure < options_.numSteps) {
+    pressure++;
+    increases_.fetch_add(1, std::memory_order_relaxed);
+    VLOG(2) << "Stream limit pressure up to " << pressure << " at load "
+            << load;
+  } else if (load < options_.lowLoad && pressure > 0) {
+    pressure--;
+    decreases_.fetch_add(1, std::memory_order_relaxed);
+    VLOG(2) << "Stream limit pressure down to " << pressure << " at load "
+            << load;
+  } else {
+    return false;
+  }
+  pressure_.store(pressure, std::memory_order_relaxed);
+  return true;
+}
+
+uint32_t AdaptiveStreamLimit::getLimit(uint32_t configured) const {
+  auto pressure = pressure_.load(std::memory_order_relaxed);
+  if (pressure == 0 || configured <= options_.minStreams) {
+    return configured;
+  }
+  auto range = configured - options_.minStreams;
+  return configured - static_cast<uint32_t>(std::lround(
+                          static_cast<double>(range) * pressure /
+                          options_.numSteps));
+}
+
+AdaptiveStreamLimit::Stats AdaptiveStreamLimit::getStats() const {
+  Stats stats;
+  stats.pressure = pressure_.load(std::memory_order_relaxed);
+  stats.load = lastLoad_.load(std::memory_order_relaxed);
+  stats.increases = increases_.load(std::memory_order_relaxed);
+  stats.decreases = decreases_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace proxygen
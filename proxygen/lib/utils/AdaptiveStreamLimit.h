@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace proxygen {
+
+class ResourceStats;
+
+/**
+ * Lowers the concurrent stream limit advertised to the clients as the
+ * server gets busy, so that under overload they queue requests rather than
+ * the server.
+ *
+ * Like AdaptiveCompressionLevel, every update() above highLoad raises the
+ * pressure one step and below lowLoad lowers it one.  At full pressure the
+ * limit is minStreams, in between it is linear from the configured one.
+ *
+ * The load may combine whatever signals the caller has, such as the CPU
+ * utilization or the time requests wait for a worker, mapped to [0, 1].
+ * All methods are thread safe.
+ */
+class AdaptiveStreamLimit {
+ public:
+  struct Options {
+    // Load, from 0 to 1, above which the pressure goes up
+    double highLoad{0.85};
+    // and below which it goes down
+    double lowLoad{0.6};
+    uint32_t minStreams{10};
+    // Steps from the configured limit to minStreams
+    uint32_t numSteps{4};
+    // How often HTTPServer samples the load
+    std::chrono::milliseconds adjustInterval{std::chrono::seconds(1)};
+  };
+
+  struct Stats {
+    uint32_t pressure{0};
+    double load{0};
+    uint64_t increases{0};
+    uint64_t decreases{0};
+  };
+
+  // Returns the current load, from 0 to 1
+  using LoadFn = std::function<double()>;
+
+  AdaptiveStreamLimit(Options options, LoadFn load);
+
+  /**
+   * The load is the CPU utilization measured by resourceStats, which must
+   * be refreshing.
+   */
+  AdaptiveStreamLimit(Options options,
+                      std::shared_ptr<ResourceStats> resourceStats);
+
+  // Samples the load, returns whether the pressure changed
+  bool update();
+
+  // The limit to advertise instead of the configured one
+  uint32_t getLimit(uint32_t configured) const;
+
+  uint32_t getPressure() const {
+    return pressure_.load(std::memory_order_relaxed);
+  }
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+  Stats getStats() const;
+
+ private:
+  const Options options_;
+  const LoadFn load_;
+  std::atomic<uint32_t> pressure_{0};
+  std::atomic<double> lastLoad_{0};
+  std::atomic<uint64_t> increases_{0};
+  std::atomic<uint64_t> decreases_{0};
+};
+
+} // namespace proxygen
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace proxygen {
+
+/**
+ * The part of a request heap allocations are charged to, when building with
+ * PROXYGEN_ALLOCATION_TRACKING.  The sessions and HTTPTransaction tag their
+ * hot paths with PROXYGEN_ALLOCATION_PHASE, and the malloc interposer in
+ * lib/test/AllocationTracker counts allocations by the innermost phase.
+ * Without the build flag the tags compile to nothing.
+ */
+enum class AllocationPhase : uint8_t {
+  NONE,
+  // Reading and parsing ingress, transaction setup included
+  PARSE,
+  // Handler callbacks
+  HANDLER,
+  // Serializing egress through the codec
+  ENCODE,
+  // The write loop
+  WRITE,
+};
+
+constexpr size_t kNumAllocationPhases = 5;
+
+inline const char* getAllocationPhaseString(AllocationPhase phase) {
+  switch (phase) {
+    case AllocationPhase::NONE:
+      return "none";
+    case AllocationPhase::PARSE:
+      return "parse";
+    case AllocationPhase::HANDLER:
+      return "handler";
+    case AllocationPhase::ENCODE:
+      return "encode";
+    case AllocationPhase::WRITE:
+      return "write";
+  }
+  return "unknown";
+}
+
+#ifdef PROXYGEN_ALLOCATION_TRACKING
+
+// The calling thread's innermost phase
+inline AllocationPhase& currentAllocationPhase() noexcept {
+  static thread_local AllocationPhase phase{AllocationPhase::NONE};
+  return phase;
+}
+
+class AllocationPhaseGuard {
+ public:
+  explicit AllocationPhaseGuard(AllocationPhase phase) noexcept
+      : previous_(currentAllocationPhase()) {
+    currentAllocationPhase() = phase;
+  }
+
+  ~AllocationPhaseGuard() {
+    currentAllocationPhase() = previous_;
+  }
+
+  AllocationPhaseGuard(const AllocationPhaseGuard&) = delete;
+  AllocationPhaseGuard& operator=(const AllocationPhaseGuard&) = delete;
+
+ private:
+  AllocationPhase previous_;
+};
+
+#define PROXYGEN_ALLOCATION_PHASE_CONCAT_(a, b) a##b
+#define PROXYGEN_ALLOCATION_PHASE_CONCAT(a, b) \
+  PROXYGEN_ALLOCATION_PHASE_CONCAT_(a, b)
+#define PROXYGEN_ALLOCATION_PHASE(phase)                           \
+  ::proxygen::AllocationPhaseGuard PROXYGEN_ALLOCATION_PHASE_CONCAT( \
+      allocationPhaseGuard, __LINE__)(::proxygen::AllocationPhase::phase)
+
+#else
+
+#define PROXYGEN_ALLOCATION_PHASE(phase) \
+  do {                                   \
+  } while (false)
+
+#endif
+
+} // namespace proxygen
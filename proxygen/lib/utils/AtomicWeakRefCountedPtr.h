@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <folly/io/async/EventBase.h>
+#include <glog/logging.h>
+#include <utility>
+
+namespace proxygen {
+
+/**
+ * The thread-safe counterpart of WeakRefCountedPtr, for objects living on an
+ * EventBase, e.g. sessions, to be referenced from other threads.
+ *
+ * An AtomicWeakRefCountedPtr may be copied and kept on any thread.  lock()
+ * gives a Locked, which keeps the target from being destroyed while held, or
+ * an empty one once the target is gone.  The strong and weak counts are
+ * atomics: neither locking nor the EventBase thread is involved.
+ *
+ * Enabling for a type T:
+ *   1. Derive from EnableAtomicWeakRefCountedPtr<T>, giving the EventBase.
+ *   2. Before destruction, call tryExpireAtomicWeakRefs() on the EventBase.
+ *      It fails while a Locked is held, and destruction must be delayed.
+ *   3. Implement onAtomicWeakRefsUnlocked, called on the EventBase once the
+ *      last Locked is released after a failed tryExpireAtomicWeakRefs().
+ *      Try again from it.
+ *
+ * What a Locked target may be used for off its EventBase is up to T;
+ * runInEventBaseThread() hands it to a function on its own thread.
+ */
+
+template <class T>
+class AtomicWeakRefCountedPtr;
+
+template <class T>
+struct AtomicWeakRefCountedPtrState {
+  // In strong, with the number of Locked
+  static constexpr uint64_t kExpired = 1ull << 63;
+  static constexpr uint64_t kWaiting = 1ull << 62;
+  static constexpr uint64_t kCountMask = kWaiting - 1;
+
+  AtomicWeakRefCountedPtrState(T* ptrIn, folly::EventBase* evbIn)
+      : ptr(ptrIn), evb(evbIn) {
+  }
+
+  void addWeak() {
+    weak.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void releaseWeak() {
+    if (weak.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  bool expired() const {
+    return strong.load(std::memory_order_acquire) & kExpired;
+  }
+
+  T* const ptr;
+  folly::EventBase* const evb;
+  std::atomic<uint64_t> strong{0};
+  // Held by each pointer and Locked, and by the target while it lives
+  std::atomic<uint64_t> weak{1};
+};
+
+/**
+ * Derive from EnableAtomicWeakRefCountedPtr to enable AtomicWeakRefCountedPtr
+ * for class.
+ */
+template <class T>
+class EnableAtomicWeakRefCountedPtr {
+ public:
+  explicit EnableAtomicWeakRefCountedPtr(folly::EventBase* evb) : evb_(evb) {
+    static_assert(std::is_base_of<EnableAtomicWeakRefCountedPtr<T>, T>::value,
+                  "T must derive from EnableAtomicWeakRefCountedPtr");
+  }
+
+  virtual ~EnableAtomicWeakRefCountedPtr() {
+    if (state_) {
+      // Should have been expired before T was torn down
+      CHECK(tryExpireAtomicWeakRefs()) << "Destroyed while locked";
+      state_->releaseWeak();
+    }
+  }
+
+  // EventBase thread
+  AtomicWeakRefCountedPtr<T> getAtomicWeakRefCountedPtr() {
+    DCHECK(evb_->isInEventBaseThread());
+    if (!state_) {
+      state_ = new AtomicWeakRefCountedPtrState<T>(static_cast<T*>(this), evb_);
+    }
+    return AtomicWeakRefCountedPtr<T>(state_);
+  }
+
+  /**
+   * EventBase thread.  Returns true if no Locked is held, after which lock()
+   * fails everywhere.  Otherwise onAtomicWeakRefsUnlocked follows.
+   */
+  bool tryExpireAtomicWeakRefs() {
+    if (!state_) {
+      return true;
+    }
+    using State = AtomicWeakRefCountedPtrState<T>;
+    auto strong = state_->strong.load(std::memory_order_acquire);
+    while (!(strong & State::kExpired)) {
+      auto next = (strong & State::kCountMask) == 0
+                      ? State::kExpired
+                      : (strong | State::kWaiting);
+      if (state_->strong.compare_exchange_weak(
+              strong, next, std::memory_order_acq_rel)) {
+        return next == State::kExpired;
+      }
+    }
+    return true;
+  }
+
+  uint64_t numAtomicWeakRefsLocked() const {
+    if (!state_) {
+      return 0;
+    }
+    return state_->strong.load(std::memory_order_relaxed) &
+           AtomicWeakRefCountedPtrState<T>::kCountMask;
+  }
+
+ protected:
+  virtual void onAtomicWeakRefsUnlocked() = 0;
+
+  template <typename U>
+  friend class AtomicWeakRefCountedPtr;
+
+ private:
+  folly::EventBase* evb_;
+  AtomicWeakRefCountedPtrState<T>* state_{nullptr};
+};
+
+template <class T>
+class AtomicWeakRefCountedPtr {
+  using State = AtomicWeakRefCountedPtrState<T>;
+
+ public:
+  /**
+   * Keeps the target alive while held.  Move-only, and may be released on
+   * any thread.
+   */
+  class Locked {
+   public:
+    Locked() = default;
+
+    Locked(Locked&& other) noexcept
+        : state_(std::exchange(other.state_, nullptr)) {
+    }
+
+    Locked& operator=(Locked&& other) noexcept {
+      if (this != &other) {
+        reset();
+        state_ = std::exchange(other.state_, nullptr);
+      }
+      return *this;
+    }
+
+    ~Locked() {
+      reset();
+    }
+
+    T* get() const {
+      return state_ ? state_->ptr : nullptr;
+    }
+
+    T* operator->() const {
+      return get();
+    }
+
+    explicit operator bool() const {
+      return state_ != nullptr;
+    }
+
+    void reset() {
+      if (!state_) {
+        return;
+      }
+      auto state = std::exchange(state_, nullptr);
+      auto strong = state->strong.load(std::memory_order_acquire);
+      uint64_t next;
+      do {
+        next = strong - 1;
+        if ((next & State::kCountMask) == 0) {
+          next &= ~State::kWaiting;
+        }
+      } while (!state->strong.compare_exchange_weak(
+          strong, next, std::memory_order_acq_rel));
+      if ((strong & State::kWaiting) && !(next & State::kWaiting)) {
+        // The target waits for this to be destroyed, on its EventBase
+        state->addWeak();
+        state->evb->runInEventBaseThread([state] {
+          // Unless expired meanwhile on this thread
+          if (!state->expired()) {
+            static_cast<EnableAtomicWeakRefCountedPtr<T>*>(state->ptr)
+                ->onAtomicWeakRefsUnlocked();
+          }
+          state->releaseWeak();
+        });
+      }
+      state->releaseWeak();
+    }
+
+   private:
+    friend class AtomicWeakRefCountedPtr;
+
+    explicit Locked(State* state) : state_(state) {
+    }
+
+    State* state_{nullptr};
+  };
+
+  AtomicWeakRefCountedPtr() = default;
+
+  AtomicWeakRefCountedPtr(const AtomicWeakRefCountedPtr& rhs)
+      : state_(rhs.state_) {
+    if (state_) {
+      state_->addWeak();
+    }
+  }
+
+  AtomicWeakRefCountedPtr(AtomicWeakRefCountedPtr&& rhs) noexcept
+      : state_(std::exchange(rhs.state_, nullptr)) {
+  }
+
+  AtomicWeakRefCountedPtr& operator=(const AtomicWeakRefCountedPtr& rhs) {
+    if (this != &rhs) {
+      reset();
+      state_ = rhs.state_;
+      if (state_) {
+        state_->addWeak();
+      }
+    }
+    return *this;
+  }
+
+  AtomicWeakRefCountedPtr& operator=(AtomicWeakRefCountedPtr&& rhs) noexcept {
+    if (this != &rhs) {
+      reset();
+      state_ = std::exchange(rhs.state_, nullptr);
+    }
+    return *this;
+  }
+
+  ~AtomicWeakRefCountedPtr() {
+    reset();
+  }
+
+  void reset() {
+    if (state_) {
+      std::exchange(state_, nullptr)->releaseWeak();
+    }
+  }
+
+  // Any thread; empty once the target is expired
+  Locked lock() const {
+    if (!state_) {
+      return Locked();
+    }
+    auto strong = state_->strong.load(std::memory_order_acquire);
+    while (!(strong & State::kExpired)) {
+      if (state_->strong.compare_exchange_weak(
+              strong, strong + 1, std::memory_order_acq_rel)) {
+        state_->addWeak();
+        return Locked(state_);
+      }
+    }
+    return Locked();
+  }
+
+  bool expired() const {
+    return !state_ || state_->expired();
+  }
+
+  /**
+   * Any thread.  Runs func(T&) on the EventBase of the target, which is kept
+   * alive until it has run.  false if the target is already gone.
+   */
+  template <typename F>
+  bool runInEventBaseThread(F&& func) const {
+    auto locked = lock();
+    if (!locked) {
+      return false;
+    }
+    state_->evb->runInEventBaseThread(
+        [locked = std::move(locked), func = std::forward<F>(func)]() mutable {
+          func(*locked.get());
+        });
+    return true;
+  }
+
+ private:
+  friend class EnableAtomicWeakRefCountedPtr<T>;
+
+  explicit AtomicWeakRefCountedPtr(State* state) : state_(state) {
+    state_->addWeak();
+  }
+
+  State* state_{nullptr};
+};
+
+} // namespace proxygen
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/BrotliStreamCompressor.h>
+
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+
+namespace {
+
+constexpr size_t kMinOutputSize = 1024;
+constexpr size_t kOutputSize = 16384;
+
+} // namespace
+
+namespace proxygen {
+
+void BrotliStreamCompressor::freeState(BrotliEncoderState* state) {
+  BrotliEncoderDestroyInstance(state);
+}
+
+BrotliStreamCompressor::BrotliStreamCompressor(int quality, int windowBits)
+    : quality_(quality), windowBits_(windowBits) {
+}
+
+BrotliEncoderState* BrotliStreamCompressor::getState() {
+  if (!state_) {
+    state_.reset(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr));
+    if (!state_ ||
+        !BrotliEncoderSetParameter(
+            state_.get(), BROTLI_PARAM_QUALITY, quality_) ||
+        !BrotliEncoderSetParameter(
+            state_.get(), BROTLI_PARAM_LGWIN, windowBits_)) {
+      state_.reset();
+    }
+  }
+  return state_.get();
+}
+
+bool BrotliStreamCompressor::compressRange(folly::ByteRange range,
+                                           BrotliEncoderOperation op,
+                                           folly::IOBufQueue& out) {
+  auto state = state_.get();
+  size_t availIn = range.size();
+  const uint8_t* nextIn = range.data();
+  do {
+    auto buf = out.preallocate(kMinOutputSize, kOutputSize);
+    size_t availOut = buf.second;
+    auto nextOut = static_cast<uint8_t*>(buf.first);
+    if (!BrotliEncoderCompressStream(
+            state, op, &availIn, &nextIn, &availOut, &nextOut, nullptr)) {
+      return false;
+    }
+    out.postallocate(buf.second - availOut);
+  } while (availIn > 0 || BrotliEncoderHasMoreOutput(state) ||
+           (op == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(state)));
+  return true;
+}
+
+std::unique_ptr<folly::IOBuf> BrotliStreamCompressor::compress(
+    const folly::IOBuf* in, bool last) {
+  if (error_) {
+    return nullptr;
+  }
+
+  if (in == nullptr || getState() == nullptr) {
+    error_ = true;
+    return nullptr;
+  }
+
+  folly::IOBufQueue out(folly::IOBufQueue::cacheChainLength());
+  for (const folly::ByteRange& range : *in) {
+    if (!range.empty() &&
+        !compressRange(range, BROTLI_OPERATION_PROCESS, out)) {
+      error_ = true;
+      return nullptr;
+    }
+  }
+  if (!compressRange(folly::ByteRange(),
+                     last ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_FLUSH,
+                     out)) {
+    error_ = true;
+    return nullptr;
+  }
+
+  if (last) {
+    state_.reset();
+  }
+  if (out.empty()) {
+    return folly::IOBuf::create(0);
+  }
+  return out.move();
+}
+
+} // namespace proxygen
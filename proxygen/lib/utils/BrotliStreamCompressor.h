@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <brotli/encode.h>
+
+#include <folly/Memory.h>
+#include <folly/Range.h>
+#include <proxygen/lib/utils/StreamCompressor.h>
+
+namespace folly {
+class IOBuf;
+class IOBufQueue;
+} // namespace folly
+
+namespace proxygen {
+
+/**
+ * Compresses a message with the br content-coding (RFC 7932). The stream
+ * is flushed after every chunk, and finished with the last one, after
+ * which the compressor may be reused for another message.
+ */
+class BrotliStreamCompressor : public StreamCompressor {
+ public:
+  /**
+   * @param quality    0 (fastest) to 11 (smallest). 11 is only worth it
+   *                   for content compressed ahead of time.
+   * @param windowBits 10 to 24, the log2 of the window size. Bigger windows
+   *                   compress better, at the cost of memory on both ends.
+   */
+  explicit BrotliStreamCompressor(int quality = 5, int windowBits = 22);
+
+  ~BrotliStreamCompressor() override = default;
+
+  std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf* in,
+                                         bool last = true) override;
+
+  bool hasError() override {
+    return error_;
+  }
+
+ private:
+  static void freeState(BrotliEncoderState* state);
+
+  BrotliEncoderState* getState();
+  bool compressRange(folly::ByteRange range,
+                     BrotliEncoderOperation op,
+                     folly::IOBufQueue& out);
+
+  std::unique_ptr<
+      BrotliEncoderState,
+      folly::static_function_deleter<BrotliEncoderState, freeState>>
+      state_;
+  const int quality_;
+  const int windowBits_;
+  bool error_ = false;
+};
+} // namespace proxygen
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/BrotliStreamDecompressor.h>
+
+#include <limits>
+
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+
+namespace {
+
+constexpr size_t kOutBufAllocSize = 16384;
+
+} // namespace
+
+namespace proxygen {
+
+void BrotliStreamDecompressor::freeState(BrotliDecoderState* state) {
+  BrotliDecoderDestroyInstance(state);
+}
+
+BrotliStreamDecompressor::BrotliStreamDecompressor()
+    : status_(BrotliStatusType::NONE),
+      state_(BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)) {
+}
+
+std::unique_ptr<folly::IOBuf> BrotliStreamDecompressor::decompress(
+    const folly::IOBuf* in) {
+  return decompressAtMost(in, std::numeric_limits<uint64_t>::max());
+}
+
+std::unique_ptr<folly::IOBuf> BrotliStreamDecompressor::decompressAtMost(
+    const folly::IOBuf* in, uint64_t maxOutput) {
+  if (!state_) {
+    status_ = BrotliStatusType::ERROR;
+  }
+  if (hasError()) {
+    return nullptr;
+  }
+
+  auto out = folly::IOBuf::create(kOutBufAllocSize);
+  auto appender = folly::io::Appender(out.get(), kOutBufAllocSize);
+
+  uint64_t outLen = 0;
+  for (const folly::ByteRange& range : *in) {
+    if (outLen >= maxOutput) {
+      break;
+    }
+    if (range.empty()) {
+      continue;
+    }
+
+    if (status_ == BrotliStatusType::FINISHED) {
+      // Nothing may follow the end of the stream
+      status_ = BrotliStatusType::ERROR;
+      return nullptr;
+    }
+    status_ = BrotliStatusType::CONTINUE;
+
+    size_t availIn = range.size();
+    const uint8_t* nextIn = range.data();
+    BrotliDecoderResult ret;
+    do {
+      appender.ensure(kOutBufAllocSize);
+      DCHECK_GT(appender.length(), 0);
+
+      size_t maxOut = std::min<uint64_t>(appender.length(), maxOutput - outLen);
+      size_t availOut = maxOut;
+      uint8_t* nextOut = appender.writableData();
+      ret = BrotliDecoderDecompressStream(
+          state_.get(), &availIn, &nextIn, &availOut, &nextOut, nullptr);
+      appender.append(maxOut - availOut);
+      outLen += maxOut - availOut;
+    } while (ret == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT &&
+             outLen < maxOutput);
+    if (ret == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) {
+      // Stopped at maxOutput, with more to come
+      break;
+    }
+
+    if (ret == BROTLI_DECODER_RESULT_ERROR ||
+        (ret == BROTLI_DECODER_RESULT_SUCCESS && availIn > 0)) {
+      status_ = BrotliStatusType::ERROR;
+      return nullptr;
+    } else if (ret == BROTLI_DECODER_RESULT_SUCCESS) {
+      status_ = BrotliStatusType::FINISHED;
+    }
+  }
+
+  return out;
+}
+} // namespace proxygen
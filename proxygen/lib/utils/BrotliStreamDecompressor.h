@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <brotli/decode.h>
+
+#include <folly/Memory.h>
+
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+namespace proxygen {
+
+class BrotliStreamDecompressor : public StreamDecompressor {
+ public:
+  BrotliStreamDecompressor();
+
+  // May return nullptr on error / no output.
+  std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) override;
+  std::unique_ptr<folly::IOBuf> decompressAtMost(const folly::IOBuf* in,
+                                                 uint64_t maxOutput) override;
+
+  bool hasError() override {
+    return status_ == BrotliStatusType::ERROR;
+  }
+
+  bool finished() override {
+    return status_ == BrotliStatusType::FINISHED;
+  }
+
+ private:
+  static void freeState(BrotliDecoderState* state);
+
+  enum class BrotliStatusType : int { NONE, CONTINUE, ERROR, FINISHED };
+
+  BrotliStatusType status_;
+
+  const std::unique_ptr<
+      BrotliDecoderState,
+      folly::static_function_deleter<BrotliDecoderState, freeState>>
+      state_;
+};
+} // namespace proxygen
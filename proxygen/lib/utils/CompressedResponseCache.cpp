@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/CompressedResponseCache.h>
+
+#include <array>
+#include <cstring>
+#include <limits>
+
+#include <folly/Conv.h>
+#include <folly/ssl/OpenSSLHash.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+CompressedResponseCache::Shard::Shard(size_t maxShardBytes)
+    // Bounded by bytes rather than entries
+    : map(std::numeric_limits<size_t>::max()), maxBytes(maxShardBytes) {
+}
+
+CompressedResponseCache::CompressedResponseCache(Options options)
+    : options_(options) {
+  CHECK_GT(options_.numShards, 0);
+  auto shardBytes = options_.maxBytes / options_.numShards;
+  shards_.reserve(options_.numShards);
+  for (size_t i = 0; i < options_.numShards; ++i) {
+    shards_.push_back(
+        std::make_unique<folly::Synchronized<Shard, std::mutex>>(
+            std::in_place, shardBytes));
+  }
+}
+
+std::string CompressedResponseCache::makeKey(folly::StringPiece validator,
+                                             folly::StringPiece encoding,
+                                             int32_t level) {
+  // The validator goes last, as it may contain any character
+  return folly::to<std::string>(encoding, ":", level, ":v:", validator);
+}
+
+std::string CompressedResponseCache::makeDigestKey(const folly::IOBuf& body,
+                                                   folly::StringPiece encoding,
+                                                   int32_t level) {
+  std::array<uint8_t, 32> digest;
+  folly::ssl::OpenSSLHash::sha256(folly::range(digest), body);
+  return folly::to<std::string>(
+      encoding, ":", level, ":d:", folly::StringPiece(folly::range(digest)));
+}
+
+folly::Synchronized<CompressedResponseCache::Shard, std::mutex>&
+CompressedResponseCache::getShard(const std::string& key) {
+  return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+std::unique_ptr<folly::IOBuf> CompressedResponseCache::get(
+    const std::string& key) {
+  auto shard = getShard(key).lock();
+  auto it = shard->map.find(key);
+  if (it == shard->map.end()) {
+    misses_++;
+    return nullptr;
+  }
+  hits_++;
+  return it->second->clone();
+}
+
+void CompressedResponseCache::put(const std::string& key,
+                                  const folly::IOBuf& compressed) {
+  auto length = compressed.computeChainDataLength();
+  auto shard = getShard(key).lock();
+  if (length > shard->maxBytes) {
+    return;
+  }
+  auto it = shard->map.findWithoutPromotion(key);
+  if (it != shard->map.end()) {
+    // Another request compressed the same body meanwhile
+    return;
+  }
+  // One contiguous copy, so that the cache holds no more than length
+  auto copy = folly::IOBuf::create(length);
+  for (auto range : compressed) {
+    memcpy(copy->writableTail(), range.data(), range.size());
+    copy->append(range.size());
+  }
+  while (shard->bytes + length > shard->maxBytes && !shard->map.empty()) {
+    auto oldest = std::prev(shard->map.end());
+    shard->bytes -= oldest->second->length();
+    shard->map.erase(oldest);
+    evictions_++;
+  }
+  shard->map.set(key, std::move(copy));
+  shard->bytes += length;
+  insertions_++;
+}
+
+CompressedResponseCache::Stats CompressedResponseCache::getStats() {
+  Stats stats{hits_.load(),
+              misses_.load(),
+              insertions_.load(),
+              evictions_.load(),
+              0,
+              0};
+  for (auto& shard : shards_) {
+    auto locked = shard->lock();
+    stats.bytes += locked->bytes;
+    stats.entries += locked->map.size();
+  }
+  return stats;
+}
+
+void CompressedResponseCache::clear() {
+  for (auto& shard : shards_) {
+    auto locked = shard->lock();
+    locked->map.clear();
+    locked->bytes = 0;
+  }
+}
+
+} // namespace proxygen
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/io/IOBuf.h>
+
+namespace proxygen {
+
+/**
+ * A bounded cache of compressed response bodies, so that CompressionFilter
+ * compresses a body served over and over once rather than per request.
+ *
+ * Keys are built by makeKey() from what identifies the uncompressed body,
+ * and the coding and level compressing it. Bodies are copied in once and
+ * served by clone, sharing the cached buffer. The cache is split in shards
+ * by key, each an LRU bounded to its share of maxBytes.
+ *
+ * All methods are thread safe.
+ */
+class CompressedResponseCache {
+ public:
+  struct Options {
+    // Total size of the cached compressed bodies
+    size_t maxBytes{64 * 1024 * 1024};
+    // Uncompressed bodies bigger than this are not cached
+    size_t maxBodyBytes{1024 * 1024};
+    size_t numShards{16};
+  };
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    size_t bytes;
+    size_t entries;
+  };
+
+  explicit CompressedResponseCache(Options options);
+
+  /**
+   * Key of a body identified by a strong validator of the resource, such as
+   * its ETag along with its URL.
+   */
+  static std::string makeKey(folly::StringPiece validator,
+                             folly::StringPiece encoding,
+                             int32_t level);
+
+  /**
+   * Key of a body identified by its SHA-256 digest, for responses without a
+   * validator.
+   */
+  static std::string makeDigestKey(const folly::IOBuf& body,
+                                   folly::StringPiece encoding,
+                                   int32_t level);
+
+  // Returns a clone of the cached body, or nullptr on a miss
+  std::unique_ptr<folly::IOBuf> get(const std::string& key);
+
+  // Copies compressed in, if it fits
+  void put(const std::string& key, const folly::IOBuf& compressed);
+
+  const Options& getOptions() const {
+    return options_;
+  }
+
+  Stats getStats();
+
+  void clear();
+
+ private:
+  struct Shard {
+    explicit Shard(size_t maxBytes);
+
+    folly::EvictingCacheMap<std::string, std::unique_ptr<folly::IOBuf>> map;
+    size_t maxBytes;
+    size_t bytes{0};
+  };
+
+  folly::Synchronized<Shard, std::mutex>& getShard(const std::string& key);
+
+  const Options options_;
+  std::vector<std::unique_ptr<folly::Synchronized<Shard, std::mutex>>>
+      shards_;
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> insertions_{0};
+  std::atomic<uint64_t> evictions_{0};
+};
+
+} // namespace proxygen
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/CompressionContextPool.h>
+
+#include <folly/compression/Compression.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+
+namespace proxygen {
+
+void CompressionContextPool::freeZstdCCtx(ZSTD_CCtx* cctx) {
+  ZSTD_freeCCtx(cctx);
+}
+
+void CompressionContextPool::freeZstdDCtx(ZSTD_DCtx* dctx) {
+  ZSTD_freeDCtx(dctx);
+}
+
+CompressionContextPool& CompressionContextPool::get() {
+  static thread_local CompressionContextPool pool;
+  return pool;
+}
+
+CompressionContextPool::~CompressionContextPool() {
+  for (auto& [key, streams] : zlibStreams_) {
+    for (auto& stream : streams) {
+      endZlibStream(std::get<0>(key), std::move(stream));
+    }
+  }
+}
+
+template <typename Ptr>
+Ptr CompressionContextPool::pop(std::vector<Ptr>& free) {
+  stats_.acquired++;
+  if (free.empty()) {
+    return nullptr;
+  }
+  auto context = std::move(free.back());
+  free.pop_back();
+  stats_.reused++;
+  return context;
+}
+
+template <typename Ptr>
+bool CompressionContextPool::push(std::vector<Ptr>& free, Ptr& context) {
+  if (free.size() >= maxFree_) {
+    return false;
+  }
+  free.push_back(std::move(context));
+  stats_.released++;
+  return true;
+}
+
+void CompressionContextPool::clearZlibBuffers(z_stream* stream) {
+  stream->next_in = Z_NULL;
+  stream->avail_in = 0;
+  stream->next_out = Z_NULL;
+  stream->avail_out = 0;
+}
+
+void CompressionContextPool::endZlibStream(bool deflate,
+                                           std::unique_ptr<z_stream> stream) {
+  if (deflate) {
+    deflateEnd(stream.get());
+  } else {
+    inflateEnd(stream.get());
+  }
+}
+
+std::unique_ptr<z_stream> CompressionContextPool::acquireDeflate(
+    CompressionType type, int level) {
+  if (auto stream = pop(zlibStreams_[ZlibKey(true, type, level)])) {
+    return stream;
+  }
+  auto stream = std::make_unique<z_stream>();
+  stream->zalloc = Z_NULL;
+  stream->zfree = Z_NULL;
+  stream->opaque = Z_NULL;
+  int status = Z_STREAM_ERROR;
+  switch (type) {
+    case CompressionType::GZIP:
+      status = deflateInit2(stream.get(),
+                            level,
+                            Z_DEFLATED,
+                            GZIP_WINDOW_BITS,
+                            MAX_MEM_LEVEL,
+                            Z_DEFAULT_STRATEGY);
+      break;
+    case CompressionType::DEFLATE:
+      status = deflateInit(stream.get(), level);
+      break;
+    default:
+      DCHECK(false) << "Unsupported zlib compression type.";
+      break;
+  }
+  if (status != Z_OK) {
+    LOG(ERROR) << "error initializing zlib stream. r=" << status;
+    return nullptr;
+  }
+  return stream;
+}
+
+void CompressionContextPool::releaseDeflate(std::unique_ptr<z_stream> stream,
+                                            CompressionType type,
+                                            int level) {
+  if (!stream) {
+    return;
+  }
+  clearZlibBuffers(stream.get());
+  if (deflateReset(stream.get()) != Z_OK ||
+      !push(zlibStreams_[ZlibKey(true, type, level)], stream)) {
+    endZlibStream(true, std::move(stream));
+  }
+}
+
+std::unique_ptr<z_stream> CompressionContextPool::acquireInflate(
+    CompressionType type) {
+  if (auto stream = pop(zlibStreams_[ZlibKey(false, type, 0)])) {
+    return stream;
+  }
+  DCHECK(type == CompressionType::DEFLATE || type == CompressionType::GZIP);
+  auto stream = std::make_unique<z_stream>();
+  stream->zalloc = Z_NULL;
+  stream->zfree = Z_NULL;
+  stream->opaque = Z_NULL;
+  auto windowBits =
+      type == CompressionType::GZIP ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
+  if (inflateInit2(stream.get(), windowBits) != Z_OK) {
+    return nullptr;
+  }
+  return stream;
+}
+
+void CompressionContextPool::releaseInflate(std::unique_ptr<z_stream> stream,
+                                            CompressionType type) {
+  if (!stream) {
+    return;
+  }
+  clearZlibBuffers(stream.get());
+  if (inflateReset(stream.get()) != Z_OK ||
+      !push(zlibStreams_[ZlibKey(false, type, 0)], stream)) {
+    endZlibStream(false, std::move(stream));
+  }
+}
+
+std::unique_ptr<z_stream> CompressionContextPool::acquireRawDeflate(
+    int level) {
+  if (auto stream =
+          pop(zlibStreams_[ZlibKey(true, CompressionType::NONE, level)])) {
+    return stream;
+  }
+  auto stream = std::make_unique<z_stream>();
+  stream->zalloc = Z_NULL;
+  stream->zfree = Z_NULL;
+  stream->opaque = Z_NULL;
+  // Negative window bits for no header or trailer
+  int status = deflateInit2(stream.get(),
+                            level,
+                            Z_DEFLATED,
+                            -DEFLATE_WINDOW_BITS,
+                            MAX_MEM_LEVEL,
+                            Z_DEFAULT_STRATEGY);
+  if (status != Z_OK) {
+    LOG(ERROR) << "error initializing zlib stream. r=" << status;
+    return nullptr;
+  }
+  return stream;
+}
+
+void CompressionContextPool::releaseRawDeflate(std::unique_ptr<z_stream> stream,
+                                               int level) {
+  releaseDeflate(std::move(stream), CompressionType::NONE, level);
+}
+
+std::unique_ptr<z_stream> CompressionContextPool::acquireRawInflate() {
+  if (auto stream =
+          pop(zlibStreams_[ZlibKey(false, CompressionType::NONE, 0)])) {
+    return stream;
+  }
+  auto stream = std::make_unique<z_stream>();
+  stream->zalloc = Z_NULL;
+  stream->zfree = Z_NULL;
+  stream->opaque = Z_NULL;
+  if (inflateInit2(stream.get(), -DEFLATE_WINDOW_BITS) != Z_OK) {
+    return nullptr;
+  }
+  return stream;
+}
+
+void CompressionContextPool::releaseRawInflate(
+    std::unique_ptr<z_stream> stream) {
+  releaseInflate(std::move(stream), CompressionType::NONE);
+}
+
+std::unique_ptr<folly::io::StreamCodec>
+CompressionContextPool::acquireZstdCodec(int level) {
+  if (auto codec = pop(zstdCodecs_[level])) {
+    return codec;
+  }
+  return folly::io::getStreamCodec(folly::io::CodecType::ZSTD, level);
+}
+
+void CompressionContextPool::releaseZstdCodec(
+    std::unique_ptr<folly::io::StreamCodec> codec, int level) {
+  if (!codec) {
+    return;
+  }
+  try {
+    codec->resetStream();
+  } catch (const std::exception&) {
+    return;
+  }
+  push(zstdCodecs_[level], codec);
+}
+
+CompressionContextPool::ZstdCCtxPtr CompressionContextPool::acquireZstdCCtx() {
+  if (auto cctx = pop(zstdCCtxs_)) {
+    return cctx;
+  }
+  return ZstdCCtxPtr(ZSTD_createCCtx());
+}
+
+void CompressionContextPool::releaseZstdCCtx(ZstdCCtxPtr cctx) {
+  // Also drops the parameters and dictionary
+  if (cctx && !ZSTD_isError(ZSTD_CCtx_reset(
+                  cctx.get(), ZSTD_reset_session_and_parameters))) {
+    push(zstdCCtxs_, cctx);
+  }
+}
+
+CompressionContextPool::ZstdDCtxPtr CompressionContextPool::acquireZstdDCtx() {
+  if (auto dctx = pop(zstdDCtxs_)) {
+    return dctx;
+  }
+  return ZstdDCtxPtr(ZSTD_createDCtx());
+}
+
+void CompressionContextPool::releaseZstdDCtx(ZstdDCtxPtr dctx) {
+  if (dctx && !ZSTD_isError(ZSTD_DCtx_reset(
+                  dctx.get(), ZSTD_reset_session_and_parameters))) {
+    push(zstdDCtxs_, dctx);
+  }
+}
+
+size_t CompressionContextPool::getFreeCount() const {
+  size_t count = zstdCCtxs_.size() + zstdDCtxs_.size();
+  for (const auto& entry : zlibStreams_) {
+    count += entry.second.size();
+  }
+  for (const auto& entry : zstdCodecs_) {
+    count += entry.second.size();
+  }
+  return count;
+}
+
+} // namespace proxygen
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#ifndef ZSTD_STATIC_LINKING_ONLY
+#define ZSTD_STATIC_LINKING_ONLY
+#endif
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include <zlib.h>
+#include <zstd.h>
+
+#include <folly/Memory.h>
+#include <proxygen/lib/utils/StreamDecompressor.h>
+
+namespace folly::io {
+class StreamCodec;
+} // namespace folly::io
+
+namespace proxygen {
+
+/**
+ * Per-thread free lists of compression and decompression contexts, so that
+ * the streams of every response don't allocate and initialize their own.
+ * A deflate state alone is about 256KB. Contexts are reset when released,
+ * and kept apart by the parameters they were initialized with.
+ *
+ * Not thread safe, use get() for the calling thread's pool. A context may
+ * be released to the pool of another thread than the one it was acquired
+ * from, but not after that thread exited.
+ */
+class CompressionContextPool {
+ public:
+  struct Stats {
+    // contexts handed out by the acquire methods
+    uint64_t acquired{0};
+    // contexts handed out from the free lists
+    uint64_t reused{0};
+    // contexts put back in the free lists
+    uint64_t released{0};
+  };
+
+  static void freeZstdCCtx(ZSTD_CCtx* cctx);
+  static void freeZstdDCtx(ZSTD_DCtx* dctx);
+
+  using ZstdCCtxPtr =
+      std::unique_ptr<ZSTD_CCtx,
+                      folly::static_function_deleter<ZSTD_CCtx, freeZstdCCtx>>;
+  using ZstdDCtxPtr =
+      std::unique_ptr<ZSTD_DCtx,
+                      folly::static_function_deleter<ZSTD_DCtx, freeZstdDCtx>>;
+
+  // Per kind of context and parameters
+  static constexpr size_t kDefaultMaxFree = 16;
+
+  explicit CompressionContextPool(size_t maxFree = kDefaultMaxFree)
+      : maxFree_(maxFree) {
+  }
+
+  ~CompressionContextPool();
+
+  CompressionContextPool(const CompressionContextPool&) = delete;
+  CompressionContextPool& operator=(const CompressionContextPool&) = delete;
+
+  /**
+   * The pool for the calling thread.
+   */
+  static CompressionContextPool& get();
+
+  /**
+   * A deflate or inflate stream for GZIP or DEFLATE, ready for a new
+   * stream, or nullptr if zlib fails to initialize one. Streams can't move
+   * once initialized, hence the pointers.
+   */
+  std::unique_ptr<z_stream> acquireDeflate(CompressionType type, int level);
+  void releaseDeflate(std::unique_ptr<z_stream> stream,
+                      CompressionType type,
+                      int level);
+  std::unique_ptr<z_stream> acquireInflate(CompressionType type);
+  void releaseInflate(std::unique_ptr<z_stream> stream, CompressionType type);
+
+  // Raw deflate streams, without zlib or gzip framing, as in WebSockets
+  std::unique_ptr<z_stream> acquireRawDeflate(int level);
+  void releaseRawDeflate(std::unique_ptr<z_stream> stream, int level);
+  std::unique_ptr<z_stream> acquireRawInflate();
+  void releaseRawInflate(std::unique_ptr<z_stream> stream);
+
+  // Zstd codecs of folly, as the ZstdStreamCompressor uses
+  std::unique_ptr<folly::io::StreamCodec> acquireZstdCodec(int level);
+  void releaseZstdCodec(std::unique_ptr<folly::io::StreamCodec> codec,
+                        int level);
+
+  // Zstd contexts, with default parameters and no dictionary
+  ZstdCCtxPtr acquireZstdCCtx();
+  void releaseZstdCCtx(ZstdCCtxPtr cctx);
+  ZstdDCtxPtr acquireZstdDCtx();
+  void releaseZstdDCtx(ZstdDCtxPtr dctx);
+
+  const Stats& getStats() const {
+    return stats_;
+  }
+
+  // Contexts in the free lists
+  size_t getFreeCount() const;
+
+ private:
+  // Kind, type and level.  The type of raw streams is NONE.
+  using ZlibKey = std::tuple<bool, CompressionType, int>;
+
+  // nullptr if the free list is empty
+  template <typename Ptr>
+  Ptr pop(std::vector<Ptr>& free);
+  // false, leaving context alone, if the free list is full
+  template <typename Ptr>
+  bool push(std::vector<Ptr>& free, Ptr& context);
+
+  // The caller's buffers, which the next user of the stream must not see
+  static void clearZlibBuffers(z_stream* stream);
+  static void endZlibStream(bool deflate, std::unique_ptr<z_stream> stream);
+
+  size_t maxFree_;
+  std::map<ZlibKey, std::vector<std::unique_ptr<z_stream>>> zlibStreams_;
+  std::map<int, std::vector<std::unique_ptr<folly::io::StreamCodec>>>
+      zstdCodecs_;
+  std::vector<ZstdCCtxPtr> zstdCCtxs_;
+  std::vector<ZstdDCtxPtr> zstdDCtxs_;
+  Stats stats_;
+};
+
+} // namespace proxygen
@@ -8,16 +8,28 @@
 
 #pragma once
 
+#include <array>
+#include <tuple>
+
 #include <proxygen/lib/http/HTTPMessage.h>
 #include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/utils/AdaptiveCompressionLevel.h>
+#include <proxygen/lib/utils/CompressedResponseCache.h>
 #include <proxygen/lib/utils/StreamCompressor.h>
 #include <proxygen/lib/utils/ZlibStreamCompressor.h>
 #include <proxygen/lib/utils/ZstdStreamCompressor.h>
+#ifdef PROXYGEN_HAVE_BROTLI
+#include <proxygen/lib/utils/BrotliStreamCompressor.h>
+#endif
 
 namespace proxygen {
 
 class CompressionFilterUtils {
  public:
+  // Compression Dictionary Transport request header
+  static constexpr folly::StringPiece kAvailableDictionary{
+      "Available-Dictionary"};
+
   struct FactoryOptions {
     FactoryOptions() = default;
     uint32_t minimumCompressionSize = 1000;
@@ -27,6 +39,20 @@ class CompressionFilterUtils {
     bool enableZstd = false;
     bool independentChunks = false;
     bool enableGzip = true;
+    // Takes the zlib and zstd contexts from the CompressionContextPool of
+    // the thread rather than allocating them for every response
+    bool poolCompressionContexts = false;
+    // Ignored unless proxygen is built with brotli
+    bool enableBrotli = false;
+    int32_t brotliQuality = 5;
+    int32_t brotliWindowBits = 22;
+    // Caches the compressed bodies of non chunked responses when set
+    std::shared_ptr<CompressedResponseCache> responseCache;
+    // With enableZstd, compresses as dcz the responses to the requests
+    // advertising one of these in Available-Dictionary
+    std::shared_ptr<const ZstdDictionaryStore> zstdDictionaries;
+    // Lowers the levels above, and may skip large responses, under load
+    std::shared_ptr<AdaptiveCompressionLevel> adaptiveLevel;
   };
 
   using StreamCompressorFactory =
@@ -37,31 +63,98 @@ class CompressionFilterUtils {
     StreamCompressorFactory compressorFactory;
     std::string headerEncoding;
     const std::set<std::string> compressibleContentTypes;
+    // Level of the compressor, part of the responseCache keys
+    int32_t compressionLevel{0};
+    std::shared_ptr<CompressedResponseCache> responseCache;
+    // Set for dcz
+    std::shared_ptr<const ZstdDictionary> dictionary;
+    std::shared_ptr<AdaptiveCompressionLevel> adaptiveLevel;
   };
 
   static folly::Optional<FilterParams> getFilterParams(
       const HTTPMessage& msg, const FactoryOptions& options) {
-    switch (
-        determineCompressionType(msg, options.enableZstd, options.enableGzip)) {
-      case CodecType::ZLIB:
+    if (auto dictionary = findDictionary(msg, options)) {
+      return FilterParams{options.minimumCompressionSize,
+                          [dictionary,
+                           independent = options.independentChunks,
+                           pooled = options.poolCompressionContexts]()
+                              -> std::unique_ptr<StreamCompressor> {
+                            return std::make_unique<ZstdStreamCompressor>(
+                                dictionary,
+                                independent,
+                                /*dczFraming=*/true,
+                                pooled);
+                          },
+                          "dcz",
+                          options.compressibleContentTypes,
+                          dictionary->getCompressionLevel(),
+                          options.responseCache,
+                          dictionary,
+                          options.adaptiveLevel};
+    }
+    const auto& adaptive = options.adaptiveLevel;
+    switch (determineCompressionType(msg, options)) {
+      case CodecType::ZLIB: {
+        auto level = adaptive
+                         ? adaptive->getZlibLevel(options.zlibCompressionLevel)
+                         : options.zlibCompressionLevel;
         return FilterParams{options.minimumCompressionSize,
-                            [level = options.zlibCompressionLevel]()
+                            [level,
+                             pooled = options.poolCompressionContexts]()
                                 -> std::unique_ptr<StreamCompressor> {
                               return std::make_unique<ZlibStreamCompressor>(
-                                  proxygen::CompressionType::GZIP, level);
+                                  proxygen::CompressionType::GZIP,
+                                  level,
+                                  pooled);
                             },
                             "gzip",
-                            options.compressibleContentTypes};
-      case CodecType::ZSTD:
+                            options.compressibleContentTypes,
+                            level,
+                            options.responseCache,
+                            nullptr,
+                            adaptive};
+      }
+      case CodecType::ZSTD: {
+        auto level = adaptive
+                         ? adaptive->getZstdLevel(options.zstdCompressionLevel)
+                         : options.zstdCompressionLevel;
         return FilterParams{options.minimumCompressionSize,
-                            [level = options.zstdCompressionLevel,
-                             independent = options.independentChunks]()
+                            [level,
+                             independent = options.independentChunks,
+                             pooled = options.poolCompressionContexts]()
                                 -> std::unique_ptr<StreamCompressor> {
                               return std::make_unique<ZstdStreamCompressor>(
-                                  level, independent);
+                                  level, independent, pooled);
                             },
                             "zstd",
-                            options.compressibleContentTypes};
+                            options.compressibleContentTypes,
+                            level,
+                            options.responseCache,
+                            nullptr,
+                            adaptive};
+      }
+      case CodecType::BROTLI: {
+#ifdef PROXYGEN_HAVE_BROTLI
+        auto quality = adaptive
+                           ? adaptive->getBrotliQuality(options.brotliQuality)
+                           : options.brotliQuality;
+        return FilterParams{options.minimumCompressionSize,
+                            [quality,
+                             windowBits = options.brotliWindowBits]()
+                                -> std::unique_ptr<StreamCompressor> {
+                              return std::make_unique<BrotliStreamCompressor>(
+                                  quality, windowBits);
+                            },
+                            "br",
+                            options.compressibleContentTypes,
+                            quality,
+                            options.responseCache,
+                            nullptr,
+                            adaptive};
+#else
+        return folly::none;
+#endif
+      }
       case CodecType::NO_COMPRESSION:
         return folly::none;
     }
@@ -79,7 +172,20 @@ class CompressionFilterUtils {
 
     // Make final determination of whether to compress
     return !alreadyCompressed && isCompressibleContentType(msg, params) &&
-           (msg.getIsChunked() || isMinimumCompressibleSize(msg, params));
+           (msg.getIsChunked() || (isMinimumCompressibleSize(msg, params) &&
+                                   !isSkippedUnderLoad(msg, params)));
+  }
+
+  // Large responses aren't worth their CPU when the adaptive level says so
+  static bool isSkippedUnderLoad(const HTTPMessage& msg,
+                                 const FilterParams& params) {
+    if (!params.adaptiveLevel) {
+      return false;
+    }
+    auto contentLength = folly::tryTo<uint64_t>(
+        msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_CONTENT_LENGTH));
+    return contentLength.hasValue() &&
+           params.adaptiveLevel->shouldSkip(*contentLength);
   }
 
   // Verify the response is large enough to compress
@@ -124,10 +230,46 @@ class CompressionFilterUtils {
     NO_COMPRESSION = 0,
     ZLIB = 1,
     ZSTD = 2,
+    BROTLI = 3,
   };
-  static CodecType determineCompressionType(const HTTPMessage& msg,
-                                            bool enableZstd,
-                                            bool enableGzip) noexcept {
+
+  /**
+   * The dictionary to compress with when the request accepts dcz with one
+   * we have, which the client would only advertise for the URLs it applies
+   * to, so dcz is then preferred to any other coding.
+   */
+  static std::shared_ptr<const ZstdDictionary> findDictionary(
+      const HTTPMessage& msg, const FactoryOptions& options) {
+    if (!options.enableZstd || !options.zstdDictionaries) {
+      return nullptr;
+    }
+    const auto& availableDictionary =
+        msg.getHeaders().getSingleOrEmpty(kAvailableDictionary);
+    if (availableDictionary.empty()) {
+      return nullptr;
+    }
+    RFC2616::TokenPairVec output;
+    if (!RFC2616::parseQvalues(
+            msg.getHeaders().getSingleOrEmpty(HTTP_HEADER_ACCEPT_ENCODING),
+            output)) {
+      return nullptr;
+    }
+    auto it = std::find_if(output.begin(), output.end(), [](const auto& elem) {
+      return elem.first.compare("dcz") == 0;
+    });
+    if (it == output.end() || it->second <= 0) {
+      return nullptr;
+    }
+    return options.zstdDictionaries->findByHeader(availableDictionary);
+  }
+
+  /**
+   * Picks the enabled coding with the highest qvalue in Accept-Encoding,
+   * where "*" stands for the codings not listed and q=0 rules a coding out.
+   * Ties go to the coding compressing best: br, then zstd, then gzip.
+   */
+  static CodecType determineCompressionType(
+      const HTTPMessage& msg, const FactoryOptions& options) noexcept {
 
     RFC2616::TokenPairVec output;
 
@@ -139,27 +281,41 @@ class CompressionFilterUtils {
       return CodecType::NO_COMPRESSION;
     }
 
-    auto it = std::find_if(
-        output.begin(),
-        output.end(),
-        [enableZstd, enableGzip](RFC2616::TokenQPair elem) {
-          return (enableGzip &&
-                  elem.first.compare(folly::StringPiece("gzip")) == 0) ||
-                 (enableZstd &&
-                  elem.first.compare(folly::StringPiece("zstd")) == 0);
-        });
-
-    if (it == output.end()) {
-      return CodecType::NO_COMPRESSION;
+    bool enableBrotli = false;
+#ifdef PROXYGEN_HAVE_BROTLI
+    enableBrotli = options.enableBrotli;
+#endif
+    // By order of preference
+    const std::array<std::tuple<folly::StringPiece, bool, CodecType>, 3>
+        codings = {{{"br", enableBrotli, CodecType::BROTLI},
+                    {"zstd", options.enableZstd, CodecType::ZSTD},
+                    {"gzip", options.enableGzip, CodecType::ZLIB}}};
+
+    folly::Optional<double> wildcardQvalue;
+    for (const auto& elem : output) {
+      if (elem.first == "*") {
+        wildcardQvalue = elem.second;
+      }
     }
-    if (it->first == "zstd") {
-      return CodecType::ZSTD;
-    } else if (it->first == "gzip") {
-      return CodecType::ZLIB;
-    } else {
-      DCHECK(false) << "found unexpected content-coding selection";
-      return CodecType::NO_COMPRESSION;
+
+    auto result = CodecType::NO_COMPRESSION;
+    double bestQvalue = 0;
+    for (const auto& [name, enabled, type] : codings) {
+      if (!enabled) {
+        continue;
+      }
+      auto it = std::find_if(
+          output.begin(), output.end(), [&name = name](const auto& elem) {
+            return elem.first.compare(name) == 0;
+          });
+      auto qvalue =
+          it != output.end() ? it->second : wildcardQvalue.value_or(0);
+      if (qvalue > bestQvalue) {
+        bestQvalue = qvalue;
+        result = type;
+      }
     }
+    return result;
   }
 };
 } // namespace proxygen
@@ -10,9 +10,9 @@
 
 #include <bitset>
 #include <folly/Function.h>
+#include <folly/small_vector.h>
 #include <glog/logging.h>
 #include <ostream>
-#include <vector>
 
 namespace proxygen {
 
@@ -31,8 +31,9 @@ namespace proxygen {
  * thingsDone.set(Things::Thing1);
  * thingsDone.set(Things::Thing2);
  *
+ * Up to M pending functions are stored inline, without allocating.
  */
-template <typename E, size_t N>
+template <typename E, size_t N, size_t M = 1>
 class ConditionalGate {
   static_assert(std::is_enum<E>(), "ConditionalGate type must be enum");
   static_assert(N > 0, "N must be greater than 0");
@@ -89,12 +90,12 @@ class ConditionalGate {
   }
 
   std::bitset<N> conditions_;
-  std::vector<folly::Function<void()>> functions_;
+  folly::small_vector<folly::Function<void()>, M> functions_;
 };
 
-template <typename E, size_t N>
+template <typename E, size_t N, size_t M>
 inline std::ostream& operator<<(std::ostream& os,
-                                const ConditionalGate<E, N>& g) {
+                                const ConditionalGate<E, N, M>& g) {
   g.describe(os);
   return os;
 }
@@ -8,51 +8,50 @@
 
 #include <proxygen/lib/utils/CryptUtil.h>
 
+#include <folly/base64.h>
 #include <folly/portability/OpenSSL.h>
-#include <iomanip>
-#include <openssl/buffer.h>
 #include <openssl/md5.h>
-#include <sstream>
+
+// folly's base64 picks a vectorized implementation for the CPU and writes
+// straight to the caller's buffer.
 
 namespace proxygen {
 
-// Base64 encode using openssl
 std::string base64Encode(folly::ByteRange text) {
-  std::string result;
-  BIO *b64 = BIO_new(BIO_f_base64());
-  if (b64 == nullptr) {
-    return result;
-  }
-  BIO *bmem = BIO_new(BIO_s_mem());
-  if (bmem == nullptr) {
-    BIO_free_all(b64);
-    return result;
-  }
-  BUF_MEM *bptr;
+  std::string result(base64EncodedSize(text.size()), '\0');
+  base64Encode(text, &result[0]);
+  return result;
+}
 
-  // chain base64 filter with the memory buffer
-  // so that text will be encoded by base64 and flushed to buffer
-  BIO *chain = BIO_push(b64, bmem);
-  if (chain == nullptr) {
-    BIO_free_all(b64);
-    return result;
-  }
-  BIO_set_flags(chain, BIO_FLAGS_BASE64_NO_NL);
-  BIO_write(chain, text.begin(), text.size());
-  if (BIO_flush(chain) != 1) {
-    BIO_free_all(chain);
-    return result;
-  }
+size_t base64EncodedSize(size_t size) {
+  return folly::base64EncodedSize(size);
+}
 
-  BIO_get_mem_ptr(chain, &bptr);
+char* base64Encode(folly::ByteRange text, char* out) {
+  auto begin = reinterpret_cast<const char*>(text.begin());
+  return folly::base64Encode(begin, begin + text.size(), out);
+}
+
+size_t base64DecodedSize(folly::StringPiece text) {
+  return folly::base64DecodedSize(text.begin(), text.end());
+}
 
-  if (bptr && bptr->length > 0) {
-    result = std::string((char *)bptr->data, bptr->length);
+folly::Optional<size_t> base64Decode(folly::StringPiece text, uint8_t* out) {
+  auto begin = reinterpret_cast<char*>(out);
+  auto result = folly::base64Decode(text.begin(), text.end(), begin);
+  if (!result.isSuccess) {
+    return folly::none;
   }
+  return result.o - begin;
+}
 
-  // free the whole BIO chain (b64 and mem)
-  BIO_free_all(chain);
-  return result;
+char* hexEncode(folly::ByteRange bytes, char* out) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  for (auto byte : bytes) {
+    *out++ = kHex[byte >> 4];
+    *out++ = kHex[byte & 0xf];
+  }
+  return out;
 }
 
 // MD5 encode using openssl
@@ -62,13 +61,9 @@ std::string md5Encode(folly::ByteRange text) {
   unsigned char digest[MD5_DIGEST_LENGTH];
   MD5(text.begin(), text.size(), digest);
 
-  // convert digest to hex string
-  std::ostringstream ss;
-  ss << std::hex << std::setfill('0');
-  for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
-    ss << std::setw(2) << (unsigned int)digest[i];
-  }
-  return ss.str();
+  std::string result(2 * MD5_DIGEST_LENGTH, '\0');
+  hexEncode(folly::ByteRange(digest, MD5_DIGEST_LENGTH), &result[0]);
+  return result;
 }
 
 } // namespace proxygen
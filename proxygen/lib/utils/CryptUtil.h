@@ -8,14 +8,40 @@
 
 #pragma once
 
+#include <folly/Optional.h>
 #include <folly/Range.h>
 #include <string>
 
 namespace proxygen {
 
-// Base64 encode using openssl, may return empty string on allocation failure
+// Base64 encode, with padding and no newlines
 std::string base64Encode(folly::ByteRange text);
 
+// Length of the padded base64 encoding of size bytes
+size_t base64EncodedSize(size_t size);
+
+/**
+ * Base64 encodes text to out, which must hold base64EncodedSize(text.size())
+ * bytes, without allocating.  Returns the end of the encoding.
+ */
+char* base64Encode(folly::ByteRange text, char* out);
+
+// Upper bound of the bytes the base64 text decodes to
+size_t base64DecodedSize(folly::StringPiece text);
+
+/**
+ * Decodes the padded base64 text to out, which must hold
+ * base64DecodedSize(text) bytes, without allocating.  Returns the decoded
+ * length, or none if text isn't valid base64.
+ */
+folly::Optional<size_t> base64Decode(folly::StringPiece text, uint8_t* out);
+
+/**
+ * Writes the lower case hex of bytes to out, which must hold
+ * 2 * bytes.size() chars.  Returns the end of the hex.
+ */
+char* hexEncode(folly::ByteRange bytes, char* out);
+
 // MD5 encode using openssl
 std::string md5Encode(folly::ByteRange text);
 } // namespace proxygen
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/FileBodySource.h>
+
+#include <folly/Exception.h>
+#include <glog/logging.h>
+
+namespace proxygen {
+
+FileBodySource::FileBodySource(folly::File file,
+                               uint64_t offset,
+                               uint64_t length,
+                               size_t chunkSize)
+    : chunkSize_(chunkSize) {
+  CHECK_GT(chunkSize_, 0);
+  if (length == 0) {
+    // mmap(2) rejects empty mappings
+    return;
+  }
+  mapping_ = std::make_shared<folly::MemoryMapping>(
+      std::move(file), offset, length);
+  mapping_->hintLinearScan();
+  data_ = mapping_->range();
+  if (data_.size() != length) {
+    folly::throwSystemErrorExplicit(EINVAL, "Region extends past end of file");
+  }
+}
+
+std::unique_ptr<folly::IOBuf> FileBodySource::next() {
+  if (data_.empty()) {
+    return nullptr;
+  }
+  auto len = std::min<uint64_t>(data_.size(), chunkSize_);
+  auto chunk = folly::IOBuf::takeOwnership(
+      const_cast<uint8_t*>(data_.data()),
+      len,
+      [](void* /*buf*/, void* userData) {
+        delete static_cast<std::shared_ptr<folly::MemoryMapping>*>(userData);
+      },
+      new std::shared_ptr<folly::MemoryMapping>(mapping_));
+  chunk->markExternallySharedOne();
+  data_.advance(len);
+  return chunk;
+}
+
+} // namespace proxygen
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/io/IOBuf.h>
+#include <folly/system/MemoryMapping.h>
+#include <memory>
+
+namespace proxygen {
+
+/**
+ * Produces a region of a file as a sequence of body IOBufs without copying
+ * or blocking reads.  The region is memory mapped and each chunk wraps the
+ * mapping directly; the chunks keep the mapping alive, so they may outlive
+ * the FileBodySource.  Chunks are marked shared so that nothing downstream
+ * (eg: in-place TLS encryption) writes into the page cache.
+ *
+ * The mapping is advised for sequential access so the kernel reads ahead of
+ * next(), which keeps page faults off the EventBase for warm and sequentially
+ * read files.
+ */
+class FileBodySource {
+ public:
+  static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+  /**
+   * Serve length bytes of file starting at offset.  Throws std::system_error
+   * if the region cannot be mapped or extends past the end of the file.
+   */
+  FileBodySource(folly::File file,
+                 uint64_t offset,
+                 uint64_t length,
+                 size_t chunkSize = kDefaultChunkSize);
+
+  // Bytes not yet returned by next()
+  uint64_t remaining() const {
+    return data_.size();
+  }
+
+  // Returns up to chunkSize bytes, or nullptr once the region is exhausted
+  std::unique_ptr<folly::IOBuf> next();
+
+ private:
+  std::shared_ptr<folly::MemoryMapping> mapping_;
+  folly::ByteRange data_;
+  size_t chunkSize_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/FlatTraceEvent.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include <folly/Conv.h>
+#include <folly/json.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/TraceEvent.h>
+
+namespace proxygen {
+
+folly::StringPiece TraceArena::copy(folly::StringPiece value) {
+  if (value.empty()) {
+    return folly::StringPiece();
+  }
+  auto data = static_cast<char*>(allocate(value.size(), 1));
+  memcpy(data, value.data(), value.size());
+  return folly::StringPiece(data, value.size());
+}
+
+void TraceArena::clear() {
+  if (blocks_.empty()) {
+    return;
+  }
+  // Later blocks may be oversized for a single allocation, only keep the
+  // first
+  blocks_.resize(1);
+  next_ = blocks_[0].get();
+  end_ = next_ + blockSize_;
+}
+
+void* TraceArena::allocate(size_t size, size_t align) {
+  auto space = static_cast<size_t>(end_ - next_);
+  void* ptr = next_;
+  if (!next_ || !std::align(align, size, ptr, space)) {
+    // Every block starts aligned for any type
+    auto blockSize = std::max(blockSize_, size);
+    blocks_.emplace_back(new char[blockSize]);
+    ptr = blocks_.back().get();
+    end_ = blocks_.back().get() + blockSize;
+  }
+  next_ = static_cast<char*>(ptr) + size;
+  return ptr;
+}
+
+std::string FlatTraceEvent::Field::toString() const {
+  switch (kind) {
+    case Kind::INT:
+      return folly::to<std::string>(intValue);
+    case Kind::STRING:
+      return getString().str();
+    case Kind::STRING_LIST: {
+      folly::dynamic data = folly::dynamic::array;
+      for (auto item : getStringList()) {
+        data.push_back(item);
+      }
+      return folly::toJson(data);
+    }
+  }
+  return std::string();
+}
+
+FlatTraceEvent::FlatTraceEvent(TraceEventType type,
+                               TraceArena& arena,
+                               uint32_t parentID)
+    : arena_(&arena),
+      type_(type),
+      id_(TraceEvent::nextID()),
+      parentID_(parentID) {
+}
+
+const FlatTraceEvent::Field* FlatTraceEvent::getField(
+    TraceFieldType field) const {
+  if (!hasTraceField(field)) {
+    return nullptr;
+  }
+  for (const auto& f : *this) {
+    if (f.key == field) {
+      return &f;
+    }
+  }
+  return nullptr;
+}
+
+FlatTraceEvent::Field* FlatTraceEvent::insert(TraceFieldType key,
+                                              Field::Kind kind,
+                                              bool& added) {
+  Field* field = const_cast<Field*>(getField(key));
+  added = !field;
+  if (!field) {
+    if (numFields_ == kMaxFields) {
+      VLOG(4) << "Dropping trace field " << key << " of " << type_;
+      added = false;
+      return nullptr;
+    }
+    field = &fields_[numFields_++];
+    field->key = key;
+    present_.set(static_cast<size_t>(key));
+  }
+  field->kind = kind;
+  field->size = 0;
+  return field;
+}
+
+bool FlatTraceEvent::addMeta(TraceFieldType key, folly::StringPiece value) {
+  bool added;
+  auto field = insert(key, Field::Kind::STRING, added);
+  if (field) {
+    auto copy = arena_->copy(value);
+    field->stringValue = copy.data();
+    field->size = copy.size();
+  }
+  return added;
+}
+
+bool FlatTraceEvent::addMeta(TraceFieldType key,
+                             const std::vector<std::string>& value) {
+  bool added;
+  auto field = insert(key, Field::Kind::STRING_LIST, added);
+  if (field) {
+    auto list = arena_->allocateArray<folly::StringPiece>(value.size());
+    for (size_t i = 0; i < value.size(); i++) {
+      new (&list[i]) folly::StringPiece(arena_->copy(value[i]));
+    }
+    field->listValue = list;
+    field->size = value.size();
+  }
+  return added;
+}
+
+bool FlatTraceEvent::readStrMeta(TraceFieldType key,
+                                 folly::StringPiece& dest) const {
+  auto field = getField(key);
+  if (!field || field->kind != Field::Kind::STRING) {
+    return false;
+  }
+  dest = field->getString();
+  return true;
+}
+
+TraceEvent FlatTraceEvent::toTraceEvent() const {
+  TraceEvent event(type_, parentID_);
+  event.id_ = id_;
+  event.stateFlags_ = stateFlags_;
+  event.start_ = start_;
+  event.end_ = end_;
+  for (const auto& field : *this) {
+    switch (field.kind) {
+      case Field::Kind::INT:
+        event.addMeta(field.key, field.intValue);
+        break;
+      case Field::Kind::STRING:
+        event.addMeta(field.key, field.getString().str());
+        break;
+      case Field::Kind::STRING_LIST: {
+        std::vector<std::string> list;
+        for (auto item : field.getStringList()) {
+          list.push_back(item.str());
+        }
+        event.addMeta(field.key, std::move(list));
+        break;
+      }
+    }
+  }
+  return event;
+}
+
+} // namespace proxygen
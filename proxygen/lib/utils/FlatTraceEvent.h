@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <folly/Range.h>
+#include <proxygen/lib/utils/Time.h>
+#include <proxygen/lib/utils/TraceEventType.h>
+#include <proxygen/lib/utils/TraceFieldType.h>
+
+namespace proxygen {
+
+class TraceEvent;
+
+/**
+ * Bump allocator holding the string payloads of FlatTraceEvents. Memory is
+ * only given back by clear(), which keeps the first block for reuse, so a
+ * context tracing the same events over and over stops allocating.
+ */
+class TraceArena {
+ public:
+  explicit TraceArena(size_t blockSize = 4096) : blockSize_(blockSize) {
+  }
+
+  TraceArena(const TraceArena&) = delete;
+  TraceArena& operator=(const TraceArena&) = delete;
+
+  // A copy of value, valid until clear()
+  folly::StringPiece copy(folly::StringPiece value);
+
+  // Uninitialized room for n trivially destructible T
+  template <typename T>
+  T* allocateArray(size_t n) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "The arena never runs destructors");
+    return static_cast<T*>(allocate(sizeof(T) * n, alignof(T)));
+  }
+
+  // Invalidates everything allocated so far
+  void clear();
+
+ private:
+  void* allocate(size_t size, size_t align);
+
+  size_t blockSize_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  // Free room in the last block
+  char* next_{nullptr};
+  char* end_{nullptr};
+};
+
+/**
+ * A TraceEvent laid out flat, to trace without allocating: fields live in
+ * a fixed number of inline slots, looked up through a bitset indexed by
+ * TraceFieldType, and strings are copied into a TraceArena. The event
+ * must not outlive the arena, nor be used once it is cleared: observers
+ * that keep events should copy them, e.g. with toTraceEvent().
+ */
+class FlatTraceEvent {
+ public:
+  // Fields beyond this many are dropped
+  static constexpr size_t kMaxFields = 24;
+
+  struct Field {
+    enum class Kind : uint8_t { INT, STRING, STRING_LIST };
+
+    TraceFieldType key;
+    Kind kind;
+    // The length of the string, or of the string list
+    uint32_t size;
+    union {
+      int64_t intValue;
+      const char* stringValue;
+      const folly::StringPiece* listValue;
+    };
+
+    folly::StringPiece getString() const {
+      return folly::StringPiece(stringValue, size);
+    }
+
+    folly::Range<const folly::StringPiece*> getStringList() const {
+      return folly::Range<const folly::StringPiece*>(listValue, size);
+    }
+
+    // As TraceEvent::MetaData::getValueAs<std::string>
+    std::string toString() const;
+  };
+
+  FlatTraceEvent(TraceEventType type, TraceArena& arena, uint32_t parentID = 0);
+
+  void start(TimePoint startTime) {
+    stateFlags_ |= State::STARTED;
+    start_ = startTime;
+  }
+
+  void end(TimePoint endTime) {
+    stateFlags_ |= State::ENDED;
+    end_ = endTime;
+  }
+
+  bool hasStarted() const {
+    return stateFlags_ & State::STARTED;
+  }
+
+  bool hasEnded() const {
+    return stateFlags_ & State::ENDED;
+  }
+
+  TimePoint getStartTime() const {
+    return start_;
+  }
+
+  TimePoint getEndTime() const {
+    return end_;
+  }
+
+  TraceEventType getType() const {
+    return type_;
+  }
+
+  uint32_t getID() const {
+    return id_;
+  }
+
+  void setParentID(uint32_t parent) {
+    parentID_ = parent;
+  }
+
+  uint32_t getParentID() const {
+    return parentID_;
+  }
+
+  bool hasTraceField(TraceFieldType field) const {
+    return present_.test(static_cast<size_t>(field));
+  }
+
+  // The field, or nullptr if not set
+  const Field* getField(TraceFieldType field) const;
+
+  /**
+   * As TraceEvent::addMeta: true if the field is new, false if it replaced
+   * the value already set or was dropped for lack of slots.
+   */
+  template <typename T,
+            typename = typename std::enable_if<std::is_integral<T>::value,
+                                               void>::type>
+  bool addMeta(TraceFieldType key, T value) {
+    bool added;
+    auto field = insert(key, Field::Kind::INT, added);
+    if (field) {
+      field->intValue = static_cast<int64_t>(value);
+    }
+    return added;
+  }
+
+  bool addMeta(TraceFieldType key, folly::StringPiece value);
+
+  bool addMeta(TraceFieldType key, const char* value) {
+    return addMeta(key, folly::StringPiece(value));
+  }
+
+  bool addMeta(TraceFieldType key, const std::vector<std::string>& value);
+
+  template <typename T>
+  bool readIntMeta(TraceFieldType key, T& dest) const {
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                  "readIntMeta should take an intergral type of paremeter");
+    auto field = getField(key);
+    if (!field || field->kind != Field::Kind::INT) {
+      return false;
+    }
+    dest = static_cast<T>(field->intValue);
+    return true;
+  }
+
+  // A view into the arena
+  bool readStrMeta(TraceFieldType key, folly::StringPiece& dest) const;
+
+  const Field* begin() const {
+    return fields_.data();
+  }
+
+  const Field* end() const {
+    return fields_.data() + numFields_;
+  }
+
+  size_t size() const {
+    return numFields_;
+  }
+
+  // A copy owning its fields, for the observers taking TraceEvents
+  TraceEvent toTraceEvent() const;
+
+ private:
+  Field* insert(TraceFieldType key, Field::Kind kind, bool& added);
+
+  enum State {
+    NOT_STARTED = 0,
+    STARTED = 1,
+    ENDED = 2,
+  };
+
+  TraceArena* arena_;
+  uint8_t stateFlags_{0};
+  uint8_t numFields_{0};
+  TraceEventType type_;
+  uint32_t id_;
+  uint32_t parentID_;
+  TimePoint start_;
+  TimePoint end_;
+  std::bitset<kNumTraceFieldTypes> present_;
+  std::array<Field, kMaxFields> fields_;
+};
+
+} // namespace proxygen
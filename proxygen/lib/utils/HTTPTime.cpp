@@ -8,29 +8,257 @@
 
 #include <proxygen/lib/utils/HTTPTime.h>
 
-#include <folly/portability/Time.h>
+#include <chrono>
+#include <cstring>
 
-namespace proxygen {
+#include <folly/SingletonThreadLocal.h>
+#include <glog/logging.h>
 
-folly::Optional<int64_t> parseHTTPDateTime(const std::string& s) {
-  struct tm tm = {};
+namespace {
 
-  if (s.empty()) {
-    return folly::none;
+constexpr int64_t kSecondsPerDay = 24 * 60 * 60;
+
+const char* const kDays[] = {
+    "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday",
+    "Saturday"};
+
+const char* const kMonths[] = {"January",
+                               "February",
+                               "March",
+                               "April",
+                               "May",
+                               "June",
+                               "July",
+                               "August",
+                               "September",
+                               "October",
+                               "November",
+                               "December"};
+
+// Days since 1970-01-01 of a proleptic Gregorian date, month in [1, 12]
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+  year -= month <= 2;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(year - era * 400);
+  const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+void civilFromDays(int64_t days,
+                   int64_t& year,
+                   unsigned& month,
+                   unsigned& day) {
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const unsigned doe = static_cast<unsigned>(days - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  day = doy - (153 * mp + 2) / 5 + 1;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2);
+}
+
+bool lowerEqual(char a, char b) {
+  return (a | 0x20) == (b | 0x20);
+}
+
+// Matches the full or 3 letter name, case insensitively, returns its index
+bool parseName(folly::StringPiece& s,
+               const char* const* names,
+               size_t numNames,
+               unsigned& result) {
+  if (s.size() < 3) {
+    return false;
+  }
+  for (size_t i = 0; i < numNames; i++) {
+    folly::StringPiece name(names[i]);
+    if (!lowerEqual(s[0], name[0]) || !lowerEqual(s[1], name[1]) ||
+        !lowerEqual(s[2], name[2])) {
+      continue;
+    }
+    size_t len = 3;
+    if (s.size() >= name.size()) {
+      len = name.size();
+      for (size_t j = 3; j < name.size(); j++) {
+        if (!lowerEqual(s[j], name[j])) {
+          len = 3;
+          break;
+        }
+      }
+    }
+    s.advance(len);
+    result = i;
+    return true;
   }
+  return false;
+}
 
+// Up to maxDigits digits, at least minDigits
+bool parseNumber(folly::StringPiece& s,
+                 size_t minDigits,
+                 size_t maxDigits,
+                 unsigned& result) {
+  size_t digits = 0;
+  result = 0;
+  while (digits < maxDigits && digits < s.size() && s[digits] >= '0' &&
+         s[digits] <= '9') {
+    result = result * 10 + (s[digits] - '0');
+    digits++;
+  }
+  if (digits < minDigits) {
+    return false;
+  }
+  s.advance(digits);
+  return true;
+}
+
+bool skipChar(folly::StringPiece& s, char c) {
+  if (s.empty() || s.front() != c) {
+    return false;
+  }
+  s.advance(1);
+  return true;
+}
+
+// At least one space
+bool skipSpaces(folly::StringPiece& s) {
+  if (!skipChar(s, ' ')) {
+    return false;
+  }
+  while (skipChar(s, ' ')) {
+  }
+  return true;
+}
+
+bool parseTimeOfDay(folly::StringPiece& s,
+                    unsigned& hour,
+                    unsigned& minute,
+                    unsigned& second) {
+  // Leap seconds are let through, as by strptime()
+  return parseNumber(s, 1, 2, hour) && hour < 24 && skipChar(s, ':') &&
+         parseNumber(s, 1, 2, minute) && minute < 60 && skipChar(s, ':') &&
+         parseNumber(s, 1, 2, second) && second <= 60;
+}
+
+bool skipGMT(folly::StringPiece& s) {
+  return skipSpaces(s) && s.size() >= 3 && s.subpiece(0, 3) == "GMT";
+}
+
+void writeDigits(char* out, unsigned value, size_t digits) {
+  for (size_t i = digits; i > 0; i--) {
+    out[i - 1] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+}
+
+struct CurrentHTTPDateTime {
+  int64_t lastTime{-1};
+  std::string date;
+
+  const std::string& get() {
+    const int64_t now =
+        std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    if (now != lastTime) {
+      date.resize(proxygen::kHTTPDateTimeLength);
+      proxygen::formatHTTPDateTime(now, &date[0]);
+      lastTime = now;
+    }
+    return date;
+  }
+};
+
+} // namespace
+
+namespace proxygen {
+
+folly::Optional<int64_t> parseHTTPDateTime(folly::StringPiece s) {
   // Sun, 06 Nov 1994 08:49:37 GMT  ; RFC 822, updated by RFC 1123
   // Sunday, 06-Nov-94 08:49:37 GMT ; RFC 850, obsoleted by RFC 1036
   // Sun Nov 6 08:49:37 1994        ; ANSI C's asctime() format
   //    Assume GMT as per rfc2616 (see HTTP-date):
   //       - https://www.w3.org/Protocols/rfc2616/rfc2616-sec3.html
-  if (strptime(s.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm) != nullptr ||
-      strptime(s.c_str(), "%a, %d-%b-%y %H:%M:%S GMT", &tm) != nullptr ||
-      strptime(s.c_str(), "%a %b %d %H:%M:%S %Y", &tm) != nullptr) {
-    return folly::Optional<int64_t>(timegm(&tm));
+  unsigned weekday, day, month, year, hour, minute, second;
+  if (!parseName(s, kDays, 7, weekday)) {
+    return folly::none;
+  }
+  if (skipChar(s, ',')) {
+    if (!skipSpaces(s) || !parseNumber(s, 1, 2, day)) {
+      return folly::none;
+    }
+    if (skipChar(s, '-')) {
+      // RFC 850, two digit years as by strptime()
+      if (!parseName(s, kMonths, 12, month) || !skipChar(s, '-') ||
+          !parseNumber(s, 2, 2, year)) {
+        return folly::none;
+      }
+      year += year < 69 ? 2000 : 1900;
+    } else if (!skipSpaces(s) || !parseName(s, kMonths, 12, month) ||
+               !skipSpaces(s) || !parseNumber(s, 4, 4, year)) {
+      return folly::none;
+    }
+    if (!skipSpaces(s) || !parseTimeOfDay(s, hour, minute, second) ||
+        !skipGMT(s)) {
+      return folly::none;
+    }
+  } else if (!skipSpaces(s) || !parseName(s, kMonths, 12, month) ||
+             !skipSpaces(s) || !parseNumber(s, 1, 2, day) ||
+             !skipSpaces(s) || !parseTimeOfDay(s, hour, minute, second) ||
+             !skipSpaces(s) || !parseNumber(s, 4, 4, year)) {
+    return folly::none;
+  }
+  if (day < 1 || day > 31) {
+    return folly::none;
+  }
+  // As by timegm(), days past the end of the month roll over into the next
+  return daysFromCivil(year, month + 1, 1) * kSecondsPerDay +
+         (day - 1) * kSecondsPerDay + hour * 3600 + minute * 60 + second;
+}
+
+void formatHTTPDateTime(int64_t t, char* out) {
+  int64_t days = t / kSecondsPerDay;
+  int64_t secs = t % kSecondsPerDay;
+  if (secs < 0) {
+    secs += kSecondsPerDay;
+    days--;
   }
+  int64_t year;
+  unsigned month, day;
+  civilFromDays(days, year, month, day);
+  DCHECK(year >= 0 && year <= 9999) << "year=" << year;
+  // 1970-01-01 was a Thursday
+  auto weekday = static_cast<unsigned>(((days % 7) + 11) % 7);
+
+  // Sun, 06 Nov 1994 08:49:37 GMT
+  memcpy(out, kDays[weekday], 3);
+  out[3] = ',';
+  out[4] = ' ';
+  writeDigits(out + 5, day, 2);
+  out[7] = ' ';
+  memcpy(out + 8, kMonths[month - 1], 3);
+  out[11] = ' ';
+  writeDigits(out + 12, static_cast<unsigned>(year), 4);
+  out[16] = ' ';
+  writeDigits(out + 17, secs / 3600, 2);
+  out[19] = ':';
+  writeDigits(out + 20, secs / 60 % 60, 2);
+  out[22] = ':';
+  writeDigits(out + 23, secs % 60, 2);
+  memcpy(out + 25, " GMT", 4);
+}
+
+std::string formatHTTPDateTime(int64_t t) {
+  std::string result(kHTTPDateTimeLength, '\0');
+  formatHTTPDateTime(t, &result[0]);
+  return result;
+}
 
-  return folly::none;
+const std::string& getCurrentHTTPDateTime() {
+  struct DateTag {};
+  return folly::SingletonThreadLocal<CurrentHTTPDateTime, DateTag>::get().get();
 }
 
 } // namespace proxygen
@@ -9,11 +9,35 @@
 #pragma once
 
 #include <folly/Optional.h>
+#include <folly/Range.h>
 #include <stddef.h>
 #include <string>
 
 namespace proxygen {
 
-folly::Optional<int64_t> parseHTTPDateTime(const std::string& s);
+// Length of an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+constexpr size_t kHTTPDateTimeLength = 29;
+
+/**
+ * Parses the three HTTP-date formats of RFC 7231 section 7.1.1.1 into a
+ * Unix time, without strptime() and its locale. The weekday is not checked
+ * against the date, and anything after the date is ignored.
+ */
+folly::Optional<int64_t> parseHTTPDateTime(folly::StringPiece s);
+
+/**
+ * Writes the IMF-fixdate of the Unix time t, which must be within years 0
+ * to 9999, to out. out must have room for kHTTPDateTimeLength chars, no
+ * terminating null is written.
+ */
+void formatHTTPDateTime(int64_t t, char* out);
+
+std::string formatHTTPDateTime(int64_t t);
+
+/**
+ * The IMF-fixdate of the current second, as sent in Date headers. It is
+ * cached per thread, and only formatted again once the second changes.
+ */
+const std::string& getCurrentHTTPDateTime();
 
 } // namespace proxygen
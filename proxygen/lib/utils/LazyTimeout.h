@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include <proxygen/lib/utils/Time.h>
+
+namespace proxygen {
+
+/**
+ * Deadline bookkeeping for idle timeouts pushed back on every bit of
+ * activity. Rescheduling a wheel timer callback unlinks and relinks it each
+ * time; instead, while the callback is scheduled, refresh() only records the
+ * new deadline. When the callback fires, remaining() tells whether the
+ * deadline passed, or how long to schedule it again for.
+ *
+ *   void refreshTimeout() {
+ *     if (lazy_.refresh(isScheduled(), timeout)) {
+ *       timer->scheduleTimeout(this, timeout);
+ *     }
+ *   }
+ *
+ *   void timeoutExpired() noexcept override {
+ *     auto left = lazy_.remaining();
+ *     if (left.count() > 0) {
+ *       timer->scheduleTimeout(this, left);
+ *       return;
+ *     }
+ *     ...
+ *   }
+ */
+class LazyTimeout {
+ public:
+  /**
+   * Pushes the deadline to timeout from now. Returns whether the callback
+   * must be scheduled for timeout: it is not scheduled, or would fire after
+   * the new deadline.
+   */
+  bool refresh(bool isScheduled,
+               std::chrono::milliseconds timeout,
+               TimePoint now = getCurrentTime()) {
+    deadline_ = now + timeout;
+    if (isScheduled && deadline_ >= scheduledDeadline_) {
+      return false;
+    }
+    scheduledDeadline_ = deadline_;
+    return true;
+  }
+
+  /**
+   * Once the callback fired, the time left until the deadline, zero if it
+   * passed. The callback must be scheduled again for a non zero result.
+   */
+  std::chrono::milliseconds remaining(TimePoint now = getCurrentTime()) {
+    if (deadline_ <= now) {
+      return std::chrono::milliseconds::zero();
+    }
+    scheduledDeadline_ = deadline_;
+    // Rounded up, so the callback never fires before the deadline
+    return std::chrono::ceil<std::chrono::milliseconds>(deadline_ - now);
+  }
+
+  TimePoint getDeadline() const {
+    return deadline_;
+  }
+
+ private:
+  // The latest deadline refreshed
+  TimePoint deadline_;
+  // When the callback is scheduled to fire
+  TimePoint scheduledDeadline_;
+};
+
+} // namespace proxygen
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/MaglevHash.h>
+
+#include <algorithm>
+#include <cmath>
+#include <folly/hash/Hash.h>
+#include <glog/logging.h>
+#include <limits>
+
+namespace {
+
+constexpr uint32_t kEmptySlot = std::numeric_limits<uint32_t>::max();
+
+bool isPrime(uint32_t n) {
+  if (n < 2) {
+    return false;
+  }
+  for (uint64_t d = 2; d * d <= n; ++d) {
+    if (n % d == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+namespace proxygen {
+
+MaglevHash::MaglevHash(uint32_t tableSize) : tableSize_(tableSize) {
+  CHECK(isPrime(tableSize_)) << "tableSize=" << tableSize_ << " is not prime";
+}
+
+/*
+ * Candidate i starts at slot offset_i and moves skip_i slots at a time,
+ * which visits every slot since the table size is prime. Every candidate
+ * first claims one slot, however small its weight. Then in each round,
+ * every candidate earns weight_i / maxWeight credit, and spends a full one
+ * to claim the next free slot of its permutation, until the table is full.
+ */
+void MaglevHash::build(std::vector<std::pair<std::string, uint64_t>>& nodes) {
+  CHECK_LT(nodes.size(), kEmptySlot);
+  table_.assign(tableSize_, kEmptySlot);
+  weights_.clear();
+  totalWeight_ = 0;
+  numWeighted_ = 0;
+  maxErrorRate_ = 0;
+
+  struct Permutation {
+    uint32_t node;
+    uint64_t offset;
+    uint64_t skip;
+    uint64_t next{0};
+    double credit{0};
+    double share;
+  };
+  std::vector<Permutation> permutations;
+  uint64_t maxWeight = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    weights_.push_back(nodes[i].second);
+    if (nodes[i].second == 0) {
+      continue;
+    }
+    auto hash = computeHash(nodes[i].first.c_str(), nodes[i].first.size());
+    permutations.push_back({static_cast<uint32_t>(i),
+                            hash % tableSize_,
+                            computeHash(hash) % (tableSize_ - 1) + 1});
+    maxWeight = std::max(maxWeight, nodes[i].second);
+    totalWeight_ += nodes[i].second;
+  }
+  numWeighted_ = permutations.size();
+  if (permutations.empty()) {
+    table_.clear();
+    return;
+  }
+  for (auto& permutation : permutations) {
+    permutation.share = double(weights_[permutation.node]) / maxWeight;
+  }
+
+  std::vector<uint32_t> slotCounts(nodes.size());
+  uint32_t filled = 0;
+  // Only while the table isn't full, so the permutation finds a free slot
+  auto claim = [&](Permutation& permutation) {
+    uint64_t slot;
+    do {
+      slot = (permutation.offset + permutation.next * permutation.skip) %
+             tableSize_;
+      permutation.next++;
+    } while (table_[slot] != kEmptySlot);
+    table_[slot] = permutation.node;
+    slotCounts[permutation.node]++;
+    return ++filled == tableSize_;
+  };
+  bool full = false;
+  for (auto& permutation : permutations) {
+    if ((full = claim(permutation))) {
+      break;
+    }
+  }
+  while (!full) {
+    for (auto& permutation : permutations) {
+      permutation.credit += permutation.share;
+      if (permutation.credit < 1) {
+        continue;
+      }
+      permutation.credit -= 1;
+      if ((full = claim(permutation))) {
+        break;
+      }
+    }
+  }
+
+  for (const auto& permutation : permutations) {
+    double expected = weights_[permutation.node] / totalWeight_;
+    double actual = double(slotCounts[permutation.node]) / tableSize_;
+    maxErrorRate_ = std::max(maxErrorRate_, std::fabs(expected - actual));
+  }
+}
+
+size_t MaglevHash::get(const uint64_t key, const size_t rank) const {
+  if (table_.empty()) {
+    return 0;
+  }
+  size_t index = getTableIndex(key);
+  size_t modRank = rank % numWeighted_;
+  if (modRank == 0) {
+    return table_[index];
+  }
+
+  // One pass over the table: with more candidates than slots, some own none
+  std::vector<bool> seen(weights_.size());
+  std::vector<uint32_t> found;
+  for (size_t i = 0; i < tableSize_; ++i, index = (index + 1) % tableSize_) {
+    auto node = table_[index];
+    if (!seen[node]) {
+      seen[node] = true;
+      if (found.size() == modRank) {
+        return node;
+      }
+      found.push_back(node);
+    }
+  }
+  return found[modRank % found.size()];
+}
+
+size_t MaglevHash::getWithBoundedLoad(const uint64_t key,
+                                      const std::vector<uint64_t>& loads,
+                                      uint64_t totalLoad,
+                                      double loadFactor) const {
+  DCHECK_EQ(loads.size(), weights_.size());
+  DCHECK_GE(loadFactor, 1.0);
+  if (table_.empty()) {
+    return 0;
+  }
+  size_t start = getTableIndex(key);
+  // Counting this key, so that there is always room under the bound
+  double boundPerWeight = loadFactor * (totalLoad + 1) / totalWeight_;
+  size_t index = start;
+  do {
+    auto node = table_[index];
+    if (loads[node] < std::ceil(boundPerWeight * weights_[node])) {
+      return node;
+    }
+    index = (index + 1) % tableSize_;
+  } while (index != start);
+  // Only if loads doesn't add up to totalLoad
+  return table_[start];
+}
+
+size_t MaglevHash::getTableIndex(uint64_t key) const {
+  return computeHash(key) % tableSize_;
+}
+
+uint64_t MaglevHash::computeHash(const char* data, size_t len) const {
+  return folly::hash::fnv64_buf(data, len);
+}
+
+uint64_t MaglevHash::computeHash(uint64_t i) const {
+  return folly::hash::twang_mix64(i);
+}
+
+double MaglevHash::getMaxErrorRate() const {
+  return maxErrorRate_;
+}
+
+} // namespace proxygen
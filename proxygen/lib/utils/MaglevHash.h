@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <proxygen/lib/utils/ConsistentHash.h>
+#include <string>
+#include <vector>
+
+namespace proxygen {
+/*
+ * Weighted Maglev Hash (Eisenbud et al., NSDI 2016) routes keys with a
+ * single lookup into a table filled at build() time, rather than hashing
+ * the key against every candidate as RendezvousHash does.
+ *
+ * Every candidate walks its own permutation of the table and claims the
+ * next free slot in turn. Candidates take turns in proportion to their
+ * weight, so each owns about its share of slots. Changing the candidates
+ * moves slightly more keys than RendezvousHash would, a few percent with a
+ * table 100 times larger than the number of candidates.
+ *
+ * getWithBoundedLoad() implements consistent hashing with bounded loads
+ * (Mirrokni et al., SODA 2018) on top of it.
+ */
+class MaglevHash : public ConsistentHash {
+ public:
+  // Prime, as required for the permutations to cover the whole table
+  static constexpr uint32_t kDefaultTableSize = 65537;
+
+  /**
+   * @param tableSize Must be prime, ideally at least 100 times the number of
+   *                  candidates.
+   */
+  explicit MaglevHash(uint32_t tableSize = kDefaultTableSize);
+
+  double getMaxErrorRate() const override;
+
+  void build(std::vector<std::pair<std::string, uint64_t>>&) override;
+
+  /**
+   * Rank 0 is a table lookup. Any other rank walks the table from the key
+   * until rank + 1 distinct candidates were found, and is taken modulo the
+   * number of candidates with a non zero weight.
+   */
+  size_t get(const uint64_t key, const size_t rank = 0) const override;
+
+  /**
+   * Returns the first candidate for key, in the order of the table, whose
+   * load is below ceil(loadFactor * (totalLoad + 1) * its weight share).
+   * No candidate is then assigned more than loadFactor times its share of
+   * the load, and a key only moves off its candidate while it is
+   * overloaded.
+   *
+   * @param loads      The current load of every candidate, indexed as the
+   *                   input of build().
+   * @param totalLoad  The sum of loads.
+   * @param loadFactor At least 1. The closer to 1, the more keys move.
+   */
+  size_t getWithBoundedLoad(const uint64_t key,
+                            const std::vector<uint64_t>& loads,
+                            uint64_t totalLoad,
+                            double loadFactor = 1.25) const;
+
+ private:
+  uint64_t computeHash(const char* data, size_t len) const;
+
+  uint64_t computeHash(uint64_t i) const;
+
+  size_t getTableIndex(uint64_t key) const;
+
+  uint32_t tableSize_;
+  // Candidate owning every slot
+  std::vector<uint32_t> table_;
+  std::vector<uint64_t> weights_;
+  double totalWeight_{0};
+  size_t numWeighted_{0};
+  double maxErrorRate_{0};
+};
+
+} // namespace proxygen
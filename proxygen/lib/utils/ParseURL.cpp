@@ -48,8 +48,10 @@ static bool validateScheme(folly::StringPiece url) {
   }
 
   auto scheme = url.subpiece(0, schemeEnd);
-  return std::all_of(
-      scheme.begin(), scheme.end(), [](auto _) { return std::isalpha(_); });
+  // ASCII only, unlike std::isalpha which depends on the locale
+  return std::all_of(scheme.begin(), scheme.end(), [](char c) {
+    return static_cast<uint8_t>((c | 0x20) - 'a') < 26;
+  });
 }
 
 void ParseURL::parse(bool strict) noexcept {
@@ -96,8 +98,15 @@ void ParseURL::parse(bool strict) noexcept {
       fragment_ = url_.subpiece(u.field_data[UF_FRAGMENT].off,
                                 u.field_data[UF_FRAGMENT].len);
 
-      authority_ =
-          (port_) ? folly::to<std::string>(host_, ":", port_) : host_.str();
+      // host and port are adjacent in the URL, after any userinfo
+      if (port_ != 0) {
+        authority_.reset(host_.data(),
+                         u.field_data[UF_PORT].off +
+                             u.field_data[UF_PORT].len -
+                             (host_.data() - url_.data()));
+      } else {
+        authority_ = host_;
+      }
     }
   } else {
     parseNonFully(strict);
@@ -126,7 +135,7 @@ void ParseURL::parseNonFully(bool strict) noexcept {
   auto pathEnd = std::min(queryStart, hashStart);
   auto authorityEnd = std::min(pathStart, pathEnd);
 
-  authority_ = url_.subpiece(0, authorityEnd).str();
+  authority_ = url_.subpiece(0, authorityEnd);
 
   if (pathStart < pathEnd) {
     path_ = url_.subpiece(pathStart, pathEnd - pathStart);
@@ -160,21 +169,20 @@ bool ParseURL::parseAuthority() noexcept {
 
   auto pos = authority_.find(":", right != std::string::npos ? right : 0);
   if (pos != std::string::npos) {
-    try {
-      port_ = folly::to<uint16_t>(
-          folly::StringPiece(authority_, pos + 1, std::string::npos));
-    } catch (...) {
+    auto port = folly::tryTo<uint16_t>(authority_.subpiece(pos + 1));
+    if (!port) {
       return false;
     }
+    port_ = *port;
   }
 
   if (left == std::string::npos && right == std::string::npos) {
     // not a ipv6 literal
-    host_ = folly::StringPiece(authority_, 0, pos);
+    host_ = authority_.subpiece(0, pos);
     return true;
   } else if (left < right && right != std::string::npos) {
     // a ipv6 literal
-    host_ = folly::StringPiece(authority_, left, right - left + 1);
+    host_ = authority_.subpiece(left, right - left + 1);
     return true;
   } else {
     return false;
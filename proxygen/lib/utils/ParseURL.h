@@ -52,30 +52,9 @@ class ParseURL {
     init(urlVal, strict);
   }
 
-  ParseURL(ParseURL&& goner)
-      : url_(goner.url_),
-        scheme_(goner.scheme_),
-        path_(goner.path_),
-        query_(goner.query_),
-        fragment_(goner.fragment_),
-        port_(goner.port_),
-        valid_(goner.valid_),
-        initialized_(goner.initialized_) {
-    moveHostAndAuthority(std::move(goner));
-  }
-
-  ParseURL& operator=(ParseURL&& goner) {
-    url_ = goner.url_;
-    scheme_ = goner.scheme_;
-    path_ = goner.path_;
-    query_ = goner.query_;
-    fragment_ = goner.fragment_;
-    port_ = goner.port_;
-    valid_ = goner.valid_;
-    initialized_ = goner.initialized_;
-    moveHostAndAuthority(std::move(goner));
-    return *this;
-  }
+  // Every component is a view of url_, so moving is a plain copy
+  ParseURL(ParseURL&&) = default;
+  ParseURL& operator=(ParseURL&&) = default;
 
   ParseURL& operator=(const ParseURL&) = delete;
   ParseURL(const ParseURL&) = delete;
@@ -102,7 +81,7 @@ class ParseURL {
   }
 
   std::string authority() const {
-    return authority_;
+    return authority_.str();
   }
 
   bool hasHost() const {
@@ -154,40 +133,6 @@ class ParseURL {
       folly::StringPiece name) const noexcept;
 
  private:
-  void moveHostAndAuthority(ParseURL&& goner) {
-    if (!valid_) {
-      return;
-    }
-    int64_t hostOff = -1;
-    int64_t hostNoBracketsOff = -1;
-    if (goner.host_.empty() || (goner.host_.data() >= goner.url_.data() &&
-                                goner.host_.data() < goner.url_.end())) {
-      // relative url_
-      host_ = goner.host_;
-    } else {
-      // relative authority_
-      hostOff = goner.host_.data() - goner.authority_.data();
-    }
-    if (goner.hostNoBrackets_.empty() ||
-        (goner.hostNoBrackets_.data() >= goner.url_.data() &&
-         goner.hostNoBrackets_.data() < goner.url_.end())) {
-      // relative url_
-      hostNoBrackets_ = goner.hostNoBrackets_;
-    } else {
-      // relative authority_
-      hostNoBracketsOff =
-          goner.hostNoBrackets_.data() - goner.authority_.data();
-    }
-    authority_ = std::move(goner.authority_);
-    if (hostOff >= 0) {
-      host_.reset(authority_.data() + hostOff, goner.host_.size());
-    }
-    if (hostNoBracketsOff >= 0) {
-      hostNoBrackets_.reset(authority_.data() + hostNoBracketsOff,
-                            goner.hostNoBrackets_.size());
-    }
-  }
-
   FB_EXPORT void parse(bool strict) noexcept;
 
   void parseNonFully(bool strict) noexcept;
@@ -196,7 +141,8 @@ class ParseURL {
 
   folly::StringPiece url_;
   folly::StringPiece scheme_;
-  std::string authority_;
+  // host[:port], without any userinfo
+  folly::StringPiece authority_;
   folly::StringPiece host_;
   folly::StringPiece hostNoBrackets_;
   folly::StringPiece path_;
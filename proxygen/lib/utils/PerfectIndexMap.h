@@ -286,7 +286,18 @@ class PerfectIndexMap {
   }
   std::ptrdiff_t searchForOtherKey(const std::string &keyStr,
                                    size_t &startIndex) const {
-    while (startIndex < otherKeyNamesKeysIndex_.size()) {
+    const uint8_t hash = shortHash(keyStr);
+    const uint8_t *hashes = otherKeyHashes_.data();
+    while (startIndex < otherKeyHashes_.size()) {
+      // Only the names with the same short hash are compared
+      auto match = (const uint8_t *)memchr(hashes + startIndex,
+                                           hash,
+                                           otherKeyHashes_.size() - startIndex);
+      if (!match) {
+        startIndex = otherKeyHashes_.size();
+        break;
+      }
+      startIndex = match - hashes;
       // The key can only be OtherKey or NoneKey
       if (keys_[otherKeyNamesKeysIndex_[startIndex]] == OtherKey) {
         if (CaseInsensitive) {
@@ -307,6 +318,19 @@ class PerfectIndexMap {
     return -1;
   }
 
+  // One byte FNV-1a of keyStr, folded to lower case if CaseInsensitive
+  static uint8_t shortHash(const std::string &keyStr) {
+    uint32_t hash = 2166136261u;
+    for (char c : keyStr) {
+      if (CaseInsensitive && c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+      }
+      hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return static_cast<uint8_t>(hash ^ (hash >> 8) ^ (hash >> 16) ^
+                                (hash >> 24));
+  }
+
   // Utility methods for adding / modifying to our index.
   void addKeyToIndex(Key key, const std::string &value) {
     keys_.push_back(key);
@@ -315,6 +339,7 @@ class PerfectIndexMap {
   void addOtherKeyToIndex(const std::string &keyStr, const std::string &value) {
     keys_.push_back(OtherKey);
     otherKeyNames_.emplace_back(keyStr);
+    otherKeyHashes_.push_back(shortHash(keyStr));
     otherKeyNamesKeysIndex_.push_back(keys_.size() - 1);
     values_.emplace_back(value);
     ++otherKeyCount_;
@@ -329,6 +354,7 @@ class PerfectIndexMap {
                               const std::string &keyStr,
                               const std::string &value) {
     otherKeyNames_[namesIndex] = keyStr;
+    // Unchanged: only names equal to keyStr, up to case, are replaced
     values_[otherKeyNamesKeysIndex_[namesIndex]] = value;
   }
 
@@ -412,6 +438,10 @@ class PerfectIndexMap {
   // the map was an OtherKey.
   folly::fbvector<std::string> otherKeyNames_;
 
+  // shortHash() of each of otherKeyNames_, scanned with memchr before any
+  // string comparison.
+  folly::fbvector<uint8_t> otherKeyHashes_;
+
   // Storage for all values, OtherKey or other.
   // Thus values_.size() == keys_.size().
   folly::fbvector<std::string> values_;
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include <folly/SingletonThreadLocal.h>
+
+namespace proxygen {
+
+namespace detail {
+inline std::atomic<size_t> pooledObjectCacheSize{0};
+} // namespace detail
+
+/**
+ * Free blocks each thread keeps for each PooledObject class, zero (the
+ * default) to not pool. HTTPServer sets it from
+ * HTTPServerOptions::handlerPoolSize.
+ */
+inline void setPooledObjectCacheSize(size_t size) {
+  detail::pooledObjectCacheSize.store(size, std::memory_order_relaxed);
+}
+
+inline size_t getPooledObjectCacheSize() {
+  return detail::pooledObjectCacheSize.load(std::memory_order_relaxed);
+}
+
+/**
+ * Recycles the memory of objects allocated for every request or connection,
+ * such as RequestHandlers, Filters, RequestHandlerAdaptors, and the
+ * HTTPDownstreamSessions and codecs of HTTPSessionAcceptor, through a free
+ * list per thread instead of malloc and free. The memory stays on the
+ * thread, and so the NUMA node, that first touched it. Derive from it,
+ * naming the class:
+ *
+ *   class MyFilter : public Filter, public PooledObject<MyFilter> {...};
+ *
+ * new and delete (including `delete this`) work as before, and the object
+ * is constructed anew in the recycled memory, so no reset method is
+ * needed. Only objects of exactly T's size are pooled: subclasses of T use
+ * the global allocator.
+ */
+template <typename T>
+class PooledObject {
+ public:
+  static void* operator new(size_t size) {
+    if (size == sizeof(T)) {
+      auto& blocks = freeBlocks();
+      if (!blocks.empty()) {
+        auto block = blocks.back();
+        blocks.pop_back();
+        return block;
+      }
+    }
+    return ::operator new(size);
+  }
+
+  static void operator delete(void* block, size_t size) noexcept {
+    if (size == sizeof(T)) {
+      auto& blocks = freeBlocks();
+      if (blocks.size() < getPooledObjectCacheSize()) {
+        try {
+          blocks.push_back(block);
+          return;
+        } catch (const std::bad_alloc&) {
+        }
+      }
+    }
+    ::operator delete(block);
+  }
+
+ private:
+  struct FreeBlocks {
+    ~FreeBlocks() {
+      for (auto block : blocks) {
+        ::operator delete(block);
+      }
+    }
+
+    std::vector<void*> blocks;
+  };
+  struct Tag {};
+
+  static std::vector<void*>& freeBlocks() {
+    return folly::SingletonThreadLocal<FreeBlocks, Tag>::get().blocks;
+  }
+};
+
+} // namespace proxygen
@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <folly/hash/Hash.h>
+#include <glog/logging.h>
 #include <limits>
 #include <map>
 #include <math.h> /* pow */
@@ -146,15 +147,7 @@ size_t RendezvousHash::getNthByWeightedHash(
     scaledWeights.reserve(weights_.size());
   }
   for (size_t i = 0; i < weights_.size(); ++i) {
-    const auto& entry = weights_[i];
-    // combine the hash with the cluster together
-    double combinedHash = computeHash(entry.first + key);
-    double scaledHash =
-        (double)combinedHash / std::numeric_limits<uint64_t>::max();
-    double scaledWeight = 0;
-    if (entry.second != 0) {
-      scaledWeight = pow(scaledHash, (double)1 / entry.second);
-    }
+    double scaledWeight = getScaledWeight(weights_[i], key);
     if (modRank == 0) {
       if (scaledWeight > maxWeight) {
         maxWeight = scaledWeight;
@@ -211,6 +204,62 @@ std::vector<size_t> RendezvousHash::selectNUnweighted(const uint64_t key,
   return selection;
 }
 
+size_t RendezvousHash::getWithTwoChoices(const uint64_t key,
+                                         const std::vector<uint64_t>& loads,
+                                         uint64_t seed,
+                                         size_t candidates,
+                                         double loadFactor) const {
+  DCHECK_EQ(loads.size(), weights_.size());
+  DCHECK_GE(loadFactor, 1.0);
+  if (weights_.empty()) {
+    return 0;
+  }
+  auto ranked = getTopN(key, std::min(candidates, weights_.size()));
+  auto first = ranked[0];
+  if (ranked.size() == 1) {
+    return first;
+  }
+  auto other = ranked[1 + computeHash(key ^ computeHash(seed)) %
+                              (ranked.size() - 1)];
+  // Counting this key, so that an idle node keeps its keys
+  if (loads[first] + 1 > loadFactor * (loads[other] + 1)) {
+    return other;
+  }
+  return first;
+}
+
+std::vector<size_t> RendezvousHash::getTopN(const uint64_t key,
+                                            size_t n) const {
+  std::vector<std::pair<double, size_t>> scaledWeights;
+  scaledWeights.reserve(weights_.size());
+  for (size_t i = 0; i < weights_.size(); ++i) {
+    scaledWeights.emplace_back(getScaledWeight(weights_[i], key), i);
+  }
+  n = std::min(n, scaledWeights.size());
+  std::partial_sort(scaledWeights.begin(),
+                    scaledWeights.begin() + n,
+                    scaledWeights.end(),
+                    std::greater<std::pair<double, size_t>>());
+  std::vector<size_t> top;
+  top.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    top.push_back(scaledWeights[i].second);
+  }
+  return top;
+}
+
+double RendezvousHash::getScaledWeight(
+    const std::pair<uint64_t, uint64_t>& entry, const uint64_t key) const {
+  // combine the hash with the cluster together
+  double combinedHash = computeHash(entry.first + key);
+  double scaledHash =
+      (double)combinedHash / std::numeric_limits<uint64_t>::max();
+  if (entry.second == 0) {
+    return 0;
+  }
+  return pow(scaledHash, (double)1 / entry.second);
+}
+
 uint64_t RendezvousHash::computeHash(const char* data, size_t len) const {
   return folly::hash::fnv64_buf(data, len);
 }
@@ -19,6 +19,10 @@ namespace proxygen {
  * Unlike ConsistentHash, Weighted Rendezvous Hash supports the action to
  * reduce the relative weight of a candidate while incurring minimum data
  * movement.
+ *
+ * getWithTwoChoices() spreads hot keys over the candidates ranked highest
+ * for them by the power of two choices, keeping a key on its first
+ * candidate unless that one is much busier.
  */
 class RendezvousHash : public ConsistentHash {
  public:
@@ -31,7 +35,33 @@ class RendezvousHash : public ConsistentHash {
   std::vector<size_t> selectNUnweighted(const uint64_t key,
                                         const size_t rank) const;
 
+  /**
+   * Returns the first of the candidates nodes ranked highest for key, or
+   * another of them picked by hash of key and seed when its load is over
+   * loadFactor times the other's.  Under even loads keys keep their node as
+   * with get(), and a hot key only moves off a node that its requests
+   * overloaded, to nodes that keys ranking it first don't already crowd.
+   *
+   * @param loads      The current load of every node, such as its pool's
+   *                   outgoing transactions, indexed as the input of
+   *                   build().
+   * @param seed       Varies the second choice, such as a request counter.
+   * @param candidates How many of the highest ranked nodes can be chosen.
+   * @param loadFactor At least 1. The closer to 1, the more keys move.
+   */
+  size_t getWithTwoChoices(const uint64_t key,
+                           const std::vector<uint64_t>& loads,
+                           uint64_t seed,
+                           size_t candidates = 4,
+                           double loadFactor = 1.25) const;
+
  private:
+  double getScaledWeight(const std::pair<uint64_t, uint64_t>& entry,
+                         const uint64_t key) const;
+
+  // The n nodes ranked highest for key, highest first
+  std::vector<size_t> getTopN(const uint64_t key, size_t n) const;
+
   size_t getNthByWeightedHash(const uint64_t key,
                               const size_t modRank,
                               std::vector<size_t>* returnRankIds) const;
@@ -8,9 +8,13 @@
 
 #pragma once
 
+#include <cstdint>
+#include <folly/Likely.h>
 #include <glog/logging.h>
+#include <initializer_list>
 #include <limits>
 #include <tuple>
+#include <utility>
 
 namespace proxygen {
 
@@ -29,7 +33,7 @@ class StateMachine {
     State newState;
 
     std::tie(newState, ok) = T::find(state, event);
-    if (!ok) {
+    if (FOLLY_UNLIKELY(!ok)) {
       LOG_EVERY_N(ERROR, 100)
           << T::getName() << ": invalid transition tried: " << state << " "
           << event;
@@ -57,55 +61,57 @@ class StateMachine {
  * storing the index of S2 (the new state) at transitions[S1, e]. An
  * invalid transition is represented by storing a max value instead of
  * S2 index.
+ *
+ * N and M are State::NumStates and Event::NumEvents.  The table is built
+ * at compile time; a table listing a transition out of range, or the same
+ * transition twice, is not valid(), which the users static_assert.
  */
 template <class State, class Event>
 class TransitionTable {
- private:
-  size_t index(State s, Event e) const {
-    return static_cast<uint64_t>(s) * nEvents_ + static_cast<uint64_t>(e);
-  }
+ public:
+  using Transition = std::pair<std::pair<State, Event>, State>;
 
-  std::vector<uint8_t> transitions_;
-  const size_t nStates_{0};
-  const size_t nEvents_{0};
+  static constexpr size_t kNumStates = static_cast<size_t>(State::NumStates);
+  static constexpr size_t kNumEvents = static_cast<size_t>(Event::NumEvents);
+  static_assert(kNumStates < std::numeric_limits<uint8_t>::max(),
+                "Too many states");
 
- public:
-  TransitionTable(
-      size_t nStates,
-      size_t nEvents,
-      std::vector<std::pair<std::pair<State, Event>, State>> transitions)
-      : nStates_(nStates), nEvents_(nEvents) {
-    CHECK_LT(static_cast<uint64_t>(nStates),
-             std::numeric_limits<uint8_t>::max());
+  constexpr TransitionTable(std::initializer_list<Transition> transitions) {
     // Set all transitions to invalid
-    transitions_.resize(nStates * nEvents, std::numeric_limits<uint8_t>::max());
-
-    for (auto t : transitions) {
-      auto src_state = t.first.first;
-      auto event = t.first.second;
-      auto dst_state_idx = static_cast<uint8_t>(t.second);
-      transitions_[index(src_state, event)] = dst_state_idx;
+    for (auto& dst : transitions_) {
+      dst = kInvalid;
+    }
+    for (const auto& t : transitions) {
+      auto src = static_cast<size_t>(t.first.first);
+      auto event = static_cast<size_t>(t.first.second);
+      auto dst = static_cast<size_t>(t.second);
+      if (src >= kNumStates || event >= kNumEvents || dst >= kNumStates ||
+          transitions_[src * kNumEvents + event] != kInvalid) {
+        valid_ = false;
+        continue;
+      }
+      transitions_[src * kNumEvents + event] = static_cast<uint8_t>(dst);
     }
   }
 
-  TransitionTable() = delete;
-  TransitionTable& operator=(const TransitionTable&) = delete;
-  TransitionTable(const TransitionTable&) = delete;
-  TransitionTable(TransitionTable&& goner)
-      : transitions_(std::move(goner.transitions_)),
-        nStates_(goner.nStates_),
-        nEvents_(goner.nEvents_) {
+  constexpr bool valid() const {
+    return valid_;
   }
 
   std::pair<State, bool> find(State s, Event e) const {
-    CHECK_LT(static_cast<uint64_t>(s), nStates_);
-    CHECK_LT(static_cast<uint64_t>(e), nEvents_);
-    uint8_t result = transitions_[index(s, e)];
-    if (result == std::numeric_limits<uint8_t>::max()) {
-      return std::make_pair(s, false);
-    }
-    return std::make_pair(State(result), true);
+    DCHECK_LT(static_cast<size_t>(s), kNumStates);
+    DCHECK_LT(static_cast<size_t>(e), kNumEvents);
+    uint8_t result = transitions_[static_cast<size_t>(s) * kNumEvents +
+                                  static_cast<size_t>(e)];
+    bool ok = result != kInvalid;
+    return std::make_pair(ok ? State(result) : s, ok);
   }
+
+ private:
+  static constexpr uint8_t kInvalid = std::numeric_limits<uint8_t>::max();
+
+  uint8_t transitions_[kNumStates * kNumEvents]{};
+  bool valid_{true};
 };
 
 } // namespace proxygen
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/StaticFileCache.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/File.h>
+#include <folly/String.h>
+#include <folly/portability/SysStat.h>
+#include <folly/portability/Unistd.h>
+#include <folly/system/MemoryMapping.h>
+#include <glog/logging.h>
+#include <proxygen/lib/http/RFC2616.h>
+#include <proxygen/lib/utils/HTTPTime.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+#include <proxygen/lib/utils/ZstdStreamCompressor.h>
+#ifdef PROXYGEN_HAVE_BROTLI
+#include <proxygen/lib/utils/BrotliStreamCompressor.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+// Compresses body whole, nullptr if compressing failed
+std::unique_ptr<folly::IOBuf> compressWith(proxygen::StreamCompressor& c,
+                                           const folly::IOBuf& body) {
+  auto compressed = c.compress(&body, true);
+  if (c.hasError() || !compressed) {
+    return nullptr;
+  }
+  // One contiguous buffer, so that the cache holds no more than its length
+  compressed->coalesce();
+  return compressed;
+}
+
+// Strong: a change of the file changes its inode, size or mtime
+std::string makeETag(const struct stat& st) {
+  return folly::to<std::string>("\"",
+                                uint64_t(st.st_ino),
+                                "-",
+                                st.st_size,
+                                "-",
+                                int64_t(st.st_mtime),
+                                "\"");
+}
+
+} // namespace
+
+namespace proxygen {
+
+class StaticFileCache::Watcher : public folly::EventHandler {
+ public:
+  Watcher(folly::EventBase* evb, int fd, StaticFileCache& cache)
+      : folly::EventHandler(evb, folly::NetworkSocket::fromFd(fd)),
+        cache_(cache) {
+    registerHandler(folly::EventHandler::READ | folly::EventHandler::PERSIST);
+  }
+
+  void handlerReady(uint16_t /*events*/) noexcept override {
+#if defined(__linux__)
+    alignas(struct inotify_event) char buf[4096];
+    auto fd = getNetworkSocket().toFd();
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+      for (char* p = buf; p < buf + len;) {
+        auto event = reinterpret_cast<const struct inotify_event*>(p);
+        cache_.onFileChanged(event->wd);
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+#endif
+  }
+
+ private:
+  StaticFileCache& cache_;
+};
+
+StaticFileCache::State::State()
+    // Bounded by bytes rather than entries
+    : map(std::numeric_limits<size_t>::max()) {
+}
+
+const StaticFileCache::Entry::Variant* FOLLY_NULLABLE
+StaticFileCache::Entry::chooseVariant(folly::StringPiece acceptEncoding) const {
+  if (variants.empty() || acceptEncoding.empty()) {
+    return nullptr;
+  }
+  auto encodings = RFC2616::parseEncoding(acceptEncoding);
+  if (encodings.hasException()) {
+    return nullptr;
+  }
+  // Sorted by size
+  for (const auto& variant : variants) {
+    if (RFC2616::acceptsEncoding(*encodings, variant.coding)) {
+      return &variant;
+    }
+  }
+  return nullptr;
+}
+
+StaticFileCache::StaticFileCache(Options options) : options_(options) {
+}
+
+StaticFileCache::~StaticFileCache() {
+  if (watcher_) {
+    watcher_->getEventBase()->runImmediatelyOrRunInEventBaseThreadAndWait(
+        [this] { watcher_.reset(); });
+  }
+  auto fd = inotifyFd_.load();
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+std::shared_ptr<const StaticFileCache::Entry> StaticFileCache::load(
+    const std::string& path, const Options& options) {
+  folly::File file(path);
+  struct stat st;
+  folly::checkUnixError(fstat(file.fd(), &st), "fstat failed");
+  if (!S_ISREG(st.st_mode)) {
+    folly::throwSystemErrorExplicit(EISDIR, "not a file");
+  }
+  if (uint64_t(st.st_size) > options.maxFileBytes) {
+    return nullptr;
+  }
+
+  auto entry = std::make_shared<Entry>();
+  entry->size = st.st_size;
+  entry->etag = makeETag(st);
+  entry->lastModified = formatHTTPDateTime(st.st_mtime);
+  entry->contentLength = folly::to<std::string>(entry->size);
+  if (entry->size == 0) {
+    // mmap(2) rejects empty mappings
+    entry->body = folly::IOBuf::create(0);
+    return entry;
+  }
+
+  auto mapping =
+      std::make_shared<folly::MemoryMapping>(std::move(file), 0, entry->size);
+  auto data = mapping->range();
+  if (data.size() != entry->size) {
+    folly::throwSystemErrorExplicit(EINVAL, "file shrank while mapping it");
+  }
+  entry->body = folly::IOBuf::takeOwnership(
+      const_cast<uint8_t*>(data.data()),
+      data.size(),
+      [](void* /*buf*/, void* userData) {
+        delete static_cast<std::shared_ptr<folly::MemoryMapping>*>(userData);
+      },
+      new std::shared_ptr<folly::MemoryMapping>(std::move(mapping)));
+  // Nothing downstream (eg: in-place TLS encryption) may write into the
+  // page cache
+  entry->body->markExternallySharedOne();
+
+  if (entry->size < options.minCompressBytes) {
+    return entry;
+  }
+  auto addVariant = [&](std::string coding, StreamCompressor&& compressor) {
+    auto compressed = compressWith(compressor, *entry->body);
+    if (!compressed || compressed->length() >= entry->size) {
+      return;
+    }
+    auto length = folly::to<std::string>(compressed->length());
+    entry->variants.push_back(
+        {std::move(coding), std::move(compressed), std::move(length)});
+  };
+  if (options.gzip) {
+    addVariant("gzip",
+               ZlibStreamCompressor(CompressionType::GZIP, options.zlibLevel));
+  }
+  if (options.zstd) {
+    addVariant("zstd", ZstdStreamCompressor(options.zstdLevel));
+  }
+#ifdef PROXYGEN_HAVE_BROTLI
+  if (options.brotli) {
+    addVariant("br", BrotliStreamCompressor(options.brotliQuality));
+  }
+#endif
+  std::sort(entry->variants.begin(),
+            entry->variants.end(),
+            [](const auto& a, const auto& b) {
+              return a.body->length() < b.body->length();
+            });
+  return entry;
+}
+
+size_t StaticFileCache::getBytes(const Entry& entry) {
+  size_t bytes = entry.size;
+  for (const auto& variant : entry.variants) {
+    bytes += variant.body->length();
+  }
+  return bytes;
+}
+
+std::shared_ptr<const StaticFileCache::Entry> StaticFileCache::get(
+    const std::string& path) {
+  {
+    auto state = state_.lock();
+    auto it = state->map.find(path);
+    if (it != state->map.end()) {
+      hits_++;
+      return it->second.entry;
+    }
+  }
+  misses_++;
+  // Loaded unlocked, so a large file doesn't hold up the hits.  Concurrent
+  // misses of the same file load it more than once.
+  auto entry = load(path, options_);
+  if (!entry) {
+    return nullptr;
+  }
+  auto bytes = getBytes(*entry);
+  if (bytes > options_.maxBytes) {
+    return entry;
+  }
+
+  auto state = state_.lock();
+  auto it = state->map.findWithoutPromotion(path);
+  if (it != state->map.end()) {
+    // Another request loaded it meanwhile
+    return it->second.entry;
+  }
+  int wd = -1;
+#if defined(__linux__)
+  // Under the lock, so the watcher can't miss it, then checking the file
+  // didn't change since it was loaded
+  auto fd = inotifyFd_.load();
+  if (fd >= 0) {
+    wd = inotify_add_watch(fd,
+                           path.c_str(),
+                           IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF |
+                               IN_DELETE_SELF);
+    struct stat st;
+    if (wd < 0 || stat(path.c_str(), &st) != 0 ||
+        makeETag(st) != entry->etag) {
+      // It would never be revalidated
+      VLOG(2) << "Not caching " << path << ", changed or can't be watched";
+      if (wd >= 0 && !state->paths.count(wd)) {
+        inotify_rm_watch(fd, wd);
+      }
+      return entry;
+    }
+  }
+#endif
+  while (state->bytes + bytes > options_.maxBytes && !state->map.empty()) {
+    auto oldest = std::prev(state->map.end());
+    state->bytes -= getBytes(*oldest->second.entry);
+    unwatch(*state, oldest->first, oldest->second.wd);
+    state->map.erase(oldest);
+    evictions_++;
+  }
+  state->map.set(path, Cached{entry, wd});
+  state->bytes += bytes;
+  if (wd >= 0) {
+    state->paths[wd].insert(path);
+  }
+  return entry;
+}
+
+void StaticFileCache::unwatch(State& state,
+                              const std::string& path,
+                              int wd) {
+  if (wd < 0) {
+    return;
+  }
+  auto it = state.paths.find(wd);
+  if (it == state.paths.end()) {
+    return;
+  }
+  it->second.erase(path);
+  if (it->second.empty()) {
+    state.paths.erase(it);
+#if defined(__linux__)
+    // Fails harmlessly if inotify already removed it with its file
+    inotify_rm_watch(inotifyFd_.load(), wd);
+#endif
+  }
+}
+
+void StaticFileCache::invalidate(const std::string& path) {
+  auto state = state_.lock();
+  auto it = state->map.findWithoutPromotion(path);
+  if (it == state->map.end()) {
+    return;
+  }
+  state->bytes -= getBytes(*it->second.entry);
+  unwatch(*state, path, it->second.wd);
+  state->map.erase(it);
+  invalidations_++;
+}
+
+void StaticFileCache::onFileChanged(int wd) {
+  auto state = state_.lock();
+  auto it = state->paths.find(wd);
+  if (it == state->paths.end()) {
+    return;
+  }
+  auto paths = std::move(it->second);
+  state->paths.erase(it);
+#if defined(__linux__)
+  inotify_rm_watch(inotifyFd_.load(), wd);
+#endif
+  for (const auto& path : paths) {
+    VLOG(4) << "Invalidating changed " << path;
+    auto entry = state->map.findWithoutPromotion(path);
+    if (entry != state->map.end()) {
+      state->bytes -= getBytes(*entry->second.entry);
+      state->map.erase(entry);
+      invalidations_++;
+    }
+  }
+}
+
+bool StaticFileCache::watch(folly::EventBase* evb) {
+#if defined(__linux__)
+  CHECK(!watcher_) << "Already watching";
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    LOG(ERROR) << "inotify_init1 failed: " << folly::errnoStr(errno);
+    return false;
+  }
+  evb->runImmediatelyOrRunInEventBaseThreadAndWait(
+      [&] { watcher_ = std::make_unique<Watcher>(evb, fd, *this); });
+  inotifyFd_.store(fd);
+  return true;
+#else
+  (void)evb;
+  return false;
+#endif
+}
+
+StaticFileCache::Stats StaticFileCache::getStats() {
+  Stats stats{hits_.load(),
+              misses_.load(),
+              evictions_.load(),
+              invalidations_.load(),
+              0,
+              0};
+  auto state = state_.lock();
+  stats.bytes = state->bytes;
+  stats.entries = state->map.size();
+  return stats;
+}
+
+void StaticFileCache::clear() {
+  auto state = state_.lock();
+  while (!state->map.empty()) {
+    auto it = state->map.begin();
+    unwatch(*state, it->first, it->second.wd);
+    state->map.erase(it);
+  }
+  state->bytes = 0;
+}
+
+} // namespace proxygen
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/EventHandler.h>
+
+namespace proxygen {
+
+/**
+ * Caches regular files for serving.  Each file is memory mapped once and
+ * handed out as shared IOBufs over the mapping, along with the ETag,
+ * Last-Modified and Content-Length header values of its responses and its
+ * gzip, zstd and br variants, compressed when it's loaded.
+ *
+ * Entries are immutable, so a response keeps serving the version it
+ * started with.  The cache is an LRU bounded to maxBytes of files and
+ * variants.  With watch(), inotify drops the entries of the files that are
+ * changed, moved or deleted; otherwise they are never revalidated.
+ *
+ * All methods are thread safe.
+ */
+class StaticFileCache {
+ public:
+  struct Options {
+    // Bigger files are not cached
+    uint64_t maxFileBytes{4 * 1024 * 1024};
+    // Total size of the cached files and their variants
+    uint64_t maxBytes{256 * 1024 * 1024};
+    // Smaller files get no variants, nor do those compressing to more
+    uint64_t minCompressBytes{1000};
+    bool gzip{true};
+    int32_t zlibLevel{9};
+    bool zstd{true};
+    int32_t zstdLevel{19};
+    // Ignored unless proxygen is built with brotli
+    bool brotli{true};
+    int32_t brotliQuality{9};
+  };
+
+  struct Entry {
+    uint64_t size{0};
+    std::string etag;
+    std::string lastModified;
+    std::string contentLength;
+    // The whole file, use getBody()
+    std::unique_ptr<folly::IOBuf> body;
+    // Content coding to compressed body, and its Content-Length
+    struct Variant {
+      std::string coding;
+      std::unique_ptr<folly::IOBuf> body;
+      std::string contentLength;
+    };
+    std::vector<Variant> variants;
+
+    // A clone, sharing the mapping
+    std::unique_ptr<folly::IOBuf> getBody() const {
+      return body->clone();
+    }
+
+    // The smallest variant acceptEncoding accepts, nullptr for identity
+    const Variant* FOLLY_NULLABLE
+    chooseVariant(folly::StringPiece acceptEncoding) const;
+  };
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+    size_t bytes;
+    size_t entries;
+  };
+
+  explicit StaticFileCache(Options options);
+  ~StaticFileCache();
+
+  /**
+   * The entry of the file at path, loading it on a miss.  nullptr if it
+   * is bigger than maxFileBytes.  Throws std::system_error if it can't be
+   * opened or isn't a regular file.
+   */
+  std::shared_ptr<const Entry> get(const std::string& path);
+
+  void invalidate(const std::string& path);
+
+  /**
+   * Invalidates the entries of the files inotify reports changes of, read
+   * from evb, which must outlive the cache.  Call it once, before adding
+   * entries.  Returns false if inotify isn't available.
+   */
+  bool watch(folly::EventBase* evb);
+
+  Stats getStats();
+
+  void clear();
+
+  // Loads the file at path without caching it
+  static std::shared_ptr<const Entry> load(const std::string& path,
+                                           const Options& options);
+
+ private:
+  class Watcher;
+
+  struct Cached {
+    std::shared_ptr<const Entry> entry;
+    // inotify watch descriptor, or -1
+    int wd{-1};
+  };
+
+  struct State {
+    State();
+
+    folly::EvictingCacheMap<std::string, Cached> map;
+    size_t bytes{0};
+    // Several paths may name the same file, and inotify watch
+    folly::F14FastMap<int, folly::F14FastSet<std::string>> paths;
+  };
+
+  static size_t getBytes(const Entry& entry);
+
+  // Forgets the path its watch descriptor watches
+  void unwatch(State& state, const std::string& path, int wd);
+
+  void onFileChanged(int wd);
+
+  const Options options_;
+  folly::Synchronized<State, std::mutex> state_;
+  std::unique_ptr<Watcher> watcher_;
+  std::atomic<int> inotifyFd_{-1};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> invalidations_{0};
+};
+
+} // namespace proxygen
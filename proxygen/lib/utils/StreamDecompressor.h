@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
 namespace folly {
@@ -25,6 +26,14 @@ class StreamDecompressor {
  public:
   virtual ~StreamDecompressor() = default;
   virtual std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) = 0;
+  /**
+   * Like decompress, but stops once it has output maxOutput bytes, dropping
+   * the rest of in. The default does not bound the output.
+   */
+  virtual std::unique_ptr<folly::IOBuf> decompressAtMost(
+      const folly::IOBuf* in, uint64_t /*maxOutput*/) {
+    return decompress(in);
+  }
   virtual bool hasError() = 0;
   virtual bool finished() = 0;
 };
@@ -26,10 +26,13 @@ std::ostream& operator<<(std::ostream& os, TraceFieldType fieldType) {
   return os;
 }
 
-TraceEvent::TraceEvent(TraceEventType type, uint32_t parentID)
-    : type_(type), parentID_(parentID) {
+uint32_t TraceEvent::nextID() {
   static std::atomic<uint32_t> counter(0);
-  id_ = counter++;
+  return counter++;
+}
+
+TraceEvent::TraceEvent(TraceEventType type, uint32_t parentID)
+    : type_(type), id_(nextID()), parentID_(parentID) {
 }
 
 void TraceEvent::start(const TimeUtil& tm) {
@@ -236,8 +236,12 @@ class TraceEvent {
   friend std::ostream& operator<<(std::ostream& out, const TraceEvent& event);
 
   friend class Iterator;
+  friend class FlatTraceEvent;
 
  private:
+  // Shared with FlatTraceEvent, so ids stay unique across both
+  FB_EXPORT static uint32_t nextID();
+
   template <typename T>
   bool readMeta(TraceFieldType key, T& dest) const {
     const auto itr = metaData_.find(key);
@@ -17,6 +17,19 @@ void TraceEventContext::traceEventAvailable(const TraceEvent& event) {
   }
 }
 
+void TraceEventContext::traceEventAvailable(const FlatTraceEvent& event) {
+  for (const auto observer : observers_) {
+    observer->flatTraceEventAvailable(event);
+  }
+}
+
+TraceArena& TraceEventContext::getArena() {
+  if (!arena_) {
+    arena_ = std::make_shared<TraceArena>();
+  }
+  return *arena_;
+}
+
 bool TraceEventContext::isAllTraceEventNeeded() const {
   return allTraceEventNeeded_;
 }
@@ -9,12 +9,15 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace proxygen {
 
 struct TraceEventObserver;
 class TraceEvent;
+class FlatTraceEvent;
+class TraceArena;
 
 class TraceEventContext {
  public:
@@ -40,12 +43,24 @@ class TraceEventContext {
 
   void traceEventAvailable(const TraceEvent& event);
 
+  void traceEventAvailable(const FlatTraceEvent& event);
+
+  /**
+   * The arena for the FlatTraceEvents of this context, shared by its
+   * copies once created. The owner of the context clears it once the
+   * events are delivered.
+   */
+  TraceArena& getArena();
+
   bool isAllTraceEventNeeded() const;
 
  private:
   // Observer vector to observe all trace events about to occur
   std::vector<TraceEventObserver*> observers_;
 
+  // Created on first use, so contexts not tracing flat events cost nothing
+  std::shared_ptr<TraceArena> arena_;
+
   // Whether the observers actually care about all trace events from this
   // context or only necessary ones.
   bool allTraceEventNeeded_;
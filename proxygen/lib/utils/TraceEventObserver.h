@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <folly/Range.h>
+#include <proxygen/lib/utils/FlatTraceEvent.h>
 #include <proxygen/lib/utils/TraceEvent.h>
 
 namespace proxygen {
@@ -28,6 +30,23 @@ struct TraceEventObserver {
   }
   virtual void emitTraceEvents(std::vector<TraceEvent>) noexcept {
   }
+
+  /**
+   * Zero copy versions of the above, for events only valid during the
+   * call. By default the events are copied for the TraceEvent versions.
+   */
+  virtual void flatTraceEventAvailable(const FlatTraceEvent& event) noexcept {
+    traceEventAvailable(event.toTraceEvent());
+  }
+  virtual void emitFlatTraceEvents(
+      folly::Range<const FlatTraceEvent*> events) noexcept {
+    std::vector<TraceEvent> copies;
+    copies.reserve(events.size());
+    for (const auto& event : events) {
+      copies.push_back(event.toTraceEvent());
+    }
+    emitTraceEvents(std::move(copies));
+  }
 };
 
 } // namespace proxygen
@@ -10,6 +10,7 @@
 
 #include <folly/io/Cursor.h>
 #include <folly/lang/Bits.h>
+#include <proxygen/lib/utils/CompressionContextPool.h>
 
 using folly::IOBuf;
 
@@ -54,24 +55,33 @@ void ZlibStreamCompressor::init() {
 
   status_ = Z_OK;
 
-  zlibStream_.zalloc = Z_NULL;
-  zlibStream_.zfree = Z_NULL;
-  zlibStream_.opaque = Z_NULL;
-  zlibStream_.total_in = 0;
-  zlibStream_.next_in = Z_NULL;
-  zlibStream_.avail_in = 0;
-  zlibStream_.avail_out = 0;
-  zlibStream_.next_out = Z_NULL;
-
   DCHECK(level_ == Z_DEFAULT_COMPRESSION ||
          (level_ >= Z_NO_COMPRESSION && level_ <= Z_BEST_COMPRESSION))
       << "Invalid Zlib compression level. level=" << level_;
 
+  if (pooled_) {
+    zlibStream_ = CompressionContextPool::get().acquireDeflate(type_, level_);
+    if (!zlibStream_) {
+      status_ = Z_STREAM_ERROR;
+    }
+    return;
+  }
+
+  zlibStream_ = std::make_unique<z_stream>();
+  zlibStream_->zalloc = Z_NULL;
+  zlibStream_->zfree = Z_NULL;
+  zlibStream_->opaque = Z_NULL;
+  zlibStream_->total_in = 0;
+  zlibStream_->next_in = Z_NULL;
+  zlibStream_->avail_in = 0;
+  zlibStream_->avail_out = 0;
+  zlibStream_->next_out = Z_NULL;
+
   switch (type_) {
     case CompressionType::GZIP: {
       auto windowBits = type_ == CompressionType::GZIP ? GZIP_WINDOW_BITS
                                                        : DEFLATE_WINDOW_BITS;
-      status_ = deflateInit2(&zlibStream_,
+      status_ = deflateInit2(zlibStream_.get(),
                              level_,
                              Z_DEFLATED,
                              windowBits,
@@ -79,7 +89,7 @@ void ZlibStreamCompressor::init() {
                              Z_DEFAULT_STRATEGY);
     } break;
     case CompressionType::DEFLATE:
-      status_ = deflateInit(&zlibStream_, level_);
+      status_ = deflateInit(zlibStream_.get(), level_);
       break;
     default:
       DCHECK(false) << "Unsupported zlib compression type.";
@@ -88,16 +98,25 @@ void ZlibStreamCompressor::init() {
 
   if (status_ != Z_OK) {
     LOG(ERROR) << "error initializing zlib stream. r=" << status_;
+    zlibStream_.reset();
   }
 }
 
-ZlibStreamCompressor::ZlibStreamCompressor(CompressionType type, int level)
-    : type_(type), level_(level) {
+ZlibStreamCompressor::ZlibStreamCompressor(CompressionType type,
+                                           int level,
+                                           bool pooled)
+    : type_(type), level_(level), pooled_(pooled) {
 }
 
 ZlibStreamCompressor::~ZlibStreamCompressor() {
-  if (init_) {
-    status_ = deflateEnd(&zlibStream_);
+  if (!zlibStream_) {
+    return;
+  }
+  if (pooled_) {
+    CompressionContextPool::get().releaseDeflate(
+        std::move(zlibStream_), type_, level_);
+  } else {
+    status_ = deflateEnd(zlibStream_.get());
   }
 }
 
@@ -107,24 +126,27 @@ ZlibStreamCompressor::~ZlibStreamCompressor() {
 std::unique_ptr<IOBuf> ZlibStreamCompressor::compress(const IOBuf* in,
                                                       bool trailer) {
   init();
+  if (!zlibStream_) {
+    return nullptr;
+  }
   auto bufferLength = FLAGS_zlib_compressor_buffer_growth;
 
-  auto out = addOutputBuffer(&zlibStream_, bufferLength);
+  auto out = addOutputBuffer(zlibStream_.get(), bufferLength);
 
   for (auto& range : *in) {
     uint64_t remaining = range.size();
     uint64_t written = 0;
     while (remaining) {
       uint32_t step = remaining;
-      zlibStream_.next_in = const_cast<uint8_t*>(range.data() + written);
-      zlibStream_.avail_in = step;
+      zlibStream_->next_in = const_cast<uint8_t*>(range.data() + written);
+      zlibStream_->avail_in = step;
       remaining -= step;
       written += step;
 
-      while (zlibStream_.avail_in != 0) {
-        status_ = deflateHelper(&zlibStream_, out.get(), Z_NO_FLUSH);
+      while (zlibStream_->avail_in != 0) {
+        status_ = deflateHelper(zlibStream_.get(), out.get(), Z_NO_FLUSH);
         if (status_ != Z_OK) {
-          DLOG(FATAL) << "Deflate failed: " << zlibStream_.msg;
+          DLOG(FATAL) << "Deflate failed: " << zlibStream_->msg;
           return nullptr;
         }
       }
@@ -133,28 +155,28 @@ std::unique_ptr<IOBuf> ZlibStreamCompressor::compress(const IOBuf* in,
 
   if (trailer) {
     do {
-      status_ = deflateHelper(&zlibStream_, out.get(), Z_FINISH);
+      status_ = deflateHelper(zlibStream_.get(), out.get(), Z_FINISH);
     } while (status_ == Z_OK);
 
     if (status_ != Z_STREAM_END) {
-      DLOG(FATAL) << "Deflate failed: " << zlibStream_.msg;
+      DLOG(FATAL) << "Deflate failed: " << zlibStream_->msg;
       return nullptr;
     }
   } else {
     do {
-      status_ = deflateHelper(&zlibStream_, out.get(), Z_SYNC_FLUSH);
-    } while (zlibStream_.avail_out == 0);
+      status_ = deflateHelper(zlibStream_.get(), out.get(), Z_SYNC_FLUSH);
+    } while (zlibStream_->avail_out == 0);
 
     if (status_ != Z_OK) {
-      DLOG(FATAL) << "Deflate failed: " << zlibStream_.msg;
+      DLOG(FATAL) << "Deflate failed: " << zlibStream_->msg;
       return nullptr;
     }
   }
 
-  out->prev()->trimEnd(zlibStream_.avail_out);
+  out->prev()->trimEnd(zlibStream_->avail_out);
 
-  zlibStream_.next_out = Z_NULL;
-  zlibStream_.avail_out = 0;
+  zlibStream_->next_out = Z_NULL;
+  zlibStream_->avail_out = 0;
 
   return out;
 }
@@ -24,7 +24,13 @@ namespace proxygen {
 
 class ZlibStreamCompressor : public StreamCompressor {
  public:
-  explicit ZlibStreamCompressor(CompressionType type, int level);
+  /**
+   * With pooled, the deflate state comes from the CompressionContextPool of
+   * the thread and goes back to it when the compressor is destroyed.
+   */
+  explicit ZlibStreamCompressor(CompressionType type,
+                                int level,
+                                bool pooled = false);
 
   ~ZlibStreamCompressor() override;
 
@@ -48,8 +54,10 @@ class ZlibStreamCompressor : public StreamCompressor {
  private:
   CompressionType type_{CompressionType::NONE};
   int level_{Z_DEFAULT_COMPRESSION};
-  z_stream zlibStream_;
+  // Initialized zlib streams can't move
+  std::unique_ptr<z_stream> zlibStream_;
   int status_{Z_OK};
   bool init_{false};
+  bool pooled_{false};
 };
 } // namespace proxygen
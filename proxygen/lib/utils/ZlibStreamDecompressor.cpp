@@ -8,7 +8,10 @@
 
 #include <proxygen/lib/utils/ZlibStreamDecompressor.h>
 
+#include <limits>
+
 #include <folly/io/Cursor.h>
+#include <proxygen/lib/utils/CompressionContextPool.h>
 
 using folly::IOBuf;
 
@@ -18,45 +21,74 @@ void ZlibStreamDecompressor::init(CompressionType type) {
   DCHECK(type_ == CompressionType::NONE) << "Must be uninitialized";
   type_ = type;
   status_ = Z_OK;
-  zlibStream_.zalloc = Z_NULL;
-  zlibStream_.zfree = Z_NULL;
-  zlibStream_.opaque = Z_NULL;
-  zlibStream_.total_in = 0;
-  zlibStream_.next_in = Z_NULL;
-  zlibStream_.avail_in = 0;
-  zlibStream_.avail_out = 0;
-  zlibStream_.next_out = Z_NULL;
+  if (pooled_) {
+    zlibStream_ = CompressionContextPool::get().acquireInflate(type);
+    if (!zlibStream_) {
+      status_ = Z_STREAM_ERROR;
+    }
+    return;
+  }
+  zlibStream_ = std::make_unique<z_stream>();
+  zlibStream_->zalloc = Z_NULL;
+  zlibStream_->zfree = Z_NULL;
+  zlibStream_->opaque = Z_NULL;
+  zlibStream_->total_in = 0;
+  zlibStream_->next_in = Z_NULL;
+  zlibStream_->avail_in = 0;
+  zlibStream_->avail_out = 0;
+  zlibStream_->next_out = Z_NULL;
 
   DCHECK(type == CompressionType::DEFLATE || type == CompressionType::GZIP);
   auto windowBits =
       type_ == CompressionType::GZIP ? GZIP_WINDOW_BITS : DEFLATE_WINDOW_BITS;
-  status_ = inflateInit2(&zlibStream_, windowBits);
+  status_ = inflateInit2(zlibStream_.get(), windowBits);
+  if (status_ != Z_OK) {
+    zlibStream_.reset();
+  }
 }
 
 ZlibStreamDecompressor::ZlibStreamDecompressor(
     CompressionType type,
     uint64_t zlib_decompressor_buffer_growth,
-    uint64_t zlib_decompressor_buffer_minsize)
+    uint64_t zlib_decompressor_buffer_minsize,
+    bool pooled)
     : type_(CompressionType::NONE),
       decompressor_buffer_growth_(zlib_decompressor_buffer_growth),
       decompressor_buffer_minsize_(zlib_decompressor_buffer_minsize),
-      status_(Z_OK) {
+      status_(Z_OK),
+      pooled_(pooled) {
   init(type);
 }
 
 ZlibStreamDecompressor::~ZlibStreamDecompressor() {
-  if (type_ != CompressionType::NONE) {
-    status_ = inflateEnd(&zlibStream_);
+  if (!zlibStream_) {
+    return;
+  }
+  if (pooled_) {
+    CompressionContextPool::get().releaseInflate(std::move(zlibStream_),
+                                                 type_);
+  } else {
+    status_ = inflateEnd(zlibStream_.get());
   }
 }
 
 std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompress(const IOBuf* in) {
+  return decompressAtMost(in, std::numeric_limits<uint64_t>::max());
+}
+
+std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompressAtMost(
+    const IOBuf* in, uint64_t maxOutput) {
+  if (!zlibStream_) {
+    status_ = Z_STREAM_ERROR;
+    return nullptr;
+  }
   auto out = IOBuf::create(decompressor_buffer_growth_);
   auto appender = folly::io::Appender(out.get(), decompressor_buffer_growth_);
 
   const IOBuf* crtBuf = in;
   size_t offset = 0;
-  while (true) {
+  uint64_t outLen = 0;
+  while (outLen < maxOutput) {
     // Advance to the next IOBuf if necessary
     DCHECK_GE(crtBuf->length(), offset);
     if (crtBuf->length() == offset) {
@@ -82,22 +114,25 @@ std::unique_ptr<IOBuf> ZlibStreamDecompressor::decompress(const IOBuf* in) {
     DCHECK_GT(appender.length(), 0);
 
     const size_t origAvailIn = crtBuf->length() - offset;
-    zlibStream_.next_in = const_cast<uint8_t*>(crtBuf->data() + offset);
-    zlibStream_.avail_in = origAvailIn;
-    zlibStream_.next_out = appender.writableData();
-    zlibStream_.avail_out = appender.length();
-    status_ = inflate(&zlibStream_, Z_PARTIAL_FLUSH);
+    zlibStream_->next_in = const_cast<uint8_t*>(crtBuf->data() + offset);
+    zlibStream_->avail_in = origAvailIn;
+    zlibStream_->next_out = appender.writableData();
+    const size_t origAvailOut =
+        std::min<uint64_t>(appender.length(), maxOutput - outLen);
+    zlibStream_->avail_out = origAvailOut;
+    status_ = inflate(zlibStream_.get(), Z_PARTIAL_FLUSH);
     if (status_ != Z_OK && status_ != Z_STREAM_END) {
       LOG(INFO) << "error uncompressing buffer: r=" << status_;
       return nullptr;
     }
 
     // Adjust the input offset ahead
-    auto inConsumed = origAvailIn - zlibStream_.avail_in;
+    auto inConsumed = origAvailIn - zlibStream_->avail_in;
     offset += inConsumed;
     // Move output buffer ahead
-    auto outMove = appender.length() - zlibStream_.avail_out;
+    auto outMove = origAvailOut - zlibStream_->avail_out;
     appender.append(outMove);
+    outLen += outMove;
   }
 
   return out;
@@ -33,11 +33,16 @@ constexpr int DEFLATE_WINDOW_BITS = 15;
 
 class ZlibStreamDecompressor : public StreamDecompressor {
  public:
+  /**
+   * With pooled, the inflate state comes from the CompressionContextPool of
+   * the thread and goes back to it when the decompressor is destroyed.
+   */
   explicit ZlibStreamDecompressor(CompressionType type,
                                   uint64_t zlib_decompressor_buffer_growth =
                                       kZlibDecompressorBufferGrowthDefault,
                                   uint64_t zlib_decompressor_buffer_minsize =
-                                      kZlibDecompressorBufferMinsizeDefault);
+                                      kZlibDecompressorBufferMinsizeDefault,
+                                  bool pooled = false);
 
   ZlibStreamDecompressor() = default;
 
@@ -46,6 +51,8 @@ class ZlibStreamDecompressor : public StreamDecompressor {
   void init(CompressionType type);
 
   std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) override;
+  std::unique_ptr<folly::IOBuf> decompressAtMost(const folly::IOBuf* in,
+                                                 uint64_t maxOutput) override;
 
   int getStatus() {
     return status_;
@@ -63,7 +70,9 @@ class ZlibStreamDecompressor : public StreamDecompressor {
   CompressionType type_{CompressionType::NONE};
   uint64_t decompressor_buffer_growth_{kZlibDecompressorBufferGrowthDefault};
   uint64_t decompressor_buffer_minsize_{kZlibDecompressorBufferMinsizeDefault};
-  z_stream zlibStream_;
+  // Initialized zlib streams can't move
+  std::unique_ptr<z_stream> zlibStream_;
   int status_{-1};
+  bool pooled_{false};
 };
 } // namespace proxygen
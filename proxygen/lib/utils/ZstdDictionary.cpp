@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/ZstdDictionary.h>
+
+#include <stdexcept>
+
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/ssl/OpenSSLHash.h>
+#include <glog/logging.h>
+#include <proxygen/lib/utils/CryptUtil.h>
+
+namespace proxygen {
+
+void ZstdDictionary::freeCDict(ZSTD_CDict* cdict) {
+  ZSTD_freeCDict(cdict);
+}
+
+void ZstdDictionary::freeDDict(ZSTD_DDict* ddict) {
+  ZSTD_freeDDict(ddict);
+}
+
+ZstdDictionary::ZstdDictionary(std::string content, int compressionLevel)
+    : compressionLevel_(compressionLevel) {
+  if (content.empty()) {
+    throw std::runtime_error("Empty zstd dictionary");
+  }
+  id_ = ZSTD_getDictID_fromDict(content.data(), content.size());
+  folly::ssl::OpenSSLHash::sha256(folly::range(hash_),
+                                  folly::StringPiece(content));
+  hashHeaderValue_ =
+      folly::to<std::string>(":", base64Encode(folly::range(hash_)), ":");
+  // The digested dictionaries copy the content
+  cdict_.reset(
+      ZSTD_createCDict(content.data(), content.size(), compressionLevel));
+  ddict_.reset(ZSTD_createDDict(content.data(), content.size()));
+  if (!cdict_ || !ddict_) {
+    throw std::runtime_error("Failed to digest zstd dictionary");
+  }
+}
+
+std::shared_ptr<const ZstdDictionary> ZstdDictionary::loadFromFile(
+    const std::string& path, int compressionLevel) {
+  std::string content;
+  if (!folly::readFile(path.c_str(), content)) {
+    throw std::runtime_error(
+        folly::to<std::string>("Failed to read zstd dictionary ", path));
+  }
+  return std::make_shared<const ZstdDictionary>(std::move(content),
+                                                compressionLevel);
+}
+
+std::string ZstdDictionary::getDczHeader() const {
+  std::string header(reinterpret_cast<const char*>(kDczMagic.data()),
+                     kDczMagic.size());
+  header.append(reinterpret_cast<const char*>(hash_.data()), hash_.size());
+  return header;
+}
+
+ZstdDictionaryStore::ZstdDictionaryStore(
+    std::vector<std::shared_ptr<const ZstdDictionary>> dictionaries)
+    : dictionaries_(std::move(dictionaries)) {
+  for (const auto& dictionary : dictionaries_) {
+    CHECK(dictionary);
+    if (dictionary->getId() != 0 &&
+        !byId_.emplace(dictionary->getId(), dictionary).second) {
+      LOG(WARNING) << "Duplicate zstd dictionary ID " << dictionary->getId();
+    }
+    byHeader_.emplace(dictionary->getHashHeaderValue(), dictionary);
+  }
+}
+
+std::shared_ptr<const ZstdDictionary> ZstdDictionaryStore::findById(
+    uint32_t id) const {
+  auto it = byId_.find(id);
+  return it != byId_.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const ZstdDictionary> ZstdDictionaryStore::findByHash(
+    folly::ByteRange hash) const {
+  if (hash.size() != ZstdDictionary::kHashSize) {
+    return nullptr;
+  }
+  return findByHeader(folly::to<std::string>(":", base64Encode(hash), ":"));
+}
+
+std::shared_ptr<const ZstdDictionary> ZstdDictionaryStore::findByHeader(
+    folly::StringPiece availableDictionary) const {
+  auto it = byHeader_.find(folly::trimWhitespace(availableDictionary).str());
+  return it != byHeader_.end() ? it->second : nullptr;
+}
+
+} // namespace proxygen
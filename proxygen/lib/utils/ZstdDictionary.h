@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#ifndef ZSTD_STATIC_LINKING_ONLY
+#define ZSTD_STATIC_LINKING_ONLY
+#endif
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <zstd.h>
+
+#include <folly/Memory.h>
+#include <folly/Range.h>
+
+namespace proxygen {
+
+/**
+ * A zstd dictionary, digested once for compression and for decompression,
+ * that can be shared read-only by the compressors and decompressors of all
+ * threads.
+ *
+ * It is identified both by its zstd dictionary ID (zero for raw content
+ * dictionaries), which zstd writes in the frame headers, and by the SHA-256
+ * of its content, which the "dcz" content coding of Compression Dictionary
+ * Transport (RFC 9842) uses.
+ */
+class ZstdDictionary {
+ public:
+  // Prefix of dcz bodies, followed by the SHA-256 of the dictionary
+  static constexpr std::array<uint8_t, 8> kDczMagic = {
+      0x5e, 0x2a, 0x4d, 0x18, 0x20, 0x00, 0x00, 0x00};
+  static constexpr size_t kHashSize = 32;
+  static constexpr size_t kDczHeaderSize = kDczMagic.size() + kHashSize;
+
+  using Hash = std::array<uint8_t, kHashSize>;
+
+  /**
+   * Digests a dictionary trained by `zstd --train`, or any raw content, to
+   * compress at compressionLevel. Throws std::runtime_error if zstd fails
+   * to.
+   */
+  ZstdDictionary(std::string content, int compressionLevel);
+
+  // Throws std::runtime_error if the file can't be read
+  static std::shared_ptr<const ZstdDictionary> loadFromFile(
+      const std::string& path, int compressionLevel);
+
+  uint32_t getId() const {
+    return id_;
+  }
+
+  const Hash& getHash() const {
+    return hash_;
+  }
+
+  // The hash as an Available-Dictionary header value, ":<base64>:"
+  const std::string& getHashHeaderValue() const {
+    return hashHeaderValue_;
+  }
+
+  int getCompressionLevel() const {
+    return compressionLevel_;
+  }
+
+  const ZSTD_CDict* getCDict() const {
+    return cdict_.get();
+  }
+
+  const ZSTD_DDict* getDDict() const {
+    return ddict_.get();
+  }
+
+  // The dcz prefix of the bodies compressed with this dictionary
+  std::string getDczHeader() const;
+
+ private:
+  static void freeCDict(ZSTD_CDict* cdict);
+  static void freeDDict(ZSTD_DDict* ddict);
+
+  const int compressionLevel_;
+  uint32_t id_{0};
+  Hash hash_;
+  std::string hashHeaderValue_;
+  std::unique_ptr<ZSTD_CDict,
+                  folly::static_function_deleter<ZSTD_CDict, freeCDict>>
+      cdict_;
+  std::unique_ptr<ZSTD_DDict,
+                  folly::static_function_deleter<ZSTD_DDict, freeDDict>>
+      ddict_;
+};
+
+/**
+ * A read-only set of dictionaries, looked up by zstd ID or by hash.
+ */
+class ZstdDictionaryStore {
+ public:
+  explicit ZstdDictionaryStore(
+      std::vector<std::shared_ptr<const ZstdDictionary>> dictionaries);
+
+  const std::vector<std::shared_ptr<const ZstdDictionary>>& getDictionaries()
+      const {
+    return dictionaries_;
+  }
+
+  // nullptr if unknown, as are raw content dictionaries (ID zero)
+  std::shared_ptr<const ZstdDictionary> findById(uint32_t id) const;
+  std::shared_ptr<const ZstdDictionary> findByHash(
+      folly::ByteRange hash) const;
+
+  /**
+   * Finds the dictionary an Available-Dictionary request header names,
+   * a structured field byte sequence such as ":<base64 SHA-256>:".
+   */
+  std::shared_ptr<const ZstdDictionary> findByHeader(
+      folly::StringPiece availableDictionary) const;
+
+ private:
+  std::vector<std::shared_ptr<const ZstdDictionary>> dictionaries_;
+  std::map<uint32_t, std::shared_ptr<const ZstdDictionary>> byId_;
+  std::map<std::string, std::shared_ptr<const ZstdDictionary>> byHeader_;
+};
+
+} // namespace proxygen
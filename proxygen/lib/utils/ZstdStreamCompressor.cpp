@@ -9,24 +9,57 @@
 #include <proxygen/lib/utils/ZstdStreamCompressor.h>
 
 #include <folly/compression/Compression.h>
+#include <folly/io/IOBufQueue.h>
 
 namespace proxygen {
 
 ZstdStreamCompressor::ZstdStreamCompressor(int compressionLevel,
-                                           bool independentChunks)
+                                           bool independentChunks,
+                                           bool pooled)
     : codec_(nullptr),
       compressionLevel_(compressionLevel),
-      independent_(independentChunks) {
+      independent_(independentChunks),
+      pooled_(pooled) {
+}
+
+ZstdStreamCompressor::ZstdStreamCompressor(
+    std::shared_ptr<const ZstdDictionary> dictionary,
+    bool independentChunks,
+    bool dczFraming,
+    bool pooled)
+    : codec_(nullptr),
+      compressionLevel_(CHECK_NOTNULL(dictionary.get())->getCompressionLevel()),
+      independent_(independentChunks),
+      pooled_(pooled),
+      dictionary_(std::move(dictionary)),
+      dczFraming_(dczFraming) {
+}
+
+ZstdStreamCompressor::~ZstdStreamCompressor() {
+  releaseCodec();
+  if (pooled_ && cctx_) {
+    CompressionContextPool::get().releaseZstdCCtx(std::move(cctx_));
+  }
 }
 
 folly::io::StreamCodec& ZstdStreamCompressor::getCodec() {
   if (!codec_) {
-    codec_ = folly::io::getStreamCodec(folly::io::CodecType::ZSTD,
-                                       compressionLevel_);
+    codec_ = pooled_ ? CompressionContextPool::get().acquireZstdCodec(
+                           compressionLevel_)
+                     : folly::io::getStreamCodec(folly::io::CodecType::ZSTD,
+                                                 compressionLevel_);
   }
   return *codec_;
 }
 
+void ZstdStreamCompressor::releaseCodec() {
+  if (pooled_ && codec_) {
+    CompressionContextPool::get().releaseZstdCodec(std::move(codec_),
+                                                   compressionLevel_);
+  }
+  codec_.reset();
+}
+
 std::unique_ptr<folly::IOBuf> ZstdStreamCompressor::compress(
     const folly::IOBuf* in, bool last) {
   if (error_) {
@@ -38,6 +71,10 @@ std::unique_ptr<folly::IOBuf> ZstdStreamCompressor::compress(
     return nullptr;
   }
 
+  if (dictionary_) {
+    return compressWithDictionary(in, last);
+  }
+
   try {
     folly::IOBuf clone;
     if (in->isChained()) {
@@ -71,7 +108,7 @@ std::unique_ptr<folly::IOBuf> ZstdStreamCompressor::compress(
     out->append(outrange.begin() - out->tail());
 
     if (op == folly::io::StreamCodec::FlushOp::END) {
-      codec_.reset();
+      releaseCodec();
     }
 
     return out;
@@ -81,4 +118,59 @@ std::unique_ptr<folly::IOBuf> ZstdStreamCompressor::compress(
   return {};
 }
 
+std::unique_ptr<folly::IOBuf> ZstdStreamCompressor::compressWithDictionary(
+    const folly::IOBuf* in, bool last) {
+  if (!cctx_) {
+    cctx_ = pooled_ ? CompressionContextPool::get().acquireZstdCCtx()
+                    : CompressionContextPool::ZstdCCtxPtr(ZSTD_createCCtx());
+    if (!cctx_ || ZSTD_isError(ZSTD_CCtx_refCDict(
+                      cctx_.get(), dictionary_->getCDict()))) {
+      error_ = true;
+      return nullptr;
+    }
+  }
+
+  const size_t outBufAllocSize = ZSTD_CStreamOutSize();
+  folly::IOBufQueue out(folly::IOBufQueue::cacheChainLength());
+  if (messageStart_ && dczFraming_) {
+    out.append(dictionary_->getDczHeader());
+  }
+  messageStart_ = last;
+
+  auto op = last || independent_ ? ZSTD_e_end : ZSTD_e_flush;
+  auto compressRange = [&](folly::ByteRange range, ZSTD_EndDirective mode) {
+    ZSTD_inBuffer ibuf = {range.data(), range.size(), 0};
+    size_t remaining;
+    do {
+      auto buf = out.preallocate(outBufAllocSize, outBufAllocSize);
+      ZSTD_outBuffer obuf = {buf.first, buf.second, 0};
+      remaining = ZSTD_compressStream2(cctx_.get(), &obuf, &ibuf, mode);
+      if (ZSTD_isError(remaining)) {
+        return false;
+      }
+      out.postallocate(obuf.pos);
+      // Until the input is consumed, and flushed unless continuing
+    } while (ibuf.pos < ibuf.size ||
+             (mode != ZSTD_e_continue && remaining > 0));
+    return true;
+  };
+
+  // Only the last range ends the frame or flushes
+  std::vector<folly::ByteRange> ranges(in->begin(), in->end());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    auto mode = i + 1 < ranges.size() ? ZSTD_e_continue : op;
+    if (!compressRange(ranges[i], mode)) {
+      error_ = true;
+      return nullptr;
+    }
+  }
+  if (ranges.empty() && !compressRange(folly::ByteRange(), op)) {
+    error_ = true;
+    return nullptr;
+  }
+
+  auto result = out.move();
+  return result ? std::move(result) : folly::IOBuf::create(0);
+}
+
 } // namespace proxygen
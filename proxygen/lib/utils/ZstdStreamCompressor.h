@@ -11,7 +11,9 @@
 #include <memory>
 
 #include <folly/compression/Compression.h>
+#include <proxygen/lib/utils/CompressionContextPool.h>
 #include <proxygen/lib/utils/StreamCompressor.h>
+#include <proxygen/lib/utils/ZstdDictionary.h>
 
 namespace folly {
 class IOBuf;
@@ -39,11 +41,25 @@ class ZstdStreamCompressor : public StreamCompressor {
    * frame. This means they can't take advantage of previous chunks, so you
    * will get a worse compression ratio. However, no state needs to be stored
    * between chunks, so there's no memory footprint cost.
+   *
+   * With pooled, the zstd contexts come from the CompressionContextPool of
+   * the thread and go back to it when done with.
    */
   explicit ZstdStreamCompressor(int compressionLevel,
-                                bool independentChunks = false);
+                                bool independentChunks = false,
+                                bool pooled = false);
 
-  virtual ~ZstdStreamCompressor() override = default;
+  /**
+   * Compresses with a dictionary, at the level it was digested for rather
+   * than compressionLevel. With dczFraming every message starts with the
+   * dcz header naming the dictionary, as the "dcz" content coding requires.
+   */
+  ZstdStreamCompressor(std::shared_ptr<const ZstdDictionary> dictionary,
+                       bool independentChunks,
+                       bool dczFraming,
+                       bool pooled = false);
+
+  virtual ~ZstdStreamCompressor() override;
 
   virtual std::unique_ptr<folly::IOBuf> compress(const folly::IOBuf*,
                                                  bool last = true) override;
@@ -54,10 +70,21 @@ class ZstdStreamCompressor : public StreamCompressor {
 
  private:
   folly::io::StreamCodec& getCodec();
+  void releaseCodec();
+  // folly's StreamCodec has no dictionary support
+  std::unique_ptr<folly::IOBuf> compressWithDictionary(const folly::IOBuf* in,
+                                                       bool last);
 
   std::unique_ptr<folly::io::StreamCodec> codec_;
   const int compressionLevel_;
   const bool independent_;
   bool error_ = false;
+  const bool pooled_{false};
+
+  const std::shared_ptr<const ZstdDictionary> dictionary_;
+  const bool dczFraming_{false};
+  CompressionContextPool::ZstdCCtxPtr cctx_;
+  // No output yet for the current message
+  bool messageStart_{true};
 };
 } // namespace proxygen
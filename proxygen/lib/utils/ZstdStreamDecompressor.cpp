@@ -8,25 +8,98 @@
 
 #include <proxygen/lib/utils/ZstdStreamDecompressor.h>
 
+#include <limits>
+
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/IOBufQueue.h>
 
 namespace proxygen {
 
-void ZstdStreamDecompressor::freeDCtx(ZSTD_DCtx* dctx) {
-  ZSTD_freeDCtx(dctx);
+namespace {
+
+CompressionContextPool::ZstdDCtxPtr createDCtx(bool pooled) {
+  return pooled ? CompressionContextPool::get().acquireZstdDCtx()
+                : CompressionContextPool::ZstdDCtxPtr(ZSTD_createDCtx());
 }
 
-ZstdStreamDecompressor::ZstdStreamDecompressor(bool reuseOutBuf)
+} // namespace
+
+ZstdStreamDecompressor::ZstdStreamDecompressor(bool reuseOutBuf, bool pooled)
     : status_(ZstdStatusType::NONE),
-      dctx_(ZSTD_createDCtx()),
+      pooled_(pooled),
+      dctx_(createDCtx(pooled)),
       cachedIOBuf_(nullptr),
       reuseOutBuf_(reuseOutBuf) {
 }
 
+ZstdStreamDecompressor::ZstdStreamDecompressor(
+    std::shared_ptr<const ZstdDictionaryStore> dictionaries,
+    bool dczFraming,
+    bool reuseOutBuf,
+    bool pooled)
+    : status_(ZstdStatusType::NONE),
+      pooled_(pooled),
+      dctx_(createDCtx(pooled)),
+      cachedIOBuf_(nullptr),
+      reuseOutBuf_(reuseOutBuf),
+      dictionaries_(std::move(dictionaries)),
+      dczFraming_(dczFraming) {
+  if (!dctx_ || !dictionaries_ || dczFraming_) {
+    return;
+  }
+  auto ret = ZSTD_DCtx_setParameter(
+      dctx_.get(), ZSTD_d_refMultipleDDicts, ZSTD_rmd_refMultipleDDicts);
+  for (const auto& dictionary : dictionaries_->getDictionaries()) {
+    if (ZSTD_isError(ret)) {
+      break;
+    }
+    if (dictionary->getId() != 0) {
+      ret = ZSTD_DCtx_refDDict(dctx_.get(), dictionary->getDDict());
+    }
+  }
+  if (ZSTD_isError(ret)) {
+    status_ = ZstdStatusType::ERROR;
+  }
+}
+
+ZstdStreamDecompressor::~ZstdStreamDecompressor() {
+  if (pooled_ && dctx_) {
+    // Resetting it drops the dictionaries before dictionaries_ goes
+    CompressionContextPool::get().releaseZstdDCtx(std::move(dctx_));
+  }
+}
+
+bool ZstdStreamDecompressor::readDczHeader(folly::ByteRange& range) {
+  auto needed = ZstdDictionary::kDczHeaderSize - dczHeader_.size();
+  auto len = std::min(needed, range.size());
+  dczHeader_.append(reinterpret_cast<const char*>(range.data()), len);
+  range.advance(len);
+  if (dczHeader_.size() < ZstdDictionary::kDczHeaderSize) {
+    return true;
+  }
+
+  auto header = folly::ByteRange(folly::StringPiece(dczHeader_));
+  if (header.subpiece(0, ZstdDictionary::kDczMagic.size()) !=
+      folly::ByteRange(ZstdDictionary::kDczMagic.data(),
+                       ZstdDictionary::kDczMagic.size())) {
+    return false;
+  }
+  auto dictionary = dictionaries_
+                        ? dictionaries_->findByHash(header.subpiece(
+                              ZstdDictionary::kDczMagic.size()))
+                        : nullptr;
+  return dictionary && !ZSTD_isError(ZSTD_DCtx_refDDict(
+                           dctx_.get(), dictionary->getDDict()));
+}
+
 std::unique_ptr<folly::IOBuf> ZstdStreamDecompressor::decompress(
     const folly::IOBuf* in) {
+  return decompressAtMost(in, std::numeric_limits<uint64_t>::max());
+}
+
+std::unique_ptr<folly::IOBuf> ZstdStreamDecompressor::decompressAtMost(
+    const folly::IOBuf* in, uint64_t maxOutput) {
   if (!dctx_) {
     status_ = ZstdStatusType::ERROR;
   }
@@ -41,18 +114,34 @@ std::unique_ptr<folly::IOBuf> ZstdStreamDecompressor::decompress(
                  : folly::IOBuf::create(outBufAllocSize);
   auto appender = folly::io::Appender(out.get(), outBufAllocSize);
 
-  for (const folly::ByteRange& range : *in) {
+  uint64_t outLen = 0;
+  for (folly::ByteRange range : *in) {
+    if (outLen >= maxOutput) {
+      break;
+    }
     if (range.data() == nullptr) {
       continue;
     }
+    if (dczFraming_ && dczHeader_.size() < ZstdDictionary::kDczHeaderSize) {
+      if (!readDczHeader(range)) {
+        status_ = ZstdStatusType::ERROR;
+        return nullptr;
+      }
+      if (range.empty()) {
+        continue;
+      }
+    }
 
     ZSTD_inBuffer ibuf = {range.data(), range.size(), 0};
-    while (ibuf.pos < ibuf.size) {
+    while (ibuf.pos < ibuf.size && outLen < maxOutput) {
       status_ = ZstdStatusType::CONTINUE;
       appender.ensure(outBufAllocSize);
       DCHECK_GT(appender.length(), 0);
 
-      ZSTD_outBuffer obuf = {appender.writableData(), appender.length(), 0};
+      ZSTD_outBuffer obuf = {
+          appender.writableData(),
+          std::min<uint64_t>(appender.length(), maxOutput - outLen),
+          0};
       auto ret = ZSTD_decompressStream(dctx_.get(), &obuf, &ibuf);
       if (ZSTD_isError(ret)) {
         status_ = ZstdStatusType::ERROR;
@@ -62,6 +151,7 @@ std::unique_ptr<folly::IOBuf> ZstdStreamDecompressor::decompress(
       }
 
       appender.append(obuf.pos);
+      outLen += obuf.pos;
     }
   }
 
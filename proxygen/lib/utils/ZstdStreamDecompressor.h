@@ -22,16 +22,37 @@
 
 #include <folly/Memory.h>
 
+#include <proxygen/lib/utils/CompressionContextPool.h>
 #include <proxygen/lib/utils/StreamDecompressor.h>
+#include <proxygen/lib/utils/ZstdDictionary.h>
 
 namespace proxygen {
 
 class ZstdStreamDecompressor : public StreamDecompressor {
  public:
-  explicit ZstdStreamDecompressor(bool reuseOutBuf = false);
+  // With pooled, the context comes from the CompressionContextPool of the
+  // thread and goes back to it on destruction
+  explicit ZstdStreamDecompressor(bool reuseOutBuf = false,
+                                  bool pooled = false);
+
+  ~ZstdStreamDecompressor() override;
+
+  /**
+   * Decompresses frames compressed with any of the dictionaries, which zstd
+   * picks by the ID in the frame header. With dczFraming the stream starts
+   * with the dcz header instead, and the dictionary is picked by its hash,
+   * which also works for raw content dictionaries.
+   */
+  ZstdStreamDecompressor(
+      std::shared_ptr<const ZstdDictionaryStore> dictionaries,
+      bool dczFraming,
+      bool reuseOutBuf = false,
+      bool pooled = false);
 
   // May return nullptr on error / no output.
   std::unique_ptr<folly::IOBuf> decompress(const folly::IOBuf* in) override;
+  std::unique_ptr<folly::IOBuf> decompressAtMost(const folly::IOBuf* in,
+                                                 uint64_t maxOutput) override;
 
   bool hasError() override {
     return status_ == ZstdStatusType::ERROR;
@@ -46,19 +67,25 @@ class ZstdStreamDecompressor : public StreamDecompressor {
   }
 
  private:
-  static void freeDCtx(ZSTD_DCtx* dctx);
+  // Consumes the dcz header from the front of range, false on error
+  bool readDczHeader(folly::ByteRange& range);
 
   enum class ZstdStatusType : int { NONE, CONTINUE, ERROR, FINISHED };
 
   ZstdStatusType status_;
 
-  const std::unique_ptr<ZSTD_DCtx,
-                        folly::static_function_deleter<ZSTD_DCtx, freeDCtx>>
-      dctx_;
+  const bool pooled_{false};
+
+  CompressionContextPool::ZstdDCtxPtr dctx_;
 
   std::unique_ptr<folly::IOBuf> cachedIOBuf_; // For reuse when output is
                                               // 0-sized
 
   bool reuseOutBuf_; // Controls whether we may reuse the decompress outBuf
+
+  // Kept alive for the digested dictionaries dctx_ references
+  const std::shared_ptr<const ZstdDictionaryStore> dictionaries_;
+  const bool dczFraming_{false};
+  std::string dczHeader_;
 };
 } // namespace proxygen
@@ -149,6 +149,11 @@ def gen_cpp_header(items, class_name, install_dir, output_scope):
             outf.write("    %s,\n" % item[0])
         outf.write("};\n\n")
 
+        # the number of values, to index arrays by the enum
+        outf.write(
+            "constexpr std::size_t kNum%ss = %d;\n\n" % (class_name, len(items))
+        )
+
         # enum to string convert function
         outf.write(
             "extern const std::string& get%sString(%s);\n" % (class_name, class_name)
@@ -61,6 +61,25 @@ class %%name%% {
    */
 $$$$$
 
+  // Names tables are sized for every possible code so that runtime
+  // extensions (see registerExtension) can be appended after num_codes.
+  constexpr static uint64_t kMaxCodes = 256;
+
+  // Assign a code in [num_codes, kMaxCodes) to a name not in the generated
+  // set, so that hash(), getPointerToName() and getCodeFromTableName() treat
+  // it like any generated code.  Returns the existing code for names that are
+  // already known.  Registration is intended for startup: it is not
+  // thread-safe, and registered names only become visible to hash() after
+  // freezeExtensions(), past which lookups are lock-free and the set is
+  // immutable.
+  FB_EXPORT static %%name_enum%% registerExtension(const std::string& name);
+  FB_EXPORT static void freezeExtensions();
+
+  // Whether code is a runtime extension rather than a generated code
+  inline static bool isExtension(%%name_enum%% code) {
+    return code >= num_codes;
+  }
+
   static const std::string* getPointerToTable(
     %%table_type_name%% type);
 
@@ -85,7 +104,7 @@ $$$$$
       return %%enum_prefix%%_NONE;
     } else {
       auto diff = headerName - getPointerToTable(type);
-      if (diff >= %%name_enum%%CommonOffset && diff < (long)num_codes) {
+      if (diff >= %%name_enum%%CommonOffset && diff < (long)kMaxCodes) {
         return static_cast<%%name_enum%%>(diff);
       } else {
         return %%enum_prefix%%_OTHER;
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/AdaptiveCompressionLevel.h>
+
+using namespace proxygen;
+
+class AdaptiveCompressionLevelTest : public testing::Test {
+ protected:
+  AdaptiveCompressionLevel::Options getOptions() {
+    AdaptiveCompressionLevel::Options options;
+    options.adjustInterval = std::chrono::milliseconds(0);
+    return options;
+  }
+
+  double load_{0};
+  AdaptiveCompressionLevel::LoadFn loadFn_{[this] { return load_; }};
+};
+
+TEST_F(AdaptiveCompressionLevelTest, LevelsFollowLoad) {
+  AdaptiveCompressionLevel adaptive(getOptions(), loadFn_);
+  EXPECT_EQ(adaptive.getZlibLevel(7), 7);
+  EXPECT_EQ(adaptive.getZlibLevel(-1), -1);
+
+  // Each sample moves one step, down to the minimum levels
+  load_ = 0.9;
+  EXPECT_EQ(adaptive.getZlibLevel(7), 5);
+  EXPECT_EQ(adaptive.getPressure(), 1);
+  EXPECT_EQ(adaptive.getZlibLevel(7), 3);
+  EXPECT_EQ(adaptive.getZlibLevel(7), 1);
+  EXPECT_EQ(adaptive.getZstdLevel(8), 1);
+  EXPECT_EQ(adaptive.getBrotliQuality(5), 1);
+  EXPECT_EQ(adaptive.getPressure(), 3);
+
+  // The hysteresis band holds the pressure
+  load_ = 0.7;
+  adaptive.update();
+  EXPECT_EQ(adaptive.getPressure(), 3);
+
+  load_ = 0.1;
+  EXPECT_EQ(adaptive.getZlibLevel(7), 3);
+  EXPECT_EQ(adaptive.getZlibLevel(7), 5);
+  EXPECT_EQ(adaptive.getZlibLevel(-1), -1);
+
+  auto stats = adaptive.getStats();
+  EXPECT_EQ(stats.increases, 3);
+  EXPECT_EQ(stats.decreases, 3);
+  EXPECT_EQ(stats.pressure, 0);
+}
+
+TEST_F(AdaptiveCompressionLevelTest, AdjustInterval) {
+  auto options = getOptions();
+  options.adjustInterval = std::chrono::hours(1);
+  AdaptiveCompressionLevel adaptive(options, loadFn_);
+  load_ = 0.9;
+  // The first call samples, the next ones wait for the interval
+  EXPECT_EQ(adaptive.getZstdLevel(10), 7);
+  EXPECT_EQ(adaptive.getZstdLevel(10), 7);
+  EXPECT_EQ(adaptive.getPressure(), 1);
+}
+
+TEST_F(AdaptiveCompressionLevelTest, SkipLargeBodies) {
+  auto options = getOptions();
+  options.skipBodyBytes = 1000;
+  AdaptiveCompressionLevel adaptive(options, loadFn_);
+  load_ = 0.99;
+  EXPECT_FALSE(adaptive.shouldSkip(5000));
+  EXPECT_FALSE(adaptive.shouldSkip(5000));
+  // At full pressure
+  EXPECT_TRUE(adaptive.shouldSkip(5000));
+  EXPECT_FALSE(adaptive.shouldSkip(500));
+  load_ = 0.9;
+  EXPECT_FALSE(adaptive.shouldSkip(5000));
+  EXPECT_EQ(adaptive.getStats().skipped, 1);
+}
+
+TEST_F(AdaptiveCompressionLevelTest, ResponseStats) {
+  AdaptiveCompressionLevel adaptive(getOptions(), loadFn_);
+  adaptive.recordResponse("gzip", 6);
+  adaptive.recordResponse("gzip", 6);
+  adaptive.recordResponse("gzip", 1);
+  adaptive.recordResponse("zstd", -5);
+  adaptive.recordResponse("identity", 0);
+  auto stats = adaptive.getStats();
+  EXPECT_EQ(stats.responses.size(), 2);
+  EXPECT_EQ(stats.responses["gzip"][6], 2);
+  EXPECT_EQ(stats.responses["gzip"][1], 1);
+  EXPECT_EQ(stats.responses["zstd"][-5], 1);
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/AdaptiveStreamLimit.h>
+
+using namespace proxygen;
+
+TEST(AdaptiveStreamLimitTest, LimitFollowsLoad) {
+  double load = 0;
+  AdaptiveStreamLimit limit({}, [&load] { return load; });
+  EXPECT_FALSE(limit.update());
+  EXPECT_EQ(limit.getLimit(100), 100);
+
+  // Each sample moves one step, down to minStreams
+  load = 0.9;
+  EXPECT_TRUE(limit.update());
+  EXPECT_EQ(limit.getLimit(100), 77);
+  EXPECT_TRUE(limit.update());
+  EXPECT_TRUE(limit.update());
+  EXPECT_TRUE(limit.update());
+  EXPECT_EQ(limit.getLimit(100), 10);
+  EXPECT_FALSE(limit.update());
+  // Never raised
+  EXPECT_EQ(limit.getLimit(5), 5);
+
+  // The hysteresis band holds the pressure
+  load = 0.7;
+  EXPECT_FALSE(limit.update());
+  EXPECT_EQ(limit.getPressure(), 4);
+
+  load = 0.1;
+  EXPECT_TRUE(limit.update());
+  EXPECT_EQ(limit.getLimit(100), 32);
+
+  auto stats = limit.getStats();
+  EXPECT_EQ(stats.increases, 4);
+  EXPECT_EQ(stats.decreases, 1);
+  EXPECT_EQ(stats.pressure, 3);
+  EXPECT_DOUBLE_EQ(stats.load, 0.1);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/AtomicWeakRefCountedPtr.h>
+
+#include <folly/portability/GTest.h>
+#include <thread>
+#include <vector>
+
+namespace proxygen { namespace test {
+
+class TestTarget : public EnableAtomicWeakRefCountedPtr<TestTarget> {
+ public:
+  explicit TestTarget(folly::EventBase* evb)
+      : EnableAtomicWeakRefCountedPtr<TestTarget>(evb) {
+  }
+
+  void onAtomicWeakRefsUnlocked() override {
+    unlocked++;
+    expired = tryExpireAtomicWeakRefs();
+  }
+
+  uint32_t unlocked{0};
+  uint32_t ran{0};
+  bool expired{false};
+};
+
+TEST(AtomicWeakRefCountedPtrTest, LockAndExpire) {
+  folly::EventBase evb;
+  auto target = std::make_unique<TestTarget>(&evb);
+  auto weak = target->getAtomicWeakRefCountedPtr();
+  {
+    auto locked = weak.lock();
+    ASSERT_TRUE(locked);
+    EXPECT_EQ(locked.get(), target.get());
+    EXPECT_EQ(target->numAtomicWeakRefsLocked(), 1);
+  }
+  EXPECT_EQ(target->numAtomicWeakRefsLocked(), 0);
+  EXPECT_TRUE(target->tryExpireAtomicWeakRefs());
+  EXPECT_TRUE(weak.expired());
+  EXPECT_FALSE(weak.lock());
+  EXPECT_EQ(target->unlocked, 0);
+  target.reset();
+  // The pointer outlives the target
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST(AtomicWeakRefCountedPtrTest, DelayedDestruction) {
+  folly::EventBase evb;
+  auto target = std::make_unique<TestTarget>(&evb);
+  auto weak = target->getAtomicWeakRefCountedPtr();
+  auto locked = weak.lock();
+  EXPECT_FALSE(target->tryExpireAtomicWeakRefs());
+  EXPECT_FALSE(weak.expired());
+
+  // Released on another thread; the target is told on its own
+  std::thread([locked = std::move(locked)]() mutable { locked.reset(); })
+      .join();
+  EXPECT_EQ(target->unlocked, 0);
+  evb.loop();
+  EXPECT_EQ(target->unlocked, 1);
+  EXPECT_TRUE(target->expired);
+  EXPECT_TRUE(weak.expired());
+}
+
+TEST(AtomicWeakRefCountedPtrTest, ConcurrentLockers) {
+  folly::EventBase evb;
+  auto target = std::make_unique<TestTarget>(&evb);
+  auto weak = target->getAtomicWeakRefCountedPtr();
+  std::vector<std::thread> threads;
+  for (auto i = 0; i < 4; i++) {
+    threads.emplace_back([weak] {
+      for (auto j = 0; j < 10000; j++) {
+        auto locked = weak.lock();
+        EXPECT_TRUE(locked);
+      }
+      EXPECT_TRUE(weak.runInEventBaseThread([](TestTarget& t) { t.ran++; }));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // Those queued keep the target locked until they have run
+  EXPECT_FALSE(target->tryExpireAtomicWeakRefs());
+  evb.loop();
+  EXPECT_EQ(target->ran, 4);
+  EXPECT_EQ(target->unlocked, 1);
+  EXPECT_TRUE(target->expired);
+  EXPECT_FALSE(weak.runInEventBaseThread([](TestTarget& t) { t.ran++; }));
+}
+
+}} // namespace proxygen::test
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/BrotliStreamCompressor.h>
+#include <proxygen/lib/utils/BrotliStreamDecompressor.h>
+
+using namespace folly;
+using namespace proxygen;
+using namespace std;
+
+namespace {
+
+std::unique_ptr<folly::IOBuf> makeBuf(uint32_t size) {
+  auto out = folly::IOBuf::create(size);
+  out->append(size);
+  // fill with random junk
+  folly::io::RWPrivateCursor cursor(out.get());
+  while (cursor.length() >= 8) {
+    cursor.write<uint64_t>(folly::Random::rand64());
+  }
+  while (cursor.length()) {
+    cursor.write<uint8_t>((uint8_t)folly::Random::rand32());
+  }
+  return out;
+}
+
+std::unique_ptr<folly::IOBuf> makeText(uint32_t size) {
+  std::string text;
+  while (text.size() < size) {
+    text += folly::to<std::string>("<p>line ", text.size() % 97, "</p>\n");
+  }
+  text.resize(size);
+  return folly::IOBuf::copyBuffer(text);
+}
+
+void verify(const IOBuf& original, const IOBuf& compressed) {
+  BrotliStreamDecompressor decompressor;
+  auto decompressed = decompressor.decompress(&compressed);
+  ASSERT_FALSE(decompressor.hasError());
+  EXPECT_TRUE(decompressor.finished());
+  ASSERT_TRUE(decompressed);
+  IOBufEqualTo eq;
+  EXPECT_TRUE(eq(original, *decompressed));
+}
+
+} // anonymous namespace
+
+TEST(BrotliTests, CompressDecompress) {
+  for (auto size : {0, 1, 1000, 100000}) {
+    auto buf = makeBuf(size);
+    BrotliStreamCompressor compressor(5, 22);
+    auto compressed = compressor.compress(buf.get(), true);
+    ASSERT_FALSE(compressor.hasError());
+    ASSERT_NO_FATAL_FAILURE(verify(*buf, *compressed));
+  }
+}
+
+TEST(BrotliTests, CompressText) {
+  auto buf = makeText(100000);
+  BrotliStreamCompressor compressor(5, 22);
+  auto compressed = compressor.compress(buf.get(), true);
+  ASSERT_FALSE(compressor.hasError());
+  EXPECT_LT(compressed->computeChainDataLength(), 10000);
+  ASSERT_NO_FATAL_FAILURE(verify(*buf, *compressed));
+}
+
+TEST(BrotliTests, StreamChunks) {
+  BrotliStreamCompressor compressor(5, 22);
+  BrotliStreamDecompressor decompressor;
+  folly::IOBufQueue original(folly::IOBufQueue::cacheChainLength());
+  folly::IOBufQueue decompressed(folly::IOBufQueue::cacheChainLength());
+  for (int i = 0; i < 10; ++i) {
+    auto chunk = makeText(1000 + i);
+    original.append(chunk->clone());
+    // Every chunk is flushed, so it decompresses on its own
+    auto compressed = compressor.compress(chunk.get(), false);
+    ASSERT_FALSE(compressor.hasError());
+    auto out = decompressor.decompress(compressed.get());
+    ASSERT_FALSE(decompressor.hasError());
+    EXPECT_EQ(out->computeChainDataLength(), chunk->length());
+    decompressed.append(std::move(out));
+  }
+  folly::IOBuf empty;
+  auto trailer = compressor.compress(&empty, true);
+  ASSERT_FALSE(compressor.hasError());
+  decompressed.append(decompressor.decompress(trailer.get()));
+  EXPECT_TRUE(decompressor.finished());
+
+  IOBufEqualTo eq;
+  EXPECT_TRUE(eq(*original.move(), *decompressed.move()));
+}
+
+TEST(BrotliTests, ChainedInput) {
+  auto buf = makeText(3000);
+  buf->appendToChain(makeBuf(2000));
+  buf->appendToChain(makeText(1000));
+  BrotliStreamCompressor compressor(5, 22);
+  auto compressed = compressor.compress(buf.get(), true);
+  ASSERT_FALSE(compressor.hasError());
+  ASSERT_NO_FATAL_FAILURE(verify(*buf, *compressed));
+}
+
+TEST(BrotliTests, CorruptInput) {
+  BrotliStreamDecompressor decompressor;
+  auto garbage = folly::IOBuf::copyBuffer("definitely not brotli");
+  decompressor.decompress(garbage.get());
+  EXPECT_TRUE(decompressor.hasError());
+}
+
+TEST(BrotliTests, DecompressAtMost) {
+  auto buf = makeText(1024 * 1024);
+  BrotliStreamCompressor compressor(5, 22);
+  auto compressed = compressor.compress(buf.get(), true);
+  ASSERT_FALSE(compressor.hasError());
+
+  BrotliStreamDecompressor decompressor;
+  auto decompressed = decompressor.decompressAtMost(compressed.get(), 5000);
+  ASSERT_FALSE(decompressor.hasError());
+  EXPECT_EQ(decompressed->computeChainDataLength(), 5000);
+}
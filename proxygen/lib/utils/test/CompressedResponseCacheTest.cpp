@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Conv.h>
+#include <folly/io/IOBuf.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/CompressedResponseCache.h>
+
+using namespace proxygen;
+
+namespace {
+
+std::string toString(const folly::IOBuf& buf) {
+  return buf.cloneCoalescedAsValue().moveToFbString().toStdString();
+}
+
+CompressedResponseCache::Options makeOptions(size_t maxBytes) {
+  CompressedResponseCache::Options options;
+  options.maxBytes = maxBytes;
+  options.numShards = 1;
+  return options;
+}
+
+} // namespace
+
+TEST(CompressedResponseCacheTest, HitsAndMisses) {
+  CompressedResponseCache cache(makeOptions(1024));
+  auto key = CompressedResponseCache::makeKey("/app.js \"v1\"", "gzip", 4);
+  EXPECT_EQ(cache.get(key), nullptr);
+
+  auto compressed = folly::IOBuf::copyBuffer("compressed");
+  compressed->appendToChain(folly::IOBuf::copyBuffer(" body"));
+  cache.put(key, *compressed);
+
+  auto cached = cache.get(key);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_EQ(toString(*cached), "compressed body");
+  // The level and coding are part of the key
+  EXPECT_EQ(cache.get(CompressedResponseCache::makeKey(
+                "/app.js \"v1\"", "gzip", 6)),
+            nullptr);
+  EXPECT_EQ(cache.get(CompressedResponseCache::makeKey(
+                "/app.js \"v1\"", "zstd", 4)),
+            nullptr);
+
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 3);
+  EXPECT_EQ(stats.insertions, 1);
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_EQ(stats.bytes, 15);
+}
+
+TEST(CompressedResponseCacheTest, DigestKeys) {
+  auto body = folly::IOBuf::copyBuffer("hello world");
+  auto chained = folly::IOBuf::copyBuffer("hello ");
+  chained->appendToChain(folly::IOBuf::copyBuffer("world"));
+  EXPECT_EQ(CompressedResponseCache::makeDigestKey(*body, "gzip", 4),
+            CompressedResponseCache::makeDigestKey(*chained, "gzip", 4));
+  auto other = folly::IOBuf::copyBuffer("hello World");
+  EXPECT_NE(CompressedResponseCache::makeDigestKey(*body, "gzip", 4),
+            CompressedResponseCache::makeDigestKey(*other, "gzip", 4));
+}
+
+TEST(CompressedResponseCacheTest, EvictsByBytes) {
+  CompressedResponseCache cache(makeOptions(100));
+  std::string value(40, 'x');
+  for (int i = 0; i < 3; ++i) {
+    cache.put(folly::to<std::string>("key", i),
+              *folly::IOBuf::copyBuffer(value));
+  }
+  // The oldest one made room for the third
+  EXPECT_EQ(cache.get("key0"), nullptr);
+  EXPECT_NE(cache.get("key1"), nullptr);
+  EXPECT_NE(cache.get("key2"), nullptr);
+
+  // key1 was used more recently than key2
+  cache.get("key1");
+  cache.put("key3", *folly::IOBuf::copyBuffer(value));
+  EXPECT_EQ(cache.get("key2"), nullptr);
+  EXPECT_NE(cache.get("key1"), nullptr);
+
+  // Too big for the cache
+  cache.put("key4", *folly::IOBuf::copyBuffer(std::string(101, 'x')));
+  EXPECT_EQ(cache.get("key4"), nullptr);
+
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.evictions, 2);
+  EXPECT_EQ(stats.entries, 2);
+  EXPECT_LE(stats.bytes, 100);
+
+  cache.clear();
+  EXPECT_EQ(cache.getStats().bytes, 0);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <iostream>
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/io/IOBuf.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/utils/CompressionContextPool.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+#include <proxygen/lib/utils/ZstdStreamCompressor.h>
+#include <proxygen/lib/utils/ZstdStreamDecompressor.h>
+
+using namespace proxygen;
+
+namespace {
+
+// A small API response, where setting up the context dominates
+std::unique_ptr<folly::IOBuf> makeBody() {
+  std::string body;
+  for (int i = 0; i < 20; ++i) {
+    body += folly::to<std::string>(R"({"id":)", i, R"(,"name":"item"},)");
+  }
+  return folly::IOBuf::copyBuffer(body);
+}
+
+void zlibResponses(size_t iters, bool pooled) {
+  std::unique_ptr<folly::IOBuf> body;
+  BENCHMARK_SUSPEND {
+    body = makeBody();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    ZlibStreamCompressor compressor(CompressionType::GZIP, 4, pooled);
+    folly::doNotOptimizeAway(compressor.compress(body.get()));
+  }
+}
+
+void zlibRoundTrips(size_t iters, bool pooled) {
+  std::unique_ptr<folly::IOBuf> compressed;
+  BENCHMARK_SUSPEND {
+    ZlibStreamCompressor compressor(CompressionType::GZIP, 4);
+    compressed = compressor.compress(makeBody().get());
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    ZlibStreamDecompressor decompressor(CompressionType::GZIP,
+                                        kZlibDecompressorBufferGrowthDefault,
+                                        kZlibDecompressorBufferMinsizeDefault,
+                                        pooled);
+    folly::doNotOptimizeAway(decompressor.decompress(compressed.get()));
+  }
+}
+
+void zstdResponses(size_t iters, bool pooled) {
+  std::unique_ptr<folly::IOBuf> body;
+  BENCHMARK_SUSPEND {
+    body = makeBody();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    ZstdStreamCompressor compressor(8, false, pooled);
+    folly::doNotOptimizeAway(compressor.compress(body.get()));
+  }
+}
+
+void zstdRoundTrips(size_t iters, bool pooled) {
+  std::unique_ptr<folly::IOBuf> compressed;
+  BENCHMARK_SUSPEND {
+    ZstdStreamCompressor compressor(8);
+    compressed = compressor.compress(makeBody().get());
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    ZstdStreamDecompressor decompressor(false, pooled);
+    folly::doNotOptimizeAway(decompressor.decompress(compressed.get()));
+  }
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(zlibResponses, unpooled, false)
+BENCHMARK_RELATIVE_NAMED_PARAM(zlibResponses, pooled, true)
+BENCHMARK_NAMED_PARAM(zlibRoundTrips, unpooled, false)
+BENCHMARK_RELATIVE_NAMED_PARAM(zlibRoundTrips, pooled, true)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(zstdResponses, unpooled, false)
+BENCHMARK_RELATIVE_NAMED_PARAM(zstdResponses, pooled, true)
+BENCHMARK_NAMED_PARAM(zstdRoundTrips, unpooled, false)
+BENCHMARK_RELATIVE_NAMED_PARAM(zstdRoundTrips, pooled, true)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+
+  // Unpooled, every stream allocates its context
+  const auto& stats = CompressionContextPool::get().getStats();
+  std::cout << "Pooled streams: " << stats.acquired
+            << ", contexts allocated: " << stats.acquired - stats.reused
+            << ", reused: " << stats.reused << std::endl;
+  return 0;
+}
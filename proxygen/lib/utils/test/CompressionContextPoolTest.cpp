@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Conv.h>
+#include <folly/io/IOBuf.h>
+#include <folly/portability/GTest.h>
+#include <proxygen/lib/utils/CompressionContextPool.h>
+#include <proxygen/lib/utils/ZlibStreamCompressor.h>
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+#include <proxygen/lib/utils/ZstdStreamCompressor.h>
+#include <proxygen/lib/utils/ZstdStreamDecompressor.h>
+
+using namespace proxygen;
+
+namespace {
+
+std::unique_ptr<folly::IOBuf> makeBody(size_t n) {
+  std::string body;
+  for (size_t i = 0; i < n; ++i) {
+    body += folly::to<std::string>("line ", i % 17, " of the response\n");
+  }
+  return folly::IOBuf::copyBuffer(body);
+}
+
+} // namespace
+
+TEST(CompressionContextPoolTest, ZlibReuse) {
+  auto& pool = CompressionContextPool::get();
+  auto stats = pool.getStats();
+  for (int i = 0; i < 3; ++i) {
+    auto body = makeBody(100 + i);
+    ZlibStreamCompressor compressor(CompressionType::GZIP, 6, true);
+    // Split in two, so the stream state carries over
+    auto head = body->clone();
+    head->trimEnd(head->length() / 2);
+    auto tail = body->clone();
+    tail->trimStart(head->length());
+    auto compressed = compressor.compress(head.get(), false);
+    ASSERT_NE(compressed, nullptr);
+    compressed->prependChain(compressor.compress(tail.get(), true));
+    ASSERT_FALSE(compressor.hasError());
+
+    ZlibStreamDecompressor decompressor(
+        CompressionType::GZIP,
+        kZlibDecompressorBufferGrowthDefault,
+        kZlibDecompressorBufferMinsizeDefault,
+        true);
+    auto decompressed = decompressor.decompress(compressed.get());
+    ASSERT_TRUE(decompressor.finished());
+    EXPECT_TRUE(folly::IOBufEqualTo()(body, decompressed));
+  }
+  // One deflate and one inflate state, reused twice each
+  EXPECT_EQ(pool.getStats().acquired - stats.acquired, 6);
+  EXPECT_EQ(pool.getStats().reused - stats.reused, 4);
+  EXPECT_EQ(pool.getStats().released - stats.released, 6);
+}
+
+TEST(CompressionContextPoolTest, ZlibKeyedByLevel) {
+  auto& pool = CompressionContextPool::get();
+  auto stats = pool.getStats();
+  auto body = makeBody(10);
+  for (int level : {1, 9}) {
+    ZlibStreamCompressor compressor(CompressionType::GZIP, level, true);
+    EXPECT_NE(compressor.compress(body.get()), nullptr);
+  }
+  EXPECT_EQ(pool.getStats().reused, stats.reused);
+}
+
+TEST(CompressionContextPoolTest, ZstdReuse) {
+  auto& pool = CompressionContextPool::get();
+  auto stats = pool.getStats();
+  for (int i = 0; i < 3; ++i) {
+    auto body = makeBody(100 + i);
+    ZstdStreamCompressor compressor(3, false, true);
+    auto compressed = compressor.compress(body.get());
+    ASSERT_FALSE(compressor.hasError());
+
+    ZstdStreamDecompressor decompressor(false, true);
+    auto decompressed = decompressor.decompress(compressed.get());
+    ASSERT_FALSE(decompressor.hasError());
+    EXPECT_TRUE(decompressor.finished());
+    EXPECT_TRUE(folly::IOBufEqualTo()(body, decompressed));
+  }
+  EXPECT_EQ(pool.getStats().reused - stats.reused, 4);
+}
+
+TEST(CompressionContextPoolTest, MaxFree) {
+  CompressionContextPool pool(1);
+  auto first = pool.acquireDeflate(CompressionType::GZIP, 4);
+  auto second = pool.acquireDeflate(CompressionType::GZIP, 4);
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  pool.releaseDeflate(std::move(first), CompressionType::GZIP, 4);
+  pool.releaseDeflate(std::move(second), CompressionType::GZIP, 4);
+  EXPECT_EQ(pool.getFreeCount(), 1);
+  EXPECT_EQ(pool.getStats().released, 1);
+}
@@ -77,3 +77,17 @@ TEST(ConditionalGateDeleteTest, DeleteFromCallback) {
   ready->then([&ready] { ready.reset(); });
   ready->set();
 }
+
+TEST(ConditionalGateInlineTest, MoreThanInline) {
+  // Spills to the heap past the one inline function
+  ConditionalGate<detail::ReadyEnum, 1, 1> ready;
+  int done = 0;
+  for (int i = 0; i < 3; i++) {
+    ready.then([&done, i] {
+      EXPECT_EQ(done, i);
+      done++;
+    });
+  }
+  ready.set();
+  EXPECT_EQ(done, 3);
+}
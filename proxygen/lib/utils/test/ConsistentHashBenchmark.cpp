@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Conv.h>
+#include <folly/portability/GFlags.h>
+#include <proxygen/lib/utils/MaglevHash.h>
+#include <proxygen/lib/utils/RendezvousHash.h>
+#include <cmath>
+#include <random>
+
+using namespace proxygen;
+
+namespace {
+
+std::vector<std::pair<std::string, uint64_t>> makeNodes(size_t numNodes) {
+  std::vector<std::pair<std::string, uint64_t>> nodes;
+  for (size_t i = 0; i < numNodes; ++i) {
+    nodes.emplace_back(folly::to<std::string>("origin", i), 100 + i % 7);
+  }
+  return nodes;
+}
+
+template <typename Hash>
+void runGets(size_t iters, size_t numNodes, size_t rank) {
+  Hash hashes;
+  BENCHMARK_SUSPEND {
+    auto nodes = makeNodes(numNodes);
+    hashes.build(nodes);
+  }
+  size_t sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    sum += hashes.get(i, rank);
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+void rendezvousGet(size_t iters, size_t numNodes) {
+  runGets<RendezvousHash>(iters, numNodes, 0);
+}
+
+void maglevGet(size_t iters, size_t numNodes) {
+  runGets<MaglevHash>(iters, numNodes, 0);
+}
+
+void rendezvousGetRank2(size_t iters, size_t numNodes) {
+  runGets<RendezvousHash>(iters, numNodes, 2);
+}
+
+void maglevGetRank2(size_t iters, size_t numNodes) {
+  runGets<MaglevHash>(iters, numNodes, 2);
+}
+
+void maglevGetWithBoundedLoad(size_t iters, size_t numNodes) {
+  MaglevHash hashes;
+  std::vector<uint64_t> loads(numNodes);
+  uint64_t totalLoad = 0;
+  BENCHMARK_SUSPEND {
+    auto nodes = makeNodes(numNodes);
+    hashes.build(nodes);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    loads[hashes.getWithBoundedLoad(i, loads, totalLoad)]++;
+    totalLoad++;
+  }
+  folly::doNotOptimizeAway(totalLoad);
+}
+
+// Keys of a Zipfian distribution over numKeys keys with exponent s
+std::vector<uint64_t> makeZipfKeys(size_t count, size_t numKeys, double s) {
+  std::vector<double> weights;
+  for (size_t k = 1; k <= numKeys; ++k) {
+    weights.push_back(1 / std::pow(k, s));
+  }
+  std::discrete_distribution<uint64_t> dist(weights.begin(), weights.end());
+  std::mt19937_64 rng(42);
+  std::vector<uint64_t> keys;
+  for (size_t i = 0; i < count; ++i) {
+    keys.push_back(dist(rng));
+  }
+  return keys;
+}
+
+/**
+ * Simulates requests for Zipfian keys that each stay outstanding for the
+ * next `window` requests.  Reports the highest load a node had relative to
+ * the mean, and the percentage of requests sent to the key's get() node.
+ */
+void zipfSimulation(folly::UserCounters& counters,
+                    size_t iters,
+                    double s,
+                    bool twoChoices) {
+  constexpr size_t kNodes = 50;
+  constexpr size_t kWindow = 1000;
+  RendezvousHash hashes;
+  std::vector<uint64_t> keys;
+  BENCHMARK_SUSPEND {
+    auto nodes = makeNodes(kNodes);
+    for (auto& node : nodes) {
+      node.second = 1;
+    }
+    hashes.build(nodes);
+    keys = makeZipfKeys(std::max<size_t>(iters, kWindow), 10000, s);
+  }
+  std::vector<uint64_t> loads(kNodes);
+  std::vector<size_t> outstanding(kWindow);
+  uint64_t maxLoad = 0;
+  size_t affine = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    auto key = keys[i];
+    if (i >= kWindow) {
+      loads[outstanding[i % kWindow]]--;
+    }
+    auto node = twoChoices ? hashes.getWithTwoChoices(key, loads, i)
+                           : hashes.get(key);
+    affine += node == hashes.get(key);
+    loads[node]++;
+    outstanding[i % kWindow] = node;
+    maxLoad = std::max(maxLoad, loads[node]);
+  }
+  counters["maxLoadPerMean"] = double(maxLoad) * kNodes / kWindow;
+  counters["affinityPct"] = iters ? affine * 100.0 / iters : 0;
+}
+
+void maglevBuild(size_t iters, size_t numNodes) {
+  std::vector<std::pair<std::string, uint64_t>> nodes;
+  BENCHMARK_SUSPEND {
+    nodes = makeNodes(numNodes);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    MaglevHash hashes;
+    hashes.build(nodes);
+    folly::doNotOptimizeAway(hashes.get(i));
+  }
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(rendezvousGet, nodes_20, 20)
+BENCHMARK_RELATIVE_NAMED_PARAM(maglevGet, nodes_20, 20)
+BENCHMARK_NAMED_PARAM(rendezvousGet, nodes_2000, 2000)
+BENCHMARK_RELATIVE_NAMED_PARAM(maglevGet, nodes_2000, 2000)
+BENCHMARK_RELATIVE_NAMED_PARAM(maglevGetWithBoundedLoad, nodes_2000, 2000)
+BENCHMARK_NAMED_PARAM(rendezvousGetRank2, nodes_2000, 2000)
+BENCHMARK_RELATIVE_NAMED_PARAM(maglevGetRank2, nodes_2000, 2000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(maglevBuild, nodes_2000, 2000)
+
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  for (auto s : {0.8, 1.2}) {
+    for (auto twoChoices : {false, true}) {
+      folly::addBenchmark(
+          __FILE__,
+          folly::to<std::string>(
+              "zipfSimulation(s_", s, twoChoices ? "_two_choices)" : "_get)"),
+          [s, twoChoices](folly::UserCounters& counters, unsigned iters) {
+            zipfSimulation(counters, iters, s, twoChoices);
+            return iters;
+          });
+    }
+  }
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <array>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <folly/portability/OpenSSL.h>
+#include <openssl/buffer.h>
+#include <proxygen/lib/utils/CryptUtil.h>
+#include <string>
+
+using namespace proxygen;
+
+namespace {
+
+// A Sec-WebSocket-Accept digest, a signed cookie, a larger token
+const std::string kSha1(20, '\x5a');
+const std::string kCookie(64, '\x5a');
+const std::string kToken(1024, '\x5a');
+
+// The BIO chain base64Encode used to go through
+std::string bioBase64Encode(folly::ByteRange text) {
+  BIO* b64 = BIO_new(BIO_f_base64());
+  BIO* chain = BIO_push(b64, BIO_new(BIO_s_mem()));
+  BIO_set_flags(chain, BIO_FLAGS_BASE64_NO_NL);
+  BIO_write(chain, text.begin(), text.size());
+  CHECK_EQ(BIO_flush(chain), 1);
+  BUF_MEM* bptr;
+  BIO_get_mem_ptr(chain, &bptr);
+  std::string result(bptr->data, bptr->length);
+  BIO_free_all(chain);
+  return result;
+}
+
+void bioBench(const std::string& text, int iters) {
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(bioBase64Encode(folly::StringPiece(text)));
+  }
+}
+
+void stringBench(const std::string& text, int iters) {
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(base64Encode(folly::StringPiece(text)));
+  }
+}
+
+void bufferBench(const std::string& text, int iters) {
+  std::array<char, 2048> out;
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(base64Encode(folly::StringPiece(text), &out[0]));
+  }
+}
+
+void decodeBench(const std::string& text, int iters) {
+  std::string encoded;
+  BENCHMARK_SUSPEND {
+    encoded = base64Encode(folly::StringPiece(text));
+  }
+  std::array<uint8_t, 2048> out;
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(base64Decode(encoded, &out[0]));
+  }
+}
+
+} // namespace
+
+BENCHMARK(base64EncodeBio_20, iters) {
+  bioBench(kSha1, iters);
+}
+
+BENCHMARK_RELATIVE(base64EncodeString_20, iters) {
+  stringBench(kSha1, iters);
+}
+
+BENCHMARK_RELATIVE(base64EncodeBuffer_20, iters) {
+  bufferBench(kSha1, iters);
+}
+
+BENCHMARK(base64EncodeBio_64, iters) {
+  bioBench(kCookie, iters);
+}
+
+BENCHMARK_RELATIVE(base64EncodeString_64, iters) {
+  stringBench(kCookie, iters);
+}
+
+BENCHMARK_RELATIVE(base64EncodeBuffer_64, iters) {
+  bufferBench(kCookie, iters);
+}
+
+BENCHMARK(base64EncodeBio_1024, iters) {
+  bioBench(kToken, iters);
+}
+
+BENCHMARK_RELATIVE(base64EncodeString_1024, iters) {
+  stringBench(kToken, iters);
+}
+
+BENCHMARK_RELATIVE(base64EncodeBuffer_1024, iters) {
+  bufferBench(kToken, iters);
+}
+
+BENCHMARK(base64Decode_64, iters) {
+  decodeBench(kCookie, iters);
+}
+
+BENCHMARK(base64Decode_1024, iters) {
+  decodeBench(kToken, iters);
+}
+
+BENCHMARK(md5Encode_64, iters) {
+  for (int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(md5Encode(folly::StringPiece(kCookie)));
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -9,7 +9,9 @@
 #include <proxygen/lib/utils/CryptUtil.h>
 
 #include <folly/portability/GTest.h>
+#include <array>
 #include <string>
+#include <vector>
 
 using namespace proxygen;
 
@@ -40,3 +42,38 @@ TEST(CryptUtilTest, MD5EncodeTest) {
       md5Encode(ByteRange(
           reinterpret_cast<const unsigned char*>("Aladdin:open sesame"), 19)));
 }
+
+TEST(CryptUtilTest, Base64EncodeToBuffer) {
+  std::string text("Aladdin:open sesame");
+  std::array<char, 32> out;
+  ASSERT_LE(base64EncodedSize(text.size()), out.size());
+  EXPECT_EQ(base64EncodedSize(text.size()), 28);
+  auto end = base64Encode(folly::StringPiece(text), out.data());
+  EXPECT_EQ(std::string(out.data(), end), "QWxhZGRpbjpvcGVuIHNlc2FtZQ==");
+}
+
+TEST(CryptUtilTest, Base64Decode) {
+  for (size_t size = 0; size < 100; size++) {
+    std::string text;
+    for (size_t i = 0; i < size; i++) {
+      text.push_back(static_cast<char>(i * 37));
+    }
+    auto encoded = base64Encode(folly::StringPiece(text));
+    std::vector<uint8_t> decoded(base64DecodedSize(encoded));
+    auto length = base64Decode(encoded, decoded.data());
+    ASSERT_TRUE(length.hasValue()) << encoded;
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(decoded.data()),
+                          *length),
+              text);
+  }
+
+  std::array<uint8_t, 16> out;
+  EXPECT_FALSE(base64Decode("QWxh*GRp", out.data()).hasValue());
+}
+
+TEST(CryptUtilTest, HexEncode) {
+  const uint8_t bytes[] = {0x00, 0x0f, 0xa5, 0xff};
+  std::array<char, 8> out;
+  auto end = hexEncode(ByteRange(bytes, sizeof(bytes)), out.data());
+  EXPECT_EQ(std::string(out.data(), end), "000fa5ff");
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+#include <proxygen/lib/utils/FileBodySource.h>
+
+using namespace proxygen;
+
+class FileBodySourceTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    for (size_t i = 0; i < 10000; i++) {
+      contents_.push_back('a' + (i % 26));
+    }
+    ASSERT_TRUE(folly::writeFile(contents_, tmpFile_.path().c_str()));
+  }
+
+  folly::File openFile() {
+    return folly::File(tmpFile_.path().string());
+  }
+
+  std::string drain(FileBodySource& source, size_t chunkSize) {
+    std::string result;
+    while (auto chunk = source.next()) {
+      EXPECT_LE(chunk->length(), chunkSize);
+      EXPECT_TRUE(chunk->isShared());
+      result.append(reinterpret_cast<const char*>(chunk->data()),
+                    chunk->length());
+    }
+    EXPECT_EQ(source.remaining(), 0);
+    return result;
+  }
+
+  folly::test::TemporaryFile tmpFile_;
+  std::string contents_;
+};
+
+TEST_F(FileBodySourceTest, WholeFile) {
+  FileBodySource source(openFile(), 0, contents_.size(), 4096);
+  EXPECT_EQ(source.remaining(), contents_.size());
+  EXPECT_EQ(drain(source, 4096), contents_);
+  EXPECT_EQ(source.next(), nullptr);
+}
+
+TEST_F(FileBodySourceTest, UnalignedRange) {
+  FileBodySource source(openFile(), 4097, 3000, 1000);
+  EXPECT_EQ(drain(source, 1000), contents_.substr(4097, 3000));
+}
+
+TEST_F(FileBodySourceTest, Empty) {
+  FileBodySource source(openFile(), 0, 0);
+  EXPECT_EQ(source.remaining(), 0);
+  EXPECT_EQ(source.next(), nullptr);
+}
+
+TEST_F(FileBodySourceTest, PastEndOfFile) {
+  EXPECT_THROW(FileBodySource(openFile(), 9000, 2000), std::system_error);
+}
+
+TEST_F(FileBodySourceTest, ChunkOutlivesSource) {
+  std::unique_ptr<folly::IOBuf> chunk;
+  {
+    FileBodySource source(openFile(), 10, 20);
+    chunk = source.next();
+  }
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(chunk->data()),
+                        chunk->length()),
+            contents_.substr(10, 20));
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/FlatTraceEvent.h>
+
+#include <proxygen/lib/utils/TraceEvent.h>
+#include <proxygen/lib/utils/TraceEventContext.h>
+#include <proxygen/lib/utils/TraceEventObserver.h>
+
+#include <folly/portability/GTest.h>
+
+#include <string>
+#include <vector>
+
+using namespace proxygen;
+
+TEST(FlatTraceEventTest, Fields) {
+  TraceArena arena;
+  FlatTraceEvent event(TraceEventType::TotalRequest, arena, 7);
+  EXPECT_EQ(event.getParentID(), 7);
+  EXPECT_FALSE(event.hasTraceField(TraceFieldType::Protocol));
+
+  EXPECT_TRUE(event.addMeta(TraceFieldType::Protocol, 13));
+  std::string host("example.com");
+  EXPECT_TRUE(event.addMeta(TraceFieldType::HostName, host));
+  EXPECT_TRUE(event.addMeta(TraceFieldType::IpAddr,
+                            std::vector<std::string>{"::1", "127.0.0.1"}));
+  // Replaced
+  EXPECT_FALSE(event.addMeta(TraceFieldType::Protocol, 14));
+  EXPECT_EQ(event.size(), 3);
+
+  int64_t protocol;
+  EXPECT_TRUE(event.readIntMeta(TraceFieldType::Protocol, protocol));
+  EXPECT_EQ(protocol, 14);
+  // Copied into the arena
+  host = "changed";
+  folly::StringPiece hostName;
+  EXPECT_TRUE(event.readStrMeta(TraceFieldType::HostName, hostName));
+  EXPECT_EQ(hostName, "example.com");
+  EXPECT_FALSE(event.readIntMeta(TraceFieldType::HostName, protocol));
+  EXPECT_EQ(event.getField(TraceFieldType::IpAddr)->toString(),
+            "[\"::1\",\"127.0.0.1\"]");
+  EXPECT_EQ(event.getField(TraceFieldType::IpAddr)->getStringList().size(), 2);
+}
+
+TEST(FlatTraceEventTest, MaxFields) {
+  TraceArena arena;
+  FlatTraceEvent event(TraceEventType::TotalRequest, arena);
+  for (size_t i = 0; i < FlatTraceEvent::kMaxFields; i++) {
+    EXPECT_TRUE(event.addMeta(static_cast<TraceFieldType>(i), i));
+  }
+  auto extra = static_cast<TraceFieldType>(FlatTraceEvent::kMaxFields);
+  EXPECT_FALSE(event.addMeta(extra, 1));
+  EXPECT_FALSE(event.hasTraceField(extra));
+  EXPECT_EQ(event.size(), FlatTraceEvent::kMaxFields);
+}
+
+TEST(FlatTraceEventTest, ToTraceEvent) {
+  TraceArena arena;
+  FlatTraceEvent event(TraceEventType::TotalRequest, arena, 3);
+  auto now = getCurrentTime();
+  event.start(now);
+  event.end(now);
+  event.addMeta(TraceFieldType::Protocol, 13);
+  event.addMeta(TraceFieldType::HostName, "example.com");
+
+  auto copy = event.toTraceEvent();
+  EXPECT_EQ(copy.getID(), event.getID());
+  EXPECT_EQ(copy.getParentID(), 3);
+  EXPECT_TRUE(copy.hasStarted());
+  EXPECT_TRUE(copy.hasEnded());
+  EXPECT_EQ(copy.getStartTime(), now);
+  EXPECT_EQ(copy.getTraceFieldDataAs<int64_t>(TraceFieldType::Protocol), 13);
+  EXPECT_EQ(copy.getTraceFieldDataAs<std::string>(TraceFieldType::HostName),
+            "example.com");
+
+  // Ids are shared with TraceEvent
+  EXPECT_NE(TraceEvent(TraceEventType::TotalRequest).getID(), event.getID());
+}
+
+TEST(FlatTraceEventTest, Arena) {
+  TraceArena arena(16);
+  auto small = arena.copy("hello");
+  auto large = arena.copy(std::string(100, 'a'));
+  EXPECT_EQ(small, "hello");
+  EXPECT_EQ(large.size(), 100);
+  arena.clear();
+  auto reused = arena.copy("world");
+  EXPECT_EQ(reused, "world");
+  EXPECT_EQ(reused.data(), small.data());
+}
+
+namespace {
+
+struct TestObserver : public TraceEventObserver {
+  void traceEventAvailable(TraceEvent event) noexcept override {
+    events.push_back(std::move(event));
+  }
+
+  std::vector<TraceEvent> events;
+};
+
+struct FlatObserver : public TraceEventObserver {
+  void flatTraceEventAvailable(const FlatTraceEvent& event) noexcept override {
+    fields += event.size();
+  }
+
+  size_t fields{0};
+};
+
+} // namespace
+
+TEST(FlatTraceEventTest, Observers) {
+  TestObserver observer;
+  FlatObserver flatObserver;
+  TraceEventContext context(0, {&observer, &flatObserver});
+  FlatTraceEvent event(TraceEventType::TotalRequest, context.getArena());
+  event.addMeta(TraceFieldType::HostName, "example.com");
+  context.traceEventAvailable(event);
+
+  // Observers of TraceEvents get a copy
+  ASSERT_EQ(observer.events.size(), 1);
+  EXPECT_EQ(observer.events[0].getTraceFieldDataAs<std::string>(
+                TraceFieldType::HostName),
+            "example.com");
+  EXPECT_EQ(flatObserver.fields, 1);
+
+  // Copies of a context share its arena
+  auto copy = context;
+  EXPECT_EQ(&copy.getArena(), &context.getArena());
+}
@@ -8,8 +8,12 @@
 
 #include <proxygen/lib/utils/HTTPTime.h>
 
+#include <ctime>
+
 #include <folly/portability/GTest.h>
 
+using proxygen::formatHTTPDateTime;
+using proxygen::getCurrentHTTPDateTime;
 using proxygen::parseHTTPDateTime;
 
 TEST(HTTPTimeTests, InvalidTimeTest) {
@@ -87,3 +91,39 @@ TEST(HTTPTimeTests, TzToUnixTsTest) {
   auto o = parseHTTPDateTime("Thu, 01 Jan 1970 00:00:01");
   EXPECT_FALSE(o.has_value());
 }
+
+TEST(HTTPTimeTests, FullNamesTest) {
+  auto a = parseHTTPDateTime("Sunday, 06 November 1994 08:49:37 GMT");
+  ASSERT_TRUE(a.has_value());
+  EXPECT_EQ(a.value(), 784111777);
+  auto b = parseHTTPDateTime("sun, 06 nov 1994 08:49:37 GMT");
+  ASSERT_TRUE(b.has_value());
+  EXPECT_EQ(b.value(), 784111777);
+}
+
+TEST(HTTPTimeTests, FormatTest) {
+  EXPECT_EQ(formatHTTPDateTime(784111777), "Sun, 06 Nov 1994 08:49:37 GMT");
+  EXPECT_EQ(formatHTTPDateTime(0), "Thu, 01 Jan 1970 00:00:00 GMT");
+  EXPECT_EQ(formatHTTPDateTime(-1), "Wed, 31 Dec 1969 23:59:59 GMT");
+  EXPECT_EQ(formatHTTPDateTime(951782400), "Tue, 29 Feb 2000 00:00:00 GMT");
+  EXPECT_EQ(formatHTTPDateTime(253402300799), "Fri, 31 Dec 9999 23:59:59 GMT");
+}
+
+TEST(HTTPTimeTests, RoundTripTest) {
+  for (int64_t t = -86400; t < 4102444800; t += 86400 * 13 + 3607) {
+    auto formatted = formatHTTPDateTime(t);
+    EXPECT_EQ(formatted.size(), proxygen::kHTTPDateTimeLength);
+    auto parsed = parseHTTPDateTime(formatted);
+    ASSERT_TRUE(parsed.has_value()) << formatted;
+    EXPECT_EQ(parsed.value(), t) << formatted;
+  }
+}
+
+TEST(HTTPTimeTests, CurrentTimeTest) {
+  auto before = time(nullptr);
+  auto current = parseHTTPDateTime(getCurrentHTTPDateTime());
+  auto after = time(nullptr);
+  ASSERT_TRUE(current.has_value());
+  EXPECT_GE(current.value(), before);
+  EXPECT_LE(current.value(), after);
+}
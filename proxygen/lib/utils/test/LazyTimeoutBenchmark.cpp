@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <proxygen/lib/utils/LazyTimeout.h>
+
+#include <vector>
+
+using namespace proxygen;
+
+namespace {
+
+// Idle timeouts scheduled alongside the refreshed ones, as on a busy server
+const size_t kNumTimeouts = 10000;
+const std::chrono::milliseconds kTimeout(60000);
+
+class IdleTimeout : public folly::HHWheelTimer::Callback {
+ public:
+  void timeoutExpired() noexcept override {
+  }
+
+  LazyTimeout lazy;
+};
+
+// Refreshes every timeout iters times in total, round robin
+template <typename Refresh>
+void refreshTimeouts(size_t iters, Refresh refresh) {
+  folly::BenchmarkSuspender suspender;
+  folly::EventBase evb;
+  auto& timer = evb.timer();
+  std::vector<IdleTimeout> timeouts(kNumTimeouts);
+  for (auto& timeout : timeouts) {
+    timeout.lazy.refresh(false, kTimeout);
+    timer.scheduleTimeout(&timeout, kTimeout);
+  }
+  suspender.dismiss();
+
+  for (size_t i = 0; i < iters; i++) {
+    refresh(timer, timeouts[i % kNumTimeouts]);
+  }
+
+  suspender.rehire();
+  for (auto& timeout : timeouts) {
+    timeout.cancelTimeout();
+  }
+}
+
+} // namespace
+
+BENCHMARK(RescheduleOnRefresh, iters) {
+  refreshTimeouts(iters, [](folly::HHWheelTimer& timer, IdleTimeout& timeout) {
+    timer.scheduleTimeout(&timeout, kTimeout);
+  });
+}
+
+BENCHMARK_RELATIVE(LazyRefresh, iters) {
+  refreshTimeouts(iters, [](folly::HHWheelTimer& timer, IdleTimeout& timeout) {
+    if (timeout.lazy.refresh(timeout.isScheduled(), kTimeout)) {
+      timer.scheduleTimeout(&timeout, kTimeout);
+    }
+  });
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/LazyTimeout.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace proxygen;
+using namespace std::chrono;
+
+TEST(LazyTimeoutTest, RefreshWhileScheduled) {
+  LazyTimeout timeout;
+  auto start = getCurrentTime();
+  // Not scheduled yet
+  EXPECT_TRUE(timeout.refresh(false, milliseconds(100), start));
+  // Pushed back without rescheduling
+  EXPECT_FALSE(timeout.refresh(true, milliseconds(100), start + 40ms));
+  EXPECT_FALSE(timeout.refresh(true, milliseconds(100), start + 80ms));
+  EXPECT_EQ(timeout.getDeadline(), start + 180ms);
+
+  // Fires at the first deadline, for the time left
+  EXPECT_EQ(timeout.remaining(start + 100ms), milliseconds(80));
+  // Then at the deadline
+  EXPECT_EQ(timeout.remaining(start + 180ms), milliseconds(0));
+}
+
+TEST(LazyTimeoutTest, Shortened) {
+  LazyTimeout timeout;
+  auto start = getCurrentTime();
+  EXPECT_TRUE(timeout.refresh(false, milliseconds(100), start));
+  // Firing after the new deadline would be too late
+  EXPECT_TRUE(timeout.refresh(true, milliseconds(10), start + 10ms));
+  EXPECT_EQ(timeout.remaining(start + 20ms), milliseconds(0));
+}
+
+TEST(LazyTimeoutTest, RescheduledAfterFiring) {
+  LazyTimeout timeout;
+  auto start = getCurrentTime();
+  EXPECT_TRUE(timeout.refresh(false, milliseconds(100), start));
+  EXPECT_FALSE(timeout.refresh(true, milliseconds(100), start + 50ms));
+  EXPECT_EQ(timeout.remaining(start + 100ms), milliseconds(50));
+  // Pushed back past the rescheduled deadline
+  EXPECT_FALSE(timeout.refresh(true, milliseconds(100), start + 120ms));
+  EXPECT_EQ(timeout.remaining(start + 150ms), milliseconds(70));
+  // Rounded up
+  EXPECT_EQ(timeout.remaining(start + 219ms + 500us), milliseconds(1));
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+#include <map>
+#include <vector>
+
+#include <proxygen/lib/utils/MaglevHash.h>
+
+using namespace proxygen;
+
+namespace {
+
+std::vector<std::pair<std::string, uint64_t>> makeNodes(int numNodes,
+                                                        uint64_t weight) {
+  std::vector<std::pair<std::string, uint64_t>> nodes;
+  for (int i = 0; i < numNodes; ++i) {
+    nodes.emplace_back(folly::to<std::string>("key", i), weight);
+  }
+  return nodes;
+}
+
+} // namespace
+
+TEST(MaglevHash, Consistency) {
+  MaglevHash hashes;
+  auto nodes = makeNodes(10, 1);
+  hashes.build(nodes);
+
+  for (size_t rank = 0; rank < nodes.size() + 2; rank++) {
+    std::map<uint64_t, size_t> mapping;
+    for (int i = 0; i < 10000; ++i) {
+      mapping[i] = hashes.get(i, rank);
+    }
+
+    MaglevHash rebuilt;
+    rebuilt.build(nodes);
+    for (auto&& [key, expected] : mapping) {
+      EXPECT_EQ(expected, hashes.get(key, rank));
+      EXPECT_EQ(expected, rebuilt.get(key, rank));
+    }
+  }
+}
+
+TEST(MaglevHash, DistinctRanks) {
+  MaglevHash hashes;
+  auto nodes = makeNodes(10, 1);
+  hashes.build(nodes);
+
+  for (uint64_t key = 0; key < 1000; ++key) {
+    std::vector<bool> seen(nodes.size());
+    for (size_t rank = 0; rank < nodes.size(); rank++) {
+      auto id = hashes.get(key, rank);
+      EXPECT_FALSE(seen[id]);
+      seen[id] = true;
+    }
+  }
+}
+
+TEST(MaglevHash, ConsistencyWithNewNode) {
+  MaglevHash hashes;
+  int numNodes = 10;
+  auto nodes = makeNodes(numNodes, 1);
+  hashes.build(nodes);
+  std::map<uint64_t, size_t> mapping;
+  for (uint64_t i = 0; i < 10000; ++i) {
+    mapping[i] = hashes.get(i);
+  }
+  hashes = MaglevHash();
+  nodes.emplace_back(folly::to<std::string>("key", numNodes), 1);
+  hashes.build(nodes);
+
+  // Most of the moved keys go to the new node
+  size_t toNewNode = 0;
+  size_t toOtherNodes = 0;
+  for (auto&& [key, expected] : mapping) {
+    size_t id = hashes.get(key);
+    if (id == size_t(numNodes)) {
+      toNewNode++;
+    } else if (id != expected) {
+      toOtherNodes++;
+    }
+  }
+  EXPECT_NEAR(toNewNode, mapping.size() / (numNodes + 1), 200);
+  EXPECT_LT(toOtherNodes, mapping.size() * 3 / 100);
+}
+
+TEST(MaglevHash, ZeroWeightNode) {
+  MaglevHash hashes;
+  auto nodes = makeNodes(10, 1);
+  nodes[3].second = 0;
+  hashes.build(nodes);
+  for (uint64_t key = 0; key < 10000; ++key) {
+    for (size_t rank = 0; rank < nodes.size() - 1; rank++) {
+      EXPECT_NE(hashes.get(key, rank), 3);
+    }
+  }
+}
+
+TEST(MaglevHash, SkewedWeights) {
+  MaglevHash hashes;
+  auto nodes = makeNodes(2, 1000000);
+  nodes[1].second = 1;
+  hashes.build(nodes);
+  // The light node still owns a slot, so both ranks are distinct
+  for (uint64_t key = 0; key < 100; ++key) {
+    EXPECT_NE(hashes.get(key, 0), hashes.get(key, 1));
+  }
+}
+
+TEST(MaglevHash, HighRank) {
+  MaglevHash hashes;
+  auto nodes = makeNodes(3, 1);
+  hashes.build(nodes);
+  for (uint64_t key = 0; key < 100; ++key) {
+    EXPECT_EQ(hashes.get(key, 1000), hashes.get(key, 1000 % 3));
+  }
+}
+
+TEST(MaglevHash, MoreNodesThanSlots) {
+  MaglevHash hashes(5);
+  auto nodes = makeNodes(7, 1);
+  hashes.build(nodes);
+  for (uint64_t key = 0; key < 100; ++key) {
+    for (size_t rank = 0; rank < 2 * nodes.size(); rank++) {
+      EXPECT_LT(hashes.get(key, rank), nodes.size());
+    }
+  }
+}
+
+TEST(MaglevHash, TableSizeNotPrime) {
+  EXPECT_DEATH(MaglevHash(65536), "not prime");
+}
+
+TEST(MaglevHash, DistributionAccuracy) {
+  std::vector<std::string> keys = {
+      "ash_proxy", "prn_proxy", "snc_proxy", "frc_proxy"};
+
+  std::vector<std::vector<uint64_t>> weights = {
+      {248, 342, 2, 384},
+      {10, 10, 10, 10},
+      {25, 25, 10, 10},
+      {100, 10, 10, 1},
+      {100, 5, 5, 5},
+      {922337203685, 12395828300, 50192385101, 59293845010}};
+
+  for (auto& weight : weights) {
+    MaglevHash hashes;
+    std::vector<std::pair<std::string, uint64_t>> nodes;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      nodes.emplace_back(keys[i], weight[i]);
+    }
+    hashes.build(nodes);
+    EXPECT_LE(hashes.getMaxErrorRate(), 0.001);
+
+    std::vector<uint64_t> distribution(keys.size());
+
+    for (uint64_t i = 0; i < 21000; ++i) {
+      distribution[hashes.get(i)]++;
+    }
+
+    uint64_t totalWeight = 0;
+
+    for (auto& w : weight) {
+      totalWeight += w;
+    }
+
+    double maxError = 0.0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      double expected = 100.0 * weight[i] / totalWeight;
+      double actual = 100.0 * distribution[i] / 21000;
+
+      maxError = std::max(maxError, fabs(expected - actual));
+    }
+    // make sure the error rate is less than 1.0%
+    EXPECT_LE(maxError, 1.0);
+  }
+}
+
+TEST(MaglevHash, BoundedLoad) {
+  MaglevHash hashes;
+  auto nodes = makeNodes(10, 1);
+  nodes[0].second = 2;
+  hashes.build(nodes);
+
+  std::vector<uint64_t> loads(nodes.size());
+  uint64_t totalLoad = 0;
+  double loadFactor = 1.25;
+  size_t unmoved = 0;
+  // The same hot keys over and over
+  for (uint64_t i = 0; i < 11000; ++i) {
+    uint64_t key = i % 20;
+    auto id = hashes.getWithBoundedLoad(key, loads, totalLoad, loadFactor);
+    unmoved += id == hashes.get(key);
+    loads[id]++;
+    totalLoad++;
+  }
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    double share = i == 0 ? 2.0 / 11 : 1.0 / 11;
+    EXPECT_LE(loads[i], std::ceil(loadFactor * totalLoad * share));
+  }
+  EXPECT_GT(unmoved, 0);
+
+  // Unloaded, the key keeps its candidate
+  std::vector<uint64_t> noLoads(nodes.size());
+  for (uint64_t key = 0; key < 1000; ++key) {
+    EXPECT_EQ(hashes.getWithBoundedLoad(key, noLoads, 0), hashes.get(key));
+  }
+}
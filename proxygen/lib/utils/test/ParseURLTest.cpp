@@ -247,6 +247,32 @@ TEST(ParseURL, PortOverflow) {
   EXPECT_EQ(u->port(), 1);
 }
 
+TEST(ParseURL, AuthorityIsAView) {
+  std::string url("http://user:pass@[::1]:8080/foo");
+  auto u = ParseURL::parseURL(url);
+  ASSERT_TRUE(u.hasValue());
+  EXPECT_EQ(u->authority(), "[::1]:8080");
+  EXPECT_EQ(u->host().data(), url.data() + 17);
+
+  u = ParseURL::parseURL("localhost:443/foo");
+  ASSERT_TRUE(u.hasValue());
+  EXPECT_EQ(u->authority(), "localhost:443");
+  EXPECT_EQ(u->port(), 443);
+  EXPECT_FALSE(ParseURL::parseURL("localhost:/foo").hasValue());
+  EXPECT_FALSE(ParseURL::parseURL("localhost:44x3/foo").hasValue());
+}
+
+TEST(ParseURL, Move) {
+  std::string url("[::1]:80/foo");
+  auto u = ParseURL::parseURLMaybeInvalid(url);
+  ParseURL moved(std::move(u));
+  EXPECT_TRUE(moved.valid());
+  EXPECT_EQ(moved.host(), "[::1]");
+  EXPECT_EQ(moved.hostNoBrackets(), "::1");
+  EXPECT_EQ(moved.authority(), "[::1]:80");
+  EXPECT_EQ(moved.host().data(), url.data());
+}
+
 TEST(ParseURL, GetQueryParam) {
   auto u = ParseURL::parseURL("localhost/?foo=1&bar=2&baz&bazz=3&bak=");
   ASSERT_TRUE(u.hasValue());
@@ -85,6 +85,29 @@ typedef PerfectIndexMap<HTTPHeaderCode,
                         false>
     DefaultPerfectIndexMap;
 
+typedef PerfectIndexMap<HTTPHeaderCode,
+                        HTTP_HEADER_OTHER,
+                        HTTP_HEADER_NONE,
+                        HTTPCommonHeaders::hash,
+                        true,
+                        true>
+    CaseInsensitivePerfectIndexMap;
+
+std::vector<const std::string*> getTestHeaderMissingStrings() {
+  std::vector<const std::string*> testHeadersMissingStrings;
+  for (uint64_t j = HTTPHeaderCodeCommonOffset;
+       j < HTTPCommonHeaders::num_codes;
+       ++j) {
+    testHeadersMissingStrings.push_back(new std::string(
+        *HTTPCommonHeaders::getPointerToName(static_cast<HTTPHeaderCode>(j)) +
+        "1"));
+  }
+  return testHeadersMissingStrings;
+}
+
+static const std::vector<const std::string*> testHeadersMissingStrings =
+    getTestHeaderMissingStrings();
+
 } // namespace
 
 void UnorderedMapInsertBench(
@@ -275,6 +298,35 @@ BENCHMARK(PerfectIndexMapUniqueGetsOtherString, iters) {
       bPerfectIndexMapUniqueGetsOtherStringMap, testHeadersOtherStrings, iters);
 }
 
+// Uncommon names the map doesn't hold: only their short hashes are compared
+BENCHMARK(PerfectIndexMapUniqueMissesOtherString, iters) {
+  for (int i = 0; i < iters; ++i) {
+    for (auto const& key : testHeadersMissingStrings) {
+      CHECK(bPerfectIndexMapUniqueGetsOtherStringMap.getSingleOrNone(*key) ==
+            folly::none);
+    }
+  }
+}
+
+CaseInsensitivePerfectIndexMap
+getBenchPerfectIndexMapCaseInsensitiveOtherStringTestMap() {
+  CaseInsensitivePerfectIndexMap testMap;
+  for (auto const& keyAndValue : testHeadersOtherStrings) {
+    testMap.add(*keyAndValue, *keyAndValue);
+  }
+  return testMap;
+}
+CaseInsensitivePerfectIndexMap bPerfectIndexMapCaseInsensitiveOtherStringMap =
+    getBenchPerfectIndexMapCaseInsensitiveOtherStringTestMap();
+BENCHMARK(PerfectIndexMapCaseInsensitiveGetsOtherString, iters) {
+  for (int i = 0; i < iters; ++i) {
+    for (auto const& key : testHeadersOtherStrings) {
+      CHECK(bPerfectIndexMapCaseInsensitiveOtherStringMap.getSingleOrNone(
+                *key) != folly::none);
+    }
+  }
+}
+
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -283,6 +335,9 @@ int main(int argc, char** argv) {
   for (auto* testHeaderOtherString : testHeadersOtherStrings) {
     delete testHeaderOtherString;
   }
+  for (auto* testHeaderMissingString : testHeadersMissingStrings) {
+    delete testHeaderMissingString;
+  }
 
   return 0;
 }
@@ -8,6 +8,7 @@
 
 #include <proxygen/lib/utils/PerfectIndexMap.h>
 
+#include <folly/Conv.h>
 #include <folly/portability/GTest.h>
 #include <proxygen/lib/http/HTTPCommonHeaders.h>
 #include <string>
@@ -225,3 +226,34 @@ TYPED_TEST(PerfectIndexMapTests, OtherStringCaseSensitivity) {
     }
   }
 }
+
+TYPED_TEST(PerfectIndexMapTests, ManyOtherKeys) {
+  // More names than short hashes, so that some share one
+  const size_t numKeys = 600;
+  for (size_t i = 0; i < numKeys; ++i) {
+    this->testMap_.set(folly::to<std::string>("X-Other-", i),
+                       std::to_string(i));
+  }
+  EXPECT_EQ(this->testMap_.size(), numKeys);
+  for (size_t i = 0; i < numKeys; ++i) {
+    auto name = folly::to<std::string>("X-Other-", i);
+    auto optional = this->testMap_.getSingleOrNone(name);
+    ASSERT_TRUE(optional.hasValue()) << name;
+    EXPECT_EQ(optional.value(), std::to_string(i));
+    EXPECT_EQ(this->testMap_.getSingleOrNone("x-other-" + std::to_string(i))
+                  .hasValue(),
+              TypeParam::TCaseInsensitive);
+  }
+  EXPECT_FALSE(this->testMap_.getSingleOrNone("X-Other-600").hasValue());
+
+  for (size_t i = 0; i < numKeys; i += 2) {
+    EXPECT_TRUE(this->testMap_.remove(folly::to<std::string>("X-Other-", i)));
+  }
+  EXPECT_EQ(this->testMap_.size(), numKeys / 2);
+  for (size_t i = 0; i < numKeys; ++i) {
+    EXPECT_EQ(this->testMap_
+                  .getSingleOrNone(folly::to<std::string>("X-Other-", i))
+                  .hasValue(),
+              i % 2 == 1);
+  }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <proxygen/lib/utils/PooledObject.h>
+
+#include <folly/portability/GTest.h>
+#include <thread>
+
+using namespace proxygen;
+
+namespace {
+
+struct Pooled : public PooledObject<Pooled> {
+  virtual ~Pooled() = default;
+  uint64_t value{0};
+};
+
+struct PooledChild : public Pooled {
+  char more[256]{};
+};
+
+class PooledObjectTest : public testing::Test {
+ public:
+  void TearDown() override {
+    setPooledObjectCacheSize(0);
+  }
+};
+
+} // namespace
+
+TEST_F(PooledObjectTest, NotPooledByDefault) {
+  EXPECT_EQ(getPooledObjectCacheSize(), 0);
+  auto first = new Pooled();
+  delete first;
+  auto second = new Pooled();
+  EXPECT_EQ(second->value, 0);
+  delete second;
+}
+
+TEST_F(PooledObjectTest, RecyclesMemory) {
+  setPooledObjectCacheSize(2);
+  auto a = new Pooled();
+  auto b = new Pooled();
+  auto c = new Pooled();
+  void* aBlock = a;
+  void* bBlock = b;
+  a->value = 1;
+  delete a;
+  delete b;
+  // Over the limit
+  delete c;
+
+  // Most recently freed first, and constructed anew
+  auto d = new Pooled();
+  EXPECT_EQ(static_cast<void*>(d), bBlock);
+  auto e = new Pooled();
+  EXPECT_EQ(static_cast<void*>(e), aBlock);
+  EXPECT_EQ(e->value, 0);
+  delete d;
+  delete e;
+}
+
+TEST_F(PooledObjectTest, SubclassesNotPooled) {
+  setPooledObjectCacheSize(1);
+  Pooled* child = new PooledChild();
+  void* childBlock = child;
+  delete child;
+  auto p = new Pooled();
+  EXPECT_NE(static_cast<void*>(p), childBlock);
+  delete p;
+}
+
+TEST_F(PooledObjectTest, PerThread) {
+  setPooledObjectCacheSize(1);
+  auto p = new Pooled();
+  void* block = p;
+  delete p;
+  std::thread([&] {
+    auto q = new Pooled();
+    EXPECT_NE(static_cast<void*>(q), block);
+    delete q;
+  }).join();
+  auto r = new Pooled();
+  EXPECT_EQ(static_cast<void*>(r), block);
+  delete r;
+}
@@ -10,6 +10,7 @@
 #include <folly/container/Foreach.h>
 #include <folly/portability/GTest.h>
 #include <map>
+#include <set>
 #include <vector>
 
 #include <proxygen/lib/utils/RendezvousHash.h>
@@ -299,3 +300,39 @@ TEST(RendezvousHash, selectNUnweighted) {
     EXPECT_GT(different, 0);
   }
 }
+
+TEST(RendezvousHash, getWithTwoChoices) {
+  RendezvousHash hashes;
+  std::vector<std::pair<std::string, uint64_t>> nodes;
+  int size = 20;
+  for (int i = 0; i < size; ++i) {
+    nodes.emplace_back(folly::to<std::string>("key", i), 1);
+  }
+  hashes.build(nodes);
+
+  // Even loads keep every key on its node
+  std::vector<uint64_t> loads(size, 10);
+  for (uint64_t key = 0; key < 1000; key++) {
+    EXPECT_EQ(hashes.getWithTwoChoices(key, loads, key), hashes.get(key));
+  }
+
+  // A hot key spreads over its highest ranked nodes only
+  uint64_t key = 12345;
+  auto top = hashes.selectNUnweighted(key, 4);
+  std::set<size_t> candidates(top.begin(), top.end());
+  std::fill(loads.begin(), loads.end(), 0);
+  for (uint64_t seed = 0; seed < 1000; seed++) {
+    auto node = hashes.getWithTwoChoices(key, loads, seed);
+    EXPECT_EQ(candidates.count(node), 1);
+    loads[node]++;
+  }
+  EXPECT_GT(loads[hashes.get(key)], 250);
+  for (auto node : candidates) {
+    EXPECT_GT(loads[node], 100);
+  }
+
+  // One candidate is get()
+  for (uint64_t seed = 0; seed < 10; seed++) {
+    EXPECT_EQ(hashes.getWithTwoChoices(key, loads, seed, 1), hashes.get(key));
+  }
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/FileUtil.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+#include <proxygen/lib/utils/StaticFileCache.h>
+#include <proxygen/lib/utils/ZlibStreamDecompressor.h>
+#include <thread>
+
+using namespace proxygen;
+
+class StaticFileCacheTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    for (size_t i = 0; i < 10000; i++) {
+      contents_.push_back('a' + (i % 26));
+    }
+    ASSERT_TRUE(folly::writeFile(contents_, path().c_str()));
+  }
+
+  std::string path() const {
+    return tmpFile_.path().string();
+  }
+
+  static std::string toString(const folly::IOBuf& buf) {
+    return buf.cloneCoalescedAsValue().moveToFbString().toStdString();
+  }
+
+  folly::test::TemporaryFile tmpFile_;
+  std::string contents_;
+};
+
+TEST_F(StaticFileCacheTest, HitAndMiss) {
+  StaticFileCache cache(StaticFileCache::Options{});
+  auto entry = cache.get(path());
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(cache.get(path()), entry);
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_GE(stats.bytes, contents_.size());
+
+  EXPECT_EQ(entry->size, contents_.size());
+  EXPECT_EQ(entry->contentLength, "10000");
+  EXPECT_FALSE(entry->etag.empty());
+  EXPECT_FALSE(entry->lastModified.empty());
+  auto body = entry->getBody();
+  EXPECT_TRUE(body->isShared());
+  EXPECT_EQ(toString(*body), contents_);
+}
+
+TEST_F(StaticFileCacheTest, Variants) {
+  StaticFileCache cache(StaticFileCache::Options{});
+  auto entry = cache.get(path());
+  ASSERT_NE(entry, nullptr);
+  ASSERT_FALSE(entry->variants.empty());
+  for (const auto& variant : entry->variants) {
+    EXPECT_LT(variant.body->length(), contents_.size());
+  }
+
+  EXPECT_EQ(entry->chooseVariant(""), nullptr);
+  EXPECT_EQ(entry->chooseVariant("identity"), nullptr);
+  auto gzip = entry->chooseVariant("gzip;q=1, identity;q=0.5");
+  ASSERT_NE(gzip, nullptr);
+  EXPECT_EQ(gzip->coding, "gzip");
+  EXPECT_EQ(gzip->contentLength,
+            folly::to<std::string>(gzip->body->length()));
+  ZlibStreamDecompressor decompressor(CompressionType::GZIP);
+  auto decompressed = decompressor.decompress(gzip->body.get());
+  ASSERT_FALSE(decompressor.hasError());
+  EXPECT_EQ(toString(*decompressed), contents_);
+}
+
+TEST_F(StaticFileCacheTest, SmallFileNotCompressed) {
+  ASSERT_TRUE(folly::writeFile(std::string("tiny"), path().c_str()));
+  StaticFileCache cache(StaticFileCache::Options{});
+  auto entry = cache.get(path());
+  ASSERT_NE(entry, nullptr);
+  EXPECT_TRUE(entry->variants.empty());
+  EXPECT_EQ(entry->chooseVariant("gzip"), nullptr);
+}
+
+TEST_F(StaticFileCacheTest, Empty) {
+  ASSERT_TRUE(folly::writeFile(std::string(), path().c_str()));
+  StaticFileCache cache(StaticFileCache::Options{});
+  auto entry = cache.get(path());
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->size, 0);
+  EXPECT_EQ(entry->getBody()->computeChainDataLength(), 0);
+}
+
+TEST_F(StaticFileCacheTest, TooBig) {
+  StaticFileCache::Options options;
+  options.maxFileBytes = contents_.size() - 1;
+  StaticFileCache cache(options);
+  EXPECT_EQ(cache.get(path()), nullptr);
+  EXPECT_EQ(cache.getStats().entries, 0);
+}
+
+TEST_F(StaticFileCacheTest, NotFound) {
+  StaticFileCache cache(StaticFileCache::Options{});
+  EXPECT_THROW(cache.get(path() + ".missing"), std::system_error);
+  EXPECT_THROW(cache.get(tmpFile_.path().parent_path().string()),
+               std::system_error);
+}
+
+TEST_F(StaticFileCacheTest, Invalidate) {
+  StaticFileCache cache(StaticFileCache::Options{});
+  auto entry = cache.get(path());
+  cache.invalidate(path());
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.invalidations, 1);
+  EXPECT_EQ(stats.entries, 0);
+  EXPECT_EQ(stats.bytes, 0);
+  // Still valid for the responses holding it
+  EXPECT_EQ(toString(*entry->getBody()), contents_);
+  EXPECT_NE(cache.get(path()), entry);
+  EXPECT_EQ(cache.getStats().misses, 2);
+}
+
+TEST_F(StaticFileCacheTest, Evict) {
+  folly::test::TemporaryFile other;
+  ASSERT_TRUE(folly::writeFile(contents_, other.path().c_str()));
+  StaticFileCache::Options options;
+  options.gzip = options.zstd = options.brotli = false;
+  options.maxBytes = contents_.size() * 3 / 2;
+  StaticFileCache cache(options);
+  cache.get(path());
+  cache.get(other.path().string());
+  auto stats = cache.getStats();
+  EXPECT_EQ(stats.evictions, 1);
+  EXPECT_EQ(stats.entries, 1);
+  EXPECT_EQ(stats.bytes, contents_.size());
+  cache.get(other.path().string());
+  EXPECT_EQ(cache.getStats().hits, 1);
+}
+
+TEST_F(StaticFileCacheTest, Watch) {
+  folly::EventBase evb;
+  StaticFileCache cache(StaticFileCache::Options{});
+  if (!cache.watch(&evb)) {
+    GTEST_SKIP() << "inotify unavailable";
+  }
+  auto entry = cache.get(path());
+  ASSERT_TRUE(folly::writeFile(std::string("changed"), path().c_str()));
+  for (int i = 0; i < 100 && cache.getStats().entries > 0; i++) {
+    evb.loopOnce(EVLOOP_NONBLOCK);
+    /* sleep override */ std::this_thread::sleep_for(
+        std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(cache.getStats().invalidations, 1);
+  EXPECT_EQ(toString(*cache.get(path())->getBody()), "changed");
+}
@@ -17,6 +17,21 @@ TEST(UtilTest, CaseInsensitiveEqual) {
   ASSERT_FALSE(caseInsensitiveEqual(std::string("foo"), "FOO2"));
   ASSERT_FALSE(caseInsensitiveEqual("fo", "FOO"));
   ASSERT_FALSE(caseInsensitiveEqual("FO", "FOO"));
+
+  // Compared 8 bytes at a time, with a tail
+  ASSERT_TRUE(caseInsensitiveEqual("Access-Control-Allow-Origin",
+                                   "access-control-allow-origin"));
+  ASSERT_FALSE(caseInsensitiveEqual("Access-Control-Allow-Origin",
+                                    "Accesz-control-allow-origin"));
+  ASSERT_FALSE(caseInsensitiveEqual("access-control-allow-origin",
+                                    "access-control-allow-origim"));
+  // Only letters fold: these differ by the case bit
+  ASSERT_FALSE(caseInsensitiveEqual("x-header^1", "x-header~1"));
+  ASSERT_FALSE(caseInsensitiveEqual("x-head@r-1", "x-head`r-1"));
+  ASSERT_FALSE(caseInsensitiveEqual("x-header[1]", "x-header{1}"));
+  ASSERT_FALSE(caseInsensitiveEqual("x-header-\xc1", "x-header-\xe1"));
+  ASSERT_FALSE(caseInsensitiveEqual("\xc1-header-1", "\xe1-header-1"));
+  ASSERT_TRUE(caseInsensitiveEqual("X-AZaz-\xc1-09", "x-azAZ-\xc1-09"));
 }
 
 TEST(UtilTest, findLastOf) {
@@ -41,3 +56,20 @@ TEST(UtilTest, validateURL) {
   EXPECT_TRUE(validateURL(input("/foo\xff"), URLValidateMode::STRICT_COMPAT));
   EXPECT_FALSE(validateURL(input("/foo\xff"), URLValidateMode::STRICT));
 }
+
+TEST(UtilTest, validateURLEveryPosition) {
+  // Past the first eight bytes, and in each byte of a word
+  for (size_t i = 0; i < 24; i++) {
+    for (char c : {'\0', '\t', ' ', '\x7f', '\x80', '\xff'}) {
+      std::string url(24, 'a');
+      url[i] = c;
+      auto range = folly::ByteRange(folly::StringPiece(url));
+      bool high = static_cast<uint8_t>(c) > 0x7f;
+      EXPECT_FALSE(validateURL(range, URLValidateMode::STRICT)) << i;
+      EXPECT_EQ(high, validateURL(range, URLValidateMode::STRICT_COMPAT))
+          << i;
+    }
+  }
+  EXPECT_TRUE(validateURL(input("/!azAZ09~-._?#[]@:%20&=+$,;'()*"),
+                          URLValidateMode::STRICT));
+}
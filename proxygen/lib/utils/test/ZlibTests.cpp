@@ -145,3 +145,16 @@ TEST_F(ZlibTests, CompressDecompressSmallBuffer) {
     compressThenDecompress(CompressionType::GZIP, 4, makeBuf(127));
   });
 }
+
+TEST_F(ZlibTests, DecompressAtMost) {
+  ZlibStreamCompressor zc(CompressionType::GZIP, 6);
+  auto zeros = IOBuf::create(1024 * 1024);
+  memset(zeros->writableData(), 0, zeros->capacity());
+  zeros->append(zeros->capacity());
+  auto compressed = zc.compress(zeros.get(), true);
+
+  ZlibStreamDecompressor zd(CompressionType::GZIP);
+  auto decompressed = zd.decompressAtMost(compressed.get(), 5000);
+  ASSERT_FALSE(zd.hasError());
+  EXPECT_EQ(decompressed->computeChainDataLength(), 5000);
+}
@@ -6,6 +6,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <folly/Conv.h>
 #include <folly/Random.h>
 #include <folly/ScopeGuard.h>
 #include <folly/compression/Compression.h>
@@ -13,6 +14,7 @@
 #include <folly/io/IOBuf.h>
 #include <folly/portability/GTest.h>
 #include <glog/logging.h>
+#include <proxygen/lib/utils/ZstdDictionary.h>
 #include <proxygen/lib/utils/ZstdStreamCompressor.h>
 #include <proxygen/lib/utils/ZstdStreamDecompressor.h>
 
@@ -241,3 +243,107 @@ TEST_F(ZstdTests, CompressDecompressStreamingProxygenIndependent) {
         std::move(input_pieces), true, reuseBuf);
   }
 }
+
+namespace {
+
+// A raw content dictionary, so it has no zstd ID
+std::shared_ptr<const ZstdDictionary> makeDictionary() {
+  std::string content;
+  for (int i = 0; i < 64; ++i) {
+    content += folly::to<std::string>(
+        R"({"id":)", i, R"(,"name":"item","tags":["alpha","beta"]})");
+  }
+  return std::make_shared<const ZstdDictionary>(std::move(content), 3);
+}
+
+std::unique_ptr<folly::IOBuf> makeJson() {
+  return folly::IOBuf::copyBuffer(
+      R"({"id":7,"name":"item","tags":["alpha","beta","gamma"]})");
+}
+
+} // anonymous namespace
+
+TEST_F(ZstdTests, DictionaryDcz) {
+  auto dictionary = makeDictionary();
+  auto store = std::make_shared<const ZstdDictionaryStore>(
+      std::vector<std::shared_ptr<const ZstdDictionary>>{dictionary});
+  EXPECT_EQ(store->findByHeader(dictionary->getHashHeaderValue()), dictionary);
+  EXPECT_EQ(store->findByHash(folly::range(dictionary->getHash())),
+            dictionary);
+
+  auto input = makeJson();
+  ZstdStreamCompressor compressor(dictionary, false, /*dczFraming=*/true);
+  auto compressed = compressor.compress(input.get());
+  ASSERT_FALSE(compressor.hasError());
+  ASSERT_GT(compressed->computeChainDataLength(),
+            ZstdDictionary::kDczHeaderSize);
+  EXPECT_EQ(compressed->cloneCoalescedAsValue()
+                .moveToFbString()
+                .substr(0, ZstdDictionary::kDczHeaderSize)
+                .toStdString(),
+            dictionary->getDczHeader());
+  // Most of the input is in the dictionary
+  ZstdStreamCompressor plain(3);
+  EXPECT_LT(compressed->computeChainDataLength() -
+                ZstdDictionary::kDczHeaderSize,
+            plain.compress(input.get())->computeChainDataLength());
+
+  // Split within the dcz header
+  auto tail = compressed->cloneCoalesced();
+  tail->trimStart(20);
+  auto head = compressed->cloneCoalesced();
+  head->trimEnd(head->length() - 20);
+  ZstdStreamDecompressor decompressor(store, /*dczFraming=*/true);
+  EXPECT_EQ(decompressor.decompress(head.get())->computeChainDataLength(), 0);
+  auto decompressed = decompressor.decompress(tail.get());
+  ASSERT_FALSE(decompressor.hasError());
+  EXPECT_TRUE(decompressor.finished());
+  EXPECT_TRUE(IOBufEqualTo()(input, decompressed));
+}
+
+TEST_F(ZstdTests, DictionaryDczUnknown) {
+  auto input = makeJson();
+  ZstdStreamCompressor compressor(makeDictionary(), false, true);
+  auto compressed = compressor.compress(input.get());
+
+  auto store = std::make_shared<const ZstdDictionaryStore>(
+      std::vector<std::shared_ptr<const ZstdDictionary>>{});
+  ZstdStreamDecompressor decompressor(store, /*dczFraming=*/true);
+  EXPECT_EQ(decompressor.decompress(compressed.get()), nullptr);
+  EXPECT_TRUE(decompressor.hasError());
+}
+
+TEST_F(ZstdTests, DictionaryPieces) {
+  auto dictionary = makeDictionary();
+  auto store = std::make_shared<const ZstdDictionaryStore>(
+      std::vector<std::shared_ptr<const ZstdDictionary>>{dictionary});
+  for (bool independent : {false, true}) {
+    ZstdStreamCompressor compressor(dictionary, independent, true);
+    ZstdStreamDecompressor decompressor(store, true);
+    auto decompressed = folly::IOBuf::create(0);
+    auto expected = folly::IOBuf::create(0);
+    for (int i = 0; i < 3; ++i) {
+      auto piece = makeJson();
+      auto out = decompressor.decompress(
+          compressor.compress(piece.get(), i == 2).get());
+      ASSERT_FALSE(decompressor.hasError());
+      decompressed->prependChain(std::move(out));
+      expected->prependChain(std::move(piece));
+    }
+    EXPECT_TRUE(decompressor.finished());
+    EXPECT_TRUE(IOBufEqualTo()(expected, decompressed));
+  }
+}
+
+TEST_F(ZstdTests, DecompressAtMost) {
+  ZstdStreamCompressor compressor(3);
+  auto zeros = IOBuf::create(1024 * 1024);
+  memset(zeros->writableData(), 0, zeros->capacity());
+  zeros->append(zeros->capacity());
+  auto compressed = compressor.compress(zeros.get(), true);
+
+  ZstdStreamDecompressor decompressor(/*reuseOutBuf=*/false);
+  auto decompressed = decompressor.decompressAtMost(compressed.get(), 5000);
+  ASSERT_FALSE(decompressor.hasError());
+  EXPECT_EQ(decompressed->computeChainDataLength(), 5000);
+}